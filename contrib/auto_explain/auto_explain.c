@@ -30,6 +30,7 @@ static bool auto_explain_log_buffers = false;
 static bool auto_explain_log_wal = false;
 static bool auto_explain_log_triggers = false;
 static bool auto_explain_log_timing = true;
+static int	auto_explain_log_timing_sample_interval = 1;
 static bool auto_explain_log_settings = false;
 static int	auto_explain_log_format = EXPLAIN_FORMAT_TEXT;
 static int	auto_explain_log_level = LOG;
@@ -78,6 +79,8 @@ static ExecutorEnd_hook_type prev_ExecutorEnd = NULL;
 void		_PG_init(void);
 void		_PG_fini(void);
 
+static void assign_log_timing_sample_interval(int newval, void *extra);
+
 static void explain_ExecutorStart(QueryDesc *queryDesc, int eflags);
 static void explain_ExecutorRun(QueryDesc *queryDesc,
 								ScanDirection direction,
@@ -217,6 +220,18 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomIntVariable("auto_explain.log_timing_sample_interval",
+							"Time only every Nth execution of each plan node.",
+							"The time of the other executions is extrapolated.",
+							&auto_explain_log_timing_sample_interval,
+							1,
+							1, INT_MAX,
+							PGC_SUSET,
+							0,
+							NULL,
+							assign_log_timing_sample_interval,
+							NULL);
+
 	DefineCustomRealVariable("auto_explain.sample_rate",
 							 "Fraction of queries to process.",
 							 NULL,
@@ -256,6 +271,18 @@ _PG_fini(void)
 	ExecutorEnd_hook = prev_ExecutorEnd;
 }
 
+/*
+ * Pass auto_explain.log_timing_sample_interval on to the instrumentation
+ * code.  Doing this in an assign hook rather than in ExecutorStart makes
+ * parallel workers, which restore our GUCs but skip our hooks, time plan
+ * nodes the same way as the leader.
+ */
+static void
+assign_log_timing_sample_interval(int newval, void *extra)
+{
+	instr_timer_sample_interval = newval;
+}
+
 /*
  * ExecutorStart hook: start up logging if needed
  */
@@ -286,7 +313,10 @@ explain_ExecutorStart(QueryDesc *queryDesc, int eflags)
 		/* Enable per-node instrumentation iff log_analyze is required. */
 		if (auto_explain_log_analyze && (eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0)
 		{
-			if (auto_explain_log_timing)
+			if (auto_explain_log_timing &&
+				auto_explain_log_timing_sample_interval > 1)
+				queryDesc->instrument_options |= INSTRUMENT_TIMER_SAMPLED;
+			else if (auto_explain_log_timing)
 				queryDesc->instrument_options |= INSTRUMENT_TIMER;
 			else
 				queryDesc->instrument_options |= INSTRUMENT_ROWS;
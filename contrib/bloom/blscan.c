@@ -16,6 +16,7 @@
 #include "bloom.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/pg_simd.h"
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
 #include "utils/memutils.h"
@@ -35,6 +36,8 @@ blbeginscan(Relation r, int nkeys, int norderbys)
 	so = (BloomScanOpaque) palloc(sizeof(BloomScanOpaqueData));
 	initBloomState(&so->state, scan->indexRelation);
 	so->sign = NULL;
+	so->signWords = NULL;
+	so->nSignWords = 0;
 
 	scan->opaque = so;
 
@@ -53,6 +56,9 @@ blrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
 	if (so->sign)
 		pfree(so->sign);
 	so->sign = NULL;
+	if (so->signWords)
+		pfree(so->signWords);
+	so->signWords = NULL;
 
 	if (scankey && scan->numberOfKeys > 0)
 	{
@@ -72,6 +78,61 @@ blendscan(IndexScanDesc scan)
 	if (so->sign)
 		pfree(so->sign);
 	so->sign = NULL;
+	if (so->signWords)
+		pfree(so->signWords);
+	so->signWords = NULL;
+}
+
+#ifndef USE_NO_SIMD
+#define SIGN_WORDS_PER_VECTOR	((int) (sizeof(Vector8) / sizeof(BloomSignatureWord)))
+#endif
+
+/*
+ * Check whether an index tuple's signature contains all bits of the scan
+ * signature.
+ *
+ * A scan signature usually has only a few bits set, so normally we test just
+ * its nonzero words.  If there are more of those than vectors covering the
+ * signature, we instead test 16 bytes at a time with vector instructions.
+ */
+static inline bool
+signatureMatches(BloomScanOpaque so, const BloomSignatureWord *isign)
+{
+	int			len = so->state.opts.bloomLength;
+
+#ifndef USE_NO_SIMD
+	if (so->nSignWords > len / SIGN_WORDS_PER_VECTOR &&
+		len >= SIGN_WORDS_PER_VECTOR)
+	{
+		int			i;
+
+		for (i = 0; i + SIGN_WORDS_PER_VECTOR <= len; i += SIGN_WORDS_PER_VECTOR)
+		{
+			Vector8		qv;
+			Vector8		iv;
+
+			vector8_load(&qv, (const uint8 *) &so->sign[i]);
+			vector8_load(&iv, (const uint8 *) &isign[i]);
+			if (!vector8_is_zero(vector8_andnot(qv, iv)))
+				return false;
+		}
+		for (; i < len; i++)
+		{
+			if ((isign[i] & so->sign[i]) != so->sign[i])
+				return false;
+		}
+		return true;
+	}
+#endif
+
+	for (int j = 0; j < so->nSignWords; j++)
+	{
+		int			i = so->signWords[j];
+
+		if ((isign[i] & so->sign[i]) != so->sign[i])
+			return false;
+	}
+	return true;
 }
 
 /*
@@ -113,6 +174,15 @@ blgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 
 			skey++;
 		}
+
+		/* Remember which words of the signature need checking */
+		so->signWords = palloc(sizeof(int) * so->state.opts.bloomLength);
+		so->nSignWords = 0;
+		for (i = 0; i < so->state.opts.bloomLength; i++)
+		{
+			if (so->sign[i] != 0)
+				so->signWords[so->nSignWords++] = i;
+		}
 	}
 
 	/*
@@ -142,21 +212,11 @@ blgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 			for (offset = 1; offset <= maxOffset; offset++)
 			{
 				BloomTuple *itup = BloomPageGetTuple(&so->state, page, offset);
-				bool		res = true;
 
 				/* Check index signature with scan signature */
-				for (i = 0; i < so->state.opts.bloomLength; i++)
-				{
-					if ((itup->sign[i] & so->sign[i]) != so->sign[i])
-					{
-						res = false;
-						break;
-					}
-				}
-
-				/* Add matching tuples to bitmap */
-				if (res)
+				if (signatureMatches(so, itup->sign))
 				{
+					/* Add matching tuples to bitmap */
 					tbm_add_tuples(tbm, &itup->heapPtr, 1, true);
 					ntids++;
 				}
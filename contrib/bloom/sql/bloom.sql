@@ -73,6 +73,15 @@ SELECT count(*) FROM tstu WHERE i = 7;
 SELECT count(*) FROM tstu WHERE t = '5';
 SELECT count(*) FROM tstu WHERE i = 7 AND t = '5';
 
+-- A long signature with many bits per column exercises the vectorized check
+DROP INDEX bloomidxu;
+CREATE INDEX bloomidxu ON tstu USING bloom (i, t)
+  WITH (length = 256, col1 = 64, col2 = 64);
+
+SELECT count(*) FROM tstu WHERE i = 7;
+SELECT count(*) FROM tstu WHERE t = '5';
+SELECT count(*) FROM tstu WHERE i = 7 AND t = '5';
+
 RESET enable_seqscan;
 RESET enable_bitmapscan;
 RESET enable_indexscan;
@@ -11,12 +11,18 @@
 #include "access/htup_details.h"
 #include "catalog/pg_type.h"
 #include "funcapi.h"
+#include "miscadmin.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "utils/hsearch.h"
+#include "utils/tuplestore.h"
 
 
 #define NUM_BUFFERCACHE_PAGES_MIN_ELEM	8
 #define NUM_BUFFERCACHE_PAGES_ELEM	9
+#define NUM_BUFFERCACHE_SUMMARY_ELEM	5
+#define NUM_BUFFERCACHE_USAGE_COUNTS_ELEM	4
+#define NUM_BUFFERCACHE_RELATIONS_ELEM	8
 
 PG_MODULE_MAGIC;
 
@@ -54,11 +60,28 @@ typedef struct
 } BufferCachePagesContext;
 
 
+/*
+ * Hash table entry for pg_buffercache_relations().
+ */
+typedef struct
+{
+	RelFileNode rnode;			/* hash key: relation ... */
+	ForkNumber	forknum;		/* ... and fork */
+	int32		buffers;
+	int32		dirty;
+	int32		pinned;
+	int64		usagecount_total;
+} BufferCacheRelationEntry;
+
+
 /*
  * Function returning data from the shared buffer cache - buffer number,
  * relation node/tablespace/database/blocknum and dirty indicator.
  */
 PG_FUNCTION_INFO_V1(pg_buffercache_pages);
+PG_FUNCTION_INFO_V1(pg_buffercache_summary);
+PG_FUNCTION_INFO_V1(pg_buffercache_usage_counts);
+PG_FUNCTION_INFO_V1(pg_buffercache_relations);
 
 Datum
 pg_buffercache_pages(PG_FUNCTION_ARGS)
@@ -237,3 +260,240 @@ pg_buffercache_pages(PG_FUNCTION_ARGS)
 	else
 		SRF_RETURN_DONE(funcctx);
 }
+
+/*
+ * Set up a tuplestore to return the results of a set-returning function in
+ * materialize mode.
+ */
+static Tuplestorestate *
+buffercache_init_tuplestore(FunctionCallInfo fcinfo, TupleDesc *tupdesc)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Tuplestorestate *tupstore;
+	MemoryContext oldcontext;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	if (get_call_result_type(fcinfo, NULL, tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = *tupdesc;
+	MemoryContextSwitchTo(oldcontext);
+
+	return tupstore;
+}
+
+/*
+ * Return a single row summarizing the state of the whole buffer cache.
+ *
+ * Unlike pg_buffercache_pages, this neither takes buffer header locks nor
+ * builds a row per buffer; each buffer's state word is simply read
+ * atomically.  The result is therefore cheap to compute even for a very
+ * large cache, but, as with pg_buffercache_pages, not a consistent snapshot
+ * across buffers.
+ */
+Datum
+pg_buffercache_summary(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[NUM_BUFFERCACHE_SUMMARY_ELEM];
+	bool		nulls[NUM_BUFFERCACHE_SUMMARY_ELEM];
+	int32		buffers_used = 0;
+	int32		buffers_unused = 0;
+	int32		buffers_dirty = 0;
+	int32		buffers_pinned = 0;
+	int64		usagecount_total = 0;
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	for (int i = 0; i < NBuffers; i++)
+	{
+		BufferDesc *bufHdr = GetBufferDescriptor(i);
+		uint32		buf_state = pg_atomic_read_u32(&bufHdr->state);
+
+		if (buf_state & BM_VALID)
+		{
+			buffers_used++;
+			usagecount_total += BUF_STATE_GET_USAGECOUNT(buf_state);
+
+			if (buf_state & BM_DIRTY)
+				buffers_dirty++;
+		}
+		else
+			buffers_unused++;
+
+		if (BUF_STATE_GET_REFCOUNT(buf_state) > 0)
+			buffers_pinned++;
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	memset(nulls, 0, sizeof(nulls));
+	values[0] = Int32GetDatum(buffers_used);
+	values[1] = Int32GetDatum(buffers_unused);
+	values[2] = Int32GetDatum(buffers_dirty);
+	values[3] = Int32GetDatum(buffers_pinned);
+	if (buffers_used != 0)
+		values[4] = Float8GetDatum((double) usagecount_total / buffers_used);
+	else
+		nulls[4] = true;
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
+/*
+ * Return one row per possible usage count, with the number of buffers having
+ * that usage count and how many of those are dirty and pinned.  Like
+ * pg_buffercache_summary, this reads buffer states without locking.
+ */
+Datum
+pg_buffercache_usage_counts(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	int32		buffers[BM_MAX_USAGE_COUNT + 1] = {0};
+	int32		dirty[BM_MAX_USAGE_COUNT + 1] = {0};
+	int32		pinned[BM_MAX_USAGE_COUNT + 1] = {0};
+
+	tupstore = buffercache_init_tuplestore(fcinfo, &tupdesc);
+
+	for (int i = 0; i < NBuffers; i++)
+	{
+		BufferDesc *bufHdr = GetBufferDescriptor(i);
+		uint32		buf_state = pg_atomic_read_u32(&bufHdr->state);
+		int			usage_count = BUF_STATE_GET_USAGECOUNT(buf_state);
+
+		buffers[usage_count]++;
+
+		if (buf_state & BM_DIRTY)
+			dirty[usage_count]++;
+
+		if (BUF_STATE_GET_REFCOUNT(buf_state) > 0)
+			pinned[usage_count]++;
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	for (int i = 0; i < BM_MAX_USAGE_COUNT + 1; i++)
+	{
+		Datum		values[NUM_BUFFERCACHE_USAGE_COUNTS_ELEM];
+		bool		nulls[NUM_BUFFERCACHE_USAGE_COUNTS_ELEM] = {0};
+
+		values[0] = Int32GetDatum(i);
+		values[1] = Int32GetDatum(buffers[i]);
+		values[2] = Int32GetDatum(dirty[i]);
+		values[3] = Int32GetDatum(pinned[i]);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Return one row per relation fork present in the buffer cache, with the
+ * number of its buffers, how many of those are dirty and pinned, and their
+ * average usage count.
+ *
+ * Each buffer header is locked just long enough to copy its tag and state,
+ * so that a buffer being replaced concurrently can't be attributed to a
+ * relation that doesn't exist.  The aggregation happens here, so the result
+ * has only as many rows as there are cached relation forks.
+ */
+Datum
+pg_buffercache_relations(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	HASHCTL		ctl;
+	HTAB	   *relations;
+	HASH_SEQ_STATUS status;
+	BufferCacheRelationEntry *entry;
+
+	tupstore = buffercache_init_tuplestore(fcinfo, &tupdesc);
+
+	ctl.keysize = offsetof(BufferCacheRelationEntry, buffers);
+	ctl.entrysize = sizeof(BufferCacheRelationEntry);
+	ctl.hcxt = CurrentMemoryContext;
+	relations = hash_create("pg_buffercache relations", 1024, &ctl,
+							HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	for (int i = 0; i < NBuffers; i++)
+	{
+		BufferDesc *bufHdr = GetBufferDescriptor(i);
+		BufferCacheRelationEntry key;
+		uint32		buf_state;
+		bool		found;
+
+		/* Skip buffers that are obviously unused without locking them */
+		if (!(pg_atomic_read_u32(&bufHdr->state) & BM_VALID))
+			continue;
+
+		memset(&key, 0, sizeof(key));
+		buf_state = LockBufHdr(bufHdr);
+		key.rnode = bufHdr->tag.rnode;
+		key.forknum = bufHdr->tag.forkNum;
+		UnlockBufHdr(bufHdr, buf_state);
+
+		if (!(buf_state & BM_VALID) || !(buf_state & BM_TAG_VALID))
+			continue;
+
+		entry = (BufferCacheRelationEntry *)
+			hash_search(relations, &key, HASH_ENTER, &found);
+		if (!found)
+		{
+			entry->buffers = 0;
+			entry->dirty = 0;
+			entry->pinned = 0;
+			entry->usagecount_total = 0;
+		}
+
+		entry->buffers++;
+		entry->usagecount_total += BUF_STATE_GET_USAGECOUNT(buf_state);
+		if (buf_state & BM_DIRTY)
+			entry->dirty++;
+		if (BUF_STATE_GET_REFCOUNT(buf_state) > 0)
+			entry->pinned++;
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	hash_seq_init(&status, relations);
+	while ((entry = (BufferCacheRelationEntry *) hash_seq_search(&status)) != NULL)
+	{
+		Datum		values[NUM_BUFFERCACHE_RELATIONS_ELEM];
+		bool		nulls[NUM_BUFFERCACHE_RELATIONS_ELEM] = {0};
+
+		values[0] = ObjectIdGetDatum(entry->rnode.relNode);
+		values[1] = ObjectIdGetDatum(entry->rnode.spcNode);
+		values[2] = ObjectIdGetDatum(entry->rnode.dbNode);
+		values[3] = Int16GetDatum(entry->forknum);
+		values[4] = Int32GetDatum(entry->buffers);
+		values[5] = Int32GetDatum(entry->dirty);
+		values[6] = Int32GetDatum(entry->pinned);
+		values[7] = Float8GetDatum((double) entry->usagecount_total /
+								   entry->buffers);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	hash_destroy(relations);
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
@@ -10,11 +10,14 @@
  *		and we need to lock the relations so that we don't try to prewarm
  *		pages from a relation that is in the process of being dropped.
  *
- *		While prewarming, autoprewarm will use two workers.  There's a
- *		leader worker that reads and sorts the list of blocks to be
- *		prewarmed and then launches a per-database worker for each
- *		relevant database in turn.  The former keeps running after the
- *		initial prewarm is complete to update the dump file periodically.
+ *		While prewarming, autoprewarm uses a leader worker that reads and
+ *		sorts the list of blocks to be prewarmed, splits each relevant
+ *		database's blocks into pg_prewarm.autoprewarm_workers chunks, and
+ *		launches a worker for each chunk, with no more than that many running
+ *		at once.  The workers read blocks through a read stream, so that runs
+ *		of consecutive blocks are read with single large reads.  The leader
+ *		keeps running after the initial prewarm is complete to update the
+ *		dump file periodically.
  *
  *	Copyright (c) 2016-2020, PostgreSQL Global Development Group
  *
@@ -36,6 +39,7 @@
 #include "pgstat.h"
 #include "postmaster/bgworker.h"
 #include "postmaster/interrupt.h"
+#include "postmaster/postmaster.h"
 #include "storage/buf_internals.h"
 #include "storage/dsm.h"
 #include "storage/ipc.h"
@@ -43,6 +47,7 @@
 #include "storage/lwlock.h"
 #include "storage/proc.h"
 #include "storage/procsignal.h"
+#include "storage/read_stream.h"
 #include "storage/shmem.h"
 #include "storage/smgr.h"
 #include "tcop/tcopprot.h"
@@ -73,13 +78,30 @@ typedef struct AutoPrewarmSharedState
 	pid_t		bgworker_pid;	/* for main bgworker */
 	pid_t		pid_using_dumpfile; /* for autoprewarm or block dump */
 
-	/* Following items are for communication with per-database worker */
+	/* Following items are for communication with per-database workers */
 	dsm_handle	block_info_handle;
+	pg_atomic_uint32 prewarmed_blocks;
+} AutoPrewarmSharedState;
+
+/*
+ * The chunk of the block list to be prewarmed by one per-database worker,
+ * passed in its bgw_extra.
+ */
+typedef struct AutoPrewarmTask
+{
 	Oid			database;
 	int			prewarm_start_idx;
 	int			prewarm_stop_idx;
-	int			prewarmed_blocks;
-} AutoPrewarmSharedState;
+} AutoPrewarmTask;
+
+/* State of the read stream prewarming one fork of a relation. */
+typedef struct AutoPrewarmReadStreamData
+{
+	BlockInfoRecord *block_info;
+	int			pos;
+	int			stop_idx;
+	BlockNumber nblocks;
+} AutoPrewarmReadStreamData;
 
 void		_PG_init(void);
 void		autoprewarm_main(Datum main_arg);
@@ -91,7 +113,14 @@ PG_FUNCTION_INFO_V1(autoprewarm_dump_now);
 static void apw_load_buffers(void);
 static int	apw_dump_now(bool is_bgworker, bool dump_unlogged);
 static void apw_start_leader_worker(void);
-static void apw_start_database_worker(void);
+static void apw_start_database_worker(AutoPrewarmTask *task,
+									  BackgroundWorkerHandle **handles);
+static int	apw_wait_for_workers(BackgroundWorkerHandle **handles,
+								 int max_running, int *nrunning);
+static int	apw_prewarm_relation(Relation rel, BlockInfoRecord *block_info,
+								 int pos, int stop_idx);
+static BlockNumber apw_read_stream_next_block(ReadStream *stream,
+											  void *callback_private_data);
 static bool apw_init_shmem(void);
 static void apw_detach_shmem(int code, Datum arg);
 static int	apw_compare_blockinfo(const void *p, const void *q);
@@ -102,6 +131,7 @@ static AutoPrewarmSharedState *apw_state = NULL;
 /* GUC variables. */
 static bool autoprewarm = true; /* start worker? */
 static int	autoprewarm_interval;	/* dump interval */
+static int	autoprewarm_workers = 1;	/* max. concurrent prewarm workers */
 
 /*
  * Module load callback.
@@ -121,6 +151,18 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomIntVariable("pg_prewarm.autoprewarm_workers",
+							"Sets the maximum number of workers that reload blocks at the same time",
+							NULL,
+							&autoprewarm_workers,
+							1,
+							1, MAX_BACKENDS,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
 	if (!process_shared_preload_libraries_in_progress)
 		return;
 
@@ -258,8 +300,8 @@ autoprewarm_main(Datum main_arg)
 }
 
 /*
- * Read the dump file and launch per-database workers one at a time to
- * prewarm the buffers found there.
+ * Read the dump file and launch per-database workers to prewarm the buffers
+ * found there.
  */
 static void
 apw_load_buffers(void)
@@ -269,6 +311,8 @@ apw_load_buffers(void)
 				i;
 	BlockInfoRecord *blkinfo;
 	dsm_segment *seg;
+	BackgroundWorkerHandle **handles;
+	int			start_idx;
 
 	/*
 	 * Skip the prewarm if the dump file is in use; otherwise, prevent any
@@ -340,18 +384,22 @@ apw_load_buffers(void)
 
 	/* Populate shared memory state. */
 	apw_state->block_info_handle = dsm_segment_handle(seg);
-	apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx = 0;
-	apw_state->prewarmed_blocks = 0;
+	pg_atomic_write_u32(&apw_state->prewarmed_blocks, 0);
+
+	handles = (BackgroundWorkerHandle **)
+		palloc0(sizeof(BackgroundWorkerHandle *) * autoprewarm_workers);
 
 	/* Get the info position of the first block of the next database. */
-	while (apw_state->prewarm_start_idx < num_elements)
+	start_idx = 0;
+	while (start_idx < num_elements)
 	{
-		int			j = apw_state->prewarm_start_idx;
+		int			j = start_idx;
 		Oid			current_db = blkinfo[j].database;
+		int			chunk_size;
 
 		/*
-		 * Advance the prewarm_stop_idx to the first BlockInfoRecord that does
-		 * not belong to this database.
+		 * Advance j to the first BlockInfoRecord that does not belong to this
+		 * database.
 		 */
 		j++;
 		while (j < num_elements)
@@ -378,25 +426,35 @@ apw_load_buffers(void)
 		if (current_db == InvalidOid)
 			break;
 
-		/* Configure stop point and database for next per-database worker. */
-		apw_state->prewarm_stop_idx = j;
-		apw_state->database = current_db;
-		Assert(apw_state->prewarm_start_idx < apw_state->prewarm_stop_idx);
-
 		/* If we've run out of free buffers, don't launch another worker. */
 		if (!have_free_buffer())
 			break;
 
 		/*
-		 * Start a per-database worker to load blocks for this database; this
-		 * function will return once the per-database worker exits.
+		 * Split this database's blocks evenly between the workers, and start
+		 * a per-database worker for each chunk; this waits for a running
+		 * worker to exit if there are already as many as allowed.
 		 */
-		apw_start_database_worker();
+		chunk_size = (j - start_idx + autoprewarm_workers - 1) /
+			autoprewarm_workers;
+		for (i = start_idx; i < j; i += chunk_size)
+		{
+			AutoPrewarmTask task;
+
+			task.database = current_db;
+			task.prewarm_start_idx = i;
+			task.prewarm_stop_idx = Min(i + chunk_size, j);
+			apw_start_database_worker(&task, handles);
+		}
 
 		/* Prepare for next database. */
-		apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx;
+		start_idx = j;
 	}
 
+	/* Wait for all workers to finish. */
+	(void) apw_wait_for_workers(handles, 0, NULL);
+	pfree(handles);
+
 	/* Clean up. */
 	dsm_detach(seg);
 	LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
@@ -407,27 +465,28 @@ apw_load_buffers(void)
 	/* Report our success. */
 	ereport(LOG,
 			(errmsg("autoprewarm successfully prewarmed %d of %d previously-loaded blocks",
-					apw_state->prewarmed_blocks, num_elements)));
+					(int) pg_atomic_read_u32(&apw_state->prewarmed_blocks),
+					num_elements)));
 }
 
 /*
- * Prewarm all blocks for one database (and possibly also global objects, if
- * those got grouped with this database).
+ * Prewarm all blocks of one chunk of the block list for one database (and
+ * possibly also global objects, if those got grouped with this database).
  */
 void
 autoprewarm_database_main(Datum main_arg)
 {
+	AutoPrewarmTask task;
 	int			pos;
 	BlockInfoRecord *block_info;
-	Relation	rel = NULL;
-	BlockNumber nblocks = 0;
-	BlockInfoRecord *old_blk = NULL;
 	dsm_segment *seg;
 
 	/* Establish signal handlers; once that's done, unblock signals. */
 	pqsignal(SIGTERM, die);
 	BackgroundWorkerUnblockSignals();
 
+	memcpy(&task, MyBgworkerEntry->bgw_extra, sizeof(AutoPrewarmTask));
+
 	/* Connect to correct database and get block information. */
 	apw_init_shmem();
 	seg = dsm_attach(apw_state->block_info_handle);
@@ -435,18 +494,20 @@ autoprewarm_database_main(Datum main_arg)
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("could not map dynamic shared memory segment")));
-	BackgroundWorkerInitializeConnectionByOid(apw_state->database, InvalidOid, 0);
+	BackgroundWorkerInitializeConnectionByOid(task.database, InvalidOid, 0);
 	block_info = (BlockInfoRecord *) dsm_segment_address(seg);
-	pos = apw_state->prewarm_start_idx;
+	pos = task.prewarm_start_idx;
 
 	/*
 	 * Loop until we run out of blocks to prewarm or until we run out of free
-	 * buffers.
+	 * buffers, one relation at a time.
 	 */
-	while (pos < apw_state->prewarm_stop_idx && have_free_buffer())
+	while (pos < task.prewarm_stop_idx && have_free_buffer())
 	{
-		BlockInfoRecord *blk = &block_info[pos++];
-		Buffer		buf;
+		BlockInfoRecord *blk = &block_info[pos];
+		int			next;
+		Oid			reloid;
+		Relation	rel = NULL;
 
 		CHECK_FOR_INTERRUPTS();
 
@@ -454,93 +515,126 @@ autoprewarm_database_main(Datum main_arg)
 		 * Quit if we've reached records for another database. If previous
 		 * blocks are of some global objects, then continue pre-warming.
 		 */
-		if (old_blk != NULL && old_blk->database != blk->database &&
-			old_blk->database != 0)
+		if (blk->database != task.database && blk->database != InvalidOid)
 			break;
 
-		/*
-		 * As soon as we encounter a block of a new relation, close the old
-		 * relation. Note that rel will be NULL if try_relation_open failed
-		 * previously; in that case, there is nothing to close.
-		 */
-		if (old_blk != NULL && old_blk->filenode != blk->filenode &&
-			rel != NULL)
+		/* Find the end of this relation's records. */
+		for (next = pos + 1; next < task.prewarm_stop_idx; next++)
 		{
-			relation_close(rel, AccessShareLock);
-			rel = NULL;
-			CommitTransactionCommand();
+			if (block_info[next].database != blk->database ||
+				block_info[next].tablespace != blk->tablespace ||
+				block_info[next].filenode != blk->filenode)
+				break;
 		}
 
 		/*
-		 * Try to open each new relation, but only once, when we first
-		 * encounter it. If it's been dropped, skip the associated blocks.
+		 * Try to open the relation.  If it's been dropped, skip the
+		 * associated blocks.
 		 */
-		if (old_blk == NULL || old_blk->filenode != blk->filenode)
-		{
-			Oid			reloid;
-
-			Assert(rel == NULL);
-			StartTransactionCommand();
-			reloid = RelidByRelfilenode(blk->tablespace, blk->filenode);
-			if (OidIsValid(reloid))
-				rel = try_relation_open(reloid, AccessShareLock);
+		StartTransactionCommand();
+		reloid = RelidByRelfilenode(blk->tablespace, blk->filenode);
+		if (OidIsValid(reloid))
+			rel = try_relation_open(reloid, AccessShareLock);
 
-			if (!rel)
-				CommitTransactionCommand();
-		}
-		if (!rel)
+		if (rel)
 		{
-			old_blk = blk;
-			continue;
+			int			nprewarmed;
+
+			nprewarmed = apw_prewarm_relation(rel, block_info, pos, next);
+			pg_atomic_fetch_add_u32(&apw_state->prewarmed_blocks, nprewarmed);
+			relation_close(rel, AccessShareLock);
 		}
+		CommitTransactionCommand();
 
-		/* Once per fork, check for fork existence and size. */
-		if (old_blk == NULL ||
-			old_blk->filenode != blk->filenode ||
-			old_blk->forknum != blk->forknum)
-		{
-			RelationOpenSmgr(rel);
+		pos = next;
+	}
 
-			/*
-			 * smgrexists is not safe for illegal forknum, hence check whether
-			 * the passed forknum is valid before using it in smgrexists.
-			 */
-			if (blk->forknum > InvalidForkNumber &&
-				blk->forknum <= MAX_FORKNUM &&
-				smgrexists(rel->rd_smgr, blk->forknum))
-				nblocks = RelationGetNumberOfBlocksInFork(rel, blk->forknum);
-			else
-				nblocks = 0;
-		}
+	dsm_detach(seg);
+}
+
+/*
+ * Prewarm the blocks listed in block_info[pos .. stop_idx - 1], all of which
+ * belong to the given relation, one fork at a time.  Returns the number of
+ * blocks prewarmed.
+ */
+static int
+apw_prewarm_relation(Relation rel, BlockInfoRecord *block_info,
+					 int pos, int stop_idx)
+{
+	int			nprewarmed = 0;
+
+	while (pos < stop_idx && have_free_buffer())
+	{
+		ForkNumber	forknum = block_info[pos].forknum;
+		AutoPrewarmReadStreamData p;
+		int			next;
 
-		/* Check whether blocknum is valid and within fork file size. */
-		if (blk->blocknum >= nblocks)
+		/* Find the end of this fork's records. */
+		for (next = pos + 1; next < stop_idx; next++)
 		{
-			/* Move to next forknum. */
-			old_blk = blk;
-			continue;
+			if (block_info[next].forknum != forknum)
+				break;
 		}
 
-		/* Prewarm buffer. */
-		buf = ReadBufferExtended(rel, blk->forknum, blk->blocknum, RBM_NORMAL,
-								 NULL);
-		if (BufferIsValid(buf))
+		/*
+		 * smgrexists is not safe for illegal forknum, hence check whether the
+		 * passed forknum is valid before using it in smgrexists.
+		 */
+		RelationOpenSmgr(rel);
+		if (forknum > InvalidForkNumber &&
+			forknum <= MAX_FORKNUM &&
+			smgrexists(rel->rd_smgr, forknum))
 		{
-			apw_state->prewarmed_blocks++;
-			ReleaseBuffer(buf);
+			ReadStream *stream;
+			Buffer		buf;
+
+			p.block_info = block_info;
+			p.pos = pos;
+			p.stop_idx = next;
+			p.nblocks = RelationGetNumberOfBlocksInFork(rel, forknum);
+
+			stream = read_stream_begin_relation(READ_STREAM_DEFAULT,
+												rel, forknum, NULL,
+												apw_read_stream_next_block,
+												&p);
+			while ((buf = read_stream_next_buffer(stream)) != InvalidBuffer)
+			{
+				nprewarmed++;
+				ReleaseBuffer(buf);
+			}
+			read_stream_end(stream);
 		}
 
-		old_blk = blk;
+		pos = next;
 	}
 
-	dsm_detach(seg);
+	return nprewarmed;
+}
+
+/*
+ * Read stream callback returning the next block of the fork being prewarmed
+ * by apw_prewarm_relation(), skipping any beyond the end of the fork.
+ */
+static BlockNumber
+apw_read_stream_next_block(ReadStream *stream, void *callback_private_data)
+{
+	AutoPrewarmReadStreamData *p = callback_private_data;
+
+	CHECK_FOR_INTERRUPTS();
+
+	/* Stop early if we've run out of free buffers. */
+	if (!have_free_buffer())
+		return InvalidBlockNumber;
 
-	/* Release lock on previous relation. */
-	if (rel)
+	while (p->pos < p->stop_idx)
 	{
-		relation_close(rel, AccessShareLock);
-		CommitTransactionCommand();
+		BlockNumber blocknum = p->block_info[p->pos++].blocknum;
+
+		if (blocknum < p->nblocks)
+			return blocknum;
 	}
+
+	return InvalidBlockNumber;
 }
 
 /*
@@ -757,6 +851,7 @@ apw_init_shmem(void)
 		LWLockInitialize(&apw_state->lock, LWLockNewTrancheId());
 		apw_state->bgworker_pid = InvalidPid;
 		apw_state->pid_using_dumpfile = InvalidPid;
+		pg_atomic_init_u32(&apw_state->prewarmed_blocks, 0);
 	}
 	LWLockRelease(AddinShmemInitLock);
 
@@ -822,13 +917,19 @@ apw_start_leader_worker(void)
 }
 
 /*
- * Start autoprewarm per-database worker process.
+ * Start autoprewarm per-database worker process for the given task.
+ *
+ * handles[] has room for autoprewarm_workers handles of running workers; if
+ * all of them are in use, wait for one of those workers to exit first.
  */
 static void
-apw_start_database_worker(void)
+apw_start_database_worker(AutoPrewarmTask *task,
+						  BackgroundWorkerHandle **handles)
 {
 	BackgroundWorker worker;
 	BackgroundWorkerHandle *handle;
+	int			slot;
+	int			nrunning;
 
 	MemSet(&worker, 0, sizeof(BackgroundWorker));
 	worker.bgw_flags =
@@ -839,21 +940,86 @@ apw_start_database_worker(void)
 	strcpy(worker.bgw_function_name, "autoprewarm_database_main");
 	strcpy(worker.bgw_name, "autoprewarm worker");
 	strcpy(worker.bgw_type, "autoprewarm worker");
+	StaticAssertStmt(sizeof(AutoPrewarmTask) <= BGW_EXTRALEN,
+					 "AutoPrewarmTask too large for bgw_extra");
+	memcpy(worker.bgw_extra, task, sizeof(AutoPrewarmTask));
 
 	/* must set notify PID to wait for shutdown */
 	worker.bgw_notify_pid = MyProcPid;
 
-	if (!RegisterDynamicBackgroundWorker(&worker, &handle))
-		ereport(ERROR,
-				(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
-				 errmsg("registering dynamic bgworker autoprewarm failed"),
-				 errhint("Consider increasing configuration parameter \"max_worker_processes\".")));
+	slot = apw_wait_for_workers(handles, autoprewarm_workers - 1, &nrunning);
 
 	/*
-	 * Ignore return value; if it fails, postmaster has died, but we have
-	 * checks for that elsewhere.
+	 * If no worker slot is available, try again once one of our own workers
+	 * has exited; only fail if we have none left that could free one up.
 	 */
-	WaitForBackgroundWorkerShutdown(handle);
+	while (!RegisterDynamicBackgroundWorker(&worker, &handle))
+	{
+		if (nrunning == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+					 errmsg("registering dynamic bgworker autoprewarm failed"),
+					 errhint("Consider increasing configuration parameter \"max_worker_processes\".")));
+		slot = apw_wait_for_workers(handles, nrunning - 1, &nrunning);
+	}
+
+	handles[slot] = handle;
+}
+
+/*
+ * Wait until no more than max_running of the per-database workers in
+ * handles[] are still running.  Returns the index of a free slot in
+ * handles[], and the number of workers still running in *nrunning if that
+ * isn't NULL.
+ */
+static int
+apw_wait_for_workers(BackgroundWorkerHandle **handles, int max_running,
+					 int *nrunning)
+{
+	for (;;)
+	{
+		int			running = 0;
+		int			free_slot = -1;
+
+		for (int i = 0; i < autoprewarm_workers; i++)
+		{
+			pid_t		pid;
+
+			/*
+			 * Forget about workers that have exited.  If the postmaster has
+			 * died, WaitLatch() below will notice; treat the worker as gone.
+			 */
+			if (handles[i] != NULL)
+			{
+				BgwHandleStatus status;
+
+				status = GetBackgroundWorkerPid(handles[i], &pid);
+				if (status == BGWH_STOPPED || status == BGWH_POSTMASTER_DIED)
+				{
+					pfree(handles[i]);
+					handles[i] = NULL;
+				}
+			}
+
+			if (handles[i] != NULL)
+				running++;
+			else if (free_slot < 0)
+				free_slot = i;
+		}
+
+		if (running <= max_running)
+		{
+			if (nrunning)
+				*nrunning = running;
+			return free_slot;
+		}
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_EXIT_ON_PM_DEATH,
+						 -1L,
+						 PG_WAIT_EXTENSION);
+		ResetLatch(MyLatch);
+	}
 }
 
 /* Compare member elements to check whether they are not equal. */
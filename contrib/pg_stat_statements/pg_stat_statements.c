@@ -47,6 +47,15 @@
  * Rewriting the entire external query-text file, eg for garbage collection,
  * requires holding pgss->lock exclusively; this allows individual entries
  * in the file to be read or written while holding only shared lock.
+ * Garbage collection writes the compacted copy of the file while holding
+ * only shared lock, though, and takes exclusive lock just to install it;
+ * pgss->gc_lock makes sure only one process does that at a time.
+ *
+ * If pg_stat_statements.flush_interval is set, each backend adds the
+ * counts of statements whose entries already exist to a local hashtable
+ * of pending counts, and adds those to the shared entries at most once per
+ * interval.  That saves taking pgss->lock and the entries' spinlocks for
+ * every execution of frequently executed statements.
  *
  *
  * Copyright (c) 2008-2020, PostgreSQL Global Development Group
@@ -62,7 +71,9 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include "access/xact.h"
 #include "catalog/pg_authid.h"
+#include "catalog/pg_type.h"
 #include "common/hashfn.h"
 #include "executor/instrument.h"
 #include "funcapi.h"
@@ -79,8 +90,10 @@
 #include "storage/spin.h"
 #include "tcop/utility.h"
 #include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/memutils.h"
+#include "utils/timestamp.h"
 
 PG_MODULE_MAGIC;
 
@@ -97,8 +110,11 @@ PG_MODULE_MAGIC;
  */
 #define PGSS_TEXT_FILE	PG_STAT_TMP_DIR "/pgss_query_texts.stat"
 
+/* Compacted copy of the query text file being written by gc_qtexts() */
+#define PGSS_TEXT_FILE_TMP	PGSS_TEXT_FILE ".tmp"
+
 /* Magic number identifying the stats file format */
-static const uint32 PGSS_FILE_HEADER = 0x20201126;
+static const uint32 PGSS_FILE_HEADER = 0x20201215;
 
 /* PostgreSQL major version number, changes in which invalidate all entries */
 static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
@@ -115,6 +131,8 @@ static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
 
 #define JUMBLE_SIZE				1024	/* query serialization buffer size */
 
+#define PGSS_HIST_BUCKETS		24	/* # of execution time histogram buckets */
+
 /*
  * Extension version number, for supporting older extension versions' objects
  */
@@ -124,7 +142,8 @@ typedef enum pgssVersion
 	PGSS_V1_1,
 	PGSS_V1_2,
 	PGSS_V1_3,
-	PGSS_V1_8
+	PGSS_V1_8,
+	PGSS_V1_10
 } pgssVersion;
 
 typedef enum pgssStoreKind
@@ -191,6 +210,10 @@ typedef struct Counters
 	int64		wal_records;	/* # of WAL records generated */
 	int64		wal_fpi;		/* # of WAL full page images generated */
 	uint64		wal_bytes;		/* total amount of WAL bytes generated */
+	int64		exec_hist[PGSS_HIST_BUCKETS];	/* # of executions by time, see
+												 * hist_bucket() */
+	uint64		plan_id;		/* fingerprint of last plan executed, or 0 */
+	int64		plan_changes;	/* # of times plan_id changed */
 } Counters;
 
 /*
@@ -224,6 +247,8 @@ typedef struct pgssEntry
 typedef struct pgssSharedState
 {
 	LWLock	   *lock;			/* protects hashtable search/modification */
+	LWLock	   *gc_lock;		/* held while garbage-collecting query texts */
+	uint64		reset_count;	/* # of entry_reset() calls; protected by lock */
 	double		cur_median_usage;	/* current median usage in hashtable */
 	Size		mean_query_len; /* current mean entry text length */
 	slock_t		mutex;			/* protects following fields only: */
@@ -233,6 +258,27 @@ typedef struct pgssSharedState
 	pgssGlobalStats stats;		/* global statistics for pgss */
 } pgssSharedState;
 
+/*
+ * Counts not yet added to the shared entry with the same key, see
+ * pgss_pending_add()
+ */
+typedef struct pgssPendingEntry
+{
+	pgssHashKey key;			/* hash key of entry - MUST BE FIRST */
+	Counters	counters;		/* statistics to add to the shared entry */
+} pgssPendingEntry;
+
+/*
+ * New location of an entry's query text, used by gc_qtexts()
+ */
+typedef struct pgssTextLocation
+{
+	pgssHashKey key;			/* hash key of entry - MUST BE FIRST */
+	Size		old_offset;		/* query text offset in old file */
+	int			query_len;		/* # of valid bytes in query string */
+	Size		new_offset;		/* query text offset in new file */
+} pgssTextLocation;
+
 /*
  * Struct for tracking locations/lengths of constants during normalization
  */
@@ -289,6 +335,11 @@ static ProcessUtility_hook_type prev_ProcessUtility = NULL;
 static pgssSharedState *pgss = NULL;
 static HTAB *pgss_hash = NULL;
 
+/* Counts not yet added to the shared hashtable, and state for flushing them */
+static HTAB *pgss_pending = NULL;
+static uint64 pgss_pending_reset_count = 0;
+static TimestampTz pgss_last_flush = 0;
+
 /*---- GUC variables ----*/
 
 typedef enum
@@ -311,6 +362,9 @@ static int	pgss_track;			/* tracking level */
 static bool pgss_track_utility; /* whether to track utility commands */
 static bool pgss_track_planning;	/* whether to track planning duration */
 static bool pgss_save;			/* whether to save stats across shutdown */
+static int	pgss_flush_interval;	/* msec between flushes of pending counts */
+static double pgss_histogram_min_time;	/* upper bound of first histogram
+										 * bucket, in msec */
 
 
 #define pgss_enabled(level) \
@@ -335,6 +389,7 @@ PG_FUNCTION_INFO_V1(pg_stat_statements_reset_1_7);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_2);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_3);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_8);
+PG_FUNCTION_INFO_V1(pg_stat_statements_1_10);
 PG_FUNCTION_INFO_V1(pg_stat_statements);
 PG_FUNCTION_INFO_V1(pg_stat_statements_info);
 
@@ -362,7 +417,23 @@ static void pgss_store(const char *query, uint64 queryId,
 					   double total_time, uint64 rows,
 					   const BufferUsage *bufusage,
 					   const WalUsage *walusage,
+					   uint64 planId,
 					   pgssJumbleState *jstate);
+static void counters_add(Counters *counters, pgssStoreKind kind,
+						 double total_time, uint64 rows,
+						 const BufferUsage *bufusage,
+						 const WalUsage *walusage,
+						 uint64 planId);
+static int	hist_bucket(double total_time);
+static void counters_merge(Counters *dst, const Counters *src);
+static bool pgss_pending_add(pgssHashKey *key, pgssStoreKind kind,
+							 double total_time, uint64 rows,
+							 const BufferUsage *bufusage,
+							 const WalUsage *walusage,
+							 uint64 planId);
+static void pgss_pending_enter(pgssHashKey *key, uint64 reset_count);
+static void pgss_flush_pending(void);
+static void pgss_pending_shutdown(int code, Datum arg);
 static void pg_stat_statements_internal(FunctionCallInfo fcinfo,
 										pgssVersion api_version,
 										bool showtext);
@@ -384,6 +455,10 @@ static void JumbleQuery(pgssJumbleState *jstate, Query *query);
 static void JumbleRangeTable(pgssJumbleState *jstate, List *rtable);
 static void JumbleRowMarks(pgssJumbleState *jstate, List *rowMarks);
 static void JumbleExpr(pgssJumbleState *jstate, Node *node);
+static uint64 pgss_plan_id(PlannedStmt *pstmt);
+static void JumblePlan(pgssJumbleState *jstate, Plan *plan, List *rtable);
+static void JumbleScanRelation(pgssJumbleState *jstate, Index scanrelid,
+							   List *rtable);
 static void RecordConstLocation(pgssJumbleState *jstate, int location);
 static char *generate_normalized_query(pgssJumbleState *jstate, const char *query,
 									   int query_loc, int *query_len_p);
@@ -470,6 +545,32 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomRealVariable("pg_stat_statements.histogram_min_time",
+							 "Sets the upper bound of the first bucket of the execution time histograms, in milliseconds.",
+							 "Each further bucket covers twice the range of the previous one.",
+							 &pgss_histogram_min_time,
+							 0.1,
+							 0.001,
+							 1000000.0,
+							 PGC_POSTMASTER,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("pg_stat_statements.flush_interval",
+							"Sets the maximum time a backend keeps statement statistics before adding them to the shared hashtable.",
+							"Zero adds them after every execution.",
+							&pgss_flush_interval,
+							0,
+							0,
+							INT_MAX,
+							PGC_SUSET,
+							GUC_UNIT_MS,
+							NULL,
+							NULL,
+							NULL);
+
 	EmitWarningsOnPlaceholders("pg_stat_statements");
 
 	/*
@@ -478,7 +579,7 @@ _PG_init(void)
 	 * resources in pgss_shmem_startup().
 	 */
 	RequestAddinShmemSpace(pgss_memsize());
-	RequestNamedLWLockTranche("pg_stat_statements", 1);
+	RequestNamedLWLockTranche("pg_stat_statements", 2);
 
 	/*
 	 * Install hooks.
@@ -557,7 +658,9 @@ pgss_shmem_startup(void)
 	if (!found)
 	{
 		/* First time through ... */
-		pgss->lock = &(GetNamedLWLockTranche("pg_stat_statements"))->lock;
+		pgss->lock = &(GetNamedLWLockTranche("pg_stat_statements"))[0].lock;
+		pgss->gc_lock = &(GetNamedLWLockTranche("pg_stat_statements"))[1].lock;
+		pgss->reset_count = 0;
 		pgss->cur_median_usage = ASSUMED_MEDIAN_INIT;
 		pgss->mean_query_len = ASSUMED_LENGTH_INIT;
 		SpinLockInit(&pgss->mutex);
@@ -595,8 +698,9 @@ pgss_shmem_startup(void)
 	 * processes running when this code is reached.
 	 */
 
-	/* Unlink query text file possibly left over from crash */
+	/* Unlink query text files possibly left over from crash */
 	unlink(PGSS_TEXT_FILE);
+	unlink(PGSS_TEXT_FILE_TMP);
 
 	/* Allocate new query text temp file */
 	qfile = AllocateFile(PGSS_TEXT_FILE, PG_BINARY_W);
@@ -915,6 +1019,7 @@ pgss_post_parse_analyze(ParseState *pstate, Query *query)
 				   0,
 				   NULL,
 				   NULL,
+				   0,
 				   &jstate);
 }
 
@@ -999,6 +1104,7 @@ pgss_planner(Query *parse,
 				   0,
 				   &bufusage,
 				   &walusage,
+				   0,
 				   NULL);
 	}
 	else
@@ -1117,6 +1223,7 @@ pgss_ExecutorEnd(QueryDesc *queryDesc)
 				   queryDesc->estate->es_processed,
 				   &queryDesc->totaltime->bufusage,
 				   &queryDesc->totaltime->walusage,
+				   pgss_plan_id(queryDesc->plannedstmt),
 				   NULL);
 	}
 
@@ -1217,6 +1324,7 @@ pgss_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
 				   rows,
 				   &bufusage,
 				   &walusage,
+				   0,
 				   NULL);
 	}
 	else
@@ -1252,8 +1360,10 @@ pgss_hash_string(const char *str, int len)
  *
  * If jstate is not NULL then we're trying to create an entry for which
  * we have no statistics as yet; we just want to record the normalized
- * query string.  total_time, rows, bufusage and walusage are ignored in this
- * case.
+ * query string.  total_time, rows, bufusage, walusage and planId are ignored
+ * in this case.
+ *
+ * planId is the fingerprint of the plan executed, or 0 if unknown.
  *
  * If kind is PGSS_PLAN or PGSS_EXEC, its value is used as the array position
  * for the arrays in the Counters field.
@@ -1265,12 +1375,15 @@ pgss_store(const char *query, uint64 queryId,
 		   double total_time, uint64 rows,
 		   const BufferUsage *bufusage,
 		   const WalUsage *walusage,
+		   uint64 planId,
 		   pgssJumbleState *jstate)
 {
 	pgssHashKey key;
 	pgssEntry  *entry;
 	char	   *norm_query = NULL;
 	int			encoding = GetDatabaseEncoding();
+	bool		do_gc = false;
+	uint64		reset_count = 0;
 
 	Assert(query != NULL);
 
@@ -1331,6 +1444,12 @@ pgss_store(const char *query, uint64 queryId,
 	key.dbid = MyDatabaseId;
 	key.queryid = queryId;
 
+	/* If we've counted this statement before, we may just add to that */
+	if (!jstate &&
+		pgss_pending_add(&key, kind, total_time, rows, bufusage, walusage,
+						 planId))
+		return;
+
 	/* Lookup the hash table entry with shared lock. */
 	LWLockAcquire(pgss->lock, LW_SHARED);
 
@@ -1342,7 +1461,6 @@ pgss_store(const char *query, uint64 queryId,
 		Size		query_offset;
 		int			gc_count;
 		bool		stored;
-		bool		do_gc;
 
 		/*
 		 * Create a new, normalized query string if caller asked.  We don't
@@ -1393,10 +1511,6 @@ pgss_store(const char *query, uint64 queryId,
 		/* OK to create a new hashtable entry */
 		entry = entry_alloc(&key, query_offset, query_len, encoding,
 							jstate != NULL);
-
-		/* If needed, perform garbage collection while exclusive lock held */
-		if (do_gc)
-			gc_qtexts();
 	}
 
 	/* Increment the counts, except when jstate is not NULL */
@@ -1406,71 +1520,368 @@ pgss_store(const char *query, uint64 queryId,
 		 * Grab the spinlock while updating the counters (see comment about
 		 * locking rules at the head of the file)
 		 */
-		volatile pgssEntry *e = (volatile pgssEntry *) entry;
-
 		Assert(kind == PGSS_PLAN || kind == PGSS_EXEC);
 
-		SpinLockAcquire(&e->mutex);
+		SpinLockAcquire(&entry->mutex);
 
 		/* "Unstick" entry if it was previously sticky */
-		if (IS_STICKY(e->counters))
-			e->counters.usage = USAGE_INIT;
+		if (IS_STICKY(entry->counters))
+			entry->counters.usage = USAGE_INIT;
 
-		e->counters.calls[kind] += 1;
-		e->counters.total_time[kind] += total_time;
+		counters_add(&entry->counters, kind, total_time, rows,
+					 bufusage, walusage, planId);
 
-		if (e->counters.calls[kind] == 1)
-		{
-			e->counters.min_time[kind] = total_time;
-			e->counters.max_time[kind] = total_time;
-			e->counters.mean_time[kind] = total_time;
-		}
-		else
-		{
-			/*
-			 * Welford's method for accurately computing variance. See
-			 * <http://www.johndcook.com/blog/standard_deviation/>
-			 */
-			double		old_mean = e->counters.mean_time[kind];
-
-			e->counters.mean_time[kind] +=
-				(total_time - old_mean) / e->counters.calls[kind];
-			e->counters.sum_var_time[kind] +=
-				(total_time - old_mean) * (total_time - e->counters.mean_time[kind]);
-
-			/* calculate min and max time */
-			if (e->counters.min_time[kind] > total_time)
-				e->counters.min_time[kind] = total_time;
-			if (e->counters.max_time[kind] < total_time)
-				e->counters.max_time[kind] = total_time;
-		}
-		e->counters.rows += rows;
-		e->counters.shared_blks_hit += bufusage->shared_blks_hit;
-		e->counters.shared_blks_read += bufusage->shared_blks_read;
-		e->counters.shared_blks_dirtied += bufusage->shared_blks_dirtied;
-		e->counters.shared_blks_written += bufusage->shared_blks_written;
-		e->counters.local_blks_hit += bufusage->local_blks_hit;
-		e->counters.local_blks_read += bufusage->local_blks_read;
-		e->counters.local_blks_dirtied += bufusage->local_blks_dirtied;
-		e->counters.local_blks_written += bufusage->local_blks_written;
-		e->counters.temp_blks_read += bufusage->temp_blks_read;
-		e->counters.temp_blks_written += bufusage->temp_blks_written;
-		e->counters.blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_read_time);
-		e->counters.blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_write_time);
-		e->counters.usage += USAGE_EXEC(total_time);
-		e->counters.wal_records += walusage->wal_records;
-		e->counters.wal_fpi += walusage->wal_fpi;
-		e->counters.wal_bytes += walusage->wal_bytes;
-
-		SpinLockRelease(&e->mutex);
+		SpinLockRelease(&entry->mutex);
 	}
 
+	reset_count = pgss->reset_count;
+
 done:
 	LWLockRelease(pgss->lock);
 
 	/* We postpone this clean-up until we're out of the lock */
 	if (norm_query)
 		pfree(norm_query);
+
+	/* Count further executions locally, if wanted */
+	if (!jstate && entry && pgss_flush_interval > 0)
+		pgss_pending_enter(&key, reset_count);
+
+	/* If needed, perform garbage collection */
+	if (do_gc)
+		gc_qtexts();
+}
+
+/*
+ * Add the counts of one planning or execution to *counters.
+ */
+static void
+counters_add(Counters *counters, pgssStoreKind kind,
+			 double total_time, uint64 rows,
+			 const BufferUsage *bufusage,
+			 const WalUsage *walusage,
+			 uint64 planId)
+{
+	counters->calls[kind] += 1;
+	counters->total_time[kind] += total_time;
+
+	if (counters->calls[kind] == 1)
+	{
+		counters->min_time[kind] = total_time;
+		counters->max_time[kind] = total_time;
+		counters->mean_time[kind] = total_time;
+	}
+	else
+	{
+		/*
+		 * Welford's method for accurately computing variance. See
+		 * <http://www.johndcook.com/blog/standard_deviation/>
+		 */
+		double		old_mean = counters->mean_time[kind];
+
+		counters->mean_time[kind] +=
+			(total_time - old_mean) / counters->calls[kind];
+		counters->sum_var_time[kind] +=
+			(total_time - old_mean) * (total_time - counters->mean_time[kind]);
+
+		/* calculate min and max time */
+		if (counters->min_time[kind] > total_time)
+			counters->min_time[kind] = total_time;
+		if (counters->max_time[kind] < total_time)
+			counters->max_time[kind] = total_time;
+	}
+	counters->rows += rows;
+	counters->shared_blks_hit += bufusage->shared_blks_hit;
+	counters->shared_blks_read += bufusage->shared_blks_read;
+	counters->shared_blks_dirtied += bufusage->shared_blks_dirtied;
+	counters->shared_blks_written += bufusage->shared_blks_written;
+	counters->local_blks_hit += bufusage->local_blks_hit;
+	counters->local_blks_read += bufusage->local_blks_read;
+	counters->local_blks_dirtied += bufusage->local_blks_dirtied;
+	counters->local_blks_written += bufusage->local_blks_written;
+	counters->temp_blks_read += bufusage->temp_blks_read;
+	counters->temp_blks_written += bufusage->temp_blks_written;
+	counters->blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_read_time);
+	counters->blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_write_time);
+	counters->usage += USAGE_EXEC(total_time);
+	counters->wal_records += walusage->wal_records;
+	counters->wal_fpi += walusage->wal_fpi;
+	counters->wal_bytes += walusage->wal_bytes;
+
+	if (kind == PGSS_EXEC)
+		counters->exec_hist[hist_bucket(total_time)]++;
+
+	if (planId != UINT64CONST(0))
+	{
+		if (counters->plan_id != UINT64CONST(0) && counters->plan_id != planId)
+			counters->plan_changes++;
+		counters->plan_id = planId;
+	}
+}
+
+/*
+ * Histogram bucket for an execution time in msec.  Bucket 0 counts times
+ * below pg_stat_statements.histogram_min_time, and each following bucket
+ * covers twice the range of the previous one; the last is open-ended.
+ */
+static int
+hist_bucket(double total_time)
+{
+	int			bucket;
+
+	if (!(total_time >= pgss_histogram_min_time))
+		return 0;
+
+	bucket = 1 + (int) floor(log2(total_time / pgss_histogram_min_time));
+
+	return Min(bucket, PGSS_HIST_BUCKETS - 1);
+}
+
+/*
+ * Add the counts in *src to *dst.
+ */
+static void
+counters_merge(Counters *dst, const Counters *src)
+{
+	int			kind;
+	int			i;
+
+	for (kind = 0; kind < PGSS_NUMKIND; kind++)
+	{
+		int64		calls;
+		double		delta;
+
+		if (src->calls[kind] == 0)
+			continue;
+
+		if (dst->calls[kind] == 0)
+		{
+			dst->calls[kind] = src->calls[kind];
+			dst->total_time[kind] = src->total_time[kind];
+			dst->min_time[kind] = src->min_time[kind];
+			dst->max_time[kind] = src->max_time[kind];
+			dst->mean_time[kind] = src->mean_time[kind];
+			dst->sum_var_time[kind] = src->sum_var_time[kind];
+			continue;
+		}
+
+		/*
+		 * Combine the means and sums of variances the way Chan et al.
+		 * suggest for computing variance in parallel.
+		 */
+		calls = dst->calls[kind] + src->calls[kind];
+		delta = src->mean_time[kind] - dst->mean_time[kind];
+		dst->sum_var_time[kind] += src->sum_var_time[kind] +
+			delta * delta * dst->calls[kind] * src->calls[kind] / calls;
+		dst->mean_time[kind] += delta * src->calls[kind] / calls;
+		dst->calls[kind] = calls;
+		dst->total_time[kind] += src->total_time[kind];
+		if (dst->min_time[kind] > src->min_time[kind])
+			dst->min_time[kind] = src->min_time[kind];
+		if (dst->max_time[kind] < src->max_time[kind])
+			dst->max_time[kind] = src->max_time[kind];
+	}
+	dst->rows += src->rows;
+	dst->shared_blks_hit += src->shared_blks_hit;
+	dst->shared_blks_read += src->shared_blks_read;
+	dst->shared_blks_dirtied += src->shared_blks_dirtied;
+	dst->shared_blks_written += src->shared_blks_written;
+	dst->local_blks_hit += src->local_blks_hit;
+	dst->local_blks_read += src->local_blks_read;
+	dst->local_blks_dirtied += src->local_blks_dirtied;
+	dst->local_blks_written += src->local_blks_written;
+	dst->temp_blks_read += src->temp_blks_read;
+	dst->temp_blks_written += src->temp_blks_written;
+	dst->blk_read_time += src->blk_read_time;
+	dst->blk_write_time += src->blk_write_time;
+	dst->usage += src->usage;
+	dst->wal_records += src->wal_records;
+	dst->wal_fpi += src->wal_fpi;
+	dst->wal_bytes += src->wal_bytes;
+
+	for (i = 0; i < PGSS_HIST_BUCKETS; i++)
+		dst->exec_hist[i] += src->exec_hist[i];
+
+	dst->plan_changes += src->plan_changes;
+	if (src->plan_id != UINT64CONST(0))
+	{
+		if (dst->plan_id != UINT64CONST(0) && dst->plan_id != src->plan_id)
+			dst->plan_changes++;
+		dst->plan_id = src->plan_id;
+	}
+}
+
+/*
+ * Add the counts of one planning or execution to the locally pending counts
+ * for the given key, if there is an entry for it.  Returns false if there
+ * isn't; the caller must then update the shared entry itself.
+ *
+ * Pending entries are only made for statements that had a shared entry
+ * when we last looked, so that we don't have to keep query texts locally.
+ * If the shared entry is deallocated in the meantime, pending counts for it
+ * are thrown away when flushing, as if they had been added before.
+ */
+static bool
+pgss_pending_add(pgssHashKey *key, pgssStoreKind kind,
+				 double total_time, uint64 rows,
+				 const BufferUsage *bufusage,
+				 const WalUsage *walusage,
+				 uint64 planId)
+{
+	pgssPendingEntry *pending;
+	TimestampTz now;
+
+	if (pgss_pending == NULL)
+		return false;
+
+	/* If batching was turned off, flush and forget what we have */
+	if (pgss_flush_interval <= 0)
+	{
+		pgss_flush_pending();
+		hash_destroy(pgss_pending);
+		pgss_pending = NULL;
+		return false;
+	}
+
+	pending = (pgssPendingEntry *) hash_search(pgss_pending, key,
+											   HASH_FIND, NULL);
+	if (pending == NULL)
+		return false;
+
+	counters_add(&pending->counters, kind, total_time, rows,
+				 bufusage, walusage, planId);
+
+	/*
+	 * Flush if the interval has elapsed.  Using the statement start time
+	 * saves a kernel call; it's accurate enough for this purpose.
+	 */
+	now = GetCurrentStatementStartTimestamp();
+	if (TimestampDifferenceExceeds(pgss_last_flush, now, pgss_flush_interval))
+		pgss_flush_pending();
+
+	return true;
+}
+
+/*
+ * Make a pending entry for the given key, to count further executions of
+ * the statement locally.  reset_count is the value of pgss->reset_count at
+ * the time the shared entry was last seen.
+ */
+static void
+pgss_pending_enter(pgssHashKey *key, uint64 reset_count)
+{
+	static bool registered = false;
+	pgssPendingEntry *pending;
+	bool		found;
+
+	if (pgss_pending == NULL)
+	{
+		HASHCTL		info;
+
+		memset(&info, 0, sizeof(info));
+		info.keysize = sizeof(pgssHashKey);
+		info.entrysize = sizeof(pgssPendingEntry);
+		info.hcxt = TopMemoryContext;
+		pgss_pending = hash_create("pg_stat_statements pending counts",
+								   64, &info,
+								   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+		pgss_pending_reset_count = reset_count;
+		pgss_last_flush = GetCurrentStatementStartTimestamp();
+
+		/* Don't lose pending counts when the backend exits */
+		if (!registered)
+			on_shmem_exit(pgss_pending_shutdown, (Datum) 0);
+		registered = true;
+	}
+
+	/*
+	 * If the shared hashtable was reset since we last flushed, counts
+	 * gathered before that have to go.
+	 */
+	if (reset_count != pgss_pending_reset_count)
+	{
+		HASH_SEQ_STATUS hash_seq;
+
+		hash_seq_init(&hash_seq, pgss_pending);
+		while ((pending = hash_seq_search(&hash_seq)) != NULL)
+			hash_search(pgss_pending, &pending->key, HASH_REMOVE, NULL);
+		pgss_pending_reset_count = reset_count;
+	}
+
+	/* Limit the local hashtable to the size of the shared one */
+	if (hash_get_num_entries(pgss_pending) >= pgss_max)
+		return;
+
+	pending = (pgssPendingEntry *) hash_search(pgss_pending, key,
+											   HASH_ENTER, &found);
+	if (!found)
+		memset(&pending->counters, 0, sizeof(Counters));
+}
+
+/*
+ * Add all pending counts to the shared hashtable.
+ */
+static void
+pgss_flush_pending(void)
+{
+	HASH_SEQ_STATUS hash_seq;
+	pgssPendingEntry *pending;
+	bool		discard;
+
+	if (pgss_pending == NULL || !pgss || !pgss_hash)
+		return;
+
+	LWLockAcquire(pgss->lock, LW_SHARED);
+
+	/* After a reset, all counts gathered since the last flush are stale */
+	discard = (pgss->reset_count != pgss_pending_reset_count);
+
+	hash_seq_init(&hash_seq, pgss_pending);
+	while ((pending = hash_seq_search(&hash_seq)) != NULL)
+	{
+		pgssEntry  *entry = NULL;
+
+		if (!discard)
+			entry = (pgssEntry *) hash_search(pgss_hash, &pending->key,
+											  HASH_FIND, NULL);
+
+		/* Forget statements whose shared entry is gone */
+		if (entry == NULL)
+		{
+			hash_search(pgss_pending, &pending->key, HASH_REMOVE, NULL);
+			continue;
+		}
+
+		if (pending->counters.calls[PGSS_PLAN] +
+			pending->counters.calls[PGSS_EXEC] == 0)
+			continue;
+
+		SpinLockAcquire(&entry->mutex);
+		if (IS_STICKY(entry->counters))
+			entry->counters.usage = USAGE_INIT;
+		counters_merge(&entry->counters, &pending->counters);
+		SpinLockRelease(&entry->mutex);
+
+		memset(&pending->counters, 0, sizeof(Counters));
+	}
+
+	pgss_pending_reset_count = pgss->reset_count;
+
+	LWLockRelease(pgss->lock);
+
+	pgss_last_flush = GetCurrentStatementStartTimestamp();
+}
+
+/*
+ * Backend exit callback: flush pending counts.
+ *
+ * This is registered with on_shmem_exit(), so it runs after any open
+ * transaction has been aborted and all LWLocks have been released.
+ */
+static void
+pgss_pending_shutdown(int code, Datum arg)
+{
+	pgss_flush_pending();
 }
 
 /*
@@ -1509,7 +1920,8 @@ pg_stat_statements_reset(PG_FUNCTION_ARGS)
 #define PG_STAT_STATEMENTS_COLS_V1_2	19
 #define PG_STAT_STATEMENTS_COLS_V1_3	23
 #define PG_STAT_STATEMENTS_COLS_V1_8	32
-#define PG_STAT_STATEMENTS_COLS			32	/* maximum of above */
+#define PG_STAT_STATEMENTS_COLS_V1_10	35
+#define PG_STAT_STATEMENTS_COLS			35	/* maximum of above */
 
 /*
  * Retrieve statement statistics.
@@ -1521,6 +1933,16 @@ pg_stat_statements_reset(PG_FUNCTION_ARGS)
  * expected API version is identified by embedding it in the C name of the
  * function.  Unfortunately we weren't bright enough to do that for 1.1.
  */
+Datum
+pg_stat_statements_1_10(PG_FUNCTION_ARGS)
+{
+	bool		showtext = PG_GETARG_BOOL(0);
+
+	pg_stat_statements_internal(fcinfo, PGSS_V1_10, showtext);
+
+	return (Datum) 0;
+}
+
 Datum
 pg_stat_statements_1_8(PG_FUNCTION_ARGS)
 {
@@ -1640,6 +2062,10 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 			if (api_version != PGSS_V1_8)
 				elog(ERROR, "incorrect number of output arguments");
 			break;
+		case PG_STAT_STATEMENTS_COLS_V1_10:
+			if (api_version != PGSS_V1_10)
+				elog(ERROR, "incorrect number of output arguments");
+			break;
 		default:
 			elog(ERROR, "incorrect number of output arguments");
 	}
@@ -1651,6 +2077,9 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 
 	MemoryContextSwitchTo(oldcontext);
 
+	/* Make sure we see at least our own backend's counts */
+	pgss_flush_pending();
+
 	/*
 	 * We'd like to load the query text file (if needed) while not holding any
 	 * lock on pgss->lock.  In the worst case we'll have to do this again
@@ -1862,12 +2291,33 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 											Int32GetDatum(-1));
 			values[i++] = wal_bytes;
 		}
+		if (api_version >= PGSS_V1_10)
+		{
+			Datum		hist[PGSS_HIST_BUCKETS];
+			int			j;
+
+			if (tmp.plan_id != UINT64CONST(0))
+				values[i++] = Int64GetDatumFast(tmp.plan_id);
+			else
+				nulls[i++] = true;
+			values[i++] = Int64GetDatumFast(tmp.plan_changes);
+
+			for (j = 0; j < PGSS_HIST_BUCKETS; j++)
+				hist[j] = Int64GetDatum(tmp.exec_hist[j]);
+			values[i++] = PointerGetDatum(construct_array(hist,
+														  PGSS_HIST_BUCKETS,
+														  INT8OID,
+														  sizeof(int64),
+														  FLOAT8PASSBYVAL,
+														  TYPALIGN_DOUBLE));
+		}
 
 		Assert(i == (api_version == PGSS_V1_0 ? PG_STAT_STATEMENTS_COLS_V1_0 :
 					 api_version == PGSS_V1_1 ? PG_STAT_STATEMENTS_COLS_V1_1 :
 					 api_version == PGSS_V1_2 ? PG_STAT_STATEMENTS_COLS_V1_2 :
 					 api_version == PGSS_V1_3 ? PG_STAT_STATEMENTS_COLS_V1_3 :
 					 api_version == PGSS_V1_8 ? PG_STAT_STATEMENTS_COLS_V1_8 :
+					 api_version == PGSS_V1_10 ? PG_STAT_STATEMENTS_COLS_V1_10 :
 					 -1 /* fail if you forget to update this assert */ ));
 
 		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
@@ -2308,7 +2758,17 @@ need_gc_qtexts(void)
  * becomes unreasonably large, with no other method of compaction likely to
  * occur in the foreseeable future.
  *
- * The caller must hold an exclusive lock on pgss->lock.
+ * To avoid stalling all other backends for the duration, we write the
+ * compacted texts to a new file while holding only shared lock on
+ * pgss->lock.  Entries can't be created or removed while we hold that, but
+ * they can once we release it, so after acquiring exclusive lock we copy
+ * the texts of entries created in the meantime from the old file before
+ * putting the new one in its place and updating the entries' offsets.
+ * Texts of entries removed in the meantime are left behind harmlessly.
+ * Only one process does this at a time; if another one is already at it,
+ * we return immediately.
+ *
+ * The caller must not hold pgss->lock.
  *
  * At the first sign of trouble we unlink the query text file to get a clean
  * slate (although existing statistics are retained), rather than risk
@@ -2320,18 +2780,34 @@ gc_qtexts(void)
 	char	   *qbuffer;
 	Size		qbuffer_size;
 	FILE	   *qfile = NULL;
+	int			old_fd = -1;
+	HTAB	   *locations = NULL;
+	HASHCTL		info;
 	HASH_SEQ_STATUS hash_seq;
 	pgssEntry  *entry;
+	pgssTextLocation *location;
 	Size		extent;
 	int			nentries;
+	int			gc_count;
+
+	if (!LWLockConditionalAcquire(pgss->gc_lock, LW_EXCLUSIVE))
+		return;
+
+	LWLockAcquire(pgss->lock, LW_SHARED);
 
 	/*
-	 * When called from pgss_store, some other session might have proceeded
-	 * with garbage collection in the no-lock-held interim of lock strength
-	 * escalation.  Check once more that this is actually necessary.
+	 * Some other session might have proceeded with garbage collection since
+	 * our caller checked.  Check once more that this is actually necessary.
 	 */
 	if (!need_gc_qtexts())
+	{
+		LWLockRelease(pgss->lock);
+		LWLockRelease(pgss->gc_lock);
 		return;
+	}
+
+	/* gc_count only changes under exclusive lock, so no need for the mutex */
+	gc_count = pgss->gc_count;
 
 	/*
 	 * Load the old texts file.  If we fail (out of memory, for instance),
@@ -2342,26 +2818,28 @@ gc_qtexts(void)
 	 */
 	qbuffer = qtext_load_file(&qbuffer_size);
 	if (qbuffer == NULL)
-		goto gc_fail;
+		goto gc_fail_shared;
 
-	/*
-	 * We overwrite the query texts file in place, so as to reduce the risk of
-	 * an out-of-disk-space failure.  Since the file is guaranteed not to get
-	 * larger, this should always work on traditional filesystems; though we
-	 * could still lose on copy-on-write filesystems.
-	 */
-	qfile = AllocateFile(PGSS_TEXT_FILE, PG_BINARY_W);
+	qfile = AllocateFile(PGSS_TEXT_FILE_TMP, PG_BINARY_W);
 	if (qfile == NULL)
 	{
 		ereport(LOG,
 				(errcode_for_file_access(),
 				 errmsg("could not write file \"%s\": %m",
-						PGSS_TEXT_FILE)));
-		goto gc_fail;
+						PGSS_TEXT_FILE_TMP)));
+		goto gc_fail_shared;
 	}
 
+	/* Remember where each entry's text goes in the new file */
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(pgssHashKey);
+	info.entrysize = sizeof(pgssTextLocation);
+	info.hcxt = CurrentMemoryContext;
+	locations = hash_create("pg_stat_statements text locations",
+							hash_get_num_entries(pgss_hash), &info,
+							HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
 	extent = 0;
-	nentries = 0;
 
 	hash_seq_init(&hash_seq, pgss_hash);
 	while ((entry = hash_seq_search(&hash_seq)) != NULL)
@@ -2372,9 +2850,85 @@ gc_qtexts(void)
 									  qbuffer,
 									  qbuffer_size);
 
+		/* Trouble ... the text will be dropped below */
 		if (qry == NULL)
+			continue;
+
+		if (fwrite(qry, 1, query_len + 1, qfile) != query_len + 1)
+		{
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not write file \"%s\": %m",
+							PGSS_TEXT_FILE_TMP)));
+			hash_seq_term(&hash_seq);
+			goto gc_fail_shared;
+		}
+
+		location = (pgssTextLocation *) hash_search(locations, &entry->key,
+													HASH_ENTER, NULL);
+		location->old_offset = entry->query_offset;
+		location->query_len = query_len;
+		location->new_offset = extent;
+		extent += query_len + 1;
+	}
+
+	free(qbuffer);
+	qbuffer = NULL;
+
+	LWLockRelease(pgss->lock);
+	LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
+
+	/* If the file was reset meanwhile, our copy is useless */
+	if (pgss->gc_count != gc_count)
+	{
+		hash_destroy(locations);
+		FreeFile(qfile);
+		unlink(PGSS_TEXT_FILE_TMP);
+		LWLockRelease(pgss->lock);
+		LWLockRelease(pgss->gc_lock);
+		return;
+	}
+
+	old_fd = OpenTransientFile(PGSS_TEXT_FILE, O_RDONLY | PG_BINARY);
+	if (old_fd < 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m",
+						PGSS_TEXT_FILE)));
+		goto gc_fail;
+	}
+
+	nentries = 0;
+
+	hash_seq_init(&hash_seq, pgss_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		int			query_len = entry->query_len;
+		char	   *qry;
+
+		if (query_len < 0)
+			continue;
+
+		location = (pgssTextLocation *) hash_search(locations, &entry->key,
+													HASH_FIND, NULL);
+		if (location != NULL &&
+			location->old_offset == entry->query_offset &&
+			location->query_len == query_len)
+		{
+			entry->query_offset = location->new_offset;
+			nentries++;
+			continue;
+		}
+
+		/* The entry is new; copy its text from the old file */
+		qry = palloc(query_len + 1);
+		if (pg_pread(old_fd, qry, query_len + 1,
+					 entry->query_offset) != query_len + 1 ||
+			qry[query_len] != '\0')
 		{
 			/* Trouble ... drop the text */
+			pfree(qry);
 			entry->query_offset = 0;
 			entry->query_len = -1;
 			/* entry will not be counted in mean query length computation */
@@ -2386,35 +2940,41 @@ gc_qtexts(void)
 			ereport(LOG,
 					(errcode_for_file_access(),
 					 errmsg("could not write file \"%s\": %m",
-							PGSS_TEXT_FILE)));
+							PGSS_TEXT_FILE_TMP)));
 			hash_seq_term(&hash_seq);
 			goto gc_fail;
 		}
+		pfree(qry);
 
 		entry->query_offset = extent;
 		extent += query_len + 1;
 		nentries++;
 	}
 
-	/*
-	 * Truncate away any now-unused space.  If this fails for some odd reason,
-	 * we log it, but there's no need to fail.
-	 */
-	if (ftruncate(fileno(qfile), extent) != 0)
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not truncate file \"%s\": %m",
-						PGSS_TEXT_FILE)));
+	CloseTransientFile(old_fd);
+	old_fd = -1;
+	hash_destroy(locations);
+	locations = NULL;
 
 	if (FreeFile(qfile))
 	{
 		ereport(LOG,
 				(errcode_for_file_access(),
 				 errmsg("could not write file \"%s\": %m",
-						PGSS_TEXT_FILE)));
+						PGSS_TEXT_FILE_TMP)));
 		qfile = NULL;
 		goto gc_fail;
 	}
+	qfile = NULL;
+
+	if (rename(PGSS_TEXT_FILE_TMP, PGSS_TEXT_FILE) != 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not rename file \"%s\" to \"%s\": %m",
+						PGSS_TEXT_FILE_TMP, PGSS_TEXT_FILE)));
+		goto gc_fail;
+	}
 
 	elog(DEBUG1, "pgss gc of queries file shrunk size from %zu to %zu",
 		 pgss->extent, extent);
@@ -2431,8 +2991,6 @@ gc_qtexts(void)
 	else
 		pgss->mean_query_len = ASSUMED_LENGTH_INIT;
 
-	free(qbuffer);
-
 	/*
 	 * OK, count a garbage collection cycle.  (Note: even though we have
 	 * exclusive lock on pgss->lock, we must take pgss->mutex for this, since
@@ -2442,14 +3000,40 @@ gc_qtexts(void)
 	 */
 	record_gc_qtexts();
 
+	LWLockRelease(pgss->lock);
+	LWLockRelease(pgss->gc_lock);
+
 	return;
 
+gc_fail_shared:
+	/* Get exclusive lock, unless someone else reset the file meanwhile */
+	LWLockRelease(pgss->lock);
+	LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
+	if (pgss->gc_count != gc_count)
+	{
+		if (qfile)
+			FreeFile(qfile);
+		if (qbuffer)
+			free(qbuffer);
+		if (locations)
+			hash_destroy(locations);
+		unlink(PGSS_TEXT_FILE_TMP);
+		LWLockRelease(pgss->lock);
+		LWLockRelease(pgss->gc_lock);
+		return;
+	}
+
 gc_fail:
 	/* clean up resources */
 	if (qfile)
 		FreeFile(qfile);
 	if (qbuffer)
 		free(qbuffer);
+	if (old_fd >= 0)
+		CloseTransientFile(old_fd);
+	if (locations)
+		hash_destroy(locations);
+	unlink(PGSS_TEXT_FILE_TMP);
 
 	/*
 	 * Since the contents of the external file are now uncertain, mark all
@@ -2493,6 +3077,9 @@ gc_fail:
 	 * pgss->lock acquired in shared or exclusive mode respectively.)
 	 */
 	record_gc_qtexts();
+
+	LWLockRelease(pgss->lock);
+	LWLockRelease(pgss->gc_lock);
 }
 
 /*
@@ -2516,6 +3103,9 @@ entry_reset(Oid userid, Oid dbid, uint64 queryid)
 	LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
 	num_entries = hash_get_num_entries(pgss_hash);
 
+	/* Make backends discard counts they haven't flushed yet */
+	pgss->reset_count++;
+
 	if (userid != 0 && dbid != 0 && queryid != UINT64CONST(0))
 	{
 		/* If all the parameters are available, use the fast path. */
@@ -3245,6 +3835,142 @@ JumbleExpr(pgssJumbleState *jstate, Node *node)
 	}
 }
 
+/*
+ * Compute a fingerprint of the shape of a plan: the plan node types, the
+ * relations and indexes scanned and the join and aggregation strategies,
+ * but not costs, row estimates or expressions.  It tells apart executions
+ * of the same statement that used different plans.
+ */
+static uint64
+pgss_plan_id(PlannedStmt *pstmt)
+{
+	pgssJumbleState jstate;
+	ListCell   *lc;
+	uint64		planId;
+
+	/* Only the jumble buffer is used here */
+	memset(&jstate, 0, sizeof(jstate));
+	jstate.jumble = (unsigned char *) palloc(JUMBLE_SIZE);
+
+	JumblePlan(&jstate, pstmt->planTree, pstmt->rtable);
+	foreach(lc, pstmt->subplans)
+		JumblePlan(&jstate, (Plan *) lfirst(lc), pstmt->rtable);
+
+	planId = DatumGetUInt64(hash_any_extended(jstate.jumble,
+											  jstate.jumble_len, 0));
+	pfree(jstate.jumble);
+
+	/* Zero means "unknown" */
+	if (planId == UINT64CONST(0))
+		planId = UINT64CONST(1);
+
+	return planId;
+}
+
+/*
+ * Jumble a plan tree for pgss_plan_id().
+ */
+static void
+JumblePlan(pgssJumbleState *jstate, Plan *plan, List *rtable)
+{
+	NodeTag		tag;
+	ListCell   *lc;
+
+	/* Make missing children count, so that different shapes differ */
+	if (plan == NULL)
+	{
+		tag = T_Invalid;
+		APP_JUMB(tag);
+		return;
+	}
+
+	/* Guard against stack overflow due to overly complex plans */
+	check_stack_depth();
+
+	tag = nodeTag(plan);
+	APP_JUMB(tag);
+
+	switch (tag)
+	{
+		case T_SeqScan:
+		case T_SampleScan:
+		case T_BitmapHeapScan:
+		case T_TidScan:
+		case T_ForeignScan:
+			JumbleScanRelation(jstate, ((Scan *) plan)->scanrelid, rtable);
+			break;
+		case T_IndexScan:
+			JumbleScanRelation(jstate, ((Scan *) plan)->scanrelid, rtable);
+			APP_JUMB(((IndexScan *) plan)->indexid);
+			break;
+		case T_IndexOnlyScan:
+			JumbleScanRelation(jstate, ((Scan *) plan)->scanrelid, rtable);
+			APP_JUMB(((IndexOnlyScan *) plan)->indexid);
+			break;
+		case T_BitmapIndexScan:
+			APP_JUMB(((BitmapIndexScan *) plan)->indexid);
+			break;
+		case T_NestLoop:
+		case T_MergeJoin:
+		case T_HashJoin:
+			APP_JUMB(((Join *) plan)->jointype);
+			break;
+		case T_Agg:
+			APP_JUMB(((Agg *) plan)->aggstrategy);
+			break;
+		case T_ModifyTable:
+			APP_JUMB(((ModifyTable *) plan)->operation);
+			foreach(lc, ((ModifyTable *) plan)->plans)
+				JumblePlan(jstate, (Plan *) lfirst(lc), rtable);
+			break;
+		case T_Append:
+			foreach(lc, ((Append *) plan)->appendplans)
+				JumblePlan(jstate, (Plan *) lfirst(lc), rtable);
+			break;
+		case T_MergeAppend:
+			foreach(lc, ((MergeAppend *) plan)->mergeplans)
+				JumblePlan(jstate, (Plan *) lfirst(lc), rtable);
+			break;
+		case T_BitmapAnd:
+			foreach(lc, ((BitmapAnd *) plan)->bitmapplans)
+				JumblePlan(jstate, (Plan *) lfirst(lc), rtable);
+			break;
+		case T_BitmapOr:
+			foreach(lc, ((BitmapOr *) plan)->bitmapplans)
+				JumblePlan(jstate, (Plan *) lfirst(lc), rtable);
+			break;
+		case T_SubqueryScan:
+			JumblePlan(jstate, ((SubqueryScan *) plan)->subplan, rtable);
+			break;
+		case T_CustomScan:
+			foreach(lc, ((CustomScan *) plan)->custom_plans)
+				JumblePlan(jstate, (Plan *) lfirst(lc), rtable);
+			break;
+		default:
+			/* the node type and children are all that matter */
+			break;
+	}
+
+	JumblePlan(jstate, plan->lefttree, rtable);
+	JumblePlan(jstate, plan->righttree, rtable);
+}
+
+/*
+ * Jumble the OID of the relation a scan node scans, if any.
+ */
+static void
+JumbleScanRelation(pgssJumbleState *jstate, Index scanrelid, List *rtable)
+{
+	RangeTblEntry *rte;
+
+	/* foreign and custom joins have no scan relation */
+	if (scanrelid == 0 || scanrelid > list_length(rtable))
+		return;
+
+	rte = rt_fetch(scanrelid, rtable);
+	APP_JUMB(rte->relid);
+}
+
 /*
  * Record location of constant within query string of query tree
  * that is currently being walked.
@@ -358,6 +358,34 @@ SELECT 42;
 SELECT 42;
 SELECT query, plans, calls, rows FROM pg_stat_statements ORDER BY query COLLATE "C";
 
+--
+-- counting in batches
+--
+SET pg_stat_statements.flush_interval = '1h';
+SELECT pg_stat_statements_reset();
+SELECT 1 AS "batched";
+SELECT 2 AS "batched";
+SELECT 3 AS "batched";
+SELECT query, calls, rows FROM pg_stat_statements
+  WHERE query LIKE 'SELECT $1 AS%' ORDER BY query COLLATE "C";
+RESET pg_stat_statements.flush_interval;
+
+--
+-- plan identifiers and execution time histograms
+--
+CREATE TABLE pgss_plan_test (a int);
+SELECT pg_stat_statements_reset();
+SELECT count(*) FROM pgss_plan_test WHERE a = 1;
+CREATE INDEX ON pgss_plan_test (a);
+SET enable_seqscan = off;
+SELECT count(*) FROM pgss_plan_test WHERE a = 1;
+RESET enable_seqscan;
+SELECT calls, plan_changes, plan_id IS NOT NULL AS has_plan_id,
+  array_length(exec_time_histogram, 1) AS buckets,
+  (SELECT sum(b) FROM unnest(exec_time_histogram) b) AS histogram_total
+  FROM pg_stat_statements WHERE query LIKE 'SELECT count(*) FROM pgss_plan_test%';
+DROP TABLE pgss_plan_test;
+
 --
 -- access to pg_stat_statements_info view
 --
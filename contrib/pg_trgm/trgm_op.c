@@ -20,6 +20,19 @@ double		similarity_threshold = 0.3f;
 double		word_similarity_threshold = 0.6f;
 double		strict_word_similarity_threshold = 0.5f;
 
+/*
+ * Lookup tables for ASCII characters, so that the common case of extracting
+ * trigrams from ASCII text needs no locale-aware function calls per
+ * character.  They are filled on first use by asking the same functions the
+ * slow path uses, so results are identical; the database's LC_CTYPE can't
+ * change within a session.  A zero in ascii_lower means lower-casing that
+ * character doesn't yield a single ASCII byte (think Turkish dotless i), so
+ * words containing it take the slow path.
+ */
+static bool ascii_tables_ready = false;
+static bool ascii_wordchr[128];
+static char ascii_lower[128];
+
 void		_PG_init(void);
 
 PG_FUNCTION_INFO_V1(set_limit);
@@ -163,27 +176,78 @@ comp_trgm(const void *a, const void *b)
 	return CMPTRGM(a, b);
 }
 
+static void
+init_ascii_tables(void)
+{
+	for (int c = 1; c < 128; c++)
+	{
+		char		s[2];
+
+		s[0] = (char) c;
+		s[1] = '\0';
+		ascii_wordchr[c] = ISWORDCHR(s);
+#ifdef IGNORECASE
+		{
+			char	   *lower = lowerstr_with_len(s, 1);
+
+			if (strlen(lower) == 1 && !IS_HIGHBIT_SET(lower[0]))
+				ascii_lower[c] = lower[0];
+			else
+				ascii_lower[c] = '\0';
+			pfree(lower);
+		}
+#else
+		ascii_lower[c] = (char) c;
+#endif
+	}
+	ascii_wordchr[0] = false;
+	ascii_lower[0] = '\0';
+	ascii_tables_ready = true;
+}
+
+static inline bool
+iswordchr(const char *c)
+{
+	if (!IS_HIGHBIT_SET(*c))
+		return ascii_wordchr[(unsigned char) *c];
+	return ISWORDCHR(c);
+}
+
+static inline int
+trgm_mblen(const char *c)
+{
+	return IS_HIGHBIT_SET(*c) ? pg_mblen(c) : 1;
+}
+
 /*
  * Finds first word in string, returns pointer to the word,
- * endword points to the character after word
+ * endword points to the character after word.  *ascii is set to true if
+ * the word can be case-folded using ascii_lower[].
  */
 static char *
-find_word(char *str, int lenstr, char **endword, int *charlen)
+find_word(char *str, int lenstr, char **endword, int *charlen_p, bool *ascii)
 {
 	char	   *beginword = str;
 
-	while (beginword - str < lenstr && !ISWORDCHR(beginword))
-		beginword += pg_mblen(beginword);
+	if (!ascii_tables_ready)
+		init_ascii_tables();
+
+	while (beginword - str < lenstr && !iswordchr(beginword))
+		beginword += trgm_mblen(beginword);
 
 	if (beginword - str >= lenstr)
 		return NULL;
 
 	*endword = beginword;
-	*charlen = 0;
-	while (*endword - str < lenstr && ISWORDCHR(*endword))
+	*charlen_p = 0;
+	*ascii = true;
+	while (*endword - str < lenstr && iswordchr(*endword))
 	{
-		*endword += pg_mblen(*endword);
-		(*charlen)++;
+		if (IS_HIGHBIT_SET(**endword) ||
+			ascii_lower[(unsigned char) **endword] == '\0')
+			*ascii = false;
+		*endword += trgm_mblen(*endword);
+		(*charlen_p)++;
 	}
 
 	return beginword;
@@ -280,6 +344,7 @@ generate_trgm_only(trgm *trg, char *str, int slen, TrgmBound *bounds)
 				bytelen;
 	char	   *bword,
 			   *eword;
+	bool		ascii;
 
 	if (slen + LPADDING + RPADDING < 3 || slen == 0)
 		return 0;
@@ -297,20 +362,29 @@ generate_trgm_only(trgm *trg, char *str, int slen, TrgmBound *bounds)
 	}
 
 	eword = str;
-	while ((bword = find_word(eword, slen - (eword - str), &eword, &charlen)) != NULL)
+	while ((bword = find_word(eword, slen - (eword - str), &eword, &charlen,
+							  &ascii)) != NULL)
 	{
-#ifdef IGNORECASE
-		bword = lowerstr_with_len(bword, eword - bword);
-		bytelen = strlen(bword);
-#else
 		bytelen = eword - bword;
+		if (ascii)
+		{
+			/* Fast path: fold case one byte at a time */
+			for (int i = 0; i < bytelen; i++)
+				buf[LPADDING + i] = ascii_lower[(unsigned char) bword[i]];
+		}
+		else
+		{
+#ifdef IGNORECASE
+			bword = lowerstr_with_len(bword, eword - bword);
+			bytelen = strlen(bword);
 #endif
 
-		memcpy(buf + LPADDING, bword, bytelen);
+			memcpy(buf + LPADDING, bword, bytelen);
 
 #ifdef IGNORECASE
-		pfree(bword);
+			pfree(bword);
 #endif
+		}
 
 		buf[LPADDING + bytelen] = ' ';
 		buf[LPADDING + bytelen + 1] = ' ';
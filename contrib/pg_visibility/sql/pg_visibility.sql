@@ -94,6 +94,15 @@ select count(*) > 0 from pg_visibility_map_summary('test_partition');
 select * from pg_check_frozen('test_partition'); -- hopefully none
 select pg_truncate_visibility_map('test_partition');
 
+-- pages from which VACUUM removes dead tuples are frozen along the way
+create table eager_freeze_test (a int) with (autovacuum_enabled = off);
+insert into eager_freeze_test select generate_series(1, 1000);
+delete from eager_freeze_test where a % 2 = 0;
+vacuum eager_freeze_test;
+select * from pg_visibility_map_summary('eager_freeze_test');
+select * from pg_check_frozen('eager_freeze_test'); -- hopefully none
+drop table eager_freeze_test;
+
 -- cleanup
 drop table test_partitioned;
 drop view test_view;
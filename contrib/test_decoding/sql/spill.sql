@@ -174,6 +174,16 @@ SELECT (regexp_split_to_array(data, ':'))[4] COLLATE "C", COUNT(*), (array_agg(d
 FROM pg_logical_slot_get_changes('regression_slot', NULL,NULL) WHERE data ~ 'INSERT'
 GROUP BY 1 ORDER BY 1;
 
+-- spilling main xact with compressed spill files
+SET logical_decoding_spill_compression = pglz;
+BEGIN;
+INSERT INTO spill_test SELECT 'serialize-compressed--1:'||g.i||':'||repeat('x', 200) FROM generate_series(1, 5000) g(i);
+COMMIT;
+SELECT (regexp_split_to_array(data, ':'))[4], COUNT(*), bool_and(data ~ ('[0-9]:x{200}''$'))
+FROM pg_logical_slot_get_changes('regression_slot', NULL,NULL) WHERE data ~ 'INSERT'
+GROUP BY 1 ORDER BY 1;
+RESET logical_decoding_spill_compression;
+
 DROP TABLE spill_test;
 
 SELECT pg_drop_replication_slot('regression_slot');
@@ -19,30 +19,163 @@
 #include "access/brin_page.h"
 #include "access/brin_pageops.h"
 #include "access/brin_xlog.h"
+#include "access/parallel.h"
 #include "access/relation.h"
 #include "access/reloptions.h"
 #include "access/relscan.h"
 #include "access/table.h"
 #include "access/tableam.h"
+#include "access/xact.h"
 #include "access/xloginsert.h"
 #include "catalog/index.h"
 #include "catalog/pg_am.h"
 #include "commands/vacuum.h"
+#include "executor/instrument.h"
 #include "miscadmin.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/paths.h"
 #include "pgstat.h"
+#include "port/atomics.h"
 #include "postmaster/autovacuum.h"
 #include "storage/bufmgr.h"
+#include "storage/condition_variable.h"
 #include "storage/freespace.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"		/* pgrminclude ignore */
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/index_selfuncs.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/tuplesort.h"
 
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_BRIN_SHARED		UINT64CONST(0xB000000000000001)
+#define PARALLEL_KEY_TUPLESORT			UINT64CONST(0xB000000000000002)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xB000000000000003)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xB000000000000004)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xB000000000000005)
+
+/*
+ * Status for parallel BRIN operations.  This is allocated in a dynamic
+ * shared memory segment.
+ *
+ * In a parallel index build, each participant summarizes the heap blocks
+ * handed to it by a parallel heap scan, and feeds the summary tuples to a
+ * shared tuplesort.  A range whose blocks were seen by more than one
+ * participant produces several partial summaries.  The leader reads the
+ * tuples back in block number order, unions the partial summaries of each
+ * range and inserts the result, so the index is filled in revmap order just
+ * like in a serial build.
+ *
+ * In a parallel summarization, participants instead claim whole ranges from
+ * a shared counter, and summarize those that are missing from the index just
+ * as the serial code does.  summarize_range() copes with concurrent
+ * insertions into the range it works on, and nothing more is needed for
+ * participants to work on different ranges at the same time.
+ */
+typedef struct BrinShared
+{
+	/*
+	 * These fields are not modified during the operation.  They exist for
+	 * the benefit of worker processes that need to open the relations.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+	BlockNumber pagesPerRange;
+	int			scantuplesortstates;
+
+	/*
+	 * Set for a parallel summarization.  Ranges starting below heapNumBlocks
+	 * are handed out through nextRangeStart.
+	 */
+	bool		summarizing;
+	bool		include_partial;
+	BlockNumber heapNumBlocks;
+	pg_atomic_uint64 nextRangeStart;
+
+	/*
+	 * workersdonecv is used to monitor the progress of workers.  All parallel
+	 * participants must indicate that they are done before leader can use
+	 * mutable state that workers maintain during the operation.
+	 */
+	ConditionVariable workersdonecv;
+
+	/*
+	 * mutex protects the fields that follow it.
+	 *
+	 * Mutable state that is maintained by workers, and reported back to
+	 * leader at the end.
+	 *
+	 * nparticipantsdone is number of participants finished.
+	 *
+	 * reltuples is the total number of input heap tuples of a build.
+	 *
+	 * brokenhotchain indicates if any worker detected a broken HOT chain
+	 * during a build.
+	 *
+	 * numSummarized and numExisting count the ranges summarized, and those
+	 * found already summarized, by a summarization.
+	 */
+	slock_t		mutex;
+	int			nparticipantsdone;
+	double		reltuples;
+	bool		brokenhotchain;
+	double		numSummarized;
+	double		numExisting;
+
+	/*
+	 * For builds, ParallelTableScanDescData data follows.  Can't directly
+	 * embed here, as implementations of the parallel table scan desc
+	 * interface might need stronger alignment.
+	 */
+} BrinShared;
+
+/*
+ * Return pointer to a BrinShared's parallel table scan.
+ *
+ * c.f. shm_toc_allocate as to why BUFFERALIGN is used, rather than just
+ * MAXALIGN.
+ */
+#define ParallelTableScanFromBrinShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(BrinShared)))
+
+/*
+ * Status for leader in parallel BRIN operations.
+ */
+typedef struct BrinLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/*
+	 * nparticipants is the exact number of worker processes successfully
+	 * launched, plus one for the leader process, which always participates
+	 * as a worker.
+	 */
+	int			nparticipants;
+
+	/*
+	 * Leader process convenience pointers to shared state (leader avoids TOC
+	 * lookups).  sharedsort is only used by builds.  snapshot is the
+	 * snapshot used by the scan iff an MVCC snapshot is required.
+	 */
+	BrinShared *brinshared;
+	Sharedsort *sharedsort;
+	Snapshot	snapshot;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+} BrinLeader;
 
 /*
  * We use a BrinBuildState during initial construction of a BRIN index.
  * The running state is kept in a BrinMemTuple.
+ *
+ * Participants of a parallel build send their summaries to bs_sortstate
+ * rather than into the index; bs_rangeHasValues tells whether the current
+ * range has seen any heap tuples yet.
  */
 typedef struct BrinBuildState
 {
@@ -54,6 +187,9 @@ typedef struct BrinBuildState
 	BrinRevmap *bs_rmAccess;
 	BrinDesc   *bs_bdesc;
 	BrinMemTuple *bs_dtuple;
+	bool		bs_rangeHasValues;
+	Tuplesortstate *bs_sortstate;
+	BrinLeader *bs_leader;
 } BrinBuildState;
 
 /*
@@ -73,11 +209,45 @@ static BrinBuildState *initialize_brin_buildstate(Relation idxRel,
 static void terminate_brin_buildstate(BrinBuildState *state);
 static void brinsummarize(Relation index, Relation heapRel, BlockNumber pageRange,
 						  bool include_partial, double *numSummarized, double *numExisting);
+static void brinsummarize_ranges(Relation index, Relation heapRel,
+								 BrinRevmap *revmap, BlockNumber pagesPerRange,
+								 BlockNumber startBlk, BlockNumber heapNumBlocks,
+								 bool include_partial, BrinShared *brinshared,
+								 double *numSummarized, double *numExisting);
+static int	brin_summarize_parallel_workers(Relation index, Relation heapRel,
+											BrinRevmap *revmap,
+											BlockNumber pagesPerRange,
+											BlockNumber heapNumBlocks,
+											bool include_partial);
 static void form_and_insert_tuple(BrinBuildState *state);
+static void form_and_spill_tuple(BrinBuildState *state);
 static void union_tuples(BrinDesc *bdesc, BrinMemTuple *a,
 						 BrinTuple *b);
 static void brin_vacuum_scan(Relation idxrel, BufferAccessStrategy strategy);
 
+/* parallel index builds and summarization */
+static BrinLeader *_brin_begin_parallel(Relation heap, Relation index,
+										BlockNumber pagesPerRange,
+										bool isconcurrent, bool summarizing,
+										BlockNumber heapNumBlocks,
+										bool include_partial, int request);
+static void _brin_end_parallel(BrinLeader *brinleader);
+static Size _brin_parallel_estimate_shared(Relation heap, Snapshot snapshot,
+										   bool summarizing);
+static void _brin_parallel_wait(BrinLeader *brinleader);
+static double _brin_parallel_merge(BrinBuildState *state, Relation heap,
+								   Relation index, IndexInfo *indexInfo);
+static void _brin_leader_participate_as_worker(BrinLeader *brinleader,
+											   Relation heap, Relation index);
+static void _brin_parallel_scan_and_build(BrinBuildState *state,
+										  BrinShared *brinshared,
+										  Sharedsort *sharedsort,
+										  Relation heap, Relation index,
+										  int sortmem, bool progress);
+static void _brin_parallel_summarize(Relation index, Relation heap,
+									 BrinRevmap *revmap,
+									 BrinShared *brinshared);
+
 
 /*
  * BRIN handler function: return IndexAmRoutine with access method parameters
@@ -105,6 +275,7 @@ brinhandler(PG_FUNCTION_ARGS)
 	amroutine->amcanparallel = false;
 	amroutine->amcaninclude = false;
 	amroutine->amusemaintenanceworkmem = false;
+	amroutine->amsummarizing = true;
 	amroutine->amparallelvacuumoptions =
 		VACUUM_OPTION_PARALLEL_CLEANUP;
 	amroutine->amkeytype = InvalidOid;
@@ -595,6 +766,37 @@ brinendscan(IndexScanDesc scan)
 	pfree(opaque);
 }
 
+/*
+ * Accumulate the values of one heap tuple into the running state of the
+ * current range.
+ */
+static void
+add_values_to_range(Relation index, BrinBuildState *state,
+					Datum *values, bool *isnull)
+{
+	int			i;
+
+	for (i = 0; i < state->bs_bdesc->bd_tupdesc->natts; i++)
+	{
+		FmgrInfo   *addValue;
+		BrinValues *col;
+		Form_pg_attribute attr = TupleDescAttr(state->bs_bdesc->bd_tupdesc, i);
+
+		col = &state->bs_dtuple->bt_columns[i];
+		addValue = index_getprocinfo(index, i + 1,
+									 BRIN_PROCNUM_ADDVALUE);
+
+		/*
+		 * Update dtuple state, if and as necessary.
+		 */
+		FunctionCall4Coll(addValue,
+						  attr->attcollation,
+						  PointerGetDatum(state->bs_bdesc),
+						  PointerGetDatum(col),
+						  values[i], isnull[i]);
+	}
+}
+
 /*
  * Per-heap-tuple callback for table_index_build_scan.
  *
@@ -612,7 +814,6 @@ brinbuildCallback(Relation index,
 {
 	BrinBuildState *state = (BrinBuildState *) brstate;
 	BlockNumber thisblock;
-	int			i;
 
 	thisblock = ItemPointerGetBlockNumber(tid);
 
@@ -641,25 +842,47 @@ brinbuildCallback(Relation index,
 	}
 
 	/* Accumulate the current tuple into the running state */
-	for (i = 0; i < state->bs_bdesc->bd_tupdesc->natts; i++)
-	{
-		FmgrInfo   *addValue;
-		BrinValues *col;
-		Form_pg_attribute attr = TupleDescAttr(state->bs_bdesc->bd_tupdesc, i);
+	add_values_to_range(index, state, values, isnull);
+}
 
-		col = &state->bs_dtuple->bt_columns[i];
-		addValue = index_getprocinfo(index, i + 1,
-									 BRIN_PROCNUM_ADDVALUE);
+/*
+ * Per-heap-tuple callback for table_index_build_scan in a parallel build.
+ *
+ * A participant only sees the blocks the parallel scan hands to it, in
+ * chunks that need not line up with range boundaries, and a synchronized
+ * scan may even wrap around to the start of the table.  So whenever we move
+ * to a different range, the summary we have so far is sent to the tuplesort
+ * and we start afresh; the leader merges summaries of the same range, and
+ * fills in the ranges nobody saw any tuples for.  As in the serial case, the
+ * range we're working on when the scan ends is left for the caller.
+ */
+static void
+brinbuildCallbackParallel(Relation index,
+						  ItemPointer tid,
+						  Datum *values,
+						  bool *isnull,
+						  bool tupleIsAlive,
+						  void *brstate)
+{
+	BrinBuildState *state = (BrinBuildState *) brstate;
+	BlockNumber thisblock;
+	BlockNumber thisRangeStart;
 
-		/*
-		 * Update dtuple state, if and as necessary.
-		 */
-		FunctionCall4Coll(addValue,
-						  attr->attcollation,
-						  PointerGetDatum(state->bs_bdesc),
-						  PointerGetDatum(col),
-						  values[i], isnull[i]);
+	thisblock = ItemPointerGetBlockNumber(tid);
+	thisRangeStart = thisblock - (thisblock % state->bs_pagesPerRange);
+
+	if (thisRangeStart != state->bs_currRangeStart)
+	{
+		if (state->bs_rangeHasValues)
+			form_and_spill_tuple(state);
+
+		state->bs_currRangeStart = thisRangeStart;
+		brin_memtuple_initialize(state->bs_dtuple, state->bs_bdesc);
 	}
+
+	/* Accumulate the current tuple into the running state */
+	add_values_to_range(index, state, values, isnull);
+	state->bs_rangeHasValues = true;
 }
 
 /*
@@ -724,14 +947,34 @@ brinbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	state = initialize_brin_buildstate(index, revmap, pagesPerRange);
 
 	/*
-	 * Now scan the relation.  No syncscan allowed here because we want the
-	 * heap blocks in physical order.
+	 * Attempt to launch parallel worker scan when required.  Workers only
+	 * compute summaries; inserting them is left to us.
 	 */
-	reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
-									   brinbuildCallback, (void *) state, NULL);
+	if (indexInfo->ii_ParallelWorkers > 0)
+		state->bs_leader = _brin_begin_parallel(heap, index, pagesPerRange,
+												indexInfo->ii_Concurrent,
+												false, InvalidBlockNumber,
+												false,
+												indexInfo->ii_ParallelWorkers);
+
+	if (state->bs_leader)
+	{
+		_brin_leader_participate_as_worker(state->bs_leader, heap, index);
+		reltuples = _brin_parallel_merge(state, heap, index, indexInfo);
+		_brin_end_parallel(state->bs_leader);
+	}
+	else
+	{
+		/*
+		 * Now scan the relation.  No syncscan allowed here because we want
+		 * the heap blocks in physical order.
+		 */
+		reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
+										   brinbuildCallback, (void *) state, NULL);
 
-	/* process the final batch */
-	form_and_insert_tuple(state);
+		/* process the final batch */
+		form_and_insert_tuple(state);
+	}
 
 	/* release resources */
 	idxtuples = state->bs_numtuples;
@@ -1119,6 +1362,9 @@ initialize_brin_buildstate(Relation idxRel, BrinRevmap *revmap,
 	state->bs_rmAccess = revmap;
 	state->bs_bdesc = brin_build_desc(idxRel);
 	state->bs_dtuple = brin_new_memtuple(state->bs_bdesc);
+	state->bs_rangeHasValues = false;
+	state->bs_sortstate = NULL;
+	state->bs_leader = NULL;
 
 	brin_memtuple_initialize(state->bs_dtuple, state->bs_bdesc);
 
@@ -1305,11 +1551,9 @@ brinsummarize(Relation index, Relation heapRel, BlockNumber pageRange,
 			  bool include_partial, double *numSummarized, double *numExisting)
 {
 	BrinRevmap *revmap;
-	BrinBuildState *state = NULL;
-	IndexInfo  *indexInfo = NULL;
+	BrinLeader *brinleader = NULL;
 	BlockNumber heapNumBlocks;
 	BlockNumber pagesPerRange;
-	Buffer		buf;
 	BlockNumber startBlk;
 
 	revmap = brinRevmapInitialize(index, &pagesPerRange, NULL);
@@ -1330,15 +1574,88 @@ brinsummarize(Relation index, Relation heapRel, BlockNumber pageRange,
 		return;
 	}
 
+	/*
+	 * A large backlog of unsummarized ranges is worth spreading over parallel
+	 * workers, just like the initial build.
+	 */
+	if (pageRange == BRIN_ALL_BLOCKRANGES)
+	{
+		int			nworkers;
+
+		nworkers = brin_summarize_parallel_workers(index, heapRel, revmap,
+												   pagesPerRange,
+												   heapNumBlocks,
+												   include_partial);
+		if (nworkers > 0)
+			brinleader = _brin_begin_parallel(heapRel, index, pagesPerRange,
+											  false, true, heapNumBlocks,
+											  include_partial, nworkers);
+	}
+
+	if (brinleader)
+	{
+		BrinShared *brinshared = brinleader->brinshared;
+
+		/* Do our share of the ranges, then wait for everyone else's */
+		_brin_parallel_summarize(index, heapRel, revmap, brinshared);
+		_brin_parallel_wait(brinleader);
+
+		if (numSummarized)
+			*numSummarized += brinshared->numSummarized;
+		if (numExisting)
+			*numExisting += brinshared->numExisting;
+
+		_brin_end_parallel(brinleader);
+	}
+	else
+		brinsummarize_ranges(index, heapRel, revmap, pagesPerRange,
+							 startBlk, heapNumBlocks, include_partial, NULL,
+							 numSummarized, numExisting);
+
+	brinRevmapTerminate(revmap);
+}
+
+/*
+ * Workhorse for brinsummarize: summarize the ranges from startBlk up to
+ * heapNumBlocks that are missing from the index.
+ *
+ * In a parallel summarization brinshared is given, and startBlk is ignored;
+ * participants claim the ranges to look at one at a time from the shared
+ * state instead.
+ */
+static void
+brinsummarize_ranges(Relation index, Relation heapRel, BrinRevmap *revmap,
+					 BlockNumber pagesPerRange, BlockNumber startBlk,
+					 BlockNumber heapNumBlocks, bool include_partial,
+					 BrinShared *brinshared,
+					 double *numSummarized, double *numExisting)
+{
+	BrinBuildState *state = NULL;
+	IndexInfo  *indexInfo = NULL;
+	Buffer		buf;
+
 	/*
 	 * Scan the revmap to find unsummarized items.
 	 */
 	buf = InvalidBuffer;
-	for (; startBlk < heapNumBlocks; startBlk += pagesPerRange)
+	for (;; startBlk += pagesPerRange)
 	{
 		BrinTuple  *tup;
 		OffsetNumber off;
 
+		if (brinshared)
+		{
+			uint64		claimed;
+
+			claimed = pg_atomic_fetch_add_u64(&brinshared->nextRangeStart,
+											  pagesPerRange);
+			if (claimed >= heapNumBlocks)
+				break;
+			startBlk = (BlockNumber) claimed;
+		}
+		else if (startBlk >= heapNumBlocks)
+			break;
+
 		/*
 		 * Unless requested to summarize even a partial range, go away now if
 		 * we think the next range is partial.  Caller would pass true when it
@@ -1385,7 +1702,6 @@ brinsummarize(Relation index, Relation heapRel, BlockNumber pageRange,
 		ReleaseBuffer(buf);
 
 	/* free resources */
-	brinRevmapTerminate(revmap);
 	if (state)
 	{
 		terminate_brin_buildstate(state);
@@ -1393,6 +1709,65 @@ brinsummarize(Relation index, Relation heapRel, BlockNumber pageRange,
 	}
 }
 
+/*
+ * Determine the number of parallel workers to summarize all unsummarized
+ * ranges of the index with.
+ *
+ * This is only worthwhile when the ranges to summarize add up to a table
+ * size that the planner would consider scanning in parallel; we stop
+ * counting as soon as we know that's the case.  Beyond that, we let
+ * plan_create_index_workers decide, as for the initial build.
+ */
+static int
+brin_summarize_parallel_workers(Relation index, Relation heapRel,
+								BrinRevmap *revmap, BlockNumber pagesPerRange,
+								BlockNumber heapNumBlocks, bool include_partial)
+{
+	BlockNumber heapBlk;
+	BlockNumber pendingBlocks = 0;
+	Buffer		buf = InvalidBuffer;
+
+	/*
+	 * We can't launch workers from within a parallel operation, such as the
+	 * index cleanup of a parallel VACUUM.  Autovacuum never uses parallel
+	 * workers for vacuuming either, so don't start doing so here.
+	 */
+	if (IsInParallelMode() || IsAutoVacuumWorkerProcess() ||
+		max_parallel_maintenance_workers == 0 ||
+		heapNumBlocks < (BlockNumber) min_parallel_table_scan_size)
+		return 0;
+
+	for (heapBlk = 0;
+		 heapBlk < heapNumBlocks &&
+		 pendingBlocks < (BlockNumber) min_parallel_table_scan_size;
+		 heapBlk += pagesPerRange)
+	{
+		BrinTuple  *tup;
+		OffsetNumber off;
+
+		if (!include_partial && heapBlk + pagesPerRange > heapNumBlocks)
+			break;
+
+		CHECK_FOR_INTERRUPTS();
+
+		tup = brinGetTupleForHeapBlock(revmap, heapBlk, &buf, &off, NULL,
+									   BUFFER_LOCK_SHARE, NULL);
+		if (tup == NULL)
+			pendingBlocks += pagesPerRange;
+		else
+			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+	}
+
+	if (BufferIsValid(buf))
+		ReleaseBuffer(buf);
+
+	if (pendingBlocks < (BlockNumber) min_parallel_table_scan_size)
+		return 0;
+
+	return plan_create_index_workers(RelationGetRelid(heapRel),
+									 RelationGetRelid(index));
+}
+
 /*
  * Given a deformed tuple in the build state, convert it into the on-disk
  * format and insert it into the index, making the revmap point to it.
@@ -1413,6 +1788,25 @@ form_and_insert_tuple(BrinBuildState *state)
 	pfree(tup);
 }
 
+/*
+ * In a parallel build participant, convert the deformed tuple in the build
+ * state into the on-disk format and hand it to the tuplesort, for the leader
+ * to insert.
+ */
+static void
+form_and_spill_tuple(BrinBuildState *state)
+{
+	BrinTuple  *tup;
+	Size		size;
+
+	tup = brin_form_tuple(state->bs_bdesc, state->bs_currRangeStart,
+						  state->bs_dtuple, &size);
+	tuplesort_putbrintuple(state->bs_sortstate, tup, size);
+	state->bs_numtuples++;
+
+	pfree(tup);
+}
+
 /*
  * Given two deformed tuples, adjust the first one so that it's consistent
  * with the summary values in both.
@@ -1491,3 +1885,530 @@ brin_vacuum_scan(Relation idxrel, BufferAccessStrategy strategy)
 	 */
 	FreeSpaceMapVacuum(idxrel);
 }
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * For an index build, isconcurrent indicates if operation is CREATE INDEX
+ * CONCURRENTLY.  For a summarization of all ranges of an existing index,
+ * summarizing is true, and heapNumBlocks and include_partial have the same
+ * meaning as for brinsummarize_ranges.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Returns the BrinLeader, which caller must use to shut down parallel mode
+ * by passing it to _brin_end_parallel() once it is done.  If not even a
+ * single worker process can be launched, returns NULL, and caller should
+ * proceed serially.
+ */
+static BrinLeader *
+_brin_begin_parallel(Relation heap, Relation index, BlockNumber pagesPerRange,
+					 bool isconcurrent, bool summarizing,
+					 BlockNumber heapNumBlocks, bool include_partial,
+					 int request)
+{
+	ParallelContext *pcxt;
+	int			scantuplesortstates;
+	Snapshot	snapshot;
+	Size		estbrinshared;
+	Size		estsort = 0;
+	BrinShared *brinshared;
+	Sharedsort *sharedsort = NULL;
+	BrinLeader *brinleader;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	int			querylen;
+
+	/*
+	 * Enter parallel mode, and create context for parallel build or
+	 * summarization of brin index
+	 */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_brin_parallel_build_main",
+								 request);
+
+	scantuplesortstates = request + 1;
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time
+	 * qual checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.  Summarization scans each range on its own,
+	 * in the same way as summarize_range does serially, so it needs neither
+	 * a snapshot nor a parallel heap scan.
+	 */
+	if (summarizing || !isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_BRIN_SHARED workspace, and
+	 * PARALLEL_KEY_TUPLESORT tuplesort workspace for builds
+	 */
+	estbrinshared = _brin_parallel_estimate_shared(heap, snapshot, summarizing);
+	shm_toc_estimate_chunk(&pcxt->estimator, estbrinshared);
+	if (summarizing)
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	else
+	{
+		estsort = tuplesort_estimate_shared(scantuplesortstates);
+		shm_toc_estimate_chunk(&pcxt->estimator, estsort);
+		shm_toc_estimate_keys(&pcxt->estimator, 2);
+	}
+
+	/*
+	 * Estimate space for WalUsage and BufferUsage -- PARALLEL_KEY_WAL_USAGE
+	 * and PARALLEL_KEY_BUFFER_USAGE.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+	{
+		if (IsMVCCSnapshot(snapshot))
+			UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return NULL;
+	}
+
+	/* Store shared state, for which we reserved space */
+	brinshared = (BrinShared *) shm_toc_allocate(pcxt->toc, estbrinshared);
+	/* Initialize immutable state */
+	brinshared->heaprelid = RelationGetRelid(heap);
+	brinshared->indexrelid = RelationGetRelid(index);
+	brinshared->isconcurrent = isconcurrent;
+	brinshared->pagesPerRange = pagesPerRange;
+	brinshared->scantuplesortstates = scantuplesortstates;
+	brinshared->summarizing = summarizing;
+	brinshared->include_partial = include_partial;
+	brinshared->heapNumBlocks = heapNumBlocks;
+	pg_atomic_init_u64(&brinshared->nextRangeStart, 0);
+	ConditionVariableInit(&brinshared->workersdonecv);
+	SpinLockInit(&brinshared->mutex);
+	/* Initialize mutable state */
+	brinshared->nparticipantsdone = 0;
+	brinshared->reltuples = 0.0;
+	brinshared->brokenhotchain = false;
+	brinshared->numSummarized = 0.0;
+	brinshared->numExisting = 0.0;
+
+	if (!summarizing)
+	{
+		table_parallelscan_initialize(heap,
+									  ParallelTableScanFromBrinShared(brinshared),
+									  snapshot);
+
+		/*
+		 * Store shared tuplesort-private state, for which we reserved space.
+		 * Then, initialize opaque state using tuplesort routine.
+		 */
+		sharedsort = (Sharedsort *) shm_toc_allocate(pcxt->toc, estsort);
+		tuplesort_initialize_shared(sharedsort, scantuplesortstates,
+									pcxt->seg);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT, sharedsort);
+	}
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BRIN_SHARED, brinshared);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	/*
+	 * Allocate space for each worker's WalUsage and BufferUsage; no need to
+	 * initialize.
+	 */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+	brinleader = (BrinLeader *) palloc0(sizeof(BrinLeader));
+	brinleader->pcxt = pcxt;
+	brinleader->nparticipants = pcxt->nworkers_launched + 1;
+	brinleader->brinshared = brinshared;
+	brinleader->sharedsort = sharedsort;
+	brinleader->snapshot = snapshot;
+	brinleader->walusage = walusage;
+	brinleader->bufferusage = bufferusage;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		_brin_end_parallel(brinleader);
+		return NULL;
+	}
+
+	return brinleader;
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ */
+static void
+_brin_end_parallel(BrinLeader *brinleader)
+{
+	int			i;
+
+	/* Shutdown worker processes */
+	WaitForParallelWorkersToFinish(brinleader->pcxt);
+
+	/*
+	 * Next, accumulate WAL usage.  (This must wait for the workers to finish,
+	 * or we might get incomplete data.)
+	 */
+	for (i = 0; i < brinleader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&brinleader->bufferusage[i], &brinleader->walusage[i]);
+
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(brinleader->snapshot))
+		UnregisterSnapshot(brinleader->snapshot);
+	DestroyParallelContext(brinleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Returns size of shared memory required to store state for a parallel
+ * brin index build based on the snapshot its parallel scan will use, or for
+ * a parallel summarization.
+ */
+static Size
+_brin_parallel_estimate_shared(Relation heap, Snapshot snapshot,
+							   bool summarizing)
+{
+	/* c.f. shm_toc_allocate as to why BUFFERALIGN is used */
+	if (summarizing)
+		return BUFFERALIGN(sizeof(BrinShared));
+
+	return add_size(BUFFERALIGN(sizeof(BrinShared)),
+					table_parallelscan_estimate(heap, snapshot));
+}
+
+/*
+ * Within leader, wait for all participants to finish their share of the
+ * work.  Afterwards, the leader can read the mutable state in BrinShared
+ * without taking the mutex.
+ */
+static void
+_brin_parallel_wait(BrinLeader *brinleader)
+{
+	BrinShared *brinshared = brinleader->brinshared;
+
+	/* Make sure that the failure-to-start case will not hang forever */
+	WaitForParallelWorkersToAttach(brinleader->pcxt);
+
+	for (;;)
+	{
+		SpinLockAcquire(&brinshared->mutex);
+		if (brinshared->nparticipantsdone == brinleader->nparticipants)
+		{
+			SpinLockRelease(&brinshared->mutex);
+			break;
+		}
+		SpinLockRelease(&brinshared->mutex);
+
+		ConditionVariableSleep(&brinshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+}
+
+/*
+ * Within leader of a parallel build, wait for the participants to finish
+ * scanning, then merge their summaries and insert them into the index.
+ *
+ * The tuplesort returns the partial summaries in block number order, so
+ * the index tuples are inserted in the same order as in a serial build.
+ * Ranges that no participant saw any tuples for get an empty summary, also
+ * as in a serial build.
+ *
+ * Returns the total number of heap tuples scanned.
+ */
+static double
+_brin_parallel_merge(BrinBuildState *state, Relation heap, Relation index,
+					 IndexInfo *indexInfo)
+{
+	BrinLeader *brinleader = state->bs_leader;
+	SortCoordinate coordinate;
+	BrinTuple  *tup;
+	Size		tuplen;
+
+	_brin_parallel_wait(brinleader);
+	indexInfo->ii_BrokenHotChain = brinleader->brinshared->brokenhotchain;
+
+	/* Set up the leader's tuplesort, which merges the workers' runs */
+	coordinate = (SortCoordinate) palloc0(sizeof(SortCoordinateData));
+	coordinate->isWorker = false;
+	coordinate->nParticipants = brinleader->nparticipants;
+	coordinate->sharedsort = brinleader->sharedsort;
+
+	state->bs_sortstate = tuplesort_begin_index_brin(heap, index,
+													 maintenance_work_mem,
+													 coordinate, false);
+	tuplesort_performsort(state->bs_sortstate);
+
+	state->bs_currRangeStart = 0;
+	while ((tup = tuplesort_getbrintuple(state->bs_sortstate, &tuplen,
+										 true)) != NULL)
+	{
+		MemoryContext oldcxt;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* Insert the ranges up to this one, which are complete now */
+		while (tup->bt_blkno > state->bs_currRangeStart)
+		{
+			form_and_insert_tuple(state);
+			state->bs_currRangeStart += state->bs_pagesPerRange;
+			brin_memtuple_initialize(state->bs_dtuple, state->bs_bdesc);
+		}
+
+		/* Merge the partial summary into the range's running state */
+		Assert(tup->bt_blkno == state->bs_currRangeStart);
+		oldcxt = MemoryContextSwitchTo(state->bs_dtuple->bt_context);
+		union_tuples(state->bs_bdesc, state->bs_dtuple, tup);
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	/* process the final batch */
+	form_and_insert_tuple(state);
+
+	tuplesort_end(state->bs_sortstate);
+	state->bs_sortstate = NULL;
+
+	return brinleader->brinshared->reltuples;
+}
+
+/*
+ * Within leader of a parallel build, participate as a parallel worker.
+ */
+static void
+_brin_leader_participate_as_worker(BrinLeader *brinleader, Relation heap,
+								   Relation index)
+{
+	BrinBuildState *leaderworker;
+
+	leaderworker = initialize_brin_buildstate(index, NULL,
+											  brinleader->brinshared->pagesPerRange);
+
+	/*
+	 * Might as well use reliable figure when doling out maintenance_work_mem
+	 * (when requested number of workers were not launched, this will be
+	 * somewhat higher than it is for other workers).
+	 */
+	_brin_parallel_scan_and_build(leaderworker, brinleader->brinshared,
+								  brinleader->sharedsort, heap, index,
+								  maintenance_work_mem / brinleader->nparticipants,
+								  true);
+
+	terminate_brin_buildstate(leaderworker);
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_brin_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	BrinShared *brinshared;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Look up brin shared state */
+	brinshared = shm_toc_lookup(toc, PARALLEL_KEY_BRIN_SHARED, false);
+
+	/*
+	 * Open relations using lock modes known to be obtained by index.c, or,
+	 * when summarizing, lock modes no stronger than those held by the leader
+	 */
+	if (!brinshared->isconcurrent && !brinshared->summarizing)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = table_open(brinshared->heaprelid, heapLockmode);
+	indexRel = index_open(brinshared->indexrelid, indexLockmode);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	if (brinshared->summarizing)
+	{
+		BrinRevmap *revmap;
+		BlockNumber pagesPerRange;
+
+		revmap = brinRevmapInitialize(indexRel, &pagesPerRange, NULL);
+		Assert(pagesPerRange == brinshared->pagesPerRange);
+		_brin_parallel_summarize(indexRel, heapRel, revmap, brinshared);
+		brinRevmapTerminate(revmap);
+	}
+	else
+	{
+		Sharedsort *sharedsort;
+		BrinBuildState *state;
+
+		/* Look up shared state private to tuplesort.c */
+		sharedsort = shm_toc_lookup(toc, PARALLEL_KEY_TUPLESORT, false);
+		tuplesort_attach_shared(sharedsort, seg);
+
+		state = initialize_brin_buildstate(indexRel, NULL,
+										   brinshared->pagesPerRange);
+		_brin_parallel_scan_and_build(state, brinshared, sharedsort,
+									  heapRel, indexRel,
+									  maintenance_work_mem / brinshared->scantuplesortstates,
+									  false);
+		terminate_brin_buildstate(state);
+	}
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	index_close(indexRel, indexLockmode);
+	table_close(heapRel, heapLockmode);
+}
+
+/*
+ * Perform a participant's portion of a parallel build.
+ *
+ * The summaries of the ranges seen by this participant are sent to a
+ * "partial" tuplesort, for the leader to merge.  sortmem is the amount of
+ * working memory to use, expressed in KBs.
+ *
+ * When this returns, the participant is done, and need only release
+ * resources.
+ */
+static void
+_brin_parallel_scan_and_build(BrinBuildState *state, BrinShared *brinshared,
+							  Sharedsort *sharedsort, Relation heap,
+							  Relation index, int sortmem, bool progress)
+{
+	SortCoordinate coordinate;
+	TableScanDesc scan;
+	double		reltuples;
+	IndexInfo  *indexInfo;
+
+	/* Initialize local tuplesort coordination state */
+	coordinate = (SortCoordinate) palloc0(sizeof(SortCoordinateData));
+	coordinate->isWorker = true;
+	coordinate->nParticipants = -1;
+	coordinate->sharedsort = sharedsort;
+
+	/* Begin "partial" tuplesort */
+	state->bs_sortstate = tuplesort_begin_index_brin(heap, index, sortmem,
+													 coordinate, false);
+
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = brinshared->isconcurrent;
+	scan = table_beginscan_parallel(heap,
+									ParallelTableScanFromBrinShared(brinshared));
+	reltuples = table_index_build_scan(heap, index, indexInfo, true, progress,
+									   brinbuildCallbackParallel,
+									   (void *) state, scan);
+
+	/* spill the range we were working on when the scan ended */
+	if (state->bs_rangeHasValues)
+		form_and_spill_tuple(state);
+
+	/* Execute this participant's part of the sort */
+	tuplesort_performsort(state->bs_sortstate);
+
+	/*
+	 * Done.  Record ambuild statistics, and whether we encountered a broken
+	 * HOT chain.
+	 */
+	SpinLockAcquire(&brinshared->mutex);
+	brinshared->nparticipantsdone++;
+	brinshared->reltuples += reltuples;
+	if (indexInfo->ii_BrokenHotChain)
+		brinshared->brokenhotchain = true;
+	SpinLockRelease(&brinshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&brinshared->workersdonecv);
+
+	/* We can end tuplesort immediately */
+	tuplesort_end(state->bs_sortstate);
+	state->bs_sortstate = NULL;
+}
+
+/*
+ * Perform a participant's portion of a parallel summarization, and report
+ * the number of ranges it summarized or found already summarized.
+ */
+static void
+_brin_parallel_summarize(Relation index, Relation heap, BrinRevmap *revmap,
+						 BrinShared *brinshared)
+{
+	double		numSummarized = 0;
+	double		numExisting = 0;
+
+	brinsummarize_ranges(index, heap, revmap, brinshared->pagesPerRange,
+						 0, brinshared->heapNumBlocks,
+						 brinshared->include_partial, brinshared,
+						 &numSummarized, &numExisting);
+
+	SpinLockAcquire(&brinshared->mutex);
+	brinshared->nparticipantsdone++;
+	brinshared->numSummarized += numSummarized;
+	brinshared->numExisting += numExisting;
+	SpinLockRelease(&brinshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&brinshared->workersdonecv);
+}
@@ -0,0 +1,368 @@
+/*
+ * brin_bloom.c
+ *		Implementation of Bloom opclass for BRIN
+ *
+ * A Bloom filter summarizes the set of values in a page range in a way that
+ * answers "could this range contain value X?" with no false negatives and a
+ * configurable rate of false positives.  Unlike minmax, this does not depend
+ * on the values being correlated with the physical order of the table, so it
+ * is useful for equality searches on columns such as identifiers that are
+ * scattered randomly across the heap.  Only the equality operator can be
+ * supported, though.
+ *
+ * The filter is sized for a fixed fraction of the maximum number of tuples
+ * in a page range (BLOOM_NDISTINCT_FRACTION) and a fixed false positive rate
+ * (BLOOM_FALSE_POSITIVE_RATE), and capped at BLOOM_MAX_FILTER_SIZE bytes so
+ * that the index tuple still fits on a page.  Since the parameters depend
+ * only on pages_per_range, all filters of an index have the same size, which
+ * makes the union a simple bitwise OR.
+ *
+ * Values are hashed with the hash support function of the opclass (support
+ * procedure 11), and the k bit positions are derived from that hash by
+ * double hashing.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/brin/brin_bloom.c
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/brin.h"
+#include "access/brin_internal.h"
+#include "access/brin_tuple.h"
+#include "access/genam.h"
+#include "access/htup_details.h"
+#include "access/stratnum.h"
+#include "catalog/pg_type.h"
+#include "common/hashfn.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/rel.h"
+
+/* Support procedure returning the hash of a value */
+#define BLOOM_HASH_PROCNUM			11
+
+/* Sizing of the filters; see the file header comment */
+#define BLOOM_FALSE_POSITIVE_RATE	0.01
+#define BLOOM_NDISTINCT_FRACTION	0.1
+#define BLOOM_MIN_NDISTINCT			16
+#define BLOOM_MAX_FILTER_SIZE		(BLCKSZ / 2)
+
+/* Seeds for the two hash functions combined by double hashing */
+#define BLOOM_SEED_1	0x71d924af
+#define BLOOM_SEED_2	0xba48b314
+
+/*
+ * On-disk representation of a Bloom filter, stored as a bytea.
+ */
+typedef struct BloomFilter
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	uint16		nhashes;		/* number of hash functions */
+	uint32		nbits;			/* number of bits in the bitmap */
+	char		data[FLEXIBLE_ARRAY_MEMBER];	/* the bitmap */
+} BloomFilter;
+
+typedef struct BloomOpaque
+{
+	FmgrInfo	hashFn;
+} BloomOpaque;
+
+
+/*
+ * Create an empty Bloom filter sized for an index with the given number of
+ * pages per range.
+ */
+static BloomFilter *
+bloom_init(BlockNumber pagesPerRange)
+{
+	double		ndistinct;
+	double		nbits;
+	int			nbytes;
+	int			nhashes;
+	BloomFilter *filter;
+
+	ndistinct = BLOOM_NDISTINCT_FRACTION *
+		(double) pagesPerRange * MaxHeapTuplesPerPage;
+	ndistinct = Max(ndistinct, BLOOM_MIN_NDISTINCT);
+
+	/* optimal number of bits, and the matching number of hash functions */
+	nbits = ceil(-(ndistinct * log(BLOOM_FALSE_POSITIVE_RATE)) /
+				 pow(log(2.0), 2));
+	nbytes = (int) Min(ceil(nbits / 8), BLOOM_MAX_FILTER_SIZE);
+	nhashes = (int) rint((nbytes * 8) / ndistinct * log(2.0));
+	nhashes = Max(nhashes, 1);
+
+	filter = (BloomFilter *) palloc0(offsetof(BloomFilter, data) + nbytes);
+	SET_VARSIZE(filter, offsetof(BloomFilter, data) + nbytes);
+	filter->nhashes = nhashes;
+	filter->nbits = nbytes * 8;
+
+	return filter;
+}
+
+/*
+ * Add a value, given by its hash, to the filter.  Returns true if that set
+ * any bit that wasn't set yet.
+ */
+static bool
+bloom_add_value(BloomFilter *filter, uint32 value)
+{
+	uint64		h1,
+				h2;
+	bool		updated = false;
+	int			i;
+
+	h1 = hash_bytes_uint32_extended(value, BLOOM_SEED_1) % filter->nbits;
+	h2 = hash_bytes_uint32_extended(value, BLOOM_SEED_2) % filter->nbits;
+
+	for (i = 0; i < filter->nhashes; i++)
+	{
+		uint32		bit = (h1 + i * h2) % filter->nbits;
+		uint32		byte = bit / 8;
+
+		if (!(filter->data[byte] & (0x01 << (bit % 8))))
+		{
+			filter->data[byte] |= (0x01 << (bit % 8));
+			updated = true;
+		}
+	}
+
+	return updated;
+}
+
+/*
+ * Check whether the filter may contain a value, given by its hash.
+ */
+static bool
+bloom_contains_value(BloomFilter *filter, uint32 value)
+{
+	uint64		h1,
+				h2;
+	int			i;
+
+	h1 = hash_bytes_uint32_extended(value, BLOOM_SEED_1) % filter->nbits;
+	h2 = hash_bytes_uint32_extended(value, BLOOM_SEED_2) % filter->nbits;
+
+	for (i = 0; i < filter->nhashes; i++)
+	{
+		uint32		bit = (h1 + i * h2) % filter->nbits;
+		uint32		byte = bit / 8;
+
+		if (!(filter->data[byte] & (0x01 << (bit % 8))))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Return the hash support procedure of the given index column, caching it
+ * in the opaque struct.
+ */
+static FmgrInfo *
+bloom_get_hash_procinfo(BrinDesc *bdesc, uint16 attno)
+{
+	BloomOpaque *opaque;
+
+	opaque = (BloomOpaque *) bdesc->bd_info[attno - 1]->oi_opaque;
+
+	if (opaque->hashFn.fn_oid == InvalidOid)
+		fmgr_info_copy(&opaque->hashFn,
+					   index_getprocinfo(bdesc->bd_index, attno,
+										 BLOOM_HASH_PROCNUM),
+					   bdesc->bd_context);
+
+	return &opaque->hashFn;
+}
+
+Datum
+brin_bloom_opcinfo(PG_FUNCTION_ARGS)
+{
+	BrinOpcInfo *result;
+
+	/*
+	 * opaque->hashFn is initialized lazily; here it is set to uninitialized
+	 * by palloc0 which sets fn_oid to InvalidOid.
+	 *
+	 * The filter is stored as a single bytea, whatever the indexed type.
+	 */
+	result = palloc0(MAXALIGN(SizeofBrinOpcInfo(1)) +
+					 sizeof(BloomOpaque));
+	result->oi_nstored = 1;
+	result->oi_opaque = (BloomOpaque *)
+		MAXALIGN((char *) result + SizeofBrinOpcInfo(1));
+	result->oi_typcache[0] = lookup_type_cache(BYTEAOID, 0);
+
+	PG_RETURN_POINTER(result);
+}
+
+/*
+ * Examine the given index tuple (which contains partial status of a certain
+ * page range) by comparing it to the given value that comes from another heap
+ * tuple.  If the new value isn't represented in the range's Bloom filter yet,
+ * add it and return true.  Otherwise, return false and do not modify in this
+ * case.
+ */
+Datum
+brin_bloom_add_value(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	Datum		newval = PG_GETARG_DATUM(2);
+	bool		isnull = PG_GETARG_DATUM(3);
+	Oid			colloid = PG_GET_COLLATION();
+	FmgrInfo   *hashFn;
+	uint32		hashValue;
+	bool		updated = false;
+	BloomFilter *filter;
+
+	/*
+	 * If the new value is null, we record that we saw it if it's the first
+	 * one; otherwise, there's nothing to do.
+	 */
+	if (isnull)
+	{
+		if (column->bv_hasnulls)
+			PG_RETURN_BOOL(false);
+
+		column->bv_hasnulls = true;
+		PG_RETURN_BOOL(true);
+	}
+
+	/* If the recorded value is null, start with an empty filter */
+	if (column->bv_allnulls)
+	{
+		filter = bloom_init(BrinGetPagesPerRange(bdesc->bd_index));
+		column->bv_values[0] = PointerGetDatum(filter);
+		column->bv_allnulls = false;
+		updated = true;
+	}
+	else
+	{
+		/* the filter may have been compressed when stored in the index */
+		filter = (BloomFilter *) PG_DETOAST_DATUM(column->bv_values[0]);
+		column->bv_values[0] = PointerGetDatum(filter);
+	}
+
+	hashFn = bloom_get_hash_procinfo(bdesc, column->bv_attno);
+	hashValue = DatumGetUInt32(FunctionCall1Coll(hashFn, colloid, newval));
+
+	updated |= bloom_add_value(filter, hashValue);
+
+	PG_RETURN_BOOL(updated);
+}
+
+/*
+ * Given an index tuple corresponding to a certain page range and a scan key,
+ * return whether the scan key is consistent with the index tuple's Bloom
+ * filter.  Return true if so, false otherwise.
+ */
+Datum
+brin_bloom_consistent(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	ScanKey		key = (ScanKey) PG_GETARG_POINTER(2);
+	Oid			colloid = PG_GET_COLLATION();
+	FmgrInfo   *hashFn;
+	uint32		hashValue;
+	BloomFilter *filter;
+
+	Assert(key->sk_attno == column->bv_attno);
+
+	/* handle IS NULL/IS NOT NULL tests */
+	if (key->sk_flags & SK_ISNULL)
+	{
+		if (key->sk_flags & SK_SEARCHNULL)
+		{
+			if (column->bv_allnulls || column->bv_hasnulls)
+				PG_RETURN_BOOL(true);
+			PG_RETURN_BOOL(false);
+		}
+
+		/*
+		 * For IS NOT NULL, we can only skip ranges that are known to have
+		 * only nulls.
+		 */
+		if (key->sk_flags & SK_SEARCHNOTNULL)
+			PG_RETURN_BOOL(!column->bv_allnulls);
+
+		/*
+		 * Neither IS NULL nor IS NOT NULL was used; assume all indexable
+		 * operators are strict and return false.
+		 */
+		PG_RETURN_BOOL(false);
+	}
+
+	/* if the range is all empty, it cannot possibly be consistent */
+	if (column->bv_allnulls)
+		PG_RETURN_BOOL(false);
+
+	if (key->sk_strategy != HTEqualStrategyNumber)
+		elog(ERROR, "invalid strategy number %d", key->sk_strategy);
+
+	filter = (BloomFilter *) PG_DETOAST_DATUM(column->bv_values[0]);
+
+	hashFn = bloom_get_hash_procinfo(bdesc, key->sk_attno);
+	hashValue = DatumGetUInt32(FunctionCall1Coll(hashFn, colloid,
+												 key->sk_argument));
+
+	PG_RETURN_BOOL(bloom_contains_value(filter, hashValue));
+}
+
+/*
+ * Given two BrinValues, update the first of them as a union of the summary
+ * values contained in both.  The second one is untouched.
+ */
+Datum
+brin_bloom_union(PG_FUNCTION_ARGS)
+{
+	BrinValues *col_a = (BrinValues *) PG_GETARG_POINTER(1);
+	BrinValues *col_b = (BrinValues *) PG_GETARG_POINTER(2);
+	BloomFilter *filter_a;
+	BloomFilter *filter_b;
+	uint32		nbytes;
+	uint32		i;
+
+	Assert(col_a->bv_attno == col_b->bv_attno);
+
+	/* Adjust "hasnulls" */
+	if (!col_a->bv_hasnulls && col_b->bv_hasnulls)
+		col_a->bv_hasnulls = true;
+
+	/* If there are no values in B, there's nothing left to do */
+	if (col_b->bv_allnulls)
+		PG_RETURN_VOID();
+
+	filter_b = (BloomFilter *) PG_DETOAST_DATUM(col_b->bv_values[0]);
+
+	/*
+	 * Adjust "allnulls".  If A doesn't have values, just copy the filter from
+	 * B into A, and we're done.
+	 */
+	if (col_a->bv_allnulls)
+	{
+		col_a->bv_allnulls = false;
+		col_a->bv_values[0] = datumCopy(PointerGetDatum(filter_b), false, -1);
+		PG_RETURN_VOID();
+	}
+
+	filter_a = (BloomFilter *) PG_DETOAST_DATUM(col_a->bv_values[0]);
+	col_a->bv_values[0] = PointerGetDatum(filter_a);
+
+	/* all filters of an index are created with the same parameters */
+	if (filter_a->nbits != filter_b->nbits ||
+		filter_a->nhashes != filter_b->nhashes)
+		elog(ERROR, "cannot merge bloom filters with different parameters");
+
+	nbytes = filter_a->nbits / 8;
+	for (i = 0; i < nbytes; i++)
+		filter_a->data[i] |= filter_b->data[i];
+
+	PG_RETURN_VOID();
+}
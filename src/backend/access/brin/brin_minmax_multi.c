@@ -0,0 +1,655 @@
+/*
+ * brin_minmax_multi.c
+ *		Implementation of multi-range Min/Max opclass for BRIN
+ *
+ * Plain minmax summarizes a page range with a single [min, max] interval,
+ * which becomes useless as soon as a single outlier lands in the range.
+ * This opclass instead keeps a sorted list of up to MINMAX_MAX_RANGES
+ * disjoint intervals (a single value being an interval with min == max).
+ * When a new value does not fall into any of the existing intervals, it is
+ * added as a new one, and if that exceeds the limit the two neighboring
+ * intervals with the smallest gap between them are merged.  The gaps are
+ * measured with a type-specific distance function (support procedure 11).
+ *
+ * The summary is stored as a single bytea holding the interval boundaries.
+ * Only fixed-length types are supported.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/brin/brin_minmax_multi.c
+ */
+#include "postgres.h"
+
+#include "access/brin_internal.h"
+#include "access/brin_tuple.h"
+#include "access/genam.h"
+#include "access/stratnum.h"
+#include "access/tupmacs.h"
+#include "catalog/pg_amop.h"
+#include "catalog/pg_type.h"
+#include "utils/builtins.h"
+#include "utils/date.h"
+#include "utils/datum.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+#include "utils/syscache.h"
+#include "utils/timestamp.h"
+
+/* Support procedure returning the distance between two values */
+#define MINMAX_DISTANCE_PROCNUM		11
+
+/* Maximum number of intervals kept per page range */
+#define MINMAX_MAX_RANGES			16
+
+/*
+ * On-disk representation of the summary, stored as a bytea.  The data part
+ * holds 2 * nranges values of the indexed type, each occupying typlen bytes:
+ * the minimum and maximum of each interval, with the intervals sorted and
+ * not overlapping.
+ */
+typedef struct SerializedRanges
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	int32		nranges;		/* number of intervals */
+	char		data[FLEXIBLE_ARRAY_MEMBER];
+} SerializedRanges;
+
+/*
+ * In-memory representation of the summary.  values[] has room for one
+ * interval more than MINMAX_MAX_RANGES, so that a new value can be added
+ * before reducing the number of intervals again.
+ */
+typedef struct Ranges
+{
+	int			nranges;
+	Datum		values[2 * (MINMAX_MAX_RANGES + 1)];
+} Ranges;
+
+typedef struct MinmaxMultiOpaque
+{
+	FmgrInfo	distanceFn;
+	Oid			cached_subtype;
+	FmgrInfo	strategy_procinfos[BTMaxStrategyNumber];
+} MinmaxMultiOpaque;
+
+static FmgrInfo *minmax_multi_get_strategy_procinfo(BrinDesc *bdesc,
+													uint16 attno, Oid subtype,
+													uint16 strategynum);
+
+
+/*
+ * Expand a stored summary into a Ranges struct.  For pass-by-reference
+ * types, the values point into the summary.
+ */
+static void
+range_deserialize(SerializedRanges *serialized, Form_pg_attribute attr,
+				  Ranges *ranges)
+{
+	char	   *ptr = serialized->data;
+	int			i;
+
+	ranges->nranges = serialized->nranges;
+	for (i = 0; i < 2 * ranges->nranges; i++)
+	{
+		ranges->values[i] = fetch_att(ptr, attr->attbyval, attr->attlen);
+		ptr += attr->attlen;
+	}
+}
+
+/*
+ * Build the stored form of a Ranges struct.
+ */
+static SerializedRanges *
+range_serialize(Ranges *ranges, Form_pg_attribute attr)
+{
+	SerializedRanges *serialized;
+	Size		len;
+	char	   *ptr;
+	int			i;
+
+	len = offsetof(SerializedRanges, data) + 2 * ranges->nranges * attr->attlen;
+	serialized = (SerializedRanges *) palloc(len);
+	SET_VARSIZE(serialized, len);
+	serialized->nranges = ranges->nranges;
+
+	ptr = serialized->data;
+	for (i = 0; i < 2 * ranges->nranges; i++)
+	{
+		if (attr->attbyval)
+			store_att_byval(ptr, ranges->values[i], attr->attlen);
+		else
+			memcpy(ptr, DatumGetPointer(ranges->values[i]), attr->attlen);
+		ptr += attr->attlen;
+	}
+
+	return serialized;
+}
+
+/*
+ * Merge intervals until there are at most MINMAX_MAX_RANGES of them, each
+ * time merging the two neighbors with the smallest gap between them.
+ */
+static void
+range_reduce(BrinDesc *bdesc, uint16 attno, Oid colloid, Ranges *ranges)
+{
+	MinmaxMultiOpaque *opaque;
+
+	opaque = (MinmaxMultiOpaque *) bdesc->bd_info[attno - 1]->oi_opaque;
+
+	if (opaque->distanceFn.fn_oid == InvalidOid)
+		fmgr_info_copy(&opaque->distanceFn,
+					   index_getprocinfo(bdesc->bd_index, attno,
+										 MINMAX_DISTANCE_PROCNUM),
+					   bdesc->bd_context);
+
+	while (ranges->nranges > MINMAX_MAX_RANGES)
+	{
+		int			best = 0;
+		double		bestdist = 0;
+		int			i;
+
+		for (i = 0; i < ranges->nranges - 1; i++)
+		{
+			double		dist;
+
+			/* gap between the max of interval i and the min of i + 1 */
+			dist = DatumGetFloat8(FunctionCall2Coll(&opaque->distanceFn,
+													colloid,
+													ranges->values[2 * i + 1],
+													ranges->values[2 * i + 2]));
+			if (i == 0 || dist < bestdist)
+			{
+				best = i;
+				bestdist = dist;
+			}
+		}
+
+		/* interval 'best' absorbs the next one */
+		ranges->values[2 * best + 1] = ranges->values[2 * best + 3];
+		memmove(&ranges->values[2 * best + 2], &ranges->values[2 * best + 4],
+				sizeof(Datum) * 2 * (ranges->nranges - best - 2));
+		ranges->nranges--;
+	}
+}
+
+/*
+ * Add a value to the Ranges.  Returns false if it's already covered by one
+ * of the intervals, in which case nothing changes.
+ */
+static bool
+range_add_value(BrinDesc *bdesc, uint16 attno, Oid colloid, Ranges *ranges,
+				Datum newval)
+{
+	Form_pg_attribute attr = TupleDescAttr(bdesc->bd_tupdesc, attno - 1);
+	FmgrInfo   *ltFn;
+	FmgrInfo   *gtFn;
+	int			i;
+
+	ltFn = minmax_multi_get_strategy_procinfo(bdesc, attno, attr->atttypid,
+											  BTLessStrategyNumber);
+	gtFn = minmax_multi_get_strategy_procinfo(bdesc, attno, attr->atttypid,
+											  BTGreaterStrategyNumber);
+
+	/* find the first interval whose maximum is not less than the value */
+	for (i = 0; i < ranges->nranges; i++)
+	{
+		if (!DatumGetBool(FunctionCall2Coll(gtFn, colloid, newval,
+											ranges->values[2 * i + 1])))
+			break;
+	}
+
+	/* covered by that interval? */
+	if (i < ranges->nranges &&
+		!DatumGetBool(FunctionCall2Coll(ltFn, colloid, newval,
+										ranges->values[2 * i])))
+		return false;
+
+	/* no, insert it as a new single-value interval before it */
+	memmove(&ranges->values[2 * i + 2], &ranges->values[2 * i],
+			sizeof(Datum) * 2 * (ranges->nranges - i));
+	ranges->values[2 * i] = ranges->values[2 * i + 1] = newval;
+	ranges->nranges++;
+
+	range_reduce(bdesc, attno, colloid, ranges);
+
+	return true;
+}
+
+Datum
+brin_minmax_multi_opcinfo(PG_FUNCTION_ARGS)
+{
+	Oid			typoid = PG_GETARG_OID(0);
+	BrinOpcInfo *result;
+
+	if (get_typlen(typoid) <= 0)
+		elog(ERROR, "minmax-multi opclasses support only fixed-length types");
+
+	/*
+	 * opaque->distanceFn and opaque->strategy_procinfos are initialized
+	 * lazily; here they are set to all-uninitialized by palloc0 which sets
+	 * fn_oid to InvalidOid.
+	 *
+	 * The intervals are stored as a single bytea, whatever the indexed type.
+	 */
+	result = palloc0(MAXALIGN(SizeofBrinOpcInfo(1)) +
+					 sizeof(MinmaxMultiOpaque));
+	result->oi_nstored = 1;
+	result->oi_opaque = (MinmaxMultiOpaque *)
+		MAXALIGN((char *) result + SizeofBrinOpcInfo(1));
+	result->oi_typcache[0] = lookup_type_cache(BYTEAOID, 0);
+
+	PG_RETURN_POINTER(result);
+}
+
+/*
+ * Examine the given index tuple (which contains partial status of a certain
+ * page range) by comparing it to the given value that comes from another heap
+ * tuple.  If the new value is not covered by any of the intervals, add it,
+ * update the index tuple and return true.  Otherwise, return false and do not
+ * modify in this case.
+ */
+Datum
+brin_minmax_multi_add_value(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	Datum		newval = PG_GETARG_DATUM(2);
+	bool		isnull = PG_GETARG_DATUM(3);
+	Oid			colloid = PG_GET_COLLATION();
+	Form_pg_attribute attr;
+	AttrNumber	attno;
+	Ranges		ranges;
+
+	/*
+	 * If the new value is null, we record that we saw it if it's the first
+	 * one; otherwise, there's nothing to do.
+	 */
+	if (isnull)
+	{
+		if (column->bv_hasnulls)
+			PG_RETURN_BOOL(false);
+
+		column->bv_hasnulls = true;
+		PG_RETURN_BOOL(true);
+	}
+
+	attno = column->bv_attno;
+	attr = TupleDescAttr(bdesc->bd_tupdesc, attno - 1);
+
+	/*
+	 * If the recorded value is null, store the new value as a single
+	 * interval, and we're done.
+	 */
+	if (column->bv_allnulls)
+	{
+		ranges.nranges = 1;
+		ranges.values[0] = ranges.values[1] = newval;
+		column->bv_values[0] = PointerGetDatum(range_serialize(&ranges, attr));
+		column->bv_allnulls = false;
+		PG_RETURN_BOOL(true);
+	}
+
+	range_deserialize((SerializedRanges *) PG_DETOAST_DATUM(column->bv_values[0]),
+					  attr, &ranges);
+
+	if (!range_add_value(bdesc, attno, colloid, &ranges, newval))
+		PG_RETURN_BOOL(false);
+
+	column->bv_values[0] = PointerGetDatum(range_serialize(&ranges, attr));
+
+	PG_RETURN_BOOL(true);
+}
+
+/*
+ * Given an index tuple corresponding to a certain page range and a scan key,
+ * return whether the scan key is consistent with the index tuple's intervals.
+ * Return true if so, false otherwise.
+ */
+Datum
+brin_minmax_multi_consistent(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *column = (BrinValues *) PG_GETARG_POINTER(1);
+	ScanKey		key = (ScanKey) PG_GETARG_POINTER(2);
+	Oid			colloid = PG_GET_COLLATION(),
+				subtype;
+	AttrNumber	attno;
+	Datum		value;
+	Datum		matches;
+	FmgrInfo   *finfo;
+	Form_pg_attribute attr;
+	Ranges		ranges;
+	int			i;
+
+	Assert(key->sk_attno == column->bv_attno);
+
+	/* handle IS NULL/IS NOT NULL tests */
+	if (key->sk_flags & SK_ISNULL)
+	{
+		if (key->sk_flags & SK_SEARCHNULL)
+		{
+			if (column->bv_allnulls || column->bv_hasnulls)
+				PG_RETURN_BOOL(true);
+			PG_RETURN_BOOL(false);
+		}
+
+		/*
+		 * For IS NOT NULL, we can only skip ranges that are known to have
+		 * only nulls.
+		 */
+		if (key->sk_flags & SK_SEARCHNOTNULL)
+			PG_RETURN_BOOL(!column->bv_allnulls);
+
+		/*
+		 * Neither IS NULL nor IS NOT NULL was used; assume all indexable
+		 * operators are strict and return false.
+		 */
+		PG_RETURN_BOOL(false);
+	}
+
+	/* if the range is all empty, it cannot possibly be consistent */
+	if (column->bv_allnulls)
+		PG_RETURN_BOOL(false);
+
+	attno = key->sk_attno;
+	subtype = key->sk_subtype;
+	value = key->sk_argument;
+	attr = TupleDescAttr(bdesc->bd_tupdesc, attno - 1);
+
+	range_deserialize((SerializedRanges *) PG_DETOAST_DATUM(column->bv_values[0]),
+					  attr, &ranges);
+
+	switch (key->sk_strategy)
+	{
+		case BTLessStrategyNumber:
+		case BTLessEqualStrategyNumber:
+			/* compare to the overall minimum */
+			finfo = minmax_multi_get_strategy_procinfo(bdesc, attno, subtype,
+													   key->sk_strategy);
+			matches = FunctionCall2Coll(finfo, colloid, ranges.values[0],
+										value);
+			break;
+		case BTEqualStrategyNumber:
+
+			/*
+			 * In the equality case (WHERE col = someval), we want to return
+			 * the current page range if any of the intervals contains the
+			 * scan key.
+			 */
+			matches = BoolGetDatum(false);
+			for (i = 0; i < ranges.nranges; i++)
+			{
+				finfo = minmax_multi_get_strategy_procinfo(bdesc, attno, subtype,
+														   BTLessEqualStrategyNumber);
+				if (!DatumGetBool(FunctionCall2Coll(finfo, colloid,
+													ranges.values[2 * i],
+													value)))
+					break;		/* this and all later intervals are above */
+
+				finfo = minmax_multi_get_strategy_procinfo(bdesc, attno, subtype,
+														   BTGreaterEqualStrategyNumber);
+				matches = FunctionCall2Coll(finfo, colloid,
+											ranges.values[2 * i + 1], value);
+				if (DatumGetBool(matches))
+					break;
+			}
+			break;
+		case BTGreaterEqualStrategyNumber:
+		case BTGreaterStrategyNumber:
+			/* compare to the overall maximum */
+			finfo = minmax_multi_get_strategy_procinfo(bdesc, attno, subtype,
+													   key->sk_strategy);
+			matches = FunctionCall2Coll(finfo, colloid,
+										ranges.values[2 * ranges.nranges - 1],
+										value);
+			break;
+		default:
+			/* shouldn't happen */
+			elog(ERROR, "invalid strategy number %d", key->sk_strategy);
+			matches = 0;
+			break;
+	}
+
+	PG_RETURN_DATUM(matches);
+}
+
+/*
+ * Given two BrinValues, update the first of them as a union of the summary
+ * values contained in both.  The second one is untouched.
+ */
+Datum
+brin_minmax_multi_union(PG_FUNCTION_ARGS)
+{
+	BrinDesc   *bdesc = (BrinDesc *) PG_GETARG_POINTER(0);
+	BrinValues *col_a = (BrinValues *) PG_GETARG_POINTER(1);
+	BrinValues *col_b = (BrinValues *) PG_GETARG_POINTER(2);
+	Oid			colloid = PG_GET_COLLATION();
+	AttrNumber	attno;
+	Form_pg_attribute attr;
+	FmgrInfo   *ltFn;
+	FmgrInfo   *gtFn;
+	Ranges		ranges_a;
+	Ranges		ranges_b;
+	Ranges		merged;
+	int			ia = 0,
+				ib = 0;
+
+	Assert(col_a->bv_attno == col_b->bv_attno);
+
+	/* Adjust "hasnulls" */
+	if (!col_a->bv_hasnulls && col_b->bv_hasnulls)
+		col_a->bv_hasnulls = true;
+
+	/* If there are no values in B, there's nothing left to do */
+	if (col_b->bv_allnulls)
+		PG_RETURN_VOID();
+
+	/*
+	 * Adjust "allnulls".  If A doesn't have values, just copy the values from
+	 * B into A, and we're done.
+	 */
+	if (col_a->bv_allnulls)
+	{
+		col_a->bv_allnulls = false;
+		col_a->bv_values[0] = datumCopy(PointerGetDatum(PG_DETOAST_DATUM(col_b->bv_values[0])),
+										false, -1);
+		PG_RETURN_VOID();
+	}
+
+	attno = col_a->bv_attno;
+	attr = TupleDescAttr(bdesc->bd_tupdesc, attno - 1);
+
+	range_deserialize((SerializedRanges *) PG_DETOAST_DATUM(col_a->bv_values[0]),
+					  attr, &ranges_a);
+	range_deserialize((SerializedRanges *) PG_DETOAST_DATUM(col_b->bv_values[0]),
+					  attr, &ranges_b);
+
+	ltFn = minmax_multi_get_strategy_procinfo(bdesc, attno, attr->atttypid,
+											  BTLessStrategyNumber);
+	gtFn = minmax_multi_get_strategy_procinfo(bdesc, attno, attr->atttypid,
+											  BTGreaterStrategyNumber);
+
+	/*
+	 * Merge the two sorted lists of intervals, coalescing overlapping ones,
+	 * and reducing the result back to the limit as we go.
+	 */
+	merged.nranges = 0;
+	while (ia < ranges_a.nranges || ib < ranges_b.nranges)
+	{
+		Datum		lo,
+					hi;
+
+		/* take the interval with the smaller minimum next */
+		if (ib >= ranges_b.nranges ||
+			(ia < ranges_a.nranges &&
+			 !DatumGetBool(FunctionCall2Coll(ltFn, colloid,
+											 ranges_b.values[2 * ib],
+											 ranges_a.values[2 * ia]))))
+		{
+			lo = ranges_a.values[2 * ia];
+			hi = ranges_a.values[2 * ia + 1];
+			ia++;
+		}
+		else
+		{
+			lo = ranges_b.values[2 * ib];
+			hi = ranges_b.values[2 * ib + 1];
+			ib++;
+		}
+
+		if (merged.nranges > 0 &&
+			!DatumGetBool(FunctionCall2Coll(gtFn, colloid, lo,
+											merged.values[2 * merged.nranges - 1])))
+		{
+			/* overlaps the previous interval, so extend that one */
+			if (DatumGetBool(FunctionCall2Coll(gtFn, colloid, hi,
+											   merged.values[2 * merged.nranges - 1])))
+				merged.values[2 * merged.nranges - 1] = hi;
+		}
+		else
+		{
+			merged.values[2 * merged.nranges] = lo;
+			merged.values[2 * merged.nranges + 1] = hi;
+			merged.nranges++;
+			range_reduce(bdesc, attno, colloid, &merged);
+		}
+	}
+
+	col_a->bv_values[0] = PointerGetDatum(range_serialize(&merged, attr));
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Cache and return the procedure for the given strategy.
+ *
+ * Note: this function mirrors minmax_get_strategy_procinfo; see notes
+ * there.  If changes are made here, see that function too.
+ */
+static FmgrInfo *
+minmax_multi_get_strategy_procinfo(BrinDesc *bdesc, uint16 attno, Oid subtype,
+								   uint16 strategynum)
+{
+	MinmaxMultiOpaque *opaque;
+
+	Assert(strategynum >= 1 &&
+		   strategynum <= BTMaxStrategyNumber);
+
+	opaque = (MinmaxMultiOpaque *) bdesc->bd_info[attno - 1]->oi_opaque;
+
+	/*
+	 * We cache the procedures for the previous subtype in the opaque struct,
+	 * to avoid repetitive syscache lookups.  If the subtype changed,
+	 * invalidate all the cached entries.
+	 */
+	if (opaque->cached_subtype != subtype)
+	{
+		uint16		i;
+
+		for (i = 1; i <= BTMaxStrategyNumber; i++)
+			opaque->strategy_procinfos[i - 1].fn_oid = InvalidOid;
+		opaque->cached_subtype = subtype;
+	}
+
+	if (opaque->strategy_procinfos[strategynum - 1].fn_oid == InvalidOid)
+	{
+		Form_pg_attribute attr;
+		HeapTuple	tuple;
+		Oid			opfamily,
+					oprid;
+		bool		isNull;
+
+		opfamily = bdesc->bd_index->rd_opfamily[attno - 1];
+		attr = TupleDescAttr(bdesc->bd_tupdesc, attno - 1);
+		tuple = SearchSysCache4(AMOPSTRATEGY, ObjectIdGetDatum(opfamily),
+								ObjectIdGetDatum(attr->atttypid),
+								ObjectIdGetDatum(subtype),
+								Int16GetDatum(strategynum));
+
+		if (!HeapTupleIsValid(tuple))
+			elog(ERROR, "missing operator %d(%u,%u) in opfamily %u",
+				 strategynum, attr->atttypid, subtype, opfamily);
+
+		oprid = DatumGetObjectId(SysCacheGetAttr(AMOPSTRATEGY, tuple,
+												 Anum_pg_amop_amopopr, &isNull));
+		ReleaseSysCache(tuple);
+		Assert(!isNull && RegProcedureIsValid(oprid));
+
+		fmgr_info_cxt(get_opcode(oprid),
+					  &opaque->strategy_procinfos[strategynum - 1],
+					  bdesc->bd_context);
+	}
+
+	return &opaque->strategy_procinfos[strategynum - 1];
+}
+
+/*
+ * Distance functions, used to decide which intervals to merge.  They're
+ * called with the maximum of one interval and the minimum of the next, so
+ * the first argument is never greater than the second.
+ */
+Datum
+brin_minmax_multi_distance_int2(PG_FUNCTION_ARGS)
+{
+	int16		a = PG_GETARG_INT16(0);
+	int16		b = PG_GETARG_INT16(1);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+Datum
+brin_minmax_multi_distance_int4(PG_FUNCTION_ARGS)
+{
+	int32		a = PG_GETARG_INT32(0);
+	int32		b = PG_GETARG_INT32(1);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+Datum
+brin_minmax_multi_distance_int8(PG_FUNCTION_ARGS)
+{
+	int64		a = PG_GETARG_INT64(0);
+	int64		b = PG_GETARG_INT64(1);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+Datum
+brin_minmax_multi_distance_float4(PG_FUNCTION_ARGS)
+{
+	float4		a = PG_GETARG_FLOAT4(0);
+	float4		b = PG_GETARG_FLOAT4(1);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+Datum
+brin_minmax_multi_distance_float8(PG_FUNCTION_ARGS)
+{
+	float8		a = PG_GETARG_FLOAT8(0);
+	float8		b = PG_GETARG_FLOAT8(1);
+
+	PG_RETURN_FLOAT8(b - a);
+}
+
+Datum
+brin_minmax_multi_distance_date(PG_FUNCTION_ARGS)
+{
+	DateADT		a = PG_GETARG_DATEADT(0);
+	DateADT		b = PG_GETARG_DATEADT(1);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
+
+/* This serves timestamptz as well; both are int64 microseconds. */
+Datum
+brin_minmax_multi_distance_timestamp(PG_FUNCTION_ARGS)
+{
+	Timestamp	a = PG_GETARG_TIMESTAMP(0);
+	Timestamp	b = PG_GETARG_TIMESTAMP(1);
+
+	PG_RETURN_FLOAT8((double) b - (double) a);
+}
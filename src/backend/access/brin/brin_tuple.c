@@ -213,7 +213,8 @@ brin_form_tuple(BrinDesc *brdesc, BlockNumber blkno, BrinMemTuple *tuple,
 				(atttype->typstorage == TYPSTORAGE_EXTENDED ||
 				 atttype->typstorage == TYPSTORAGE_MAIN))
 			{
-				Datum		cvalue = toast_compress_datum(value);
+				Datum		cvalue = toast_compress_datum(value,
+														  InvalidCompressionMethod);
 
 				if (DatumGetPointer(cvalue) != NULL)
 				{
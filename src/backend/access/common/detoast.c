@@ -16,6 +16,7 @@
 #include "access/detoast.h"
 #include "access/table.h"
 #include "access/tableam.h"
+#include "access/toast_compression.h"
 #include "access/toast_internals.h"
 #include "common/pg_lzcompress.h"
 #include "utils/expandeddatum.h"
@@ -28,6 +29,39 @@ static struct varlena *toast_fetch_datum_slice(struct varlena *attr,
 static struct varlena *toast_decompress_datum(struct varlena *attr);
 static struct varlena *toast_decompress_datum_slice(struct varlena *attr, int32 slicelength);
 
+/*
+ * State of an incremental detoast; see detoast_iterator_begin().
+ */
+typedef enum DetoastIteratorKind
+{
+	DETOAST_ITER_PLAIN,			/* not toasted, all data available */
+	DETOAST_ITER_EXTERNAL,		/* external, not compressed */
+	DETOAST_ITER_PGLZ,			/* pglz-compressed, maybe external */
+	DETOAST_ITER_WHOLE			/* anything else; detoasted all at once */
+} DetoastIteratorKind;
+
+typedef struct DetoastIteratorData
+{
+	DetoastIteratorKind kind;
+	struct varlena *attr;		/* datum being detoasted */
+	int32		rawsize;		/* size of the detoasted data */
+	char	   *data;			/* detoasted data, or NULL if none yet */
+	int32		avail;			/* bytes of data available so far */
+	struct varlena *result;		/* palloc'd buffer holding data, if any */
+
+	/* For external datums, the stored data is fetched from the front */
+	struct varatt_external toast_pointer;
+	struct varlena *stored;		/* buffer for all of the stored data */
+	int32		fetched;		/* bytes of it (after header) fetched */
+
+	/* For pglz-compressed datums */
+	struct varlena *compressed; /* the datum itself, or stored */
+	PGLZ_DecompressState pglz;
+} DetoastIteratorData;
+
+static void detoast_iterator_fetch_stored(DetoastIterator iter, int32 want);
+static void detoast_iterator_decompress(DetoastIterator iter, int32 length);
+
 /* ----------
  * detoast_external_attr -
  *
@@ -225,14 +259,21 @@ detoast_attr_slice(struct varlena *attr,
 		 */
 		if (slicelength > 0 && sliceoffset >= 0)
 		{
-			int32		max_size;
+			int32		max_size = VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer);
 
 			/*
 			 * Determine maximum amount of compressed data needed for a prefix
 			 * of a given length (after decompression).
+			 *
+			 * At least for now, if it's LZ4 or zstd data, we'll have to fetch
+			 * the whole thing, because there doesn't seem to be an API call
+			 * to determine how much compressed data we need to be sure of
+			 * being able to decompress the required slice.
 			 */
-			max_size = pglz_maximum_compressed_size(sliceoffset + slicelength,
-													toast_pointer.va_extsize);
+			if (VARATT_EXTERNAL_GET_COMPRESS_METHOD(toast_pointer) ==
+				TOAST_PGLZ_COMPRESSION_ID)
+				max_size = pglz_maximum_compressed_size(sliceoffset + slicelength,
+														max_size);
 
 			/*
 			 * Fetch enough compressed slices (compressed marker will get set
@@ -312,6 +353,217 @@ detoast_attr_slice(struct varlena *attr,
 	return result;
 }
 
+/* ----------
+ * detoast_iterator_begin -
+ *
+ *	Start detoasting attr incrementally.  Nothing is fetched or
+ *	decompressed until detoast_iterator_fetch() asks for it.
+ *
+ *	Uncompressed external values are fetched only as far as needed, and
+ *	pglz-compressed values, inline or external, are fetched and decompressed
+ *	only as far as needed, resuming where the previous fetch stopped.  Other
+ *	compression methods can't resume a decompression, so such values are
+ *	detoasted in full on the first fetch, as are indirect and expanded
+ *	values.
+ * ----------
+ */
+DetoastIterator
+detoast_iterator_begin(struct varlena *attr)
+{
+	DetoastIterator iter = palloc0(sizeof(DetoastIteratorData));
+
+	iter->attr = attr;
+
+	if (VARATT_IS_EXTERNAL_ONDISK(attr))
+	{
+		int32		extsize;
+
+		/* Must copy to access aligned fields */
+		VARATT_EXTERNAL_GET_POINTER(iter->toast_pointer, attr);
+		iter->rawsize = iter->toast_pointer.va_rawsize - VARHDRSZ;
+		extsize = VARATT_EXTERNAL_GET_EXTSIZE(iter->toast_pointer);
+
+		if (!VARATT_EXTERNAL_IS_COMPRESSED(iter->toast_pointer))
+		{
+			iter->kind = DETOAST_ITER_EXTERNAL;
+			iter->stored = (struct varlena *) palloc(extsize + VARHDRSZ);
+			SET_VARSIZE(iter->stored, extsize + VARHDRSZ);
+			iter->data = VARDATA(iter->stored);
+		}
+		else if (VARATT_EXTERNAL_GET_COMPRESS_METHOD(iter->toast_pointer) ==
+				 TOAST_PGLZ_COMPRESSION_ID)
+		{
+			iter->kind = DETOAST_ITER_PGLZ;
+			iter->stored = (struct varlena *) palloc(extsize + VARHDRSZ);
+			SET_VARSIZE_COMPRESSED(iter->stored, extsize + VARHDRSZ);
+			iter->compressed = iter->stored;
+		}
+		else
+			iter->kind = DETOAST_ITER_WHOLE;
+	}
+	else if (VARATT_IS_EXTERNAL(attr))
+	{
+		iter->kind = DETOAST_ITER_WHOLE;
+		iter->rawsize = toast_raw_datum_size(PointerGetDatum(attr)) - VARHDRSZ;
+	}
+	else if (VARATT_IS_COMPRESSED(attr))
+	{
+		iter->rawsize = TOAST_COMPRESS_EXTSIZE(attr);
+		if (TOAST_COMPRESS_METHOD(attr) == TOAST_PGLZ_COMPRESSION_ID)
+		{
+			iter->kind = DETOAST_ITER_PGLZ;
+			iter->compressed = attr;
+			iter->fetched = VARSIZE(attr) - VARHDRSZ;
+		}
+		else
+			iter->kind = DETOAST_ITER_WHOLE;
+	}
+	else
+	{
+		iter->kind = DETOAST_ITER_PLAIN;
+		iter->data = VARDATA_ANY(attr);
+		iter->rawsize = iter->avail = VARSIZE_ANY_EXHDR(attr);
+	}
+
+	return iter;
+}
+
+/* ----------
+ * detoast_iterator_fetch -
+ *
+ *	Make at least the first length bytes of the detoasted data available,
+ *	or all of it if there is less.  Returns a pointer to the start of the
+ *	data, and sets *avail to the number of bytes available, which may be
+ *	more than requested.  The pointer stays valid until
+ *	detoast_iterator_end(), and earlier bytes don't change.
+ * ----------
+ */
+char *
+detoast_iterator_fetch(DetoastIterator iter, int32 length, int32 *avail)
+{
+	length = Min(length, iter->rawsize);
+
+	if (iter->avail < length)
+	{
+		switch (iter->kind)
+		{
+			case DETOAST_ITER_PLAIN:
+				Assert(false);
+				break;
+			case DETOAST_ITER_EXTERNAL:
+				detoast_iterator_fetch_stored(iter, length);
+				iter->avail = iter->fetched;
+				break;
+			case DETOAST_ITER_PGLZ:
+				detoast_iterator_decompress(iter, length);
+				break;
+			case DETOAST_ITER_WHOLE:
+				iter->result = detoast_attr(iter->attr);
+				iter->data = VARDATA_ANY(iter->result);
+				iter->avail = iter->rawsize;
+				break;
+		}
+	}
+
+	*avail = iter->avail;
+	return iter->data;
+}
+
+/* ----------
+ * detoast_iterator_end -
+ *
+ *	Release the iterator and the buffers it allocated.
+ * ----------
+ */
+void
+detoast_iterator_end(DetoastIterator iter)
+{
+	if (iter->stored)
+		pfree(iter->stored);
+	if (iter->result && iter->result != iter->attr)
+		pfree(iter->result);
+	pfree(iter);
+}
+
+/*
+ * Fetch at least the first want bytes of an external datum's stored data.
+ *
+ * To keep the number of toast relation scans logarithmic in the size of
+ * the value when a caller keeps asking for a little more, at least double
+ * what we have so far.
+ */
+static void
+detoast_iterator_fetch_stored(DetoastIterator iter, int32 want)
+{
+	int32		extsize = VARATT_EXTERNAL_GET_EXTSIZE(iter->toast_pointer);
+	int32		length;
+	struct varlena *slice;
+	Relation	toastrel;
+
+	want = Max(want, (int32) Min((int64) 2 * iter->fetched, extsize));
+	want = Min(want, extsize);
+	if (want <= iter->fetched)
+		return;
+	length = want - iter->fetched;
+
+	slice = (struct varlena *) palloc(length + VARHDRSZ);
+	SET_VARSIZE(slice, length + VARHDRSZ);
+
+	toastrel = table_open(iter->toast_pointer.va_toastrelid, AccessShareLock);
+	table_relation_fetch_toast_slice(toastrel, iter->toast_pointer.va_valueid,
+									 extsize, iter->fetched, length, slice);
+	table_close(toastrel, AccessShareLock);
+
+	memcpy(VARDATA(iter->stored) + iter->fetched, VARDATA(slice), length);
+	pfree(slice);
+	iter->fetched = want;
+}
+
+/*
+ * Decompress at least the first length bytes of a pglz-compressed datum,
+ * fetching more of the compressed data as needed.
+ */
+static void
+detoast_iterator_decompress(DetoastIterator iter, int32 length)
+{
+	/* fetched counts the tcinfo word too */
+	const int32 hdrsize = TOAST_COMPRESS_HDRSZ - VARHDRSZ;
+	int32		storedsize = VARSIZE(iter->compressed) - VARHDRSZ;
+
+	if (iter->result == NULL)
+	{
+		iter->result = (struct varlena *) palloc(iter->rawsize + VARHDRSZ);
+		SET_VARSIZE(iter->result, iter->rawsize + VARHDRSZ);
+		iter->data = VARDATA(iter->result);
+	}
+
+	for (;;)
+	{
+		bool		complete = (iter->fetched == storedsize);
+
+		if (iter->fetched > hdrsize)
+		{
+			int32		avail;
+
+			avail = pglz_decompress_resume(TOAST_COMPRESS_RAWDATA(iter->compressed),
+										   iter->fetched - hdrsize, complete,
+										   iter->data, iter->rawsize, length,
+										   &iter->pglz);
+			if (avail < 0 || (avail < length && complete))
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg_internal("compressed pglz data is corrupt")));
+			iter->avail = avail;
+			if (avail >= length)
+				break;
+		}
+
+		detoast_iterator_fetch_stored(iter, hdrsize +
+									  pglz_maximum_compressed_size(length,
+																   storedsize - hdrsize));
+	}
+}
+
 /* ----------
  * toast_fetch_datum -
  *
@@ -333,7 +585,7 @@ toast_fetch_datum(struct varlena *attr)
 	/* Must copy to access aligned fields */
 	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
 
-	attrsize = toast_pointer.va_extsize;
+	attrsize = VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer);
 
 	result = (struct varlena *) palloc(attrsize + VARHDRSZ);
 
@@ -394,7 +646,7 @@ toast_fetch_datum_slice(struct varlena *attr, int32 sliceoffset,
 	 */
 	Assert(!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer) || 0 == sliceoffset);
 
-	attrsize = toast_pointer.va_extsize;
+	attrsize = VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer);
 
 	if (sliceoffset >= attrsize)
 	{
@@ -404,8 +656,8 @@ toast_fetch_datum_slice(struct varlena *attr, int32 sliceoffset,
 
 	/*
 	 * When fetching a prefix of a compressed external datum, account for the
-	 * rawsize tracking amount of raw data, which is stored at the beginning
-	 * as an int32 value).
+	 * tcinfo tracking amount of raw data and compression method, which is
+	 * stored at the beginning as an int32 value).
 	 */
 	if (VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer) && slicelength > 0)
 		slicelength = slicelength + sizeof(int32);
@@ -445,21 +697,27 @@ toast_fetch_datum_slice(struct varlena *attr, int32 sliceoffset,
 static struct varlena *
 toast_decompress_datum(struct varlena *attr)
 {
-	struct varlena *result;
+	ToastCompressionId cmid;
 
 	Assert(VARATT_IS_COMPRESSED(attr));
 
-	result = (struct varlena *)
-		palloc(TOAST_COMPRESS_RAWSIZE(attr) + VARHDRSZ);
-	SET_VARSIZE(result, TOAST_COMPRESS_RAWSIZE(attr) + VARHDRSZ);
-
-	if (pglz_decompress(TOAST_COMPRESS_RAWDATA(attr),
-						TOAST_COMPRESS_SIZE(attr),
-						VARDATA(result),
-						TOAST_COMPRESS_RAWSIZE(attr), true) < 0)
-		elog(ERROR, "compressed data is corrupted");
-
-	return result;
+	/*
+	 * Fetch the compression method id stored in the compression header and
+	 * decompress the data using the appropriate decompression routine.
+	 */
+	cmid = TOAST_COMPRESS_METHOD(attr);
+	switch (cmid)
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
+			return pglz_decompress_datum(attr);
+		case TOAST_LZ4_COMPRESSION_ID:
+			return lz4_decompress_datum(attr);
+		case TOAST_ZSTD_COMPRESSION_ID:
+			return zstd_decompress_datum(attr);
+		default:
+			elog(ERROR, "invalid compression method id %d", cmid);
+			return NULL;		/* keep compiler quiet */
+	}
 }
 
 
@@ -473,22 +731,32 @@ toast_decompress_datum(struct varlena *attr)
 static struct varlena *
 toast_decompress_datum_slice(struct varlena *attr, int32 slicelength)
 {
-	struct varlena *result;
-	int32		rawsize;
+	ToastCompressionId cmid;
 
 	Assert(VARATT_IS_COMPRESSED(attr));
 
-	result = (struct varlena *) palloc(slicelength + VARHDRSZ);
-
-	rawsize = pglz_decompress(TOAST_COMPRESS_RAWDATA(attr),
-							  VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
-							  VARDATA(result),
-							  slicelength, false);
-	if (rawsize < 0)
-		elog(ERROR, "compressed data is corrupted");
+	/*
+	 * Some callers may pass a slicelength that's more than the actual
+	 * decompressed size.  If so, just decompress normally.  This avoids
+	 * possibly allocating a larger-than-necessary result object, and may be
+	 * faster and/or more robust as well.
+	 */
+	if (slicelength >= TOAST_COMPRESS_EXTSIZE(attr))
+		return toast_decompress_datum(attr);
 
-	SET_VARSIZE(result, rawsize + VARHDRSZ);
-	return result;
+	cmid = TOAST_COMPRESS_METHOD(attr);
+	switch (cmid)
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
+			return pglz_decompress_datum_slice(attr, slicelength);
+		case TOAST_LZ4_COMPRESSION_ID:
+			return lz4_decompress_datum_slice(attr, slicelength);
+		case TOAST_ZSTD_COMPRESSION_ID:
+			return zstd_decompress_datum_slice(attr, slicelength);
+		default:
+			elog(ERROR, "invalid compression method id %d", cmid);
+			return NULL;		/* keep compiler quiet */
+	}
 }
 
 /* ----------
@@ -530,7 +798,7 @@ toast_raw_datum_size(Datum value)
 	else if (VARATT_IS_COMPRESSED(attr))
 	{
 		/* here, va_rawsize is just the payload size */
-		result = VARRAWSIZE_4B_C(attr) + VARHDRSZ;
+		result = VARDATA_COMPRESSED_GET_EXTSIZE(attr) + VARHDRSZ;
 	}
 	else if (VARATT_IS_SHORT(attr))
 	{
@@ -570,7 +838,7 @@ toast_datum_size(Datum value)
 		struct varatt_external toast_pointer;
 
 		VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
-		result = toast_pointer.va_extsize;
+		result = VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer);
 	}
 	else if (VARATT_IS_EXTERNAL_INDIRECT(attr))
 	{
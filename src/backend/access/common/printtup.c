@@ -19,6 +19,8 @@
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
 #include "tcop/pquery.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memdebug.h"
 #include "utils/memutils.h"
@@ -42,19 +44,45 @@ static void SendRowDescriptionCols_3(StringInfo buf, TupleDesc typeinfo,
  * ----------------------------------------------------------------
  */
 
+/*
+ * DataRow messages are collected in a buffer and handed to pq_putmessages()
+ * once it holds this much, or at the end of the run.  Besides saving the
+ * per-message overhead of pq_putmessage(), batches this large are written to
+ * the socket directly rather than being copied through the send buffer.
+ */
+#define PRINTTUP_BATCH_SIZE		(64 * 1024)
+
 /* ----------------
  *		Private state for a printtup destination object
  *
  * NOTE: finfo is the lookup info for either typoutput or typsend, whichever
  * we are using for this column.
+ *
+ * For a few common types, whose output we can produce directly in the
+ * message buffer, fastpath says how, and finfo is not used.
  * ----------------
  */
+typedef enum PrinttupFastPath
+{
+	PRINTTUP_CALL,				/* call the output or send function */
+	PRINTTUP_TEXT_INT2,
+	PRINTTUP_TEXT_INT4,
+	PRINTTUP_TEXT_INT8,
+	PRINTTUP_BINARY_BOOL,
+	PRINTTUP_BINARY_INT2,
+	PRINTTUP_BINARY_INT4,		/* also used for oid */
+	PRINTTUP_BINARY_INT8,
+	PRINTTUP_BINARY_FLOAT4,
+	PRINTTUP_BINARY_FLOAT8
+} PrinttupFastPath;
+
 typedef struct
 {								/* Per-attribute information */
 	Oid			typoutput;		/* Oid for the type's text output fn */
 	Oid			typsend;		/* Oid for the type's binary output fn */
 	bool		typisvarlena;	/* is it varlena (ie possibly toastable)? */
 	int16		format;			/* format code for this column */
+	PrinttupFastPath fastpath;	/* how to produce the output */
 	FmgrInfo	finfo;			/* Precomputed call info for output fn */
 } PrinttupAttrInfo;
 
@@ -66,7 +94,8 @@ typedef struct
 	TupleDesc	attrinfo;		/* The attr info we are set up for */
 	int			nattrs;
 	PrinttupAttrInfo *myinfo;	/* Cached info about each attr */
-	StringInfoData buf;			/* output buffer (*not* in tmpcontext) */
+	StringInfoData buf;			/* output buffer (*not* in tmpcontext); in
+								 * printtup, the batch of DataRows */
 	MemoryContext tmpcontext;	/* Memory context for per-row workspace */
 } DR_printtup;
 
@@ -174,6 +203,9 @@ printtup_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
 								  FetchPortalTargetList(portal),
 								  portal->formats);
 
+	/* printtup expects to find an empty batch */
+	resetStringInfo(&myState->buf);
+
 	/* ----------------
 	 * We could set up the derived attr info at this time, but we postpone it
 	 * until the first call of printtup, for 2 reasons:
@@ -349,12 +381,30 @@ printtup_prepare_info(DR_printtup *myState, TupleDesc typeinfo, int numAttrs)
 		Form_pg_attribute attr = TupleDescAttr(typeinfo, i);
 
 		thisState->format = format;
+		thisState->fastpath = PRINTTUP_CALL;
 		if (format == 0)
 		{
 			getTypeOutputInfo(attr->atttypid,
 							  &thisState->typoutput,
 							  &thisState->typisvarlena);
 			fmgr_info(thisState->typoutput, &thisState->finfo);
+
+			/* The protocol 2.0 routines don't know about fast paths */
+			if (PG_PROTOCOL_MAJOR(FrontendProtocol) >= 3)
+			{
+				switch (thisState->typoutput)
+				{
+					case F_INT2OUT:
+						thisState->fastpath = PRINTTUP_TEXT_INT2;
+						break;
+					case F_INT4OUT:
+						thisState->fastpath = PRINTTUP_TEXT_INT4;
+						break;
+					case F_INT8OUT:
+						thisState->fastpath = PRINTTUP_TEXT_INT8;
+						break;
+				}
+			}
 		}
 		else if (format == 1)
 		{
@@ -362,6 +412,32 @@ printtup_prepare_info(DR_printtup *myState, TupleDesc typeinfo, int numAttrs)
 									&thisState->typsend,
 									&thisState->typisvarlena);
 			fmgr_info(thisState->typsend, &thisState->finfo);
+
+			if (PG_PROTOCOL_MAJOR(FrontendProtocol) >= 3)
+			{
+				switch (thisState->typsend)
+				{
+					case F_BOOLSEND:
+						thisState->fastpath = PRINTTUP_BINARY_BOOL;
+						break;
+					case F_INT2SEND:
+						thisState->fastpath = PRINTTUP_BINARY_INT2;
+						break;
+					case F_INT4SEND:
+					case F_OIDSEND:
+						thisState->fastpath = PRINTTUP_BINARY_INT4;
+						break;
+					case F_INT8SEND:
+						thisState->fastpath = PRINTTUP_BINARY_INT8;
+						break;
+					case F_FLOAT4SEND:
+						thisState->fastpath = PRINTTUP_BINARY_FLOAT4;
+						break;
+					case F_FLOAT8SEND:
+						thisState->fastpath = PRINTTUP_BINARY_FLOAT8;
+						break;
+				}
+			}
 		}
 		else
 			ereport(ERROR,
@@ -382,6 +458,7 @@ printtup(TupleTableSlot *slot, DestReceiver *self)
 	MemoryContext oldcontext;
 	StringInfo	buf = &myState->buf;
 	int			natts = typeinfo->natts;
+	int			msgstart;
 	int			i;
 
 	/* Set or update my derived attribute info, if needed */
@@ -395,11 +472,15 @@ printtup(TupleTableSlot *slot, DestReceiver *self)
 	oldcontext = MemoryContextSwitchTo(myState->tmpcontext);
 
 	/*
-	 * Prepare a DataRow message (note buffer is in per-row context)
+	 * Append a DataRow message to the batch in buf (note buffer is not in
+	 * per-row context).  The buffer holds complete messages, type byte and
+	 * length word included; the length word is filled in at the end.
 	 */
-	pq_beginmessage_reuse(buf, 'D');
-
-	pq_sendint16(buf, natts);
+	msgstart = buf->len;
+	enlargeStringInfo(buf, 1 + 4 + 2);
+	pq_writeint8(buf, 'D');
+	pq_writeint32(buf, 0);
+	pq_writeint16(buf, natts);
 
 	/*
 	 * send the attributes of this tuple
@@ -426,6 +507,92 @@ printtup(TupleTableSlot *slot, DestReceiver *self)
 			VALGRIND_CHECK_MEM_IS_DEFINED(DatumGetPointer(attr),
 										  VARSIZE_ANY(attr));
 
+		switch (thisState->fastpath)
+		{
+			case PRINTTUP_CALL:
+				break;
+
+			case PRINTTUP_TEXT_INT2:
+			case PRINTTUP_TEXT_INT4:
+			case PRINTTUP_TEXT_INT8:
+				{
+					/*
+					 * Format the number straight into the buffer, after
+					 * room for its length.  Digits and sign are the same in
+					 * every client encoding, so no conversion is needed.
+					 */
+					char	   *str;
+					int			len;
+
+					enlargeStringInfo(buf, 4 + MAXINT8LEN + 1);
+					str = buf->data + buf->len + 4;
+					if (thisState->fastpath == PRINTTUP_TEXT_INT2)
+						len = pg_itoa(DatumGetInt16(attr), str);
+					else if (thisState->fastpath == PRINTTUP_TEXT_INT4)
+						len = pg_ltoa(DatumGetInt32(attr), str);
+					else
+						len = pg_lltoa(DatumGetInt64(attr), str);
+					pq_writeint32(buf, len);
+					buf->len += len;
+					buf->data[buf->len] = '\0';
+					continue;
+				}
+
+			case PRINTTUP_BINARY_BOOL:
+				enlargeStringInfo(buf, 4 + 1);
+				pq_writeint32(buf, 1);
+				pq_writeint8(buf, DatumGetBool(attr) ? 1 : 0);
+				continue;
+
+			case PRINTTUP_BINARY_INT2:
+				enlargeStringInfo(buf, 4 + 2);
+				pq_writeint32(buf, 2);
+				pq_writeint16(buf, DatumGetInt16(attr));
+				continue;
+
+			case PRINTTUP_BINARY_INT4:
+				enlargeStringInfo(buf, 4 + 4);
+				pq_writeint32(buf, 4);
+				pq_writeint32(buf, DatumGetUInt32(attr));
+				continue;
+
+			case PRINTTUP_BINARY_INT8:
+				enlargeStringInfo(buf, 4 + 8);
+				pq_writeint32(buf, 8);
+				pq_writeint64(buf, DatumGetInt64(attr));
+				continue;
+
+			case PRINTTUP_BINARY_FLOAT4:
+				{
+					union
+					{
+						float4		f;
+						uint32		i;
+					}			swap;
+
+					swap.f = DatumGetFloat4(attr);
+					enlargeStringInfo(buf, 4 + 4);
+					pq_writeint32(buf, 4);
+					pq_writeint32(buf, swap.i);
+					continue;
+				}
+
+			case PRINTTUP_BINARY_FLOAT8:
+				{
+					union
+					{
+						float8		f;
+						int64		i;
+					}			swap;
+
+					swap.f = DatumGetFloat8(attr);
+					enlargeStringInfo(buf, 4 + 8);
+					pq_writeint32(buf, 8);
+					pq_writeint64(buf, swap.i);
+					continue;
+				}
+		}
+
 		if (thisState->format == 0)
 		{
 			/* Text output */
@@ -446,7 +613,19 @@ printtup(TupleTableSlot *slot, DestReceiver *self)
 		}
 	}
 
-	pq_endmessage_reuse(buf);
+	/* Fill in the message length, which doesn't count the type byte */
+	{
+		uint32		n32 = pg_hton32((uint32) (buf->len - msgstart - 1));
+
+		memcpy(buf->data + msgstart + 1, &n32, sizeof(n32));
+	}
+
+	/* Send the batch once it's big enough */
+	if (buf->len >= PRINTTUP_BATCH_SIZE)
+	{
+		pq_putmessages(buf->data, buf->len);
+		resetStringInfo(buf);
+	}
 
 	/* Return to caller's context, and flush row's temporary memory */
 	MemoryContextSwitchTo(oldcontext);
@@ -542,6 +721,10 @@ printtup_shutdown(DestReceiver *self)
 {
 	DR_printtup *myState = (DR_printtup *) self;
 
+	/* Send whatever is left of the batch of DataRows */
+	if (myState->pub.receiveSlot == printtup && myState->buf.len > 0)
+		pq_putmessages(myState->buf.data, myState->buf.len);
+
 	if (myState->myinfo)
 		pfree(myState->myinfo);
 	myState->myinfo = NULL;
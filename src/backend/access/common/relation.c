@@ -22,6 +22,7 @@
 
 #include "access/relation.h"
 #include "access/xact.h"
+#include "catalog/globaltemp.h"
 #include "catalog/namespace.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -73,6 +74,10 @@ relation_open(Oid relationId, LOCKMODE lockmode)
 	if (RelationUsesLocalBuffers(r))
 		MyXactFlags |= XACT_FLAGS_ACCESSEDTEMPNAMESPACE;
 
+	/* Set up this session's storage for a global temporary relation */
+	if (RelationIsGlobalTemp(r))
+		GlobalTempRelationInitStorage(r);
+
 	pgstat_initstats(r);
 
 	return r;
@@ -123,6 +128,10 @@ try_relation_open(Oid relationId, LOCKMODE lockmode)
 	if (RelationUsesLocalBuffers(r))
 		MyXactFlags |= XACT_FLAGS_ACCESSEDTEMPNAMESPACE;
 
+	/* Set up this session's storage for a global temporary relation */
+	if (RelationIsGlobalTemp(r))
+		GlobalTempRelationInitStorage(r);
+
 	pgstat_initstats(r);
 
 	return r;
@@ -40,6 +40,7 @@ static void gistfinishsplit(GISTInsertState *state, GISTInsertStack *stack,
 							GISTSTATE *giststate, List *splitinfo, bool unlockbuf);
 static void gistprunepage(Relation rel, Page page, Buffer buffer,
 						  Relation heapRel);
+static XLogRecPtr gistGetBuildLSN(GISTSTATE *giststate);
 
 
 #define ROTATEDIST(d) do { \
@@ -77,6 +78,7 @@ gisthandler(PG_FUNCTION_ARGS)
 	amroutine->amcanparallel = false;
 	amroutine->amcaninclude = true;
 	amroutine->amusemaintenanceworkmem = false;
+	amroutine->amsummarizing = false;
 	amroutine->amparallelvacuumoptions =
 		VACUUM_OPTION_PARALLEL_BULKDEL | VACUUM_OPTION_PARALLEL_COND_CLEANUP;
 	amroutine->amkeytype = InvalidOid;
@@ -187,6 +189,24 @@ gistinsert(Relation r, Datum *values, bool *isnull,
 	return false;
 }
 
+/*
+ * Return the LSN to stamp on a page modified during index build.
+ *
+ * A serial build uses GistBuildLSN for everything.  In a parallel build,
+ * several processes insert into the index at once, so the LSN-NSN interlock
+ * has to work for concurrent splits: every modification takes the next
+ * value from a counter shared by all participants.  The leader resets the
+ * LSNs and NSNs to GistBuildLSN once the build is done.
+ */
+static XLogRecPtr
+gistGetBuildLSN(GISTSTATE *giststate)
+{
+	if (giststate->buildLSN == NULL)
+		return GistBuildLSN;
+
+	return (XLogRecPtr) pg_atomic_fetch_add_u64(giststate->buildLSN, 1);
+}
+
 
 /*
  * Place tuples from 'itup' to 'buffer'. If 'oldoffnum' is valid, the tuple
@@ -493,11 +513,12 @@ gistplacetopage(Relation rel, Size freespace, GISTSTATE *giststate,
 		 * yet. The LSN-NSN interlock between parent and child requires that
 		 * LSNs never move backwards, so set the LSNs to a value that's
 		 * smaller than any real or fake unlogged LSN that might be generated
-		 * later. (There can't be any concurrent scans during index build, so
-		 * we don't need to be able to detect concurrent splits yet.)
+		 * later. (There can't be any concurrent scans during a serial index
+		 * build, so we don't need to be able to detect concurrent splits yet.
+		 * A parallel build does need to, see gistGetBuildLSN.)
 		 */
 		if (is_build)
-			recptr = GistBuildLSN;
+			recptr = gistGetBuildLSN(giststate);
 		else
 		{
 			if (RelationNeedsWAL(rel))
@@ -564,7 +585,7 @@ gistplacetopage(Relation rel, Size freespace, GISTSTATE *giststate,
 			MarkBufferDirty(leftchildbuf);
 
 		if (is_build)
-			recptr = GistBuildLSN;
+			recptr = gistGetBuildLSN(giststate);
 		else
 		{
 			if (RelationNeedsWAL(rel))
@@ -1520,6 +1541,7 @@ initGISTstate(Relation index)
 	giststate->scanCxt = scanCxt;
 	giststate->tempCxt = scanCxt;	/* caller must change this if needed */
 	giststate->leafTupdesc = index->rd_att;
+	giststate->buildLSN = NULL;
 
 	/*
 	 * The truncated tupdesc for non-leaf index tuples, which doesn't contain
@@ -21,6 +21,10 @@
  * over, but switches to the buffered algorithm after a certain number of
  * tuples (unless buffering mode is disabled).
  *
+ * The second strategy can also be run in parallel, unless buffering was
+ * explicitly requested: each participant scans part of the heap and inserts
+ * its tuples into the shared index, without buffers.
+ *
  *
  * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -37,17 +41,33 @@
 #include "access/genam.h"
 #include "access/gist_private.h"
 #include "access/gistxlog.h"
+#include "access/parallel.h"
+#include "access/relscan.h"
+#include "access/table.h"
 #include "access/tableam.h"
+#include "access/xact.h"
 #include "access/xloginsert.h"
 #include "catalog/index.h"
+#include "executor/instrument.h"
 #include "miscadmin.h"
 #include "optimizer/optimizer.h"
+#include "pgstat.h"
 #include "storage/bufmgr.h"
+#include "storage/condition_variable.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"		/* pgrminclude ignore */
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
 #include "utils/tuplesort.h"
 
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_GIST_SHARED		UINT64CONST(0xC000000000000001)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xC000000000000002)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xC000000000000003)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xC000000000000004)
+
 /* Step of index tuples for check whether to switch to buffering build mode */
 #define BUFFERING_MODE_SWITCH_CHECK_STEP 256
 
@@ -78,6 +98,98 @@ typedef enum
 	GIST_BUFFERING_ACTIVE		/* in buffering build mode */
 } GistBuildMode;
 
+/*
+ * Status for index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment.
+ */
+typedef struct GistShared
+{
+	/*
+	 * These fields are not modified during the build.  They exist for the
+	 * benefit of worker processes that need to open the relations.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+	Size		freespace;
+
+	/*
+	 * buildLSN hands out the LSNs that participants stamp on the pages they
+	 * modify, so that concurrent page splits can be detected.  See
+	 * gistGetBuildLSN().
+	 */
+	pg_atomic_uint64 buildLSN;
+
+	/*
+	 * workersdonecv is used to monitor the progress of workers.  All parallel
+	 * participants must indicate that they are done before leader can use
+	 * mutable state that workers maintain during the build.
+	 */
+	ConditionVariable workersdonecv;
+
+	/*
+	 * mutex protects the fields that follow it.
+	 *
+	 * Mutable state that is maintained by workers, and reported back to
+	 * leader at end of parallel scan.
+	 *
+	 * nparticipantsdone is number of participants finished.
+	 *
+	 * reltuples is the total number of input heap tuples.
+	 *
+	 * indtuples is the total number of tuples that made it into the index.
+	 *
+	 * brokenhotchain indicates if any worker detected a broken HOT chain
+	 * during build.
+	 */
+	slock_t		mutex;
+	int			nparticipantsdone;
+	double		reltuples;
+	int64		indtuples;
+	bool		brokenhotchain;
+
+	/*
+	 * ParallelTableScanDescData data follows. Can't directly embed here, as
+	 * implementations of the parallel table scan desc interface might need
+	 * stronger alignment.
+	 */
+} GistShared;
+
+/*
+ * Return pointer to a GistShared's parallel table scan.
+ *
+ * c.f. shm_toc_allocate as to why BUFFERALIGN is used, rather than just
+ * MAXALIGN.
+ */
+#define ParallelTableScanFromGistShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(GistShared)))
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct GistLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/*
+	 * nparticipants is the exact number of worker processes successfully
+	 * launched, plus one for the leader process, which always participates
+	 * as a worker.
+	 */
+	int			nparticipants;
+
+	/*
+	 * Leader process convenience pointers to shared state (leader avoids TOC
+	 * lookups).  snapshot is the snapshot used by the scan iff an MVCC
+	 * snapshot is required.
+	 */
+	GistShared *gistshared;
+	Snapshot	snapshot;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+} GistLeader;
+
 /* Working state for gistbuild and its callback */
 typedef struct
 {
@@ -111,6 +223,12 @@ typedef struct
 	int			ready_num_pages;
 	BlockNumber ready_blknos[XLR_MAX_BLOCK_ID];
 	Page		ready_pages[XLR_MAX_BLOCK_ID];
+
+	/*
+	 * gistleader is only present when a parallel index build is performed,
+	 * and only in the leader process.
+	 */
+	GistLeader *gistleader;
 } GISTBuildState;
 
 /*
@@ -167,6 +285,17 @@ static void gistMemorizeParent(GISTBuildState *buildstate, BlockNumber child,
 static void gistMemorizeAllDownlinks(GISTBuildState *buildstate, Buffer parent);
 static BlockNumber gistGetParent(GISTBuildState *buildstate, BlockNumber child);
 
+static void _gist_begin_parallel(GISTBuildState *buildstate, bool isconcurrent,
+								 int request);
+static void _gist_end_parallel(GistLeader *gistleader);
+static Size _gist_parallel_estimate_shared(Relation heap, Snapshot snapshot);
+static double _gist_parallel_heapscan(GISTBuildState *buildstate,
+									  bool *brokenhotchain);
+static void _gist_parallel_scan_and_build(Relation heap, Relation index,
+										  GistShared *gistshared,
+										  bool progress);
+static void gistResetBuildLSNs(Relation index);
+
 
 /*
  * Main entry point to GiST index build.
@@ -193,6 +322,7 @@ gistbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	buildstate.indexrel = index;
 	buildstate.heaprel = heap;
 	buildstate.sortstate = NULL;
+	buildstate.gistleader = NULL;
 	buildstate.giststate = initGISTstate(index);
 
 	/*
@@ -305,20 +435,44 @@ gistbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 
 		END_CRIT_SECTION();
 
-		/* Scan the table, inserting all the tuples to the index. */
-		reltuples = table_index_build_scan(heap, index, indexInfo, true, true,
-										   gistBuildCallback,
-										   (void *) &buildstate, NULL);
-
 		/*
-		 * If buffering was used, flush out all the tuples that are still in
-		 * the buffers.
+		 * Attempt to launch parallel worker scan when required.  Buffering
+		 * can't be combined with that, so don't go parallel if the user asked
+		 * for buffering explicitly.
 		 */
-		if (buildstate.buildMode == GIST_BUFFERING_ACTIVE)
+		if (indexInfo->ii_ParallelWorkers > 0 &&
+			buildstate.buildMode != GIST_BUFFERING_STATS)
+			_gist_begin_parallel(&buildstate, indexInfo->ii_Concurrent,
+								 indexInfo->ii_ParallelWorkers);
+
+		if (buildstate.gistleader)
 		{
-			elog(DEBUG1, "all tuples processed, emptying buffers");
-			gistEmptyAllBuffers(&buildstate);
-			gistFreeBuildBuffers(buildstate.gfbb);
+			bool		brokenhotchain;
+
+			/* Wait for all participants to finish inserting */
+			reltuples = _gist_parallel_heapscan(&buildstate, &brokenhotchain);
+			indexInfo->ii_BrokenHotChain = brokenhotchain;
+			_gist_end_parallel(buildstate.gistleader);
+
+			gistResetBuildLSNs(index);
+		}
+		else
+		{
+			/* Scan the table, inserting all the tuples to the index. */
+			reltuples = table_index_build_scan(heap, index, indexInfo, true, true,
+											   gistBuildCallback,
+											   (void *) &buildstate, NULL);
+
+			/*
+			 * If buffering was used, flush out all the tuples that are still
+			 * in the buffers.
+			 */
+			if (buildstate.buildMode == GIST_BUFFERING_ACTIVE)
+			{
+				elog(DEBUG1, "all tuples processed, emptying buffers");
+				gistEmptyAllBuffers(&buildstate);
+				gistFreeBuildBuffers(buildstate.gfbb);
+			}
 		}
 
 		/*
@@ -1549,3 +1703,400 @@ gistGetParent(GISTBuildState *buildstate, BlockNumber child)
 
 	return entry->parentblkno;
 }
+
+/*-------------------------------------------------------------------------
+ * Routines for parallel build
+ *-------------------------------------------------------------------------
+ */
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * buildstate argument should be initialized, and the index's root page must
+ * already exist.
+ *
+ * isconcurrent indicates if operation is CREATE INDEX CONCURRENTLY.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Sets buildstate's GistLeader, which caller must use to shut down parallel
+ * mode by passing it to _gist_end_parallel() at the very end of its index
+ * build.  If not even a single worker process can be launched, this is
+ * never set, and caller should proceed with a serial index build.
+ */
+static void
+_gist_begin_parallel(GISTBuildState *buildstate, bool isconcurrent,
+					 int request)
+{
+	ParallelContext *pcxt;
+	Snapshot	snapshot;
+	Size		estgistshared;
+	GistShared *gistshared;
+	GistLeader *gistleader = (GistLeader *) palloc0(sizeof(GistLeader));
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	int			querylen;
+
+	/*
+	 * Enter parallel mode, and create context for parallel build of gist
+	 * index
+	 */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_gist_parallel_build_main",
+								 request);
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time
+	 * qual checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/* Estimate size for our own PARALLEL_KEY_GIST_SHARED workspace */
+	estgistshared = _gist_parallel_estimate_shared(buildstate->heaprel,
+												   snapshot);
+	shm_toc_estimate_chunk(&pcxt->estimator, estgistshared);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/*
+	 * Estimate space for WalUsage and BufferUsage -- PARALLEL_KEY_WAL_USAGE
+	 * and PARALLEL_KEY_BUFFER_USAGE.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+	{
+		if (IsMVCCSnapshot(snapshot))
+			UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return;
+	}
+
+	/* Store shared build state, for which we reserved space */
+	gistshared = (GistShared *) shm_toc_allocate(pcxt->toc, estgistshared);
+	/* Initialize immutable state */
+	gistshared->heaprelid = RelationGetRelid(buildstate->heaprel);
+	gistshared->indexrelid = RelationGetRelid(buildstate->indexrel);
+	gistshared->isconcurrent = isconcurrent;
+	gistshared->freespace = buildstate->freespace;
+	pg_atomic_init_u64(&gistshared->buildLSN, GistBuildLSN + 1);
+	ConditionVariableInit(&gistshared->workersdonecv);
+	SpinLockInit(&gistshared->mutex);
+	/* Initialize mutable state */
+	gistshared->nparticipantsdone = 0;
+	gistshared->reltuples = 0.0;
+	gistshared->indtuples = 0;
+	gistshared->brokenhotchain = false;
+	table_parallelscan_initialize(buildstate->heaprel,
+								  ParallelTableScanFromGistShared(gistshared),
+								  snapshot);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_GIST_SHARED, gistshared);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	/*
+	 * Allocate space for each worker's WalUsage and BufferUsage; no need to
+	 * initialize.
+	 */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+	gistleader->pcxt = pcxt;
+	gistleader->nparticipants = pcxt->nworkers_launched + 1;
+	gistleader->gistshared = gistshared;
+	gistleader->snapshot = snapshot;
+	gistleader->walusage = walusage;
+	gistleader->bufferusage = bufferusage;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		_gist_end_parallel(gistleader);
+		return;
+	}
+
+	/* Save leader state now that it's clear build will be parallel */
+	buildstate->gistleader = gistleader;
+
+	/* Join heap scan ourselves */
+	_gist_parallel_scan_and_build(buildstate->heaprel, buildstate->indexrel,
+								  gistshared, true);
+
+	/*
+	 * Caller needs to wait for all launched workers when we return.  Make
+	 * sure that the failure-to-start case will not hang forever.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ */
+static void
+_gist_end_parallel(GistLeader *gistleader)
+{
+	int			i;
+
+	/* Shutdown worker processes */
+	WaitForParallelWorkersToFinish(gistleader->pcxt);
+
+	/*
+	 * Next, accumulate WAL usage.  (This must wait for the workers to finish,
+	 * or we might get incomplete data.)
+	 */
+	for (i = 0; i < gistleader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&gistleader->bufferusage[i], &gistleader->walusage[i]);
+
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(gistleader->snapshot))
+		UnregisterSnapshot(gistleader->snapshot);
+	DestroyParallelContext(gistleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Returns size of shared memory required to store state for a parallel
+ * gist index build based on the snapshot its parallel scan will use.
+ */
+static Size
+_gist_parallel_estimate_shared(Relation heap, Snapshot snapshot)
+{
+	/* c.f. shm_toc_allocate as to why BUFFERALIGN is used */
+	return add_size(BUFFERALIGN(sizeof(GistShared)),
+					table_parallelscan_estimate(heap, snapshot));
+}
+
+/*
+ * Within leader, wait for all participants to finish inserting.
+ *
+ * Fills in indtuples for ambuild statistics, and lets caller set field
+ * indicating that some worker encountered a broken HOT chain.
+ *
+ * Returns the total number of heap tuples scanned.
+ */
+static double
+_gist_parallel_heapscan(GISTBuildState *buildstate, bool *brokenhotchain)
+{
+	GistShared *gistshared = buildstate->gistleader->gistshared;
+	int			nparticipants;
+	double		reltuples;
+
+	nparticipants = buildstate->gistleader->nparticipants;
+	for (;;)
+	{
+		SpinLockAcquire(&gistshared->mutex);
+		if (gistshared->nparticipantsdone == nparticipants)
+		{
+			buildstate->indtuples = gistshared->indtuples;
+			*brokenhotchain = gistshared->brokenhotchain;
+			reltuples = gistshared->reltuples;
+			SpinLockRelease(&gistshared->mutex);
+			break;
+		}
+		SpinLockRelease(&gistshared->mutex);
+
+		ConditionVariableSleep(&gistshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+
+	return reltuples;
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_gist_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	GistShared *gistshared;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Look up gist shared state */
+	gistshared = shm_toc_lookup(toc, PARALLEL_KEY_GIST_SHARED, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!gistshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = table_open(gistshared->heaprelid, heapLockmode);
+	indexRel = index_open(gistshared->indexrelid, indexLockmode);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	/* Scan our share of the heap, inserting tuples as we go */
+	_gist_parallel_scan_and_build(heapRel, indexRel, gistshared, false);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	index_close(indexRel, indexLockmode);
+	table_close(heapRel, heapLockmode);
+}
+
+/*
+ * Perform a participant's portion of a parallel build.
+ *
+ * Tuples from the blocks handed to us by the parallel heap scan are
+ * inserted one by one, exactly as in an unbuffered serial build, except
+ * that page LSNs come from the shared counter.
+ *
+ * When this returns, the participant is done, and need only release
+ * resources.
+ */
+static void
+_gist_parallel_scan_and_build(Relation heap, Relation index,
+							  GistShared *gistshared, bool progress)
+{
+	GISTBuildState buildstate;
+	TableScanDesc scan;
+	double		reltuples;
+	IndexInfo  *indexInfo;
+
+	buildstate.indexrel = index;
+	buildstate.heaprel = heap;
+	buildstate.sortstate = NULL;
+	buildstate.gistleader = NULL;
+	buildstate.giststate = initGISTstate(index);
+	buildstate.giststate->tempCxt = createTempGistContext();
+	buildstate.giststate->buildLSN = &gistshared->buildLSN;
+	buildstate.freespace = gistshared->freespace;
+	buildstate.buildMode = GIST_BUFFERING_DISABLED;
+	buildstate.indtuples = 0;
+	buildstate.indtuplesSize = 0;
+
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = gistshared->isconcurrent;
+	scan = table_beginscan_parallel(heap,
+									ParallelTableScanFromGistShared(gistshared));
+	reltuples = table_index_build_scan(heap, index, indexInfo, true, progress,
+									   gistBuildCallback,
+									   (void *) &buildstate, scan);
+
+	MemoryContextDelete(buildstate.giststate->tempCxt);
+	freeGISTstate(buildstate.giststate);
+
+	/*
+	 * Done.  Record ambuild statistics, and whether we encountered a broken
+	 * HOT chain.
+	 */
+	SpinLockAcquire(&gistshared->mutex);
+	gistshared->nparticipantsdone++;
+	gistshared->reltuples += reltuples;
+	gistshared->indtuples += buildstate.indtuples;
+	if (indexInfo->ii_BrokenHotChain)
+		gistshared->brokenhotchain = true;
+	SpinLockRelease(&gistshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&gistshared->workersdonecv);
+}
+
+/*
+ * After a parallel build, reset the LSN and NSN of every page to
+ * GistBuildLSN, as a serial build would have left them.  The values handed
+ * out by the shared counter are only meaningful among the participants, and
+ * could otherwise compare as newer than real or fake unlogged LSNs generated
+ * later.  All splits are complete by now, so nothing depends on them.
+ */
+static void
+gistResetBuildLSNs(Relation index)
+{
+	BlockNumber nblocks = RelationGetNumberOfBlocks(index);
+	BlockNumber blkno;
+
+	for (blkno = GIST_ROOT_BLKNO; blkno < nblocks; blkno++)
+	{
+		Buffer		buffer;
+		Page		page;
+
+		CHECK_FOR_INTERRUPTS();
+
+		buffer = ReadBuffer(index, blkno);
+		LockBuffer(buffer, GIST_EXCLUSIVE);
+		page = BufferGetPage(buffer);
+
+		if (!PageIsNew(page))
+		{
+			Assert(!GistFollowRight(page));
+
+			START_CRIT_SECTION();
+			if (GistPageGetNSN(page) != InvalidXLogRecPtr)
+				GistPageSetNSN(page, GistBuildLSN);
+			PageSetLSN(page, GistBuildLSN);
+			MarkBufferDirty(buffer);
+			END_CRIT_SECTION();
+		}
+
+		UnlockReleaseBuffer(buffer);
+	}
+}
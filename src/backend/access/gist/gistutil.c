@@ -1026,10 +1026,11 @@ gistproperty(Oid index_oid, int attno,
 XLogRecPtr
 gistGetFakeLSN(Relation rel)
 {
-	if (rel->rd_rel->relpersistence == RELPERSISTENCE_TEMP)
+	if (RelationUsesLocalBuffers(rel))
 	{
 		/*
-		 * Temporary relations are only accessible in our session, so a simple
+		 * Temporary relations (including this session's copy of a global
+		 * temporary relation) are only accessible in our session, so a simple
 		 * backend-local counter will do.
 		 */
 		static XLogRecPtr counter = FirstNormalUnloggedLSN;
@@ -74,6 +74,7 @@ hashhandler(PG_FUNCTION_ARGS)
 	amroutine->amcanparallel = false;
 	amroutine->amcaninclude = false;
 	amroutine->amusemaintenanceworkmem = false;
+	amroutine->amsummarizing = false;
 	amroutine->amparallelvacuumoptions =
 		VACUUM_OPTION_PARALLEL_BULKDEL;
 	amroutine->amkeytype = INT4OID;
@@ -149,15 +150,19 @@ hashbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	 * NOTE: this test will need adjustment if a bucket is ever different from
 	 * one page.  Also, "initial index size" accounting does not include the
 	 * metapage, nor the first bitmap page.
+	 *
+	 * A parallel build always sorts, since that is how the tuples collected
+	 * by the workers reach the leader, which does all the insertions.
 	 */
 	sort_threshold = (maintenance_work_mem * 1024L) / BLCKSZ;
-	if (index->rd_rel->relpersistence != RELPERSISTENCE_TEMP)
+	if (!RelationUsesLocalBuffers(index))
 		sort_threshold = Min(sort_threshold, NBuffers);
 	else
 		sort_threshold = Min(sort_threshold, NLocBuffer);
 
-	if (num_buckets >= (uint32) sort_threshold)
-		buildstate.spool = _h_spoolinit(heap, index, num_buckets);
+	if (num_buckets >= (uint32) sort_threshold ||
+		indexInfo->ii_ParallelWorkers > 0)
+		buildstate.spool = _h_spoolinit(heap, index, num_buckets, indexInfo);
 	else
 		buildstate.spool = NULL;
 
@@ -165,10 +170,15 @@ hashbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	buildstate.indtuples = 0;
 	buildstate.heapRel = heap;
 
-	/* do the heap scan */
-	reltuples = table_index_build_scan(heap, index, indexInfo, true, true,
-									   hashbuildCallback,
-									   (void *) &buildstate, NULL);
+	/* do the heap scan, unless parallel participants already did it */
+	if (buildstate.spool && _h_spool_is_parallel(buildstate.spool))
+		reltuples = _h_parallel_heapscan(buildstate.spool,
+										 &buildstate.indtuples,
+										 &indexInfo->ii_BrokenHotChain);
+	else
+		reltuples = table_index_build_scan(heap, index, indexInfo, true, true,
+										   hashbuildCallback,
+										   (void *) &buildstate, NULL);
 	pgstat_progress_update_param(PROGRESS_CREATEIDX_TUPLES_TOTAL,
 								 buildstate.indtuples);
 
@@ -13,6 +13,12 @@
  * hash code value.  That's no big problem though, since we'll still have
  * plenty of locality of access.
  *
+ * The spool can also be filled by a parallel heap scan.  Each participant
+ * hashes the keys of its share of the table into its own partial tuplesort,
+ * and the leader merges the sorted runs and inserts the tuples in bucket
+ * order, just as in a serial sorted build.  This follows the parallel
+ * B-Tree build in nbtsort.c; only the leader ever writes to the index.
+ *
  *
  * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -26,20 +32,127 @@
 #include "postgres.h"
 
 #include "access/hash.h"
+#include "access/parallel.h"
+#include "access/relscan.h"
+#include "access/table.h"
+#include "access/tableam.h"
+#include "access/xact.h"
+#include "catalog/index.h"
 #include "commands/progress.h"
+#include "executor/instrument.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "port/pg_bitutils.h"
+#include "storage/condition_variable.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"		/* pgrminclude ignore */
+#include "utils/rel.h"
 #include "utils/tuplesort.h"
 
 
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_HASH_SHARED		UINT64CONST(0xC000000000000001)
+#define PARALLEL_KEY_TUPLESORT			UINT64CONST(0xC000000000000002)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xC000000000000003)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xC000000000000004)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xC000000000000005)
+
+/*
+ * Status for index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment.  Note that there is a separate tuplesort TOC
+ * entry, private to tuplesort.c but allocated by this module on its behalf.
+ */
+typedef struct HSShared
+{
+	/*
+	 * These fields are not modified during the sort.  They primarily exist
+	 * for the benefit of worker processes that need to create HSpool state
+	 * corresponding to that used by the leader.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	uint32		num_buckets;
+	bool		isconcurrent;
+	int			scantuplesortstates;
+
+	/*
+	 * workersdonecv is used to monitor the progress of workers.  All parallel
+	 * participants must indicate that they are done before leader can use
+	 * mutable state that workers maintain during scan (and before leader can
+	 * proceed to tuplesort_performsort()).
+	 */
+	ConditionVariable workersdonecv;
+
+	/*
+	 * mutex protects the mutable state below, which is maintained by workers
+	 * and reported back to leader at end of parallel scan.
+	 *
+	 * nparticipantsdone is number of worker processes finished.
+	 *
+	 * reltuples is the total number of input heap tuples.
+	 *
+	 * indtuples is the total number of tuples that made it into the index.
+	 *
+	 * brokenhotchain indicates if any worker detected a broken HOT chain
+	 * during build.
+	 */
+	slock_t		mutex;
+	int			nparticipantsdone;
+	double		reltuples;
+	double		indtuples;
+	bool		brokenhotchain;
+
+	/*
+	 * ParallelTableScanDescData data follows. Can't directly embed here, as
+	 * implementations of the parallel table scan desc interface might need
+	 * stronger alignment.
+	 */
+} HSShared;
+
+/*
+ * Return pointer to a HSShared's parallel table scan.
+ *
+ * c.f. shm_toc_allocate as to why BUFFERALIGN is used, rather than just
+ * MAXALIGN.
+ */
+#define ParallelTableScanFromHSShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(HSShared)))
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct HSLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/*
+	 * nparticipanttuplesorts is the exact number of worker processes
+	 * successfully launched, plus one leader process, which always
+	 * participates as a worker.
+	 */
+	int			nparticipanttuplesorts;
+
+	/*
+	 * Leader process convenience pointers to shared state (leader avoids TOC
+	 * lookups).
+	 */
+	HSShared   *hsshared;
+	Sharedsort *sharedsort;
+	Snapshot	snapshot;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+} HSLeader;
+
 /*
  * Status record for spooling/sorting phase.
  */
 struct HSpool
 {
 	Tuplesortstate *sortstate;	/* state data for tuplesort.c */
+	Relation	heap;
 	Relation	index;
+	HSLeader   *hsleader;		/* NULL unless parallel build */
 
 	/*
 	 * We sort the hash keys based on the buckets they belong to. Below masks
@@ -51,33 +164,68 @@ struct HSpool
 	uint32		max_buckets;
 };
 
+/* Working state of a parallel participant's heap scan */
+typedef struct HSBuildState
+{
+	HSpool	   *spool;
+	double		indtuples;
+} HSBuildState;
+
+static void _h_spool_setmasks(HSpool *hspool, uint32 num_buckets);
+static void _h_begin_parallel(HSpool *hspool, uint32 num_buckets,
+							  bool isconcurrent, int request);
+static void _h_end_parallel(HSLeader *hsleader);
+static Size _h_parallel_estimate_shared(Relation heap, Snapshot snapshot);
+static void _h_parallel_scan_and_sort(HSpool *hspool, HSShared *hsshared,
+									  Sharedsort *sharedsort, int sortmem,
+									  bool progress);
+static void _h_build_callback(Relation index, ItemPointer tid, Datum *values,
+							  bool *isnull, bool tupleIsAlive, void *state);
+
 
 /*
  * create and initialize a spool structure
+ *
+ * If indexInfo requests parallel workers, they are launched here and the
+ * heap scan begins at once; the leader takes part in it before returning.
+ * Caller must then use _h_parallel_heapscan() instead of scanning the heap
+ * itself.  If no worker could be launched, the spool is left for a serial
+ * scan, as if no workers had been requested.
  */
 HSpool *
-_h_spoolinit(Relation heap, Relation index, uint32 num_buckets)
+_h_spoolinit(Relation heap, Relation index, uint32 num_buckets,
+			 struct IndexInfo *indexInfo)
 {
 	HSpool	   *hspool = (HSpool *) palloc0(sizeof(HSpool));
+	SortCoordinate coordinate = NULL;
 
+	hspool->heap = heap;
 	hspool->index = index;
+	_h_spool_setmasks(hspool, num_buckets);
+
+	/* Attempt to launch parallel worker scan when required */
+	if (indexInfo->ii_ParallelWorkers > 0)
+		_h_begin_parallel(hspool, num_buckets, indexInfo->ii_Concurrent,
+						  indexInfo->ii_ParallelWorkers);
 
 	/*
-	 * Determine the bitmask for hash code values.  Since there are currently
-	 * num_buckets buckets in the index, the appropriate mask can be computed
-	 * as follows.
-	 *
-	 * NOTE : This hash mask calculation should be in sync with similar
-	 * calculation in _hash_init_metabuffer.
+	 * If parallel build requested and at least one worker process was
+	 * successfully launched, set up coordination state
 	 */
-	hspool->high_mask = pg_nextpower2_32(num_buckets + 1) - 1;
-	hspool->low_mask = (hspool->high_mask >> 1);
-	hspool->max_buckets = num_buckets - 1;
+	if (hspool->hsleader)
+	{
+		coordinate = (SortCoordinate) palloc0(sizeof(SortCoordinateData));
+		coordinate->isWorker = false;
+		coordinate->nParticipants = hspool->hsleader->nparticipanttuplesorts;
+		coordinate->sharedsort = hspool->hsleader->sharedsort;
+	}
 
 	/*
 	 * We size the sort area as maintenance_work_mem rather than work_mem to
 	 * speed index creation.  This should be OK since a single backend can't
-	 * run multiple index creations in parallel.
+	 * run multiple index creations in parallel.  As for B-Tree builds, the
+	 * leader's tuplesort only starts using much memory once the workers have
+	 * finished their partial sorts.
 	 */
 	hspool->sortstate = tuplesort_begin_index_hash(heap,
 												   index,
@@ -85,22 +233,53 @@ _h_spoolinit(Relation heap, Relation index, uint32 num_buckets)
 												   hspool->low_mask,
 												   hspool->max_buckets,
 												   maintenance_work_mem,
-												   NULL,
+												   coordinate,
 												   false);
 
 	return hspool;
 }
 
 /*
- * clean up a spool structure and its substructures.
+ * Set the bucket masks used to sort the hash keys of a spool
+ */
+static void
+_h_spool_setmasks(HSpool *hspool, uint32 num_buckets)
+{
+	/*
+	 * Determine the bitmask for hash code values.  Since there are currently
+	 * num_buckets buckets in the index, the appropriate mask can be computed
+	 * as follows.
+	 *
+	 * NOTE : This hash mask calculation should be in sync with similar
+	 * calculation in _hash_init_metabuffer.
+	 */
+	hspool->high_mask = pg_nextpower2_32(num_buckets + 1) - 1;
+	hspool->low_mask = (hspool->high_mask >> 1);
+	hspool->max_buckets = num_buckets - 1;
+}
+
+/*
+ * clean up a spool structure and its substructures, shutting down parallel
+ * workers if any were used to fill it.
  */
 void
 _h_spooldestroy(HSpool *hspool)
 {
 	tuplesort_end(hspool->sortstate);
+	if (hspool->hsleader)
+		_h_end_parallel(hspool->hsleader);
 	pfree(hspool);
 }
 
+/*
+ * Is the spool being filled by a parallel heap scan?
+ */
+bool
+_h_spool_is_parallel(HSpool *hspool)
+{
+	return hspool->hsleader != NULL;
+}
+
 /*
  * spool an index entry into the sort file.
  */
@@ -150,3 +329,445 @@ _h_indexbuild(HSpool *hspool, Relation heapRel)
 									 ++tups_done);
 	}
 }
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * isconcurrent indicates if operation is CREATE INDEX CONCURRENTLY.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Sets hspool's HSLeader, which _h_spooldestroy() uses to shut down parallel
+ * mode at the very end of the index build.  If not even a single worker
+ * process can be launched, this is never set, and caller should proceed
+ * with a serial index build.
+ */
+static void
+_h_begin_parallel(HSpool *hspool, uint32 num_buckets, bool isconcurrent,
+				  int request)
+{
+	ParallelContext *pcxt;
+	int			scantuplesortstates;
+	Snapshot	snapshot;
+	Size		esthsshared;
+	Size		estsort;
+	HSShared   *hsshared;
+	Sharedsort *sharedsort;
+	HSLeader   *hsleader = (HSLeader *) palloc0(sizeof(HSLeader));
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	int			querylen;
+
+	/*
+	 * Enter parallel mode, and create context for parallel build of hash
+	 * index
+	 */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_h_parallel_build_main",
+								 request);
+
+	/* The leader always participates as a worker */
+	scantuplesortstates = request + 1;
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time
+	 * qual checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_HASH_SHARED workspace, and
+	 * PARALLEL_KEY_TUPLESORT tuplesort workspace
+	 */
+	esthsshared = _h_parallel_estimate_shared(hspool->heap, snapshot);
+	shm_toc_estimate_chunk(&pcxt->estimator, esthsshared);
+	estsort = tuplesort_estimate_shared(scantuplesortstates);
+	shm_toc_estimate_chunk(&pcxt->estimator, estsort);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	/*
+	 * Estimate space for WalUsage and BufferUsage -- PARALLEL_KEY_WAL_USAGE
+	 * and PARALLEL_KEY_BUFFER_USAGE.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+	{
+		if (IsMVCCSnapshot(snapshot))
+			UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return;
+	}
+
+	/* Store shared build state, for which we reserved space */
+	hsshared = (HSShared *) shm_toc_allocate(pcxt->toc, esthsshared);
+	/* Initialize immutable state */
+	hsshared->heaprelid = RelationGetRelid(hspool->heap);
+	hsshared->indexrelid = RelationGetRelid(hspool->index);
+	hsshared->num_buckets = num_buckets;
+	hsshared->isconcurrent = isconcurrent;
+	hsshared->scantuplesortstates = scantuplesortstates;
+	ConditionVariableInit(&hsshared->workersdonecv);
+	SpinLockInit(&hsshared->mutex);
+	/* Initialize mutable state */
+	hsshared->nparticipantsdone = 0;
+	hsshared->reltuples = 0.0;
+	hsshared->indtuples = 0.0;
+	hsshared->brokenhotchain = false;
+	table_parallelscan_initialize(hspool->heap,
+								  ParallelTableScanFromHSShared(hsshared),
+								  snapshot);
+
+	/*
+	 * Store shared tuplesort-private state, for which we reserved space.
+	 * Then, initialize opaque state using tuplesort routine.
+	 */
+	sharedsort = (Sharedsort *) shm_toc_allocate(pcxt->toc, estsort);
+	tuplesort_initialize_shared(sharedsort, scantuplesortstates,
+								pcxt->seg);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_HASH_SHARED, hsshared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT, sharedsort);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	/*
+	 * Allocate space for each worker's WalUsage and BufferUsage; no need to
+	 * initialize.
+	 */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+	hsleader->pcxt = pcxt;
+	hsleader->nparticipanttuplesorts = pcxt->nworkers_launched + 1;
+	hsleader->hsshared = hsshared;
+	hsleader->sharedsort = sharedsort;
+	hsleader->snapshot = snapshot;
+	hsleader->walusage = walusage;
+	hsleader->bufferusage = bufferusage;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		_h_end_parallel(hsleader);
+		return;
+	}
+
+	/* Save leader state now that it's clear build will be parallel */
+	hspool->hsleader = hsleader;
+
+	/*
+	 * Join heap scan ourselves, using a private spool that shares the
+	 * relations and masks of the leader's spool.  Might as well use reliable
+	 * figure when doling out maintenance_work_mem.
+	 */
+	{
+		HSpool	   *leaderworker = (HSpool *) palloc0(sizeof(HSpool));
+
+		leaderworker->heap = hspool->heap;
+		leaderworker->index = hspool->index;
+		_h_spool_setmasks(leaderworker, num_buckets);
+
+		_h_parallel_scan_and_sort(leaderworker, hsshared, sharedsort,
+								  maintenance_work_mem /
+								  hsleader->nparticipanttuplesorts,
+								  true);
+		pfree(leaderworker);
+	}
+
+	/*
+	 * Caller needs to wait for all launched workers when we return.  Make
+	 * sure that the failure-to-start case will not hang forever.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ */
+static void
+_h_end_parallel(HSLeader *hsleader)
+{
+	int			i;
+
+	/* Shutdown worker processes */
+	WaitForParallelWorkersToFinish(hsleader->pcxt);
+
+	/*
+	 * Next, accumulate WAL usage.  (This must wait for the workers to finish,
+	 * or we might get incomplete data.)
+	 */
+	for (i = 0; i < hsleader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&hsleader->bufferusage[i], &hsleader->walusage[i]);
+
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(hsleader->snapshot))
+		UnregisterSnapshot(hsleader->snapshot);
+	DestroyParallelContext(hsleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Returns size of shared memory required to store state for a parallel
+ * hash index build based on the snapshot its parallel scan will use.
+ */
+static Size
+_h_parallel_estimate_shared(Relation heap, Snapshot snapshot)
+{
+	/* c.f. shm_toc_allocate as to why BUFFERALIGN is used */
+	return add_size(BUFFERALIGN(sizeof(HSShared)),
+					table_parallelscan_estimate(heap, snapshot));
+}
+
+/*
+ * Within leader, wait for end of heap scan.
+ *
+ * When called, the leader has already done its own share of the parallel
+ * heap scan started by _h_spoolinit(), so we end up here just as workers
+ * are finishing.
+ *
+ * Sets *indtuples to the number of tuples spooled, and lets caller set
+ * field indicating that some worker encountered a broken HOT chain.
+ *
+ * Returns the total number of heap tuples scanned.
+ */
+double
+_h_parallel_heapscan(HSpool *hspool, double *indtuples, bool *brokenhotchain)
+{
+	HSShared   *hsshared = hspool->hsleader->hsshared;
+	int			nparticipanttuplesorts;
+	double		reltuples;
+
+	nparticipanttuplesorts = hspool->hsleader->nparticipanttuplesorts;
+	for (;;)
+	{
+		SpinLockAcquire(&hsshared->mutex);
+		if (hsshared->nparticipantsdone == nparticipanttuplesorts)
+		{
+			*indtuples = hsshared->indtuples;
+			*brokenhotchain = hsshared->brokenhotchain;
+			reltuples = hsshared->reltuples;
+			SpinLockRelease(&hsshared->mutex);
+			break;
+		}
+		SpinLockRelease(&hsshared->mutex);
+
+		ConditionVariableSleep(&hsshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+
+	return reltuples;
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_h_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	HSpool	   *hspool;
+	HSShared   *hsshared;
+	Sharedsort *sharedsort;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	int			sortmem;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Look up hash shared state */
+	hsshared = shm_toc_lookup(toc, PARALLEL_KEY_HASH_SHARED, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!hsshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = table_open(hsshared->heaprelid, heapLockmode);
+	indexRel = index_open(hsshared->indexrelid, indexLockmode);
+
+	/* Initialize worker's own spool */
+	hspool = (HSpool *) palloc0(sizeof(HSpool));
+	hspool->heap = heapRel;
+	hspool->index = indexRel;
+	_h_spool_setmasks(hspool, hsshared->num_buckets);
+
+	/* Look up shared state private to tuplesort.c */
+	sharedsort = shm_toc_lookup(toc, PARALLEL_KEY_TUPLESORT, false);
+	tuplesort_attach_shared(sharedsort, seg);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	/* Perform sorting of spool */
+	sortmem = maintenance_work_mem / hsshared->scantuplesortstates;
+	_h_parallel_scan_and_sort(hspool, hsshared, sharedsort, sortmem, false);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	index_close(indexRel, indexLockmode);
+	table_close(heapRel, heapLockmode);
+}
+
+/*
+ * Perform a worker's portion of a parallel sort.
+ *
+ * This generates a partial tuplesort for the passed hspool, whose relation
+ * and mask fields should already be set, and fills it from the worker's
+ * share of the parallel heap scan.
+ *
+ * sortmem is the amount of working memory to use within each worker,
+ * expressed in KBs.
+ *
+ * When this returns, workers are done, and need only release resources.
+ */
+static void
+_h_parallel_scan_and_sort(HSpool *hspool, HSShared *hsshared,
+						  Sharedsort *sharedsort, int sortmem, bool progress)
+{
+	SortCoordinate coordinate;
+	HSBuildState buildstate;
+	TableScanDesc scan;
+	double		reltuples;
+	IndexInfo  *indexInfo;
+
+	/* Initialize local tuplesort coordination state */
+	coordinate = palloc0(sizeof(SortCoordinateData));
+	coordinate->isWorker = true;
+	coordinate->nParticipants = -1;
+	coordinate->sharedsort = sharedsort;
+
+	/* Begin "partial" tuplesort */
+	hspool->sortstate = tuplesort_begin_index_hash(hspool->heap,
+												   hspool->index,
+												   hspool->high_mask,
+												   hspool->low_mask,
+												   hspool->max_buckets,
+												   sortmem, coordinate,
+												   false);
+
+	/* Fill in buildstate for _h_build_callback() */
+	buildstate.spool = hspool;
+	buildstate.indtuples = 0;
+
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(hspool->index);
+	indexInfo->ii_Concurrent = hsshared->isconcurrent;
+	scan = table_beginscan_parallel(hspool->heap,
+									ParallelTableScanFromHSShared(hsshared));
+	reltuples = table_index_build_scan(hspool->heap, hspool->index, indexInfo,
+									   true, progress, _h_build_callback,
+									   (void *) &buildstate, scan);
+
+	/* Execute this worker's part of the sort */
+	tuplesort_performsort(hspool->sortstate);
+
+	/*
+	 * Done.  Record ambuild statistics, and whether we encountered a broken
+	 * HOT chain.
+	 */
+	SpinLockAcquire(&hsshared->mutex);
+	hsshared->nparticipantsdone++;
+	hsshared->reltuples += reltuples;
+	hsshared->indtuples += buildstate.indtuples;
+	if (indexInfo->ii_BrokenHotChain)
+		hsshared->brokenhotchain = true;
+	SpinLockRelease(&hsshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&hsshared->workersdonecv);
+
+	/* We can end tuplesorts immediately */
+	tuplesort_end(hspool->sortstate);
+}
+
+/*
+ * Per-tuple callback for table_index_build_scan in parallel participants.
+ * This is the spooling half of hashbuildCallback().
+ */
+static void
+_h_build_callback(Relation index,
+				  ItemPointer tid,
+				  Datum *values,
+				  bool *isnull,
+				  bool tupleIsAlive,
+				  void *state)
+{
+	HSBuildState *buildstate = (HSBuildState *) state;
+	Datum		index_values[1];
+	bool		index_isnull[1];
+
+	/* convert data to a hash key; on failure, do not insert anything */
+	if (!_hash_convert_tuple(index,
+							 values, isnull,
+							 index_values, index_isnull))
+		return;
+
+	_h_spool(buildstate->spool, tid, index_values, index_isnull);
+
+	buildstate->indtuples += 1;
+}
@@ -60,6 +60,7 @@
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
 #include "storage/procarray.h"
+#include "storage/read_stream.h"
 #include "storage/smgr.h"
 #include "storage/spin.h"
 #include "storage/standby.h"
@@ -73,6 +74,10 @@
 
 static HeapTuple heap_prepare_insert(Relation relation, HeapTuple tup,
 									 TransactionId xid, CommandId cid, int options);
+static void heap_bulk_load_tuples(Relation relation, HeapTuple *heaptuples,
+								  int ntuples, Size saveFreeSpace,
+								  BulkInsertState bistate);
+static void heap_bulk_load_write_page(BulkInsertState bistate);
 static XLogRecPtr log_heap_update(Relation reln, Buffer oldbuf,
 								  Buffer newbuf, HeapTuple oldtup,
 								  HeapTuple newtup, HeapTuple old_key_tuple,
@@ -298,6 +303,18 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 
 	scan->rs_numblocks = InvalidBlockNumber;
 	scan->rs_inited = false;
+
+	/*
+	 * The strategy may have changed, so let heapgetpage() set up a new read
+	 * stream if it wants one.
+	 */
+	if (scan->rs_read_stream != NULL)
+	{
+		read_stream_end(scan->rs_read_stream);
+		scan->rs_read_stream = NULL;
+	}
+	scan->rs_stream_next = InvalidBlockNumber;
+	scan->rs_stream_remaining = InvalidBlockNumber;
 	scan->rs_ctup.t_data = NULL;
 	ItemPointerSetInvalid(&scan->rs_ctup.t_self);
 	scan->rs_cbuf = InvalidBuffer;
@@ -342,6 +359,98 @@ heap_setscanlimits(TableScanDesc sscan, BlockNumber startBlk, BlockNumber numBlk
 	scan->rs_numblocks = numBlks;
 }
 
+/*
+ * heap_scan_page_after - page a serial forward scan visits after "page"
+ *
+ * Returns InvalidBlockNumber if the scan ends after "page" because it has
+ * wrapped around to rs_startblock.
+ */
+static BlockNumber
+heap_scan_page_after(HeapScanDesc scan, BlockNumber page)
+{
+	page++;
+	if (page >= scan->rs_nblocks)
+		page = 0;
+	if (page == scan->rs_startblock)
+		return InvalidBlockNumber;
+	return page;
+}
+
+/*
+ * heap_scan_stream_read_next - read stream callback for sequential scans
+ *
+ * Predicts the pages a forward heapgettup() or heapgettup_pagemode() will
+ * ask for next.
+ */
+static BlockNumber
+heap_scan_stream_read_next(ReadStream *stream, void *callback_private_data)
+{
+	HeapScanDesc scan = (HeapScanDesc) callback_private_data;
+	BlockNumber page = scan->rs_stream_next;
+
+	if (!BlockNumberIsValid(page) || scan->rs_stream_remaining == 0)
+		return InvalidBlockNumber;
+
+	if (scan->rs_stream_remaining != InvalidBlockNumber)
+		scan->rs_stream_remaining--;
+	scan->rs_stream_next = heap_scan_page_after(scan, page);
+
+	return page;
+}
+
+/*
+ * heap_scan_read_page - read a page for heapgetpage()
+ *
+ * Serial sequential scans that are seen moving forward get their pages from
+ * a read stream, so that consecutive pages are read with large vectored
+ * reads.  The first page of a scan, and any page reached by changing
+ * direction, is read directly; in the latter case the stream is discarded,
+ * so that a backward-moving cursor doesn't read ahead in the wrong direction.
+ */
+static Buffer
+heap_scan_read_page(HeapScanDesc scan, BlockNumber page)
+{
+	bool		forward;
+
+	forward = (scan->rs_base.rs_flags &
+			   (SO_TYPE_SEQSCAN | SO_TYPE_TIDRANGESCAN)) != 0 &&
+		scan->rs_base.rs_parallel == NULL &&
+		BlockNumberIsValid(scan->rs_cblock) &&
+		page == heap_scan_page_after(scan, scan->rs_cblock);
+
+	if (forward && scan->rs_read_stream == NULL)
+	{
+		/* rs_numblocks already accounts for this page */
+		scan->rs_stream_next = page;
+		scan->rs_stream_remaining = scan->rs_numblocks;
+		scan->rs_read_stream =
+			read_stream_begin_relation(READ_STREAM_DEFAULT,
+									   scan->rs_base.rs_rd, MAIN_FORKNUM,
+									   scan->rs_strategy,
+									   heap_scan_stream_read_next,
+									   scan);
+	}
+
+	if (scan->rs_read_stream != NULL)
+	{
+		Buffer		buffer = InvalidBuffer;
+
+		if (forward)
+			buffer = read_stream_next_buffer(scan->rs_read_stream);
+		if (BufferIsValid(buffer) && BufferGetBlockNumber(buffer) == page)
+			return buffer;
+
+		/* the scan went somewhere we didn't predict */
+		if (BufferIsValid(buffer))
+			ReleaseBuffer(buffer);
+		read_stream_end(scan->rs_read_stream);
+		scan->rs_read_stream = NULL;
+	}
+
+	return ReadBufferExtended(scan->rs_base.rs_rd, MAIN_FORKNUM, page,
+							  RBM_NORMAL, scan->rs_strategy);
+}
+
 /*
  * heapgetpage - subroutine for heapgettup()
  *
@@ -379,8 +488,7 @@ heapgetpage(TableScanDesc sscan, BlockNumber page)
 	CHECK_FOR_INTERRUPTS();
 
 	/* read page using selected strategy */
-	scan->rs_cbuf = ReadBufferExtended(scan->rs_base.rs_rd, MAIN_FORKNUM, page,
-									   RBM_NORMAL, scan->rs_strategy);
+	scan->rs_cbuf = heap_scan_read_page(scan, page);
 	scan->rs_cblock = page;
 
 	if (!(scan->rs_base.rs_flags & SO_ALLOW_PAGEMODE))
@@ -585,8 +693,14 @@ heapgettup(HeapScanDesc scan,
 			 * forward scanners.
 			 */
 			scan->rs_base.rs_flags &= ~SO_ALLOW_SYNC;
-			/* start from last page of the scan */
-			if (scan->rs_startblock > 0)
+
+			/*
+			 * Start from last page of the scan.  Ensure we take into account
+			 * rs_numblocks if it's been adjusted by heap_setscanlimits().
+			 */
+			if (scan->rs_numblocks != InvalidBlockNumber)
+				page = (scan->rs_startblock + scan->rs_numblocks - 1) % scan->rs_nblocks;
+			else if (scan->rs_startblock > 0)
 				page = scan->rs_startblock - 1;
 			else
 				page = scan->rs_nblocks - 1;
@@ -900,8 +1014,14 @@ heapgettup_pagemode(HeapScanDesc scan,
 			 * forward scanners.
 			 */
 			scan->rs_base.rs_flags &= ~SO_ALLOW_SYNC;
-			/* start from last page of the scan */
-			if (scan->rs_startblock > 0)
+
+			/*
+			 * Start from last page of the scan.  Ensure we take into account
+			 * rs_numblocks if it's been adjusted by heap_setscanlimits().
+			 */
+			if (scan->rs_numblocks != InvalidBlockNumber)
+				page = (scan->rs_startblock + scan->rs_numblocks - 1) % scan->rs_nblocks;
+			else if (scan->rs_startblock > 0)
 				page = scan->rs_startblock - 1;
 			else
 				page = scan->rs_nblocks - 1;
@@ -1167,6 +1287,7 @@ heap_beginscan(Relation relation, Snapshot snapshot,
 	scan->rs_base.rs_private =
 		palloc(sizeof(ParallelBlockTableScanWorkerData));
 	scan->rs_strategy = NULL;	/* set in initscan */
+	scan->rs_read_stream = NULL;
 
 	/*
 	 * Disable page-at-a-time mode if it's not a MVCC-safe snapshot.
@@ -1265,6 +1386,9 @@ heap_endscan(TableScanDesc sscan)
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
 
+	if (scan->rs_read_stream != NULL)
+		read_stream_end(scan->rs_read_stream);
+
 	/*
 	 * decrement relation reference count and free scan descriptor storage
 	 */
@@ -1361,6 +1485,151 @@ heap_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableSlot *s
 	return true;
 }
 
+void
+heap_set_tidrange(TableScanDesc sscan, ItemPointer mintid,
+				  ItemPointer maxtid)
+{
+	HeapScanDesc scan = (HeapScanDesc) sscan;
+	BlockNumber startBlk;
+	BlockNumber numBlks;
+	ItemPointerData highestItem;
+	ItemPointerData lowestItem;
+
+	/*
+	 * For relations without any pages, we can simply leave the TID range
+	 * unset.  There will be no tuples to scan, therefore no tuples outside
+	 * the given TID range.
+	 */
+	if (scan->rs_nblocks == 0)
+		return;
+
+	/*
+	 * Set up some ItemPointers which point to the first and last possible
+	 * tuples in the heap.
+	 */
+	ItemPointerSet(&highestItem, scan->rs_nblocks - 1, MaxOffsetNumber);
+	ItemPointerSet(&lowestItem, 0, FirstOffsetNumber);
+
+	/*
+	 * If the given maximum TID is below the highest possible TID in the
+	 * relation, then restrict the range to that, otherwise we scan to the end
+	 * of the relation.
+	 */
+	if (ItemPointerCompare(maxtid, &highestItem) < 0)
+		ItemPointerCopy(maxtid, &highestItem);
+
+	/*
+	 * If the given minimum TID is above the lowest possible TID in the
+	 * relation, then restrict the range to only scan for TIDs above that.
+	 */
+	if (ItemPointerCompare(mintid, &lowestItem) > 0)
+		ItemPointerCopy(mintid, &lowestItem);
+
+	/*
+	 * Check for an empty range and protect from would be negative results
+	 * from the numBlks calculation below.
+	 */
+	if (ItemPointerCompare(&highestItem, &lowestItem) < 0)
+	{
+		/* Set an empty range of blocks to scan */
+		heap_setscanlimits(sscan, 0, 0);
+		return;
+	}
+
+	/*
+	 * Calculate the first block and the number of blocks we must scan.  We
+	 * could be more aggressive here and check whether lowestItem has an
+	 * offset above MaxOffsetNumber, in which case startBlk could be advanced
+	 * by one; likewise we could scan one fewer block if highestItem has an
+	 * offset of 0.  Such cases don't seem worth troubling over.
+	 */
+	startBlk = ItemPointerGetBlockNumberNoCheck(&lowestItem);
+
+	numBlks = ItemPointerGetBlockNumberNoCheck(&highestItem) -
+		ItemPointerGetBlockNumberNoCheck(&lowestItem) + 1;
+
+	/* Set the start block and number of blocks to scan */
+	heap_setscanlimits(sscan, startBlk, numBlks);
+
+	/* Finally, set the TID range in sscan */
+	ItemPointerCopy(&lowestItem, &sscan->rs_mintid);
+	ItemPointerCopy(&highestItem, &sscan->rs_maxtid);
+}
+
+bool
+heap_getnextslot_tidrange(TableScanDesc sscan, ScanDirection direction,
+						  TupleTableSlot *slot)
+{
+	HeapScanDesc scan = (HeapScanDesc) sscan;
+	ItemPointer mintid = &sscan->rs_mintid;
+	ItemPointer maxtid = &sscan->rs_maxtid;
+
+	/* Note: no locking manipulations needed */
+	for (;;)
+	{
+		if (sscan->rs_flags & SO_ALLOW_PAGEMODE)
+			heapgettup_pagemode(scan, direction, sscan->rs_nkeys, sscan->rs_key);
+		else
+			heapgettup(scan, direction, sscan->rs_nkeys, sscan->rs_key);
+
+		if (scan->rs_ctup.t_data == NULL)
+		{
+			ExecClearTuple(slot);
+			return false;
+		}
+
+		/*
+		 * heap_set_tidrange will have used heap_setscanlimits to limit the
+		 * range of pages we scan to only ones that can contain the TID range
+		 * we're scanning for.  Here we must filter out any tuples from these
+		 * pages that are outside of that range.
+		 */
+		if (ItemPointerCompare(&scan->rs_ctup.t_self, mintid) < 0)
+		{
+			ExecClearTuple(slot);
+
+			/*
+			 * When scanning backwards, the TIDs will be in descending order.
+			 * Future tuples in this direction will be lower still, so we can
+			 * just return false to indicate there will be no more tuples.
+			 */
+			if (ScanDirectionIsBackward(direction))
+				return false;
+
+			continue;
+		}
+
+		/*
+		 * Likewise for the final page, we must filter out TIDs greater than
+		 * maxtid.
+		 */
+		if (ItemPointerCompare(&scan->rs_ctup.t_self, maxtid) > 0)
+		{
+			ExecClearTuple(slot);
+
+			/*
+			 * When scanning forward, the TIDs will be in ascending order.
+			 * Future tuples in this direction will be higher still, so we can
+			 * just return false to indicate there will be no more tuples.
+			 */
+			if (ScanDirectionIsForward(direction))
+				return false;
+			continue;
+		}
+
+		break;
+	}
+
+	/*
+	 * if we get here it means we have a new current scan tuple, so point to
+	 * the proper return buffer and return the tuple.
+	 */
+	pgstat_count_heap_getnext(scan->rs_base.rs_rd);
+
+	ExecStoreBufferHeapTuple(&scan->rs_ctup, slot, scan->rs_cbuf);
+	return true;
+}
+
 /*
  *	heap_fetch		- retrieve tuple with given tid
  *
@@ -1810,6 +2079,11 @@ GetBulkInsertState(void)
 	bistate = (BulkInsertState) palloc(sizeof(BulkInsertStateData));
 	bistate->strategy = GetAccessStrategy(BAS_BULKWRITE);
 	bistate->current_buf = InvalidBuffer;
+	bistate->load_rel = NULL;
+	bistate->load_page = NULL;
+	bistate->load_page_valid = false;
+	bistate->load_first_blkno = InvalidBlockNumber;
+	bistate->load_blkno = InvalidBlockNumber;
 	return bistate;
 }
 
@@ -1819,6 +2093,34 @@ GetBulkInsertState(void)
 void
 FreeBulkInsertState(BulkInsertState bistate)
 {
+	/* Finish a bulk load, if there was one */
+	if (bistate->load_rel != NULL)
+	{
+		Relation	rel = bistate->load_rel;
+
+		if (bistate->load_page_valid)
+			heap_bulk_load_write_page(bistate);
+
+		/*
+		 * As in end_heap_rewrite(), WAL-logged pages that bypassed shared
+		 * buffers must be fsync'd by us, because a checkpoint that happened
+		 * while we were writing them didn't do it.
+		 */
+		RelationOpenSmgr(rel);
+		if (RelationNeedsWAL(rel))
+			smgrimmedsync(rel->rd_smgr, MAIN_FORKNUM);
+
+		/*
+		 * Every tuple was inserted frozen, so all the new pages are
+		 * all-visible and all-frozen.
+		 */
+		visibilitymap_set_range(rel, bistate->load_first_blkno,
+								bistate->load_blkno,
+								VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
+
+		pfree(bistate->load_page);
+	}
+
 	if (bistate->current_buf != InvalidBuffer)
 		ReleaseBuffer(bistate->current_buf);
 	FreeAccessStrategy(bistate->strategy);
@@ -2047,9 +2349,12 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
 	 * To allow parallel inserts, we need to ensure that they are safe to be
 	 * performed in workers. We have the infrastructure to allow parallel
 	 * inserts in general except for the cases where inserts generate a new
-	 * CommandId (eg. inserts into a table having a foreign key column).
+	 * CommandId (eg. inserts into a table having a foreign key column).  So
+	 * a worker may insert only if the leader marked the current command ID
+	 * as used before starting the parallel operation, as parallel COPY FROM
+	 * does.
 	 */
-	if (IsParallelWorker())
+	if (IsParallelWorker() && !IsCurrentCommandIdUsed())
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
 				 errmsg("cannot insert tuples in a parallel worker")));
@@ -2090,6 +2395,11 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
  * tuples can be inserted on a single page, we can write just a single WAL
  * record covering all of them, and only need to lock/unlock the page once.
  *
+ * With HEAP_INSERT_BULK_LOAD, when the relation's storage was created in
+ * the current transaction, the tuples are instead placed on pages built in
+ * private memory, which are written directly to storage as they fill up; see
+ * heap_bulk_load_tuples().
+ *
  * Note: this leaks memory into the current memory context. You can create a
  * temporary context before calling this, if that's a problem.
  */
@@ -2154,6 +2464,25 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 	CheckForSerializableConflictIn(relation, NULL, InvalidBlockNumber);
 
 	ndone = 0;
+
+	/*
+	 * Use the bulk load path if requested and possible.  Nobody else can see
+	 * storage created in our transaction, and if we fail it will simply be
+	 * thrown away.  Logical decoding needs the tuples in the WAL, which the
+	 * page images we write for the bulk load don't provide.
+	 */
+	if ((options & HEAP_INSERT_BULK_LOAD) &&
+		(options & HEAP_INSERT_FROZEN) &&
+		bistate != NULL &&
+		(relation->rd_createSubid != InvalidSubTransactionId ||
+		 relation->rd_firstRelfilenodeSubid != InvalidSubTransactionId) &&
+		!need_tuple_data && !need_cids)
+	{
+		heap_bulk_load_tuples(relation, heaptuples, ntuples, saveFreeSpace,
+							  bistate);
+		ndone = ntuples;
+	}
+
 	while (ndone < ntuples)
 	{
 		Buffer		buffer;
@@ -2371,6 +2700,111 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 	pgstat_count_heap_insert(relation, ntuples);
 }
 
+/*
+ * heap_bulk_load_tuples - heap_multi_insert() workhorse for bulk loads
+ *
+ * Much like raw_heap_insert() in rewriteheap.c, this fills pages in private
+ * memory and writes each one out, after WAL-logging it as a full-page image
+ * if needed, once the next tuple doesn't fit.  The last page stays in the
+ * BulkInsertState until more tuples arrive or FreeBulkInsertState() writes
+ * it out, which is also when the visibility map is updated for all of them.
+ *
+ * The tuples have already been prepared by heap_prepare_insert().
+ */
+static void
+heap_bulk_load_tuples(Relation relation, HeapTuple *heaptuples, int ntuples,
+					  Size saveFreeSpace, BulkInsertState bistate)
+{
+	Page		page;
+	int			i;
+
+	if (bistate->load_rel == NULL)
+	{
+		/* Release any pin left over from earlier, ordinary inserts */
+		ReleaseBulkInsertStatePin(bistate);
+
+		bistate->load_rel = relation;
+		bistate->load_page = (Page) palloc(BLCKSZ);
+		bistate->load_page_valid = false;
+		bistate->load_first_blkno = RelationGetNumberOfBlocks(relation);
+		bistate->load_blkno = bistate->load_first_blkno;
+	}
+	Assert(bistate->load_rel == relation);
+
+	page = bistate->load_page;
+
+	for (i = 0; i < ntuples; i++)
+	{
+		HeapTuple	heaptup = heaptuples[i];
+		Size		len = MAXALIGN(heaptup->t_len);
+		OffsetNumber offnum;
+		HeapTupleHeader item;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (len > MaxHeapTupleSize)
+			ereport(ERROR,
+					(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+					 errmsg("row is too big: size %zu, maximum size %zu",
+							len, MaxHeapTupleSize)));
+
+		/* Write out the current page if the tuple doesn't fit on it */
+		if (bistate->load_page_valid &&
+			len + saveFreeSpace > PageGetHeapFreeSpace(page))
+			heap_bulk_load_write_page(bistate);
+
+		if (!bistate->load_page_valid)
+		{
+			PageInit(page, BLCKSZ, 0);
+			bistate->load_page_valid = true;
+		}
+
+		offnum = PageAddItem(page, (Item) heaptup->t_data, heaptup->t_len,
+							 InvalidOffsetNumber, false, true);
+		if (offnum == InvalidOffsetNumber)
+			elog(ERROR, "failed to add tuple to page");
+
+		/* Set t_self and the stored tuple's ctid, as RelationPutHeapTuple() */
+		ItemPointerSet(&(heaptup->t_self), bistate->load_blkno, offnum);
+		item = (HeapTupleHeader) PageGetItem(page, PageGetItemId(page, offnum));
+		item->t_ctid = heaptup->t_self;
+	}
+}
+
+/*
+ * heap_bulk_load_write_page - write out the page being bulk loaded
+ */
+static void
+heap_bulk_load_write_page(BulkInsertState bistate)
+{
+	Relation	rel = bistate->load_rel;
+	Page		page = bistate->load_page;
+	BlockNumber blkno = bistate->load_blkno;
+
+	Assert(bistate->load_page_valid);
+
+	/* All the tuples are frozen; FreeBulkInsertState() sets the map bits */
+	PageSetAllVisible(page);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+		log_newpage(&rel->rd_node, MAIN_FORKNUM, blkno, page, true);
+
+	/*
+	 * Now write the page.  We say skipFsync = true because there's no need
+	 * for smgr to schedule an fsync for this write; FreeBulkInsertState()
+	 * does it, or the commit does for relations that skip WAL.
+	 */
+	RelationOpenSmgr(rel);
+
+	PageSetChecksumInplace(page, blkno);
+
+	smgrextend(rel->rd_smgr, MAIN_FORKNUM, blkno, (char *) page, true);
+
+	bistate->load_blkno++;
+	bistate->load_page_valid = false;
+}
+
 /*
  *	simple_heap_insert - insert a tuple
  *
@@ -2882,7 +3316,9 @@ simple_heap_delete(Relation relation, ItemPointer tid)
  *	heap_update - replace a tuple
  *
  * See table_tuple_update() for an explanation of the parameters, except that
- * this routine directly takes a tuple rather than a slot.
+ * this routine directly takes a tuple rather than a slot.  update_indexes may
+ * be NULL if the caller can't cope with TU_Summarizing; then changes to
+ * columns of summarizing indexes prevent a HOT update, like any others.
  *
  * In the failure cases, the routine fills *tmfd with the tuple's t_ctid,
  * t_xmax (resolving a possible MultiXact, if necessary), and t_cmax (the last
@@ -2892,11 +3328,13 @@ simple_heap_delete(Relation relation, ItemPointer tid)
 TM_Result
 heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 			CommandId cid, Snapshot crosscheck, bool wait,
-			TM_FailureData *tmfd, LockTupleMode *lockmode)
+			TM_FailureData *tmfd, LockTupleMode *lockmode,
+			TU_UpdateIndexes *update_indexes)
 {
 	TM_Result	result;
 	TransactionId xid = GetCurrentTransactionId();
 	Bitmapset  *hot_attrs;
+	Bitmapset  *sum_attrs;
 	Bitmapset  *key_attrs;
 	Bitmapset  *id_attrs;
 	Bitmapset  *interesting_attrs;
@@ -2919,6 +3357,7 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	bool		have_tuple_lock = false;
 	bool		iscombo;
 	bool		use_hot_update = false;
+	bool		summarized_update = false;
 	bool		hot_attrs_checked = false;
 	bool		key_intact;
 	bool		all_visible_cleared = false;
@@ -2954,13 +3393,26 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	 * deadlock if we try to fetch the list later.  In any case, the relcache
 	 * caches the data so this is usually pretty cheap.
 	 *
+	 * Columns that are only used by summarizing indexes don't block HOT
+	 * updates, but those indexes must still be told about the new tuple if
+	 * the columns change.
+	 *
 	 * We also need columns used by the replica identity and columns that are
 	 * considered the "key" of rows in the table.
 	 *
 	 * Note that we get copies of each bitmap, so we need not worry about
 	 * relcache flush happening midway through.
 	 */
-	hot_attrs = RelationGetIndexAttrBitmap(relation, INDEX_ATTR_BITMAP_ALL);
+	hot_attrs = RelationGetIndexAttrBitmap(relation,
+										   INDEX_ATTR_BITMAP_HOT_BLOCKING);
+	sum_attrs = RelationGetIndexAttrBitmap(relation,
+										   INDEX_ATTR_BITMAP_SUMMARIZED);
+	if (update_indexes == NULL)
+	{
+		hot_attrs = bms_add_members(hot_attrs, sum_attrs);
+		bms_free(sum_attrs);
+		sum_attrs = NULL;
+	}
 	key_attrs = RelationGetIndexAttrBitmap(relation, INDEX_ATTR_BITMAP_KEY);
 	id_attrs = RelationGetIndexAttrBitmap(relation,
 										  INDEX_ATTR_BITMAP_IDENTITY_KEY);
@@ -2985,6 +3437,7 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	if (!PageIsFull(page))
 	{
 		interesting_attrs = bms_add_members(interesting_attrs, hot_attrs);
+		interesting_attrs = bms_add_members(interesting_attrs, sum_attrs);
 		hot_attrs_checked = true;
 	}
 	interesting_attrs = bms_add_members(interesting_attrs, key_attrs);
@@ -3286,6 +3739,7 @@ l2:
 		if (vmbuffer != InvalidBuffer)
 			ReleaseBuffer(vmbuffer);
 		bms_free(hot_attrs);
+		bms_free(sum_attrs);
 		bms_free(key_attrs);
 		bms_free(id_attrs);
 		bms_free(modified_attrs);
@@ -3597,7 +4051,17 @@ l2:
 		 * for index columns, and also can't do a HOT update.
 		 */
 		if (hot_attrs_checked && !bms_overlap(modified_attrs, hot_attrs))
+		{
 			use_hot_update = true;
+
+			/*
+			 * Summarizing indexes only reference the block, so they can
+			 * cope with a heap-only tuple, but they still need an entry for
+			 * it if their columns changed.
+			 */
+			if (bms_overlap(modified_attrs, sum_attrs))
+				summarized_update = true;
+		}
 	}
 	else
 	{
@@ -3758,7 +4222,18 @@ l2:
 	if (old_key_tuple != NULL && old_key_copied)
 		heap_freetuple(old_key_tuple);
 
+	if (update_indexes)
+	{
+		if (!use_hot_update)
+			*update_indexes = TU_All;
+		else if (summarized_update)
+			*update_indexes = TU_Summarizing;
+		else
+			*update_indexes = TU_None;
+	}
+
 	bms_free(hot_attrs);
+	bms_free(sum_attrs);
 	bms_free(key_attrs);
 	bms_free(id_attrs);
 	bms_free(modified_attrs);
@@ -3891,7 +4366,7 @@ simple_heap_update(Relation relation, ItemPointer otid, HeapTuple tup)
 	result = heap_update(relation, otid, tup,
 						 GetCurrentCommandId(true), InvalidSnapshot,
 						 true /* wait for commit */ ,
-						 &tmfd, &lockmode);
+						 &tmfd, &lockmode, NULL);
 	switch (result)
 	{
 		case TM_SelfModified:
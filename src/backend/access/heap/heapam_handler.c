@@ -314,7 +314,7 @@ static TM_Result
 heapam_tuple_update(Relation relation, ItemPointer otid, TupleTableSlot *slot,
 					CommandId cid, Snapshot snapshot, Snapshot crosscheck,
 					bool wait, TM_FailureData *tmfd,
-					LockTupleMode *lockmode, bool *update_indexes)
+					LockTupleMode *lockmode, TU_UpdateIndexes *update_indexes)
 {
 	bool		shouldFree = true;
 	HeapTuple	tuple = ExecFetchSlotHeapTuple(slot, true, &shouldFree);
@@ -324,19 +324,19 @@ heapam_tuple_update(Relation relation, ItemPointer otid, TupleTableSlot *slot,
 	slot->tts_tableOid = RelationGetRelid(relation);
 	tuple->t_tableOid = slot->tts_tableOid;
 
-	result = heap_update(relation, otid, tuple, cid, crosscheck, wait,
-						 tmfd, lockmode);
-	ItemPointerCopy(&tuple->t_self, &slot->tts_tid);
-
 	/*
-	 * Decide whether new index entries are needed for the tuple
+	 * heap_update decides which indexes need new entries for the tuple: none
+	 * for a HOT update, unless columns of summarizing indexes changed.
 	 *
 	 * Note: heap_update returns the tid (location) of the new tuple in the
 	 * t_self field.
-	 *
-	 * If it's a HOT update, we mustn't insert new index entries.
 	 */
-	*update_indexes = result == TM_Ok && !HeapTupleIsHeapOnly(tuple);
+	*update_indexes = TU_None;
+	result = heap_update(relation, otid, tuple, cid, crosscheck, wait,
+						 tmfd, lockmode, update_indexes);
+	ItemPointerCopy(&tuple->t_self, &slot->tts_tid);
+	if (result != TM_Ok)
+		*update_indexes = TU_None;
 
 	if (shouldFree)
 		pfree(tuple);
@@ -2541,6 +2541,9 @@ static const TableAmRoutine heapam_methods = {
 	.scan_rescan = heap_rescan,
 	.scan_getnextslot = heap_getnextslot,
 
+	.scan_set_tidrange = heap_set_tidrange,
+	.scan_getnextslot_tidrange = heap_getnextslot_tidrange,
+
 	.parallelscan_estimate = table_block_parallelscan_estimate,
 	.parallelscan_initialize = table_block_parallelscan_initialize,
 	.parallelscan_reinitialize = table_block_parallelscan_reinitialize,
@@ -30,7 +30,17 @@
 #include "access/heaptoast.h"
 #include "access/toast_helper.h"
 #include "access/toast_internals.h"
+#include "catalog/catalog.h"
+#include "storage/bufmgr.h"
 #include "utils/fmgroids.h"
+#include "utils/spccache.h"
+
+/*
+ * Fetches of at least this many chunks read ahead in the toast relation;
+ * smaller values fit on a few pages, which are likely to be read together
+ * anyway.
+ */
+#define TOAST_PREFETCH_MIN_CHUNKS	(4 * EXTERN_TUPLES_PER_PAGE)
 
 
 /* ----------
@@ -640,6 +650,12 @@ heap_fetch_toast_slice(Relation toastrel, Oid valueid, int32 attrsize,
 	int			num_indexes;
 	int			validIndex;
 	SnapshotData SnapshotToast;
+#ifdef USE_PREFETCH
+	IndexScanDesc prefetchscan = NULL;
+	int32		prefetch_chunks = 0;
+	int32		prefetched_chunks = 0;
+	BlockNumber prefetch_blkno = InvalidBlockNumber;
+#endif
 
 	/* Look for the valid index of toast relation */
 	validIndex = toast_open_indexes(toastrel,
@@ -689,13 +705,43 @@ heap_fetch_toast_slice(Relation toastrel, Oid valueid, int32 attrsize,
 	toastscan = systable_beginscan_ordered(toastrel, toastidxs[validIndex],
 										   &SnapshotToast, nscankeys, toastkey);
 
+#ifdef USE_PREFETCH
+
+	/*
+	 * The chunks of a large value are spread over many pages of the toast
+	 * relation, and reading them one chunk at a time means waiting for each
+	 * page in turn.  To overlap those reads, run a second scan of the toast
+	 * index ahead of the main one, and prefetch the heap blocks it returns.
+	 * As in heap_compute_xid_horizon_for_tuples(), avoid the tablespace
+	 * lookup for catalogs.
+	 */
+	if (endchunk - startchunk + 1 >= TOAST_PREFETCH_MIN_CHUNKS)
+	{
+		int			prefetch_distance;
+
+		if (IsCatalogRelation(toastrel))
+			prefetch_distance = effective_io_concurrency;
+		else
+			prefetch_distance =
+				get_tablespace_io_concurrency(toastrel->rd_rel->reltablespace);
+
+		if (prefetch_distance > 0)
+		{
+			prefetch_chunks = prefetch_distance * EXTERN_TUPLES_PER_PAGE;
+			prefetchscan = index_beginscan(toastrel, toastidxs[validIndex],
+										   &SnapshotToast, nscankeys, 0);
+			index_rescan(prefetchscan, toastkey, nscankeys, NULL, 0);
+		}
+	}
+#endif
+
 	/*
 	 * Read the chunks by index
 	 *
 	 * The index is on (valueid, chunkidx) so they will come in order
 	 */
 	expectedchunk = startchunk;
-	while ((ttup = systable_getnext_ordered(toastscan, ForwardScanDirection)) != NULL)
+	for (;;)
 	{
 		int32		curchunk;
 		Pointer		chunk;
@@ -706,6 +752,33 @@ heap_fetch_toast_slice(Relation toastrel, Oid valueid, int32 attrsize,
 		int32		chcpystrt;
 		int32		chcpyend;
 
+#ifdef USE_PREFETCH
+		/* Keep the prefetch scan prefetch_chunks chunks ahead of us */
+		while (prefetchscan != NULL &&
+			   prefetched_chunks < expectedchunk - startchunk + prefetch_chunks)
+		{
+			ItemPointer tid = index_getnext_tid(prefetchscan,
+												ForwardScanDirection);
+
+			if (tid == NULL)
+			{
+				index_endscan(prefetchscan);
+				prefetchscan = NULL;
+				break;
+			}
+			if (ItemPointerGetBlockNumber(tid) != prefetch_blkno)
+			{
+				prefetch_blkno = ItemPointerGetBlockNumber(tid);
+				PrefetchBuffer(toastrel, MAIN_FORKNUM, prefetch_blkno);
+			}
+			prefetched_chunks++;
+		}
+#endif
+
+		ttup = systable_getnext_ordered(toastscan, ForwardScanDirection);
+		if (ttup == NULL)
+			break;
+
 		/*
 		 * Have a chunk, extract the sequence number and the data
 		 */
@@ -788,6 +861,10 @@ heap_fetch_toast_slice(Relation toastrel, Oid valueid, int32 attrsize,
 								 RelationGetRelationName(toastrel))));
 
 	/* End scan and close indexes. */
+#ifdef USE_PREFETCH
+	if (prefetchscan != NULL)
+		index_endscan(prefetchscan);
+#endif
 	systable_endscan_ordered(toastscan);
 	toast_close_indexes(toastidxs, num_indexes, AccessShareLock);
 }
@@ -194,10 +194,11 @@ GetVisibilityMapPins(Relation relation, Buffer buffer1, Buffer buffer2,
  * the result to some sane overall value.
  */
 static void
-RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
+RelationAddExtraBlocks(Relation relation)
 {
 	BlockNumber blockNum,
-				firstBlock = InvalidBlockNumber;
+				firstBlock;
+	Size		freespace;
 	int			extraBlocks;
 	int			lockWaiters;
 
@@ -214,53 +215,32 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 	 */
 	extraBlocks = Min(512, lockWaiters * 20);
 
-	do
-	{
-		Buffer		buffer;
-		Page		page;
-		Size		freespace;
-
-		/*
-		 * Extend by one page.  This should generally match the main-line
-		 * extension code in RelationGetBufferForTuple, except that we hold
-		 * the relation extension lock throughout, and we don't immediately
-		 * initialize the page (see below).
-		 */
-		buffer = ReadBufferBI(relation, P_NEW, RBM_ZERO_AND_LOCK, bistate);
-		page = BufferGetPage(buffer);
-
-		if (!PageIsNew(page))
-			elog(ERROR, "page %u of relation \"%s\" should be empty but is not",
-				 BufferGetBlockNumber(buffer),
-				 RelationGetRelationName(relation));
-
-		/*
-		 * Add the page to the FSM without initializing. If we were to
-		 * initialize here, the page would potentially get flushed out to disk
-		 * before we add any useful content. There's no guarantee that that'd
-		 * happen before a potential crash, so we need to deal with
-		 * uninitialized pages anyway, thus avoid the potential for
-		 * unnecessary writes.
-		 */
-
-		/* we'll need this info below */
-		blockNum = BufferGetBlockNumber(buffer);
-		freespace = BufferGetPageSize(buffer) - SizeOfPageHeaderData;
-
-		UnlockReleaseBuffer(buffer);
-
-		/* Remember first block number thus added. */
-		if (firstBlock == InvalidBlockNumber)
-			firstBlock = blockNum;
+	/*
+	 * Extend the file by all the blocks at once, with zeroed pages, without
+	 * reading them into shared buffers.  We hold the relation extension lock,
+	 * so nobody else can be extending the relation at the same time and the
+	 * current size is accurate.
+	 *
+	 * The pages aren't initialized.  If we were to initialize them here, they
+	 * would potentially get flushed out to disk before we add any useful
+	 * content. There's no guarantee that that'd happen before a potential
+	 * crash, so we need to deal with uninitialized pages anyway, thus avoid
+	 * the potential for unnecessary writes.  RelationGetBufferForTuple()
+	 * initializes them when it finds them through the FSM.
+	 */
+	firstBlock = RelationGetNumberOfBlocks(relation);
+	RelationOpenSmgr(relation);
+	smgrzeroextend(relation->rd_smgr, MAIN_FORKNUM, firstBlock, extraBlocks,
+				   false);
 
-		/*
-		 * Immediately update the bottom level of the FSM.  This has a good
-		 * chance of making this page visible to other concurrently inserting
-		 * backends, and we want that to happen without delay.
-		 */
+	/*
+	 * Immediately update the bottom level of the FSM.  This has a good chance
+	 * of making these pages visible to other concurrently inserting backends,
+	 * and we want that to happen without delay.
+	 */
+	freespace = BLCKSZ - SizeOfPageHeaderData;
+	for (blockNum = firstBlock; blockNum < firstBlock + extraBlocks; blockNum++)
 		RecordPageWithFreeSpace(relation, blockNum, freespace);
-	}
-	while (--extraBlocks > 0);
 
 	/*
 	 * Updating the upper levels of the free space map is too expensive to do
@@ -268,7 +248,7 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 	 * subsequent insertion activity sees all of those nifty free pages we
 	 * just inserted.
 	 */
-	FreeSpaceMapVacuumRange(relation, firstBlock, blockNum + 1);
+	FreeSpaceMapVacuumRange(relation, firstBlock, firstBlock + extraBlocks);
 }
 
 /*
@@ -589,7 +569,7 @@ loop:
 			}
 
 			/* Time to bulk-extend. */
-			RelationAddExtraBlocks(relation, bistate);
+			RelationAddExtraBlocks(relation);
 		}
 	}
 
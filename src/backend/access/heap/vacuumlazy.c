@@ -4,23 +4,26 @@
  *	  Concurrent ("lazy") vacuuming.
  *
  *
- * The major space usage for LAZY VACUUM is storage for the array of dead tuple
- * TIDs.  We want to ensure we can vacuum even the very largest relations with
- * finite memory space usage.  To do that, we set upper bounds on the number of
- * tuples we will keep track of at once.
+ * The major space usage for LAZY VACUUM is storage for the dead tuple TIDs.
+ * We want to ensure we can vacuum even the very largest relations with
+ * finite memory space usage.  To do that, we set upper bounds on the space
+ * used to keep track of dead tuples at once.
  *
  * We are willing to use at most maintenance_work_mem (or perhaps
  * autovacuum_work_mem) memory space to keep track of dead tuples.  We
- * initially allocate an array of TIDs of that size, with an upper limit that
- * depends on table size (this limit ensures we don't allocate a huge area
- * uselessly for vacuuming small tables).  If the array threatens to overflow,
- * we suspend the heap scan phase and perform a pass of index cleanup and page
- * compaction, then resume the heap scan with an empty TID array.
+ * initially allocate a dead tuple store of that size, with an upper limit
+ * that depends on table size (this limit ensures we don't allocate a huge
+ * area uselessly for vacuuming small tables).  The store groups the dead
+ * tuples by heap page, keeping only their offset numbers, or a bitmap of
+ * them when that is smaller, so it holds many more TIDs than a plain array
+ * of the same size would.  If the store threatens to overflow, we suspend
+ * the heap scan phase and perform a pass of index cleanup and page
+ * compaction, then resume the heap scan with an empty store.
  *
  * If we're processing a table with no indexes, we can just vacuum each page
  * as we go; there's no need to save up multiple tuples to minimize the number
  * of index scans performed.  So we don't use maintenance_work_mem memory for
- * the TID array, just enough to hold as many heap tuples as fit on one page.
+ * the dead tuple store, just enough to hold the dead tuples of one page.
  *
  * Lazy vacuum supports parallel execution with parallel worker processes.  In
  * a parallel vacuum, we perform both index vacuum and index cleanup with
@@ -37,6 +40,16 @@
  * parallel mode we update the index statistics after exiting from the
  * parallel mode.
  *
+ * If the table is large enough, the two passes over the heap are performed
+ * with parallel worker processes too.  In the first pass, the participants
+ * claim ranges of blocks to scan, reserving enough of the shared dead tuple
+ * space for every tuple on those blocks, and append the dead tuples they
+ * find to the shared array once they are done with a range.  When the space
+ * runs out, the leader sorts the array and performs a round of index and
+ * heap vacuuming before relaunching the workers to scan the rest of the
+ * heap.  In the second pass, the participants claim ranges of the sorted
+ * array, cut at page boundaries, and vacuum the corresponding pages.
+ *
  * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -74,6 +87,8 @@
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
+#include "storage/read_stream.h"
+#include "storage/spin.h"
 #include "tcop/tcopprot.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
@@ -111,19 +126,22 @@
 #define VACUUM_FSM_EVERY_PAGES \
 	((BlockNumber) (((uint64) 8 * 1024 * 1024 * 1024) / BLCKSZ))
 
-/*
- * Guesstimation of number of dead tuples per page.  This is used to
- * provide an upper limit to memory allocated when vacuuming small
- * tables.
- */
-#define LAZY_ALLOC_TUPLES		MaxHeapTuplesPerPage
-
 /*
  * Before we consider skipping a page that's marked as clean in
  * visibility map, we must've seen at least this many clean pages.
  */
 #define SKIP_PAGES_THRESHOLD	((BlockNumber) 32)
 
+/*
+ * Units of work handed out to the participants of the parallel heap passes:
+ * the number of blocks claimed at a time in the first pass, and the number
+ * of pages with dead tuples claimed at a time in the second pass.  The
+ * former is a multiple of SKIP_PAGES_THRESHOLD so that cutting a run of
+ * skippable blocks at the end of a range doesn't matter much.
+ */
+#define PARALLEL_VACUUM_SCAN_CHUNK	((BlockNumber) (8 * SKIP_PAGES_THRESHOLD))
+#define PARALLEL_VACUUM_HEAP_CHUNK	32
+
 /*
  * Size of the prefetch window for lazy vacuum backwards truncation scan.
  * Needs to be a power of 2.
@@ -147,6 +165,21 @@
  */
 #define ParallelVacuumIsActive(lps) PointerIsValid(lps)
 
+/*
+ * Macro to check if the heap passes use parallel workers in a parallel
+ * vacuum.
+ */
+#define ParallelHeapVacuumIsActive(lps) \
+	(ParallelVacuumIsActive(lps) && (lps)->nworkers_heap > 0)
+
+/* Tasks that parallel vacuum workers are launched for */
+typedef enum
+{
+	PARALLEL_VACUUM_INDEXES,	/* index vacuum or cleanup */
+	PARALLEL_VACUUM_SCAN_HEAP,	/* first heap pass */
+	PARALLEL_VACUUM_VACUUM_HEAP /* second heap pass */
+} LVParallelTask;
+
 /* Phases of vacuum during which we report error context. */
 typedef enum
 {
@@ -159,26 +192,86 @@ typedef enum
 } VacErrPhase;
 
 /*
- * LVDeadTuples stores the dead tuple TIDs collected during the heap scan.
- * This is allocated in the DSM segment in parallel mode and in local memory
- * in non-parallel mode.
+ * LVDeadTuples stores the dead tuple TIDs collected during the heap scan,
+ * grouped by heap page.  This is allocated in the DSM segment in parallel
+ * mode and in local memory in non-parallel mode.
+ *
+ * The space following the header is filled from both ends.  From the start
+ * grows the pages array, with an LVDeadPage for each heap page that has dead
+ * tuples.  From the end grow the dead offsets of those pages: for each page,
+ * a uint16 header followed by either a sorted array of its dead offset
+ * numbers, or a bitmap of them, whichever is smaller.  If the header has
+ * DEAD_OFFSETS_BITMAP set, the rest of it is the length of the bitmap in
+ * bytes, and bit (offnum - FirstOffsetNumber) is set for each dead offnum;
+ * otherwise the header is the number of offset numbers in the array.  Since
+ * the dead offsets are located by their offset from the start of the pages
+ * array rather than by pointers, parallel workers can use the same store.
  */
+typedef struct LVDeadPage
+{
+	BlockNumber blkno;			/* heap page with dead tuples */
+	uint32		dataoff;		/* location of its dead offsets */
+} LVDeadPage;
+
 typedef struct LVDeadTuples
 {
-	int			max_tuples;		/* # slots allocated in array */
-	int			num_tuples;		/* current # of entries */
-	/* List of TIDs of tuples we intend to delete */
-	/* NB: this list is ordered by TID address */
-	ItemPointerData itemptrs[FLEXIBLE_ARRAY_MEMBER];	/* array of
-														 * ItemPointerData */
+	uint32		max_bytes;		/* size of the space following the header */
+	uint32		data_start;		/* start of the dead offsets area */
+	int			num_pages;		/* current # of entries in pages array */
+	int64		num_tuples;		/* current # of dead tuples */
+	int64		max_tuples;		/* minimum # of dead tuples that fit */
+	/* NB: this array is ordered by block number */
+	LVDeadPage	pages[FLEXIBLE_ARRAY_MEMBER];
 } LVDeadTuples;
 
-/* The dead tuple space consists of LVDeadTuples and dead tuple TIDs */
-#define SizeOfDeadTuples(cnt) \
-	add_size(offsetof(LVDeadTuples, itemptrs), \
-			 mul_size(sizeof(ItemPointerData), cnt))
-#define MAXDEADTUPLES(max_size) \
-		(((max_size) - offsetof(LVDeadTuples, itemptrs)) / sizeof(ItemPointerData))
+#define DEAD_OFFSETS_BITMAP		0x8000
+
+/* The dead tuple space consists of LVDeadTuples and max_bytes of data */
+#define SizeOfDeadTuples(nbytes) \
+	add_size(offsetof(LVDeadTuples, pages), (nbytes))
+
+/* Get the dead offsets of a page in the pages array */
+#define DeadPageData(dead_tuples, deadpage) \
+	((uint16 *) ((char *) (dead_tuples)->pages + (deadpage)->dataoff))
+
+/*
+ * Maximum size of the dead offsets bitmap of a page, rounded up so that the
+ * dead offsets stay aligned, and the maximum space the dead tuples of one
+ * page can use.
+ */
+#define MaxDeadOffsetsBitmapSize \
+	(((MaxHeapTuplesPerPage + 15) / 16) * sizeof(uint16))
+#define MaxDeadPageSize \
+	(sizeof(LVDeadPage) + sizeof(uint16) + MaxDeadOffsetsBitmapSize)
+
+/*
+ * The minimum space one dead tuple can use, when it's the only dead tuple on
+ * its page.  This is used to compute the number of dead tuples we can store
+ * for progress reporting.
+ */
+#define MinDeadTupleSize \
+	(sizeof(LVDeadPage) + sizeof(uint16) + sizeof(OffsetNumber))
+
+/*
+ * Statistics that parallel vacuum workers gather during a round of the first
+ * heap pass, summed up in shared memory for the leader.  The fields mirror
+ * those of LVRelStats and LVHeapScanState.
+ */
+typedef struct LVScanCounts
+{
+	BlockNumber scanned_pages;
+	BlockNumber pinskipped_pages;
+	BlockNumber frozenskipped_pages;
+	BlockNumber tupcount_pages;
+	BlockNumber nonempty_pages; /* the maximum, not the sum */
+	BlockNumber empty_pages;
+	double		num_tuples;
+	double		live_tuples;
+	double		tups_vacuumed;
+	double		nkeep;
+	double		nunused;
+	TransactionId latestRemovedXid; /* the latest, not the sum */
+} LVScanCounts;
 
 /*
  * Shared information among parallel workers.  So this is allocated in the DSM
@@ -193,10 +286,13 @@ typedef struct LVShared
 	Oid			relid;
 	int			elevel;
 
+	/* The task that vacuum workers are launched for */
+	LVParallelTask task;
+
 	/*
-	 * An indication for vacuum workers to perform either index vacuum or
-	 * index cleanup.  first_time is true only if for_cleanup is true and
-	 * bulk-deletion is not performed yet.
+	 * For PARALLEL_VACUUM_INDEXES, an indication for vacuum workers to
+	 * perform either index vacuum or index cleanup.  first_time is true only
+	 * if for_cleanup is true and bulk-deletion is not performed yet.
 	 */
 	bool		for_cleanup;
 	bool		first_time;
@@ -238,6 +334,37 @@ typedef struct LVShared
 	 */
 	pg_atomic_uint32 active_nworkers;
 
+	/*
+	 * Fields for the heap passes.  The leader's vacuum parameters and
+	 * cutoffs are not modified during the lazy vacuum.
+	 */
+	VacuumParams params;
+	bool		aggressive;
+	TransactionId oldest_xmin;
+	TransactionId freeze_limit;
+	MultiXactId multixact_cutoff;
+	bool		eager_freeze_all;
+	BlockNumber rel_pages;
+
+	/*
+	 * Variables to control the heap passes, protected by mutex.
+	 *
+	 * In the first pass, next_block is the next block to be claimed, and
+	 * reserved_space is the dead tuple space reserved for the blocks claimed
+	 * but not yet finished.  scan_counts accumulates the workers' statistics
+	 * for the current round.  In the second pass, next_page is the next
+	 * entry of the dead tuples' pages array to be claimed, and
+	 * npages_vacuumed accumulates the number of pages the workers vacuumed.
+	 * latestRemovedXid is the cutoff the leader computed in the first pass.
+	 */
+	slock_t		mutex;
+	BlockNumber next_block;
+	Size		reserved_space;
+	LVScanCounts scan_counts;
+	int			next_page;
+	int			npages_vacuumed;
+	TransactionId latestRemovedXid;
+
 	/*
 	 * Variables to control parallel vacuum.  We have a bitmap to indicate
 	 * which index has stats in shared memory.  The set bit in the map
@@ -287,6 +414,12 @@ typedef struct LVParallelState
 	int			nindexes_parallel_bulkdel;
 	int			nindexes_parallel_cleanup;
 	int			nindexes_parallel_condcleanup;
+
+	/* The number of workers to launch for each heap pass */
+	int			nworkers_heap;
+
+	/* Have we launched workers yet? */
+	bool		launched;
 } LVParallelState;
 
 typedef struct LVRelStats
@@ -321,6 +454,61 @@ typedef struct LVRelStats
 	VacErrPhase phase;
 } LVRelStats;
 
+/*
+ * State of a participant in the first heap pass.  The counters are local to
+ * the participant; in a parallel vacuum the leader adds up those of the
+ * workers at the end of each round.
+ */
+typedef struct LVHeapScanState
+{
+	VacuumParams *params;
+	bool		aggressive;
+	int			nindexes;
+	TransactionId relfrozenxid;
+	MultiXactId relminmxid;
+	GlobalVisState *vistest;
+	LVDeadTuples *dead_tuples;	/* where to record dead tuples */
+	xl_heap_freeze_tuple *frozen;	/* workspace for heap_prepare_freeze_tuple */
+	Buffer		vmbuffer;
+	BlockNumber next_fsm_block_to_vacuum;
+	bool		parallel;		/* taking part in a parallel heap scan? */
+
+	/* Counters that follow are only for the log message */
+	BlockNumber empty_pages;
+	BlockNumber vacuumed_pages;
+	double		num_tuples;		/* total number of nonremovable tuples */
+	double		live_tuples;	/* live tuples (reltuples estimate) */
+	double		tups_vacuumed;	/* tuples cleaned up by current vacuum */
+	double		nkeep;			/* dead-but-not-removable tuples */
+	double		nunused;		/* # existing unused line pointers */
+} LVHeapScanState;
+
+/*
+ * State of the read stream of the first heap pass over a range of blocks,
+ * see lazy_scan_next_block.
+ */
+typedef struct LVScanStreamState
+{
+	Relation	onerel;
+	LVRelStats *vacrelstats;
+	LVHeapScanState *scanstate;
+	BlockNumber next_block;		/* next block to consider */
+	BlockNumber endblk;			/* end of the range */
+	BlockNumber next_unskippable_block;
+	bool		skipping_blocks;
+} LVScanStreamState;
+
+/*
+ * State of the read stream of the second heap pass over some of the pages
+ * with dead tuples, see lazy_vacuum_next_block.
+ */
+typedef struct LVVacuumStreamState
+{
+	LVDeadTuples *dead_tuples;
+	int			next_page;		/* next index into dead_tuples->pages */
+	int			endpage;
+} LVVacuumStreamState;
+
 /* Struct for saving and restoring vacuum error information. */
 typedef struct LVSavedErrInfo
 {
@@ -335,6 +523,7 @@ static int	elevel = -1;
 static TransactionId OldestXmin;
 static TransactionId FreezeLimit;
 static MultiXactId MultiXactCutoff;
+static bool EagerFreezeAll;		/* freeze every page that becomes all-visible? */
 
 static BufferAccessStrategy vac_strategy;
 
@@ -343,7 +532,45 @@ static BufferAccessStrategy vac_strategy;
 static void lazy_scan_heap(Relation onerel, VacuumParams *params,
 						   LVRelStats *vacrelstats, Relation *Irel, int nindexes,
 						   bool aggressive);
-static void lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats);
+static BlockNumber lazy_scan_heap_range(Relation onerel, LVRelStats *vacrelstats,
+										LVHeapScanState *scanstate,
+										BlockNumber startblk, BlockNumber endblk);
+static BlockNumber lazy_next_unskippable_block(Relation onerel,
+											   LVHeapScanState *scanstate,
+											   BlockNumber blkno, BlockNumber endblk);
+static BlockNumber lazy_scan_next_block(ReadStream *stream,
+										void *callback_private_data);
+static void lazy_count_skipped_blocks(Relation onerel,
+									  LVHeapScanState *scanstate,
+									  LVRelStats *vacrelstats,
+									  BlockNumber startblk,
+									  BlockNumber endblk);
+static BlockNumber lazy_vacuum_next_block(ReadStream *stream,
+										  void *callback_private_data);
+static void init_heap_scan_state(LVHeapScanState *scanstate, Relation onerel,
+								 VacuumParams *params, bool aggressive,
+								 int nindexes);
+static void lazy_parallel_scan_heap(Relation onerel, LVRelStats *vacrelstats,
+									LVHeapScanState *scanstate, Relation *Irel,
+									IndexBulkDeleteResult **indstats,
+									LVParallelState *lps, int nindexes);
+static void parallel_scan_heap(Relation onerel, LVShared *lvshared,
+							   LVDeadTuples *dead_tuples, LVRelStats *vacrelstats,
+							   LVHeapScanState *scanstate);
+static void parallel_heap_scan_report_stats(LVShared *lvshared,
+											LVRelStats *vacrelstats,
+											LVHeapScanState *scanstate);
+static void parallel_heap_scan_collect_stats(LVShared *lvshared,
+											 LVRelStats *vacrelstats,
+											 LVHeapScanState *scanstate);
+static void lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats,
+							 LVParallelState *lps);
+static int	lazy_vacuum_heap_range(Relation onerel, LVRelStats *vacrelstats,
+								   int startpage, int endpage, Buffer *vmbuffer);
+static int	lazy_parallel_vacuum_heap(Relation onerel, LVRelStats *vacrelstats,
+									  LVParallelState *lps);
+static int	parallel_vacuum_heap(Relation onerel, LVShared *lvshared,
+								 LVRelStats *vacrelstats);
 static bool lazy_check_needs_freeze(Buffer buf, bool *hastup,
 									LVRelStats *vacrelstats);
 static void lazy_vacuum_all_indexes(Relation onerel, Relation *Irel,
@@ -355,21 +582,34 @@ static void lazy_vacuum_index(Relation indrel, IndexBulkDeleteResult **stats,
 static void lazy_cleanup_index(Relation indrel,
 							   IndexBulkDeleteResult **stats,
 							   double reltuples, bool estimated_count, LVRelStats *vacrelstats);
-static int	lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-							 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer);
+static void lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
+							 int pageidx, LVRelStats *vacrelstats, Buffer *vmbuffer);
 static bool should_attempt_truncation(VacuumParams *params,
 									  LVRelStats *vacrelstats);
 static void lazy_truncate_heap(Relation onerel, LVRelStats *vacrelstats);
 static BlockNumber count_nondeletable_pages(Relation onerel,
 											LVRelStats *vacrelstats);
 static void lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks);
-static void lazy_record_dead_tuple(LVDeadTuples *dead_tuples,
-								   ItemPointer itemptr);
+static void lazy_reset_dead_tuples(LVDeadTuples *dead_tuples);
+static Size lazy_dead_tuples_free_space(LVDeadTuples *dead_tuples);
+static void lazy_record_dead_page(LVDeadTuples *dead_tuples, BlockNumber blkno,
+								  OffsetNumber *offsets, int noffsets);
+static int	lazy_get_dead_offsets(LVDeadTuples *dead_tuples, int pageidx,
+								  OffsetNumber *offsets);
 static bool lazy_tid_reaped(ItemPointer itemptr, void *state);
-static int	vac_cmp_itemptr(const void *left, const void *right);
+static int	vac_cmp_dead_page(const void *left, const void *right);
+static bool lazy_prepare_eager_freeze(Page page, TransactionId relfrozenxid,
+									  MultiXactId relminmxid,
+									  xl_heap_freeze_tuple *frozen,
+									  int *nfrozen, bool *all_frozen);
+static void lazy_execute_freeze(Relation onerel, Buffer buf,
+								TransactionId cutoff_xid,
+								xl_heap_freeze_tuple *frozen, int nfrozen);
 static bool heap_page_is_all_visible(Relation rel, Buffer buf,
 									 LVRelStats *vacrelstats,
 									 TransactionId *visibility_cutoff_xid, bool *all_frozen);
+static void launch_parallel_vacuum_workers(LVParallelState *lps, int nworkers);
+static void wait_for_parallel_vacuum_workers(LVParallelState *lps, int nworkers);
 static void lazy_parallel_vacuum_indexes(Relation *Irel, IndexBulkDeleteResult **stats,
 										 LVRelStats *vacrelstats, LVParallelState *lps,
 										 int nindexes);
@@ -385,15 +625,18 @@ static void vacuum_one_index(Relation indrel, IndexBulkDeleteResult **stats,
 static void lazy_cleanup_all_indexes(Relation *Irel, IndexBulkDeleteResult **stats,
 									 LVRelStats *vacrelstats, LVParallelState *lps,
 									 int nindexes);
-static long compute_max_dead_tuples(BlockNumber relblocks, bool hasindex);
+static Size compute_dead_tuples_space(BlockNumber relblocks, bool useindex);
 static int	compute_parallel_vacuum_workers(Relation *Irel, int nindexes, int nrequested,
 											bool *can_parallel_vacuum);
+static int	compute_parallel_heap_workers(BlockNumber nblocks, int nrequested);
 static void prepare_index_statistics(LVShared *lvshared, bool *can_parallel_vacuum,
 									 int nindexes);
 static void update_index_statistics(Relation *Irel, IndexBulkDeleteResult **stats,
 									int nindexes);
 static LVParallelState *begin_parallel_vacuum(Oid relid, Relation *Irel,
-											  LVRelStats *vacrelstats, BlockNumber nblocks,
+											  LVRelStats *vacrelstats,
+											  VacuumParams *params, bool aggressive,
+											  BlockNumber nblocks,
 											  int nindexes, int nrequested);
 static void end_parallel_vacuum(IndexBulkDeleteResult **stats,
 								LVParallelState *lps, int nindexes);
@@ -487,6 +730,9 @@ heap_vacuum_rel(Relation onerel, VacuumParams *params,
 	if (params->options & VACOPT_DISABLE_PAGE_SKIPPING)
 		aggressive = true;
 
+	/* Freeze every page that becomes all-visible on insert-mostly tables */
+	EagerFreezeAll = params->insert_mostly;
+
 	vacrelstats = (LVRelStats *) palloc0(sizeof(LVRelStats));
 
 	vacrelstats->relnamespace = get_namespace_name(RelationGetNamespace(onerel));
@@ -735,15 +981,16 @@ vacuum_log_cleanup_info(Relation rel, LVRelStats *vacrelstats)
  *
  *		If the table has at least two indexes, we execute both index vacuum
  *		and index cleanup with parallel workers unless parallel vacuum is
- *		disabled.  In a parallel vacuum, we enter parallel mode and then
- *		create both the parallel context and the DSM segment before starting
- *		heap scan so that we can record dead tuples to the DSM segment.  All
- *		parallel workers are launched at beginning of index vacuuming and
- *		index cleanup and they exit once done with all indexes.  At the end of
- *		this function we exit from parallel mode.  Index bulk-deletion results
- *		are stored in the DSM segment and we update index statistics for all
- *		the indexes after exiting from parallel mode since writes are not
- *		allowed during parallel mode.
+ *		disabled.  If the table is large enough, we also use parallel workers
+ *		for both passes over the heap, as long as it has at least one index.
+ *		In a parallel vacuum, we enter parallel mode and then create both the
+ *		parallel context and the DSM segment before starting heap scan so that
+ *		we can record dead tuples to the DSM segment.  Parallel workers are
+ *		launched at the beginning of each phase and they exit once done with
+ *		it.  At the end of this function we exit from parallel mode.  Index
+ *		bulk-deletion results are stored in the DSM segment and we update
+ *		index statistics for all the indexes after exiting from parallel mode
+ *		since writes are not allowed during parallel mode.
  *
  *		If there are no indexes then we can reclaim line pointers on the fly;
  *		dead line pointers need only be retained until all index pointers that
@@ -754,27 +1001,12 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			   Relation *Irel, int nindexes, bool aggressive)
 {
 	LVParallelState *lps = NULL;
+	LVHeapScanState scanstate;
 	LVDeadTuples *dead_tuples;
 	BlockNumber nblocks,
 				blkno;
-	HeapTupleData tuple;
-	TransactionId relfrozenxid = onerel->rd_rel->relfrozenxid;
-	TransactionId relminmxid = onerel->rd_rel->relminmxid;
-	BlockNumber empty_pages,
-				vacuumed_pages,
-				next_fsm_block_to_vacuum;
-	double		num_tuples,		/* total number of nonremovable tuples */
-				live_tuples,	/* live tuples (reltuples estimate) */
-				tups_vacuumed,	/* tuples cleaned up by vacuum */
-				nkeep,			/* dead-but-not-removable tuples */
-				nunused;		/* unused line pointers */
 	IndexBulkDeleteResult **indstats;
-	int			i;
 	PGRUsage	ru0;
-	Buffer		vmbuffer = InvalidBuffer;
-	BlockNumber next_unskippable_block;
-	bool		skipping_blocks;
-	xl_heap_freeze_tuple *frozen;
 	StringInfoData buf;
 	const int	initprog_index[] = {
 		PROGRESS_VACUUM_PHASE,
@@ -782,7 +1014,6 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		PROGRESS_VACUUM_MAX_DEAD_TUPLES
 	};
 	int64		initprog_val[3];
-	GlobalVisState *vistest;
 
 	pg_rusage_init(&ru0);
 
@@ -797,10 +1028,6 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 						vacrelstats->relnamespace,
 						vacrelstats->relname)));
 
-	empty_pages = vacuumed_pages = 0;
-	next_fsm_block_to_vacuum = (BlockNumber) 0;
-	num_tuples = live_tuples = tups_vacuumed = nkeep = nunused = 0;
-
 	indstats = (IndexBulkDeleteResult **)
 		palloc0(nindexes * sizeof(IndexBulkDeleteResult *));
 
@@ -811,14 +1038,16 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	vacrelstats->nonempty_pages = 0;
 	vacrelstats->latestRemovedXid = InvalidTransactionId;
 
-	vistest = GlobalVisTestFor(onerel);
+	init_heap_scan_state(&scanstate, onerel, params, aggressive, nindexes);
 
 	/*
 	 * Initialize state for a parallel vacuum.  As of now, only one worker can
-	 * be used for an index, so we invoke parallelism only if there are at
-	 * least two indexes on a table.
+	 * be used for an index, so index vacuuming and cleanup are performed in
+	 * parallel only if there are at least two indexes on a table.  The heap
+	 * passes can use parallel workers even with a single index, though, if
+	 * the table is large enough; see begin_parallel_vacuum.
 	 */
-	if (params->nworkers >= 0 && vacrelstats->useindex && nindexes > 1)
+	if (params->nworkers >= 0 && vacrelstats->useindex)
 	{
 		/*
 		 * Since parallel workers cannot access data in temporary tables, we
@@ -837,8 +1066,8 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		}
 		else
 			lps = begin_parallel_vacuum(RelationGetRelid(onerel), Irel,
-										vacrelstats, nblocks, nindexes,
-										params->nworkers);
+										vacrelstats, params, aggressive,
+										nblocks, nindexes, params->nworkers);
 	}
 
 	/*
@@ -849,7 +1078,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		lazy_space_alloc(vacrelstats, nblocks);
 
 	dead_tuples = vacrelstats->dead_tuples;
-	frozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
+	scanstate.dead_tuples = dead_tuples;
 
 	/* Report that we're scanning the heap, advertising total # of blocks */
 	initprog_val[0] = PROGRESS_VACUUM_PHASE_SCAN_HEAP;
@@ -857,6 +1086,200 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	initprog_val[2] = dead_tuples->max_tuples;
 	pgstat_progress_update_multi_param(3, initprog_index, initprog_val);
 
+	if (ParallelHeapVacuumIsActive(lps))
+		lazy_parallel_scan_heap(onerel, vacrelstats, &scanstate, Irel,
+								indstats, lps, nindexes);
+	else
+	{
+		blkno = 0;
+		while ((blkno = lazy_scan_heap_range(onerel, vacrelstats, &scanstate,
+											 blkno, nblocks)) < nblocks)
+		{
+			/*
+			 * We ran low on space for dead-tuple TIDs before blkno, so do a
+			 * cycle of vacuuming before we go on.
+			 *
+			 * Before beginning index vacuuming, we release any pin we may
+			 * hold on the visibility map page.  This isn't necessary for
+			 * correctness, but we do it anyway to avoid holding the pin
+			 * across a lengthy, unrelated operation.
+			 */
+			if (BufferIsValid(scanstate.vmbuffer))
+			{
+				ReleaseBuffer(scanstate.vmbuffer);
+				scanstate.vmbuffer = InvalidBuffer;
+			}
+
+			/* Work on all the indexes, then the heap */
+			lazy_vacuum_all_indexes(onerel, Irel, indstats,
+									vacrelstats, lps, nindexes);
+
+			/* Remove tuples from heap */
+			lazy_vacuum_heap(onerel, vacrelstats, lps);
+
+			/*
+			 * Forget the now-vacuumed tuples, and press on, but be careful
+			 * not to reset latestRemovedXid since we want that value to be
+			 * valid.
+			 */
+			lazy_reset_dead_tuples(dead_tuples);
+
+			/*
+			 * Vacuum the Free Space Map to make newly-freed space visible on
+			 * upper-level FSM pages.  Note we have not yet processed blkno.
+			 */
+			FreeSpaceMapVacuumRange(onerel, scanstate.next_fsm_block_to_vacuum,
+									blkno);
+			scanstate.next_fsm_block_to_vacuum = blkno;
+
+			/* Report that we are once again scanning the heap */
+			pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+										 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
+		}
+	}
+
+
+	/* report that everything is scanned and vacuumed */
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, nblocks);
+
+	/* Clear the block number information */
+	vacrelstats->blkno = InvalidBlockNumber;
+
+	pfree(scanstate.frozen);
+
+	/* save stats for use later */
+	vacrelstats->tuples_deleted = scanstate.tups_vacuumed;
+	vacrelstats->new_dead_tuples = scanstate.nkeep;
+
+	/* now we can compute the new value for pg_class.reltuples */
+	vacrelstats->new_live_tuples = vac_estimate_reltuples(onerel,
+														  nblocks,
+														  vacrelstats->tupcount_pages,
+														  scanstate.live_tuples);
+
+	/*
+	 * Also compute the total number of surviving heap entries.  In the
+	 * (unlikely) scenario that new_live_tuples is -1, take it as zero.
+	 */
+	vacrelstats->new_rel_tuples =
+		Max(vacrelstats->new_live_tuples, 0) + vacrelstats->new_dead_tuples;
+
+	/*
+	 * Release any remaining pin on visibility map page.
+	 */
+	if (BufferIsValid(scanstate.vmbuffer))
+	{
+		ReleaseBuffer(scanstate.vmbuffer);
+		scanstate.vmbuffer = InvalidBuffer;
+	}
+
+	/* If any tuples need to be deleted, perform final vacuum cycle */
+	/* XXX put a threshold on min number of tuples here? */
+	if (dead_tuples->num_tuples > 0)
+	{
+		/* Work on all the indexes, and then the heap */
+		lazy_vacuum_all_indexes(onerel, Irel, indstats, vacrelstats,
+								lps, nindexes);
+
+		/* Remove tuples from heap */
+		lazy_vacuum_heap(onerel, vacrelstats, lps);
+	}
+
+	/*
+	 * Vacuum the remainder of the Free Space Map.  We must do this whether or
+	 * not there were indexes.
+	 */
+	if (nblocks > scanstate.next_fsm_block_to_vacuum)
+		FreeSpaceMapVacuumRange(onerel, scanstate.next_fsm_block_to_vacuum,
+								nblocks);
+
+	/* report all blocks vacuumed */
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, nblocks);
+
+	/* Do post-vacuum cleanup */
+	if (vacrelstats->useindex)
+		lazy_cleanup_all_indexes(Irel, indstats, vacrelstats, lps, nindexes);
+
+	/*
+	 * End parallel mode before updating index statistics as we cannot write
+	 * during parallel mode.
+	 */
+	if (ParallelVacuumIsActive(lps))
+		end_parallel_vacuum(indstats, lps, nindexes);
+
+	/* Update index statistics */
+	update_index_statistics(Irel, indstats, nindexes);
+
+	/* If no indexes, make log report that lazy_vacuum_heap would've made */
+	if (scanstate.vacuumed_pages)
+		ereport(elevel,
+				(errmsg("\"%s\": removed %.0f row versions in %u pages",
+						vacrelstats->relname,
+						scanstate.tups_vacuumed, scanstate.vacuumed_pages)));
+
+	/*
+	 * This is pretty messy, but we split it up so that we can skip emitting
+	 * individual parts of the message when not applicable.
+	 */
+	initStringInfo(&buf);
+	appendStringInfo(&buf,
+					 _("%.0f dead row versions cannot be removed yet, oldest xmin: %u\n"),
+					 scanstate.nkeep, OldestXmin);
+	appendStringInfo(&buf, _("There were %.0f unused item identifiers.\n"),
+					 scanstate.nunused);
+	appendStringInfo(&buf, ngettext("Skipped %u page due to buffer pins, ",
+									"Skipped %u pages due to buffer pins, ",
+									vacrelstats->pinskipped_pages),
+					 vacrelstats->pinskipped_pages);
+	appendStringInfo(&buf, ngettext("%u frozen page.\n",
+									"%u frozen pages.\n",
+									vacrelstats->frozenskipped_pages),
+					 vacrelstats->frozenskipped_pages);
+	appendStringInfo(&buf, ngettext("%u page is entirely empty.\n",
+									"%u pages are entirely empty.\n",
+									scanstate.empty_pages),
+					 scanstate.empty_pages);
+	appendStringInfo(&buf, _("%s."), pg_rusage_show(&ru0));
+
+	ereport(elevel,
+			(errmsg("\"%s\": found %.0f removable, %.0f nonremovable row versions in %u out of %u pages",
+					vacrelstats->relname,
+					scanstate.tups_vacuumed, scanstate.num_tuples,
+					vacrelstats->scanned_pages, nblocks),
+			 errdetail_internal("%s", buf.data)));
+	pfree(buf.data);
+}
+
+
+/*
+ *	lazy_scan_heap_range() -- first heap pass over a range of blocks
+ *
+ *		This processes the blocks from startblk up to endblk as described for
+ *		lazy_scan_heap, recording dead tuples in scanstate->dead_tuples.  If
+ *		that space runs low, we stop before the next block we would process
+ *		and return its number, so that the caller can vacuum the indexes and
+ *		the heap before calling us again for the rest of the range.  Otherwise
+ *		the return value is endblk.
+ */
+static BlockNumber
+lazy_scan_heap_range(Relation onerel, LVRelStats *vacrelstats,
+					 LVHeapScanState *scanstate,
+					 BlockNumber startblk, BlockNumber endblk)
+{
+	VacuumParams *params = scanstate->params;
+	bool		aggressive = scanstate->aggressive;
+	LVDeadTuples *dead_tuples = scanstate->dead_tuples;
+	xl_heap_freeze_tuple *frozen = scanstate->frozen;
+	BlockNumber nblocks = vacrelstats->rel_pages;
+	BlockNumber blkno;
+	BlockNumber next_blkno = startblk;
+	HeapTupleData tuple;
+	LVScanStreamState streamstate;
+	ReadStream *stream;
+	Buffer		buf;
+	OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
+	int			ndead;
+
 	/*
 	 * Except when aggressive is set, we want to skip pages that are
 	 * all-visible according to the visibility map, but only when we can skip
@@ -872,12 +1295,16 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	 * such pages do not need freezing and do not affect the value that we can
 	 * safely set for relfrozenxid or relminmxid.
 	 *
-	 * Before entering the main loop, establish the invariant that
-	 * next_unskippable_block is the next block number >= blkno that we can't
-	 * skip based on the visibility map, either all-visible for a regular scan
-	 * or all-frozen for an aggressive scan.  We set it to nblocks if there's
-	 * no such block.  We also set up the skipping_blocks flag correctly at
-	 * this stage.
+	 * The blocks to process are produced by lazy_scan_next_block(), the
+	 * callback of a read stream, so that they can be read ahead of time and
+	 * in larger chunks.  Before creating the stream, establish the invariant
+	 * that next_unskippable_block is the next block number >= the stream's
+	 * next_block that we can't skip based on the visibility map, either
+	 * all-visible for a regular scan or all-frozen for an aggressive scan.
+	 * We set it to endblk if there's no such block.  We also set up the
+	 * skipping_blocks flag correctly at this stage.  (A run of skippable
+	 * blocks is thus cut off at the end of the range; in a parallel heap
+	 * scan, the ranges are large enough for that not to matter much.)
 	 *
 	 * Note: The value returned by visibilitymap_get_status could be slightly
 	 * out-of-date, since we make this test before reading the corresponding
@@ -901,47 +1328,35 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	 * the last page.  This is worth avoiding mainly because such a lock must
 	 * be replayed on any hot standby, where it can be disruptive.
 	 */
-	next_unskippable_block = 0;
-	if ((params->options & VACOPT_DISABLE_PAGE_SKIPPING) == 0)
-	{
-		while (next_unskippable_block < nblocks)
-		{
-			uint8		vmstatus;
-
-			vmstatus = visibilitymap_get_status(onerel, next_unskippable_block,
-												&vmbuffer);
-			if (aggressive)
-			{
-				if ((vmstatus & VISIBILITYMAP_ALL_FROZEN) == 0)
-					break;
-			}
-			else
-			{
-				if ((vmstatus & VISIBILITYMAP_ALL_VISIBLE) == 0)
-					break;
-			}
-			vacuum_delay_point();
-			next_unskippable_block++;
-		}
-	}
-
-	if (next_unskippable_block >= SKIP_PAGES_THRESHOLD)
-		skipping_blocks = true;
+	streamstate.onerel = onerel;
+	streamstate.vacrelstats = vacrelstats;
+	streamstate.scanstate = scanstate;
+	streamstate.next_block = startblk;
+	streamstate.endblk = endblk;
+	streamstate.next_unskippable_block =
+		lazy_next_unskippable_block(onerel, scanstate, startblk, endblk);
+
+	if (streamstate.next_unskippable_block - startblk >= SKIP_PAGES_THRESHOLD)
+		streamstate.skipping_blocks = true;
 	else
-		skipping_blocks = false;
+		streamstate.skipping_blocks = false;
+
+	stream = read_stream_begin_relation(READ_STREAM_MAINTENANCE,
+										onerel, MAIN_FORKNUM, vac_strategy,
+										lazy_scan_next_block, &streamstate);
 
-	for (blkno = 0; blkno < nblocks; blkno++)
+	while ((buf = read_stream_next_buffer(stream)) != InvalidBuffer)
 	{
-		Buffer		buf;
 		Page		page;
 		OffsetNumber offnum,
 					maxoff;
 		bool		tupgone,
 					hastup;
-		int			prev_dead_count;
 		int			nfrozen;
+		int			npruned;
+		TransactionId freeze_cutoff = FreezeLimit;
 		Size		freespace;
-		bool		all_visible_according_to_vm = false;
+		bool		all_visible_according_to_vm;
 		bool		all_visible;
 		bool		all_frozen = true;	/* provided all_visible is also true */
 		bool		has_dead_tuples;
@@ -951,144 +1366,51 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 #define FORCE_CHECK_PAGE() \
 		(blkno == nblocks - 1 && should_attempt_truncation(params, vacrelstats))
 
-		pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
-
-		update_vacuum_error_info(vacrelstats, NULL, VACUUM_ERRCB_PHASE_SCAN_HEAP,
-								 blkno, InvalidOffsetNumber);
-
-		if (blkno == next_unskippable_block)
-		{
-			/* Time to advance next_unskippable_block */
-			next_unskippable_block++;
-			if ((params->options & VACOPT_DISABLE_PAGE_SKIPPING) == 0)
-			{
-				while (next_unskippable_block < nblocks)
-				{
-					uint8		vmskipflags;
+		blkno = BufferGetBlockNumber(buf);
 
-					vmskipflags = visibilitymap_get_status(onerel,
-														   next_unskippable_block,
-														   &vmbuffer);
-					if (aggressive)
-					{
-						if ((vmskipflags & VISIBILITYMAP_ALL_FROZEN) == 0)
-							break;
-					}
-					else
-					{
-						if ((vmskipflags & VISIBILITYMAP_ALL_VISIBLE) == 0)
-							break;
-					}
-					vacuum_delay_point();
-					next_unskippable_block++;
-				}
-			}
+		/* Account for the blocks that the stream skipped */
+		lazy_count_skipped_blocks(onerel, scanstate, vacrelstats,
+								  next_blkno, blkno);
+		next_blkno = blkno + 1;
 
-			/*
-			 * We know we can't skip the current block.  But set up
-			 * skipping_blocks to do the right thing at the following blocks.
-			 */
-			if (next_unskippable_block - blkno > SKIP_PAGES_THRESHOLD)
-				skipping_blocks = true;
-			else
-				skipping_blocks = false;
+		/* in a parallel heap scan, the leader reports progress */
+		if (!scanstate->parallel)
+			pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED,
+										 blkno);
 
-			/*
-			 * Normally, the fact that we can't skip this block must mean that
-			 * it's not all-visible.  But in an aggressive vacuum we know only
-			 * that it's not all-frozen, so it might still be all-visible.
-			 */
-			if (aggressive && VM_ALL_VISIBLE(onerel, blkno, &vmbuffer))
-				all_visible_according_to_vm = true;
-		}
-		else
-		{
-			/*
-			 * The current block is potentially skippable; if we've seen a
-			 * long enough run of skippable blocks to justify skipping it, and
-			 * we're not forced to check it, then go ahead and skip.
-			 * Otherwise, the page must be at least all-visible if not
-			 * all-frozen, so we can set all_visible_according_to_vm = true.
-			 */
-			if (skipping_blocks && !FORCE_CHECK_PAGE())
-			{
-				/*
-				 * Tricky, tricky.  If this is in aggressive vacuum, the page
-				 * must have been all-frozen at the time we checked whether it
-				 * was skippable, but it might not be any more.  We must be
-				 * careful to count it as a skipped all-frozen page in that
-				 * case, or else we'll think we can't update relfrozenxid and
-				 * relminmxid.  If it's not an aggressive vacuum, we don't
-				 * know whether it was all-frozen, so we have to recheck; but
-				 * in this case an approximate answer is OK.
-				 */
-				if (aggressive || VM_ALL_FROZEN(onerel, blkno, &vmbuffer))
-					vacrelstats->frozenskipped_pages++;
-				continue;
-			}
-			all_visible_according_to_vm = true;
-		}
+		update_vacuum_error_info(vacrelstats, NULL, VACUUM_ERRCB_PHASE_SCAN_HEAP,
+								 blkno, InvalidOffsetNumber);
 
 		vacuum_delay_point();
 
 		/*
 		 * If we are close to overrunning the available space for dead-tuple
-		 * TIDs, pause and do a cycle of vacuuming before we tackle this page.
+		 * TIDs, stop so that the caller can do a cycle of vacuuming before we
+		 * tackle this page.
 		 */
-		if ((dead_tuples->max_tuples - dead_tuples->num_tuples) < MaxHeapTuplesPerPage &&
-			dead_tuples->num_tuples > 0)
+		if (lazy_dead_tuples_free_space(dead_tuples) < MaxDeadPageSize &&
+			dead_tuples->num_pages > 0)
 		{
-			/*
-			 * Before beginning index vacuuming, we release any pin we may
-			 * hold on the visibility map page.  This isn't necessary for
-			 * correctness, but we do it anyway to avoid holding the pin
-			 * across a lengthy, unrelated operation.
-			 */
-			if (BufferIsValid(vmbuffer))
-			{
-				ReleaseBuffer(vmbuffer);
-				vmbuffer = InvalidBuffer;
-			}
-
-			/* Work on all the indexes, then the heap */
-			lazy_vacuum_all_indexes(onerel, Irel, indstats,
-									vacrelstats, lps, nindexes);
-
-			/* Remove tuples from heap */
-			lazy_vacuum_heap(onerel, vacrelstats);
-
-			/*
-			 * Forget the now-vacuumed tuples, and press on, but be careful
-			 * not to reset latestRemovedXid since we want that value to be
-			 * valid.
-			 */
-			dead_tuples->num_tuples = 0;
-
-			/*
-			 * Vacuum the Free Space Map to make newly-freed space visible on
-			 * upper-level FSM pages.  Note we have not yet processed blkno.
-			 */
-			FreeSpaceMapVacuumRange(onerel, next_fsm_block_to_vacuum, blkno);
-			next_fsm_block_to_vacuum = blkno;
-
-			/* Report that we are once again scanning the heap */
-			pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
-										 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
+			ReleaseBuffer(buf);
+			read_stream_end(stream);
+			return blkno;
 		}
 
 		/*
-		 * Pin the visibility map page in case we need to mark the page
-		 * all-visible.  In most cases this will be very cheap, because we'll
-		 * already have the correct page pinned anyway.  However, it's
-		 * possible that (a) next_unskippable_block is covered by a different
-		 * VM page than the current block or (b) we released our pin and did a
-		 * cycle of index vacuuming.
-		 *
+		 * The stream returns blocks that aren't all-visible, or all-frozen in
+		 * an aggressive scan, and blocks in runs of skippable blocks too
+		 * short to be worth skipping.  Check which case this is.  (In an
+		 * aggressive scan, an unskippable block might still be all-visible.)
 		 */
-		visibilitymap_pin(onerel, blkno, &vmbuffer);
+		all_visible_according_to_vm = VM_ALL_VISIBLE(onerel, blkno,
+													 &scanstate->vmbuffer);
 
-		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, blkno,
-								 RBM_NORMAL, vac_strategy);
+		/*
+		 * Pin the visibility map page in case we need to mark the page
+		 * all-visible.  That's very cheap, because the check above pinned the
+		 * correct page already.
+		 */
+		visibilitymap_pin(onerel, blkno, &scanstate->vmbuffer);
 
 		/* We need buffer cleanup lock so that we can prune HOT chains. */
 		if (!ConditionalLockBufferForCleanup(buf))
@@ -1177,7 +1499,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			 */
 			UnlockReleaseBuffer(buf);
 
-			empty_pages++;
+			scanstate->empty_pages++;
 
 			if (GetRecordedFreeSpace(onerel, blkno) == 0)
 			{
@@ -1191,7 +1513,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 
 		if (PageIsEmpty(page))
 		{
-			empty_pages++;
+			scanstate->empty_pages++;
 			freespace = PageGetHeapFreeSpace(page);
 
 			/*
@@ -1221,7 +1543,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 
 				PageSetAllVisible(page);
 				visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-								  vmbuffer, InvalidTransactionId,
+								  scanstate->vmbuffer, InvalidTransactionId,
 								  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
 				END_CRIT_SECTION();
 			}
@@ -1236,10 +1558,11 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		 *
 		 * We count tuples removed by the pruning step as removed by VACUUM.
 		 */
-		tups_vacuumed += heap_page_prune(onerel, buf, vistest, false,
-										 InvalidTransactionId, 0,
-										 &vacrelstats->latestRemovedXid,
-										 &vacrelstats->offnum);
+		npruned = heap_page_prune(onerel, buf, scanstate->vistest, false,
+								  InvalidTransactionId, 0,
+								  &vacrelstats->latestRemovedXid,
+								  &vacrelstats->offnum);
+		scanstate->tups_vacuumed += npruned;
 
 		/*
 		 * Now scan the page to collect vacuumable items and check for tuples
@@ -1249,7 +1572,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		has_dead_tuples = false;
 		nfrozen = 0;
 		hastup = false;
-		prev_dead_count = dead_tuples->num_tuples;
+		ndead = 0;
 		maxoff = PageGetMaxOffsetNumber(page);
 
 		/*
@@ -1272,7 +1595,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			/* Unused items require no processing, but we count 'em */
 			if (!ItemIdIsUsed(itemid))
 			{
-				nunused += 1;
+				scanstate->nunused += 1;
 				continue;
 			}
 
@@ -1293,7 +1616,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			 */
 			if (ItemIdIsDead(itemid))
 			{
-				lazy_record_dead_tuple(dead_tuples, &(tuple.t_self));
+				deadoffsets[ndead++] = offnum;
 				all_visible = false;
 				continue;
 			}
@@ -1350,7 +1673,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 					if (HeapTupleIsHotUpdated(&tuple) ||
 						HeapTupleIsHeapOnly(&tuple) ||
 						params->index_cleanup == VACOPT_TERNARY_DISABLED)
-						nkeep += 1;
+						scanstate->nkeep += 1;
 					else
 						tupgone = true; /* we can delete the tuple */
 					all_visible = false;
@@ -1361,7 +1684,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 					 * Count it as live.  Not only is this natural, but it's
 					 * also what acquire_sample_rows() does.
 					 */
-					live_tuples += 1;
+					scanstate->live_tuples += 1;
 
 					/*
 					 * Is the tuple definitely visible to all transactions?
@@ -1404,7 +1727,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 					 * If tuple is recently deleted then we must not remove it
 					 * from relation.
 					 */
-					nkeep += 1;
+					scanstate->nkeep += 1;
 					all_visible = false;
 					break;
 				case HEAPTUPLE_INSERT_IN_PROGRESS:
@@ -1430,7 +1753,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 					 * deleting transaction will commit and update the
 					 * counters after we report.
 					 */
-					live_tuples += 1;
+					scanstate->live_tuples += 1;
 					break;
 				default:
 					elog(ERROR, "unexpected HeapTupleSatisfiesVacuum result");
@@ -1439,17 +1762,17 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 
 			if (tupgone)
 			{
-				lazy_record_dead_tuple(dead_tuples, &(tuple.t_self));
+				deadoffsets[ndead++] = offnum;
 				HeapTupleHeaderAdvanceLatestRemovedXid(tuple.t_data,
 													   &vacrelstats->latestRemovedXid);
-				tups_vacuumed += 1;
+				scanstate->tups_vacuumed += 1;
 				has_dead_tuples = true;
 			}
 			else
 			{
 				bool		tuple_totally_frozen;
 
-				num_tuples += 1;
+				scanstate->num_tuples += 1;
 				hastup = true;
 
 				/*
@@ -1457,7 +1780,8 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 				 * freezing.  Note we already have exclusive buffer lock.
 				 */
 				if (heap_prepare_freeze_tuple(tuple.t_data,
-											  relfrozenxid, relminmxid,
+											  scanstate->relfrozenxid,
+											  scanstate->relminmxid,
 											  FreezeLimit, MultiXactCutoff,
 											  &frozen[nfrozen],
 											  &tuple_totally_frozen))
@@ -1468,47 +1792,45 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			}
 		}						/* scan along page */
 
+		/* Remember the dead tuples of the page */
+		if (ndead > 0)
+		{
+			lazy_record_dead_page(dead_tuples, blkno, deadoffsets, ndead);
+
+			if (!scanstate->parallel)
+				pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
+											 dead_tuples->num_tuples);
+		}
+
 		/*
 		 * Clear the offset information once we have processed all the tuples
 		 * on the page.
 		 */
 		vacrelstats->offnum = InvalidOffsetNumber;
 
+		/*
+		 * If the page is about to be marked all-visible but not all-frozen,
+		 * consider freezing all of it now, so that a later aggressive vacuum
+		 * doesn't have to read and dirty it again.  That is cheap if this
+		 * vacuum is dirtying and WAL-logging the page anyway, because it
+		 * pruned or froze something on it.  It's also worth it on tables that
+		 * are mostly inserted into, whose pages are unlikely to be modified
+		 * again.
+		 */
+		if (all_visible && !all_frozen && vacuum_eager_freeze &&
+			(EagerFreezeAll || npruned > 0 || nfrozen > 0) &&
+			lazy_prepare_eager_freeze(page, scanstate->relfrozenxid,
+									  scanstate->relminmxid, frozen,
+									  &nfrozen, &all_frozen))
+			freeze_cutoff = OldestXmin;
+
 		/*
 		 * If we froze any tuples, mark the buffer dirty, and write a WAL
 		 * record recording the changes.  We must log the changes to be
 		 * crash-safe against future truncation of CLOG.
 		 */
 		if (nfrozen > 0)
-		{
-			START_CRIT_SECTION();
-
-			MarkBufferDirty(buf);
-
-			/* execute collected freezes */
-			for (i = 0; i < nfrozen; i++)
-			{
-				ItemId		itemid;
-				HeapTupleHeader htup;
-
-				itemid = PageGetItemId(page, frozen[i].offset);
-				htup = (HeapTupleHeader) PageGetItem(page, itemid);
-
-				heap_execute_freeze_tuple(htup, &frozen[i]);
-			}
-
-			/* Now WAL-log freezing if necessary */
-			if (RelationNeedsWAL(onerel))
-			{
-				XLogRecPtr	recptr;
-
-				recptr = log_heap_freeze(onerel, buf, FreezeLimit,
-										 frozen, nfrozen);
-				PageSetLSN(page, recptr);
-			}
-
-			END_CRIT_SECTION();
-		}
+			lazy_execute_freeze(onerel, buf, freeze_cutoff, frozen, nfrozen);
 
 		/*
 		 * If there are no indexes we can vacuum the page right now instead of
@@ -1517,11 +1839,12 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		 */
 		if (!vacrelstats->useindex && dead_tuples->num_tuples > 0)
 		{
-			if (nindexes == 0)
+			if (scanstate->nindexes == 0)
 			{
 				/* Remove tuples from heap if the table has no index */
-				lazy_vacuum_page(onerel, blkno, buf, 0, vacrelstats, &vmbuffer);
-				vacuumed_pages++;
+				lazy_vacuum_page(onerel, blkno, buf, 0, vacrelstats,
+								 &scanstate->vmbuffer);
+				scanstate->vacuumed_pages++;
 				has_dead_tuples = false;
 			}
 			else
@@ -1544,7 +1867,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
-			dead_tuples->num_tuples = 0;
+			lazy_reset_dead_tuples(dead_tuples);
 
 			/*
 			 * Periodically do incremental FSM vacuuming to make newly-freed
@@ -1552,11 +1875,13 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			 * the current block, we haven't yet updated its FSM entry (that
 			 * happens further down), so passing end == blkno is correct.
 			 */
-			if (blkno - next_fsm_block_to_vacuum >= VACUUM_FSM_EVERY_PAGES)
+			if (blkno - scanstate->next_fsm_block_to_vacuum >=
+				VACUUM_FSM_EVERY_PAGES)
 			{
-				FreeSpaceMapVacuumRange(onerel, next_fsm_block_to_vacuum,
+				FreeSpaceMapVacuumRange(onerel,
+										scanstate->next_fsm_block_to_vacuum,
 										blkno);
-				next_fsm_block_to_vacuum = blkno;
+				scanstate->next_fsm_block_to_vacuum = blkno;
 			}
 		}
 
@@ -1586,7 +1911,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			PageSetAllVisible(page);
 			MarkBufferDirty(buf);
 			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-							  vmbuffer, visibility_cutoff_xid, flags);
+							  scanstate->vmbuffer, visibility_cutoff_xid, flags);
 		}
 
 		/*
@@ -1597,11 +1922,11 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		 * that something bad has happened.
 		 */
 		else if (all_visible_according_to_vm && !PageIsAllVisible(page)
-				 && VM_ALL_VISIBLE(onerel, blkno, &vmbuffer))
+				 && VM_ALL_VISIBLE(onerel, blkno, &scanstate->vmbuffer))
 		{
 			elog(WARNING, "page is not marked all-visible but visibility map bit is set in relation \"%s\" page %u",
 				 vacrelstats->relname, blkno);
-			visibilitymap_clear(onerel, blkno, vmbuffer,
+			visibilitymap_clear(onerel, blkno, scanstate->vmbuffer,
 								VISIBILITYMAP_VALID_BITS);
 		}
 
@@ -1626,7 +1951,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 				 vacrelstats->relname, blkno);
 			PageClearAllVisible(page);
 			MarkBufferDirty(buf);
-			visibilitymap_clear(onerel, blkno, vmbuffer,
+			visibilitymap_clear(onerel, blkno, scanstate->vmbuffer,
 								VISIBILITYMAP_VALID_BITS);
 		}
 
@@ -1636,7 +1961,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		 * all_visible is true, so we must check both.
 		 */
 		else if (all_visible_according_to_vm && all_visible && all_frozen &&
-				 !VM_ALL_FROZEN(onerel, blkno, &vmbuffer))
+				 !VM_ALL_FROZEN(onerel, blkno, &scanstate->vmbuffer))
 		{
 			/*
 			 * We can pass InvalidTransactionId as the cutoff XID here,
@@ -1644,7 +1969,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			 * conflicts.
 			 */
 			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-							  vmbuffer, InvalidTransactionId,
+							  scanstate->vmbuffer, InvalidTransactionId,
 							  VISIBILITYMAP_ALL_FROZEN);
 		}
 
@@ -1661,118 +1986,416 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		 * page, so remember its free space as-is.  (This path will always be
 		 * taken if there are no indexes.)
 		 */
-		if (dead_tuples->num_tuples == prev_dead_count)
+		if (ndead == 0 || !vacrelstats->useindex)
 			RecordPageWithFreeSpace(onerel, blkno, freespace);
 	}
 
-	/* report that everything is scanned and vacuumed */
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
+	read_stream_end(stream);
+	lazy_count_skipped_blocks(onerel, scanstate, vacrelstats,
+							  next_blkno, endblk);
 
-	/* Clear the block number information */
-	vacrelstats->blkno = InvalidBlockNumber;
+	return endblk;
+}
 
-	pfree(frozen);
+/*
+ * Read stream callback for lazy_scan_heap_range: return the next block of the
+ * range that we need to look at, or InvalidBlockNumber at the end of the
+ * range.
+ */
+static BlockNumber
+lazy_scan_next_block(ReadStream *stream, void *callback_private_data)
+{
+	LVScanStreamState *state = (LVScanStreamState *) callback_private_data;
+	LVRelStats *vacrelstats = state->vacrelstats;
+	LVHeapScanState *scanstate = state->scanstate;
 
-	/* save stats for use later */
-	vacrelstats->tuples_deleted = tups_vacuumed;
-	vacrelstats->new_dead_tuples = nkeep;
+	while (state->next_block < state->endblk)
+	{
+		BlockNumber blkno = state->next_block++;
 
-	/* now we can compute the new value for pg_class.reltuples */
-	vacrelstats->new_live_tuples = vac_estimate_reltuples(onerel,
-														  nblocks,
-														  vacrelstats->tupcount_pages,
-														  live_tuples);
+		if (blkno == state->next_unskippable_block)
+		{
+			/* Time to advance next_unskippable_block */
+			state->next_unskippable_block =
+				lazy_next_unskippable_block(state->onerel, scanstate,
+											blkno + 1, state->endblk);
 
-	/*
-	 * Also compute the total number of surviving heap entries.  In the
-	 * (unlikely) scenario that new_live_tuples is -1, take it as zero.
-	 */
-	vacrelstats->new_rel_tuples =
-		Max(vacrelstats->new_live_tuples, 0) + vacrelstats->new_dead_tuples;
+			/*
+			 * We know we can't skip the current block.  But set up
+			 * skipping_blocks to do the right thing at the following blocks.
+			 */
+			if (state->next_unskippable_block - blkno > SKIP_PAGES_THRESHOLD)
+				state->skipping_blocks = true;
+			else
+				state->skipping_blocks = false;
 
-	/*
-	 * Release any remaining pin on visibility map page.
-	 */
-	if (BufferIsValid(vmbuffer))
+			return blkno;
+		}
+
+		/*
+		 * The current block is potentially skippable; if we've seen a long
+		 * enough run of skippable blocks to justify skipping it, and we're
+		 * not forced to check it (see lazy_scan_heap_range), then go ahead
+		 * and skip.
+		 */
+		if (state->skipping_blocks &&
+			!(blkno == vacrelstats->rel_pages - 1 &&
+			  should_attempt_truncation(scanstate->params, vacrelstats)))
+			continue;
+
+		return blkno;
+	}
+
+	return InvalidBlockNumber;
+}
+
+/*
+ * Count the blocks from startblk up to endblk, which the first heap pass
+ * skipped, in vacrelstats->frozenskipped_pages if they are all-frozen.
+ */
+static void
+lazy_count_skipped_blocks(Relation onerel, LVHeapScanState *scanstate,
+						  LVRelStats *vacrelstats,
+						  BlockNumber startblk, BlockNumber endblk)
+{
+	BlockNumber blkno;
+
+	for (blkno = startblk; blkno < endblk; blkno++)
 	{
-		ReleaseBuffer(vmbuffer);
-		vmbuffer = InvalidBuffer;
+		/*
+		 * Tricky, tricky.  If this is in aggressive vacuum, the page must
+		 * have been all-frozen at the time we checked whether it was
+		 * skippable, but it might not be any more.  We must be careful to
+		 * count it as a skipped all-frozen page in that case, or else we'll
+		 * think we can't update relfrozenxid and relminmxid.  If it's not an
+		 * aggressive vacuum, we don't know whether it was all-frozen, so we
+		 * have to recheck; but in this case an approximate answer is OK.
+		 */
+		if (scanstate->aggressive ||
+			VM_ALL_FROZEN(onerel, blkno, &scanstate->vmbuffer))
+			vacrelstats->frozenskipped_pages++;
 	}
+}
 
-	/* If any tuples need to be deleted, perform final vacuum cycle */
-	/* XXX put a threshold on min number of tuples here? */
-	if (dead_tuples->num_tuples > 0)
+/*
+ * Return the first block from blkno up to endblk that we can't skip based on
+ * the visibility map, or endblk if there's no such block.  See
+ * lazy_scan_heap_range.
+ */
+static BlockNumber
+lazy_next_unskippable_block(Relation onerel, LVHeapScanState *scanstate,
+							BlockNumber blkno, BlockNumber endblk)
+{
+	if ((scanstate->params->options & VACOPT_DISABLE_PAGE_SKIPPING) != 0)
+		return blkno;
+
+	while (blkno < endblk)
 	{
-		/* Work on all the indexes, and then the heap */
-		lazy_vacuum_all_indexes(onerel, Irel, indstats, vacrelstats,
-								lps, nindexes);
+		uint8		vmstatus;
+
+		vmstatus = visibilitymap_get_status(onerel, blkno,
+											&scanstate->vmbuffer);
+		if (scanstate->aggressive)
+		{
+			if ((vmstatus & VISIBILITYMAP_ALL_FROZEN) == 0)
+				break;
+		}
+		else
+		{
+			if ((vmstatus & VISIBILITYMAP_ALL_VISIBLE) == 0)
+				break;
+		}
+		vacuum_delay_point();
+		blkno++;
+	}
+
+	return blkno;
+}
+
+/*
+ * Initialize the state for taking part in the first heap pass.  The caller
+ * must still set scanstate->dead_tuples.
+ */
+static void
+init_heap_scan_state(LVHeapScanState *scanstate, Relation onerel,
+					 VacuumParams *params, bool aggressive, int nindexes)
+{
+	MemSet(scanstate, 0, sizeof(LVHeapScanState));
+	scanstate->params = params;
+	scanstate->aggressive = aggressive;
+	scanstate->nindexes = nindexes;
+	scanstate->relfrozenxid = onerel->rd_rel->relfrozenxid;
+	scanstate->relminmxid = onerel->rd_rel->relminmxid;
+	scanstate->vistest = GlobalVisTestFor(onerel);
+	scanstate->frozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
+	scanstate->vmbuffer = InvalidBuffer;
+	scanstate->next_fsm_block_to_vacuum = (BlockNumber) 0;
+}
+
+/*
+ * Perform the first heap pass with parallel workers.  This function must be
+ * used by the parallel vacuum leader process.
+ *
+ * Each round of the parallel heap scan goes on until either all blocks have
+ * been claimed, or the dead tuple space is full; in the latter case we vacuum
+ * the indexes and the heap before launching the workers again for the next
+ * round.  The dead tuples of the last round are left for the caller.
+ */
+static void
+lazy_parallel_scan_heap(Relation onerel, LVRelStats *vacrelstats,
+						LVHeapScanState *scanstate, Relation *Irel,
+						IndexBulkDeleteResult **indstats,
+						LVParallelState *lps, int nindexes)
+{
+	LVShared   *lvshared = lps->lvshared;
+	LVDeadTuples *dead_tuples = vacrelstats->dead_tuples;
+	BlockNumber nblocks = vacrelstats->rel_pages;
+
+	Assert(!IsParallelWorker());
+	Assert(ParallelHeapVacuumIsActive(lps));
+
+	lvshared->next_block = 0;
+
+	for (;;)
+	{
+		BlockNumber next_block;
+
+		/* Tell parallel workers to scan the heap */
+		lvshared->task = PARALLEL_VACUUM_SCAN_HEAP;
+		lvshared->reserved_space = 0;
+		MemSet(&lvshared->scan_counts, 0, sizeof(LVScanCounts));
+
+		launch_parallel_vacuum_workers(lps, lps->nworkers_heap);
+		ereport(elevel,
+				(errmsg(ngettext("launched %d parallel vacuum worker for heap scanning (planned: %d)",
+								 "launched %d parallel vacuum workers for heap scanning (planned: %d)",
+								 lps->pcxt->nworkers_launched),
+						lps->pcxt->nworkers_launched, lps->nworkers_heap)));
+
+		/* Join as a parallel worker */
+		parallel_scan_heap(onerel, lvshared, dead_tuples, vacrelstats,
+						   scanstate);
+
+		wait_for_parallel_vacuum_workers(lps, lps->nworkers_heap);
+
+		/* Add the statistics of the workers to our own */
+		parallel_heap_scan_collect_stats(lvshared, vacrelstats, scanstate);
+
+		/*
+		 * The participants appended the dead tuples of their ranges in
+		 * whatever order they finished them, but index vacuuming and the
+		 * second heap pass need the pages sorted by block number.
+		 */
+		qsort((void *) dead_tuples->pages, dead_tuples->num_pages,
+			  sizeof(LVDeadPage), vac_cmp_dead_page);
+
+		/* Is the whole table done? */
+		next_block = lvshared->next_block;
+		if (next_block >= nblocks)
+			break;
+
+		/* Work on all the indexes, then the heap */
+		lazy_vacuum_all_indexes(onerel, Irel, indstats,
+								vacrelstats, lps, nindexes);
 
 		/* Remove tuples from heap */
-		lazy_vacuum_heap(onerel, vacrelstats);
+		lazy_vacuum_heap(onerel, vacrelstats, lps);
+
+		/*
+		 * Forget the now-vacuumed tuples, and press on, but be careful not to
+		 * reset latestRemovedXid since we want that value to be valid.
+		 */
+		lazy_reset_dead_tuples(dead_tuples);
+
+		/*
+		 * Vacuum the Free Space Map to make newly-freed space visible on
+		 * upper-level FSM pages.  All blocks before next_block have been
+		 * processed.
+		 */
+		FreeSpaceMapVacuumRange(onerel, scanstate->next_fsm_block_to_vacuum,
+								next_block);
+		scanstate->next_fsm_block_to_vacuum = next_block;
+
+		/* Report that we are once again scanning the heap */
+		pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+									 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
 	}
+}
+
+/*
+ * First heap pass routine used by the leader process and parallel vacuum
+ * worker processes.
+ *
+ * We repeatedly claim a range of up to PARALLEL_VACUUM_SCAN_CHUNK blocks,
+ * along with enough of the shared dead tuple space to hold the dead tuples of
+ * those pages even if every tuple is dead.  The dead tuples of a range are collected locally and then
+ * moved to the shared space, giving back the part of the reservation we
+ * didn't use.  We stop when all the blocks have been claimed, or when there
+ * isn't enough space left for even a single page.
+ */
+static void
+parallel_scan_heap(Relation onerel, LVShared *lvshared,
+				   LVDeadTuples *dead_tuples, LVRelStats *vacrelstats,
+				   LVHeapScanState *scanstate)
+{
+	LVDeadTuples *range_tuples;
+
+	range_tuples = (LVDeadTuples *)
+		palloc(SizeOfDeadTuples(PARALLEL_VACUUM_SCAN_CHUNK * MaxDeadPageSize));
+	scanstate->dead_tuples = range_tuples;
+	scanstate->parallel = true;
 
 	/*
-	 * Vacuum the remainder of the Free Space Map.  We must do this whether or
-	 * not there were indexes.
+	 * Increment the active worker count if we are able to launch any worker.
 	 */
-	if (blkno > next_fsm_block_to_vacuum)
-		FreeSpaceMapVacuumRange(onerel, next_fsm_block_to_vacuum, blkno);
+	if (VacuumActiveNWorkers)
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
 
-	/* report all blocks vacuumed */
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
+	for (;;)
+	{
+		BlockNumber startblk;
+		BlockNumber nclaimed;
+		Size		datasize;
+		uint32		datastart;
+		int			pageidx;
+		int64		num_tuples;
+		int			i;
 
-	/* Do post-vacuum cleanup */
-	if (vacrelstats->useindex)
-		lazy_cleanup_all_indexes(Irel, indstats, vacrelstats, lps, nindexes);
+		/* Claim the next range of blocks */
+		SpinLockAcquire(&lvshared->mutex);
+		startblk = lvshared->next_block;
+		nclaimed = Min(PARALLEL_VACUUM_SCAN_CHUNK, lvshared->rel_pages - startblk);
+		nclaimed = Min(nclaimed,
+					   (BlockNumber) ((lazy_dead_tuples_free_space(dead_tuples) -
+									   lvshared->reserved_space) /
+									  MaxDeadPageSize));
+		lvshared->next_block += nclaimed;
+		lvshared->reserved_space += nclaimed * MaxDeadPageSize;
+		SpinLockRelease(&lvshared->mutex);
+
+		if (nclaimed == 0)
+			break;
 
-	/*
-	 * End parallel mode before updating index statistics as we cannot write
-	 * during parallel mode.
-	 */
-	if (ParallelVacuumIsActive(lps))
-		end_parallel_vacuum(indstats, lps, nindexes);
+		if (!IsParallelWorker())
+			pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED,
+										 startblk + nclaimed);
 
-	/* Update index statistics */
-	update_index_statistics(Irel, indstats, nindexes);
+		range_tuples->max_bytes = nclaimed * MaxDeadPageSize;
+		lazy_reset_dead_tuples(range_tuples);
 
-	/* If no indexes, make log report that lazy_vacuum_heap would've made */
-	if (vacuumed_pages)
-		ereport(elevel,
-				(errmsg("\"%s\": removed %.0f row versions in %u pages",
-						vacrelstats->relname,
-						tups_vacuumed, vacuumed_pages)));
+		/* Our reservation ensures that this won't stop early */
+		(void) lazy_scan_heap_range(onerel, vacrelstats, scanstate,
+									startblk, startblk + nclaimed);
+
+		/*
+		 * Move the dead tuples to the shared space, and give back our
+		 * reservation.
+		 */
+		datasize = range_tuples->max_bytes - range_tuples->data_start;
+		SpinLockAcquire(&lvshared->mutex);
+		pageidx = dead_tuples->num_pages;
+		dead_tuples->num_pages += range_tuples->num_pages;
+		dead_tuples->data_start -= datasize;
+		datastart = dead_tuples->data_start;
+		dead_tuples->num_tuples += range_tuples->num_tuples;
+		num_tuples = dead_tuples->num_tuples;
+		lvshared->reserved_space -= nclaimed * MaxDeadPageSize;
+		SpinLockRelease(&lvshared->mutex);
+
+		memcpy((char *) dead_tuples->pages + datastart,
+			   (char *) range_tuples->pages + range_tuples->data_start,
+			   datasize);
+		for (i = 0; i < range_tuples->num_pages; i++)
+		{
+			LVDeadPage *deadpage = &dead_tuples->pages[pageidx + i];
+
+			deadpage->blkno = range_tuples->pages[i].blkno;
+			deadpage->dataoff = range_tuples->pages[i].dataoff -
+				range_tuples->data_start + datastart;
+		}
+
+		if (!IsParallelWorker())
+			pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
+										 num_tuples);
+	}
+
+	if (BufferIsValid(scanstate->vmbuffer))
+	{
+		ReleaseBuffer(scanstate->vmbuffer);
+		scanstate->vmbuffer = InvalidBuffer;
+	}
+
+	/* Workers hand their statistics over to the leader */
+	if (IsParallelWorker())
+		parallel_heap_scan_report_stats(lvshared, vacrelstats, scanstate);
 
 	/*
-	 * This is pretty messy, but we split it up so that we can skip emitting
-	 * individual parts of the message when not applicable.
+	 * We have completed the heap scan so decrement the active worker count.
 	 */
-	initStringInfo(&buf);
-	appendStringInfo(&buf,
-					 _("%.0f dead row versions cannot be removed yet, oldest xmin: %u\n"),
-					 nkeep, OldestXmin);
-	appendStringInfo(&buf, _("There were %.0f unused item identifiers.\n"),
-					 nunused);
-	appendStringInfo(&buf, ngettext("Skipped %u page due to buffer pins, ",
-									"Skipped %u pages due to buffer pins, ",
-									vacrelstats->pinskipped_pages),
-					 vacrelstats->pinskipped_pages);
-	appendStringInfo(&buf, ngettext("%u frozen page.\n",
-									"%u frozen pages.\n",
-									vacrelstats->frozenskipped_pages),
-					 vacrelstats->frozenskipped_pages);
-	appendStringInfo(&buf, ngettext("%u page is entirely empty.\n",
-									"%u pages are entirely empty.\n",
-									empty_pages),
-					 empty_pages);
-	appendStringInfo(&buf, _("%s."), pg_rusage_show(&ru0));
+	if (VacuumActiveNWorkers)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
 
-	ereport(elevel,
-			(errmsg("\"%s\": found %.0f removable, %.0f nonremovable row versions in %u out of %u pages",
-					vacrelstats->relname,
-					tups_vacuumed, num_tuples,
-					vacrelstats->scanned_pages, nblocks),
-			 errdetail_internal("%s", buf.data)));
-	pfree(buf.data);
+	scanstate->dead_tuples = NULL;
+	scanstate->parallel = false;
+	pfree(range_tuples);
+}
+
+/*
+ * Add the statistics gathered by a parallel vacuum worker during the first
+ * heap pass to the totals in shared memory.
+ */
+static void
+parallel_heap_scan_report_stats(LVShared *lvshared, LVRelStats *vacrelstats,
+								LVHeapScanState *scanstate)
+{
+	LVScanCounts *counts = &lvshared->scan_counts;
+
+	SpinLockAcquire(&lvshared->mutex);
+	counts->scanned_pages += vacrelstats->scanned_pages;
+	counts->pinskipped_pages += vacrelstats->pinskipped_pages;
+	counts->frozenskipped_pages += vacrelstats->frozenskipped_pages;
+	counts->tupcount_pages += vacrelstats->tupcount_pages;
+	counts->nonempty_pages = Max(counts->nonempty_pages,
+								 vacrelstats->nonempty_pages);
+	if (TransactionIdFollows(vacrelstats->latestRemovedXid,
+							 counts->latestRemovedXid))
+		counts->latestRemovedXid = vacrelstats->latestRemovedXid;
+	counts->empty_pages += scanstate->empty_pages;
+	counts->num_tuples += scanstate->num_tuples;
+	counts->live_tuples += scanstate->live_tuples;
+	counts->tups_vacuumed += scanstate->tups_vacuumed;
+	counts->nkeep += scanstate->nkeep;
+	counts->nunused += scanstate->nunused;
+	SpinLockRelease(&lvshared->mutex);
+}
+
+/*
+ * Add the statistics that parallel vacuum workers gathered during a round of
+ * the first heap pass to the leader's own.
+ */
+static void
+parallel_heap_scan_collect_stats(LVShared *lvshared, LVRelStats *vacrelstats,
+								 LVHeapScanState *scanstate)
+{
+	LVScanCounts *counts = &lvshared->scan_counts;
+
+	Assert(!IsParallelWorker());
+
+	vacrelstats->scanned_pages += counts->scanned_pages;
+	vacrelstats->pinskipped_pages += counts->pinskipped_pages;
+	vacrelstats->frozenskipped_pages += counts->frozenskipped_pages;
+	vacrelstats->tupcount_pages += counts->tupcount_pages;
+	vacrelstats->nonempty_pages = Max(vacrelstats->nonempty_pages,
+									  counts->nonempty_pages);
+	if (TransactionIdFollows(counts->latestRemovedXid,
+							 vacrelstats->latestRemovedXid))
+		vacrelstats->latestRemovedXid = counts->latestRemovedXid;
+	scanstate->empty_pages += counts->empty_pages;
+	scanstate->num_tuples += counts->num_tuples;
+	scanstate->live_tuples += counts->live_tuples;
+	scanstate->tups_vacuumed += counts->tups_vacuumed;
+	scanstate->nkeep += counts->nkeep;
+	scanstate->nunused += counts->nunused;
 }
 
 /*
@@ -1840,9 +2463,9 @@ lazy_vacuum_all_indexes(Relation onerel, Relation *Irel,
  * process index entry removal in batches as large as possible.
  */
 static void
-lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
+lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats,
+				 LVParallelState *lps)
 {
-	int			tupindex;
 	int			npages;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
@@ -1857,57 +2480,189 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 							 InvalidBlockNumber, InvalidOffsetNumber);
 
 	pg_rusage_init(&ru0);
-	npages = 0;
 
-	tupindex = 0;
-	while (tupindex < vacrelstats->dead_tuples->num_tuples)
+	if (ParallelHeapVacuumIsActive(lps))
+		npages = lazy_parallel_vacuum_heap(onerel, vacrelstats, lps);
+	else
+		npages = lazy_vacuum_heap_range(onerel, vacrelstats, 0,
+										vacrelstats->dead_tuples->num_pages,
+										&vmbuffer);
+
+	/* Clear the block number information */
+	vacrelstats->blkno = InvalidBlockNumber;
+
+	if (BufferIsValid(vmbuffer))
+	{
+		ReleaseBuffer(vmbuffer);
+		vmbuffer = InvalidBuffer;
+	}
+
+	ereport(elevel,
+			(errmsg("\"%s\": removed %lld row versions in %d pages",
+					vacrelstats->relname,
+					(long long) vacrelstats->dead_tuples->num_tuples, npages),
+			 errdetail_internal("%s", pg_rusage_show(&ru0))));
+
+	/* Revert to the previous phase information for error traceback */
+	restore_vacuum_error_info(vacrelstats, &saved_err_info);
+}
+
+/*
+ *	lazy_vacuum_heap_range() -- second heap pass over some of the dead tuples
+ *
+ *		This vacuums the pages from startpage up to endpage in the pages
+ *		array of the dead tuples.  Returns the number of pages vacuumed.
+ */
+static int
+lazy_vacuum_heap_range(Relation onerel, LVRelStats *vacrelstats,
+					   int startpage, int endpage, Buffer *vmbuffer)
+{
+	LVVacuumStreamState streamstate;
+	ReadStream *stream;
+	Buffer		buf;
+	int			pageidx = startpage;
+	int			npages = 0;
+
+	streamstate.dead_tuples = vacrelstats->dead_tuples;
+	streamstate.next_page = startpage;
+	streamstate.endpage = endpage;
+	stream = read_stream_begin_relation(READ_STREAM_MAINTENANCE,
+										onerel, MAIN_FORKNUM, vac_strategy,
+										lazy_vacuum_next_block, &streamstate);
+
+	for (; (buf = read_stream_next_buffer(stream)) != InvalidBuffer; pageidx++)
 	{
 		BlockNumber tblk;
-		Buffer		buf;
 		Page		page;
 		Size		freespace;
 
 		vacuum_delay_point();
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples->itemptrs[tupindex]);
-		vacrelstats->blkno = tblk;
-		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, tblk, RBM_NORMAL,
-								 vac_strategy);
-		if (!ConditionalLockBufferForCleanup(buf))
-		{
-			ReleaseBuffer(buf);
-			++tupindex;
-			continue;
-		}
-		tupindex = lazy_vacuum_page(onerel, tblk, buf, tupindex, vacrelstats,
-									&vmbuffer);
+		tblk = BufferGetBlockNumber(buf);
+		Assert(tblk == vacrelstats->dead_tuples->pages[pageidx].blkno);
+		vacrelstats->blkno = tblk;
+		if (!ConditionalLockBufferForCleanup(buf))
+		{
+			ReleaseBuffer(buf);
+			continue;
+		}
+		lazy_vacuum_page(onerel, tblk, buf, pageidx, vacrelstats, vmbuffer);
+
+		/* Now that we've compacted the page, record its available space */
+		page = BufferGetPage(buf);
+		freespace = PageGetHeapFreeSpace(page);
+
+		UnlockReleaseBuffer(buf);
+		RecordPageWithFreeSpace(onerel, tblk, freespace);
+		npages++;
+	}
+
+	read_stream_end(stream);
+
+	return npages;
+}
+
+/*
+ * Read stream callback for lazy_vacuum_heap_range: return the next page with
+ * dead tuples, or InvalidBlockNumber at the end of the range.
+ */
+static BlockNumber
+lazy_vacuum_next_block(ReadStream *stream, void *callback_private_data)
+{
+	LVVacuumStreamState *state = (LVVacuumStreamState *) callback_private_data;
+
+	if (state->next_page >= state->endpage)
+		return InvalidBlockNumber;
+
+	return state->dead_tuples->pages[state->next_page++].blkno;
+}
+
+/*
+ * Perform the second heap pass with parallel workers.  This function must be
+ * used by the parallel vacuum leader process.  Returns the number of pages
+ * vacuumed.
+ */
+static int
+lazy_parallel_vacuum_heap(Relation onerel, LVRelStats *vacrelstats,
+						  LVParallelState *lps)
+{
+	LVShared   *lvshared = lps->lvshared;
+	int			npages;
+
+	Assert(!IsParallelWorker());
+	Assert(ParallelHeapVacuumIsActive(lps));
+
+	/* Tell parallel workers to vacuum the heap */
+	lvshared->task = PARALLEL_VACUUM_VACUUM_HEAP;
+	lvshared->next_page = 0;
+	lvshared->npages_vacuumed = 0;
+	lvshared->latestRemovedXid = vacrelstats->latestRemovedXid;
+
+	launch_parallel_vacuum_workers(lps, lps->nworkers_heap);
+	ereport(elevel,
+			(errmsg(ngettext("launched %d parallel vacuum worker for heap vacuuming (planned: %d)",
+							 "launched %d parallel vacuum workers for heap vacuuming (planned: %d)",
+							 lps->pcxt->nworkers_launched),
+					lps->pcxt->nworkers_launched, lps->nworkers_heap)));
+
+	/* Join as a parallel worker */
+	npages = parallel_vacuum_heap(onerel, lvshared, vacrelstats);
+
+	wait_for_parallel_vacuum_workers(lps, lps->nworkers_heap);
+
+	return npages + lvshared->npages_vacuumed;
+}
+
+/*
+ * Second heap pass routine used by the leader process and parallel vacuum
+ * worker processes.
+ *
+ * We repeatedly claim the next PARALLEL_VACUUM_HEAP_CHUNK pages of the dead
+ * tuples and vacuum them.  Returns the number of pages we vacuumed.
+ */
+static int
+parallel_vacuum_heap(Relation onerel, LVShared *lvshared,
+					 LVRelStats *vacrelstats)
+{
+	LVDeadTuples *dead_tuples = vacrelstats->dead_tuples;
+	Buffer		vmbuffer = InvalidBuffer;
+	int			npages = 0;
+
+	/*
+	 * Increment the active worker count if we are able to launch any worker.
+	 */
+	if (VacuumActiveNWorkers)
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+
+	for (;;)
+	{
+		int			startpage;
+		int			endpage;
+
+		SpinLockAcquire(&lvshared->mutex);
+		startpage = lvshared->next_page;
+		endpage = Min(startpage + PARALLEL_VACUUM_HEAP_CHUNK,
+					  dead_tuples->num_pages);
+		lvshared->next_page = endpage;
+		SpinLockRelease(&lvshared->mutex);
 
-		/* Now that we've compacted the page, record its available space */
-		page = BufferGetPage(buf);
-		freespace = PageGetHeapFreeSpace(page);
+		if (startpage >= endpage)
+			break;
 
-		UnlockReleaseBuffer(buf);
-		RecordPageWithFreeSpace(onerel, tblk, freespace);
-		npages++;
+		npages += lazy_vacuum_heap_range(onerel, vacrelstats,
+										 startpage, endpage, &vmbuffer);
 	}
 
-	/* Clear the block number information */
-	vacrelstats->blkno = InvalidBlockNumber;
-
 	if (BufferIsValid(vmbuffer))
-	{
 		ReleaseBuffer(vmbuffer);
-		vmbuffer = InvalidBuffer;
-	}
 
-	ereport(elevel,
-			(errmsg("\"%s\": removed %d row versions in %d pages",
-					vacrelstats->relname,
-					tupindex, npages),
-			 errdetail_internal("%s", pg_rusage_show(&ru0))));
+	/*
+	 * We have completed the heap vacuum so decrement the active worker count.
+	 */
+	if (VacuumActiveNWorkers)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
 
-	/* Revert to the previous phase information for error traceback */
-	restore_vacuum_error_info(vacrelstats, &saved_err_info);
+	return npages;
 }
 
 /*
@@ -1916,18 +2671,17 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
  *
  * Caller must hold pin and buffer cleanup lock on the buffer.
  *
- * tupindex is the index in vacrelstats->dead_tuples of the first dead
- * tuple for this page.  We assume the rest follow sequentially.
- * The return value is the first tupindex after the tuples of this page.
+ * pageidx is the index of this page in the pages array of
+ * vacrelstats->dead_tuples.
  */
-static int
+static void
 lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer)
+				 int pageidx, LVRelStats *vacrelstats, Buffer *vmbuffer)
 {
-	LVDeadTuples *dead_tuples = vacrelstats->dead_tuples;
 	Page		page = BufferGetPage(buffer);
 	OffsetNumber unused[MaxOffsetNumber];
-	int			uncnt = 0;
+	int			uncnt;
+	int			i;
 	TransactionId visibility_cutoff_xid;
 	bool		all_frozen;
 	LVSavedErrInfo saved_err_info;
@@ -1938,21 +2692,17 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 	update_vacuum_error_info(vacrelstats, &saved_err_info, VACUUM_ERRCB_PHASE_VACUUM_HEAP,
 							 blkno, InvalidOffsetNumber);
 
+	Assert(vacrelstats->dead_tuples->pages[pageidx].blkno == blkno);
+	uncnt = lazy_get_dead_offsets(vacrelstats->dead_tuples, pageidx, unused);
+
 	START_CRIT_SECTION();
 
-	for (; tupindex < dead_tuples->num_tuples; tupindex++)
+	for (i = 0; i < uncnt; i++)
 	{
-		BlockNumber tblk;
-		OffsetNumber toff;
 		ItemId		itemid;
 
-		tblk = ItemPointerGetBlockNumber(&dead_tuples->itemptrs[tupindex]);
-		if (tblk != blkno)
-			break;				/* past end of tuples for this block */
-		toff = ItemPointerGetOffsetNumber(&dead_tuples->itemptrs[tupindex]);
-		itemid = PageGetItemId(page, toff);
+		itemid = PageGetItemId(page, unused[i]);
 		ItemIdSetUnused(itemid);
-		unused[uncnt++] = toff;
 	}
 
 	PageRepairFragmentation(page);
@@ -1991,8 +2741,28 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 	if (heap_page_is_all_visible(onerel, buffer, vacrelstats,
 								 &visibility_cutoff_xid,
 								 &all_frozen))
+	{
 		PageSetAllVisible(page);
 
+		/*
+		 * Since we're modifying the page anyway, also freeze it if that's
+		 * all it takes to mark it all-frozen, like lazy_scan_heap does.
+		 */
+		if (!all_frozen && vacuum_eager_freeze)
+		{
+			xl_heap_freeze_tuple frozen[MaxHeapTuplesPerPage];
+			int			nfrozen;
+
+			if (lazy_prepare_eager_freeze(page,
+										  onerel->rd_rel->relfrozenxid,
+										  onerel->rd_rel->relminmxid,
+										  frozen, &nfrozen, &all_frozen) &&
+				nfrozen > 0)
+				lazy_execute_freeze(onerel, buffer, OldestXmin,
+									frozen, nfrozen);
+		}
+	}
+
 	/*
 	 * All the changes to the heap page have been done. If the all-visible
 	 * flag is now set, also set the VM all-visible bit (and, if possible, the
@@ -2017,7 +2787,6 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 
 	/* Revert to the previous phase information for error traceback */
 	restore_vacuum_error_info(vacrelstats, &saved_err_info);
-	return tupindex;
 }
 
 /*
@@ -2120,48 +2889,14 @@ lazy_parallel_vacuum_indexes(Relation *Irel, IndexBulkDeleteResult **stats,
 	 */
 	nworkers = Min(nworkers, lps->pcxt->nworkers);
 
+	/* Reset the parallel index processing counter */
+	lps->lvshared->task = PARALLEL_VACUUM_INDEXES;
+	pg_atomic_write_u32(&(lps->lvshared->idx), 0);
+
 	/* Setup the shared cost-based vacuum delay and launch workers */
 	if (nworkers > 0)
 	{
-		if (vacrelstats->num_index_scans > 0)
-		{
-			/* Reset the parallel index processing counter */
-			pg_atomic_write_u32(&(lps->lvshared->idx), 0);
-
-			/* Reinitialize the parallel context to relaunch parallel workers */
-			ReinitializeParallelDSM(lps->pcxt);
-		}
-
-		/*
-		 * Set up shared cost balance and the number of active workers for
-		 * vacuum delay.  We need to do this before launching workers as
-		 * otherwise, they might not see the updated values for these
-		 * parameters.
-		 */
-		pg_atomic_write_u32(&(lps->lvshared->cost_balance), VacuumCostBalance);
-		pg_atomic_write_u32(&(lps->lvshared->active_nworkers), 0);
-
-		/*
-		 * The number of workers can vary between bulkdelete and cleanup
-		 * phase.
-		 */
-		ReinitializeParallelWorkers(lps->pcxt, nworkers);
-
-		LaunchParallelWorkers(lps->pcxt);
-
-		if (lps->pcxt->nworkers_launched > 0)
-		{
-			/*
-			 * Reset the local cost values for leader backend as we have
-			 * already accumulated the remaining balance of heap.
-			 */
-			VacuumCostBalance = 0;
-			VacuumCostBalanceLocal = 0;
-
-			/* Enable shared cost balance for leader backend */
-			VacuumSharedCostBalance = &(lps->lvshared->cost_balance);
-			VacuumActiveNWorkers = &(lps->lvshared->active_nworkers);
-		}
+		launch_parallel_vacuum_workers(lps, nworkers);
 
 		if (lps->lvshared->for_cleanup)
 			ereport(elevel,
@@ -2187,6 +2922,59 @@ lazy_parallel_vacuum_indexes(Relation *Irel, IndexBulkDeleteResult **stats,
 	parallel_vacuum_index(Irel, stats, lps->lvshared,
 						  vacrelstats->dead_tuples, nindexes, vacrelstats);
 
+	wait_for_parallel_vacuum_workers(lps, nworkers);
+}
+
+/*
+ * Launch nworkers parallel vacuum workers for the task set in lps->lvshared,
+ * and set up the shared cost-based vacuum delay.
+ */
+static void
+launch_parallel_vacuum_workers(LVParallelState *lps, int nworkers)
+{
+	Assert(nworkers > 0);
+
+	/* Reinitialize the parallel context to relaunch parallel workers */
+	if (lps->launched)
+		ReinitializeParallelDSM(lps->pcxt);
+
+	/*
+	 * Set up shared cost balance and the number of active workers for vacuum
+	 * delay.  We need to do this before launching workers as otherwise, they
+	 * might not see the updated values for these parameters.
+	 */
+	pg_atomic_write_u32(&(lps->lvshared->cost_balance), VacuumCostBalance);
+	pg_atomic_write_u32(&(lps->lvshared->active_nworkers), 0);
+
+	/* The number of workers can vary between phases */
+	ReinitializeParallelWorkers(lps->pcxt, nworkers);
+
+	LaunchParallelWorkers(lps->pcxt);
+	lps->launched = true;
+
+	if (lps->pcxt->nworkers_launched > 0)
+	{
+		/*
+		 * Reset the local cost values for leader backend as we have already
+		 * accumulated the remaining balance of heap.
+		 */
+		VacuumCostBalance = 0;
+		VacuumCostBalanceLocal = 0;
+
+		/* Enable shared cost balance for leader backend */
+		VacuumSharedCostBalance = &(lps->lvshared->cost_balance);
+		VacuumActiveNWorkers = &(lps->lvshared->active_nworkers);
+	}
+}
+
+/*
+ * Wait for the workers launched by launch_parallel_vacuum_workers to finish,
+ * and disable shared costing.  nworkers must be the same as given to it, or
+ * zero if it wasn't called.
+ */
+static void
+wait_for_parallel_vacuum_workers(LVParallelState *lps, int nworkers)
+{
 	/*
 	 * Next, accumulate buffer and WAL usage.  (This must wait for the workers
 	 * to finish, or we might get incomplete data.)
@@ -2462,9 +3250,9 @@ lazy_vacuum_index(Relation indrel, IndexBulkDeleteResult **stats,
 							   lazy_tid_reaped, (void *) dead_tuples);
 
 	ereport(elevel,
-			(errmsg("scanned index \"%s\" to remove %d row versions",
+			(errmsg("scanned index \"%s\" to remove %lld row versions",
 					vacrelstats->indname,
-					dead_tuples->num_tuples),
+					(long long) dead_tuples->num_tuples),
 			 errdetail_internal("%s", pg_rusage_show(&ru0))));
 
 	/* Revert to the previous phase information for error traceback */
@@ -2841,33 +3629,36 @@ count_nondeletable_pages(Relation onerel, LVRelStats *vacrelstats)
 }
 
 /*
- * Return the maximum number of dead tuples we can record.
+ * Return the size of the space for recording dead tuples, following the
+ * LVDeadTuples header.
  */
-static long
-compute_max_dead_tuples(BlockNumber relblocks, bool useindex)
+static Size
+compute_dead_tuples_space(BlockNumber relblocks, bool useindex)
 {
-	long		maxtuples;
+	Size		space;
 	int			vac_work_mem = IsAutoVacuumWorkerProcess() &&
 	autovacuum_work_mem != -1 ?
 	autovacuum_work_mem : maintenance_work_mem;
 
 	if (useindex)
 	{
-		maxtuples = MAXDEADTUPLES(vac_work_mem * 1024L);
-		maxtuples = Min(maxtuples, INT_MAX);
-		maxtuples = Min(maxtuples, MAXDEADTUPLES(MaxAllocSize));
+		space = (Size) vac_work_mem * 1024;
+		space -= Min(space, offsetof(LVDeadTuples, pages));
+		/* the dead tuples are located using 32-bit offsets */
+		space = Min(space, (Size) PG_UINT32_MAX);
 
-		/* curious coding here to ensure the multiplication can't overflow */
-		if ((BlockNumber) (maxtuples / LAZY_ALLOC_TUPLES) > relblocks)
-			maxtuples = relblocks * LAZY_ALLOC_TUPLES;
+		/* there's no point in more space than every page could use */
+		if ((BlockNumber) (space / MaxDeadPageSize) > relblocks)
+			space = (Size) relblocks * MaxDeadPageSize;
 
 		/* stay sane if small maintenance_work_mem */
-		maxtuples = Max(maxtuples, MaxHeapTuplesPerPage);
+		space = Max(space, MaxDeadPageSize);
 	}
 	else
-		maxtuples = MaxHeapTuplesPerPage;
+		space = MaxDeadPageSize;
 
-	return maxtuples;
+	/* keep the dead offsets aligned */
+	return TYPEALIGN_DOWN(sizeof(uint16), space);
 }
 
 /*
@@ -2879,35 +3670,127 @@ static void
 lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks)
 {
 	LVDeadTuples *dead_tuples = NULL;
-	long		maxtuples;
+	Size		space;
 
-	maxtuples = compute_max_dead_tuples(relblocks, vacrelstats->useindex);
+	space = compute_dead_tuples_space(relblocks, vacrelstats->useindex);
 
-	dead_tuples = (LVDeadTuples *) palloc(SizeOfDeadTuples(maxtuples));
-	dead_tuples->num_tuples = 0;
-	dead_tuples->max_tuples = (int) maxtuples;
+	dead_tuples = (LVDeadTuples *)
+		MemoryContextAllocHuge(CurrentMemoryContext, SizeOfDeadTuples(space));
+	dead_tuples->max_bytes = (uint32) space;
+	dead_tuples->max_tuples = space / MinDeadTupleSize;
+	lazy_reset_dead_tuples(dead_tuples);
 
 	vacrelstats->dead_tuples = dead_tuples;
 }
 
 /*
- * lazy_record_dead_tuple - remember one deletable tuple
+ * lazy_reset_dead_tuples - forget all the dead tuples recorded so far
  */
 static void
-lazy_record_dead_tuple(LVDeadTuples *dead_tuples, ItemPointer itemptr)
+lazy_reset_dead_tuples(LVDeadTuples *dead_tuples)
 {
-	/*
-	 * The array shouldn't overflow under normal behavior, but perhaps it
-	 * could if we are given a really small maintenance_work_mem. In that
-	 * case, just forget the last few tuples (we'll get 'em next time).
-	 */
-	if (dead_tuples->num_tuples < dead_tuples->max_tuples)
+	dead_tuples->data_start = dead_tuples->max_bytes;
+	dead_tuples->num_pages = 0;
+	dead_tuples->num_tuples = 0;
+}
+
+/*
+ * lazy_dead_tuples_free_space - return the space left for dead tuples
+ */
+static Size
+lazy_dead_tuples_free_space(LVDeadTuples *dead_tuples)
+{
+	return dead_tuples->data_start - dead_tuples->num_pages * sizeof(LVDeadPage);
+}
+
+/*
+ * lazy_record_dead_page - remember the deletable tuples of one page
+ *
+ * offsets must be in ascending order.  The caller must have made sure that
+ * there is MaxDeadPageSize of free space.
+ */
+static void
+lazy_record_dead_page(LVDeadTuples *dead_tuples, BlockNumber blkno,
+					  OffsetNumber *offsets, int noffsets)
+{
+	LVDeadPage *deadpage;
+	uint16	   *data;
+	Size		bitmapsize;
+	Size		datasize;
+	int			i;
+
+	Assert(noffsets > 0 && noffsets <= MaxHeapTuplesPerPage);
+	Assert(lazy_dead_tuples_free_space(dead_tuples) >= MaxDeadPageSize);
+
+	/* Use a bitmap if it's smaller than the array of offsets */
+	bitmapsize = TYPEALIGN(sizeof(uint16),
+						   (offsets[noffsets - 1] - FirstOffsetNumber) / BITS_PER_BYTE + 1);
+	if (bitmapsize < noffsets * sizeof(OffsetNumber))
+		datasize = sizeof(uint16) + bitmapsize;
+	else
+		datasize = sizeof(uint16) + noffsets * sizeof(OffsetNumber);
+
+	dead_tuples->data_start -= datasize;
+	deadpage = &dead_tuples->pages[dead_tuples->num_pages++];
+	deadpage->blkno = blkno;
+	deadpage->dataoff = dead_tuples->data_start;
+	data = DeadPageData(dead_tuples, deadpage);
+
+	if (bitmapsize < noffsets * sizeof(OffsetNumber))
+	{
+		uint8	   *bitmap = (uint8 *) (data + 1);
+
+		data[0] = DEAD_OFFSETS_BITMAP | bitmapsize;
+		memset(bitmap, 0, bitmapsize);
+		for (i = 0; i < noffsets; i++)
+		{
+			int			bit = offsets[i] - FirstOffsetNumber;
+
+			bitmap[bit / BITS_PER_BYTE] |= 1 << (bit % BITS_PER_BYTE);
+		}
+	}
+	else
+	{
+		data[0] = noffsets;
+		memcpy(data + 1, offsets, noffsets * sizeof(OffsetNumber));
+	}
+
+	dead_tuples->num_tuples += noffsets;
+}
+
+/*
+ * lazy_get_dead_offsets - get the dead offsets of a page
+ *
+ * pageidx is the index of the page in the pages array.  The offsets are
+ * stored in ascending order into offsets, which must have room for
+ * MaxHeapTuplesPerPage entries, and their number is returned.
+ */
+static int
+lazy_get_dead_offsets(LVDeadTuples *dead_tuples, int pageidx,
+					  OffsetNumber *offsets)
+{
+	uint16	   *data = DeadPageData(dead_tuples, &dead_tuples->pages[pageidx]);
+	int			noffsets = 0;
+
+	if (data[0] & DEAD_OFFSETS_BITMAP)
+	{
+		uint8	   *bitmap = (uint8 *) (data + 1);
+		int			bitmapsize = data[0] & ~DEAD_OFFSETS_BITMAP;
+		int			bit;
+
+		for (bit = 0; bit < bitmapsize * BITS_PER_BYTE; bit++)
+		{
+			if (bitmap[bit / BITS_PER_BYTE] & (1 << (bit % BITS_PER_BYTE)))
+				offsets[noffsets++] = bit + FirstOffsetNumber;
+		}
+	}
+	else
 	{
-		dead_tuples->itemptrs[dead_tuples->num_tuples] = *itemptr;
-		dead_tuples->num_tuples++;
-		pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
-									 dead_tuples->num_tuples);
+		noffsets = data[0];
+		memcpy(offsets, data + 1, noffsets * sizeof(OffsetNumber));
 	}
+
+	return noffsets;
 }
 
 /*
@@ -2915,51 +3798,175 @@ lazy_record_dead_tuple(LVDeadTuples *dead_tuples, ItemPointer itemptr)
  *
  *		This has the right signature to be an IndexBulkDeleteCallback.
  *
- *		Assumes dead_tuples array is in sorted order.
+ *		Assumes the pages array of dead_tuples is in sorted order.
  */
 static bool
 lazy_tid_reaped(ItemPointer itemptr, void *state)
 {
 	LVDeadTuples *dead_tuples = (LVDeadTuples *) state;
-	ItemPointer res;
+	LVDeadPage	key;
+	LVDeadPage *deadpage;
+	OffsetNumber offnum;
+	uint16	   *data;
+
+	key.blkno = ItemPointerGetBlockNumber(itemptr);
+	deadpage = (LVDeadPage *) bsearch((void *) &key,
+									  (void *) dead_tuples->pages,
+									  dead_tuples->num_pages,
+									  sizeof(LVDeadPage),
+									  vac_cmp_dead_page);
+	if (deadpage == NULL)
+		return false;
+
+	offnum = ItemPointerGetOffsetNumber(itemptr);
+	data = DeadPageData(dead_tuples, deadpage);
 
-	res = (ItemPointer) bsearch((void *) itemptr,
-								(void *) dead_tuples->itemptrs,
-								dead_tuples->num_tuples,
-								sizeof(ItemPointerData),
-								vac_cmp_itemptr);
+	if (data[0] & DEAD_OFFSETS_BITMAP)
+	{
+		uint8	   *bitmap = (uint8 *) (data + 1);
+		int			bitmapsize = data[0] & ~DEAD_OFFSETS_BITMAP;
+		int			bit = offnum - FirstOffsetNumber;
+
+		return bit < bitmapsize * BITS_PER_BYTE &&
+			(bitmap[bit / BITS_PER_BYTE] & (1 << (bit % BITS_PER_BYTE))) != 0;
+	}
+	else
+	{
+		OffsetNumber *offsets = (OffsetNumber *) (data + 1);
+		int			noffsets = data[0];
+		int			i;
 
-	return (res != NULL);
+		/* The arrays are short, since bitmaps are used for long ones */
+		for (i = 0; i < noffsets && offsets[i] <= offnum; i++)
+		{
+			if (offsets[i] == offnum)
+				return true;
+		}
+		return false;
+	}
 }
 
 /*
  * Comparator routines for use with qsort() and bsearch().
  */
 static int
-vac_cmp_itemptr(const void *left, const void *right)
+vac_cmp_dead_page(const void *left, const void *right)
 {
 	BlockNumber lblk,
 				rblk;
-	OffsetNumber loff,
-				roff;
 
-	lblk = ItemPointerGetBlockNumber((ItemPointer) left);
-	rblk = ItemPointerGetBlockNumber((ItemPointer) right);
+	lblk = ((const LVDeadPage *) left)->blkno;
+	rblk = ((const LVDeadPage *) right)->blkno;
 
 	if (lblk < rblk)
 		return -1;
 	if (lblk > rblk)
 		return 1;
+	return 0;
+}
 
-	loff = ItemPointerGetOffsetNumber((ItemPointer) left);
-	roff = ItemPointerGetOffsetNumber((ItemPointer) right);
+/*
+ *	lazy_prepare_eager_freeze() -- prepare to freeze a whole page
+ *
+ * Called for a page whose tuples are all visible to everyone, but not all
+ * frozen.  Fills "frozen" with plans freezing every tuple using OldestXmin
+ * as the cutoff, which is safe since all the xmins precede it, replacing any
+ * plans already there.  Returns false without changing anything if some
+ * tuple has a MultiXactId xmax, because freezing that might require creating
+ * a new MultiXactId.
+ */
+static bool
+lazy_prepare_eager_freeze(Page page, TransactionId relfrozenxid,
+						  MultiXactId relminmxid,
+						  xl_heap_freeze_tuple *frozen,
+						  int *nfrozen, bool *all_frozen)
+{
+	OffsetNumber offnum,
+				maxoff;
+	int			n = 0;
 
-	if (loff < roff)
-		return -1;
-	if (loff > roff)
-		return 1;
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = FirstOffsetNumber;
+		 offnum <= maxoff;
+		 offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		HeapTupleHeader htup;
 
-	return 0;
+		if (!ItemIdIsNormal(itemid))
+			continue;
+
+		htup = (HeapTupleHeader) PageGetItem(page, itemid);
+		if (!(htup->t_infomask & HEAP_XMAX_INVALID) &&
+			(htup->t_infomask & HEAP_XMAX_IS_MULTI))
+			return false;
+	}
+
+	*all_frozen = true;
+	for (offnum = FirstOffsetNumber;
+		 offnum <= maxoff;
+		 offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		bool		tuple_totally_frozen;
+
+		if (!ItemIdIsNormal(itemid))
+			continue;
+
+		if (heap_prepare_freeze_tuple((HeapTupleHeader) PageGetItem(page, itemid),
+									  relfrozenxid, relminmxid,
+									  OldestXmin, MultiXactCutoff,
+									  &frozen[n],
+									  &tuple_totally_frozen))
+			frozen[n++].offset = offnum;
+
+		if (!tuple_totally_frozen)
+			*all_frozen = false;
+	}
+
+	*nfrozen = n;
+	return true;
+}
+
+/*
+ *	lazy_execute_freeze() -- freeze tuples on a page and WAL-log it
+ *
+ * Caller must hold a cleanup lock on the buffer.  We must log the changes to
+ * be crash-safe against future truncation of CLOG.
+ */
+static void
+lazy_execute_freeze(Relation onerel, Buffer buf, TransactionId cutoff_xid,
+					xl_heap_freeze_tuple *frozen, int nfrozen)
+{
+	Page		page = BufferGetPage(buf);
+	int			i;
+
+	START_CRIT_SECTION();
+
+	MarkBufferDirty(buf);
+
+	/* execute collected freezes */
+	for (i = 0; i < nfrozen; i++)
+	{
+		ItemId		itemid;
+		HeapTupleHeader htup;
+
+		itemid = PageGetItemId(page, frozen[i].offset);
+		htup = (HeapTupleHeader) PageGetItem(page, itemid);
+
+		heap_execute_freeze_tuple(htup, &frozen[i]);
+	}
+
+	/* Now WAL-log freezing if necessary */
+	if (RelationNeedsWAL(onerel))
+	{
+		XLogRecPtr	recptr;
+
+		recptr = log_heap_freeze(onerel, buf, cutoff_xid, frozen, nfrozen);
+		PageSetLSN(page, recptr);
+	}
+
+	END_CRIT_SECTION();
 }
 
 /*
@@ -3153,6 +4160,52 @@ compute_parallel_vacuum_workers(Relation *Irel, int nindexes, int nrequested,
 	return parallel_workers;
 }
 
+/*
+ * Compute the number of parallel worker processes to request for the heap
+ * passes.  Both passes use the same number of workers.
+ *
+ * We don't use workers for tables smaller than min_parallel_table_scan_size.
+ * If nrequested is 0, we compute the parallel degree based on the table size
+ * the same way a parallel sequential scan does, that is, one more worker
+ * each time the table triples in size.
+ */
+static int
+compute_parallel_heap_workers(BlockNumber nblocks, int nrequested)
+{
+	int			parallel_workers;
+
+	/*
+	 * We don't allow performing parallel operation in standalone backend or
+	 * when parallelism is disabled.
+	 */
+	if (!IsUnderPostmaster || max_parallel_maintenance_workers == 0)
+		return 0;
+
+	if (nblocks < (BlockNumber) min_parallel_table_scan_size)
+		return 0;
+
+	if (nrequested > 0)
+		parallel_workers = nrequested;
+	else
+	{
+		BlockNumber threshold = Max(min_parallel_table_scan_size, 1);
+
+		parallel_workers = 1;
+		while (nblocks >= (BlockNumber) threshold * 3)
+		{
+			parallel_workers++;
+			threshold *= 3;
+			if (threshold > INT_MAX / 3)
+				break;
+		}
+	}
+
+	/* Cap by max_parallel_maintenance_workers */
+	parallel_workers = Min(parallel_workers, max_parallel_maintenance_workers);
+
+	return parallel_workers;
+}
+
 /*
  * Initialize variables for shared index statistics, set NULL bitmap and the
  * size of stats for each index.
@@ -3210,11 +4263,13 @@ update_index_statistics(Relation *Irel, IndexBulkDeleteResult **stats,
 
 /*
  * This function prepares and returns parallel vacuum state if we can launch
- * even one worker.  This function is responsible for entering parallel mode,
- * create a parallel context, and then initialize the DSM segment.
+ * even one worker, either for the indexes or for the heap passes.  This
+ * function is responsible for entering parallel mode, create a parallel
+ * context, and then initialize the DSM segment.
  */
 static LVParallelState *
 begin_parallel_vacuum(Oid relid, Relation *Irel, LVRelStats *vacrelstats,
+					  VacuumParams *params, bool aggressive,
 					  BlockNumber nblocks, int nindexes, int nrequested)
 {
 	LVParallelState *lps = NULL;
@@ -3224,11 +4279,12 @@ begin_parallel_vacuum(Oid relid, Relation *Irel, LVRelStats *vacrelstats,
 	BufferUsage *buffer_usage;
 	WalUsage   *wal_usage;
 	bool	   *can_parallel_vacuum;
-	long		maxtuples;
+	Size		deadtuples_space;
 	Size		est_shared;
 	Size		est_deadtuples;
 	int			nindexes_mwm = 0;
 	int			parallel_workers = 0;
+	int			nworkers_heap;
 	int			querylen;
 	int			i;
 
@@ -3246,9 +4302,10 @@ begin_parallel_vacuum(Oid relid, Relation *Irel, LVRelStats *vacrelstats,
 	parallel_workers = compute_parallel_vacuum_workers(Irel, nindexes,
 													   nrequested,
 													   can_parallel_vacuum);
+	nworkers_heap = compute_parallel_heap_workers(nblocks, nrequested);
 
 	/* Can't perform vacuum in parallel */
-	if (parallel_workers <= 0)
+	if (parallel_workers <= 0 && nworkers_heap <= 0)
 	{
 		pfree(can_parallel_vacuum);
 		return lps;
@@ -3258,7 +4315,7 @@ begin_parallel_vacuum(Oid relid, Relation *Irel, LVRelStats *vacrelstats,
 
 	EnterParallelMode();
 	pcxt = CreateParallelContext("postgres", "parallel_vacuum_main",
-								 parallel_workers);
+								 Max(parallel_workers, nworkers_heap));
 	Assert(pcxt->nworkers > 0);
 	lps->pcxt = pcxt;
 
@@ -3300,8 +4357,8 @@ begin_parallel_vacuum(Oid relid, Relation *Irel, LVRelStats *vacrelstats,
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 
 	/* Estimate size for dead tuples -- PARALLEL_VACUUM_KEY_DEAD_TUPLES */
-	maxtuples = compute_max_dead_tuples(nblocks, true);
-	est_deadtuples = MAXALIGN(SizeOfDeadTuples(maxtuples));
+	deadtuples_space = compute_dead_tuples_space(nblocks, true);
+	est_deadtuples = MAXALIGN(SizeOfDeadTuples(deadtuples_space));
 	shm_toc_estimate_chunk(&pcxt->estimator, est_deadtuples);
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 
@@ -3332,15 +4389,26 @@ begin_parallel_vacuum(Oid relid, Relation *Irel, LVRelStats *vacrelstats,
 
 	InitializeParallelDSM(pcxt);
 
+	/* We might get fewer workers than we asked for */
+	lps->nworkers_heap = Min(nworkers_heap, pcxt->nworkers);
+
 	/* Prepare shared information */
 	shared = (LVShared *) shm_toc_allocate(pcxt->toc, est_shared);
 	MemSet(shared, 0, est_shared);
 	shared->relid = relid;
 	shared->elevel = elevel;
 	shared->maintenance_work_mem_worker =
-		(nindexes_mwm > 0) ?
+		(nindexes_mwm > 0 && parallel_workers > 0) ?
 		maintenance_work_mem / Min(parallel_workers, nindexes_mwm) :
 		maintenance_work_mem;
+	shared->params = *params;
+	shared->aggressive = aggressive;
+	shared->oldest_xmin = OldestXmin;
+	shared->freeze_limit = FreezeLimit;
+	shared->multixact_cutoff = MultiXactCutoff;
+	shared->eager_freeze_all = EagerFreezeAll;
+	shared->rel_pages = nblocks;
+	SpinLockInit(&shared->mutex);
 
 	pg_atomic_init_u32(&(shared->cost_balance), 0);
 	pg_atomic_init_u32(&(shared->active_nworkers), 0);
@@ -3353,9 +4421,9 @@ begin_parallel_vacuum(Oid relid, Relation *Irel, LVRelStats *vacrelstats,
 
 	/* Prepare the dead tuple space */
 	dead_tuples = (LVDeadTuples *) shm_toc_allocate(pcxt->toc, est_deadtuples);
-	dead_tuples->max_tuples = maxtuples;
-	dead_tuples->num_tuples = 0;
-	MemSet(dead_tuples->itemptrs, 0, sizeof(ItemPointerData) * maxtuples);
+	dead_tuples->max_bytes = (uint32) deadtuples_space;
+	dead_tuples->max_tuples = deadtuples_space / MinDeadTupleSize;
+	lazy_reset_dead_tuples(dead_tuples);
 	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_DEAD_TUPLES, dead_tuples);
 	vacrelstats->dead_tuples = dead_tuples;
 
@@ -3497,8 +4565,8 @@ skip_parallel_vacuum_index(Relation indrel, LVShared *lvshared)
 /*
  * Perform work within a launched parallel process.
  *
- * Since parallel vacuum workers perform only index vacuum or index cleanup,
- * we don't need to report progress information.
+ * Parallel vacuum workers don't report progress information; the leader
+ * does that on behalf of all participants.
  */
 void
 parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
@@ -3519,10 +4587,21 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 										   false);
 	elevel = lvshared->elevel;
 
-	if (lvshared->for_cleanup)
-		elog(DEBUG1, "starting parallel vacuum worker for cleanup");
-	else
-		elog(DEBUG1, "starting parallel vacuum worker for bulk delete");
+	switch (lvshared->task)
+	{
+		case PARALLEL_VACUUM_INDEXES:
+			if (lvshared->for_cleanup)
+				elog(DEBUG1, "starting parallel vacuum worker for cleanup");
+			else
+				elog(DEBUG1, "starting parallel vacuum worker for bulk delete");
+			break;
+		case PARALLEL_VACUUM_SCAN_HEAP:
+			elog(DEBUG1, "starting parallel vacuum worker for heap scan");
+			break;
+		case PARALLEL_VACUUM_VACUUM_HEAP:
+			elog(DEBUG1, "starting parallel vacuum worker for heap vacuum");
+			break;
+	}
 
 	/* Set debug_query_string for individual workers */
 	sharedquery = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_QUERY_TEXT, true);
@@ -3568,6 +4647,7 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	 * Initialize vacrelstats for use as error callback arg by parallel
 	 * worker.
 	 */
+	MemSet(&vacrelstats, 0, sizeof(LVRelStats));
 	vacrelstats.relnamespace = get_namespace_name(RelationGetNamespace(onerel));
 	vacrelstats.relname = pstrdup(RelationGetRelationName(onerel));
 	vacrelstats.indname = NULL;
@@ -3582,9 +4662,54 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	/* Prepare to track buffer usage during parallel execution */
 	InstrStartParallelQuery();
 
-	/* Process indexes to perform vacuum/cleanup */
-	parallel_vacuum_index(indrels, stats, lvshared, dead_tuples, nindexes,
-						  &vacrelstats);
+	switch (lvshared->task)
+	{
+		case PARALLEL_VACUUM_INDEXES:
+			/* Process indexes to perform vacuum/cleanup */
+			parallel_vacuum_index(indrels, stats, lvshared, dead_tuples,
+								  nindexes, &vacrelstats);
+			break;
+
+		case PARALLEL_VACUUM_SCAN_HEAP:
+		case PARALLEL_VACUUM_VACUUM_HEAP:
+			/* Use the same cutoffs as the leader */
+			OldestXmin = lvshared->oldest_xmin;
+			FreezeLimit = lvshared->freeze_limit;
+			MultiXactCutoff = lvshared->multixact_cutoff;
+			EagerFreezeAll = lvshared->eager_freeze_all;
+			vac_strategy = GetAccessStrategy(BAS_VACUUM);
+
+			vacrelstats.useindex = true;
+			vacrelstats.rel_pages = lvshared->rel_pages;
+
+			if (lvshared->task == PARALLEL_VACUUM_SCAN_HEAP)
+			{
+				LVHeapScanState scanstate;
+
+				/* Scan the heap, collecting dead tuples */
+				init_heap_scan_state(&scanstate, onerel, &lvshared->params,
+									 lvshared->aggressive, nindexes);
+				parallel_scan_heap(onerel, lvshared, dead_tuples,
+								   &vacrelstats, &scanstate);
+				pfree(scanstate.frozen);
+			}
+			else
+			{
+				int			npages;
+
+				/* Remove the collected dead tuples from the heap */
+				vacrelstats.dead_tuples = dead_tuples;
+				vacrelstats.latestRemovedXid = lvshared->latestRemovedXid;
+				vacrelstats.phase = VACUUM_ERRCB_PHASE_VACUUM_HEAP;
+				vacrelstats.blkno = InvalidBlockNumber;
+				npages = parallel_vacuum_heap(onerel, lvshared, &vacrelstats);
+
+				SpinLockAcquire(&lvshared->mutex);
+				lvshared->npages_vacuumed += npages;
+				SpinLockRelease(&lvshared->mutex);
+			}
+			break;
+	}
 
 	/* Report buffer/WAL usage during parallel execution */
 	buffer_usage = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_BUFFER_USAGE, false);
@@ -15,6 +15,7 @@
  *		visibilitymap_pin	 - pin a map page for setting a bit
  *		visibilitymap_pin_ok - check whether correct map page is already pinned
  *		visibilitymap_set	 - set a bit in a previously pinned page
+ *		visibilitymap_set_range - set bits for a range of newly written pages
  *		visibilitymap_get_status - get status of bits
  *		visibilitymap_count  - count number of bits set in visibility map
  *		visibilitymap_prepare_truncate -
@@ -89,6 +90,7 @@
 #include "access/heapam_xlog.h"
 #include "access/visibilitymap.h"
 #include "access/xlog.h"
+#include "access/xloginsert.h"
 #include "miscadmin.h"
 #include "port/pg_bitutils.h"
 #include "storage/bufmgr.h"
@@ -307,6 +309,56 @@ visibilitymap_set(Relation rel, BlockNumber heapBlk, Buffer heapBuf,
 	LockBuffer(vmBuf, BUFFER_LOCK_UNLOCK);
 }
 
+/*
+ *	visibilitymap_set_range - set bits for heap pages [startBlk, endBlk)
+ *
+ * This is for bulk loads that write new heap pages directly to storage,
+ * bypassing shared buffers, so there is no heap buffer to pass to
+ * visibilitymap_set().  The caller must already have made the heap pages
+ * durable (or, if the relation is not WAL-logged, arranged for them to be
+ * synced at commit).
+ *
+ * Rather than emitting one XLOG_HEAP2_VISIBLE record per heap page, each map
+ * page we modify is WAL-logged once as a full-page image.
+ */
+void
+visibilitymap_set_range(Relation rel, BlockNumber startBlk, BlockNumber endBlk,
+						uint8 flags)
+{
+	BlockNumber heapBlk = startBlk;
+	Buffer		vmBuf = InvalidBuffer;
+
+	Assert(flags & VISIBILITYMAP_VALID_BITS);
+
+	while (heapBlk < endBlk)
+	{
+		BlockNumber mapBlock = HEAPBLK_TO_MAPBLOCK(heapBlk);
+		uint8	   *map;
+
+		visibilitymap_pin(rel, heapBlk, &vmBuf);
+		map = (uint8 *) PageGetContents(BufferGetPage(vmBuf));
+
+		LockBuffer(vmBuf, BUFFER_LOCK_EXCLUSIVE);
+		START_CRIT_SECTION();
+
+		for (; heapBlk < endBlk && HEAPBLK_TO_MAPBLOCK(heapBlk) == mapBlock;
+			 heapBlk++)
+			map[HEAPBLK_TO_MAPBYTE(heapBlk)] |= (flags << HEAPBLK_TO_OFFSET(heapBlk));
+
+		MarkBufferDirty(vmBuf);
+
+		/* Map pages don't have the standard layout */
+		if (RelationNeedsWAL(rel))
+			log_newpage_buffer(vmBuf, false);
+
+		END_CRIT_SECTION();
+		LockBuffer(vmBuf, BUFFER_LOCK_UNLOCK);
+	}
+
+	if (BufferIsValid(vmBuf))
+		ReleaseBuffer(vmBuf);
+}
+
 /*
  *	visibilitymap_get_status - get status of bits
  *
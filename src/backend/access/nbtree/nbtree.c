@@ -32,10 +32,12 @@
 #include "storage/indexfsm.h"
 #include "storage/ipc.h"
 #include "storage/lmgr.h"
+#include "storage/read_stream.h"
 #include "storage/smgr.h"
 #include "utils/builtins.h"
 #include "utils/index_selfuncs.h"
 #include "utils/memutils.h"
+#include "utils/spccache.h"
 
 
 /* Working state needed by btvacuumpage */
@@ -51,6 +53,13 @@ typedef struct
 	MemoryContext pagedelcontext;
 } BTVacState;
 
+/* State of btvacuumscan's read stream */
+typedef struct
+{
+	BlockNumber next_block;
+	BlockNumber num_pages;
+} BTVacScanStreamState;
+
 /*
  * BTPARALLEL_NOT_INITIALIZED indicates that the scan has not started.
  *
@@ -90,10 +99,16 @@ typedef struct BTParallelScanDescData
 typedef struct BTParallelScanDescData *BTParallelScanDesc;
 
 
+/* GUC parameter */
+bool		btree_heap_prefetch = false;
+
+static void _bt_prefetch_heap(IndexScanDesc scan, ScanDirection dir);
 static void btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 						 IndexBulkDeleteCallback callback, void *callback_state,
 						 BTCycleId cycleid);
-static void btvacuumpage(BTVacState *vstate, BlockNumber scanblkno);
+static BlockNumber btvacuumscan_next_block(ReadStream *stream,
+										   void *callback_private_data);
+static void btvacuumpage(BTVacState *vstate, Buffer buf);
 static BTVacuumPosting btreevacuumposting(BTVacState *vstate,
 										  IndexTuple posting,
 										  OffsetNumber updatedoffset,
@@ -126,6 +141,7 @@ bthandler(PG_FUNCTION_ARGS)
 	amroutine->amcanparallel = true;
 	amroutine->amcaninclude = true;
 	amroutine->amusemaintenanceworkmem = false;
+	amroutine->amsummarizing = false;
 	amroutine->amparallelvacuumoptions =
 		VACUUM_OPTION_PARALLEL_BULKDEL | VACUUM_OPTION_PARALLEL_COND_CLEANUP;
 	amroutine->amkeytype = InvalidOid;
@@ -241,7 +257,20 @@ btgettuple(IndexScanDesc scan, ScanDirection dir)
 		_bt_start_array_keys(scan, dir);
 	}
 
-	/* This loop handles advancing to the next array elements, if any */
+	/*
+	 * Likewise, a skip scan starts from the first leading column value in
+	 * the scan direction.  We're done if the index is empty.
+	 */
+	if (so->skipScan && !BTScanPosIsValid(so->currPos))
+	{
+		if (!_bt_skip_probe(scan, dir, true))
+			return false;
+	}
+
+	/*
+	 * This loop handles advancing to the next array elements, or the next
+	 * leading column value for a skip scan, if any
+	 */
 	do
 	{
 		/*
@@ -284,11 +313,95 @@ btgettuple(IndexScanDesc scan, ScanDirection dir)
 		if (res)
 			break;
 		/* ... otherwise see if we have more array keys to deal with */
-	} while (so->numArrayKeys && _bt_advance_array_keys(scan, dir));
+	} while ((so->numArrayKeys && _bt_advance_array_keys(scan, dir)) ||
+			 (so->skipScan && _bt_skip_probe(scan, dir, false)));
+
+	if (res)
+		_bt_prefetch_heap(scan, dir);
 
 	return res;
 }
 
+/*
+ * _bt_prefetch_heap() -- prefetch heap blocks of upcoming items
+ *
+ * A plain index scan fetches the heap tuple for each TID as it is returned,
+ * so on a cold cache every heap block is a synchronous read.  We have the
+ * TIDs of all matching items on the current leaf page in currPos, though, so
+ * we can ask the kernel to start reading the heap blocks of the next few
+ * items while the caller processes the current one.  The items are still
+ * returned in index order.  Like bitmap heap scans, we look ahead as many
+ * items as the heap's tablespace effective_io_concurrency says, and we don't
+ * look past the end of the current leaf page.
+ *
+ * When the heap blocks are cached, which is the common case, prefetching
+ * only adds a buffer mapping lookup per block, so it is only done if
+ * btree_heap_prefetch is set.  Index-only scans are left alone, since they
+ * normally don't visit the heap.
+ */
+static void
+_bt_prefetch_heap(IndexScanDesc scan, ScanDirection dir)
+{
+#ifdef USE_PREFETCH
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	BTScanPos	pos = &so->currPos;
+
+	if (so->prefetchMaximum < 0)
+	{
+		if (!btree_heap_prefetch ||
+			scan->heapRelation == NULL || scan->xs_want_itup)
+			so->prefetchMaximum = 0;
+		else
+			so->prefetchMaximum =
+				get_tablespace_io_concurrency(scan->heapRelation->rd_rel->reltablespace);
+	}
+	if (so->prefetchMaximum == 0)
+		return;
+
+	if (ScanDirectionIsForward(dir))
+	{
+		int			limit = Min(pos->itemIndex + so->prefetchMaximum,
+								pos->lastItem);
+
+		/* the current item's block will be read right away, so skip it */
+		if (pos->nextPrefetch <= pos->itemIndex)
+			pos->nextPrefetch = pos->itemIndex + 1;
+
+		for (; pos->nextPrefetch <= limit; pos->nextPrefetch++)
+		{
+			BlockNumber blkno =
+			ItemPointerGetBlockNumber(&pos->items[pos->nextPrefetch].heapTid);
+
+			if (blkno != so->lastPrefetchBlock)
+			{
+				(void) PrefetchBuffer(scan->heapRelation, MAIN_FORKNUM, blkno);
+				so->lastPrefetchBlock = blkno;
+			}
+		}
+	}
+	else
+	{
+		int			limit = Max(pos->itemIndex - so->prefetchMaximum,
+								pos->firstItem);
+
+		if (pos->nextPrefetch >= pos->itemIndex)
+			pos->nextPrefetch = pos->itemIndex - 1;
+
+		for (; pos->nextPrefetch >= limit; pos->nextPrefetch--)
+		{
+			BlockNumber blkno =
+			ItemPointerGetBlockNumber(&pos->items[pos->nextPrefetch].heapTid);
+
+			if (blkno != so->lastPrefetchBlock)
+			{
+				(void) PrefetchBuffer(scan->heapRelation, MAIN_FORKNUM, blkno);
+				so->lastPrefetchBlock = blkno;
+			}
+		}
+	}
+#endif							/* USE_PREFETCH */
+}
+
 /*
  * btgetbitmap() -- gets all matching tuples, and adds them to a bitmap
  */
@@ -311,6 +424,13 @@ btgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 		_bt_start_array_keys(scan, ForwardScanDirection);
 	}
 
+	/* Likewise for the first leading column value of a skip scan */
+	if (so->skipScan)
+	{
+		if (!_bt_skip_probe(scan, ForwardScanDirection, true))
+			return ntids;
+	}
+
 	/* This loop handles advancing to the next array elements, if any */
 	do
 	{
@@ -341,8 +461,11 @@ btgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
 				ntids++;
 			}
 		}
-		/* Now see if we have more array keys to deal with */
-	} while (so->numArrayKeys && _bt_advance_array_keys(scan, ForwardScanDirection));
+		/* Now see if we have more array keys or skip values to deal with */
+	} while ((so->numArrayKeys &&
+			  _bt_advance_array_keys(scan, ForwardScanDirection)) ||
+			 (so->skipScan &&
+			  _bt_skip_probe(scan, ForwardScanDirection, false)));
 
 	return ntids;
 }
@@ -366,8 +489,10 @@ btbeginscan(Relation rel, int nkeys, int norderbys)
 	so = (BTScanOpaque) palloc(sizeof(BTScanOpaqueData));
 	BTScanPosInvalidate(so->currPos);
 	BTScanPosInvalidate(so->markPos);
+	/* leave room for the extra key of a skip scan */
 	if (scan->numberOfKeys > 0)
-		so->keyData = (ScanKey) palloc(scan->numberOfKeys * sizeof(ScanKeyData));
+		so->keyData = (ScanKey) palloc((scan->numberOfKeys + 1) *
+									   sizeof(ScanKeyData));
 	else
 		so->keyData = NULL;
 
@@ -375,10 +500,15 @@ btbeginscan(Relation rel, int nkeys, int norderbys)
 	so->numArrayKeys = 0;
 	so->arrayKeys = NULL;
 	so->arrayContext = NULL;
+	so->skipScan = false;
 
 	so->killedItems = NULL;		/* until needed */
 	so->numKilled = 0;
 
+	/* we don't know the heap relation yet, see _bt_prefetch_heap */
+	so->prefetchMaximum = -1;
+	so->lastPrefetchBlock = InvalidBlockNumber;
+
 	/*
 	 * We don't know yet whether the scan will be index-only, so we do not
 	 * allocate the tuple workspace arrays until btrescan.  However, we set up
@@ -388,6 +518,9 @@ btbeginscan(Relation rel, int nkeys, int norderbys)
 
 	scan->xs_itupdesc = RelationGetDescr(rel);
 
+	/* we load matching items a page at a time; see _bt_readpage */
+	scan->xs_batchno = 1;
+
 	scan->opaque = so;
 
 	return scan;
@@ -451,6 +584,9 @@ btrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
 
 	/* If any keys are SK_SEARCHARRAY type, set up array-key info */
 	_bt_preprocess_array_keys(scan);
+
+	/* If the leading column is unconstrained, consider a skip scan */
+	_bt_preprocess_skip_key(scan);
 }
 
 /*
@@ -517,6 +653,8 @@ btmarkpos(IndexScanDesc scan)
 	/* Also record the current positions of any array keys */
 	if (so->numArrayKeys)
 		_bt_mark_array_keys(scan);
+	if (so->skipScan)
+		_bt_mark_skip_key(scan);
 }
 
 /*
@@ -530,6 +668,8 @@ btrestrpos(IndexScanDesc scan)
 	/* Restore the marked positions of any array keys */
 	if (so->numArrayKeys)
 		_bt_restore_array_keys(scan);
+	if (so->skipScan)
+		_bt_restore_skip_key(scan);
 
 	if (so->markItemIndex >= 0)
 	{
@@ -973,6 +1113,9 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 	BlockNumber num_pages;
 	BlockNumber scanblkno;
 	bool		needLock;
+	BTVacScanStreamState streamstate;
+	ReadStream *stream;
+	Buffer		buf;
 
 	/*
 	 * Reset counts that will be incremented during the scan; needed in case
@@ -998,8 +1141,8 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 
 	/*
 	 * The outer loop iterates over all index pages except the metapage, in
-	 * physical order (we hope the kernel will cooperate in providing
-	 * read-ahead for speed).  It is critical that we visit all leaf pages,
+	 * physical order, using a read stream to read them ahead of time and in
+	 * larger chunks.  It is critical that we visit all leaf pages,
 	 * including ones added after we start the scan, else we might fail to
 	 * delete some deletable tuples.  Hence, we must repeatedly check the
 	 * relation length.  We must acquire the relation-extension lock while
@@ -1039,13 +1182,22 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 		if (scanblkno >= num_pages)
 			break;
 		/* Iterate over pages, then loop back to recheck length */
-		for (; scanblkno < num_pages; scanblkno++)
+		streamstate.next_block = scanblkno;
+		streamstate.num_pages = num_pages;
+		stream = read_stream_begin_relation(READ_STREAM_MAINTENANCE,
+											rel, MAIN_FORKNUM, info->strategy,
+											btvacuumscan_next_block,
+											&streamstate);
+		while ((buf = read_stream_next_buffer(stream)) != InvalidBuffer)
 		{
-			btvacuumpage(&vstate, scanblkno);
+			scanblkno = BufferGetBlockNumber(buf);
+			btvacuumpage(&vstate, buf);
 			if (info->report_progress)
 				pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_DONE,
 											 scanblkno);
 		}
+		read_stream_end(stream);
+		scanblkno = num_pages;
 	}
 
 	MemoryContextDelete(vstate.pagedelcontext);
@@ -1085,18 +1237,33 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 	stats->pages_free = vstate.totFreePages;
 }
 
+/*
+ * Read stream callback for btvacuumscan: return the pages in physical order
+ * up to the relation length it last saw.
+ */
+static BlockNumber
+btvacuumscan_next_block(ReadStream *stream, void *callback_private_data)
+{
+	BTVacScanStreamState *state = (BTVacScanStreamState *) callback_private_data;
+
+	if (state->next_block >= state->num_pages)
+		return InvalidBlockNumber;
+
+	return state->next_block++;
+}
+
 /*
  * btvacuumpage --- VACUUM one page
  *
- * This processes a single page for btvacuumscan().  In some cases we must
- * backtrack to re-examine and VACUUM pages that were the scanblkno during
- * a previous call here.  This is how we handle page splits (that happened
- * after our cycleid was acquired) whose right half page happened to reuse
- * a block that we might have processed at some point before it was
- * recycled (i.e. before the page split).
+ * This processes a single page for btvacuumscan(), which passes it to us
+ * pinned.  In some cases we must backtrack to re-examine and VACUUM pages
+ * that were the scanblkno during a previous call here.  This is how we
+ * handle page splits (that happened after our cycleid was acquired) whose
+ * right half page happened to reuse a block that we might have processed at
+ * some point before it was recycled (i.e. before the page split).
  */
 static void
-btvacuumpage(BTVacState *vstate, BlockNumber scanblkno)
+btvacuumpage(BTVacState *vstate, Buffer buf)
 {
 	IndexVacuumInfo *info = vstate->info;
 	IndexBulkDeleteResult *stats = vstate->stats;
@@ -1106,7 +1273,7 @@ btvacuumpage(BTVacState *vstate, BlockNumber scanblkno)
 	bool		attempt_pagedel;
 	BlockNumber blkno,
 				backtrack_to;
-	Buffer		buf;
+	BlockNumber scanblkno = BufferGetBlockNumber(buf);
 	Page		page;
 	BTPageOpaque opaque;
 
@@ -1124,10 +1291,11 @@ backtrack:
 	 * We can't use _bt_getbuf() here because it always applies
 	 * _bt_checkpage(), which will barf on an all-zero page. We want to
 	 * recycle all-zero pages, not fail.  Also, we want to use a nondefault
-	 * buffer access strategy.
+	 * buffer access strategy.  The scanblkno page was read by our caller.
 	 */
-	buf = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
-							 info->strategy);
+	if (blkno != scanblkno)
+		buf = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+								 info->strategy);
 	_bt_lockbuf(rel, buf, BT_READ);
 	page = BufferGetPage(buf);
 	opaque = NULL;
@@ -20,12 +20,18 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/predicate.h"
+#include "utils/date.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
+#include "utils/timestamp.h"
+#include "utils/uuid.h"
 
 
 static void _bt_drop_lock_and_maybe_pin(IndexScanDesc scan, BTScanPos sp);
 static OffsetNumber _bt_binsrch(Relation rel, BTScanInsert key, Buffer buf);
+static inline bool _bt_compare_inline(ScanKey scankey, Datum datum,
+									  int32 *result);
 static int	_bt_binsrch_posting(BTScanInsert key, Page page,
 								OffsetNumber offnum);
 static bool _bt_readpage(IndexScanDesc scan, ScanDirection dir,
@@ -613,6 +619,82 @@ _bt_binsrch_posting(BTScanInsert key, Page page, OffsetNumber offnum)
 	return low;
 }
 
+/*
+ *	_bt_compare_inline() -- Compare an index datum to a scankey argument,
+ *	without calling the comparison function through fmgr.
+ *
+ * The btree comparison support functions of the most common fixed-width key
+ * types are trivial, and the fmgr call overhead dominates their cost.  If
+ * sk_func is one of those, compute its result directly into *result and
+ * return true.  Otherwise (including for cross-type comparisons) return
+ * false, and the caller must call sk_func as usual.
+ *
+ * As with sk_func, the index datum is the left argument.
+ */
+static inline bool
+_bt_compare_inline(ScanKey scankey, Datum datum, int32 *result)
+{
+	switch (scankey->sk_func.fn_oid)
+	{
+		case F_BTINT2CMP:
+			{
+				int16		a = DatumGetInt16(datum);
+				int16		b = DatumGetInt16(scankey->sk_argument);
+
+				*result = (a > b) ? 1 : ((a == b) ? 0 : -1);
+				return true;
+			}
+		case F_BTINT4CMP:
+			{
+				int32		a = DatumGetInt32(datum);
+				int32		b = DatumGetInt32(scankey->sk_argument);
+
+				*result = (a > b) ? 1 : ((a == b) ? 0 : -1);
+				return true;
+			}
+		case F_BTINT8CMP:
+			{
+				int64		a = DatumGetInt64(datum);
+				int64		b = DatumGetInt64(scankey->sk_argument);
+
+				*result = (a > b) ? 1 : ((a == b) ? 0 : -1);
+				return true;
+			}
+		case F_BTOIDCMP:
+			{
+				Oid			a = DatumGetObjectId(datum);
+				Oid			b = DatumGetObjectId(scankey->sk_argument);
+
+				*result = (a > b) ? 1 : ((a == b) ? 0 : -1);
+				return true;
+			}
+		case F_DATE_CMP:
+			{
+				DateADT		a = DatumGetDateADT(datum);
+				DateADT		b = DatumGetDateADT(scankey->sk_argument);
+
+				*result = (a > b) ? 1 : ((a == b) ? 0 : -1);
+				return true;
+			}
+		case F_TIMESTAMP_CMP:
+			{
+				/* also used for timestamptz; see timestamp_cmp_internal() */
+				Timestamp	a = DatumGetTimestamp(datum);
+				Timestamp	b = DatumGetTimestamp(scankey->sk_argument);
+
+				*result = (a > b) ? 1 : ((a == b) ? 0 : -1);
+				return true;
+			}
+		case F_UUID_CMP:
+			*result = memcmp(DatumGetUUIDP(datum)->data,
+							 DatumGetUUIDP(scankey->sk_argument)->data,
+							 UUID_LEN);
+			return true;
+		default:
+			return false;
+	}
+}
+
 /*----------
  *	_bt_compare() -- Compare insertion-type scankey to tuple on a page.
  *
@@ -718,10 +800,11 @@ _bt_compare(Relation rel,
 			 * to flip the sign of the comparison result.  (Unless it's a DESC
 			 * column, in which case we *don't* flip the sign.)
 			 */
-			result = DatumGetInt32(FunctionCall2Coll(&scankey->sk_func,
-													 scankey->sk_collation,
-													 datum,
-													 scankey->sk_argument));
+			if (!_bt_compare_inline(scankey, datum, &result))
+				result = DatumGetInt32(FunctionCall2Coll(&scankey->sk_func,
+														 scankey->sk_collation,
+														 datum,
+														 scankey->sk_argument));
 
 			if (!(scankey->sk_flags & SK_BT_DESC))
 				INVERT_COMPARE_RESULT(result);
@@ -1526,6 +1609,12 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 	page = BufferGetPage(so->currPos.buf);
 	opaque = (BTPageOpaque) PageGetSpecialPointer(page);
 
+	/*
+	 * Tell index-only scans that the items we are about to load may be newer
+	 * than any visibility map status they have remembered.
+	 */
+	scan->xs_batchno++;
+
 	/* allow next page be processed by parallel worker */
 	if (scan->parallel_scan)
 	{
@@ -1660,6 +1749,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 		so->currPos.firstItem = 0;
 		so->currPos.lastItem = itemIndex - 1;
 		so->currPos.itemIndex = 0;
+		so->currPos.nextPrefetch = 0;
 	}
 	else
 	{
@@ -1755,6 +1845,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 		so->currPos.firstItem = itemIndex;
 		so->currPos.lastItem = MaxTIDsPerBTreePage - 1;
 		so->currPos.itemIndex = MaxTIDsPerBTreePage - 1;
+		so->currPos.nextPrefetch = MaxTIDsPerBTreePage - 1;
 	}
 
 	return (so->currPos.firstItem <= so->currPos.lastItem);
@@ -2461,6 +2552,143 @@ _bt_endpoint(IndexScanDesc scan, ScanDirection dir)
 	return true;
 }
 
+/*
+ *	_bt_skip_probe() -- Find the next leading column value for a skip scan
+ *
+ * If first is true, we find the first value of the index's leading column in
+ * the given scan direction; otherwise the first value beyond the current
+ * skip key value.  On success the skip key is set to the value found, ready
+ * for the next primitive index scan, and we return true.  If there are no
+ * more values, we return false.
+ *
+ * We look at the leaf items directly, rather than through _bt_readpage, since
+ * none of the scan's other keys matter here.  Each leaf page we examine is
+ * predicate-locked, because it is those pages that show there are no other
+ * leading column values in between.
+ */
+bool
+_bt_skip_probe(IndexScanDesc scan, ScanDirection dir, bool first)
+{
+	Relation	rel = scan->indexRelation;
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Buffer		buf;
+	Page		page;
+	BTPageOpaque opaque;
+	OffsetNumber offnum;
+	IndexTuple	itup;
+	Datum		value;
+	bool		isnull;
+
+	Assert(so->skipScan);
+
+	if (first)
+	{
+		buf = _bt_get_endpoint(rel, 0, ScanDirectionIsBackward(dir),
+							   scan->xs_snapshot);
+		if (!BufferIsValid(buf))
+		{
+			/* empty index, so lock the whole relation as _bt_first does */
+			PredicateLockRelation(rel, scan->xs_snapshot);
+			return false;
+		}
+		page = BufferGetPage(buf);
+		opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+		if (ScanDirectionIsForward(dir))
+			offnum = P_FIRSTDATAKEY(opaque);
+		else
+			offnum = PageGetMaxOffsetNumber(page);
+	}
+	else
+	{
+		ScanKey		skipkey = &so->arrayKeyData[0];
+		BTScanInsertData inskey;
+		BTStack		stack;
+		int			flags;
+
+		/*
+		 * Build an insertion scan key on just the leading column.  For a
+		 * forward scan we want the first item > the current value; for a
+		 * backward scan, the item just before the first item >= it.
+		 */
+		flags = (skipkey->sk_flags & SK_ISNULL) |
+			(rel->rd_indoption[0] << SK_BT_INDOPTION_SHIFT);
+		ScanKeyEntryInitializeWithInfo(inskey.scankeys,
+									   flags,
+									   1,
+									   InvalidStrategy,
+									   InvalidOid,
+									   rel->rd_indcollation[0],
+									   index_getprocinfo(rel, 1, BTORDER_PROC),
+									   skipkey->sk_argument);
+		_bt_metaversion(rel, &inskey.heapkeyspace, &inskey.allequalimage);
+		inskey.anynullkeys = false; /* unused */
+		inskey.nextkey = ScanDirectionIsForward(dir);
+		inskey.pivotsearch = false;
+		inskey.scantid = NULL;
+		inskey.keysz = 1;
+
+		stack = _bt_search(rel, &inskey, &buf, BT_READ, scan->xs_snapshot);
+		_bt_freestack(stack);
+
+		if (!BufferIsValid(buf))
+		{
+			/* index must have been emptied since the last probe */
+			PredicateLockRelation(rel, scan->xs_snapshot);
+			return false;
+		}
+		page = BufferGetPage(buf);
+		opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+		offnum = _bt_binsrch(rel, &inskey, buf);
+		if (ScanDirectionIsBackward(dir))
+			offnum = OffsetNumberPrev(offnum);
+	}
+
+	/* Step to neighboring leaf pages until we find an item */
+	for (;;)
+	{
+		if (!P_IGNORE(opaque))
+		{
+			PredicateLockPage(rel, BufferGetBlockNumber(buf),
+							  scan->xs_snapshot);
+			if (offnum >= P_FIRSTDATAKEY(opaque) &&
+				offnum <= PageGetMaxOffsetNumber(page))
+				break;
+		}
+
+		if (ScanDirectionIsForward(dir))
+		{
+			if (P_RIGHTMOST(opaque))
+			{
+				_bt_relbuf(rel, buf);
+				return false;
+			}
+			buf = _bt_relandgetbuf(rel, buf, opaque->btpo_next, BT_READ);
+			page = BufferGetPage(buf);
+			TestForOldSnapshot(scan->xs_snapshot, rel, page);
+			opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+			offnum = P_FIRSTDATAKEY(opaque);
+		}
+		else
+		{
+			/* _bt_walk_left releases our page, and copes with splits */
+			buf = _bt_walk_left(rel, buf, scan->xs_snapshot);
+			if (!BufferIsValid(buf))
+				return false;
+			page = BufferGetPage(buf);
+			opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+			offnum = PageGetMaxOffsetNumber(page);
+		}
+	}
+
+	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+	value = index_getattr(itup, 1, RelationGetDescr(rel), &isnull);
+	_bt_set_skip_key(scan, value, isnull);
+
+	_bt_relbuf(rel, buf);
+
+	return true;
+}
+
 /*
  * _bt_initialize_more_data() -- initialize moreLeft/moreRight appropriately
  * for scan direction
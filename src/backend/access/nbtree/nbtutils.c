@@ -23,11 +23,14 @@
 #include "catalog/catalog.h"
 #include "commands/progress.h"
 #include "lib/qunique.h"
+#include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "utils/array.h"
 #include "utils/datum.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/pg_locale.h"
 #include "utils/rel.h"
 
 
@@ -55,6 +58,9 @@ static bool _bt_check_rowcompare(ScanKey skey,
 								 ScanDirection dir, bool *continuescan);
 static int	_bt_keep_natts(Relation rel, IndexTuple lastleft,
 						   IndexTuple firstright, BTScanInsert itup_key);
+static IndexTuple _bt_truncate_att(Relation rel, IndexTuple lastleft,
+								   IndexTuple firstright, int keepnatts,
+								   BTScanInsert itup_key);
 
 
 /*
@@ -653,6 +659,179 @@ _bt_restore_array_keys(IndexScanDesc scan)
 	}
 }
 
+/*
+ *	_bt_preprocess_skip_key() -- Set up a skip scan, if possible
+ *
+ * When the scan has keys on the second index column but none on the first,
+ * none of its keys are required (see _bt_preprocess_keys), so an ordinary
+ * scan has to read the whole index.  Instead we perform a series of primitive
+ * index scans, one per distinct value of the first column, each with an
+ * added "=" key for that value.  That makes the keys on the second column
+ * required, and lets _bt_first use them to position each primitive scan, so
+ * we only visit the part of the index that can match.
+ *
+ * The added "skip key" is placed at the front of so->arrayKeyData, ahead of a
+ * copy of scan->keyData.  Its value is filled in by _bt_skip_probe, which
+ * finds the next distinct value in the index.  We don't try to combine skip
+ * scans with array keys, nor to coordinate them among parallel workers.
+ */
+void
+_bt_preprocess_skip_key(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	Oid			opcintype = rel->rd_opcintype[0];
+	Oid			eq_op;
+	RegProcedure eq_proc;
+	bool		useful;
+	int			i;
+	MemoryContext oldContext;
+
+	so->skipScan = false;
+
+	if (so->numArrayKeys != 0 || scan->parallel_scan != NULL)
+		return;
+
+	/* Input keys are ordered by attribute, so check for no keys on attr 1 */
+	if (scan->numberOfKeys < 1 || scan->keyData[0].sk_attno != 2)
+		return;
+
+	/* Insist on at least one key that can bound the scan of each value */
+	useful = false;
+	for (i = 0; i < scan->numberOfKeys; i++)
+	{
+		ScanKey		cur = &scan->keyData[i];
+
+		if (cur->sk_attno != 2)
+			break;
+		if (!(cur->sk_flags & SK_SEARCHNOTNULL))
+			useful = true;
+	}
+	if (!useful)
+		return;
+
+	eq_op = get_opfamily_member(rel->rd_opfamily[0], opcintype, opcintype,
+								BTEqualStrategyNumber);
+	if (!OidIsValid(eq_op))
+		return;
+	eq_proc = get_opcode(eq_op);
+	if (!RegProcedureIsValid(eq_proc))
+		return;
+
+	/* Skip key data lives in the array context, same as array key data */
+	if (so->arrayContext == NULL)
+		so->arrayContext = AllocSetContextCreate(CurrentMemoryContext,
+												 "BTree array context",
+												 ALLOCSET_SMALL_SIZES);
+	else
+		MemoryContextReset(so->arrayContext);
+
+	oldContext = MemoryContextSwitchTo(so->arrayContext);
+
+	so->arrayKeyData = (ScanKey) palloc((scan->numberOfKeys + 1) *
+										sizeof(ScanKeyData));
+	memcpy(so->arrayKeyData + 1,
+		   scan->keyData,
+		   scan->numberOfKeys * sizeof(ScanKeyData));
+	fmgr_info(eq_proc, &so->skipEqFunc);
+
+	/* Placeholder value, replaced by _bt_skip_probe before first use */
+	ScanKeyEntryInitialize(&so->arrayKeyData[0],
+						   SK_ISNULL | SK_SEARCHNULL,
+						   1,
+						   InvalidStrategy,
+						   InvalidOid,
+						   InvalidOid,
+						   InvalidOid,
+						   (Datum) 0);
+	so->skipMarkValue = (Datum) 0;
+	so->skipMarkIsNull = true;
+	so->skipScan = true;
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+/*
+ * _bt_set_skip_key() -- Set the skip key to the given leading column value
+ *
+ * value may point into a locked index page, so we make our own copy of it.
+ */
+void
+_bt_set_skip_key(IndexScanDesc scan, Datum value, bool isnull)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	Form_pg_attribute att = TupleDescAttr(RelationGetDescr(rel), 0);
+	ScanKey		skey = &so->arrayKeyData[0];
+	MemoryContext oldContext;
+
+	Assert(so->skipScan);
+
+	/* Free the previous value, if it was a pass-by-reference copy */
+	if (!(skey->sk_flags & SK_ISNULL) && !att->attbyval)
+		pfree(DatumGetPointer(skey->sk_argument));
+
+	if (isnull)
+	{
+		ScanKeyEntryInitialize(skey,
+							   SK_ISNULL | SK_SEARCHNULL,
+							   1,
+							   InvalidStrategy,
+							   InvalidOid,
+							   InvalidOid,
+							   InvalidOid,
+							   (Datum) 0);
+		return;
+	}
+
+	oldContext = MemoryContextSwitchTo(so->arrayContext);
+	ScanKeyEntryInitializeWithInfo(skey,
+								   0,
+								   1,
+								   BTEqualStrategyNumber,
+								   rel->rd_opcintype[0],
+								   rel->rd_indcollation[0],
+								   &so->skipEqFunc,
+								   datumCopy(value, att->attbyval, att->attlen));
+	MemoryContextSwitchTo(oldContext);
+}
+
+/*
+ * _bt_mark_skip_key() -- Handle the skip key during btmarkpos
+ */
+void
+_bt_mark_skip_key(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Form_pg_attribute att = TupleDescAttr(RelationGetDescr(scan->indexRelation), 0);
+	ScanKey		skey = &so->arrayKeyData[0];
+
+	if (!so->skipMarkIsNull && !att->attbyval)
+		pfree(DatumGetPointer(so->skipMarkValue));
+
+	so->skipMarkIsNull = (skey->sk_flags & SK_ISNULL) != 0;
+	if (so->skipMarkIsNull)
+		so->skipMarkValue = (Datum) 0;
+	else
+		so->skipMarkValue = datumCopy(skey->sk_argument, att->attbyval,
+									  att->attlen);
+}
+
+/*
+ * _bt_restore_skip_key() -- Handle the skip key during btrestrpos
+ */
+void
+_bt_restore_skip_key(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+
+	_bt_set_skip_key(scan, so->skipMarkValue, so->skipMarkIsNull);
+
+	/* As in _bt_restore_array_keys, redo preprocessing for the new key */
+	_bt_preprocess_keys(scan);
+	Assert(so->qual_ok);
+}
+
 
 /*
  *	_bt_preprocess_keys() -- Preprocess scan keys
@@ -763,12 +942,15 @@ _bt_preprocess_keys(IndexScanDesc scan)
 		return;					/* done if qual-less scan */
 
 	/*
-	 * Read so->arrayKeyData if array keys are present, else scan->keyData
+	 * Read so->arrayKeyData if array keys or a skip key are present, else
+	 * scan->keyData.  A skip key is an extra key, ahead of the others.
 	 */
 	if (so->arrayKeyData != NULL)
 		inkeys = so->arrayKeyData;
 	else
 		inkeys = scan->keyData;
+	if (so->skipScan)
+		numberOfKeys++;
 
 	outkeys = so->keyData;
 	cur = &inkeys[0];
@@ -2187,14 +2369,15 @@ btbuildphasename(int64 phasenum)
  * key attributes are treated as containing "minus infinity" values by
  * _bt_compare().
  *
+ * For some types we can also truncate within the last attribute kept; see
+ * _bt_truncate_att().
+ *
  * In the worst case (when a heap TID must be appended to distinguish lastleft
  * from firstright), the size of the returned tuple is the size of firstright
  * plus the size of an additional MAXALIGN()'d item pointer.  This guarantee
  * is important, since callers need to stay under the 1/3 of a page
- * restriction on tuple size.  If this routine is ever taught to truncate
- * within an attribute/datum, it will need to avoid returning an enlarged
- * tuple to caller when truncation + TOAST compression ends up enlarging the
- * final datum.
+ * restriction on tuple size.  Truncation within an attribute only ever
+ * replaces the tuple with a smaller one.
  */
 IndexTuple
 _bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright,
@@ -2244,6 +2427,21 @@ _bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright,
 	 */
 	if (keepnatts <= nkeyatts)
 	{
+		IndexTuple	shortpivot;
+
+		shortpivot = _bt_truncate_att(rel, lastleft, firstright, keepnatts,
+									  itup_key);
+		if (shortpivot != NULL)
+		{
+			if (IndexTupleSize(shortpivot) < IndexTupleSize(pivot))
+			{
+				pfree(pivot);
+				pivot = shortpivot;
+			}
+			else
+				pfree(shortpivot);
+		}
+
 		BTreeTupleSetNAtts(pivot, keepnatts, false);
 		return pivot;
 	}
@@ -2330,6 +2528,117 @@ _bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright,
 	return tidpivot;
 }
 
+/*
+ * _bt_truncate_att - truncate within the last attribute of a new pivot tuple
+ *
+ * Once _bt_keep_natts() has found the first attribute that distinguishes
+ * firstright from lastleft, any value of that attribute that is > lastleft's
+ * and <= firstright's works equally well in the new pivot tuple.  For types
+ * that sort bytewise, the shortest such value is the prefix of firstright's
+ * value that extends just past the prefix it shares with lastleft's.  With
+ * long keys that share long prefixes (URLs, file paths and the like) this
+ * makes for much smaller pivot tuples, and so more downlinks per internal
+ * page.  Truncated attributes after this one keep their usual "minus
+ * infinity" meaning.
+ *
+ * Returns a pivot tuple with keepnatts attributes, or NULL if we can't
+ * truncate the attribute.  Caller sets the number of attributes.
+ */
+static IndexTuple
+_bt_truncate_att(Relation rel, IndexTuple lastleft, IndexTuple firstright,
+				 int keepnatts, BTScanInsert itup_key)
+{
+	TupleDesc	itupdesc = RelationGetDescr(rel);
+	ScanKey		scankey = &itup_key->scankeys[keepnatts - 1];
+	Oid			cmpproc = scankey->sk_func.fn_oid;
+	TupleDesc	truncdesc;
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+	Datum		leftdatum,
+				rightdatum;
+	bool		leftnull,
+				rightnull;
+	struct varlena *left,
+			   *right,
+			   *prefix;
+	char	   *leftdata,
+			   *rightdata;
+	int			leftlen,
+				rightlen,
+				commonlen,
+				prefixlen;
+	IndexTuple	truncated;
+
+	/*
+	 * The new value sorts before firstright's, so it can't work for a DESC
+	 * column.  !heapkeyspace indexes only ever get whole-attribute pivots.
+	 */
+	if (!itup_key->heapkeyspace || (scankey->sk_flags & SK_BT_DESC))
+		return NULL;
+
+	/* Only bytea, and text compared bytewise, qualify */
+	if (cmpproc != F_BYTEACMP && cmpproc != F_BTTEXT_PATTERN_CMP &&
+		!(cmpproc == F_BTTEXTCMP && lc_collate_is_c(scankey->sk_collation)))
+		return NULL;
+
+	leftdatum = index_getattr(lastleft, keepnatts, itupdesc, &leftnull);
+	rightdatum = index_getattr(firstright, keepnatts, itupdesc, &rightnull);
+	if (leftnull || rightnull)
+		return NULL;
+
+	/* Leave compressed values alone, rather than decompressing them */
+	left = (struct varlena *) DatumGetPointer(leftdatum);
+	right = (struct varlena *) DatumGetPointer(rightdatum);
+	if (VARATT_IS_COMPRESSED(left) || VARATT_IS_EXTERNAL(left) ||
+		VARATT_IS_COMPRESSED(right) || VARATT_IS_EXTERNAL(right))
+		return NULL;
+
+	leftdata = VARDATA_ANY(left);
+	leftlen = VARSIZE_ANY_EXHDR(left);
+	rightdata = VARDATA_ANY(right);
+	rightlen = VARSIZE_ANY_EXHDR(right);
+
+	commonlen = 0;
+	while (commonlen < leftlen && commonlen < rightlen &&
+		   leftdata[commonlen] == rightdata[commonlen])
+		commonlen++;
+
+	/* firstright > lastleft, so it can't be a prefix of lastleft */
+	Assert(commonlen < rightlen);
+
+	/* Keep the first differing byte, or for text the whole character */
+	if (cmpproc == F_BYTEACMP)
+		prefixlen = commonlen + 1;
+	else
+	{
+		prefixlen = 0;
+		while (prefixlen <= commonlen)
+			prefixlen += pg_mblen(rightdata + prefixlen);
+		prefixlen = Min(prefixlen, rightlen);
+	}
+
+	if (prefixlen >= rightlen)
+		return NULL;
+
+	prefix = (struct varlena *) palloc(VARHDRSZ + prefixlen);
+	SET_VARSIZE(prefix, VARHDRSZ + prefixlen);
+	memcpy(VARDATA(prefix), rightdata, prefixlen);
+
+	/* Form the pivot as index_truncate_tuple() would, with the new value */
+	truncdesc = palloc(TupleDescSize(itupdesc));
+	TupleDescCopy(truncdesc, itupdesc);
+	truncdesc->natts = keepnatts;
+	index_deform_tuple(firstright, truncdesc, values, isnull);
+	values[keepnatts - 1] = PointerGetDatum(prefix);
+	truncated = index_form_tuple(truncdesc, values, isnull);
+	truncated->t_tid = firstright->t_tid;
+
+	pfree(truncdesc);
+	pfree(prefix);
+
+	return truncated;
+}
+
 /*
  * _bt_keep_natts - how many key attributes to keep when truncating.
  *
@@ -90,7 +90,7 @@ static SlruCtlData XactCtlData;
 
 
 static int	ZeroCLOGPage(int pageno, bool writeXlog);
-static bool CLOGPagePrecedes(int page1, int page2);
+static bool CLOGPagePrecedes(int64 page1, int64 page2);
 static void WriteZeroPageXlogRec(int pageno);
 static void WriteTruncateXlogRec(int pageno, TransactionId oldestXact,
 								 Oid oldestXactDb);
@@ -662,20 +662,26 @@ TransactionIdGetStatus(TransactionId xid, XLogRecPtr *lsn)
  * On larger multi-processor systems, it is possible to have many CLOG page
  * requests in flight at one time which could lead to disk access for CLOG
  * page if the required page is not found in memory.  Testing revealed that we
- * can get the best performance by having 128 CLOG buffers, more than that it
- * doesn't improve performance.
+ * can get the best performance by having at least 128 CLOG buffers.
  *
- * Unconditionally keeping the number of CLOG buffers to 128 did not seem like
- * a good idea, because it would increase the minimum amount of shared memory
+ * Workloads that look up the status of many old transactions benefit from
+ * more, so the number is set by transaction_buffers.  Since the buffers are
+ * searched one bank at a time, a large setting does not make lookups any
+ * slower.
+ *
+ * Unconditionally using a large number of CLOG buffers did not seem like a
+ * good idea, because it would increase the minimum amount of shared memory
  * required to start, which could be a problem for people running very small
- * configurations.  The following formula seems to represent a reasonable
- * compromise: people with very low values for shared_buffers will get fewer
- * CLOG buffers as well, and everyone else will get 128.
+ * configurations.  So by default (transaction_buffers = 0) people with very
+ * low values for shared_buffers get fewer CLOG buffers as well, and everyone
+ * else gets 1024.
  */
 Size
 CLOGShmemBuffers(void)
 {
-	return Min(128, Max(4, NBuffers / 512));
+	if (transaction_buffers == 0)
+		return SimpleLruAutotuneBuffers(512, 1024);
+	return transaction_buffers;
 }
 
 /*
@@ -877,7 +883,7 @@ ExtendCLOG(TransactionId newestXact)
 void
 TruncateCLOG(TransactionId oldestXact, Oid oldestxid_datoid)
 {
-	int			cutoffPage;
+	int64		cutoffPage;
 
 	/*
 	 * The cutoff point is the start of the segment containing oldestXact. We
@@ -921,7 +927,7 @@ TruncateCLOG(TransactionId oldestXact, Oid oldestxid_datoid)
  * offset both xids by FirstNormalTransactionId to avoid that.
  */
 static bool
-CLOGPagePrecedes(int page1, int page2)
+CLOGPagePrecedes(int64 page1, int64 page2)
 {
 	TransactionId xid1;
 	TransactionId xid2;
@@ -78,6 +78,7 @@
 #include "access/xloginsert.h"
 #include "catalog/pg_type.h"
 #include "commands/dbcommands.h"
+#include "common/hashfn.h"
 #include "funcapi.h"
 #include "lib/ilist.h"
 #include "miscadmin.h"
@@ -309,18 +310,44 @@ static MultiXactId *OldestVisibleMXactId;
  *
  * We allocate the cache entries in a memory context that is deleted at
  * transaction end, so we don't need to do retail freeing of entries.
+ *
+ * The entries are kept in LRU order in a list, and are also indexed by
+ * MultiXactId in a hash table, since lookups by ID (from heap_lock_tuple,
+ * heap_update and visibility checks on hot rows) are far more frequent than
+ * lookups by member set.  The latter still scan the list, but compare a hash
+ * of the sorted member set before comparing the members themselves.
  */
 typedef struct mXactCacheEnt
 {
 	MultiXactId multi;
 	int			nmembers;
+	uint32		sethash;		/* hash of the sorted members array */
 	dlist_node	node;
 	MultiXactMember members[FLEXIBLE_ARRAY_MEMBER];
 } mXactCacheEnt;
 
-#define MAX_CACHE_ENTRIES	256
+typedef struct mXactCacheIdEnt
+{
+	MultiXactId multi;			/* hash key */
+	char		status;			/* hash status */
+	mXactCacheEnt *entry;
+} mXactCacheIdEnt;
+
+#define SH_PREFIX		mxidcache
+#define SH_ELEMENT_TYPE	mXactCacheIdEnt
+#define SH_KEY_TYPE		MultiXactId
+#define SH_KEY			multi
+#define SH_HASH_KEY(tb, key)	murmurhash32(key)
+#define SH_EQUAL(tb, a, b)		((a) == (b))
+#define SH_SCOPE		static inline
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
+#define MAX_CACHE_ENTRIES	1024
 static dlist_head MXactCache = DLIST_STATIC_INIT(MXactCache);
 static int	MXactCacheMembers = 0;
+static mxidcache_hash *MXactCacheById = NULL;
 static MemoryContext MXactContext = NULL;
 
 #ifdef MULTIXACT_DEBUG
@@ -355,8 +382,8 @@ static char *mxstatus_to_string(MultiXactStatus status);
 /* management of SLRU infrastructure */
 static int	ZeroMultiXactOffsetPage(int pageno, bool writeXlog);
 static int	ZeroMultiXactMemberPage(int pageno, bool writeXlog);
-static bool MultiXactOffsetPagePrecedes(int page1, int page2);
-static bool MultiXactMemberPagePrecedes(int page1, int page2);
+static bool MultiXactOffsetPagePrecedes(int64 page1, int64 page2);
+static bool MultiXactMemberPagePrecedes(int64 page1, int64 page2);
 static bool MultiXactOffsetPrecedes(MultiXactOffset offset1,
 									MultiXactOffset offset2);
 static void ExtendMultiXactOffset(MultiXactId multi);
@@ -1494,18 +1521,21 @@ static MultiXactId
 mXactCacheGetBySet(int nmembers, MultiXactMember *members)
 {
 	dlist_iter	iter;
+	uint32		sethash;
 
 	debug_elog3(DEBUG2, "CacheGet: looking for %s",
 				mxid_to_string(InvalidMultiXactId, nmembers, members));
 
 	/* sort the array so comparison is easy */
 	qsort(members, nmembers, sizeof(MultiXactMember), mxactMemberComparator);
+	sethash = hash_bytes((const unsigned char *) members,
+						 nmembers * sizeof(MultiXactMember));
 
 	dlist_foreach(iter, &MXactCache)
 	{
 		mXactCacheEnt *entry = dlist_container(mXactCacheEnt, node, iter.cur);
 
-		if (entry->nmembers != nmembers)
+		if (entry->nmembers != nmembers || entry->sethash != sethash)
 			continue;
 
 		/*
@@ -1535,43 +1565,35 @@ mXactCacheGetBySet(int nmembers, MultiXactMember *members)
 static int
 mXactCacheGetById(MultiXactId multi, MultiXactMember **members)
 {
-	dlist_iter	iter;
+	mXactCacheIdEnt *hentry;
+	mXactCacheEnt *entry;
+	MultiXactMember *ptr;
+	Size		size;
 
 	debug_elog3(DEBUG2, "CacheGet: looking for %u", multi);
 
-	dlist_foreach(iter, &MXactCache)
+	if (MXactCacheById == NULL ||
+		(hentry = mxidcache_lookup(MXactCacheById, multi)) == NULL)
 	{
-		mXactCacheEnt *entry = dlist_container(mXactCacheEnt, node, iter.cur);
-
-		if (entry->multi == multi)
-		{
-			MultiXactMember *ptr;
-			Size		size;
-
-			size = sizeof(MultiXactMember) * entry->nmembers;
-			ptr = (MultiXactMember *) palloc(size);
-			*members = ptr;
+		debug_elog2(DEBUG2, "CacheGet: not found");
+		return -1;
+	}
 
-			memcpy(ptr, entry->members, size);
+	entry = hentry->entry;
+	size = sizeof(MultiXactMember) * entry->nmembers;
+	ptr = (MultiXactMember *) palloc(size);
+	*members = ptr;
 
-			debug_elog3(DEBUG2, "CacheGet: found %s",
-						mxid_to_string(multi,
-									   entry->nmembers,
-									   entry->members));
+	memcpy(ptr, entry->members, size);
 
-			/*
-			 * Note we modify the list while not using a modifiable iterator.
-			 * This is acceptable only because we exit the iteration
-			 * immediately afterwards.
-			 */
-			dlist_move_head(&MXactCache, iter.cur);
+	debug_elog3(DEBUG2, "CacheGet: found %s",
+				mxid_to_string(multi,
+							   entry->nmembers,
+							   entry->members));
 
-			return entry->nmembers;
-		}
-	}
+	dlist_move_head(&MXactCache, &entry->node);
 
-	debug_elog2(DEBUG2, "CacheGet: not found");
-	return -1;
+	return entry->nmembers;
 }
 
 /*
@@ -1582,6 +1604,8 @@ static void
 mXactCachePut(MultiXactId multi, int nmembers, MultiXactMember *members)
 {
 	mXactCacheEnt *entry;
+	mXactCacheIdEnt *hentry;
+	bool		found;
 
 	debug_elog3(DEBUG2, "CachePut: storing %s",
 				mxid_to_string(multi, nmembers, members));
@@ -1593,6 +1617,7 @@ mXactCachePut(MultiXactId multi, int nmembers, MultiXactMember *members)
 		MXactContext = AllocSetContextCreate(TopTransactionContext,
 											 "MultiXact cache context",
 											 ALLOCSET_SMALL_SIZES);
+		MXactCacheById = mxidcache_create(MXactContext, 64, NULL);
 	}
 
 	entry = (mXactCacheEnt *)
@@ -1606,6 +1631,11 @@ mXactCachePut(MultiXactId multi, int nmembers, MultiXactMember *members)
 
 	/* mXactCacheGetBySet assumes the entries are sorted, so sort them */
 	qsort(entry->members, nmembers, sizeof(MultiXactMember), mxactMemberComparator);
+	entry->sethash = hash_bytes((const unsigned char *) entry->members,
+								nmembers * sizeof(MultiXactMember));
+
+	hentry = mxidcache_insert(MXactCacheById, multi, &found);
+	hentry->entry = entry;
 
 	dlist_push_head(&MXactCache, &entry->node);
 	if (MXactCacheMembers++ >= MAX_CACHE_ENTRIES)
@@ -1621,6 +1651,11 @@ mXactCachePut(MultiXactId multi, int nmembers, MultiXactMember *members)
 		debug_elog3(DEBUG2, "CachePut: pruning cached multi %u",
 					entry->multi);
 
+		/* the hash entry may already point to a newer copy of this multi */
+		hentry = mxidcache_lookup(MXactCacheById, entry->multi);
+		if (hentry != NULL && hentry->entry == entry)
+			mxidcache_delete(MXactCacheById, entry->multi);
+
 		pfree(entry);
 	}
 }
@@ -1699,6 +1734,7 @@ AtEOXact_MultiXact(void)
 	MXactContext = NULL;
 	dlist_init(&MXactCache);
 	MXactCacheMembers = 0;
+	MXactCacheById = NULL;
 }
 
 /*
@@ -1766,6 +1802,7 @@ PostPrepare_MultiXact(TransactionId xid)
 	MXactContext = NULL;
 	dlist_init(&MXactCache);
 	MXactCacheMembers = 0;
+	MXactCacheById = NULL;
 }
 
 /*
@@ -1831,8 +1868,8 @@ MultiXactShmemSize(void)
 			 mul_size(sizeof(MultiXactId) * 2, MaxOldestSlot))
 
 	size = SHARED_MULTIXACT_STATE_SIZE;
-	size = add_size(size, SimpleLruShmemSize(NUM_MULTIXACTOFFSET_BUFFERS, 0));
-	size = add_size(size, SimpleLruShmemSize(NUM_MULTIXACTMEMBER_BUFFERS, 0));
+	size = add_size(size, SimpleLruShmemSize(multixact_offset_buffers, 0));
+	size = add_size(size, SimpleLruShmemSize(multixact_member_buffers, 0));
 
 	return size;
 }
@@ -1848,12 +1885,12 @@ MultiXactShmemInit(void)
 	MultiXactMemberCtl->PagePrecedes = MultiXactMemberPagePrecedes;
 
 	SimpleLruInit(MultiXactOffsetCtl,
-				  "MultiXactOffset", NUM_MULTIXACTOFFSET_BUFFERS, 0,
+				  "MultiXactOffset", multixact_offset_buffers, 0,
 				  MultiXactOffsetSLRULock, "pg_multixact/offsets",
 				  LWTRANCHE_MULTIXACTOFFSET_BUFFER,
 				  SYNC_HANDLER_MULTIXACT_OFFSET);
 	SimpleLruInit(MultiXactMemberCtl,
-				  "MultiXactMember", NUM_MULTIXACTMEMBER_BUFFERS, 0,
+				  "MultiXactMember", multixact_member_buffers, 0,
 				  MultiXactMemberSLRULock, "pg_multixact/members",
 				  LWTRANCHE_MULTIXACTMEMBER_BUFFER,
 				  SYNC_HANDLER_MULTIXACT_MEMBER);
@@ -2852,7 +2889,7 @@ MultiXactMemberFreezeThreshold(void)
 
 typedef struct mxtruncinfo
 {
-	int			earliestExistingPage;
+	int64		earliestExistingPage;
 } mxtruncinfo;
 
 /*
@@ -2860,7 +2897,8 @@ typedef struct mxtruncinfo
  *		This callback determines the earliest existing page number.
  */
 static bool
-SlruScanDirCbFindEarliest(SlruCtl ctl, char *filename, int segpage, void *data)
+SlruScanDirCbFindEarliest(SlruCtl ctl, char *filename, int64 segpage,
+						  void *data)
 {
 	mxtruncinfo *trunc = (mxtruncinfo *) data;
 
@@ -3107,7 +3145,7 @@ TruncateMultiXact(MultiXactId newOldestMulti, Oid newOldestMultiDB)
  * InvalidMultiXactId, but there's no harm in leaving this code like this.)
  */
 static bool
-MultiXactOffsetPagePrecedes(int page1, int page2)
+MultiXactOffsetPagePrecedes(int64 page1, int64 page2)
 {
 	MultiXactId multi1;
 	MultiXactId multi2;
@@ -3125,7 +3163,7 @@ MultiXactOffsetPagePrecedes(int page1, int page2)
  * purposes.  There is no "invalid offset number" so use the numbers verbatim.
  */
 static bool
-MultiXactMemberPagePrecedes(int page1, int page2)
+MultiXactMemberPagePrecedes(int64 page1, int64 page2)
 {
 	MultiXactOffset offset1;
 	MultiXactOffset offset2;
@@ -14,6 +14,10 @@
 
 #include "postgres.h"
 
+#include "access/brin.h"
+#include "access/gin_private.h"
+#include "access/gist_private.h"
+#include "access/hash.h"
 #include "access/heapam.h"
 #include "access/nbtree.h"
 #include "access/parallel.h"
@@ -25,6 +29,7 @@
 #include "catalog/pg_enum.h"
 #include "catalog/storage.h"
 #include "commands/async.h"
+#include "commands/copy.h"
 #include "executor/execParallel.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
@@ -143,8 +148,26 @@ static const struct
 	{
 		"_bt_parallel_build_main", _bt_parallel_build_main
 	},
+	{
+		"_gin_parallel_build_main", _gin_parallel_build_main
+	},
+	{
+		"_gist_parallel_build_main", _gist_parallel_build_main
+	},
+	{
+		"_brin_parallel_build_main", _brin_parallel_build_main
+	},
+	{
+		"_h_parallel_build_main", _h_parallel_build_main
+	},
 	{
 		"parallel_vacuum_main", parallel_vacuum_main
+	},
+	{
+		"ParallelCopyMain", ParallelCopyMain
+	},
+	{
+		"ParallelCopyToMain", ParallelCopyToMain
 	}
 };
 
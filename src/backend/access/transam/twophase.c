@@ -510,10 +510,10 @@ GXactLoadSubxactData(GlobalTransaction gxact, int nsubxacts,
 	PGPROC	   *proc = &ProcGlobal->allProcs[gxact->pgprocno];
 
 	/* We need no extra lock since the GXACT isn't valid yet */
-	if (nsubxacts > PGPROC_MAX_CACHED_SUBXIDS)
+	if (nsubxacts > max_cached_subxids)
 	{
 		proc->subxidStatus.overflowed = true;
-		nsubxacts = PGPROC_MAX_CACHED_SUBXIDS;
+		nsubxacts = max_cached_subxids;
 	}
 	if (nsubxacts > 0)
 	{
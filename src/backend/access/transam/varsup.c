@@ -239,7 +239,7 @@ GetNewTransactionId(bool isSubXact)
 		Assert(substat->count == MyProc->subxidStatus.count);
 		Assert(substat->overflowed == MyProc->subxidStatus.overflowed);
 
-		if (nxids < PGPROC_MAX_CACHED_SUBXIDS)
+		if (nxids < max_cached_subxids)
 		{
 			MyProc->subxids.xids[nxids] = xid;
 			pg_write_barrier();
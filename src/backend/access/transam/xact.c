@@ -769,12 +769,38 @@ GetCurrentCommandId(bool used)
 		 * could relax this restriction when currentCommandIdUsed was already
 		 * true at the start of the parallel operation.
 		 */
-		Assert(!IsParallelWorker());
+		Assert(!IsParallelWorker() || currentCommandIdUsed);
 		currentCommandIdUsed = true;
 	}
 	return currentCommandId;
 }
 
+/*
+ *	SetCurrentCommandIdUsedForWorker
+ *
+ * For a parallel worker, record that the current command ID has been used.
+ * This must only be called at the start of a parallel operation whose leader
+ * has already marked the command ID as used (see GetCurrentCommandId), since
+ * the worker has no way to report a newly used command ID back to it.
+ */
+void
+SetCurrentCommandIdUsedForWorker(void)
+{
+	Assert(IsParallelWorker() && !currentCommandIdUsed &&
+		   currentCommandId != InvalidCommandId);
+
+	currentCommandIdUsed = true;
+}
+
+/*
+ *	IsCurrentCommandIdUsed
+ */
+bool
+IsCurrentCommandIdUsed(void)
+{
+	return currentCommandIdUsed;
+}
+
 /*
  *	SetParallelStartTimestamps
  *
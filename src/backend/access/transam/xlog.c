@@ -35,6 +35,7 @@
 #include "access/xlog_internal.h"
 #include "access/xlogarchive.h"
 #include "access/xloginsert.h"
+#include "access/xlogprefetch.h"
 #include "access/xlogreader.h"
 #include "access/xlogutils.h"
 #include "catalog/catversion.h"
@@ -97,15 +98,16 @@ char	   *XLogArchiveCommand = NULL;
 bool		EnableHotStandby = false;
 bool		fullPageWrites = true;
 bool		wal_log_hints = false;
-bool		wal_compression = false;
+int			wal_compression = WAL_COMPRESSION_NONE;
 char	   *wal_consistency_checking_string = NULL;
 bool	   *wal_consistency_checking = NULL;
 bool		wal_init_zero = true;
 bool		wal_recycle = true;
+int			wal_prealloc_segments = 0;
 bool		log_checkpoints = false;
 int			sync_method = DEFAULT_SYNC_METHOD;
 int			wal_level = WAL_LEVEL_MINIMAL;
-int			CommitDelay = 0;	/* precommit delay in microseconds */
+int			CommitDelay = 0;	/* precommit delay in microseconds, or -1 */
 int			CommitSiblings = 5; /* # concurrent xacts needed to sleep */
 int			wal_retrieve_retry_interval = 5000;
 int			max_slot_wal_keep_size_mb = -1;
@@ -117,11 +119,20 @@ bool		XLOG_DEBUG = false;
 int			wal_segment_size = DEFAULT_XLOG_SEG_SIZE;
 
 /*
- * Number of WAL insertion locks to use. A higher value allows more insertions
- * to happen concurrently, but adds some CPU overhead to flushing the WAL,
- * which needs to iterate all the locks.
+ * Number of WAL insertion locks to use (GUC wal_insert_locks). A higher value
+ * allows more insertions to happen concurrently, but adds some CPU overhead
+ * to flushing the WAL, which needs to iterate all the locks.
  */
-#define NUM_XLOGINSERT_LOCKS  8
+int			NumXLogInsertLocks = 8;
+
+/*
+ * Upper limit for the commit delay, whether set by commit_delay or chosen
+ * adaptively by XLogFlushAdaptiveDelay().
+ */
+#define MAX_COMMIT_DELAY	100000
+
+/* Weight of the newest sample in the adaptive commit delay's averages */
+#define COMMIT_DELAY_SMOOTHING	0.1
 
 /*
  * Max distance from last checkpoint, before triggering a new xlog-based
@@ -616,6 +627,19 @@ typedef struct XLogCtlData
 	pg_time_t	lastSegSwitchTime;
 	XLogRecPtr	lastSegSwitchLSN;
 
+	/*
+	 * State of the adaptive commit delay (commit_delay = -1).  flushRequests
+	 * counts XLogFlush() calls that had to wait for a flush; the rest is
+	 * protected by WALWriteLock.  avgFlushTime and avgRequestInterval are
+	 * moving averages, in microseconds, of the duration of a flush and of
+	 * the time between flush requests.
+	 */
+	pg_atomic_uint64 flushRequests;
+	uint64		lastFlushRequests;	/* flushRequests at last flush */
+	instr_time	lastFlushTime;	/* when the last flush was started */
+	double		avgFlushTime;
+	double		avgRequestInterval;
+
 	/*
 	 * Protected by info_lck and WALWriteLock (you must hold either lock to
 	 * read it, but both to update)
@@ -636,11 +660,11 @@ typedef struct XLogCtlData
 
 	/*
 	 * These values do not change after startup, although the pointed-to pages
-	 * and xlblocks values certainly do.  xlblocks values are protected by
-	 * WALBufMappingLock.
+	 * and xlblocks values certainly do.  xlblocks values are changed while
+	 * holding WALBufMappingLock, but may be read without it.
 	 */
 	char	   *pages;			/* buffers for unwritten XLOG pages */
-	XLogRecPtr *xlblocks;		/* 1st byte ptr-s + XLOG_BLCKSZ */
+	pg_atomic_uint64 *xlblocks; /* 1st byte ptr-s + XLOG_BLCKSZ */
 	int			XLogCacheBlck;	/* highest allocated xlog buffer index */
 
 	/*
@@ -969,6 +993,7 @@ static void WALInsertLockAcquire(void);
 static void WALInsertLockAcquireExclusive(void);
 static void WALInsertLockRelease(void);
 static void WALInsertLockUpdateInsertingAt(XLogRecPtr insertingAt);
+static int	XLogFlushAdaptiveDelay(void);
 
 /*
  * Insert an XLOG record represented by an already-constructed chain of data
@@ -1000,7 +1025,8 @@ XLogRecPtr
 XLogInsertRecord(XLogRecData *rdata,
 				 XLogRecPtr fpw_lsn,
 				 uint8 flags,
-				 int num_fpi)
+				 int num_fpi,
+				 uint32 fpi_bytes)
 {
 	XLogCtlInsert *Insert = &XLogCtl->Insert;
 	pg_crc32c	rdata_crc;
@@ -1038,7 +1064,7 @@ XLogInsertRecord(XLogRecData *rdata,
 	 * inserter acquires an insertion lock. In addition to just indicating that
 	 * an insertion is in progress, the lock tells others how far the inserter
 	 * has progressed. There is a small fixed number of insertion locks,
-	 * determined by NUM_XLOGINSERT_LOCKS. When an inserter crosses a page
+	 * determined by wal_insert_locks. When an inserter crosses a page
 	 * boundary, it updates the value stored in the lock to the how far it has
 	 * inserted, to allow the previous buffer to be flushed.
 	 *
@@ -1262,6 +1288,8 @@ XLogInsertRecord(XLogRecData *rdata,
 		pgWalUsage.wal_bytes += rechdr->xl_tot_len;
 		pgWalUsage.wal_records++;
 		pgWalUsage.wal_fpi += num_fpi;
+		pgstat_count_wal_record(rechdr->xl_rmid, rechdr->xl_info,
+								rechdr->xl_tot_len, num_fpi, fpi_bytes);
 	}
 
 	return EndPos;
@@ -1669,7 +1697,7 @@ WALInsertLockAcquire(void)
 	static int	lockToTry = -1;
 
 	if (lockToTry == -1)
-		lockToTry = MyProc->pgprocno % NUM_XLOGINSERT_LOCKS;
+		lockToTry = MyProc->pgprocno % NumXLogInsertLocks;
 	MyLockNo = lockToTry;
 
 	/*
@@ -1687,7 +1715,7 @@ WALInsertLockAcquire(void)
 		 * than locks, it still helps to distribute the inserters evenly
 		 * across the locks.
 		 */
-		lockToTry = (lockToTry + 1) % NUM_XLOGINSERT_LOCKS;
+		lockToTry = (lockToTry + 1) % NumXLogInsertLocks;
 	}
 }
 
@@ -1705,7 +1733,7 @@ WALInsertLockAcquireExclusive(void)
 	 * indicator is set to 0xFFFFFFFFFFFFFFFF, which is higher than any real
 	 * XLogRecPtr value, to make sure that no-one blocks waiting on those.
 	 */
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS - 1; i++)
+	for (i = 0; i < NumXLogInsertLocks - 1; i++)
 	{
 		LWLockAcquire(&WALInsertLocks[i].l.lock, LW_EXCLUSIVE);
 		LWLockUpdateVar(&WALInsertLocks[i].l.lock,
@@ -1731,7 +1759,7 @@ WALInsertLockRelease(void)
 	{
 		int			i;
 
-		for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+		for (i = 0; i < NumXLogInsertLocks; i++)
 			LWLockReleaseClearVar(&WALInsertLocks[i].l.lock,
 								  &WALInsertLocks[i].l.insertingAt,
 								  0);
@@ -1759,8 +1787,8 @@ WALInsertLockUpdateInsertingAt(XLogRecPtr insertingAt)
 		 * We use the last lock to mark our actual position, see comments in
 		 * WALInsertLockAcquireExclusive.
 		 */
-		LWLockUpdateVar(&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.lock,
-						&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.insertingAt,
+		LWLockUpdateVar(&WALInsertLocks[NumXLogInsertLocks - 1].l.lock,
+						&WALInsertLocks[NumXLogInsertLocks - 1].l.insertingAt,
 						insertingAt);
 	}
 	else
@@ -1828,7 +1856,7 @@ WaitXLogInsertionsToFinish(XLogRecPtr upto)
 	 * out for any insertion that's still in progress.
 	 */
 	finishedUpto = reservedUpto;
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < NumXLogInsertLocks; i++)
 	{
 		XLogRecPtr	insertingat = InvalidXLogRecPtr;
 
@@ -1930,7 +1958,7 @@ GetXLogBuffer(XLogRecPtr ptr)
 	expectedEndPtr = ptr;
 	expectedEndPtr += XLOG_BLCKSZ - ptr % XLOG_BLCKSZ;
 
-	endptr = XLogCtl->xlblocks[idx];
+	endptr = pg_atomic_read_u64(&XLogCtl->xlblocks[idx]);
 	if (expectedEndPtr != endptr)
 	{
 		XLogRecPtr	initializedUpto;
@@ -1961,7 +1989,7 @@ GetXLogBuffer(XLogRecPtr ptr)
 		WALInsertLockUpdateInsertingAt(initializedUpto);
 
 		AdvanceXLInsertBuffer(ptr, false);
-		endptr = XLogCtl->xlblocks[idx];
+		endptr = pg_atomic_read_u64(&XLogCtl->xlblocks[idx]);
 
 		if (expectedEndPtr != endptr)
 			elog(PANIC, "could not find WAL buffer for %X/%X",
@@ -1989,6 +2017,68 @@ GetXLogBuffer(XLogRecPtr ptr)
 	return cachedPos + ptr % XLOG_BLCKSZ;
 }
 
+/*
+ * Copy WAL starting at startptr from the WAL buffers into dstbuf, without
+ * touching the WAL files.  Stops at the first page that is no longer (or not
+ * yet) in the buffers, and returns the number of bytes copied, which can be
+ * anything from 0 to count.
+ *
+ * This is meant for WAL that has already been flushed, which can't change
+ * anymore.  The only thing to worry about is the buffer being recycled for
+ * a later page while we're copying from it, so we check that the page is
+ * still there both before and after copying it.  AdvanceXLInsertBuffer()
+ * invalidates the xlblocks entry before reinitializing a buffer.
+ */
+Size
+XLogReadFromBuffers(char *dstbuf, XLogRecPtr startptr, Size count,
+					TimeLineID tli)
+{
+	char	   *dst = dstbuf;
+	XLogRecPtr	recptr = startptr;
+	Size		nbytes = count;
+
+	/* The buffers only hold WAL of the current timeline, and not in recovery */
+	if (RecoveryInProgress() || tli != XLogCtl->ThisTimeLineID)
+		return 0;
+
+	while (nbytes > 0)
+	{
+		XLogRecPtr	expectedEndPtr;
+		XLogRecPtr	endptr;
+		int			idx;
+		Size		offset;
+		Size		npagebytes;
+		char	   *page;
+
+		idx = XLogRecPtrToBufIdx(recptr);
+		expectedEndPtr = recptr - (recptr % XLOG_BLCKSZ) + XLOG_BLCKSZ;
+		offset = recptr % XLOG_BLCKSZ;
+		npagebytes = Min(nbytes, XLOG_BLCKSZ - offset);
+
+		endptr = pg_atomic_read_u64(&XLogCtl->xlblocks[idx]);
+		if (endptr != expectedEndPtr)
+			break;
+
+		/* Don't read the page contents before checking xlblocks */
+		pg_read_barrier();
+
+		page = XLogCtl->pages + idx * (Size) XLOG_BLCKSZ;
+		memcpy(dst, page + offset, npagebytes);
+
+		/* Make sure the page wasn't replaced while we were copying it */
+		pg_read_barrier();
+		endptr = pg_atomic_read_u64(&XLogCtl->xlblocks[idx]);
+		if (endptr != expectedEndPtr)
+			break;
+
+		dst += npagebytes;
+		recptr += npagebytes;
+		nbytes -= npagebytes;
+	}
+
+	return count - nbytes;
+}
+
 /*
  * Converts a "usable byte position" to XLogRecPtr. A usable byte position
  * is the position starting from the beginning of WAL, excluding all WAL
@@ -2148,7 +2238,7 @@ AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic)
 		 * be zero if the buffer hasn't been used yet).  Fall through if it's
 		 * already written out.
 		 */
-		OldPageRqstPtr = XLogCtl->xlblocks[nextidx];
+		OldPageRqstPtr = pg_atomic_read_u64(&XLogCtl->xlblocks[nextidx]);
 		if (LogwrtResult.Write < OldPageRqstPtr)
 		{
 			/*
@@ -2217,6 +2307,14 @@ AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic)
 
 		NewPage = (XLogPageHeader) (XLogCtl->pages + nextidx * (Size) XLOG_BLCKSZ);
 
+		/*
+		 * Mark the buffer as not containing any page while we reinitialize
+		 * it, so that XLogReadFromBuffers() can tell if the page it was
+		 * copying from got replaced.
+		 */
+		pg_atomic_write_u64(&XLogCtl->xlblocks[nextidx], InvalidXLogRecPtr);
+		pg_write_barrier();
+
 		/*
 		 * Be sure to re-zero the buffer so that bytes beyond what we've
 		 * written will look like zeroes and not valid XLOG records...
@@ -2270,7 +2368,7 @@ AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic)
 		 */
 		pg_write_barrier();
 
-		*((volatile XLogRecPtr *) &XLogCtl->xlblocks[nextidx]) = NewPageEndPtr;
+		pg_atomic_write_u64(&XLogCtl->xlblocks[nextidx], NewPageEndPtr);
 
 		XLogCtl->InitializedUpTo = NewPageEndPtr;
 
@@ -2459,7 +2557,7 @@ XLogWrite(XLogwrtRqst WriteRqst, bool flexible)
 		 * if we're passed a bogus WriteRqst.Write that is past the end of the
 		 * last page that's been initialized by AdvanceXLInsertBuffer.
 		 */
-		XLogRecPtr	EndPtr = XLogCtl->xlblocks[curridx];
+		XLogRecPtr	EndPtr = pg_atomic_read_u64(&XLogCtl->xlblocks[curridx]);
 
 		if (LogwrtResult.Write >= EndPtr)
 			elog(PANIC, "xlog write request %X/%X is past end of log %X/%X",
@@ -2867,6 +2965,10 @@ XLogFlush(XLogRecPtr record)
 	if (record <= LogwrtResult.Flush)
 		return;
 
+	WalStats.m_wal_flush_requests++;
+	if (CommitDelay < 0)
+		pg_atomic_fetch_add_u64(&XLogCtl->flushRequests, 1);
+
 #ifdef WAL_DEBUG
 	if (XLOG_DEBUG)
 		elog(LOG, "xlog flush request %X/%X; write %X/%X; flush %X/%X",
@@ -2944,32 +3046,58 @@ XLogFlush(XLogRecPtr record)
 		 * followers; this can significantly improve transaction throughput,
 		 * at the risk of increasing transaction latency.
 		 *
+		 * With commit_delay = -1, the delay is chosen based on how long
+		 * flushes take and how often they are requested, see
+		 * XLogFlushAdaptiveDelay().
+		 *
 		 * We do not sleep if enableFsync is not turned on, nor if there are
 		 * fewer than CommitSiblings other backends with active transactions.
 		 */
-		if (CommitDelay > 0 && enableFsync &&
-			MinimumActiveBackends(CommitSiblings))
+		if (CommitDelay != 0 && enableFsync)
 		{
-			pg_usleep(CommitDelay);
+			int			delay;
 
-			/*
-			 * Re-check how far we can now flush the WAL. It's generally not
-			 * safe to call WaitXLogInsertionsToFinish while holding
-			 * WALWriteLock, because an in-progress insertion might need to
-			 * also grab WALWriteLock to make progress. But we know that all
-			 * the insertions up to insertpos have already finished, because
-			 * that's what the earlier WaitXLogInsertionsToFinish() returned.
-			 * We're only calling it again to allow insertpos to be moved
-			 * further forward, not to actually wait for anyone.
-			 */
-			insertpos = WaitXLogInsertionsToFinish(insertpos);
+			delay = (CommitDelay > 0) ? CommitDelay : XLogFlushAdaptiveDelay();
+			if (delay > 0 && MinimumActiveBackends(CommitSiblings))
+			{
+				pg_usleep(delay);
+
+				/*
+				 * Re-check how far we can now flush the WAL. It's generally
+				 * not safe to call WaitXLogInsertionsToFinish while holding
+				 * WALWriteLock, because an in-progress insertion might need
+				 * to also grab WALWriteLock to make progress. But we know
+				 * that all the insertions up to insertpos have already
+				 * finished, because that's what the earlier
+				 * WaitXLogInsertionsToFinish() returned. We're only calling
+				 * it again to allow insertpos to be moved further forward,
+				 * not to actually wait for anyone.
+				 */
+				insertpos = WaitXLogInsertionsToFinish(insertpos);
+			}
 		}
 
 		/* try to write/flush later additions to XLOG as well */
 		WriteRqst.Write = insertpos;
 		WriteRqst.Flush = insertpos;
 
-		XLogWrite(WriteRqst, false);
+		if (CommitDelay < 0 && enableFsync)
+		{
+			instr_time	start;
+			instr_time	duration;
+
+			/* Keep track of how long flushes take, for the next delay */
+			INSTR_TIME_SET_CURRENT(start);
+			XLogWrite(WriteRqst, false);
+			INSTR_TIME_SET_CURRENT(duration);
+			INSTR_TIME_SUBTRACT(duration, start);
+			XLogCtl->avgFlushTime +=
+				COMMIT_DELAY_SMOOTHING *
+				(INSTR_TIME_GET_MICROSEC(duration) - XLogCtl->avgFlushTime);
+		}
+		else
+			XLogWrite(WriteRqst, false);
+		WalStats.m_wal_flushes++;
 
 		LWLockRelease(WALWriteLock);
 		/* done */
@@ -3009,6 +3137,56 @@ XLogFlush(XLogRecPtr record)
 			 (uint32) (LogwrtResult.Flush >> 32), (uint32) LogwrtResult.Flush);
 }
 
+/*
+ * Choose how long XLogFlush() should wait before flushing, when commit_delay
+ * is -1.  Caller must hold WALWriteLock.
+ *
+ * Waiting for half the time a flush takes is a common rule of thumb for
+ * commit_delay: backends that request a flush meanwhile can join this one,
+ * instead of having to wait for this flush and then another.  But that is
+ * only worth it if at least one request is expected to arrive during the
+ * wait, judging by how often flushes have recently been requested; otherwise
+ * it would just add latency.
+ */
+static int
+XLogFlushAdaptiveDelay(void)
+{
+	instr_time	now;
+	uint64		requests;
+	uint64		nrequests;
+	double		delay;
+
+	INSTR_TIME_SET_CURRENT(now);
+	requests = pg_atomic_read_u64(&XLogCtl->flushRequests);
+	nrequests = requests - XLogCtl->lastFlushRequests;
+
+	/* Update the average interval between requests since the last flush */
+	if (!INSTR_TIME_IS_ZERO(XLogCtl->lastFlushTime) && nrequests > 0)
+	{
+		instr_time	elapsed = now;
+		double		interval;
+
+		INSTR_TIME_SUBTRACT(elapsed, XLogCtl->lastFlushTime);
+		interval = INSTR_TIME_GET_MICROSEC(elapsed) / nrequests;
+
+		if (XLogCtl->avgRequestInterval == 0)
+			XLogCtl->avgRequestInterval = interval;
+		else
+			XLogCtl->avgRequestInterval +=
+				COMMIT_DELAY_SMOOTHING *
+				(interval - XLogCtl->avgRequestInterval);
+	}
+	XLogCtl->lastFlushRequests = requests;
+	XLogCtl->lastFlushTime = now;
+
+	delay = Min(XLogCtl->avgFlushTime / 2, MAX_COMMIT_DELAY);
+	if (XLogCtl->avgRequestInterval == 0 ||
+		delay < XLogCtl->avgRequestInterval)
+		return 0;
+
+	return (int) delay;
+}
+
 /*
  * Write & flush xlog, but without specifying exactly where to.
  *
@@ -3913,6 +4091,63 @@ PreallocXlogFiles(XLogRecPtr endptr)
 	}
 }
 
+/*
+ * Make sure that the wal_prealloc_segments segments following the one WAL
+ * is currently being inserted into exist, creating any that don't.
+ *
+ * This is called periodically by the walwriter.  PreallocXlogFiles() only
+ * runs at checkpoints, and checkpoints only recycle as many old segments as
+ * they expect to need, so a burst of WAL activity can otherwise leave
+ * backends to create and zero-fill new segments in the foreground, while
+ * holding WALWriteLock.
+ *
+ * Returns true if any segment was created.
+ */
+bool
+XLogPreallocFutureSegments(void)
+{
+	static XLogSegNo lastSegNo = 0;
+	static int	lastCount = 0;
+	XLogSegNo	insertSegNo;
+	bool		created = false;
+
+	if (wal_prealloc_segments <= 0 || RecoveryInProgress())
+		return false;
+
+	/* Nothing new to do until insertion moves on to another segment */
+	XLByteToSeg(GetXLogInsertRecPtr(), insertSegNo, wal_segment_size);
+	if (insertSegNo == lastSegNo && wal_prealloc_segments == lastCount)
+		return false;
+
+	/*
+	 * Remember this position before trying, so that a failure (such as
+	 * running out of disk space) isn't retried on every call.
+	 */
+	lastSegNo = insertSegNo;
+	lastCount = wal_prealloc_segments;
+
+	for (int i = 1; i <= wal_prealloc_segments; i++)
+	{
+		char		path[MAXPGPATH];
+		struct stat stat_buf;
+		bool		use_existent;
+		int			fd;
+
+		/* Recycled or previously created segments are good enough */
+		XLogFilePath(path, ThisTimeLineID, insertSegNo + i, wal_segment_size);
+		if (stat(path, &stat_buf) == 0)
+			continue;
+
+		use_existent = true;
+		fd = XLogFileInit(insertSegNo + i, &use_existent, true);
+		close(fd);
+		if (!use_existent)
+			created = true;
+	}
+
+	return created;
+}
+
 /*
  * Throws an error if the given log segment has already been removed or
  * recycled. The caller should only pass a segment that it knows to have
@@ -5065,9 +5300,10 @@ XLOGShmemSize(void)
 	size = sizeof(XLogCtlData);
 
 	/* WAL insertion locks, plus alignment */
-	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), NUM_XLOGINSERT_LOCKS + 1));
+	size = add_size(size, mul_size(sizeof(WALInsertLockPadded),
+								   NumXLogInsertLocks + 1));
 	/* xlblocks array */
-	size = add_size(size, mul_size(sizeof(XLogRecPtr), XLOGbuffers));
+	size = add_size(size, mul_size(sizeof(pg_atomic_uint64), XLOGbuffers));
 	/* extra alignment padding for XLOG I/O buffers */
 	size = add_size(size, XLOG_BLCKSZ);
 	/* and the buffers themselves */
@@ -5145,9 +5381,11 @@ XLOGShmemInit(void)
 	 * needed here.
 	 */
 	allocptr = ((char *) XLogCtl) + sizeof(XLogCtlData);
-	XLogCtl->xlblocks = (XLogRecPtr *) allocptr;
-	memset(XLogCtl->xlblocks, 0, sizeof(XLogRecPtr) * XLOGbuffers);
-	allocptr += sizeof(XLogRecPtr) * XLOGbuffers;
+	XLogCtl->xlblocks = (pg_atomic_uint64 *) allocptr;
+	allocptr += sizeof(pg_atomic_uint64) * XLOGbuffers;
+
+	for (i = 0; i < XLOGbuffers; i++)
+		pg_atomic_init_u64(&XLogCtl->xlblocks[i], InvalidXLogRecPtr);
 
 
 	/* WAL insertion locks. Ensure they're aligned to the full padded size */
@@ -5155,9 +5393,9 @@ XLOGShmemInit(void)
 		((uintptr_t) allocptr) % sizeof(WALInsertLockPadded);
 	WALInsertLocks = XLogCtl->Insert.WALInsertLocks =
 		(WALInsertLockPadded *) allocptr;
-	allocptr += sizeof(WALInsertLockPadded) * NUM_XLOGINSERT_LOCKS;
+	allocptr += sizeof(WALInsertLockPadded) * NumXLogInsertLocks;
 
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < NumXLogInsertLocks; i++)
 	{
 		LWLockInitialize(&WALInsertLocks[i].l.lock, LWTRANCHE_WAL_INSERT);
 		WALInsertLocks[i].l.insertingAt = InvalidXLogRecPtr;
@@ -5186,6 +5424,7 @@ XLOGShmemInit(void)
 	SpinLockInit(&XLogCtl->Insert.insertpos_lck);
 	SpinLockInit(&XLogCtl->info_lck);
 	SpinLockInit(&XLogCtl->ulsn_lck);
+	pg_atomic_init_u64(&XLogCtl->flushRequests, 0);
 }
 
 /*
@@ -7168,11 +7407,15 @@ StartupXLOG(void)
 			ErrorContextCallback errcallback;
 			TimestampTz xtime;
 			PGRUsage	ru0;
+			XLogPrefetcher *prefetcher;
 
 			pg_rusage_init(&ru0);
 
 			InRedo = true;
 
+			/* Prefetch blocks referenced by upcoming records, if enabled */
+			prefetcher = XLogPrefetcherAllocate();
+
 			ereport(LOG,
 					(errmsg("redo starts at %X/%X",
 							(uint32) (ReadRecPtr >> 32), (uint32) ReadRecPtr)));
@@ -7320,6 +7563,9 @@ StartupXLOG(void)
 					TransactionIdIsValid(record->xl_xid))
 					RecordKnownAssignedTransactionIds(record->xl_xid);
 
+				/* Start reads of blocks that upcoming records will need */
+				XLogPrefetcherReadAhead(prefetcher, xlogreader, ThisTimeLineID);
+
 				/* Now apply the WAL record itself */
 				RmgrTable[record->xl_rmid].rm_redo(xlogreader);
 
@@ -7428,6 +7674,8 @@ StartupXLOG(void)
 				}
 			}
 
+			XLogPrefetcherFree(prefetcher);
+
 			/* Allow resource managers to do any required cleanup. */
 			for (rmid = 0; rmid <= RM_MAX_ID; rmid++)
 			{
@@ -7465,6 +7713,14 @@ StartupXLOG(void)
 			ereport(FATAL,
 					(errmsg("recovery ended before configured recovery target was reached")));
 	}
+	else
+	{
+		/*
+		 * We were shut down cleanly, so restore the statistics saved at
+		 * shutdown.
+		 */
+		pgstat_restore_shared_stats();
+	}
 
 	/*
 	 * Kill WAL receiver, if it's still running, before we continue to write
@@ -7685,7 +7941,8 @@ StartupXLOG(void)
 		memcpy(page, xlogreader->readBuf, len);
 		memset(page + len, 0, XLOG_BLCKSZ - len);
 
-		XLogCtl->xlblocks[firstIdx] = pageBeginPtr + XLOG_BLCKSZ;
+		pg_atomic_write_u64(&XLogCtl->xlblocks[firstIdx],
+							pageBeginPtr + XLOG_BLCKSZ);
 		XLogCtl->InitializedUpTo = pageBeginPtr + XLOG_BLCKSZ;
 	}
 	else
@@ -8443,7 +8700,7 @@ GetLastImportantRecPtr(void)
 	XLogRecPtr	res = InvalidXLogRecPtr;
 	int			i;
 
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < NumXLogInsertLocks; i++)
 	{
 		XLogRecPtr	last_important;
 
@@ -8520,7 +8777,7 @@ ShutdownXLOG(int code, Datum arg)
 		 * process one more time at the end of shutdown). The checkpoint
 		 * record will go to the next XLOG file and won't be archived (yet).
 		 */
-		if (XLogArchivingActive() && XLogArchiveCommandSet())
+		if (XLogArchivingActive())
 			RequestXLogSwitch(false);
 
 		CreateCheckPoint(CHECKPOINT_IS_SHUTDOWN | CHECKPOINT_IMMEDIATE);
@@ -10347,27 +10604,20 @@ get_sync_bit(int method)
 {
 	int			o_direct_flag = 0;
 
-	/* If fsync is disabled, never open in sync mode */
-	if (!enableFsync)
-		return 0;
-
 	/*
-	 * Optimize writes by bypassing kernel cache with O_DIRECT when using
-	 * O_SYNC/O_FSYNC and O_DSYNC.  But only if archiving and streaming are
-	 * disabled, otherwise the archive command or walsender process will read
-	 * the WAL soon after writing it, which is guaranteed to cause a physical
-	 * read if we bypassed the kernel cache. We also skip the
-	 * posix_fadvise(POSIX_FADV_DONTNEED) call in XLogFileClose() for the same
-	 * reason.
-	 *
-	 * Never use O_DIRECT in walreceiver process for similar reasons; the WAL
-	 * written by walreceiver is normally read by the startup process soon
-	 * after its written. Also, walreceiver performs unaligned writes, which
-	 * don't work with O_DIRECT, so it is required for correctness too.
+	 * Bypass the kernel cache with O_DIRECT only if io_direct asks for it,
+	 * whatever the sync method.  Never use it in walreceiver, though: the WAL
+	 * it writes is normally read by the startup process soon after it's
+	 * written, and walreceiver performs unaligned writes, which don't work
+	 * with O_DIRECT.
 	 */
-	if (!XLogIsNeeded() && !AmWalReceiverProcess())
+	if ((io_direct_flags & IO_DIRECT_WAL) && !AmWalReceiverProcess())
 		o_direct_flag = PG_O_DIRECT;
 
+	/* If fsync is disabled, never open in sync mode */
+	if (!enableFsync)
+		return o_direct_flag;
+
 	switch (method)
 	{
 			/*
@@ -10379,7 +10629,7 @@ get_sync_bit(int method)
 		case SYNC_METHOD_FSYNC:
 		case SYNC_METHOD_FSYNC_WRITETHROUGH:
 		case SYNC_METHOD_FDATASYNC:
-			return 0;
+			return o_direct_flag;
 #ifdef OPEN_SYNC_FLAG
 		case SYNC_METHOD_OPEN:
 			return OPEN_SYNC_FLAG | o_direct_flag;
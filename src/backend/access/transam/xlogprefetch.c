@@ -0,0 +1,357 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogprefetch.c
+ *		Prefetching support for recovery.
+ *
+ * During recovery the startup process replays WAL records one at a time,
+ * and each record that references a block which isn't in shared buffers
+ * makes it wait for a synchronous read.  On storage with high latency that
+ * makes replay much slower than the primary that generated the WAL.
+ *
+ * The prefetcher reads the WAL ahead of replay with an XLogReader of its
+ * own, and calls PrefetchSharedBuffer() for the blocks referenced by the
+ * records it decodes, so that the kernel can read them in while replay is
+ * still busy with earlier records.  It looks no further ahead than
+ * max_recovery_prefetch_distance bytes of WAL, and keeps no more than
+ * maintenance_io_concurrency prefetches in flight, where a prefetch is
+ * considered complete once replay has reached the record that caused it.
+ *
+ * Blocks that a record will initialize, or restore from a full page image,
+ * are not prefetched, since replay won't read them.  Neither are blocks
+ * that were prefetched very recently, which is common as consecutive
+ * records often touch the same pages.
+ *
+ * Only WAL already present in pg_wal can be read ahead, that is WAL written
+ * before a crash or received by walreceiver.  Whenever the prefetcher can't
+ * read or decode the WAL ahead, for instance because it hasn't arrived yet
+ * or because it is being restored from the archive one segment at a time,
+ * it gives up until replay has caught up with it.  None of this affects
+ * correctness, only how often replay has to wait for reads.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/backend/access/transam/xlogprefetch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <unistd.h>
+
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
+#include "access/xlogreader.h"
+#include "pgstat.h"
+#include "storage/bufmgr.h"
+#include "storage/fd.h"
+#include "storage/smgr.h"
+
+/* Number of recently prefetched blocks remembered, to skip repeats */
+#define XLOGPREFETCHER_RECENT_SIZE	8
+
+/* GUC parameter */
+int			max_recovery_prefetch_distance = 256 * 1024;
+
+typedef struct XLogPrefetcherRecentBlock
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber blkno;
+} XLogPrefetcherRecentBlock;
+
+struct XLogPrefetcher
+{
+	/* Reader running ahead of replay, and the WAL file it has open */
+	XLogReaderState *reader;
+	bool		started;
+	TimeLineID	tli;
+	int			file;
+	XLogSegNo	file_segno;
+	TimeLineID	file_tli;
+
+	/*
+	 * Next block reference of the reader's current record to look at, or -1
+	 * if all of them have been dealt with.
+	 */
+	int			next_block_id;
+
+	/* Don't try reading ahead again until replay has reached this point */
+	XLogRecPtr	stalled_until;
+
+	/*
+	 * Start LSNs of the records whose prefetches are believed to be still in
+	 * flight, oldest first, in a circular queue.
+	 */
+	XLogRecPtr	inflight[MAX_IO_CONCURRENCY];
+	int			inflight_head;
+	int			inflight_count;
+
+	/* Recently prefetched blocks, in a circular buffer */
+	XLogPrefetcherRecentBlock recent[XLOGPREFETCHER_RECENT_SIZE];
+	int			recent_next;
+
+	/* Statistics, reported at the end */
+	uint64		prefetch;
+	uint64		skip_hit;
+	uint64		skip_new;
+	uint64		skip_fpw;
+	uint64		skip_repeat;
+};
+
+static int	XLogPrefetcherPageRead(XLogReaderState *reader,
+								   XLogRecPtr targetPagePtr, int reqLen,
+								   XLogRecPtr targetRecPtr, char *readBuf);
+static bool XLogPrefetcherScanBlocks(XLogPrefetcher *prefetcher);
+static bool XLogPrefetcherIsRepeat(XLogPrefetcher *prefetcher,
+								   DecodedBkpBlock *block);
+
+/*
+ * Create a prefetcher, for use by the startup process's redo loop.
+ */
+XLogPrefetcher *
+XLogPrefetcherAllocate(void)
+{
+	XLogPrefetcher *prefetcher;
+
+	prefetcher = palloc0(sizeof(XLogPrefetcher));
+	prefetcher->reader =
+		XLogReaderAllocate(wal_segment_size, NULL,
+						   XL_ROUTINE(.page_read = &XLogPrefetcherPageRead),
+						   prefetcher);
+	if (!prefetcher->reader)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+	prefetcher->file = -1;
+	prefetcher->next_block_id = -1;
+
+	return prefetcher;
+}
+
+/*
+ * Free a prefetcher, after reporting what it did.
+ */
+void
+XLogPrefetcherFree(XLogPrefetcher *prefetcher)
+{
+	elog(DEBUG1,
+		 "recovery prefetch: " UINT64_FORMAT " blocks prefetched, skipped "
+		 UINT64_FORMAT " in shared buffers, " UINT64_FORMAT " initialized, "
+		 UINT64_FORMAT " with full page image, " UINT64_FORMAT " repeated",
+		 prefetcher->prefetch, prefetcher->skip_hit, prefetcher->skip_new,
+		 prefetcher->skip_fpw, prefetcher->skip_repeat);
+
+	if (prefetcher->file >= 0)
+		close(prefetcher->file);
+	XLogReaderFree(prefetcher->reader);
+	pfree(prefetcher);
+}
+
+/*
+ * Issue prefetches for the blocks referenced by the records following the
+ * one that "replaying" is about to replay, as far ahead as allowed.  "tli"
+ * is the timeline being replayed, whose segments the WAL ahead is read from.
+ */
+void
+XLogPrefetcherReadAhead(XLogPrefetcher *prefetcher,
+						XLogReaderState *replaying,
+						TimeLineID tli)
+{
+	XLogReaderState *reader = prefetcher->reader;
+	XLogRecPtr	replay_lsn = replaying->ReadRecPtr;
+
+	/* Forget about prefetches for records that replay has reached */
+	while (prefetcher->inflight_count > 0 &&
+		   prefetcher->inflight[prefetcher->inflight_head] <= replay_lsn)
+	{
+		prefetcher->inflight_head =
+			(prefetcher->inflight_head + 1) % MAX_IO_CONCURRENCY;
+		prefetcher->inflight_count--;
+	}
+
+	if (max_recovery_prefetch_distance <= 0 ||
+		maintenance_io_concurrency <= 0 ||
+		replay_lsn < prefetcher->stalled_until)
+		return;
+
+	/*
+	 * Start reading right after the record being replayed if we haven't
+	 * started yet, gave up earlier, or have fallen behind replay.
+	 */
+	if (!prefetcher->started || prefetcher->tli != tli ||
+		reader->EndRecPtr < replaying->EndRecPtr)
+	{
+		XLogBeginRead(reader, replaying->EndRecPtr);
+		prefetcher->started = true;
+		prefetcher->tli = tli;
+		prefetcher->next_block_id = -1;
+	}
+
+	for (;;)
+	{
+		XLogRecPtr	next_lsn = reader->EndRecPtr;
+		char	   *errormsg;
+
+		/* Finish the current record, unless too much I/O is in flight */
+		if (prefetcher->next_block_id >= 0 &&
+			!XLogPrefetcherScanBlocks(prefetcher))
+			return;
+
+		/* Don't look any further ahead than allowed */
+		if (next_lsn - replay_lsn >= (XLogRecPtr) max_recovery_prefetch_distance)
+			return;
+
+		if (XLogReadRecord(reader, &errormsg) == NULL)
+		{
+			/* Try again once replay has read this far itself */
+			prefetcher->started = false;
+			prefetcher->stalled_until = next_lsn;
+			return;
+		}
+
+		prefetcher->next_block_id = 0;
+	}
+}
+
+/*
+ * Issue prefetches for the remaining block references in the reader's
+ * current record.  Returns false if we have to stop halfway because
+ * maintenance_io_concurrency prefetches are in flight.
+ */
+static bool
+XLogPrefetcherScanBlocks(XLogPrefetcher *prefetcher)
+{
+	XLogReaderState *reader = prefetcher->reader;
+
+	for (; prefetcher->next_block_id <= reader->max_block_id;
+		 prefetcher->next_block_id++)
+	{
+		DecodedBkpBlock *block = &reader->blocks[prefetcher->next_block_id];
+		SMgrRelation reln;
+		PrefetchBufferResult result;
+
+		if (!block->in_use)
+			continue;
+
+		/* Replay won't read pages it initializes or restores. */
+		if (block->flags & BKPBLOCK_WILL_INIT)
+		{
+			prefetcher->skip_new++;
+			continue;
+		}
+		if (block->has_image && block->apply_image)
+		{
+			prefetcher->skip_fpw++;
+			continue;
+		}
+
+		if (prefetcher->inflight_count >= maintenance_io_concurrency)
+			return false;
+
+		if (XLogPrefetcherIsRepeat(prefetcher, block))
+		{
+			prefetcher->skip_repeat++;
+			continue;
+		}
+
+		reln = smgropen(block->rnode, InvalidBackendId);
+		result = PrefetchSharedBuffer(reln, block->forknum, block->blkno);
+
+		if (result.initiated_io)
+		{
+			int			idx;
+
+			idx = (prefetcher->inflight_head + prefetcher->inflight_count) %
+				MAX_IO_CONCURRENCY;
+			prefetcher->inflight[idx] = reader->ReadRecPtr;
+			prefetcher->inflight_count++;
+			prefetcher->prefetch++;
+		}
+		else
+			prefetcher->skip_hit++;
+	}
+
+	prefetcher->next_block_id = -1;
+
+	return true;
+}
+
+/*
+ * Has this block been prefetched recently?  If not, remember it.
+ */
+static bool
+XLogPrefetcherIsRepeat(XLogPrefetcher *prefetcher, DecodedBkpBlock *block)
+{
+	XLogPrefetcherRecentBlock *recent;
+
+	for (int i = 0; i < XLOGPREFETCHER_RECENT_SIZE; i++)
+	{
+		recent = &prefetcher->recent[i];
+
+		if (RelFileNodeEquals(recent->rnode, block->rnode) &&
+			recent->forknum == block->forknum &&
+			recent->blkno == block->blkno)
+			return true;
+	}
+
+	recent = &prefetcher->recent[prefetcher->recent_next];
+	recent->rnode = block->rnode;
+	recent->forknum = block->forknum;
+	recent->blkno = block->blkno;
+	prefetcher->recent_next =
+		(prefetcher->recent_next + 1) % XLOGPREFETCHER_RECENT_SIZE;
+
+	return false;
+}
+
+/*
+ * XLogReaderRoutine->page_read callback for the prefetcher's reader.
+ *
+ * Reads straight from the segment files in pg_wal, and fails rather than
+ * waiting or restoring anything from the archive if a page isn't there.
+ */
+static int
+XLogPrefetcherPageRead(XLogReaderState *reader, XLogRecPtr targetPagePtr,
+					   int reqLen, XLogRecPtr targetRecPtr, char *readBuf)
+{
+	XLogPrefetcher *prefetcher = (XLogPrefetcher *) reader->private_data;
+	XLogSegNo	segno;
+	uint32		offset;
+	int			nread;
+
+	XLByteToSeg(targetPagePtr, segno, wal_segment_size);
+	offset = XLogSegmentOffset(targetPagePtr, wal_segment_size);
+
+	if (prefetcher->file >= 0 &&
+		(prefetcher->file_segno != segno ||
+		 prefetcher->file_tli != prefetcher->tli))
+	{
+		close(prefetcher->file);
+		prefetcher->file = -1;
+	}
+
+	if (prefetcher->file < 0)
+	{
+		char		path[MAXPGPATH];
+
+		XLogFilePath(path, prefetcher->tli, segno, wal_segment_size);
+		prefetcher->file = BasicOpenFile(path, O_RDONLY | PG_BINARY);
+		if (prefetcher->file < 0)
+			return -1;
+		prefetcher->file_segno = segno;
+		prefetcher->file_tli = prefetcher->tli;
+	}
+
+	pgstat_report_wait_start(WAIT_EVENT_WAL_READ);
+	nread = pg_pread(prefetcher->file, readBuf, XLOG_BLCKSZ, (off_t) offset);
+	pgstat_report_wait_end();
+
+	if (nread != XLOG_BLCKSZ)
+		return -1;
+
+	return XLOG_BLCKSZ;
+}
@@ -396,6 +396,7 @@ GetNewRelFileNode(Oid reltablespace, Relation pg_class, char relpersistence)
 			break;
 		case RELPERSISTENCE_UNLOGGED:
 		case RELPERSISTENCE_PERMANENT:
+		case RELPERSISTENCE_GLOBAL_TEMP:
 			backend = InvalidBackendId;
 			break;
 		default:
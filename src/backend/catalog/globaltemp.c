@@ -0,0 +1,236 @@
+/*-------------------------------------------------------------------------
+ *
+ * globaltemp.c
+ *	  session-private storage for global temporary tables
+ *
+ * A global temporary table (relpersistence 'g') has an ordinary, persistent
+ * catalog definition that all sessions share, but each session sees only
+ * the rows it inserted itself.  We get that by giving each session its own
+ * copy of the relation's files, named like those of a local temporary table
+ * ("t<backendid>_<relfilenode>") and accessed through local buffers.  The
+ * relfilenode in pg_class is shared; it's the backend ID in the path that
+ * makes the storage private.
+ *
+ * A session's storage is created lazily, the first time it opens the
+ * relation, and is removed when the session exits or runs DISCARD TEMP.
+ * Indexes are built from the session's own heap when they are first opened,
+ * which also takes care of indexes created by other sessions after this one
+ * started using the table.  Since pg_class.relfilenode is shared, nothing
+ * may assign a new relfilenode to a global temporary relation; operations
+ * that would (TRUNCATE, REINDEX) instead recreate this session's storage in
+ * place, and those that rewrite the table into new storage are rejected.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/catalog/globaltemp.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/table.h"
+#include "access/xact.h"
+#include "catalog/globaltemp.h"
+#include "catalog/index.h"
+#include "catalog/pg_class.h"
+#include "miscadmin.h"
+#include "postmaster/proxy.h"
+#include "storage/ipc.h"
+#include "storage/smgr.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+/*
+ * Relations for which this session has set up storage, keyed by OID.  We
+ * remember the relfilenode too, both to find the files at cleanup time and
+ * so that an entry left over from a dropped relation whose OID got reused is
+ * recognized as stale.
+ */
+typedef struct GlobalTempStorageEnt
+{
+	Oid			relid;			/* hash key --- must be first */
+	RelFileNode rnode;
+} GlobalTempStorageEnt;
+
+static HTAB *GlobalTempStorageHash = NULL;
+
+static void GlobalTempStorageExit(int code, Datum arg);
+static void GlobalTempRelationCreateStorage(Relation rel);
+
+
+/*
+ * GlobalTempStorageRemember
+ *		Record that this session has set up storage for rel.
+ */
+void
+GlobalTempStorageRemember(Relation rel)
+{
+	GlobalTempStorageEnt *ent;
+
+	Assert(RelationIsGlobalTemp(rel));
+
+	/* The table's contents live in this backend's local buffers */
+	ProxyPinSession();
+
+	if (GlobalTempStorageHash == NULL)
+	{
+		HASHCTL		ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(Oid);
+		ctl.entrysize = sizeof(GlobalTempStorageEnt);
+		ctl.hcxt = TopMemoryContext;
+		GlobalTempStorageHash = hash_create("Global temporary table storage",
+											32, &ctl,
+											HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+		before_shmem_exit(GlobalTempStorageExit, 0);
+	}
+
+	ent = (GlobalTempStorageEnt *) hash_search(GlobalTempStorageHash,
+											   &RelationGetRelid(rel),
+											   HASH_ENTER, NULL);
+	ent->rnode = rel->rd_node;
+}
+
+/*
+ * GlobalTempRelationHasStorage
+ *		Has this session set up storage for the given relation?
+ *
+ * This lets maintenance commands skip global temporary tables the session
+ * never used, without creating storage for them just to find them empty.
+ */
+bool
+GlobalTempRelationHasStorage(Oid relid)
+{
+	if (GlobalTempStorageHash == NULL)
+		return false;
+	return hash_search(GlobalTempStorageHash, &relid, HASH_FIND, NULL) != NULL;
+}
+
+/*
+ * Create empty storage for rel, getting rid of any files left behind by an
+ * earlier failed attempt or by a crashed session that had the same backend
+ * ID.  This is non-transactional: the storage persists even if the current
+ * transaction aborts.
+ */
+static void
+GlobalTempRelationCreateStorage(Relation rel)
+{
+	RelationOpenSmgr(rel);
+	smgrdounlinkall(&rel->rd_smgr, 1, true);
+	smgrclose(rel->rd_smgr);
+
+	RelationOpenSmgr(rel);
+	smgrcreate(rel->rd_smgr, MAIN_FORKNUM, false);
+}
+
+/*
+ * GlobalTempRelationInitStorage
+ *		Make sure this session has storage for rel.
+ *
+ * Called whenever a global temporary relation is opened.  For an index, the
+ * new storage is filled by building the index from this session's heap.
+ */
+void
+GlobalTempRelationInitStorage(Relation rel)
+{
+	Assert(RelationIsGlobalTemp(rel));
+
+	if (!RELKIND_HAS_STORAGE(rel->rd_rel->relkind))
+		return;
+
+	if (GlobalTempStorageHash != NULL)
+	{
+		GlobalTempStorageEnt *ent;
+
+		ent = (GlobalTempStorageEnt *) hash_search(GlobalTempStorageHash,
+												   &RelationGetRelid(rel),
+												   HASH_FIND, NULL);
+		if (ent != NULL && RelFileNodeEquals(ent->rnode, rel->rd_node))
+			return;
+	}
+
+	GlobalTempRelationCreateStorage(rel);
+
+	if (rel->rd_rel->relkind == RELKIND_INDEX)
+	{
+		Relation	heapRel;
+
+		/* this sets up the heap's storage first, if need be */
+		heapRel = table_open(rel->rd_index->indrelid, AccessShareLock);
+		index_build(heapRel, rel, BuildIndexInfo(rel), true, false);
+		table_close(heapRel, NoLock);
+	}
+
+	/* Only remember it once it's fully set up */
+	GlobalTempStorageRemember(rel);
+}
+
+/*
+ * GlobalTempRelationResetStorage
+ *		Replace this session's storage for rel with empty storage.
+ *
+ * This is used in place of assigning a new relfilenode, which would affect
+ * every session.  Unlike a new relfilenode, it can't be rolled back.  For an
+ * index, the caller is responsible for rebuilding it.
+ */
+void
+GlobalTempRelationResetStorage(Relation rel)
+{
+	Assert(RelationIsGlobalTemp(rel));
+
+	GlobalTempRelationCreateStorage(rel);
+	GlobalTempStorageRemember(rel);
+}
+
+/*
+ * GlobalTempStorageDiscardAll
+ *		Remove all of this session's global temporary table storage.
+ *
+ * The storage is recreated empty if the tables are used again.
+ */
+void
+GlobalTempStorageDiscardAll(void)
+{
+	HASH_SEQ_STATUS status;
+	GlobalTempStorageEnt *ent;
+	SMgrRelation *srels;
+	int			nrels = 0;
+	int			i;
+
+	if (GlobalTempStorageHash == NULL)
+		return;
+
+	srels = palloc(sizeof(SMgrRelation) * hash_get_num_entries(GlobalTempStorageHash));
+
+	hash_seq_init(&status, GlobalTempStorageHash);
+	while ((ent = (GlobalTempStorageEnt *) hash_seq_search(&status)) != NULL)
+	{
+		srels[nrels++] = smgropen(ent->rnode, BackendIdForTempRelations());
+		(void) hash_search(GlobalTempStorageHash, &ent->relid,
+						   HASH_REMOVE, NULL);
+	}
+
+	smgrdounlinkall(srels, nrels, true);
+	for (i = 0; i < nrels; i++)
+		smgrclose(srels[i]);
+
+	pfree(srels);
+}
+
+/*
+ * before_shmem_exit callback to remove the session's storage.
+ */
+static void
+GlobalTempStorageExit(int code, Datum arg)
+{
+	/* Release any buffer pins held by an interrupted transaction */
+	AbortOutOfAnyTransaction();
+
+	GlobalTempStorageDiscardAll();
+}
@@ -2915,6 +2915,13 @@ index_update_stats(Relation rel,
 	if (reltuples == 0 && rd_rel->reltuples < 0)
 		reltuples = -1;
 
+	/*
+	 * The statistics of a global temporary table would describe only the
+	 * current session's data, so don't store them in the shared pg_class row.
+	 */
+	if (rd_rel->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+		reltuples = -1;
+
 	/* Apply required updates, if any, to copied tuple */
 
 	dirty = false;
@@ -3009,12 +3016,16 @@ index_build(Relation heapRelation,
 
 	/*
 	 * Determine worker process details for parallel CREATE INDEX.  Currently,
-	 * only btree has support for parallel builds.
+	 * only btree, gin, gist, brin and hash have support for parallel builds.
 	 *
 	 * Note that planner considers parallel safety for us.
 	 */
 	if (parallel && IsNormalProcessingMode() &&
-		indexRelation->rd_rel->relam == BTREE_AM_OID)
+		(indexRelation->rd_rel->relam == BTREE_AM_OID ||
+		 indexRelation->rd_rel->relam == GIN_AM_OID ||
+		 indexRelation->rd_rel->relam == GIST_AM_OID ||
+		 indexRelation->rd_rel->relam == BRIN_AM_OID ||
+		 indexRelation->rd_rel->relam == HASH_AM_OID))
 		indexInfo->ii_ParallelWorkers =
 			plan_create_index_workers(RelationGetRelid(heapRelation),
 									  RelationGetRelid(indexRelation));
@@ -45,6 +45,7 @@
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "parser/parse_func.h"
+#include "postmaster/proxy.h"
 #include "storage/ipc.h"
 #include "storage/lmgr.h"
 #include "storage/sinvaladt.h"
@@ -3947,6 +3948,9 @@ InitTempTableNamespace(void)
 
 	Assert(!OidIsValid(myTempNamespace));
 
+	/* Temporary objects belong to this backend */
+	ProxyPinSession();
+
 	/*
 	 * First, do permission check to see if we are authorized to make temp
 	 * tables.  We use a nonstandard error message here since "databasename:
@@ -560,6 +560,12 @@ CREATE VIEW pg_backend_memory_contexts AS
 REVOKE ALL ON pg_backend_memory_contexts FROM PUBLIC;
 REVOKE EXECUTE ON FUNCTION pg_get_backend_memory_contexts() FROM PUBLIC;
 
+CREATE VIEW pg_backend_cache_stats AS
+    SELECT * FROM pg_get_backend_cache_stats();
+
+REVOKE ALL ON pg_backend_cache_stats FROM PUBLIC;
+REVOKE EXECUTE ON FUNCTION pg_get_backend_cache_stats() FROM PUBLIC;
+
 -- Statistics views
 
 CREATE VIEW pg_stat_all_tables AS
@@ -796,6 +802,13 @@ CREATE VIEW pg_stat_replication AS
         JOIN pg_stat_get_wal_senders() AS W ON (S.pid = W.pid)
         LEFT JOIN pg_authid AS U ON (S.usesysid = U.oid);
 
+CREATE VIEW pg_stat_sync_replication AS
+    SELECT
+            s.wait_mode,
+            s.waits,
+            s.wait_time
+    FROM pg_stat_get_sync_replication() s;
+
 CREATE VIEW pg_stat_replication_slots AS
     SELECT
             s.slot_name,
@@ -821,6 +834,53 @@ CREATE VIEW pg_stat_slru AS
             s.stats_reset
     FROM pg_stat_get_slru() s;
 
+CREATE VIEW pg_stat_lwlock AS
+    SELECT
+            s.tranche,
+            s.acquisitions,
+            s.contended,
+            s.wait_time,
+            s.stats_reset
+    FROM pg_stat_get_lwlock() s;
+
+CREATE VIEW pg_stat_io AS
+    SELECT
+            b.backend_type,
+            b.object,
+            b.context,
+            b.reads,
+            b.read_time,
+            b.writes,
+            b.write_time,
+            b.extends,
+            b.extend_time,
+            b.fsyncs,
+            b.fsync_time,
+            b.stats_reset
+    FROM pg_stat_get_io() b;
+
+CREATE VIEW pg_stat_wait_samples AS
+    SELECT
+            s.sample_time,
+            s.pid,
+            s.backend_type,
+            s.wait_event_type,
+            s.wait_event,
+            s.query_id
+    FROM pg_stat_get_wait_samples() s;
+
+CREATE VIEW pg_stat_wait_profile AS
+    SELECT
+            backend_type,
+            wait_event_type,
+            wait_event,
+            query_id,
+            count(*) AS samples,
+            min(sample_time) AS first_sample,
+            max(sample_time) AS last_sample
+    FROM pg_stat_wait_samples
+    GROUP BY backend_type, wait_event_type, wait_event, query_id;
+
 CREATE VIEW pg_stat_wal_receiver AS
     SELECT
             s.pid,
@@ -997,9 +1057,22 @@ CREATE VIEW pg_stat_wal AS
         w.wal_fpi,
         w.wal_bytes,
         w.wal_buffers_full,
+        w.wal_flushes,
+        w.wal_flush_requests,
         w.stats_reset
     FROM pg_stat_get_wal() w;
 
+CREATE VIEW pg_stat_wal_records AS
+    SELECT
+        w.resource_manager,
+        w.record_type,
+        w.records,
+        w.fpi,
+        w.bytes,
+        w.fpi_bytes,
+        w.stats_reset
+    FROM pg_stat_get_wal_records() w;
+
 CREATE VIEW pg_stat_progress_analyze AS
     SELECT
         S.pid AS pid, S.datid AS datid, D.datname AS datname,
@@ -1507,6 +1580,8 @@ REVOKE EXECUTE ON FUNCTION pg_stat_file(text,boolean) FROM public;
 REVOKE EXECUTE ON FUNCTION pg_ls_dir(text) FROM public;
 REVOKE EXECUTE ON FUNCTION pg_ls_dir(text,boolean,boolean) FROM public;
 
+REVOKE EXECUTE ON FUNCTION pg_log_backend_memory_contexts(integer) FROM PUBLIC;
+
 --
 -- We also set up some things as accessible to standard roles.
 --
@@ -184,6 +184,16 @@ analyze_rel(Oid relid, RangeVar *relation,
 		return;
 	}
 
+	/*
+	 * Likewise ignore global temporary tables: pg_statistic is shared by all
+	 * sessions, but each session's contents differ.
+	 */
+	if (RelationIsGlobalTemp(onerel))
+	{
+		relation_close(onerel, ShareUpdateExclusiveLock);
+		return;
+	}
+
 	/*
 	 * We can ANALYZE any table except pg_statistic. See update_attstats
 	 */
@@ -73,11 +73,14 @@
  *	  Finally, after we are out of the transaction altogether, we check if
  *	  we need to signal listening backends.  In SignalBackends() we scan the
  *	  list of listening backends and send a PROCSIG_NOTIFY_INTERRUPT signal
- *	  to every listening backend (we don't know which backend is listening on
- *	  which channel so we must signal them all). We can exclude backends that
- *	  are already up to date, though, and we can also exclude backends that
- *	  are in other databases (unless they are way behind and should be kicked
- *	  to make them advance their pointers).  We don't bother with a
+ *	  to every listening backend that might be interested in what we sent.
+ *	  Each listener advertises a small hashed bitmap of its channels in
+ *	  shared memory; a listener whose bitmap does not overlap the channels
+ *	  we notified cannot want our messages.  If such a listener is positioned
+ *	  exactly at the start of our entries we just move its pointer past them
+ *	  on its behalf, otherwise we leave it alone unless it is way behind.
+ *	  The same applies to backends that are in other databases.  We can also
+ *	  exclude backends that are already up to date.  We don't bother with a
  *	  self-signal either, but just process the queue directly.
  *
  * 5. Upon receipt of a PROCSIG_NOTIFY_INTERRUPT signal, the signal handler
@@ -107,7 +110,7 @@
  * frontend during startup.)  The above design guarantees that notifies from
  * other backends will never be missed by ignoring self-notifies.
  *
- * The amount of shared memory used for notify management (NUM_NOTIFY_BUFFERS)
+ * The amount of shared memory used for notify management (notify_buffers)
  * can be varied without affecting anything but performance.  The maximum
  * amount of notification data that can be queued at one time is determined
  * by slru.c's wraparound limit; see QUEUE_MAX_PAGE below.
@@ -131,6 +134,7 @@
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
 #include "miscadmin.h"
+#include "postmaster/proxy.h"
 #include "storage/ipc.h"
 #include "storage/lmgr.h"
 #include "storage/proc.h"
@@ -225,11 +229,26 @@ typedef struct QueuePosition
  *
  * Resist the temptation to make this really large.  While that would save
  * work in some places, it would add cost in others.  In particular, this
- * should likely be less than NUM_NOTIFY_BUFFERS, to ensure that backends
+ * should likely be less than notify_buffers, to ensure that backends
  * catch up before the pages they'll need to read fall out of SLRU cache.
  */
 #define QUEUE_CLEANUP_DELAY 4
 
+/*
+ * A listener's channels are summarized as a small bitmap with one bit set
+ * per channel, chosen by hashing the channel name.  Notifiers test their own
+ * channels' bits against it to decide whether a listener needs waking.  False
+ * positives merely cost a useless wakeup, so a fixed size is fine even for
+ * listeners on very many channels.
+ */
+#define NOTIFY_CHANNEL_MASK_WORDS	4
+#define NOTIFY_CHANNEL_MASK_BITS	(NOTIFY_CHANNEL_MASK_WORDS * 64)
+
+typedef struct NotifyChannelMask
+{
+	uint64		words[NOTIFY_CHANNEL_MASK_WORDS];
+} NotifyChannelMask;
+
 /*
  * Struct describing a listening backend's status
  */
@@ -239,6 +258,7 @@ typedef struct QueueBackendStatus
 	Oid			dboid;			/* backend's database OID, or InvalidOid */
 	BackendId	nextListener;	/* id of next listener, or InvalidBackendId */
 	QueuePosition pos;			/* backend has read queue up to here */
+	NotifyChannelMask channels; /* channels backend may be listening on */
 } QueueBackendStatus;
 
 /*
@@ -294,6 +314,7 @@ static AsyncQueueControl *asyncQueueControl;
 #define QUEUE_BACKEND_DBOID(i)		(asyncQueueControl->backend[i].dboid)
 #define QUEUE_NEXT_LISTENER(i)		(asyncQueueControl->backend[i].nextListener)
 #define QUEUE_BACKEND_POS(i)		(asyncQueueControl->backend[i].pos)
+#define QUEUE_BACKEND_CHANNELS(i)	(asyncQueueControl->backend[i].channels)
 
 /*
  * The SLRU buffer area through which we access the notification queue
@@ -432,12 +453,26 @@ static bool backendHasSentNotifications = false;
 /* have we advanced to a page that's a multiple of QUEUE_CLEANUP_DELAY? */
 static bool backendTryAdvanceTail = false;
 
+/*
+ * Queue range and channels of the notifications we have sent since the last
+ * ProcessCompletedNotifies().  The range is only valid if a single transaction
+ * wrote all of them, since only then are the entries known to be contiguous.
+ */
+static bool notifyRangeValid = false;
+static QueuePosition notifyRangeStart;
+static QueuePosition notifyRangeEnd;
+static NotifyChannelMask notifyChannels;
+
 /* GUC parameter */
 bool		Trace_notify = false;
 
 /* local function prototypes */
 static int	asyncQueuePageDiff(int p, int q);
-static bool asyncQueuePagePrecedes(int p, int q);
+static bool asyncQueuePagePrecedes(int64 p, int64 q);
+static void ChannelMaskAdd(NotifyChannelMask *mask, const char *channel);
+static bool ChannelMaskOverlaps(const NotifyChannelMask *a,
+								const NotifyChannelMask *b);
+static void asyncQueueUpdateChannelMask(bool includePending);
 static void queue_listen(ListenActionKind action, const char *channel);
 static void Async_UnlistenOnExit(int code, Datum arg);
 static void Exec_ListenPreCommit(void);
@@ -492,7 +527,7 @@ asyncQueuePageDiff(int p, int q)
 
 /* Is p < q, accounting for wraparound? */
 static bool
-asyncQueuePagePrecedes(int p, int q)
+asyncQueuePagePrecedes(int64 p, int64 q)
 {
 	return asyncQueuePageDiff(p, q) < 0;
 }
@@ -509,7 +544,7 @@ AsyncShmemSize(void)
 	size = mul_size(MaxBackends + 1, sizeof(QueueBackendStatus));
 	size = add_size(size, offsetof(AsyncQueueControl, backend));
 
-	size = add_size(size, SimpleLruShmemSize(NUM_NOTIFY_BUFFERS, 0));
+	size = add_size(size, SimpleLruShmemSize(notify_buffers, 0));
 
 	return size;
 }
@@ -550,6 +585,7 @@ AsyncShmemInit(void)
 			QUEUE_BACKEND_DBOID(i) = InvalidOid;
 			QUEUE_NEXT_LISTENER(i) = InvalidBackendId;
 			SET_QUEUE_POS(QUEUE_BACKEND_POS(i), 0, 0);
+			MemSet(&QUEUE_BACKEND_CHANNELS(i), 0, sizeof(NotifyChannelMask));
 		}
 	}
 
@@ -557,7 +593,7 @@ AsyncShmemInit(void)
 	 * Set up SLRU management of the pg_notify data.
 	 */
 	NotifyCtl->PagePrecedes = asyncQueuePagePrecedes;
-	SimpleLruInit(NotifyCtl, "Notify", NUM_NOTIFY_BUFFERS, 0,
+	SimpleLruInit(NotifyCtl, "Notify", notify_buffers, 0,
 				  NotifySLRULock, "pg_notify", LWTRANCHE_NOTIFY_BUFFER,
 				  SYNC_HANDLER_NONE);
 
@@ -762,6 +798,9 @@ Async_Listen(const char *channel)
 	if (Trace_notify)
 		elog(DEBUG1, "Async_Listen(%s,%d)", channel, MyProcPid);
 
+	/* Notifications are delivered to this backend */
+	ProxyPinSession();
+
 	queue_listen(LISTEN_LISTEN, channel);
 }
 
@@ -910,12 +949,21 @@ PreCommit_Notify(void)
 					break;
 			}
 		}
+
+		/*
+		 * Advertise the channels we're about to start listening on.  This
+		 * must be done before we commit, so that any notifier committing
+		 * after us will see them and signal us.
+		 */
+		if (amRegisteredListener)
+			asyncQueueUpdateChannelMask(true);
 	}
 
 	/* Queue any pending notifies (must happen after the above) */
 	if (pendingNotifies)
 	{
 		ListCell   *nextNotify;
+		bool		firstNotify;
 
 		/*
 		 * Make sure that we have an XID assigned to the current transaction.
@@ -944,8 +992,29 @@ PreCommit_Notify(void)
 		LockSharedObject(DatabaseRelationId, InvalidOid, 0,
 						 AccessExclusiveLock);
 
+		/*
+		 * Remember which channels we notify, so that SignalBackends() can
+		 * skip listeners that aren't interested.  If an earlier transaction
+		 * already sent notifications that haven't been signaled yet, our
+		 * entries won't be contiguous with those, so forget the range.
+		 */
+		if (!backendHasSentNotifications)
+		{
+			MemSet(&notifyChannels, 0, sizeof(NotifyChannelMask));
+			notifyRangeValid = true;
+		}
+		else
+			notifyRangeValid = false;
+		foreach(p, pendingNotifies->events)
+		{
+			Notification *n = (Notification *) lfirst(p);
+
+			ChannelMaskAdd(&notifyChannels, n->data);
+		}
+
 		/* Now push the notifications into the queue */
 		backendHasSentNotifications = true;
+		firstNotify = true;
 
 		nextNotify = list_head(pendingNotifies->events);
 		while (nextNotify != NULL)
@@ -968,7 +1037,13 @@ PreCommit_Notify(void)
 				ereport(ERROR,
 						(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
 						 errmsg("too many notifications in the NOTIFY queue")));
+			if (firstNotify)
+			{
+				notifyRangeStart = QUEUE_HEAD;
+				firstNotify = false;
+			}
 			nextNotify = asyncQueueAddEntries(nextNotify);
+			notifyRangeEnd = QUEUE_HEAD;
 			LWLockRelease(NotifyQueueLock);
 		}
 	}
@@ -1021,6 +1096,11 @@ AtCommit_Notify(void)
 	/* If no longer listening to anything, get out of listener array */
 	if (amRegisteredListener && listenChannels == NIL)
 		asyncQueueUnregister();
+	else if (amRegisteredListener && pendingActions != NULL)
+	{
+		/* Drop bits for channels we no longer listen on */
+		asyncQueueUpdateChannelMask(false);
+	}
 
 	/* And clean up */
 	ClearPendingActionsAndNotifies();
@@ -1093,6 +1173,7 @@ Exec_ListenPreCommit(void)
 	QUEUE_BACKEND_POS(MyBackendId) = max;
 	QUEUE_BACKEND_PID(MyBackendId) = MyProcPid;
 	QUEUE_BACKEND_DBOID(MyBackendId) = MyDatabaseId;
+	MemSet(&QUEUE_BACKEND_CHANNELS(MyBackendId), 0, sizeof(NotifyChannelMask));
 	/* Insert backend into list of listeners at correct position */
 	if (prevListener > 0)
 	{
@@ -1315,6 +1396,7 @@ asyncQueueUnregister(void)
 	/* Mark our entry as invalid */
 	QUEUE_BACKEND_PID(MyBackendId) = InvalidPid;
 	QUEUE_BACKEND_DBOID(MyBackendId) = InvalidOid;
+	MemSet(&QUEUE_BACKEND_CHANNELS(MyBackendId), 0, sizeof(NotifyChannelMask));
 	/* and remove it from the list */
 	if (QUEUE_FIRST_LISTENER == MyBackendId)
 		QUEUE_FIRST_LISTENER = QUEUE_NEXT_LISTENER(MyBackendId);
@@ -1655,12 +1737,15 @@ asyncQueueFillWarning(void)
  *
  * We never signal our own process; that should be handled by our caller.
  *
- * Normally we signal only backends in our own database, since only those
- * backends could be interested in notifies we send.  However, if there's
- * notify traffic in our database but no traffic in another database that
- * does have listener(s), those listeners will fall further and further
- * behind.  Waken them anyway if they're far enough behind, so that they'll
- * advance their queue position pointers, allowing the global tail to advance.
+ * Normally we signal only backends in our own database that may be listening
+ * on a channel we notified, since only those backends could be interested in
+ * notifies we send.  However, if there's notify traffic in our database but
+ * no traffic in another database (or on another channel) that does have
+ * listener(s), those listeners will fall further and further behind.  If such
+ * a listener is positioned exactly at the start of the entries we wrote, we
+ * can simply advance its pointer past them ourselves.  Otherwise, waken it
+ * anyway if it's far enough behind, so that it'll advance its queue position
+ * pointer, allowing the global tail to advance.
  *
  * Since we know the BackendId and the Pid the signaling is quite cheap.
  */
@@ -1694,11 +1779,12 @@ SignalBackends(void)
 		if (pid == MyProcPid)
 			continue;			/* never signal self */
 		pos = QUEUE_BACKEND_POS(i);
-		if (QUEUE_BACKEND_DBOID(i) == MyDatabaseId)
+		if (QUEUE_BACKEND_DBOID(i) == MyDatabaseId &&
+			ChannelMaskOverlaps(&QUEUE_BACKEND_CHANNELS(i), &notifyChannels))
 		{
 			/*
-			 * Always signal listeners in our own database, unless they're
-			 * already caught up (unlikely, but possible).
+			 * Always signal interested listeners in our own database, unless
+			 * they're already caught up (unlikely, but possible).
 			 */
 			if (QUEUE_POS_EQUAL(pos, QUEUE_HEAD))
 				continue;
@@ -1706,8 +1792,22 @@ SignalBackends(void)
 		else
 		{
 			/*
-			 * Listeners in other databases should be signaled only if they
-			 * are far behind.
+			 * This listener has no use for anything we wrote.  If it has
+			 * read everything before our entries, step it over them.  We
+			 * must not advance it any further than that, since other
+			 * transactions may have appended entries it does want.  (If the
+			 * backend is reading the queue right now it will overwrite this
+			 * with its own idea of its position when it's done, which is
+			 * harmless.)
+			 */
+			if (notifyRangeValid && QUEUE_POS_EQUAL(pos, notifyRangeStart))
+			{
+				QUEUE_BACKEND_POS(i) = notifyRangeEnd;
+				continue;
+			}
+
+			/*
+			 * Otherwise it should be signaled only if it is far behind.
 			 */
 			if (asyncQueuePageDiff(QUEUE_POS_PAGE(QUEUE_HEAD),
 								   QUEUE_POS_PAGE(pos)) < QUEUE_CLEANUP_DELAY)
@@ -1739,6 +1839,68 @@ SignalBackends(void)
 	pfree(ids);
 }
 
+/*
+ * Set the bit for the given channel name in a channel mask.
+ */
+static void
+ChannelMaskAdd(NotifyChannelMask *mask, const char *channel)
+{
+	uint32		bit;
+
+	bit = hash_bytes((const unsigned char *) channel, strlen(channel)) %
+		NOTIFY_CHANNEL_MASK_BITS;
+	mask->words[bit / 64] |= UINT64CONST(1) << (bit % 64);
+}
+
+/*
+ * Do two channel masks have any bit in common?
+ */
+static bool
+ChannelMaskOverlaps(const NotifyChannelMask *a, const NotifyChannelMask *b)
+{
+	for (int i = 0; i < NOTIFY_CHANNEL_MASK_WORDS; i++)
+	{
+		if ((a->words[i] & b->words[i]) != 0)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Recompute the channel mask in our listener entry from listenChannels,
+ * plus the channels of our pending LISTEN actions if includePending.
+ *
+ * Before commit we only ever add bits, and after commit or abort we drop
+ * bits we no longer need; a stale bit just costs a useless wakeup.
+ */
+static void
+asyncQueueUpdateChannelMask(bool includePending)
+{
+	NotifyChannelMask mask;
+	ListCell   *p;
+
+	Assert(amRegisteredListener);
+
+	MemSet(&mask, 0, sizeof(mask));
+	foreach(p, listenChannels)
+		ChannelMaskAdd(&mask, (char *) lfirst(p));
+	if (includePending && pendingActions != NULL)
+	{
+		foreach(p, pendingActions->actions)
+		{
+			ListenAction *actrec = (ListenAction *) lfirst(p);
+
+			if (actrec->action == LISTEN_LISTEN)
+				ChannelMaskAdd(&mask, actrec->channel);
+		}
+	}
+
+	/* We may update our own entry while holding only shared lock */
+	LWLockAcquire(NotifyQueueLock, LW_SHARED);
+	QUEUE_BACKEND_CHANNELS(MyBackendId) = mask;
+	LWLockRelease(NotifyQueueLock);
+}
+
 /*
  * AtAbort_Notify
  *
@@ -1757,6 +1919,11 @@ AtAbort_Notify(void)
 	 */
 	if (amRegisteredListener && listenChannels == NIL)
 		asyncQueueUnregister();
+	else if (amRegisteredListener && pendingActions != NULL)
+	{
+		/* Drop bits advertised for LISTENs that didn't commit */
+		asyncQueueUpdateChannelMask(false);
+	}
 
 	/* And clean up */
 	ClearPendingActionsAndNotifies();
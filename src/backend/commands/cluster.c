@@ -388,6 +388,16 @@ cluster_rel(Oid tableOid, Oid indexOid, int options)
 					 errmsg("cannot vacuum temporary tables of other sessions")));
 	}
 
+	/*
+	 * Nor global temporary tables, whose new relfilenode would have to be
+	 * filled from every session's copy.
+	 */
+	if (RelationIsGlobalTemp(OldHeap))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot cluster global temporary table \"%s\"",
+						RelationGetRelationName(OldHeap))));
+
 	/*
 	 * Also check for active uses of the relation in the current transaction,
 	 * including open scans and pending AFTER trigger events.
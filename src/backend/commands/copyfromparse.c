@@ -26,6 +26,7 @@
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "port/pg_bswap.h"
+#include "port/pg_simd.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 
@@ -773,6 +774,38 @@ CopyReadLine(CopyFromState cstate)
 	return result;
 }
 
+/*
+ * CopyReadRawLine - append the next raw input line to line_buf
+ *
+ * This is used by the leader of a parallel COPY FROM to find line boundaries
+ * without doing any of the per-line work itself.  Unlike CopyReadLine, line_buf
+ * is not reset, the line terminator is kept, and no encoding conversion is
+ * done, so that consecutive lines accumulate into a chunk of raw input that a
+ * worker can parse exactly as if it had read it from the original source.
+ * An end-of-copy marker and anything after it is discarded.
+ *
+ * Result is true if read was terminated by EOF, false if terminated
+ * by newline.
+ */
+bool
+CopyReadRawLine(CopyFromState cstate)
+{
+	bool		result;
+
+	result = CopyReadLineText(cstate);
+
+	/* Ignore anything after \. up to the protocol end of copy data */
+	if (result && cstate->copy_src == COPY_NEW_FE)
+	{
+		do
+		{
+			cstate->raw_buf_index = cstate->raw_buf_len;
+		} while (CopyLoadRawBuf(cstate));
+	}
+
+	return result;
+}
+
 /*
  * CopyReadLineText - inner loop of CopyReadLine for text mode
  */
@@ -794,6 +827,16 @@ CopyReadLineText(CopyFromState cstate)
 	char		quotec = '\0';
 	char		escapec = '\0';
 
+#ifndef USE_NO_SIMD
+	/* vector scan variables */
+	Vector8		nl_vec = vector8_broadcast('\n');
+	Vector8		cr_vec = vector8_broadcast('\r');
+	Vector8		bs_vec = vector8_broadcast('\\');
+	Vector8		quote_vec;
+	Vector8		escape_vec;
+	int			simd_resume_ptr = 0;
+#endif
+
 	if (cstate->opts.csv_mode)
 	{
 		quotec = cstate->opts.quote[0];
@@ -803,6 +846,11 @@ CopyReadLineText(CopyFromState cstate)
 			escapec = '\0';
 	}
 
+#ifndef USE_NO_SIMD
+	quote_vec = vector8_broadcast((uint8) quotec);
+	escape_vec = vector8_broadcast((uint8) escapec);
+#endif
+
 	mblen_str[1] = '\0';
 
 	/*
@@ -825,6 +873,10 @@ CopyReadLineText(CopyFromState cstate)
 	 *
 	 * For a little extra speed within the loop, we copy raw_buf and
 	 * raw_buf_len into local variables.
+	 *
+	 * Where the platform has vector instructions, we also skip over runs of
+	 * uninteresting bytes a whole vector at a time before falling back to
+	 * examining characters one by one.
 	 */
 	copy_raw_buf = cstate->raw_buf;
 	raw_buf_ptr = cstate->raw_buf_index;
@@ -857,6 +909,9 @@ CopyReadLineText(CopyFromState cstate)
 				hit_eof = true;
 			raw_buf_ptr = 0;
 			copy_buf_len = cstate->raw_buf_len;
+#ifndef USE_NO_SIMD
+			simd_resume_ptr = 0;
+#endif
 
 			/*
 			 * If we are completely out of data, break out of the loop,
@@ -870,6 +925,54 @@ CopyReadLineText(CopyFromState cstate)
 			need_data = false;
 		}
 
+#ifndef USE_NO_SIMD
+
+		/*
+		 * A chunk that contains no newline, backslash or (in CSV mode) quote
+		 * or escape character cannot change any of our state, so it is
+		 * simply part of the line.  If the file encoding can embed ASCII
+		 * bytes in multibyte characters, the chunk must also be pure ASCII,
+		 * so that we never start scanning in the middle of a character.
+		 *
+		 * Once a chunk fails that test, examine it byte by byte; there's no
+		 * point in retrying the vector test until we're past it.
+		 */
+		if (raw_buf_ptr >= simd_resume_ptr)
+		{
+			while (raw_buf_ptr + (int) sizeof(Vector8) <= copy_buf_len)
+			{
+				Vector8		chunk;
+				Vector8		special;
+
+				vector8_load(&chunk, (const uint8 *) copy_raw_buf + raw_buf_ptr);
+				special = vector8_or(vector8_eq(chunk, nl_vec),
+									 vector8_eq(chunk, cr_vec));
+				special = vector8_or(special, vector8_eq(chunk, bs_vec));
+				if (cstate->opts.csv_mode)
+				{
+					special = vector8_or(special, vector8_eq(chunk, quote_vec));
+					special = vector8_or(special, vector8_eq(chunk, escape_vec));
+				}
+				if (cstate->encoding_embeds_ascii)
+					special = vector8_or(special, chunk);
+
+				if (vector8_is_highbit_set(special))
+				{
+					simd_resume_ptr = raw_buf_ptr + sizeof(Vector8);
+					break;
+				}
+
+				raw_buf_ptr += sizeof(Vector8);
+				first_char_in_line = false;
+				last_was_esc = false;
+			}
+
+			/* Go back to load more data if we consumed the whole buffer */
+			if (raw_buf_ptr >= copy_buf_len)
+				continue;
+		}
+#endif
+
 		/* OK to fetch a character */
 		prev_raw_ptr = raw_buf_ptr;
 		c = copy_raw_buf[raw_buf_ptr++];
@@ -1176,6 +1279,9 @@ CopyReadAttributesText(CopyFromState cstate)
 	char	   *output_ptr;
 	char	   *cur_ptr;
 	char	   *line_end_ptr;
+#ifndef USE_NO_SIMD
+	char	   *simd_resume_ptr;
+#endif
 
 	/*
 	 * We need a special case for zero-column tables: check that the input
@@ -1206,6 +1312,9 @@ CopyReadAttributesText(CopyFromState cstate)
 	/* set pointer variables for loop */
 	cur_ptr = cstate->line_buf.data;
 	line_end_ptr = cstate->line_buf.data + cstate->line_buf.len;
+#ifndef USE_NO_SIMD
+	simd_resume_ptr = cur_ptr;
+#endif
 
 	/* Outer loop iterates over fields */
 	fieldno = 0;
@@ -1244,6 +1353,33 @@ CopyReadAttributesText(CopyFromState cstate)
 		{
 			char		c;
 
+#ifndef USE_NO_SIMD
+
+			/*
+			 * Copy runs of bytes containing neither the delimiter nor a
+			 * backslash a whole vector at a time.  line_buf is already in
+			 * the server encoding, which never embeds ASCII bytes in
+			 * multibyte characters, so no further care is needed.  As in
+			 * CopyReadLineText, don't retest a chunk that has already failed.
+			 */
+			while (cur_ptr >= simd_resume_ptr &&
+				   cur_ptr + sizeof(Vector8) <= line_end_ptr)
+			{
+				Vector8		chunk;
+
+				vector8_load(&chunk, (const uint8 *) cur_ptr);
+				if (vector8_has(chunk, (uint8) delimc) ||
+					vector8_has(chunk, (uint8) '\\'))
+				{
+					simd_resume_ptr = cur_ptr + sizeof(Vector8);
+					break;
+				}
+				memcpy(output_ptr, cur_ptr, sizeof(Vector8));
+				output_ptr += sizeof(Vector8);
+				cur_ptr += sizeof(Vector8);
+			}
+#endif
+
 			end_ptr = cur_ptr;
 			if (cur_ptr >= line_end_ptr)
 				break;
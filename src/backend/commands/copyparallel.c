@@ -0,0 +1,659 @@
+/*-------------------------------------------------------------------------
+ *
+ * copyparallel.c
+ *		Parallel COPY FROM.
+ *
+ * In a parallel COPY FROM, the leader does nothing but read the input and
+ * split it at line boundaries into chunks of raw data, which it hands out
+ * round-robin to the workers through one shared memory queue per worker.
+ * Each worker runs an ordinary CopyFrom() whose data source is its queue, so
+ * all the parsing, type conversion, encoding conversion and insertion
+ * (including the multi-insert buffering) happens in the workers.
+ *
+ * The workers insert using the leader's transaction and command ID.  That is
+ * only safe if nothing about the insertion needs to happen in the leader, so
+ * we only go parallel for plain tables without triggers, and only if every
+ * function the workers could call is parallel safe.  In all other cases, and
+ * if no workers can be launched, we quietly do a serial copy instead.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/commands/copyparallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/parallel.h"
+#include "access/table.h"
+#include "access/xact.h"
+#include "catalog/pg_proc.h"
+#include "commands/copy.h"
+#include "commands/copyfrom_internal.h"
+#include "executor/instrument.h"
+#include "mb/pg_wchar.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "parser/parse_relation.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "storage/shm_mq.h"
+#include "tcop/tcopprot.h"
+#include "utils/acl.h"
+#include "utils/lsyscache.h"
+#include "utils/partcache.h"
+#include "utils/rel.h"
+#include "utils/typcache.h"
+
+/* DSM keys for parallel COPY FROM */
+#define PARALLEL_COPY_KEY_SHARED		1
+#define PARALLEL_COPY_KEY_QUERY_TEXT	2
+#define PARALLEL_COPY_KEY_OPTIONS		3
+#define PARALLEL_COPY_KEY_ATTNAMES		4
+#define PARALLEL_COPY_KEY_WHERE_CLAUSE	5
+#define PARALLEL_COPY_KEY_QUEUES		6
+#define PARALLEL_COPY_KEY_BUFFER_USAGE	7
+#define PARALLEL_COPY_KEY_WAL_USAGE		8
+
+/*
+ * The leader sends a chunk once it holds at least this many bytes of complete
+ * lines.  Each worker's queue holds several chunks, so that the leader can
+ * usually keep reading while the workers catch up.
+ */
+#define PARALLEL_COPY_CHUNK_SIZE	RAW_BUF_SIZE
+#define PARALLEL_COPY_QUEUE_SIZE	(PARALLEL_COPY_CHUNK_SIZE * 8)
+
+/*
+ * Shared information among the leader and the workers.
+ */
+typedef struct ParallelCopyShared
+{
+	Oid			relid;			/* target relation */
+	int			file_encoding;	/* encoding of the input data */
+
+	/* Total number of tuples inserted by the workers */
+	pg_atomic_uint64 processed;
+} ParallelCopyShared;
+
+/*
+ * Each chunk of input the leader sends starts with this header, followed by
+ * the raw data of one or more complete lines.
+ */
+typedef struct ParallelCopyChunkHeader
+{
+	uint64		first_lineno;	/* input line number of the first line */
+	EolType		eol_type;		/* line terminator the leader detected */
+} ParallelCopyChunkHeader;
+
+/*
+ * Worker-local state, used by the data source callback.
+ */
+typedef struct ParallelCopyWorkerState
+{
+	CopyFromState cstate;		/* the worker's COPY FROM state */
+	shm_mq_handle *mqh;			/* queue to receive chunks from */
+	char	   *chunk;			/* unread data of the current chunk */
+	Size		chunk_len;		/* number of unread bytes */
+} ParallelCopyWorkerState;
+
+static ParallelCopyWorkerState pcworker;
+
+static bool parallel_copy_unsafe_checker(Oid func_id, void *context);
+static bool parallel_copy_unsafe_walker(Node *node, void *context);
+static void parallel_copy_send_chunk(ParallelContext *pcxt, shm_mq_handle *mqh,
+									 uint64 first_lineno, EolType eol_type,
+									 StringInfo buf);
+static int	parallel_copy_read_chunk(void *outbuf, int minread, int maxread);
+
+
+/*
+ * IsParallelCopyAllowed
+ *		Can this COPY FROM be done by parallel workers?
+ *
+ * Everything a worker evaluates on the way to inserting a row must be
+ * parallel safe: the input functions, default and generated column
+ * expressions, check and partition constraints, index expressions and
+ * predicates, and the WHERE clause.
+ */
+bool
+IsParallelCopyAllowed(CopyFromState cstate)
+{
+	Relation	rel = cstate->rel;
+	TupleDesc	tupDesc = RelationGetDescr(rel);
+	TupleConstr *constr = tupDesc->constr;
+	List	   *indexoidlist;
+	ListCell   *lc;
+	int			i;
+
+	/*
+	 * We must be able to find line boundaries without parsing the data, and
+	 * to read ahead of the line being processed, which the old frontend
+	 * protocol doesn't allow.
+	 */
+	if (cstate->opts.binary ||
+		(cstate->copy_src != COPY_FILE && cstate->copy_src != COPY_NEW_FE))
+		return false;
+
+	/* The checks for FREEZE only make sense in the leader */
+	if (cstate->opts.freeze)
+		return false;
+
+	/*
+	 * Only plain tables are supported.  Workers can't access the leader's
+	 * local buffers, and triggers (which include foreign key checks and
+	 * deferred uniqueness checks) would have to be queued in the leader.
+	 */
+	if (rel->rd_rel->relkind != RELKIND_RELATION ||
+		RelationUsesLocalBuffers(rel) ||
+		rel->trigdesc != NULL)
+		return false;
+
+	foreach(lc, cstate->attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+		Form_pg_attribute att = TupleDescAttr(tupDesc, attnum - 1);
+
+		if (func_parallel(cstate->in_functions[attnum - 1].fn_oid) != PROPARALLEL_SAFE ||
+			DomainHasConstraints(att->atttypid))
+			return false;
+	}
+
+	for (i = 0; i < cstate->num_defaults; i++)
+	{
+		if (parallel_copy_unsafe_walker((Node *) cstate->defexprs[i]->expr, NULL))
+			return false;
+	}
+
+	if (parallel_copy_unsafe_walker(cstate->whereClause, NULL))
+		return false;
+
+	if (constr)
+	{
+		for (i = 0; i < constr->num_check; i++)
+		{
+			if (parallel_copy_unsafe_walker(stringToNode(constr->check[i].ccbin),
+											NULL))
+				return false;
+		}
+
+		for (i = 0; i < constr->num_defval; i++)
+		{
+			AttrDefault *defval = &constr->defval[i];
+
+			if (TupleDescAttr(tupDesc, defval->adnum - 1)->attgenerated &&
+				parallel_copy_unsafe_walker(stringToNode(defval->adbin), NULL))
+				return false;
+		}
+	}
+
+	if (rel->rd_rel->relispartition &&
+		parallel_copy_unsafe_walker((Node *) RelationGetPartitionQual(rel),
+									NULL))
+		return false;
+
+	indexoidlist = RelationGetIndexList(rel);
+	foreach(lc, indexoidlist)
+	{
+		Relation	indexRel;
+		bool		unsafe;
+
+		/* Use the same lock as the workers' ExecOpenIndices() */
+		indexRel = index_open(lfirst_oid(lc), RowExclusiveLock);
+		unsafe = parallel_copy_unsafe_walker((Node *) RelationGetIndexExpressions(indexRel),
+											 NULL) ||
+			parallel_copy_unsafe_walker((Node *) RelationGetIndexPredicate(indexRel),
+										NULL);
+		index_close(indexRel, NoLock);
+
+		if (unsafe)
+		{
+			list_free(indexoidlist);
+			return false;
+		}
+	}
+	list_free(indexoidlist);
+
+	return true;
+}
+
+static bool
+parallel_copy_unsafe_checker(Oid func_id, void *context)
+{
+	return (func_parallel(func_id) != PROPARALLEL_SAFE);
+}
+
+/*
+ * Does the expression contain anything a parallel worker can't evaluate?
+ *
+ * This is a simplified max_parallel_hazard(): the expressions we look at
+ * can't contain sublinks or params, and anything short of parallel safe
+ * rules out parallelism.
+ */
+static bool
+parallel_copy_unsafe_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+
+	if (check_functions_in_node(node, parallel_copy_unsafe_checker, context))
+		return true;
+
+	/* Identity columns' nextval() is just as unsafe as the function */
+	if (IsA(node, NextValueExpr))
+		return true;
+
+	/* Domain constraints could call anything */
+	if (IsA(node, CoerceToDomain) &&
+		DomainHasConstraints(((CoerceToDomain *) node)->resulttype))
+		return true;
+
+	return expression_tree_walker(node, parallel_copy_unsafe_walker, context);
+}
+
+/*
+ * ParallelCopyFrom
+ *		Leader side of a parallel COPY FROM.
+ *
+ * Returns false, without having consumed any input, if no workers could be
+ * launched; the caller should then do a serial copy.  Otherwise stores the
+ * number of tuples inserted into *processed and returns true.
+ */
+bool
+ParallelCopyFrom(CopyFromState cstate, uint64 *processed)
+{
+	ParallelContext *pcxt;
+	ParallelCopyShared *shared;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	char	   *queuespace;
+	shm_mq_handle **mqh;
+	ErrorContextCallback errcallback;
+	TupleDesc	tupDesc = RelationGetDescr(cstate->rel);
+	List	   *attnamelist = NIL;
+	char	   *options_str;
+	char	   *attnames_str;
+	char	   *where_str;
+	char	   *ptr;
+	Size		querylen;
+	ListCell   *lc;
+	int			nworkers;
+	int			next_worker = 0;
+	uint64		first_lineno = 0;
+	bool		done = false;
+	int			i;
+
+	/*
+	 * The workers insert under the leader's transaction ID and command ID, so
+	 * make sure the former is assigned and the latter marked as used before
+	 * entering parallel mode, after which neither can happen anymore.
+	 */
+	(void) GetCurrentTransactionId();
+	(void) GetCurrentCommandId(true);
+
+	/* The workers need the column list by name, as BeginCopyFrom takes it */
+	foreach(lc, cstate->attnumlist)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupDesc, lfirst_int(lc) - 1);
+
+		attnamelist = lappend(attnamelist,
+							  makeString(pstrdup(NameStr(att->attname))));
+	}
+
+	options_str = nodeToString(cstate->options);
+	attnames_str = nodeToString(attnamelist);
+	where_str = nodeToString(cstate->whereClause);
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "ParallelCopyMain",
+								 cstate->opts.nworkers);
+
+	/* Estimate size for shared information -- PARALLEL_COPY_KEY_SHARED */
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelCopyShared));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Estimate space for the serialized COPY parameters */
+	shm_toc_estimate_chunk(&pcxt->estimator, strlen(options_str) + 1);
+	shm_toc_estimate_chunk(&pcxt->estimator, strlen(attnames_str) + 1);
+	shm_toc_estimate_chunk(&pcxt->estimator, strlen(where_str) + 1);
+	shm_toc_estimate_keys(&pcxt->estimator, 3);
+
+	/* Estimate space for the chunk queues -- PARALLEL_COPY_KEY_QUEUES */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_COPY_QUEUE_SIZE, pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/*
+	 * Estimate space for BufferUsage and WalUsage --
+	 * PARALLEL_COPY_KEY_BUFFER_USAGE and PARALLEL_COPY_KEY_WAL_USAGE.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_COPY_KEY_QUERY_TEXT space */
+	querylen = debug_query_string ? strlen(debug_query_string) : 0;
+	shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	InitializeParallelDSM(pcxt);
+
+	/* Prepare shared information */
+	shared = (ParallelCopyShared *) shm_toc_allocate(pcxt->toc,
+													 sizeof(ParallelCopyShared));
+	shared->relid = RelationGetRelid(cstate->rel);
+	shared->file_encoding = cstate->file_encoding;
+	pg_atomic_init_u64(&shared->processed, 0);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_SHARED, shared);
+
+	/* Store the COPY parameters for workers */
+	ptr = shm_toc_allocate(pcxt->toc, strlen(options_str) + 1);
+	strcpy(ptr, options_str);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_OPTIONS, ptr);
+	ptr = shm_toc_allocate(pcxt->toc, strlen(attnames_str) + 1);
+	strcpy(ptr, attnames_str);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_ATTNAMES, ptr);
+	ptr = shm_toc_allocate(pcxt->toc, strlen(where_str) + 1);
+	strcpy(ptr, where_str);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_WHERE_CLAUSE, ptr);
+
+	/* Set up one queue per worker, with the leader as the sender */
+	queuespace = shm_toc_allocate(pcxt->toc,
+								  mul_size(PARALLEL_COPY_QUEUE_SIZE,
+										   pcxt->nworkers));
+	for (i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(queuespace + ((Size) i) * PARALLEL_COPY_QUEUE_SIZE,
+						   (Size) PARALLEL_COPY_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_QUEUES, queuespace);
+
+	/*
+	 * Allocate space for each worker's BufferUsage and WalUsage; no need to
+	 * initialize
+	 */
+	buffer_usage = shm_toc_allocate(pcxt->toc,
+									mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_BUFFER_USAGE, buffer_usage);
+	wal_usage = shm_toc_allocate(pcxt->toc,
+								 mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_WAL_USAGE, wal_usage);
+
+	/* Store query string for workers */
+	ptr = shm_toc_allocate(pcxt->toc, querylen + 1);
+	if (debug_query_string)
+		memcpy(ptr, debug_query_string, querylen);
+	ptr[querylen] = '\0';
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_QUERY_TEXT, ptr);
+
+	LaunchParallelWorkers(pcxt);
+	nworkers = pcxt->nworkers_launched;
+
+	if (nworkers == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return false;
+	}
+
+	/*
+	 * Workers that were launched are numbered from 0, so they use the first
+	 * nworkers queues.  Passing the worker's handle lets us notice if it dies
+	 * before attaching to its queue.
+	 */
+	mqh = (shm_mq_handle **) palloc(sizeof(shm_mq_handle *) * nworkers);
+	for (i = 0; i < nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = (shm_mq *) (queuespace + ((Size) i) * PARALLEL_COPY_QUEUE_SIZE);
+		mqh[i] = shm_mq_attach(mq, pcxt->seg, pcxt->worker[i].bgwhandle);
+	}
+
+	/* Set up callback to identify error line number */
+	errcallback.callback = CopyFromErrorCallback;
+	errcallback.arg = (void *) cstate;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	/*
+	 * line_buf accumulates whole chunks rather than single lines, so it's
+	 * not useful to show in error messages.
+	 */
+	cstate->line_buf_valid = false;
+
+	/* The workers never see the header line */
+	if (cstate->opts.header_line)
+	{
+		cstate->cur_lineno++;
+		done = CopyReadRawLine(cstate);
+		resetStringInfo(&cstate->line_buf);
+	}
+
+	while (!done)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		if (cstate->line_buf.len == 0)
+			first_lineno = cstate->cur_lineno + 1;
+
+		cstate->cur_lineno++;
+		done = CopyReadRawLine(cstate);
+
+		if (cstate->line_buf.len > 0 &&
+			(done || cstate->line_buf.len >= PARALLEL_COPY_CHUNK_SIZE))
+		{
+			parallel_copy_send_chunk(pcxt, mqh[next_worker], first_lineno,
+									 cstate->eol_type, &cstate->line_buf);
+			next_worker = (next_worker + 1) % nworkers;
+			resetStringInfo(&cstate->line_buf);
+		}
+	}
+
+	/* Detaching from the queues tells the workers there is no more input */
+	for (i = 0; i < nworkers; i++)
+		shm_mq_detach(mqh[i]);
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/* Accumulate the workers' buffer and WAL usage */
+	for (i = 0; i < nworkers; i++)
+		InstrAccumParallelQuery(&buffer_usage[i], &wal_usage[i]);
+
+	*processed = pg_atomic_read_u64(&shared->processed);
+
+	/* Done, clean up */
+	error_context_stack = errcallback.previous;
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	return true;
+}
+
+/*
+ * Send a chunk of complete lines to a worker, waiting for space in its queue
+ * if necessary.
+ */
+static void
+parallel_copy_send_chunk(ParallelContext *pcxt, shm_mq_handle *mqh,
+						 uint64 first_lineno, EolType eol_type,
+						 StringInfo buf)
+{
+	ParallelCopyChunkHeader hdr;
+	shm_mq_iovec iov[2];
+
+	hdr.first_lineno = first_lineno;
+	hdr.eol_type = eol_type;
+
+	iov[0].data = (const char *) &hdr;
+	iov[0].len = sizeof(hdr);
+	iov[1].data = buf->data;
+	iov[1].len = buf->len;
+
+	if (shm_mq_sendv(mqh, iov, 2, false, true) != SHM_MQ_SUCCESS)
+	{
+		/*
+		 * Workers only detach early when they fail, in which case this will
+		 * report their error.
+		 */
+		WaitForParallelWorkersToFinish(pcxt);
+		elog(ERROR, "parallel COPY worker exited unexpectedly");
+	}
+}
+
+/*
+ * ParallelCopyMain
+ *		Main entry point for parallel COPY FROM worker processes.
+ */
+void
+ParallelCopyMain(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelCopyShared *shared;
+	char	   *sharedquery;
+	Relation	rel;
+	ParseState *pstate;
+	ParseNamespaceItem *nsitem;
+	List	   *options;
+	List	   *attnamelist;
+	Node	   *whereClause;
+	char	   *queuespace;
+	shm_mq	   *mq;
+	CopyFromState cstate;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	uint64		processed;
+
+	shared = (ParallelCopyShared *) shm_toc_lookup(toc, PARALLEL_COPY_KEY_SHARED,
+												   false);
+
+	/* Set debug_query_string for individual workers */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_COPY_KEY_QUERY_TEXT, false);
+	debug_query_string = sharedquery;
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* We insert under the leader's command ID, which it has marked as used */
+	SetCurrentCommandIdUsedForWorker();
+
+	/*
+	 * Open table.  The lock mode is the same as the leader process.  It's
+	 * okay because the lock mode does not conflict among the parallel
+	 * workers.
+	 */
+	rel = table_open(shared->relid, RowExclusiveLock);
+
+	pstate = make_parsestate(NULL);
+	pstate->p_sourcetext = sharedquery;
+	nsitem = addRangeTableEntryForRelation(pstate, rel, RowExclusiveLock,
+										   NULL, false, false);
+	nsitem->p_rte->requiredPerms = ACL_INSERT;
+
+	options = (List *) stringToNode(shm_toc_lookup(toc, PARALLEL_COPY_KEY_OPTIONS,
+												   false));
+	attnamelist = (List *) stringToNode(shm_toc_lookup(toc,
+													   PARALLEL_COPY_KEY_ATTNAMES,
+													   false));
+	whereClause = (Node *) stringToNode(shm_toc_lookup(toc,
+													   PARALLEL_COPY_KEY_WHERE_CLAUSE,
+													   false));
+
+	/* Attach to our queue as the receiver */
+	queuespace = shm_toc_lookup(toc, PARALLEL_COPY_KEY_QUEUES, false);
+	mq = (shm_mq *) (queuespace +
+					 ((Size) ParallelWorkerNumber) * PARALLEL_COPY_QUEUE_SIZE);
+	shm_mq_set_receiver(mq, MyProc);
+	pcworker.mqh = shm_mq_attach(mq, seg, NULL);
+	pcworker.chunk = NULL;
+	pcworker.chunk_len = 0;
+
+	cstate = BeginCopyFrom(pstate, rel, whereClause, NULL, false,
+						   parallel_copy_read_chunk, attnamelist, options);
+	pcworker.cstate = cstate;
+
+	/* The leader has already consumed the header line */
+	cstate->opts.header_line = false;
+	cstate->opts.nworkers = 0;
+
+	/* Interpret the input as the leader would, not by our client encoding */
+	cstate->file_encoding = shared->file_encoding;
+	cstate->need_transcoding =
+		(cstate->file_encoding != GetDatabaseEncoding() ||
+		 pg_database_encoding_max_length() > 1);
+	cstate->encoding_embeds_ascii = PG_ENCODING_IS_CLIENT_ONLY(cstate->file_encoding);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	processed = CopyFrom(cstate);
+	EndCopyFrom(cstate);
+
+	pg_atomic_fetch_add_u64(&shared->processed, processed);
+
+	/* Report buffer/WAL usage during parallel execution */
+	buffer_usage = shm_toc_lookup(toc, PARALLEL_COPY_KEY_BUFFER_USAGE, false);
+	wal_usage = shm_toc_lookup(toc, PARALLEL_COPY_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&buffer_usage[ParallelWorkerNumber],
+						  &wal_usage[ParallelWorkerNumber]);
+
+	shm_mq_detach(pcworker.mqh);
+	table_close(rel, NoLock);
+}
+
+/*
+ * Data source callback for a worker's CopyFrom(): hand out the chunks the
+ * leader sends us, one at a time.  Returns 0 once the leader has detached.
+ */
+static int
+parallel_copy_read_chunk(void *outbuf, int minread, int maxread)
+{
+	int			nbytes;
+
+	if (pcworker.chunk_len == 0)
+	{
+		CopyFromState cstate = pcworker.cstate;
+		ParallelCopyChunkHeader hdr;
+		shm_mq_result res;
+		Size		len;
+		void	   *data;
+
+		res = shm_mq_receive(pcworker.mqh, &len, &data, false);
+		if (res == SHM_MQ_DETACHED)
+			return 0;
+		Assert(res == SHM_MQ_SUCCESS && len > sizeof(hdr));
+
+		memcpy(&hdr, data, sizeof(hdr));
+		pcworker.chunk = (char *) data + sizeof(hdr);
+		pcworker.chunk_len = len - sizeof(hdr);
+
+		if (cstate->eol_type == EOL_UNKNOWN)
+			cstate->eol_type = hdr.eol_type;
+
+		/*
+		 * Keep line numbers in error messages right.  Chunks begin at line
+		 * boundaries, so normally the line being read is the chunk's first
+		 * line.  But CSV parsing may look one character past a terminating
+		 * \r, in which case we're still finishing the previous chunk's last
+		 * line, and the chunk's first line is the next one.
+		 */
+		if (RAW_BUF_BYTES(cstate) > 0 || cstate->line_buf.len > 0)
+			cstate->cur_lineno = hdr.first_lineno - 1;
+		else
+			cstate->cur_lineno = hdr.first_lineno;
+	}
+
+	nbytes = Min(pcworker.chunk_len, maxread);
+	memcpy(outbuf, pcworker.chunk, nbytes);
+	pcworker.chunk += nbytes;
+	pcworker.chunk_len -= nbytes;
+
+	return nbytes;
+}
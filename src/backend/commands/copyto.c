@@ -20,20 +20,27 @@
 
 #include "access/heapam.h"
 #include "access/htup_details.h"
+#include "access/parallel.h"
+#include "access/table.h"
 #include "access/tableam.h"
 #include "access/xact.h"
 #include "access/xlog.h"
+#include "catalog/pg_proc.h"
 #include "commands/copy.h"
 #include "executor/execdesc.h"
 #include "executor/executor.h"
+#include "executor/instrument.h"
 #include "executor/tuptable.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "optimizer/optimizer.h"
+#include "parser/parse_node.h"
+#include "pgstat.h"
 #include "rewrite/rewriteHandler.h"
 #include "storage/fd.h"
+#include "storage/shm_mq.h"
 #include "tcop/tcopprot.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
@@ -50,6 +57,7 @@ typedef enum CopyDest
 	COPY_FILE,					/* to file (or a piped program) */
 	COPY_OLD_FE,				/* to frontend (2.0 protocol) */
 	COPY_NEW_FE,				/* to frontend (3.0 protocol) */
+	COPY_PARALLEL_LEADER,		/* to parallel COPY leader (in a worker) */
 } CopyDest;
 
 /*
@@ -73,6 +81,7 @@ typedef struct CopyToStateData
 	CopyDest	copy_dest;		/* type of copy source/destination */
 	FILE	   *copy_file;		/* used if copy_dest == COPY_FILE */
 	StringInfo	fe_msgbuf;		/* used for all dests during COPY TO */
+	shm_mq_handle *leader_mqh;	/* used if copy_dest == COPY_PARALLEL_LEADER */
 
 	int			file_encoding;	/* file or remote side's character encoding */
 	bool		need_transcoding;	/* file encoding diff from server? */
@@ -86,6 +95,7 @@ typedef struct CopyToStateData
 	bool		is_program;		/* is 'filename' a program to popen? */
 
 	CopyFormatOptions opts;
+	List	   *options;		/* raw COPY options, for parallel workers */
 	Node	   *whereClause;	/* WHERE condition (or NULL) */
 
 	/*
@@ -109,11 +119,36 @@ typedef struct
 /* NOTE: there's a copy of this in copyfromparse.c */
 static const char BinarySignature[11] = "PGCOPY\n\377\r\n\0";
 
+/* DSM keys for parallel COPY TO */
+#define PARALLEL_COPY_TO_KEY_SHARED			1
+#define PARALLEL_COPY_TO_KEY_QUERY_TEXT		2
+#define PARALLEL_COPY_TO_KEY_OPTIONS		3
+#define PARALLEL_COPY_TO_KEY_ATTNAMES		4
+#define PARALLEL_COPY_TO_KEY_SCAN			5
+#define PARALLEL_COPY_TO_KEY_QUEUES			6
+#define PARALLEL_COPY_TO_KEY_BUFFER_USAGE	7
+#define PARALLEL_COPY_TO_KEY_WAL_USAGE		8
+
+/* Size of each worker's queue of formatted rows */
+#define PARALLEL_COPY_TO_QUEUE_SIZE		65536
+
+/*
+ * Shared information among the leader and the workers of a parallel COPY TO.
+ */
+typedef struct ParallelCopyToShared
+{
+	Oid			relid;			/* relation to copy */
+	int			file_encoding;	/* encoding to produce the output in */
+} ParallelCopyToShared;
+
 
 /* non-export function prototypes */
 static void EndCopy(CopyToState cstate);
 static void ClosePipeToProgram(CopyToState cstate);
 static uint64 CopyTo(CopyToState cstate);
+static void CopyToSetupOutput(CopyToState cstate, TupleDesc tupDesc);
+static bool IsParallelCopyToAllowed(CopyToState cstate);
+static bool ParallelCopyTo(CopyToState cstate, uint64 *processed);
 static void CopyOneRowTo(CopyToState cstate, TupleTableSlot *slot);
 static void CopyAttributeOutText(CopyToState cstate, char *string);
 static void CopyAttributeOutCSV(CopyToState cstate, char *string,
@@ -286,6 +321,18 @@ CopySendEndOfRow(CopyToState cstate)
 			/* Dump the accumulated row as one CopyData message */
 			(void) pq_putmessage('d', fe_msgbuf->data, fe_msgbuf->len);
 			break;
+		case COPY_PARALLEL_LEADER:
+
+			/*
+			 * The line terminator depends on where the leader sends the
+			 * data, so it's the leader's business to add it.  Rows are
+			 * batched up in the queue, and only flushed when enough of them
+			 * accumulate or we detach.
+			 */
+			if (shm_mq_send(cstate->leader_mqh, fe_msgbuf->len,
+							fe_msgbuf->data, false, false) != SHM_MQ_SUCCESS)
+				elog(ERROR, "parallel COPY leader has stopped reading");
+			break;
 	}
 
 	resetStringInfo(fe_msgbuf);
@@ -440,6 +487,7 @@ BeginCopyTo(ParseState *pstate,
 
 	/* Extract options from the statement node tree */
 	ProcessCopyOptions(pstate, &cstate->opts, false /* is_from */, options);
+	cstate->options = options;
 
 	/* Process the source/target relation or query */
 	if (rel)
@@ -827,7 +875,6 @@ static uint64
 CopyTo(CopyToState cstate)
 {
 	TupleDesc	tupDesc;
-	int			num_phys_attrs;
 	ListCell   *cur;
 	uint64		processed;
 
@@ -835,41 +882,8 @@ CopyTo(CopyToState cstate)
 		tupDesc = RelationGetDescr(cstate->rel);
 	else
 		tupDesc = cstate->queryDesc->tupDesc;
-	num_phys_attrs = tupDesc->natts;
-	cstate->opts.null_print_client = cstate->opts.null_print; /* default */
 
-	/* We use fe_msgbuf as a per-row buffer regardless of copy_dest */
-	cstate->fe_msgbuf = makeStringInfo();
-
-	/* Get info about the columns we need to process. */
-	cstate->out_functions = (FmgrInfo *) palloc(num_phys_attrs * sizeof(FmgrInfo));
-	foreach(cur, cstate->attnumlist)
-	{
-		int			attnum = lfirst_int(cur);
-		Oid			out_func_oid;
-		bool		isvarlena;
-		Form_pg_attribute attr = TupleDescAttr(tupDesc, attnum - 1);
-
-		if (cstate->opts.binary)
-			getTypeBinaryOutputInfo(attr->atttypid,
-									&out_func_oid,
-									&isvarlena);
-		else
-			getTypeOutputInfo(attr->atttypid,
-							  &out_func_oid,
-							  &isvarlena);
-		fmgr_info(out_func_oid, &cstate->out_functions[attnum - 1]);
-	}
-
-	/*
-	 * Create a temporary memory context that we can reset once per row to
-	 * recover palloc'd memory.  This avoids any problems with leaks inside
-	 * datatype output routines, and should be faster than retail pfree's
-	 * anyway.  (We don't need a whole econtext as CopyFrom does.)
-	 */
-	cstate->rowcontext = AllocSetContextCreate(CurrentMemoryContext,
-											   "COPY TO",
-											   ALLOCSET_DEFAULT_SIZES);
+	CopyToSetupOutput(cstate, tupDesc);
 
 	if (cstate->opts.binary)
 	{
@@ -887,15 +901,6 @@ CopyTo(CopyToState cstate)
 	}
 	else
 	{
-		/*
-		 * For non-binary copy, we need to convert null_print to file
-		 * encoding, because it will be sent directly with CopySendString.
-		 */
-		if (cstate->need_transcoding)
-			cstate->opts.null_print_client = pg_server_to_any(cstate->opts.null_print,
-														 cstate->opts.null_print_len,
-														 cstate->file_encoding);
-
 		/* if a header has been requested send the line */
 		if (cstate->opts.header_line)
 		{
@@ -920,7 +925,14 @@ CopyTo(CopyToState cstate)
 		}
 	}
 
-	if (cstate->rel)
+	if (cstate->rel &&
+		cstate->opts.nworkers > 0 &&
+		IsParallelCopyToAllowed(cstate) &&
+		ParallelCopyTo(cstate, &processed))
+	{
+		/* The workers scanned the table, and we sent out what they formatted */
+	}
+	else if (cstate->rel)
 	{
 		TupleTableSlot *slot;
 		TableScanDesc scandesc;
@@ -964,6 +976,424 @@ CopyTo(CopyToState cstate)
 	return processed;
 }
 
+/*
+ * Set up the state needed to format rows: output functions, the per-row
+ * buffer and memory context, and the null string in the output encoding.
+ */
+static void
+CopyToSetupOutput(CopyToState cstate, TupleDesc tupDesc)
+{
+	int			num_phys_attrs;
+	ListCell   *cur;
+
+	num_phys_attrs = tupDesc->natts;
+	cstate->opts.null_print_client = cstate->opts.null_print; /* default */
+
+	/* We use fe_msgbuf as a per-row buffer regardless of copy_dest */
+	cstate->fe_msgbuf = makeStringInfo();
+
+	/* Get info about the columns we need to process. */
+	cstate->out_functions = (FmgrInfo *) palloc(num_phys_attrs * sizeof(FmgrInfo));
+	foreach(cur, cstate->attnumlist)
+	{
+		int			attnum = lfirst_int(cur);
+		Oid			out_func_oid;
+		bool		isvarlena;
+		Form_pg_attribute attr = TupleDescAttr(tupDesc, attnum - 1);
+
+		if (cstate->opts.binary)
+			getTypeBinaryOutputInfo(attr->atttypid,
+									&out_func_oid,
+									&isvarlena);
+		else
+			getTypeOutputInfo(attr->atttypid,
+							  &out_func_oid,
+							  &isvarlena);
+		fmgr_info(out_func_oid, &cstate->out_functions[attnum - 1]);
+	}
+
+	/*
+	 * Create a temporary memory context that we can reset once per row to
+	 * recover palloc'd memory.  This avoids any problems with leaks inside
+	 * datatype output routines, and should be faster than retail pfree's
+	 * anyway.  (We don't need a whole econtext as CopyFrom does.)
+	 */
+	cstate->rowcontext = AllocSetContextCreate(CurrentMemoryContext,
+											   "COPY TO",
+											   ALLOCSET_DEFAULT_SIZES);
+
+	/*
+	 * For non-binary copy, we need to convert null_print to file encoding,
+	 * because it will be sent directly with CopySendString.
+	 */
+	if (!cstate->opts.binary && cstate->need_transcoding)
+		cstate->opts.null_print_client = pg_server_to_any(cstate->opts.null_print,
+														 cstate->opts.null_print_len,
+														 cstate->file_encoding);
+}
+
+/*
+ * IsParallelCopyToAllowed
+ *		Can the table scan of this COPY TO be done by parallel workers?
+ *
+ * The workers format the rows, so the output functions must be parallel
+ * safe.  Workers can't read the leader's local buffers, so temporary tables
+ * are out, too.
+ */
+static bool
+IsParallelCopyToAllowed(CopyToState cstate)
+{
+	ListCell   *cur;
+
+	if (RelationUsesLocalBuffers(cstate->rel))
+		return false;
+
+	foreach(cur, cstate->attnumlist)
+	{
+		int			attnum = lfirst_int(cur);
+
+		if (func_parallel(cstate->out_functions[attnum - 1].fn_oid) != PROPARALLEL_SAFE)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * ParallelCopyTo
+ *		Leader side of a parallel COPY TO.
+ *
+ * The workers share a parallel scan of the table, format the rows they find
+ * exactly as CopyOneRowTo() would, and send each one through their own queue.
+ * All the leader does is collect the rows from whichever queue has some and
+ * send them on to the destination, so rows come out in no particular order.
+ *
+ * Returns false if no workers could be launched; the caller should then do
+ * a serial copy.  Otherwise stores the number of rows sent into *processed
+ * and returns true.
+ */
+static bool
+ParallelCopyTo(CopyToState cstate, uint64 *processed)
+{
+	ParallelContext *pcxt;
+	ParallelCopyToShared *shared;
+	ParallelTableScanDesc pscan;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	Snapshot	snapshot = GetActiveSnapshot();
+	TupleDesc	tupDesc = RelationGetDescr(cstate->rel);
+	List	   *attnamelist = NIL;
+	char	   *options_str;
+	char	   *attnames_str;
+	char	   *queuespace;
+	char	   *ptr;
+	shm_mq_handle **mqh;
+	Size		querylen;
+	ListCell   *lc;
+	int			nworkers;
+	int			nactive;
+	int			nvisited = 0;
+	int			next = 0;
+	int			i;
+
+	/* The workers need the column list by name, as BeginCopyTo takes it */
+	foreach(lc, cstate->attnumlist)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupDesc, lfirst_int(lc) - 1);
+
+		attnamelist = lappend(attnamelist,
+							  makeString(pstrdup(NameStr(att->attname))));
+	}
+
+	options_str = nodeToString(cstate->options);
+	attnames_str = nodeToString(attnamelist);
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "ParallelCopyToMain",
+								 cstate->opts.nworkers);
+
+	/* Estimate size for shared information -- PARALLEL_COPY_TO_KEY_SHARED */
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelCopyToShared));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Estimate space for the serialized COPY parameters */
+	shm_toc_estimate_chunk(&pcxt->estimator, strlen(options_str) + 1);
+	shm_toc_estimate_chunk(&pcxt->estimator, strlen(attnames_str) + 1);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	/* Estimate space for the parallel scan -- PARALLEL_COPY_TO_KEY_SCAN */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   table_parallelscan_estimate(cstate->rel, snapshot));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Estimate space for the row queues -- PARALLEL_COPY_TO_KEY_QUEUES */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_COPY_TO_QUEUE_SIZE, pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/*
+	 * Estimate space for BufferUsage and WalUsage --
+	 * PARALLEL_COPY_TO_KEY_BUFFER_USAGE and PARALLEL_COPY_TO_KEY_WAL_USAGE.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_COPY_TO_KEY_QUERY_TEXT space */
+	querylen = debug_query_string ? strlen(debug_query_string) : 0;
+	shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	InitializeParallelDSM(pcxt);
+
+	/* Prepare shared information */
+	shared = (ParallelCopyToShared *) shm_toc_allocate(pcxt->toc,
+													   sizeof(ParallelCopyToShared));
+	shared->relid = RelationGetRelid(cstate->rel);
+	shared->file_encoding = cstate->file_encoding;
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_SHARED, shared);
+
+	/* Store the COPY parameters for workers */
+	ptr = shm_toc_allocate(pcxt->toc, strlen(options_str) + 1);
+	strcpy(ptr, options_str);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_OPTIONS, ptr);
+	ptr = shm_toc_allocate(pcxt->toc, strlen(attnames_str) + 1);
+	strcpy(ptr, attnames_str);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_ATTNAMES, ptr);
+
+	/* Set up the parallel scan */
+	pscan = (ParallelTableScanDesc)
+		shm_toc_allocate(pcxt->toc,
+						 table_parallelscan_estimate(cstate->rel, snapshot));
+	table_parallelscan_initialize(cstate->rel, pscan, snapshot);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_SCAN, pscan);
+
+	/* Set up one queue per worker, with the leader as the receiver */
+	queuespace = shm_toc_allocate(pcxt->toc,
+								  mul_size(PARALLEL_COPY_TO_QUEUE_SIZE,
+										   pcxt->nworkers));
+	for (i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(queuespace + ((Size) i) * PARALLEL_COPY_TO_QUEUE_SIZE,
+						   (Size) PARALLEL_COPY_TO_QUEUE_SIZE);
+		shm_mq_set_receiver(mq, MyProc);
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_QUEUES, queuespace);
+
+	/*
+	 * Allocate space for each worker's BufferUsage and WalUsage; no need to
+	 * initialize
+	 */
+	buffer_usage = shm_toc_allocate(pcxt->toc,
+									mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_BUFFER_USAGE, buffer_usage);
+	wal_usage = shm_toc_allocate(pcxt->toc,
+								 mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_WAL_USAGE, wal_usage);
+
+	/* Store query string for workers */
+	ptr = shm_toc_allocate(pcxt->toc, querylen + 1);
+	if (debug_query_string)
+		memcpy(ptr, debug_query_string, querylen);
+	ptr[querylen] = '\0';
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_TO_KEY_QUERY_TEXT, ptr);
+
+	LaunchParallelWorkers(pcxt);
+	nworkers = pcxt->nworkers_launched;
+
+	if (nworkers == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return false;
+	}
+
+	/*
+	 * Workers that were launched are numbered from 0, so they use the first
+	 * nworkers queues.  Passing the worker's handle lets us notice if it dies
+	 * before attaching to its queue.
+	 */
+	mqh = (shm_mq_handle **) palloc(sizeof(shm_mq_handle *) * nworkers);
+	for (i = 0; i < nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = (shm_mq *) (queuespace + ((Size) i) * PARALLEL_COPY_TO_QUEUE_SIZE);
+		mqh[i] = shm_mq_attach(mq, pcxt->seg, pcxt->worker[i].bgwhandle);
+	}
+
+	/*
+	 * Send out rows until every worker has detached from its queue.  As in
+	 * gather_readnext(), we keep reading from the same queue as long as it
+	 * has data, and sleep only once all of them have come up empty.
+	 */
+	*processed = 0;
+	nactive = nworkers;
+	while (nactive > 0)
+	{
+		shm_mq_result res;
+		Size		nbytes;
+		void	   *data;
+
+		CHECK_FOR_INTERRUPTS();
+
+		res = shm_mq_receive(mqh[next], &nbytes, &data, true);
+
+		if (res == SHM_MQ_SUCCESS)
+		{
+			/* The row lacks only its line terminator, if any */
+			CopySendData(cstate, data, nbytes);
+			CopySendEndOfRow(cstate);
+			(*processed)++;
+			nvisited = 0;
+			continue;
+		}
+
+		if (res == SHM_MQ_DETACHED)
+		{
+			/*
+			 * The worker is done, or failed; in the latter case we'll hear
+			 * about it from WaitForParallelWorkersToFinish().
+			 */
+			shm_mq_detach(mqh[next]);
+			--nactive;
+			memmove(&mqh[next], &mqh[next + 1],
+					sizeof(shm_mq_handle *) * (nactive - next));
+			if (next >= nactive)
+				next = 0;
+			nvisited = 0;
+			continue;
+		}
+
+		/* Nothing there right now; try the next queue, or wait */
+		Assert(res == SHM_MQ_WOULD_BLOCK);
+		next = (next + 1) % nactive;
+		if (++nvisited >= nactive)
+		{
+			(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, 0,
+							 WAIT_EVENT_MQ_RECEIVE);
+			ResetLatch(MyLatch);
+			nvisited = 0;
+		}
+	}
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/* Accumulate the workers' buffer and WAL usage */
+	for (i = 0; i < nworkers; i++)
+		InstrAccumParallelQuery(&buffer_usage[i], &wal_usage[i]);
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	return true;
+}
+
+/*
+ * ParallelCopyToMain
+ *		Main entry point for parallel COPY TO worker processes.
+ */
+void
+ParallelCopyToMain(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelCopyToShared *shared;
+	char	   *sharedquery;
+	Relation	rel;
+	ParseState *pstate;
+	List	   *options;
+	List	   *attnamelist;
+	char	   *queuespace;
+	shm_mq	   *mq;
+	ParallelTableScanDesc pscan;
+	TableScanDesc scandesc;
+	TupleTableSlot *slot;
+	CopyToState cstate;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+
+	shared = (ParallelCopyToShared *) shm_toc_lookup(toc,
+													 PARALLEL_COPY_TO_KEY_SHARED,
+													 false);
+
+	/* Set debug_query_string for individual workers */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_COPY_TO_KEY_QUERY_TEXT, false);
+	debug_query_string = sharedquery;
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/*
+	 * Open table.  The lock mode is the same as the leader process.  It's
+	 * okay because the lock mode does not conflict among the parallel
+	 * workers.
+	 */
+	rel = table_open(shared->relid, AccessShareLock);
+
+	pstate = make_parsestate(NULL);
+	pstate->p_sourcetext = sharedquery;
+
+	options = (List *) stringToNode(shm_toc_lookup(toc,
+												   PARALLEL_COPY_TO_KEY_OPTIONS,
+												   false));
+	attnamelist = (List *) stringToNode(shm_toc_lookup(toc,
+													   PARALLEL_COPY_TO_KEY_ATTNAMES,
+													   false));
+
+	/* Attach to our queue as the sender */
+	queuespace = shm_toc_lookup(toc, PARALLEL_COPY_TO_KEY_QUEUES, false);
+	mq = (shm_mq *) (queuespace +
+					 ((Size) ParallelWorkerNumber) * PARALLEL_COPY_TO_QUEUE_SIZE);
+	shm_mq_set_sender(mq, MyProc);
+
+	cstate = BeginCopyTo(pstate, rel, NULL, InvalidOid, NULL, false,
+						 attnamelist, options);
+	cstate->copy_dest = COPY_PARALLEL_LEADER;
+	cstate->leader_mqh = shm_mq_attach(mq, seg, NULL);
+
+	/* Produce the output the leader asked for, not our client encoding */
+	cstate->file_encoding = shared->file_encoding;
+	cstate->need_transcoding =
+		(cstate->file_encoding != GetDatabaseEncoding() ||
+		 pg_database_encoding_max_length() > 1);
+	cstate->encoding_embeds_ascii = PG_ENCODING_IS_CLIENT_ONLY(cstate->file_encoding);
+
+	CopyToSetupOutput(cstate, RelationGetDescr(rel));
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	pscan = shm_toc_lookup(toc, PARALLEL_COPY_TO_KEY_SCAN, false);
+	scandesc = table_beginscan_parallel(rel, pscan);
+	slot = table_slot_create(rel, NULL);
+
+	while (table_scan_getnextslot(scandesc, ForwardScanDirection, slot))
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		/* Format the row and send it to the leader */
+		CopyOneRowTo(cstate, slot);
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	table_endscan(scandesc);
+
+	/* Report buffer/WAL usage during parallel execution */
+	buffer_usage = shm_toc_lookup(toc, PARALLEL_COPY_TO_KEY_BUFFER_USAGE, false);
+	wal_usage = shm_toc_lookup(toc, PARALLEL_COPY_TO_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&buffer_usage[ParallelWorkerNumber],
+						  &wal_usage[ParallelWorkerNumber]);
+
+	/* Detaching flushes any rows still pending and tells the leader we're done */
+	shm_mq_detach(cstate->leader_mqh);
+
+	MemoryContextDelete(cstate->rowcontext);
+	EndCopyTo(cstate);
+	table_close(rel, NoLock);
+}
+
 /*
  * Emit one row during CopyTo().
  */
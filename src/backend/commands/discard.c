@@ -14,11 +14,13 @@
 #include "postgres.h"
 
 #include "access/xact.h"
+#include "catalog/globaltemp.h"
 #include "catalog/namespace.h"
 #include "commands/async.h"
 #include "commands/discard.h"
 #include "commands/prepare.h"
 #include "commands/sequence.h"
+#include "tcop/autoprepare.h"
 #include "utils/guc.h"
 #include "utils/portal.h"
 
@@ -46,6 +48,7 @@ DiscardCommand(DiscardStmt *stmt, bool isTopLevel)
 
 		case DISCARD_TEMP:
 			ResetTempTableNamespace();
+			GlobalTempStorageDiscardAll();
 			break;
 
 		default:
@@ -73,6 +76,8 @@ DiscardAll(bool isTopLevel)
 	Async_UnlistenAll();
 	LockReleaseAll(USER_LOCKMETHOD, true);
 	ResetPlanCache();
+	AutoPrepareReset();
 	ResetTempTableNamespace();
+	GlobalTempStorageDiscardAll();
 	ResetSequenceCaches();
 }
@@ -23,6 +23,7 @@
 #include "access/tableam.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
+#include "catalog/globaltemp.h"
 #include "catalog/index.h"
 #include "catalog/indexing.h"
 #include "catalog/pg_am.h"
@@ -506,6 +507,7 @@ DefineIndex(Oid relationId,
 			bool quiet)
 {
 	bool		concurrent;
+	char		relpersistence;
 	char	   *indexRelationName;
 	char	   *accessMethodName;
 	Oid		   *typeObjectId;
@@ -558,10 +560,15 @@ DefineIndex(Oid relationId,
 	 * Force non-concurrent build on temporary relations, even if CONCURRENTLY
 	 * was requested.  Other backends can't access a temporary relation, so
 	 * there's no harm in grabbing a stronger lock, and a non-concurrent DROP
-	 * is more efficient.  Do this before any use of the concurrent option is
-	 * done.
-	 */
-	if (stmt->concurrent && get_rel_persistence(relationId) != RELPERSISTENCE_TEMP)
+	 * is more efficient.  The same goes for global temporary tables: other
+	 * sessions' rows aren't visible to us, and each session builds its own
+	 * copy of the index from its own rows.  Do this before any use of the
+	 * concurrent option is done.
+	 */
+	relpersistence = get_rel_persistence(relationId);
+	if (stmt->concurrent &&
+		relpersistence != RELPERSISTENCE_TEMP &&
+		relpersistence != RELPERSISTENCE_GLOBAL_TEMP)
 		concurrent = true;
 	else
 		concurrent = false;
@@ -2528,7 +2535,8 @@ ReindexIndex(RangeVar *indexRelation, int options, bool isTopLevel)
 	if (relkind == RELKIND_PARTITIONED_INDEX)
 		ReindexPartitions(indOid, options, isTopLevel);
 	else if ((options & REINDEXOPT_CONCURRENTLY) != 0 &&
-			 persistence != RELPERSISTENCE_TEMP)
+			 persistence != RELPERSISTENCE_TEMP &&
+			 persistence != RELPERSISTENCE_GLOBAL_TEMP)
 		ReindexRelationConcurrently(indOid, options);
 	else
 		reindex_index(indOid, false, persistence,
@@ -2633,7 +2641,8 @@ ReindexTable(RangeVar *relation, int options, bool isTopLevel)
 	if (get_rel_relkind(heapOid) == RELKIND_PARTITIONED_TABLE)
 		ReindexPartitions(heapOid, options, isTopLevel);
 	else if ((options & REINDEXOPT_CONCURRENTLY) != 0 &&
-			 get_rel_persistence(heapOid) != RELPERSISTENCE_TEMP)
+			 get_rel_persistence(heapOid) != RELPERSISTENCE_TEMP &&
+			 get_rel_persistence(heapOid) != RELPERSISTENCE_GLOBAL_TEMP)
 	{
 		result = ReindexRelationConcurrently(heapOid, options);
 
@@ -2773,6 +2782,11 @@ ReindexMultipleTables(const char *objectName, ReindexObjectType objectKind,
 			!isTempNamespace(classtuple->relnamespace))
 			continue;
 
+		/* Likewise global temporary tables this session hasn't used */
+		if (classtuple->relpersistence == RELPERSISTENCE_GLOBAL_TEMP &&
+			!GlobalTempRelationHasStorage(relid))
+			continue;
+
 		/* Check user/system classification, and optionally skip */
 		if (objectKind == REINDEX_OBJECT_SYSTEM &&
 			!IsSystemClass(relid, classtuple))
@@ -2992,7 +3006,8 @@ ReindexMultipleInternal(List *relids, int options)
 			   relkind != RELKIND_PARTITIONED_TABLE);
 
 		if ((options & REINDEXOPT_CONCURRENTLY) != 0 &&
-			relpersistence != RELPERSISTENCE_TEMP)
+			relpersistence != RELPERSISTENCE_TEMP &&
+			relpersistence != RELPERSISTENCE_GLOBAL_TEMP)
 		{
 			(void) ReindexRelationConcurrently(relid,
 											   options |
@@ -3356,7 +3371,7 @@ ReindexRelationConcurrently(Oid relationOid, int options)
 							 ShareUpdateExclusiveLock);
 
 		/* This function shouldn't be called for temporary relations. */
-		if (indexRel->rd_rel->relpersistence == RELPERSISTENCE_TEMP)
+		if (RelationUsesLocalBuffers(indexRel))
 			elog(ERROR, "cannot reindex a temporary table concurrently");
 
 		pgstat_progress_start_command(PROGRESS_COMMAND_CREATE_INDEX,
@@ -29,6 +29,7 @@
 #include "parser/parse_collate.h"
 #include "parser/parse_expr.h"
 #include "parser/parse_type.h"
+#include "postmaster/proxy.h"
 #include "rewrite/rewriteHandler.h"
 #include "tcop/pquery.h"
 #include "tcop/utility.h"
@@ -436,6 +437,9 @@ StorePreparedStatement(const char *stmt_name,
 	if (!prepared_queries)
 		InitQueryHashTable();
 
+	/* The statement stays with this backend */
+	ProxyPinSession();
+
 	/* Add entry to hash table */
 	entry = (PreparedStatement *) hash_search(prepared_queries,
 											  stmt_name,
@@ -34,6 +34,11 @@
 #include "commands/publicationcmds.h"
 #include "funcapi.h"
 #include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
+#include "parser/parse_clause.h"
+#include "parser/parse_collate.h"
+#include "parser/parse_relation.h"
 #include "utils/acl.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
@@ -53,6 +58,11 @@ static void CloseTableList(List *rels);
 static void PublicationAddTables(Oid pubid, List *rels, bool if_not_exists,
 								 AlterPublicationStmt *stmt);
 static void PublicationDropTables(Oid pubid, List *rels, bool missing_ok);
+static Node *transformPublicationWhereClause(Relation rel, Node *whereClause);
+static void check_publication_rowfilter_columns(Relation rel, Node *qual);
+static void check_publication_rowfilters(Oid pubid);
+static bool contain_user_defined_functions_walker(Node *node, void *context);
+static bool contain_user_defined_functions_checker(Oid func_id, void *context);
 
 static void
 parse_publication_options(List *options,
@@ -310,6 +320,14 @@ AlterPublicationOptions(AlterPublicationStmt *stmt, Relation rel,
 
 	pubform = (Form_pg_publication) GETSTRUCT(tup);
 
+	/*
+	 * Row filters that were fine for an insert-only publication may not be
+	 * once updates or deletes are published, so check them again.
+	 */
+	if (publish_given && (pubactions.pubupdate || pubactions.pubdelete) &&
+		!pubform->puballtables)
+		check_publication_rowfilters(pubform->oid);
+
 	/* Invalidate the relcache. */
 	if (pubform->puballtables)
 	{
@@ -385,7 +403,11 @@ AlterPublicationTables(AlterPublicationStmt *stmt, Relation rel,
 		List	   *delrels = NIL;
 		ListCell   *oldlc;
 
-		/* Calculate which relations to drop. */
+		/*
+		 * Calculate which relations to drop.  Relations that have a row
+		 * filter, either now or in the new list, are dropped and added back,
+		 * so that the new filter replaces the old one.
+		 */
 		foreach(oldlc, oldrelids)
 		{
 			Oid			oldrelid = lfirst_oid(oldlc);
@@ -394,21 +416,24 @@ AlterPublicationTables(AlterPublicationStmt *stmt, Relation rel,
 
 			foreach(newlc, rels)
 			{
-				Relation	newrel = (Relation) lfirst(newlc);
+				PublicationRelInfo *newpri = (PublicationRelInfo *) lfirst(newlc);
 
-				if (RelationGetRelid(newrel) == oldrelid)
+				if (RelationGetRelid(newpri->relation) == oldrelid)
 				{
-					found = true;
+					found = (newpri->whereClause == NULL &&
+							 !PublicationRelHasRowFilter(pubid, oldrelid));
 					break;
 				}
 			}
 
 			if (!found)
 			{
-				Relation	oldrel = table_open(oldrelid,
-												ShareUpdateExclusiveLock);
+				PublicationRelInfo *oldpri = palloc(sizeof(PublicationRelInfo));
 
-				delrels = lappend(delrels, oldrel);
+				oldpri->relation = table_open(oldrelid,
+											  ShareUpdateExclusiveLock);
+				oldpri->whereClause = NULL;
+				delrels = lappend(delrels, oldpri);
 			}
 		}
 
@@ -499,7 +524,9 @@ RemovePublicationRelById(Oid proid)
 }
 
 /*
- * Open relations specified by a RangeVar list.
+ * Open relations specified by a list of PublicationTable or RangeVar nodes,
+ * returning a list of PublicationRelInfo.  The WHERE clauses, if any, are
+ * returned untransformed.
  * The returned tables are locked in ShareUpdateExclusiveLock mode in order to
  * add them to a publication.
  */
@@ -515,10 +542,23 @@ OpenTableList(List *tables)
 	 */
 	foreach(lc, tables)
 	{
-		RangeVar   *rv = castNode(RangeVar, lfirst(lc));
-		bool		recurse = rv->inh;
+		RangeVar   *rv;
+		Node	   *whereClause = NULL;
+		bool		recurse;
 		Relation	rel;
 		Oid			myrelid;
+		PublicationRelInfo *pri;
+
+		if (IsA(lfirst(lc), PublicationTable))
+		{
+			PublicationTable *t = (PublicationTable *) lfirst(lc);
+
+			rv = t->relation;
+			whereClause = t->whereClause;
+		}
+		else
+			rv = castNode(RangeVar, lfirst(lc));
+		recurse = rv->inh;
 
 		/* Allow query cancel in case this takes a long time */
 		CHECK_FOR_INTERRUPTS();
@@ -527,7 +567,8 @@ OpenTableList(List *tables)
 		myrelid = RelationGetRelid(rel);
 
 		/*
-		 * Filter out duplicates if user specifies "foo, foo".
+		 * Filter out duplicates if user specifies "foo, foo", unless it's
+		 * not clear which WHERE clause should apply.
 		 *
 		 * Note that this algorithm is known to not be very efficient (O(N^2))
 		 * but given that it only works on list of tables given to us by user
@@ -535,11 +576,20 @@ OpenTableList(List *tables)
 		 */
 		if (list_member_oid(relids, myrelid))
 		{
+			if (whereClause)
+				ereport(ERROR,
+						(errcode(ERRCODE_DUPLICATE_OBJECT),
+						 errmsg("conflicting or redundant WHERE clauses for table \"%s\"",
+								RelationGetRelationName(rel))));
+
 			table_close(rel, ShareUpdateExclusiveLock);
 			continue;
 		}
 
-		rels = lappend(rels, rel);
+		pri = palloc(sizeof(PublicationRelInfo));
+		pri->relation = rel;
+		pri->whereClause = whereClause;
+		rels = lappend(rels, pri);
 		relids = lappend_oid(relids, myrelid);
 
 		/*
@@ -572,7 +622,10 @@ OpenTableList(List *tables)
 
 				/* find_all_inheritors already got lock */
 				rel = table_open(childrelid, NoLock);
-				rels = lappend(rels, rel);
+				pri = palloc(sizeof(PublicationRelInfo));
+				pri->relation = rel;
+				pri->whereClause = whereClause;
+				rels = lappend(rels, pri);
 				relids = lappend_oid(relids, childrelid);
 			}
 		}
@@ -593,9 +646,10 @@ CloseTableList(List *rels)
 
 	foreach(lc, rels)
 	{
-		Relation	rel = (Relation) lfirst(lc);
+		PublicationRelInfo *pri = (PublicationRelInfo *) lfirst(lc);
 
-		table_close(rel, NoLock);
+		table_close(pri->relation, NoLock);
+		pfree(pri);
 	}
 }
 
@@ -607,12 +661,14 @@ PublicationAddTables(Oid pubid, List *rels, bool if_not_exists,
 					 AlterPublicationStmt *stmt)
 {
 	ListCell   *lc;
+	Publication *pub = GetPublication(pubid);
 
 	Assert(!stmt || !stmt->for_all_tables);
 
 	foreach(lc, rels)
 	{
-		Relation	rel = (Relation) lfirst(lc);
+		PublicationRelInfo *pri = (PublicationRelInfo *) lfirst(lc);
+		Relation	rel = pri->relation;
 		ObjectAddress obj;
 
 		/* Must be owner of the table or superuser. */
@@ -620,7 +676,15 @@ PublicationAddTables(Oid pubid, List *rels, bool if_not_exists,
 			aclcheck_error(ACLCHECK_NOT_OWNER, get_relkind_objtype(rel->rd_rel->relkind),
 						   RelationGetRelationName(rel));
 
-		obj = publication_add_relation(pubid, rel, if_not_exists);
+		if (pri->whereClause)
+		{
+			pri->whereClause = transformPublicationWhereClause(rel,
+															   pri->whereClause);
+			if (pub->pubactions.pubupdate || pub->pubactions.pubdelete)
+				check_publication_rowfilter_columns(rel, pri->whereClause);
+		}
+
+		obj = publication_add_relation(pubid, pri, if_not_exists);
 		if (stmt)
 		{
 			EventTriggerCollectSimpleCommand(obj, InvalidObjectAddress,
@@ -644,7 +708,8 @@ PublicationDropTables(Oid pubid, List *rels, bool missing_ok)
 
 	foreach(lc, rels)
 	{
-		Relation	rel = (Relation) lfirst(lc);
+		PublicationRelInfo *pri = (PublicationRelInfo *) lfirst(lc);
+		Relation	rel = pri->relation;
 		Oid			relid = RelationGetRelid(rel);
 
 		prid = GetSysCacheOid2(PUBLICATIONRELMAP, Anum_pg_publication_rel_oid,
@@ -666,6 +731,140 @@ PublicationDropTables(Oid pubid, List *rels, bool missing_ok)
 	}
 }
 
+/*
+ * Transform the WHERE clause of a table being added to a publication, and
+ * check that it can be evaluated by the output plugin.
+ *
+ * The filter is evaluated while decoding, with a historic snapshot, so only
+ * immutable built-in functions and operators are allowed; anything else
+ * could look at the catalogs or user data in ways that don't work there.
+ */
+static Node *
+transformPublicationWhereClause(Relation rel, Node *whereClause)
+{
+	ParseState *pstate;
+	ParseNamespaceItem *nsitem;
+	Node	   *qual;
+
+	pstate = make_parsestate(NULL);
+	nsitem = addRangeTableEntryForRelation(pstate, rel, AccessShareLock,
+										   NULL, false, false);
+	addNSItemToQuery(pstate, nsitem, false, true, true);
+
+	qual = transformWhereClause(pstate, copyObject(whereClause),
+								EXPR_KIND_PUBLICATION_WHERE,
+								"PUBLICATION WHERE");
+	assign_expr_collations(pstate, qual);
+
+	if (contain_mutable_functions(qual))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+				 errmsg("functions in publication WHERE expression must be marked IMMUTABLE")));
+
+	if (contain_user_defined_functions_walker(qual, NULL))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("user-defined functions and operators are not allowed in publication WHERE expressions")));
+
+	free_parsestate(pstate);
+
+	return qual;
+}
+
+/*
+ * Check that a row filter only references replica identity columns.
+ *
+ * For UPDATE and DELETE the filter is also evaluated on the old tuple, and
+ * the WAL record only carries the replica identity columns of that, so a
+ * filter on any other column would be evaluated against NULLs.
+ */
+static void
+check_publication_rowfilter_columns(Relation rel, Node *qual)
+{
+	Bitmapset  *attrs = NULL;
+	Bitmapset  *idattrs;
+	int			attno;
+
+	if (rel->rd_rel->relreplident == REPLICA_IDENTITY_FULL)
+		return;
+
+	pull_varattnos(qual, 1, &attrs);
+	idattrs = RelationGetIndexAttrBitmap(rel, INDEX_ATTR_BITMAP_IDENTITY_KEY);
+
+	attno = -1;
+	while ((attno = bms_next_member(attrs, attno)) >= 0)
+	{
+		if (!bms_is_member(attno, idattrs))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+					 errmsg("column \"%s\" used in the publication WHERE expression is not part of the replica identity of table \"%s\"",
+							get_attname(RelationGetRelid(rel),
+										attno + FirstLowInvalidHeapAttributeNumber,
+										false),
+							RelationGetRelationName(rel)),
+					 errdetail("Publications that publish UPDATE or DELETE can only filter on replica identity columns.")));
+	}
+
+	bms_free(attrs);
+	bms_free(idattrs);
+}
+
+/*
+ * Check the stored row filters of all tables in a publication.
+ */
+static void
+check_publication_rowfilters(Oid pubid)
+{
+	List	   *relids = GetPublicationRelations(pubid, PUBLICATION_PART_ROOT);
+	ListCell   *lc;
+
+	foreach(lc, relids)
+	{
+		Oid			relid = lfirst_oid(lc);
+		HeapTuple	tup;
+		Datum		prqual;
+		bool		isnull;
+
+		tup = SearchSysCache2(PUBLICATIONRELMAP, ObjectIdGetDatum(relid),
+							  ObjectIdGetDatum(pubid));
+		if (!HeapTupleIsValid(tup))
+			continue;
+
+		prqual = SysCacheGetAttr(PUBLICATIONRELMAP, tup,
+								 Anum_pg_publication_rel_prqual, &isnull);
+		if (!isnull)
+		{
+			Relation	rel = table_open(relid, AccessShareLock);
+
+			check_publication_rowfilter_columns(rel,
+												stringToNode(TextDatumGetCString(prqual)));
+			table_close(rel, AccessShareLock);
+		}
+
+		ReleaseSysCache(tup);
+	}
+}
+
+static bool
+contain_user_defined_functions_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+
+	if (check_functions_in_node(node, contain_user_defined_functions_checker,
+								context))
+		return true;
+
+	return expression_tree_walker(node, contain_user_defined_functions_walker,
+								  context);
+}
+
+static bool
+contain_user_defined_functions_checker(Oid func_id, void *context)
+{
+	return func_id >= FirstNormalObjectId;
+}
+
 /*
  * Internal workhorse for changing a publication owner
  */
@@ -33,13 +33,17 @@
 #include "commands/defrem.h"
 #include "commands/sequence.h"
 #include "commands/tablecmds.h"
+#include "common/hashfn.h"
 #include "funcapi.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "parser/parse_type.h"
+#include "port/atomics.h"
 #include "storage/lmgr.h"
 #include "storage/proc.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
@@ -82,6 +86,7 @@ typedef struct SeqTableData
 	/* if last != cached, we have not used up all the cached values */
 	int64		increment;		/* copy of sequence's increment field */
 	/* note that increment is zero until we first do nextval_internal() */
+	bool		shared;			/* does nextval use the shared cache? */
 } SeqTableData;
 
 typedef SeqTableData *SeqTable;
@@ -94,6 +99,65 @@ static HTAB *seqhashtab = NULL; /* hash table for SeqTable items */
  */
 static SeqTableData *last_used_seq = NULL;
 
+/*
+ * Shared sequence cache.
+ *
+ * If shared_sequence_cache is more than 1, a backend that has to visit the
+ * sequence page fetches that many values at once, returns the first one and
+ * publishes the rest in a slot in shared memory.  Other backends then take
+ * values from the slot with a single atomic fetch-and-add, without locking
+ * the sequence's buffer or writing WAL.  The published range has already
+ * been consumed from the sequence tuple, and is covered by the WAL record
+ * written when it was fetched, just like the values pre-logged because of
+ * SEQ_LOG_VALS; so after a crash or restart, the unused part of it is lost.
+ *
+ * Slots are direct-mapped from the database and sequence OIDs, so two busy
+ * sequences that map to the same slot keep evicting each other's ranges,
+ * which costs skipped values but is otherwise harmless.
+ *
+ * The slot's ticket holds the epoch of the published range in its upper
+ * half and the number of values claimed from the range in its lower half.
+ * Publishing a range (or invalidating the slot) installs it with the next
+ * epoch and then resets the ticket, so a backend whose fetch-and-add
+ * returned (epoch, n) owns the n'th value of the range of that epoch, if the
+ * range it reads afterwards is still that one.  Otherwise the claimed value
+ * is skipped and the backend takes the regular path.  The range itself is
+ * read and written with the changecount protocol described for
+ * st_changecount in pgstat.h, and writers are serialized by the slot's
+ * spinlock.
+ */
+#define NUM_SEQ_SHARED_SLOTS	1024
+
+typedef struct SeqSharedRange
+{
+	uint32		epoch;			/* epoch this range was published in */
+	Oid			dbid;			/* database of the sequence */
+	Oid			relid;			/* pg_class OID of the sequence */
+	Oid			filenode;		/* relfilenode the range was fetched from */
+	int64		first;			/* first value of the range */
+	int64		increment;		/* sequence's increment */
+	uint32		count;			/* number of values in the range */
+} SeqSharedRange;
+
+typedef struct SeqSharedSlot
+{
+	pg_atomic_uint64 ticket;	/* epoch << 32 | number of claimed values */
+	slock_t		mutex;			/* serializes writers of the range */
+	uint32		changecount;	/* odd while the range is being changed */
+	SeqSharedRange range;
+} SeqSharedSlot;
+
+/* Pad the slots to a cache line, so that they don't share one */
+typedef union SeqSharedSlotPadded
+{
+	SeqSharedSlot slot;
+	char		pad[PG_CACHE_LINE_SIZE];
+} SeqSharedSlotPadded;
+
+int			shared_sequence_cache = 0;
+
+static SeqSharedSlotPadded *SeqSharedSlots = NULL;
+
 static void fill_seq_with_data(Relation rel, HeapTuple tuple);
 static Relation lock_and_open_sequence(SeqTable seq);
 static void create_seq_hashtable(void);
@@ -108,6 +172,10 @@ static void init_params(ParseState *pstate, List *options, bool for_identity,
 						List **owned_by);
 static void do_setval(Oid relid, int64 next, bool iscalled);
 static void process_owned_by(Relation seqrel, List *owned_by, bool for_identity);
+static bool seq_shared_fetch(SeqTable elm, int64 *result);
+static void seq_shared_publish(SeqTable elm, int64 first, int64 increment,
+							   uint32 count);
+static void seq_shared_invalidate(Oid relid);
 
 
 /*
@@ -139,6 +207,12 @@ DefineSequence(ParseState *pstate, CreateSeqStmt *seq)
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("unlogged sequences are not supported")));
 
+	/* Nor global temporary ones, whose state would have to be per-session */
+	if (seq->sequence->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("global temporary sequences are not supported")));
+
 	/*
 	 * If if_not_exists was given and a relation with the same name already
 	 * exists, bail out. (Note: we needn't check this when not if_not_exists,
@@ -224,6 +298,9 @@ DefineSequence(ParseState *pstate, CreateSeqStmt *seq)
 	tuple = heap_form_tuple(tupDesc, value, null);
 	fill_seq_with_data(rel, tuple);
 
+	/* a dropped sequence with the same OID might have left a shared range */
+	seq_shared_invalidate(seqoid);
+
 	/* process OWNED BY if given */
 	if (owned_by)
 		process_owned_by(rel, owned_by, seq->for_identity);
@@ -332,6 +409,7 @@ ResetSequence(Oid seq_relid)
 	/* Clear local cache so that we don't think we have cached numbers */
 	/* Note that we do not change the currval() state */
 	elm->cached = elm->last;
+	seq_shared_invalidate(seq_relid);
 
 	relation_close(seq_rel, NoLock);
 }
@@ -477,6 +555,7 @@ AlterSequence(ParseState *pstate, AlterSeqStmt *stmt)
 	/* Clear local cache so that we don't think we have cached numbers */
 	/* Note that we do not change the currval() state */
 	elm->cached = elm->last;
+	seq_shared_invalidate(relid);
 
 	/* If needed, rewrite the sequence relation itself */
 	if (need_seq_rewrite)
@@ -631,6 +710,17 @@ nextval_internal(Oid relid, bool check_permissions)
 		return elm->last;
 	}
 
+	/* Take a value from the shared cache, if there's one left */
+	if (elm->shared && shared_sequence_cache > 1 &&
+		seq_shared_fetch(elm, &result))
+	{
+		elm->last = elm->cached = result;
+		elm->last_valid = true;
+		relation_close(seqrel, NoLock);
+		last_used_seq = elm;
+		return result;
+	}
+
 	pgstuple = SearchSysCache1(SEQRELID, ObjectIdGetDatum(relid));
 	if (!HeapTupleIsValid(pgstuple))
 		elog(ERROR, "cache lookup failed for sequence %u", relid);
@@ -642,10 +732,35 @@ nextval_internal(Oid relid, bool check_permissions)
 	cycle = pgsform->seqcycle;
 	ReleaseSysCache(pgstuple);
 
+	/*
+	 * Sequences with their own CACHE setting keep using the backend-local
+	 * cache, and temporary ones have nobody to share values with.
+	 */
+	elm->shared = (shared_sequence_cache > 1 && cache == 1 &&
+				   seqrel->rd_rel->relpersistence != RELPERSISTENCE_TEMP);
+
 	/* lock page' buffer and read tuple */
 	seq = read_seq_tuple(seqrel, &buf, &seqdatatuple);
 	page = BufferGetPage(buf);
 
+	if (elm->shared)
+	{
+		/*
+		 * Somebody else may have published a new range while we were waiting
+		 * for the buffer lock.  If not, fetch enough values for a new one.
+		 */
+		if (seq_shared_fetch(elm, &result))
+		{
+			UnlockReleaseBuffer(buf);
+			elm->last = elm->cached = result;
+			elm->last_valid = true;
+			relation_close(seqrel, NoLock);
+			last_used_seq = elm;
+			return result;
+		}
+		cache = shared_sequence_cache;
+	}
+
 	elm->increment = incby;
 	last = next = result = seq->last_value;
 	fetch = cache;
@@ -753,7 +868,7 @@ nextval_internal(Oid relid, bool check_permissions)
 
 	/* save info in local cache */
 	elm->last = result;			/* last returned number */
-	elm->cached = last;			/* last fetched number */
+	elm->cached = elm->shared ? result : last;	/* last fetched number */
 	elm->last_valid = true;
 
 	last_used_seq = elm;
@@ -819,6 +934,16 @@ nextval_internal(Oid relid, bool check_permissions)
 
 	END_CRIT_SECTION();
 
+	/*
+	 * Hand the values after the one we return to the shared cache.  The loop
+	 * above never wraps around after the first value, so they're evenly
+	 * spaced.  This has to happen before releasing the buffer lock, so that
+	 * a concurrent setval() can't be followed by a stale range.
+	 */
+	if (elm->shared)
+		seq_shared_publish(elm, rescnt > 1 ? result + incby : 0, incby,
+						   (uint32) (rescnt - 1));
+
 	UnlockReleaseBuffer(buf);
 
 	relation_close(seqrel, NoLock);
@@ -974,6 +1099,7 @@ do_setval(Oid relid, int64 next, bool iscalled)
 
 	/* In any case, forget any future cached numbers */
 	elm->cached = elm->last;
+	seq_shared_invalidate(relid);
 
 	/* check the comment above nextval_internal()'s equivalent call. */
 	if (RelationNeedsWAL(seqrel))
@@ -1127,6 +1253,7 @@ init_sequence(Oid relid, SeqTable *p_elm, Relation *p_rel)
 		elm->lxid = InvalidLocalTransactionId;
 		elm->last_valid = false;
 		elm->last = elm->cached = 0;
+		elm->shared = false;
 	}
 
 	/*
@@ -1944,6 +2071,170 @@ ResetSequenceCaches(void)
 	last_used_seq = NULL;
 }
 
+/*
+ * Report shared memory space needed by SequenceShmemInit
+ */
+Size
+SequenceShmemSize(void)
+{
+	return mul_size(NUM_SEQ_SHARED_SLOTS, sizeof(SeqSharedSlotPadded));
+}
+
+/*
+ * Allocate and initialize the shared sequence cache
+ */
+void
+SequenceShmemInit(void)
+{
+	bool		found;
+	int			i;
+
+	SeqSharedSlots = (SeqSharedSlotPadded *)
+		ShmemInitStruct("Shared Sequence Cache", SequenceShmemSize(), &found);
+
+	if (!found)
+	{
+		MemSet(SeqSharedSlots, 0, SequenceShmemSize());
+		for (i = 0; i < NUM_SEQ_SHARED_SLOTS; i++)
+		{
+			SeqSharedSlot *slot = &SeqSharedSlots[i].slot;
+
+			pg_atomic_init_u64(&slot->ticket, 0);
+			SpinLockInit(&slot->mutex);
+		}
+	}
+}
+
+/*
+ * Find the shared cache slot of a sequence in the current database
+ */
+static inline volatile SeqSharedSlot *
+seq_shared_slot(Oid relid)
+{
+	uint32		hash;
+
+	hash = hash_combine(murmurhash32((uint32) MyDatabaseId),
+						murmurhash32((uint32) relid));
+
+	return &SeqSharedSlots[hash % NUM_SEQ_SHARED_SLOTS].slot;
+}
+
+/*
+ * Try to take the next value of a sequence from the shared cache.
+ *
+ * Returns false if the sequence has no range in the cache, or it has been
+ * used up.
+ */
+static bool
+seq_shared_fetch(SeqTable elm, int64 *result)
+{
+	volatile SeqSharedSlot *slot = seq_shared_slot(elm->relid);
+	SeqSharedRange range;
+	uint64		ticket;
+	uint32		epoch;
+	uint32		index;
+
+	/* claim a value; this is a full memory barrier */
+	ticket = pg_atomic_fetch_add_u64(&slot->ticket, 1);
+	epoch = (uint32) (ticket >> 32);
+	index = (uint32) ticket;
+
+	/* read the range the value belongs to, unless it's already replaced */
+	for (;;)
+	{
+		uint32		before_changecount;
+		uint32		after_changecount;
+
+		before_changecount = slot->changecount;
+		pg_read_barrier();
+		range = slot->range;
+		pg_read_barrier();
+		after_changecount = slot->changecount;
+
+		if (before_changecount == after_changecount &&
+			(before_changecount & 1) == 0)
+			break;
+		SPIN_DELAY();
+	}
+
+	if (range.epoch != epoch ||
+		index >= range.count ||
+		range.dbid != MyDatabaseId ||
+		range.relid != elm->relid ||
+		range.filenode != elm->filenode)
+		return false;
+
+	*result = range.first + (int64) index * range.increment;
+	return true;
+}
+
+/*
+ * Install a range in a shared cache slot, with the next epoch.
+ *
+ * Caller must hold the slot's spinlock.
+ */
+static void
+seq_shared_set_range(volatile SeqSharedSlot *slot, Oid relid, Oid filenode,
+					 int64 first, int64 increment, uint32 count)
+{
+	uint32		epoch;
+
+	epoch = (uint32) (pg_atomic_read_u64(&slot->ticket) >> 32) + 1;
+
+	slot->changecount++;
+	pg_write_barrier();
+
+	slot->range.epoch = epoch;
+	slot->range.dbid = MyDatabaseId;
+	slot->range.relid = relid;
+	slot->range.filenode = filenode;
+	slot->range.first = first;
+	slot->range.increment = increment;
+	slot->range.count = count;
+
+	pg_write_barrier();
+	slot->changecount++;
+
+	/* now let backends claim values from the new range */
+	pg_atomic_exchange_u64(&slot->ticket, (uint64) epoch << 32);
+}
+
+/*
+ * Publish a range of values of a sequence in the shared cache, replacing
+ * whatever the slot held before.
+ *
+ * Caller must hold the exclusive lock on the sequence's buffer, and must
+ * already have consumed the values from the sequence tuple.
+ */
+static void
+seq_shared_publish(SeqTable elm, int64 first, int64 increment, uint32 count)
+{
+	volatile SeqSharedSlot *slot = seq_shared_slot(elm->relid);
+
+	SpinLockAcquire(&slot->mutex);
+	seq_shared_set_range(slot, elm->relid, elm->filenode,
+						 first, increment, count);
+	SpinLockRelease(&slot->mutex);
+}
+
+/*
+ * Forget a sequence's range in the shared cache, if it has one.
+ *
+ * This must be done whenever the sequence tuple is changed other than by
+ * nextval, so that no backend hands out values from before the change.
+ * Backends that have already claimed a value may still return it.
+ */
+static void
+seq_shared_invalidate(Oid relid)
+{
+	volatile SeqSharedSlot *slot = seq_shared_slot(relid);
+
+	SpinLockAcquire(&slot->mutex);
+	if (slot->range.dbid == MyDatabaseId && slot->range.relid == relid)
+		seq_shared_set_range(slot, relid, InvalidOid, 0, 0, 0);
+	SpinLockRelease(&slot->mutex);
+}
+
 /*
  * Mask a Sequence page before performing consistency checks on it.
  */
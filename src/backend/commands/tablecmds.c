@@ -23,6 +23,7 @@
 #include "access/relscan.h"
 #include "access/sysattr.h"
 #include "access/tableam.h"
+#include "access/toast_compression.h"
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
@@ -420,6 +421,9 @@ static ObjectAddress ATExecSetOptions(Relation rel, const char *colName,
 									  Node *options, bool isReset, LOCKMODE lockmode);
 static ObjectAddress ATExecSetStorage(Relation rel, const char *colName,
 									  Node *newValue, LOCKMODE lockmode);
+static ObjectAddress ATExecSetCompression(Relation rel, const char *colName,
+										  Node *newValue, LOCKMODE lockmode);
+static char GetAttributeCompression(Oid atttypid, const char *compression);
 static void ATPrepDropColumn(List **wqueue, Relation rel, bool recurse, bool recursing,
 							 AlterTableCmd *cmd, LOCKMODE lockmode,
 							 AlterTableUtilityContext *context);
@@ -510,6 +514,8 @@ static void ATPrepSetTableSpace(AlteredTableInfo *tab, Relation rel,
 								const char *tablespacename, LOCKMODE lockmode);
 static void ATExecSetTableSpace(Oid tableOid, Oid newTableSpace, LOCKMODE lockmode);
 static void ATExecSetTableSpaceNoStorage(Relation rel, Oid newTableSpace);
+static void ATExecSetLoggedNoRewrite(Oid tableOid, Oid newTableSpace,
+									 LOCKMODE lockmode);
 static void ATExecSetRelOptions(Relation rel, List *defList,
 								AlterTableType operation,
 								LOCKMODE lockmode);
@@ -616,11 +622,25 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId,
 	 * Check consistency of arguments
 	 */
 	if (stmt->oncommit != ONCOMMIT_NOOP
-		&& stmt->relation->relpersistence != RELPERSISTENCE_TEMP)
+		&& stmt->relation->relpersistence != RELPERSISTENCE_TEMP
+		&& stmt->relation->relpersistence != RELPERSISTENCE_GLOBAL_TEMP)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
 				 errmsg("ON COMMIT can only be used on temporary tables")));
 
+	if (stmt->relation->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+	{
+		if (stmt->oncommit == ONCOMMIT_DELETE_ROWS ||
+			stmt->oncommit == ONCOMMIT_DROP)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("global temporary tables support only ON COMMIT PRESERVE ROWS")));
+		if (stmt->partspec != NULL || stmt->inhRelations != NIL)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("global temporary tables cannot use inheritance or partitioning")));
+	}
+
 	if (stmt->partspec != NULL)
 	{
 		if (relkind != RELKIND_RELATION)
@@ -817,6 +837,11 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId,
 		attnum++;
 		attr = TupleDescAttr(descriptor, attnum - 1);
 
+		/* Set the compression method, if one was specified */
+		if (colDef->compression != NULL)
+			attr->attcompression = GetAttributeCompression(attr->atttypid,
+														   colDef->compression);
+
 		if (colDef->raw_default != NULL)
 		{
 			RawColumnDefault *rawEnt;
@@ -2308,6 +2333,13 @@ MergeAttributes(List *schema, List *supers, char relpersistence,
 							? "cannot inherit from temporary relation of another session"
 							: "cannot create as partition of temporary relation of another session")));
 
+		/* Global temporary tables can't take part in inheritance at all */
+		if (relation->rd_rel->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("cannot inherit from global temporary relation \"%s\"",
+							RelationGetRelationName(relation))));
+
 		/*
 		 * We should have an UNDER permission flag for this, but for now,
 		 * demand that creator of a child table own the parent.
@@ -2396,6 +2428,23 @@ MergeAttributes(List *schema, List *supers, char relpersistence,
 									   storage_name(def->storage),
 									   storage_name(attribute->attstorage))));
 
+				/* Copy/check compression parameter */
+				if (CompressionMethodIsValid(attribute->attcompression))
+				{
+					const char *compression =
+					GetCompressionMethodName(attribute->attcompression);
+
+					if (def->compression == NULL)
+						def->compression = pstrdup(compression);
+					else if (strcmp(def->compression, compression) != 0)
+						ereport(ERROR,
+								(errcode(ERRCODE_DATATYPE_MISMATCH),
+								 errmsg("column \"%s\" has a compression method conflict",
+										attributeName),
+								 errdetail("%s versus %s",
+										   def->compression, compression)));
+				}
+
 				def->inhcount++;
 				/* Merge of NOT NULL constraints = OR 'em together */
 				def->is_not_null |= attribute->attnotnull;
@@ -2423,6 +2472,9 @@ MergeAttributes(List *schema, List *supers, char relpersistence,
 				def->is_not_null = attribute->attnotnull;
 				def->is_from_type = false;
 				def->storage = attribute->attstorage;
+				if (CompressionMethodIsValid(attribute->attcompression))
+					def->compression =
+						pstrdup(GetCompressionMethodName(attribute->attcompression));
 				def->raw_default = NULL;
 				def->cooked_default = NULL;
 				def->generated = attribute->attgenerated;
@@ -2675,6 +2727,10 @@ MergeAttributes(List *schema, List *supers, char relpersistence,
 									   storage_name(def->storage),
 									   storage_name(newdef->storage))));
 
+				/* A locally specified compression method wins */
+				if (newdef->compression != NULL)
+					def->compression = newdef->compression;
+
 				/* Mark the column as locally defined */
 				def->is_local = true;
 				/* Merge of NOT NULL constraints = OR 'em together */
@@ -3784,6 +3840,15 @@ AlterTableGetLockLevel(List *cmds)
 				cmd_lockmode = AccessExclusiveLock;
 				break;
 
+				/*
+				 * Changing the compression method doesn't affect existing
+				 * data, but take the same lock as SET STORAGE so that all
+				 * sessions toast new values the same way afterwards.
+				 */
+			case AT_SetCompression:
+				cmd_lockmode = AccessExclusiveLock;
+				break;
+
 				/*
 				 * Removing constraints can affect SELECTs that have been
 				 * optimized assuming the constraint holds true. See also
@@ -4177,6 +4242,12 @@ ATPrepCmd(List **wqueue, Relation rel, AlterTableCmd *cmd,
 			/* No command-specific prep needed */
 			pass = AT_PASS_MISC;
 			break;
+		case AT_SetCompression: /* ALTER COLUMN SET COMPRESSION */
+			ATSimplePermissions(rel, ATT_TABLE | ATT_MATVIEW);
+			ATSimpleRecursion(wqueue, rel, cmd, recurse, lockmode, context);
+			/* No command-specific prep needed */
+			pass = AT_PASS_MISC;
+			break;
 		case AT_DropColumn:		/* DROP COLUMN */
 			ATSimplePermissions(rel,
 								ATT_TABLE | ATT_COMPOSITE_TYPE | ATT_FOREIGN_TABLE);
@@ -4520,6 +4591,9 @@ ATExecCmd(List **wqueue, AlteredTableInfo *tab, Relation rel,
 		case AT_SetStorage:		/* ALTER COLUMN SET STORAGE */
 			address = ATExecSetStorage(rel, cmd->name, cmd->def, lockmode);
 			break;
+		case AT_SetCompression: /* ALTER COLUMN SET COMPRESSION */
+			address = ATExecSetCompression(rel, cmd->name, cmd->def, lockmode);
+			break;
 		case AT_DropColumn:		/* DROP COLUMN */
 			address = ATExecDropColumn(wqueue, rel, cmd->name,
 									   cmd->behavior, false, false,
@@ -5005,6 +5079,16 @@ ATRewriteTables(AlterTableStmt *parsetree, List **wqueue, LOCKMODE lockmode,
 						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 						 errmsg("cannot rewrite temporary tables of other sessions")));
 
+			/*
+			 * Nor on global temporary tables: the rewrite would have to be
+			 * applied to every session's copy of the data.
+			 */
+			if (RelationIsGlobalTemp(OldHeap))
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("cannot rewrite global temporary table \"%s\"",
+								RelationGetRelationName(OldHeap))));
+
 			/*
 			 * Select destination tablespace (same as original unless user
 			 * requested a change)
@@ -5021,6 +5105,36 @@ ATRewriteTables(AlterTableStmt *parsetree, List **wqueue, LOCKMODE lockmode,
 			persistence = tab->chgPersistence ?
 				tab->newrelpersistence : OldHeap->rd_rel->relpersistence;
 
+			/*
+			 * SET LOGGED doesn't need the tuples to be reconstructed: the
+			 * pages of an unlogged heap are just as valid in a permanent one.
+			 * If that's the only reason for the rewrite, copy the table and
+			 * its toast table block by block into new permanent relfilenodes
+			 * instead, and rebuild the indexes as a rewrite would.  This
+			 * writes each page to WAL once (or, with wal_level = minimal,
+			 * just syncs it at commit), rather than every tuple.  Other table
+			 * AMs' page contents aren't ours to copy, so they still go the
+			 * long way around.
+			 */
+			if (tab->rewrite == AT_REWRITE_ALTER_PERSISTENCE &&
+				persistence == RELPERSISTENCE_PERMANENT &&
+				OldHeap->rd_tableam == GetHeapamTableAmRoutine())
+			{
+				table_close(OldHeap, NoLock);
+
+				if (tab->constraints != NIL || tab->verify_new_notnull ||
+					tab->partition_constraint != NULL)
+					ATRewriteTable(tab, InvalidOid, lockmode);
+
+				ATExecSetLoggedNoRewrite(tab->relid, tab->newTableSpace,
+										 lockmode);
+				reindex_relation(tab->relid,
+								 REINDEX_REL_PROCESS_TOAST |
+								 REINDEX_REL_FORCE_INDEXES_PERMANENT,
+								 0);
+				continue;
+			}
+
 			table_close(OldHeap, NoLock);
 
 			/*
@@ -6225,6 +6339,8 @@ ATExecAddColumn(List **wqueue, AlteredTableInfo *tab, Relation rel,
 	attribute.attndims = list_length(colDef->typeName->arrayBounds);
 	attribute.attstorage = tform->typstorage;
 	attribute.attalign = tform->typalign;
+	attribute.attcompression = GetAttributeCompression(typeOid,
+													   colDef->compression);
 	attribute.attnotnull = colDef->is_not_null;
 	attribute.atthasdef = false;
 	attribute.atthasmissing = false;
@@ -7734,6 +7850,106 @@ ATExecSetStorage(Relation rel, const char *colName, Node *newValue, LOCKMODE loc
 	return address;
 }
 
+/*
+ * ALTER TABLE ALTER COLUMN SET COMPRESSION
+ *
+ * Only values compressed from now on use the new method; existing values
+ * are left as they are.
+ *
+ * Return value is the address of the modified column
+ */
+static ObjectAddress
+ATExecSetCompression(Relation rel,
+					 const char *colName,
+					 Node *newValue,
+					 LOCKMODE lockmode)
+{
+	Relation	attrel;
+	HeapTuple	tuple;
+	Form_pg_attribute atttableform;
+	AttrNumber	attnum;
+	char	   *compression;
+	char		cmethod;
+	ObjectAddress address;
+
+	Assert(IsA(newValue, String));
+	compression = strVal(newValue);
+
+	attrel = table_open(AttributeRelationId, RowExclusiveLock);
+
+	/* copy the cache entry so we can scribble on it below */
+	tuple = SearchSysCacheCopyAttName(RelationGetRelid(rel), colName);
+	if (!HeapTupleIsValid(tuple))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_COLUMN),
+				 errmsg("column \"%s\" of relation \"%s\" does not exist",
+						colName, RelationGetRelationName(rel))));
+
+	/* prevent them from altering a system attribute */
+	atttableform = (Form_pg_attribute) GETSTRUCT(tuple);
+	attnum = atttableform->attnum;
+	if (attnum <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot alter system column \"%s\"", colName)));
+
+	/*
+	 * Check that column type is compressible, then get the attribute
+	 * compression method code
+	 */
+	cmethod = GetAttributeCompression(atttableform->atttypid, compression);
+
+	/* update pg_attribute entry */
+	atttableform->attcompression = cmethod;
+	CatalogTupleUpdate(attrel, &tuple->t_self, tuple);
+
+	InvokeObjectPostAlterHook(RelationRelationId,
+							  RelationGetRelid(rel),
+							  attnum);
+
+	heap_freetuple(tuple);
+
+	table_close(attrel, RowExclusiveLock);
+
+	/* make changes visible */
+	CommandCounterIncrement();
+
+	ObjectAddressSubSet(address, RelationRelationId,
+						RelationGetRelid(rel), attnum);
+	return address;
+}
+
+/*
+ * resolve column compression specification to compression method.
+ */
+static char
+GetAttributeCompression(Oid atttypid, const char *compression)
+{
+	char		cmethod;
+
+	if (compression == NULL || strcmp(compression, "default") == 0)
+		return InvalidCompressionMethod;
+
+	/*
+	 * To specify a nondefault method, the column data type must be toastable.
+	 * Note this says nothing about whether the column's attstorage setting
+	 * permits compression; attstorage and attcompression are independent.
+	 */
+	if (!TypeIsToastable(atttypid))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("column data type %s does not support compression",
+						format_type_be(atttypid))));
+
+	cmethod = CompressionNameToMethod(compression);
+	if (!CompressionMethodIsValid(cmethod))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid compression method \"%s\"", compression)));
+
+	return cmethod;
+}
+
 
 /*
  * ALTER TABLE DROP COLUMN
@@ -8469,6 +8685,12 @@ ATAddForeignKeyConstraint(List **wqueue, AlteredTableInfo *tab, Relation rel,
 						(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
 						 errmsg("constraints on temporary tables must involve temporary tables of this session")));
 			break;
+		case RELPERSISTENCE_GLOBAL_TEMP:
+			if (pkrel->rd_rel->relpersistence != RELPERSISTENCE_GLOBAL_TEMP)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+						 errmsg("constraints on global temporary tables may reference only global temporary tables")));
+			break;
 	}
 
 	/*
@@ -11552,6 +11774,21 @@ ATExecAlterColumnType(AlteredTableInfo *tab, Relation rel,
 								   colName)));
 				break;
 
+			case OCLASS_PUBLICATION_REL:
+
+				/*
+				 * A publication table can depend on a column used in its
+				 * WHERE clause.  As for policies, punt rather than rewrite
+				 * and recheck the expression.
+				 */
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("cannot alter type of a column used in a publication WHERE clause"),
+						 errdetail("%s depends on column \"%s\"",
+								   getObjectDescription(&foundObject, false),
+								   colName)));
+				break;
+
 			case OCLASS_DEFAULT:
 
 				/*
@@ -11600,7 +11837,6 @@ ATExecAlterColumnType(AlteredTableInfo *tab, Relation rel,
 			case OCLASS_EXTENSION:
 			case OCLASS_EVENT_TRIGGER:
 			case OCLASS_PUBLICATION:
-			case OCLASS_PUBLICATION_REL:
 			case OCLASS_SUBSCRIPTION:
 			case OCLASS_TRANSFORM:
 
@@ -11750,6 +11986,9 @@ ATExecAlterColumnType(AlteredTableInfo *tab, Relation rel,
 	attTup->attbyval = tform->typbyval;
 	attTup->attalign = tform->typalign;
 	attTup->attstorage = tform->typstorage;
+	/* a type that can't be compressed can't keep a compression method */
+	if (tform->typstorage == TYPSTORAGE_PLAIN)
+		attTup->attcompression = InvalidCompressionMethod;
 
 	ReleaseSysCache(typeTuple);
 
@@ -13213,6 +13452,13 @@ ATExecSetTableSpace(Oid tableOid, Oid newTableSpace, LOCKMODE lockmode)
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("cannot move temporary tables of other sessions")));
 
+	/* Other sessions' copies of a global temporary table can't be moved */
+	if (RelationIsGlobalTemp(rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot move global temporary relation \"%s\"",
+						RelationGetRelationName(rel))));
+
 	reltoastrelid = rel->rd_rel->reltoastrelid;
 	/* Fetch the list of indexes on toast relation if necessary */
 	if (OidIsValid(reltoastrelid))
@@ -13290,6 +13536,102 @@ ATExecSetTableSpace(Oid tableOid, Oid newTableSpace, LOCKMODE lockmode)
 	list_free(reltoastidxids);
 }
 
+/*
+ * Copy an unlogged heap, and its toast table, into new permanent relfilenodes
+ * without reconstructing any tuples.  This is the ALTER TABLE SET LOGGED
+ * counterpart of ATExecSetTableSpace(), and it moves the relation to
+ * newTableSpace along the way if that's valid.  The caller must rebuild the
+ * indexes afterwards.
+ */
+static void
+ATExecSetLoggedNoRewrite(Oid tableOid, Oid newTableSpace, LOCKMODE lockmode)
+{
+	Relation	rel;
+	Oid			reltoastrelid;
+	Oid			newrelfilenode;
+	RelFileNode newrnode;
+	SMgrRelation dstrel;
+	Relation	pg_class;
+	HeapTuple	tuple;
+	Form_pg_class rd_rel;
+
+	rel = relation_open(tableOid, lockmode);
+
+	Assert(rel->rd_rel->relpersistence == RELPERSISTENCE_UNLOGGED);
+	Assert(rel->rd_tableam == GetHeapamTableAmRoutine());
+
+	if (!OidIsValid(newTableSpace))
+		newTableSpace = rel->rd_node.spcNode;
+
+	/* Get a modifiable copy of the relation's pg_class row */
+	pg_class = table_open(RelationRelationId, RowExclusiveLock);
+
+	tuple = SearchSysCacheCopy1(RELOID, ObjectIdGetDatum(tableOid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for relation %u", tableOid);
+	rd_rel = (Form_pg_class) GETSTRUCT(tuple);
+
+	newrelfilenode = GetNewRelFileNode(newTableSpace, NULL,
+									   RELPERSISTENCE_PERMANENT);
+	newrnode = rel->rd_node;
+	newrnode.relNode = newrelfilenode;
+	newrnode.spcNode = newTableSpace;
+
+	dstrel = smgropen(newrnode, InvalidBackendId);
+	RelationOpenSmgr(rel);
+
+	/*
+	 * As in heapam_relation_copy_data(), flush the source's buffers first and
+	 * rely on our lock to keep anyone from dirtying new ones.  The copies are
+	 * made as a permanent relation, so RelationCopyStorage() WAL-logs them
+	 * when needed; the init fork is left behind.
+	 */
+	FlushRelationBuffers(rel);
+
+	RelationCreateStorage(newrnode, RELPERSISTENCE_PERMANENT);
+	RelationCopyStorage(rel->rd_smgr, dstrel, MAIN_FORKNUM,
+						RELPERSISTENCE_PERMANENT);
+
+	for (ForkNumber forkNum = MAIN_FORKNUM + 1;
+		 forkNum <= MAX_FORKNUM; forkNum++)
+	{
+		if (forkNum == INIT_FORKNUM || !smgrexists(rel->rd_smgr, forkNum))
+			continue;
+
+		smgrcreate(dstrel, forkNum, false);
+		log_smgrcreate(&newrnode, forkNum);
+		RelationCopyStorage(rel->rd_smgr, dstrel, forkNum,
+							RELPERSISTENCE_PERMANENT);
+	}
+
+	RelationDropStorage(rel);
+	smgrclose(dstrel);
+
+	rd_rel->reltablespace = (newTableSpace == MyDatabaseTableSpace) ?
+		InvalidOid : newTableSpace;
+	rd_rel->relfilenode = newrelfilenode;
+	rd_rel->relpersistence = RELPERSISTENCE_PERMANENT;
+	CatalogTupleUpdate(pg_class, &tuple->t_self, tuple);
+
+	InvokeObjectPostAlterHook(RelationRelationId, RelationGetRelid(rel), 0);
+
+	heap_freetuple(tuple);
+
+	table_close(pg_class, RowExclusiveLock);
+
+	reltoastrelid = rel->rd_rel->reltoastrelid;
+
+	RelationAssumeNewRelfilenode(rel);
+
+	relation_close(rel, NoLock);
+
+	/* Make sure the new relfilenode and persistence are visible */
+	CommandCounterIncrement();
+
+	if (OidIsValid(reltoastrelid))
+		ATExecSetLoggedNoRewrite(reltoastrelid, newTableSpace, lockmode);
+}
+
 /*
  * Special handling of ALTER TABLE SET TABLESPACE for relations with no
  * storage that have an interest in preserving tablespace.
@@ -13675,6 +14017,18 @@ ATExecAddInherit(Relation child_rel, RangeVar *parent, LOCKMODE lockmode)
 				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
 				 errmsg("cannot inherit to temporary relation of another session")));
 
+	/* Global temporary tables can't take part in inheritance at all */
+	if (parent_rel->rd_rel->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("cannot inherit from global temporary relation \"%s\"",
+						RelationGetRelationName(parent_rel))));
+	if (child_rel->rd_rel->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("global temporary relation \"%s\" cannot inherit",
+						RelationGetRelationName(child_rel))));
+
 	/* Prevent partitioned tables from becoming inheritance parents */
 	if (parent_rel->rd_rel->relkind == RELKIND_PARTITIONED_TABLE)
 		ereport(ERROR,
@@ -14956,6 +15310,7 @@ ATPrepChangePersistence(Relation rel, bool toLogged)
 	switch (rel->rd_rel->relpersistence)
 	{
 		case RELPERSISTENCE_TEMP:
+		case RELPERSISTENCE_GLOBAL_TEMP:
 			ereport(ERROR,
 					(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
 					 errmsg("cannot change logged status of table \"%s\" because it is temporary",
@@ -16463,6 +16818,13 @@ ATExecAttachPartition(List **wqueue, Relation rel, PartitionCmd *cmd,
 				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
 				 errmsg("cannot attach temporary relation of another session as partition")));
 
+	/* Global temporary tables can't be partitions */
+	if (attachrel->rd_rel->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("cannot attach global temporary relation \"%s\" as partition",
+						RelationGetRelationName(attachrel))));
+
 	/* Check if there are any columns in attachrel that aren't in the parent */
 	tupleDesc = RelationGetDescr(attachrel);
 	natts = tupleDesc->natts;
@@ -36,6 +36,7 @@
 #include "commands/trigger.h"
 #include "executor/executor.h"
 #include "executor/execPartition.h"
+#include "lib/ilist.h"
 #include "miscadmin.h"
 #include "nodes/bitmapset.h"
 #include "nodes/makefuncs.h"
@@ -48,6 +49,7 @@
 #include "partitioning/partdesc.h"
 #include "pgstat.h"
 #include "rewrite/rewriteManip.h"
+#include "storage/buffile.h"
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
 #include "tcop/utility.h"
@@ -66,6 +68,7 @@
 
 /* GUC variables */
 int			SessionReplicationRole = SESSION_REPLICATION_ROLE_ORIGIN;
+int			after_trigger_queue_mem = -1;
 
 /* How many levels deep into trigger execution are we? */
 static int	MyTriggerDepth = 0;
@@ -3368,35 +3371,49 @@ typedef struct AfterTriggerEventDataZeroCtids
 /*
  * To avoid palloc overhead, we keep trigger events in arrays in successively-
  * larger chunks (a slightly more sophisticated version of an expansible
- * array).  The space between CHUNK_DATA_START and freeptr is occupied by
- * AfterTriggerEventData records; the space between endfree and endptr is
- * occupied by AfterTriggerSharedData records.
+ * array).  The space between the start of the chunk's data and freeoff is
+ * occupied by AfterTriggerEventData records; the space between endfree and
+ * the end of the data is occupied by AfterTriggerSharedData records.
+ *
+ * The chunk headers are kept separately from the data, so that the data of
+ * chunks that aren't being looked at can be written out to a temporary file
+ * when the queue grows past after_trigger_queue_mem; see
+ * afterTriggerPinChunk().  The data is only addressable while the chunk is
+ * pinned, which is why the positions within it are kept as offsets.
  */
 typedef struct AfterTriggerEventChunk
 {
 	struct AfterTriggerEventChunk *next;	/* list link */
-	char	   *freeptr;		/* start of free space in chunk */
-	char	   *endfree;		/* end of free space in chunk */
-	char	   *endptr;			/* end of chunk */
-	/* event data follows here */
+	char	   *data;			/* chunk contents, or NULL if spilled */
+	Size		freeoff;		/* start of free space in chunk */
+	Size		endfree;		/* end of free space in chunk */
+	Size		size;			/* size of chunk contents */
+	long		spillblock;		/* location in spill file, or -1 if none */
+	int			pincount;		/* number of pins on data */
+	dlist_node	node;			/* link in afterTriggers.loaded_chunks */
 } AfterTriggerEventChunk;
 
-#define CHUNK_DATA_START(cptr) ((char *) (cptr) + MAXALIGN(sizeof(AfterTriggerEventChunk)))
+#define CHUNK_DATA_START(cptr) ((cptr)->data)
+#define CHUNK_FREEPTR(cptr) ((cptr)->data + (cptr)->freeoff)
 
 /* A list of events */
 typedef struct AfterTriggerEventList
 {
 	AfterTriggerEventChunk *head;
 	AfterTriggerEventChunk *tail;
-	char	   *tailfree;		/* freeptr of tail chunk */
+	Size		tailfree;		/* freeoff of tail chunk */
 } AfterTriggerEventList;
 
-/* Macros to help in iterating over a list of events */
+/*
+ * Macros to help in iterating over a list of events.  The current chunk is
+ * kept pinned; code that leaves a for_each_chunk loop early must unpin it.
+ */
 #define for_each_chunk(cptr, evtlist) \
-	for (cptr = (evtlist).head; cptr != NULL; cptr = cptr->next)
+	for (cptr = afterTriggerPinChunk((evtlist).head); cptr != NULL; \
+		 cptr = afterTriggerPinNextChunk(cptr))
 #define for_each_event(eptr, cptr) \
 	for (eptr = (AfterTriggerEvent) CHUNK_DATA_START(cptr); \
-		 (char *) eptr < (cptr)->freeptr; \
+		 (char *) eptr < CHUNK_FREEPTR(cptr); \
 		 eptr = (AfterTriggerEvent) (((char *) eptr) + SizeofTriggerEvent(eptr)))
 /* Use this if no special per-chunk processing is needed */
 #define for_each_event_chunk(eptr, cptr, evtlist) \
@@ -3404,10 +3421,11 @@ typedef struct AfterTriggerEventList
 
 /* Macros for iterating from a start point that might not be list start */
 #define for_each_chunk_from(cptr) \
-	for (; cptr != NULL; cptr = cptr->next)
+	for (cptr = afterTriggerPinChunk(cptr); cptr != NULL; \
+		 cptr = afterTriggerPinNextChunk(cptr))
 #define for_each_event_from(eptr, cptr) \
 	for (; \
-		 (char *) eptr < (cptr)->freeptr; \
+		 (char *) eptr < CHUNK_FREEPTR(cptr); \
 		 eptr = (AfterTriggerEvent) (((char *) eptr) + SizeofTriggerEvent(eptr)))
 
 
@@ -3431,6 +3449,11 @@ typedef struct AfterTriggerEventList
  * end of the list, so it is relatively easy to discard them.  The event
  * list chunks themselves are stored in event_cxt.
  *
+ * loaded_chunks lists the chunks of all event lists whose data is in memory,
+ * least recently used first, and loaded_size is the total size of their
+ * data.  When that exceeds after_trigger_queue_mem, the data of unpinned
+ * chunks is written to spill_file, which has room for spill_nblocks blocks.
+ *
  * query_depth is the current depth of nested AfterTriggerBeginQuery calls
  * (-1 when the stack is empty).
  *
@@ -3497,6 +3520,12 @@ typedef struct AfterTriggersData
 	AfterTriggerEventList events;	/* deferred-event list */
 	MemoryContext event_cxt;	/* memory context for events, if any */
 
+	/* memory accounting and spilling of event chunks: */
+	dlist_head	loaded_chunks;	/* chunks with data in memory, LRU first */
+	Size		loaded_size;	/* total size of their data */
+	BufFile    *spill_file;		/* temp file for spilled data, or NULL */
+	long		spill_nblocks;	/* number of blocks used in spill_file */
+
 	/* per-query-level data: */
 	AfterTriggersQueryData *query_stack;	/* array of structs shown below */
 	int			query_depth;	/* current index in above array */
@@ -3556,6 +3585,9 @@ static SetConstraintState SetConstraintStateCopy(SetConstraintState state);
 static SetConstraintState SetConstraintStateAddItem(SetConstraintState state,
 													Oid tgoid, bool tgisdeferred);
 static void cancel_prior_stmt_triggers(Oid relid, CmdType cmdType, int tgevent);
+static AfterTriggerEventChunk *afterTriggerPinChunk(AfterTriggerEventChunk *chunk);
+static AfterTriggerEventChunk *afterTriggerPinNextChunk(AfterTriggerEventChunk *chunk);
+static void afterTriggerUnpinChunk(AfterTriggerEventChunk *chunk);
 
 
 /*
@@ -3637,6 +3669,163 @@ afterTriggerCheckState(AfterTriggerShared evtshared)
 }
 
 
+/* ----------
+ * afterTriggerSpillChunk()
+ *
+ *	Write the data of an unpinned chunk out to the spill file, and release
+ *	its memory.
+ * ----------
+ */
+static void
+afterTriggerSpillChunk(AfterTriggerEventChunk *chunk)
+{
+	Assert(chunk->data != NULL && chunk->pincount == 0);
+
+	/* Create the spill file if we didn't already */
+	if (afterTriggers.spill_file == NULL)
+	{
+		MemoryContext oldcxt;
+		ResourceOwner oldowner;
+
+		/* it must survive until the end of the transaction */
+		oldcxt = MemoryContextSwitchTo(afterTriggers.event_cxt);
+		oldowner = CurrentResourceOwner;
+		CurrentResourceOwner = TopTransactionResourceOwner;
+		afterTriggers.spill_file = BufFileCreateTemp(false);
+		CurrentResourceOwner = oldowner;
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	/*
+	 * Each chunk gets its own range of blocks the first time it's spilled,
+	 * and is rewritten in place if it's loaded and spilled again.
+	 */
+	if (chunk->spillblock < 0)
+	{
+		chunk->spillblock = afterTriggers.spill_nblocks;
+		afterTriggers.spill_nblocks += (chunk->size + BLCKSZ - 1) / BLCKSZ;
+	}
+
+	if (BufFileSeekBlock(afterTriggers.spill_file, chunk->spillblock) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not seek in trigger event temporary file: %m")));
+	BufFileWrite(afterTriggers.spill_file, chunk->data, chunk->size);
+
+	dlist_delete(&chunk->node);
+	afterTriggers.loaded_size -= chunk->size;
+	pfree(chunk->data);
+	chunk->data = NULL;
+}
+
+/* ----------
+ * afterTriggerPinChunk()
+ *
+ *	Make sure that a chunk's data is in memory, and keep it there until
+ *	afterTriggerUnpinChunk() is called.  Returns the chunk, for the
+ *	convenience of the iteration macros; NULL is passed through.
+ *
+ *	Afterwards, spill the least recently used unpinned chunks if we're over
+ *	after_trigger_queue_mem.  Pins that are left behind by an error merely
+ *	keep the chunk in memory for the rest of the transaction.
+ * ----------
+ */
+static AfterTriggerEventChunk *
+afterTriggerPinChunk(AfterTriggerEventChunk *chunk)
+{
+	dlist_mutable_iter iter;
+
+	if (chunk == NULL)
+		return NULL;
+
+	if (chunk->data == NULL)
+	{
+		/* Read it back in */
+		chunk->data = MemoryContextAlloc(afterTriggers.event_cxt, chunk->size);
+		if (BufFileSeekBlock(afterTriggers.spill_file, chunk->spillblock) != 0 ||
+			BufFileRead(afterTriggers.spill_file,
+						chunk->data, chunk->size) != chunk->size)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from trigger event temporary file: %m")));
+		afterTriggers.loaded_size += chunk->size;
+	}
+	else
+		dlist_delete(&chunk->node);
+
+	/* It's now the most recently used chunk */
+	dlist_push_tail(&afterTriggers.loaded_chunks, &chunk->node);
+	chunk->pincount++;
+
+	if (after_trigger_queue_mem >= 0 &&
+		afterTriggers.loaded_size > (Size) after_trigger_queue_mem * 1024L)
+	{
+		dlist_foreach_modify(iter, &afterTriggers.loaded_chunks)
+		{
+			AfterTriggerEventChunk *victim;
+
+			victim = dlist_container(AfterTriggerEventChunk, node, iter.cur);
+			if (victim->pincount > 0)
+				continue;
+			afterTriggerSpillChunk(victim);
+			if (afterTriggers.loaded_size <=
+				(Size) after_trigger_queue_mem * 1024L)
+				break;
+		}
+	}
+
+	return chunk;
+}
+
+/* ----------
+ * afterTriggerUnpinChunk()
+ *
+ *	Release a pin taken by afterTriggerPinChunk().
+ * ----------
+ */
+static void
+afterTriggerUnpinChunk(AfterTriggerEventChunk *chunk)
+{
+	Assert(chunk->pincount > 0);
+	chunk->pincount--;
+}
+
+/* ----------
+ * afterTriggerPinNextChunk()
+ *
+ *	Move a pin from a chunk to its successor in the list, returning the
+ *	successor (or NULL at the end of the list).
+ * ----------
+ */
+static AfterTriggerEventChunk *
+afterTriggerPinNextChunk(AfterTriggerEventChunk *chunk)
+{
+	AfterTriggerEventChunk *next = afterTriggerPinChunk(chunk->next);
+
+	afterTriggerUnpinChunk(chunk);
+	return next;
+}
+
+/* ----------
+ * afterTriggerFreeChunk()
+ *
+ *	Release the memory of a chunk that has been removed from its list.
+ *	Its space in the spill file, if any, is not reused.
+ * ----------
+ */
+static void
+afterTriggerFreeChunk(AfterTriggerEventChunk *chunk)
+{
+	if (chunk->data != NULL)
+	{
+		dlist_delete(&chunk->node);
+		afterTriggers.loaded_size -= chunk->size;
+		pfree(chunk->data);
+	}
+	pfree(chunk);
+}
+
+
 /* ----------
  * afterTriggerAddEvent()
  *
@@ -3660,7 +3849,7 @@ afterTriggerAddEvent(AfterTriggerEventList *events,
 	 */
 	chunk = events->tail;
 	if (chunk == NULL ||
-		chunk->endfree - chunk->freeptr < needed)
+		chunk->endfree - chunk->freeoff < needed)
 	{
 		Size		chunksize;
 
@@ -3698,20 +3887,26 @@ afterTriggerAddEvent(AfterTriggerEventList *events,
 		else
 		{
 			/* preceding chunk size... */
-			chunksize = chunk->endptr - (char *) chunk;
+			chunksize = chunk->size;
 			/* check number of shared records in preceding chunk */
-			if ((chunk->endptr - chunk->endfree) <=
+			if ((chunk->size - chunk->endfree) <=
 				(100 * sizeof(AfterTriggerSharedData)))
 				chunksize *= 2; /* okay, double it */
 			else
 				chunksize /= 2; /* too many shared records */
 			chunksize = Min(chunksize, MAX_CHUNK_SIZE);
 		}
-		chunk = MemoryContextAlloc(afterTriggers.event_cxt, chunksize);
+		chunk = MemoryContextAlloc(afterTriggers.event_cxt,
+								   sizeof(AfterTriggerEventChunk));
 		chunk->next = NULL;
-		chunk->freeptr = CHUNK_DATA_START(chunk);
-		chunk->endptr = chunk->endfree = (char *) chunk + chunksize;
-		Assert(chunk->endfree - chunk->freeptr >= needed);
+		chunk->data = MemoryContextAlloc(afterTriggers.event_cxt, chunksize);
+		chunk->freeoff = 0;
+		chunk->size = chunk->endfree = chunksize;
+		chunk->spillblock = -1;
+		chunk->pincount = 0;
+		Assert(chunk->endfree - chunk->freeoff >= needed);
+		dlist_push_tail(&afterTriggers.loaded_chunks, &chunk->node);
+		afterTriggers.loaded_size += chunksize;
 
 		if (events->head == NULL)
 			events->head = chunk;
@@ -3721,12 +3916,15 @@ afterTriggerAddEvent(AfterTriggerEventList *events,
 		/* events->tailfree is now out of sync, but we'll fix it below */
 	}
 
+	/* The tail chunk might have been spilled, so bring it in */
+	afterTriggerPinChunk(chunk);
+
 	/*
 	 * Try to locate a matching shared-data record already in the chunk. If
 	 * none, make a new one.
 	 */
-	for (newshared = ((AfterTriggerShared) chunk->endptr) - 1;
-		 (char *) newshared >= chunk->endfree;
+	for (newshared = ((AfterTriggerShared) (chunk->data + chunk->size)) - 1;
+		 (char *) newshared >= chunk->data + chunk->endfree;
 		 newshared--)
 	{
 		if (newshared->ats_tgoid == evtshared->ats_tgoid &&
@@ -3736,22 +3934,24 @@ afterTriggerAddEvent(AfterTriggerEventList *events,
 			newshared->ats_firing_id == 0)
 			break;
 	}
-	if ((char *) newshared < chunk->endfree)
+	if ((char *) newshared < chunk->data + chunk->endfree)
 	{
 		*newshared = *evtshared;
 		newshared->ats_firing_id = 0;	/* just to be sure */
-		chunk->endfree = (char *) newshared;
+		chunk->endfree = (char *) newshared - chunk->data;
 	}
 
 	/* Insert the data */
-	newevent = (AfterTriggerEvent) chunk->freeptr;
+	newevent = (AfterTriggerEvent) CHUNK_FREEPTR(chunk);
 	memcpy(newevent, event, eventsize);
 	/* ... and link the new event to its shared record */
 	newevent->ate_flags &= ~AFTER_TRIGGER_OFFSET;
 	newevent->ate_flags |= (char *) newshared - (char *) newevent;
 
-	chunk->freeptr += eventsize;
-	events->tailfree = chunk->freeptr;
+	chunk->freeoff += eventsize;
+	events->tailfree = chunk->freeoff;
+
+	afterTriggerUnpinChunk(chunk);
 }
 
 /* ----------
@@ -3768,10 +3968,10 @@ afterTriggerFreeEventList(AfterTriggerEventList *events)
 	while ((chunk = events->head) != NULL)
 	{
 		events->head = chunk->next;
-		pfree(chunk);
+		afterTriggerFreeChunk(chunk);
 	}
 	events->tail = NULL;
-	events->tailfree = NULL;
+	events->tailfree = 0;
 }
 
 /* ----------
@@ -3800,11 +4000,11 @@ afterTriggerRestoreEventList(AfterTriggerEventList *events,
 		for (chunk = events->tail->next; chunk != NULL; chunk = next_chunk)
 		{
 			next_chunk = chunk->next;
-			pfree(chunk);
+			afterTriggerFreeChunk(chunk);
 		}
 		/* and clean up the tail chunk to be the right length */
 		events->tail->next = NULL;
-		events->tail->freeptr = events->tailfree;
+		events->tail->freeoff = events->tailfree;
 
 		/*
 		 * We don't make any effort to remove now-unused shared data records.
@@ -3843,13 +4043,13 @@ afterTriggerDeleteHeadEventChunk(AfterTriggersQueryData *qs)
 		{
 			table->after_trig_events.head = NULL;
 			table->after_trig_events.tail = NULL;
-			table->after_trig_events.tailfree = NULL;
+			table->after_trig_events.tailfree = 0;
 		}
 	}
 
 	/* Now we can flush the head chunk */
 	qs->events.head = target->next;
-	pfree(target);
+	afterTriggerFreeChunk(target);
 }
 
 
@@ -4272,8 +4472,8 @@ afterTriggerInvokeEvents(AfterTriggerEventList *events,
 		/* Clear the chunk if delete_ok and nothing left of interest */
 		if (delete_ok && all_fired_in_chunk)
 		{
-			chunk->freeptr = CHUNK_DATA_START(chunk);
-			chunk->endfree = chunk->endptr;
+			chunk->freeoff = 0;
+			chunk->endfree = chunk->size;
 
 			/*
 			 * If it's last chunk, must sync event list's tailfree too.  Note
@@ -4282,7 +4482,7 @@ afterTriggerInvokeEvents(AfterTriggerEventList *events,
 			 * list, since we'd fail to fix their copies of tailfree.
 			 */
 			if (chunk == events->tail)
-				events->tailfree = chunk->freeptr;
+				events->tailfree = chunk->freeoff;
 		}
 	}
 	if (slot1 != NULL)
@@ -4291,6 +4491,9 @@ afterTriggerInvokeEvents(AfterTriggerEventList *events,
 		ExecDropSingleTupleTableSlot(slot2);
 	}
 
+	/* Do any foreign key checks the triggers have batched up */
+	RI_FlushPendingChecks();
+
 	/* Release working resources */
 	MemoryContextDelete(per_tuple_context);
 
@@ -4485,6 +4688,8 @@ AfterTriggerBeginXact(void)
 	Assert(afterTriggers.maxquerydepth == 0);
 	Assert(afterTriggers.event_cxt == NULL);
 	Assert(afterTriggers.events.head == NULL);
+	Assert(afterTriggers.loaded_size == 0);
+	Assert(afterTriggers.spill_file == NULL);
 	Assert(afterTriggers.trans_stack == NULL);
 	Assert(afterTriggers.maxtransdepth == 0);
 }
@@ -4721,6 +4926,9 @@ AfterTriggerFireDeferred(void)
 void
 AfterTriggerEndXact(bool isCommit)
 {
+	/* Forget any batched foreign key checks */
+	RI_EndXactPendingChecks();
+
 	/*
 	 * Forget the pending-events list.
 	 *
@@ -4732,11 +4940,18 @@ AfterTriggerEndXact(bool isCommit)
 	 */
 	if (afterTriggers.event_cxt)
 	{
+		if (afterTriggers.spill_file)
+			BufFileClose(afterTriggers.spill_file);
+		afterTriggers.spill_file = NULL;
+		afterTriggers.spill_nblocks = 0;
+		dlist_init(&afterTriggers.loaded_chunks);
+		afterTriggers.loaded_size = 0;
+
 		MemoryContextDelete(afterTriggers.event_cxt);
 		afterTriggers.event_cxt = NULL;
 		afterTriggers.events.head = NULL;
 		afterTriggers.events.tail = NULL;
-		afterTriggers.events.tailfree = NULL;
+		afterTriggers.events.tailfree = 0;
 	}
 
 	/*
@@ -4823,6 +5038,9 @@ AfterTriggerEndSubXact(bool isCommit)
 	AfterTriggerEventChunk *chunk;
 	CommandId	subxact_firing_id;
 
+	/* Pass batched foreign key checks to the parent, or forget them */
+	RI_EndSubXactPendingChecks(isCommit);
+
 	/*
 	 * Pop the prior state if needed.
 	 */
@@ -4952,7 +5170,7 @@ AfterTriggerEnlargeQueryState(void)
 
 		qs->events.head = NULL;
 		qs->events.tail = NULL;
-		qs->events.tailfree = NULL;
+		qs->events.tailfree = 0;
 		qs->fdw_tuplestore = NULL;
 		qs->tables = NIL;
 
@@ -5374,7 +5592,10 @@ AfterTriggerPendingOnRel(Oid relid)
 			continue;
 
 		if (evtshared->ats_relid == relid)
+		{
+			afterTriggerUnpinChunk(chunk);
 			return true;
+		}
 	}
 
 	/*
@@ -5392,7 +5613,10 @@ AfterTriggerPendingOnRel(Oid relid)
 				continue;
 
 			if (evtshared->ats_relid == relid)
+			{
+				afterTriggerUnpinChunk(chunk);
 				return true;
+			}
 		}
 	}
 
@@ -5827,22 +6051,22 @@ cancel_prior_stmt_triggers(Oid relid, CmdType cmdType, int tgevent)
 		 */
 		AfterTriggerEvent event;
 		AfterTriggerEventChunk *chunk;
+		Size		startoff;
 
 		if (table->after_trig_events.tail)
 		{
 			chunk = table->after_trig_events.tail;
-			event = (AfterTriggerEvent) table->after_trig_events.tailfree;
+			startoff = table->after_trig_events.tailfree;
 		}
 		else
 		{
 			chunk = qs->events.head;
-			event = NULL;
+			startoff = 0;
 		}
 
 		for_each_chunk_from(chunk)
 		{
-			if (event == NULL)
-				event = (AfterTriggerEvent) CHUNK_DATA_START(chunk);
+			event = (AfterTriggerEvent) (CHUNK_DATA_START(chunk) + startoff);
 			for_each_event_from(event, chunk)
 			{
 				AfterTriggerShared evtshared = GetTriggerSharedData(event);
@@ -5851,20 +6075,20 @@ cancel_prior_stmt_triggers(Oid relid, CmdType cmdType, int tgevent)
 				 * Exit loop when we reach events that aren't AS triggers for
 				 * the target relation.
 				 */
-				if (evtshared->ats_relid != relid)
-					goto done;
-				if ((evtshared->ats_event & TRIGGER_EVENT_OPMASK) != tgevent)
-					goto done;
-				if (!TRIGGER_FIRED_FOR_STATEMENT(evtshared->ats_event))
-					goto done;
-				if (!TRIGGER_FIRED_AFTER(evtshared->ats_event))
+				if (evtshared->ats_relid != relid ||
+					(evtshared->ats_event & TRIGGER_EVENT_OPMASK) != tgevent ||
+					!TRIGGER_FIRED_FOR_STATEMENT(evtshared->ats_event) ||
+					!TRIGGER_FIRED_AFTER(evtshared->ats_event))
+				{
+					afterTriggerUnpinChunk(chunk);
 					goto done;
+				}
 				/* OK, mark it DONE */
 				event->ate_flags &= ~AFTER_TRIGGER_IN_PROGRESS;
 				event->ate_flags |= AFTER_TRIGGER_DONE;
 			}
-			/* signal we must reinitialize event ptr for next chunk */
-			event = NULL;
+			/* later chunks must be scanned from their start */
+			startoff = 0;
 		}
 	}
 done:
@@ -62,6 +62,7 @@ int			vacuum_freeze_min_age;
 int			vacuum_freeze_table_age;
 int			vacuum_multixact_freeze_min_age;
 int			vacuum_multixact_freeze_table_age;
+bool		vacuum_eager_freeze;
 
 
 /* A few variables that don't seem worth passing around as parameters */
@@ -242,6 +243,9 @@ ExecVacuum(ParseState *pstate, VacuumStmt *vacstmt, bool isTopLevel)
 	/* user-invoked vacuum is never "for wraparound" */
 	params.is_wraparound = false;
 
+	/* we don't know how the table is used without looking at the stats */
+	params.insert_mostly = false;
+
 	/* user-invoked vacuum never uses this parameter */
 	params.log_min_duration = -1;
 
@@ -1234,6 +1238,13 @@ vac_update_relstats(Relation relation,
 	Form_pg_class pgcform;
 	bool		dirty;
 
+	/*
+	 * A global temporary table's size and XID horizon differ between
+	 * sessions, so there's nothing meaningful to store in pg_class.
+	 */
+	if (RelationIsGlobalTemp(relation))
+		return;
+
 	rd = table_open(RelationRelationId, RowExclusiveLock);
 
 	/* Fetch a copy of the tuple to scribble on */
@@ -1827,6 +1838,21 @@ vacuum_rel(Oid relid, RangeVar *relation, VacuumParams *params)
 		return false;
 	}
 
+	/*
+	 * VACUUM FULL would have to rewrite every session's copy of a global
+	 * temporary table; a plain VACUUM processes just this session's.
+	 */
+	if ((params->options & VACOPT_FULL) && RelationIsGlobalTemp(onerel))
+	{
+		ereport(WARNING,
+				(errmsg("skipping \"%s\" --- cannot VACUUM FULL global temporary tables",
+						RelationGetRelationName(onerel))));
+		relation_close(onerel, lmode);
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+		return false;
+	}
+
 	/*
 	 * Silently ignore partitioned tables as there is no work to be done.  The
 	 * useful work is on their child partitions, which have been queued up for
@@ -62,6 +62,7 @@
 #include "executor/execExpr.h"
 #include "executor/nodeSubplan.h"
 #include "funcapi.h"
+#include "jit/jit.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
 #include "parser/parsetree.h"
@@ -138,6 +139,51 @@ static ExprEvalOpLookup reverse_dispatch_table[EEOP_LAST];
 	} while (0)
 
 
+/*
+ * Hash table of the elements of a constant array, for
+ * EEOP_HASHED_SCALARARRAYOP.
+ */
+typedef struct ScalarArrayOpExprHashEntry
+{
+	Datum		key;
+	uint32		status;			/* hash status */
+	uint32		hash;			/* hash value (cached) */
+} ScalarArrayOpExprHashEntry;
+
+#define SH_PREFIX saophash
+#define SH_ELEMENT_TYPE ScalarArrayOpExprHashEntry
+#define SH_KEY_TYPE Datum
+#define SH_SCOPE static inline
+#define SH_DECLARE
+#include "lib/simplehash.h"
+
+static bool saop_hash_element_match(struct saophash_hash *tb, Datum key1,
+									Datum key2);
+static uint32 saop_element_hash(struct saophash_hash *tb, Datum key);
+
+typedef struct ScalarArrayOpExprHashTable
+{
+	saophash_hash *hashtab;		/* underlying hash table */
+	/* copied from the step, for quick access from the callbacks: */
+	FunctionCallInfo fcinfo;	/* comparison function's args */
+	PGFunction	fn_addr;		/* comparison function's address */
+	FunctionCallInfo hash_fcinfo;	/* hash function's args */
+	PGFunction	hash_fn_addr;	/* hash function's address */
+} ScalarArrayOpExprHashTable;
+
+#define SH_PREFIX saophash
+#define SH_ELEMENT_TYPE ScalarArrayOpExprHashEntry
+#define SH_KEY_TYPE Datum
+#define SH_KEY key
+#define SH_HASH_KEY(tb, key) saop_element_hash(tb, key)
+#define SH_EQUAL(tb, a, b) saop_hash_element_match(tb, a, b)
+#define SH_SCOPE static inline
+#define SH_STORE_HASH
+#define SH_GET_HASH(tb, a) a->hash
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
+
 static Datum ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull);
 static void ExecInitInterpreter(void);
 
@@ -150,6 +196,8 @@ static void ShutdownTupleDescRef(Datum arg);
 static void ExecEvalRowNullInt(ExprState *state, ExprEvalStep *op,
 							   ExprContext *econtext, bool checkisnull);
 
+static Datum ExecInterpExprDeferJit(ExprState *state, ExprContext *econtext, bool *isNull);
+
 /* fast-path evaluation functions */
 static Datum ExecJustInnerVar(ExprState *state, ExprContext *econtext, bool *isnull);
 static Datum ExecJustOuterVar(ExprState *state, ExprContext *econtext, bool *isnull);
@@ -264,7 +312,8 @@ ExecReadyInterpretedExpr(ExprState *state)
 			return;
 		}
 		else if (step0 == EEOP_CASE_TESTVAL &&
-				 step1 == EEOP_FUNCEXPR_STRICT &&
+				 (step1 == EEOP_FUNCEXPR_STRICT ||
+				  step1 == EEOP_FUNCEXPR_STRICT_1) &&
 				 state->steps[0].d.casetest.value)
 		{
 			state->evalfunc_private = (void *) ExecJustApplyFuncToCase;
@@ -374,6 +423,8 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 		&&CASE_EEOP_CONST,
 		&&CASE_EEOP_FUNCEXPR,
 		&&CASE_EEOP_FUNCEXPR_STRICT,
+		&&CASE_EEOP_FUNCEXPR_STRICT_1,
+		&&CASE_EEOP_FUNCEXPR_STRICT_2,
 		&&CASE_EEOP_FUNCEXPR_FUSAGE,
 		&&CASE_EEOP_FUNCEXPR_STRICT_FUSAGE,
 		&&CASE_EEOP_BOOL_AND_STEP_FIRST,
@@ -426,6 +477,7 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 		&&CASE_EEOP_DOMAIN_CHECK,
 		&&CASE_EEOP_CONVERT_ROWTYPE,
 		&&CASE_EEOP_SCALARARRAYOP,
+		&&CASE_EEOP_HASHED_SCALARARRAYOP,
 		&&CASE_EEOP_XMLEXPR,
 		&&CASE_EEOP_AGGREF,
 		&&CASE_EEOP_GROUPING_FUNC,
@@ -703,6 +755,54 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 			EEO_NEXT();
 		}
 
+		/* strict function call with one argument */
+		EEO_CASE(EEOP_FUNCEXPR_STRICT_1)
+		{
+			FunctionCallInfo fcinfo = op->d.func.fcinfo_data;
+			NullableDatum *args = fcinfo->args;
+
+			Assert(op->d.func.nargs == 1);
+
+			/* strict function, so check for NULL args */
+			if (args[0].isnull)
+				*op->resnull = true;
+			else
+			{
+				Datum		d;
+
+				fcinfo->isnull = false;
+				d = op->d.func.fn_addr(fcinfo);
+				*op->resvalue = d;
+				*op->resnull = fcinfo->isnull;
+			}
+
+			EEO_NEXT();
+		}
+
+		/* strict function call with two arguments, e.g. most operators */
+		EEO_CASE(EEOP_FUNCEXPR_STRICT_2)
+		{
+			FunctionCallInfo fcinfo = op->d.func.fcinfo_data;
+			NullableDatum *args = fcinfo->args;
+
+			Assert(op->d.func.nargs == 2);
+
+			/* strict function, so check for NULL args */
+			if (args[0].isnull || args[1].isnull)
+				*op->resnull = true;
+			else
+			{
+				Datum		d;
+
+				fcinfo->isnull = false;
+				d = op->d.func.fn_addr(fcinfo);
+				*op->resvalue = d;
+				*op->resnull = fcinfo->isnull;
+			}
+
+			EEO_NEXT();
+		}
+
 		EEO_CASE(EEOP_FUNCEXPR_FUSAGE)
 		{
 			/* not common enough to inline */
@@ -1464,6 +1564,14 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 			EEO_NEXT();
 		}
 
+		EEO_CASE(EEOP_HASHED_SCALARARRAYOP)
+		{
+			/* too complex for an inline implementation */
+			ExecEvalHashedScalarArrayOp(state, op, econtext);
+
+			EEO_NEXT();
+		}
+
 		EEO_CASE(EEOP_DOMAIN_NOTNULL)
 		{
 			/* too complex for an inline implementation */
@@ -1793,6 +1901,62 @@ ExecInterpExprStillValid(ExprState *state, ExprContext *econtext, bool *isNull)
 	return state->evalfunc(state, econtext, isNull);
 }
 
+/*
+ * Prepare ExprState for interpreted execution, JIT compiling it once it has
+ * been evaluated jit_defer_evaluations times.  This avoids paying for JIT
+ * compilation of expressions that turn out to be evaluated only a few
+ * times, e.g. because the planner overestimated row counts.
+ *
+ * Expressions handled by one of the fast-path evalfuncs are cheap to
+ * interpret and aren't worth compiling, so they're left alone.
+ */
+void
+ExecReadyInterpretedExprDeferJit(ExprState *state)
+{
+	Assert(jit_defer_evaluations > 0);
+
+	ExecReadyInterpretedExpr(state);
+
+	if (state->evalfunc_private == (void *) ExecInterpExpr)
+	{
+		state->jit_deferred_evals = 0;
+		state->evalfunc = ExecInterpExprDeferJit;
+	}
+}
+
+/*
+ * Expression evaluation callback used while JIT compilation is deferred.
+ */
+static Datum
+ExecInterpExprDeferJit(ExprState *state, ExprContext *econtext, bool *isNull)
+{
+	/* same as ExecInterpExprStillValid(), for the first evaluation */
+	if (state->jit_deferred_evals == 0)
+		CheckExprStillValid(state, econtext);
+
+	if (++state->jit_deferred_evals >= jit_defer_evaluations)
+	{
+		MemoryContext oldcontext;
+		bool		compiled;
+
+		/*
+		 * The compiled expression has to live as long as the ExprState, not
+		 * just for the current evaluation.
+		 */
+		oldcontext = MemoryContextSwitchTo(state->parent->state->es_query_cxt);
+		compiled = jit_compile_expr(state);
+		MemoryContextSwitchTo(oldcontext);
+
+		/* if compilation isn't possible, just keep interpreting */
+		if (!compiled)
+			state->evalfunc = (ExprStateEvalFunc) state->evalfunc_private;
+
+		return state->evalfunc(state, econtext, isNull);
+	}
+
+	return ExecInterpExpr(state, econtext, isNull);
+}
+
 /*
  * Check that an expression is still valid in the face of potential schema
  * changes since the plan has been created.
@@ -3567,6 +3731,171 @@ ExecEvalScalarArrayOp(ExprState *state, ExprEvalStep *op)
 	*op->resnull = resultnull;
 }
 
+/*
+ * Hash function for elements of a hashed ScalarArrayOpExpr.
+ */
+static uint32
+saop_element_hash(struct saophash_hash *tb, Datum key)
+{
+	ScalarArrayOpExprHashTable *elements_tab =
+	(ScalarArrayOpExprHashTable *) tb->private_data;
+	FunctionCallInfo fcinfo = elements_tab->hash_fcinfo;
+
+	fcinfo->args[0].value = key;
+	fcinfo->args[0].isnull = false;
+	fcinfo->isnull = false;
+
+	return DatumGetUInt32(elements_tab->hash_fn_addr(fcinfo));
+}
+
+/*
+ * Match function for elements of a hashed ScalarArrayOpExpr, using the
+ * expression's comparison function.
+ */
+static bool
+saop_hash_element_match(struct saophash_hash *tb, Datum key1, Datum key2)
+{
+	ScalarArrayOpExprHashTable *elements_tab =
+	(ScalarArrayOpExprHashTable *) tb->private_data;
+	FunctionCallInfo fcinfo = elements_tab->fcinfo;
+	Datum		result;
+
+	fcinfo->args[0].value = key1;
+	fcinfo->args[0].isnull = false;
+	fcinfo->args[1].value = key2;
+	fcinfo->args[1].isnull = false;
+	fcinfo->isnull = false;
+
+	result = elements_tab->fn_addr(fcinfo);
+
+	return !fcinfo->isnull && DatumGetBool(result);
+}
+
+/*
+ * Evaluate "scalar op ANY (const array)" with a hash table of the array
+ * elements, which is built on the first call.
+ *
+ * Source array is in our result area, scalar arg is already evaluated into
+ * fcinfo->args[0].
+ *
+ * The comparison function is strict (see ExecInitExprRec), so a NULL scalar
+ * yields NULL, and so does a failed lookup if the array contains NULLs.
+ */
+void
+ExecEvalHashedScalarArrayOp(ExprState *state, ExprEvalStep *op,
+							ExprContext *econtext)
+{
+	ScalarArrayOpExprHashTable *elements_tab =
+	op->d.hashedscalararrayop.elements_tab;
+	FunctionCallInfo fcinfo = op->d.hashedscalararrayop.fcinfo_data;
+	Datum		scalar = fcinfo->args[0].value;
+
+	/* If the array is NULL then we return NULL, as in the linear case */
+	if (*op->resnull)
+		return;
+
+	if (fcinfo->args[0].isnull)
+	{
+		*op->resnull = true;
+		return;
+	}
+
+	/* Build the hash table on first evaluation */
+	if (elements_tab == NULL)
+	{
+		MemoryContext oldcontext;
+		ArrayType  *arr;
+		int			nitems;
+		int16		typlen;
+		bool		typbyval;
+		char		typalign;
+		bool		has_nulls = false;
+		char	   *s;
+		bits8	   *bitmap;
+		int			bitmask;
+
+		/*
+		 * The table, and the detoasted array whose elements it points to,
+		 * must live as long as the expression.
+		 */
+		oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_query_memory);
+
+		arr = DatumGetArrayTypeP(*op->resvalue);
+		nitems = ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr));
+		get_typlenbyvalalign(ARR_ELEMTYPE(arr), &typlen, &typbyval, &typalign);
+
+		elements_tab = (ScalarArrayOpExprHashTable *)
+			palloc(sizeof(ScalarArrayOpExprHashTable));
+		elements_tab->fcinfo = fcinfo;
+		elements_tab->fn_addr = op->d.hashedscalararrayop.finfo->fn_addr;
+		elements_tab->hash_fcinfo = op->d.hashedscalararrayop.hash_fcinfo_data;
+		elements_tab->hash_fn_addr =
+			elements_tab->hash_fcinfo->flinfo->fn_addr;
+
+		/*
+		 * Size the table for the number of elements.  If the array contains
+		 * many duplicates, that'll just make the table a bit roomy.
+		 */
+		elements_tab->hashtab = saophash_create(CurrentMemoryContext, nitems,
+												elements_tab);
+
+		MemoryContextSwitchTo(oldcontext);
+
+		s = (char *) ARR_DATA_PTR(arr);
+		bitmap = ARR_NULLBITMAP(arr);
+		bitmask = 1;
+
+		for (int i = 0; i < nitems; i++)
+		{
+			/* Get array element, checking for NULL */
+			if (bitmap && (*bitmap & bitmask) == 0)
+				has_nulls = true;
+			else
+			{
+				Datum		elt;
+				bool		found;
+
+				elt = fetch_att(s, typbyval, typlen);
+				s = att_addlength_pointer(s, typlen, s);
+				s = (char *) att_align_nominal(s, typalign);
+
+				saophash_insert(elements_tab->hashtab, elt, &found);
+			}
+
+			/* advance bitmap pointer if any */
+			if (bitmap)
+			{
+				bitmask <<= 1;
+				if (bitmask == 0x100)
+				{
+					bitmap++;
+					bitmask = 1;
+				}
+			}
+		}
+
+		op->d.hashedscalararrayop.has_nulls = has_nulls;
+		op->d.hashedscalararrayop.elements_tab = elements_tab;
+	}
+
+	if (saophash_lookup(elements_tab->hashtab, scalar) != NULL)
+	{
+		*op->resvalue = BoolGetDatum(true);
+		*op->resnull = false;
+	}
+	else if (op->d.hashedscalararrayop.has_nulls)
+	{
+		/* no match, but the operator would have returned NULL for a NULL */
+		*op->resvalue = (Datum) 0;
+		*op->resnull = true;
+	}
+	else
+	{
+		*op->resvalue = BoolGetDatum(false);
+		*op->resnull = false;
+	}
+}
+
 /*
  * Evaluate a NOT NULL domain constraint.
  */
@@ -264,9 +264,13 @@ ExecCloseIndices(ResultRelInfo *resultRelInfo)
  *		If 'arbiterIndexes' is nonempty, noDupErr applies only to
  *		those indexes.  NIL means noDupErr applies to all indexes.
  *
- *		CAUTION: this must not be called for a HOT update.
- *		We can't defend against that here for lack of info.
- *		Should we change the API to make it safer?
+ *		If 'onlySummarizing' is true, only summarizing indexes are
+ *		updated, as required after a HOT update that changed columns
+ *		of such indexes (TU_Summarizing).
+ *
+ *		CAUTION: this must not be called for a HOT update, except with
+ *		onlySummarizing.  We can't defend against that here for lack of
+ *		info.  Should we change the API to make it safer?
  * ----------------------------------------------------------------
  */
 List *
@@ -275,7 +279,8 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 					  EState *estate,
 					  bool noDupErr,
 					  bool *specConflict,
-					  List *arbiterIndexes)
+					  List *arbiterIndexes,
+					  bool onlySummarizing)
 {
 	ItemPointer tupleid = &slot->tts_tid;
 	List	   *result = NIL;
@@ -324,6 +329,10 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 		if (indexRelation == NULL)
 			continue;
 
+		/* After a HOT update, only summarizing indexes need the tuple */
+		if (onlySummarizing && !indexRelation->rd_indam->amsummarizing)
+			continue;
+
 		indexInfo = indexInfoArray[i];
 
 		/* If the index is marked as read-only, ignore it */
@@ -54,6 +54,7 @@
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "parser/parsetree.h"
+#include "pgstat.h"
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
 #include "tcop/utility.h"
@@ -99,6 +100,7 @@ static char *ExecBuildSlotValueDescription(Oid reloid,
 										   Bitmapset *modifiedCols,
 										   int maxfieldlen);
 static void EvalPlanQualStart(EPQState *epqstate, Plan *planTree);
+static int	ExecSetQueryWorkMem(QueryDesc *queryDesc);
 
 /*
  * Note that GetAllUpdatedColumns() also exists in commands/trigger.c.  There does
@@ -142,10 +144,23 @@ static void EvalPlanQualStart(EPQState *epqstate, Plan *planTree);
 void
 ExecutorStart(QueryDesc *queryDesc, int eflags)
 {
-	if (ExecutorStart_hook)
-		(*ExecutorStart_hook) (queryDesc, eflags);
-	else
-		standard_ExecutorStart(queryDesc, eflags);
+	int			save_work_mem = ExecSetQueryWorkMem(queryDesc);
+
+	/* Let the wait event sampler attribute our waits to this statement */
+	pgstat_report_query_id(queryDesc->plannedstmt->queryId);
+
+	PG_TRY();
+	{
+		if (ExecutorStart_hook)
+			(*ExecutorStart_hook) (queryDesc, eflags);
+		else
+			standard_ExecutorStart(queryDesc, eflags);
+	}
+	PG_FINALLY();
+	{
+		work_mem = save_work_mem;
+	}
+	PG_END_TRY();
 }
 
 void
@@ -302,10 +317,20 @@ ExecutorRun(QueryDesc *queryDesc,
 			ScanDirection direction, uint64 count,
 			bool execute_once)
 {
-	if (ExecutorRun_hook)
-		(*ExecutorRun_hook) (queryDesc, direction, count, execute_once);
-	else
-		standard_ExecutorRun(queryDesc, direction, count, execute_once);
+	int			save_work_mem = ExecSetQueryWorkMem(queryDesc);
+
+	PG_TRY();
+	{
+		if (ExecutorRun_hook)
+			(*ExecutorRun_hook) (queryDesc, direction, count, execute_once);
+		else
+			standard_ExecutorRun(queryDesc, direction, count, execute_once);
+	}
+	PG_FINALLY();
+	{
+		work_mem = save_work_mem;
+	}
+	PG_END_TRY();
 }
 
 void
@@ -401,10 +426,20 @@ standard_ExecutorRun(QueryDesc *queryDesc,
 void
 ExecutorFinish(QueryDesc *queryDesc)
 {
-	if (ExecutorFinish_hook)
-		(*ExecutorFinish_hook) (queryDesc);
-	else
-		standard_ExecutorFinish(queryDesc);
+	int			save_work_mem = ExecSetQueryWorkMem(queryDesc);
+
+	PG_TRY();
+	{
+		if (ExecutorFinish_hook)
+			(*ExecutorFinish_hook) (queryDesc);
+		else
+			standard_ExecutorFinish(queryDesc);
+	}
+	PG_FINALLY();
+	{
+		work_mem = save_work_mem;
+	}
+	PG_END_TRY();
 }
 
 void
@@ -446,6 +481,30 @@ standard_ExecutorFinish(QueryDesc *queryDesc)
 	estate->es_finished = true;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSetQueryWorkMem
+ *
+ *		If the planner divided query_work_mem among the nodes of this
+ *		plan, lower work_mem to the per-node share for the duration of
+ *		the current executor call.  Every node that sizes its memory
+ *		from work_mem or hash_mem (including those in parallel workers,
+ *		which inherit the setting) then stays within the query's budget.
+ *		Returns the previous work_mem, which the caller must restore.
+ * ----------------------------------------------------------------
+ */
+static int
+ExecSetQueryWorkMem(QueryDesc *queryDesc)
+{
+	int			save_work_mem = work_mem;
+	PlannedStmt *plannedstmt = queryDesc->plannedstmt;
+
+	if (plannedstmt != NULL && plannedstmt->workMem > 0 &&
+		plannedstmt->workMem < work_mem)
+		work_mem = plannedstmt->workMem;
+
+	return save_work_mem;
+}
+
 /* ----------------------------------------------------------------
  *		ExecutorEnd
  *
@@ -1233,6 +1292,11 @@ InitResultRelInfo(ResultRelInfo *resultRelInfo,
 	/* The following fields are set later if needed */
 	resultRelInfo->ri_FdwState = NULL;
 	resultRelInfo->ri_usesFdwDirectModify = false;
+	resultRelInfo->ri_NumSlots = 0;
+	resultRelInfo->ri_NumSlotsInitialized = 0;
+	resultRelInfo->ri_BatchSize = 0;
+	resultRelInfo->ri_Slots = NULL;
+	resultRelInfo->ri_PlanSlots = NULL;
 	resultRelInfo->ri_ConstraintExprs = NULL;
 	resultRelInfo->ri_GeneratedExprs = NULL;
 	resultRelInfo->ri_junkFilter = NULL;
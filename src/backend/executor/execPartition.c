@@ -133,6 +133,21 @@ struct PartitionTupleRouting
  *		routing it through this table). A NULL value is stored if no tuple
  *		conversion is required.
  *
+ * last_found_datum_index
+ *		Index into the partition bound's datums array of the bound that
+ *		matched the last tuple routed through this table, or -1 if none.
+ *		Used only for LIST and RANGE partitioned tables.
+ *
+ * last_found_part_index
+ *		Partition index (into partdesc->oids) that the last routed tuple was
+ *		found to belong to, or -1 if none.
+ *
+ * last_found_count
+ *		Number of consecutive tuples that have been routed to the partition
+ *		at last_found_part_index.  Once this reaches
+ *		PARTITION_CACHED_FIND_THRESHOLD, get_partition_for_tuple() checks the
+ *		cached bound before falling back to a binary search.
+ *
  * indexes
  *		Array of partdesc->nparts elements.  For leaf partitions the index
  *		corresponds to the partition's ResultRelInfo in the encapsulating
@@ -150,9 +165,22 @@ typedef struct PartitionDispatchData
 	PartitionDesc partdesc;
 	TupleTableSlot *tupslot;
 	AttrMap    *tupmap;
+	int			last_found_datum_index;
+	int			last_found_part_index;
+	int			last_found_count;
 	int			indexes[FLEXIBLE_ARRAY_MEMBER];
 }			PartitionDispatchData;
 
+/*
+ * Number of times the same partition must be found in a row before we start
+ * checking the cached bound ahead of doing a binary search.  Bulk loads
+ * commonly route long runs of tuples into the same partition, so this allows
+ * us to skip the binary search for those, while keeping the overhead of a
+ * failed cache check low for workloads whose tuples jump around between
+ * partitions.
+ */
+#define PARTITION_CACHED_FIND_THRESHOLD	16
+
 /* struct to hold result relations coming from UPDATE subplans */
 typedef struct SubplanResultRelHashElem
 {
@@ -994,6 +1022,24 @@ ExecInitRoutingInfo(ModifyTableState *mtstate,
 		partRelInfo->ri_FdwRoutine->BeginForeignInsert != NULL)
 		partRelInfo->ri_FdwRoutine->BeginForeignInsert(mtstate, partRelInfo);
 
+	/*
+	 * Determine if the FDW supports batch insert and determine the batch
+	 * size (a FDW may support batching, but it may be disabled for the
+	 * server/table or for this particular query).
+	 *
+	 * If the FDW does not support batching, we set the batch size to 1.
+	 */
+	if (mtstate->operation == CMD_INSERT &&
+		partRelInfo->ri_FdwRoutine != NULL &&
+		partRelInfo->ri_FdwRoutine->GetForeignModifyBatchSize &&
+		partRelInfo->ri_FdwRoutine->ExecForeignBatchInsert)
+		partRelInfo->ri_BatchSize =
+			partRelInfo->ri_FdwRoutine->GetForeignModifyBatchSize(partRelInfo);
+	else
+		partRelInfo->ri_BatchSize = 1;
+
+	Assert(partRelInfo->ri_BatchSize >= 1);
+
 	partRelInfo->ri_CopyMultiInsertBuffer = NULL;
 
 	/*
@@ -1070,6 +1116,9 @@ ExecInitPartitionDispatchInfo(EState *estate,
 	pd->key = RelationGetPartitionKey(rel);
 	pd->keystate = NIL;
 	pd->partdesc = partdesc;
+	pd->last_found_datum_index = -1;
+	pd->last_found_part_index = -1;
+	pd->last_found_count = 0;
 	if (parent_pd != NULL)
 	{
 		TupleDesc	tupdesc = RelationGetDescr(rel);
@@ -1191,6 +1240,7 @@ ExecCleanupTupleRouting(ModifyTableState *mtstate,
 	for (i = 0; i < proute->num_partitions; i++)
 	{
 		ResultRelInfo *resultRelInfo = proute->partitions[i];
+		int			j;
 
 		/* Allow any FDWs to shut down */
 		if (resultRelInfo->ri_FdwRoutine != NULL &&
@@ -1198,6 +1248,13 @@ ExecCleanupTupleRouting(ModifyTableState *mtstate,
 			resultRelInfo->ri_FdwRoutine->EndForeignInsert(mtstate->ps.state,
 														   resultRelInfo);
 
+		/* Release the batch slots of foreign partitions, if any */
+		for (j = 0; j < resultRelInfo->ri_NumSlotsInitialized; j++)
+		{
+			ExecDropSingleTupleTableSlot(resultRelInfo->ri_Slots[j]);
+			ExecDropSingleTupleTableSlot(resultRelInfo->ri_PlanSlots[j]);
+		}
+
 		/*
 		 * Check if this result rel is one belonging to the node's subplans,
 		 * if so, let ExecEndPlan() clean it up.
@@ -1292,11 +1349,17 @@ FormPartitionKeyDatum(PartitionDispatch pd,
  *
  * Return value is index of the partition (>= 0 and < partdesc->nparts) if one
  * found or -1 if none found.
+ *
+ * For LIST and RANGE partitioned tables, we remember the bound that the last
+ * tuple matched.  Once the same partition has been found
+ * PARTITION_CACHED_FIND_THRESHOLD times in a row, we check whether the new
+ * tuple also fits that bound before resorting to a binary search.  Hash
+ * partitioning needs no such cache, as its lookup is already O(1).
  */
 static int
 get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 {
-	int			bound_offset;
+	int			bound_offset = -1;
 	int			part_index = -1;
 	PartitionKey key = pd->key;
 	PartitionDesc partdesc = pd->partdesc;
@@ -1316,20 +1379,44 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 													   key->partcollation,
 													   values, isnull);
 
+				/* No need to bother with the cache fields for hashing */
 				part_index = boundinfo->indexes[rowHash % greatest_modulus];
+				if (part_index < 0)
+					part_index = boundinfo->default_index;
+				return part_index;
 			}
-			break;
 
 		case PARTITION_STRATEGY_LIST:
 			if (isnull[0])
 			{
+				/* This is far from the hot path; don't bother caching it. */
 				if (partition_bound_accepts_nulls(boundinfo))
-					part_index = boundinfo->null_index;
+				{
+					pd->last_found_count = 0;
+					return boundinfo->null_index;
+				}
 			}
 			else
 			{
 				bool		equal = false;
 
+				if (pd->last_found_count >= PARTITION_CACHED_FIND_THRESHOLD)
+				{
+					int			last_datum_offset = pd->last_found_datum_index;
+					Datum		lastDatum = boundinfo->datums[last_datum_offset][0];
+					int32		cmpval;
+
+					/* Does the last found datum match this one? */
+					cmpval = DatumGetInt32(FunctionCall2Coll(&key->partsupfunc[0],
+															 key->partcollation[0],
+															 lastDatum,
+															 values[0]));
+					if (cmpval == 0)
+						return pd->last_found_part_index;
+
+					/* Otherwise, fall through and do a binary search */
+				}
+
 				bound_offset = partition_list_bsearch(key->partsupfunc,
 													  key->partcollation,
 													  boundinfo,
@@ -1358,23 +1445,53 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 					}
 				}
 
-				if (!range_partkey_has_null)
+				if (range_partkey_has_null)
+					break;
+
+				if (pd->last_found_count >= PARTITION_CACHED_FIND_THRESHOLD)
 				{
-					bound_offset = partition_range_datum_bsearch(key->partsupfunc,
-																 key->partcollation,
-																 boundinfo,
-																 key->partnatts,
-																 values,
-																 &equal);
+					int			last_datum_offset = pd->last_found_datum_index;
+					int32		cmpval;
+
+					/* Is the value >= the lower bound of the last partition? */
+					cmpval = partition_rbound_datum_cmp(key->partsupfunc,
+														key->partcollation,
+														boundinfo->datums[last_datum_offset],
+														boundinfo->kind[last_datum_offset],
+														values,
+														key->partnatts);
 
 					/*
-					 * The bound at bound_offset is less than or equal to the
-					 * tuple value, so the bound at offset+1 is the upper
-					 * bound of the partition we're looking for, if there
-					 * actually exists one.
+					 * If so, and it's also below the upper bound, the tuple
+					 * belongs in the same partition as last time.
 					 */
-					part_index = boundinfo->indexes[bound_offset + 1];
+					if (cmpval <= 0 &&
+						last_datum_offset + 1 < boundinfo->ndatums &&
+						partition_rbound_datum_cmp(key->partsupfunc,
+												   key->partcollation,
+												   boundinfo->datums[last_datum_offset + 1],
+												   boundinfo->kind[last_datum_offset + 1],
+												   values,
+												   key->partnatts) > 0)
+						return pd->last_found_part_index;
+
+					/* Otherwise, fall through and do a binary search */
 				}
+
+				bound_offset = partition_range_datum_bsearch(key->partsupfunc,
+															 key->partcollation,
+															 boundinfo,
+															 key->partnatts,
+															 values,
+															 &equal);
+
+				/*
+				 * The bound at bound_offset is less than or equal to the
+				 * tuple value, so the bound at offset+1 is the upper bound of
+				 * the partition we're looking for, if there actually exists
+				 * one.
+				 */
+				part_index = boundinfo->indexes[bound_offset + 1];
 			}
 			break;
 
@@ -1385,10 +1502,27 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 
 	/*
 	 * part_index < 0 means we failed to find a partition of this parent. Use
-	 * the default partition, if there is one.
+	 * the default partition, if there is one.  We leave the cache fields
+	 * alone here; the next tuple may well belong to the cached partition
+	 * again.
 	 */
 	if (part_index < 0)
-		part_index = boundinfo->default_index;
+		return boundinfo->default_index;
+
+	/*
+	 * If we found the same bound as last time, bump the count so that we'll
+	 * eventually start checking the cached bound first.  Otherwise, remember
+	 * this bound and start counting again.
+	 */
+	Assert(bound_offset >= 0);
+	if (bound_offset == pd->last_found_datum_index)
+		pd->last_found_count++;
+	else
+	{
+		pd->last_found_count = 1;
+		pd->last_found_part_index = part_index;
+		pd->last_found_datum_index = bound_offset;
+	}
 
 	return part_index;
 }
@@ -17,6 +17,12 @@
 
 #include "executor/instrument.h"
 
+/* GUC parameter */
+int			timing_clock_source = TIMING_CLOCK_SOURCE_AUTO;
+
+/* sampling interval for INSTRUMENT_TIMER_SAMPLED; set by extensions */
+int			instr_timer_sample_interval = 1;
+
 BufferUsage pgBufferUsage;
 static BufferUsage save_pgBufferUsage;
 WalUsage	pgWalUsage;
@@ -26,6 +32,40 @@ static void BufferUsageAdd(BufferUsage *dst, const BufferUsage *add);
 static void WalUsageAdd(WalUsage *dst, WalUsage *add);
 
 
+/*
+ * Set up the clock used by INSTR_TIME_SET_CURRENT_FAST() according to
+ * timing_clock_source.  Called once by the postmaster, or by a standalone
+ * backend, after reading the configuration file; child processes inherit
+ * the result.
+ */
+void
+InstrInitClockSource(void)
+{
+	if (timing_clock_source == TIMING_CLOCK_SOURCE_SYSTEM)
+		return;
+
+	if (pg_cycle_counter_initialize(timing_clock_source ==
+									TIMING_CLOCK_SOURCE_CYCLE_COUNTER))
+		elog(DEBUG1, "using CPU cycle counter for timing, frequency %.3f MHz",
+			 1000.0 / pg_cycle_counter_ns_per_cycle);
+	else
+		elog(DEBUG1, "using system clock for timing");
+}
+
+/*
+ * Sampling interval to use for the given instrument_options: full timing
+ * wins if both kinds of timing are requested.
+ */
+static inline int
+InstrSampleInterval(int instrument_options)
+{
+	if ((instrument_options & INSTRUMENT_TIMER) == 0 &&
+		(instrument_options & INSTRUMENT_TIMER_SAMPLED) != 0 &&
+		instr_timer_sample_interval > 1)
+		return instr_timer_sample_interval;
+	return 0;
+}
+
 /* Allocate new instrumentation structure(s) */
 Instrumentation *
 InstrAlloc(int n, int instrument_options)
@@ -34,11 +74,14 @@ InstrAlloc(int n, int instrument_options)
 
 	/* initialize all fields to zeroes, then modify as needed */
 	instr = palloc0(n * sizeof(Instrumentation));
-	if (instrument_options & (INSTRUMENT_BUFFERS | INSTRUMENT_TIMER | INSTRUMENT_WAL))
+	if (instrument_options & (INSTRUMENT_BUFFERS | INSTRUMENT_TIMER |
+							  INSTRUMENT_TIMER_SAMPLED | INSTRUMENT_WAL))
 	{
 		bool		need_buffers = (instrument_options & INSTRUMENT_BUFFERS) != 0;
 		bool		need_wal = (instrument_options & INSTRUMENT_WAL) != 0;
-		bool		need_timer = (instrument_options & INSTRUMENT_TIMER) != 0;
+		bool		need_timer = (instrument_options & (INSTRUMENT_TIMER |
+													   INSTRUMENT_TIMER_SAMPLED)) != 0;
+		int			sample_interval = InstrSampleInterval(instrument_options);
 		int			i;
 
 		for (i = 0; i < n; i++)
@@ -46,6 +89,7 @@ InstrAlloc(int n, int instrument_options)
 			instr[i].need_bufusage = need_buffers;
 			instr[i].need_walusage = need_wal;
 			instr[i].need_timer = need_timer;
+			instr[i].sample_interval = sample_interval;
 		}
 	}
 
@@ -59,16 +103,31 @@ InstrInit(Instrumentation *instr, int instrument_options)
 	memset(instr, 0, sizeof(Instrumentation));
 	instr->need_bufusage = (instrument_options & INSTRUMENT_BUFFERS) != 0;
 	instr->need_walusage = (instrument_options & INSTRUMENT_WAL) != 0;
-	instr->need_timer = (instrument_options & INSTRUMENT_TIMER) != 0;
+	instr->need_timer = (instrument_options & (INSTRUMENT_TIMER |
+											   INSTRUMENT_TIMER_SAMPLED)) != 0;
+	instr->sample_interval = InstrSampleInterval(instrument_options);
 }
 
-/* Entry to a plan node */
+/*
+ * Entry to a plan node
+ *
+ * With a sample_interval, only the first call of each cycle and every
+ * sample_interval'th call after it are timed; InstrEndLoop extrapolates the
+ * rest.
+ */
 void
 InstrStartNode(Instrumentation *instr)
 {
-	if (instr->need_timer &&
-		!INSTR_TIME_SET_CURRENT_LAZY(instr->starttime))
-		elog(ERROR, "InstrStartNode called twice in a row");
+	if (instr->need_timer)
+	{
+		bool		sampled = true;
+
+		if (instr->sample_interval > 1)
+			sampled = (instr->ncalls++ % instr->sample_interval) == 0;
+
+		if (sampled && !INSTR_TIME_SET_CURRENT_FAST_LAZY(instr->starttime))
+			elog(ERROR, "InstrStartNode called twice in a row");
+	}
 
 	/* save buffer usage totals at node entry, if needed */
 	if (instr->need_bufusage)
@@ -90,13 +149,16 @@ InstrStopNode(Instrumentation *instr, double nTuples)
 	/* let's update the time only if the timer was requested */
 	if (instr->need_timer)
 	{
-		if (INSTR_TIME_IS_ZERO(instr->starttime))
-			elog(ERROR, "InstrStopNode called without start");
-
-		INSTR_TIME_SET_CURRENT(endtime);
-		INSTR_TIME_ACCUM_DIFF(instr->counter, endtime, instr->starttime);
+		if (!INSTR_TIME_IS_ZERO(instr->starttime))
+		{
+			INSTR_TIME_SET_CURRENT_FAST(endtime);
+			INSTR_TIME_ACCUM_DIFF(instr->counter, endtime, instr->starttime);
 
-		INSTR_TIME_SET_ZERO(instr->starttime);
+			INSTR_TIME_SET_ZERO(instr->starttime);
+			instr->nsampled++;
+		}
+		else if (instr->sample_interval <= 1)
+			elog(ERROR, "InstrStopNode called without start");
 	}
 
 	/* Add delta of buffer usage since entry to node's totals */
@@ -116,6 +178,14 @@ InstrStopNode(Instrumentation *instr, double nTuples)
 	}
 }
 
+/* Update tuple count */
+void
+InstrUpdateTupleCount(Instrumentation *instr, double nTuples)
+{
+	/* count the returned tuples */
+	instr->tuplecount += nTuples;
+}
+
 /* Finish a run cycle for a plan node */
 void
 InstrEndLoop(Instrumentation *instr)
@@ -132,6 +202,16 @@ InstrEndLoop(Instrumentation *instr)
 	/* Accumulate per-cycle statistics into totals */
 	totaltime = INSTR_TIME_GET_DOUBLE(instr->counter);
 
+	/*
+	 * If only some calls were timed, scale up the time of the calls after
+	 * the first one.  The first call is always timed, and is kept apart
+	 * because it usually includes the node's startup work.
+	 */
+	if (instr->nsampled > 1 && instr->ncalls > instr->nsampled)
+		totaltime = instr->firsttuple +
+			(totaltime - instr->firsttuple) *
+			(double) (instr->ncalls - 1) / (double) (instr->nsampled - 1);
+
 	instr->startup += instr->firsttuple;
 	instr->total += totaltime;
 	instr->ntuples += instr->tuplecount;
@@ -143,6 +223,8 @@ InstrEndLoop(Instrumentation *instr)
 	INSTR_TIME_SET_ZERO(instr->counter);
 	instr->firsttuple = 0;
 	instr->tuplecount = 0;
+	instr->ncalls = 0;
+	instr->nsampled = 0;
 }
 
 /* aggregate instrumentation information */
@@ -160,6 +242,8 @@ InstrAggNode(Instrumentation *dst, Instrumentation *add)
 	INSTR_TIME_ADD(dst->counter, add->counter);
 
 	dst->tuplecount += add->tuplecount;
+	dst->ncalls += add->ncalls;
+	dst->nsampled += add->nsampled;
 	dst->startup += add->startup;
 	dst->total += add->total;
 	dst->ntuples += add->ntuples;
@@ -167,6 +251,7 @@ InstrAggNode(Instrumentation *dst, Instrumentation *add)
 	dst->nloops += add->nloops;
 	dst->nfiltered1 += add->nfiltered1;
 	dst->nfiltered2 += add->nfiltered2;
+	dst->nfiltered3 += add->nfiltered3;
 
 	/* Add delta of buffer usage since entry to node's totals */
 	if (dst->need_bufusage)
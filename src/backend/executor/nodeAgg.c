@@ -217,6 +217,15 @@
  *	  imposing a limit on the number of groups separately from the amount of
  *	  memory consumed.
  *
+ *	  Partial aggregation (for instance in a parallel worker, below a
+ *	  Finalize Aggregate) needn't spill at all: it is fine for the same group
+ *	  to be emitted more than once, since the node above combines the partial
+ *	  states anyway.  So when a plain hashed partial aggregate hits the limit
+ *	  while reading its input, it instead emits the groups it has, empties
+ *	  the hash table and carries on reading.  With many distinct keys, where
+ *	  partial aggregation barely reduces the number of rows, that saves
+ *	  writing nearly all of the input to disk and reading it back.
+ *
  *    Transition / Combine function invocation:
  *
  *    For performance reasons transition functions, including combine
@@ -438,6 +447,7 @@ static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table_in_memory(AggState *aggstate);
 static void hash_agg_check_limits(AggState *aggstate);
 static void hash_agg_enter_spill_mode(AggState *aggstate);
+static void hash_agg_reset_tables(AggState *aggstate);
 static void hash_agg_update_metrics(AggState *aggstate, bool from_tape,
 									int npartitions);
 static void hashagg_finish_initial_spills(AggState *aggstate);
@@ -1848,6 +1858,15 @@ hash_agg_check_limits(AggState *aggstate)
 	Size		hashkey_mem = MemoryContextMemAllocated(aggstate->hashcontext->ecxt_per_tuple_memory,
 														true);
 
+	/*
+	 * ResetTupleHashTable() keeps the bucket arrays at the size they grew to,
+	 * so when emitting early, a table that has just been emptied would
+	 * otherwise be over the limit again after its first group.  Only count
+	 * what was allocated since then.
+	 */
+	if (aggstate->hash_emit_early)
+		meta_mem -= Min(meta_mem, aggstate->hash_emit_base_mem);
+
 	/*
 	 * Don't spill unless there's at least one group in the hash table so we
 	 * can be sure to make progress even in edge cases.
@@ -1856,7 +1875,10 @@ hash_agg_check_limits(AggState *aggstate)
 		(meta_mem + hashkey_mem > aggstate->hash_mem_limit ||
 		 ngroups > aggstate->hash_ngroups_limit))
 	{
-		hash_agg_enter_spill_mode(aggstate);
+		if (aggstate->hash_emit_early && !aggstate->table_filled)
+			aggstate->hash_emit_pending = true;
+		else
+			hash_agg_enter_spill_mode(aggstate);
 	}
 }
 
@@ -1894,6 +1916,26 @@ hash_agg_enter_spill_mode(AggState *aggstate)
 	}
 }
 
+/*
+ * Free the groups in all hash tables, leaving them empty but ready for use.
+ */
+static void
+hash_agg_reset_tables(AggState *aggstate)
+{
+	/* there could be residual pergroup pointers; clear them */
+	for (int setoff = 0;
+		 setoff < aggstate->maxsets + aggstate->num_hashes;
+		 setoff++)
+		aggstate->all_pergroups[setoff] = NULL;
+
+	/* free memory and reset hash tables */
+	ReScanExprContext(aggstate->hashcontext);
+	for (int setno = 0; setno < aggstate->num_hashes; setno++)
+		ResetTupleHashTable(aggstate->perhash[setno].hashtable);
+
+	aggstate->hash_ngroups_current = 0;
+}
+
 /*
  * Update metrics after filling the hash table.
  *
@@ -2519,6 +2561,10 @@ agg_retrieve_direct(AggState *aggstate)
 
 /*
  * ExecAgg for hashed case: read input and build hash table
+ *
+ * If the hash table fills up and we may emit groups early (see
+ * hash_agg_check_limits()), we stop short of the end of the input, and are
+ * called again once the groups read so far have been returned.
  */
 static void
 agg_fill_hash_table(AggState *aggstate)
@@ -2526,11 +2572,13 @@ agg_fill_hash_table(AggState *aggstate)
 	TupleTableSlot *outerslot;
 	ExprContext *tmpcontext = aggstate->tmpcontext;
 
+	aggstate->table_filled = false;
+
 	/*
 	 * Process each outer-plan tuple, and then fetch the next one, until we
-	 * exhaust the outer plan.
+	 * exhaust the outer plan or fill the hash table.
 	 */
-	for (;;)
+	while (!aggstate->hash_emit_pending)
 	{
 		outerslot = fetch_input_tuple(aggstate);
 		if (TupIsNull(outerslot))
@@ -2593,18 +2641,7 @@ agg_refill_hash_table(AggState *aggstate)
 						batch->used_bits, &aggstate->hash_mem_limit,
 						&aggstate->hash_ngroups_limit, NULL);
 
-	/* there could be residual pergroup pointers; clear them */
-	for (int setoff = 0;
-		 setoff < aggstate->maxsets + aggstate->num_hashes;
-		 setoff++)
-		aggstate->all_pergroups[setoff] = NULL;
-
-	/* free memory and reset hash tables */
-	ReScanExprContext(aggstate->hashcontext);
-	for (int setno = 0; setno < aggstate->num_hashes; setno++)
-		ResetTupleHashTable(aggstate->perhash[setno].hashtable);
-
-	aggstate->hash_ngroups_current = 0;
+	hash_agg_reset_tables(aggstate);
 
 	/*
 	 * In AGG_MIXED mode, hash aggregation happens in phase 1 and the output
@@ -2731,7 +2768,17 @@ agg_retrieve_hash_table(AggState *aggstate)
 		result = agg_retrieve_hash_table_in_memory(aggstate);
 		if (result == NULL)
 		{
-			if (!agg_refill_hash_table(aggstate))
+			if (aggstate->hash_emit_pending)
+			{
+				/* all groups emitted; start over with the rest of the input */
+				hash_agg_reset_tables(aggstate);
+				aggstate->hash_emit_base_mem =
+					MemoryContextMemAllocated(aggstate->hash_metacxt, true);
+				aggstate->hash_emit_pending = false;
+				aggstate->hash_batches_used++;
+				agg_fill_hash_table(aggstate);
+			}
+			else if (!agg_refill_hash_table(aggstate))
 			{
 				aggstate->agg_done = true;
 				break;
@@ -3678,6 +3725,17 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 
 		/* Initialize this to 1, meaning nothing spilled, yet */
 		aggstate->hash_batches_used = 1;
+
+		/*
+		 * A partial aggregate may emit a group more than once, so it needn't
+		 * spill.  Grouping sets are not supported here, and AGG_MIXED needs
+		 * all of its input before it can switch to hashing anyway.
+		 */
+		aggstate->hash_emit_early = (node->aggstrategy == AGG_HASHED &&
+									 DO_AGGSPLIT_SKIPFINAL(node->aggsplit) &&
+									 aggstate->num_hashes == 1);
+		aggstate->hash_emit_pending = false;
+		aggstate->hash_emit_base_mem = 0;
 	}
 
 	/*
@@ -4512,6 +4570,8 @@ ExecReScanAgg(AggState *node)
 
 		node->hash_ever_spilled = false;
 		node->hash_spill_mode = false;
+		node->hash_emit_pending = false;
+		node->hash_emit_base_mem = 0;
 		node->hash_ngroups_current = 0;
 
 		ReScanExprContext(node->hashcontext);
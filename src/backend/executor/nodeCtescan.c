@@ -18,8 +18,28 @@
 #include "executor/execdebug.h"
 #include "executor/nodeCtescan.h"
 #include "miscadmin.h"
+#include "storage/sharedfileset.h"
+#include "utils/sharedtuplestore.h"
+
+/*
+ * Shared state of a parallel-aware CteScan, in the DSM segment.
+ *
+ * When the parallel query starts, the leader copies all the CTE's rows into
+ * a shared tuplestore.  Then all participants read them with a parallel
+ * scan, so that each row is returned by exactly one of them.  The CTE query
+ * itself only ever runs in the leader.  Workers don't have its plan, so we
+ * also store the descriptor of the rows, flattened, after the tuplestore.
+ */
+struct ParallelCteScanState
+{
+	SharedFileSet fileset;		/* space for the shared tuplestore's files */
+	Size		tupdesc_offset; /* offset of the TupleDesc from the start */
+	char		sts[FLEXIBLE_ARRAY_MEMBER]; /* the SharedTuplestore */
+};
 
 static TupleTableSlot *CteScanNext(CteScanState *node);
+static TupleTableSlot *CteScanNextParallel(CteScanState *node);
+static Size CteScanTupleDescOffset(int nparticipants);
 
 /* ----------------------------------------------------------------
  *		CteScanNext
@@ -37,6 +57,10 @@ CteScanNext(CteScanState *node)
 	bool		eof_tuplestore;
 	TupleTableSlot *slot;
 
+	/* Parallel scans read from the shared tuplestore instead */
+	if (node->pstate != NULL)
+		return CteScanNextParallel(node);
+
 	/*
 	 * get state info from node
 	 */
@@ -138,6 +162,34 @@ CteScanNext(CteScanState *node)
 	return ExecClearTuple(slot);
 }
 
+/* ----------------------------------------------------------------
+ *		CteScanNextParallel
+ *
+ *		Fetch the next row of a parallel scan from the shared tuplestore.
+ *		Parallel scans only go forward.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+CteScanNextParallel(CteScanState *node)
+{
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	MinimalTuple tuple;
+
+	Assert(ScanDirectionIsForward(node->ss.ps.state->es_direction));
+
+	if (!node->sts_scanning)
+	{
+		sts_begin_parallel_scan(node->sts_accessor);
+		node->sts_scanning = true;
+	}
+
+	tuple = sts_parallel_scan_next(node->sts_accessor, NULL);
+	if (tuple == NULL)
+		return ExecClearTuple(slot);
+
+	return ExecStoreMinimalTuple(tuple, slot, false);
+}
+
 /*
  * CteScanRecheck -- access method routine to recheck a tuple in EvalPlanQual
  */
@@ -210,6 +262,34 @@ ExecInitCteScan(CteScan *node, EState *estate, int eflags)
 	scanstate->eflags = eflags;
 	scanstate->cte_table = NULL;
 	scanstate->eof_cte = false;
+	scanstate->pstate = NULL;
+	scanstate->sts_accessor = NULL;
+	scanstate->sts_scanning = false;
+
+	/*
+	 * A parallel-aware scan in a worker only reads the rows the leader has
+	 * put in shared memory.  The CTE query's plan may not even be available
+	 * here, so don't look for it, and leave the scan tuple descriptor and
+	 * the projection to ExecCteScanInitializeWorker().
+	 */
+	if (IsParallelWorker() && node->scan.plan.parallel_aware)
+	{
+		scanstate->leader = scanstate;
+
+		ExecAssignExprContext(estate, &scanstate->ss.ps);
+		ExecInitScanTupleSlot(estate, &scanstate->ss, NULL,
+							  &TTSOpsMinimalTuple);
+		ExecInitResultTypeTL(&scanstate->ss.ps);
+
+		/* signal that return type is not yet known */
+		scanstate->ss.ps.resultopsset = true;
+		scanstate->ss.ps.resultopsfixed = false;
+
+		scanstate->ss.ps.qual =
+			ExecInitQual(node->scan.plan.qual, (PlanState *) scanstate);
+
+		return scanstate;
+	}
 
 	/*
 	 * Find the already-initialized plan for the CTE query.
@@ -299,10 +379,13 @@ ExecEndCteScan(CteScanState *node)
 		ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
 	ExecClearTuple(node->ss.ss_ScanTupleSlot);
 
+	if (node->sts_scanning)
+		sts_end_parallel_scan(node->sts_accessor);
+
 	/*
 	 * If I am the leader, free the tuplestore.
 	 */
-	if (node->leader == node)
+	if (node->leader == node && node->cte_table != NULL)
 	{
 		tuplestore_end(node->cte_table);
 		node->cte_table = NULL;
@@ -325,6 +408,19 @@ ExecReScanCteScan(CteScanState *node)
 
 	ExecScanReScan(&node->ss);
 
+	/*
+	 * A parallel scan starts over once ExecCteScanReInitializeDSM() has
+	 * reset the shared tuplestore.  Its contents stay valid, since we only
+	 * share CTEs that don't depend on any parameters.
+	 */
+	if (node->pstate != NULL)
+	{
+		if (node->sts_scanning)
+			sts_end_parallel_scan(node->sts_accessor);
+		node->sts_scanning = false;
+		return;
+	}
+
 	/*
 	 * Clear the tuplestore if a new scan of the underlying CTE is required.
 	 * This implicitly resets all the tuplestore's read pointers.  Note that
@@ -349,3 +445,135 @@ ExecReScanCteScan(CteScanState *node)
 		tuplestore_rescan(tuplestorestate);
 	}
 }
+
+/* ----------------------------------------------------------------
+ *						Parallel Scan Support
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Offset of the flattened TupleDesc within ParallelCteScanState.
+ */
+static Size
+CteScanTupleDescOffset(int nparticipants)
+{
+	return MAXALIGN(add_size(offsetof(ParallelCteScanState, sts),
+							 sts_estimate(nparticipants)));
+}
+
+/* ----------------------------------------------------------------
+ *		ExecCteScanEstimate
+ *
+ *		Compute the amount of space we'll need in the parallel
+ *		query DSM, and inform pcxt->estimator about our needs.
+ * ----------------------------------------------------------------
+ */
+void
+ExecCteScanEstimate(CteScanState *node, ParallelContext *pcxt)
+{
+	TupleDesc	tupdesc = node->ss.ss_ScanTupleSlot->tts_tupleDescriptor;
+
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   add_size(CteScanTupleDescOffset(pcxt->nworkers + 1),
+									TupleDescSize(tupdesc)));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecCteScanInitializeDSM
+ *
+ *		Set up the shared tuplestore, and fill it with all the rows of
+ *		the CTE, running the CTE query to completion if necessary.
+ * ----------------------------------------------------------------
+ */
+void
+ExecCteScanInitializeDSM(CteScanState *node, ParallelContext *pcxt)
+{
+	int			nparticipants = pcxt->nworkers + 1;
+	TupleDesc	tupdesc = node->ss.ss_ScanTupleSlot->tts_tupleDescriptor;
+	ParallelCteScanState *pstate;
+	Size		tupdesc_offset;
+	TupleTableSlot *slot;
+
+	tupdesc_offset = CteScanTupleDescOffset(nparticipants);
+	pstate = shm_toc_allocate(pcxt->toc,
+							  add_size(tupdesc_offset,
+									   TupleDescSize(tupdesc)));
+	SharedFileSetInit(&pstate->fileset, pcxt->seg);
+	pstate->tupdesc_offset = tupdesc_offset;
+	TupleDescCopy((TupleDesc) ((char *) pstate + tupdesc_offset), tupdesc);
+
+	node->sts_accessor = sts_initialize((SharedTuplestore *) pstate->sts,
+										nparticipants,
+										ParallelWorkerNumber + 1,
+										0,
+										0,
+										&pstate->fileset,
+										"cte");
+
+	/*
+	 * Copy the CTE's rows, reading them through our own tuplestore read
+	 * pointer like a non-parallel scan would.  Afterwards, rewind that
+	 * pointer, in case we're later run without workers again.
+	 */
+	while (!TupIsNull(slot = CteScanNext(node)))
+	{
+		bool		shouldFree;
+		MinimalTuple tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+
+		sts_puttuple(node->sts_accessor, NULL, tuple);
+		if (shouldFree)
+			pfree(tuple);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+	sts_end_write(node->sts_accessor);
+
+	tuplestore_select_read_pointer(node->leader->cte_table, node->readptr);
+	tuplestore_rescan(node->leader->cte_table);
+
+	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pstate);
+	node->pstate = pstate;
+	node->sts_scanning = false;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecCteScanReInitializeDSM
+ *
+ *		Reset shared state before beginning a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecCteScanReInitializeDSM(CteScanState *node, ParallelContext *pcxt)
+{
+	sts_reinitialize(node->sts_accessor);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecCteScanInitializeWorker
+ *
+ *		Attach to the shared tuplestore, and finish the initialization
+ *		that ExecInitCteScan() left undone.
+ * ----------------------------------------------------------------
+ */
+void
+ExecCteScanInitializeWorker(CteScanState *node,
+							ParallelWorkerContext *pwcxt)
+{
+	ParallelCteScanState *pstate;
+	TupleDesc	tupdesc;
+
+	pstate = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, false);
+	SharedFileSetAttach(&pstate->fileset, pwcxt->seg);
+
+	tupdesc = CreateTupleDescCopy((TupleDesc) ((char *) pstate +
+											   pstate->tupdesc_offset));
+	ExecSetSlotDescriptor(node->ss.ss_ScanTupleSlot, tupdesc);
+	ExecAssignScanProjectionInfo(&node->ss);
+
+	node->sts_accessor = sts_attach((SharedTuplestore *) pstate->sts,
+									ParallelWorkerNumber + 1,
+									&pstate->fileset);
+	node->pstate = pstate;
+	node->sts_scanning = false;
+}
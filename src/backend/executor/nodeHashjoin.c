@@ -82,6 +82,7 @@
  *  PHJ_BATCH_ALLOCATING     -- one allocates buckets
  *  PHJ_BATCH_LOADING        -- all load the hash table from disk
  *  PHJ_BATCH_PROBING        -- all probe
+ *  PHJ_BATCH_SCAN           -- one does full/right unmatched scan
  *  PHJ_BATCH_DONE           -- end
  *
  * Batch 0 is a special case, because it starts out in phase
@@ -99,7 +100,11 @@
  * while attached to a barrier, unless the barrier has reached its final
  * state.  In the slightly special case of the per-batch barrier, we return
  * tuples while in PHJ_BATCH_PROBING phase, but that's OK because we use
- * BarrierArriveAndDetach() to advance it to PHJ_BATCH_DONE without waiting.
+ * BarrierArriveAndDetachExceptLast() to advance it to PHJ_BATCH_SCAN without
+ * waiting.  Only the last participant to finish probing stays attached and
+ * emits the unmatched inner tuples of a full or right join, since by then
+ * every match bit has been set; the others move on to other batches.  It
+ * then advances the barrier to PHJ_BATCH_DONE with BarrierArriveAndDetach().
  *
  *-------------------------------------------------------------------------
  */
@@ -112,6 +117,7 @@
 #include "executor/hashjoin.h"
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
+#include "lib/bloomfilter.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "utils/memutils.h"
@@ -133,6 +139,20 @@
 /* Returns true if doing null-fill on inner relation */
 #define HJ_FILL_INNER(hjstate)	((hjstate)->hj_NullOuterTupleSlot != NULL)
 
+/*
+ * A Bloom filter of the inner hash values is only built if the outer side is
+ * expected to have at least this many rows, as creating one costs at least
+ * a 1MB allocation.  If after HJ_BLOOM_CHECK_PROBES outer tuples fewer than
+ * a HJ_BLOOM_MIN_REJECT fraction of them have been rejected, the filter is
+ * not worth checking and probing stops.
+ */
+#define HJ_BLOOM_MIN_OUTER_ROWS	10000
+#define HJ_BLOOM_CHECK_PROBES	4096
+#define HJ_BLOOM_MIN_REJECT		0.1
+
+/* GUC parameter */
+bool		enable_hashjoin_bloom_filter = true;
+
 static TupleTableSlot *ExecHashJoinOuterGetTuple(PlanState *outerNode,
 												 HashJoinState *hjstate,
 												 uint32 *hashvalue);
@@ -282,6 +302,25 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 												HJ_FILL_INNER(node));
 				node->hj_HashTable = hashtable;
 
+				/*
+				 * If requested, have the Hash node also build a Bloom filter
+				 * of the inner hash values, so that outer tuples without a
+				 * possible match can be discarded cheaply.
+				 */
+				if (node->hj_UseBloom)
+				{
+					MemoryContext oldcxt;
+
+					oldcxt = MemoryContextSwitchTo(hashtable->hashCxt);
+					hashtable->bloom =
+						bloom_create((int64) hashNode->ps.plan->plan_rows,
+									 work_mem, 0);
+					MemoryContextSwitchTo(oldcxt);
+				}
+				node->hj_BloomActive = (hashtable->bloom != NULL);
+				node->hj_BloomProbes = 0;
+				node->hj_BloomRejects = 0;
+
 				/*
 				 * Execute the Hash node, to build the hash table.  If using
 				 * Parallel Hash, then we'll try to help hashing unless we
@@ -361,8 +400,23 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 					if (HJ_FILL_INNER(node))
 					{
 						/* set up to scan for unmatched inner tuples */
-						ExecPrepHashTableForUnmatched(node);
-						node->hj_JoinState = HJ_FILL_INNER_TUPLES;
+						if (parallel)
+						{
+							/*
+							 * Only one process is currently allowed to handle
+							 * each batch's unmatched tuples, in a parallel
+							 * join.
+							 */
+							if (ExecParallelPrepHashTableForUnmatched(node))
+								node->hj_JoinState = HJ_FILL_INNER_TUPLES;
+							else
+								node->hj_JoinState = HJ_NEED_NEW_BATCH;
+						}
+						else
+						{
+							ExecPrepHashTableForUnmatched(node);
+							node->hj_JoinState = HJ_FILL_INNER_TUPLES;
+						}
 					}
 					else
 						node->hj_JoinState = HJ_NEED_NEW_BATCH;
@@ -455,25 +509,15 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				{
 					node->hj_MatchedOuter = true;
 
-					if (parallel)
-					{
-						/*
-						 * Full/right outer joins are currently not supported
-						 * for parallel joins, so we don't need to set the
-						 * match bit.  Experiments show that it's worth
-						 * avoiding the shared memory traffic on large
-						 * systems.
-						 */
-						Assert(!HJ_FILL_INNER(node));
-					}
-					else
-					{
-						/*
-						 * This is really only needed if HJ_FILL_INNER(node),
-						 * but we'll avoid the branch and just set it always.
-						 */
+					/*
+					 * This is really only needed if HJ_FILL_INNER(node), but
+					 * we'll avoid the branch and just set it always.  Testing
+					 * the bit first avoids dirtying the cache line of an
+					 * already-matched tuple, which matters when it lives in
+					 * shared memory and other processes are probing it too.
+					 */
+					if (!HeapTupleHeaderHasMatch(HJTUPLE_MINTUPLE(node->hj_CurTuple)))
 						HeapTupleHeaderSetMatch(HJTUPLE_MINTUPLE(node->hj_CurTuple));
-					}
 
 					/* In an antijoin, we never return a matched tuple */
 					if (node->js.jointype == JOIN_ANTI)
@@ -531,7 +575,9 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				 * so any unmatched inner tuples in the hashtable have to be
 				 * emitted before we continue to the next batch.
 				 */
-				if (!ExecScanHashTableForUnmatched(node, econtext))
+				if (parallel ?
+					!ExecParallelScanHashTableForUnmatched(node, econtext) :
+					!ExecScanHashTableForUnmatched(node, econtext))
 				{
 					/* no more unmatched tuples */
 					node->hj_JoinState = HJ_NEED_NEW_BATCH;
@@ -752,6 +798,21 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_MatchedOuter = false;
 	hjstate->hj_OuterNotEmpty = false;
 
+	/*
+	 * Decide whether to use a Bloom filter to discard outer tuples early.
+	 * That's only correct if unmatched outer tuples aren't returned.  With
+	 * Parallel Hash each participant only sees part of the inner relation,
+	 * so no participant could build a complete filter.
+	 */
+	hjstate->hj_UseBloom = (enable_hashjoin_bloom_filter &&
+							!HJ_FILL_OUTER(hjstate) &&
+							!hashNode->plan.parallel_aware &&
+							outerNode->plan_rows >= HJ_BLOOM_MIN_OUTER_ROWS &&
+							hashNode->plan.plan_rows < outerNode->plan_rows);
+	hjstate->hj_BloomActive = false;
+	hjstate->hj_BloomProbes = 0;
+	hjstate->hj_BloomRejects = 0;
+
 	return hjstate;
 }
 
@@ -842,12 +903,41 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 				/* remember outer relation is not empty for possible rescan */
 				hjstate->hj_OuterNotEmpty = true;
 
-				return slot;
+				/*
+				 * If the Bloom filter says no inner tuple has this hash
+				 * value, the tuple can't have a match.  Discarding it here
+				 * avoids probing the hash table, and, for multi-batch joins,
+				 * writing it to a batch file.
+				 */
+				if (hjstate->hj_BloomActive)
+				{
+					bool		reject;
+
+					reject = bloom_lacks_element(hashtable->bloom,
+												 (unsigned char *) hashvalue,
+												 sizeof(uint32));
+					if (reject)
+					{
+						hjstate->hj_BloomRejects++;
+						InstrCountFiltered3(hjstate, 1);
+					}
+
+					/* stop checking if the filter hardly rejects anything */
+					if (++hjstate->hj_BloomProbes == HJ_BLOOM_CHECK_PROBES &&
+						hjstate->hj_BloomRejects <
+						HJ_BLOOM_CHECK_PROBES * HJ_BLOOM_MIN_REJECT)
+						hjstate->hj_BloomActive = false;
+
+					if (!reject)
+						return slot;
+				}
+				else
+					return slot;
 			}
 
 			/*
-			 * That tuple couldn't match because of a NULL, so discard it and
-			 * continue with the next one.
+			 * That tuple couldn't match because of a NULL, or was rejected by
+			 * the Bloom filter, so discard it and continue with the next one.
 			 */
 			slot = ExecProcNode(outerNode);
 		}
@@ -934,6 +1024,8 @@ ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
 	}
 
 	/* End of this batch */
+	hashtable->batches[curbatch].outer_eof = true;
+
 	return NULL;
 }
 
@@ -1181,6 +1273,21 @@ ExecParallelHashJoinNewBatch(HashJoinState *hjstate)
 					sts_begin_parallel_scan(hashtable->batches[batchno].outer_tuples);
 					return true;
 
+				case PHJ_BATCH_SCAN:
+
+					/*
+					 * In principle, we could help scan for unmatched tuples,
+					 * since that phase is already underway (the thing we
+					 * can't do under current deadlock-avoidance rules is wait
+					 * for others to arrive at PHJ_BATCH_SCAN, because
+					 * PHJ_BATCH_PROBING emits tuples), but in this initial
+					 * simple implementation we just give up.
+					 */
+					BarrierDetach(batch_barrier);
+					hashtable->batches[batchno].done = true;
+					hashtable->curbatch = -1;
+					break;
+
 				case PHJ_BATCH_DONE:
 
 					/*
@@ -1222,8 +1329,11 @@ ExecHashJoinSaveTuple(MinimalTuple tuple, uint32 hashvalue,
 
 	if (file == NULL)
 	{
-		/* First write to this batch file, so open it. */
-		file = BufFileCreateTemp(false);
+		/*
+		 * First write to this batch file, so open it.  Batch files are only
+		 * ever written, rewound and read back, so they may be compressed.
+		 */
+		file = BufFileCreateCompressTemp(false);
 		*fileptr = file;
 	}
 
@@ -120,6 +120,8 @@ IndexOnlyNext(IndexOnlyScanState *node)
 	 */
 	while ((tid = index_getnext_tid(scandesc, direction)) != NULL)
 	{
+		BlockNumber blkno = ItemPointerGetBlockNumber(tid);
+		bool		all_visible;
 		bool		tuple_from_heap = false;
 
 		CHECK_FOR_INTERRUPTS();
@@ -157,10 +159,29 @@ IndexOnlyNext(IndexOnlyScanState *node)
 		 *
 		 * It's worth going through this complexity to avoid needing to lock
 		 * the VM buffer, which could cause significant contention.
+		 *
+		 * The same reasoning lets us remember the status of the last heap
+		 * block we looked up, since index entries returned consecutively
+		 * frequently point to the same heap page.  The remembered status is
+		 * good only for TIDs that the index AM read before we consulted the
+		 * visibility map, so we must forget it whenever the AM loads a new
+		 * batch of TIDs, as reported by xs_batchno.  AMs that don't maintain
+		 * xs_batchno leave it at zero, disabling the cache.
 		 */
-		if (!VM_ALL_VISIBLE(scandesc->heapRelation,
-							ItemPointerGetBlockNumber(tid),
-							&node->ioss_VMBuffer))
+		if (scandesc->xs_batchno != 0 &&
+			scandesc->xs_batchno == node->ioss_VMCacheBatch &&
+			blkno == node->ioss_VMCacheBlock)
+			all_visible = node->ioss_VMCacheAllVisible;
+		else
+		{
+			all_visible = VM_ALL_VISIBLE(scandesc->heapRelation, blkno,
+										 &node->ioss_VMBuffer);
+			node->ioss_VMCacheBlock = blkno;
+			node->ioss_VMCacheBatch = scandesc->xs_batchno;
+			node->ioss_VMCacheAllVisible = all_visible;
+		}
+
+		if (!all_visible)
 		{
 			/*
 			 * Rats, we have to visit the heap to check visibility.
@@ -351,6 +372,9 @@ ExecReScanIndexOnlyScan(IndexOnlyScanState *node)
 	}
 	node->ioss_RuntimeKeysReady = true;
 
+	/* forget any cached visibility map status */
+	node->ioss_VMCacheBatch = 0;
+
 	/* reset index scan */
 	if (node->ioss_ScanDesc)
 		index_rescan(node->ioss_ScanDesc,
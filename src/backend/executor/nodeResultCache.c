@@ -0,0 +1,787 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeResultCache.c
+ *	  Routines to handle caching of results from parameterized nodes
+ *
+ * A ResultCache node sits on the inner side of a nested loop, above a
+ * parameterized subplan, and remembers the rows the subplan returned for
+ * each set of parameter values.  When the nested loop rescans it with
+ * values it has seen before, the rows are returned from the cache instead
+ * of running the subplan again.  That pays off when the outer side supplies
+ * the same values many times, for instance when looking up dimension rows
+ * by a foreign key.
+ *
+ * The cache is a hash table keyed by the values of the cache key
+ * expressions, which compute the parameters from the outer row.  Each entry
+ * holds a list of the rows for its key, and is only used once it is known
+ * to be complete, that is once the subplan has been run to the end for that
+ * key.  The memory used by the cache is limited to hash_mem; when adding to
+ * it would exceed that, the least recently used entries are evicted.  If a
+ * single entry doesn't fit, we give up caching it and just pass the
+ * subplan's rows through until the next rescan.
+ *
+ * If any of the subplan's parameters that aren't cache keys change, all
+ * entries are thrown away, since they might no longer be valid.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeResultCache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+/*
+ * INTERFACE ROUTINES
+ *		ExecResultCache			- lookup cache, exec subplan when not found
+ *		ExecInitResultCache		- initialize node and subnodes
+ *		ExecEndResultCache		- shutdown node and subnodes
+ *		ExecReScanResultCache	- rescan the result cache
+ */
+#include "postgres.h"
+
+#include "common/hashfn.h"
+#include "executor/executor.h"
+#include "executor/nodeResultCache.h"
+#include "lib/ilist.h"
+#include "miscadmin.h"
+#include "utils/lsyscache.h"
+
+/* States of the ExecResultCache state machine */
+#define RC_CACHE_LOOKUP				1	/* look up the next set of params */
+#define RC_CACHE_FETCH_NEXT_TUPLE	2	/* return rows of a cache hit */
+#define RC_FILLING_CACHE			3	/* add subplan rows to the entry */
+#define RC_CACHE_BYPASS_MODE		4	/* entry didn't fit; pass rows through */
+#define RC_END_OF_SCAN				5	/* no more rows for these params */
+
+/* Memory accounted for an entry without rows, and for each of its rows */
+#define EMPTY_ENTRY_MEMORY_BYTES(e)	(sizeof(ResultCacheEntry) + \
+									 sizeof(ResultCacheKey) + \
+									 (e)->key->params->t_len)
+#define CACHE_TUPLE_BYTES(t)		(sizeof(ResultCacheTuple) + \
+									 (t)->mintuple->t_len)
+
+/* Default number of hash buckets if the planner had no estimate */
+#define RC_DEFAULT_ENTRIES			1024
+
+/* A row stored in a cache entry */
+typedef struct ResultCacheTuple
+{
+	MinimalTuple mintuple;		/* the cached row */
+	struct ResultCacheTuple *next;	/* next row for the same key, or NULL */
+} ResultCacheTuple;
+
+/* The key of a cache entry, also linked into the LRU list */
+typedef struct ResultCacheKey
+{
+	MinimalTuple params;		/* values of the cache key expressions */
+	dlist_node	lru_node;		/* position in ResultCacheState.lru_list */
+} ResultCacheKey;
+
+/* A hash table entry */
+typedef struct ResultCacheEntry
+{
+	ResultCacheKey *key;		/* the key, see above */
+	ResultCacheTuple *tuplehead;	/* rows for this key, in subplan order */
+	uint32		hash;			/* hash value of the key */
+	char		status;			/* hash status */
+	bool		complete;		/* did we read all of the subplan's rows? */
+} ResultCacheEntry;
+
+static uint32 ResultCacheHash_hash(struct resultcache_hash *tb,
+								   const ResultCacheKey *key);
+static bool ResultCacheHash_equal(struct resultcache_hash *tb,
+								  const ResultCacheKey *key1,
+								  const ResultCacheKey *key2);
+
+/*
+ * Lookups pass a NULL key, meaning the parameter values in the node's
+ * probeslot; see ResultCacheHash_hash().
+ */
+#define SH_PREFIX resultcache
+#define SH_ELEMENT_TYPE ResultCacheEntry
+#define SH_KEY_TYPE ResultCacheKey *
+#define SH_KEY key
+#define SH_HASH_KEY(tb, key) ResultCacheHash_hash(tb, key)
+#define SH_EQUAL(tb, a, b) ResultCacheHash_equal(tb, a, b)
+#define SH_SCOPE static inline
+#define SH_STORE_HASH
+#define SH_GET_HASH(tb, a) a->hash
+#define SH_DEFINE
+#define SH_DECLARE
+#include "lib/simplehash.h"
+
+/*
+ * ResultCacheHash_hash
+ *		Hash the cache key values, either those of an existing key, or if
+ *		'key' is NULL, the current parameter values in the probeslot.
+ */
+static uint32
+ResultCacheHash_hash(struct resultcache_hash *tb, const ResultCacheKey *key)
+{
+	ResultCacheState *rcstate = (ResultCacheState *) tb->private_data;
+	TupleTableSlot *slot;
+	uint32		hashkey = 0;
+
+	if (key == NULL)
+		slot = rcstate->probeslot;
+	else
+	{
+		slot = rcstate->tableslot;
+		ExecStoreMinimalTuple(key->params, slot, false);
+		slot_getallattrs(slot);
+	}
+
+	for (int i = 0; i < rcstate->nkeys; i++)
+	{
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		/* treat nulls as having hash key 0 */
+		if (!slot->tts_isnull[i])
+		{
+			uint32		hkey;
+
+			hkey = DatumGetUInt32(FunctionCall1Coll(&rcstate->hashfunctions[i],
+													rcstate->collations[i],
+													slot->tts_values[i]));
+			hashkey ^= hkey;
+		}
+	}
+
+	return murmurhash32(hashkey);
+}
+
+/*
+ * ResultCacheHash_equal
+ *		Does the existing key 'key1' match 'key2'?
+ *
+ * 'key2' is NULL for lookups of the current parameter values.  Otherwise
+ * it's a key that is already in the table, which is being removed, and as
+ * keys are unique it can only match itself.
+ */
+static bool
+ResultCacheHash_equal(struct resultcache_hash *tb, const ResultCacheKey *key1,
+					  const ResultCacheKey *key2)
+{
+	ResultCacheState *rcstate = (ResultCacheState *) tb->private_data;
+	TupleTableSlot *tslot = rcstate->tableslot;
+	TupleTableSlot *pslot = rcstate->probeslot;
+
+	if (key2 != NULL)
+		return key1 == key2;
+
+	ExecStoreMinimalTuple(key1->params, tslot, false);
+	slot_getallattrs(tslot);
+
+	for (int i = 0; i < rcstate->nkeys; i++)
+	{
+		if (tslot->tts_isnull[i] || pslot->tts_isnull[i])
+		{
+			if (tslot->tts_isnull[i] != pslot->tts_isnull[i])
+				return false;
+			continue;
+		}
+
+		if (!DatumGetBool(FunctionCall2Coll(&rcstate->eqfunctions[i],
+											rcstate->collations[i],
+											tslot->tts_values[i],
+											pslot->tts_values[i])))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * build_hash_table
+ *		(Re)create the hash table, with room for 'size' entries.
+ */
+static void
+build_hash_table(ResultCacheState *rcstate, uint32 size)
+{
+	rcstate->hashtable = resultcache_create(rcstate->tableContext, size,
+											rcstate);
+}
+
+/*
+ * prepare_probe_slot
+ *		Evaluate the cache key expressions for the current parameter values
+ *		into the probeslot.
+ */
+static inline void
+prepare_probe_slot(ResultCacheState *rcstate)
+{
+	TupleTableSlot *pslot = rcstate->probeslot;
+	ExprContext *econtext = rcstate->ss.ps.ps_ExprContext;
+	MemoryContext oldcontext;
+
+	ResetExprContext(econtext);
+	ExecClearTuple(pslot);
+
+	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+	for (int i = 0; i < rcstate->nkeys; i++)
+		pslot->tts_values[i] = ExecEvalExpr(rcstate->param_exprs[i],
+											econtext,
+											&pslot->tts_isnull[i]);
+	MemoryContextSwitchTo(oldcontext);
+
+	ExecStoreVirtualTuple(pslot);
+}
+
+/*
+ * entry_purge_tuples
+ *		Remove all rows from a cache entry, leaving it empty and incomplete.
+ */
+static void
+entry_purge_tuples(ResultCacheState *rcstate, ResultCacheEntry *entry)
+{
+	ResultCacheTuple *tuple = entry->tuplehead;
+
+	while (tuple != NULL)
+	{
+		ResultCacheTuple *next = tuple->next;
+
+		rcstate->mem_used -= CACHE_TUPLE_BYTES(tuple);
+
+		pfree(tuple->mintuple);
+		pfree(tuple);
+
+		tuple = next;
+	}
+
+	entry->tuplehead = NULL;
+	entry->complete = false;
+}
+
+/*
+ * remove_cache_entry
+ *		Remove an entry and its rows from the cache.
+ */
+static void
+remove_cache_entry(ResultCacheState *rcstate, ResultCacheEntry *entry)
+{
+	ResultCacheKey *key = entry->key;
+
+	dlist_delete(&key->lru_node);
+
+	entry_purge_tuples(rcstate, entry);
+	rcstate->mem_used -= EMPTY_ENTRY_MEMORY_BYTES(entry);
+
+	/* this may move other entries around in the hash table */
+	resultcache_delete(rcstate->hashtable, key);
+
+	pfree(key->params);
+	pfree(key);
+}
+
+/*
+ * cache_purge_all
+ *		Remove all entries from the cache.
+ */
+static void
+cache_purge_all(ResultCacheState *rcstate)
+{
+	uint32		size = rcstate->hashtable->size;
+
+	/* this frees the hash table too */
+	MemoryContextReset(rcstate->tableContext);
+
+	dlist_init(&rcstate->lru_list);
+	rcstate->mem_used = 0;
+	rcstate->entry = NULL;
+	rcstate->last_tuple = NULL;
+
+	build_hash_table(rcstate, size);
+}
+
+/*
+ * cache_reduce_memory
+ *		Evict the least recently used entries until the cache is within its
+ *		memory limit again.
+ *
+ * Returns false if the entry with 'specialkey' had to be evicted too, which
+ * only happens if it is the last one left.
+ */
+static bool
+cache_reduce_memory(ResultCacheState *rcstate, ResultCacheKey *specialkey)
+{
+	bool		specialkey_intact = true;
+	dlist_mutable_iter iter;
+	uint64		evictions = 0;
+
+	/* the memory in use is at its peak now */
+	if (rcstate->mem_used > rcstate->stats.mem_peak)
+		rcstate->stats.mem_peak = rcstate->mem_used;
+
+	dlist_foreach_modify(iter, &rcstate->lru_list)
+	{
+		ResultCacheKey *key = dlist_container(ResultCacheKey, lru_node,
+											  iter.cur);
+		ResultCacheEntry *entry;
+
+		entry = resultcache_lookup(rcstate->hashtable, key);
+		Assert(entry != NULL);
+
+		/* the special key is the most recently used, so it goes last */
+		if (key == specialkey)
+			specialkey_intact = false;
+
+		remove_cache_entry(rcstate, entry);
+		evictions++;
+
+		if (rcstate->mem_used <= rcstate->mem_limit)
+			break;
+	}
+
+	rcstate->stats.cache_evictions += evictions;
+
+	return specialkey_intact;
+}
+
+/*
+ * cache_lookup
+ *		Find or create the entry for the parameter values in the probeslot,
+ *		and mark it as the most recently used.
+ *
+ * *found is set to whether the entry already existed.  Returns NULL if a new
+ * entry was needed but didn't fit in the cache.
+ */
+static ResultCacheEntry *
+cache_lookup(ResultCacheState *rcstate, bool *found)
+{
+	ResultCacheKey *key;
+	ResultCacheEntry *entry;
+	MemoryContext oldcontext;
+
+	prepare_probe_slot(rcstate);
+
+	entry = resultcache_insert(rcstate->hashtable, NULL, found);
+
+	if (*found)
+	{
+		dlist_delete(&entry->key->lru_node);
+		dlist_push_tail(&rcstate->lru_list, &entry->key->lru_node);
+		return entry;
+	}
+
+	oldcontext = MemoryContextSwitchTo(rcstate->tableContext);
+
+	key = (ResultCacheKey *) palloc(sizeof(ResultCacheKey));
+	key->params = ExecCopySlotMinimalTuple(rcstate->probeslot);
+
+	entry->key = key;
+	entry->tuplehead = NULL;
+	entry->complete = false;
+
+	rcstate->mem_used += EMPTY_ENTRY_MEMORY_BYTES(entry);
+	dlist_push_tail(&rcstate->lru_list, &key->lru_node);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (rcstate->mem_used > rcstate->mem_limit)
+	{
+		if (!cache_reduce_memory(rcstate, key))
+			return NULL;
+
+		/* evicting may have moved our entry within the hash table */
+		if (entry->status != resultcache_SH_IN_USE || entry->key != key)
+		{
+			entry = resultcache_lookup(rcstate->hashtable, NULL);
+			Assert(entry != NULL);
+		}
+	}
+
+	return entry;
+}
+
+/*
+ * cache_store_tuple
+ *		Add the row in 'slot' to the end of rcstate->entry.
+ *
+ * Returns false if that made the entry too large to keep, in which case it
+ * has been removed from the cache.
+ */
+static bool
+cache_store_tuple(ResultCacheState *rcstate, TupleTableSlot *slot)
+{
+	ResultCacheEntry *entry = rcstate->entry;
+	ResultCacheTuple *tuple;
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(rcstate->tableContext);
+
+	tuple = (ResultCacheTuple *) palloc(sizeof(ResultCacheTuple));
+	tuple->mintuple = ExecCopySlotMinimalTuple(slot);
+	tuple->next = NULL;
+
+	rcstate->mem_used += CACHE_TUPLE_BYTES(tuple);
+
+	if (entry->tuplehead == NULL)
+		entry->tuplehead = tuple;
+	else
+		rcstate->last_tuple->next = tuple;
+	rcstate->last_tuple = tuple;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (rcstate->mem_used > rcstate->mem_limit)
+	{
+		ResultCacheKey *key = entry->key;
+
+		if (!cache_reduce_memory(rcstate, key))
+			return false;
+
+		/* evicting may have moved our entry within the hash table */
+		if (entry->status != resultcache_SH_IN_USE || entry->key != key)
+		{
+			entry = resultcache_lookup(rcstate->hashtable, NULL);
+			Assert(entry != NULL);
+			rcstate->entry = entry;
+		}
+	}
+
+	return true;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecResultCache
+ *
+ *		On the first call after a rescan, look up the parameter values in
+ *		the cache.  If there's a complete entry for them, return its rows;
+ *		otherwise run the subplan, storing its rows in the cache as we
+ *		return them.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecResultCache(PlanState *pstate)
+{
+	ResultCacheState *node = castNode(ResultCacheState, pstate);
+	PlanState  *outerNode;
+	TupleTableSlot *slot;
+
+	CHECK_FOR_INTERRUPTS();
+
+	switch (node->rc_status)
+	{
+		case RC_CACHE_LOOKUP:
+			{
+				ResultCacheEntry *entry;
+				bool		found;
+
+				Assert(node->entry == NULL);
+
+				entry = cache_lookup(node, &found);
+
+				if (found && entry->complete)
+				{
+					node->stats.cache_hits++;
+
+					node->entry = entry;
+					node->last_tuple = entry->tuplehead;
+					if (node->last_tuple == NULL)
+					{
+						/* the subplan returned no rows for these params */
+						node->rc_status = RC_END_OF_SCAN;
+						return NULL;
+					}
+
+					node->rc_status = RC_CACHE_FETCH_NEXT_TUPLE;
+					slot = node->ss.ps.ps_ResultTupleSlot;
+					ExecStoreMinimalTuple(node->last_tuple->mintuple, slot,
+										  false);
+					return slot;
+				}
+
+				node->stats.cache_misses++;
+
+				/*
+				 * An incomplete entry is left over from a scan the nested
+				 * loop didn't read to the end.  Start it afresh.
+				 */
+				if (found)
+					entry_purge_tuples(node, entry);
+
+				outerNode = outerPlanState(node);
+				slot = ExecProcNode(outerNode);
+
+				if (entry == NULL)
+				{
+					/* entry didn't fit; don't try to cache these rows */
+					node->stats.cache_overflows++;
+					node->rc_status = TupIsNull(slot) ? RC_END_OF_SCAN :
+						RC_CACHE_BYPASS_MODE;
+					return slot;
+				}
+
+				node->entry = entry;
+
+				if (TupIsNull(slot))
+				{
+					/* no rows for these params, remember that */
+					entry->complete = true;
+					node->rc_status = RC_END_OF_SCAN;
+					return NULL;
+				}
+
+				if (!cache_store_tuple(node, slot))
+				{
+					node->stats.cache_overflows++;
+					node->entry = NULL;
+					node->last_tuple = NULL;
+					node->rc_status = RC_CACHE_BYPASS_MODE;
+					return slot;
+				}
+
+				/*
+				 * If the nested loop won't ask for a second row, the entry is
+				 * complete already.
+				 */
+				if (node->singlerow)
+				{
+					node->entry->complete = true;
+					node->rc_status = RC_END_OF_SCAN;
+				}
+				else
+					node->rc_status = RC_FILLING_CACHE;
+
+				return slot;
+			}
+
+		case RC_CACHE_FETCH_NEXT_TUPLE:
+			{
+				Assert(node->entry != NULL && node->entry->complete);
+
+				node->last_tuple = node->last_tuple->next;
+				if (node->last_tuple == NULL)
+				{
+					node->rc_status = RC_END_OF_SCAN;
+					return NULL;
+				}
+
+				slot = node->ss.ps.ps_ResultTupleSlot;
+				ExecStoreMinimalTuple(node->last_tuple->mintuple, slot,
+									  false);
+				return slot;
+			}
+
+		case RC_FILLING_CACHE:
+			{
+				Assert(node->entry != NULL);
+
+				outerNode = outerPlanState(node);
+				slot = ExecProcNode(outerNode);
+
+				if (TupIsNull(slot))
+				{
+					/* we've seen all the rows, so the entry is complete */
+					node->entry->complete = true;
+					node->rc_status = RC_END_OF_SCAN;
+					return NULL;
+				}
+
+				if (!cache_store_tuple(node, slot))
+				{
+					node->stats.cache_overflows++;
+					node->entry = NULL;
+					node->last_tuple = NULL;
+					node->rc_status = RC_CACHE_BYPASS_MODE;
+				}
+
+				return slot;
+			}
+
+		case RC_CACHE_BYPASS_MODE:
+			{
+				outerNode = outerPlanState(node);
+				slot = ExecProcNode(outerNode);
+
+				if (TupIsNull(slot))
+					node->rc_status = RC_END_OF_SCAN;
+
+				return slot;
+			}
+
+		case RC_END_OF_SCAN:
+			return NULL;
+
+		default:
+			elog(ERROR, "unrecognized resultcache state: %d",
+				 (int) node->rc_status);
+			return NULL;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitResultCache
+ * ----------------------------------------------------------------
+ */
+ResultCacheState *
+ExecInitResultCache(ResultCache *node, EState *estate, int eflags)
+{
+	ResultCacheState *rcstate;
+	Plan	   *outerNode;
+	TupleDesc	keydesc;
+	int			i;
+	int			nkeys;
+	ListCell   *lc;
+
+	/* check for unsupported flags */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	rcstate = makeNode(ResultCacheState);
+	rcstate->ss.ps.plan = (Plan *) node;
+	rcstate->ss.ps.state = estate;
+	rcstate->ss.ps.ExecProcNode = ExecResultCache;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * create expression context for node, to evaluate the cache keys in
+	 */
+	ExecAssignExprContext(estate, &rcstate->ss.ps);
+
+	/*
+	 * initialize child nodes
+	 */
+	outerNode = outerPlan(node);
+	outerPlanState(rcstate) = ExecInitNode(outerNode, estate, eflags);
+
+	/*
+	 * Initialize result type and slot.  Rows from the cache are returned in
+	 * a MinimalTuple slot, but if we're not caching, rows from the subplan
+	 * are returned as they are, so the result slot type isn't fixed.  No
+	 * need to initialize projection info because this node doesn't do
+	 * projections.
+	 */
+	ExecInitResultTupleSlotTL(&rcstate->ss.ps, &TTSOpsMinimalTuple);
+	rcstate->ss.ps.ps_ProjInfo = NULL;
+	rcstate->ss.ps.resultopsset = true;
+	rcstate->ss.ps.resultopsfixed = false;
+
+	/*
+	 * initialize tuple type.
+	 */
+	ExecCreateScanSlotFromOuterPlan(estate, &rcstate->ss, &TTSOpsMinimalTuple);
+
+	/*
+	 * Set up the cache keys and the functions to hash and compare them.
+	 */
+	rcstate->nkeys = nkeys = node->numKeys;
+	keydesc = ExecTypeFromExprList(node->param_exprs);
+	rcstate->tableslot = ExecInitExtraTupleSlot(estate, keydesc,
+												&TTSOpsMinimalTuple);
+	rcstate->probeslot = ExecInitExtraTupleSlot(estate, keydesc,
+												&TTSOpsVirtual);
+
+	rcstate->param_exprs = (ExprState **) palloc(nkeys * sizeof(ExprState *));
+	rcstate->hashfunctions = (FmgrInfo *) palloc(nkeys * sizeof(FmgrInfo));
+	rcstate->eqfunctions = (FmgrInfo *) palloc(nkeys * sizeof(FmgrInfo));
+	rcstate->collations = node->collations;
+
+	i = 0;
+	foreach(lc, node->param_exprs)
+	{
+		Expr	   *param_expr = (Expr *) lfirst(lc);
+		Oid			hashop = node->hashOperators[i];
+		RegProcedure left_hashfn;
+		RegProcedure right_hashfn;
+
+		if (!get_op_hash_functions(hashop, &left_hashfn, &right_hashfn))
+			elog(ERROR, "could not find hash function for hash operator %u",
+				 hashop);
+
+		fmgr_info(left_hashfn, &rcstate->hashfunctions[i]);
+		fmgr_info(get_opcode(hashop), &rcstate->eqfunctions[i]);
+
+		rcstate->param_exprs[i] = ExecInitExpr(param_expr,
+											   (PlanState *) rcstate);
+		i++;
+	}
+
+	rcstate->mem_used = 0;
+	rcstate->mem_limit = get_hash_mem() * (uint64) 1024;
+
+	/*
+	 * The cache lives in a context of its own, so that it can be thrown away
+	 * at once.
+	 */
+	rcstate->tableContext = AllocSetContextCreate(CurrentMemoryContext,
+												  "ResultCacheHashTable",
+												  ALLOCSET_DEFAULT_SIZES);
+	dlist_init(&rcstate->lru_list);
+	rcstate->last_tuple = NULL;
+	rcstate->entry = NULL;
+	rcstate->singlerow = node->singlerow;
+	rcstate->keyparamids = node->keyparamids;
+	memset(&rcstate->stats, 0, sizeof(ResultCacheInstrumentation));
+
+	build_hash_table(rcstate, node->est_entries > 0 ? node->est_entries :
+					 RC_DEFAULT_ENTRIES);
+
+	rcstate->rc_status = RC_CACHE_LOOKUP;
+
+	return rcstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndResultCache
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndResultCache(ResultCacheState *node)
+{
+	/*
+	 * Free the exprcontext
+	 */
+	ExecFreeExprContext(&node->ss.ps);
+
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+
+	/*
+	 * Release the cache
+	 */
+	MemoryContextDelete(node->tableContext);
+
+	/*
+	 * shut down the subplan
+	 */
+	ExecEndNode(outerPlanState(node));
+}
+
+/* ----------------------------------------------------------------
+ *		ExecReScanResultCache
+ *
+ *		Prepare to look up the cache for new parameter values.
+ * ----------------------------------------------------------------
+ */
+void
+ExecReScanResultCache(ResultCacheState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+
+	node->rc_status = RC_CACHE_LOOKUP;
+	node->entry = NULL;
+	node->last_tuple = NULL;
+
+	/*
+	 * If chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode, which only happens on a cache miss.
+	 */
+	if (outerPlan->chgParam == NULL)
+		ExecReScan(outerPlan);
+
+	/*
+	 * If parameters other than the cache keys changed, the cached rows may
+	 * no longer be right for their keys.
+	 */
+	if (bms_nonempty_difference(outerPlan->chgParam, node->keyparamids))
+		cache_purge_all(node);
+}
@@ -29,11 +29,14 @@
 
 #include "access/relscan.h"
 #include "access/tableam.h"
+#include "executor/execScan.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSeqscan.h"
+#include "optimizer/optimizer.h"
 #include "utils/rel.h"
 
 static TupleTableSlot *SeqNext(SeqScanState *node);
+static Bitmapset *SeqScanProjectedAttrs(SeqScanState *node);
 
 /* ----------------------------------------------------------------
  *						Scan Support
@@ -71,6 +74,7 @@ SeqNext(SeqScanState *node)
 		scandesc = table_beginscan(node->ss.ss_currentRelation,
 								   estate->es_snapshot,
 								   0, NULL);
+		table_scan_set_projection(scandesc, node->projected_attrs);
 		node->ss.ss_currentScanDesc = scandesc;
 	}
 
@@ -82,6 +86,26 @@ SeqNext(SeqScanState *node)
 	return NULL;
 }
 
+/*
+ * SeqScanProjectedAttrs -- compute the columns the scan has to return
+ *
+ * These are the columns referenced by the node's targetlist and qual.  A
+ * whole-row reference shows up as attribute 0, which tells the AM that
+ * every column may be needed.
+ */
+static Bitmapset *
+SeqScanProjectedAttrs(SeqScanState *node)
+{
+	Plan	   *plan = node->ss.ps.plan;
+	Index		scanrelid = ((Scan *) plan)->scanrelid;
+	Bitmapset  *attrs = NULL;
+
+	pull_varattnos((Node *) plan->targetlist, scanrelid, &attrs);
+	pull_varattnos((Node *) plan->qual, scanrelid, &attrs);
+
+	return attrs;
+}
+
 /*
  * SeqRecheck -- access method routine to recheck a tuple in EvalPlanQual
  */
@@ -99,9 +123,15 @@ SeqRecheck(SeqScanState *node, TupleTableSlot *slot)
  *		ExecSeqScan(node)
  *
  *		Scans the relation sequentially and returns the next qualifying
- *		tuple.
- *		We call the ExecScan() routine and pass it the appropriate
- *		access method functions.
+ *		tuple.  This variant is used when there is no qual, no projection
+ *		and no EvalPlanQual recheck going on.
+ *
+ *		Sequential scans are often the bulk of the per-row CPU cost of
+ *		analytic queries, so rather than going through the generic
+ *		ExecScan(), ExecInitSeqScan() picks one of the variants below, each
+ *		of which inlines ExecScanExtended() with its qual, projection and
+ *		EPQ arguments fixed, so that the branches on them disappear from the
+ *		per-tuple path.
  * ----------------------------------------------------------------
  */
 static TupleTableSlot *
@@ -109,6 +139,88 @@ ExecSeqScan(PlanState *pstate)
 {
 	SeqScanState *node = castNode(SeqScanState, pstate);
 
+	Assert(pstate->state->es_epq_active == NULL);
+	Assert(pstate->qual == NULL);
+	Assert(pstate->ps_ProjInfo == NULL);
+
+	return ExecScanExtended(&node->ss,
+							(ExecScanAccessMtd) SeqNext,
+							(ExecScanRecheckMtd) SeqRecheck,
+							NULL,
+							NULL,
+							NULL);
+}
+
+/*
+ * Variant of ExecSeqScan() for when a qual has to be checked.
+ */
+static TupleTableSlot *
+ExecSeqScanWithQual(PlanState *pstate)
+{
+	SeqScanState *node = castNode(SeqScanState, pstate);
+
+	Assert(pstate->state->es_epq_active == NULL);
+	Assert(pstate->qual != NULL);
+	Assert(pstate->ps_ProjInfo == NULL);
+
+	return ExecScanExtended(&node->ss,
+							(ExecScanAccessMtd) SeqNext,
+							(ExecScanRecheckMtd) SeqRecheck,
+							NULL,
+							pstate->qual,
+							NULL);
+}
+
+/*
+ * Variant of ExecSeqScan() for when a projection is required.
+ */
+static TupleTableSlot *
+ExecSeqScanWithProject(PlanState *pstate)
+{
+	SeqScanState *node = castNode(SeqScanState, pstate);
+
+	Assert(pstate->state->es_epq_active == NULL);
+	Assert(pstate->qual == NULL);
+	Assert(pstate->ps_ProjInfo != NULL);
+
+	return ExecScanExtended(&node->ss,
+							(ExecScanAccessMtd) SeqNext,
+							(ExecScanRecheckMtd) SeqRecheck,
+							NULL,
+							NULL,
+							pstate->ps_ProjInfo);
+}
+
+/*
+ * Variant of ExecSeqScan() for when both a qual and a projection are
+ * required.
+ */
+static TupleTableSlot *
+ExecSeqScanWithQualProject(PlanState *pstate)
+{
+	SeqScanState *node = castNode(SeqScanState, pstate);
+
+	Assert(pstate->state->es_epq_active == NULL);
+	Assert(pstate->qual != NULL);
+	Assert(pstate->ps_ProjInfo != NULL);
+
+	return ExecScanExtended(&node->ss,
+							(ExecScanAccessMtd) SeqNext,
+							(ExecScanRecheckMtd) SeqRecheck,
+							NULL,
+							pstate->qual,
+							pstate->ps_ProjInfo);
+}
+
+/*
+ * Variant of ExecSeqScan() for use inside an EvalPlanQual recheck, which
+ * isn't performance-critical, so the generic ExecScan() will do.
+ */
+static TupleTableSlot *
+ExecSeqScanEPQ(PlanState *pstate)
+{
+	SeqScanState *node = castNode(SeqScanState, pstate);
+
 	return ExecScan(&node->ss,
 					(ExecScanAccessMtd) SeqNext,
 					(ExecScanRecheckMtd) SeqRecheck);
@@ -137,7 +249,6 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	scanstate = makeNode(SeqScanState);
 	scanstate->ss.ps.plan = (Plan *) node;
 	scanstate->ss.ps.state = estate;
-	scanstate->ss.ps.ExecProcNode = ExecSeqScan;
 
 	/*
 	 * Miscellaneous initialization
@@ -171,6 +282,42 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	scanstate->ss.ps.qual =
 		ExecInitQual(node->plan.qual, (PlanState *) scanstate);
 
+	/*
+	 * If the table AM can make use of it, work out which columns we need.
+	 * Inside an EvalPlanQual recheck the tuples may come from elsewhere and
+	 * are accessed in full, so ask for all columns.
+	 */
+	if (table_scan_supports_projection(scanstate->ss.ss_currentRelation))
+	{
+		if (estate->es_epq_active == NULL)
+			scanstate->projected_attrs = SeqScanProjectedAttrs(scanstate);
+		else
+			scanstate->projected_attrs =
+				bms_make_singleton(0 - FirstLowInvalidHeapAttributeNumber);
+	}
+
+	/*
+	 * Now that the qual and projection are known, choose the most specific
+	 * ExecProcNode variant.  The EvalPlanQual case is rare, so it's handled
+	 * by a single generic variant.
+	 */
+	if (scanstate->ss.ps.state->es_epq_active != NULL)
+		scanstate->ss.ps.ExecProcNode = ExecSeqScanEPQ;
+	else if (scanstate->ss.ps.qual == NULL)
+	{
+		if (scanstate->ss.ps.ps_ProjInfo == NULL)
+			scanstate->ss.ps.ExecProcNode = ExecSeqScan;
+		else
+			scanstate->ss.ps.ExecProcNode = ExecSeqScanWithProject;
+	}
+	else
+	{
+		if (scanstate->ss.ps.ps_ProjInfo == NULL)
+			scanstate->ss.ps.ExecProcNode = ExecSeqScanWithQual;
+		else
+			scanstate->ss.ps.ExecProcNode = ExecSeqScanWithQualProject;
+	}
+
 	return scanstate;
 }
 
@@ -278,6 +425,8 @@ ExecSeqScanInitializeDSM(SeqScanState *node,
 	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pscan);
 	node->ss.ss_currentScanDesc =
 		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+	table_scan_set_projection(node->ss.ss_currentScanDesc,
+							  node->projected_attrs);
 }
 
 /* ----------------------------------------------------------------
@@ -311,4 +460,6 @@ ExecSeqScanInitializeWorker(SeqScanState *node,
 	pscan = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, false);
 	node->ss.ss_currentScanDesc =
 		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+	table_scan_set_projection(node->ss.ss_currentScanDesc,
+							  node->projected_attrs);
 }
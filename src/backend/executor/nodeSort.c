@@ -19,8 +19,46 @@
 #include "executor/execdebug.h"
 #include "executor/nodeSort.h"
 #include "miscadmin.h"
+#include "port/atomics.h"
+#include "storage/barrier.h"
 #include "utils/tuplesort.h"
 
+/*
+ * A Parallel Sort shares one tuplesort between all participants.  Each of
+ * them sorts the part of the (partial) input that it reads itself into a
+ * single run, as the workers of a parallel CREATE INDEX do.  The last
+ * participant to finish its run then merges all of them and returns the
+ * whole sorted output, while the others return nothing.  Since only one
+ * process emits tuples, a Gather above the node preserves their order, and
+ * no single process needs to merge the streams of all the others as Gather
+ * Merge would.
+ *
+ * Nobody ever waits at the barrier, so this is deadlock-free: participants
+ * that aren't last simply detach.  Participants that show up after the last
+ * run was finished have nothing to contribute, since the input has been
+ * consumed by then.
+ *
+ * The shared state is followed in the same DSM chunk by the Sharedsort,
+ * and then by the SharedSortInfo if instrumenting.
+ */
+#define PSORT_LOADING		0
+#define PSORT_MERGING		1
+
+struct ParallelSortState
+{
+	Barrier		barrier;		/* see PSORT_* phases above */
+	pg_atomic_uint32 nruns;		/* number of runs to be merged */
+	int			ntapes;			/* size of the Sharedsort */
+};
+
+#define ParallelSortStateSize(ntapes) \
+	(MAXALIGN(sizeof(ParallelSortState)) + \
+	 MAXALIGN(tuplesort_estimate_shared(ntapes)))
+#define ParallelSortGetSharedsort(pstate) \
+	((Sharedsort *) ((char *) (pstate) + MAXALIGN(sizeof(ParallelSortState))))
+
+static Tuplesortstate *ExecParallelSortBuild(SortState *node);
+
 
 /* ----------------------------------------------------------------
  *		ExecSort
@@ -86,37 +124,58 @@ ExecSort(PlanState *pstate)
 		outerNode = outerPlanState(node);
 		tupDesc = ExecGetResultType(outerNode);
 
-		tuplesortstate = tuplesort_begin_heap(tupDesc,
-											  plannode->numCols,
-											  plannode->sortColIdx,
-											  plannode->sortOperators,
-											  plannode->collations,
-											  plannode->nullsFirst,
-											  work_mem,
-											  NULL,
-											  node->randomAccess);
-		if (node->bounded)
-			tuplesort_set_bound(tuplesortstate, node->bound);
-		node->tuplesortstate = (void *) tuplesortstate;
-
-		/*
-		 * Scan the subplan and feed all the tuples to tuplesort.
-		 */
-
-		for (;;)
+		if (node->parallel_state != NULL)
 		{
-			slot = ExecProcNode(outerNode);
-
-			if (TupIsNull(slot))
-				break;
-
-			tuplesort_puttupleslot(tuplesortstate, slot);
+			/*
+			 * Feed our part of the input to the shared sort.  We only get a
+			 * tuplesort to return tuples from if we are the one to merge.
+			 */
+			tuplesortstate = ExecParallelSortBuild(node);
 		}
-
-		/*
-		 * Complete the sort.
-		 */
-		tuplesort_performsort(tuplesortstate);
+		else
+		{
+			tuplesortstate = tuplesort_begin_heap(tupDesc,
+												  plannode->numCols,
+												  plannode->sortColIdx,
+												  plannode->sortOperators,
+												  plannode->collations,
+												  plannode->nullsFirst,
+												  work_mem,
+												  NULL,
+												  node->randomAccess);
+			if (node->bounded)
+				tuplesort_set_bound(tuplesortstate, node->bound);
+
+			/*
+			 * Scan the subplan and feed all the tuples to tuplesort.
+			 */
+
+			for (;;)
+			{
+				slot = ExecProcNode(outerNode);
+
+				if (TupIsNull(slot))
+					break;
+
+				tuplesort_puttupleslot(tuplesortstate, slot);
+			}
+
+			/*
+			 * Complete the sort.
+			 */
+			tuplesort_performsort(tuplesortstate);
+
+			if (node->shared_info && node->am_worker)
+			{
+				TuplesortInstrumentation *si;
+
+				Assert(IsParallelWorker());
+				Assert(ParallelWorkerNumber <= node->shared_info->num_workers);
+				si = &node->shared_info->sinstrument[ParallelWorkerNumber];
+				tuplesort_get_stats(tuplesortstate, si);
+			}
+		}
+		node->tuplesortstate = (void *) tuplesortstate;
 
 		/*
 		 * restore to user specified direction
@@ -129,15 +188,6 @@ ExecSort(PlanState *pstate)
 		node->sort_Done = true;
 		node->bounded_Done = node->bounded;
 		node->bound_Done = node->bound;
-		if (node->shared_info && node->am_worker)
-		{
-			TuplesortInstrumentation *si;
-
-			Assert(IsParallelWorker());
-			Assert(ParallelWorkerNumber <= node->shared_info->num_workers);
-			si = &node->shared_info->sinstrument[ParallelWorkerNumber];
-			tuplesort_get_stats(tuplesortstate, si);
-		}
 		SO1_printf("ExecSort: %s\n", "sorting done");
 	}
 
@@ -150,12 +200,107 @@ ExecSort(PlanState *pstate)
 	 * next fetch from the tuplesort.
 	 */
 	slot = node->ss.ps.ps_ResultTupleSlot;
+	if (tuplesortstate == NULL)
+		return ExecClearTuple(slot);	/* another process merges the runs */
 	(void) tuplesort_gettupleslot(tuplesortstate,
 								  ScanDirectionIsForward(dir),
 								  false, slot, NULL);
 	return slot;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecParallelSortBuild
+ *
+ *		Sorts this participant's share of the input of a Parallel Sort
+ *		into a run on shared tapes.  If this turns out to be the last
+ *		participant to finish its run, returns a tuplesort merging the
+ *		runs of all of them; otherwise returns NULL.
+ * ----------------------------------------------------------------
+ */
+static Tuplesortstate *
+ExecParallelSortBuild(SortState *node)
+{
+	ParallelSortState *pstate = node->parallel_state;
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+	PlanState  *outerNode = outerPlanState(node);
+	TupleDesc	tupDesc = ExecGetResultType(outerNode);
+	SortCoordinateData coordinate;
+	Tuplesortstate *tuplesortstate;
+	TupleTableSlot *slot;
+
+	if (BarrierAttach(&pstate->barrier) != PSORT_LOADING)
+	{
+		/* Too late to contribute a run, and someone else is merging. */
+		BarrierDetach(&pstate->barrier);
+		return NULL;
+	}
+	pg_atomic_fetch_add_u32(&pstate->nruns, 1);
+
+	coordinate.isWorker = true;
+	coordinate.nParticipants = -1;
+	coordinate.sharedsort = ParallelSortGetSharedsort(pstate);
+
+	tuplesortstate = tuplesort_begin_heap(tupDesc,
+										  plannode->numCols,
+										  plannode->sortColIdx,
+										  plannode->sortOperators,
+										  plannode->collations,
+										  plannode->nullsFirst,
+										  work_mem,
+										  &coordinate,
+										  false);
+
+	for (;;)
+	{
+		slot = ExecProcNode(outerNode);
+
+		if (TupIsNull(slot))
+			break;
+
+		tuplesort_puttupleslot(tuplesortstate, slot);
+	}
+
+	/* Write out our run; it stays behind in the shared fileset. */
+	tuplesort_performsort(tuplesortstate);
+
+	if (node->shared_info && node->am_worker)
+	{
+		TuplesortInstrumentation *si;
+
+		Assert(IsParallelWorker());
+		Assert(ParallelWorkerNumber <= node->shared_info->num_workers);
+		si = &node->shared_info->sinstrument[ParallelWorkerNumber];
+		tuplesort_get_stats(tuplesortstate, si);
+	}
+	tuplesort_end(tuplesortstate);
+
+	/*
+	 * Everyone but the last participant to get here detaches and returns no
+	 * tuples.  Since nobody else is still attached when we turn out to be
+	 * last, all the runs counted in nruns are complete.
+	 */
+	if (!BarrierArriveAndDetachExceptLast(&pstate->barrier))
+		return NULL;
+
+	Assert(BarrierPhase(&pstate->barrier) == PSORT_MERGING);
+
+	coordinate.isWorker = false;
+	coordinate.nParticipants = (int) pg_atomic_read_u32(&pstate->nruns);
+
+	tuplesortstate = tuplesort_begin_heap(tupDesc,
+										  plannode->numCols,
+										  plannode->sortColIdx,
+										  plannode->sortOperators,
+										  plannode->collations,
+										  plannode->nullsFirst,
+										  work_mem,
+										  &coordinate,
+										  false);
+	tuplesort_performsort(tuplesortstate);
+
+	return tuplesortstate;
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitSort
  *
@@ -188,6 +333,17 @@ ExecInitSort(Sort *node, EState *estate, int eflags)
 										 EXEC_FLAG_BACKWARD |
 										 EXEC_FLAG_MARK)) != 0;
 
+	/*
+	 * A parallel sort can't be read backwards, and is never marked since
+	 * it's always below a Gather, but it might be asked to prefer to rewind.
+	 * It'll just have to sort again instead.
+	 */
+	if (node->plan.parallel_aware)
+	{
+		Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+		sortstate->randomAccess = false;
+	}
+
 	sortstate->bounded = false;
 	sortstate->sort_Done = false;
 	sortstate->tuplesortstate = NULL;
@@ -328,7 +484,8 @@ ExecReScanSort(SortState *node)
 		!node->randomAccess)
 	{
 		node->sort_Done = false;
-		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+		if (node->tuplesortstate != NULL)
+			tuplesort_end((Tuplesortstate *) node->tuplesortstate);
 		node->tuplesortstate = NULL;
 
 		/*
@@ -350,20 +507,29 @@ ExecReScanSort(SortState *node)
 /* ----------------------------------------------------------------
  *		ExecSortEstimate
  *
- *		Estimate space required to propagate sort statistics.
+ *		Estimate space required for a parallel sort and to propagate sort
+ *		statistics.
  * ----------------------------------------------------------------
  */
 void
 ExecSortEstimate(SortState *node, ParallelContext *pcxt)
 {
-	Size		size;
+	Size		size = 0;
+
+	if (node->ss.ps.plan->parallel_aware)
+		size = ParallelSortStateSize(pcxt->nworkers + 1);
+
+	/* don't need instrumentation if not instrumenting or no workers */
+	if (node->ss.ps.instrument && pcxt->nworkers > 0)
+	{
+		size = add_size(size, offsetof(SharedSortInfo, sinstrument));
+		size = add_size(size, mul_size(pcxt->nworkers,
+									   sizeof(TuplesortInstrumentation)));
+	}
 
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	if (size == 0)
 		return;
 
-	size = mul_size(pcxt->nworkers, sizeof(TuplesortInstrumentation));
-	size = add_size(size, offsetof(SharedSortInfo, sinstrument));
 	shm_toc_estimate_chunk(&pcxt->estimator, size);
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 }
@@ -371,40 +537,100 @@ ExecSortEstimate(SortState *node, ParallelContext *pcxt)
 /* ----------------------------------------------------------------
  *		ExecSortInitializeDSM
  *
- *		Initialize DSM space for sort statistics.
+ *		Initialize DSM space for a parallel sort and sort statistics.
  * ----------------------------------------------------------------
  */
 void
 ExecSortInitializeDSM(SortState *node, ParallelContext *pcxt)
 {
-	Size		size;
+	Size		pstate_size = 0;
+	Size		instr_size = 0;
+	char	   *ptr;
 
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	if (node->ss.ps.plan->parallel_aware)
+		pstate_size = ParallelSortStateSize(pcxt->nworkers + 1);
+
+	/* don't need instrumentation if not instrumenting or no workers */
+	if (node->ss.ps.instrument && pcxt->nworkers > 0)
+		instr_size = offsetof(SharedSortInfo, sinstrument)
+			+ pcxt->nworkers * sizeof(TuplesortInstrumentation);
+
+	if (pstate_size + instr_size == 0)
 		return;
 
-	size = offsetof(SharedSortInfo, sinstrument)
-		+ pcxt->nworkers * sizeof(TuplesortInstrumentation);
-	node->shared_info = shm_toc_allocate(pcxt->toc, size);
-	/* ensure any unfilled slots will contain zeroes */
-	memset(node->shared_info, 0, size);
-	node->shared_info->num_workers = pcxt->nworkers;
-	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id,
-				   node->shared_info);
+	ptr = shm_toc_allocate(pcxt->toc, pstate_size + instr_size);
+	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, ptr);
+
+	if (pstate_size > 0)
+	{
+		ParallelSortState *pstate = (ParallelSortState *) ptr;
+
+		BarrierInit(&pstate->barrier, 0);
+		pg_atomic_init_u32(&pstate->nruns, 0);
+		pstate->ntapes = pcxt->nworkers + 1;
+		tuplesort_initialize_shared(ParallelSortGetSharedsort(pstate),
+									pstate->ntapes, pcxt->seg);
+		node->parallel_state = pstate;
+		ptr += pstate_size;
+	}
+
+	if (instr_size > 0)
+	{
+		node->shared_info = (SharedSortInfo *) ptr;
+		/* ensure any unfilled slots will contain zeroes */
+		memset(node->shared_info, 0, instr_size);
+		node->shared_info->num_workers = pcxt->nworkers;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecSortReInitializeDSM
+ *
+ *		Reset shared state before beginning a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSortReInitializeDSM(SortState *node, ParallelContext *pcxt)
+{
+	ParallelSortState *pstate = node->parallel_state;
+
+	/* Forget about the runs of the previous scan, and their files. */
+	BarrierInit(&pstate->barrier, 0);
+	pg_atomic_write_u32(&pstate->nruns, 0);
+	tuplesort_reinitialize_shared(ParallelSortGetSharedsort(pstate));
 }
 
 /* ----------------------------------------------------------------
  *		ExecSortInitializeWorker
  *
- *		Attach worker to DSM space for sort statistics.
+ *		Attach worker to DSM space for a parallel sort and sort statistics.
  * ----------------------------------------------------------------
  */
 void
 ExecSortInitializeWorker(SortState *node, ParallelWorkerContext *pwcxt)
 {
-	node->shared_info =
-		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
+	bool		parallel_aware = node->ss.ps.plan->parallel_aware;
+	char	   *ptr;
+
+	ptr = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id,
+						 !parallel_aware);
 	node->am_worker = true;
+
+	if (ptr == NULL)
+		return;
+
+	if (parallel_aware)
+	{
+		ParallelSortState *pstate = (ParallelSortState *) ptr;
+
+		tuplesort_attach_shared(ParallelSortGetSharedsort(pstate),
+								pwcxt->seg);
+		node->parallel_state = pstate;
+		ptr += ParallelSortStateSize(pstate->ntapes);
+	}
+
+	if (node->ss.ps.instrument)
+		node->shared_info = (SharedSortInfo *) ptr;
 }
 
 /* ----------------------------------------------------------------
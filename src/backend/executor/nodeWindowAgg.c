@@ -1259,6 +1259,14 @@ spool_tuples(WindowAggState *winstate, int64 pos)
 	if (!tuplestore_in_memory(winstate->buffer))
 		pos = -1;
 
+	/*
+	 * In strict pass-through mode we're the top-level window and the rest of
+	 * the current partition can't produce any output, so just read past it
+	 * without bothering to store anything.
+	 */
+	if (winstate->status == WINDOWAGG_PASSTHROUGH_STRICT)
+		pos = -1;
+
 	outerPlan = outerPlanState(winstate);
 
 	/* Must be in query context to call outerplan */
@@ -1296,8 +1304,11 @@ spool_tuples(WindowAggState *winstate, int64 pos)
 		}
 
 		/* Still in partition, so save it into the tuplestore */
-		tuplestore_puttupleslot(winstate->buffer, outerslot);
-		winstate->spooled_rows++;
+		if (winstate->status != WINDOWAGG_PASSTHROUGH_STRICT)
+		{
+			tuplestore_puttupleslot(winstate->buffer, outerslot);
+			winstate->spooled_rows++;
+		}
 	}
 
 	MemoryContextSwitchTo(oldcontext);
@@ -2016,20 +2027,24 @@ update_grouptailpos(WindowAggState *winstate)
  *	ExecWindowAgg receives tuples from its outer subplan and
  *	stores them into a tuplestore, then processes window functions.
  *	This node doesn't reduce nor qualify any row so the number of
- *	returned rows is exactly the same as its outer subplan's result.
+ *	returned rows is exactly the same as its outer subplan's result,
+ *	except when it has a run condition: once that fails, the rest of the
+ *	partition is skipped if this is the top-level WindowAgg, or returned
+ *	with NULL window function results otherwise.
  * -----------------
  */
 static TupleTableSlot *
 ExecWindowAgg(PlanState *pstate)
 {
 	WindowAggState *winstate = castNode(WindowAggState, pstate);
+	TupleTableSlot *slot;
 	ExprContext *econtext;
 	int			i;
 	int			numfuncs;
 
 	CHECK_FOR_INTERRUPTS();
 
-	if (winstate->all_done)
+	if (winstate->status == WINDOWAGG_DONE)
 		return NULL;
 
 	/*
@@ -2099,143 +2114,210 @@ ExecWindowAgg(PlanState *pstate)
 		winstate->all_first = false;
 	}
 
-	if (winstate->buffer == NULL)
-	{
-		/* Initialize for first partition and set current row = 0 */
-		begin_partition(winstate);
-		/* If there are no input rows, we'll detect that and exit below */
-	}
-	else
-	{
-		/* Advance current row within partition */
-		winstate->currentpos++;
-		/* This might mean that the frame moves, too */
-		winstate->framehead_valid = false;
-		winstate->frametail_valid = false;
-		/* we don't need to invalidate grouptail here; see below */
-	}
-
-	/*
-	 * Spool all tuples up to and including the current row, if we haven't
-	 * already
-	 */
-	spool_tuples(winstate, winstate->currentpos);
-
-	/* Move to the next partition if we reached the end of this partition */
-	if (winstate->partition_spooled &&
-		winstate->currentpos >= winstate->spooled_rows)
+	for (;;)
 	{
-		release_partition(winstate);
+		CHECK_FOR_INTERRUPTS();
 
-		if (winstate->more_partitions)
+		if (winstate->buffer == NULL)
 		{
+			/* Initialize for first partition and set current row = 0 */
 			begin_partition(winstate);
-			Assert(winstate->spooled_rows > 0);
+			/* If there are no input rows, we'll detect that and exit below */
 		}
 		else
 		{
-			winstate->all_done = true;
-			return NULL;
+			/* Advance current row within partition */
+			winstate->currentpos++;
+			/* This might mean that the frame moves, too */
+			winstate->framehead_valid = false;
+			winstate->frametail_valid = false;
+			/* we don't need to invalidate grouptail here; see below */
 		}
-	}
 
-	/* final output execution is in ps_ExprContext */
-	econtext = winstate->ss.ps.ps_ExprContext;
+		/*
+		 * Spool all tuples up to and including the current row, if we
+		 * haven't already
+		 */
+		spool_tuples(winstate, winstate->currentpos);
 
-	/* Clear the per-output-tuple context for current row */
-	ResetExprContext(econtext);
+		/* Move to the next partition if we reached the end of this partition */
+		if (winstate->partition_spooled &&
+			winstate->currentpos >= winstate->spooled_rows)
+		{
+			release_partition(winstate);
 
-	/*
-	 * Read the current row from the tuplestore, and save in ScanTupleSlot.
-	 * (We can't rely on the outerplan's output slot because we may have to
-	 * read beyond the current row.  Also, we have to actually copy the row
-	 * out of the tuplestore, since window function evaluation might cause the
-	 * tuplestore to dump its state to disk.)
-	 *
-	 * In GROUPS mode, or when tracking a group-oriented exclusion clause, we
-	 * must also detect entering a new peer group and update associated state
-	 * when that happens.  We use temp_slot_2 to temporarily hold the previous
-	 * row for this purpose.
-	 *
-	 * Current row must be in the tuplestore, since we spooled it above.
-	 */
-	tuplestore_select_read_pointer(winstate->buffer, winstate->current_ptr);
-	if ((winstate->frameOptions & (FRAMEOPTION_GROUPS |
-								   FRAMEOPTION_EXCLUDE_GROUP |
-								   FRAMEOPTION_EXCLUDE_TIES)) &&
-		winstate->currentpos > 0)
-	{
-		ExecCopySlot(winstate->temp_slot_2, winstate->ss.ss_ScanTupleSlot);
-		if (!tuplestore_gettupleslot(winstate->buffer, true, true,
-									 winstate->ss.ss_ScanTupleSlot))
-			elog(ERROR, "unexpected end of tuplestore");
-		if (!are_peers(winstate, winstate->temp_slot_2,
-					   winstate->ss.ss_ScanTupleSlot))
+			if (winstate->more_partitions)
+			{
+				begin_partition(winstate);
+				Assert(winstate->spooled_rows > 0);
+
+				/* Come out of pass-through mode when changing partition */
+				winstate->status = WINDOWAGG_RUN;
+			}
+			else
+			{
+				/* No further partitions?  We're done */
+				winstate->status = WINDOWAGG_DONE;
+				return NULL;
+			}
+		}
+
+		/* final output execution is in ps_ExprContext */
+		econtext = winstate->ss.ps.ps_ExprContext;
+
+		/* Clear the per-output-tuple context for current row */
+		ResetExprContext(econtext);
+
+		/*
+		 * Read the current row from the tuplestore, and save in
+		 * ScanTupleSlot. (We can't rely on the outerplan's output slot
+		 * because we may have to read beyond the current row.  Also, we have
+		 * to actually copy the row out of the tuplestore, since window
+		 * function evaluation might cause the tuplestore to dump its state to
+		 * disk.)
+		 *
+		 * In GROUPS mode, or when tracking a group-oriented exclusion clause,
+		 * we must also detect entering a new peer group and update associated
+		 * state when that happens.  We use temp_slot_2 to temporarily hold
+		 * the previous row for this purpose.
+		 *
+		 * Current row must be in the tuplestore, since we spooled it above.
+		 */
+		tuplestore_select_read_pointer(winstate->buffer, winstate->current_ptr);
+		if ((winstate->frameOptions & (FRAMEOPTION_GROUPS |
+									   FRAMEOPTION_EXCLUDE_GROUP |
+									   FRAMEOPTION_EXCLUDE_TIES)) &&
+			winstate->currentpos > 0)
 		{
-			winstate->currentgroup++;
-			winstate->groupheadpos = winstate->currentpos;
-			winstate->grouptail_valid = false;
+			ExecCopySlot(winstate->temp_slot_2, winstate->ss.ss_ScanTupleSlot);
+			if (!tuplestore_gettupleslot(winstate->buffer, true, true,
+										 winstate->ss.ss_ScanTupleSlot))
+				elog(ERROR, "unexpected end of tuplestore");
+			if (!are_peers(winstate, winstate->temp_slot_2,
+						   winstate->ss.ss_ScanTupleSlot))
+			{
+				winstate->currentgroup++;
+				winstate->groupheadpos = winstate->currentpos;
+				winstate->grouptail_valid = false;
+			}
+			ExecClearTuple(winstate->temp_slot_2);
+		}
+		else
+		{
+			if (!tuplestore_gettupleslot(winstate->buffer, true, true,
+										 winstate->ss.ss_ScanTupleSlot))
+				elog(ERROR, "unexpected end of tuplestore");
 		}
-		ExecClearTuple(winstate->temp_slot_2);
-	}
-	else
-	{
-		if (!tuplestore_gettupleslot(winstate->buffer, true, true,
-									 winstate->ss.ss_ScanTupleSlot))
-			elog(ERROR, "unexpected end of tuplestore");
-	}
 
-	/*
-	 * Evaluate true window functions
-	 */
-	numfuncs = winstate->numfuncs;
-	for (i = 0; i < numfuncs; i++)
-	{
-		WindowStatePerFunc perfuncstate = &(winstate->perfunc[i]);
+		/* Window functions aren't evaluated in pass-through mode */
+		if (winstate->status == WINDOWAGG_RUN)
+		{
+			/*
+			 * Evaluate true window functions
+			 */
+			numfuncs = winstate->numfuncs;
+			for (i = 0; i < numfuncs; i++)
+			{
+				WindowStatePerFunc perfuncstate = &(winstate->perfunc[i]);
 
-		if (perfuncstate->plain_agg)
-			continue;
-		eval_windowfunction(winstate, perfuncstate,
-							&(econtext->ecxt_aggvalues[perfuncstate->wfuncstate->wfuncno]),
-							&(econtext->ecxt_aggnulls[perfuncstate->wfuncstate->wfuncno]));
-	}
+				if (perfuncstate->plain_agg)
+					continue;
+				eval_windowfunction(winstate, perfuncstate,
+									&(econtext->ecxt_aggvalues[perfuncstate->wfuncstate->wfuncno]),
+									&(econtext->ecxt_aggnulls[perfuncstate->wfuncstate->wfuncno]));
+			}
 
-	/*
-	 * Evaluate aggregates
-	 */
-	if (winstate->numaggs > 0)
-		eval_windowaggregates(winstate);
+			/*
+			 * Evaluate aggregates
+			 */
+			if (winstate->numaggs > 0)
+				eval_windowaggregates(winstate);
+		}
 
-	/*
-	 * If we have created auxiliary read pointers for the frame or group
-	 * boundaries, force them to be kept up-to-date, because we don't know
-	 * whether the window function(s) will do anything that requires that.
-	 * Failing to advance the pointers would result in being unable to trim
-	 * data from the tuplestore, which is bad.  (If we could know in advance
-	 * whether the window functions will use frame boundary info, we could
-	 * skip creating these pointers in the first place ... but unfortunately
-	 * the window function API doesn't require that.)
-	 */
-	if (winstate->framehead_ptr >= 0)
-		update_frameheadpos(winstate);
-	if (winstate->frametail_ptr >= 0)
-		update_frametailpos(winstate);
-	if (winstate->grouptail_ptr >= 0)
-		update_grouptailpos(winstate);
+		/*
+		 * If we have created auxiliary read pointers for the frame or group
+		 * boundaries, force them to be kept up-to-date, because we don't know
+		 * whether the window function(s) will do anything that requires
+		 * that.  Failing to advance the pointers would result in being unable
+		 * to trim data from the tuplestore, which is bad.  (If we could know
+		 * in advance whether the window functions will use frame boundary
+		 * info, we could skip creating these pointers in the first place ...
+		 * but unfortunately the window function API doesn't require that.)
+		 */
+		if (winstate->framehead_ptr >= 0)
+			update_frameheadpos(winstate);
+		if (winstate->frametail_ptr >= 0)
+			update_frametailpos(winstate);
+		if (winstate->grouptail_ptr >= 0)
+			update_grouptailpos(winstate);
 
-	/*
-	 * Truncate any no-longer-needed rows from the tuplestore.
-	 */
-	tuplestore_trim(winstate->buffer);
+		/*
+		 * Truncate any no-longer-needed rows from the tuplestore.
+		 */
+		tuplestore_trim(winstate->buffer);
 
-	/*
-	 * Form and return a projection tuple using the windowfunc results and the
-	 * current row.  Setting ecxt_outertuple arranges that any Vars will be
-	 * evaluated with respect to that row.
-	 */
-	econtext->ecxt_outertuple = winstate->ss.ss_ScanTupleSlot;
+		/*
+		 * Form a projection tuple using the windowfunc results and the
+		 * current row.  Setting ecxt_outertuple arranges that any Vars will
+		 * be evaluated with respect to that row.
+		 */
+		econtext->ecxt_outertuple = winstate->ss.ss_ScanTupleSlot;
+
+		slot = ExecProject(winstate->ss.ps.ps_ProjInfo);
 
-	return ExecProject(winstate->ss.ps.ps_ProjInfo);
+		if (winstate->status == WINDOWAGG_RUN)
+		{
+			/*
+			 * Check the run condition against the row we just formed.  If it
+			 * fails, it must fail for all remaining rows of this partition.
+			 * The planner made its Vars INNER_VAR references to our output.
+			 */
+			econtext->ecxt_innertuple = slot;
+			if (!ExecQual(winstate->runcondition, econtext))
+			{
+				if (!winstate->use_pass_through)
+				{
+					/*
+					 * We're the top-level WindowAgg and there are no other
+					 * partitions, so nothing else can possibly match.
+					 */
+					winstate->status = WINDOWAGG_DONE;
+					return NULL;
+				}
+
+				/*
+				 * Otherwise we must go on reading rows, either to get to the
+				 * next partition or because WindowAggs above us need to see
+				 * all of them.  Our window function results are no longer updated
+				 * from here on, so NULL them rather than leave stale values
+				 * around; the qual in the upper query that the run condition
+				 * came from will filter these rows out.
+				 */
+				numfuncs = winstate->numfuncs;
+				for (i = 0; i < numfuncs; i++)
+				{
+					econtext->ecxt_aggvalues[i] = (Datum) 0;
+					econtext->ecxt_aggnulls[i] = true;
+				}
+
+				if (winstate->top_window)
+				{
+					/* Nobody above us needs the rest of this partition */
+					winstate->status = WINDOWAGG_PASSTHROUGH_STRICT;
+					continue;
+				}
+				winstate->status = WINDOWAGG_PASSTHROUGH;
+				slot = ExecProject(winstate->ss.ps.ps_ProjInfo);
+			}
+		}
+		else if (winstate->top_window)
+		{
+			/* Rows in pass-through mode are of no interest above us */
+			continue;
+		}
+
+		return slot;
+	}
 }
 
 /* -----------------
@@ -2307,6 +2389,18 @@ ExecInitWindowAgg(WindowAgg *node, EState *estate, int eflags)
 	Assert(node->plan.qual == NIL);
 	winstate->ss.ps.qual = NULL;
 
+	/* Initialize the run condition */
+	winstate->runcondition = ExecInitQual(node->runCondition,
+										  (PlanState *) winstate);
+
+	/*
+	 * When we're not the top-level WindowAgg node or we are but have a
+	 * PARTITION BY clause, we must move into one of the pass-through modes
+	 * when the run condition becomes false.  Otherwise we can just stop.
+	 */
+	winstate->use_pass_through = !node->topWindow || node->partNumCols > 0;
+	winstate->top_window = node->topWindow;
+
 	/*
 	 * initialize child nodes
 	 */
@@ -2519,6 +2613,7 @@ ExecInitWindowAgg(WindowAgg *node, EState *estate, int eflags)
 	winstate->inRangeNullsFirst = node->inRangeNullsFirst;
 
 	winstate->all_first = true;
+	winstate->status = WINDOWAGG_RUN;
 	winstate->partition_spooled = false;
 	winstate->more_partitions = false;
 
@@ -2579,7 +2674,7 @@ ExecReScanWindowAgg(WindowAggState *node)
 	PlanState  *outerPlan = outerPlanState(node);
 	ExprContext *econtext = node->ss.ps.ps_ExprContext;
 
-	node->all_done = false;
+	node->status = WINDOWAGG_RUN;
 	node->all_first = true;
 
 	/* release tuplestore et al */
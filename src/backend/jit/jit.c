@@ -38,6 +38,7 @@ bool		jit_profiling_support = false;
 bool		jit_tuple_deforming = true;
 double		jit_above_cost = 100000;
 double		jit_inline_above_cost = 500000;
+int			jit_defer_evaluations = 0;
 double		jit_optimize_above_cost = 500000;
 
 static JitProviderCallbacks provider;
@@ -145,12 +146,10 @@ jit_release_context(JitContext *context)
 }
 
 /*
- * Ask provider to JIT compile an expression.
- *
- * Returns true if successful, false if not.
+ * Should an attempt be made to JIT compile an expression?
  */
 bool
-jit_compile_expr(struct ExprState *state)
+jit_expr_wanted(struct ExprState *state)
 {
 	/*
 	 * We can easily create a one-off context for functions without an
@@ -172,6 +171,20 @@ jit_compile_expr(struct ExprState *state)
 	if (!(state->parent->state->es_jit_flags & PGJIT_EXPR))
 		return false;
 
+	return true;
+}
+
+/*
+ * Ask provider to JIT compile an expression.
+ *
+ * Returns true if successful, false if not.
+ */
+bool
+jit_compile_expr(struct ExprState *state)
+{
+	if (!jit_expr_wanted(state))
+		return false;
+
 	/* this also takes !jit_enabled into account */
 	if (provider_init())
 		return provider.compile_expr(state);
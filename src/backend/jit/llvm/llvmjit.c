@@ -52,6 +52,8 @@ typedef struct LLVMJitHandle
 	LLVMOrcJITStackRef stack;
 	LLVMOrcModuleHandle orc_handle;
 #endif
+	/* keep the code after the context is released, see llvmjit_deform.c */
+	bool		retain;
 } LLVMJitHandle;
 
 
@@ -91,6 +93,7 @@ LLVMValueRef AttributeTemplate;
 LLVMModuleRef llvm_types_module = NULL;
 
 static bool llvm_session_initialized = false;
+static List *llvm_retained_handles = NIL;
 static size_t llvm_generation = 0;
 static const char *llvm_triple = NULL;
 static const char *llvm_layout = NULL;
@@ -187,6 +190,7 @@ llvm_release_context(JitContext *context)
 		LLVMDisposeModule(llvm_context->module);
 		llvm_context->module = NULL;
 	}
+	llvm_deform_cache_discard(llvm_context);
 
 	while (llvm_context->handles != NIL)
 	{
@@ -195,6 +199,16 @@ llvm_release_context(JitContext *context)
 		jit_handle = (LLVMJitHandle *) linitial(llvm_context->handles);
 		llvm_context->handles = list_delete_first(llvm_context->handles);
 
+		/* cached functions live in this module, so leave it alone */
+		if (jit_handle->retain)
+		{
+			MemoryContext oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+			llvm_retained_handles = lappend(llvm_retained_handles, jit_handle);
+			MemoryContextSwitchTo(oldcontext);
+			continue;
+		}
+
 #if LLVM_VERSION_MAJOR > 11
 		{
 			LLVMOrcExecutionSessionRef ee;
@@ -645,6 +659,7 @@ llvm_compile_module(LLVMJitContext *context)
 
 	handle = (LLVMJitHandle *)
 		MemoryContextAlloc(TopMemoryContext, sizeof(LLVMJitHandle));
+	handle->retain = false;
 
 	/*
 	 * Emit the code. Note that this can, depending on the optimization
@@ -726,6 +741,16 @@ llvm_compile_module(LLVMJitContext *context)
 	context->handles = lappend(context->handles, handle);
 	MemoryContextSwitchTo(oldcontext);
 
+	/*
+	 * If deform functions of this module are to be cached for use by later
+	 * queries, the module has to survive the context.
+	 */
+	if (context->deform_pending != NIL)
+	{
+		handle->retain = true;
+		llvm_deform_cache_publish(context);
+	}
+
 	ereport(DEBUG1,
 			(errmsg("time to inline: %.3fs, opt: %.3fs, emit: %.3fs",
 					INSTR_TIME_GET_DOUBLE(context->base.instr.inlining_counter),
@@ -7,6 +7,12 @@
  * knowledge of the tuple descriptor. Fixed column widths, NOT NULLness, etc
  * can be taken advantage of.
  *
+ * The generated code depends only on the properties of the tuple descriptor
+ * and slot type it's generated for, not on any particular query, so emitted
+ * deform functions are remembered in a small per-backend cache and reused by
+ * later queries, e.g. further executions of a prepared statement, instead of
+ * being generated and optimized again.
+ *
  * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -22,10 +28,166 @@
 
 #include "access/htup_details.h"
 #include "access/tupdesc_details.h"
+#include "common/hashfn.h"
 #include "executor/tuptable.h"
 #include "jit/llvmjit.h"
 #include "jit/llvmjit_emit.h"
+#include "utils/memutils.h"
+
+/*
+ * Maximum number of cached deform functions.  Each cached function keeps
+ * the module it was emitted in alive for the rest of the backend's life, so
+ * this must stay small.
+ */
+#define DEFORM_CACHE_SIZE	64
+
+/* Properties of a column that the generated deform code depends on */
+typedef struct DeformCacheAttr
+{
+	int16		attlen;
+	char		attalign;
+	bool		attbyval;
+	bool		attnotnull;
+	bool		atthasmissing;
+	bool		attisdropped;
+} DeformCacheAttr;
+
+/* Identifies a deform function, followed by desc_natts DeformCacheAttrs */
+typedef struct DeformCacheKey
+{
+	const TupleTableSlotOps *ops;
+	int			natts;
+	int			desc_natts;
+	bool		optimized;
+	DeformCacheAttr attrs[FLEXIBLE_ARRAY_MEMBER];
+} DeformCacheKey;
+
+typedef struct DeformCacheEntry
+{
+	uint32		hash;
+	Size		keylen;
+	DeformCacheKey *key;
+	char	   *funcname;		/* name in the module it was emitted in */
+	void	   *fn;				/* address, once emitted */
+	LLVMValueRef v_fn;			/* pending entries: function in the module */
+} DeformCacheEntry;
+
+/* emitted, reusable deform functions, in TopMemoryContext */
+static List *deform_cache = NIL;
+static int	deform_cache_nentries = 0;	/* including pending ones */
+
+static DeformCacheKey *deform_cache_key(LLVMJitContext *context,
+										TupleDesc desc,
+										const TupleTableSlotOps *ops,
+										int natts, Size *keylen);
+static DeformCacheEntry *deform_cache_lookup(List *entries, uint32 hash,
+											 DeformCacheKey *key,
+											 Size keylen);
+
+
+/*
+ * Build the cache key for a deform function, in the current memory context.
+ */
+static DeformCacheKey *
+deform_cache_key(LLVMJitContext *context, TupleDesc desc,
+				 const TupleTableSlotOps *ops, int natts, Size *keylen)
+{
+	DeformCacheKey *key;
+	Size		len;
+
+	len = offsetof(DeformCacheKey, attrs) + sizeof(DeformCacheAttr) * desc->natts;
+
+	/* zeroed, so that padding compares equal */
+	key = palloc0(len);
+	key->ops = ops;
+	key->natts = natts;
+	key->desc_natts = desc->natts;
+	key->optimized = (context->base.flags & PGJIT_OPT3) != 0;
+
+	for (int attnum = 0; attnum < desc->natts; attnum++)
+	{
+		Form_pg_attribute att = TupleDescAttr(desc, attnum);
+		DeformCacheAttr *cattr = &key->attrs[attnum];
+
+		cattr->attlen = att->attlen;
+		cattr->attalign = att->attalign;
+		cattr->attbyval = att->attbyval;
+		cattr->attnotnull = att->attnotnull;
+		cattr->atthasmissing = att->atthasmissing;
+		cattr->attisdropped = att->attisdropped;
+	}
+
+	*keylen = len;
+	return key;
+}
 
+static DeformCacheEntry *
+deform_cache_lookup(List *entries, uint32 hash, DeformCacheKey *key,
+					Size keylen)
+{
+	ListCell   *lc;
+
+	foreach(lc, entries)
+	{
+		DeformCacheEntry *entry = (DeformCacheEntry *) lfirst(lc);
+
+		if (entry->hash == hash && entry->keylen == keylen &&
+			memcmp(entry->key, key, keylen) == 0)
+			return entry;
+	}
+
+	return NULL;
+}
+
+/*
+ * Add the deform functions generated in the module that has just been
+ * emitted by llvm_compile_module() to the cache.
+ *
+ * The caller has to make sure the module's code outlives the context.
+ */
+void
+llvm_deform_cache_publish(LLVMJitContext *context)
+{
+	MemoryContext oldcontext;
+
+	Assert(context->compiled);
+
+	while (context->deform_pending != NIL)
+	{
+		DeformCacheEntry *entry;
+
+		entry = (DeformCacheEntry *) linitial(context->deform_pending);
+		entry->fn = llvm_get_function(context, entry->funcname);
+		entry->v_fn = NULL;
+
+		oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+		context->deform_pending = list_delete_first(context->deform_pending);
+		deform_cache = lappend(deform_cache, entry);
+		MemoryContextSwitchTo(oldcontext);
+	}
+}
+
+/*
+ * Forget about deform functions of a module that was never emitted.
+ */
+void
+llvm_deform_cache_discard(LLVMJitContext *context)
+{
+	ListCell   *lc;
+
+	foreach(lc, context->deform_pending)
+	{
+		DeformCacheEntry *entry = (DeformCacheEntry *) lfirst(lc);
+
+		pfree(entry->key);
+		pfree(entry->funcname);
+		pfree(entry);
+		deform_cache_nentries--;
+	}
+
+	list_free(context->deform_pending);
+	context->deform_pending = NIL;
+}
 
 /*
  * Create a function that deforms a tuple of type desc up to natts columns.
@@ -78,6 +240,11 @@ slot_compile_deform(LLVMJitContext *context, TupleDesc desc,
 
 	LLVMValueRef v_hasnulls;
 
+	DeformCacheKey *key;
+	Size		keylen;
+	uint32		hash;
+	DeformCacheEntry *entry;
+
 	/* last column (0 indexed) guaranteed to exist */
 	int			guaranteed_column_number = -1;
 
@@ -100,6 +267,37 @@ slot_compile_deform(LLVMJitContext *context, TupleDesc desc,
 
 	mod = llvm_mutable_module(context);
 
+	/* Create the signature */
+	{
+		LLVMTypeRef param_types[1];
+
+		param_types[0] = l_ptr(StructTupleTableSlot);
+
+		deform_sig = LLVMFunctionType(LLVMVoidType(), param_types,
+									  lengthof(param_types), 0);
+	}
+
+	/*
+	 * Reuse an equivalent function if one was emitted before, or is already
+	 * part of the current module.
+	 */
+	key = deform_cache_key(context, desc, ops, natts, &keylen);
+	hash = hash_bytes((const unsigned char *) key, keylen);
+
+	entry = deform_cache_lookup(deform_cache, hash, key, keylen);
+	if (entry)
+	{
+		pfree(key);
+		return l_ptr_const(entry->fn, l_ptr(deform_sig));
+	}
+
+	entry = deform_cache_lookup(context->deform_pending, hash, key, keylen);
+	if (entry)
+	{
+		pfree(key);
+		return entry->v_fn;
+	}
+
 	funcname = llvm_expand_funcname(context, "deform");
 
 	/*
@@ -127,20 +325,36 @@ slot_compile_deform(LLVMJitContext *context, TupleDesc desc,
 			guaranteed_column_number = attnum;
 	}
 
-	/* Create the signature and function */
-	{
-		LLVMTypeRef param_types[1];
-
-		param_types[0] = l_ptr(StructTupleTableSlot);
-
-		deform_sig = LLVMFunctionType(LLVMVoidType(), param_types,
-									  lengthof(param_types), 0);
-	}
+	/* Create the function */
 	v_deform_fn = LLVMAddFunction(mod, funcname, deform_sig);
-	LLVMSetLinkage(v_deform_fn, LLVMInternalLinkage);
 	LLVMSetParamAlignment(LLVMGetParam(v_deform_fn, 0), MAXIMUM_ALIGNOF);
 	llvm_copy_attributes(AttributeTemplate, v_deform_fn);
 
+	/*
+	 * Remember the function for the cache, if there's room.  It has to be
+	 * externally visible so its address can be looked up once the module is
+	 * emitted.
+	 */
+	if (deform_cache_nentries < DEFORM_CACHE_SIZE)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+		entry = palloc0(sizeof(DeformCacheEntry));
+		entry->hash = hash;
+		entry->keylen = keylen;
+		entry->key = palloc(keylen);
+		memcpy(entry->key, key, keylen);
+		entry->funcname = pstrdup(funcname);
+		entry->v_fn = v_deform_fn;
+		context->deform_pending = lappend(context->deform_pending, entry);
+		deform_cache_nentries++;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+	else
+		LLVMSetLinkage(v_deform_fn, LLVMInternalLinkage);
+	pfree(key);
+
 	b_entry =
 		LLVMAppendBasicBlock(v_deform_fn, "entry");
 	b_adjust_unavail_cols =
@@ -149,6 +149,14 @@ struct dshash_table
 #define BUCKET_INDEX_FOR_HASH_AND_SIZE(hash, size_log2)		\
 	(hash >> ((sizeof(dshash_hash) * CHAR_BIT) - (size_log2)))
 
+/* The number of buckets at a given size. */
+#define NUM_BUCKETS(size_log2)		\
+	(((size_t) 1) << (size_log2))
+
+/* The partition covering a given bucket index. */
+#define PARTITION_FOR_BUCKET_INDEX(bucket_idx, size_log2)	\
+	((bucket_idx) >> NUM_SPLITS(size_log2))
+
 /* The index of the first bucket in a given partition. */
 #define BUCKET_INDEX_FOR_PARTITION(partition, size_log2)	\
 	((partition) << NUM_SPLITS(size_log2))
@@ -574,6 +582,124 @@ dshash_release_lock(dshash_table *hash_table, void *entry)
 	LWLockRelease(PARTITION_LOCK(hash_table, partition_index));
 }
 
+/*
+ * Initialize a sequential scan over the entire hash table.
+ *
+ * The scan visits partitions in order, holding the lock on the current
+ * partition (in exclusive mode if 'exclusive' is true) until it moves on to
+ * the next one, so the table can't be resized under it.  The caller must not
+ * hold any other lock on the table, and must call dshash_seq_term when done,
+ * even if the scan was abandoned early.
+ */
+void
+dshash_seq_init(dshash_seq_status *status, dshash_table *hash_table,
+				bool exclusive)
+{
+	status->hash_table = hash_table;
+	status->curbucket = 0;
+	status->nbuckets = 0;
+	status->curitem = NULL;
+	status->pnextitem = InvalidDsaPointer;
+	status->curpartition = -1;
+	status->exclusive = exclusive;
+}
+
+/*
+ * Return the next entry of a sequential scan, or NULL when all entries have
+ * been returned.  The returned entry may be removed with
+ * dshash_delete_current if the scan is exclusive.
+ */
+void *
+dshash_seq_next(dshash_seq_status *status)
+{
+	dshash_table *hash_table = status->hash_table;
+	LWLockMode	lockmode = status->exclusive ? LW_EXCLUSIVE : LW_SHARED;
+	dsa_pointer next_item_pointer;
+
+	if (status->curpartition == -1)
+	{
+		Assert(status->curbucket == 0);
+		Assert(!hash_table->find_locked);
+
+		/*
+		 * Partitions are visited in order, so start by locking partition 0.
+		 * Once any partition lock is held the table can't be resized, so the
+		 * bucket pointers stay valid for the rest of the scan.
+		 */
+		status->curpartition = 0;
+		LWLockAcquire(PARTITION_LOCK(hash_table, 0), lockmode);
+		ensure_valid_bucket_pointers(hash_table);
+
+		status->nbuckets = NUM_BUCKETS(hash_table->size_log2);
+		next_item_pointer = hash_table->buckets[status->curbucket];
+	}
+	else
+		next_item_pointer = status->pnextitem;
+
+	/* Advance to the next non-empty bucket if this one is exhausted */
+	while (!DsaPointerIsValid(next_item_pointer))
+	{
+		int			next_partition;
+
+		if (++status->curbucket >= status->nbuckets)
+			return NULL;
+
+		next_partition = PARTITION_FOR_BUCKET_INDEX(status->curbucket,
+													hash_table->size_log2);
+		if (status->curpartition != next_partition)
+		{
+			/*
+			 * Lock the next partition before releasing the current one, in
+			 * the same order resize() uses, so that no resize can sneak in.
+			 */
+			LWLockAcquire(PARTITION_LOCK(hash_table, next_partition),
+						  lockmode);
+			LWLockRelease(PARTITION_LOCK(hash_table, status->curpartition));
+			status->curpartition = next_partition;
+		}
+
+		next_item_pointer = hash_table->buckets[status->curbucket];
+	}
+
+	status->curitem = dsa_get_address(hash_table->area, next_item_pointer);
+
+	/* Remember the successor, in case the caller deletes this item */
+	status->pnextitem = status->curitem->next;
+
+	return ENTRY_FROM_ITEM(status->curitem);
+}
+
+/*
+ * End a sequential scan, releasing the partition lock it holds, if any.
+ */
+void
+dshash_seq_term(dshash_seq_status *status)
+{
+	if (status->curpartition >= 0)
+		LWLockRelease(PARTITION_LOCK(status->hash_table,
+									 status->curpartition));
+	status->curpartition = -1;
+}
+
+/*
+ * Remove the entry most recently returned by dshash_seq_next.  The scan must
+ * have been started in exclusive mode.
+ */
+void
+dshash_delete_current(dshash_seq_status *status)
+{
+	dshash_table *hash_table = status->hash_table;
+	dshash_table_item *item = status->curitem;
+
+	Assert(status->exclusive);
+	Assert(hash_table->control->magic == DSHASH_MAGIC);
+	Assert(LWLockHeldByMeInMode(PARTITION_LOCK(hash_table,
+											   PARTITION_FOR_HASH(item->hash)),
+								LW_EXCLUSIVE));
+
+	delete_item(hash_table, item);
+}
+
 /*
  * A compare function that forwards to memcmp.
  */
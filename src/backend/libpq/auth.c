@@ -393,6 +393,16 @@ ClientAuthentication(Port *port)
 	}
 #endif
 
+	/*
+	 * A client of a connection proxy reaches us through the proxy's socket,
+	 * so we can't ask the kernel or an ident server who is at the other end.
+	 */
+	if (port->proxied &&
+		(port->hba->auth_method == uaPeer || port->hba->auth_method == uaIdent))
+		ereport(FATAL,
+				(errcode(ERRCODE_INVALID_AUTHORIZATION_SPECIFICATION),
+				 errmsg("peer and ident authentication are not supported through a connection proxy")));
+
 	/*
 	 * Now proceed to do the actual authentication check
 	 */
@@ -628,6 +638,21 @@ ClientAuthentication(Port *port)
 		auth_failed(port, status, logdetail);
 }
 
+/*
+ * ClientAuthenticationBypass
+ *
+ * Accept a connection from a connection proxy without authenticating it.
+ * Only the postmaster can create such connections, and each client of the
+ * proxy is authenticated separately later on; see ProxyAuthenticateClient.
+ */
+void
+ClientAuthenticationBypass(Port *port)
+{
+	Assert(port->proxied);
+
+	sendAuthRequest(port, AUTH_REQ_OK, NULL, 0);
+}
+
 
 /*
  * Send an authentication request packet to the frontend.
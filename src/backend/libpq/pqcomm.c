@@ -87,6 +87,7 @@
 #endif
 
 #include "common/ip.h"
+#include "common/protocol_compression.h"
 #include "libpq/libpq.h"
 #include "miscadmin.h"
 #include "port/pg_bswap.h"
@@ -137,10 +138,35 @@ static int	PqSendBufferSize;	/* Size send buffer */
 static int	PqSendPointer;		/* Next index to store a byte in PqSendBuffer */
 static int	PqSendStart;		/* Next index to send a byte in PqSendBuffer */
 
-static char PqRecvBuffer[PQ_RECV_BUFFER_SIZE];
+static char PqRecvRawBuffer[PQ_RECV_BUFFER_SIZE];
+static char *PqRecvBuffer = PqRecvRawBuffer;
 static int	PqRecvPointer;		/* Next index to read a byte from PqRecvBuffer */
 static int	PqRecvLength;		/* End of data available in PqRecvBuffer */
 
+/*
+ * Protocol compression state (see common/protocol_compression.c).
+ *
+ * Outgoing DataRow and CopyData messages go through PqSendCompressor into
+ * PqCompressBuffer, and are only copied to PqSendBuffer, as a CompressedData
+ * message, when the block is ended.  PqCompressPending counts the
+ * uncompressed bytes in the current block.
+ *
+ * When a CompressedData message arrives, its contents are decompressed into
+ * PqDecompressBuffer and PqRecvBuffer is pointed there until they have been
+ * read, with the raw buffer's read state saved in PqRawRecvPointer and
+ * PqRawRecvLength.
+ */
+static PqCompressor *PqSendCompressor = NULL;
+static PqCompressionBuffer PqCompressBuffer;
+static size_t PqCompressPending = 0;
+static PqDecompressor *PqRecvDecompressor = NULL;
+static PqCompressionBuffer PqDecompressBuffer;
+static int	PqRawRecvPointer;
+static int	PqRawRecvLength;
+
+/* GUC variable */
+bool		protocol_compression = true;
+
 /*
  * Message status
  */
@@ -160,8 +186,14 @@ static int	socket_putmessage(char msgtype, const char *s, size_t len);
 static void socket_putmessage_noblock(char msgtype, const char *s, size_t len);
 static void socket_startcopyout(void);
 static void socket_endcopyout(bool errorAbort);
+static int	internal_putmessage(char msgtype, const char *s, size_t len,
+								bool noblock);
+static int	socket_putmessages(const char *s, size_t len);
 static int	internal_putbytes(const char *s, size_t len);
 static int	internal_flush(void);
+static int	internal_flush_buffer(const char *buf, int *start, int *end);
+static int	internal_end_compressed_block(bool noblock);
+static int	pq_decompress_message(void);
 
 #ifdef HAVE_UNIX_SOCKETS
 static int	Lock_AF_UNIX(const char *unixSocketDir, const char *unixSocketPath);
@@ -175,6 +207,7 @@ static const PQcommMethods PqCommSocketMethods = {
 	socket_is_send_pending,
 	socket_putmessage,
 	socket_putmessage_noblock,
+	socket_putmessages,
 	socket_startcopyout,
 	socket_endcopyout
 };
@@ -225,6 +258,27 @@ pq_init(void)
 	AddWaitEventToSet(FeBeWaitSet, WL_POSTMASTER_DEATH, -1, NULL, NULL);
 }
 
+/* --------------------------------
+ *		pq_enable_compression - start compressing the protocol stream
+ *
+ * Called once the client has been told which method we chose; everything
+ * sent or received after that may be compressed.
+ * --------------------------------
+ */
+void
+pq_enable_compression(PqCompressionMethod method)
+{
+	Assert(PqSendCompressor == NULL && PqRecvDecompressor == NULL);
+
+	PqSendCompressor = pq_compressor_create(method);
+	PqRecvDecompressor = pq_decompressor_create(method);
+	if (PqSendCompressor == NULL || PqRecvDecompressor == NULL)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("could not initialize %s compression",
+						pq_compression_method_name(method))));
+}
+
 /* --------------------------------
  *		socket_comm_reset - reset libpq during error recovery
  *
@@ -860,6 +914,163 @@ StreamClose(pgsocket sock)
 	closesocket(sock);
 }
 
+/*
+ * StreamSendSocket -- pass a socket to another process
+ *
+ * The socket is sent over channel, which must be a Unix-domain stream
+ * socket, together with len bytes of data for the receiver.  Passing no data
+ * is fine; a dummy byte is sent then, since the socket has to ride along with
+ * something.  The caller still has to close its own descriptor for sock.
+ *
+ * Returns false, with errno set, on failure.
+ */
+bool
+StreamSendSocket(pgsocket channel, pgsocket sock, const void *data, size_t len)
+{
+#ifndef WIN32
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	union
+	{
+		struct cmsghdr hdr;
+		char		buf[CMSG_SPACE(sizeof(int))];
+	}			cmsgbuf;
+	char		dummy = 'S';
+	const char *ptr;
+	ssize_t		rc;
+
+	if (len == 0)
+	{
+		data = &dummy;
+		len = 1;
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = unconstify(void *, data);
+	iov.iov_len = len;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &sock, sizeof(int));
+
+	do
+	{
+		rc = sendmsg(channel, &msg, 0);
+	} while (rc < 0 && errno == EINTR);
+	if (rc <= 0)
+		return false;
+
+	/* The socket went with the first byte; send whatever didn't fit */
+	ptr = (const char *) data + rc;
+	len -= rc;
+	while (len > 0)
+	{
+		rc = send(channel, ptr, len, 0);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc <= 0)
+			return false;
+		ptr += rc;
+		len -= rc;
+	}
+
+	return true;
+#else
+	errno = ENOSYS;
+	return false;
+#endif
+}
+
+/*
+ * StreamReceiveSocket -- receive a socket sent with StreamSendSocket
+ *
+ * data and len must match what the sender passed.  Blocks until all the
+ * data has arrived, unless channel is in nonblocking mode and nothing has
+ * arrived yet.
+ *
+ * Returns PGINVALID_SOCKET on failure, including when the sender has closed
+ * the channel.
+ */
+pgsocket
+StreamReceiveSocket(pgsocket channel, void *data, size_t len)
+{
+#ifndef WIN32
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	union
+	{
+		struct cmsghdr hdr;
+		char		buf[CMSG_SPACE(sizeof(int))];
+	}			cmsgbuf;
+	char		dummy;
+	char	   *ptr;
+	ssize_t		rc;
+	int			sock;
+
+	if (len == 0)
+	{
+		data = &dummy;
+		len = 1;
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = data;
+	iov.iov_len = len;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+	do
+	{
+		rc = recvmsg(channel, &msg, 0);
+	} while (rc < 0 && errno == EINTR);
+	if (rc <= 0)
+		return PGINVALID_SOCKET;
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET ||
+		cmsg->cmsg_type != SCM_RIGHTS ||
+		cmsg->cmsg_len != CMSG_LEN(sizeof(int)))
+		return PGINVALID_SOCKET;
+	memcpy(&sock, CMSG_DATA(cmsg), sizeof(int));
+
+	/* Collect the rest of the data, if it came separately */
+	ptr = (char *) data + rc;
+	len -= rc;
+	while (len > 0)
+	{
+		rc = recv(channel, ptr, len, 0);
+		if (rc < 0 && (errno == EINTR || errno == EWOULDBLOCK))
+		{
+			/* it's on its way; wait for it even on a nonblocking channel */
+			if (errno == EWOULDBLOCK)
+				pg_usleep(1000L);
+			continue;
+		}
+		if (rc <= 0)
+		{
+			closesocket(sock);
+			return PGINVALID_SOCKET;
+		}
+		ptr += rc;
+		len -= rc;
+	}
+
+	return sock;
+#else
+	return PGINVALID_SOCKET;
+#endif
+}
+
 /*
  * TouchSocketFiles -- mark socket files as recently accessed
  *
@@ -940,6 +1151,16 @@ socket_set_nonblocking(bool nonblocking)
 static int
 pq_recvbuf(void)
 {
+	if (PqRecvBuffer != PqRecvRawBuffer)
+	{
+		/* Done with the decompressed messages, go back to the raw input */
+		PqRecvBuffer = PqRecvRawBuffer;
+		PqRecvPointer = PqRawRecvPointer;
+		PqRecvLength = PqRawRecvLength;
+		if (PqRecvPointer < PqRecvLength)
+			return 0;
+	}
+
 	if (PqRecvPointer > 0)
 	{
 		if (PqRecvLength > PqRecvPointer)
@@ -1003,12 +1224,27 @@ pq_getbyte(void)
 {
 	Assert(PqCommReadingMsg);
 
-	while (PqRecvPointer >= PqRecvLength)
+	for (;;)
 	{
-		if (pq_recvbuf())		/* If nothing in buffer, then recv some */
-			return EOF;			/* Failed to recv data */
+		unsigned char c;
+
+		while (PqRecvPointer >= PqRecvLength)
+		{
+			if (pq_recvbuf())	/* If nothing in buffer, then recv some */
+				return EOF;		/* Failed to recv data */
+		}
+		c = PqRecvBuffer[PqRecvPointer++];
+
+		/*
+		 * Callers use this to read message types, so this is where we unpack
+		 * CompressedData messages, and return the first message in them
+		 * instead.
+		 */
+		if (c != PQ_MSG_COMPRESSED_DATA || PqRecvDecompressor == NULL)
+			return c;
+		if (pq_decompress_message())
+			return EOF;
 	}
-	return (unsigned char) PqRecvBuffer[PqRecvPointer++];
 }
 
 /* --------------------------------
@@ -1045,42 +1281,65 @@ pq_getbyte_if_available(unsigned char *c)
 
 	Assert(PqCommReadingMsg);
 
+	if (PqRecvPointer >= PqRecvLength && PqRecvBuffer != PqRecvRawBuffer)
+	{
+		/* Done with the decompressed messages, go back to the raw input */
+		PqRecvBuffer = PqRecvRawBuffer;
+		PqRecvPointer = PqRawRecvPointer;
+		PqRecvLength = PqRawRecvLength;
+	}
+
 	if (PqRecvPointer < PqRecvLength)
 	{
 		*c = PqRecvBuffer[PqRecvPointer++];
-		return 1;
+		r = 1;
 	}
-
-	/* Put the socket into non-blocking mode */
-	socket_set_nonblocking(true);
-
-	r = secure_read(MyProcPort, c, 1);
-	if (r < 0)
+	else
 	{
-		/*
-		 * Ok if no data available without blocking or interrupted (though
-		 * EINTR really shouldn't happen with a non-blocking socket). Report
-		 * other errors.
-		 */
-		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
-			r = 0;
-		else
+		/* Put the socket into non-blocking mode */
+		socket_set_nonblocking(true);
+
+		r = secure_read(MyProcPort, c, 1);
+		if (r < 0)
 		{
 			/*
-			 * Careful: an ereport() that tries to write to the client would
-			 * cause recursion to here, leading to stack overflow and core
-			 * dump!  This message must go *only* to the postmaster log.
+			 * Ok if no data available without blocking or interrupted (though
+			 * EINTR really shouldn't happen with a non-blocking socket).
+			 * Report other errors.
 			 */
-			ereport(COMMERROR,
-					(errcode_for_socket_access(),
-					 errmsg("could not receive data from client: %m")));
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+				r = 0;
+			else
+			{
+				/*
+				 * Careful: an ereport() that tries to write to the client
+				 * would cause recursion to here, leading to stack overflow
+				 * and core dump!  This message must go *only* to the
+				 * postmaster log.
+				 */
+				ereport(COMMERROR,
+						(errcode_for_socket_access(),
+						 errmsg("could not receive data from client: %m")));
+				r = EOF;
+			}
+		}
+		else if (r == 0)
+		{
+			/* EOF detected */
 			r = EOF;
 		}
 	}
-	else if (r == 0)
+
+	/*
+	 * As in pq_getbyte, unpack a CompressedData message.  Once its type byte
+	 * has arrived we read the rest of it even if that means waiting, the same
+	 * as callers do for the rest of any other message.
+	 */
+	if (r == 1 && *c == PQ_MSG_COMPRESSED_DATA && PqRecvDecompressor != NULL)
 	{
-		/* EOF detected */
-		r = EOF;
+		if (pq_decompress_message())
+			return EOF;
+		return pq_getbyte_if_available(c);
 	}
 
 	return r;
@@ -1149,6 +1408,99 @@ pq_discardbytes(size_t len)
 	return 0;
 }
 
+/* --------------------------------
+ *		pq_decompress_message	- unpack a CompressedData message
+ *
+ *		Called once the type byte of a CompressedData message has been read.
+ *		Reads the rest of it and makes PqRecvBuffer point to the decompressed
+ *		messages it contains; pq_recvbuf() switches back to the raw input
+ *		once they have been consumed.  The sender only compresses complete
+ *		messages, so no message straddles the two.
+ *
+ *		returns 0 if OK, EOF if trouble
+ * --------------------------------
+ */
+static int
+pq_decompress_message(void)
+{
+	int32		len;
+	char	   *buf;
+	const char *detail;
+
+	if (PqRecvBuffer != PqRecvRawBuffer)
+	{
+		ereport(COMMERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("unexpected compressed data message within compressed data")));
+		return EOF;
+	}
+
+	if (pq_getbytes((char *) &len, 4) == EOF)
+	{
+		ereport(COMMERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("unexpected EOF within message length word")));
+		return EOF;
+	}
+
+	len = pg_ntoh32(len);
+
+	if (len < 4 || len - 4 >= MaxAllocSize)
+	{
+		ereport(COMMERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("invalid message length")));
+		return EOF;
+	}
+	len -= 4;
+
+	buf = MemoryContextAllocExtended(TopMemoryContext, Max(len, 1),
+									 MCXT_ALLOC_NO_OOM);
+	if (buf == NULL)
+	{
+		if (pq_discardbytes(len) == EOF)
+			ereport(COMMERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("incomplete message from client")));
+		ereport(COMMERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+		return EOF;
+	}
+
+	if (pq_getbytes(buf, len) == EOF)
+	{
+		ereport(COMMERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("incomplete message from client")));
+		pfree(buf);
+		return EOF;
+	}
+
+	PqDecompressBuffer.len = 0;
+	if (!pq_decompress(PqRecvDecompressor, buf, len, &PqDecompressBuffer,
+					   &detail))
+	{
+		ereport(COMMERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("could not decompress data from client: %s", detail)));
+		pfree(buf);
+		return EOF;
+	}
+	pfree(buf);
+
+	if (PqDecompressBuffer.len > 0)
+	{
+		PqRawRecvPointer = PqRecvPointer;
+		PqRawRecvLength = PqRecvLength;
+		PqRecvBuffer = PqDecompressBuffer.data;
+		PqRecvPointer = 0;
+		PqRecvLength = PqDecompressBuffer.len;
+	}
+
+	return 0;
+}
+
 /* --------------------------------
  *		pq_getstring	- get a null terminated string from connection
  *
@@ -1381,6 +1733,21 @@ internal_putbytes(const char *s, size_t len)
 			if (internal_flush())
 				return EOF;
 		}
+
+		/*
+		 * If the buffer is empty and the data would fill it anyway, send the
+		 * data straight from the caller's memory instead of copying it
+		 * through the buffer.
+		 */
+		if (PqSendStart == PqSendPointer && len >= PqSendBufferSize)
+		{
+			int			start = 0;
+			int			end = (int) len;
+
+			socket_set_nonblocking(false);
+			return internal_flush_buffer(s, &start, &end);
+		}
+
 		amount = PqSendBufferSize - PqSendPointer;
 		if (amount > len)
 			amount = len;
@@ -1408,7 +1775,9 @@ socket_flush(void)
 		return 0;
 	PqCommBusy = true;
 	socket_set_nonblocking(false);
-	res = internal_flush();
+	res = internal_end_compressed_block(false);
+	if (res == 0)
+		res = internal_flush();
 	PqCommBusy = false;
 	return res;
 }
@@ -1422,11 +1791,24 @@ socket_flush(void)
  */
 static int
 internal_flush(void)
+{
+	return internal_flush_buffer(PqSendBuffer, &PqSendStart, &PqSendPointer);
+}
+
+/* --------------------------------
+ *		internal_flush_buffer - flush the given buffer content
+ *
+ * Sends buf[*start .. *end), advancing *start past what was sent.  Both are
+ * reset to zero once everything has been sent.  Returns as internal_flush.
+ * --------------------------------
+ */
+static int
+internal_flush_buffer(const char *buf, int *start, int *end)
 {
 	static int	last_reported_send_errno = 0;
 
-	char	   *bufptr = PqSendBuffer + PqSendStart;
-	char	   *bufend = PqSendBuffer + PqSendPointer;
+	char	   *bufptr = (char *) buf + *start;
+	char	   *bufend = (char *) buf + *end;
 
 	while (bufptr < bufend)
 	{
@@ -1472,7 +1854,7 @@ internal_flush(void)
 			 * flag that'll cause the next CHECK_FOR_INTERRUPTS to terminate
 			 * the connection.
 			 */
-			PqSendStart = PqSendPointer = 0;
+			*start = *end = 0;
 			ClientConnectionLost = 1;
 			InterruptPending = 1;
 			return EOF;
@@ -1480,10 +1862,10 @@ internal_flush(void)
 
 		last_reported_send_errno = 0;	/* reset after any successful send */
 		bufptr += r;
-		PqSendStart += r;
+		*start += r;
 	}
 
-	PqSendStart = PqSendPointer = 0;
+	*start = *end = 0;
 	return 0;
 }
 
@@ -1499,7 +1881,7 @@ socket_flush_if_writable(void)
 	int			res;
 
 	/* Quick exit if nothing to do */
-	if (PqSendPointer == PqSendStart)
+	if (PqSendPointer == PqSendStart && PqCompressPending == 0)
 		return 0;
 
 	/* No-op if reentrant call */
@@ -1510,7 +1892,9 @@ socket_flush_if_writable(void)
 	socket_set_nonblocking(true);
 
 	PqCommBusy = true;
-	res = internal_flush();
+	res = internal_end_compressed_block(true);
+	if (res == 0)
+		res = internal_flush();
 	PqCommBusy = false;
 	return res;
 }
@@ -1522,7 +1906,58 @@ socket_flush_if_writable(void)
 static bool
 socket_is_send_pending(void)
 {
-	return (PqSendStart < PqSendPointer);
+	return (PqSendStart < PqSendPointer || PqCompressPending > 0);
+}
+
+/* --------------------------------
+ *		internal_end_compressed_block - write out compressed messages
+ *
+ *		Flushes the compression stream and appends its output to the send
+ *		buffer as a CompressedData message.  With noblock, the send buffer
+ *		is enlarged to hold it, rather than flushed to make room.
+ *
+ *		returns 0 if OK, EOF if trouble
+ * --------------------------------
+ */
+static int
+internal_end_compressed_block(bool noblock)
+{
+	char		msgtype = PQ_MSG_COMPRESSED_DATA;
+	uint32		n32;
+	const char *detail;
+	int			res;
+
+	if (PqCompressPending == 0)
+		return 0;
+	PqCompressPending = 0;
+
+	if (!pq_compress_flush(PqSendCompressor, &PqCompressBuffer, &detail))
+	{
+		ereport(COMMERROR,
+				(errmsg("could not compress data: %s", detail)));
+		PqCompressBuffer.len = 0;
+		return EOF;
+	}
+
+	if (noblock)
+	{
+		size_t		required = PqSendPointer + 1 + 4 + PqCompressBuffer.len;
+
+		if (required > PqSendBufferSize)
+		{
+			PqSendBuffer = repalloc(PqSendBuffer, required);
+			PqSendBufferSize = required;
+		}
+	}
+
+	n32 = pg_hton32((uint32) (PqCompressBuffer.len + 4));
+	res = 0;
+	if (internal_putbytes(&msgtype, 1) ||
+		internal_putbytes((char *) &n32, 4) ||
+		internal_putbytes(PqCompressBuffer.data, PqCompressBuffer.len))
+		res = EOF;
+	PqCompressBuffer.len = 0;
+	return res;
 }
 
 /* --------------------------------
@@ -1560,10 +1995,52 @@ socket_is_send_pending(void)
  */
 static int
 socket_putmessage(char msgtype, const char *s, size_t len)
+{
+	return internal_putmessage(msgtype, s, len, false);
+}
+
+/*
+ * Guts of socket_putmessage and socket_putmessage_noblock.  With noblock,
+ * the caller has made room in the send buffer for the message, and we make
+ * room for any compressed data we have to write out ahead of it.
+ */
+static int
+internal_putmessage(char msgtype, const char *s, size_t len, bool noblock)
 {
 	if (DoingCopyOut || PqCommBusy)
 		return 0;
 	PqCommBusy = true;
+	if (PqSendCompressor != NULL)
+	{
+		if (PQ_MSG_IS_COMPRESSIBLE(msgtype))
+		{
+			uint32		n32;
+			const char *detail;
+
+			n32 = pg_hton32((uint32) (len + 4));
+			if (!pq_compress(PqSendCompressor, &msgtype, 1,
+							 &PqCompressBuffer, &detail) ||
+				!pq_compress(PqSendCompressor, (char *) &n32, 4,
+							 &PqCompressBuffer, &detail) ||
+				!pq_compress(PqSendCompressor, s, len,
+							 &PqCompressBuffer, &detail))
+			{
+				ereport(COMMERROR,
+						(errmsg("could not compress data: %s", detail)));
+				goto fail;
+			}
+			PqCompressPending += 1 + 4 + len;
+			if (PqCompressPending >= PQ_COMPRESSION_BLOCK_SIZE &&
+				internal_end_compressed_block(noblock))
+				goto fail;
+			PqCommBusy = false;
+			return 0;
+		}
+
+		/* Anything else must follow the compressed messages before it */
+		if (internal_end_compressed_block(noblock))
+			goto fail;
+	}
 	if (msgtype)
 		if (internal_putbytes(&msgtype, 1))
 			goto fail;
@@ -1607,12 +2084,82 @@ socket_putmessage_noblock(char msgtype, const char *s, size_t len)
 		PqSendBuffer = repalloc(PqSendBuffer, required);
 		PqSendBufferSize = required;
 	}
-	res = pq_putmessage(msgtype, s, len);
+	res = internal_putmessage(msgtype, s, len, true);
 	Assert(res == 0);			/* should not fail when the message fits in
 								 * buffer */
 }
 
 
+/* --------------------------------
+ *		socket_putmessages - send a run of complete messages
+ *
+ *		s holds one or more messages with their type bytes and length words
+ *		already in place, as built by callers that batch their output (see
+ *		printtup.c).  This saves the per-message overhead of pq_putmessage.
+ *		Only valid in protocol 3.0 and later.
+ *
+ *		returns 0 if OK, EOF if trouble
+ * --------------------------------
+ */
+static int
+socket_putmessages(const char *s, size_t len)
+{
+	const char *p;
+	uint32		n32;
+	const char *detail;
+	int			res;
+
+	Assert(PG_PROTOCOL_MAJOR(FrontendProtocol) >= 3);
+
+	if (DoingCopyOut || PqCommBusy)
+		return 0;
+
+	if (PqSendCompressor != NULL)
+	{
+		/* If they are all compressible, compress them in one go */
+		for (p = s; p < s + len; p += 1 + pg_ntoh32(n32))
+		{
+			if (!PQ_MSG_IS_COMPRESSIBLE(*p))
+				break;
+			memcpy(&n32, p + 1, 4);
+		}
+
+		if (p < s + len)
+		{
+			/* No; send them one at a time */
+			for (p = s; p < s + len; p += 1 + pg_ntoh32(n32))
+			{
+				memcpy(&n32, p + 1, 4);
+				if (internal_putmessage(*p, p + 5, pg_ntoh32(n32) - 4, false))
+					return EOF;
+			}
+			return 0;
+		}
+
+		PqCommBusy = true;
+		res = 0;
+		if (!pq_compress(PqSendCompressor, s, len, &PqCompressBuffer, &detail))
+		{
+			ereport(COMMERROR,
+					(errmsg("could not compress data: %s", detail)));
+			res = EOF;
+		}
+		else
+		{
+			PqCompressPending += len;
+			if (PqCompressPending >= PQ_COMPRESSION_BLOCK_SIZE)
+				res = internal_end_compressed_block(false);
+		}
+		PqCommBusy = false;
+		return res;
+	}
+
+	PqCommBusy = true;
+	res = internal_putbytes(s, len);
+	PqCommBusy = false;
+	return res;
+}
+
 /* --------------------------------
  *		socket_startcopyout - inform libpq that an old-style COPY OUT transfer
  *			is beginning
@@ -33,6 +33,7 @@ static int	mq_flush_if_writable(void);
 static bool mq_is_send_pending(void);
 static int	mq_putmessage(char msgtype, const char *s, size_t len);
 static void mq_putmessage_noblock(char msgtype, const char *s, size_t len);
+static int	mq_putmessages(const char *s, size_t len);
 static void mq_startcopyout(void);
 static void mq_endcopyout(bool errorAbort);
 
@@ -43,6 +44,7 @@ static const PQcommMethods PqCommMqMethods = {
 	mq_is_send_pending,
 	mq_putmessage,
 	mq_putmessage_noblock,
+	mq_putmessages,
 	mq_startcopyout,
 	mq_endcopyout
 };
@@ -158,7 +160,7 @@ mq_putmessage(char msgtype, const char *s, size_t len)
 
 	for (;;)
 	{
-		result = shm_mq_sendv(pq_mq_handle, iov, 2, true);
+		result = shm_mq_sendv(pq_mq_handle, iov, 2, true, true);
 
 		if (pq_mq_parallel_leader_pid != 0)
 			SendProcSignal(pq_mq_parallel_leader_pid,
@@ -195,6 +197,28 @@ mq_putmessage_noblock(char msgtype, const char *s, size_t len)
 	elog(ERROR, "not currently supported");
 }
 
+/*
+ * Transmit a run of complete messages, each with its type byte and length
+ * word, as one message queue entry each.
+ */
+static int
+mq_putmessages(const char *s, size_t len)
+{
+	const char *end = s + len;
+
+	while (s < end)
+	{
+		uint32		n32;
+
+		memcpy(&n32, s + 1, 4);
+		n32 = pg_ntoh32(n32);
+		if (mq_putmessage(*s, s + 5, n32 - 4))
+			return EOF;
+		s += 1 + n32;
+	}
+	return 0;
+}
+
 static void
 mq_startcopyout(void)
 {
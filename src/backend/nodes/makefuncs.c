@@ -498,6 +498,7 @@ makeColumnDef(const char *colname, Oid typeOid, int32 typmod, Oid collOid)
 	n->is_not_null = false;
 	n->is_from_type = false;
 	n->storage = 0;
+	n->compression = NULL;
 	n->raw_default = NULL;
 	n->cooked_default = NULL;
 	n->collClause = NULL;
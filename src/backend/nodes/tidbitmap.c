@@ -28,6 +28,15 @@
  * into a bitmap, and it can also happen internally when we AND a lossy
  * and a non-lossy page.
  *
+ * To delay going lossy, the tuple offsets of an exact page are stored in
+ * one of several "containers", in the spirit of roaring bitmaps.  Pages
+ * with only a few matching tuples store their offsets in a small array,
+ * and pages whose matching tuples form one or two ranges of offsets (as
+ * is typical when the table is clustered on the indexed column) store the
+ * ranges.  Both fit in the hash table entry itself.  Only other pages need
+ * a full bitmap, which is kept in a separate array of bitmaps, so that the
+ * hash table entries stay small.
+ *
  *
  * Copyright (c) 2003-2020, PostgreSQL Global Development Group
  *
@@ -82,15 +91,44 @@
 /* number of active words for a lossy chunk: */
 #define WORDS_PER_CHUNK  ((PAGES_PER_CHUNK - 1) / BITS_PER_BITMAPWORD + 1)
 
+/*
+ * A bitmap for an exact page or a lossy chunk.  These are kept in an array
+ * separate from the hashtable, and referenced by their index in it.
+ */
+typedef struct TBMBitmap
+{
+	bitmapword	words[Max(WORDS_PER_PAGE, WORDS_PER_CHUNK)];
+} TBMBitmap;
+
+/* marks the end of the list of free bitmaps */
+#define InvalidBitmapIndex	PG_UINT32_MAX
+
+/*
+ * Containers for the tuple offsets of an exact page.  TBM_ARRAY must be
+ * zero, so that a zeroed entry is an exact page with no tuples.
+ */
+#define TBM_ARRAY	0			/* sorted offsets, unused slots are zero */
+#define TBM_RUNS	1			/* ranges of offsets, unused ones are zero */
+#define TBM_BITMAP	2			/* index of a TBMBitmap */
+
+#define TBM_MAX_OFFSETS		4
+#define TBM_MAX_RUNS		2
+
+typedef struct TBMRun
+{
+	OffsetNumber first;			/* first offset in range */
+	OffsetNumber last;			/* last offset in range */
+} TBMRun;
+
 /*
  * The hashtable entries are represented by this data structure.  For
- * an exact page, blockno is the page number and bit k of the bitmap
- * represents tuple offset k+1.  For a lossy chunk, blockno is the first
- * page in the chunk (this must be a multiple of PAGES_PER_CHUNK) and
- * bit k represents page blockno+k.  Note that it is not possible to
- * have exact storage for the first page of a chunk if we are using
- * lossy storage for any page in the chunk's range, since the same
- * hashtable entry has to serve both purposes.
+ * an exact page, blockno is the page number, and if the page has a bitmap,
+ * bit k of it represents tuple offset k+1.  For a lossy chunk, blockno is
+ * the first page in the chunk (this must be a multiple of PAGES_PER_CHUNK)
+ * and bit k of its bitmap represents page blockno+k; chunks always use a
+ * bitmap.  Note that it is not possible to have exact storage for the
+ * first page of a chunk if we are using lossy storage for any page in the
+ * chunk's range, since the same hashtable entry has to serve both purposes.
  *
  * recheck is used only on exact pages --- it indicates that although
  * only the stated tuples need be checked, the full index qual condition
@@ -102,9 +140,27 @@ typedef struct PagetableEntry
 	char		status;			/* hash entry status */
 	bool		ischunk;		/* T = lossy storage, F = exact */
 	bool		recheck;		/* should the tuples be rechecked? */
-	bitmapword	words[Max(WORDS_PER_PAGE, WORDS_PER_CHUNK)];
+	uint8		container;		/* TBM_ARRAY, TBM_RUNS or TBM_BITMAP */
+	union
+	{
+		OffsetNumber offsets[TBM_MAX_OFFSETS];	/* TBM_ARRAY */
+		TBMRun		runs[TBM_MAX_RUNS]; /* TBM_RUNS */
+		uint32		bitmap;		/* TBM_BITMAP */
+	}			c;
 } PagetableEntry;
 
+/*
+ * Memory accounted for each hashtable entry.  This estimates the hash cost
+ * as sizeof(PagetableEntry), which is good enough for our purpose.  Also
+ * count an extra Pointer per entry for the arrays created during iteration
+ * readout.
+ */
+#define TBM_ENTRY_BYTES \
+	(sizeof(PagetableEntry) + sizeof(Pointer) + sizeof(Pointer))
+
+/* safety limit on maxbytes, so that nentries can't overflow */
+#define TBM_MAX_BYTES	((double) (INT_MAX - 1) * TBM_ENTRY_BYTES)
+
 /*
  * Holds array of pagetable entries.
  */
@@ -152,9 +208,15 @@ struct TIDBitmap
 	TBMStatus	status;			/* see codes above */
 	struct pagetable_hash *pagetable;	/* hash table of PagetableEntry's */
 	int			nentries;		/* number of entries in pagetable */
-	int			maxentries;		/* limit on same to meet maxbytes */
+	long		maxbytes;		/* limit on memory, see tbm_memory_used */
 	int			npages;			/* number of exact entries in pagetable */
 	int			nchunks;		/* number of lossy entries in pagetable */
+	TBMBitmap  *bitmaps;		/* bitmaps of pages and chunks, or NULL */
+	uint32		nbitmaps;		/* number of bitmaps[] entries used */
+	uint32		maxbitmaps;		/* allocated length of bitmaps[] */
+	uint32		nfreebitmaps;	/* number of free bitmaps[] entries */
+	uint32		freebitmap;		/* first free entry, they're linked through
+								 * words[0] */
 	TBMIteratingState iterating;	/* tbm_begin_iterate called? */
 	uint32		lossify_start;	/* offset to start lossifying hashtable at */
 	PagetableEntry entry1;		/* used when status == TBM_ONE_PAGE */
@@ -190,10 +252,10 @@ struct TBMIterator
 typedef struct TBMSharedIteratorState
 {
 	int			nentries;		/* number of entries in pagetable */
-	int			maxentries;		/* limit on same to meet maxbytes */
 	int			npages;			/* number of exact entries in pagetable */
 	int			nchunks;		/* number of lossy entries in pagetable */
 	dsa_pointer pagetable;		/* dsa pointers to head of pagetable data */
+	dsa_pointer bitmaps;		/* dsa pointer to copy of bitmap array */
 	dsa_pointer spages;			/* dsa pointer to page array */
 	dsa_pointer schunks;		/* dsa pointer to chunk array */
 	LWLock		lock;			/* lock to protect below members */
@@ -221,13 +283,23 @@ struct TBMSharedIterator
 	PTEntryArray *ptbase;		/* pagetable element array */
 	PTIterationArray *ptpages;	/* sorted exact page index list */
 	PTIterationArray *ptchunks; /* sorted lossy page index list */
+	TBMBitmap  *bitmaps;		/* bitmap array */
 	TBMIterateResult output;	/* MUST BE LAST (because variable-size) */
 };
 
 /* Local function prototypes */
-static void tbm_union_page(TIDBitmap *a, const PagetableEntry *bpage);
+static void tbm_union_page(TIDBitmap *a, const TIDBitmap *b,
+						   const PagetableEntry *bpage);
 static bool tbm_intersect_page(TIDBitmap *a, PagetableEntry *apage,
 							   const TIDBitmap *b);
+static uint32 tbm_alloc_bitmap(TIDBitmap *tbm);
+static void tbm_free_container(TIDBitmap *tbm, PagetableEntry *page);
+static void tbm_page_get_words(const PagetableEntry *page,
+							   const TBMBitmap *bitmaps, bitmapword *words);
+static void tbm_page_set_words(TIDBitmap *tbm, PagetableEntry *page,
+							   const bitmapword *words);
+static void tbm_page_add_offset(TIDBitmap *tbm, PagetableEntry *page,
+								OffsetNumber off);
 static const PagetableEntry *tbm_find_pageentry(const TIDBitmap *tbm,
 												BlockNumber pageno);
 static PagetableEntry *tbm_get_pageentry(TIDBitmap *tbm, BlockNumber pageno);
@@ -247,10 +319,21 @@ static int	tbm_shared_comparator(const void *left, const void *right,
 #define SH_HASH_KEY(tb, key) murmurhash32(key)
 #define SH_EQUAL(tb, a, b) a == b
 #define SH_SCOPE static inline
+#define SH_GROUP_PROBING
 #define SH_DEFINE
 #define SH_DECLARE
 #include "lib/simplehash.h"
 
+/*
+ * Memory in use by the bitmap, for comparison with maxbytes
+ */
+static inline long
+tbm_memory_used(const TIDBitmap *tbm)
+{
+	return tbm->nentries * (long) TBM_ENTRY_BYTES +
+		(long) (tbm->nbitmaps - tbm->nfreebitmaps) * (long) sizeof(TBMBitmap);
+}
+
 
 /*
  * tbm_create - create an initially-empty bitmap
@@ -272,7 +355,9 @@ tbm_create(long maxbytes, dsa_area *dsa)
 	tbm->mcxt = CurrentMemoryContext;
 	tbm->status = TBM_EMPTY;
 
-	tbm->maxentries = (int) tbm_calculate_entries(maxbytes);
+	tbm->maxbytes = (long) Min((double) maxbytes, TBM_MAX_BYTES);
+	tbm->maxbytes = Max(tbm->maxbytes, 16 * (long) TBM_ENTRY_BYTES);
+	tbm->freebitmap = InvalidBitmapIndex;
 	tbm->lossify_start = 0;
 	tbm->dsa = dsa;
 	tbm->dsapagetable = InvalidDsaPointer;
@@ -326,6 +411,8 @@ tbm_free(TIDBitmap *tbm)
 		pfree(tbm->spages);
 	if (tbm->schunks)
 		pfree(tbm->schunks);
+	if (tbm->bitmaps)
+		pfree(tbm->bitmaps);
 	pfree(tbm);
 }
 
@@ -350,6 +437,8 @@ tbm_free_shared_area(dsa_area *dsa, dsa_pointer dp)
 		if (pg_atomic_sub_fetch_u32(&ptbase->refcount, 1) == 0)
 			dsa_free(dsa, istate->pagetable);
 	}
+	if (DsaPointerIsValid(istate->bitmaps))
+		dsa_free(dsa, istate->bitmaps);
 	if (DsaPointerIsValid(istate->spages))
 	{
 		ptpages = dsa_get_address(dsa, istate->spages);
@@ -385,8 +474,6 @@ tbm_add_tuples(TIDBitmap *tbm, const ItemPointer tids, int ntids,
 	{
 		BlockNumber blk = ItemPointerGetBlockNumber(tids + i);
 		OffsetNumber off = ItemPointerGetOffsetNumber(tids + i);
-		int			wordnum,
-					bitnum;
 
 		/* safety check to ensure we don't overrun bit array bounds */
 		if (off < 1 || off > MAX_TUPLES_PER_PAGE)
@@ -412,18 +499,16 @@ tbm_add_tuples(TIDBitmap *tbm, const ItemPointer tids, int ntids,
 		if (page->ischunk)
 		{
 			/* The page is a lossy chunk header, set bit for itself */
-			wordnum = bitnum = 0;
+			tbm->bitmaps[page->c.bitmap].words[0] |= ((bitmapword) 1 << 0);
 		}
 		else
 		{
-			/* Page is exact, so set bit for individual tuple */
-			wordnum = WORDNUM(off - 1);
-			bitnum = BITNUM(off - 1);
+			/* Page is exact, so add the individual tuple */
+			tbm_page_add_offset(tbm, page, off);
 		}
-		page->words[wordnum] |= ((bitmapword) 1 << bitnum);
 		page->recheck |= recheck;
 
-		if (tbm->nentries > tbm->maxentries)
+		if (tbm_memory_used(tbm) > tbm->maxbytes)
 		{
 			tbm_lossify(tbm);
 			/* Page could have been converted to lossy, so force new lookup */
@@ -444,7 +529,7 @@ tbm_add_page(TIDBitmap *tbm, BlockNumber pageno)
 	/* Enter the page in the bitmap, or mark it lossy if already present */
 	tbm_mark_page_lossy(tbm, pageno);
 	/* If we went over the memory limit, lossify some more pages */
-	if (tbm->nentries > tbm->maxentries)
+	if (tbm_memory_used(tbm) > tbm->maxbytes)
 		tbm_lossify(tbm);
 }
 
@@ -462,7 +547,7 @@ tbm_union(TIDBitmap *a, const TIDBitmap *b)
 		return;
 	/* Scan through chunks and pages in b, merge into a */
 	if (b->status == TBM_ONE_PAGE)
-		tbm_union_page(a, &b->entry1);
+		tbm_union_page(a, b, &b->entry1);
 	else
 	{
 		pagetable_iterator i;
@@ -471,13 +556,13 @@ tbm_union(TIDBitmap *a, const TIDBitmap *b)
 		Assert(b->status == TBM_HASH);
 		pagetable_start_iterate(b->pagetable, &i);
 		while ((bpage = pagetable_iterate(b->pagetable, &i)) != NULL)
-			tbm_union_page(a, bpage);
+			tbm_union_page(a, b, bpage);
 	}
 }
 
 /* Process one page of b during a union op */
 static void
-tbm_union_page(TIDBitmap *a, const PagetableEntry *bpage)
+tbm_union_page(TIDBitmap *a, const TIDBitmap *b, const PagetableEntry *bpage)
 {
 	PagetableEntry *apage;
 	int			wordnum;
@@ -487,7 +572,7 @@ tbm_union_page(TIDBitmap *a, const PagetableEntry *bpage)
 		/* Scan b's chunk, mark each indicated page lossy in a */
 		for (wordnum = 0; wordnum < WORDS_PER_CHUNK; wordnum++)
 		{
-			bitmapword	w = bpage->words[wordnum];
+			bitmapword	w = b->bitmaps[bpage->c.bitmap].words[wordnum];
 
 			if (w != 0)
 			{
@@ -515,18 +600,34 @@ tbm_union_page(TIDBitmap *a, const PagetableEntry *bpage)
 		if (apage->ischunk)
 		{
 			/* The page is a lossy chunk header, set bit for itself */
-			apage->words[0] |= ((bitmapword) 1 << 0);
+			a->bitmaps[apage->c.bitmap].words[0] |= ((bitmapword) 1 << 0);
+		}
+		else if (apage->container == TBM_BITMAP)
+		{
+			bitmapword	bwords[WORDS_PER_PAGE];
+
+			/* a's page has a bitmap already, merge b's page into it */
+			tbm_page_get_words(bpage, b->bitmaps, bwords);
+			for (wordnum = 0; wordnum < WORDS_PER_PAGE; wordnum++)
+				a->bitmaps[apage->c.bitmap].words[wordnum] |= bwords[wordnum];
+			apage->recheck |= bpage->recheck;
 		}
 		else
 		{
+			bitmapword	awords[WORDS_PER_PAGE];
+			bitmapword	bwords[WORDS_PER_PAGE];
+
 			/* Both pages are exact, merge at the bit level */
+			tbm_page_get_words(apage, a->bitmaps, awords);
+			tbm_page_get_words(bpage, b->bitmaps, bwords);
 			for (wordnum = 0; wordnum < WORDS_PER_PAGE; wordnum++)
-				apage->words[wordnum] |= bpage->words[wordnum];
+				awords[wordnum] |= bwords[wordnum];
+			tbm_page_set_words(a, apage, awords);
 			apage->recheck |= bpage->recheck;
 		}
 	}
 
-	if (a->nentries > a->maxentries)
+	if (tbm_memory_used(a) > a->maxbytes)
 		tbm_lossify(a);
 }
 
@@ -549,6 +650,7 @@ tbm_intersect(TIDBitmap *a, const TIDBitmap *b)
 		{
 			/* Page is now empty, remove it from a */
 			Assert(!a->entry1.ischunk);
+			tbm_free_container(a, &a->entry1);
 			a->npages--;
 			a->nentries--;
 			Assert(a->nentries == 0);
@@ -572,6 +674,7 @@ tbm_intersect(TIDBitmap *a, const TIDBitmap *b)
 				else
 					a->npages--;
 				a->nentries--;
+				tbm_free_container(a, apage);
 				if (!pagetable_delete(a->pagetable, apage->blockno))
 					elog(ERROR, "hash table corrupted");
 			}
@@ -597,7 +700,7 @@ tbm_intersect_page(TIDBitmap *a, PagetableEntry *apage, const TIDBitmap *b)
 
 		for (wordnum = 0; wordnum < WORDS_PER_CHUNK; wordnum++)
 		{
-			bitmapword	w = apage->words[wordnum];
+			bitmapword	w = a->bitmaps[apage->c.bitmap].words[wordnum];
 
 			if (w != 0)
 			{
@@ -622,7 +725,7 @@ tbm_intersect_page(TIDBitmap *a, PagetableEntry *apage, const TIDBitmap *b)
 					bitnum++;
 					w >>= 1;
 				}
-				apage->words[wordnum] = neww;
+				a->bitmaps[apage->c.bitmap].words[wordnum] = neww;
 				if (neww != 0)
 					candelete = false;
 			}
@@ -647,14 +750,21 @@ tbm_intersect_page(TIDBitmap *a, PagetableEntry *apage, const TIDBitmap *b)
 		bpage = tbm_find_pageentry(b, apage->blockno);
 		if (bpage != NULL)
 		{
+			bitmapword	awords[WORDS_PER_PAGE];
+			bitmapword	bwords[WORDS_PER_PAGE];
+
 			/* Both pages are exact, merge at the bit level */
 			Assert(!bpage->ischunk);
+			tbm_page_get_words(apage, a->bitmaps, awords);
+			tbm_page_get_words(bpage, b->bitmaps, bwords);
 			for (wordnum = 0; wordnum < WORDS_PER_PAGE; wordnum++)
 			{
-				apage->words[wordnum] &= bpage->words[wordnum];
-				if (apage->words[wordnum] != 0)
+				awords[wordnum] &= bwords[wordnum];
+				if (awords[wordnum] != 0)
 					candelete = false;
 			}
+			if (!candelete)
+				tbm_page_set_words(a, apage, awords);
 			apage->recheck |= bpage->recheck;
 		}
 		/* If there is no matching b page, we can just delete the a page */
@@ -865,13 +975,26 @@ tbm_prepare_shared_iterate(TIDBitmap *tbm)
 	 * across multiple processes.
 	 */
 	istate->nentries = tbm->nentries;
-	istate->maxentries = tbm->maxentries;
 	istate->npages = tbm->npages;
 	istate->nchunks = tbm->nchunks;
 	istate->pagetable = tbm->dsapagetable;
 	istate->spages = tbm->ptpages;
 	istate->schunks = tbm->ptchunks;
 
+	/*
+	 * The bitmaps live in backend-private memory, so each shared iteration
+	 * gets its own copy of them.
+	 */
+	istate->bitmaps = InvalidDsaPointer;
+	if (tbm->nbitmaps > 0)
+	{
+		istate->bitmaps = dsa_allocate_extended(tbm->dsa,
+												tbm->nbitmaps * sizeof(TBMBitmap),
+												DSA_ALLOC_HUGE);
+		memcpy(dsa_get_address(tbm->dsa, istate->bitmaps), tbm->bitmaps,
+			   tbm->nbitmaps * sizeof(TBMBitmap));
+	}
+
 	ptbase = dsa_get_address(tbm->dsa, tbm->dsapagetable);
 	ptpages = dsa_get_address(tbm->dsa, tbm->ptpages);
 	ptchunks = dsa_get_address(tbm->dsa, tbm->ptchunks);
@@ -902,19 +1025,19 @@ tbm_prepare_shared_iterate(TIDBitmap *tbm)
 }
 
 /*
- * tbm_extract_page_tuple - extract the tuple offsets from a page
+ * tbm_extract_bitmap_tuples - extract the tuple offsets from a page bitmap
  *
- * The extracted offsets are stored into TBMIterateResult.
+ * The extracted offsets are stored into offsets[], in increasing order.
  */
 static inline int
-tbm_extract_page_tuple(PagetableEntry *page, TBMIterateResult *output)
+tbm_extract_bitmap_tuples(const bitmapword *words, OffsetNumber *offsets)
 {
 	int			wordnum;
 	int			ntuples = 0;
 
 	for (wordnum = 0; wordnum < WORDS_PER_PAGE; wordnum++)
 	{
-		bitmapword	w = page->words[wordnum];
+		bitmapword	w = words[wordnum];
 
 		if (w != 0)
 		{
@@ -923,7 +1046,7 @@ tbm_extract_page_tuple(PagetableEntry *page, TBMIterateResult *output)
 			while (w != 0)
 			{
 				if (w & 1)
-					output->offsets[ntuples++] = (OffsetNumber) off;
+					offsets[ntuples++] = (OffsetNumber) off;
 				off++;
 				w >>= 1;
 			}
@@ -933,11 +1056,53 @@ tbm_extract_page_tuple(PagetableEntry *page, TBMIterateResult *output)
 	return ntuples;
 }
 
+/*
+ * tbm_extract_page_tuple - extract the tuple offsets from a page
+ *
+ * The extracted offsets are stored into TBMIterateResult.
+ */
+static inline int
+tbm_extract_page_tuple(const PagetableEntry *page, const TBMBitmap *bitmaps,
+					   TBMIterateResult *output)
+{
+	int			ntuples = 0;
+	int			i;
+
+	switch (page->container)
+	{
+		case TBM_ARRAY:
+			for (i = 0; i < TBM_MAX_OFFSETS; i++)
+			{
+				if (page->c.offsets[i] == InvalidOffsetNumber)
+					break;
+				output->offsets[ntuples++] = page->c.offsets[i];
+			}
+			break;
+		case TBM_RUNS:
+			for (i = 0; i < TBM_MAX_RUNS; i++)
+			{
+				OffsetNumber off;
+
+				if (page->c.runs[i].first == InvalidOffsetNumber)
+					break;
+				for (off = page->c.runs[i].first; off <= page->c.runs[i].last; off++)
+					output->offsets[ntuples++] = off;
+			}
+			break;
+		case TBM_BITMAP:
+			ntuples = tbm_extract_bitmap_tuples(bitmaps[page->c.bitmap].words,
+												output->offsets);
+			break;
+	}
+
+	return ntuples;
+}
+
 /*
  *	tbm_advance_schunkbit - Advance the schunkbit
  */
 static inline void
-tbm_advance_schunkbit(PagetableEntry *chunk, int *schunkbitp)
+tbm_advance_schunkbit(const bitmapword *words, int *schunkbitp)
 {
 	int			schunkbit = *schunkbitp;
 
@@ -946,7 +1111,7 @@ tbm_advance_schunkbit(PagetableEntry *chunk, int *schunkbitp)
 		int			wordnum = WORDNUM(schunkbit);
 		int			bitnum = BITNUM(schunkbit);
 
-		if ((chunk->words[wordnum] & ((bitmapword) 1 << bitnum)) != 0)
+		if ((words[wordnum] & ((bitmapword) 1 << bitnum)) != 0)
 			break;
 		schunkbit++;
 	}
@@ -983,7 +1148,7 @@ tbm_iterate(TBMIterator *iterator)
 		PagetableEntry *chunk = tbm->schunks[iterator->schunkptr];
 		int			schunkbit = iterator->schunkbit;
 
-		tbm_advance_schunkbit(chunk, &schunkbit);
+		tbm_advance_schunkbit(tbm->bitmaps[chunk->c.bitmap].words, &schunkbit);
 		if (schunkbit < PAGES_PER_CHUNK)
 		{
 			iterator->schunkbit = schunkbit;
@@ -1028,7 +1193,7 @@ tbm_iterate(TBMIterator *iterator)
 			page = tbm->spages[iterator->spageptr];
 
 		/* scan bitmap to extract individual offset numbers */
-		ntuples = tbm_extract_page_tuple(page, output);
+		ntuples = tbm_extract_page_tuple(page, tbm->bitmaps, output);
 		output->blockno = page->blockno;
 		output->ntuples = ntuples;
 		output->recheck = page->recheck;
@@ -1075,7 +1240,8 @@ tbm_shared_iterate(TBMSharedIterator *iterator)
 		PagetableEntry *chunk = &ptbase[idxchunks[istate->schunkptr]];
 		int			schunkbit = istate->schunkbit;
 
-		tbm_advance_schunkbit(chunk, &schunkbit);
+		tbm_advance_schunkbit(iterator->bitmaps[chunk->c.bitmap].words,
+							  &schunkbit);
 		if (schunkbit < PAGES_PER_CHUNK)
 		{
 			istate->schunkbit = schunkbit;
@@ -1117,7 +1283,7 @@ tbm_shared_iterate(TBMSharedIterator *iterator)
 		int			ntuples;
 
 		/* scan bitmap to extract individual offset numbers */
-		ntuples = tbm_extract_page_tuple(page, output);
+		ntuples = tbm_extract_page_tuple(page, iterator->bitmaps, output);
 		output->blockno = page->blockno;
 		output->ntuples = ntuples;
 		output->recheck = page->recheck;
@@ -1159,6 +1325,244 @@ tbm_end_shared_iterate(TBMSharedIterator *iterator)
 	pfree(iterator);
 }
 
+/*
+ * tbm_alloc_bitmap - allocate a zeroed bitmap, return its index
+ *
+ * This may move the bitmaps array, so the caller mustn't hold on to
+ * pointers into it.
+ */
+static uint32
+tbm_alloc_bitmap(TIDBitmap *tbm)
+{
+	uint32		bitmap;
+
+	if (tbm->freebitmap != InvalidBitmapIndex)
+	{
+		/* reuse a free one */
+		bitmap = tbm->freebitmap;
+		tbm->freebitmap = (uint32) tbm->bitmaps[bitmap].words[0];
+		tbm->nfreebitmaps--;
+	}
+	else
+	{
+		if (tbm->nbitmaps >= tbm->maxbitmaps)
+		{
+			uint32		newmax;
+
+			if (tbm->maxbitmaps >= PG_UINT32_MAX / 2)
+				elog(ERROR, "too many bitmaps in TID bitmap");
+			newmax = Max(tbm->maxbitmaps * 2, 64);
+			if (tbm->bitmaps == NULL)
+				tbm->bitmaps = (TBMBitmap *)
+					MemoryContextAllocHuge(tbm->mcxt,
+										   newmax * sizeof(TBMBitmap));
+			else
+				tbm->bitmaps = (TBMBitmap *)
+					repalloc_huge(tbm->bitmaps, newmax * sizeof(TBMBitmap));
+			tbm->maxbitmaps = newmax;
+		}
+		bitmap = tbm->nbitmaps++;
+	}
+
+	memset(&tbm->bitmaps[bitmap], 0, sizeof(TBMBitmap));
+
+	return bitmap;
+}
+
+/*
+ * tbm_free_container - release the bitmap of a page or chunk, if it has one
+ *
+ * The entry is left as an exact page with no tuples.
+ */
+static void
+tbm_free_container(TIDBitmap *tbm, PagetableEntry *page)
+{
+	if (page->container == TBM_BITMAP)
+	{
+		tbm->bitmaps[page->c.bitmap].words[0] = (bitmapword) tbm->freebitmap;
+		tbm->freebitmap = page->c.bitmap;
+		tbm->nfreebitmaps++;
+	}
+	page->container = TBM_ARRAY;
+	memset(&page->c, 0, sizeof(page->c));
+}
+
+/*
+ * tbm_page_get_words - get the tuple offsets of an exact page as a bitmap
+ */
+static void
+tbm_page_get_words(const PagetableEntry *page, const TBMBitmap *bitmaps,
+				   bitmapword *words)
+{
+	int			i;
+
+	Assert(!page->ischunk);
+
+	if (page->container == TBM_BITMAP)
+	{
+		memcpy(words, bitmaps[page->c.bitmap].words,
+			   WORDS_PER_PAGE * sizeof(bitmapword));
+		return;
+	}
+
+	memset(words, 0, WORDS_PER_PAGE * sizeof(bitmapword));
+	if (page->container == TBM_ARRAY)
+	{
+		for (i = 0; i < TBM_MAX_OFFSETS; i++)
+		{
+			OffsetNumber off = page->c.offsets[i];
+
+			if (off == InvalidOffsetNumber)
+				break;
+			words[WORDNUM(off - 1)] |= ((bitmapword) 1 << BITNUM(off - 1));
+		}
+	}
+	else
+	{
+		for (i = 0; i < TBM_MAX_RUNS; i++)
+		{
+			OffsetNumber off;
+
+			if (page->c.runs[i].first == InvalidOffsetNumber)
+				break;
+			for (off = page->c.runs[i].first; off <= page->c.runs[i].last; off++)
+				words[WORDNUM(off - 1)] |= ((bitmapword) 1 << BITNUM(off - 1));
+		}
+	}
+}
+
+/*
+ * tbm_page_set_words - store the tuple offsets of an exact page
+ *
+ * The offsets are given as a bitmap, which must not be empty.  We choose
+ * the smallest container that can hold them.
+ */
+static void
+tbm_page_set_words(TIDBitmap *tbm, PagetableEntry *page,
+				   const bitmapword *words)
+{
+	OffsetNumber offsets[MAX_TUPLES_PER_PAGE];
+	TBMRun		runs[TBM_MAX_RUNS];
+	int			ntuples;
+	int			nruns;
+	int			i;
+
+	Assert(!page->ischunk);
+
+	ntuples = tbm_extract_bitmap_tuples(words, offsets);
+	Assert(ntuples > 0);
+
+	if (ntuples <= TBM_MAX_OFFSETS)
+	{
+		tbm_free_container(tbm, page);
+		memcpy(page->c.offsets, offsets, ntuples * sizeof(OffsetNumber));
+		return;
+	}
+
+	/* Try to describe the offsets as a few ranges */
+	nruns = 0;
+	for (i = 0; i < ntuples; i++)
+	{
+		if (nruns > 0 && offsets[i] == runs[nruns - 1].last + 1)
+			runs[nruns - 1].last = offsets[i];
+		else if (nruns < TBM_MAX_RUNS)
+		{
+			runs[nruns].first = runs[nruns].last = offsets[i];
+			nruns++;
+		}
+		else
+			break;
+	}
+	if (i == ntuples)
+	{
+		tbm_free_container(tbm, page);
+		page->container = TBM_RUNS;
+		memcpy(page->c.runs, runs, nruns * sizeof(TBMRun));
+		return;
+	}
+
+	/* Need a full bitmap then */
+	if (page->container != TBM_BITMAP)
+	{
+		page->c.bitmap = tbm_alloc_bitmap(tbm);
+		page->container = TBM_BITMAP;
+	}
+	memcpy(tbm->bitmaps[page->c.bitmap].words, words,
+		   WORDS_PER_PAGE * sizeof(bitmapword));
+}
+
+/*
+ * tbm_page_add_offset - add one tuple offset to an exact page
+ *
+ * The common cases are handled in place; otherwise the page's container is
+ * rebuilt.
+ */
+static void
+tbm_page_add_offset(TIDBitmap *tbm, PagetableEntry *page, OffsetNumber off)
+{
+	bitmapword	words[WORDS_PER_PAGE];
+	int			i;
+
+	Assert(!page->ischunk);
+
+	switch (page->container)
+	{
+		case TBM_BITMAP:
+			tbm->bitmaps[page->c.bitmap].words[WORDNUM(off - 1)] |=
+				((bitmapword) 1 << BITNUM(off - 1));
+			return;
+		case TBM_ARRAY:
+			for (i = 0; i < TBM_MAX_OFFSETS; i++)
+			{
+				OffsetNumber cur = page->c.offsets[i];
+
+				if (cur == off)
+					return;		/* already present */
+				if (cur == InvalidOffsetNumber || cur > off)
+					break;
+			}
+			/* Insert it in sorted position, if there's room */
+			if (i < TBM_MAX_OFFSETS &&
+				page->c.offsets[TBM_MAX_OFFSETS - 1] == InvalidOffsetNumber)
+			{
+				memmove(&page->c.offsets[i + 1], &page->c.offsets[i],
+						(TBM_MAX_OFFSETS - 1 - i) * sizeof(OffsetNumber));
+				page->c.offsets[i] = off;
+				return;
+			}
+			break;
+		case TBM_RUNS:
+			for (i = 0; i < TBM_MAX_RUNS; i++)
+			{
+				TBMRun	   *run = &page->c.runs[i];
+
+				if (run->first == InvalidOffsetNumber)
+					break;
+				if (off >= run->first && off <= run->last)
+					return;		/* already present */
+
+				/*
+				 * Extend the run if that doesn't make it adjacent to the next
+				 * one.  This is the usual case when tuples are added in order.
+				 */
+				if (off == run->last + 1 &&
+					(i == TBM_MAX_RUNS - 1 ||
+					 page->c.runs[i + 1].first == InvalidOffsetNumber ||
+					 off + 1 < page->c.runs[i + 1].first))
+				{
+					run->last = off;
+					return;
+				}
+			}
+			break;
+	}
+
+	/* Rebuild the container with the new offset added */
+	tbm_page_get_words(page, tbm->bitmaps, words);
+	words[WORDNUM(off - 1)] |= ((bitmapword) 1 << BITNUM(off - 1));
+	tbm_page_set_words(tbm, page, words);
+}
+
 /*
  * tbm_find_pageentry - find a PagetableEntry for the pageno
  *
@@ -1266,7 +1670,8 @@ tbm_page_is_lossy(const TIDBitmap *tbm, BlockNumber pageno)
 		int			wordnum = WORDNUM(bitno);
 		int			bitnum = BITNUM(bitno);
 
-		if ((page->words[wordnum] & ((bitmapword) 1 << bitnum)) != 0)
+		if ((tbm->bitmaps[page->c.bitmap].words[wordnum] &
+			 ((bitmapword) 1 << bitnum)) != 0)
 			return true;
 	}
 	return false;
@@ -1287,6 +1692,7 @@ tbm_mark_page_lossy(TIDBitmap *tbm, BlockNumber pageno)
 	int			bitno;
 	int			wordnum;
 	int			bitnum;
+	uint32		bitmap;
 
 	/* We force the bitmap into hashtable mode whenever it's lossy */
 	if (tbm->status != TBM_HASH)
@@ -1301,11 +1707,15 @@ tbm_mark_page_lossy(TIDBitmap *tbm, BlockNumber pageno)
 	 */
 	if (bitno != 0)
 	{
-		if (pagetable_delete(tbm->pagetable, pageno))
+		page = pagetable_lookup(tbm->pagetable, pageno);
+		if (page != NULL)
 		{
 			/* It was present, so adjust counts */
+			Assert(!page->ischunk);
+			tbm_free_container(tbm, page);
+			pagetable_delete(tbm->pagetable, pageno);
 			tbm->nentries--;
-			tbm->npages--;		/* assume it must have been non-lossy */
+			tbm->npages--;
 		}
 	}
 
@@ -1324,18 +1734,29 @@ tbm_mark_page_lossy(TIDBitmap *tbm, BlockNumber pageno)
 		/* must count it too */
 		tbm->nentries++;
 		tbm->nchunks++;
+		page->container = TBM_BITMAP;
+		page->c.bitmap = tbm_alloc_bitmap(tbm);
 	}
 	else if (!page->ischunk)
 	{
 		char		oldstatus = page->status;
 
 		/* chunk header page was formerly non-lossy, make it lossy */
+		if (page->container == TBM_BITMAP)
+		{
+			bitmap = page->c.bitmap;
+			memset(&tbm->bitmaps[bitmap], 0, sizeof(TBMBitmap));
+		}
+		else
+			bitmap = tbm_alloc_bitmap(tbm);
 		MemSet(page, 0, sizeof(PagetableEntry));
 		page->status = oldstatus;
 		page->blockno = chunk_pageno;
 		page->ischunk = true;
+		page->container = TBM_BITMAP;
+		page->c.bitmap = bitmap;
 		/* we assume it had some tuple bit(s) set, so mark it lossy */
-		page->words[0] = ((bitmapword) 1 << 0);
+		tbm->bitmaps[bitmap].words[0] = ((bitmapword) 1 << 0);
 		/* adjust counts */
 		tbm->nchunks++;
 		tbm->npages--;
@@ -1344,7 +1765,7 @@ tbm_mark_page_lossy(TIDBitmap *tbm, BlockNumber pageno)
 	/* Now set the original target page's bit */
 	wordnum = WORDNUM(bitno);
 	bitnum = BITNUM(bitno);
-	page->words[wordnum] |= ((bitmapword) 1 << bitnum);
+	tbm->bitmaps[page->c.bitmap].words[wordnum] |= ((bitmapword) 1 << bitnum);
 }
 
 /*
@@ -1361,9 +1782,9 @@ tbm_lossify(TIDBitmap *tbm)
 	 * essentially random order.  We should be paying some attention to the
 	 * number of bits set in each page, instead.
 	 *
-	 * Since we are called as soon as nentries exceeds maxentries, we should
-	 * push nentries down to significantly less than maxentries, or else we'll
-	 * just end up doing this again very soon.  We shoot for maxentries/2.
+	 * Since we are called as soon as the memory used exceeds maxbytes, we
+	 * should push it down to significantly less than maxbytes, or else we'll
+	 * just end up doing this again very soon.  We shoot for maxbytes/2.
 	 */
 	Assert(tbm->iterating == TBM_NOT_ITERATING);
 	Assert(tbm->status == TBM_HASH);
@@ -1384,7 +1805,7 @@ tbm_lossify(TIDBitmap *tbm)
 		/* This does the dirty work ... */
 		tbm_mark_page_lossy(tbm, page->blockno);
 
-		if (tbm->nentries <= tbm->maxentries / 2)
+		if (tbm_memory_used(tbm) <= tbm->maxbytes / 2)
 		{
 			/*
 			 * We have made enough room. Remember where to start lossifying
@@ -1404,16 +1825,17 @@ tbm_lossify(TIDBitmap *tbm)
 
 	/*
 	 * With a big bitmap and small work_mem, it's possible that we cannot get
-	 * under maxentries.  Again, if that happens, we'd end up uselessly
+	 * under maxbytes.  Again, if that happens, we'd end up uselessly
 	 * calling tbm_lossify over and over.  To prevent this from becoming a
-	 * performance sink, force maxentries up to at least double the current
-	 * number of entries.  (In essence, we're admitting inability to fit
-	 * within work_mem when we do this.)  Note that this test will not fire if
-	 * we broke out of the loop early; and if we didn't, the current number of
-	 * entries is simply not reducible any further.
+	 * performance sink, force maxbytes up to at least double the current
+	 * memory use.  (In essence, we're admitting inability to fit within
+	 * work_mem when we do this.)  Note that this test will not fire if we
+	 * broke out of the loop early; and if we didn't, the current memory use
+	 * is simply not reducible any further.
 	 */
-	if (tbm->nentries > tbm->maxentries / 2)
-		tbm->maxentries = Min(tbm->nentries, (INT_MAX - 1) / 2) * 2;
+	if (tbm_memory_used(tbm) > tbm->maxbytes / 2)
+		tbm->maxbytes = (long) Min((double) tbm_memory_used(tbm) * 2,
+								   TBM_MAX_BYTES);
 }
 
 /*
@@ -1483,6 +1905,8 @@ tbm_attach_shared_iterate(dsa_area *dsa, dsa_pointer dp)
 		iterator->ptpages = dsa_get_address(dsa, istate->spages);
 	if (istate->nchunks)
 		iterator->ptchunks = dsa_get_address(dsa, istate->schunks);
+	if (DsaPointerIsValid(istate->bitmaps))
+		iterator->bitmaps = dsa_get_address(dsa, istate->bitmaps);
 
 	return iterator;
 }
@@ -1539,21 +1963,24 @@ pagetable_free(pagetable_hash *pagetable, void *pointer)
 /*
  * tbm_calculate_entries
  *
- * Estimate number of hashtable entries we can have within maxbytes.
+ * Estimate number of exact pages we can have within maxbytes, if about
+ * tuples_per_page tuples are stored for each page.
  */
 long
-tbm_calculate_entries(double maxbytes)
+tbm_calculate_entries(double maxbytes, double tuples_per_page)
 {
 	long		nbuckets;
+	double		bytes_per_page = TBM_ENTRY_BYTES;
 
 	/*
-	 * Estimate number of hashtable entries we can have within maxbytes. This
-	 * estimates the hash cost as sizeof(PagetableEntry), which is good enough
-	 * for our purpose.  Also count an extra Pointer per entry for the arrays
-	 * created during iteration readout.
+	 * Pages with more tuples than fit in the hashtable entry usually need a
+	 * bitmap, though not if the tuples form a few ranges of offsets.  We
+	 * don't know that, so assume the worst.
 	 */
-	nbuckets = maxbytes /
-		(sizeof(PagetableEntry) + sizeof(Pointer) + sizeof(Pointer));
+	if (tuples_per_page > TBM_MAX_OFFSETS)
+		bytes_per_page += sizeof(TBMBitmap);
+
+	nbuckets = maxbytes / bytes_per_page;
 	nbuckets = Min(nbuckets, INT_MAX - 1);	/* safety limit */
 	nbuckets = Max(nbuckets, 16);	/* sanity limit */
 
@@ -18,6 +18,7 @@
 #include <limits.h>
 #include <math.h>
 
+#include "access/stratnum.h"
 #include "access/sysattr.h"
 #include "access/tsmapi.h"
 #include "catalog/pg_class.h"
@@ -27,6 +28,7 @@
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
+#include "nodes/supportnodes.h"
 #ifdef OPTIMIZER_DEBUG
 #include "nodes/print.h"
 #endif
@@ -145,6 +147,11 @@ static void subquery_push_qual(Query *subquery,
 							   RangeTblEntry *rte, Index rti, Node *qual);
 static void recurse_push_qual(Node *setOp, Query *topquery,
 							  RangeTblEntry *rte, Index rti, Node *qual);
+static void check_and_push_window_quals(Query *subquery, Index rti,
+										Node *clause,
+										pushdown_safety_info *safetyInfo);
+static bool find_window_run_conditions(Query *subquery, Expr *expr,
+									   OpExpr *opexpr, bool wfunc_left);
 static void remove_unused_subquery_outputs(Query *subquery, RelOptInfo *rel);
 
 
@@ -596,6 +603,8 @@ static void
 set_rel_consider_parallel(PlannerInfo *root, RelOptInfo *rel,
 						  RangeTblEntry *rte)
 {
+	char		relpersistence;
+
 	/*
 	 * The flag has previously been initialized to false, so we can just
 	 * return if it becomes clear that we can't safely set it.
@@ -621,9 +630,12 @@ set_rel_consider_parallel(PlannerInfo *root, RelOptInfo *rel,
 			 * taught the workers to read them.  Writing a large number of
 			 * temporary buffers could be expensive, though, and we don't have
 			 * the rest of the necessary infrastructure right now anyway.  So
-			 * for now, bail out if we see a temporary table.
+			 * for now, bail out if we see a temporary table.  Global temporary
+			 * tables keep their data in local buffers too.
 			 */
-			if (get_rel_persistence(rte->relid) == RELPERSISTENCE_TEMP)
+			relpersistence = get_rel_persistence(rte->relid);
+			if (relpersistence == RELPERSISTENCE_TEMP ||
+				relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
 				return;
 
 			/*
@@ -719,13 +731,21 @@ set_rel_consider_parallel(PlannerInfo *root, RelOptInfo *rel,
 		case RTE_CTE:
 
 			/*
-			 * CTE tuplestores aren't shared among parallel workers, so we
-			 * force all CTE scans to happen in the leader.  Also, populating
-			 * the CTE would require executing a subplan that's not available
-			 * in the worker, might be parallel-restricted, and must get
-			 * executed only once.
+			 * CTE tuplestores aren't shared among parallel workers, and
+			 * populating the CTE would require executing a subplan that's
+			 * not available in the worker, might be parallel-restricted, and
+			 * must get executed only once.  So plain CTE scans have to happen
+			 * in the leader, and set_cte_pathlist() marks them
+			 * parallel-unsafe.  A parallel-aware CTE scan instead reads rows
+			 * that the leader copies into shared memory when the parallel
+			 * query starts.  That requires the CTE's contents not to change
+			 * while the query runs, so only CTEs of the top query level,
+			 * which can't depend on any parameters, are eligible.
 			 */
-			return;
+			if (rte->self_reference || rte->ctelevelsup != 0 ||
+				root->query_level != 1)
+				return;
+			break;
 
 		case RTE_NAMEDTUPLESTORE:
 
@@ -2326,7 +2346,14 @@ set_subquery_pathlist(PlannerInfo *root, RelOptInfo *rel,
 			}
 			else
 			{
-				/* Keep it in the upper query */
+				/*
+				 * Keep it in the upper query.  If it filters on the result
+				 * of a window function, it may also let the subquery's
+				 * WindowAgg stop early.
+				 */
+				if (!rinfo->pseudoconstant && subquery->hasWindowFuncs)
+					check_and_push_window_quals(subquery, rti, clause,
+												&safetyInfo);
 				upperrestrictlist = lappend(upperrestrictlist, rinfo);
 			}
 		}
@@ -2551,7 +2578,7 @@ set_tablefunc_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 
 /*
  * set_cte_pathlist
- *		Build the (single) access path for a non-self-reference CTE RTE
+ *		Build the access paths for a non-self-reference CTE RTE
  *
  * There's no need for a separate set_cte_size phase, since we don't
  * support join-qual-parameterized paths for CTEs.
@@ -2612,7 +2639,24 @@ set_cte_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 	required_outer = rel->lateral_relids;
 
 	/* Generate appropriate path */
-	add_path(rel, create_ctescan_path(root, rel, required_outer));
+	add_path(rel, create_ctescan_path(root, rel, required_outer, 0));
+
+	/*
+	 * Consider a parallel scan of the CTE, choosing the number of workers as
+	 * if the CTE's rows were stored in a table.
+	 */
+	if (rel->consider_parallel && required_outer == NULL)
+	{
+		double		pages;
+		int			parallel_workers;
+
+		pages = ceil(cteplan->plan_rows * cteplan->plan_width / BLCKSZ);
+		parallel_workers = compute_parallel_worker(rel, pages, -1,
+												   max_parallel_workers_per_gather);
+		if (parallel_workers > 0)
+			add_partial_path(rel, create_ctescan_path(root, rel, NULL,
+													  parallel_workers));
+	}
 }
 
 /*
@@ -3719,6 +3763,228 @@ recurse_push_qual(Node *setOp, Query *topquery,
 	}
 }
 
+/*
+ * check_and_push_window_quals
+ *		Try to use an upper-level qual as a WindowAgg run condition
+ *
+ * A qual that compares a subquery output column computed by a monotonic
+ * window function against a pseudoconstant, such as "rn <= 10" on top of
+ * "row_number() OVER (...) AS rn", can't be pushed down into the subquery,
+ * since removing input rows would change the window function's results.  But
+ * once such a qual has failed for some row of a window partition, it will
+ * fail for all the remaining rows of that partition as well, so the WindowAgg
+ * needn't bother computing them.  If that's the case, add a suitable clause
+ * to the WindowClause's runCondition list.
+ *
+ * The original qual must still be checked in the upper query: we only use
+ * the run condition to cut short processing of a partition, and WindowAggs
+ * that are not at the top of the plan keep returning rows with NULL window
+ * function results once it fails.
+ */
+static void
+check_and_push_window_quals(Query *subquery, Index rti, Node *clause,
+							pushdown_safety_info *safetyInfo)
+{
+	OpExpr	   *opexpr = (OpExpr *) clause;
+	Var		   *var;
+	TargetEntry *tle;
+	bool		wfunc_left;
+
+	/* We only handle binary operator clauses */
+	if (!IsA(opexpr, OpExpr) || list_length(opexpr->args) != 2)
+		return;
+
+	/*
+	 * Rows removed by the WindowAgg could change which row DISTINCT ON picks
+	 * for each group, so don't try it there.
+	 */
+	if (subquery->hasDistinctOn)
+		return;
+
+	/* Same restrictions as qual_is_pushdown_safe applies to pushed quals */
+	if (contain_subplans(clause))
+		return;
+	if (safetyInfo->unsafeLeaky && contain_leaked_vars(clause))
+		return;
+
+	/* One side must be a plain reference to a subquery output column */
+	if (IsA(linitial(opexpr->args), Var))
+	{
+		var = (Var *) linitial(opexpr->args);
+		wfunc_left = true;
+	}
+	else if (IsA(lsecond(opexpr->args), Var))
+	{
+		var = (Var *) lsecond(opexpr->args);
+		wfunc_left = false;
+	}
+	else
+		return;
+
+	if (var->varno != rti || var->varlevelsup != 0 || var->varattno <= 0)
+		return;
+
+	tle = get_tle_by_resno(subquery->targetList, var->varattno);
+	if (tle == NULL || tle->resjunk)
+		return;
+
+	(void) find_window_run_conditions(subquery, tle->expr, opexpr,
+									  wfunc_left);
+}
+
+/*
+ * find_window_run_conditions
+ *		Add a run condition for "expr", if it is a monotonic WindowFunc
+ *
+ * opexpr is the upper-level qual, in which the reference to "expr" is the
+ * left argument if wfunc_left is true, else the right one.  Returns true if
+ * a run condition was added to the WindowFunc's WindowClause.
+ */
+static bool
+find_window_run_conditions(Query *subquery, Expr *expr, OpExpr *opexpr,
+						   bool wfunc_left)
+{
+	WindowFunc *wfunc;
+	WindowClause *wclause = NULL;
+	Expr	   *otherexpr;
+	Oid			prosupport;
+	SupportRequestWFuncMonotonic req;
+	SupportRequestWFuncMonotonic *res;
+	Oid			runoperator = InvalidOid;
+	List	   *opinfos;
+	ListCell   *lc;
+
+	while (IsA(expr, RelabelType))
+		expr = ((RelabelType *) expr)->arg;
+
+	/* We can only work with window functions */
+	if (!IsA(expr, WindowFunc))
+		return false;
+	wfunc = (WindowFunc *) expr;
+
+	/* Its arguments must not change between rows, nor contain subplans */
+	if (contain_volatile_functions((Node *) wfunc) ||
+		contain_subplans((Node *) wfunc))
+		return false;
+
+	prosupport = get_func_support(wfunc->winfnoid);
+	if (!OidIsValid(prosupport))
+		return false;
+
+	/* The value being compared must not change during the partition */
+	otherexpr = (Expr *) (wfunc_left ? lsecond(opexpr->args) :
+						  linitial(opexpr->args));
+	if (!is_pseudo_constant_clause((Node *) otherexpr))
+		return false;
+
+	foreach(lc, subquery->windowClause)
+	{
+		WindowClause *wc = lfirst_node(WindowClause, lc);
+
+		if (wc->winref == wfunc->winref)
+		{
+			wclause = wc;
+			break;
+		}
+	}
+	if (wclause == NULL)
+		elog(ERROR, "could not find WindowClause for winref %u",
+			 wfunc->winref);
+
+	req.type = T_SupportRequestWFuncMonotonic;
+	req.window_func = wfunc;
+	req.window_clause = wclause;
+	req.monotonic = MONOTONICFUNC_NONE;
+
+	res = (SupportRequestWFuncMonotonic *)
+		DatumGetPointer(OidFunctionCall1(prosupport,
+										 PointerGetDatum(&req)));
+
+	if (res == NULL || res->monotonic == MONOTONICFUNC_NONE)
+		return false;
+
+	/*
+	 * Work out which operator the run condition must use, if any.  For a
+	 * monotonically increasing function, "wfunc < const" can only go from
+	 * true to false as the partition is processed; likewise "wfunc > const"
+	 * for a decreasing one, and the commuted forms.  An equality qual can't
+	 * be used as such, but it implies a usable inequality.
+	 */
+	opinfos = get_op_btree_interpretation(opexpr->opno);
+	foreach(lc, opinfos)
+	{
+		OpBtreeInterpretation *opinfo = (OpBtreeInterpretation *) lfirst(lc);
+		int			strategy = opinfo->strategy;
+
+		if (strategy == BTLessStrategyNumber ||
+			strategy == BTLessEqualStrategyNumber)
+		{
+			if ((wfunc_left && (res->monotonic & MONOTONICFUNC_INCREASING)) ||
+				(!wfunc_left && (res->monotonic & MONOTONICFUNC_DECREASING)))
+				runoperator = opexpr->opno;
+			break;
+		}
+		else if (strategy == BTGreaterStrategyNumber ||
+				 strategy == BTGreaterEqualStrategyNumber)
+		{
+			if ((wfunc_left && (res->monotonic & MONOTONICFUNC_DECREASING)) ||
+				(!wfunc_left && (res->monotonic & MONOTONICFUNC_INCREASING)))
+				runoperator = opexpr->opno;
+			break;
+		}
+		else if (strategy == BTEqualStrategyNumber)
+		{
+			int16		newstrategy;
+
+			/* a function that never changes can use the equality as is */
+			if ((res->monotonic & MONOTONICFUNC_BOTH) == MONOTONICFUNC_BOTH)
+			{
+				runoperator = opexpr->opno;
+				break;
+			}
+
+			/*
+			 * Otherwise "wfunc = const" becomes "wfunc <= const" when
+			 * increasing and "wfunc >= const" when decreasing.
+			 */
+			if (res->monotonic & MONOTONICFUNC_INCREASING)
+				newstrategy = wfunc_left ? BTLessEqualStrategyNumber :
+					BTGreaterEqualStrategyNumber;
+			else
+				newstrategy = wfunc_left ? BTGreaterEqualStrategyNumber :
+					BTLessEqualStrategyNumber;
+
+			runoperator = get_opfamily_member(opinfo->opfamily_id,
+											  opinfo->oplefttype,
+											  opinfo->oprighttype,
+											  newstrategy);
+			break;
+		}
+	}
+	list_free_deep(opinfos);
+
+	if (!OidIsValid(runoperator))
+		return false;
+
+	/* Build the run condition, keeping the WindowFunc on the same side */
+	if (wfunc_left)
+		expr = make_opclause(runoperator, opexpr->opresulttype,
+							 opexpr->opretset,
+							 (Expr *) copyObject(wfunc),
+							 (Expr *) copyObject(otherexpr),
+							 opexpr->opcollid, opexpr->inputcollid);
+	else
+		expr = make_opclause(runoperator, opexpr->opresulttype,
+							 opexpr->opretset,
+							 (Expr *) copyObject(otherexpr),
+							 (Expr *) copyObject(wfunc),
+							 opexpr->opcollid, opexpr->inputcollid);
+
+	wclause->runCondition = lappend(wclause->runCondition, expr);
+
+	return true;
+}
+
 /*****************************************************************************
  *			SIMPLIFYING SUBQUERY TARGETLISTS
  *****************************************************************************/
@@ -4132,6 +4398,9 @@ print_path(PlannerInfo *root, Path *path, int indent)
 		case T_TidPath:
 			ptype = "TidScan";
 			break;
+		case T_TidRangePath:
+			ptype = "TidRangePath";
+			break;
 		case T_SubqueryScanPath:
 			ptype = "SubqueryScan";
 			break;
@@ -4166,6 +4435,10 @@ print_path(PlannerInfo *root, Path *path, int indent)
 			ptype = "Material";
 			subpath = ((MaterialPath *) path)->subpath;
 			break;
+		case T_ResultCachePath:
+			ptype = "ResultCache";
+			subpath = ((ResultCachePath *) path)->subpath;
+			break;
 		case T_UniquePath:
 			ptype = "Unique";
 			subpath = ((UniquePath *) path)->subpath;
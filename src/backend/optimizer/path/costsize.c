@@ -139,14 +139,18 @@ bool		enable_incremental_sort = true;
 bool		enable_hashagg = true;
 bool		enable_nestloop = true;
 bool		enable_material = true;
+bool		enable_resultcache = false;
 bool		enable_mergejoin = true;
 bool		enable_hashjoin = true;
 bool		enable_gathermerge = true;
 bool		enable_partitionwise_join = false;
 bool		enable_partitionwise_aggregate = false;
+bool		enable_partitionwise_window = false;
 bool		enable_parallel_append = true;
 bool		enable_parallel_hash = true;
+bool		enable_parallel_sort = false;
 bool		enable_partition_pruning = true;
+bool		enable_async_append = true;
 
 typedef struct
 {
@@ -158,6 +162,9 @@ static List *extract_nonindex_conditions(List *qual_clauses, List *indexclauses)
 static MergeScanSelCache *cached_scansel(PlannerInfo *root,
 										 RestrictInfo *rinfo,
 										 PathKey *pathkey);
+static void cost_resultcache_rescan(PlannerInfo *root, ResultCachePath *rcpath,
+									Cost *rescan_startup_cost,
+									Cost *rescan_total_cost);
 static void cost_rescan(PlannerInfo *root, Path *path,
 						Cost *rescan_startup_cost, Cost *rescan_total_cost);
 static bool cost_qual_eval_walker(Node *node, cost_qual_eval_context *context);
@@ -552,7 +559,11 @@ cost_index(IndexPath *path, PlannerInfo *root, double loop_count,
 	 * the fraction of main-table tuples we will have to retrieve) and its
 	 * correlation to the main-table tuple order.  We need a cast here because
 	 * pathnodes.h uses a weak function type to avoid including amapi.h.
+	 *
+	 * Mark a partial path as parallel-aware first, since an index AM may
+	 * scan the index differently when the scan is shared among workers.
 	 */
+	path->path.parallel_aware = partial_path;
 	amcostestimate = (amcostestimate_function) index->amcostestimate;
 	amcostestimate(root, path, loop_count,
 				   &indexStartupCost, &indexTotalCost,
@@ -713,8 +724,6 @@ cost_index(IndexPath *path, PlannerInfo *root, double loop_count,
 		 */
 		if (path->path.parallel_workers <= 0)
 			return;
-
-		path->path.parallel_aware = true;
 	}
 
 	/*
@@ -1283,6 +1292,101 @@ cost_tidscan(Path *path, PlannerInfo *root,
 	path->total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_tidrangescan
+ *	  Determines and sets the costs of scanning a relation using a range of
+ *	  TIDs for 'path'
+ *
+ * 'baserel' is the relation to be scanned
+ * 'tidrangequals' is the list of TID-checkable range quals
+ * 'param_info' is the ParamPathInfo if this is a parameterized path, else NULL
+ */
+void
+cost_tidrangescan(Path *path, PlannerInfo *root,
+				  RelOptInfo *baserel, List *tidrangequals,
+				  ParamPathInfo *param_info)
+{
+	Selectivity selectivity;
+	double		pages;
+	Cost		startup_cost = 0;
+	Cost		run_cost = 0;
+	QualCost	qpqual_cost;
+	Cost		cpu_per_tuple;
+	QualCost	tid_qual_cost;
+	double		ntuples;
+	double		nseqpages;
+	double		spc_random_page_cost;
+	double		spc_seq_page_cost;
+
+	/* Should only be applied to base relations */
+	Assert(baserel->relid > 0);
+	Assert(baserel->rtekind == RTE_RELATION);
+
+	/* Mark the path with the correct row estimate */
+	if (param_info)
+		path->rows = param_info->ppi_rows;
+	else
+		path->rows = baserel->rows;
+
+	/* Count how many tuples and pages we expect to scan */
+	selectivity = clauselist_selectivity(root, tidrangequals, baserel->relid,
+										 JOIN_INNER, NULL);
+	pages = ceil(selectivity * baserel->pages);
+
+	if (pages <= 0.0)
+		pages = 1.0;
+
+	/*
+	 * The first page in a range requires a random seek, but each subsequent
+	 * page is just a normal sequential page read.  NOTE: it's desirable for
+	 * TID Range Scans to cost more than the equivalent Sequential Scans,
+	 * because Seq Scans have some performance advantages such as scan
+	 * synchronization and parallelizability, and we'd prefer one of them to
+	 * be picked unless a TID Range Scan really is better.
+	 */
+	ntuples = selectivity * baserel->tuples;
+	nseqpages = pages - 1.0;
+
+	if (!enable_tidscan)
+		startup_cost += disable_cost;
+
+	/*
+	 * The TID qual expressions will be computed once, any other baserestrict
+	 * quals once per retrieved tuple.
+	 */
+	cost_qual_eval(&tid_qual_cost, tidrangequals, root);
+
+	/* fetch estimated page cost for tablespace containing table */
+	get_tablespace_page_costs(baserel->reltablespace,
+							  &spc_random_page_cost,
+							  &spc_seq_page_cost);
+
+	/* disk costs; 1 random page and the remainder as seq pages */
+	run_cost += spc_random_page_cost + spc_seq_page_cost * nseqpages;
+
+	/* Add scanning CPU costs */
+	get_restriction_qual_cost(root, baserel, param_info, &qpqual_cost);
+
+	/*
+	 * XXX currently we assume TID quals are a subset of qpquals at this
+	 * point; they will be removed (if possible) when we create the plan, so
+	 * we subtract their cost from the total qpqual cost.  (If the TID quals
+	 * can't be removed, this is a mistake and we're going to underestimate
+	 * the CPU cost a bit.)
+	 */
+	startup_cost += qpqual_cost.startup + tid_qual_cost.per_tuple;
+	cpu_per_tuple = cpu_tuple_cost + qpqual_cost.per_tuple -
+		tid_qual_cost.per_tuple;
+	run_cost += cpu_per_tuple * ntuples;
+
+	/* tlist eval costs are paid per output row, not per tuple scanned */
+	startup_cost += path->pathtarget->cost.startup;
+	run_cost += path->pathtarget->cost.per_tuple * path->rows;
+
+	path->startup_cost = startup_cost;
+	path->total_cost = startup_cost + run_cost;
+}
+
 /*
  * cost_subqueryscan
  *	  Determines and returns the cost of scanning a subquery RTE.
@@ -1539,6 +1643,22 @@ cost_ctescan(Path *path, PlannerInfo *root,
 	startup_cost += path->pathtarget->cost.startup;
 	run_cost += path->pathtarget->cost.per_tuple * path->rows;
 
+	/* Adjust costing for parallelism, if used. */
+	if (path->parallel_workers > 0)
+	{
+		double		parallel_divisor = get_parallel_divisor(path);
+
+		/*
+		 * Before the scan starts, the leader copies all the rows into a
+		 * shared tuplestore.  After that, the CPU cost is divided among all
+		 * the participants.
+		 */
+		startup_cost += cpu_tuple_cost * baserel->tuples;
+		run_cost /= parallel_divisor;
+
+		path->rows = clamp_row_est(path->rows / parallel_divisor);
+	}
+
 	path->startup_cost = startup_cost;
 	path->total_cost = startup_cost + run_cost;
 }
@@ -1958,6 +2078,61 @@ cost_sort(Path *path, PlannerInfo *root,
 	path->total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_parallel_sort
+ *	  Determines and returns the cost of a parallel-aware sort.
+ *
+ * Each participant sorts its share of the input, 'tuples' rows as for any
+ * partial path, and writes it out as a single run.  The last participant to
+ * finish then reads back and merges the runs of all of them, so the output
+ * of the whole sort is produced by that one process.  path->parallel_workers
+ * must already be set.
+ */
+void
+cost_parallel_sort(Path *path, PlannerInfo *root,
+				   List *pathkeys, Cost input_cost, double tuples, int width,
+				   int sort_mem)
+{
+	Cost		startup_cost;
+	Cost		run_cost;
+	Cost		comparison_cost = 2.0 * cpu_operator_cost;
+	double		parallel_divisor = get_parallel_divisor(path);
+	double		total_tuples;
+	double		nruns;
+	double		npages;
+
+	/* Sorting our own share, as if it were a serial sort */
+	cost_tuplesort(&startup_cost, &run_cost,
+				   tuples, width,
+				   0.0, sort_mem,
+				   -1.0);
+
+	if (!enable_sort)
+		startup_cost += disable_cost;
+
+	startup_cost += input_cost;
+
+	total_tuples = clamp_row_est(tuples * parallel_divisor);
+	nruns = path->parallel_workers + (parallel_leader_participation ? 1 : 0);
+	npages = ceil(relation_byte_size(total_tuples, width) / BLCKSZ);
+
+	/*
+	 * Each participant writes its own run, in parallel with the others.  The
+	 * merge then reads all of them back, and needs about log2(nruns)
+	 * comparisons per output tuple, plus a small cost per extracted tuple as
+	 * charged by cost_tuplesort().
+	 */
+	startup_cost += seq_page_cost * npages / parallel_divisor;
+	startup_cost += comparison_cost * nruns * LOG2(nruns);
+	run_cost = seq_page_cost * npages;
+	run_cost += total_tuples * comparison_cost * LOG2(nruns);
+	run_cost += cpu_operator_cost * total_tuples;
+
+	path->rows = tuples;
+	path->startup_cost = startup_cost;
+	path->total_cost = startup_cost + run_cost;
+}
+
 /*
  * append_nonpartial_cost
  *	  Estimate the cost of the non-partial paths in a Parallel Append.
@@ -4045,6 +4220,11 @@ cost_rescan(PlannerInfo *root, Path *path,
 				*rescan_total_cost = run_cost;
 			}
 			break;
+		case T_ResultCache:
+			/* Rescans are answered from the cache, if we're lucky */
+			cost_resultcache_rescan(root, (ResultCachePath *) path,
+									rescan_startup_cost, rescan_total_cost);
+			break;
 		default:
 			*rescan_startup_cost = path->startup_cost;
 			*rescan_total_cost = path->total_cost;
@@ -4052,6 +4232,74 @@ cost_rescan(PlannerInfo *root, Path *path,
 	}
 }
 
+/*
+ * cost_resultcache_rescan
+ *	  Determines the estimated cost of rescanning a ResultCache node.
+ *
+ * Each rescan first looks up the parameter values in the cache.  On a hit
+ * the cached rows are returned, which costs about as much as reading them
+ * back from a Material node; on a miss the subpath is rescanned and its
+ * rows are added to the cache, possibly evicting older entries.  The hit
+ * ratio follows from the number of distinct parameter values expected
+ * among the rescans and from how many entries fit in hash_mem.
+ *
+ * As a side effect, this sets rcpath->est_entries, which the executor uses
+ * to size its hash table.
+ */
+static void
+cost_resultcache_rescan(PlannerInfo *root, ResultCachePath *rcpath,
+						Cost *rescan_startup_cost, Cost *rescan_total_cost)
+{
+	Path	   *subpath = rcpath->subpath;
+	double		tuples = subpath->rows;
+	double		calls = Max(rcpath->calls, 1.0);
+	double		hash_mem_bytes = get_hash_mem() * 1024.0;
+	double		est_entry_bytes;
+	double		est_cache_entries;
+	double		ndistinct;
+	double		fit_ratio;
+	double		hit_ratio;
+	double		miss_ratio;
+	Cost		lookup_cost;
+
+	/*
+	 * Estimate the size of an entry: its rows, plus the key and some
+	 * bookkeeping.  relation_byte_size() accounts for the tuple headers.
+	 */
+	est_entry_bytes = relation_byte_size(tuples, subpath->pathtarget->width) +
+		MAXALIGN(SizeofMinimalTupleHeader) + 64;
+	est_cache_entries = floor(hash_mem_bytes / est_entry_bytes);
+
+	ndistinct = estimate_num_groups(root, rcpath->param_exprs, calls, NULL);
+	ndistinct = clamp_row_est(Min(ndistinct, calls));
+
+	rcpath->est_entries = (uint32) Min(Min(ndistinct, est_cache_entries),
+									   PG_UINT32_MAX);
+
+	/*
+	 * Only the rescans after the first with each value can hit the cache,
+	 * and only if the entry hasn't been evicted in the meantime.  Assume the
+	 * latter in proportion to the fraction of the entries that don't fit.
+	 */
+	fit_ratio = Min(est_cache_entries / ndistinct, 1.0);
+	hit_ratio = (1.0 - ndistinct / calls) * fit_ratio;
+	hit_ratio = Max(Min(hit_ratio, 1.0), 0.0);
+	miss_ratio = 1.0 - hit_ratio;
+
+	/* every rescan hashes and compares the cache keys */
+	lookup_cost = cpu_tuple_cost +
+		cpu_operator_cost * list_length(rcpath->param_exprs);
+
+	*rescan_startup_cost = lookup_cost + subpath->startup_cost * miss_ratio;
+	*rescan_total_cost = lookup_cost +
+		hit_ratio * cpu_operator_cost * tuples +
+		miss_ratio * (subpath->total_cost + cpu_tuple_cost * tuples);
+
+	/* a miss with a full cache must evict something first */
+	if (fit_ratio < 1.0)
+		*rescan_total_cost += miss_ratio * cpu_tuple_cost;
+}
+
 
 /*
  * cost_qual_eval
@@ -4191,10 +4439,6 @@ cost_qual_eval_walker(Node *node, cost_qual_eval_context *context)
 	}
 	else if (IsA(node, ScalarArrayOpExpr))
 	{
-		/*
-		 * Estimate that the operator will be applied to about half of the
-		 * array elements before the answer is determined.
-		 */
 		ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *) node;
 		Node	   *arraynode = (Node *) lsecond(saop->args);
 		QualCost	sacosts;
@@ -4203,9 +4447,32 @@ cost_qual_eval_walker(Node *node, cost_qual_eval_context *context)
 		sacosts.startup = sacosts.per_tuple = 0;
 		add_function_cost(context->root, saop->opfuncid, NULL,
 						  &sacosts);
-		context->total.startup += sacosts.startup;
-		context->total.per_tuple += sacosts.per_tuple *
-			estimate_array_length(arraynode) * 0.5;
+
+		if (OidIsValid(saop->hashfuncid))
+		{
+			QualCost	hcosts;
+
+			/*
+			 * The hash table is built once, hashing each array element.
+			 * Then each lookup costs one hash and, normally, one comparison.
+			 */
+			hcosts.startup = hcosts.per_tuple = 0;
+			add_function_cost(context->root, saop->hashfuncid, NULL,
+							  &hcosts);
+			context->total.startup += sacosts.startup + hcosts.startup +
+				hcosts.per_tuple * estimate_array_length(arraynode);
+			context->total.per_tuple += hcosts.per_tuple + sacosts.per_tuple;
+		}
+		else
+		{
+			/*
+			 * Estimate that the operator will be applied to about half of
+			 * the array elements before the answer is determined.
+			 */
+			context->total.startup += sacosts.startup;
+			context->total.per_tuple += sacosts.per_tuple *
+				estimate_array_length(arraynode) * 0.5;
+		}
 	}
 	else if (IsA(node, Aggref) ||
 			 IsA(node, WindowFunc))
@@ -5839,7 +6106,8 @@ compute_bitmap_pages(PlannerInfo *root, RelOptInfo *baserel, Path *bitmapqual,
 	 * the bitmap at one time.)
 	 */
 	heap_pages = Min(pages_fetched, baserel->pages);
-	maxentries = tbm_calculate_entries(work_mem * 1024L);
+	maxentries = tbm_calculate_entries(work_mem * 1024L,
+									   tuples_fetched / Max(heap_pages, 1.0));
 
 	if (loop_count > 1)
 	{
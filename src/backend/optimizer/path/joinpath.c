@@ -18,10 +18,14 @@
 
 #include "executor/executor.h"
 #include "foreign/fdwapi.h"
+#include "nodes/nodeFuncs.h"
 #include "optimizer/cost.h"
+#include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
 #include "optimizer/planmain.h"
+#include "utils/lsyscache.h"
+#include "utils/typcache.h"
 
 /* Hook for plugins to get control in add_paths_to_joinrel() */
 set_join_pathlist_hook_type set_join_pathlist_hook = NULL;
@@ -354,6 +358,130 @@ allow_star_schema_join(PlannerInfo *root,
 			bms_nonempty_difference(inner_paramrels, outerrelids));
 }
 
+/*
+ * paraminfo_get_equal_hashops
+ *		Determine the outer expressions that the parameterized path's
+ *		parameters are computed from, and hashable equality operators to
+ *		compare their values with.
+ *
+ * Returns false if some clause of the parameterization isn't a binary
+ * operator clause with one side computed from the outer rel alone, or if
+ * that side's type can't be hashed.
+ */
+static bool
+paraminfo_get_equal_hashops(ParamPathInfo *param_info, RelOptInfo *outerrel,
+							List **param_exprs, List **operators)
+{
+	ListCell   *lc;
+
+	*param_exprs = NIL;
+	*operators = NIL;
+
+	foreach(lc, param_info->ppi_clauses)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+		OpExpr	   *opexpr;
+		Node	   *expr;
+		Oid			exprtype;
+		TypeCacheEntry *typentry;
+
+		if (!IsA(rinfo->clause, OpExpr) ||
+			list_length(((OpExpr *) rinfo->clause)->args) != 2)
+			return false;
+		opexpr = (OpExpr *) rinfo->clause;
+
+		if (bms_is_subset(rinfo->left_relids, outerrel->relids) &&
+			!bms_overlap(rinfo->right_relids, outerrel->relids))
+			expr = (Node *) linitial(opexpr->args);
+		else if (bms_is_subset(rinfo->right_relids, outerrel->relids) &&
+				 !bms_overlap(rinfo->left_relids, outerrel->relids))
+			expr = (Node *) lsecond(opexpr->args);
+		else
+			return false;
+
+		if (contain_volatile_functions(expr))
+			return false;
+
+		exprtype = exprType(expr);
+		typentry = lookup_type_cache(exprtype,
+									 TYPECACHE_HASH_PROC | TYPECACHE_EQ_OPR);
+		if (!OidIsValid(typentry->hash_proc) ||
+			!OidIsValid(typentry->eq_opr) ||
+			!op_hashjoinable(typentry->eq_opr, exprtype))
+			return false;
+
+		*param_exprs = lappend(*param_exprs, expr);
+		*operators = lappend_oid(*operators, typentry->eq_opr);
+	}
+
+	return *param_exprs != NIL;
+}
+
+/*
+ * get_resultcache_path
+ *		If possible, make a ResultCache path to cache the rows of the
+ *		parameterized 'inner_path' for each distinct set of values the outer
+ *		rel supplies.  Returns NULL if that can't be done.
+ */
+static Path *
+get_resultcache_path(PlannerInfo *root, RelOptInfo *innerrel,
+					 RelOptInfo *outerrel, Path *inner_path,
+					 Path *outer_path, JoinType jointype,
+					 JoinPathExtraData *extra)
+{
+	List	   *param_exprs;
+	List	   *hash_operators;
+	bool		singlerow;
+	ListCell   *lc;
+
+	if (!enable_resultcache)
+		return NULL;
+
+	/* Only rescans with changed parameter values can be saved */
+	if (!PATH_PARAM_BY_REL(inner_path, outerrel) || outer_path->rows < 2)
+		return NULL;
+
+	/*
+	 * Lateral references are parameters too, which we don't know how to
+	 * compute from the outer rel.
+	 */
+	if (!bms_is_empty(innerrel->lateral_relids))
+		return NULL;
+
+	/* Don't cache rows that might differ between calls with the same keys */
+	if (contain_volatile_functions((Node *) innerrel->reltarget->exprs))
+		return NULL;
+	foreach(lc, innerrel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		if (contain_volatile_functions((Node *) rinfo->clause))
+			return NULL;
+	}
+
+	/*
+	 * If the nestloop only needs the first inner row that passes the join
+	 * quals, it won't read any further, so an entry would never be known to
+	 * be complete, unless it can be marked complete after its first row.
+	 * That's only safe if the join has no quals other than the ones used as
+	 * parameters, meaning the first row always passes.
+	 */
+	singlerow = (extra->inner_unique ||
+				 jointype == JOIN_SEMI || jointype == JOIN_ANTI);
+	if (singlerow &&
+		list_length(inner_path->param_info->ppi_clauses) <
+		list_length(extra->restrictlist))
+		return NULL;
+
+	if (!paraminfo_get_equal_hashops(inner_path->param_info, outerrel,
+									 &param_exprs, &hash_operators))
+		return NULL;
+
+	return (Path *) create_resultcache_path(root, innerrel, inner_path,
+											param_exprs, hash_operators,
+											singlerow, outer_path->rows);
+}
+
 /*
  * try_nestloop_path
  *	  Consider a nestloop join path; if it appears useful, push it into
@@ -1471,6 +1599,7 @@ match_unsorted_outer(PlannerInfo *root,
 			foreach(lc2, innerrel->cheapest_parameterized_paths)
 			{
 				Path	   *innerpath = (Path *) lfirst(lc2);
+				Path	   *rcpath;
 
 				try_nestloop_path(root,
 								  joinrel,
@@ -1479,6 +1608,22 @@ match_unsorted_outer(PlannerInfo *root,
 								  merge_pathkeys,
 								  jointype,
 								  extra);
+
+				/*
+				 * Also consider caching the inner rows for each distinct set
+				 * of parameter values.
+				 */
+				rcpath = get_resultcache_path(root, innerrel, outerrel,
+											  innerpath, outerpath, jointype,
+											  extra);
+				if (rcpath != NULL)
+					try_nestloop_path(root,
+									  joinrel,
+									  outerpath,
+									  rcpath,
+									  merge_pathkeys,
+									  jointype,
+									  extra);
 			}
 
 			/* Also consider materialized form of the cheapest inner path */
@@ -1633,6 +1778,7 @@ consider_parallel_nestloop(PlannerInfo *root,
 		foreach(lc2, innerrel->cheapest_parameterized_paths)
 		{
 			Path	   *innerpath = (Path *) lfirst(lc2);
+			Path	   *rcpath;
 
 			/* Can't join to an inner path that is not parallel-safe */
 			if (!innerpath->parallel_safe)
@@ -1657,6 +1803,14 @@ consider_parallel_nestloop(PlannerInfo *root,
 
 			try_partial_nestloop_path(root, joinrel, outerpath, innerpath,
 									  pathkeys, jointype, extra);
+
+			/* Each worker can keep a cache of its own */
+			rcpath = get_resultcache_path(root, innerrel, outerrel,
+										  innerpath, outerpath, jointype,
+										  extra);
+			if (rcpath != NULL)
+				try_partial_nestloop_path(root, joinrel, outerpath, rcpath,
+										  pathkeys, jointype, extra);
 		}
 	}
 }
@@ -1842,18 +1996,11 @@ hash_inner_and_outer(PlannerInfo *root,
 		 * If the joinrel is parallel-safe, we may be able to consider a
 		 * partial hash join.  However, we can't handle JOIN_UNIQUE_OUTER,
 		 * because the outer path will be partial, and therefore we won't be
-		 * able to properly guarantee uniqueness.  Similarly, we can't handle
-		 * JOIN_FULL and JOIN_RIGHT, because they can produce false null
-		 * extended rows.  Also, the resulting path must not be parameterized.
-		 * We would be able to support JOIN_FULL and JOIN_RIGHT for Parallel
-		 * Hash, since in that case we're back to a single hash table with a
-		 * single set of match bits for each batch, but that will require
-		 * figuring out a deadlock-free way to wait for the probe to finish.
+		 * able to properly guarantee uniqueness.  Also, the resulting path
+		 * must not be parameterized.
 		 */
 		if (joinrel->consider_parallel &&
 			save_jointype != JOIN_UNIQUE_OUTER &&
-			save_jointype != JOIN_FULL &&
-			save_jointype != JOIN_RIGHT &&
 			outerrel->partial_pathlist != NIL &&
 			bms_is_empty(joinrel->lateral_relids))
 		{
@@ -1887,9 +2034,14 @@ hash_inner_and_outer(PlannerInfo *root,
 			 * total inner path will also be parallel-safe, but if not, we'll
 			 * have to search for the cheapest safe, unparameterized inner
 			 * path.  If doing JOIN_UNIQUE_INNER, we can't use any alternative
-			 * inner path.
+			 * inner path.  If doing JOIN_FULL or JOIN_RIGHT, we can't use a
+			 * hash table built separately in each backend, because no one
+			 * process would have all the match bits; only Parallel Hash,
+			 * above, can produce the unmatched inner tuples correctly.
 			 */
-			if (cheapest_total_inner->parallel_safe)
+			if (save_jointype == JOIN_FULL || save_jointype == JOIN_RIGHT)
+				cheapest_safe_inner = NULL;
+			else if (cheapest_total_inner->parallel_safe)
 				cheapest_safe_inner = cheapest_total_inner;
 			else if (save_jointype != JOIN_UNIQUE_INNER)
 				cheapest_safe_inner =
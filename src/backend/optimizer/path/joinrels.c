@@ -45,6 +45,8 @@ static void try_partitionwise_join(PlannerInfo *root, RelOptInfo *rel1,
 static SpecialJoinInfo *build_child_join_sjinfo(PlannerInfo *root,
 												SpecialJoinInfo *parent_sjinfo,
 												Relids left_relids, Relids right_relids);
+static void free_child_join_sjinfo(SpecialJoinInfo *child_sjinfo,
+								   SpecialJoinInfo *parent_sjinfo);
 static void compute_partition_bounds(PlannerInfo *root, RelOptInfo *rel1,
 									 RelOptInfo *rel2, RelOptInfo *joinrel,
 									 SpecialJoinInfo *parent_sjinfo,
@@ -1548,6 +1550,15 @@ try_partitionwise_join(PlannerInfo *root, RelOptInfo *rel1, RelOptInfo *rel2,
 		populate_joinrel_with_paths(root, child_rel1, child_rel2,
 									child_joinrel, child_sjinfo,
 									child_restrictlist);
+
+		/*
+		 * The child SpecialJoinInfo and relids are not referenced by any of
+		 * the paths we just built, so release them now rather than letting
+		 * them pile up across thousands of partition pairs.  The translated
+		 * restriction list must be kept, since the join paths point to it.
+		 */
+		free_child_join_sjinfo(child_sjinfo, parent_sjinfo);
+		bms_free(child_joinrelids);
 	}
 }
 
@@ -1593,6 +1604,30 @@ build_child_join_sjinfo(PlannerInfo *root, SpecialJoinInfo *parent_sjinfo,
 	return sjinfo;
 }
 
+/*
+ * Free memory consumed by a SpecialJoinInfo created by
+ * build_child_join_sjinfo().
+ *
+ * Only the relid sets that were actually translated are freed; untranslated
+ * ones are shared with the parent's SpecialJoinInfo.  semi_rhs_exprs and
+ * semi_operators may be referenced from a UniquePath, so they are left alone.
+ */
+static void
+free_child_join_sjinfo(SpecialJoinInfo *child_sjinfo,
+					   SpecialJoinInfo *parent_sjinfo)
+{
+	if (child_sjinfo->min_lefthand != parent_sjinfo->min_lefthand)
+		bms_free(child_sjinfo->min_lefthand);
+	if (child_sjinfo->min_righthand != parent_sjinfo->min_righthand)
+		bms_free(child_sjinfo->min_righthand);
+	if (child_sjinfo->syn_lefthand != parent_sjinfo->syn_lefthand)
+		bms_free(child_sjinfo->syn_lefthand);
+	if (child_sjinfo->syn_righthand != parent_sjinfo->syn_righthand)
+		bms_free(child_sjinfo->syn_righthand);
+
+	pfree(child_sjinfo);
+}
+
 /*
  * compute_partition_bounds
  *		Compute the partition bounds for a join rel from those for inputs
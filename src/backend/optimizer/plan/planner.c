@@ -67,6 +67,7 @@
 
 /* GUC parameters */
 double		cursor_tuple_fraction = DEFAULT_CURSOR_TUPLE_FRACTION;
+int			query_work_mem = -1;
 int			force_parallel_mode = FORCE_PARALLEL_OFF;
 bool		parallel_leader_participation = true;
 
@@ -133,6 +134,8 @@ static void inheritance_planner(PlannerInfo *root);
 static void grouping_planner(PlannerInfo *root, bool inheritance_update,
 							 double tuple_fraction);
 static grouping_sets_data *preprocess_grouping_sets(PlannerInfo *root);
+static double count_work_mem_consumers(Plan *plan, int nparticipants);
+static int	compute_query_work_mem(PlannerGlobal *glob, Plan *top_plan);
 static List *remap_to_groupclause_idx(List *groupClause, List *gsets,
 									  int *tleref_to_colnum_map);
 static void preprocess_rowmarks(PlannerInfo *root);
@@ -182,13 +185,20 @@ static RelOptInfo *create_window_paths(PlannerInfo *root,
 									   bool output_target_parallel_safe,
 									   WindowFuncLists *wflists,
 									   List *activeWindows);
-static void create_one_window_path(PlannerInfo *root,
-								   RelOptInfo *window_rel,
-								   Path *path,
-								   PathTarget *input_target,
-								   PathTarget *output_target,
-								   WindowFuncLists *wflists,
-								   List *activeWindows);
+static Path *create_one_window_path(PlannerInfo *root,
+									RelOptInfo *window_rel,
+									Path *path,
+									PathTarget *input_target,
+									PathTarget *output_target,
+									WindowFuncLists *wflists,
+									List *activeWindows);
+static void create_partitionwise_window_paths(PlannerInfo *root,
+											  RelOptInfo *input_rel,
+											  RelOptInfo *window_rel,
+											  PathTarget *input_target,
+											  PathTarget *output_target,
+											  WindowFuncLists *wflists,
+											  List *activeWindows);
 static RelOptInfo *create_distinct_paths(PlannerInfo *root,
 										 RelOptInfo *input_rel);
 static RelOptInfo *create_ordered_paths(PlannerInfo *root,
@@ -553,12 +563,160 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 			result->jitFlags |= PGJIT_DEFORM;
 	}
 
+	result->workMem = compute_query_work_mem(glob, top_plan);
+
 	if (glob->partition_directory != NULL)
 		DestroyPartitionDirectory(glob->partition_directory);
 
 	return result;
 }
 
+/*
+ * count_work_mem_consumers
+ *	  Count the plan nodes in a tree that may each use up to work_mem.
+ *
+ * Hash-based nodes are entitled to hash_mem rather than work_mem, so they
+ * are weighted by hash_mem_multiplier.  Below a Gather or Gather Merge, each
+ * node runs in every participating process, so it counts once for each of
+ * them; a Parallel Hash builds one shared table instead, but it is allowed
+ * hash_mem for each participant, so it counts the same.  This deliberately
+ * errs on the side of counting nodes that might not actually consume their
+ * full allowance.
+ */
+static double
+count_work_mem_consumers(Plan *plan, int nparticipants)
+{
+	double		count = 0;
+	List	   *children = NIL;
+	ListCell   *lc;
+
+	if (plan == NULL)
+		return 0;
+
+	switch (nodeTag(plan))
+	{
+		case T_Gather:
+			/* in single-copy mode, the leader doesn't run the subplan */
+			nparticipants = ((Gather *) plan)->num_workers;
+			if (!((Gather *) plan)->single_copy)
+				nparticipants++;
+			break;
+		case T_GatherMerge:
+			nparticipants = ((GatherMerge *) plan)->num_workers + 1;
+			break;
+		default:
+			break;
+	}
+
+	switch (nodeTag(plan))
+	{
+		case T_Sort:
+		case T_IncrementalSort:
+		case T_Material:
+		case T_WindowAgg:
+		case T_CteScan:
+		case T_FunctionScan:
+		case T_BitmapIndexScan:
+		case T_BitmapOr:
+			count += 1;
+			break;
+		case T_Hash:
+		case T_RecursiveUnion:
+		case T_ResultCache:
+			count += hash_mem_multiplier;
+			break;
+		case T_Agg:
+			{
+				Agg		   *agg = (Agg *) plan;
+
+				if (agg->aggstrategy == AGG_HASHED ||
+					agg->aggstrategy == AGG_MIXED)
+					count += hash_mem_multiplier;
+				if (agg->aggstrategy == AGG_MIXED || agg->chain != NIL)
+					count += 1;
+			}
+			break;
+		case T_SetOp:
+			if (((SetOp *) plan)->strategy == SETOP_HASHED)
+				count += hash_mem_multiplier;
+			break;
+		default:
+			break;
+	}
+
+	count *= nparticipants;
+
+	switch (nodeTag(plan))
+	{
+		case T_ModifyTable:
+			children = ((ModifyTable *) plan)->plans;
+			break;
+		case T_Append:
+			children = ((Append *) plan)->appendplans;
+			break;
+		case T_MergeAppend:
+			children = ((MergeAppend *) plan)->mergeplans;
+			break;
+		case T_BitmapAnd:
+			children = ((BitmapAnd *) plan)->bitmapplans;
+			break;
+		case T_BitmapOr:
+			children = ((BitmapOr *) plan)->bitmapplans;
+			break;
+		case T_SubqueryScan:
+			count += count_work_mem_consumers(((SubqueryScan *) plan)->subplan,
+											  nparticipants);
+			break;
+		case T_CustomScan:
+			children = ((CustomScan *) plan)->custom_plans;
+			break;
+		default:
+			break;
+	}
+
+	foreach(lc, children)
+		count += count_work_mem_consumers((Plan *) lfirst(lc), nparticipants);
+
+	count += count_work_mem_consumers(plan->lefttree, nparticipants);
+	count += count_work_mem_consumers(plan->righttree, nparticipants);
+
+	return count;
+}
+
+/*
+ * compute_query_work_mem
+ *	  Divide query_work_mem among the memory-consuming nodes of a plan.
+ *
+ * Returns the work_mem value, in kilobytes, that the executor should use for
+ * each node of this plan, or 0 if the plan isn't subject to a query-level
+ * budget.  The result never exceeds work_mem, so a budget can only ever
+ * lower the per-node limit; and it never goes below 64kB, the minimum
+ * work_mem, so a plan with very many nodes may exceed the budget.
+ */
+static int
+compute_query_work_mem(PlannerGlobal *glob, Plan *top_plan)
+{
+	double		consumers;
+	double		per_node;
+	ListCell   *lc;
+
+	if (query_work_mem < 0)
+		return 0;
+
+	consumers = count_work_mem_consumers(top_plan, 1);
+	foreach(lc, glob->subplans)
+		consumers += count_work_mem_consumers((Plan *) lfirst(lc), 1);
+
+	if (consumers <= 0)
+		return 0;
+
+	per_node = (double) query_work_mem / consumers;
+	if (per_node >= work_mem)
+		return 0;
+
+	return (int) Max(per_node, 64);
+}
+
 
 /*--------------------
  * subquery_planner
@@ -800,6 +958,10 @@ subquery_planner(PlannerGlobal *glob, Query *parse,
 												EXPRKIND_LIMIT);
 		wc->endOffset = preprocess_expression(root, wc->endOffset,
 											  EXPRKIND_LIMIT);
+		/* processed like the targetlist, so that its WindowFuncs match */
+		wc->runCondition = (List *) preprocess_expression(root,
+														  (Node *) wc->runCondition,
+														  EXPRKIND_TARGET);
 	}
 
 	parse->limitOffset = preprocess_expression(root, parse->limitOffset,
@@ -1087,6 +1249,14 @@ preprocess_expression(PlannerInfo *root, Node *expr, int kind)
 		  (kind == EXPRKIND_RTFUNC_LATERAL && !root->hasJoinRTEs)))
 		expr = eval_const_expressions(root, expr);
 
+	/*
+	 * Check for ANY ScalarArrayOpExpr with Const arrays and set the
+	 * hashfuncid of any that might execute more quickly by using hash lookups
+	 * instead of a linear search.
+	 */
+	if (kind == EXPRKIND_QUAL || kind == EXPRKIND_TARGET)
+		convert_saop_to_hashed_saop(expr);
+
 	/*
 	 * If it's a qual or havingQual, canonicalize it.
 	 */
@@ -4581,15 +4751,30 @@ create_window_paths(PlannerInfo *root,
 			pathkeys_count_contained_in(root->window_pathkeys, path->pathkeys,
 										&presorted_keys) ||
 			presorted_keys > 0)
-			create_one_window_path(root,
-								   window_rel,
-								   path,
-								   input_target,
-								   output_target,
-								   wflists,
-								   activeWindows);
+			add_path(window_rel,
+					 create_one_window_path(root,
+											window_rel,
+											path,
+											input_target,
+											output_target,
+											wflists,
+											activeWindows));
 	}
 
+	/*
+	 * If every window partitions by the input's partition key, each partition
+	 * of the input can be processed by a different parallel worker.
+	 */
+	if (enable_partitionwise_window && window_rel->consider_parallel &&
+		IS_PARTITIONED_REL(input_rel))
+		create_partitionwise_window_paths(root,
+										  input_rel,
+										  window_rel,
+										  input_target,
+										  output_target,
+										  wflists,
+										  activeWindows);
+
 	/*
 	 * If there is an FDW that's responsible for all baserels of the query,
 	 * let it consider adding ForeignPaths.
@@ -4613,7 +4798,7 @@ create_window_paths(PlannerInfo *root,
 
 /*
  * Stack window-function implementation steps atop the given Path, and
- * add the result to window_rel.
+ * return the result, which the caller must add to window_rel.
  *
  * window_rel: upperrel to contain result
  * path: input Path to use (must return input_target)
@@ -4622,7 +4807,7 @@ create_window_paths(PlannerInfo *root,
  * wflists: result of find_window_functions
  * activeWindows: result of select_active_windows
  */
-static void
+static Path *
 create_one_window_path(PlannerInfo *root,
 					   RelOptInfo *window_rel,
 					   Path *path,
@@ -4723,9 +4908,103 @@ create_one_window_path(PlannerInfo *root,
 		path = (Path *)
 			create_windowagg_path(root, window_rel, path, window_target,
 								  wflists->windowFuncs[wc->winref],
-								  wc);
+								  wc,
+								  lnext(activeWindows, l) == NULL);
 	}
 
+	return path;
+}
+
+/*
+ * create_partitionwise_window_paths
+ *
+ * Window functions never look across window partitions, so if every active
+ * window's PARTITION BY includes all of the input relation's partition keys,
+ * no window partition spans two partitions of the input.  A Parallel Append
+ * that runs each input partition to completion in a single process then
+ * gives every participant whole window partitions, and the sorting and
+ * window function evaluation can be done below a Gather Merge instead of
+ * serially above it.
+ *
+ * We build the Parallel Append from the cheapest non-partial path of each
+ * child; partial child paths would split a partition among workers.
+ */
+static void
+create_partitionwise_window_paths(PlannerInfo *root,
+								  RelOptInfo *input_rel,
+								  RelOptInfo *window_rel,
+								  PathTarget *input_target,
+								  PathTarget *output_target,
+								  WindowFuncLists *wflists,
+								  List *activeWindows)
+{
+	List	   *subpaths = NIL;
+	int			parallel_workers;
+	Path	   *path;
+	double		rows;
+	ListCell   *lc;
+	int			i;
+
+	foreach(lc, activeWindows)
+	{
+		WindowClause *wc = lfirst_node(WindowClause, lc);
+
+		if (!group_by_has_partkey(input_rel, root->processed_tlist,
+								  wc->partitionClause))
+			return;
+	}
+
+	for (i = 0; i < input_rel->nparts; i++)
+	{
+		RelOptInfo *child_rel = input_rel->part_rels[i];
+		Path	   *child_path;
+
+		/* Pruned or dummy children can be ignored. */
+		if (child_rel == NULL || IS_DUMMY_REL(child_rel))
+			continue;
+
+		child_path = child_rel->cheapest_total_path;
+		if (child_path == NULL || !child_path->parallel_safe ||
+			child_path->param_info != NULL)
+			return;
+
+		subpaths = lappend(subpaths, child_path);
+	}
+
+	/* With a single partition, there's nothing to divide among workers. */
+	if (list_length(subpaths) < 2)
+		return;
+
+	parallel_workers = Max(fls(list_length(subpaths)),
+						   input_rel->rel_parallel_workers);
+	parallel_workers = Min(parallel_workers,
+						   max_parallel_workers_per_gather);
+	if (parallel_workers <= 0)
+		return;
+
+	path = (Path *) create_append_path(root, input_rel, subpaths, NIL,
+									   NIL, NULL, parallel_workers, true,
+									   NIL, -1);
+
+	path = create_one_window_path(root,
+								  window_rel,
+								  path,
+								  input_target,
+								  output_target,
+								  wflists,
+								  activeWindows);
+
+	rows = path->rows * path->parallel_workers;
+	if (path->pathkeys != NIL)
+		path = (Path *) create_gather_merge_path(root, window_rel, path,
+												 path->pathtarget,
+												 path->pathkeys, NULL,
+												 &rows);
+	else
+		path = (Path *) create_gather_path(root, window_rel, path,
+										   path->pathtarget, NULL,
+										   &rows);
+
 	add_path(window_rel, path);
 }
 
@@ -5096,6 +5375,33 @@ create_ordered_paths(PlannerInfo *root,
 												path, target);
 
 			add_path(ordered_rel, path);
+
+			/*
+			 * Alternatively, have all participants feed one Parallel Sort,
+			 * whose runs are merged by whichever participant finishes last,
+			 * and use a plain Gather.  A shared sort can't be bounded, so
+			 * don't bother if there's a LIMIT.
+			 */
+			if (enable_parallel_sort && limit_tuples < 0)
+			{
+				path = (Path *) create_parallel_sort_path(root,
+														  ordered_rel,
+														  cheapest_partial_path,
+														  root->sort_pathkeys);
+				path = (Path *)
+					create_gather_path(root, ordered_rel,
+									   path,
+									   path->pathtarget,
+									   NULL,
+									   &total_groups);
+
+				/* Add projection step if needed */
+				if (path->pathtarget != target)
+					path = apply_projection_to_path(root, ordered_rel,
+													path, target);
+
+				add_path(ordered_rel, path);
+			}
 		}
 
 		/*
@@ -6350,7 +6656,8 @@ plan_cluster_use_sort(Oid tableOid, Oid indexOid)
  *		CREATE INDEX should request for use
  *
  * tableOid is the table on which the index is to be built.  indexOid is the
- * OID of an index to be created or reindexed (which must be a btree index).
+ * OID of an index to be created or reindexed (which must be a btree, gin, gist,
+ * brin or hash index).
  *
  * Return value is the number of parallel worker processes to request.  It
  * may be unsafe to proceed if this is 0.  Note that this does not include the
@@ -6426,11 +6733,11 @@ plan_create_index_workers(Oid tableOid, Oid indexOid)
 	/*
 	 * Determine if it's safe to proceed.
 	 *
-	 * Currently, parallel workers can't access the leader's temporary tables.
-	 * Furthermore, any index predicate or index expressions must be parallel
-	 * safe.
+	 * Currently, parallel workers can't access the leader's temporary tables,
+	 * nor its copy of a global temporary table.  Furthermore, any index
+	 * predicate or index expressions must be parallel safe.
 	 */
-	if (heap->rd_rel->relpersistence == RELPERSISTENCE_TEMP ||
+	if (RelationUsesLocalBuffers(heap) ||
 		!is_parallel_safe(root, (Node *) RelationGetIndexExpressions(index)) ||
 		!is_parallel_safe(root, (Node *) RelationGetIndexPredicate(index)))
 	{
@@ -619,6 +619,22 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 								  rtoffset, 1);
 			}
 			break;
+		case T_TidRangeScan:
+			{
+				TidRangeScan *splan = (TidRangeScan *) plan;
+
+				splan->scan.scanrelid += rtoffset;
+				splan->scan.plan.targetlist =
+					fix_scan_list(root, splan->scan.plan.targetlist,
+								  rtoffset, NUM_EXEC_TLIST(plan));
+				splan->scan.plan.qual =
+					fix_scan_list(root, splan->scan.plan.qual,
+								  rtoffset, NUM_EXEC_QUAL(plan));
+				splan->tidrangequals =
+					fix_scan_list(root, splan->tidrangequals,
+								  rtoffset, 1);
+			}
+			break;
 		case T_SubqueryScan:
 			/* Needs special treatment, see comments below */
 			return set_subqueryscan_references(root,
@@ -756,6 +772,18 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 			 */
 			Assert(plan->qual == NIL);
 			break;
+		case T_ResultCache:
+			{
+				ResultCache *rcplan = (ResultCache *) plan;
+
+				/* The cache keys are only Params, but fix them up anyway */
+				rcplan->param_exprs = fix_scan_list(root, rcplan->param_exprs,
+													rtoffset,
+													NUM_EXEC_TLIST(plan));
+				set_dummy_tlist_references(plan, rtoffset);
+				Assert(plan->qual == NIL);
+			}
+			break;
 		case T_LockRows:
 			{
 				LockRows   *splan = (LockRows *) plan;
@@ -826,6 +854,29 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 			{
 				WindowAgg  *wplan = (WindowAgg *) plan;
 
+				/*
+				 * The run condition is checked against the node's own output
+				 * tuple, so rather than computing its WindowFuncs again we
+				 * make them Vars referencing our targetlist.  The executor
+				 * passes the output tuple as the inner tuple, since a
+				 * WindowAgg has no inner plan of its own.  This must be done
+				 * before set_upper_references modifies the targetlist.
+				 */
+				if (wplan->runCondition != NIL)
+				{
+					indexed_tlist *itlist;
+
+					itlist = build_tlist_index(plan->targetlist);
+					wplan->runCondition = (List *)
+						fix_upper_expr(root,
+									   (Node *) wplan->runCondition,
+									   itlist,
+									   INNER_VAR,
+									   rtoffset,
+									   NUM_EXEC_QUAL(plan));
+					pfree(itlist);
+				}
+
 				set_upper_references(root, plan, rtoffset);
 
 				/*
@@ -837,6 +888,9 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 					fix_scan_expr(root, wplan->startOffset, rtoffset, 1);
 				wplan->endOffset =
 					fix_scan_expr(root, wplan->endOffset, rtoffset, 1);
+				wplan->runConditionOrig =
+					fix_scan_list(root, wplan->runConditionOrig, rtoffset,
+								  NUM_EXEC_QUAL(plan));
 			}
 			break;
 		case T_Result:
@@ -1633,9 +1687,13 @@ fix_expr_common(PlannerInfo *root, Node *node)
 	}
 	else if (IsA(node, ScalarArrayOpExpr))
 	{
-		set_sa_opfuncid((ScalarArrayOpExpr *) node);
-		record_plan_function_dependency(root,
-										((ScalarArrayOpExpr *) node)->opfuncid);
+		ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *) node;
+
+		set_sa_opfuncid(saop);
+		record_plan_function_dependency(root, saop->opfuncid);
+
+		if (OidIsValid(saop->hashfuncid))
+			record_plan_function_dependency(root, saop->hashfuncid);
 	}
 	else if (IsA(node, Const))
 	{
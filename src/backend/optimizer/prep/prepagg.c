@@ -64,6 +64,7 @@ static int	find_compatible_trans(PlannerInfo *root, Aggref *newagg,
 								  Datum initValue, bool initValueIsNull,
 								  List *transnos);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
+static bool agg_args_support_sendreceive(Aggref *aggref);
 
 /* -----------------
  * Resolve the transition type of all Aggrefs, and determine which Aggrefs
@@ -308,6 +309,15 @@ preprocess_aggref(Aggref *aggref, PlannerInfo *root)
 						 (!OidIsValid(transinfo->serialfn_oid) ||
 						  !OidIsValid(transinfo->deserialfn_oid)))
 					root->hasNonSerialAggs = true;
+
+				/*
+				 * array_agg(anynonarray) serializes its by-reference inputs
+				 * with their types' send and receive functions, which a type
+				 * need not have.
+				 */
+				else if (transinfo->serialfn_oid == F_ARRAY_AGG_SERIALIZE &&
+						 !agg_args_support_sendreceive(aggref))
+					root->hasNonSerialAggs = true;
 			}
 		}
 		agginfo->transno = transno;
@@ -496,6 +506,38 @@ find_compatible_trans(PlannerInfo *root, Aggref *newagg, bool shareable,
 	return -1;
 }
 
+/*
+ * Do all the aggregate's by-reference argument types have binary send and
+ * receive functions?
+ */
+static bool
+agg_args_support_sendreceive(Aggref *aggref)
+{
+	ListCell   *lc;
+
+	foreach(lc, aggref->args)
+	{
+		TargetEntry *tle = (TargetEntry *) lfirst(lc);
+		Oid			type = exprType((Node *) tle->expr);
+		HeapTuple	typeTuple;
+		Form_pg_type pt;
+		bool		supported;
+
+		typeTuple = SearchSysCache1(TYPEOID, ObjectIdGetDatum(type));
+		if (!HeapTupleIsValid(typeTuple))
+			elog(ERROR, "cache lookup failed for type %u", type);
+		pt = (Form_pg_type) GETSTRUCT(typeTuple);
+		supported = pt->typbyval ||
+			(OidIsValid(pt->typsend) && OidIsValid(pt->typreceive));
+		ReleaseSysCache(typeTuple);
+
+		if (!supported)
+			return false;
+	}
+
+	return true;
+}
+
 static Datum
 GetAggInitVal(Datum textInitVal, Oid transtype)
 {
@@ -691,6 +691,15 @@ scanNSItemForColumn(ParseState *pstate, ParseNamespaceItem *nsitem,
 						colname),
 				 parser_errposition(pstate, location)));
 
+	/* Publication WHERE clauses are evaluated on decoded tuples */
+	if (pstate->p_expr_kind == EXPR_KIND_PUBLICATION_WHERE &&
+		attnum < InvalidAttrNumber)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+				 errmsg("cannot use system column \"%s\" in publication WHERE expression",
+						colname),
+				 parser_errposition(pstate, location)));
+
 	/* In generated column, no system column is allowed except tableOid */
 	if (pstate->p_expr_kind == EXPR_KIND_GENERATED_COLUMN &&
 		attnum < InvalidAttrNumber && attnum != TableOidAttributeNumber)
@@ -24,6 +24,10 @@
 #include <sys/file.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
 #ifdef HAVE_SYS_IPC_H
 #include <sys/ipc.h>
 #endif
@@ -41,6 +45,15 @@
 #include "utils/guc.h"
 #include "utils/pidfile.h"
 
+/*
+ * NUMA placement of the main shared memory region is implemented with the
+ * mbind(2) system call, directly rather than through libnuma.
+ */
+#if defined(__linux__) && defined(SYS_mbind) && defined(MPOL_INTERLEAVE)
+#define USE_SHMEM_NUMA
+#define SHMEM_NUMA_MAX_NODES	1024
+#endif
+
 
 /*
  * As of PostgreSQL 9.3, we normally allocate only a very small amount of
@@ -106,6 +119,7 @@ static void IpcMemoryDelete(int status, Datum shmId);
 static IpcMemoryState PGSharedMemoryAttach(IpcMemoryId shmId,
 										   void *attachAt,
 										   PGShmemHeader **addr);
+static void SetSharedMemoryNumaPolicy(void *addr, Size size);
 
 
 /*
@@ -547,20 +561,93 @@ GetHugePageSize(Size *hugepagesize, int *mmap_flags)
 
 #endif							/* MAP_HUGETLB */
 
+/*
+ * Apply the memory policy requested by shared_memory_numa to the main shared
+ * memory region at addr.
+ *
+ * The kernel decides where a page goes when it is first touched, so this must
+ * be done before the region is initialized.  Interleaving spreads buffer
+ * blocks, buffer descriptors and the buffer mapping table evenly over the
+ * memory of all nodes, rather than leaving them wherever the postmaster
+ * happened to run.  Failure isn't fatal, since only performance is at stake.
+ */
+static void
+SetSharedMemoryNumaPolicy(void *addr, Size size)
+{
+#ifdef USE_SHMEM_NUMA
+	unsigned long nodemask[SHMEM_NUMA_MAX_NODES / (8 * sizeof(unsigned long))];
+	FILE	   *fp;
+	char		buf[1024];
+	char	   *p;
+	int			nnodes = 0;
+
+	if (shared_memory_numa == SHMEM_NUMA_OFF)
+		return;
+
+	/*
+	 * Find the nodes that have memory, listed in a format like "0-1,3".  If
+	 * we can't find out, assume there's nothing to interleave over.
+	 */
+	memset(nodemask, 0, sizeof(nodemask));
+	fp = AllocateFile("/sys/devices/system/node/has_memory", "r");
+	if (fp == NULL)
+		return;
+	if (fgets(buf, sizeof(buf), fp) == NULL)
+		buf[0] = '\0';
+	FreeFile(fp);
+
+	p = buf;
+	while (*p >= '0' && *p <= '9')
+	{
+		long		first;
+		long		last;
+
+		first = last = strtol(p, &p, 10);
+		if (*p == '-')
+			last = strtol(p + 1, &p, 10);
+		for (long node = first; node <= last && node < SHMEM_NUMA_MAX_NODES; node++)
+		{
+			nodemask[node / (8 * sizeof(unsigned long))] |=
+				1UL << (node % (8 * sizeof(unsigned long)));
+			nnodes++;
+		}
+		if (*p == ',')
+			p++;
+	}
+
+	if (nnodes <= 1)
+	{
+		elog(DEBUG1, "only one NUMA node has memory, not interleaving shared memory");
+		return;
+	}
+
+	/* The kernel wants one more than the number of bits in the mask */
+	if (syscall(SYS_mbind, addr, size, MPOL_INTERLEAVE, nodemask,
+				(unsigned long) SHMEM_NUMA_MAX_NODES + 1, 0) != 0)
+		ereport(LOG,
+				(errmsg("could not interleave shared memory over NUMA nodes: %m")));
+	else
+		elog(DEBUG1, "interleaved shared memory over %d NUMA nodes", nnodes);
+#endif							/* USE_SHMEM_NUMA */
+}
+
 /*
  * Creates an anonymous mmap()ed shared memory segment.
  *
  * Pass the requested size in *size.  This function will modify *size to the
  * actual size of the allocation, if it ends up allocating a segment that is
- * larger than requested.
+ * larger than requested.  The size of the huge pages used is returned in
+ * *hugepagesize_used, or zero if huge pages are not used.
  */
 static void *
-CreateAnonymousSegment(Size *size)
+CreateAnonymousSegment(Size *size, Size *hugepagesize_used)
 {
 	Size		allocsize = *size;
 	void	   *ptr = MAP_FAILED;
 	int			mmap_errno = 0;
 
+	*hugepagesize_used = 0;
+
 #ifndef MAP_HUGETLB
 	/* PGSharedMemoryCreate should have dealt with this case */
 	Assert(huge_pages != HUGE_PAGES_ON);
@@ -584,6 +671,8 @@ CreateAnonymousSegment(Size *size)
 		if (huge_pages == HUGE_PAGES_TRY && ptr == MAP_FAILED)
 			elog(DEBUG1, "mmap(%zu) with MAP_HUGETLB failed, huge pages disabled: %m",
 				 allocsize);
+		if (ptr != MAP_FAILED)
+			*hugepagesize_used = hugepagesize;
 	}
 #endif
 
@@ -656,6 +745,8 @@ PGSharedMemoryCreate(Size size,
 	PGShmemHeader *hdr;
 	struct stat statbuf;
 	Size		sysvsize;
+	Size		hugepagesize_used = 0;
+	char		buf[32];
 
 	/*
 	 * We use the data directory's ID info (inode and device numbers) to
@@ -676,14 +767,25 @@ PGSharedMemoryCreate(Size size,
 				 errmsg("huge pages not supported on this platform")));
 #endif
 
+	/* Likewise for NUMA interleaving */
+#ifndef USE_SHMEM_NUMA
+	if (shared_memory_numa != SHMEM_NUMA_OFF)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("NUMA memory policies are not supported on this platform")));
+#endif
+
 	/* Room for a header? */
 	Assert(size > MAXALIGN(sizeof(PGShmemHeader)));
 
 	if (shared_memory_type == SHMEM_TYPE_MMAP)
 	{
-		AnonymousShmem = CreateAnonymousSegment(&size);
+		AnonymousShmem = CreateAnonymousSegment(&size, &hugepagesize_used);
 		AnonymousShmemSize = size;
 
+		/* Nothing has touched the new pages yet, so set their policy now */
+		SetSharedMemoryNumaPolicy(AnonymousShmem, size);
+
 		/* Register on-exit routine to unmap the anonymous segment */
 		on_shmem_exit(AnonymousShmemDetach, (Datum) 0);
 
@@ -778,6 +880,15 @@ PGSharedMemoryCreate(Size size,
 			elog(LOG, "shmdt(%p) failed: %m", oldhdr);
 	}
 
+	/* With System V shared memory, this is the main region itself */
+	if (AnonymousShmem == NULL)
+		SetSharedMemoryNumaPolicy(memAddress, size);
+
+	/* Report the huge page size actually in use */
+	snprintf(buf, sizeof(buf), "%zu", hugepagesize_used / 1024);
+	SetConfigOption("shared_memory_huge_page_size", buf, PGC_INTERNAL,
+					PGC_S_DYNAMIC_DEFAULT);
+
 	/* Initialize new segment. */
 	hdr = (PGShmemHeader *) memAddress;
 	hdr->creatorPID = getpid();
@@ -16,6 +16,7 @@
 #include "storage/dsm.h"
 #include "storage/ipc.h"
 #include "storage/pg_shmem.h"
+#include "utils/guc.h"
 
 /*
  * Early in a process's life, Windows asynchronously creates threads for the
@@ -208,6 +209,12 @@ PGSharedMemoryCreate(Size size,
 	SIZE_T		largePageSize = 0;
 	Size		orig_size = size;
 	DWORD		flProtect = PAGE_READWRITE;
+	char		buf[32];
+
+	if (shared_memory_numa != SHMEM_NUMA_OFF)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("NUMA memory policies are not supported on this platform")));
 
 	ShmemProtectiveRegion = VirtualAlloc(NULL, PROTECTIVE_REGION_SIZE,
 										 MEM_RESERVE, PAGE_NOACCESS);
@@ -374,6 +381,12 @@ retry:
 	hdr->freeoffset = MAXALIGN(sizeof(PGShmemHeader));
 	hdr->dsm_control = 0;
 
+	/* Report the huge page size actually in use */
+	snprintf(buf, sizeof(buf), "%zu",
+			 (flProtect & SEC_LARGE_PAGES) != 0 ? largePageSize / 1024 : 0);
+	SetConfigOption("shared_memory_huge_page_size", buf, PGC_INTERNAL,
+					PGC_S_DYNAMIC_DEFAULT);
+
 	/* Save info for possible future use */
 	UsedShmemSegAddr = memAddress;
 	UsedShmemSegSize = size;
@@ -123,6 +123,7 @@ int			autovacuum_anl_thresh;
 double		autovacuum_anl_scale;
 int			autovacuum_freeze_max_age;
 int			autovacuum_multixact_freeze_max_age;
+int			autovacuum_parallel_workers = 0;
 
 double		autovacuum_vac_cost_delay;
 int			autovacuum_vac_cost_limit;
@@ -185,6 +186,14 @@ typedef struct av_relation
 								 * reloptions, or NULL if none */
 } av_relation;
 
+/* struct to keep track of tables to vacuum and/or analyze, before rechecking */
+typedef struct av_candidate
+{
+	Oid			ac_relid;
+	bool		ac_wraparound;	/* is vacuum forced by wraparound risk? */
+	double		ac_priority;	/* see relation_needs_vacanalyze */
+} av_candidate;
+
 /* struct to keep track of tables to vacuum and/or analyze, after rechecking */
 typedef struct autovac_table
 {
@@ -328,11 +337,15 @@ static void FreeWorkerInfo(int code, Datum arg);
 static autovac_table *table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 											TupleDesc pg_class_desc,
 											int effective_multixact_freeze_max_age);
+static void add_candidate(List **candidates, Oid relid, bool wraparound,
+						  double priority);
+static int	candidate_comparator(const ListCell *a, const ListCell *b);
 static void relation_needs_vacanalyze(Oid relid, AutoVacOpts *relopts,
 									  Form_pg_class classForm,
 									  PgStat_StatTabEntry *tabentry,
 									  int effective_multixact_freeze_max_age,
-									  bool *dovacuum, bool *doanalyze, bool *wraparound);
+									  bool *dovacuum, bool *doanalyze, bool *wraparound,
+									  double *priority);
 
 static void autovacuum_do_vac_analyze(autovac_table *tab,
 									  BufferAccessStrategy bstrategy);
@@ -1952,7 +1965,7 @@ do_autovacuum(void)
 	HeapTuple	tuple;
 	TableScanDesc relScan;
 	Form_pg_database dbForm;
-	List	   *table_oids = NIL;
+	List	   *candidates = NIL;
 	List	   *orphan_oids = NIL;
 	HASHCTL		ctl;
 	HTAB	   *table_toast_map;
@@ -2077,6 +2090,7 @@ do_autovacuum(void)
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		double		priority;
 
 		if (classForm->relkind != RELKIND_RELATION &&
 			classForm->relkind != RELKIND_MATVIEW)
@@ -2084,6 +2098,13 @@ do_autovacuum(void)
 
 		relid = classForm->oid;
 
+		/*
+		 * Global temporary tables' contents are private to the sessions using
+		 * them, so there's nothing for us to do.
+		 */
+		if (classForm->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+			continue;
+
 		/*
 		 * Check if it is a temp table (presumably, of some other backend's).
 		 * We cannot safely process other backends' temp tables.
@@ -2117,11 +2138,12 @@ do_autovacuum(void)
 		/* Check if it needs vacuum or analyze */
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
 								  effective_multixact_freeze_max_age,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound,
+								  &priority);
 
-		/* Relations that need work are added to table_oids */
+		/* Relations that need work are added to candidates */
 		if (dovacuum || doanalyze)
-			table_oids = lappend_oid(table_oids, relid);
+			add_candidate(&candidates, relid, wraparound, priority);
 
 		/*
 		 * Remember TOAST associations for the second pass.  Note: we must do
@@ -2170,11 +2192,14 @@ do_autovacuum(void)
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		double		priority;
 
 		/*
 		 * We cannot safely process other backends' temp tables, so skip 'em.
+		 * Likewise for the toast tables of global temporary tables.
 		 */
-		if (classForm->relpersistence == RELPERSISTENCE_TEMP)
+		if (classForm->relpersistence == RELPERSISTENCE_TEMP ||
+			classForm->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
 			continue;
 
 		relid = classForm->oid;
@@ -2200,16 +2225,26 @@ do_autovacuum(void)
 
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
 								  effective_multixact_freeze_max_age,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound,
+								  &priority);
 
 		/* ignore analyze for toast tables */
 		if (dovacuum)
-			table_oids = lappend_oid(table_oids, relid);
+			add_candidate(&candidates, relid, wraparound, priority);
 	}
 
 	table_endscan(relScan);
 	table_close(classRel, AccessShareLock);
 
+	/*
+	 * Process the most urgent tables first: those at risk of wraparound,
+	 * and then the others in decreasing order of priority.  Since all the
+	 * workers in this database do the same, they tend to work on the most
+	 * urgent tables concurrently, rather than leaving them waiting behind
+	 * many less urgent ones.
+	 */
+	list_sort(candidates, candidate_comparator);
+
 	/*
 	 * Recheck orphan temporary tables, and if they still seem orphaned, drop
 	 * them.  We'll eat a transaction per dropped table, which might seem
@@ -2315,9 +2350,9 @@ do_autovacuum(void)
 	/*
 	 * Perform operations on collected tables.
 	 */
-	foreach(cell, table_oids)
+	foreach(cell, candidates)
 	{
-		Oid			relid = lfirst_oid(cell);
+		Oid			relid = ((av_candidate *) lfirst(cell))->ac_relid;
 		HeapTuple	classTup;
 		autovac_table *tab;
 		bool		isshared;
@@ -2769,12 +2804,10 @@ get_pgstat_tabentry_relid(Oid relid, bool isshared, PgStat_StatDBEntry *shared,
 	if (isshared)
 	{
 		if (PointerIsValid(shared))
-			tabentry = hash_search(shared->tables, &relid,
-								   HASH_FIND, NULL);
+			tabentry = pgstat_fetch_stat_tabentry_ext(true, relid);
 	}
 	else if (PointerIsValid(dbentry))
-		tabentry = hash_search(dbentry->tables, &relid,
-							   HASH_FIND, NULL);
+		tabentry = pgstat_fetch_stat_tabentry_ext(false, relid);
 
 	return tabentry;
 }
@@ -2801,6 +2834,7 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 	PgStat_StatDBEntry *shared;
 	PgStat_StatDBEntry *dbentry;
 	bool		wraparound;
+	double		priority;
 	AutoVacOpts *avopts;
 
 	/* use fresh stats */
@@ -2837,7 +2871,7 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 
 	relation_needs_vacanalyze(relid, avopts, classForm, tabentry,
 							  effective_multixact_freeze_max_age,
-							  &dovacuum, &doanalyze, &wraparound);
+							  &dovacuum, &doanalyze, &wraparound, &priority);
 
 	/* ignore ANALYZE for toast tables */
 	if (classForm->relkind == RELKIND_TOASTVALUE)
@@ -2908,13 +2942,28 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 			(!wraparound ? VACOPT_SKIP_LOCKED : 0);
 		tab->at_params.index_cleanup = VACOPT_TERNARY_DEFAULT;
 		tab->at_params.truncate = VACOPT_TERNARY_DEFAULT;
-		/* As of now, we don't support parallel vacuum for autovacuum */
-		tab->at_params.nworkers = -1;
+
+		/*
+		 * Parallel vacuum is only used for tables at risk of wraparound, and
+		 * only if autovacuum_parallel_workers allows it.
+		 */
+		tab->at_params.nworkers = (wraparound && dovacuum &&
+								   autovacuum_parallel_workers > 0)
+			? autovacuum_parallel_workers : -1;
 		tab->at_params.freeze_min_age = freeze_min_age;
 		tab->at_params.freeze_table_age = freeze_table_age;
 		tab->at_params.multixact_freeze_min_age = multixact_freeze_min_age;
 		tab->at_params.multixact_freeze_table_age = multixact_freeze_table_age;
 		tab->at_params.is_wraparound = wraparound;
+
+		/*
+		 * Consider the table insert-mostly if less than 5% of the tuples ever
+		 * inserted into it were updated or deleted.  VACUUM freezes such a
+		 * table as soon as its pages become all-visible.
+		 */
+		tab->at_params.insert_mostly = tabentry != NULL &&
+			(tabentry->tuples_updated + tabentry->tuples_deleted) * 20 <
+			tabentry->tuples_inserted;
 		tab->at_params.log_min_duration = log_min_duration;
 		tab->at_vacuum_cost_limit = vac_cost_limit;
 		tab->at_vacuum_cost_delay = vac_cost_delay;
@@ -2936,6 +2985,41 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 	return tab;
 }
 
+/*
+ * add_candidate
+ *
+ * Add a relation that needs to be vacuumed or analyzed to the list of
+ * candidates of do_autovacuum.
+ */
+static void
+add_candidate(List **candidates, Oid relid, bool wraparound, double priority)
+{
+	av_candidate *cand = palloc(sizeof(av_candidate));
+
+	cand->ac_relid = relid;
+	cand->ac_wraparound = wraparound;
+	cand->ac_priority = priority;
+	*candidates = lappend(*candidates, cand);
+}
+
+/*
+ * candidate_comparator
+ *
+ * list_sort comparator putting the most urgent candidates first.
+ */
+static int
+candidate_comparator(const ListCell *a, const ListCell *b)
+{
+	av_candidate *ca = (av_candidate *) lfirst(a);
+	av_candidate *cb = (av_candidate *) lfirst(b);
+
+	if (ca->ac_wraparound != cb->ac_wraparound)
+		return ca->ac_wraparound ? -1 : 1;
+	if (ca->ac_priority != cb->ac_priority)
+		return (ca->ac_priority > cb->ac_priority) ? -1 : 1;
+	return 0;
+}
+
 /*
  * relation_needs_vacanalyze
  *
@@ -2963,6 +3047,13 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
  * transactions back, and if its relminmxid is more than
  * multixact_freeze_max_age multixacts back.
  *
+ * "priority" is set to a measure of how urgently the relation needs work,
+ * for ordering the relations to process: the largest of the ratios of its
+ * dead tuples, inserted tuples and changed tuples to their thresholds, and
+ * of the age of its relfrozenxid and relminmxid to the corresponding freeze
+ * max age.  A value of 1 or more for any of them means that the relation
+ * needs work.
+ *
  * A table whose autovacuum_enabled option is false is
  * automatically skipped (unless we have to vacuum it due to freeze_max_age).
  * Thus autovacuum can be disabled for specific tables. Also, when the stats
@@ -2982,7 +3073,8 @@ relation_needs_vacanalyze(Oid relid,
  /* output params below */
 						  bool *dovacuum,
 						  bool *doanalyze,
-						  bool *wraparound)
+						  bool *wraparound,
+						  double *priority)
 {
 	bool		force_vacuum;
 	bool		av_enabled;
@@ -3074,6 +3166,18 @@ relation_needs_vacanalyze(Oid relid,
 	}
 	*wraparound = force_vacuum;
 
+	/* Start with the priority due to the age of the relation */
+	*priority = 0;
+	if (TransactionIdIsNormal(classForm->relfrozenxid) &&
+		TransactionIdPrecedes(classForm->relfrozenxid, recentXid))
+		*priority = (double) (recentXid - classForm->relfrozenxid) /
+			Max(freeze_max_age, 1);
+	if (MultiXactIdIsValid(classForm->relminmxid) &&
+		MultiXactIdPrecedes(classForm->relminmxid, recentMulti))
+		*priority = Max(*priority,
+						(double) (recentMulti - classForm->relminmxid) /
+						Max(multixact_freeze_max_age, 1));
+
 	/* User disabled it in pg_class.reloptions?  (But ignore if at risk) */
 	if (!av_enabled && !force_vacuum)
 	{
@@ -3122,6 +3226,12 @@ relation_needs_vacanalyze(Oid relid,
 		*dovacuum = force_vacuum || (vactuples > vacthresh) ||
 			(vac_ins_base_thresh >= 0 && instuples > vacinsthresh);
 		*doanalyze = (anltuples > anlthresh);
+
+		/* Determine how urgently it does */
+		*priority = Max(*priority, vactuples / Max(vacthresh, 1));
+		if (vac_ins_base_thresh >= 0)
+			*priority = Max(*priority, instuples / Max(vacinsthresh, 1));
+		*priority = Max(*priority, anltuples / Max(anlthresh, 1));
 	}
 	else
 	{
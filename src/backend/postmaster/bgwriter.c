@@ -247,6 +247,8 @@ BackgroundWriterMain(void)
 		 * Send off activity statistics to the stats collector
 		 */
 		pgstat_send_bgwriter();
+		pgstat_send_wal();
+		pgstat_send_io();
 
 		if (FirstCallSinceLastCheckpoint())
 		{
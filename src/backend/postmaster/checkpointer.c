@@ -507,6 +507,9 @@ CheckpointerMain(void)
 		/* Send WAL statistics to the stats collector. */
 		pgstat_send_wal();
 
+		/* Send I/O statistics to the stats collector. */
+		pgstat_send_io();
+
 		/*
 		 * If any checkpoint flags have been set, redo the loop to handle the
 		 * checkpoint without sleeping.
@@ -574,6 +577,8 @@ HandleCheckpointerInterrupts(void)
 		ExitOnAnyError = true;
 		/* Close down the database */
 		ShutdownXLOG(0, 0);
+		/* Save the shared statistics for the next startup */
+		pgstat_save_shared_stats();
 		/* Normal exit from the checkpointer is here */
 		proc_exit(0);			/* done */
 	}
@@ -714,6 +719,7 @@ CheckpointWriteDelay(int flags, double progress)
 		 * Report interim activity statistics to the stats collector.
 		 */
 		pgstat_send_bgwriter();
+		pgstat_send_io();
 
 		/*
 		 * This sleep used to be connected to bgwriter_delay, typically 200ms.
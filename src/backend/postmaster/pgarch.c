@@ -30,11 +30,11 @@
 #include <time.h>
 #include <sys/stat.h>
 #include <sys/time.h>
-#include <sys/wait.h>
 #include <unistd.h>
 
 #include "access/xlog.h"
 #include "access/xlog_internal.h"
+#include "fmgr.h"
 #include "libpq/pqsignal.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -49,6 +49,7 @@
 #include "storage/pg_shmem.h"
 #include "storage/pmsignal.h"
 #include "utils/guc.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 
 
@@ -73,6 +74,11 @@
  */
 #define NUM_ORPHAN_CLEANUP_RETRIES 3
 
+/*
+ * Maximum number of .ready files to gather per directory scan.
+ */
+#define NUM_FILES_PER_DIRECTORY_SCAN 64
+
 
 /* ----------
  * Local data
@@ -81,6 +87,22 @@
 static time_t last_pgarch_start_time;
 static time_t last_sigterm_time = 0;
 
+/* GUC parameter */
+char	   *XLogArchiveLibrary = "";
+
+/* Callbacks of the archive module in use, and their memory context */
+static ArchiveModuleCallbacks ArchiveCallbacks;
+static MemoryContext archive_context;
+
+/*
+ * The oldest files ready to be archived, as found by the last scan of the
+ * archive status directory, in the order to archive them.  See
+ * pgarch_readyXlog().
+ */
+static char arch_files[NUM_FILES_PER_DIRECTORY_SCAN][MAX_XFN_CHARS + 1];
+static int	arch_files_count = 0;
+static int	arch_files_next = 0;
+
 /*
  * Flags set by interrupt handlers for later service in the main loop.
  */
@@ -102,7 +124,11 @@ static void pgarch_MainLoop(void);
 static void pgarch_ArchiverCopyLoop(void);
 static bool pgarch_archiveXlog(char *xlog);
 static bool pgarch_readyXlog(char *xlog);
+static int	ready_file_cmp(const char *a, const char *b);
 static void pgarch_archiveDone(char *xlog);
+static void pgarch_ReloadConfig(void);
+static void LoadArchiveLibrary(void);
+static void pgarch_call_module_shutdown_cb(int code, Datum arg);
 
 
 /* ------------------------------------------------------------
@@ -240,9 +266,16 @@ PgArchiverMain(int argc, char *argv[])
 	MyBackendType = B_ARCHIVER;
 	init_ps_display(NULL);
 
+	/* Load the archive module, and arrange for it to be shut down */
+	archive_context = AllocSetContextCreate(TopMemoryContext,
+											"archiver",
+											ALLOCSET_DEFAULT_SIZES);
+	LoadArchiveLibrary();
+	on_proc_exit(pgarch_call_module_shutdown_cb, 0);
+
 	pgarch_MainLoop();
 
-	exit(0);
+	proc_exit(0);
 }
 
 /* SIGUSR1 signal handler for archiver process */
@@ -304,10 +337,7 @@ pgarch_MainLoop(void)
 
 		/* Check for config update */
 		if (ConfigReloadPending)
-		{
-			ConfigReloadPending = false;
-			ProcessConfigFile(PGC_SIGHUP);
-		}
+			pgarch_ReloadConfig();
 
 		/*
 		 * If we've gotten SIGTERM, we normally just sit and do nothing until
@@ -381,6 +411,10 @@ pgarch_ArchiverCopyLoop(void)
 {
 	char		xlog[MAX_XFN_CHARS + 1];
 
+	/* Start from a fresh scan of the archive status directory */
+	arch_files_count = 0;
+	arch_files_next = 0;
+
 	/*
 	 * loop through all xlogs with archive_status of .ready and archive
 	 * them...mostly we expect this to be a single file, though it is possible
@@ -413,16 +447,14 @@ pgarch_ArchiverCopyLoop(void)
 			 * is a backlog of files to be archived.
 			 */
 			if (ConfigReloadPending)
-			{
-				ConfigReloadPending = false;
-				ProcessConfigFile(PGC_SIGHUP);
-			}
+				pgarch_ReloadConfig();
 
-			/* can't do anything if no command ... */
-			if (!XLogArchiveCommandSet())
+			/* can't do anything if not configured ... */
+			if (ArchiveCallbacks.check_configured_cb != NULL &&
+				!ArchiveCallbacks.check_configured_cb())
 			{
 				ereport(WARNING,
-						(errmsg("archive_mode enabled, yet archive_command is not set")));
+						(errmsg("archive_mode enabled, yet archiving is not configured")));
 				return;
 			}
 
@@ -503,125 +535,32 @@ pgarch_ArchiverCopyLoop(void)
 /*
  * pgarch_archiveXlog
  *
- * Invokes system(3) to copy one archive file to wherever it should go
+ * Invokes the archive module's callback to copy one archive file to
+ * wherever it should go
  *
  * Returns true if successful
  */
 static bool
 pgarch_archiveXlog(char *xlog)
 {
-	char		xlogarchcmd[MAXPGPATH];
 	char		pathname[MAXPGPATH];
 	char		activitymsg[MAXFNAMELEN + 16];
-	char	   *dp;
-	char	   *endp;
-	const char *sp;
-	int			rc;
+	MemoryContext oldcontext;
+	bool		ret;
 
 	snprintf(pathname, MAXPGPATH, XLOGDIR "/%s", xlog);
 
-	/*
-	 * construct the command to be executed
-	 */
-	dp = xlogarchcmd;
-	endp = xlogarchcmd + MAXPGPATH - 1;
-	*endp = '\0';
-
-	for (sp = XLogArchiveCommand; *sp; sp++)
-	{
-		if (*sp == '%')
-		{
-			switch (sp[1])
-			{
-				case 'p':
-					/* %p: relative path of source file */
-					sp++;
-					strlcpy(dp, pathname, endp - dp);
-					make_native_path(dp);
-					dp += strlen(dp);
-					break;
-				case 'f':
-					/* %f: filename of source file */
-					sp++;
-					strlcpy(dp, xlog, endp - dp);
-					dp += strlen(dp);
-					break;
-				case '%':
-					/* convert %% to a single % */
-					sp++;
-					if (dp < endp)
-						*dp++ = *sp;
-					break;
-				default:
-					/* otherwise treat the % as not special */
-					if (dp < endp)
-						*dp++ = *sp;
-					break;
-			}
-		}
-		else
-		{
-			if (dp < endp)
-				*dp++ = *sp;
-		}
-	}
-	*dp = '\0';
-
-	ereport(DEBUG3,
-			(errmsg_internal("executing archive command \"%s\"",
-							 xlogarchcmd)));
-
 	/* Report archive activity in PS display */
 	snprintf(activitymsg, sizeof(activitymsg), "archiving %s", xlog);
 	set_ps_display(activitymsg);
 
-	rc = system(xlogarchcmd);
-	if (rc != 0)
-	{
-		/*
-		 * If either the shell itself, or a called command, died on a signal,
-		 * abort the archiver.  We do this because system() ignores SIGINT and
-		 * SIGQUIT while waiting; so a signal is very likely something that
-		 * should have interrupted us too.  Also die if the shell got a hard
-		 * "command not found" type of error.  If we overreact it's no big
-		 * deal, the postmaster will just start the archiver again.
-		 */
-		int			lev = wait_result_is_any_signal(rc, true) ? FATAL : LOG;
-
-		if (WIFEXITED(rc))
-		{
-			ereport(lev,
-					(errmsg("archive command failed with exit code %d",
-							WEXITSTATUS(rc)),
-					 errdetail("The failed archive command was: %s",
-							   xlogarchcmd)));
-		}
-		else if (WIFSIGNALED(rc))
-		{
-#if defined(WIN32)
-			ereport(lev,
-					(errmsg("archive command was terminated by exception 0x%X",
-							WTERMSIG(rc)),
-					 errhint("See C include file \"ntstatus.h\" for a description of the hexadecimal value."),
-					 errdetail("The failed archive command was: %s",
-							   xlogarchcmd)));
-#else
-			ereport(lev,
-					(errmsg("archive command was terminated by signal %d: %s",
-							WTERMSIG(rc), pg_strsignal(WTERMSIG(rc))),
-					 errdetail("The failed archive command was: %s",
-							   xlogarchcmd)));
-#endif
-		}
-		else
-		{
-			ereport(lev,
-					(errmsg("archive command exited with unrecognized status %d",
-							rc),
-					 errdetail("The failed archive command was: %s",
-							   xlogarchcmd)));
-		}
+	oldcontext = MemoryContextSwitchTo(archive_context);
+	ret = ArchiveCallbacks.archive_file_cb(xlog, pathname);
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextReset(archive_context);
 
+	if (!ret)
+	{
 		snprintf(activitymsg, sizeof(activitymsg), "failed on %s", xlog);
 		set_ps_display(activitymsg);
 
@@ -656,21 +595,42 @@ pgarch_archiveXlog(char *xlog)
  * larger ID; the net result being that past timelines are given higher
  * priority for archiving.  This seems okay, or at least not obviously worth
  * changing.
+ *
+ * Scanning the archive status directory for every file would make the cost
+ * of archiving a backlog of N files quadratic in N, so each scan remembers
+ * the NUM_FILES_PER_DIRECTORY_SCAN oldest files, which are then returned
+ * one by one.  Files that become ready in the meantime wait for the next
+ * scan; that includes timeline history files, which may thus be archived
+ * after up to NUM_FILES_PER_DIRECTORY_SCAN files of an older timeline.
  */
 static bool
 pgarch_readyXlog(char *xlog)
 {
-	/*
-	 * open xlog status directory and read through list of xlogs that have the
-	 * .ready suffix, looking for earliest file. It is possible to optimise
-	 * this code, though only a single file is expected on the vast majority
-	 * of calls, so....
-	 */
 	char		XLogArchiveStatusDir[MAXPGPATH];
 	DIR		   *rldir;
 	struct dirent *rlde;
-	bool		found = false;
-	bool		historyFound = false;
+
+	/*
+	 * Return the next file found by the last scan, unless its status file has
+	 * disappeared meanwhile.
+	 */
+	while (arch_files_next < arch_files_count)
+	{
+		char		xlogready[MAXPGPATH];
+		struct stat st;
+
+		strcpy(xlog, arch_files[arch_files_next++]);
+		StatusFilePath(xlogready, xlog, ".ready");
+		if (stat(xlogready, &st) == 0)
+			return true;
+	}
+
+	/*
+	 * open xlog status directory and read through list of xlogs that have the
+	 * .ready suffix, keeping the oldest ones in arch_files[] in order.
+	 */
+	arch_files_count = 0;
+	arch_files_next = 0;
 
 	snprintf(XLogArchiveStatusDir, MAXPGPATH, XLOGDIR "/archive_status");
 	rldir = AllocateDir(XLogArchiveStatusDir);
@@ -679,7 +639,7 @@ pgarch_readyXlog(char *xlog)
 	{
 		int			basenamelen = (int) strlen(rlde->d_name) - 6;
 		char		basename[MAX_XFN_CHARS + 1];
-		bool		ishistory;
+		int			pos;
 
 		/* Ignore entries with unexpected number of characters */
 		if (basenamelen < MIN_XFN_CHARS ||
@@ -698,32 +658,45 @@ pgarch_readyXlog(char *xlog)
 		memcpy(basename, rlde->d_name, basenamelen);
 		basename[basenamelen] = '\0';
 
-		/* Is this a history file? */
-		ishistory = IsTLHistoryFileName(basename);
+		/* Skip the file if it's newer than all the ones we have room for */
+		if (arch_files_count == NUM_FILES_PER_DIRECTORY_SCAN &&
+			ready_file_cmp(basename, arch_files[arch_files_count - 1]) >= 0)
+			continue;
 
-		/*
-		 * Consume the file to archive.  History files have the highest
-		 * priority.  If this is the first file or the first history file
-		 * ever, copy it.  In the presence of a history file already chosen as
-		 * target, ignore all other files except history files which have been
-		 * generated for an older timeline than what is already chosen as
-		 * target to archive.
-		 */
-		if (!found || (ishistory && !historyFound))
+		/* Find its place, dropping the newest file if the array is full */
+		if (arch_files_count < NUM_FILES_PER_DIRECTORY_SCAN)
+			arch_files_count++;
+		for (pos = arch_files_count - 1; pos > 0; pos--)
 		{
-			strcpy(xlog, basename);
-			found = true;
-			historyFound = ishistory;
-		}
-		else if (ishistory || !historyFound)
-		{
-			if (strcmp(basename, xlog) < 0)
-				strcpy(xlog, basename);
+			if (ready_file_cmp(basename, arch_files[pos - 1]) >= 0)
+				break;
+			strcpy(arch_files[pos], arch_files[pos - 1]);
 		}
+		strcpy(arch_files[pos], basename);
 	}
 	FreeDir(rldir);
 
-	return found;
+	if (arch_files_count == 0)
+		return false;
+
+	strcpy(xlog, arch_files[arch_files_next++]);
+	return true;
+}
+
+/*
+ * Compare the names of two files ready to be archived, sorting history files
+ * before all others.  Returns a negative value if "a" is to be archived
+ * first.
+ */
+static int
+ready_file_cmp(const char *a, const char *b)
+{
+	bool		a_history = IsTLHistoryFileName(a);
+	bool		b_history = IsTLHistoryFileName(b);
+
+	if (a_history != b_history)
+		return a_history ? -1 : 1;
+	return strcmp(a, b);
 }
 
 /*
@@ -744,3 +717,75 @@ pgarch_archiveDone(char *xlog)
 	StatusFilePath(rlogdone, xlog, ".done");
 	(void) durable_rename(rlogready, rlogdone, WARNING);
 }
+
+/*
+ * pgarch_ReloadConfig
+ *
+ * Reload the configuration file.  The archive library can't be changed on
+ * the fly, so if archive_library was changed, exit and let the postmaster
+ * start a new archiver that loads the new library.
+ */
+static void
+pgarch_ReloadConfig(void)
+{
+	char	   *archiveLib = pstrdup(XLogArchiveLibrary);
+	bool		archiveLibChanged;
+
+	ConfigReloadPending = false;
+	ProcessConfigFile(PGC_SIGHUP);
+
+	archiveLibChanged = strcmp(XLogArchiveLibrary, archiveLib) != 0;
+	pfree(archiveLib);
+
+	if (archiveLibChanged)
+	{
+		ereport(LOG,
+				(errmsg("restarting archiver process because value of \"archive_library\" was changed")));
+		proc_exit(0);
+	}
+}
+
+/*
+ * LoadArchiveLibrary
+ *
+ * Loads the archiving callbacks into our local ArchiveCallbacks.
+ */
+static void
+LoadArchiveLibrary(void)
+{
+	ArchiveModuleInit archive_init;
+
+	memset(&ArchiveCallbacks, 0, sizeof(ArchiveModuleCallbacks));
+
+	/*
+	 * If shell archiving is enabled, use our special initialization function.
+	 * Otherwise, load the library and call its _PG_archive_module_init().
+	 */
+	if (XLogArchiveLibrary[0] == '\0')
+		archive_init = shell_archive_init;
+	else
+		archive_init = (ArchiveModuleInit)
+			load_external_function(XLogArchiveLibrary,
+								   "_PG_archive_module_init", false, NULL);
+
+	if (archive_init == NULL)
+		ereport(ERROR,
+				(errmsg("archive modules have to define the symbol %s",
+						"_PG_archive_module_init")));
+
+	(*archive_init) (&ArchiveCallbacks);
+
+	if (ArchiveCallbacks.archive_file_cb == NULL)
+		ereport(ERROR,
+				(errmsg("archive modules must register an archive callback")));
+}
+
+/*
+ * Call the shutdown callback of the loaded archive module, if defined.
+ */
+static void
+pgarch_call_module_shutdown_cb(int code, Datum arg)
+{
+	if (ArchiveCallbacks.shutdown_cb != NULL)
+		ArchiveCallbacks.shutdown_cb();
+}
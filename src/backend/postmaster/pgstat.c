@@ -38,10 +38,12 @@
 #include "access/transam.h"
 #include "access/twophase_rmgr.h"
 #include "access/xact.h"
+#include "access/xlogrecord.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_proc.h"
 #include "common/ip.h"
 #include "executor/instrument.h"
+#include "lib/dshash.h"
 #include "libpq/libpq.h"
 #include "libpq/pqsignal.h"
 #include "mb/pg_wchar.h"
@@ -52,9 +54,11 @@
 #include "postmaster/fork_process.h"
 #include "postmaster/interrupt.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/waitsampler.h"
 #include "replication/slot.h"
 #include "replication/walsender.h"
 #include "storage/backendid.h"
+#include "storage/bufmgr.h"
 #include "storage/dsm.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
@@ -62,6 +66,7 @@
 #include "storage/lmgr.h"
 #include "storage/pg_shmem.h"
 #include "storage/procsignal.h"
+#include "storage/shmem.h"
 #include "storage/sinvaladt.h"
 #include "utils/ascii.h"
 #include "utils/guc.h"
@@ -99,7 +104,7 @@
 
 
 /* ----------
- * The initial size hints for the hash tables used in the collector.
+ * The initial size hints for the backend-local hash tables.
  * ----------
  */
 #define PGSTAT_DB_HASH_SIZE		16
@@ -190,9 +195,84 @@ static time_t last_pgstat_start_time;
 
 static bool pgStatRunningInCollector = false;
 
+/*
+ * Per-database, per-table and per-function statistics are kept in shared
+ * memory, in three dshash tables allocated from a DSA area.  The area is
+ * created in place in the main shared memory segment, and grows into DSM
+ * segments as the number of objects requires.  Backends add their pending
+ * counts directly to the shared entries, rather than sending them to the
+ * collector; the collector only deals with cluster-wide statistics.
+ */
+typedef struct PgStatShmemControl
+{
+	dshash_table_handle db_handle;	/* per-database hash table */
+	dshash_table_handle tab_handle; /* per-table hash table */
+	dshash_table_handle func_handle;	/* per-function hash table */
+} PgStatShmemControl;
+
+#define PgStatShmemAreaPlace(ctl) \
+	((char *) (ctl) + MAXALIGN(sizeof(PgStatShmemControl)))
+
+/* Size of the part of the DSA area that lives in the main segment */
+#define PGSTAT_SHMEM_AREA_SIZE	(256 * 1024)
+
+/* Hash key of the per-table and per-function hash tables */
+typedef struct PgStatObjectKey
+{
+	Oid			databaseid;		/* InvalidOid for shared catalogs */
+	Oid			objectid;
+} PgStatObjectKey;
+
+typedef struct PgStatSharedTabEntry
+{
+	PgStatObjectKey key;		/* hash key --- must be first */
+	PgStat_StatTabEntry stats;
+} PgStatSharedTabEntry;
+
+typedef struct PgStatSharedFuncEntry
+{
+	PgStatObjectKey key;		/* hash key --- must be first */
+	PgStat_StatFuncEntry stats;
+} PgStatSharedFuncEntry;
+
+static const dshash_parameters pgstat_db_hash_params = {
+	sizeof(Oid),
+	sizeof(PgStat_StatDBEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_PGSTATS_HASH
+};
+
+static const dshash_parameters pgstat_tab_hash_params = {
+	sizeof(PgStatObjectKey),
+	sizeof(PgStatSharedTabEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_PGSTATS_HASH
+};
+
+static const dshash_parameters pgstat_func_hash_params = {
+	sizeof(PgStatObjectKey),
+	sizeof(PgStatSharedFuncEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	LWTRANCHE_PGSTATS_HASH
+};
+
+static PgStatShmemControl *pgStatShmem = NULL;
+
+/* This backend's attachment to the shared statistics, made on first use */
+static dsa_area *pgStatArea = NULL;
+static dshash_table *pgStatSharedDBHash = NULL;
+static dshash_table *pgStatSharedTabHash = NULL;
+static dshash_table *pgStatSharedFuncHash = NULL;
+
+/* Set once we have detached at process exit; we mustn't attach again */
+static bool pgStatShmemDetached = false;
+
 /*
  * Structures in which backends store per-table info that's waiting to be
- * sent to the collector.
+ * flushed to shared memory.
  *
  * NOTE: once allocated, TabStatusArray structures are never moved or deleted
  * for the life of the backend.  Also, we zero out the t_id fields of the
@@ -227,17 +307,30 @@ typedef struct TabStatHashEntry
 static HTAB *pgStatTabHash = NULL;
 
 /*
- * Backends store per-function info that's waiting to be sent to the collector
- * in this hash table (indexed by function OID).
+ * Backends store per-function info that's waiting to be flushed to shared
+ * memory in this hash table (indexed by function OID).
  */
 static HTAB *pgStatFunctions = NULL;
 
 /*
  * Indicates if backend has some function stats that it hasn't yet
- * sent to the collector.
+ * flushed to shared memory.
  */
 static bool have_function_stats = false;
 
+/*
+ * I/O counts accumulated by this process that haven't been sent to the
+ * collector yet, and a flag saying whether there are any.
+ */
+static PgStat_IOCounters pendingIOStats[IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES];
+static bool have_io_stats = false;
+
+/*
+ * Likewise for the per-record-type WAL counts.
+ */
+static PgStat_WalRecordCounters pendingWalRecordStats[RM_MAX_ID + 1][PGSTAT_WAL_RECORD_TYPES];
+static bool have_wal_record_stats = false;
+
 /*
  * Tuple insertion/deletion counts for an open transaction can't be propagated
  * into PgStat_TableStatus counters until we know if it is going to commit
@@ -274,10 +367,28 @@ typedef struct TwoPhasePgStatRecord
 } TwoPhasePgStatRecord;
 
 /*
- * Info about current "snapshot" of stats file
+ * Info about current "snapshot" of the statistics.  Shared-memory entries
+ * are copied into the snapshot hash tables when first fetched in a
+ * transaction, so that repeated lookups return the same values; the
+ * cluster-wide statistics are read from the collector's stats file.
  */
+typedef struct PgStatSnapshotEntry
+{
+	PgStatObjectKey key;		/* hash key --- must be first */
+	bool		found;			/* does the shared entry exist? */
+	union
+	{
+		PgStat_StatDBEntry db;
+		PgStat_StatTabEntry tab;
+		PgStat_StatFuncEntry func;
+	}			stats;
+} PgStatSnapshotEntry;
+
 static MemoryContext pgStatLocalContext = NULL;
-static HTAB *pgStatDBHash = NULL;
+static HTAB *pgStatDBSnapshot = NULL;
+static HTAB *pgStatTabSnapshot = NULL;
+static HTAB *pgStatFuncSnapshot = NULL;
+static bool pgStatGlobalsRead = false;
 
 /* Status for backends including auxiliary */
 static LocalPgBackendStatus *localBackendStatusTable = NULL;
@@ -294,15 +405,14 @@ static PgStat_ArchiverStats archiverStats;
 static PgStat_GlobalStats globalStats;
 static PgStat_WalStats walStats;
 static PgStat_SLRUStats slruStats[SLRU_NUM_ELEMENTS];
+static PgStat_IOStats ioStats;
 static PgStat_ReplSlotStats *replSlotStats;
 static int	nReplSlotStats;
 
 /*
- * List of OIDs of databases we need to write out.  If an entry is InvalidOid,
- * it means to write only the shared-catalog stats ("DB 0"); otherwise, we
- * will write both that DB's data and the shared stats.
+ * Has a backend asked the collector to write out the stats file?
  */
-static List *pending_write_requests = NIL;
+static bool pending_write_request = false;
 
 /*
  * Total time charged to functions so far in the current backend.
@@ -322,25 +432,35 @@ static pid_t pgstat_forkexec(void);
 
 NON_EXEC_STATIC void PgstatCollectorMain(int argc, char *argv[]) pg_attribute_noreturn();
 static void pgstat_beshutdown_hook(int code, Datum arg);
+static void pgstat_shmem_shutdown_hook(int code, Datum arg);
 
+static bool pgstat_attach_shmem(void);
+static void reset_dbentry_counters(PgStat_StatDBEntry *dbentry);
 static PgStat_StatDBEntry *pgstat_get_db_entry(Oid databaseid, bool create);
-static PgStat_StatTabEntry *pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry,
-												 Oid tableoid, bool create);
-static void pgstat_write_statsfiles(bool permanent, bool allDbs);
-static void pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent);
-static HTAB *pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep);
-static void pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash, bool permanent);
+static PgStatSharedTabEntry *pgstat_get_tab_entry(Oid databaseid,
+												  Oid tableoid, bool create);
+static void pgstat_remove_db_objects(Oid databaseid);
+static PgStatSnapshotEntry *pgstat_snapshot_fetch(HTAB **snapshot,
+												  const char *name, long nelem,
+												  dshash_table *shared,
+												  PgStatObjectKey *key,
+												  const void *shared_key,
+												  Size offset, Size size);
+static void pgstat_write_statsfile(bool permanent);
+static void pgstat_read_statsfile(bool permanent);
 static void backend_read_statsfile(void);
 static void pgstat_read_current_status(void);
 
+static bool pgstat_read_statsfile_timestamp(bool permanent, TimestampTz *ts);
 static bool pgstat_write_statsfile_needed(void);
-static bool pgstat_db_requested(Oid databaseid);
 
 static int	pgstat_replslot_index(const char *name, bool create_it);
 static void pgstat_reset_replslot(int i, TimestampTz ts);
 
-static void pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg);
-static void pgstat_send_funcstats(void);
+static void pgstat_flush_tabstat(Oid databaseid, PgStat_TableStatus *entry,
+								 PgStat_TableCounts *dbcounts);
+static void pgstat_flush_dbstat(Oid databaseid, PgStat_TableCounts *dbcounts);
+static void pgstat_flush_funcstats(void);
 static void pgstat_send_slru(void);
 static HTAB *pgstat_collect_oids(Oid catalogid, AttrNumber anum_oid);
 
@@ -356,30 +476,19 @@ static const char *pgstat_get_wait_io(WaitEventIO w);
 
 static void pgstat_setheader(PgStat_MsgHdr *hdr, StatMsgType mtype);
 static void pgstat_send(void *msg, int len);
+static void pgstat_send_wal_records(void);
 
 static void pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len);
-static void pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len);
-static void pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len);
-static void pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len);
-static void pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len);
 static void pgstat_recv_resetsharedcounter(PgStat_MsgResetsharedcounter *msg, int len);
-static void pgstat_recv_resetsinglecounter(PgStat_MsgResetsinglecounter *msg, int len);
 static void pgstat_recv_resetslrucounter(PgStat_MsgResetslrucounter *msg, int len);
 static void pgstat_recv_resetreplslotcounter(PgStat_MsgResetreplslotcounter *msg, int len);
-static void pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len);
-static void pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len);
-static void pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len);
 static void pgstat_recv_archiver(PgStat_MsgArchiver *msg, int len);
 static void pgstat_recv_bgwriter(PgStat_MsgBgWriter *msg, int len);
 static void pgstat_recv_wal(PgStat_MsgWal *msg, int len);
+static void pgstat_recv_walrecords(PgStat_MsgWalRecords *msg, int len);
 static void pgstat_recv_slru(PgStat_MsgSLRU *msg, int len);
-static void pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len);
-static void pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len);
-static void pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len);
-static void pgstat_recv_deadlock(PgStat_MsgDeadlock *msg, int len);
-static void pgstat_recv_checksum_failure(PgStat_MsgChecksumFailure *msg, int len);
+static void pgstat_recv_io(PgStat_MsgIO *msg, int len);
 static void pgstat_recv_replslot(PgStat_MsgReplSlot *msg, int len);
-static void pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len);
 
 /* ------------------------------------------------------------
  * Public functions called from postmaster follow
@@ -697,10 +806,12 @@ pgstat_reset_remove_files(const char *directory)
 
 		/*
 		 * Skip directory entries that don't match the file names we write.
-		 * See get_dbstat_filename for the database-specific pattern.
+		 * The "db_" pattern is for per-database files of older versions.
 		 */
 		if (strncmp(entry->d_name, "global.", 7) == 0)
 			nchars = 7;
+		else if (strncmp(entry->d_name, "objects.", 8) == 0)
+			nchars = 8;
 		else
 		{
 			nchars = 0;
@@ -851,8 +962,8 @@ allow_immediate_pgstat_restart(void)
  * pgstat_report_stat() -
  *
  *	Must be called by processes that performs DML: tcop/postgres.c, logical
- *	receiver processes, SPI worker, etc. to send the so far collected
- *	per-table and function usage statistics to the collector.  Note that this
+ *	receiver processes, SPI worker, etc. to flush the so far collected
+ *	per-table and function usage statistics to shared memory.  Note that this
  *	is called only when not within a transaction, so it is fair to use
  *	transaction stop time as an approximation of current time.
  * ----------
@@ -865,20 +976,22 @@ pgstat_report_stat(bool force)
 	static TimestampTz last_report = 0;
 
 	TimestampTz now;
-	PgStat_MsgTabstat regular_msg;
-	PgStat_MsgTabstat shared_msg;
+	PgStat_TableCounts regular_counts;
+	PgStat_TableCounts shared_counts;
+	bool		have_regular = false;
+	bool		have_shared = false;
 	TabStatusArray *tsa;
 	int			i;
 
 	/* Don't expend a clock check if nothing to do */
 	if ((pgStatTabList == NULL || pgStatTabList->tsa_used == 0) &&
 		pgStatXactCommit == 0 && pgStatXactRollback == 0 &&
-		!have_function_stats)
+		!have_function_stats && !have_io_stats && !have_wal_record_stats)
 		return;
 
 	/*
-	 * Don't send a message unless it's been at least PGSTAT_STAT_INTERVAL
-	 * msec since we last sent one, or the caller wants to force stats out.
+	 * Don't flush unless it's been at least PGSTAT_STAT_INTERVAL msec since
+	 * we last did, or the caller wants to force stats out.
 	 */
 	now = GetCurrentTransactionStopTimestamp();
 	if (!force &&
@@ -886,6 +999,10 @@ pgstat_report_stat(bool force)
 		return;
 	last_report = now;
 
+	/* Nowhere to put the counts once we've detached at process exit */
+	if (!pgstat_attach_shmem())
+		return;
+
 	/*
 	 * Destroy pgStatTabHash before we start invalidating PgStat_TableEntry
 	 * entries it points to.  (Should we fail partway through the loop below,
@@ -899,22 +1016,18 @@ pgstat_report_stat(bool force)
 
 	/*
 	 * Scan through the TabStatusArray struct(s) to find tables that actually
-	 * have counts, and build messages to send.  We have to separate shared
-	 * relations from regular ones because the databaseid field in the message
-	 * header has to depend on that.
+	 * have counts, and add them to the shared entries.  Database-wide totals
+	 * are summed up separately for shared relations and regular ones, since
+	 * the former are charged to the entry with InvalidOid.
 	 */
-	regular_msg.m_databaseid = MyDatabaseId;
-	shared_msg.m_databaseid = InvalidOid;
-	regular_msg.m_nentries = 0;
-	shared_msg.m_nentries = 0;
+	MemSet(&regular_counts, 0, sizeof(PgStat_TableCounts));
+	MemSet(&shared_counts, 0, sizeof(PgStat_TableCounts));
 
 	for (tsa = pgStatTabList; tsa != NULL; tsa = tsa->tsa_next)
 	{
 		for (i = 0; i < tsa->tsa_used; i++)
 		{
 			PgStat_TableStatus *entry = &tsa->tsa_entries[i];
-			PgStat_MsgTabstat *this_msg;
-			PgStat_TableEntry *this_ent;
 
 			/* Shouldn't have any pending transaction-dependent counts */
 			Assert(entry->trans == NULL);
@@ -927,18 +1040,15 @@ pgstat_report_stat(bool force)
 					   sizeof(PgStat_TableCounts)) == 0)
 				continue;
 
-			/*
-			 * OK, insert data into the appropriate message, and send if full.
-			 */
-			this_msg = entry->t_shared ? &shared_msg : &regular_msg;
-			this_ent = &this_msg->m_entry[this_msg->m_nentries];
-			this_ent->t_id = entry->t_id;
-			memcpy(&this_ent->t_counts, &entry->t_counts,
-				   sizeof(PgStat_TableCounts));
-			if (++this_msg->m_nentries >= PGSTAT_NUM_TABENTRIES)
+			if (entry->t_shared)
+			{
+				pgstat_flush_tabstat(InvalidOid, entry, &shared_counts);
+				have_shared = true;
+			}
+			else
 			{
-				pgstat_send_tabstat(this_msg);
-				this_msg->m_nentries = 0;
+				pgstat_flush_tabstat(MyDatabaseId, entry, &regular_counts);
+				have_regular = true;
 			}
 		}
 		/* zero out PgStat_TableStatus structs after use */
@@ -948,121 +1058,167 @@ pgstat_report_stat(bool force)
 	}
 
 	/*
-	 * Send partial messages.  Make sure that any pending xact commit/abort
-	 * gets counted, even if there are no table stats to send.
+	 * Update the database entries.  Make sure that any pending xact
+	 * commit/abort gets counted, even if there are no table stats.
 	 */
-	if (regular_msg.m_nentries > 0 ||
-		pgStatXactCommit > 0 || pgStatXactRollback > 0)
-		pgstat_send_tabstat(&regular_msg);
-	if (shared_msg.m_nentries > 0)
-		pgstat_send_tabstat(&shared_msg);
+	if (have_regular || pgStatXactCommit > 0 || pgStatXactRollback > 0)
+		pgstat_flush_dbstat(MyDatabaseId, &regular_counts);
+	if (have_shared)
+		pgstat_flush_dbstat(InvalidOid, &shared_counts);
 
-	/* Now, send function statistics */
-	pgstat_send_funcstats();
+	/* Now, flush function statistics */
+	pgstat_flush_funcstats();
 
 	/* Send WAL statistics */
 	pgstat_send_wal();
 
+	/* Send I/O statistics */
+	pgstat_send_io();
+
 	/* Finally send SLRU statistics */
 	pgstat_send_slru();
 }
 
 /*
- * Subroutine for pgstat_report_stat: finish and send a tabstat message
+ * Subroutine for pgstat_report_stat: add one table's counts to its shared
+ * entry, and to the database-wide totals in *dbcounts
  */
 static void
-pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg)
+pgstat_flush_tabstat(Oid databaseid, PgStat_TableStatus *entry,
+					 PgStat_TableCounts *dbcounts)
 {
-	int			n;
-	int			len;
+	PgStat_TableCounts *counts = &entry->t_counts;
+	PgStatSharedTabEntry *shent;
+	PgStat_StatTabEntry *tabentry;
 
-	/* It's unlikely we'd get here with no socket, but maybe not impossible */
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
+	shent = pgstat_get_tab_entry(databaseid, entry->t_id, true);
+	tabentry = &shent->stats;
+
+	tabentry->numscans += counts->t_numscans;
+	tabentry->tuples_returned += counts->t_tuples_returned;
+	tabentry->tuples_fetched += counts->t_tuples_fetched;
+	tabentry->tuples_inserted += counts->t_tuples_inserted;
+	tabentry->tuples_updated += counts->t_tuples_updated;
+	tabentry->tuples_deleted += counts->t_tuples_deleted;
+	tabentry->tuples_hot_updated += counts->t_tuples_hot_updated;
+	/* If table was truncated, first reset the live/dead counters */
+	if (counts->t_truncated)
+	{
+		tabentry->n_live_tuples = 0;
+		tabentry->n_dead_tuples = 0;
+		tabentry->inserts_since_vacuum = 0;
+	}
+	tabentry->n_live_tuples += counts->t_delta_live_tuples;
+	tabentry->n_dead_tuples += counts->t_delta_dead_tuples;
+	tabentry->changes_since_analyze += counts->t_changed_tuples;
+	tabentry->inserts_since_vacuum += counts->t_tuples_inserted;
+	tabentry->blocks_fetched += counts->t_blocks_fetched;
+	tabentry->blocks_hit += counts->t_blocks_hit;
+
+	/* Clamp n_live_tuples in case of negative delta_live_tuples */
+	tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
+	/* Likewise for n_dead_tuples */
+	tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
+
+	dshash_release_lock(pgStatSharedTabHash, shent);
+
+	dbcounts->t_tuples_returned += counts->t_tuples_returned;
+	dbcounts->t_tuples_fetched += counts->t_tuples_fetched;
+	dbcounts->t_tuples_inserted += counts->t_tuples_inserted;
+	dbcounts->t_tuples_updated += counts->t_tuples_updated;
+	dbcounts->t_tuples_deleted += counts->t_tuples_deleted;
+	dbcounts->t_blocks_fetched += counts->t_blocks_fetched;
+	dbcounts->t_blocks_hit += counts->t_blocks_hit;
+}
+
+/*
+ * Subroutine for pgstat_report_stat: add database-wide totals to the shared
+ * database entry
+ */
+static void
+pgstat_flush_dbstat(Oid databaseid, PgStat_TableCounts *dbcounts)
+{
+	PgStat_StatDBEntry *dbentry;
+
+	dbentry = pgstat_get_db_entry(databaseid, true);
 
 	/*
 	 * Report and reset accumulated xact commit/rollback and I/O timings
-	 * whenever we send a normal tabstat message
+	 * whenever we update a normal database entry
 	 */
-	if (OidIsValid(tsmsg->m_databaseid))
+	if (OidIsValid(databaseid))
 	{
-		tsmsg->m_xact_commit = pgStatXactCommit;
-		tsmsg->m_xact_rollback = pgStatXactRollback;
-		tsmsg->m_block_read_time = pgStatBlockReadTime;
-		tsmsg->m_block_write_time = pgStatBlockWriteTime;
+		dbentry->n_xact_commit += pgStatXactCommit;
+		dbentry->n_xact_rollback += pgStatXactRollback;
+		dbentry->n_block_read_time += pgStatBlockReadTime;
+		dbentry->n_block_write_time += pgStatBlockWriteTime;
 		pgStatXactCommit = 0;
 		pgStatXactRollback = 0;
 		pgStatBlockReadTime = 0;
 		pgStatBlockWriteTime = 0;
 	}
-	else
-	{
-		tsmsg->m_xact_commit = 0;
-		tsmsg->m_xact_rollback = 0;
-		tsmsg->m_block_read_time = 0;
-		tsmsg->m_block_write_time = 0;
-	}
 
-	n = tsmsg->m_nentries;
-	len = offsetof(PgStat_MsgTabstat, m_entry[0]) +
-		n * sizeof(PgStat_TableEntry);
+	dbentry->n_tuples_returned += dbcounts->t_tuples_returned;
+	dbentry->n_tuples_fetched += dbcounts->t_tuples_fetched;
+	dbentry->n_tuples_inserted += dbcounts->t_tuples_inserted;
+	dbentry->n_tuples_updated += dbcounts->t_tuples_updated;
+	dbentry->n_tuples_deleted += dbcounts->t_tuples_deleted;
+	dbentry->n_blocks_fetched += dbcounts->t_blocks_fetched;
+	dbentry->n_blocks_hit += dbcounts->t_blocks_hit;
 
-	pgstat_setheader(&tsmsg->m_hdr, PGSTAT_MTYPE_TABSTAT);
-	pgstat_send(tsmsg, len);
+	dshash_release_lock(pgStatSharedDBHash, dbentry);
 }
 
 /*
- * Subroutine for pgstat_report_stat: populate and send a function stat message
+ * Subroutine for pgstat_report_stat: add function counts to the shared
+ * function entries
  */
 static void
-pgstat_send_funcstats(void)
+pgstat_flush_funcstats(void)
 {
 	/* we assume this inits to all zeroes: */
 	static const PgStat_FunctionCounts all_zeroes;
 
-	PgStat_MsgFuncstat msg;
 	PgStat_BackendFunctionEntry *entry;
 	HASH_SEQ_STATUS fstat;
 
 	if (pgStatFunctions == NULL)
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_FUNCSTAT);
-	msg.m_databaseid = MyDatabaseId;
-	msg.m_nentries = 0;
-
 	hash_seq_init(&fstat, pgStatFunctions);
 	while ((entry = (PgStat_BackendFunctionEntry *) hash_seq_search(&fstat)) != NULL)
 	{
-		PgStat_FunctionEntry *m_ent;
+		PgStatObjectKey key;
+		PgStatSharedFuncEntry *shent;
+		bool		found;
 
 		/* Skip it if no counts accumulated since last time */
 		if (memcmp(&entry->f_counts, &all_zeroes,
 				   sizeof(PgStat_FunctionCounts)) == 0)
 			continue;
 
-		/* need to convert format of time accumulators */
-		m_ent = &msg.m_entry[msg.m_nentries];
-		m_ent->f_id = entry->f_id;
-		m_ent->f_numcalls = entry->f_counts.f_numcalls;
-		m_ent->f_total_time = INSTR_TIME_GET_MICROSEC(entry->f_counts.f_total_time);
-		m_ent->f_self_time = INSTR_TIME_GET_MICROSEC(entry->f_counts.f_self_time);
-
-		if (++msg.m_nentries >= PGSTAT_NUM_FUNCENTRIES)
+		key.databaseid = MyDatabaseId;
+		key.objectid = entry->f_id;
+		shent = dshash_find_or_insert(pgStatSharedFuncHash, &key, &found);
+		if (!found)
 		{
-			pgstat_send(&msg, offsetof(PgStat_MsgFuncstat, m_entry[0]) +
-						msg.m_nentries * sizeof(PgStat_FunctionEntry));
-			msg.m_nentries = 0;
+			MemSet(&shent->stats, 0, sizeof(PgStat_StatFuncEntry));
+			shent->stats.functionid = entry->f_id;
 		}
 
+		/* need to convert format of time accumulators */
+		shent->stats.f_numcalls += entry->f_counts.f_numcalls;
+		shent->stats.f_total_time +=
+			INSTR_TIME_GET_MICROSEC(entry->f_counts.f_total_time);
+		shent->stats.f_self_time +=
+			INSTR_TIME_GET_MICROSEC(entry->f_counts.f_self_time);
+
+		dshash_release_lock(pgStatSharedFuncHash, shent);
+
 		/* reset the entry's counts */
 		MemSet(&entry->f_counts, 0, sizeof(PgStat_FunctionCounts));
 	}
 
-	if (msg.m_nentries > 0)
-		pgstat_send(&msg, offsetof(PgStat_MsgFuncstat, m_entry[0]) +
-					msg.m_nentries * sizeof(PgStat_FunctionEntry));
-
 	have_function_stats = false;
 }
 
@@ -1070,120 +1226,72 @@ pgstat_send_funcstats(void)
 /* ----------
  * pgstat_vacuum_stat() -
  *
- *	Will tell the collector about objects he can get rid of.
+ *	Remove the shared entries of objects that no longer exist.
  * ----------
  */
 void
 pgstat_vacuum_stat(void)
 {
 	HTAB	   *htab;
-	PgStat_MsgTabpurge msg;
-	PgStat_MsgFuncpurge f_msg;
-	HASH_SEQ_STATUS hstat;
+	dshash_seq_status hstat;
 	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatFuncEntry *funcentry;
-	int			len;
+	PgStatSharedTabEntry *tabentry;
+	PgStatSharedFuncEntry *funcentry;
+	List	   *dead_dbs = NIL;
+	ListCell   *lc;
+	bool		have_funcs = false;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (!pgstat_attach_shmem())
 		return;
 
-	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
-	 */
-	backend_read_statsfile();
-
 	/*
 	 * Read pg_database and make a list of OIDs of all existing databases
 	 */
 	htab = pgstat_collect_oids(DatabaseRelationId, Anum_pg_database_oid);
 
 	/*
-	 * Search the database hash table for dead databases and tell the
-	 * collector to drop them.
+	 * Search the database hash table for dead databases.  They are dropped
+	 * once the scan is done, since dropping scans the other hash tables.
 	 */
-	hash_seq_init(&hstat, pgStatDBHash);
-	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
+	dshash_seq_init(&hstat, pgStatSharedDBHash, false);
+	while ((dbentry = dshash_seq_next(&hstat)) != NULL)
 	{
 		Oid			dbid = dbentry->databaseid;
 
-		CHECK_FOR_INTERRUPTS();
-
 		/* the DB entry for shared tables (with InvalidOid) is never dropped */
 		if (OidIsValid(dbid) &&
 			hash_search(htab, (void *) &dbid, HASH_FIND, NULL) == NULL)
-			pgstat_drop_database(dbid);
+			dead_dbs = lappend_oid(dead_dbs, dbid);
 	}
+	dshash_seq_term(&hstat);
+
+	foreach(lc, dead_dbs)
+		pgstat_drop_database(lfirst_oid(lc));
 
 	/* Clean up */
+	list_free(dead_dbs);
 	hash_destroy(htab);
 
-	/*
-	 * Lookup our own database entry; if not found, nothing more to do.
-	 */
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &MyDatabaseId,
-												 HASH_FIND, NULL);
-	if (dbentry == NULL || dbentry->tables == NULL)
-		return;
-
 	/*
 	 * Similarly to above, make a list of all known relations in this DB.
 	 */
 	htab = pgstat_collect_oids(RelationRelationId, Anum_pg_class_oid);
 
 	/*
-	 * Initialize our messages table counter to zero
-	 */
-	msg.m_nentries = 0;
-
-	/*
-	 * Check for all tables listed in stats hashtable if they still exist.
+	 * Check for all of this DB's tables in the stats hashtable if they still
+	 * exist.
 	 */
-	hash_seq_init(&hstat, dbentry->tables);
-	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&hstat)) != NULL)
+	dshash_seq_init(&hstat, pgStatSharedTabHash, true);
+	while ((tabentry = dshash_seq_next(&hstat)) != NULL)
 	{
-		Oid			tabid = tabentry->tableid;
-
-		CHECK_FOR_INTERRUPTS();
-
-		if (hash_search(htab, (void *) &tabid, HASH_FIND, NULL) != NULL)
+		if (tabentry->key.databaseid != MyDatabaseId)
 			continue;
 
-		/*
-		 * Not there, so add this table's Oid to the message
-		 */
-		msg.m_tableid[msg.m_nentries++] = tabid;
-
-		/*
-		 * If the message is full, send it out and reinitialize to empty
-		 */
-		if (msg.m_nentries >= PGSTAT_NUM_TABPURGE)
-		{
-			len = offsetof(PgStat_MsgTabpurge, m_tableid[0])
-				+ msg.m_nentries * sizeof(Oid);
-
-			pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-			msg.m_databaseid = MyDatabaseId;
-			pgstat_send(&msg, len);
-
-			msg.m_nentries = 0;
-		}
-	}
-
-	/*
-	 * Send the rest
-	 */
-	if (msg.m_nentries > 0)
-	{
-		len = offsetof(PgStat_MsgTabpurge, m_tableid[0])
-			+ msg.m_nentries * sizeof(Oid);
-
-		pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-		msg.m_databaseid = MyDatabaseId;
-		pgstat_send(&msg, len);
+		if (hash_search(htab, (void *) &tabentry->key.objectid,
+						HASH_FIND, NULL) == NULL)
+			dshash_delete_current(&hstat);
 	}
+	dshash_seq_term(&hstat);
 
 	/* Clean up */
 	hash_destroy(htab);
@@ -1192,54 +1300,32 @@ pgstat_vacuum_stat(void)
 	 * Now repeat the above steps for functions.  However, we needn't bother
 	 * in the common case where no function stats are being collected.
 	 */
-	if (dbentry->functions != NULL &&
-		hash_get_num_entries(dbentry->functions) > 0)
+	dshash_seq_init(&hstat, pgStatSharedFuncHash, false);
+	while ((funcentry = dshash_seq_next(&hstat)) != NULL)
 	{
-		htab = pgstat_collect_oids(ProcedureRelationId, Anum_pg_proc_oid);
-
-		pgstat_setheader(&f_msg.m_hdr, PGSTAT_MTYPE_FUNCPURGE);
-		f_msg.m_databaseid = MyDatabaseId;
-		f_msg.m_nentries = 0;
-
-		hash_seq_init(&hstat, dbentry->functions);
-		while ((funcentry = (PgStat_StatFuncEntry *) hash_seq_search(&hstat)) != NULL)
+		if (funcentry->key.databaseid == MyDatabaseId)
 		{
-			Oid			funcid = funcentry->functionid;
-
-			CHECK_FOR_INTERRUPTS();
-
-			if (hash_search(htab, (void *) &funcid, HASH_FIND, NULL) != NULL)
-				continue;
-
-			/*
-			 * Not there, so add this function's Oid to the message
-			 */
-			f_msg.m_functionid[f_msg.m_nentries++] = funcid;
-
-			/*
-			 * If the message is full, send it out and reinitialize to empty
-			 */
-			if (f_msg.m_nentries >= PGSTAT_NUM_FUNCPURGE)
-			{
-				len = offsetof(PgStat_MsgFuncpurge, m_functionid[0])
-					+ f_msg.m_nentries * sizeof(Oid);
-
-				pgstat_send(&f_msg, len);
-
-				f_msg.m_nentries = 0;
-			}
+			have_funcs = true;
+			break;
 		}
+	}
+	dshash_seq_term(&hstat);
 
-		/*
-		 * Send the rest
-		 */
-		if (f_msg.m_nentries > 0)
+	if (have_funcs)
+	{
+		htab = pgstat_collect_oids(ProcedureRelationId, Anum_pg_proc_oid);
+
+		dshash_seq_init(&hstat, pgStatSharedFuncHash, true);
+		while ((funcentry = dshash_seq_next(&hstat)) != NULL)
 		{
-			len = offsetof(PgStat_MsgFuncpurge, m_functionid[0])
-				+ f_msg.m_nentries * sizeof(Oid);
+			if (funcentry->key.databaseid != MyDatabaseId)
+				continue;
 
-			pgstat_send(&f_msg, len);
+			if (hash_search(htab, (void *) &funcentry->key.objectid,
+							HASH_FIND, NULL) == NULL)
+				dshash_delete_current(&hstat);
 		}
+		dshash_seq_term(&hstat);
 
 		hash_destroy(htab);
 	}
@@ -1300,31 +1386,25 @@ pgstat_collect_oids(Oid catalogid, AttrNumber anum_oid)
 /* ----------
  * pgstat_drop_database() -
  *
- *	Tell the collector that we just dropped a database.
- *	(If the message gets lost, we will still clean the dead DB eventually
- *	via future invocations of pgstat_vacuum_stat().)
+ *	Remove the shared statistics of a database we just dropped, along with
+ *	those of its tables and functions.
  * ----------
  */
 void
 pgstat_drop_database(Oid databaseid)
 {
-	PgStat_MsgDropdb msg;
-
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (!pgstat_attach_shmem())
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DROPDB);
-	msg.m_databaseid = databaseid;
-	pgstat_send(&msg, sizeof(msg));
+	pgstat_remove_db_objects(databaseid);
+	(void) dshash_delete_key(pgStatSharedDBHash, &databaseid);
 }
 
 
 /* ----------
  * pgstat_drop_relation() -
  *
- *	Tell the collector that we just dropped a relation.
- *	(If the message gets lost, we will still clean the dead entry eventually
- *	via future invocations of pgstat_vacuum_stat().)
+ *	Remove the shared statistics of a relation we just dropped.
  *
  *	Currently not used for lack of any good place to call it; we rely
  *	entirely on pgstat_vacuum_stat() to clean out stats for dead rels.
@@ -1334,20 +1414,14 @@ pgstat_drop_database(Oid databaseid)
 void
 pgstat_drop_relation(Oid relid)
 {
-	PgStat_MsgTabpurge msg;
-	int			len;
+	PgStatObjectKey key;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (!pgstat_attach_shmem())
 		return;
 
-	msg.m_tableid[0] = relid;
-	msg.m_nentries = 1;
-
-	len = offsetof(PgStat_MsgTabpurge, m_tableid[0]) + sizeof(Oid);
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-	msg.m_databaseid = MyDatabaseId;
-	pgstat_send(&msg, len);
+	key.databaseid = MyDatabaseId;
+	key.objectid = relid;
+	(void) dshash_delete_key(pgStatSharedTabHash, &key);
 }
 #endif							/* NOT_USED */
 
@@ -1355,7 +1429,7 @@ pgstat_drop_relation(Oid relid)
 /* ----------
  * pgstat_reset_counters() -
  *
- *	Tell the statistics collector to reset counters for our database.
+ *	Reset counters for our database.
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1364,14 +1438,28 @@ pgstat_drop_relation(Oid relid)
 void
 pgstat_reset_counters(void)
 {
-	PgStat_MsgResetcounter msg;
+	PgStat_StatDBEntry *dbentry;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (!pgstat_attach_shmem())
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETCOUNTER);
-	msg.m_databaseid = MyDatabaseId;
-	pgstat_send(&msg, sizeof(msg));
+	/*
+	 * Lookup the database in the hashtable.  Nothing to do if not there.
+	 */
+	dbentry = pgstat_get_db_entry(MyDatabaseId, false);
+	if (!dbentry)
+		return;
+
+	/*
+	 * Reset database-level stats.
+	 */
+	reset_dbentry_counters(dbentry);
+	dshash_release_lock(pgStatSharedDBHash, dbentry);
+
+	/*
+	 * We simply throw away all the database's table and function entries.
+	 */
+	pgstat_remove_db_objects(MyDatabaseId);
 }
 
 /* ----------
@@ -1388,6 +1476,13 @@ pgstat_reset_shared_counters(const char *target)
 {
 	PgStat_MsgResetsharedcounter msg;
 
+	/* LWLock usage counters live in shared memory, not in the collector */
+	if (strcmp(target, "lwlock") == 0)
+	{
+		LWLockResetUsage();
+		return;
+	}
+
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
@@ -1395,13 +1490,15 @@ pgstat_reset_shared_counters(const char *target)
 		msg.m_resettarget = RESET_ARCHIVER;
 	else if (strcmp(target, "bgwriter") == 0)
 		msg.m_resettarget = RESET_BGWRITER;
+	else if (strcmp(target, "io") == 0)
+		msg.m_resettarget = RESET_IO;
 	else if (strcmp(target, "wal") == 0)
 		msg.m_resettarget = RESET_WAL;
 	else
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("unrecognized reset target: \"%s\"", target),
-				 errhint("Target must be \"archiver\", \"bgwriter\" or \"wal\".")));
+				 errhint("Target must be \"archiver\", \"bgwriter\", \"io\", \"lwlock\" or \"wal\".")));
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETSHAREDCOUNTER);
 	pgstat_send(&msg, sizeof(msg));
@@ -1410,7 +1507,7 @@ pgstat_reset_shared_counters(const char *target)
 /* ----------
  * pgstat_reset_single_counter() -
  *
- *	Tell the statistics collector to reset a single counter.
+ *	Reset a single counter.
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1419,17 +1516,30 @@ pgstat_reset_shared_counters(const char *target)
 void
 pgstat_reset_single_counter(Oid objoid, PgStat_Single_Reset_Type type)
 {
-	PgStat_MsgResetsinglecounter msg;
+	PgStat_StatDBEntry *dbentry;
+	PgStatObjectKey key;
+	TimestampTz ts;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (!pgstat_attach_shmem())
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETSINGLECOUNTER);
-	msg.m_databaseid = MyDatabaseId;
-	msg.m_resettype = type;
-	msg.m_objectid = objoid;
+	ts = GetCurrentTimestamp();
+
+	dbentry = pgstat_get_db_entry(MyDatabaseId, false);
+	if (!dbentry)
+		return;
 
-	pgstat_send(&msg, sizeof(msg));
+	/* Set the reset timestamp for the whole database */
+	dbentry->stat_reset_timestamp = ts;
+	dshash_release_lock(pgStatSharedDBHash, dbentry);
+
+	/* Remove object if it exists, ignore it if not */
+	key.databaseid = MyDatabaseId;
+	key.objectid = objoid;
+	if (type == RESET_TABLE)
+		(void) dshash_delete_key(pgStatSharedTabHash, &key);
+	else if (type == RESET_FUNCTION)
+		(void) dshash_delete_key(pgStatSharedFuncHash, &key);
 }
 
 /* ----------
@@ -1522,48 +1632,87 @@ pgstat_reset_replslot_counter(const char *name)
 void
 pgstat_report_autovac(Oid dboid)
 {
-	PgStat_MsgAutovacStart msg;
+	PgStat_StatDBEntry *dbentry;
+	TimestampTz ts;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (!pgstat_attach_shmem())
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_AUTOVAC_START);
-	msg.m_databaseid = dboid;
-	msg.m_start_time = GetCurrentTimestamp();
+	ts = GetCurrentTimestamp();
 
-	pgstat_send(&msg, sizeof(msg));
+	/*
+	 * Store the last autovacuum time in the database's hashtable entry.
+	 */
+	dbentry = pgstat_get_db_entry(dboid, true);
+	dbentry->last_autovac_time = ts;
+	dshash_release_lock(pgStatSharedDBHash, dbentry);
 }
 
 
 /* ---------
  * pgstat_report_vacuum() -
  *
- *	Tell the collector about the table we just vacuumed.
+ *	Record the results of the table we just vacuumed.
  * ---------
  */
 void
 pgstat_report_vacuum(Oid tableoid, bool shared,
 					 PgStat_Counter livetuples, PgStat_Counter deadtuples)
 {
-	PgStat_MsgVacuum msg;
+	Oid			dboid = shared ? InvalidOid : MyDatabaseId;
+	PgStat_StatDBEntry *dbentry;
+	PgStatSharedTabEntry *shent;
+	PgStat_StatTabEntry *tabentry;
+	TimestampTz ts;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts || !pgstat_attach_shmem())
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_VACUUM);
-	msg.m_databaseid = shared ? InvalidOid : MyDatabaseId;
-	msg.m_tableoid = tableoid;
-	msg.m_autovacuum = IsAutoVacuumWorkerProcess();
-	msg.m_vacuumtime = GetCurrentTimestamp();
-	msg.m_live_tuples = livetuples;
-	msg.m_dead_tuples = deadtuples;
-	pgstat_send(&msg, sizeof(msg));
+	ts = GetCurrentTimestamp();
+
+	/* Make sure the database has an entry */
+	dbentry = pgstat_get_db_entry(dboid, true);
+	dshash_release_lock(pgStatSharedDBHash, dbentry);
+
+	/*
+	 * Store the data in the table's hashtable entry.
+	 */
+	shent = pgstat_get_tab_entry(dboid, tableoid, true);
+	tabentry = &shent->stats;
+
+	tabentry->n_live_tuples = livetuples;
+	tabentry->n_dead_tuples = deadtuples;
+
+	/*
+	 * It is quite possible that a non-aggressive VACUUM ended up skipping
+	 * various pages, however, we'll zero the insert counter here regardless.
+	 * It's currently used only to track when we need to perform an "insert"
+	 * autovacuum, which are mainly intended to freeze newly inserted tuples.
+	 * Zeroing this may just mean we'll not try to vacuum the table again
+	 * until enough tuples have been inserted to trigger another insert
+	 * autovacuum.  An anti-wraparound autovacuum will catch any persistent
+	 * stragglers.
+	 */
+	tabentry->inserts_since_vacuum = 0;
+
+	if (IsAutoVacuumWorkerProcess())
+	{
+		tabentry->autovac_vacuum_timestamp = ts;
+		tabentry->autovac_vacuum_count++;
+	}
+	else
+	{
+		tabentry->vacuum_timestamp = ts;
+		tabentry->vacuum_count++;
+	}
+
+	dshash_release_lock(pgStatSharedTabHash, shent);
 }
 
 /* --------
  * pgstat_report_analyze() -
  *
- *	Tell the collector about the table we just analyzed.
+ *	Record the results of the table we just analyzed.
  *
  * Caller must provide new live- and dead-tuples estimates, as well as a
  * flag indicating whether to reset the changes_since_analyze counter.
@@ -1574,9 +1723,13 @@ pgstat_report_analyze(Relation rel,
 					  PgStat_Counter livetuples, PgStat_Counter deadtuples,
 					  bool resetcounter)
 {
-	PgStat_MsgAnalyze msg;
+	Oid			dboid = rel->rd_rel->relisshared ? InvalidOid : MyDatabaseId;
+	PgStat_StatDBEntry *dbentry;
+	PgStatSharedTabEntry *shent;
+	PgStat_StatTabEntry *tabentry;
+	TimestampTz ts;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts || !pgstat_attach_shmem())
 		return;
 
 	/*
@@ -1584,10 +1737,9 @@ pgstat_report_analyze(Relation rel,
 	 * already inserted and/or deleted rows in the target table. ANALYZE will
 	 * have counted such rows as live or dead respectively. Because we will
 	 * report our counts of such rows at transaction end, we should subtract
-	 * off these counts from what we send to the collector now, else they'll
-	 * be double-counted after commit.  (This approach also ensures that the
-	 * collector ends up with the right numbers if we abort instead of
-	 * committing.)
+	 * off these counts from what we store now, else they'll be double-counted
+	 * after commit.  (This approach also ensures that the shared entry ends
+	 * up with the right numbers if we abort instead of committing.)
 	 */
 	if (rel->pgstat_info != NULL)
 	{
@@ -1605,84 +1757,136 @@ pgstat_report_analyze(Relation rel,
 		deadtuples = Max(deadtuples, 0);
 	}
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_ANALYZE);
-	msg.m_databaseid = rel->rd_rel->relisshared ? InvalidOid : MyDatabaseId;
-	msg.m_tableoid = RelationGetRelid(rel);
-	msg.m_autovacuum = IsAutoVacuumWorkerProcess();
-	msg.m_resetcounter = resetcounter;
-	msg.m_analyzetime = GetCurrentTimestamp();
-	msg.m_live_tuples = livetuples;
-	msg.m_dead_tuples = deadtuples;
-	pgstat_send(&msg, sizeof(msg));
-}
+	ts = GetCurrentTimestamp();
 
-/* --------
- * pgstat_report_recovery_conflict() -
- *
- *	Tell the collector about a Hot Standby recovery conflict.
- * --------
- */
-void
-pgstat_report_recovery_conflict(int reason)
-{
-	PgStat_MsgRecoveryConflict msg;
+	/* Make sure the database has an entry */
+	dbentry = pgstat_get_db_entry(dboid, true);
+	dshash_release_lock(pgStatSharedDBHash, dbentry);
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
-		return;
+	/*
+	 * Store the data in the table's hashtable entry.
+	 */
+	shent = pgstat_get_tab_entry(dboid, RelationGetRelid(rel), true);
+	tabentry = &shent->stats;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RECOVERYCONFLICT);
-	msg.m_databaseid = MyDatabaseId;
-	msg.m_reason = reason;
-	pgstat_send(&msg, sizeof(msg));
+	tabentry->n_live_tuples = livetuples;
+	tabentry->n_dead_tuples = deadtuples;
+
+	/*
+	 * If commanded, reset changes_since_analyze to zero.  This forgets any
+	 * changes that were committed while the ANALYZE was in progress, but we
+	 * have no good way to estimate how many of those there were.
+	 */
+	if (resetcounter)
+		tabentry->changes_since_analyze = 0;
+
+	if (IsAutoVacuumWorkerProcess())
+	{
+		tabentry->autovac_analyze_timestamp = ts;
+		tabentry->autovac_analyze_count++;
+	}
+	else
+	{
+		tabentry->analyze_timestamp = ts;
+		tabentry->analyze_count++;
+	}
+
+	dshash_release_lock(pgStatSharedTabHash, shent);
 }
 
 /* --------
- * pgstat_report_deadlock() -
+ * pgstat_report_recovery_conflict() -
  *
- *	Tell the collector about a deadlock detected.
+ *	Count a Hot Standby recovery conflict.
  * --------
  */
 void
-pgstat_report_deadlock(void)
+pgstat_report_recovery_conflict(int reason)
 {
-	PgStat_MsgDeadlock msg;
+	PgStat_StatDBEntry *dbentry;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts || !pgstat_attach_shmem())
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DEADLOCK);
-	msg.m_databaseid = MyDatabaseId;
-	pgstat_send(&msg, sizeof(msg));
-}
-
+	dbentry = pgstat_get_db_entry(MyDatabaseId, true);
 
+	switch (reason)
+	{
+		case PROCSIG_RECOVERY_CONFLICT_DATABASE:
 
-/* --------
- * pgstat_report_checksum_failures_in_db() -
- *
- *	Tell the collector about one or more checksum failures.
- * --------
+			/*
+			 * Since we drop the information about the database as soon as it
+			 * replicates, there is no point in counting these conflicts.
+			 */
+			break;
+		case PROCSIG_RECOVERY_CONFLICT_TABLESPACE:
+			dbentry->n_conflict_tablespace++;
+			break;
+		case PROCSIG_RECOVERY_CONFLICT_LOCK:
+			dbentry->n_conflict_lock++;
+			break;
+		case PROCSIG_RECOVERY_CONFLICT_SNAPSHOT:
+			dbentry->n_conflict_snapshot++;
+			break;
+		case PROCSIG_RECOVERY_CONFLICT_BUFFERPIN:
+			dbentry->n_conflict_bufferpin++;
+			break;
+		case PROCSIG_RECOVERY_CONFLICT_STARTUP_DEADLOCK:
+			dbentry->n_conflict_startup_deadlock++;
+			break;
+	}
+
+	dshash_release_lock(pgStatSharedDBHash, dbentry);
+}
+
+/* --------
+ * pgstat_report_deadlock() -
+ *
+ *	Count a deadlock detected.
+ * --------
+ */
+void
+pgstat_report_deadlock(void)
+{
+	PgStat_StatDBEntry *dbentry;
+
+	if (!pgstat_track_counts || !pgstat_attach_shmem())
+		return;
+
+	dbentry = pgstat_get_db_entry(MyDatabaseId, true);
+	dbentry->n_deadlocks++;
+	dshash_release_lock(pgStatSharedDBHash, dbentry);
+}
+
+
+
+/* --------
+ * pgstat_report_checksum_failures_in_db() -
+ *
+ *	Count one or more checksum failures.
+ * --------
  */
 void
 pgstat_report_checksum_failures_in_db(Oid dboid, int failurecount)
 {
-	PgStat_MsgChecksumFailure msg;
+	PgStat_StatDBEntry *dbentry;
+	TimestampTz ts;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts || !pgstat_attach_shmem())
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_CHECKSUMFAILURE);
-	msg.m_databaseid = dboid;
-	msg.m_failurecount = failurecount;
-	msg.m_failure_time = GetCurrentTimestamp();
+	ts = GetCurrentTimestamp();
 
-	pgstat_send(&msg, sizeof(msg));
+	dbentry = pgstat_get_db_entry(dboid, true);
+	dbentry->n_checksum_failures += failurecount;
+	dbentry->last_checksum_failure = ts;
+	dshash_release_lock(pgStatSharedDBHash, dbentry);
 }
 
 /* --------
  * pgstat_report_checksum_failure() -
  *
- *	Tell the collector about a checksum failure.
+ *	Count a checksum failure.
  * --------
  */
 void
@@ -1694,21 +1898,21 @@ pgstat_report_checksum_failure(void)
 /* --------
  * pgstat_report_tempfile() -
  *
- *	Tell the collector about a temporary file.
+ *	Count a temporary file.
  * --------
  */
 void
 pgstat_report_tempfile(size_t filesize)
 {
-	PgStat_MsgTempFile msg;
+	PgStat_StatDBEntry *dbentry;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts || !pgstat_attach_shmem())
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TEMPFILE);
-	msg.m_databaseid = MyDatabaseId;
-	msg.m_filesize = filesize;
-	pgstat_send(&msg, sizeof(msg));
+	dbentry = pgstat_get_db_entry(MyDatabaseId, true);
+	dbentry->n_temp_bytes += filesize;
+	dbentry->n_temp_files += 1;
+	dshash_release_lock(pgStatSharedDBHash, dbentry);
 }
 
 /* ----------
@@ -1780,14 +1984,13 @@ pgstat_ping(void)
  * ----------
  */
 static void
-pgstat_send_inquiry(TimestampTz clock_time, TimestampTz cutoff_time, Oid databaseid)
+pgstat_send_inquiry(TimestampTz clock_time, TimestampTz cutoff_time)
 {
 	PgStat_MsgInquiry msg;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_INQUIRY);
 	msg.clock_time = clock_time;
 	msg.cutoff_time = cutoff_time;
-	msg.databaseid = databaseid;
 	pgstat_send(&msg, sizeof(msg));
 }
 
@@ -2605,18 +2808,20 @@ pgstat_twophase_postabort(TransactionId xid, uint16 info,
 PgStat_StatDBEntry *
 pgstat_fetch_stat_dbentry(Oid dbid)
 {
-	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
-	 */
-	backend_read_statsfile();
+	PgStatObjectKey key;
+	PgStatSnapshotEntry *entry;
 
-	/*
-	 * Lookup the requested database; return NULL if not found
-	 */
-	return (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-											  (void *) &dbid,
-											  HASH_FIND, NULL);
+	if (!pgstat_attach_shmem())
+		return NULL;
+
+	key.databaseid = dbid;
+	key.objectid = InvalidOid;
+	entry = pgstat_snapshot_fetch(&pgStatDBSnapshot, "Database stats snapshot",
+								  PGSTAT_DB_HASH_SIZE, pgStatSharedDBHash,
+								  &key, &dbid,
+								  0, sizeof(PgStat_StatDBEntry));
+
+	return entry->found ? &entry->stats.db : NULL;
 }
 
 
@@ -2626,55 +2831,51 @@ pgstat_fetch_stat_dbentry(Oid dbid)
  *	Support function for the SQL-callable pgstat* functions. Returns
  *	the collected statistics for one table or NULL. NULL doesn't mean
  *	that the table doesn't exist, it is just not yet known by the
- *	collector, so the caller is better off to report ZERO instead.
+ *	statistics system, so the caller is better off to report ZERO instead.
  * ----------
  */
 PgStat_StatTabEntry *
 pgstat_fetch_stat_tabentry(Oid relid)
 {
-	Oid			dbid;
-	PgStat_StatDBEntry *dbentry;
 	PgStat_StatTabEntry *tabentry;
 
 	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
+	 * Look in our own database first.  If we didn't find it, maybe it's a
+	 * shared table.
 	 */
-	backend_read_statsfile();
+	tabentry = pgstat_fetch_stat_tabentry_ext(false, relid);
+	if (tabentry == NULL)
+		tabentry = pgstat_fetch_stat_tabentry_ext(true, relid);
 
-	/*
-	 * Lookup our database, then look in its table hash table.
-	 */
-	dbid = MyDatabaseId;
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &dbid,
-												 HASH_FIND, NULL);
-	if (dbentry != NULL && dbentry->tables != NULL)
-	{
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &relid,
-													   HASH_FIND, NULL);
-		if (tabentry)
-			return tabentry;
-	}
+	return tabentry;
+}
 
-	/*
-	 * If we didn't find it, maybe it's a shared table.
-	 */
-	dbid = InvalidOid;
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &dbid,
-												 HASH_FIND, NULL);
-	if (dbentry != NULL && dbentry->tables != NULL)
-	{
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &relid,
-													   HASH_FIND, NULL);
-		if (tabentry)
-			return tabentry;
-	}
 
-	return NULL;
+/* ----------
+ * pgstat_fetch_stat_tabentry_ext() -
+ *
+ *	Like pgstat_fetch_stat_tabentry(), but for callers that know whether
+ *	the table is a shared catalog.
+ * ----------
+ */
+PgStat_StatTabEntry *
+pgstat_fetch_stat_tabentry_ext(bool shared, Oid relid)
+{
+	PgStatObjectKey key;
+	PgStatSnapshotEntry *entry;
+
+	if (!pgstat_attach_shmem())
+		return NULL;
+
+	key.databaseid = shared ? InvalidOid : MyDatabaseId;
+	key.objectid = relid;
+	entry = pgstat_snapshot_fetch(&pgStatTabSnapshot, "Table stats snapshot",
+								  PGSTAT_TAB_HASH_SIZE, pgStatSharedTabHash,
+								  &key, &key,
+								  offsetof(PgStatSharedTabEntry, stats),
+								  sizeof(PgStat_StatTabEntry));
+
+	return entry->found ? &entry->stats.tab : NULL;
 }
 
 
@@ -2688,22 +2889,21 @@ pgstat_fetch_stat_tabentry(Oid relid)
 PgStat_StatFuncEntry *
 pgstat_fetch_stat_funcentry(Oid func_id)
 {
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatFuncEntry *funcentry = NULL;
+	PgStatObjectKey key;
+	PgStatSnapshotEntry *entry;
 
-	/* load the stats file if needed */
-	backend_read_statsfile();
+	if (!pgstat_attach_shmem())
+		return NULL;
 
-	/* Lookup our database, then find the requested function.  */
-	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
-	if (dbentry != NULL && dbentry->functions != NULL)
-	{
-		funcentry = (PgStat_StatFuncEntry *) hash_search(dbentry->functions,
-														 (void *) &func_id,
-														 HASH_FIND, NULL);
-	}
+	key.databaseid = MyDatabaseId;
+	key.objectid = func_id;
+	entry = pgstat_snapshot_fetch(&pgStatFuncSnapshot, "Function stats snapshot",
+								  PGSTAT_FUNCTION_HASH_SIZE, pgStatSharedFuncHash,
+								  &key, &key,
+								  offsetof(PgStatSharedFuncEntry, stats),
+								  sizeof(PgStat_StatFuncEntry));
 
-	return funcentry;
+	return entry->found ? &entry->stats.func : NULL;
 }
 
 
@@ -2831,6 +3031,22 @@ pgstat_fetch_slru(void)
 	return slruStats;
 }
 
+/*
+ * ---------
+ * pgstat_fetch_stat_io() -
+ *
+ *	Support function for the SQL-callable pgstat* functions. Returns
+ *	a pointer to the I/O statistics struct.
+ * ---------
+ */
+PgStat_IOStats *
+pgstat_fetch_stat_io(void)
+{
+	backend_read_statsfile();
+
+	return &ioStats;
+}
+
 /*
  * ---------
  * pgstat_fetch_replslot() -
@@ -3022,6 +3238,65 @@ CreateSharedBackendStatus(void)
 #endif
 }
 
+/*
+ * Report shared-memory space needed by PgStatShmemInit.
+ */
+Size
+PgStatShmemSize(void)
+{
+	Size		size;
+
+	size = MAXALIGN(sizeof(PgStatShmemControl));
+	size = add_size(size, Max(PGSTAT_SHMEM_AREA_SIZE, dsa_minimum_size()));
+
+	return size;
+}
+
+/*
+ * Initialize the shared statistics hash tables during postmaster startup.
+ */
+void
+PgStatShmemInit(void)
+{
+	bool		found;
+
+	pgStatShmem = (PgStatShmemControl *)
+		ShmemInitStruct("Shared Statistics", PgStatShmemSize(), &found);
+
+	if (!found)
+	{
+		Size		area_size = Max(PGSTAT_SHMEM_AREA_SIZE, dsa_minimum_size());
+		dsa_area   *area;
+		dshash_table *dsh;
+
+		area = dsa_create_in_place(PgStatShmemAreaPlace(pgStatShmem),
+								   area_size, LWTRANCHE_PGSTATS_DSA, NULL);
+		dsa_pin(area);
+
+		/*
+		 * Create the hash tables within the main segment, since we can't
+		 * create DSM segments here; after that, lift the limit so that the
+		 * entries can spill into DSM segments as needed.
+		 */
+		dsa_set_size_limit(area, area_size);
+
+		dsh = dshash_create(area, &pgstat_db_hash_params, NULL);
+		pgStatShmem->db_handle = dshash_get_hash_table_handle(dsh);
+		dshash_detach(dsh);
+
+		dsh = dshash_create(area, &pgstat_tab_hash_params, NULL);
+		pgStatShmem->tab_handle = dshash_get_hash_table_handle(dsh);
+		dshash_detach(dsh);
+
+		dsh = dshash_create(area, &pgstat_func_hash_params, NULL);
+		pgStatShmem->func_handle = dshash_get_hash_table_handle(dsh);
+		dshash_detach(dsh);
+
+		dsa_set_size_limit(area, -1);
+		dsa_detach(area);
+	}
+}
+
 
 /* ----------
  * pgstat_initialize() -
@@ -3066,7 +3341,8 @@ pgstat_initialize(void)
 	 */
 	prevWalUsage = pgWalUsage;
 
-	/* Set up a process-exit hook to clean up */
+	/* Set up process-exit hooks to clean up */
+	before_shmem_exit(pgstat_shmem_shutdown_hook, 0);
 	on_shmem_exit(pgstat_beshutdown_hook, 0);
 }
 
@@ -3127,6 +3403,7 @@ pgstat_bestart(void)
 	 */
 	lbeentry.st_procpid = MyProcPid;
 	lbeentry.st_backendType = MyBackendType;
+	lbeentry.st_procno = MyProc ? MyProc->pgprocno : -1;
 	lbeentry.st_proc_start_timestamp = MyStartTimestamp;
 	lbeentry.st_activity_start_timestamp = 0;
 	lbeentry.st_state_start_timestamp = 0;
@@ -3191,6 +3468,7 @@ pgstat_bestart(void)
 #endif
 
 	lbeentry.st_state = STATE_UNDEFINED;
+	lbeentry.st_query_id = 0;
 	lbeentry.st_progress_command = PROGRESS_COMMAND_INVALID;
 	lbeentry.st_progress_command_target = InvalidOid;
 
@@ -3248,26 +3526,15 @@ pgstat_bestart(void)
 /*
  * Shut down a single backend's statistics reporting at process exit.
  *
- * Flush any remaining statistics counts out to the collector.
- * Without this, operations triggered during backend exit (such as
- * temp table deletions) won't be counted.
- *
- * Lastly, clear out our entry in the PgBackendStatus array.
+ * Remaining statistics counts have already been flushed by
+ * pgstat_shmem_shutdown_hook; all that's left is to clear out our entry in
+ * the PgBackendStatus array.
  */
 static void
 pgstat_beshutdown_hook(int code, Datum arg)
 {
 	volatile PgBackendStatus *beentry = MyBEEntry;
 
-	/*
-	 * If we got as far as discovering our own database ID, we can report what
-	 * we did to the collector.  Otherwise, we'd be sending an invalid
-	 * database ID, so forget it.  (This means that accesses to pg_database
-	 * during failed backend starts might never get counted.)
-	 */
-	if (OidIsValid(MyDatabaseId))
-		pgstat_report_stat(true);
-
 	/*
 	 * Clear my status entry, following the protocol of bumping st_changecount
 	 * before and after.  We use a volatile pointer here to ensure the
@@ -3281,6 +3548,46 @@ pgstat_beshutdown_hook(int code, Datum arg)
 }
 
 
+/*
+ * Flush our pending counts and detach from the shared statistics.
+ *
+ * This is a before_shmem_exit callback, since the DSM segments holding the
+ * shared statistics are detached before on_shmem_exit callbacks run.
+ */
+static void
+pgstat_shmem_shutdown_hook(int code, Datum arg)
+{
+	/*
+	 * If we got as far as discovering our own database ID, we can report what
+	 * we did.  Otherwise, we'd be using an invalid database ID, so forget it.
+	 * (This means that accesses to pg_database during failed backend starts
+	 * might never get counted.)
+	 */
+	if (OidIsValid(MyDatabaseId))
+		pgstat_report_stat(true);
+
+	/* Processes without a database still have I/O to account for */
+	pgstat_send_io();
+
+	if (pgStatArea != NULL)
+	{
+		dshash_detach(pgStatSharedDBHash);
+		dshash_detach(pgStatSharedTabHash);
+		dshash_detach(pgStatSharedFuncHash);
+		dsa_release_in_place(PgStatShmemAreaPlace(pgStatShmem));
+		dsa_detach(pgStatArea);
+
+		pgStatSharedDBHash = NULL;
+		pgStatSharedTabHash = NULL;
+		pgStatSharedFuncHash = NULL;
+		pgStatArea = NULL;
+	}
+
+	/* Don't let anything attach again during the rest of exit processing */
+	pgStatShmemDetached = true;
+}
+
+
 /* ----------
  * pgstat_report_activity() -
  *
@@ -3353,6 +3660,10 @@ pgstat_report_activity(BackendState state, const char *cmd_str)
 	beentry->st_state = state;
 	beentry->st_state_start_timestamp = current_timestamp;
 
+	/* a new statement, or none at all; the executor reports its query ID */
+	if (state != STATE_RUNNING || cmd_str != NULL)
+		beentry->st_query_id = 0;
+
 	if (cmd_str != NULL)
 	{
 		memcpy((char *) beentry->st_activity_raw, cmd_str, len);
@@ -3363,6 +3674,104 @@ pgstat_report_activity(BackendState state, const char *cmd_str)
 	PGSTAT_END_WRITE_ACTIVITY(beentry);
 }
 
+/* ----------
+ * pgstat_sample_wait_events() -
+ *
+ *	Called by the wait event sampler to observe what every active process is
+ *	doing right now.  Fills samples[] (which must have room for one entry per
+ *	backend status slot) and returns the number of entries filled in.  Idle
+ *	client backends, and processes sleeping in their main loop, are skipped.
+ *	Unlike pgstat_read_current_status(), only a few fields are copied, so
+ *	this is cheap enough to be done many times a second.
+ * ----------
+ */
+int
+pgstat_sample_wait_events(WaitSample *samples, TimestampTz now)
+{
+	volatile PgBackendStatus *beentry = BackendStatusArray;
+	int			nsamples = 0;
+	int			i;
+
+	for (i = 0; i < NumBackendStatSlots; i++, beentry++)
+	{
+		int			pid;
+		int			procno = -1;
+		BackendType backend_type = B_INVALID;
+		BackendState state = STATE_UNDEFINED;
+		uint64		query_id = 0;
+		uint32		wait_event_info;
+
+		/* Same retry protocol as pgstat_read_current_status() */
+		for (;;)
+		{
+			int			before_changecount;
+			int			after_changecount;
+
+			pgstat_begin_read_activity(beentry, before_changecount);
+
+			pid = beentry->st_procpid;
+			if (pid > 0)
+			{
+				procno = beentry->st_procno;
+				backend_type = beentry->st_backendType;
+				state = beentry->st_state;
+				query_id = beentry->st_query_id;
+			}
+
+			pgstat_end_read_activity(beentry, after_changecount);
+
+			if (pgstat_read_activity_complete(before_changecount,
+											  after_changecount))
+				break;
+
+			CHECK_FOR_INTERRUPTS();
+		}
+
+		if (pid <= 0 || pid == MyProcPid || state == STATE_IDLE)
+			continue;
+
+		/* an aligned 4-byte read can't be torn; see pgstat_report_wait_start */
+		wait_event_info = procno >= 0 ?
+			ProcGlobal->allProcs[procno].wait_event_info : 0;
+		if ((wait_event_info & 0xFF000000) == PG_WAIT_ACTIVITY)
+			continue;
+
+		samples[nsamples].sample_time = now;
+		samples[nsamples].pid = pid;
+		samples[nsamples].backend_type = backend_type;
+		samples[nsamples].wait_event_info = wait_event_info;
+		samples[nsamples].query_id = query_id;
+		nsamples++;
+	}
+
+	return nsamples;
+}
+
+/* --------
+ * pgstat_report_query_id() -
+ *
+ *	Called from the executor to advertise the query ID of the statement
+ *	being run.  Only the top-level statement is reported: nested statements
+ *	run through SPI or the like leave an already reported ID alone.  The ID
+ *	is zero unless a module such as pg_stat_statements computes it.
+ * --------
+ */
+void
+pgstat_report_query_id(uint64 query_id)
+{
+	volatile PgBackendStatus *beentry = MyBEEntry;
+
+	if (!beentry || !pgstat_track_activities)
+		return;
+
+	if (beentry->st_query_id != 0)
+		return;
+
+	PGSTAT_BEGIN_WRITE_ACTIVITY(beentry);
+	beentry->st_query_id = query_id;
+	PGSTAT_END_WRITE_ACTIVITY(beentry);
+}
+
 /*-----------
  * pgstat_progress_start_command() -
  *
@@ -3836,12 +4245,18 @@ pgstat_get_wait_activity(WaitEventActivity w)
 		case WAIT_EVENT_PGSTAT_MAIN:
 			event_name = "PgStatMain";
 			break;
+		case WAIT_EVENT_PREFORKED_BACKEND_IDLE:
+			event_name = "PreforkedBackendIdle";
+			break;
 		case WAIT_EVENT_RECOVERY_WAL_STREAM:
 			event_name = "RecoveryWalStream";
 			break;
 		case WAIT_EVENT_SYSLOGGER_MAIN:
 			event_name = "SysLoggerMain";
 			break;
+		case WAIT_EVENT_WAIT_SAMPLER_MAIN:
+			event_name = "WaitSamplerMain";
+			break;
 		case WAIT_EVENT_WAL_RECEIVER_MAIN:
 			event_name = "WalReceiverMain";
 			break;
@@ -3916,6 +4331,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 
 	switch (w)
 	{
+		case WAIT_EVENT_APPEND_READY:
+			event_name = "AppendReady";
+			break;
 		case WAIT_EVENT_BACKUP_WAIT_WAL_ARCHIVE:
 			event_name = "BackupWaitWalArchive";
 			break;
@@ -4609,6 +5027,9 @@ pgstat_send_wal(void)
 	WalStats.m_wal_fpi = walusage.wal_fpi;
 	WalStats.m_wal_bytes = walusage.wal_bytes;
 
+	/* The per-record-type counts go in their own messages */
+	pgstat_send_wal_records();
+
 	/*
 	 * This function can be called even if nothing at all has happened. In
 	 * this case, avoid sending a completely empty message to the stats
@@ -4634,6 +5055,81 @@ pgstat_send_wal(void)
 	MemSet(&WalStats, 0, sizeof(WalStats));
 }
 
+/* ----------
+ * pgstat_count_wal_record() -
+ *
+ *	Count a WAL record inserted by this process.  len is the total length
+ *	of the record, fpi_bytes the part of it taken up by its num_fpi full
+ *	page images.
+ * ----------
+ */
+void
+pgstat_count_wal_record(RmgrId rmid, uint8 info, uint32 len,
+						int num_fpi, uint32 fpi_bytes)
+{
+	PgStat_WalRecordCounters *counters;
+
+	counters = &pendingWalRecordStats[rmid][(info & ~XLR_INFO_MASK) >> 4];
+	counters->records++;
+	counters->fpi += num_fpi;
+	counters->bytes += len;
+	counters->fpi_bytes += fpi_bytes;
+	have_wal_record_stats = true;
+}
+
+/* ----------
+ * pgstat_send_wal_records() -
+ *
+ *		Send per-record-type WAL statistics to the collector.  Only record
+ *		types with nonzero counts are sent, in as many messages as needed.
+ * ----------
+ */
+static void
+pgstat_send_wal_records(void)
+{
+	PgStat_MsgWalRecords msg;
+
+	if (!have_wal_record_stats)
+		return;
+
+	msg.m_nentries = 0;
+	for (int rmid = 0; rmid <= RM_MAX_ID; rmid++)
+	{
+		for (int type = 0; type < PGSTAT_WAL_RECORD_TYPES; type++)
+		{
+			PgStat_WalRecordEntry *entry;
+
+			if (pendingWalRecordStats[rmid][type].records == 0)
+				continue;
+
+			entry = &msg.m_entry[msg.m_nentries++];
+			entry->rmid = rmid;
+			entry->type = type;
+			entry->counters = pendingWalRecordStats[rmid][type];
+
+			if (msg.m_nentries >= PGSTAT_NUM_WALRECORDENTRIES)
+			{
+				pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_WAL_RECORDS);
+				pgstat_send(&msg, sizeof(msg));
+				msg.m_nentries = 0;
+			}
+		}
+	}
+
+	if (msg.m_nentries > 0)
+	{
+		pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_WAL_RECORDS);
+		pgstat_send(&msg, offsetof(PgStat_MsgWalRecords, m_entry[0]) +
+					msg.m_nentries * sizeof(PgStat_WalRecordEntry));
+	}
+
+	/*
+	 * Clear out the statistics buffer, so it can be re-used.
+	 */
+	MemSet(pendingWalRecordStats, 0, sizeof(pendingWalRecordStats));
+	have_wal_record_stats = false;
+}
+
 /* ----------
  * pgstat_send_slru() -
  *
@@ -4672,9 +5168,68 @@ pgstat_send_slru(void)
 	}
 }
 
-
 /* ----------
- * PgstatCollectorMain() -
+ * pgstat_count_io_op_n() -
+ *
+ *	Count cnt I/O operations of the given kind performed by this process.
+ * ----------
+ */
+void
+pgstat_count_io_op_n(IOObject io_object, IOContext io_context, IOOp io_op,
+					 uint32 cnt)
+{
+	pendingIOStats[io_object][io_context].counts[io_op] += cnt;
+	have_io_stats = true;
+}
+
+/* ----------
+ * pgstat_count_io_time() -
+ *
+ *	Add the time spent on I/O operations of the given kind.  Callers measure
+ *	io_time only when track_io_timing is enabled.
+ * ----------
+ */
+void
+pgstat_count_io_time(IOObject io_object, IOContext io_context, IOOp io_op,
+					 instr_time io_time)
+{
+	pendingIOStats[io_object][io_context].times[io_op] +=
+		INSTR_TIME_GET_MICROSEC(io_time);
+	have_io_stats = true;
+}
+
+/* ----------
+ * pgstat_send_io() -
+ *
+ *		Send I/O statistics to the collector
+ * ----------
+ */
+void
+pgstat_send_io(void)
+{
+	PgStat_MsgIO msg;
+
+	if (!have_io_stats)
+		return;
+
+	/*
+	 * Prepare and send the message
+	 */
+	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_IO);
+	msg.m_backend_type = MyBackendType;
+	memcpy(msg.m_counters, pendingIOStats, sizeof(msg.m_counters));
+	pgstat_send(&msg, sizeof(msg));
+
+	/*
+	 * Clear out the statistics buffer, so it can be re-used.
+	 */
+	MemSet(pendingIOStats, 0, sizeof(pendingIOStats));
+	have_io_stats = false;
+}
+
+
+/* ----------
+ * PgstatCollectorMain() -
  *
  *	Start up the statistics collector process.  This is the body of the
  *	postmaster child process.
@@ -4715,7 +5270,7 @@ PgstatCollectorMain(int argc, char *argv[])
 	 * Read in existing stats files or initialize the stats to zero.
 	 */
 	pgStatRunningInCollector = true;
-	pgStatDBHash = pgstat_read_statsfiles(InvalidOid, true, true);
+	pgstat_read_statsfile(true);
 
 	/* Prepare to wait for our latch or data in our socket. */
 	wes = CreateWaitEventSet(CurrentMemoryContext, 3);
@@ -4764,11 +5319,11 @@ PgstatCollectorMain(int argc, char *argv[])
 			}
 
 			/*
-			 * Write the stats file(s) if a new request has arrived that is
-			 * not satisfied by existing file(s).
+			 * Write the stats file if a new request has arrived that is not
+			 * satisfied by the existing file.
 			 */
 			if (pgstat_write_statsfile_needed())
-				pgstat_write_statsfiles(false, false);
+				pgstat_write_statsfile(false);
 
 			/*
 			 * Try to receive and process a message.  This will not block,
@@ -4822,32 +5377,11 @@ PgstatCollectorMain(int argc, char *argv[])
 					pgstat_recv_inquiry(&msg.msg_inquiry, len);
 					break;
 
-				case PGSTAT_MTYPE_TABSTAT:
-					pgstat_recv_tabstat(&msg.msg_tabstat, len);
-					break;
-
-				case PGSTAT_MTYPE_TABPURGE:
-					pgstat_recv_tabpurge(&msg.msg_tabpurge, len);
-					break;
-
-				case PGSTAT_MTYPE_DROPDB:
-					pgstat_recv_dropdb(&msg.msg_dropdb, len);
-					break;
-
-				case PGSTAT_MTYPE_RESETCOUNTER:
-					pgstat_recv_resetcounter(&msg.msg_resetcounter, len);
-					break;
-
 				case PGSTAT_MTYPE_RESETSHAREDCOUNTER:
 					pgstat_recv_resetsharedcounter(&msg.msg_resetsharedcounter,
 												   len);
 					break;
 
-				case PGSTAT_MTYPE_RESETSINGLECOUNTER:
-					pgstat_recv_resetsinglecounter(&msg.msg_resetsinglecounter,
-												   len);
-					break;
-
 				case PGSTAT_MTYPE_RESETSLRUCOUNTER:
 					pgstat_recv_resetslrucounter(&msg.msg_resetslrucounter,
 												 len);
@@ -4858,18 +5392,6 @@ PgstatCollectorMain(int argc, char *argv[])
 													 len);
 					break;
 
-				case PGSTAT_MTYPE_AUTOVAC_START:
-					pgstat_recv_autovac(&msg.msg_autovacuum_start, len);
-					break;
-
-				case PGSTAT_MTYPE_VACUUM:
-					pgstat_recv_vacuum(&msg.msg_vacuum, len);
-					break;
-
-				case PGSTAT_MTYPE_ANALYZE:
-					pgstat_recv_analyze(&msg.msg_analyze, len);
-					break;
-
 				case PGSTAT_MTYPE_ARCHIVER:
 					pgstat_recv_archiver(&msg.msg_archiver, len);
 					break;
@@ -4882,34 +5404,16 @@ PgstatCollectorMain(int argc, char *argv[])
 					pgstat_recv_wal(&msg.msg_wal, len);
 					break;
 
-				case PGSTAT_MTYPE_SLRU:
-					pgstat_recv_slru(&msg.msg_slru, len);
-					break;
-
-				case PGSTAT_MTYPE_FUNCSTAT:
-					pgstat_recv_funcstat(&msg.msg_funcstat, len);
-					break;
-
-				case PGSTAT_MTYPE_FUNCPURGE:
-					pgstat_recv_funcpurge(&msg.msg_funcpurge, len);
-					break;
-
-				case PGSTAT_MTYPE_RECOVERYCONFLICT:
-					pgstat_recv_recoveryconflict(&msg.msg_recoveryconflict,
-												 len);
-					break;
-
-				case PGSTAT_MTYPE_DEADLOCK:
-					pgstat_recv_deadlock(&msg.msg_deadlock, len);
+				case PGSTAT_MTYPE_WAL_RECORDS:
+					pgstat_recv_walrecords(&msg.msg_walrecords, len);
 					break;
 
-				case PGSTAT_MTYPE_TEMPFILE:
-					pgstat_recv_tempfile(&msg.msg_tempfile, len);
+				case PGSTAT_MTYPE_SLRU:
+					pgstat_recv_slru(&msg.msg_slru, len);
 					break;
 
-				case PGSTAT_MTYPE_CHECKSUMFAILURE:
-					pgstat_recv_checksum_failure(&msg.msg_checksumfailure,
-												 len);
+				case PGSTAT_MTYPE_IO:
+					pgstat_recv_io(&msg.msg_io, len);
 					break;
 
 				case PGSTAT_MTYPE_REPLSLOT:
@@ -4951,7 +5455,7 @@ PgstatCollectorMain(int argc, char *argv[])
 	/*
 	 * Save the final stats to reuse at next startup.
 	 */
-	pgstat_write_statsfiles(true, true);
+	pgstat_write_statsfile(true);
 
 	FreeWaitEventSet(wes);
 
@@ -4960,14 +5464,10 @@ PgstatCollectorMain(int argc, char *argv[])
 
 /*
  * Subroutine to clear stats in a database entry
- *
- * Tables and functions hashes are initialized to empty.
  */
 static void
 reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
 {
-	HASHCTL		hash_ctl;
-
 	dbentry->n_xact_commit = 0;
 	dbentry->n_xact_rollback = 0;
 	dbentry->n_blocks_fetched = 0;
@@ -4992,48 +5492,69 @@ reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
 	dbentry->n_block_write_time = 0;
 
 	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
-	dbentry->stats_timestamp = 0;
+}
 
-	memset(&hash_ctl, 0, sizeof(hash_ctl));
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-	dbentry->tables = hash_create("Per-database table",
-								  PGSTAT_TAB_HASH_SIZE,
-								  &hash_ctl,
-								  HASH_ELEM | HASH_BLOBS);
+/*
+ * Attach to the shared statistics hash tables, if not done already.
+ *
+ * Returns false if they're not available, which is the case in processes
+ * not connected to shared memory, and once we have detached at exit.
+ */
+static bool
+pgstat_attach_shmem(void)
+{
+	MemoryContext oldcontext;
+	dsa_area   *area;
 
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-	dbentry->functions = hash_create("Per-database function",
-									 PGSTAT_FUNCTION_HASH_SIZE,
-									 &hash_ctl,
-									 HASH_ELEM | HASH_BLOBS);
+	if (pgStatArea != NULL)
+		return true;
+	if (pgStatShmem == NULL || pgStatShmemDetached)
+		return false;
+
+	/* The attachment lasts for the life of the process */
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	area = dsa_attach_in_place(PgStatShmemAreaPlace(pgStatShmem), NULL);
+	dsa_pin_mapping(area);
+
+	pgStatSharedDBHash = dshash_attach(area, &pgstat_db_hash_params,
+									   pgStatShmem->db_handle, NULL);
+	pgStatSharedTabHash = dshash_attach(area, &pgstat_tab_hash_params,
+										pgStatShmem->tab_handle, NULL);
+	pgStatSharedFuncHash = dshash_attach(area, &pgstat_func_hash_params,
+										 pgStatShmem->func_handle, NULL);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	pgStatArea = area;
+
+	return true;
 }
 
 /*
- * Lookup the hash table entry for the specified database. If no hash
- * table entry exists, initialize it, if the create parameter is true.
- * Else, return NULL.
+ * Lookup the shared hash table entry for the specified database.  If no
+ * entry exists, initialize it, if the create parameter is true.  Else,
+ * return NULL.
+ *
+ * The entry is returned locked; the caller must release it with
+ * dshash_release_lock() after updating it.
  */
 static PgStat_StatDBEntry *
 pgstat_get_db_entry(Oid databaseid, bool create)
 {
 	PgStat_StatDBEntry *result;
 	bool		found;
-	HASHACTION	action = (create ? HASH_ENTER : HASH_FIND);
 
-	/* Lookup or create the hash table entry for this database */
-	result = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												&databaseid,
-												action, &found);
+	if (!create)
+		return (PgStat_StatDBEntry *) dshash_find(pgStatSharedDBHash,
+												  &databaseid, true);
 
-	if (!create && !found)
-		return NULL;
+	/* Lookup or create the hash table entry for this database */
+	result = (PgStat_StatDBEntry *) dshash_find_or_insert(pgStatSharedDBHash,
+														  &databaseid,
+														  &found);
 
-	/*
-	 * If not found, initialize the new one.  This creates empty hash tables
-	 * for tables and functions, too.
-	 */
+	/* If not found, initialize the new one. */
 	if (!found)
 		reset_dbentry_counters(result);
 
@@ -5042,80 +5563,90 @@ pgstat_get_db_entry(Oid databaseid, bool create)
 
 
 /*
- * Lookup the hash table entry for the specified table. If no hash
- * table entry exists, initialize it, if the create parameter is true.
- * Else, return NULL.
+ * Lookup the shared hash table entry for the specified table.  If no entry
+ * exists, initialize it, if the create parameter is true.  Else, return NULL.
+ *
+ * As with pgstat_get_db_entry, the entry is returned locked.
  */
-static PgStat_StatTabEntry *
-pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
+static PgStatSharedTabEntry *
+pgstat_get_tab_entry(Oid databaseid, Oid tableoid, bool create)
 {
-	PgStat_StatTabEntry *result;
+	PgStatSharedTabEntry *result;
+	PgStatObjectKey key;
 	bool		found;
-	HASHACTION	action = (create ? HASH_ENTER : HASH_FIND);
 
-	/* Lookup or create the hash table entry for this table */
-	result = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-												 &tableoid,
-												 action, &found);
+	key.databaseid = databaseid;
+	key.objectid = tableoid;
 
-	if (!create && !found)
-		return NULL;
+	if (!create)
+		return (PgStatSharedTabEntry *) dshash_find(pgStatSharedTabHash,
+													&key, true);
+
+	/* Lookup or create the hash table entry for this table */
+	result = (PgStatSharedTabEntry *) dshash_find_or_insert(pgStatSharedTabHash,
+															&key, &found);
 
 	/* If not found, initialize the new one. */
 	if (!found)
 	{
-		result->numscans = 0;
-		result->tuples_returned = 0;
-		result->tuples_fetched = 0;
-		result->tuples_inserted = 0;
-		result->tuples_updated = 0;
-		result->tuples_deleted = 0;
-		result->tuples_hot_updated = 0;
-		result->n_live_tuples = 0;
-		result->n_dead_tuples = 0;
-		result->changes_since_analyze = 0;
-		result->inserts_since_vacuum = 0;
-		result->blocks_fetched = 0;
-		result->blocks_hit = 0;
-		result->vacuum_timestamp = 0;
-		result->vacuum_count = 0;
-		result->autovac_vacuum_timestamp = 0;
-		result->autovac_vacuum_count = 0;
-		result->analyze_timestamp = 0;
-		result->analyze_count = 0;
-		result->autovac_analyze_timestamp = 0;
-		result->autovac_analyze_count = 0;
+		MemSet(&result->stats, 0, sizeof(PgStat_StatTabEntry));
+		result->stats.tableid = tableoid;
 	}
 
 	return result;
 }
 
+/*
+ * Remove the shared table and function entries of a database.
+ */
+static void
+pgstat_remove_db_objects(Oid databaseid)
+{
+	dshash_seq_status hstat;
+	PgStatSharedTabEntry *tabentry;
+	PgStatSharedFuncEntry *funcentry;
+
+	dshash_seq_init(&hstat, pgStatSharedTabHash, true);
+	while ((tabentry = dshash_seq_next(&hstat)) != NULL)
+	{
+		if (tabentry->key.databaseid == databaseid)
+			dshash_delete_current(&hstat);
+	}
+	dshash_seq_term(&hstat);
+
+	dshash_seq_init(&hstat, pgStatSharedFuncHash, true);
+	while ((funcentry = dshash_seq_next(&hstat)) != NULL)
+	{
+		if (funcentry->key.databaseid == databaseid)
+			dshash_delete_current(&hstat);
+	}
+	dshash_seq_term(&hstat);
+}
+
 
 /* ----------
- * pgstat_write_statsfiles() -
- *		Write the global statistics file, as well as requested DB files.
- *
- *	'permanent' specifies writing to the permanent files not temporary ones.
- *	When true (happens only when the collector is shutting down), also remove
- *	the temporary files so that backends starting up under a new postmaster
- *	can't read old data before the new collector is ready.
+ * pgstat_save_shared_stats() -
  *
- *	When 'allDbs' is false, only the requested databases (listed in
- *	pending_write_requests) will be written; otherwise, all databases
- *	will be written.
+ *	Write the shared per-database, per-table and per-function statistics
+ *	to PGSTAT_SHARED_STATS_FILENAME, so that they survive a clean shutdown.
+ *	Called by the checkpointer once the shutdown checkpoint is done.
  * ----------
  */
-static void
-pgstat_write_statsfiles(bool permanent, bool allDbs)
+void
+pgstat_save_shared_stats(void)
 {
-	HASH_SEQ_STATUS hstat;
+	dshash_seq_status hstat;
 	PgStat_StatDBEntry *dbentry;
+	PgStatSharedTabEntry *tabentry;
+	PgStatSharedFuncEntry *funcentry;
 	FILE	   *fpout;
 	int32		format_id;
-	const char *tmpfile = permanent ? PGSTAT_STAT_PERMANENT_TMPFILE : pgstat_stat_tmpname;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
+	const char *tmpfile = PGSTAT_SHARED_STATS_TMPFILE;
+	const char *statfile = PGSTAT_SHARED_STATS_FILENAME;
 	int			rc;
-	int			i;
+
+	if (!pgstat_attach_shmem())
+		return;
 
 	elog(DEBUG2, "writing stats file \"%s\"", statfile);
 
@@ -5132,11 +5663,6 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 		return;
 	}
 
-	/*
-	 * Set the timestamp of the stats file.
-	 */
-	globalStats.stats_timestamp = GetCurrentTimestamp();
-
 	/*
 	 * Write the file header --- currently just a format ID.
 	 */
@@ -5145,69 +5671,45 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 	(void) rc;					/* we'll check for error with ferror */
 
 	/*
-	 * Write global stats struct
-	 */
-	rc = fwrite(&globalStats, sizeof(globalStats), 1, fpout);
-	(void) rc;					/* we'll check for error with ferror */
-
-	/*
-	 * Write archiver stats struct
-	 */
-	rc = fwrite(&archiverStats, sizeof(archiverStats), 1, fpout);
-	(void) rc;					/* we'll check for error with ferror */
-
-	/*
-	 * Write WAL stats struct
-	 */
-	rc = fwrite(&walStats, sizeof(walStats), 1, fpout);
-	(void) rc;					/* we'll check for error with ferror */
-
-	/*
-	 * Write SLRU stats struct
+	 * Walk through the database table.
 	 */
-	rc = fwrite(slruStats, sizeof(slruStats), 1, fpout);
-	(void) rc;					/* we'll check for error with ferror */
+	dshash_seq_init(&hstat, pgStatSharedDBHash, false);
+	while ((dbentry = dshash_seq_next(&hstat)) != NULL)
+	{
+		fputc('D', fpout);
+		rc = fwrite(dbentry, sizeof(PgStat_StatDBEntry), 1, fpout);
+		(void) rc;				/* we'll check for error with ferror */
+	}
+	dshash_seq_term(&hstat);
 
 	/*
-	 * Walk through the database table.
+	 * Walk through the per-table stats, including the database each table
+	 * belongs to.
 	 */
-	hash_seq_init(&hstat, pgStatDBHash);
-	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
+	dshash_seq_init(&hstat, pgStatSharedTabHash, false);
+	while ((tabentry = dshash_seq_next(&hstat)) != NULL)
 	{
-		/*
-		 * Write out the table and function stats for this DB into the
-		 * appropriate per-DB stat file, if required.
-		 */
-		if (allDbs || pgstat_db_requested(dbentry->databaseid))
-		{
-			/* Make DB's timestamp consistent with the global stats */
-			dbentry->stats_timestamp = globalStats.stats_timestamp;
-
-			pgstat_write_db_statsfile(dbentry, permanent);
-		}
-
-		/*
-		 * Write out the DB entry. We don't write the tables or functions
-		 * pointers, since they're of no use to any other process.
-		 */
-		fputc('D', fpout);
-		rc = fwrite(dbentry, offsetof(PgStat_StatDBEntry, tables), 1, fpout);
+		fputc('T', fpout);
+		rc = fwrite(tabentry, sizeof(PgStatSharedTabEntry), 1, fpout);
 		(void) rc;				/* we'll check for error with ferror */
 	}
+	dshash_seq_term(&hstat);
 
 	/*
-	 * Write replication slot stats struct
+	 * Likewise for the per-function stats.
 	 */
-	for (i = 0; i < nReplSlotStats; i++)
+	dshash_seq_init(&hstat, pgStatSharedFuncHash, false);
+	while ((funcentry = dshash_seq_next(&hstat)) != NULL)
 	{
-		fputc('R', fpout);
-		rc = fwrite(&replSlotStats[i], sizeof(PgStat_ReplSlotStats), 1, fpout);
+		fputc('F', fpout);
+		rc = fwrite(funcentry, sizeof(PgStatSharedFuncEntry), 1, fpout);
 		(void) rc;				/* we'll check for error with ferror */
 	}
+	dshash_seq_term(&hstat);
 
 	/*
 	 * No more output to be done. Close the temp file and replace the old
-	 * pgstat.stat with it.  The ferror() check replaces testing for error
+	 * stats file with it.  The ferror() check replaces testing for error
 	 * after each individual fputc or fwrite above.
 	 */
 	fputc('E', fpout);
@@ -5237,129 +5739,261 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 						tmpfile, statfile)));
 		unlink(tmpfile);
 	}
-
-	if (permanent)
-		unlink(pgstat_stat_filename);
-
-	/*
-	 * Now throw away the list of requests.  Note that requests sent after we
-	 * started the write are still waiting on the network socket.
-	 */
-	list_free(pending_write_requests);
-	pending_write_requests = NIL;
-}
-
-/*
- * return the filename for a DB stat file; filename is the output buffer,
- * of length len.
- */
-static void
-get_dbstat_filename(bool permanent, bool tempname, Oid databaseid,
-					char *filename, int len)
-{
-	int			printed;
-
-	/* NB -- pgstat_reset_remove_files knows about the pattern this uses */
-	printed = snprintf(filename, len, "%s/db_%u.%s",
-					   permanent ? PGSTAT_STAT_PERMANENT_DIRECTORY :
-					   pgstat_stat_directory,
-					   databaseid,
-					   tempname ? "tmp" : "stat");
-	if (printed >= len)
-		elog(ERROR, "overlength pgstat path");
 }
 
 /* ----------
- * pgstat_write_db_statsfile() -
- *		Write the stat file for a single database.
+ * pgstat_restore_shared_stats() -
  *
- *	If writing to the permanent file (happens when the collector is
- *	shutting down only), remove the temporary file so that backends
- *	starting up under a new postmaster can't read the old data before
- *	the new collector is ready.
+ *	Load the statistics saved by pgstat_save_shared_stats into shared
+ *	memory.  Called by the startup process when no crash recovery is needed;
+ *	after a crash, pgstat_reset_all removes the file instead.
+ *
+ *	The file is removed after reading, as the shared memory contents are now
+ *	authoritative; a later shutdown that doesn't save them mustn't leave
+ *	stale data behind.
  * ----------
  */
-static void
-pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
+void
+pgstat_restore_shared_stats(void)
 {
-	HASH_SEQ_STATUS tstat;
-	HASH_SEQ_STATUS fstat;
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatFuncEntry *funcentry;
-	FILE	   *fpout;
+	FILE	   *fpin;
 	int32		format_id;
-	Oid			dbid = dbentry->databaseid;
-	int			rc;
-	char		tmpfile[MAXPGPATH];
-	char		statfile[MAXPGPATH];
+	const char *statfile = PGSTAT_SHARED_STATS_FILENAME;
 
-	get_dbstat_filename(permanent, true, dbid, tmpfile, MAXPGPATH);
-	get_dbstat_filename(permanent, false, dbid, statfile, MAXPGPATH);
-
-	elog(DEBUG2, "writing stats file \"%s\"", statfile);
+	if (!pgstat_attach_shmem())
+		return;
 
 	/*
-	 * Open the statistics temp file to write out the current values.
+	 * Try to open the stats file.  If it doesn't exist, we simply start from
+	 * scratch with empty counters.
 	 */
-	fpout = AllocateFile(tmpfile, PG_BINARY_W);
-	if (fpout == NULL)
+	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
 	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not open temporary statistics file \"%s\": %m",
-						tmpfile)));
+		if (errno != ENOENT)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not open statistics file \"%s\": %m",
+							statfile)));
 		return;
 	}
 
 	/*
-	 * Write the file header --- currently just a format ID.
-	 */
-	format_id = PGSTAT_FILE_FORMAT_ID;
-	rc = fwrite(&format_id, sizeof(format_id), 1, fpout);
-	(void) rc;					/* we'll check for error with ferror */
-
-	/*
-	 * Walk through the database's access stats per table.
+	 * Verify it's of the expected format.
 	 */
-	hash_seq_init(&tstat, dbentry->tables);
-	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&tstat)) != NULL)
+	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
+		format_id != PGSTAT_FILE_FORMAT_ID)
 	{
-		fputc('T', fpout);
-		rc = fwrite(tabentry, sizeof(PgStat_StatTabEntry), 1, fpout);
-		(void) rc;				/* we'll check for error with ferror */
+		ereport(LOG,
+				(errmsg("corrupted statistics file \"%s\"", statfile)));
+		goto done;
 	}
 
-	/*
-	 * Walk through the database's function stats table.
-	 */
-	hash_seq_init(&fstat, dbentry->functions);
-	while ((funcentry = (PgStat_StatFuncEntry *) hash_seq_search(&fstat)) != NULL)
+	for (;;)
 	{
-		fputc('F', fpout);
-		rc = fwrite(funcentry, sizeof(PgStat_StatFuncEntry), 1, fpout);
-		(void) rc;				/* we'll check for error with ferror */
-	}
+		switch (fgetc(fpin))
+		{
+				/*
+				 * 'D'	A PgStat_StatDBEntry struct describing a database
+				 * follows.
+				 */
+			case 'D':
+				{
+					PgStat_StatDBEntry dbbuf;
+					PgStat_StatDBEntry *dbentry;
 
-	/*
-	 * No more output to be done. Close the temp file and replace the old
-	 * pgstat.stat with it.  The ferror() check replaces testing for error
-	 * after each individual fputc or fwrite above.
-	 */
-	fputc('E', fpout);
+					if (fread(&dbbuf, 1, sizeof(dbbuf), fpin) != sizeof(dbbuf))
+					{
+						ereport(LOG,
+								(errmsg("corrupted statistics file \"%s\"",
+										statfile)));
+						goto done;
+					}
 
-	if (ferror(fpout))
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
-				 errmsg("could not write temporary statistics file \"%s\": %m",
-						tmpfile)));
-		FreeFile(fpout);
-		unlink(tmpfile);
-	}
-	else if (FreeFile(fpout) < 0)
-	{
-		ereport(LOG,
-				(errcode_for_file_access(),
+					dbentry = pgstat_get_db_entry(dbbuf.databaseid, true);
+					memcpy(dbentry, &dbbuf, sizeof(dbbuf));
+					dshash_release_lock(pgStatSharedDBHash, dbentry);
+					break;
+				}
+
+				/*
+				 * 'T'	A PgStatSharedTabEntry follows.
+				 */
+			case 'T':
+				{
+					PgStatSharedTabEntry tabbuf;
+					PgStatSharedTabEntry *tabentry;
+
+					if (fread(&tabbuf, 1, sizeof(tabbuf), fpin) != sizeof(tabbuf))
+					{
+						ereport(LOG,
+								(errmsg("corrupted statistics file \"%s\"",
+										statfile)));
+						goto done;
+					}
+
+					tabentry = pgstat_get_tab_entry(tabbuf.key.databaseid,
+													tabbuf.key.objectid, true);
+					memcpy(&tabentry->stats, &tabbuf.stats,
+						   sizeof(PgStat_StatTabEntry));
+					dshash_release_lock(pgStatSharedTabHash, tabentry);
+					break;
+				}
+
+				/*
+				 * 'F'	A PgStatSharedFuncEntry follows.
+				 */
+			case 'F':
+				{
+					PgStatSharedFuncEntry funcbuf;
+					PgStatSharedFuncEntry *funcentry;
+					bool		found;
+
+					if (fread(&funcbuf, 1, sizeof(funcbuf), fpin) != sizeof(funcbuf))
+					{
+						ereport(LOG,
+								(errmsg("corrupted statistics file \"%s\"",
+										statfile)));
+						goto done;
+					}
+
+					funcentry = (PgStatSharedFuncEntry *)
+						dshash_find_or_insert(pgStatSharedFuncHash,
+											  &funcbuf.key, &found);
+					memcpy(&funcentry->stats, &funcbuf.stats,
+						   sizeof(PgStat_StatFuncEntry));
+					dshash_release_lock(pgStatSharedFuncHash, funcentry);
+					break;
+				}
+
+				/*
+				 * 'E'	The EOF marker of a complete stats file.
+				 */
+			case 'E':
+				goto done;
+
+			default:
+				ereport(LOG,
+						(errmsg("corrupted statistics file \"%s\"",
+								statfile)));
+				goto done;
+		}
+	}
+
+done:
+	FreeFile(fpin);
+
+	elog(DEBUG2, "removing permanent stats file \"%s\"", statfile);
+	unlink(statfile);
+}
+
+
+/* ----------
+ * pgstat_write_statsfile() -
+ *		Write the global statistics file.
+ *
+ *	'permanent' specifies writing to the permanent file not the temporary
+ *	one.  When true (happens only when the collector is shutting down), also
+ *	remove the temporary file so that backends starting up under a new
+ *	postmaster can't read old data before the new collector is ready.
+ * ----------
+ */
+static void
+pgstat_write_statsfile(bool permanent)
+{
+	FILE	   *fpout;
+	int32		format_id;
+	const char *tmpfile = permanent ? PGSTAT_STAT_PERMANENT_TMPFILE : pgstat_stat_tmpname;
+	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
+	int			rc;
+	int			i;
+
+	elog(DEBUG2, "writing stats file \"%s\"", statfile);
+
+	/*
+	 * Open the statistics temp file to write out the current values.
+	 */
+	fpout = AllocateFile(tmpfile, PG_BINARY_W);
+	if (fpout == NULL)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not open temporary statistics file \"%s\": %m",
+						tmpfile)));
+		return;
+	}
+
+	/*
+	 * Set the timestamp of the stats file.
+	 */
+	globalStats.stats_timestamp = GetCurrentTimestamp();
+
+	/*
+	 * Write the file header --- currently just a format ID.
+	 */
+	format_id = PGSTAT_FILE_FORMAT_ID;
+	rc = fwrite(&format_id, sizeof(format_id), 1, fpout);
+	(void) rc;					/* we'll check for error with ferror */
+
+	/*
+	 * Write global stats struct
+	 */
+	rc = fwrite(&globalStats, sizeof(globalStats), 1, fpout);
+	(void) rc;					/* we'll check for error with ferror */
+
+	/*
+	 * Write archiver stats struct
+	 */
+	rc = fwrite(&archiverStats, sizeof(archiverStats), 1, fpout);
+	(void) rc;					/* we'll check for error with ferror */
+
+	/*
+	 * Write WAL stats struct
+	 */
+	rc = fwrite(&walStats, sizeof(walStats), 1, fpout);
+	(void) rc;					/* we'll check for error with ferror */
+
+	/*
+	 * Write SLRU stats struct
+	 */
+	rc = fwrite(slruStats, sizeof(slruStats), 1, fpout);
+	(void) rc;					/* we'll check for error with ferror */
+
+	/*
+	 * Write I/O stats struct
+	 */
+	rc = fwrite(&ioStats, sizeof(ioStats), 1, fpout);
+	(void) rc;					/* we'll check for error with ferror */
+
+	/*
+	 * Write replication slot stats struct
+	 */
+	for (i = 0; i < nReplSlotStats; i++)
+	{
+		fputc('R', fpout);
+		rc = fwrite(&replSlotStats[i], sizeof(PgStat_ReplSlotStats), 1, fpout);
+		(void) rc;				/* we'll check for error with ferror */
+	}
+
+	/*
+	 * No more output to be done. Close the temp file and replace the old
+	 * pgstat.stat with it.  The ferror() check replaces testing for error
+	 * after each individual fputc or fwrite above.
+	 */
+	fputc('E', fpout);
+
+	if (ferror(fpout))
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not write temporary statistics file \"%s\": %m",
+						tmpfile)));
+		FreeFile(fpout);
+		unlink(tmpfile);
+	}
+	else if (FreeFile(fpout) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
 				 errmsg("could not close temporary statistics file \"%s\": %m",
 						tmpfile)));
 		unlink(tmpfile);
@@ -5374,74 +6008,47 @@ pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
 	}
 
 	if (permanent)
-	{
-		get_dbstat_filename(false, false, dbid, statfile, MAXPGPATH);
+		unlink(pgstat_stat_filename);
 
-		elog(DEBUG2, "removing temporary stats file \"%s\"", statfile);
-		unlink(statfile);
-	}
+	/*
+	 * Now forget the request.  Note that requests sent after we started the
+	 * write are still waiting on the network socket.
+	 */
+	pending_write_request = false;
 }
 
 /* ----------
- * pgstat_read_statsfiles() -
- *
- *	Reads in some existing statistics collector files and returns the
- *	databases hash table that is the top level of the data.
- *
- *	If 'onlydb' is not InvalidOid, it means we only want data for that DB
- *	plus the shared catalogs ("DB 0").  We'll still populate the DB hash
- *	table for all databases, but we don't bother even creating table/function
- *	hash tables for other databases.
+ * pgstat_read_statsfile() -
  *
- *	'permanent' specifies reading from the permanent files not temporary ones.
- *	When true (happens only when the collector is starting up), remove the
- *	files after reading; the in-memory status is now authoritative, and the
- *	files would be out of date in case somebody else reads them.
+ *	Reads in the existing global statistics collector file.
  *
- *	If a 'deep' read is requested, table/function stats are read, otherwise
- *	the table/function hash tables remain empty.
+ *	'permanent' specifies reading from the permanent file not the temporary
+ *	one.  When true (happens only when the collector is starting up), remove
+ *	the file after reading; the in-memory status is now authoritative, and
+ *	the file would be out of date in case somebody else reads it.
  * ----------
  */
-static HTAB *
-pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
+static void
+pgstat_read_statsfile(bool permanent)
 {
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatDBEntry dbbuf;
-	HASHCTL		hash_ctl;
-	HTAB	   *dbhash;
 	FILE	   *fpin;
 	int32		format_id;
-	bool		found;
 	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
 	int			i;
 
-	/*
-	 * The tables will live in pgStatLocalContext.
-	 */
-	pgstat_setup_memcxt();
-
-	/*
-	 * Create the DB hashtable
-	 */
-	memset(&hash_ctl, 0, sizeof(hash_ctl));
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatDBEntry);
-	hash_ctl.hcxt = pgStatLocalContext;
-	dbhash = hash_create("Databases hash", PGSTAT_DB_HASH_SIZE, &hash_ctl,
-						 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-
 	/* Allocate the space for replication slot statistics */
 	replSlotStats = palloc0(max_replication_slots * sizeof(PgStat_ReplSlotStats));
 	nReplSlotStats = 0;
 
 	/*
-	 * Clear out global, archiver, WAL and SLRU statistics so they start from
-	 * zero in case we can't load an existing statsfile.
+	 * Clear out global, archiver, WAL, SLRU and I/O statistics so they start
+	 * from zero in case we can't load an existing statsfile.
 	 */
 	memset(&globalStats, 0, sizeof(globalStats));
 	memset(&archiverStats, 0, sizeof(archiverStats));
 	memset(&walStats, 0, sizeof(walStats));
 	memset(&slruStats, 0, sizeof(slruStats));
+	memset(&ioStats, 0, sizeof(ioStats));
 
 	/*
 	 * Set the current timestamp (will be kept only in case we can't load an
@@ -5450,6 +6057,7 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 	globalStats.stat_reset_timestamp = GetCurrentTimestamp();
 	archiverStats.stat_reset_timestamp = globalStats.stat_reset_timestamp;
 	walStats.stat_reset_timestamp = globalStats.stat_reset_timestamp;
+	ioStats.stat_reset_timestamp = globalStats.stat_reset_timestamp;
 
 	/*
 	 * Set the same reset timestamp for all SLRU items too.
@@ -5479,7 +6087,7 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 					(errcode_for_file_access(),
 					 errmsg("could not open statistics file \"%s\": %m",
 							statfile)));
-		return dbhash;
+		return;
 	}
 
 	/*
@@ -5548,275 +6156,41 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 	}
 
 	/*
-	 * We found an existing collector stats file. Read it and put all the
-	 * hashtable entries into place.
-	 */
-	for (;;)
-	{
-		switch (fgetc(fpin))
-		{
-				/*
-				 * 'D'	A PgStat_StatDBEntry struct describing a database
-				 * follows.
-				 */
-			case 'D':
-				if (fread(&dbbuf, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Add to the DB hash
-				 */
-				dbentry = (PgStat_StatDBEntry *) hash_search(dbhash,
-															 (void *) &dbbuf.databaseid,
-															 HASH_ENTER,
-															 &found);
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(dbentry, &dbbuf, sizeof(PgStat_StatDBEntry));
-				dbentry->tables = NULL;
-				dbentry->functions = NULL;
-
-				/*
-				 * In the collector, disregard the timestamp we read from the
-				 * permanent stats file; we should be willing to write a temp
-				 * stats file immediately upon the first request from any
-				 * backend.
-				 */
-				if (pgStatRunningInCollector)
-					dbentry->stats_timestamp = 0;
-
-				/*
-				 * Don't create tables/functions hashtables for uninteresting
-				 * databases.
-				 */
-				if (onlydb != InvalidOid)
-				{
-					if (dbbuf.databaseid != onlydb &&
-						dbbuf.databaseid != InvalidOid)
-						break;
-				}
-
-				memset(&hash_ctl, 0, sizeof(hash_ctl));
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->tables = hash_create("Per-database table",
-											  PGSTAT_TAB_HASH_SIZE,
-											  &hash_ctl,
-											  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->functions = hash_create("Per-database function",
-												 PGSTAT_FUNCTION_HASH_SIZE,
-												 &hash_ctl,
-												 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-
-				/*
-				 * If requested, read the data from the database-specific
-				 * file.  Otherwise we just leave the hashtables empty.
-				 */
-				if (deep)
-					pgstat_read_db_statsfile(dbentry->databaseid,
-											 dbentry->tables,
-											 dbentry->functions,
-											 permanent);
-
-				break;
-
-				/*
-				 * 'R'	A PgStat_ReplSlotStats struct describing a replication
-				 * slot follows.
-				 */
-			case 'R':
-				if (fread(&replSlotStats[nReplSlotStats], 1, sizeof(PgStat_ReplSlotStats), fpin)
-					!= sizeof(PgStat_ReplSlotStats))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					memset(&replSlotStats[nReplSlotStats], 0, sizeof(PgStat_ReplSlotStats));
-					goto done;
-				}
-				nReplSlotStats++;
-				break;
-
-			case 'E':
-				goto done;
-
-			default:
-				ereport(pgStatRunningInCollector ? LOG : WARNING,
-						(errmsg("corrupted statistics file \"%s\"",
-								statfile)));
-				goto done;
-		}
-	}
-
-done:
-	FreeFile(fpin);
-
-	/* If requested to read the permanent file, also get rid of it. */
-	if (permanent)
-	{
-		elog(DEBUG2, "removing permanent stats file \"%s\"", statfile);
-		unlink(statfile);
-	}
-
-	return dbhash;
-}
-
-
-/* ----------
- * pgstat_read_db_statsfile() -
- *
- *	Reads in the existing statistics collector file for the given database,
- *	filling the passed-in tables and functions hash tables.
- *
- *	As in pgstat_read_statsfiles, if the permanent file is requested, it is
- *	removed after reading.
- *
- *	Note: this code has the ability to skip storing per-table or per-function
- *	data, if NULL is passed for the corresponding hashtable.  That's not used
- *	at the moment though.
- * ----------
- */
-static void
-pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
-						 bool permanent)
-{
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatTabEntry tabbuf;
-	PgStat_StatFuncEntry funcbuf;
-	PgStat_StatFuncEntry *funcentry;
-	FILE	   *fpin;
-	int32		format_id;
-	bool		found;
-	char		statfile[MAXPGPATH];
-
-	get_dbstat_filename(permanent, false, databaseid, statfile, MAXPGPATH);
-
-	/*
-	 * Try to open the stats file. If it doesn't exist, the backends simply
-	 * return zero for anything and the collector simply starts from scratch
-	 * with empty counters.
-	 *
-	 * ENOENT is a possibility if the stats collector is not running or has
-	 * not yet written the stats file the first time.  Any other failure
-	 * condition is suspicious.
+	 * Read I/O stats struct
 	 */
-	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
-	{
-		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
-					(errcode_for_file_access(),
-					 errmsg("could not open statistics file \"%s\": %m",
-							statfile)));
-		return;
-	}
-
-	/*
-	 * Verify it's of the expected format.
-	 */
-	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
-		format_id != PGSTAT_FILE_FORMAT_ID)
+	if (fread(&ioStats, 1, sizeof(ioStats), fpin) != sizeof(ioStats))
 	{
 		ereport(pgStatRunningInCollector ? LOG : WARNING,
 				(errmsg("corrupted statistics file \"%s\"", statfile)));
+		memset(&ioStats, 0, sizeof(ioStats));
 		goto done;
 	}
 
 	/*
 	 * We found an existing collector stats file. Read it and put all the
-	 * hashtable entries into place.
-	 */
-	for (;;)
-	{
-		switch (fgetc(fpin))
-		{
-				/*
-				 * 'T'	A PgStat_StatTabEntry follows.
-				 */
-			case 'T':
-				if (fread(&tabbuf, 1, sizeof(PgStat_StatTabEntry),
-						  fpin) != sizeof(PgStat_StatTabEntry))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Skip if table data not wanted.
-				 */
-				if (tabhash == NULL)
-					break;
-
-				tabentry = (PgStat_StatTabEntry *) hash_search(tabhash,
-															   (void *) &tabbuf.tableid,
-															   HASH_ENTER, &found);
-
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(tabentry, &tabbuf, sizeof(tabbuf));
-				break;
-
-				/*
-				 * 'F'	A PgStat_StatFuncEntry follows.
-				 */
-			case 'F':
-				if (fread(&funcbuf, 1, sizeof(PgStat_StatFuncEntry),
-						  fpin) != sizeof(PgStat_StatFuncEntry))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
+	 * replication slot entries into place.
+	 */
+	for (;;)
+	{
+		switch (fgetc(fpin))
+		{
 				/*
-				 * Skip if function data not wanted.
+				 * 'R'	A PgStat_ReplSlotStats struct describing a replication
+				 * slot follows.
 				 */
-				if (funchash == NULL)
-					break;
-
-				funcentry = (PgStat_StatFuncEntry *) hash_search(funchash,
-																 (void *) &funcbuf.functionid,
-																 HASH_ENTER, &found);
-
-				if (found)
+			case 'R':
+				if (fread(&replSlotStats[nReplSlotStats], 1, sizeof(PgStat_ReplSlotStats), fpin)
+					!= sizeof(PgStat_ReplSlotStats))
 				{
 					ereport(pgStatRunningInCollector ? LOG : WARNING,
 							(errmsg("corrupted statistics file \"%s\"",
 									statfile)));
+					memset(&replSlotStats[nReplSlotStats], 0, sizeof(PgStat_ReplSlotStats));
 					goto done;
 				}
-
-				memcpy(funcentry, &funcbuf, sizeof(funcbuf));
+				nReplSlotStats++;
 				break;
 
-				/*
-				 * 'E'	The EOF marker of a complete stats file.
-				 */
 			case 'E':
 				goto done;
 
@@ -5831,6 +6205,7 @@ pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
 done:
 	FreeFile(fpin);
 
+	/* If requested to read the permanent file, also get rid of it. */
 	if (permanent)
 	{
 		elog(DEBUG2, "removing permanent stats file \"%s\"", statfile);
@@ -5838,34 +6213,19 @@ done:
 	}
 }
 
+
 /* ----------
- * pgstat_read_db_statsfile_timestamp() -
+ * pgstat_read_statsfile_timestamp() -
  *
- *	Attempt to determine the timestamp of the last db statfile write.
+ *	Attempt to determine the timestamp of the last global statfile write.
  *	Returns true if successful; the timestamp is stored in *ts. The caller must
  *	rely on timestamp stored in *ts iff the function returns true.
- *
- *	This needs to be careful about handling databases for which no stats file
- *	exists, such as databases without a stat entry or those not yet written:
- *
- *	- if there's a database entry in the global file, return the corresponding
- *	stats_timestamp value.
- *
- *	- if there's no db stat entry (e.g. for a new or inactive database),
- *	there's no stats_timestamp value, but also nothing to write so we return
- *	the timestamp of the global statfile.
  * ----------
  */
 static bool
-pgstat_read_db_statsfile_timestamp(Oid databaseid, bool permanent,
-								   TimestampTz *ts)
+pgstat_read_statsfile_timestamp(bool permanent, TimestampTz *ts)
 {
-	PgStat_StatDBEntry dbentry;
 	PgStat_GlobalStats myGlobalStats;
-	PgStat_ArchiverStats myArchiverStats;
-	PgStat_WalStats myWalStats;
-	PgStat_SLRUStats mySLRUStats[SLRU_NUM_ELEMENTS];
-	PgStat_ReplSlotStats myReplSlotStats;
 	FILE	   *fpin;
 	int32		format_id;
 	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
@@ -5908,142 +6268,29 @@ pgstat_read_db_statsfile_timestamp(Oid databaseid, bool permanent,
 		return false;
 	}
 
-	/*
-	 * Read archiver stats struct
-	 */
-	if (fread(&myArchiverStats, 1, sizeof(myArchiverStats),
-			  fpin) != sizeof(myArchiverStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
-
-	/*
-	 * Read WAL stats struct
-	 */
-	if (fread(&myWalStats, 1, sizeof(myWalStats), fpin) != sizeof(myWalStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
-
-	/*
-	 * Read SLRU stats struct
-	 */
-	if (fread(mySLRUStats, 1, sizeof(mySLRUStats), fpin) != sizeof(mySLRUStats))
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
-
-	/* By default, we're going to return the timestamp of the global file. */
 	*ts = myGlobalStats.stats_timestamp;
 
-	/*
-	 * We found an existing collector stats file.  Read it and look for a
-	 * record for the requested database.  If found, use its timestamp.
-	 */
-	for (;;)
-	{
-		switch (fgetc(fpin))
-		{
-				/*
-				 * 'D'	A PgStat_StatDBEntry struct describing a database
-				 * follows.
-				 */
-			case 'D':
-				if (fread(&dbentry, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					FreeFile(fpin);
-					return false;
-				}
-
-				/*
-				 * If this is the DB we're looking for, save its timestamp and
-				 * we're done.
-				 */
-				if (dbentry.databaseid == databaseid)
-				{
-					*ts = dbentry.stats_timestamp;
-					goto done;
-				}
-
-				break;
-
-				/*
-				 * 'R'	A PgStat_ReplSlotStats struct describing a replication
-				 * slot follows.
-				 */
-			case 'R':
-				if (fread(&myReplSlotStats, 1, sizeof(PgStat_ReplSlotStats), fpin)
-					!= sizeof(PgStat_ReplSlotStats))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					FreeFile(fpin);
-					return false;
-				}
-				break;
-
-			case 'E':
-				goto done;
-
-			default:
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					FreeFile(fpin);
-					return false;
-				}
-		}
-	}
-
-done:
 	FreeFile(fpin);
 	return true;
 }
 
 /*
- * If not already done, read the statistics collector stats file into
- * some hash tables.  The results will be kept until pgstat_clear_snapshot()
- * is called (typically, at end of transaction).
+ * If not already done, read the statistics collector stats file.  The
+ * results will be kept until pgstat_clear_snapshot() is called (typically,
+ * at end of transaction).
  */
 static void
 backend_read_statsfile(void)
 {
 	TimestampTz min_ts = 0;
 	TimestampTz ref_ts = 0;
-	Oid			inquiry_db;
 	int			count;
 
 	/* already read it? */
-	if (pgStatDBHash)
+	if (pgStatGlobalsRead)
 		return;
 	Assert(!pgStatRunningInCollector);
 
-	/*
-	 * In a normal backend, we check staleness of the data for our own DB, and
-	 * so we send MyDatabaseId in inquiry messages.  In the autovac launcher,
-	 * check staleness of the shared-catalog data, and send InvalidOid in
-	 * inquiry messages so as not to force writing unnecessary data.
-	 */
-	if (IsAutoVacuumLauncherProcess())
-		inquiry_db = InvalidOid;
-	else
-		inquiry_db = MyDatabaseId;
-
 	/*
 	 * Loop until fresh enough stats file is available or we ran out of time.
 	 * The stats inquiry message is sent repeatedly in case collector drops
@@ -6057,7 +6304,7 @@ backend_read_statsfile(void)
 
 		CHECK_FOR_INTERRUPTS();
 
-		ok = pgstat_read_db_statsfile_timestamp(inquiry_db, false, &file_ts);
+		ok = pgstat_read_statsfile_timestamp(false, &file_ts);
 
 		cur_ts = GetCurrentTimestamp();
 		/* Calculate min acceptable timestamp, if we didn't already */
@@ -6066,10 +6313,7 @@ backend_read_statsfile(void)
 			/*
 			 * We set the minimum acceptable timestamp to PGSTAT_STAT_INTERVAL
 			 * msec before now.  This indirectly ensures that the collector
-			 * needn't write the file more often than PGSTAT_STAT_INTERVAL. In
-			 * an autovacuum worker, however, we want a lower delay to avoid
-			 * using stale data, so we use PGSTAT_RETRY_DELAY (since the
-			 * number of workers is low, this shouldn't be a problem).
+			 * needn't write the file more often than PGSTAT_STAT_INTERVAL.
 			 *
 			 * We don't recompute min_ts after sleeping, except in the
 			 * unlikely case that cur_ts went backwards.  So we might end up
@@ -6080,12 +6324,8 @@ backend_read_statsfile(void)
 			 * actually accept.
 			 */
 			ref_ts = cur_ts;
-			if (IsAutoVacuumWorkerProcess())
-				min_ts = TimestampTzPlusMilliseconds(ref_ts,
-													 -PGSTAT_RETRY_DELAY);
-			else
-				min_ts = TimestampTzPlusMilliseconds(ref_ts,
-													 -PGSTAT_STAT_INTERVAL);
+			min_ts = TimestampTzPlusMilliseconds(ref_ts,
+												 -PGSTAT_STAT_INTERVAL);
 		}
 
 		/*
@@ -6117,7 +6357,7 @@ backend_read_statsfile(void)
 				pfree(mytime);
 			}
 
-			pgstat_send_inquiry(cur_ts, min_ts, inquiry_db);
+			pgstat_send_inquiry(cur_ts, min_ts);
 			break;
 		}
 
@@ -6127,7 +6367,7 @@ backend_read_statsfile(void)
 
 		/* Not there or too old, so kick the collector and wait a bit */
 		if ((count % PGSTAT_INQ_LOOP_COUNT) == 0)
-			pgstat_send_inquiry(cur_ts, min_ts, inquiry_db);
+			pgstat_send_inquiry(cur_ts, min_ts);
 
 		pg_usleep(PGSTAT_RETRY_DELAY * 1000L);
 	}
@@ -6137,15 +6377,58 @@ backend_read_statsfile(void)
 				(errmsg("using stale statistics instead of current ones "
 						"because stats collector is not responding")));
 
-	/*
-	 * Autovacuum launcher wants stats about all databases, but a shallow read
-	 * is sufficient.  Regular backends want a deep read for just the tables
-	 * they can see (MyDatabaseId + shared catalogs).
-	 */
-	if (IsAutoVacuumLauncherProcess())
-		pgStatDBHash = pgstat_read_statsfiles(InvalidOid, false, false);
-	else
-		pgStatDBHash = pgstat_read_statsfiles(MyDatabaseId, false, true);
+	pgstat_read_statsfile(false);
+	pgStatGlobalsRead = true;
+}
+
+
+/* ----------
+ * pgstat_snapshot_fetch() -
+ *
+ *	Look up an object in one of the snapshot hash tables, copying its
+ *	statistics from the shared hash table the first time it's asked for
+ *	in this transaction.  "offset" and "size" locate the statistics within
+ *	the shared entry.  The "found" field of the result tells whether the
+ *	object had any statistics.
+ * ----------
+ */
+static PgStatSnapshotEntry *
+pgstat_snapshot_fetch(HTAB **snapshot, const char *name, long nelem,
+					  dshash_table *shared, PgStatObjectKey *key,
+					  const void *shared_key, Size offset, Size size)
+{
+	PgStatSnapshotEntry *entry;
+	bool		found;
+
+	if (*snapshot == NULL)
+	{
+		HASHCTL		hash_ctl;
+
+		pgstat_setup_memcxt();
+
+		hash_ctl.keysize = sizeof(PgStatObjectKey);
+		hash_ctl.entrysize = sizeof(PgStatSnapshotEntry);
+		hash_ctl.hcxt = pgStatLocalContext;
+		*snapshot = hash_create(name, nelem, &hash_ctl,
+								HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	entry = (PgStatSnapshotEntry *) hash_search(*snapshot, key,
+												HASH_ENTER, &found);
+	if (!found)
+	{
+		void	   *shent;
+
+		shent = dshash_find(shared, shared_key, false);
+		if (shent != NULL)
+		{
+			memcpy(&entry->stats, (char *) shent + offset, size);
+			dshash_release_lock(shared, shent);
+		}
+		entry->found = (shent != NULL);
+	}
+
+	return entry;
 }
 
 
@@ -6184,7 +6467,10 @@ pgstat_clear_snapshot(void)
 
 	/* Reset variables */
 	pgStatLocalContext = NULL;
-	pgStatDBHash = NULL;
+	pgStatDBSnapshot = NULL;
+	pgStatTabSnapshot = NULL;
+	pgStatFuncSnapshot = NULL;
+	pgStatGlobalsRead = false;
 	localBackendStatusTable = NULL;
 	localNumBackends = 0;
 }
@@ -6199,26 +6485,24 @@ pgstat_clear_snapshot(void)
 static void
 pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
-
-	elog(DEBUG2, "received inquiry for database %u", msg->databaseid);
+	elog(DEBUG2, "received inquiry");
 
 	/*
-	 * If there's already a write request for this DB, there's nothing to do.
+	 * If there's already a write request, there's nothing to do.
 	 *
 	 * Note that if a request is found, we return early and skip the below
-	 * check for clock skew.  This is okay, since the only way for a DB
-	 * request to be present in the list is that we have been here since the
-	 * last write round.  It seems sufficient to check for clock skew once per
-	 * write round.
+	 * check for clock skew.  This is okay, since the only way for a request
+	 * to be pending is that we have been here since the last write round.
+	 * It seems sufficient to check for clock skew once per write round.
 	 */
-	if (list_member_oid(pending_write_requests, msg->databaseid))
+	if (pending_write_request)
 		return;
 
 	/*
-	 * Check to see if we last wrote this database at a time >= the requested
-	 * cutoff time.  If so, this is a stale request that was generated before
-	 * we updated the DB file, and we don't need to do so again.
+	 * Check to see if we last wrote the stats file at a time >= the
+	 * requested cutoff time.  If so, this is a stale request that was
+	 * generated before we updated the file, and we don't need to do so
+	 * again.
 	 *
 	 * If the requestor's local clock time is older than stats_timestamp, we
 	 * should suspect a clock glitch, ie system time going backwards; though
@@ -6227,22 +6511,11 @@ pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len)
 	 * retreat in the system clock reading could otherwise cause us to neglect
 	 * to update the stats file for a long time.
 	 */
-	dbentry = pgstat_get_db_entry(msg->databaseid, false);
-	if (dbentry == NULL)
-	{
-		/*
-		 * We have no data for this DB.  Enter a write request anyway so that
-		 * the global stats will get updated.  This is needed to prevent
-		 * backend_read_statsfile from waiting for data that we cannot supply,
-		 * in the case of a new DB that nobody has yet reported any stats for.
-		 * See the behavior of pgstat_read_db_statsfile_timestamp.
-		 */
-	}
-	else if (msg->clock_time < dbentry->stats_timestamp)
+	if (msg->clock_time < globalStats.stats_timestamp)
 	{
 		TimestampTz cur_ts = GetCurrentTimestamp();
 
-		if (cur_ts < dbentry->stats_timestamp)
+		if (cur_ts < globalStats.stats_timestamp)
 		{
 			/*
 			 * Sure enough, time went backwards.  Force a new stats file write
@@ -6252,11 +6525,11 @@ pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len)
 			char	   *mytime;
 
 			/* Copy because timestamptz_to_str returns a static buffer */
-			writetime = pstrdup(timestamptz_to_str(dbentry->stats_timestamp));
+			writetime = pstrdup(timestamptz_to_str(globalStats.stats_timestamp));
 			mytime = pstrdup(timestamptz_to_str(cur_ts));
 			ereport(LOG,
-					(errmsg("stats_timestamp %s is later than collector's time %s for database %u",
-							writetime, mytime, dbentry->databaseid)));
+					(errmsg("stats_timestamp %s is later than collector's time %s",
+							writetime, mytime)));
 			pfree(writetime);
 			pfree(mytime);
 		}
@@ -6264,249 +6537,24 @@ pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len)
 		{
 			/*
 			 * Nope, it's just an old request.  Assuming msg's clock_time is
-			 * >= its cutoff_time, it must be stale, so we can ignore it.
-			 */
-			return;
-		}
-	}
-	else if (msg->cutoff_time <= dbentry->stats_timestamp)
-	{
-		/* Stale request, ignore it */
-		return;
-	}
-
-	/*
-	 * We need to write this DB, so create a request.
-	 */
-	pending_write_requests = lappend_oid(pending_write_requests,
-										 msg->databaseid);
-}
-
-
-/* ----------
- * pgstat_recv_tabstat() -
- *
- *	Count what the backend has done.
- * ----------
- */
-static void
-pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-	int			i;
-	bool		found;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	/*
-	 * Update database-wide stats.
-	 */
-	dbentry->n_xact_commit += (PgStat_Counter) (msg->m_xact_commit);
-	dbentry->n_xact_rollback += (PgStat_Counter) (msg->m_xact_rollback);
-	dbentry->n_block_read_time += msg->m_block_read_time;
-	dbentry->n_block_write_time += msg->m_block_write_time;
-
-	/*
-	 * Process all table entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		PgStat_TableEntry *tabmsg = &(msg->m_entry[i]);
-
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &(tabmsg->t_id),
-													   HASH_ENTER, &found);
-
-		if (!found)
-		{
-			/*
-			 * If it's a new table entry, initialize counters to the values we
-			 * just got.
-			 */
-			tabentry->numscans = tabmsg->t_counts.t_numscans;
-			tabentry->tuples_returned = tabmsg->t_counts.t_tuples_returned;
-			tabentry->tuples_fetched = tabmsg->t_counts.t_tuples_fetched;
-			tabentry->tuples_inserted = tabmsg->t_counts.t_tuples_inserted;
-			tabentry->tuples_updated = tabmsg->t_counts.t_tuples_updated;
-			tabentry->tuples_deleted = tabmsg->t_counts.t_tuples_deleted;
-			tabentry->tuples_hot_updated = tabmsg->t_counts.t_tuples_hot_updated;
-			tabentry->n_live_tuples = tabmsg->t_counts.t_delta_live_tuples;
-			tabentry->n_dead_tuples = tabmsg->t_counts.t_delta_dead_tuples;
-			tabentry->changes_since_analyze = tabmsg->t_counts.t_changed_tuples;
-			tabentry->inserts_since_vacuum = tabmsg->t_counts.t_tuples_inserted;
-			tabentry->blocks_fetched = tabmsg->t_counts.t_blocks_fetched;
-			tabentry->blocks_hit = tabmsg->t_counts.t_blocks_hit;
-
-			tabentry->vacuum_timestamp = 0;
-			tabentry->vacuum_count = 0;
-			tabentry->autovac_vacuum_timestamp = 0;
-			tabentry->autovac_vacuum_count = 0;
-			tabentry->analyze_timestamp = 0;
-			tabentry->analyze_count = 0;
-			tabentry->autovac_analyze_timestamp = 0;
-			tabentry->autovac_analyze_count = 0;
-		}
-		else
-		{
-			/*
-			 * Otherwise add the values to the existing entry.
-			 */
-			tabentry->numscans += tabmsg->t_counts.t_numscans;
-			tabentry->tuples_returned += tabmsg->t_counts.t_tuples_returned;
-			tabentry->tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
-			tabentry->tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
-			tabentry->tuples_updated += tabmsg->t_counts.t_tuples_updated;
-			tabentry->tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
-			tabentry->tuples_hot_updated += tabmsg->t_counts.t_tuples_hot_updated;
-			/* If table was truncated, first reset the live/dead counters */
-			if (tabmsg->t_counts.t_truncated)
-			{
-				tabentry->n_live_tuples = 0;
-				tabentry->n_dead_tuples = 0;
-				tabentry->inserts_since_vacuum = 0;
-			}
-			tabentry->n_live_tuples += tabmsg->t_counts.t_delta_live_tuples;
-			tabentry->n_dead_tuples += tabmsg->t_counts.t_delta_dead_tuples;
-			tabentry->changes_since_analyze += tabmsg->t_counts.t_changed_tuples;
-			tabentry->inserts_since_vacuum += tabmsg->t_counts.t_tuples_inserted;
-			tabentry->blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
-			tabentry->blocks_hit += tabmsg->t_counts.t_blocks_hit;
-		}
-
-		/* Clamp n_live_tuples in case of negative delta_live_tuples */
-		tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
-		/* Likewise for n_dead_tuples */
-		tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
-
-		/*
-		 * Add per-table stats to the per-database entry, too.
-		 */
-		dbentry->n_tuples_returned += tabmsg->t_counts.t_tuples_returned;
-		dbentry->n_tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
-		dbentry->n_tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
-		dbentry->n_tuples_updated += tabmsg->t_counts.t_tuples_updated;
-		dbentry->n_tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
-		dbentry->n_blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
-		dbentry->n_blocks_hit += tabmsg->t_counts.t_blocks_hit;
-	}
-}
-
-
-/* ----------
- * pgstat_recv_tabpurge() -
- *
- *	Arrange for dead table removal.
- * ----------
- */
-static void
-pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	int			i;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->tables)
-		return;
-
-	/*
-	 * Process all table entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->tables,
-						   (void *) &(msg->m_tableid[i]),
-						   HASH_REMOVE, NULL);
-	}
-}
-
-
-/* ----------
- * pgstat_recv_dropdb() -
- *
- *	Arrange for dead database removal
- * ----------
- */
-static void
-pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len)
-{
-	Oid			dbid = msg->m_databaseid;
-	PgStat_StatDBEntry *dbentry;
-
-	/*
-	 * Lookup the database in the hashtable.
-	 */
-	dbentry = pgstat_get_db_entry(dbid, false);
-
-	/*
-	 * If found, remove it (along with the db statfile).
-	 */
-	if (dbentry)
-	{
-		char		statfile[MAXPGPATH];
-
-		get_dbstat_filename(false, false, dbid, statfile, MAXPGPATH);
-
-		elog(DEBUG2, "removing stats file \"%s\"", statfile);
-		unlink(statfile);
-
-		if (dbentry->tables != NULL)
-			hash_destroy(dbentry->tables);
-		if (dbentry->functions != NULL)
-			hash_destroy(dbentry->functions);
-
-		if (hash_search(pgStatDBHash,
-						(void *) &dbid,
-						HASH_REMOVE, NULL) == NULL)
-			ereport(ERROR,
-					(errmsg("database hash table corrupted during cleanup --- abort")));
-	}
-}
-
-
-/* ----------
- * pgstat_recv_resetcounter() -
- *
- *	Reset the statistics for the specified database.
- * ----------
- */
-static void
-pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-
-	/*
-	 * Lookup the database in the hashtable.  Nothing to do if not there.
-	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	if (!dbentry)
+			 * >= its cutoff_time, it must be stale, so we can ignore it.
+			 */
+			return;
+		}
+	}
+	else if (msg->cutoff_time <= globalStats.stats_timestamp)
+	{
+		/* Stale request, ignore it */
 		return;
+	}
 
 	/*
-	 * We simply throw away all the database's table entries by recreating a
-	 * new hash table for them.
-	 */
-	if (dbentry->tables != NULL)
-		hash_destroy(dbentry->tables);
-	if (dbentry->functions != NULL)
-		hash_destroy(dbentry->functions);
-
-	dbentry->tables = NULL;
-	dbentry->functions = NULL;
-
-	/*
-	 * Reset database-level stats, too.  This creates empty hash tables for
-	 * tables and functions.
+	 * We need to write the stats file, so create a request.
 	 */
-	reset_dbentry_counters(dbentry);
+	pending_write_request = true;
 }
 
+
 /* ----------
  * pgstat_recv_resetsharedcounter() -
  *
@@ -6534,6 +6582,12 @@ pgstat_recv_resetsharedcounter(PgStat_MsgResetsharedcounter *msg, int len)
 		memset(&walStats, 0, sizeof(walStats));
 		walStats.stat_reset_timestamp = GetCurrentTimestamp();
 	}
+	else if (msg->m_resettarget == RESET_IO)
+	{
+		/* Reset the I/O statistics for the cluster. */
+		memset(&ioStats, 0, sizeof(ioStats));
+		ioStats.stat_reset_timestamp = GetCurrentTimestamp();
+	}
 
 	/*
 	 * Presumably the sender of this message validated the target, don't
@@ -6541,34 +6595,6 @@ pgstat_recv_resetsharedcounter(PgStat_MsgResetsharedcounter *msg, int len)
 	 */
 }
 
-/* ----------
- * pgstat_recv_resetsinglecounter() -
- *
- *	Reset a statistics for a single object
- * ----------
- */
-static void
-pgstat_recv_resetsinglecounter(PgStat_MsgResetsinglecounter *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	if (!dbentry)
-		return;
-
-	/* Set the reset timestamp for the whole database */
-	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
-
-	/* Remove object if it exists, ignore it if not */
-	if (msg->m_resettype == RESET_TABLE)
-		(void) hash_search(dbentry->tables, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
-	else if (msg->m_resettype == RESET_FUNCTION)
-		(void) hash_search(dbentry->functions, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
-}
-
 /* ----------
  * pgstat_recv_resetslrucounter() -
  *
@@ -6632,114 +6658,6 @@ pgstat_recv_resetreplslotcounter(PgStat_MsgResetreplslotcounter *msg,
 }
 
 
-/* ----------
- * pgstat_recv_autovac() -
- *
- *	Process an autovacuum signaling message.
- * ----------
- */
-static void
-pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-
-	/*
-	 * Store the last autovacuum time in the database's hashtable entry.
-	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	dbentry->last_autovac_time = msg->m_start_time;
-}
-
-/* ----------
- * pgstat_recv_vacuum() -
- *
- *	Process a VACUUM message.
- * ----------
- */
-static void
-pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-
-	/*
-	 * Store the data in the table's hashtable entry.
-	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
-
-	tabentry->n_live_tuples = msg->m_live_tuples;
-	tabentry->n_dead_tuples = msg->m_dead_tuples;
-
-	/*
-	 * It is quite possible that a non-aggressive VACUUM ended up skipping
-	 * various pages, however, we'll zero the insert counter here regardless.
-	 * It's currently used only to track when we need to perform an "insert"
-	 * autovacuum, which are mainly intended to freeze newly inserted tuples.
-	 * Zeroing this may just mean we'll not try to vacuum the table again
-	 * until enough tuples have been inserted to trigger another insert
-	 * autovacuum.  An anti-wraparound autovacuum will catch any persistent
-	 * stragglers.
-	 */
-	tabentry->inserts_since_vacuum = 0;
-
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->autovac_vacuum_count++;
-	}
-	else
-	{
-		tabentry->vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->vacuum_count++;
-	}
-}
-
-/* ----------
- * pgstat_recv_analyze() -
- *
- *	Process an ANALYZE message.
- * ----------
- */
-static void
-pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-
-	/*
-	 * Store the data in the table's hashtable entry.
-	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
-
-	tabentry->n_live_tuples = msg->m_live_tuples;
-	tabentry->n_dead_tuples = msg->m_dead_tuples;
-
-	/*
-	 * If commanded, reset changes_since_analyze to zero.  This forgets any
-	 * changes that were committed while the ANALYZE was in progress, but we
-	 * have no good way to estimate how many of those there were.
-	 */
-	if (msg->m_resetcounter)
-		tabentry->changes_since_analyze = 0;
-
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_analyze_timestamp = msg->m_analyzetime;
-		tabentry->autovac_analyze_count++;
-	}
-	else
-	{
-		tabentry->analyze_timestamp = msg->m_analyzetime;
-		tabentry->analyze_count++;
-	}
-}
-
-
 /* ----------
  * pgstat_recv_archiver() -
  *
@@ -6801,6 +6719,33 @@ pgstat_recv_wal(PgStat_MsgWal *msg, int len)
 	walStats.wal_fpi += msg->m_wal_fpi;
 	walStats.wal_bytes += msg->m_wal_bytes;
 	walStats.wal_buffers_full += msg->m_wal_buffers_full;
+	walStats.wal_flushes += msg->m_wal_flushes;
+	walStats.wal_flush_requests += msg->m_wal_flush_requests;
+}
+
+/* ----------
+ * pgstat_recv_walrecords() -
+ *
+ *	Process a per-record-type WAL message.
+ * ----------
+ */
+static void
+pgstat_recv_walrecords(PgStat_MsgWalRecords *msg, int len)
+{
+	for (int i = 0; i < msg->m_nentries; i++)
+	{
+		PgStat_WalRecordEntry *entry = &msg->m_entry[i];
+		PgStat_WalRecordCounters *counters;
+
+		if (entry->rmid > RM_MAX_ID || entry->type >= PGSTAT_WAL_RECORD_TYPES)
+			continue;
+
+		counters = &walStats.records[entry->rmid][entry->type];
+		counters->records += entry->counters.records;
+		counters->fpi += entry->counters.fpi;
+		counters->bytes += entry->counters.bytes;
+		counters->fpi_bytes += entry->counters.fpi_bytes;
+	}
 }
 
 /* ----------
@@ -6822,78 +6767,36 @@ pgstat_recv_slru(PgStat_MsgSLRU *msg, int len)
 }
 
 /* ----------
- * pgstat_recv_recoveryconflict() -
+ * pgstat_recv_io() -
  *
- *	Process a RECOVERYCONFLICT message.
+ *	Process an I/O message.
  * ----------
  */
 static void
-pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len)
+pgstat_recv_io(PgStat_MsgIO *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
+	PgStat_IOCounters (*counters)[IOCONTEXT_NUM_TYPES];
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	if ((int) msg->m_backend_type < 0 ||
+		(int) msg->m_backend_type >= BACKEND_NUM_TYPES)
+		return;
 
-	switch (msg->m_reason)
+	counters = ioStats.stats[msg->m_backend_type];
+	for (int obj = 0; obj < IOOBJECT_NUM_TYPES; obj++)
 	{
-		case PROCSIG_RECOVERY_CONFLICT_DATABASE:
-
-			/*
-			 * Since we drop the information about the database as soon as it
-			 * replicates, there is no point in counting these conflicts.
-			 */
-			break;
-		case PROCSIG_RECOVERY_CONFLICT_TABLESPACE:
-			dbentry->n_conflict_tablespace++;
-			break;
-		case PROCSIG_RECOVERY_CONFLICT_LOCK:
-			dbentry->n_conflict_lock++;
-			break;
-		case PROCSIG_RECOVERY_CONFLICT_SNAPSHOT:
-			dbentry->n_conflict_snapshot++;
-			break;
-		case PROCSIG_RECOVERY_CONFLICT_BUFFERPIN:
-			dbentry->n_conflict_bufferpin++;
-			break;
-		case PROCSIG_RECOVERY_CONFLICT_STARTUP_DEADLOCK:
-			dbentry->n_conflict_startup_deadlock++;
-			break;
+		for (int ctx = 0; ctx < IOCONTEXT_NUM_TYPES; ctx++)
+		{
+			for (int op = 0; op < IOOP_NUM_TYPES; op++)
+			{
+				counters[obj][ctx].counts[op] +=
+					msg->m_counters[obj][ctx].counts[op];
+				counters[obj][ctx].times[op] +=
+					msg->m_counters[obj][ctx].times[op];
+			}
+		}
 	}
 }
 
-/* ----------
- * pgstat_recv_deadlock() -
- *
- *	Process a DEADLOCK message.
- * ----------
- */
-static void
-pgstat_recv_deadlock(PgStat_MsgDeadlock *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	dbentry->n_deadlocks++;
-}
-
-/* ----------
- * pgstat_recv_checksum_failure() -
- *
- *	Process a CHECKSUMFAILURE message.
- * ----------
- */
-static void
-pgstat_recv_checksum_failure(PgStat_MsgChecksumFailure *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	dbentry->n_checksum_failures += msg->m_failurecount;
-	dbentry->last_checksum_failure = msg->m_failure_time;
-}
-
 /* ----------
  * pgstat_recv_replslot() -
  *
@@ -6944,103 +6847,6 @@ pgstat_recv_replslot(PgStat_MsgReplSlot *msg, int len)
 	}
 }
 
-/* ----------
- * pgstat_recv_tempfile() -
- *
- *	Process a TEMPFILE message.
- * ----------
- */
-static void
-pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	dbentry->n_temp_bytes += msg->m_filesize;
-	dbentry->n_temp_files += 1;
-}
-
-/* ----------
- * pgstat_recv_funcstat() -
- *
- *	Count what the backend has done.
- * ----------
- */
-static void
-pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len)
-{
-	PgStat_FunctionEntry *funcmsg = &(msg->m_entry[0]);
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatFuncEntry *funcentry;
-	int			i;
-	bool		found;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	/*
-	 * Process all function entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++, funcmsg++)
-	{
-		funcentry = (PgStat_StatFuncEntry *) hash_search(dbentry->functions,
-														 (void *) &(funcmsg->f_id),
-														 HASH_ENTER, &found);
-
-		if (!found)
-		{
-			/*
-			 * If it's a new function entry, initialize counters to the values
-			 * we just got.
-			 */
-			funcentry->f_numcalls = funcmsg->f_numcalls;
-			funcentry->f_total_time = funcmsg->f_total_time;
-			funcentry->f_self_time = funcmsg->f_self_time;
-		}
-		else
-		{
-			/*
-			 * Otherwise add the values to the existing entry.
-			 */
-			funcentry->f_numcalls += funcmsg->f_numcalls;
-			funcentry->f_total_time += funcmsg->f_total_time;
-			funcentry->f_self_time += funcmsg->f_self_time;
-		}
-	}
-}
-
-/* ----------
- * pgstat_recv_funcpurge() -
- *
- *	Arrange for dead function removal.
- * ----------
- */
-static void
-pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	int			i;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->functions)
-		return;
-
-	/*
-	 * Process all function entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->functions,
-						   (void *) &(msg->m_functionid[i]),
-						   HASH_REMOVE, NULL);
-	}
-}
-
 /* ----------
  * pgstat_write_statsfile_needed() -
  *
@@ -7050,36 +6856,7 @@ pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len)
 static bool
 pgstat_write_statsfile_needed(void)
 {
-	if (pending_write_requests != NIL)
-		return true;
-
-	/* Everything was written recently */
-	return false;
-}
-
-/* ----------
- * pgstat_db_requested() -
- *
- *	Checks whether stats for a particular DB need to be written to a file.
- * ----------
- */
-static bool
-pgstat_db_requested(Oid databaseid)
-{
-	/*
-	 * If any requests are outstanding at all, we should write the stats for
-	 * shared catalogs (the "database" with OID 0).  This ensures that
-	 * backends will see up-to-date stats for shared catalogs, even though
-	 * they send inquiry messages mentioning only their own DB.
-	 */
-	if (databaseid == InvalidOid && pending_write_requests != NIL)
-		return true;
-
-	/* Search to see if there's an open request to write this database. */
-	if (list_member_oid(pending_write_requests, databaseid))
-		return true;
-
-	return false;
+	return pending_write_request;
 }
 
 /*
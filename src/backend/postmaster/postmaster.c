@@ -99,7 +99,9 @@
 #include "catalog/pg_control.h"
 #include "common/file_perm.h"
 #include "common/ip.h"
+#include "common/protocol_compression.h"
 #include "common/string.h"
+#include "executor/instrument.h"
 #include "lib/ilist.h"
 #include "libpq/auth.h"
 #include "libpq/libpq.h"
@@ -114,7 +116,9 @@
 #include "postmaster/interrupt.h"
 #include "postmaster/pgarch.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
 #include "postmaster/syslogger.h"
+#include "postmaster/waitsampler.h"
 #include "replication/logicallauncher.h"
 #include "replication/walsender.h"
 #include "storage/fd.h"
@@ -182,6 +186,9 @@ typedef struct bkend
 	int			bkend_type;		/* child process flavor, see above */
 	bool		dead_end;		/* is it going to send an error and quit? */
 	bool		bgworker_notify;	/* gets bgworker start/stop notifications */
+	pgsocket	prefork_channel;	/* channel to it while it's an idle
+									 * pre-forked backend, else
+									 * PGINVALID_SOCKET */
 	dlist_node	elem;			/* list link in BackendList */
 } Backend;
 
@@ -215,9 +222,29 @@ char	   *ListenAddresses;
  */
 int			ReservedBackends;
 
+/*
+ * Number of backends to fork ahead of time, so that an incoming connection
+ * can be handed to one that is ready and waiting.
+ */
+int			PreforkBackends = 0;
+
+/* Number of pre-forked backends still waiting for a connection */
+static int	PreforkedIdleCount = 0;
+
 /* The socket(s) we're listening to. */
-#define MAXLISTEN	64
 static pgsocket ListenSocket[MAXLISTEN];
+
+/*
+ * The sockets the connection proxies listen on, and our ends of the channels
+ * they use to ask us for new backends.  MyProxyIndex is set in a proxy
+ * process, to tell ClosePostmasterPorts what to keep open.
+ */
+static pgsocket ProxyListenSocket[MAXLISTEN];
+static pgsocket ProxyChannel[MAX_CONNECTION_PROXIES];
+static int	MyProxyIndex = -1;
+
+/* Set when ProxyChannel changes, so ServerLoop rebuilds its select mask */
+static bool ProxyChannelsChanged = false;
 /*
  * These globals control the behavior of the postmaster in case some
  * backend dumps core.  Normally, it kills all peers of the dead backend
@@ -253,6 +280,9 @@ static pid_t StartupPID = 0,
 			PgStatPID = 0,
 			SysLoggerPID = 0;
 
+/* PIDs of connection proxies; 0 when not running */
+static pid_t ProxyPID[MAX_CONNECTION_PROXIES];
+
 /* Startup process's status */
 typedef enum
 {
@@ -392,8 +422,19 @@ static void CloseServerPorts(int status, Datum arg);
 static void unlink_external_pid_file(int status, Datum arg);
 static void getInstallationPaths(const char *argv0);
 static void checkControlFile(void);
+static Port *ConnAlloc(void);
 static Port *ConnCreate(int serverFd);
 static void ConnFree(Port *port);
+static void CreateProxyListenSockets(void);
+static pid_t StartConnectionProxy(int proxyIndex);
+static void StartProxiedBackend(int proxyIndex);
+static void MaintainPreforkedBackends(void);
+static bool StartPreforkedBackend(void);
+static bool AssignPreforkedBackend(Port *port);
+static void ClosePreforkChannel(Backend *bp);
+#ifndef EXEC_BACKEND
+static void PreforkedBackendMain(pgsocket channel) pg_attribute_noreturn();
+#endif
 static void reset_shared(void);
 static void SIGHUP_handler(SIGNAL_ARGS);
 static void pmdie(SIGNAL_ARGS);
@@ -433,6 +474,8 @@ static bool CreateOptsFile(int argc, char *argv[], char *fullprogname);
 static pid_t StartChildProcess(AuxProcType type);
 static void StartAutovacuumWorker(void);
 static void MaybeStartWalReceiver(void);
+static bool CleanupConnectionProxy(int pid, int exitstatus);
+static void SignalConnectionProxies(int signal);
 static void InitPostmasterDeathWatchHandle(void);
 
 /*
@@ -520,6 +563,10 @@ typedef struct
 	bool		IsBinaryUpgrade;
 	int			max_safe_fds;
 	int			MaxBackends;
+	int			FastPathLockGroupsPerBackend;
+	bool		pg_cycle_counter_in_use;
+	int64		pg_cycle_counter_base;
+	double		pg_cycle_counter_ns_per_cycle;
 #ifdef WIN32
 	HANDLE		PostmasterHandle;
 	HANDLE		initial_signal_pipe;
@@ -981,6 +1028,9 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	ApplyLauncherRegister();
 
+	/* Likewise for the wait event sampler */
+	WaitSamplerRegister();
+
 	/*
 	 * process any libraries that should be preloaded at postmaster start
 	 */
@@ -1003,6 +1053,18 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	InitializeMaxBackends();
 
+	/*
+	 * Also calculate the size of the fast-path lock arrays, now that
+	 * max_locks_per_transaction can no longer change.
+	 */
+	InitializeFastPathLocks();
+
+	/*
+	 * Calibrate the CPU cycle counter used for timing, if enabled.  Children
+	 * inherit the result, so that it's done only once.
+	 */
+	InstrInitClockSource();
+
 	/*
 	 * Set up shared memory and semaphores.
 	 */
@@ -1119,7 +1181,12 @@ PostmasterMain(int argc, char *argv[])
 	 * charged with closing the sockets again at postmaster shutdown.
 	 */
 	for (i = 0; i < MAXLISTEN; i++)
+	{
 		ListenSocket[i] = PGINVALID_SOCKET;
+		ProxyListenSocket[i] = PGINVALID_SOCKET;
+	}
+	for (i = 0; i < MAX_CONNECTION_PROXIES; i++)
+		ProxyChannel[i] = PGINVALID_SOCKET;
 
 	on_proc_exit(CloseServerPorts, 0);
 
@@ -1280,6 +1347,20 @@ PostmasterMain(int argc, char *argv[])
 		ereport(FATAL,
 				(errmsg("no socket created for listening")));
 
+	/*
+	 * Connection proxies get sockets of their own, on the same addresses.
+	 * They are started once we reach normal running, in ServerLoop.
+	 */
+	if (ConnectionProxies > 0)
+	{
+#ifdef EXEC_BACKEND
+		ereport(FATAL,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("connection proxies are not supported on this platform")));
+#endif
+		CreateProxyListenSockets();
+	}
+
 	/*
 	 * If no valid TCP ports, write an empty line for listen address,
 	 * indicating the Unix socket must be used.  Note that this line is not
@@ -1430,6 +1511,11 @@ CloseServerPorts(int status, Datum arg)
 			StreamClose(ListenSocket[i]);
 			ListenSocket[i] = PGINVALID_SOCKET;
 		}
+		if (ProxyListenSocket[i] != PGINVALID_SOCKET)
+		{
+			StreamClose(ProxyListenSocket[i]);
+			ProxyListenSocket[i] = PGINVALID_SOCKET;
+		}
 	}
 
 	/*
@@ -1669,6 +1755,12 @@ ServerLoop(void)
 		 * If we are in PM_WAIT_DEAD_END state, then we don't want to accept
 		 * any new connections, so we don't call select(), and just sleep.
 		 */
+		if (ProxyChannelsChanged)
+		{
+			nSockets = initMasks(&readmask);
+			ProxyChannelsChanged = false;
+		}
+
 		memcpy((char *) &rmask, (char *) &readmask, sizeof(fd_set));
 
 		if (pmState == PM_WAIT_DEAD_END)
@@ -1726,7 +1818,8 @@ ServerLoop(void)
 					port = ConnCreate(ListenSocket[i]);
 					if (port)
 					{
-						BackendStartup(port);
+						if (!AssignPreforkedBackend(port))
+							BackendStartup(port);
 
 						/*
 						 * We no longer need the open socket or port structure
@@ -1737,6 +1830,14 @@ ServerLoop(void)
 					}
 				}
 			}
+
+			/* Connection proxies asking for backends? */
+			for (i = 0; i < ConnectionProxies; i++)
+			{
+				if (ProxyChannel[i] != PGINVALID_SOCKET &&
+					FD_ISSET(ProxyChannel[i], &rmask))
+					StartProxiedBackend(i);
+			}
 		}
 
 		/* If we have lost the log collector, try to start a new one */
@@ -1789,6 +1890,22 @@ ServerLoop(void)
 		if (PgArchPID == 0 && PgArchStartupAllowed())
 			PgArchPID = pgarch_start();
 
+		/* Likewise for the connection proxies */
+		if ((pmState == PM_RUN || pmState == PM_HOT_STANDBY) &&
+			Shutdown == NoShutdown)
+		{
+			int			i;
+
+			for (i = 0; i < ConnectionProxies; i++)
+			{
+				if (ProxyPID[i] == 0)
+					ProxyPID[i] = StartConnectionProxy(i);
+			}
+		}
+
+		/* Top up, or trim, the supply of pre-forked backends */
+		MaintainPreforkedBackends();
+
 		/* If we need to signal the autovacuum launcher, do so now */
 		if (avlauncher_needs_signal)
 		{
@@ -1903,6 +2020,18 @@ initMasks(fd_set *rmask)
 			maxsock = fd;
 	}
 
+	for (i = 0; i < MAX_CONNECTION_PROXIES; i++)
+	{
+		int			fd = ProxyChannel[i];
+
+		if (fd == PGINVALID_SOCKET)
+			continue;
+		FD_SET(fd, rmask);
+
+		if (fd > maxsock)
+			maxsock = fd;
+	}
+
 	return maxsock + 1;
 }
 
@@ -2162,12 +2291,14 @@ retry1:
 									valptr),
 							 errhint("Valid values are: \"false\", 0, \"true\", 1, \"database\".")));
 			}
+			else if (strcmp(nameptr, PQ_COMPRESSION_OPTION) == 0)
+				port->compression_methods = pstrdup(valptr);
 			else if (strncmp(nameptr, "_pq_.", 5) == 0)
 			{
 				/*
 				 * Any option beginning with _pq_. is reserved for use as a
-				 * protocol-level option, but at present no such options are
-				 * defined.
+				 * protocol-level option; tell the client about the ones we
+				 * don't know.
 				 */
 				unrecognized_protocol_options =
 					lappend(unrecognized_protocol_options, pstrdup(nameptr));
@@ -2494,12 +2625,12 @@ canAcceptConnections(int backend_type)
 
 
 /*
- * ConnCreate -- create a local connection data structure
+ * ConnAlloc -- allocate an empty local connection data structure
  *
- * Returns NULL on failure, other than out-of-memory which is fatal.
+ * Out-of-memory is fatal.
  */
 static Port *
-ConnCreate(int serverFd)
+ConnAlloc(void)
 {
 	Port	   *port;
 
@@ -2510,14 +2641,7 @@ ConnCreate(int serverFd)
 				 errmsg("out of memory")));
 		ExitPostmaster(1);
 	}
-
-	if (StreamConnection(serverFd, port) != STATUS_OK)
-	{
-		if (port->sock != PGINVALID_SOCKET)
-			StreamClose(port->sock);
-		ConnFree(port);
-		return NULL;
-	}
+	port->sock = PGINVALID_SOCKET;
 
 	/*
 	 * Allocate GSSAPI specific state struct
@@ -2538,6 +2662,27 @@ ConnCreate(int serverFd)
 	return port;
 }
 
+/*
+ * ConnCreate -- create a local connection data structure
+ *
+ * Returns NULL on failure, other than out-of-memory which is fatal.
+ */
+static Port *
+ConnCreate(int serverFd)
+{
+	Port	   *port = ConnAlloc();
+
+	if (StreamConnection(serverFd, port) != STATUS_OK)
+	{
+		if (port->sock != PGINVALID_SOCKET)
+			StreamClose(port->sock);
+		ConnFree(port);
+		return NULL;
+	}
+
+	return port;
+}
+
 
 /*
  * ConnFree -- free a local connection data structure
@@ -2568,6 +2713,7 @@ void
 ClosePostmasterPorts(bool am_syslogger)
 {
 	int			i;
+	dlist_iter	iter;
 
 #ifndef WIN32
 
@@ -2598,6 +2744,42 @@ ClosePostmasterPorts(bool am_syslogger)
 		}
 	}
 
+	/*
+	 * Likewise the connection proxies' sockets, except that a proxy keeps the
+	 * listen sockets.  Its own end of its channel was never in ProxyChannel.
+	 */
+	if (MyProxyIndex < 0)
+	{
+		for (i = 0; i < MAXLISTEN; i++)
+		{
+			if (ProxyListenSocket[i] != PGINVALID_SOCKET)
+			{
+				StreamClose(ProxyListenSocket[i]);
+				ProxyListenSocket[i] = PGINVALID_SOCKET;
+			}
+		}
+	}
+	for (i = 0; i < MAX_CONNECTION_PROXIES; i++)
+	{
+		if (ProxyChannel[i] != PGINVALID_SOCKET)
+		{
+			StreamClose(ProxyChannel[i]);
+			ProxyChannel[i] = PGINVALID_SOCKET;
+		}
+	}
+
+	/* And the channels to idle pre-forked backends */
+	dlist_foreach(iter, &BackendList)
+	{
+		Backend    *bp = dlist_container(Backend, elem, iter.cur);
+
+		if (bp->prefork_channel != PGINVALID_SOCKET)
+		{
+			StreamClose(bp->prefork_channel);
+			bp->prefork_channel = PGINVALID_SOCKET;
+		}
+	}
+
 	/*
 	 * If using syslogger, close the read side of the pipe.  We don't bother
 	 * tracking this in fd.c, either.
@@ -2799,6 +2981,9 @@ pmdie(SIGNAL_ARGS)
 			sd_notify(0, "STOPPING=1");
 #endif
 
+			/* Let the connection proxies finish with their clients */
+			SignalConnectionProxies(SIGTERM);
+
 			/*
 			 * If we reached normal running, we have to wait for any online
 			 * backup mode to end; otherwise go straight to waiting for client
@@ -2845,6 +3030,9 @@ pmdie(SIGNAL_ARGS)
 			sd_notify(0, "STOPPING=1");
 #endif
 
+			/* The connection proxies just drop their clients */
+			SignalConnectionProxies(SIGINT);
+
 			if (pmState == PM_STARTUP || pmState == PM_RECOVERY)
 			{
 				/* Just shut down background processes silently */
@@ -3221,6 +3409,14 @@ reaper(SIGNAL_ARGS)
 			continue;
 		}
 
+		/*
+		 * Was it a connection proxy?  It doesn't touch shared memory, so
+		 * there's no need for a crash restart; ServerLoop will start a new
+		 * one.
+		 */
+		if (CleanupConnectionProxy(pid, exitstatus))
+			continue;
+
 		/* Was it one of our background workers? */
 		if (CleanupBackgroundWorker(pid, exitstatus))
 		{
@@ -3428,6 +3624,7 @@ CleanupBackend(int pid,
 				 */
 				BackgroundWorkerStopNotifications(bp->pid);
 			}
+			ClosePreforkChannel(bp);
 			dlist_delete(iter.cur);
 			free(bp);
 			break;
@@ -3531,6 +3728,7 @@ HandleChildCrash(int pid, int exitstatus, const char *procname)
 				ShmemBackendArrayRemove(bp);
 #endif
 			}
+			ClosePreforkChannel(bp);
 			dlist_delete(iter.cur);
 			free(bp);
 			/* Keep looping so we can signal remaining backends */
@@ -4131,6 +4329,7 @@ TerminateChildren(int signal)
 		signal_child(PgArchPID, signal);
 	if (PgStatPID != 0)
 		signal_child(PgStatPID, signal);
+	SignalConnectionProxies(signal);
 }
 
 /*
@@ -4190,6 +4389,7 @@ BackendStartup(Port *port)
 
 	/* Hasn't asked to be notified about any bgworkers yet */
 	bn->bgworker_notify = false;
+	bn->prefork_channel = PGINVALID_SOCKET;
 
 #ifdef EXEC_BACKEND
 	pid = backend_forkexec(port);
@@ -5564,6 +5764,7 @@ StartAutovacuumWorker(void)
 			bn->dead_end = false;
 			bn->child_slot = MyPMChildSlot = AssignPostmasterChildSlot();
 			bn->bgworker_notify = false;
+			bn->prefork_channel = PGINVALID_SOCKET;
 
 			bn->pid = StartAutoVacWorker();
 			if (bn->pid > 0)
@@ -5634,6 +5835,545 @@ MaybeStartWalReceiver(void)
 }
 
 
+/*
+ * CreateProxyListenSockets -- open the connection proxies' listen sockets
+ *
+ * The proxies listen on proxy_port, on the same addresses and in the same
+ * socket directories as the postmaster itself.  All of them accept on the
+ * same sockets.
+ */
+static void
+CreateProxyListenSockets(void)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *l;
+
+	if (ListenAddresses)
+	{
+		/* The syntax was checked when creating our own sockets */
+		rawstring = pstrdup(ListenAddresses);
+		(void) SplitGUCList(rawstring, ',', &elemlist);
+
+		foreach(l, elemlist)
+		{
+			char	   *curhost = (char *) lfirst(l);
+			int			status;
+
+			status = StreamServerPort(AF_UNSPEC,
+									  strcmp(curhost, "*") == 0 ? NULL : curhost,
+									  (unsigned short) ProxyPortNumber,
+									  NULL,
+									  ProxyListenSocket, MAXLISTEN);
+			if (status != STATUS_OK)
+				ereport(WARNING,
+						(errmsg("could not create connection proxy listen socket for \"%s\"",
+								curhost)));
+		}
+
+		list_free(elemlist);
+		pfree(rawstring);
+	}
+
+#ifdef HAVE_UNIX_SOCKETS
+	if (Unix_socket_directories)
+	{
+		rawstring = pstrdup(Unix_socket_directories);
+		(void) SplitDirectoriesString(rawstring, ',', &elemlist);
+
+		foreach(l, elemlist)
+		{
+			char	   *socketdir = (char *) lfirst(l);
+			int			status;
+
+			status = StreamServerPort(AF_UNIX, NULL,
+									  (unsigned short) ProxyPortNumber,
+									  socketdir,
+									  ProxyListenSocket, MAXLISTEN);
+			if (status != STATUS_OK)
+				ereport(WARNING,
+						(errmsg("could not create connection proxy Unix-domain socket in directory \"%s\"",
+								socketdir)));
+		}
+
+		list_free_deep(elemlist);
+		pfree(rawstring);
+	}
+#endif
+
+	if (ProxyListenSocket[0] == PGINVALID_SOCKET)
+		ereport(FATAL,
+				(errmsg("no socket created for connection proxies")));
+}
+
+/*
+ * StartConnectionProxy -- start a connection proxy process
+ *
+ * Each proxy gets a socket pair, over which it passes us the sockets for the
+ * backends it wants started; see StartProxiedBackend.
+ *
+ * Returns the proxy's PID, or 0 if it couldn't be started.
+ */
+static pid_t
+StartConnectionProxy(int proxyIndex)
+{
+#ifndef EXEC_BACKEND
+	pgsocket	channel[2];
+	pid_t		pid;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, channel) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not create channel for connection proxy: %m")));
+		return 0;
+	}
+	if (!pg_set_noblock(channel[0]))
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not set socket to nonblocking mode: %m")));
+		closesocket(channel[0]);
+		closesocket(channel[1]);
+		return 0;
+	}
+
+	switch ((pid = fork_process()))
+	{
+		case -1:
+			ereport(LOG,
+					(errmsg("could not fork connection proxy: %m")));
+			closesocket(channel[0]);
+			closesocket(channel[1]);
+			return 0;
+
+		case 0:
+			/* in postmaster child ... */
+			InitPostmasterChild();
+
+			/* Close the postmaster's sockets, but keep the proxies' */
+			MyProxyIndex = proxyIndex;
+			ClosePostmasterPorts(false);
+			closesocket(channel[0]);
+
+			/* Drop our connection to postmaster's shared memory, as well */
+			dsm_detach_all();
+			PGSharedMemoryDetach();
+
+			ConnectionProxyMain(proxyIndex, ProxyListenSocket, channel[1]);
+			break;
+
+		default:
+			closesocket(channel[1]);
+			ProxyChannel[proxyIndex] = channel[0];
+			ProxyChannelsChanged = true;
+			return pid;
+	}
+
+	/* shouldn't get here */
+	return 0;
+#else
+	/* PostmasterMain refuses to run with connection proxies */
+	return 0;
+#endif
+}
+
+/*
+ * StartProxiedBackend -- start a backend for a connection proxy
+ *
+ * The proxy sends us one end of a socket pair, which becomes the new
+ * backend's client connection.  The backend skips authentication of the
+ * proxy itself; each client is authenticated when the proxy hands it over.
+ */
+static void
+StartProxiedBackend(int proxyIndex)
+{
+	pgsocket	sock;
+	Port	   *port;
+
+	sock = StreamReceiveSocket(ProxyChannel[proxyIndex], NULL, 0);
+	if (sock == PGINVALID_SOCKET)
+	{
+		/*
+		 * The proxy has exited, or we lost sync with it.  Either way, stop
+		 * listening; the channel is replaced when the proxy is restarted.
+		 */
+		StreamClose(ProxyChannel[proxyIndex]);
+		ProxyChannel[proxyIndex] = PGINVALID_SOCKET;
+		ProxyChannelsChanged = true;
+		return;
+	}
+
+	port = ConnAlloc();
+	port->sock = sock;
+	port->proxied = true;
+
+	/* Both ends of a socket pair are unnamed, so one lookup will do */
+	port->laddr.salen = sizeof(port->laddr.addr);
+	if (getsockname(sock,
+					(struct sockaddr *) &port->laddr.addr,
+					&port->laddr.salen) < 0)
+	{
+		ereport(LOG,
+				(errmsg("getsockname() failed: %m")));
+		StreamClose(sock);
+		ConnFree(port);
+		return;
+	}
+	port->raddr = port->laddr;
+
+	BackendStartup(port);
+
+	/* We no longer need the open socket or port structure in this process */
+	StreamClose(port->sock);
+	ConnFree(port);
+}
+
+/*
+ * CleanupConnectionProxy -- handle the exit of a child that may be a
+ * connection proxy
+ *
+ * Returns true if it was one.
+ */
+static bool
+CleanupConnectionProxy(int pid, int exitstatus)
+{
+	int			i;
+
+	for (i = 0; i < MAX_CONNECTION_PROXIES; i++)
+	{
+		if (ProxyPID[i] != pid)
+			continue;
+
+		ProxyPID[i] = 0;
+		if (ProxyChannel[i] != PGINVALID_SOCKET)
+		{
+			StreamClose(ProxyChannel[i]);
+			ProxyChannel[i] = PGINVALID_SOCKET;
+			ProxyChannelsChanged = true;
+		}
+		if (!EXIT_STATUS_0(exitstatus))
+			LogChildExit(LOG, _("connection proxy"), pid, exitstatus);
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * SignalConnectionProxies -- send a signal to all running connection proxies
+ */
+static void
+SignalConnectionProxies(int signal)
+{
+	int			i;
+
+	for (i = 0; i < MAX_CONNECTION_PROXIES; i++)
+	{
+		if (ProxyPID[i] != 0)
+			signal_child(ProxyPID[i], signal);
+	}
+}
+
+
+/*
+ * MaintainPreforkedBackends -- keep prefork_backends idle backends ready
+ *
+ * We only keep them while normal connections are being accepted.  Surplus
+ * ones, say after the setting was lowered or when shutdown begins, are
+ * dismissed by closing their channels.
+ */
+static void
+MaintainPreforkedBackends(void)
+{
+	int			target = 0;
+	dlist_iter	iter;
+
+	if (PreforkBackends == 0 && PreforkedIdleCount == 0)
+		return;
+
+	if (Shutdown == NoShutdown && !FatalError &&
+		canAcceptConnections(BACKEND_TYPE_NORMAL) == CAC_OK)
+		target = PreforkBackends;
+
+	/* Recheck each time, so as not to run out of child slots */
+	while (PreforkedIdleCount < target &&
+		   canAcceptConnections(BACKEND_TYPE_NORMAL) == CAC_OK)
+	{
+		if (!StartPreforkedBackend())
+			break;
+	}
+
+	if (PreforkedIdleCount > target)
+	{
+		dlist_foreach(iter, &BackendList)
+		{
+			Backend    *bp = dlist_container(Backend, elem, iter.cur);
+
+			ClosePreforkChannel(bp);
+			if (PreforkedIdleCount <= target)
+				break;
+		}
+	}
+}
+
+/*
+ * StartPreforkedBackend -- fork a backend ahead of its connection
+ *
+ * The child does the part of a backend's startup that doesn't depend on the
+ * client, then waits for the postmaster to pass it a connection; see
+ * AssignPreforkedBackend.  It takes up a child slot and counts as a regular
+ * backend all along.
+ *
+ * Returns false if we couldn't start one.
+ */
+static bool
+StartPreforkedBackend(void)
+{
+#ifndef EXEC_BACKEND
+	Backend    *bn;
+	pgsocket	channel[2];
+	pid_t		pid;
+
+	bn = (Backend *) malloc(sizeof(Backend));
+	if (!bn)
+	{
+		ereport(LOG,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+		return false;
+	}
+
+	if (!RandomCancelKey(&MyCancelKey))
+	{
+		free(bn);
+		ereport(LOG,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not generate random cancel key")));
+		return false;
+	}
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, channel) < 0)
+	{
+		free(bn);
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not create channel for pre-forked backend: %m")));
+		return false;
+	}
+
+	bn->cancel_key = MyCancelKey;
+	bn->dead_end = false;
+	bn->child_slot = MyPMChildSlot = AssignPostmasterChildSlot();
+	bn->bgworker_notify = false;
+
+	pid = fork_process();
+	if (pid == 0)				/* child */
+	{
+		free(bn);
+
+		/* Detangle from postmaster */
+		InitPostmasterChild();
+
+		/* Close the postmaster's sockets, and its end of our channel */
+		ClosePostmasterPorts(false);
+		closesocket(channel[0]);
+
+		PreforkedBackendMain(channel[1]);
+	}
+
+	closesocket(channel[1]);
+
+	if (pid < 0)
+	{
+		/* in parent, fork failed */
+		int			save_errno = errno;
+
+		closesocket(channel[0]);
+		(void) ReleasePostmasterChildSlot(bn->child_slot);
+		free(bn);
+		errno = save_errno;
+		ereport(LOG,
+				(errmsg("could not fork pre-forked backend process: %m")));
+		return false;
+	}
+
+	/* in parent, successful fork */
+	ereport(DEBUG2,
+			(errmsg_internal("forked new pre-forked backend, pid=%d",
+							 (int) pid)));
+
+	bn->pid = pid;
+	bn->bkend_type = BACKEND_TYPE_NORMAL;	/* Can change later to WALSND */
+	bn->prefork_channel = channel[0];
+	dlist_push_head(&BackendList, &bn->elem);
+	PreforkedIdleCount++;
+
+	return true;
+#else
+	/* check_prefork_backends doesn't allow any here */
+	return false;
+#endif
+}
+
+/*
+ * AssignPreforkedBackend -- hand a new connection to a pre-forked backend
+ *
+ * We pass the backend the client's socket, along with the Port we've set up
+ * for it.  Returns false if there was no backend to take it, in which case
+ * the caller should fork one as usual.  Connections that are going to be
+ * refused are left to BackendStartup as well.
+ */
+static bool
+AssignPreforkedBackend(Port *port)
+{
+	dlist_iter	iter;
+	CAC_state	cac;
+
+	if (PreforkedIdleCount == 0)
+		return false;
+
+	cac = canAcceptConnections(BACKEND_TYPE_NORMAL);
+	if (cac != CAC_OK && cac != CAC_SUPERUSER)
+		return false;
+	port->canAcceptConnections = cac;
+
+	dlist_foreach(iter, &BackendList)
+	{
+		Backend    *bp = dlist_container(Backend, elem, iter.cur);
+		bool		sent;
+
+		if (bp->prefork_channel == PGINVALID_SOCKET)
+			continue;
+
+		sent = StreamSendSocket(bp->prefork_channel, port->sock,
+								port, sizeof(Port));
+
+		/*
+		 * Either way, this one won't wait for a connection anymore.  If it
+		 * didn't get this one, it's on its way out; try the next.
+		 */
+		ClosePreforkChannel(bp);
+
+		if (sent)
+		{
+			ereport(DEBUG2,
+					(errmsg_internal("passed connection to pre-forked backend, pid=%d socket=%d",
+									 (int) bp->pid, (int) port->sock)));
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * ClosePreforkChannel -- forget that bp is an idle pre-forked backend
+ *
+ * If it hasn't been passed a connection yet, closing the channel makes it
+ * exit.
+ */
+static void
+ClosePreforkChannel(Backend *bp)
+{
+	if (bp->prefork_channel == PGINVALID_SOCKET)
+		return;
+
+	StreamClose(bp->prefork_channel);
+	bp->prefork_channel = PGINVALID_SOCKET;
+	PreforkedIdleCount--;
+}
+
+#ifndef EXEC_BACKEND
+/*
+ * PreforkedBackendMain -- wait in a pre-forked backend for its connection
+ *
+ * Runs in the child.  We exit quietly if the postmaster dismisses us;
+ * otherwise, we carry on like a backend that was forked for the connection.
+ */
+static void
+PreforkedBackendMain(pgsocket channel)
+{
+	Port	   *port;
+	pgsocket	sock;
+
+	/*
+	 * Replace the postmaster's signal handlers.  We keep up with reloads, so
+	 * that the backend starts with the same settings as a freshly forked one
+	 * would.  SIGQUIT was already set up by InitPostmasterChild.
+	 */
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGINT, SIG_IGN);
+	pqsignal(SIGTERM, SignalHandlerForShutdownRequest);
+	pqsignal(SIGALRM, SIG_IGN);
+	pqsignal(SIGPIPE, SIG_IGN);
+	pqsignal(SIGUSR1, SIG_IGN);
+	pqsignal(SIGUSR2, SIG_IGN);
+	pqsignal(SIGCHLD, SIG_DFL);
+	PG_SETMASK(&UnBlockSig);
+
+	for (;;)
+	{
+		int			rc;
+
+		if (ShutdownRequestPending)
+			proc_exit(0);
+
+		if (ConfigReloadPending)
+		{
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		rc = WaitLatchOrSocket(MyLatch,
+							   WL_LATCH_SET | WL_SOCKET_READABLE |
+							   WL_EXIT_ON_PM_DEATH,
+							   channel, -1L,
+							   WAIT_EVENT_PREFORKED_BACKEND_IDLE);
+		if (rc & WL_LATCH_SET)
+			ResetLatch(MyLatch);
+		if (rc & WL_SOCKET_READABLE)
+			break;
+	}
+
+	/* BackendInitialize sets up signal handling for what follows */
+	PG_SETMASK(&BlockSig);
+
+	port = (Port *) malloc(sizeof(Port));
+	if (!port)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+
+	sock = StreamReceiveSocket(channel, port, sizeof(Port));
+	if (sock == PGINVALID_SOCKET)
+		proc_exit(0);			/* dismissed */
+	closesocket(channel);
+
+	/* The pointers in the Port are the postmaster's; only gss was set */
+	port->sock = sock;
+	port->gss = NULL;
+#if defined(ENABLE_GSS) || defined(ENABLE_SSPI)
+	port->gss = (pg_gssinfo *) calloc(1, sizeof(pg_gssinfo));
+	if (!port->gss)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+#endif
+
+	/* As far as anyone can tell, this backend starts now */
+	MyStartTimestamp = GetCurrentTimestamp();
+	MyStartTime = timestamptz_to_time_t(MyStartTimestamp);
+
+	/* Perform additional initialization and collect startup packet */
+	BackendInitialize(port);
+
+	/* And run the backend */
+	BackendRun(port);
+}
+#endif							/* !EXEC_BACKEND */
+
+
 /*
  * Create the opts file
  */
@@ -5960,6 +6700,7 @@ assign_backendlist_entry(RegisteredBgWorker *rw)
 	bn->bkend_type = BACKEND_TYPE_BGWORKER;
 	bn->dead_end = false;
 	bn->bgworker_notify = false;
+	bn->prefork_channel = PGINVALID_SOCKET;
 
 	rw->rw_backend = bn;
 	rw->rw_child_slot = bn->child_slot;
@@ -6194,6 +6935,11 @@ save_backend_variables(BackendParameters *param, Port *port,
 	param->max_safe_fds = max_safe_fds;
 
 	param->MaxBackends = MaxBackends;
+	param->FastPathLockGroupsPerBackend = FastPathLockGroupsPerBackend;
+
+	param->pg_cycle_counter_in_use = pg_cycle_counter_in_use;
+	param->pg_cycle_counter_base = pg_cycle_counter_base;
+	param->pg_cycle_counter_ns_per_cycle = pg_cycle_counter_ns_per_cycle;
 
 #ifdef WIN32
 	param->PostmasterHandle = PostmasterHandle;
@@ -6427,6 +7173,11 @@ restore_backend_variables(BackendParameters *param, Port *port)
 	max_safe_fds = param->max_safe_fds;
 
 	MaxBackends = param->MaxBackends;
+	FastPathLockGroupsPerBackend = param->FastPathLockGroupsPerBackend;
+
+	pg_cycle_counter_in_use = param->pg_cycle_counter_in_use;
+	pg_cycle_counter_base = param->pg_cycle_counter_base;
+	pg_cycle_counter_ns_per_cycle = param->pg_cycle_counter_ns_per_cycle;
 
 #ifdef WIN32
 	PostmasterHandle = param->PostmasterHandle;
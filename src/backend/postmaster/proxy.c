@@ -0,0 +1,1354 @@
+/*-------------------------------------------------------------------------
+ *
+ * proxy.c
+ *	  Built-in connection pooling
+ *
+ * When connection_proxies is set, the postmaster also listens on proxy_port
+ * and starts that many connection proxy processes, which accept the
+ * connections arriving there.  A proxy multiplexes its clients onto pools of
+ * backends, one pool for each distinct set of startup parameters (user,
+ * database, options and so on).  A client is attached to a backend only
+ * while it has a transaction or a request in progress; when the backend
+ * reports that it is idle again, it goes back to its pool, and the next
+ * transaction of the same client may well run on a different backend.  Many
+ * more clients than backends can thus be served, without an external pooler
+ * in between.
+ *
+ * The backends serving a proxy are started by the postmaster on request: the
+ * proxy creates a socket pair and passes one end over its channel to the
+ * postmaster, which forks a backend on that socket with Port->proxied set.
+ * Such a backend lets the proxy in without authentication, since nothing but
+ * a proxy can hand the postmaster a connection that way.  Clients are then
+ * authenticated one by one, each by whichever backend it gets first: the
+ * proxy sends that backend a proxy-only 'A' message carrying the client's
+ * address, and the backend performs the usual authentication exchange with
+ * the client through the proxy.
+ *
+ * Some session state can't follow a client from one backend to another:
+ * prepared statements, temporary tables, session-level settings, LISTEN,
+ * session-level advisory locks and holdable cursors.  A backend whose client
+ * creates any of these tells the proxy, with a "session_pinned" parameter
+ * status message that the proxy doesn't pass on.  The backend then stays
+ * attached to the client until it disconnects, and is terminated instead of
+ * being reused afterwards.
+ *
+ * The proxy doesn't attach to shared memory, and it handles all its sockets
+ * with poll(2): wait event sets have no way to remove a socket again, which
+ * a process whose connections come and go constantly needs.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/proxy.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#ifdef HAVE_NETINET_TCP_H
+#include <netinet/tcp.h>
+#endif
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#endif
+
+#include "access/xact.h"
+#include "common/ip.h"
+#include "lib/ilist.h"
+#include "libpq/auth.h"
+#include "libpq/hba.h"
+#include "libpq/libpq.h"
+#include "libpq/pqformat.h"
+#include "libpq/pqsignal.h"
+#include "miscadmin.h"
+#include "postmaster/interrupt.h"
+#include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
+#include "storage/ipc.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/ps_status.h"
+
+/* GUC parameters */
+int			ConnectionProxies = 0;
+int			ProxyPortNumber = 6543;
+int			SessionPoolSize = 10;
+
+/*
+ * Don't read more from a socket while this much of its data is still waiting
+ * to be passed on, nor pass on more to a socket that has this much unsent.
+ */
+#define PROXY_BUFFER_LIMIT	(64 * 1024)
+
+/* Name of the parameter status message that reports a pinned session */
+#define PROXY_PINNED_PARAMETER	"session_pinned"
+
+/*
+ * The proxy relies on passing sockets between processes, which we only
+ * implement for Unix; the postmaster refuses to start proxies elsewhere.
+ */
+#ifndef WIN32
+
+typedef enum ChannelState
+{
+	CLIENT_STARTUP,				/* reading the client's startup packet */
+	CLIENT_AUTH,				/* client is being authenticated */
+	CLIENT_ACTIVE,				/* client is authenticated */
+	BACKEND_STARTUP,			/* backend is starting up */
+	BACKEND_READY				/* backend can serve clients */
+} ChannelState;
+
+struct SessionPool;
+
+/*
+ * A client connection or a connection to a backend.  While a client is
+ * attached to a backend, each is the other's peer, and messages read from
+ * one are queued for sending to the other.
+ */
+typedef struct Channel
+{
+	dlist_node	node;			/* link in pool's idle or waiting list */
+	bool		in_list;		/* is node linked into a list? */
+	bool		is_backend;
+	ChannelState state;
+	pgsocket	sock;
+	SockAddr	raddr;			/* client's address */
+	struct SessionPool *pool;	/* NULL until client's startup is read */
+	struct Channel *peer;		/* attached client or backend, or NULL */
+	StringInfoData rx;			/* data read, from cursor on not yet passed */
+	StringInfoData tx;			/* data to send, from cursor on not yet sent */
+	uint32		msg_left;		/* bytes of current message not yet passed */
+	bool		closing;		/* close once tx has been sent */
+	bool		dead;			/* closed, free at end of cycle */
+
+	/* for clients */
+	int			pending_syncs;	/* Query/Sync messages not yet answered */
+	bool		in_batch;		/* sent extended-query messages since Sync */
+
+	/* for backends */
+	bool		pinned;			/* session is pinned to its client */
+} Channel;
+
+/*
+ * Backends started with a given set of startup parameters, and the clients
+ * that use them.
+ */
+typedef struct SessionPool
+{
+	struct SessionPool *next;
+	char	   *params;			/* startup parameters, sans application_name */
+	int			params_len;
+	int			n_backends;		/* backends, including ones starting up */
+	int			n_starting;		/* backends still starting up */
+	int			n_clients;
+	int			n_waiting;		/* clients waiting for a backend */
+	dlist_head	idle_backends;
+	dlist_head	waiting_clients;
+} SessionPool;
+
+static MemoryContext ProxyContext = NULL;
+static pgsocket ProxyChannel = PGINVALID_SOCKET;
+static SessionPool *pools = NULL;
+static Channel **channels = NULL;
+static int	n_channels = 0;
+static int	max_channels = 0;
+static int	n_clients = 0;
+static volatile sig_atomic_t immediate_shutdown = false;
+
+static void proxy_accept(pgsocket listenSock);
+static Channel *channel_create(pgsocket sock, bool is_backend);
+static void channel_close(Channel *chan);
+static void channel_free(Channel *chan);
+static bool channel_read(Channel *chan);
+static void channel_flush(Channel *chan);
+static void channel_send(Channel *chan, const char *data, int len);
+static void channel_send_error(Channel *client, const char *sqlstate,
+							   const char *message);
+static void process_channel(Channel *chan);
+static void process_startup_packet(Channel *client);
+static void process_client(Channel *client);
+static void process_backend(Channel *backend);
+static SessionPool *get_pool(const char *params, int params_len);
+static void request_backend(Channel *client);
+static bool launch_backend(SessionPool *pool);
+static void launch_backends_for_waiters(SessionPool *pool);
+static void attach_backend(Channel *client, Channel *backend);
+static void release_backend(Channel *backend);
+static void fail_waiting_clients(SessionPool *pool, const char *error,
+								 int errlen);
+static void ProxyImmediateShutdown(SIGNAL_ARGS);
+
+
+/* ------------------------------------------------------------
+ * Process startup and main loop
+ * ------------------------------------------------------------
+ */
+
+/*
+ * ConnectionProxyMain
+ *		Main entry point for a connection proxy process.
+ *
+ * listenSockets are the postmaster's sockets on proxy_port, shared among all
+ * proxies; pmChannel is our end of the socket pair used to ask the
+ * postmaster for new backends.
+ */
+void
+ConnectionProxyMain(int proxyIndex, pgsocket *listenSockets,
+					pgsocket pmChannel)
+{
+	struct pollfd *pfds = NULL;
+	Channel   **pchans = NULL;
+	int			max_pfds = 0;
+	int			n_listen = 0;
+	int			i;
+
+	/*
+	 * SIGTERM asks for a smart shutdown: stop accepting connections and exit
+	 * once the existing clients are gone.  SIGINT means exit right away.
+	 */
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGINT, ProxyImmediateShutdown);
+	pqsignal(SIGTERM, SignalHandlerForShutdownRequest);
+	/* SIGQUIT handler was already set up by InitPostmasterChild */
+	pqsignal(SIGALRM, SIG_IGN);
+	pqsignal(SIGPIPE, SIG_IGN);
+	pqsignal(SIGUSR1, SIG_IGN);
+	pqsignal(SIGUSR2, SIG_IGN);
+	pqsignal(SIGCHLD, SIG_DFL);
+	PG_SETMASK(&UnBlockSig);
+
+	MyBackendType = B_CONNECTION_PROXY;
+	init_ps_display(NULL);
+
+	ProxyContext = AllocSetContextCreate(TopMemoryContext,
+										 "Connection proxy",
+										 ALLOCSET_DEFAULT_SIZES);
+	MemoryContextSwitchTo(ProxyContext);
+
+	ProxyChannel = pmChannel;
+
+	/* Every proxy accepts on the same sockets, so none of them may block */
+	for (n_listen = 0; n_listen < MAXLISTEN; n_listen++)
+	{
+		if (listenSockets[n_listen] == PGINVALID_SOCKET)
+			break;
+		if (!pg_set_noblock(listenSockets[n_listen]))
+			ereport(FATAL,
+					(errcode_for_socket_access(),
+					 errmsg("could not set socket to nonblocking mode: %m")));
+	}
+
+	ereport(DEBUG1,
+			(errmsg_internal("connection proxy %d started", proxyIndex)));
+
+	for (;;)
+	{
+		int			n_pfds = 0;
+		int			rc;
+
+		if (immediate_shutdown)
+			proc_exit(0);
+
+		if (ConfigReloadPending)
+		{
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		/* In a smart shutdown, exit once the last client is gone */
+		if (ShutdownRequestPending && n_clients == 0)
+			proc_exit(0);
+
+		/* Build the poll set: listen sockets, postmaster death, channels */
+		if (max_pfds < n_listen + 1 + n_channels)
+		{
+			max_pfds = Max(64, 2 * (n_listen + 1 + n_channels));
+			if (pfds)
+			{
+				pfree(pfds);
+				pfree(pchans);
+			}
+			pfds = palloc(max_pfds * sizeof(struct pollfd));
+			pchans = palloc(max_pfds * sizeof(Channel *));
+		}
+
+		if (!ShutdownRequestPending)
+		{
+			for (i = 0; i < n_listen; i++)
+			{
+				pfds[n_pfds].fd = listenSockets[i];
+				pfds[n_pfds].events = POLLIN;
+				pchans[n_pfds++] = NULL;
+			}
+		}
+		pfds[n_pfds].fd = postmaster_alive_fds[POSTMASTER_FD_WATCH];
+		pfds[n_pfds].events = POLLIN;
+		pchans[n_pfds++] = NULL;
+
+		for (i = 0; i < n_channels; i++)
+		{
+			Channel    *chan = channels[i];
+
+			pfds[n_pfds].fd = chan->sock;
+			pfds[n_pfds].events = 0;
+			if (!chan->closing && chan->rx.len - chan->rx.cursor < PROXY_BUFFER_LIMIT)
+				pfds[n_pfds].events |= POLLIN;
+			if (chan->tx.len > chan->tx.cursor)
+				pfds[n_pfds].events |= POLLOUT;
+			pchans[n_pfds++] = chan;
+		}
+
+		/*
+		 * The timeout only bounds how long a signal arriving just before
+		 * poll() can go unnoticed.
+		 */
+		rc = poll(pfds, n_pfds, 1000);
+		if (rc < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			ereport(FATAL,
+					(errcode_for_socket_access(),
+					 errmsg("poll() failed in connection proxy: %m")));
+		}
+
+		for (i = 0; i < n_pfds && rc > 0; i++)
+		{
+			Channel    *chan = pchans[i];
+
+			if (pfds[i].revents == 0)
+				continue;
+
+			if (chan == NULL)
+			{
+				if (pfds[i].fd == postmaster_alive_fds[POSTMASTER_FD_WATCH])
+					proc_exit(1);
+				proxy_accept(pfds[i].fd);
+				continue;
+			}
+
+			if (chan->dead)
+				continue;
+
+			if (pfds[i].revents & POLLOUT)
+				channel_flush(chan);
+			if (!chan->dead &&
+				(pfds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+			{
+				bool		eof = !channel_read(chan);
+
+				/* Pass on what we got, such as a backend's last error */
+				process_channel(chan);
+				if (eof)
+				{
+					channel_close(chan);
+					continue;
+				}
+			}
+			else if (!chan->dead)
+				process_channel(chan);
+			/* Sending may have made room for more of the peer's data */
+			if (!chan->dead && chan->peer != NULL)
+				process_channel(chan->peer);
+		}
+
+		/* Finish off closed channels */
+		for (i = 0; i < n_channels;)
+		{
+			Channel    *chan = channels[i];
+
+			if (chan->closing && !chan->dead && chan->tx.len == chan->tx.cursor)
+				channel_close(chan);
+			if (chan->dead)
+			{
+				channels[i] = channels[--n_channels];
+				channel_free(chan);
+			}
+			else
+				i++;
+		}
+	}
+}
+
+/*
+ * SIGINT handler: exit at the next opportunity.
+ */
+static void
+ProxyImmediateShutdown(SIGNAL_ARGS)
+{
+	immediate_shutdown = true;
+}
+
+/*
+ * Accept new client connections on a listen socket.
+ */
+static void
+proxy_accept(pgsocket listenSock)
+{
+	for (;;)
+	{
+		SockAddr	raddr;
+		pgsocket	sock;
+		Channel    *client;
+
+		raddr.salen = sizeof(raddr.addr);
+		sock = accept(listenSock, (struct sockaddr *) &raddr.addr,
+					  &raddr.salen);
+		if (sock == PGINVALID_SOCKET)
+		{
+			/* another proxy may have taken the connection */
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				ereport(LOG,
+						(errcode_for_socket_access(),
+						 errmsg("could not accept new connection: %m")));
+			return;
+		}
+
+		if (!IS_AF_UNIX(raddr.addr.ss_family))
+		{
+			int			on = 1;
+
+#ifdef TCP_NODELAY
+			(void) setsockopt(sock, IPPROTO_TCP, TCP_NODELAY,
+							  (char *) &on, sizeof(on));
+#endif
+			(void) setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE,
+							  (char *) &on, sizeof(on));
+		}
+
+		client = channel_create(sock, false);
+		if (client == NULL)
+			continue;
+		client->raddr = raddr;
+		client->state = CLIENT_STARTUP;
+		n_clients++;
+	}
+}
+
+
+/* ------------------------------------------------------------
+ * Channels
+ * ------------------------------------------------------------
+ */
+
+/*
+ * Create a channel for a socket, or close the socket and return NULL if it
+ * can't be set up.
+ */
+static Channel *
+channel_create(pgsocket sock, bool is_backend)
+{
+	Channel    *chan;
+
+	if (!pg_set_noblock(sock))
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not set socket to nonblocking mode: %m")));
+		closesocket(sock);
+		return NULL;
+	}
+
+	chan = palloc0(sizeof(Channel));
+	chan->is_backend = is_backend;
+	chan->sock = sock;
+	initStringInfo(&chan->rx);
+	initStringInfo(&chan->tx);
+
+	if (n_channels == max_channels)
+	{
+		max_channels = Max(64, 2 * max_channels);
+		if (channels)
+			channels = repalloc(channels, max_channels * sizeof(Channel *));
+		else
+			channels = palloc(max_channels * sizeof(Channel *));
+	}
+	channels[n_channels++] = chan;
+
+	return chan;
+}
+
+/*
+ * Close a channel, and take care of its peer and pool.  The memory is
+ * released at the end of the main loop's cycle.
+ */
+static void
+channel_close(Channel *chan)
+{
+	Channel    *peer = chan->peer;
+	SessionPool *pool = chan->pool;
+
+	if (chan->dead)
+		return;
+	chan->dead = true;
+	closesocket(chan->sock);
+	chan->sock = PGINVALID_SOCKET;
+
+	if (chan->in_list)
+	{
+		dlist_delete(&chan->node);
+		chan->in_list = false;
+		if (!chan->is_backend)
+			pool->n_waiting--;
+	}
+
+	if (peer != NULL)
+	{
+		peer->peer = NULL;
+		chan->peer = NULL;
+	}
+
+	if (!chan->is_backend)
+	{
+		n_clients--;
+		if (pool != NULL)
+			pool->n_clients--;
+
+		/*
+		 * A backend is released as soon as it's idle, so if the client still
+		 * had one, it is busy or its session is pinned.  Either way it can't
+		 * serve anybody else.
+		 */
+		if (peer != NULL)
+			channel_close(peer);
+		return;
+	}
+
+	pool->n_backends--;
+	if (chan->state == BACKEND_STARTUP)
+	{
+		pool->n_starting--;
+
+		/*
+		 * If this was the only backend, the clients waiting for it won't be
+		 * served either; pass them the error, if the backend sent one.
+		 */
+		if (pool->n_backends == 0)
+		{
+			char	   *error = chan->rx.data + chan->rx.cursor;
+			int			errlen = chan->rx.len - chan->rx.cursor;
+			uint32		len;
+
+			/* Make sure it's an ErrorResponse, not some other junk */
+			if (errlen >= 5 && error[0] == 'E')
+			{
+				memcpy(&len, error + 1, 4);
+				len = pg_ntoh32(len) + 1;
+				errlen = (len <= errlen) ? len : 0;
+			}
+			else
+				errlen = 0;
+			fail_waiting_clients(pool, error, errlen);
+		}
+		return;
+	}
+
+	if (peer != NULL)
+	{
+		/* Let the client have what the backend sent, then hang up */
+		peer->closing = true;
+		channel_flush(peer);
+	}
+
+	/* Replace the backend, if clients are waiting for one */
+	launch_backends_for_waiters(pool);
+}
+
+static void
+channel_free(Channel *chan)
+{
+	pfree(chan->rx.data);
+	pfree(chan->tx.data);
+	pfree(chan);
+}
+
+/*
+ * Read whatever is available from the socket.  Returns false on EOF or
+ * error.
+ */
+static bool
+channel_read(Channel *chan)
+{
+	/* Discard consumed data before reading more */
+	if (chan->rx.cursor > 0)
+	{
+		memmove(chan->rx.data, chan->rx.data + chan->rx.cursor,
+				chan->rx.len - chan->rx.cursor);
+		chan->rx.len -= chan->rx.cursor;
+		chan->rx.cursor = 0;
+	}
+
+	for (;;)
+	{
+		ssize_t		n;
+
+		enlargeStringInfo(&chan->rx, 8192);
+		n = recv(chan->sock, chan->rx.data + chan->rx.len,
+				 chan->rx.maxlen - chan->rx.len - 1, 0);
+		if (n > 0)
+		{
+			chan->rx.len += n;
+			if (chan->rx.len >= PROXY_BUFFER_LIMIT)
+				return true;
+			continue;
+		}
+		if (n == 0)
+			return false;
+		if (errno == EINTR)
+			continue;
+		return errno == EAGAIN || errno == EWOULDBLOCK;
+	}
+}
+
+/*
+ * Send as much of the queued output as the socket will take.
+ */
+static void
+channel_flush(Channel *chan)
+{
+	while (chan->tx.cursor < chan->tx.len)
+	{
+		ssize_t		n;
+
+		n = send(chan->sock, chan->tx.data + chan->tx.cursor,
+				 chan->tx.len - chan->tx.cursor, 0);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				channel_close(chan);
+			return;
+		}
+		chan->tx.cursor += n;
+	}
+	resetStringInfo(&chan->tx);
+}
+
+/*
+ * Queue data for sending to a channel, and try to send it.
+ */
+static void
+channel_send(Channel *chan, const char *data, int len)
+{
+	if (chan->dead)
+		return;
+	if (chan->tx.cursor > 0 && chan->tx.cursor == chan->tx.len)
+		resetStringInfo(&chan->tx);
+	appendBinaryStringInfo(&chan->tx, data, len);
+	channel_flush(chan);
+}
+
+/*
+ * Send a FATAL error to a client, and close its connection afterwards.
+ */
+static void
+channel_send_error(Channel *client, const char *sqlstate, const char *message)
+{
+	StringInfoData buf;
+	uint32		len;
+
+	initStringInfo(&buf);
+	appendStringInfoChar(&buf, 'E');
+	appendBinaryStringInfo(&buf, "\0\0\0\0", 4);
+	appendStringInfo(&buf, "SFATAL%cVFATAL%cC%s%cM%s%c%c",
+					 '\0', '\0', sqlstate, '\0', message, '\0', '\0');
+	len = pg_hton32(buf.len - 1);
+	memcpy(buf.data + 1, &len, 4);
+
+	channel_send(client, buf.data, buf.len);
+	pfree(buf.data);
+	client->closing = true;
+}
+
+
+/* ------------------------------------------------------------
+ * Protocol handling
+ * ------------------------------------------------------------
+ */
+
+static void
+process_channel(Channel *chan)
+{
+	if (chan->dead)
+		return;
+	if (chan->is_backend)
+		process_backend(chan);
+	else if (chan->state == CLIENT_STARTUP)
+		process_startup_packet(chan);
+	else
+		process_client(chan);
+}
+
+/*
+ * Read a message header from rx, if there's a complete one.  *type is set
+ * to the message type and *len to the length of the whole message,
+ * including the type byte.
+ */
+static bool
+peek_message(Channel *chan, char *type, uint32 *len)
+{
+	uint32		n;
+
+	if (chan->rx.len - chan->rx.cursor < 5)
+		return false;
+	*type = chan->rx.data[chan->rx.cursor];
+	memcpy(&n, chan->rx.data + chan->rx.cursor + 1, 4);
+	n = pg_ntoh32(n);
+	if (n < 4)
+	{
+		/* we've lost message boundary sync; give up on the connection */
+		channel_close(chan);
+		return false;
+	}
+	*len = n + 1;
+	return true;
+}
+
+/*
+ * Pass on up to msg_left bytes of the current message to the peer, as far
+ * as the peer's output limit allows.  Returns true if the whole message has
+ * been passed on.
+ */
+static bool
+forward_message_data(Channel *chan)
+{
+	Channel    *peer = chan->peer;
+	int			avail = chan->rx.len - chan->rx.cursor;
+	int			room = PROXY_BUFFER_LIMIT - (peer->tx.len - peer->tx.cursor);
+	int			n;
+
+	n = Min((uint32) avail, chan->msg_left);
+	n = Min(n, room);
+	if (n <= 0)
+		return chan->msg_left == 0;
+
+	channel_send(peer, chan->rx.data + chan->rx.cursor, n);
+	chan->rx.cursor += n;
+	chan->msg_left -= n;
+	return chan->msg_left == 0;
+}
+
+/*
+ * Handle a client's startup packet, and any SSL or GSSAPI encryption
+ * requests preceding it.
+ */
+static void
+process_startup_packet(Channel *client)
+{
+	char	   *pkt;
+	uint32		len;
+	ProtocolVersion proto;
+	StringInfoData params;
+	bool		have_user = false;
+	char	   *p;
+	char	   *end;
+
+	for (;;)
+	{
+		if (client->rx.len - client->rx.cursor < 4)
+			return;
+		pkt = client->rx.data + client->rx.cursor;
+		memcpy(&len, pkt, 4);
+		len = pg_ntoh32(len);
+		if (len < 8 || len > MAX_STARTUP_PACKET_LENGTH)
+		{
+			channel_close(client);
+			return;
+		}
+		if (client->rx.len - client->rx.cursor < len)
+			return;
+		memcpy(&proto, pkt + 4, 4);
+		proto = pg_ntoh32(proto);
+
+		/* We don't do encryption; tell the client to go ahead without */
+		if (proto == NEGOTIATE_SSL_CODE || proto == NEGOTIATE_GSS_CODE)
+		{
+			client->rx.cursor += len;
+			channel_send(client, "N", 1);
+			continue;
+		}
+		break;
+	}
+
+	client->rx.cursor += len;
+
+	if (proto == CANCEL_REQUEST_CODE)
+	{
+		/* We hand out no cancel keys, so there's nothing to cancel */
+		channel_close(client);
+		return;
+	}
+
+	if (PG_PROTOCOL_MAJOR(proto) != 3)
+	{
+		channel_send_error(client, "08P01",
+						   "connection proxies support only protocol version 3");
+		return;
+	}
+
+	/*
+	 * Collect the startup parameters, except for application_name, which
+	 * needn't be the same for all clients sharing a backend.  The backend
+	 * reports the application name it has, but the client can still set its
+	 * own with SET, which pins the session.  Protocol options (_pq_.*) are
+	 * dropped too: the proxy relays messages as they are, so it can't offer
+	 * protocol compression, and the client gets an uncompressed stream.
+	 */
+	initStringInfo(&params);
+	p = pkt + 8;
+	end = pkt + len;
+	while (p < end && *p != '\0')
+	{
+		char	   *name = p;
+		char	   *value;
+
+		value = memchr(name, '\0', end - name);
+		if (value == NULL || ++value >= end)
+			break;
+		p = memchr(value, '\0', end - value);
+		if (p == NULL)
+			break;
+		p++;
+
+		if (strcmp(name, "application_name") == 0 ||
+			strncmp(name, "_pq_.", 5) == 0)
+			continue;
+		if (strcmp(name, "replication") == 0)
+		{
+			pfree(params.data);
+			channel_send_error(client, "0A000",
+							   "replication connections are not supported by connection proxies");
+			return;
+		}
+		if (strcmp(name, "user") == 0)
+			have_user = true;
+		appendBinaryStringInfo(&params, name, p - name);
+	}
+
+	if (!have_user)
+	{
+		pfree(params.data);
+		channel_send_error(client, "28000",
+						   "no PostgreSQL user name specified in startup packet");
+		return;
+	}
+
+	client->pool = get_pool(params.data, params.len);
+	client->pool->n_clients++;
+	pfree(params.data);
+
+	client->state = CLIENT_AUTH;
+	request_backend(client);
+}
+
+/*
+ * Pass a client's messages on to its backend, keeping track of how many
+ * responses it has to wait for.
+ */
+static void
+process_client(Channel *client)
+{
+	while (!client->dead && !client->closing &&
+		   client->rx.len > client->rx.cursor)
+	{
+		char		type;
+		uint32		len;
+
+		if (client->peer == NULL)
+		{
+			/* Needs a backend first */
+			if (client->state == CLIENT_ACTIVE)
+				request_backend(client);
+			return;
+		}
+
+		if (client->msg_left > 0)
+		{
+			if (!forward_message_data(client))
+				return;
+			continue;
+		}
+
+		if (!peek_message(client, &type, &len))
+			return;
+
+		switch (type)
+		{
+			case 'X':
+				/* Terminate: this is for us, not the backend */
+				channel_close(client);
+				return;
+			case 'Q':
+			case 'F':
+				client->pending_syncs++;
+				break;
+			case 'S':
+				client->pending_syncs++;
+				client->in_batch = false;
+				break;
+			case 'P':
+			case 'B':
+			case 'D':
+			case 'E':
+			case 'C':
+			case 'H':
+				client->in_batch = true;
+				break;
+			default:
+				break;
+		}
+
+		client->msg_left = len;
+		if (!forward_message_data(client))
+			return;
+	}
+}
+
+/*
+ * Handle messages from a backend: consume its startup responses, pass on
+ * what it sends its client, and give it back to the pool when it's idle.
+ */
+static void
+process_backend(Channel *backend)
+{
+	while (!backend->dead && backend->rx.len > backend->rx.cursor)
+	{
+		Channel    *client = backend->peer;
+		char	   *msg;
+		char		type;
+		uint32		len;
+
+		if (backend->msg_left > 0)
+		{
+			if (client == NULL)
+			{
+				/* leftover of a message whose client went away; drop it */
+				uint32		n = Min(backend->msg_left,
+									backend->rx.len - backend->rx.cursor);
+
+				backend->rx.cursor += n;
+				backend->msg_left -= n;
+			}
+			else if (!forward_message_data(backend))
+				return;
+			continue;
+		}
+
+		if (!peek_message(backend, &type, &len))
+			return;
+
+		/* The messages we look into are short; wait for all of them */
+		if ((backend->state == BACKEND_STARTUP || type == 'Z' || type == 'S') &&
+			backend->rx.len - backend->rx.cursor < len)
+			return;
+		msg = backend->rx.data + backend->rx.cursor;
+
+		if (backend->state == BACKEND_STARTUP)
+		{
+			if (type == 'E')
+			{
+				/* Startup failed; leave the error for channel_close */
+				channel_close(backend);
+				return;
+			}
+			backend->rx.cursor += len;
+			if (type == 'Z')
+			{
+				backend->state = BACKEND_READY;
+				backend->pool->n_starting--;
+				release_backend(backend);
+			}
+			continue;
+		}
+
+		if (type == 'S' && len > 5 && strcmp(msg + 5, PROXY_PINNED_PARAMETER) == 0)
+		{
+			backend->pinned = true;
+			backend->rx.cursor += len;
+			continue;
+		}
+
+		if (client == NULL)
+		{
+			/* Nobody to pass it to, such as a notice to an idle backend */
+			backend->msg_left = len;
+			continue;
+		}
+
+		if (type != 'Z')
+		{
+			backend->msg_left = len;
+			if (!forward_message_data(backend))
+				return;
+		}
+		else
+		{
+			char		status = msg[5];
+
+			/* pass it on whole, regardless of the output limit */
+			channel_send(client, msg, len);
+			backend->rx.cursor += len;
+
+			if (client->pending_syncs > 0)
+				client->pending_syncs--;
+			if (client->state == CLIENT_AUTH)
+				client->state = CLIENT_ACTIVE;
+
+			/*
+			 * Transaction boundary.  Unless the client has more requests in
+			 * flight or has to stay on this backend, let somebody else have
+			 * it.
+			 */
+			if (status == 'I' && client->pending_syncs == 0 &&
+				!client->in_batch && !backend->pinned)
+			{
+				client->peer = NULL;
+				backend->peer = NULL;
+				release_backend(backend);
+
+				/* The client may already have sent its next request */
+				process_client(client);
+			}
+		}
+	}
+}
+
+
+/* ------------------------------------------------------------
+ * Session pools
+ * ------------------------------------------------------------
+ */
+
+static SessionPool *
+get_pool(const char *params, int params_len)
+{
+	SessionPool *pool;
+
+	for (pool = pools; pool != NULL; pool = pool->next)
+	{
+		if (pool->params_len == params_len &&
+			memcmp(pool->params, params, params_len) == 0)
+			return pool;
+	}
+
+	pool = palloc0(sizeof(SessionPool));
+	pool->params = palloc(params_len);
+	memcpy(pool->params, params, params_len);
+	pool->params_len = params_len;
+	dlist_init(&pool->idle_backends);
+	dlist_init(&pool->waiting_clients);
+	pool->next = pools;
+	pools = pool;
+
+	return pool;
+}
+
+/*
+ * Get a backend for a client: an idle one if there is one, otherwise wait
+ * for one to become idle or to be started for us.
+ */
+static void
+request_backend(Channel *client)
+{
+	SessionPool *pool = client->pool;
+
+	Assert(client->peer == NULL);
+
+	if (!dlist_is_empty(&pool->idle_backends))
+	{
+		Channel    *backend;
+
+		backend = dlist_container(Channel, node,
+								  dlist_pop_head_node(&pool->idle_backends));
+		backend->in_list = false;
+		attach_backend(client, backend);
+		return;
+	}
+
+	if (!client->in_list)
+	{
+		dlist_push_tail(&pool->waiting_clients, &client->node);
+		client->in_list = true;
+		pool->n_waiting++;
+	}
+
+	launch_backends_for_waiters(pool);
+}
+
+/*
+ * Start as many backends as there are clients waiting for one, within the
+ * limit of session_pool_size.
+ */
+static void
+launch_backends_for_waiters(SessionPool *pool)
+{
+	while (pool->n_starting < pool->n_waiting &&
+		   pool->n_backends < SessionPoolSize)
+	{
+		if (!launch_backend(pool))
+		{
+			if (pool->n_backends == 0)
+				fail_waiting_clients(pool, NULL, 0);
+			break;
+		}
+	}
+}
+
+/*
+ * Ask the postmaster to start a new backend for a pool.
+ */
+static bool
+launch_backend(SessionPool *pool)
+{
+	pgsocket	fds[2];
+	Channel    *backend;
+	uint32		n;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not create socket pair for connection proxy: %m")));
+		return false;
+	}
+
+	if (!StreamSendSocket(ProxyChannel, fds[1], NULL, 0))
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not pass connection to postmaster: %m")));
+		closesocket(fds[0]);
+		closesocket(fds[1]);
+		return false;
+	}
+	closesocket(fds[1]);
+
+	backend = channel_create(fds[0], true);
+	if (backend == NULL)
+		return false;
+	backend->state = BACKEND_STARTUP;
+	backend->pool = pool;
+	pool->n_backends++;
+	pool->n_starting++;
+
+	/* Send the startup packet */
+	n = pg_hton32(pool->params_len + 9);
+	appendBinaryStringInfo(&backend->tx, (char *) &n, 4);
+	n = pg_hton32(PG_PROTOCOL_LATEST);
+	appendBinaryStringInfo(&backend->tx, (char *) &n, 4);
+	appendBinaryStringInfo(&backend->tx, pool->params, pool->params_len);
+	appendStringInfoChar(&backend->tx, '\0');
+	channel_flush(backend);
+
+	return true;
+}
+
+static void
+attach_backend(Channel *client, Channel *backend)
+{
+	if (client->in_list)
+	{
+		dlist_delete(&client->node);
+		client->in_list = false;
+		client->pool->n_waiting--;
+	}
+
+	client->peer = backend;
+	backend->peer = client;
+
+	/* A new client first has to be authenticated */
+	if (client->state == CLIENT_AUTH)
+	{
+		StringInfoData buf;
+		uint32		n;
+
+		initStringInfo(&buf);
+		appendStringInfoChar(&buf, 'A');
+		n = pg_hton32(8 + client->raddr.salen);
+		appendBinaryStringInfo(&buf, (char *) &n, 4);
+		n = pg_hton32(client->raddr.salen);
+		appendBinaryStringInfo(&buf, (char *) &n, 4);
+		appendBinaryStringInfo(&buf, (char *) &client->raddr.addr,
+							   client->raddr.salen);
+		channel_send(backend, buf.data, buf.len);
+		pfree(buf.data);
+		client->pending_syncs = 1;
+	}
+
+	process_client(client);
+}
+
+/*
+ * A backend is ready for another client: give it to a waiting client, or
+ * make it idle.
+ */
+static void
+release_backend(Channel *backend)
+{
+	SessionPool *pool = backend->pool;
+
+	Assert(backend->peer == NULL);
+
+	if (!dlist_is_empty(&pool->waiting_clients))
+	{
+		Channel    *client;
+
+		client = dlist_container(Channel, node,
+								 dlist_head_node(&pool->waiting_clients));
+		attach_backend(client, backend);
+		return;
+	}
+
+	dlist_push_tail(&pool->idle_backends, &backend->node);
+	backend->in_list = true;
+}
+
+/*
+ * Disconnect all clients waiting for a backend of the pool, sending them
+ * the given ErrorResponse message, or a generic one.
+ */
+static void
+fail_waiting_clients(SessionPool *pool, const char *error, int errlen)
+{
+	while (!dlist_is_empty(&pool->waiting_clients))
+	{
+		Channel    *client;
+
+		client = dlist_container(Channel, node,
+								 dlist_pop_head_node(&pool->waiting_clients));
+		client->in_list = false;
+		pool->n_waiting--;
+		if (errlen > 0)
+		{
+			channel_send(client, error, errlen);
+			client->closing = true;
+		}
+		else
+			channel_send_error(client, "08006",
+							   "could not start a backend for the connection proxy");
+	}
+}
+
+#else							/* WIN32 */
+
+void
+ConnectionProxyMain(int proxyIndex, pgsocket *listenSockets,
+					pgsocket pmChannel)
+{
+	elog(FATAL, "connection proxies are not supported on this platform");
+}
+
+#endif							/* WIN32 */
+
+
+/* ------------------------------------------------------------
+ * Backend side
+ * ------------------------------------------------------------
+ */
+
+/* Has the session acquired state that ties it to its client? */
+static bool session_pinned = false;
+static bool session_pin_reported = false;
+
+/*
+ * ProxyAuthenticateClient
+ *		Authenticate a new client of the connection proxy.
+ *
+ * The proxy sends this in place of a startup packet when it hands an idle
+ * session to a client that hasn't been authenticated yet.  The message
+ * carries the client's address, which is what pg_hba.conf has to be checked
+ * against; the user and database are the session's own.  On failure, the
+ * session ends, as it would for a direct connection.
+ */
+void
+ProxyAuthenticateClient(StringInfo msg)
+{
+	Port	   *port = MyProcPort;
+	int			salen;
+	char		remote_host[NI_MAXHOST];
+	char		remote_port[NI_MAXSERV];
+
+	if (IsTransactionOrTransactionBlock())
+		ereport(FATAL,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("connection proxy authentication request inside a transaction")));
+
+	salen = pq_getmsgint(msg, 4);
+	if (salen <= 0 || salen > (int) sizeof(port->raddr.addr))
+		ereport(FATAL,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("invalid client address in connection proxy authentication request")));
+	memcpy(&port->raddr.addr, pq_getmsgbytes(msg, salen), salen);
+	port->raddr.salen = salen;
+	pq_getmsgend(msg);
+
+	/* Describe the new client, as BackendInitialize does */
+	remote_host[0] = '\0';
+	remote_port[0] = '\0';
+	(void) pg_getnameinfo_all(&port->raddr.addr, port->raddr.salen,
+							  remote_host, sizeof(remote_host),
+							  remote_port, sizeof(remote_port),
+							  NI_NUMERICHOST | NI_NUMERICSERV);
+	port->remote_host = MemoryContextStrdup(TopMemoryContext, remote_host);
+	port->remote_port = MemoryContextStrdup(TopMemoryContext, remote_port);
+	port->remote_hostname = NULL;
+	port->remote_hostname_resolv = 0;
+
+	/*
+	 * Pick up the current pg_hba.conf and pg_ident.conf.  We kept the
+	 * PostmasterContext around for them.
+	 */
+	Assert(PostmasterContext != NULL);
+	if (!load_hba())
+		ereport(FATAL,
+				(errmsg("could not load pg_hba.conf")));
+	(void) load_ident();
+
+	set_ps_display("authentication");
+	StartTransactionCommand();
+	ClientAuthentication(port); /* might not return, if failure */
+	CommitTransactionCommand();
+
+	/* The new client needs to know the current settings */
+	ResendGUCOptions();
+}
+
+/*
+ * ProxyPinSession
+ *		Note that the session now has state that can't be moved to another
+ *		backend.  No-op unless the session serves a connection proxy.
+ */
+void
+ProxyPinSession(void)
+{
+	if (MyProcPort != NULL && MyProcPort->proxied)
+		session_pinned = true;
+}
+
+/*
+ * ProxyReportSessionState
+ *		Tell the proxy that the session got pinned, if it hasn't been told yet.
+ *
+ * Called before each ReadyForQuery, which is when the proxy could otherwise
+ * hand the backend to another client.
+ */
+void
+ProxyReportSessionState(void)
+{
+	StringInfoData buf;
+
+	if (!session_pinned || session_pin_reported)
+		return;
+
+	pq_beginmessage(&buf, 'S');
+	pq_sendstring(&buf, PROXY_PINNED_PARAMETER);
+	pq_sendstring(&buf, "on");
+	pq_endmessage(&buf);
+	session_pin_reported = true;
+}
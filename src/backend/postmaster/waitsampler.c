@@ -0,0 +1,300 @@
+/*-------------------------------------------------------------------------
+ *
+ * waitsampler.c
+ *	  Background worker that samples the wait events of all processes.
+ *
+ * pg_stat_activity only shows what each process is waiting on at the moment
+ * it is queried, so short waits are invisible to anyone polling it from the
+ * outside.  The wait event sampler looks at every active process every
+ * wait_sampling_interval milliseconds and appends what it sees (wait event,
+ * backend type and query ID) to a ring buffer in shared memory holding the
+ * last wait_sampling_history_size samples.  The pg_stat_wait_samples view
+ * shows the buffer's contents, and pg_stat_wait_profile aggregates them.
+ *
+ * The sampler is an ordinary background worker that only needs shared
+ * memory access.  It is registered at postmaster startup if
+ * wait_sampling_history_size is not zero.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/waitsampler.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "funcapi.h"
+#include "libpq/pqsignal.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/interrupt.h"
+#include "postmaster/waitsampler.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+
+/*
+ * GUC parameters
+ */
+int			wait_sampling_interval = 10;
+int			wait_sampling_history_size = 0;
+
+/*
+ * Shared ring buffer of samples.  'next' counts all samples ever stored, so
+ * the oldest sample still present is at next - history_size (if the buffer
+ * has wrapped around) and the newest is at next - 1, modulo history_size.
+ * Protected by WaitSampleLock.
+ */
+typedef struct WaitSamplerShmemStruct
+{
+	uint64		next;
+	WaitSample	samples[FLEXIBLE_ARRAY_MEMBER];
+} WaitSamplerShmemStruct;
+
+static WaitSamplerShmemStruct *WaitSamplerShmem = NULL;
+
+static void store_samples(WaitSample *samples, int nsamples);
+
+
+/*
+ * Shared memory size
+ */
+Size
+WaitSamplerShmemSize(void)
+{
+	if (wait_sampling_history_size == 0)
+		return 0;
+
+	return add_size(offsetof(WaitSamplerShmemStruct, samples),
+					mul_size(sizeof(WaitSample), wait_sampling_history_size));
+}
+
+/*
+ * Allocate and initialize shared memory
+ */
+void
+WaitSamplerShmemInit(void)
+{
+	bool		found;
+
+	if (wait_sampling_history_size == 0)
+		return;
+
+	WaitSamplerShmem = (WaitSamplerShmemStruct *)
+		ShmemInitStruct("Wait Sampler Data", WaitSamplerShmemSize(), &found);
+
+	if (!found)
+		WaitSamplerShmem->next = 0;
+}
+
+/*
+ * Register the sampler background worker, if it's enabled.  Called from
+ * the postmaster before shared_preload_libraries are processed.
+ */
+void
+WaitSamplerRegister(void)
+{
+	BackgroundWorker bgw;
+
+	if (wait_sampling_history_size == 0)
+		return;
+
+	memset(&bgw, 0, sizeof(bgw));
+	bgw.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	bgw.bgw_start_time = BgWorkerStart_PostmasterStart;
+	snprintf(bgw.bgw_library_name, BGW_MAXLEN, "postgres");
+	snprintf(bgw.bgw_function_name, BGW_MAXLEN, "WaitSamplerMain");
+	snprintf(bgw.bgw_name, BGW_MAXLEN, "wait event sampler");
+	snprintf(bgw.bgw_type, BGW_MAXLEN, "wait event sampler");
+	bgw.bgw_restart_time = 5;
+	bgw.bgw_notify_pid = 0;
+	bgw.bgw_main_arg = (Datum) 0;
+
+	RegisterBackgroundWorker(&bgw);
+}
+
+/*
+ * Main entry point for the sampler process
+ */
+void
+WaitSamplerMain(Datum main_arg)
+{
+	WaitSample *samples;
+
+	/* Establish signal handlers. */
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/* One slot per process that can have a backend status entry */
+	samples = (WaitSample *)
+		MemoryContextAlloc(TopMemoryContext,
+						   sizeof(WaitSample) * (MaxBackends + NUM_AUXPROCTYPES));
+
+	for (;;)
+	{
+		int			nsamples;
+
+		ResetLatch(MyLatch);
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (ConfigReloadPending)
+		{
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		/* Sampling is paused while the interval is zero */
+		if (wait_sampling_interval > 0)
+		{
+			nsamples = pgstat_sample_wait_events(samples,
+												 GetCurrentTimestamp());
+			if (nsamples > 0)
+				store_samples(samples, nsamples);
+
+			(void) WaitLatch(MyLatch,
+							 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+							 wait_sampling_interval,
+							 WAIT_EVENT_WAIT_SAMPLER_MAIN);
+		}
+		else
+			(void) WaitLatch(MyLatch,
+							 WL_LATCH_SET | WL_EXIT_ON_PM_DEATH,
+							 -1L,
+							 WAIT_EVENT_WAIT_SAMPLER_MAIN);
+	}
+}
+
+/*
+ * Append samples to the shared ring buffer, overwriting the oldest ones.
+ */
+static void
+store_samples(WaitSample *samples, int nsamples)
+{
+	int			i;
+
+	LWLockAcquire(WaitSampleLock, LW_EXCLUSIVE);
+	for (i = 0; i < nsamples; i++)
+	{
+		WaitSamplerShmem->samples[WaitSamplerShmem->next %
+								  wait_sampling_history_size] = samples[i];
+		WaitSamplerShmem->next++;
+	}
+	LWLockRelease(WaitSampleLock);
+}
+
+/*
+ * SQL-callable function returning the contents of the sample history,
+ * oldest first.
+ */
+Datum
+pg_stat_get_wait_samples(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_WAIT_SAMPLES_COLS	6
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	WaitSample *copy;
+	uint64		first;
+	uint64		next;
+	uint64		pos;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (WaitSamplerShmem == NULL)
+	{
+		tuplestore_donestoring(tupstore);
+		return (Datum) 0;
+	}
+
+	/*
+	 * Copy the buffer out so that the sampler isn't held up while we build
+	 * the result.
+	 */
+	copy = (WaitSample *)
+		MemoryContextAllocHuge(CurrentMemoryContext,
+							   sizeof(WaitSample) * wait_sampling_history_size);
+	LWLockAcquire(WaitSampleLock, LW_SHARED);
+	next = WaitSamplerShmem->next;
+	memcpy(copy, WaitSamplerShmem->samples,
+		   sizeof(WaitSample) * wait_sampling_history_size);
+	LWLockRelease(WaitSampleLock);
+
+	first = next > (uint64) wait_sampling_history_size ?
+		next - wait_sampling_history_size : 0;
+
+	for (pos = first; pos < next; pos++)
+	{
+		WaitSample *sample = &copy[pos % wait_sampling_history_size];
+		Datum		values[PG_STAT_GET_WAIT_SAMPLES_COLS];
+		bool		nulls[PG_STAT_GET_WAIT_SAMPLES_COLS];
+		const char *wait_event_type;
+		const char *wait_event;
+
+		MemSet(values, 0, sizeof(values));
+		MemSet(nulls, 0, sizeof(nulls));
+
+		values[0] = TimestampTzGetDatum(sample->sample_time);
+		values[1] = Int32GetDatum(sample->pid);
+		values[2] = CStringGetTextDatum(GetBackendTypeDesc(sample->backend_type));
+
+		wait_event_type = pgstat_get_wait_event_type(sample->wait_event_info);
+		wait_event = pgstat_get_wait_event(sample->wait_event_info);
+		if (wait_event_type)
+			values[3] = CStringGetTextDatum(wait_event_type);
+		else
+			nulls[3] = true;
+		if (wait_event)
+			values[4] = CStringGetTextDatum(wait_event);
+		else
+			nulls[4] = true;
+
+		if (sample->query_id != 0)
+			values[5] = Int64GetDatum((int64) sample->query_id);
+		else
+			nulls[5] = true;
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	pfree(copy);
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
@@ -253,6 +253,10 @@ WalWriterMain(void)
 		else if (left_till_hibernate > 0)
 			left_till_hibernate--;
 
+		/* Make sure backends won't have to create WAL segments themselves */
+		if (XLogPreallocFutureSegments())
+			left_till_hibernate = LOOPS_UNTIL_HIBERNATE;
+
 		/*
 		 * Sleep until we are signaled or WalWriterDelay has elapsed.  If we
 		 * haven't done anything useful for quite some time, lengthen the
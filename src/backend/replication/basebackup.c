@@ -16,6 +16,16 @@
 #include <unistd.h>
 #include <time.h>
 
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "access/xlog_internal.h"	/* for pg_start/stop_backup */
 #include "catalog/pg_type.h"
 #include "common/file_perm.h"
@@ -40,11 +50,20 @@
 #include "storage/ipc.h"
 #include "storage/reinit.h"
 #include "utils/builtins.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/relcache.h"
 #include "utils/resowner.h"
 #include "utils/timestamp.h"
 
+typedef enum
+{
+	BACKUP_COMPRESSION_NONE,
+	BACKUP_COMPRESSION_GZIP,
+	BACKUP_COMPRESSION_LZ4,
+	BACKUP_COMPRESSION_ZSTD
+} BackupCompressionMethod;
+
 typedef struct
 {
 	const char *label;
@@ -56,6 +75,8 @@ typedef struct
 	bool		sendtblspcmapfile;
 	backup_manifest_option manifest;
 	pg_checksum_type manifest_checksum_type;
+	BackupCompressionMethod compression;
+	int			compression_level;	/* 0 means the method's default */
 } basebackup_options;
 
 static int64 sendTablespace(char *path, char *oid, bool sizeonly,
@@ -81,6 +102,10 @@ static int	compareWalFileNames(const ListCell *a, const ListCell *b);
 static void throttle(size_t increment);
 static void update_basebackup_progress(int64 delta);
 static bool is_checksummed_file(const char *fullpath, const char *filename);
+static void begin_tar_stream(void);
+static void send_tar_data(const char *data, size_t len);
+static void end_tar_stream(void);
+static void flush_compressed_data(void);
 static int	basebackup_read_file(int fd, char *buf, size_t nbytes, off_t offset,
 								 const char *filename, bool partial_read_ok);
 
@@ -130,6 +155,27 @@ static int64 backup_total = 0;
 /* Amount of backup data already streamed */
 static int64 backup_streamed = 0;
 
+/*
+ * Server-side compression of the tar streams.  The compression contexts and
+ * the output buffer are kept around for the life of the walsender, because
+ * an error in the middle of a backup gives us no chance to free them.
+ */
+static BackupCompressionMethod tar_compression = BACKUP_COMPRESSION_NONE;
+static int	tar_compression_level = 0;
+static char *compress_buf = NULL;
+static size_t compress_buf_size = 0;
+static size_t compress_buf_used = 0;
+#ifdef HAVE_LIBZ
+static z_stream *gzip_stream = NULL;
+#endif
+#ifdef USE_LZ4
+static LZ4F_cctx *lz4_ctx = NULL;
+static LZ4F_preferences_t lz4_prefs;
+#endif
+#ifdef USE_ZSTD
+static ZSTD_CCtx *zstd_ctx = NULL;
+#endif
+
 /*
  * Definition of one element part of an exclusion list, used for paths part
  * of checksum validation or base backups.  "name" is the name of the file
@@ -266,6 +312,8 @@ perform_base_backup(basebackup_options *opt)
 
 	backup_total = 0;
 	backup_streamed = 0;
+	tar_compression = opt->compression;
+	tar_compression_level = opt->compression_level;
 	pgstat_progress_start_command(PROGRESS_COMMAND_BASEBACKUP, InvalidOid);
 
 	/*
@@ -403,13 +451,8 @@ perform_base_backup(basebackup_options *opt)
 		foreach(lc, tablespaces)
 		{
 			tablespaceinfo *ti = (tablespaceinfo *) lfirst(lc);
-			StringInfoData buf;
 
-			/* Send CopyOutResponse message */
-			pq_beginmessage(&buf, 'H');
-			pq_sendbyte(&buf, 0);	/* overall format */
-			pq_sendint16(&buf, 0);	/* natts */
-			pq_endmessage(&buf);
+			begin_tar_stream();
 
 			if (ti->path == NULL)
 			{
@@ -455,7 +498,7 @@ perform_base_backup(basebackup_options *opt)
 				Assert(lnext(tablespaces, lc) == NULL);
 			}
 			else
-				pq_putemptymessage('c');	/* CopyDone */
+				end_tar_stream();
 
 			tblspc_streamed++;
 			pgstat_progress_update_param(PROGRESS_BASEBACKUP_TBLSPC_STREAMED,
@@ -638,10 +681,7 @@ perform_base_backup(basebackup_options *opt)
 											   len, pathbuf, true)) > 0)
 			{
 				CheckXLogRemoved(segno, tli);
-				/* Send the chunk as a CopyData message */
-				if (pq_putmessage('d', buf, cnt))
-					ereport(ERROR,
-							(errmsg("base backup could not send data, aborting backup")));
+				send_tar_data(buf, cnt);
 				update_basebackup_progress(cnt);
 
 				len += cnt;
@@ -705,8 +745,8 @@ perform_base_backup(basebackup_options *opt)
 			sendFileWithContent(pathbuf, "", &manifest);
 		}
 
-		/* Send CopyDone message for the last tar file */
-		pq_putemptymessage('c');
+		/* Terminate the last tar file */
+		end_tar_stream();
 	}
 
 	AddWALInfoToBackupManifest(&manifest, startptr, starttli, endptr, endtli);
@@ -772,6 +812,8 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 	bool		o_noverify_checksums = false;
 	bool		o_manifest = false;
 	bool		o_manifest_checksums = false;
+	bool		o_compression = false;
+	bool		o_compression_level = false;
 
 	MemSet(opt, 0, sizeof(*opt));
 	opt->manifest = MANIFEST_OPTION_NO;
@@ -904,6 +946,59 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 								optval)));
 			o_manifest_checksums = true;
 		}
+		else if (strcmp(defel->defname, "compression") == 0)
+		{
+			char	   *optval = strVal(defel->arg);
+			bool		supported = true;
+
+			if (o_compression)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			if (pg_strcasecmp(optval, "none") == 0)
+				opt->compression = BACKUP_COMPRESSION_NONE;
+			else if (pg_strcasecmp(optval, "gzip") == 0)
+			{
+				opt->compression = BACKUP_COMPRESSION_GZIP;
+#ifndef HAVE_LIBZ
+				supported = false;
+#endif
+			}
+			else if (pg_strcasecmp(optval, "lz4") == 0)
+			{
+				opt->compression = BACKUP_COMPRESSION_LZ4;
+#ifndef USE_LZ4
+				supported = false;
+#endif
+			}
+			else if (pg_strcasecmp(optval, "zstd") == 0)
+			{
+				opt->compression = BACKUP_COMPRESSION_ZSTD;
+#ifndef USE_ZSTD
+				supported = false;
+#endif
+			}
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("unrecognized compression algorithm: \"%s\"",
+								optval)));
+			if (!supported)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("compression algorithm \"%s\" is not supported by this build",
+								optval)));
+			o_compression = true;
+		}
+		else if (strcmp(defel->defname, "compression_level") == 0)
+		{
+			if (o_compression_level)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->compression_level = intVal(defel->arg);
+			o_compression_level = true;
+		}
 		else
 			elog(ERROR, "option \"%s\" not recognized",
 				 defel->defname);
@@ -918,6 +1013,34 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 					 errmsg("manifest checksums require a backup manifest")));
 		opt->manifest_checksum_type = CHECKSUM_TYPE_NONE;
 	}
+	if (o_compression_level)
+	{
+		int			maxlevel = 0;
+
+		switch (opt->compression)
+		{
+			case BACKUP_COMPRESSION_NONE:
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("compression level requires a compression algorithm")));
+				break;
+			case BACKUP_COMPRESSION_GZIP:
+				maxlevel = 9;
+				break;
+			case BACKUP_COMPRESSION_LZ4:
+				maxlevel = 12;
+				break;
+			case BACKUP_COMPRESSION_ZSTD:
+				maxlevel = 22;
+				break;
+		}
+		if (opt->compression_level < 1 || opt->compression_level > maxlevel)
+			ereport(ERROR,
+					(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+					 errmsg("%d is outside the valid range for parameter \"%s\" (%d .. %d)",
+							opt->compression_level, "COMPRESSION_LEVEL",
+							1, maxlevel)));
+	}
 }
 
 
@@ -1124,8 +1247,7 @@ sendFileWithContent(const char *filename, const char *content,
 	statbuf.st_size = len;
 
 	_tarWriteHeader(filename, NULL, &statbuf, false);
-	/* Send the contents as a CopyData message */
-	pq_putmessage('d', content, len);
+	send_tar_data(content, len);
 	update_basebackup_progress(len);
 
 	/* Pad to a multiple of the tar block size. */
@@ -1135,7 +1257,7 @@ sendFileWithContent(const char *filename, const char *content,
 		char		buf[TAR_BLOCK_SIZE];
 
 		MemSet(buf, 0, pad);
-		pq_putmessage('d', buf, pad);
+		send_tar_data(buf, pad);
 		update_basebackup_progress(pad);
 	}
 
@@ -1765,10 +1887,7 @@ sendFile(const char *readfilename, const char *tarfilename,
 			}
 		}
 
-		/* Send the chunk as a CopyData message */
-		if (pq_putmessage('d', buf, cnt))
-			ereport(ERROR,
-					(errmsg("base backup could not send data, aborting backup")));
+		send_tar_data(buf, cnt);
 		update_basebackup_progress(cnt);
 
 		/* Also feed it to the checksum machinery. */
@@ -1786,7 +1905,7 @@ sendFile(const char *readfilename, const char *tarfilename,
 		while (len < statbuf->st_size)
 		{
 			cnt = Min(sizeof(buf), statbuf->st_size - len);
-			pq_putmessage('d', buf, cnt);
+			send_tar_data(buf, cnt);
 			if (pg_checksum_update(&checksum_ctx, (uint8 *) buf, cnt) < 0)
 				elog(ERROR, "could not update checksum of base backup");
 			update_basebackup_progress(cnt);
@@ -1804,7 +1923,7 @@ sendFile(const char *readfilename, const char *tarfilename,
 	if (pad > 0)
 	{
 		MemSet(buf, 0, pad);
-		pq_putmessage('d', buf, pad);
+		send_tar_data(buf, pad);
 		update_basebackup_progress(pad);
 	}
 
@@ -1862,7 +1981,7 @@ _tarWriteHeader(const char *filename, const char *linktarget,
 				elog(ERROR, "unrecognized tar error: %d", rc);
 		}
 
-		pq_putmessage('d', h, sizeof(h));
+		send_tar_data(h, sizeof(h));
 		update_basebackup_progress(sizeof(h));
 	}
 
@@ -1888,6 +2007,341 @@ _tarWriteDir(const char *pathbuf, int basepathlen, struct stat *statbuf,
 	return _tarWriteHeader(pathbuf + basepathlen + 1, NULL, statbuf, sizeonly);
 }
 
+/*
+ * Start a tar stream, by sending a CopyOutResponse message, and set up the
+ * compression of its contents if requested.
+ */
+static void
+begin_tar_stream(void)
+{
+	StringInfoData buf;
+	size_t		bufsize = TAR_SEND_SIZE;
+
+	/* Send CopyOutResponse message */
+	pq_beginmessage(&buf, 'H');
+	pq_sendbyte(&buf, 0);		/* overall format */
+	pq_sendint16(&buf, 0);		/* natts */
+	pq_endmessage(&buf);
+
+	/*
+	 * A compression context left behind by a backup that failed halfway is
+	 * released or reset here.
+	 */
+	switch (tar_compression)
+	{
+		case BACKUP_COMPRESSION_NONE:
+			return;
+#ifdef HAVE_LIBZ
+		case BACKUP_COMPRESSION_GZIP:
+			if (gzip_stream == NULL)
+				gzip_stream = MemoryContextAllocZero(TopMemoryContext,
+													 sizeof(z_stream));
+			else if (gzip_stream->state != NULL)
+				deflateEnd(gzip_stream);
+
+			/* windowBits 15 + 16 asks for a gzip header and trailer */
+			if (deflateInit2(gzip_stream,
+							 tar_compression_level > 0 ?
+							 tar_compression_level : Z_DEFAULT_COMPRESSION,
+							 Z_DEFLATED, 15 + 16, 8,
+							 Z_DEFAULT_STRATEGY) != Z_OK)
+				ereport(ERROR,
+						(errmsg("could not initialize compression library")));
+			break;
+#endif
+#ifdef USE_LZ4
+		case BACKUP_COMPRESSION_LZ4:
+			{
+				size_t		ret;
+
+				if (lz4_ctx != NULL)
+				{
+					LZ4F_freeCompressionContext(lz4_ctx);
+					lz4_ctx = NULL;
+				}
+				ret = LZ4F_createCompressionContext(&lz4_ctx, LZ4F_VERSION);
+				if (LZ4F_isError(ret))
+					ereport(ERROR,
+							(errmsg("could not create LZ4 compression context: %s",
+									LZ4F_getErrorName(ret))));
+
+				MemSet(&lz4_prefs, 0, sizeof(lz4_prefs));
+				lz4_prefs.compressionLevel = tar_compression_level;
+
+				/*
+				 * Each call to LZ4F_compressUpdate() needs room for the worst
+				 * case output of the data it's given, see send_tar_data().
+				 */
+				bufsize = 2 * Max(LZ4F_HEADER_SIZE_MAX,
+								  LZ4F_compressBound(TAR_SEND_SIZE, &lz4_prefs));
+			}
+			break;
+#endif
+#ifdef USE_ZSTD
+		case BACKUP_COMPRESSION_ZSTD:
+			{
+				size_t		ret;
+
+				if (zstd_ctx == NULL)
+				{
+					zstd_ctx = ZSTD_createCCtx();
+					if (zstd_ctx == NULL)
+						ereport(ERROR,
+								(errcode(ERRCODE_OUT_OF_MEMORY),
+								 errmsg("out of memory")));
+				}
+				else
+					ZSTD_CCtx_reset(zstd_ctx, ZSTD_reset_session_and_parameters);
+
+				ret = ZSTD_CCtx_setParameter(zstd_ctx, ZSTD_c_compressionLevel,
+											 tar_compression_level > 0 ?
+											 tar_compression_level :
+											 ZSTD_CLEVEL_DEFAULT);
+				if (ZSTD_isError(ret))
+					ereport(ERROR,
+							(errmsg("could not set zstd compression level: %s",
+									ZSTD_getErrorName(ret))));
+
+				bufsize = ZSTD_CStreamOutSize();
+			}
+			break;
+#endif
+		default:
+			elog(ERROR, "unrecognized compression method: %d",
+				 (int) tar_compression);
+	}
+
+	if (compress_buf_size < bufsize)
+	{
+		if (compress_buf != NULL)
+			pfree(compress_buf);
+		compress_buf = MemoryContextAlloc(TopMemoryContext, bufsize);
+		compress_buf_size = bufsize;
+	}
+	compress_buf_used = 0;
+
+#ifdef USE_LZ4
+	if (tar_compression == BACKUP_COMPRESSION_LZ4)
+	{
+		size_t		ret;
+
+		/* Write the frame header */
+		ret = LZ4F_compressBegin(lz4_ctx, compress_buf, compress_buf_size,
+								 &lz4_prefs);
+		if (LZ4F_isError(ret))
+			ereport(ERROR,
+					(errmsg("could not compress data: %s",
+							LZ4F_getErrorName(ret))));
+		compress_buf_used = ret;
+	}
+#endif
+}
+
+/*
+ * Send data of the current tar stream, compressing it if requested.  The
+ * compressed data is sent in CopyData messages of up to the size of the
+ * output buffer.
+ */
+static void
+send_tar_data(const char *data, size_t len)
+{
+	switch (tar_compression)
+	{
+		case BACKUP_COMPRESSION_NONE:
+			/* Send the chunk as a CopyData message */
+			if (pq_putmessage('d', data, len))
+				ereport(ERROR,
+						(errmsg("base backup could not send data, aborting backup")));
+			break;
+#ifdef HAVE_LIBZ
+		case BACKUP_COMPRESSION_GZIP:
+			gzip_stream->next_in = (Bytef *) data;
+			gzip_stream->avail_in = len;
+			while (gzip_stream->avail_in > 0)
+			{
+				if (compress_buf_used == compress_buf_size)
+					flush_compressed_data();
+				gzip_stream->next_out = (Bytef *) compress_buf + compress_buf_used;
+				gzip_stream->avail_out = compress_buf_size - compress_buf_used;
+				if (deflate(gzip_stream, Z_NO_FLUSH) == Z_STREAM_ERROR)
+					ereport(ERROR,
+							(errmsg("could not compress data: %s",
+									gzip_stream->msg)));
+				compress_buf_used = compress_buf_size - gzip_stream->avail_out;
+			}
+			break;
+#endif
+#ifdef USE_LZ4
+		case BACKUP_COMPRESSION_LZ4:
+			while (len > 0)
+			{
+				size_t		chunk = Min(len, TAR_SEND_SIZE);
+				size_t		ret;
+
+				if (compress_buf_size - compress_buf_used <
+					LZ4F_compressBound(chunk, &lz4_prefs))
+					flush_compressed_data();
+				ret = LZ4F_compressUpdate(lz4_ctx,
+										  compress_buf + compress_buf_used,
+										  compress_buf_size - compress_buf_used,
+										  data, chunk, NULL);
+				if (LZ4F_isError(ret))
+					ereport(ERROR,
+							(errmsg("could not compress data: %s",
+									LZ4F_getErrorName(ret))));
+				compress_buf_used += ret;
+				data += chunk;
+				len -= chunk;
+			}
+			break;
+#endif
+#ifdef USE_ZSTD
+		case BACKUP_COMPRESSION_ZSTD:
+			{
+				ZSTD_inBuffer in = {data, len, 0};
+
+				while (in.pos < in.size)
+				{
+					ZSTD_outBuffer out;
+					size_t		ret;
+
+					if (compress_buf_used == compress_buf_size)
+						flush_compressed_data();
+					out.dst = compress_buf + compress_buf_used;
+					out.size = compress_buf_size - compress_buf_used;
+					out.pos = 0;
+					ret = ZSTD_compressStream2(zstd_ctx, &out, &in,
+											   ZSTD_e_continue);
+					if (ZSTD_isError(ret))
+						ereport(ERROR,
+								(errmsg("could not compress data: %s",
+										ZSTD_getErrorName(ret))));
+					compress_buf_used += out.pos;
+				}
+			}
+			break;
+#endif
+		default:
+			elog(ERROR, "unrecognized compression method: %d",
+				 (int) tar_compression);
+	}
+}
+
+/*
+ * End the current tar stream, by finishing its compression if any and
+ * sending a CopyDone message.
+ */
+static void
+end_tar_stream(void)
+{
+	if (tar_compression != BACKUP_COMPRESSION_NONE)
+	{
+		char		zerobuf[2 * TAR_BLOCK_SIZE];
+
+		/*
+		 * The client can't add the end-of-archive blocks to a compressed
+		 * archive without decompressing it, so add them ourselves.
+		 */
+		MemSet(zerobuf, 0, sizeof(zerobuf));
+		send_tar_data(zerobuf, sizeof(zerobuf));
+
+		switch (tar_compression)
+		{
+#ifdef HAVE_LIBZ
+			case BACKUP_COMPRESSION_GZIP:
+				for (;;)
+				{
+					int			ret;
+
+					if (compress_buf_used == compress_buf_size)
+						flush_compressed_data();
+					gzip_stream->next_out = (Bytef *) compress_buf + compress_buf_used;
+					gzip_stream->avail_out = compress_buf_size - compress_buf_used;
+					ret = deflate(gzip_stream, Z_FINISH);
+					if (ret == Z_STREAM_ERROR)
+						ereport(ERROR,
+								(errmsg("could not compress data: %s",
+										gzip_stream->msg)));
+					compress_buf_used = compress_buf_size - gzip_stream->avail_out;
+					if (ret == Z_STREAM_END)
+						break;
+				}
+				deflateEnd(gzip_stream);
+				break;
+#endif
+#ifdef USE_LZ4
+			case BACKUP_COMPRESSION_LZ4:
+				{
+					size_t		ret;
+
+					if (compress_buf_size - compress_buf_used <
+						LZ4F_compressBound(0, &lz4_prefs))
+						flush_compressed_data();
+					ret = LZ4F_compressEnd(lz4_ctx,
+										   compress_buf + compress_buf_used,
+										   compress_buf_size - compress_buf_used,
+										   NULL);
+					if (LZ4F_isError(ret))
+						ereport(ERROR,
+								(errmsg("could not compress data: %s",
+										LZ4F_getErrorName(ret))));
+					compress_buf_used += ret;
+					LZ4F_freeCompressionContext(lz4_ctx);
+					lz4_ctx = NULL;
+				}
+				break;
+#endif
+#ifdef USE_ZSTD
+			case BACKUP_COMPRESSION_ZSTD:
+				for (;;)
+				{
+					ZSTD_inBuffer in = {NULL, 0, 0};
+					ZSTD_outBuffer out;
+					size_t		ret;
+
+					if (compress_buf_used == compress_buf_size)
+						flush_compressed_data();
+					out.dst = compress_buf + compress_buf_used;
+					out.size = compress_buf_size - compress_buf_used;
+					out.pos = 0;
+					ret = ZSTD_compressStream2(zstd_ctx, &out, &in, ZSTD_e_end);
+					if (ZSTD_isError(ret))
+						ereport(ERROR,
+								(errmsg("could not compress data: %s",
+										ZSTD_getErrorName(ret))));
+					compress_buf_used += out.pos;
+					if (ret == 0)
+						break;
+				}
+				break;
+#endif
+			default:
+				elog(ERROR, "unrecognized compression method: %d",
+					 (int) tar_compression);
+		}
+
+		flush_compressed_data();
+	}
+
+	pq_putemptymessage('c');	/* CopyDone */
+}
+
+/*
+ * Send the compressed data accumulated in the output buffer as a CopyData
+ * message.
+ */
+static void
+flush_compressed_data(void)
+{
+	if (compress_buf_used > 0)
+	{
+		if (pq_putmessage('d', compress_buf, compress_buf_used))
+			ereport(ERROR,
+					(errmsg("base backup could not send data, aborting backup")));
+		compress_buf_used = 0;
+	}
+}
+
 /*
  * Increment the network transfer counter by the given number of bytes,
  * and sleep if necessary to comply with the requested network transfer
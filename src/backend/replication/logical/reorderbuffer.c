@@ -91,6 +91,7 @@
 #include "access/xact.h"
 #include "access/xlog_internal.h"
 #include "catalog/catalog.h"
+#include "common/pg_lzcompress.h"
 #include "lib/binaryheap.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -170,10 +171,18 @@ typedef struct ReorderBufferToastEnt
 									 * main tup */
 } ReorderBufferToastEnt;
 
-/* Disk serialization support datastructures */
+/*
+ * Disk serialization support datastructures
+ *
+ * size is the number of bytes the change occupies in the spill file,
+ * including this header.  rawsize is what it occupies once restored into
+ * memory; if it's larger than size, the data following the header is
+ * compressed with pglz.
+ */
 typedef struct ReorderBufferDiskChange
 {
 	Size		size;
+	Size		rawsize;
 	ReorderBufferChange change;
 	/* data follows */
 } ReorderBufferDiskChange;
@@ -206,6 +215,7 @@ typedef struct ReorderBufferDiskChange
  * like.
  */
 int			logical_decoding_work_mem;
+int			logical_decoding_spill_compression = LOGICAL_DECODING_SPILL_COMPRESSION_OFF;
 static const Size max_changes_in_memory = 4096; /* XXX for restore only */
 
 /* ---------------------------------------
@@ -3415,6 +3425,34 @@ ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 	}
 
 	ondisk->size = sz;
+	ondisk->rawsize = sz;
+
+	/*
+	 * Compress the variable part of the change if requested.  The compressed
+	 * data is first put after the raw data and then moved into place, so that
+	 * we need only the one output buffer.
+	 */
+	if (logical_decoding_spill_compression != LOGICAL_DECODING_SPILL_COMPRESSION_OFF &&
+		sz > sizeof(ReorderBufferDiskChange))
+	{
+		int32		rawlen = sz - sizeof(ReorderBufferDiskChange);
+		int32		complen;
+		char	   *compressed;
+
+		ReorderBufferSerializeReserve(rb, sz + PGLZ_MAX_OUTPUT(rawlen));
+		/* might have been reallocated above */
+		ondisk = (ReorderBufferDiskChange *) rb->outbuf;
+		compressed = rb->outbuf + sz;
+
+		complen = pglz_compress(rb->outbuf + sizeof(ReorderBufferDiskChange),
+								rawlen, compressed, PGLZ_strategy_default);
+		if (complen >= 0)
+		{
+			memcpy(rb->outbuf + sizeof(ReorderBufferDiskChange), compressed,
+				   complen);
+			ondisk->size = sizeof(ReorderBufferDiskChange) + complen;
+		}
+	}
 
 	errno = 0;
 	pgstat_report_wait_start(WAIT_EVENT_REORDER_BUFFER_WRITE);
@@ -3711,6 +3749,7 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 	{
 		int			readBytes;
 		ReorderBufferDiskChange *ondisk;
+		bool		compressed;
 
 		if (*fd == -1)
 		{
@@ -3780,12 +3819,25 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 
 		ondisk = (ReorderBufferDiskChange *) rb->outbuf;
 
-		ReorderBufferSerializeReserve(rb,
-									  sizeof(ReorderBufferDiskChange) + ondisk->size);
+		if (ondisk->size < sizeof(ReorderBufferDiskChange) ||
+			ondisk->rawsize < ondisk->size)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("invalid change size in reorderbuffer spill file")));
+
+		/*
+		 * A compressed change is read in after the space for its restored
+		 * form, and decompressed into place below.
+		 */
+		compressed = ondisk->size < ondisk->rawsize;
+		ReorderBufferSerializeReserve(rb, compressed ?
+									  ondisk->rawsize + ondisk->size :
+									  ondisk->size);
 		ondisk = (ReorderBufferDiskChange *) rb->outbuf;
 
 		readBytes = FileRead(file->vfd,
-							 rb->outbuf + sizeof(ReorderBufferDiskChange),
+							 rb->outbuf + (compressed ? ondisk->rawsize :
+										   sizeof(ReorderBufferDiskChange)),
 							 ondisk->size - sizeof(ReorderBufferDiskChange),
 							 file->curOffset,
 							 WAIT_EVENT_REORDER_BUFFER_READ);
@@ -3803,6 +3855,18 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 
 		file->curOffset += readBytes;
 
+		if (compressed)
+		{
+			int32		rawlen = ondisk->rawsize - sizeof(ReorderBufferDiskChange);
+
+			if (pglz_decompress(rb->outbuf + ondisk->rawsize, readBytes,
+								rb->outbuf + sizeof(ReorderBufferDiskChange),
+								rawlen, true) != rawlen)
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("compressed data in reorderbuffer spill file is corrupt")));
+		}
+
 		/*
 		 * ok, read a full change from disk, now restore it into proper
 		 * in-memory format
@@ -4344,7 +4408,7 @@ ReorderBufferToastReplace(ReorderBuffer *rb, ReorderBufferTXN *txn,
 				   VARSIZE(chunk) - VARHDRSZ);
 			data_done += VARSIZE(chunk) - VARHDRSZ;
 		}
-		Assert(data_done == toast_pointer.va_extsize);
+		Assert(data_done == VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer));
 
 		/* make sure its marked as compressed or not */
 		if (VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer))
@@ -96,6 +96,7 @@
 #include "catalog/pg_type.h"
 #include "commands/copy.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
 #include "parser/parse_relation.h"
 #include "pgstat.h"
 #include "replication/logicallauncher.h"
@@ -737,6 +738,84 @@ fetch_remote_table_info(char *nspname, char *relname,
 	pfree(cmd.data);
 }
 
+/*
+ * Get the row filters that the subscription's publications apply to a
+ * remote relation, as a list of SQL expressions that a row has to satisfy
+ * one of.  Returns NIL if all rows are published.
+ */
+static List *
+fetch_remote_table_rowfilters(LogicalRepRelation *lrel)
+{
+	WalRcvExecResult *res;
+	StringInfoData cmd;
+	TupleTableSlot *slot;
+	Oid			filterRow[] = {TEXTOID};
+	List	   *filters = NIL;
+	bool		first = true;
+	ListCell   *lc;
+
+	/* Publishers before 14 don't have row filters. */
+	if (walrcv_server_version(wrconn) < 140000)
+		return NIL;
+
+	/*
+	 * A partition's changes can be published through the filter of one of
+	 * its ancestors.
+	 */
+	initStringInfo(&cmd);
+	appendStringInfo(&cmd,
+					 "SELECT DISTINCT CASE WHEN p.puballtables THEN NULL"
+					 "       ELSE pg_catalog.pg_get_expr(pr.prqual, pr.prrelid) END"
+					 "  FROM pg_catalog.pg_publication p"
+					 "  LEFT JOIN pg_catalog.pg_publication_rel pr"
+					 "       ON (pr.prpubid = p.oid AND pr.prrelid IN"
+					 "           (SELECT relid FROM pg_catalog.pg_partition_ancestors(%u)))"
+					 " WHERE (p.puballtables OR pr.prrelid IS NOT NULL)"
+					 "   AND p.pubname IN (",
+					 lrel->remoteid);
+	foreach(lc, MySubscription->publications)
+	{
+		char	   *pubname = strVal(lfirst(lc));
+
+		if (!first)
+			appendStringInfoString(&cmd, ", ");
+		appendStringInfoString(&cmd, quote_literal_cstr(pubname));
+		first = false;
+	}
+	appendStringInfoChar(&cmd, ')');
+
+	res = walrcv_exec(wrconn, cmd.data, lengthof(filterRow), filterRow);
+
+	if (res->status != WALRCV_OK_TUPLES)
+		ereport(ERROR,
+				(errmsg("could not fetch row filters for table \"%s.%s\" from publisher: %s",
+						lrel->nspname, lrel->relname, res->err)));
+
+	slot = MakeSingleTupleTableSlot(res->tupledesc, &TTSOpsMinimalTuple);
+	while (tuplestore_gettupleslot(res->tuplestore, true, false, slot))
+	{
+		bool		isnull;
+		Datum		filter = slot_getattr(slot, 1, &isnull);
+
+		/* A publication without a filter publishes all rows. */
+		if (isnull)
+		{
+			list_free_deep(filters);
+			filters = NIL;
+			break;
+		}
+
+		filters = lappend(filters, TextDatumGetCString(filter));
+		ExecClearTuple(slot);
+	}
+	ExecDropSingleTupleTableSlot(slot);
+
+	walrcv_clear_result(res);
+	pfree(cmd.data);
+
+	return filters;
+}
+
 /*
  * Copy existing data of a table from publisher.
  *
@@ -751,11 +830,14 @@ copy_table(Relation rel)
 	StringInfoData cmd;
 	CopyFromState cstate;
 	List	   *attnamelist;
+	List	   *options = NIL;
+	List	   *rowfilters;
 	ParseState *pstate;
 
 	/* Get the publisher relation info. */
 	fetch_remote_table_info(get_namespace_name(RelationGetNamespace(rel)),
 							RelationGetRelationName(rel), &lrel);
+	rowfilters = fetch_remote_table_rowfilters(&lrel);
 
 	/* Put the relation into relmap. */
 	logicalrep_relmap_update(&lrel);
@@ -766,14 +848,17 @@ copy_table(Relation rel)
 
 	/* Start copy on the publisher. */
 	initStringInfo(&cmd);
-	if (lrel.relkind == RELKIND_RELATION)
+	if (lrel.relkind == RELKIND_RELATION && rowfilters == NIL)
 		appendStringInfo(&cmd, "COPY %s TO STDOUT",
 						 quote_qualified_identifier(lrel.nspname, lrel.relname));
 	else
 	{
+		ListCell   *lc;
+
 		/*
-		 * For non-tables, we need to do COPY (SELECT ...), but we can't just
-		 * do SELECT * because we need to not copy generated columns.
+		 * For non-tables and for filtered tables, we need to do COPY (SELECT
+		 * ...), but we can't just do SELECT * because we need to not copy
+		 * generated columns.
 		 */
 		appendStringInfoString(&cmd, "COPY (SELECT ");
 		for (int i = 0; i < lrel.natts; i++)
@@ -782,9 +867,37 @@ copy_table(Relation rel)
 			if (i < lrel.natts - 1)
 				appendStringInfoString(&cmd, ", ");
 		}
-		appendStringInfo(&cmd, " FROM %s) TO STDOUT",
+		appendStringInfo(&cmd, " FROM %s%s",
+						 lrel.relkind == RELKIND_RELATION ? "ONLY " : "",
 						 quote_qualified_identifier(lrel.nspname, lrel.relname));
+
+		/* Only copy the rows that pass one of the row filters. */
+		foreach(lc, rowfilters)
+		{
+			appendStringInfoString(&cmd,
+								   foreach_current_index(lc) == 0 ?
+								   " WHERE " : " OR ");
+			appendStringInfo(&cmd, "(%s)", (char *) lfirst(lc));
+		}
+		appendStringInfoString(&cmd, ") TO STDOUT");
 	}
+
+	/*
+	 * If the subscription wants data in binary format, copy the table in
+	 * binary format too, which saves converting every value to text and
+	 * back.  Unlike the apply worker, binary COPY doesn't fall back to text
+	 * for types lacking binary send or receive functions, it fails.  Older
+	 * publishers never did this, so keep copying in text from them rather
+	 * than start failing existing subscriptions.
+	 */
+	if (MySubscription->binary && walrcv_server_version(wrconn) >= 140000)
+	{
+		appendStringInfoString(&cmd, " WITH (FORMAT binary)");
+		options = lappend(options,
+						  makeDefElem("format",
+									  (Node *) makeString("binary"), -1));
+	}
+
 	res = walrcv_exec(wrconn, cmd.data, 0, NULL);
 	pfree(cmd.data);
 	if (res->status != WALRCV_OK_COPY_OUT)
@@ -800,7 +913,8 @@ copy_table(Relation rel)
 										 NULL, false, false);
 
 	attnamelist = make_copy_attnamelist(relmapentry);
-	cstate = BeginCopyFrom(pstate, rel, NULL, NULL, false, copy_read_data, attnamelist, NIL);
+	cstate = BeginCopyFrom(pstate, rel, NULL, NULL, false, copy_read_data,
+						   attnamelist, options);
 
 	/* Do the copy */
 	(void) CopyFrom(cstate);
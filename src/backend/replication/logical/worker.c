@@ -933,7 +933,6 @@ apply_handle_stream_commit(StringInfo s)
 	StringInfoData s2;
 	int			nchanges;
 	char		path[MAXPGPATH];
-	char	   *buffer = NULL;
 	bool		found;
 	LogicalRepCommitData commit_data;
 	StreamXidHash *ent;
@@ -965,7 +964,6 @@ apply_handle_stream_commit(StringInfo s)
 	Assert(found);
 	fd = BufFileOpenShared(ent->stream_fileset, path, O_RDONLY);
 
-	buffer = palloc(BLCKSZ);
 	initStringInfo(&s2);
 
 	MemoryContextSwitchTo(oldcxt);
@@ -1007,19 +1005,20 @@ apply_handle_stream_commit(StringInfo s)
 
 		Assert(len > 0);
 
-		/* make sure we have sufficiently large buffer */
-		buffer = repalloc(buffer, len);
-
-		/* and finally read the data into the buffer */
-		if (BufFileRead(fd, buffer, len) != len)
+		/*
+		 * Read the data straight into the stringinfo, which only ever grows,
+		 * so that large transactions don't pay for a reallocation and an
+		 * extra copy of every change.
+		 */
+		resetStringInfo(&s2);
+		enlargeStringInfo(&s2, len);
+		if (BufFileRead(fd, s2.data, len) != len)
 			ereport(ERROR,
 					(errcode_for_file_access(),
 					 errmsg("could not read from streaming transaction's changes file \"%s\": %m",
 							path)));
-
-		/* copy the buffer to the stringinfo and call apply_dispatch */
-		resetStringInfo(&s2);
-		appendBinaryStringInfo(&s2, buffer, len);
+		s2.len = len;
+		s2.data[len] = '\0';
 
 		/* Ensure we are reading the data into our memory context. */
 		oldcxt = MemoryContextSwitchTo(ApplyMessageContext);
@@ -1039,7 +1038,6 @@ apply_handle_stream_commit(StringInfo s)
 
 	BufFileClose(fd);
 
-	pfree(buffer);
 	pfree(s2.data);
 
 	elog(DEBUG1, "replayed %d (all) changes from file \"%s\"",
@@ -15,16 +15,22 @@
 #include "access/tupconvert.h"
 #include "catalog/partition.h"
 #include "catalog/pg_publication.h"
+#include "catalog/pg_publication_rel.h"
 #include "commands/defrem.h"
+#include "executor/executor.h"
 #include "fmgr.h"
+#include "nodes/makefuncs.h"
+#include "optimizer/optimizer.h"
 #include "replication/logical.h"
 #include "replication/logicalproto.h"
 #include "replication/origin.h"
 #include "replication/pgoutput.h"
+#include "utils/builtins.h"
 #include "utils/int8.h"
 #include "utils/inval.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/rel.h"
 #include "utils/syscache.h"
 #include "utils/varlena.h"
 
@@ -83,6 +89,12 @@ static void send_relation_and_attrs(Relation relation, TransactionId xid,
  *
  * For partitions, 'pubactions' considers not only the table's own
  * publications, but also those of all of its ancestors.
+ *
+ * 'rowfilter' is the combination of the WHERE clauses of the publications
+ * the relation is published through, expressed in terms of the relation
+ * changes are published as, or NULL if all rows are published.  It lives in
+ * 'rowfilter_cxt'.  The executor state used to evaluate it is built when
+ * it's first needed, and rebuilt after the relation changes.
  */
 typedef struct RelationSyncEntry
 {
@@ -114,6 +126,13 @@ typedef struct RelationSyncEntry
 	 * having identical TupleDesc.
 	 */
 	TupleConversionMap *map;
+
+	Node	   *rowfilter;
+	MemoryContext rowfilter_cxt;
+	bool		rowfilter_valid;	/* are estate etc. up to date? */
+	EState	   *estate;
+	ExprState  *exprstate;
+	TupleTableSlot *scantuple;
 } RelationSyncEntry;
 
 /* Map used to remember which relation schemas we sent. */
@@ -129,6 +148,13 @@ static void set_schema_sent_in_streamed_txn(RelationSyncEntry *entry,
 											TransactionId xid);
 static bool get_schema_sent_in_streamed_txn(RelationSyncEntry *entry,
 											TransactionId xid);
+static Node *get_publication_rowfilter(Oid pubid, Oid relid,
+									   Oid publish_as_relid);
+static bool pgoutput_row_filter(Relation relation, HeapTuple tuple,
+								RelationSyncEntry *entry);
+static HeapTuple pgoutput_fill_unchanged_toast(Relation relation,
+											   HeapTuple oldtuple,
+											   HeapTuple newtuple);
 
 /*
  * Specify output plugin callbacks
@@ -558,6 +584,9 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 						tuple = execute_attr_map_tuple(tuple, relentry->map);
 				}
 
+				if (!pgoutput_row_filter(relation, tuple, relentry))
+					break;
+
 				OutputPluginPrepareWrite(ctx, true);
 				logicalrep_write_insert(ctx->out, xid, relation, tuple,
 										data->binary);
@@ -583,6 +612,53 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 					}
 				}
 
+				/*
+				 * With a row filter, the old and the new version of the row
+				 * may fall on different sides of it.  If the old row isn't
+				 * logged, its replica identity is the same as the new one's,
+				 * and as the filter can only use those columns, so is the
+				 * result.  If only one side matches, the subscriber either
+				 * never saw the row or must forget it, so send the update as
+				 * an insert of the new row or a delete of the old one.
+				 */
+				if (relentry->rowfilter != NULL)
+				{
+					bool		old_match;
+					bool		new_match;
+
+					if (oldtuple)
+						newtuple = pgoutput_fill_unchanged_toast(relation,
+																 oldtuple,
+																 newtuple);
+
+					new_match = pgoutput_row_filter(relation, newtuple,
+													relentry);
+					old_match = oldtuple ?
+						pgoutput_row_filter(relation, oldtuple, relentry) :
+						new_match;
+
+					if (!old_match && !new_match)
+						break;
+
+					if (!old_match)
+					{
+						OutputPluginPrepareWrite(ctx, true);
+						logicalrep_write_insert(ctx->out, xid, relation,
+												newtuple, data->binary);
+						OutputPluginWrite(ctx, true);
+						break;
+					}
+
+					if (!new_match)
+					{
+						OutputPluginPrepareWrite(ctx, true);
+						logicalrep_write_delete(ctx->out, xid, relation,
+												oldtuple, data->binary);
+						OutputPluginWrite(ctx, true);
+						break;
+					}
+				}
+
 				OutputPluginPrepareWrite(ctx, true);
 				logicalrep_write_update(ctx->out, xid, relation, oldtuple,
 										newtuple, data->binary);
@@ -604,6 +680,9 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 						oldtuple = execute_attr_map_tuple(oldtuple, relentry->map);
 				}
 
+				if (!pgoutput_row_filter(relation, oldtuple, relentry))
+					break;
+
 				OutputPluginPrepareWrite(ctx, true);
 				logicalrep_write_delete(ctx->out, xid, relation, oldtuple,
 										data->binary);
@@ -961,6 +1040,12 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 		entry->pubactions.pubinsert = entry->pubactions.pubupdate =
 			entry->pubactions.pubdelete = entry->pubactions.pubtruncate = false;
 		entry->publish_as_relid = InvalidOid;
+		entry->rowfilter = NULL;
+		entry->rowfilter_cxt = NULL;
+		entry->rowfilter_valid = false;
+		entry->estate = NULL;
+		entry->exprstate = NULL;
+		entry->scantuple = NULL;
 	}
 
 	/* Validate the entry */
@@ -969,6 +1054,9 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 		List	   *pubids = GetRelationPublications(relid);
 		ListCell   *lc;
 		Oid			publish_as_relid = relid;
+		List	   *rowfilter_pubs = NIL;
+		List	   *rowfilter_relids = NIL;
+		bool		rowfilter_all = false;
 
 		/* Reload publications if needed before use. */
 		if (!publications_valid)
@@ -991,6 +1079,7 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 		{
 			Publication *pub = lfirst(lc);
 			bool		publish = false;
+			Oid			member_relid = relid;
 
 			if (pub->alltables)
 			{
@@ -1026,13 +1115,20 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 											pub->oid))
 						{
 							ancestor_published = true;
+							member_relid = ancestor;
 							if (pub->pubviaroot)
 								publish_as_relid = ancestor;
 						}
 					}
 				}
 
-				if (list_member_oid(pubids, pub->oid) || ancestor_published)
+				/* The relation's own row filter wins over an ancestor's */
+				if (list_member_oid(pubids, pub->oid))
+				{
+					publish = true;
+					member_relid = relid;
+				}
+				else if (ancestor_published)
 					publish = true;
 			}
 
@@ -1048,15 +1144,71 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 				entry->pubactions.pubupdate |= pub->pubactions.pubupdate;
 				entry->pubactions.pubdelete |= pub->pubactions.pubdelete;
 				entry->pubactions.pubtruncate |= pub->pubactions.pubtruncate;
+
+				/*
+				 * Remember where to find the publication's row filter.  A
+				 * publication without one publishes all rows, whatever the
+				 * others say.
+				 */
+				if (pub->alltables ||
+					!PublicationRelHasRowFilter(pub->oid, member_relid))
+					rowfilter_all = true;
+				else
+				{
+					rowfilter_pubs = lappend_oid(rowfilter_pubs, pub->oid);
+					rowfilter_relids = lappend_oid(rowfilter_relids,
+												   member_relid);
+				}
 			}
 
 			if (entry->pubactions.pubinsert && entry->pubactions.pubupdate &&
-				entry->pubactions.pubdelete && entry->pubactions.pubtruncate)
+				entry->pubactions.pubdelete && entry->pubactions.pubtruncate &&
+				rowfilter_all)
 				break;
 		}
 
 		list_free(pubids);
 
+		/* Combine the row filters, if any, into one expression. */
+		if (entry->estate)
+			FreeExecutorState(entry->estate);
+		entry->estate = NULL;
+		entry->exprstate = NULL;
+		entry->scantuple = NULL;
+		entry->rowfilter_valid = false;
+		if (entry->rowfilter_cxt)
+			MemoryContextDelete(entry->rowfilter_cxt);
+		entry->rowfilter_cxt = NULL;
+		entry->rowfilter = NULL;
+
+		if (!rowfilter_all && rowfilter_pubs != NIL)
+		{
+			List	   *quals = NIL;
+			ListCell   *lc2;
+			Node	   *rowfilter;
+
+			forboth(lc, rowfilter_pubs, lc2, rowfilter_relids)
+				quals = lappend(quals,
+								get_publication_rowfilter(lfirst_oid(lc),
+														  lfirst_oid(lc2),
+														  publish_as_relid));
+
+			if (list_length(quals) == 1)
+				rowfilter = linitial(quals);
+			else
+				rowfilter = (Node *) makeBoolExpr(OR_EXPR, quals, -1);
+
+			entry->rowfilter_cxt = AllocSetContextCreate(CacheMemoryContext,
+														 "pgoutput row filter",
+														 ALLOCSET_SMALL_SIZES);
+			oldctx = MemoryContextSwitchTo(entry->rowfilter_cxt);
+			entry->rowfilter = copyObject(rowfilter);
+			MemoryContextSwitchTo(oldctx);
+		}
+
+		list_free(rowfilter_pubs);
+		list_free(rowfilter_relids);
+
 		entry->publish_as_relid = publish_as_relid;
 		entry->replicate_valid = true;
 	}
@@ -1064,6 +1216,154 @@ get_rel_sync_entry(PGOutputData *data, Oid relid)
 	return entry;
 }
 
+/*
+ * Fetch the row filter of a relation in a publication, and convert it to
+ * refer to the columns of the relation changes are published as, which is
+ * an ancestor or a partition of the former if they're not the same.
+ */
+static Node *
+get_publication_rowfilter(Oid pubid, Oid relid, Oid publish_as_relid)
+{
+	HeapTuple	tup;
+	Datum		datum;
+	bool		isnull;
+	Node	   *qual;
+
+	tup = SearchSysCache2(PUBLICATIONRELMAP, ObjectIdGetDatum(relid),
+						  ObjectIdGetDatum(pubid));
+	if (!HeapTupleIsValid(tup))
+		elog(ERROR, "cache lookup failed for publication table %u in publication %u",
+			 relid, pubid);
+
+	datum = SysCacheGetAttr(PUBLICATIONRELMAP, tup,
+							Anum_pg_publication_rel_prqual, &isnull);
+	Assert(!isnull);
+	qual = stringToNode(TextDatumGetCString(datum));
+	ReleaseSysCache(tup);
+
+	if (relid != publish_as_relid)
+	{
+		Relation	from_rel = RelationIdGetRelation(relid);
+		Relation	to_rel = RelationIdGetRelation(publish_as_relid);
+
+		qual = (Node *) linitial(map_partition_varattnos(list_make1(qual), 1,
+														 to_rel, from_rel));
+		RelationClose(from_rel);
+		RelationClose(to_rel);
+	}
+
+	return qual;
+}
+
+/*
+ * Decide whether a change of the given tuple passes the relation's row
+ * filter.  The tuple must be in the format of the relation changes are
+ * published as, which is 'relation'.
+ *
+ * The new tuple is checked for inserts and updates, and the old one for
+ * updates and deletes.  Of the old tuple only the replica identity columns
+ * are known, which is why publications of updates and deletes may only
+ * filter on those.
+ */
+static bool
+pgoutput_row_filter(Relation relation, HeapTuple tuple,
+					RelationSyncEntry *entry)
+{
+	ExprContext *econtext;
+	Datum		ret;
+	bool		isnull;
+
+	if (entry->rowfilter == NULL)
+		return true;
+
+	if (!entry->rowfilter_valid)
+	{
+		MemoryContext oldctx;
+		TupleDesc	tupdesc;
+		Expr	   *expr;
+
+		if (entry->estate)
+			FreeExecutorState(entry->estate);
+
+		oldctx = MemoryContextSwitchTo(CacheMemoryContext);
+		entry->estate = CreateExecutorState();
+		MemoryContextSwitchTo(entry->estate->es_query_cxt);
+
+		/* Use a copy of the descriptor so as not to pin the relcache's */
+		tupdesc = CreateTupleDescCopyConstr(RelationGetDescr(relation));
+		entry->scantuple = ExecInitExtraTupleSlot(entry->estate, tupdesc,
+												  &TTSOpsHeapTuple);
+		expr = expression_planner((Expr *) copyObject(entry->rowfilter));
+		entry->exprstate = ExecInitExpr(expr, NULL);
+
+		MemoryContextSwitchTo(oldctx);
+		entry->rowfilter_valid = true;
+	}
+
+	econtext = GetPerTupleExprContext(entry->estate);
+	ExecStoreHeapTuple(tuple, entry->scantuple, false);
+	econtext->ecxt_scantuple = entry->scantuple;
+
+	ret = ExecEvalExprSwitchContext(entry->exprstate, econtext, &isnull);
+
+	ExecClearTuple(entry->scantuple);
+	ResetExprContext(econtext);
+
+	return !isnull && DatumGetBool(ret);
+}
+
+/*
+ * Replace unchanged toasted values in the new tuple of an update by their
+ * values in the old tuple, where the latter has them.
+ *
+ * Values that weren't changed by an update and are stored out of line are
+ * not logged in the new tuple.  The old tuple has them for replica identity
+ * columns, which are the only ones a row filter can look at, and which must
+ * be sent in full if the update is turned into an insert.  Other unchanged
+ * toasted columns are left alone, and are sent as unchanged.
+ */
+static HeapTuple
+pgoutput_fill_unchanged_toast(Relation relation, HeapTuple oldtuple,
+							  HeapTuple newtuple)
+{
+	TupleDesc	desc = RelationGetDescr(relation);
+	Datum	   *old_values;
+	bool	   *old_isnull;
+	Datum	   *new_values;
+	bool	   *new_isnull;
+	bool		changed = false;
+	int			i;
+
+	old_values = (Datum *) palloc(desc->natts * sizeof(Datum));
+	old_isnull = (bool *) palloc(desc->natts * sizeof(bool));
+	new_values = (Datum *) palloc(desc->natts * sizeof(Datum));
+	new_isnull = (bool *) palloc(desc->natts * sizeof(bool));
+
+	heap_deform_tuple(oldtuple, desc, old_values, old_isnull);
+	heap_deform_tuple(newtuple, desc, new_values, new_isnull);
+
+	for (i = 0; i < desc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(desc, i);
+
+		if (att->attisdropped || att->attlen != -1 || new_isnull[i] ||
+			old_isnull[i])
+			continue;
+
+		if (VARATT_IS_EXTERNAL_ONDISK(new_values[i]) &&
+			!VARATT_IS_EXTERNAL_ONDISK(old_values[i]))
+		{
+			new_values[i] = old_values[i];
+			changed = true;
+		}
+	}
+
+	if (changed)
+		newtuple = heap_form_tuple(desc, new_values, new_isnull);
+
+	return newtuple;
+}
+
 /*
  * Cleanup list of streamed transactions and update the schema_sent flag.
  *
@@ -1147,6 +1447,7 @@ rel_sync_cache_relation_cb(Datum arg, Oid relid)
 		entry->schema_sent = false;
 		list_free(entry->streamed_txns);
 		entry->streamed_txns = NIL;
+		entry->rowfilter_valid = false;
 	}
 }
 
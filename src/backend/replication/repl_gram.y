@@ -89,6 +89,8 @@ static SQLCmd *make_sqlcmd(void);
 %token K_USE_SNAPSHOT
 %token K_MANIFEST
 %token K_MANIFEST_CHECKSUMS
+%token K_COMPRESSION
+%token K_COMPRESSION_LEVEL
 
 %type <node>	command
 %type <node>	base_backup start_replication start_logical_replication
@@ -158,7 +160,8 @@ var_name:	IDENT	{ $$ = $1; }
 /*
  * BASE_BACKUP [LABEL '<label>'] [PROGRESS] [FAST] [WAL] [NOWAIT]
  * [MAX_RATE %d] [TABLESPACE_MAP] [NOVERIFY_CHECKSUMS]
- * [MANIFEST %s] [MANIFEST_CHECKSUMS %s]
+ * [MANIFEST %s] [MANIFEST_CHECKSUMS %s] [COMPRESSION %s]
+ * [COMPRESSION_LEVEL %d]
  */
 base_backup:
 			K_BASE_BACKUP base_backup_opt_list
@@ -227,6 +230,16 @@ base_backup_opt:
 				  $$ = makeDefElem("manifest_checksums",
 								   (Node *)makeString($2), -1);
 				}
+			| K_COMPRESSION SCONST
+				{
+				  $$ = makeDefElem("compression",
+								   (Node *)makeString($2), -1);
+				}
+			| K_COMPRESSION_LEVEL UCONST
+				{
+				  $$ = makeDefElem("compression_level",
+								   (Node *)makeInteger($2), -1);
+				}
 			;
 
 create_replication_slot:
@@ -77,6 +77,7 @@
 #include "access/xact.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "portability/instr_time.h"
 #include "replication/syncrep.h"
 #include "replication/walsender.h"
 #include "replication/walsender_private.h"
@@ -84,6 +85,7 @@
 #include "storage/proc.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 
 /* User-settable parameters for sync rep */
@@ -97,9 +99,18 @@ static bool announce_next_takeover = true;
 SyncRepConfigData *SyncRepConfig = NULL;
 static int	SyncRepWaitMode = SYNC_REP_NO_WAIT;
 
+/*
+ * Backends removed from the queues by SyncRepWakeQueue(), whose latches are
+ * to be set by SyncRepSetWakeupLatches() once SyncRepLock has been released.
+ */
+static PGPROC **SyncRepWakeupProcs = NULL;
+static int	SyncRepNumWakeupProcs = 0;
+
 static void SyncRepQueueInsert(int mode);
 static void SyncRepCancelWait(void);
 static int	SyncRepWakeQueue(bool all, int mode);
+static void SyncRepPrepareWakeup(void);
+static void SyncRepSetWakeupLatches(void);
 
 static bool SyncRepGetSyncRecPtr(XLogRecPtr *writePtr,
 								 XLogRecPtr *flushPtr,
@@ -150,6 +161,8 @@ SyncRepWaitForLSN(XLogRecPtr lsn, bool commit)
 	char	   *new_status = NULL;
 	const char *old_status;
 	int			mode;
+	instr_time	wait_start;
+	instr_time	wait_time;
 
 	/*
 	 * This should be called while holding interrupts during a transaction
@@ -213,6 +226,8 @@ SyncRepWaitForLSN(XLogRecPtr lsn, bool commit)
 	Assert(SyncRepQueueIsOrderedByLSN(mode));
 	LWLockRelease(SyncRepLock);
 
+	INSTR_TIME_SET_CURRENT(wait_start);
+
 	/* Alter ps display to show waiting for sync rep. */
 	if (update_process_title)
 	{
@@ -322,6 +337,13 @@ SyncRepWaitForLSN(XLogRecPtr lsn, bool commit)
 	MyProc->syncRepState = SYNC_REP_NOT_WAITING;
 	MyProc->waitLSN = 0;
 
+	/* Account for the wait, see pg_stat_get_sync_replication() */
+	INSTR_TIME_SET_CURRENT(wait_time);
+	INSTR_TIME_SUBTRACT(wait_time, wait_start);
+	pg_atomic_fetch_add_u64(&WalSndCtl->sync_rep_waits[mode], 1);
+	pg_atomic_fetch_add_u64(&WalSndCtl->sync_rep_wait_time[mode],
+							INSTR_TIME_GET_MICROSEC(wait_time));
+
 	if (new_status)
 	{
 		/* Reset ps display */
@@ -469,16 +491,26 @@ SyncRepReleaseWaiters(void)
 	/*
 	 * We're a potential sync standby. Release waiters if there are enough
 	 * sync standbys and we are considered as sync.
+	 *
+	 * Every standby reply gets us here, but with several sync standbys
+	 * configured most replies don't advance the synced positions, and
+	 * backends inserting themselves into the queues must not be held up by
+	 * walsenders that have nothing to release.  So first compute the
+	 * positions holding SyncRepLock in shared mode only, and take it in
+	 * exclusive mode only if some queue can be advanced.  (Note: although
+	 * computing the positions does not of itself require holding
+	 * SyncRepLock, it seems like a good idea to do it after acquiring the
+	 * lock.  This ensures that the WAL pointers we use to release waiters are
+	 * newer than any previous execution of this routine used.  We check
+	 * again after acquiring the lock in exclusive mode that the positions
+	 * only ever move forward.)
 	 */
-	LWLockAcquire(SyncRepLock, LW_EXCLUSIVE);
+	SyncRepPrepareWakeup();
+	LWLockAcquire(SyncRepLock, LW_SHARED);
 
 	/*
 	 * Check whether we are a sync standby or not, and calculate the synced
-	 * positions among all sync standbys.  (Note: although this step does not
-	 * of itself require holding SyncRepLock, it seems like a good idea to do
-	 * it after acquiring the lock.  This ensures that the WAL pointers we use
-	 * to release waiters are newer than any previous execution of this
-	 * routine used.)
+	 * positions among all sync standbys.
 	 */
 	got_recptr = SyncRepGetSyncRecPtr(&writePtr, &flushPtr, &applyPtr, &am_sync);
 
@@ -511,6 +543,18 @@ SyncRepReleaseWaiters(void)
 		return;
 	}
 
+	/* Leave if no queue can be advanced */
+	if (walsndctl->lsn[SYNC_REP_WAIT_WRITE] >= writePtr &&
+		walsndctl->lsn[SYNC_REP_WAIT_FLUSH] >= flushPtr &&
+		walsndctl->lsn[SYNC_REP_WAIT_APPLY] >= applyPtr)
+	{
+		LWLockRelease(SyncRepLock);
+		return;
+	}
+
+	LWLockRelease(SyncRepLock);
+	LWLockAcquire(SyncRepLock, LW_EXCLUSIVE);
+
 	/*
 	 * Set the lsn first so that when we wake backends they will release up to
 	 * this location.
@@ -533,6 +577,8 @@ SyncRepReleaseWaiters(void)
 
 	LWLockRelease(SyncRepLock);
 
+	SyncRepSetWakeupLatches();
+
 	elog(DEBUG3, "released %d procs up to write %X/%X, %d procs up to flush %X/%X, %d procs up to apply %X/%X",
 		 numwrite, (uint32) (writePtr >> 32), (uint32) writePtr,
 		 numflush, (uint32) (flushPtr >> 32), (uint32) flushPtr,
@@ -869,11 +915,16 @@ SyncRepGetStandbyPriority(void)
 
 /*
  * Walk the specified queue from head.  Set the state of any backends that
- * need to be woken, remove them from the queue, and then wake them.
- * Pass all = true to wake whole queue; otherwise, just wake up to
- * the walsender's LSN.
+ * need to be woken, and remove them from the queue.  Pass all = true to wake
+ * whole queue; otherwise, just wake up to the walsender's LSN.
+ *
+ * The backends are not woken right away: setting their latches is left to
+ * SyncRepSetWakeupLatches(), to be called after releasing SyncRepLock, so
+ * that the woken backends don't immediately block on the lock we hold, and
+ * so that we don't hold the lock any longer than needed.
  *
- * The caller must hold SyncRepLock in exclusive mode.
+ * The caller must have called SyncRepPrepareWakeup() and must hold
+ * SyncRepLock in exclusive mode.
  */
 static int
 SyncRepWakeQueue(bool all, int mode)
@@ -929,7 +980,8 @@ SyncRepWakeQueue(bool all, int mode)
 		/*
 		 * Wake only when we have set state and removed from queue.
 		 */
-		SetLatch(&(thisproc->procLatch));
+		Assert(SyncRepNumWakeupProcs < MaxBackends);
+		SyncRepWakeupProcs[SyncRepNumWakeupProcs++] = thisproc;
 
 		numprocs++;
 	}
@@ -937,6 +989,39 @@ SyncRepWakeQueue(bool all, int mode)
 	return numprocs;
 }
 
+/*
+ * Make sure there's room to remember the backends SyncRepWakeQueue() removes
+ * from the queues.  Each backend can be in at most one queue, so there can't
+ * be more than MaxBackends of them.
+ */
+static void
+SyncRepPrepareWakeup(void)
+{
+	if (SyncRepWakeupProcs == NULL)
+		SyncRepWakeupProcs = (PGPROC **)
+			MemoryContextAlloc(TopMemoryContext,
+							   MaxBackends * sizeof(PGPROC *));
+	Assert(SyncRepNumWakeupProcs == 0);
+}
+
+/*
+ * Wake up the backends removed from the queues by SyncRepWakeQueue().
+ *
+ * This must be done after releasing SyncRepLock.  By then a backend might
+ * well have noticed that its wait is complete and moved on, even to another
+ * wait, but setting its latch once more is harmless since latch waiters must
+ * cope with spurious wakeups anyway.
+ */
+static void
+SyncRepSetWakeupLatches(void)
+{
+	int			i;
+
+	for (i = 0; i < SyncRepNumWakeupProcs; i++)
+		SetLatch(&(SyncRepWakeupProcs[i]->procLatch));
+	SyncRepNumWakeupProcs = 0;
+}
+
 /*
  * The checkpointer calls this as needed to update the shared
  * sync_standbys_defined flag, so that backends don't remain permanently wedged
@@ -951,6 +1036,7 @@ SyncRepUpdateSyncStandbysDefined(void)
 
 	if (sync_standbys_defined != WalSndCtl->sync_standbys_defined)
 	{
+		SyncRepPrepareWakeup();
 		LWLockAcquire(SyncRepLock, LW_EXCLUSIVE);
 
 		/*
@@ -976,6 +1062,8 @@ SyncRepUpdateSyncStandbysDefined(void)
 		WalSndCtl->sync_standbys_defined = sync_standbys_defined;
 
 		LWLockRelease(SyncRepLock);
+
+		SyncRepSetWakeupLatches();
 	}
 }
 
@@ -837,6 +837,15 @@ logical_read_xlog_page(XLogReaderState *state, XLogRecPtr targetPagePtr, int req
 	else
 		count = flushptr - targetPagePtr;	/* part of the page available */
 
+	/*
+	 * Several logical walsenders typically decode the same recent WAL, so
+	 * try to copy the page from the WAL buffers before going to the file.
+	 */
+	if (!sendTimeLineIsHistoric &&
+		XLogReadFromBuffers(cur_page, targetPagePtr, count,
+							sendTimeLine) == count)
+		return count;
+
 	/* now actually read the data, we know it's there */
 	if (!WALRead(state,
 				 cur_page,
@@ -2546,6 +2555,7 @@ XLogSendPhysical(void)
 	XLogRecPtr	startptr;
 	XLogRecPtr	endptr;
 	Size		nbytes;
+	Size		nfrombufs = 0;
 	XLogSegNo	segno;
 	WALReadError errinfo;
 
@@ -2763,11 +2773,21 @@ XLogSendPhysical(void)
 	 */
 	enlargeStringInfo(&output_message, nbytes);
 
+	/*
+	 * Recently flushed WAL is usually still in the WAL buffers, so try to
+	 * copy it from there first, and only read the rest from the WAL files.
+	 */
+	if (!sendTimeLineIsHistoric)
+		nfrombufs = XLogReadFromBuffers(&output_message.data[output_message.len],
+										startptr, nbytes, sendTimeLine);
+	if (nfrombufs == nbytes)
+		goto done;
+
 retry:
 	if (!WALRead(xlogreader,
-				 &output_message.data[output_message.len],
-				 startptr,
-				 nbytes,
+				 &output_message.data[output_message.len + nfrombufs],
+				 startptr + nfrombufs,
+				 nbytes - nfrombufs,
 				 xlogreader->seg.ws_tli,	/* Pass the current TLI because
 											 * only WalSndSegmentOpen controls
 											 * whether new TLI is needed. */
@@ -2775,7 +2795,7 @@ retry:
 		WALReadRaiseError(&errinfo);
 
 	/* See logical_read_xlog_page(). */
-	XLByteToSeg(startptr, segno, xlogreader->segcxt.ws_segsize);
+	XLByteToSeg(startptr + nfrombufs, segno, xlogreader->segcxt.ws_segsize);
 	CheckXLogRemoved(segno, xlogreader->seg.ws_tli);
 
 	/*
@@ -2802,6 +2822,7 @@ retry:
 		}
 	}
 
+done:
 	output_message.len += nbytes;
 	output_message.data[output_message.len] = '\0';
 
@@ -3093,7 +3114,11 @@ WalSndShmemInit(void)
 		MemSet(WalSndCtl, 0, WalSndShmemSize());
 
 		for (i = 0; i < NUM_SYNC_REP_WAIT_MODE; i++)
+		{
 			SHMQueueInit(&(WalSndCtl->SyncRepQueue[i]));
+			pg_atomic_init_u64(&WalSndCtl->sync_rep_waits[i], 0);
+			pg_atomic_init_u64(&WalSndCtl->sync_rep_wait_time[i], 0);
+		}
 
 		for (i = 0; i < max_wal_senders; i++)
 		{
@@ -3445,6 +3470,72 @@ pg_stat_get_wal_senders(PG_FUNCTION_ARGS)
 	return (Datum) 0;
 }
 
+/*
+ * Returns activity of synchronous replication waits, one row for each
+ * synchronous replication level.
+ */
+Datum
+pg_stat_get_sync_replication(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_SYNC_REPLICATION_COLS	3
+	static const char *const wait_modes[NUM_SYNC_REP_WAIT_MODE] = {
+		"write", "flush", "apply"
+	};
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	for (i = 0; i < NUM_SYNC_REP_WAIT_MODE; i++)
+	{
+		Datum		values[PG_STAT_GET_SYNC_REPLICATION_COLS];
+		bool		nulls[PG_STAT_GET_SYNC_REPLICATION_COLS];
+		uint64		wait_time;
+
+		MemSet(nulls, 0, sizeof(nulls));
+
+		wait_time = pg_atomic_read_u64(&WalSndCtl->sync_rep_wait_time[i]);
+
+		values[0] = CStringGetTextDatum(wait_modes[i]);
+		values[1] = Int64GetDatum(pg_atomic_read_u64(&WalSndCtl->sync_rep_waits[i]));
+		/* convert counter from microsec to millisec for display */
+		values[2] = Float8GetDatum((double) wait_time / 1000.0);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
 /*
  * Send a keepalive message to standby.
  *
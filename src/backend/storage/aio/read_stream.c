@@ -0,0 +1,207 @@
+/*-------------------------------------------------------------------------
+ *
+ * read_stream.c
+ *	  Mechanism for reading a sequence of blocks of a relation ahead of use.
+ *
+ * A read stream is created with a callback that produces the block numbers
+ * the caller is going to need, in order.  read_stream_next_buffer() then
+ * returns those blocks as pinned buffers, one at a time.  Behind the scenes
+ * the stream looks ahead in the block number sequence, so that:
+ *
+ * 1.  Runs of consecutive blocks that are not in shared buffers are read
+ *	   with a single vectored read of up to io_combine_limit blocks (see
+ *	   ReadBufferRange()), instead of one system call per block.
+ *
+ * 2.  For non-sequential access, the kernel is told about blocks before they
+ *	   are needed, up to effective_io_concurrency blocks ahead, or
+ *	   maintenance_io_concurrency blocks for READ_STREAM_MAINTENANCE streams
+ *	   (or the tablespace's setting).  Sequential access is left to the kernel's own
+ *	   readahead heuristics, which handle it well.
+ *
+ * Only the blocks of the run being returned are pinned ahead of time, so a
+ * stream holds at most io_combine_limit pins beyond those its caller holds.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/aio/read_stream.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "storage/read_stream.h"
+#include "utils/rel.h"
+#include "utils/spccache.h"
+
+struct ReadStream
+{
+	Relation	rel;
+	ForkNumber	forknum;
+	BufferAccessStrategy strategy;
+	ReadStreamBlockNumberCB callback;
+	void	   *callback_private_data;
+
+	bool		exhausted;		/* callback returned InvalidBlockNumber */
+	bool		advice_enabled; /* issue prefetch advice for random access? */
+	BlockNumber last_queued;	/* most recent block number from callback */
+
+	/*
+	 * Circular queue of upcoming block numbers, oldest first.  The buffers[]
+	 * entry for a queued block is valid if that block has already been
+	 * pinned as part of a combined read.
+	 */
+	int			queue_size;
+	int			oldest;
+	int			nqueued;
+	BlockNumber *blocknums;
+	Buffer	   *buffers;
+};
+
+/*
+ * Create a new read stream for the given relation fork.
+ */
+ReadStream *
+read_stream_begin_relation(int flags,
+						   Relation rel,
+						   ForkNumber forknum,
+						   BufferAccessStrategy strategy,
+						   ReadStreamBlockNumberCB callback,
+						   void *callback_private_data)
+{
+	ReadStream *stream;
+	int			io_concurrency;
+
+	/* see comments in nodeBitmapHeapscan.c about tablespace settings */
+	if (flags & READ_STREAM_MAINTENANCE)
+		io_concurrency =
+			get_tablespace_maintenance_io_concurrency(rel->rd_rel->reltablespace);
+	else
+		io_concurrency = get_tablespace_io_concurrency(rel->rd_rel->reltablespace);
+
+	stream = (ReadStream *) palloc0(sizeof(ReadStream));
+	stream->rel = rel;
+	stream->forknum = forknum;
+	stream->strategy = strategy;
+	stream->callback = callback;
+	stream->callback_private_data = callback_private_data;
+	stream->exhausted = false;
+	stream->last_queued = InvalidBlockNumber;
+
+#ifdef USE_PREFETCH
+	stream->advice_enabled = (io_concurrency > 0);
+#else
+	stream->advice_enabled = false;
+#endif
+
+	stream->queue_size = MAX_IO_COMBINE_LIMIT + io_concurrency;
+	stream->oldest = 0;
+	stream->nqueued = 0;
+	stream->blocknums = (BlockNumber *)
+		palloc(sizeof(BlockNumber) * stream->queue_size);
+	stream->buffers = (Buffer *)
+		palloc(sizeof(Buffer) * stream->queue_size);
+
+	return stream;
+}
+
+/*
+ * Return the next block of the stream as a pinned buffer, or InvalidBuffer
+ * once the callback has run out of block numbers.
+ */
+Buffer
+read_stream_next_buffer(ReadStream *stream)
+{
+	Buffer		buffer;
+
+	/* Look ahead as far as the queue allows. */
+	while (!stream->exhausted && stream->nqueued < stream->queue_size)
+	{
+		BlockNumber blocknum;
+		int			idx;
+
+		blocknum = stream->callback(stream, stream->callback_private_data);
+		if (!BlockNumberIsValid(blocknum))
+		{
+			stream->exhausted = true;
+			break;
+		}
+
+		idx = (stream->oldest + stream->nqueued) % stream->queue_size;
+		stream->blocknums[idx] = blocknum;
+		stream->buffers[idx] = InvalidBuffer;
+		stream->nqueued++;
+
+		if (stream->advice_enabled && blocknum != stream->last_queued + 1)
+			(void) PrefetchBuffer(stream->rel, stream->forknum, blocknum);
+		stream->last_queued = blocknum;
+	}
+
+	if (stream->nqueued == 0)
+		return InvalidBuffer;
+
+	/*
+	 * If the oldest block hasn't been pinned yet, pin it together with as
+	 * many of the following consecutive blocks as we're allowed to combine.
+	 */
+	if (!BufferIsValid(stream->buffers[stream->oldest]))
+	{
+		Buffer		run[MAX_IO_COMBINE_LIMIT];
+		BlockNumber first = stream->blocknums[stream->oldest];
+		int			limit = Min(stream->nqueued, io_combine_limit);
+		int			nrun = 1;
+		int			i;
+
+		while (nrun < limit &&
+			   stream->blocknums[(stream->oldest + nrun) % stream->queue_size] ==
+			   first + nrun)
+			nrun++;
+
+		ReadBufferRange(stream->rel, stream->forknum, first, nrun,
+						stream->strategy, run);
+
+		for (i = 0; i < nrun; i++)
+			stream->buffers[(stream->oldest + i) % stream->queue_size] = run[i];
+	}
+
+	buffer = stream->buffers[stream->oldest];
+	stream->buffers[stream->oldest] = InvalidBuffer;
+	stream->oldest = (stream->oldest + 1) % stream->queue_size;
+	stream->nqueued--;
+
+	return buffer;
+}
+
+/*
+ * Forget all queued blocks, releasing any pins held on them, so that the
+ * stream starts calling the callback again.
+ */
+void
+read_stream_reset(ReadStream *stream)
+{
+	while (stream->nqueued > 0)
+	{
+		Buffer		buffer = stream->buffers[stream->oldest];
+
+		if (BufferIsValid(buffer))
+			ReleaseBuffer(buffer);
+		stream->oldest = (stream->oldest + 1) % stream->queue_size;
+		stream->nqueued--;
+	}
+	stream->oldest = 0;
+	stream->exhausted = false;
+	stream->last_queued = InvalidBlockNumber;
+}
+
+/*
+ * Release a read stream and any pins it still holds.
+ */
+void
+read_stream_end(ReadStream *stream)
+{
+	read_stream_reset(stream);
+	pfree(stream->blocknums);
+	pfree(stream->buffers);
+	pfree(stream);
+}
@@ -9,6 +9,15 @@
  * in most cases the caller needs to adjust the buffer header contents
  * before the lock is released (see notes in README).
  *
+ * The exception is BufTableTryLookup(), which looks up a tag without any
+ * lock.  To make that possible, each partition has a change counter, which
+ * BufTableInsert() and BufTableDelete() advance to an odd value before
+ * modifying the partition and to an even value afterwards, like a seqlock.
+ * A lookup that sees the same even counter value before and after searching
+ * the table can trust its result.  The counters are padded to a cache line
+ * each, so that readers of one partition don't suffer from writes to the
+ * others.
+ *
  *
  * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -21,8 +30,10 @@
  */
 #include "postgres.h"
 
+#include "port/atomics.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "storage/shmem.h"
 
 /* entry for buffer lookup hashtable */
 typedef struct
@@ -31,7 +42,18 @@ typedef struct
 	int			id;				/* Associated buffer ID */
 } BufferLookupEnt;
 
+/* per-partition change counter, see above */
+typedef union BufMappingChangeCount
+{
+	pg_atomic_uint32 count;
+	char		pad[PG_CACHE_LINE_SIZE];
+} BufMappingChangeCount;
+
 static HTAB *SharedBufHash;
+static BufMappingChangeCount *BufMappingChangeCounts;
+
+static inline void BufTableStartChange(uint32 hashcode);
+static inline void BufTableEndChange(uint32 hashcode);
 
 
 /*
@@ -41,7 +63,9 @@ static HTAB *SharedBufHash;
 Size
 BufTableShmemSize(int size)
 {
-	return hash_estimate_size(size, sizeof(BufferLookupEnt));
+	return add_size(hash_estimate_size(size, sizeof(BufferLookupEnt)),
+					mul_size(NUM_BUFFER_PARTITIONS,
+							 sizeof(BufMappingChangeCount)));
 }
 
 /*
@@ -52,6 +76,7 @@ void
 InitBufTable(int size)
 {
 	HASHCTL		info;
+	bool		found;
 
 	/* assume no locking is needed yet */
 
@@ -64,6 +89,18 @@ InitBufTable(int size)
 								  size, size,
 								  &info,
 								  HASH_ELEM | HASH_BLOBS | HASH_PARTITION);
+
+	BufMappingChangeCounts = (BufMappingChangeCount *)
+		ShmemInitStruct("Shared Buffer Lookup Change Counts",
+						NUM_BUFFER_PARTITIONS * sizeof(BufMappingChangeCount),
+						&found);
+	if (!found)
+	{
+		int			i;
+
+		for (i = 0; i < NUM_BUFFER_PARTITIONS; i++)
+			pg_atomic_init_u32(&BufMappingChangeCounts[i].count, 0);
+	}
 }
 
 /*
@@ -105,6 +142,51 @@ BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 	return result->id;
 }
 
+/*
+ * BufTableTryLookup
+ *		Lookup the given BufferTag without a lock on BufMappingLock
+ *
+ * Returns true and sets *buf_id to the buffer ID, or -1 if not found, if the
+ * partition was not modified during the lookup.  Returns false otherwise; the
+ * caller then has to use BufTableLookup() under the lock.
+ *
+ * As usual, the result is only a hint once we return, as the buffer can be
+ * evicted at any time unless the caller pins it and rechecks its tag.
+ */
+bool
+BufTableTryLookup(BufferTag *tagPtr, uint32 hashcode, int *buf_id)
+{
+	pg_atomic_uint32 *counter;
+	uint32		before;
+	BufferLookupEnt *result;
+	bool		complete;
+	int			id = -1;
+
+	counter = &BufMappingChangeCounts[BufTableHashPartition(hashcode)].count;
+
+	before = pg_atomic_read_u32(counter);
+	if (before & 1)
+		return false;			/* change in progress */
+	pg_read_barrier();
+
+	result = (BufferLookupEnt *)
+		hash_search_optimistic(SharedBufHash,
+							   (void *) tagPtr,
+							   hashcode,
+							   &complete);
+	if (!complete)
+		return false;
+	if (result)
+		id = result->id;
+
+	pg_read_barrier();
+	if (pg_atomic_read_u32(counter) != before)
+		return false;
+
+	*buf_id = id;
+	return true;
+}
+
 /*
  * BufTableInsert
  *		Insert a hashtable entry for given tag and buffer ID,
@@ -124,6 +206,8 @@ BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id)
 	Assert(buf_id >= 0);		/* -1 is reserved for not-in-table */
 	Assert(tagPtr->blockNum != P_NEW);	/* invalid tag */
 
+	BufTableStartChange(hashcode);
+
 	result = (BufferLookupEnt *)
 		hash_search_with_hash_value(SharedBufHash,
 									(void *) tagPtr,
@@ -131,11 +215,14 @@ BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id)
 									HASH_ENTER,
 									&found);
 
+	if (!found)
+		result->id = buf_id;
+
+	BufTableEndChange(hashcode);
+
 	if (found)					/* found something already in the table */
 		return result->id;
 
-	result->id = buf_id;
-
 	return -1;
 }
 
@@ -150,6 +237,8 @@ BufTableDelete(BufferTag *tagPtr, uint32 hashcode)
 {
 	BufferLookupEnt *result;
 
+	BufTableStartChange(hashcode);
+
 	result = (BufferLookupEnt *)
 		hash_search_with_hash_value(SharedBufHash,
 									(void *) tagPtr,
@@ -157,6 +246,36 @@ BufTableDelete(BufferTag *tagPtr, uint32 hashcode)
 									HASH_REMOVE,
 									NULL);
 
+	BufTableEndChange(hashcode);
+
 	if (!result)				/* shouldn't happen */
 		elog(ERROR, "shared buffer hash table corrupted");
 }
+
+/*
+ * BufTableStartChange / BufTableEndChange
+ *		Advance the change counter of the tag's partition around a change
+ *
+ * Caller must hold exclusive lock on BufMappingLock for tag's partition, so
+ * nobody else can be changing the counter.
+ */
+static inline void
+BufTableStartChange(uint32 hashcode)
+{
+	pg_atomic_uint32 *counter;
+
+	counter = &BufMappingChangeCounts[BufTableHashPartition(hashcode)].count;
+	Assert((pg_atomic_read_u32(counter) & 1) == 0);
+	pg_atomic_write_u32(counter, pg_atomic_read_u32(counter) + 1);
+	pg_write_barrier();
+}
+
+static inline void
+BufTableEndChange(uint32 hashcode)
+{
+	pg_atomic_uint32 *counter;
+
+	counter = &BufMappingChangeCounts[BufTableHashPartition(hashcode)].count;
+	pg_write_barrier();
+	pg_atomic_write_u32(counter, pg_atomic_read_u32(counter) + 1);
+}
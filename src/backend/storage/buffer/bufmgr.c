@@ -50,6 +50,7 @@
 #include "storage/smgr.h"
 #include "storage/standby.h"
 #include "utils/memdebug.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
@@ -70,6 +71,14 @@
 
 #define RELS_BSEARCH_THRESHOLD		20
 
+/*
+ * This is the size (in the number of blocks) above which we scan the
+ * entire buffer pool to remove the buffers for all the pages of relation
+ * being dropped. For the relations with size below this threshold, we find
+ * the buffers by doing lookups in BufMapping table.
+ */
+#define BUF_DROP_FULL_SCAN_THRESHOLD		(uint64) (NBuffers / 32)
+
 typedef struct PrivateRefCountEntry
 {
 	Buffer		buffer;
@@ -124,6 +133,7 @@ typedef struct SMgrSortArray
 bool		zero_damaged_pages = false;
 int			bgwriter_lru_maxpages = 100;
 double		bgwriter_lru_multiplier = 2.0;
+int			bgwriter_lru_min_clean = 0;
 bool		track_io_timing = false;
 
 /*
@@ -149,9 +159,25 @@ int			checkpoint_flush_after = 0;
 int			bgwriter_flush_after = 0;
 int			backend_flush_after = 0;
 
-/* local state for StartBufferIO and related functions */
-static BufferDesc *InProgressBuf = NULL;
-static bool IsForInput;
+/*
+ * How many consecutive blocks ReadBufferRange() may read with a single
+ * smgrreadv() call, and BufferSync() may write with a single smgrwritev().
+ */
+int			io_combine_limit = DEFAULT_IO_COMBINE_LIMIT;
+
+/* Private copies of pages being written by FlushBuffers(), for checksums */
+static char *FlushPageCopies = NULL;
+
+/*
+ * local state for StartBufferIO and related functions
+ *
+ * ReadBufferRange() can have up to MAX_IO_COMBINE_LIMIT reads in progress,
+ * and evicting a victim buffer meanwhile may need one more for a write.
+ */
+#define MAX_IN_PROGRESS_BUFS (MAX_IO_COMBINE_LIMIT + 1)
+static BufferDesc *InProgressBufs[MAX_IN_PROGRESS_BUFS];
+static bool InProgressIsForInput[MAX_IN_PROGRESS_BUFS];
+static int	NumInProgressBufs = 0;
 
 /* local state for LockBufferForCleanup */
 static BufferDesc *PinCountWaitBuf = NULL;
@@ -460,6 +486,8 @@ static void BufferSync(int flags);
 static uint32 WaitBufHdrUnlocked(BufferDesc *buf);
 static int	SyncOneBuffer(int buf_id, bool skip_recently_used,
 						  WritebackContext *wb_context);
+static int	SyncBufferRun(CkptSortItem *items, int nitems, int *results,
+						  WritebackContext *wb_context);
 static void WaitIO(BufferDesc *buf);
 static bool StartBufferIO(BufferDesc *buf, bool forInput);
 static void TerminateBufferIO(BufferDesc *buf, bool clear_dirty,
@@ -472,9 +500,19 @@ static BufferDesc *BufferAlloc(SMgrRelation smgr,
 							   BlockNumber blockNum,
 							   BufferAccessStrategy strategy,
 							   bool *foundPtr);
-static void FlushBuffer(BufferDesc *buf, SMgrRelation reln);
+static void FlushBuffer(BufferDesc *buf, SMgrRelation reln,
+						IOContext io_context);
+static void FlushBuffers(BufferDesc **bufs, int nbufs, SMgrRelation reln,
+						 IOContext io_context);
 static void AtProcExit_Buffers(int code, Datum arg);
 static void CheckForBufferLeaks(void);
+static void ReadBufferRangeIO(SMgrRelation smgr, ForkNumber forkNum,
+							  BlockNumber blockNum, int nblocks,
+							  Buffer *buffers, IOContext io_context);
+static void FindAndDropRelFileNodeBuffers(RelFileNode rnode,
+										  ForkNumber forkNum,
+										  BlockNumber nForkBlock,
+										  BlockNumber firstDelBlock);
 static int	rnode_comparator(const void *p1, const void *p2);
 static int	buffertag_comparator(const void *p1, const void *p2);
 static int	ckpt_buforder_comparator(const void *pa, const void *pb);
@@ -506,9 +544,12 @@ PrefetchSharedBuffer(SMgrRelation smgr_reln,
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
 	/* see if the block is in the buffer pool already */
-	LWLockAcquire(newPartitionLock, LW_SHARED);
-	buf_id = BufTableLookup(&newTag, newHash);
-	LWLockRelease(newPartitionLock);
+	if (!BufTableTryLookup(&newTag, newHash, &buf_id))
+	{
+		LWLockAcquire(newPartitionLock, LW_SHARED);
+		buf_id = BufTableLookup(&newTag, newHash);
+		LWLockRelease(newPartitionLock);
+	}
 
 	/* If not in buffers, initiate prefetch */
 	if (buf_id < 0)
@@ -683,6 +724,175 @@ ReadBufferExtended(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
 }
 
 
+/*
+ * ReadBufferRange -- pin a run of consecutive blocks of a relation
+ *
+ * Equivalent to calling ReadBufferExtended() in RBM_NORMAL mode for each of
+ * blockNum .. blockNum + nblocks - 1 and storing the results in buffers[],
+ * except that runs of blocks that aren't in shared buffers are read with a
+ * single smgrreadv() call, up to io_combine_limit blocks at a time.
+ *
+ * While a run is being assembled we keep several buffers marked
+ * IO_IN_PROGRESS.  That can't deadlock against another backend doing the
+ * same thing, because both acquire the buffers in ascending block order of a
+ * single relation fork.
+ */
+void
+ReadBufferRange(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
+				int nblocks, BufferAccessStrategy strategy, Buffer *buffers)
+{
+	SMgrRelation smgr;
+	char		relpersistence;
+	int			i;
+
+	Assert(BlockNumberIsValid(blockNum));
+	Assert(nblocks > 0);
+
+	/* Open it at the smgr level if not already done */
+	RelationOpenSmgr(reln);
+
+	/* Local buffers are not worth the trouble; see ReadBufferExtended */
+	if (RelationUsesLocalBuffers(reln) || nblocks == 1)
+	{
+		for (i = 0; i < nblocks; i++)
+			buffers[i] = ReadBufferExtended(reln, forkNum, blockNum + i,
+											RBM_NORMAL, strategy);
+		return;
+	}
+
+	smgr = reln->rd_smgr;
+	relpersistence = reln->rd_rel->relpersistence;
+
+	i = 0;
+	while (i < nblocks)
+	{
+		BufferDesc *bufHdr;
+		bool		found;
+		int			nmiss;
+
+		/* Make sure we will have room to remember the buffer pin */
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
+		pgstat_count_buffer_read(reln);
+		bufHdr = BufferAlloc(smgr, relpersistence, forkNum, blockNum + i,
+							 strategy, &found);
+		buffers[i] = BufferDescriptorGetBuffer(bufHdr);
+		if (found)
+		{
+			pgstat_count_buffer_hit(reln);
+			pgBufferUsage.shared_blks_hit++;
+			VacuumPageHit++;
+			if (VacuumCostActive)
+				VacuumCostBalance += VacuumCostPageHit;
+			i++;
+			continue;
+		}
+
+		/*
+		 * Block i needs to be read; see how many of the following blocks do
+		 * too.  Stop at the first one that's already in shared buffers, but
+		 * keep the pin on it.
+		 */
+		nmiss = 1;
+		found = false;
+		while (i + nmiss < nblocks && nmiss < io_combine_limit)
+		{
+			ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
+			pgstat_count_buffer_read(reln);
+			bufHdr = BufferAlloc(smgr, relpersistence, forkNum,
+								 blockNum + i + nmiss, strategy, &found);
+			buffers[i + nmiss] = BufferDescriptorGetBuffer(bufHdr);
+			if (found)
+				break;
+			nmiss++;
+		}
+
+		ReadBufferRangeIO(smgr, forkNum, blockNum + i, nmiss, &buffers[i],
+						  IOContextForStrategy(strategy));
+		i += nmiss;
+
+		if (found)
+		{
+			pgstat_count_buffer_hit(reln);
+			pgBufferUsage.shared_blks_hit++;
+			VacuumPageHit++;
+			if (VacuumCostActive)
+				VacuumCostBalance += VacuumCostPageHit;
+			i++;
+		}
+	}
+}
+
+/*
+ * ReadBufferRangeIO -- read consecutive blocks into buffers that BufferAlloc
+ *		has marked IO_IN_PROGRESS, and mark them valid.
+ */
+static void
+ReadBufferRangeIO(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
+				  int nblocks, Buffer *buffers, IOContext io_context)
+{
+	char	   *blocks[MAX_IO_COMBINE_LIMIT];
+	instr_time	io_start,
+				io_time;
+	int			i;
+
+	Assert(nblocks <= MAX_IO_COMBINE_LIMIT);
+
+	for (i = 0; i < nblocks; i++)
+		blocks[i] = (char *) BufHdrGetBlock(GetBufferDescriptor(buffers[i] - 1));
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT_FAST(io_start);
+
+	smgrreadv(smgr, forkNum, blockNum, blocks, nblocks);
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT_FAST(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
+		INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+		pgstat_count_io_time(IOOBJECT_RELATION, io_context, IOOP_READ,
+							 io_time);
+	}
+	pgstat_count_io_op_n(IOOBJECT_RELATION, io_context, IOOP_READ, nblocks);
+
+	for (i = 0; i < nblocks; i++)
+	{
+		BufferDesc *bufHdr = GetBufferDescriptor(buffers[i] - 1);
+
+		/* check for garbage data */
+		if (!PageIsVerifiedExtended((Page) blocks[i], blockNum + i,
+									PIV_LOG_WARNING | PIV_REPORT_STAT))
+		{
+			if (zero_damaged_pages)
+			{
+				ereport(WARNING,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("invalid page in block %u of relation %s; zeroing out page",
+								blockNum + i,
+								relpath(smgr->smgr_rnode, forkNum))));
+				MemSet(blocks[i], 0, BLCKSZ);
+			}
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("invalid page in block %u of relation %s",
+								blockNum + i,
+								relpath(smgr->smgr_rnode, forkNum))));
+		}
+
+		/* Set BM_VALID, terminate IO, and wake up any waiters */
+		TerminateBufferIO(bufHdr, false, BM_VALID);
+
+		pgBufferUsage.shared_blks_read++;
+		VacuumPageMiss++;
+		if (VacuumCostActive)
+			VacuumCostBalance += VacuumCostPageMiss;
+	}
+}
+
 /*
  * ReadBufferWithoutRelcache -- like ReadBufferExtended, but doesn't require
  *		a relcache entry for the relation.
@@ -723,6 +933,8 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	bool		found;
 	bool		isExtend;
 	bool		isLocalBuf = SmgrIsTemp(smgr);
+	IOObject	io_object;
+	IOContext	io_context;
 
 	*hit = false;
 
@@ -744,6 +956,10 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	if (isLocalBuf)
 	{
+		/* local buffers don't use a strategy */
+		io_object = IOOBJECT_TEMP_RELATION;
+		io_context = IOCONTEXT_NORMAL;
+
 		bufHdr = LocalBufferAlloc(smgr, forkNum, blockNum, &found);
 		if (found)
 			pgBufferUsage.local_blks_hit++;
@@ -759,6 +975,9 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		 * lookup the buffer.  IO_IN_PROGRESS is set if the requested block is
 		 * not currently in memory.
 		 */
+		io_object = IOOBJECT_RELATION;
+		io_context = IOContextForStrategy(strategy);
+
 		bufHdr = BufferAlloc(smgr, relpersistence, forkNum, blockNum,
 							 strategy, &found);
 		if (found)
@@ -879,11 +1098,26 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	if (isExtend)
 	{
+		instr_time	io_start,
+					io_time;
+
 		/* new buffers are zero-filled */
 		MemSet((char *) bufBlock, 0, BLCKSZ);
+
+		if (track_io_timing)
+			INSTR_TIME_SET_CURRENT_FAST(io_start);
+
 		/* don't set checksum for all-zero page */
 		smgrextend(smgr, forkNum, blockNum, (char *) bufBlock, false);
 
+		if (track_io_timing)
+		{
+			INSTR_TIME_SET_CURRENT_FAST(io_time);
+			INSTR_TIME_SUBTRACT(io_time, io_start);
+			pgstat_count_io_time(io_object, io_context, IOOP_EXTEND, io_time);
+		}
+		pgstat_count_io_op(io_object, io_context, IOOP_EXTEND);
+
 		/*
 		 * NB: we're *not* doing a ScheduleBufferTagForWriteback here;
 		 * although we're essentially performing a write. At least on linux
@@ -905,17 +1139,20 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 						io_time;
 
 			if (track_io_timing)
-				INSTR_TIME_SET_CURRENT(io_start);
+				INSTR_TIME_SET_CURRENT_FAST(io_start);
 
 			smgrread(smgr, forkNum, blockNum, (char *) bufBlock);
 
 			if (track_io_timing)
 			{
-				INSTR_TIME_SET_CURRENT(io_time);
+				INSTR_TIME_SET_CURRENT_FAST(io_time);
 				INSTR_TIME_SUBTRACT(io_time, io_start);
 				pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
 				INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+				pgstat_count_io_time(io_object, io_context, IOOP_READ,
+									 io_time);
 			}
+			pgstat_count_io_op(io_object, io_context, IOOP_READ);
 
 			/* check for garbage data */
 			if (!PageIsVerifiedExtended((Page) bufBlock, blockNum,
@@ -1029,7 +1266,34 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
-	/* see if the block is in the buffer pool already */
+	/*
+	 * See if the block is in the buffer pool already.  First try without
+	 * taking the mapping lock.  In that case, the buffer can be evicted and
+	 * reused for another page before we manage to pin it, so once it's pinned
+	 * we have to check that it still holds our page.  Nobody can change that
+	 * anymore while we hold the pin.  If it doesn't, or if the lookup was
+	 * disturbed by concurrent changes, do it the normal way.
+	 */
+	if (BufTableTryLookup(&newTag, newHash, &buf_id) && buf_id >= 0)
+	{
+		buf = GetBufferDescriptor(buf_id);
+
+		valid = PinBuffer(buf, strategy);
+
+		if (BUFFERTAGS_EQUAL(buf->tag, newTag))
+		{
+			*foundPtr = true;
+
+			/* see below about buffers that are not valid yet */
+			if (!valid && StartBufferIO(buf, true))
+				*foundPtr = false;
+
+			return buf;
+		}
+
+		UnpinBuffer(buf, true);
+	}
+
 	LWLockAcquire(newPartitionLock, LW_SHARED);
 	buf_id = BufTableLookup(&newTag, newHash);
 	if (buf_id >= 0)
@@ -1158,7 +1422,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 														  smgr->smgr_rnode.node.dbNode,
 														  smgr->smgr_rnode.node.relNode);
 
-				FlushBuffer(buf, NULL);
+				FlushBuffer(buf, NULL, IOContextForStrategy(strategy));
 				LWLockRelease(BufferDescriptorGetContentLock(buf));
 
 				ScheduleBufferTagForWriteback(&BackendWritebackContext,
@@ -1842,6 +2106,7 @@ BufferSync(int flags)
 	Oid			last_tsid;
 	binaryheap *ts_heap;
 	int			i;
+	int			nrun;
 	int			mask = BM_DIRTY;
 	WritebackContext wb_context;
 
@@ -2028,8 +2293,6 @@ BufferSync(int flags)
 
 		bufHdr = GetBufferDescriptor(buf_id);
 
-		num_processed++;
-
 		/*
 		 * We don't need to acquire the lock here, because we're only looking
 		 * at a single bit. It's possible that someone else writes the buffer
@@ -2044,21 +2307,52 @@ BufferSync(int flags)
 		 */
 		if (pg_atomic_read_u32(&bufHdr->state) & BM_CHECKPOINT_NEEDED)
 		{
-			if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
+			int			results[MAX_IO_COMBINE_LIMIT];
+
+			/*
+			 * Collect the following buffers of this tablespace that appear to
+			 * hold the next blocks of the same relation fork, so that they can
+			 * be written together.  SyncBufferRun checks that they really do.
+			 */
+			nrun = 1;
+			while (nrun < io_combine_limit &&
+				   ts_stat->num_scanned + nrun < ts_stat->num_to_scan)
+			{
+				CkptSortItem *prev = &CkptBufferIds[ts_stat->index + nrun - 1];
+				CkptSortItem *next = &CkptBufferIds[ts_stat->index + nrun];
+
+				if (next->relNode != prev->relNode ||
+					next->forkNum != prev->forkNum ||
+					next->blockNum != prev->blockNum + 1)
+					break;
+				nrun++;
+			}
+
+			nrun = SyncBufferRun(&CkptBufferIds[ts_stat->index], nrun,
+								 results, &wb_context);
+
+			for (i = 0; i < nrun; i++)
 			{
-				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
-				BgWriterStats.m_buf_written_checkpoints++;
-				num_written++;
+				if (results[i] & BUF_WRITTEN)
+				{
+					TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(CkptBufferIds[ts_stat->index + i].buf_id);
+					BgWriterStats.m_buf_written_checkpoints++;
+					num_written++;
+				}
 			}
 		}
+		else
+			nrun = 1;
+
+		num_processed += nrun;
 
 		/*
 		 * Measure progress independent of actually having to flush the buffer
 		 * - otherwise writing become unbalanced.
 		 */
-		ts_stat->progress += ts_stat->progress_slice;
-		ts_stat->num_scanned++;
-		ts_stat->index++;
+		ts_stat->progress += ts_stat->progress_slice * nrun;
+		ts_stat->num_scanned += nrun;
+		ts_stat->index += nrun;
 
 		/* Have all the buffers from the tablespace been processed? */
 		if (ts_stat->num_scanned == ts_stat->num_to_scan)
@@ -2131,6 +2425,7 @@ BgBufferSync(WritebackContext *wb_context)
 	/* Potentially these could be tunables, but for now, not */
 	float		smoothing_samples = 16;
 	float		scan_whole_pool_milliseconds = 120000.0;
+	float		max_burst_factor = 4.0;
 
 	/* Used to compute how far we scan ahead */
 	long		strategy_delta;
@@ -2140,10 +2435,12 @@ BgBufferSync(WritebackContext *wb_context)
 	int			reusable_buffers_est;
 	int			upcoming_alloc_est;
 	int			min_scan_buffers;
+	int			min_clean_buffers;
 
 	/* Variables for the scanning loop proper */
 	int			num_to_scan;
 	int			num_written;
+	int			max_written;
 	int			reusable_buffers;
 
 	/* Variables for final smoothed_density update */
@@ -2269,6 +2566,31 @@ BgBufferSync(WritebackContext *wb_context)
 	bufs_ahead = NBuffers - bufs_to_lap;
 	reusable_buffers_est = (float) bufs_ahead / smoothed_density;
 
+	/*
+	 * If we're asked to keep a pool of clean buffers ahead of the strategy
+	 * point, allow writing more than bgwriter_lru_maxpages buffers while
+	 * allocations are bursting, ie, when they are well above their moving
+	 * average.  A burst would otherwise drain the pool within a round or two
+	 * and leave backends to write out their victims themselves.  The limit
+	 * grows with the size of the burst, up to max_burst_factor times
+	 * bgwriter_lru_maxpages.
+	 */
+	max_written = bgwriter_lru_maxpages;
+	if (bgwriter_lru_min_clean > 0 && recent_alloc > 2 * smoothed_alloc)
+	{
+		float		burst_factor = max_burst_factor;
+
+		if (smoothed_alloc > 0)
+			burst_factor = Min((float) recent_alloc / smoothed_alloc,
+							   max_burst_factor);
+		max_written = (int) Min((float) bgwriter_lru_maxpages * burst_factor,
+								(float) NBuffers);
+#ifdef BGW_DEBUG
+		elog(DEBUG2, "bgwriter: allocation burst recent_alloc=%u smoothed=%.2f, writing up to %d",
+			 recent_alloc, smoothed_alloc, max_written);
+#endif
+	}
+
 	/*
 	 * Track a moving average of recent buffer allocations.  Here, rather than
 	 * a true average we want a fast-attack, slow-decline behavior: we
@@ -2315,11 +2637,27 @@ BgBufferSync(WritebackContext *wb_context)
 		upcoming_alloc_est = min_scan_buffers + reusable_buffers_est;
 	}
 
+	/*
+	 * Regardless of the recent allocation rate, try to keep at least
+	 * bgwriter_lru_min_clean reusable buffers ahead of the strategy point,
+	 * so that a sudden burst of allocations finds clean buffers waiting.
+	 */
+	min_clean_buffers = Min(bgwriter_lru_min_clean, NBuffers);
+	if (upcoming_alloc_est < min_clean_buffers)
+	{
+#ifdef BGW_DEBUG
+		elog(DEBUG2, "bgwriter: alloc_est=%d too small, using min_clean=%d",
+			 upcoming_alloc_est, min_clean_buffers);
+#endif
+		upcoming_alloc_est = min_clean_buffers;
+	}
+
 	/*
 	 * Now write out dirty reusable buffers, working forward from the
 	 * next_to_clean point, until we have lapped the strategy scan, or cleaned
 	 * enough buffers to match our estimate of the next cycle's allocation
-	 * requirements, or hit the bgwriter_lru_maxpages limit.
+	 * requirements, or hit the bgwriter_lru_maxpages limit (or the raised
+	 * limit during an allocation burst).
 	 */
 
 	/* Make sure we can handle the pin inside SyncOneBuffer */
@@ -2345,7 +2683,7 @@ BgBufferSync(WritebackContext *wb_context)
 		if (sync_state & BUF_WRITTEN)
 		{
 			reusable_buffers++;
-			if (++num_written >= bgwriter_lru_maxpages)
+			if (++num_written >= max_written)
 			{
 				BgWriterStats.m_maxwritten_clean++;
 				break;
@@ -2456,7 +2794,7 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	PinBuffer_Locked(bufHdr);
 	LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
 
-	FlushBuffer(bufHdr, NULL);
+	FlushBuffer(bufHdr, NULL, IOCONTEXT_NORMAL);
 
 	LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 
@@ -2469,6 +2807,112 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	return result | BUF_WRITTEN;
 }
 
+/*
+ * SyncBufferRun -- write out checkpoint buffers holding consecutive blocks.
+ *
+ * items[] are consecutive entries of the sorted CkptBufferIds array, which
+ * appear to hold consecutive blocks of one relation fork.  As many of them as
+ * possible are written with a single FlushBuffers() call: the run ends early
+ * at the first buffer that turns out not to hold the next block, no longer
+ * needs to be written for the checkpoint, or can't be share-locked right
+ * away.
+ *
+ * Returns the number of items processed, which is at least one; the caller
+ * should proceed with the ones that follow.  results[i] is set like
+ * SyncOneBuffer's return value, so BUF_WRITTEN means we wrote items[i].
+ *
+ * Note: caller must have done ResourceOwnerEnlargeBuffers.
+ */
+static int
+SyncBufferRun(CkptSortItem *items, int nitems, int *results,
+			  WritebackContext *wb_context)
+{
+	BufferDesc *bufs[MAX_IO_COMBINE_LIMIT];
+	BufferTag	tag;
+	int			nbufs;
+
+	Assert(nitems >= 1 && nitems <= MAX_IO_COMBINE_LIMIT);
+
+	if (nitems == 1)
+	{
+		results[0] = SyncOneBuffer(items[0].buf_id, false, wb_context);
+		return 1;
+	}
+
+	for (nbufs = 0; nbufs < nitems; nbufs++)
+	{
+		BufferDesc *bufHdr = GetBufferDescriptor(items[nbufs].buf_id);
+		uint32		buf_state;
+
+		results[nbufs] = 0;
+
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+		ReservePrivateRefCountEntry();
+
+		/* See SyncOneBuffer for why the header lock is enough here */
+		buf_state = LockBufHdr(bufHdr);
+
+		if (nbufs == 0)
+		{
+			if (!(buf_state & BM_VALID) || !(buf_state & BM_DIRTY))
+			{
+				/* It's clean, so nothing to do */
+				UnlockBufHdr(bufHdr, buf_state);
+				return 1;
+			}
+			tag = bufHdr->tag;
+		}
+		else
+		{
+			tag.blockNum++;
+
+			if (!BUFFERTAGS_EQUAL(bufHdr->tag, tag) ||
+				!(buf_state & BM_CHECKPOINT_NEEDED) ||
+				!(buf_state & BM_VALID) || !(buf_state & BM_DIRTY))
+			{
+				UnlockBufHdr(bufHdr, buf_state);
+				break;
+			}
+		}
+
+		PinBuffer_Locked(bufHdr);
+
+		/*
+		 * Other code doesn't always lock several pages of a relation in
+		 * block order (a btree page split doesn't, for one), so we mustn't
+		 * wait for a content lock while holding others.
+		 */
+		if (nbufs == 0)
+			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
+		else if (!LWLockConditionalAcquire(BufferDescriptorGetContentLock(bufHdr),
+										   LW_SHARED))
+		{
+			UnpinBuffer(bufHdr, true);
+			break;
+		}
+
+		bufs[nbufs] = bufHdr;
+	}
+
+	/* (FlushBuffers will skip any buffers flushed by others meanwhile.) */
+	FlushBuffers(bufs, nbufs, NULL, IOCONTEXT_NORMAL);
+
+	for (int i = 0; i < nbufs; i++)
+	{
+		LWLockRelease(BufferDescriptorGetContentLock(bufs[i]));
+
+		tag = bufs[i]->tag;
+
+		UnpinBuffer(bufs[i], true);
+
+		ScheduleBufferTagForWriteback(wb_context, &tag);
+
+		results[i] = BUF_WRITTEN;
+	}
+
+	return nbufs;
+}
+
 /*
  *		AtEOXact_Buffers - clean up at end of transaction.
  *
@@ -2717,122 +3161,228 @@ BufferGetTag(Buffer buffer, RelFileNode *rnode, ForkNumber *forknum,
  * written.)
  *
  * If the caller has an smgr reference for the buffer's relation, pass it
- * as the second parameter.  If not, pass NULL.
+ * as the second parameter.  If not, pass NULL.  io_context says which
+ * pg_stat_io context the write is counted in.
  */
 static void
-FlushBuffer(BufferDesc *buf, SMgrRelation reln)
+FlushBuffer(BufferDesc *buf, SMgrRelation reln, IOContext io_context)
 {
-	XLogRecPtr	recptr;
+	FlushBuffers(&buf, 1, reln, io_context);
+}
+
+/*
+ * FlushBuffers
+ *		Physically write out shared buffers holding consecutive blocks.
+ *
+ * Like calling FlushBuffer() for each buffer, but the blocks are written
+ * with as few smgrwritev() calls as possible.  bufs[] must hold blocks
+ * blocknum, blocknum + 1, ... of one relation fork, all pinned and
+ * share-locked by the caller.
+ */
+static void
+FlushBuffers(BufferDesc **bufs, int nbufs, SMgrRelation reln,
+			 IOContext io_context)
+{
+	XLogRecPtr	recptr = InvalidXLogRecPtr;
 	ErrorContextCallback errcallback;
 	instr_time	io_start,
 				io_time;
-	Block		bufBlock;
-	char	   *bufToWrite;
-	uint32		buf_state;
+	bool		started[MAX_IO_COMBINE_LIMIT];
+	char	   *bufsToWrite[MAX_IO_COMBINE_LIMIT];
+	BufferDesc *first = NULL;
+	int			nstarted = 0;
+	int			i;
+
+	Assert(nbufs >= 1 && nbufs <= MAX_IO_COMBINE_LIMIT);
 
 	/*
-	 * Acquire the buffer's io_in_progress lock.  If StartBufferIO returns
+	 * Acquire the buffers' io_in_progress locks.  If StartBufferIO returns
 	 * false, then someone else flushed the buffer before we could, so we need
-	 * not do anything.
+	 * not do anything for it.
 	 */
-	if (!StartBufferIO(buf, false))
+	for (i = 0; i < nbufs; i++)
+	{
+		Assert(i == 0 ||
+			   bufs[i]->tag.blockNum == bufs[i - 1]->tag.blockNum + 1);
+
+		started[i] = StartBufferIO(bufs[i], false);
+		if (started[i])
+		{
+			if (first == NULL)
+				first = bufs[i];
+			nstarted++;
+		}
+	}
+
+	if (nstarted == 0)
 		return;
 
 	/* Setup error traceback support for ereport() */
 	errcallback.callback = shared_buffer_write_error_callback;
-	errcallback.arg = (void *) buf;
+	errcallback.arg = (void *) first;
 	errcallback.previous = error_context_stack;
 	error_context_stack = &errcallback;
 
 	/* Find smgr relation for buffer */
 	if (reln == NULL)
-		reln = smgropen(buf->tag.rnode, InvalidBackendId);
+		reln = smgropen(first->tag.rnode, InvalidBackendId);
 
-	TRACE_POSTGRESQL_BUFFER_FLUSH_START(buf->tag.forkNum,
-										buf->tag.blockNum,
-										reln->smgr_rnode.node.spcNode,
-										reln->smgr_rnode.node.dbNode,
-										reln->smgr_rnode.node.relNode);
+	for (i = 0; i < nbufs; i++)
+	{
+		BufferDesc *buf = bufs[i];
+		uint32		buf_state;
 
-	buf_state = LockBufHdr(buf);
+		if (!started[i])
+			continue;
 
-	/*
-	 * Run PageGetLSN while holding header lock, since we don't have the
-	 * buffer locked exclusively in all cases.
-	 */
-	recptr = BufferGetLSN(buf);
+		TRACE_POSTGRESQL_BUFFER_FLUSH_START(buf->tag.forkNum,
+											buf->tag.blockNum,
+											reln->smgr_rnode.node.spcNode,
+											reln->smgr_rnode.node.dbNode,
+											reln->smgr_rnode.node.relNode);
 
-	/* To check if block content changes while flushing. - vadim 01/17/97 */
-	buf_state &= ~BM_JUST_DIRTIED;
-	UnlockBufHdr(buf, buf_state);
+		buf_state = LockBufHdr(buf);
+
+		/*
+		 * Run PageGetLSN while holding header lock, since we don't have the
+		 * buffer locked exclusively in all cases.  Only the highest LSN of
+		 * the run matters to the XLogFlush() below.
+		 *
+		 * However, the WAL rule does not apply to unlogged relations, which
+		 * will be lost after a crash anyway.  Most unlogged relation pages do
+		 * not bear LSNs since we never emit WAL records for them, and
+		 * therefore flushing up through the buffer LSN would be useless, but
+		 * harmless.  However, GiST indexes use LSNs internally to track
+		 * page-splits, and therefore unlogged GiST pages bear "fake" LSNs
+		 * generated by GetFakeLSNForUnloggedRel.  It is unlikely but possible
+		 * that the fake LSN counter could advance past the WAL insertion
+		 * point; and if it did happen, attempting to flush WAL through that
+		 * location would fail, with disastrous system-wide consequences.  To
+		 * make sure that can't happen, skip the flush if the buffer isn't
+		 * permanent.
+		 */
+		if ((buf_state & BM_PERMANENT) && BufferGetLSN(buf) > recptr)
+			recptr = BufferGetLSN(buf);
+
+		/* To check if block content changes while flushing. - vadim 01/17/97 */
+		buf_state &= ~BM_JUST_DIRTIED;
+		UnlockBufHdr(buf, buf_state);
+	}
 
 	/*
-	 * Force XLOG flush up to buffer's LSN.  This implements the basic WAL
+	 * Force XLOG flush up to the buffers' LSN.  This implements the basic WAL
 	 * rule that log updates must hit disk before any of the data-file changes
 	 * they describe do.
-	 *
-	 * However, this rule does not apply to unlogged relations, which will be
-	 * lost after a crash anyway.  Most unlogged relation pages do not bear
-	 * LSNs since we never emit WAL records for them, and therefore flushing
-	 * up through the buffer LSN would be useless, but harmless.  However,
-	 * GiST indexes use LSNs internally to track page-splits, and therefore
-	 * unlogged GiST pages bear "fake" LSNs generated by
-	 * GetFakeLSNForUnloggedRel.  It is unlikely but possible that the fake
-	 * LSN counter could advance past the WAL insertion point; and if it did
-	 * happen, attempting to flush WAL through that location would fail, with
-	 * disastrous system-wide consequences.  To make sure that can't happen,
-	 * skip the flush if the buffer isn't permanent.
 	 */
-	if (buf_state & BM_PERMANENT)
+	if (!XLogRecPtrIsInvalid(recptr))
 		XLogFlush(recptr);
 
 	/*
-	 * Now it's safe to write buffer to disk. Note that no one else should
-	 * have been able to write it while we were busy with log flushing because
-	 * we have the io_in_progress lock.
+	 * Now it's safe to write the buffers to disk. Note that no one else
+	 * should have been able to write them while we were busy with log
+	 * flushing because we have the io_in_progress locks.
+	 *
+	 * Update page checksums if desired.  Since we have only shared locks on
+	 * the buffers, other processes might be updating hint bits in them, so we
+	 * must copy the pages to private storage if we do checksumming.
+	 * PageSetChecksumCopy() has room for one page only, so runs get copies of
+	 * their own.
 	 */
-	bufBlock = BufHdrGetBlock(buf);
+	for (i = 0; i < nbufs; i++)
+	{
+		Page		page = (Page) BufHdrGetBlock(bufs[i]);
 
-	/*
-	 * Update page checksum if desired.  Since we have only shared lock on the
-	 * buffer, other processes might be updating hint bits in it, so we must
-	 * copy the page to private storage if we do checksumming.
-	 */
-	bufToWrite = PageSetChecksumCopy((Page) bufBlock, buf->tag.blockNum);
+		if (!started[i])
+			continue;
+
+		if (nbufs == 1)
+			bufsToWrite[i] = PageSetChecksumCopy(page, bufs[i]->tag.blockNum);
+		else if (PageIsNew(page) || !DataChecksumsEnabled())
+			bufsToWrite[i] = page;
+		else
+		{
+			if (FlushPageCopies == NULL)
+				FlushPageCopies = (char *)
+					TYPEALIGN(PG_IO_ALIGN_SIZE,
+							  MemoryContextAlloc(TopMemoryContext,
+												 MAX_IO_COMBINE_LIMIT * BLCKSZ +
+												 PG_IO_ALIGN_SIZE));
+			bufsToWrite[i] = FlushPageCopies + i * BLCKSZ;
+			memcpy(bufsToWrite[i], page, BLCKSZ);
+			PageSetChecksumInplace((Page) bufsToWrite[i], bufs[i]->tag.blockNum);
+		}
+	}
 
 	if (track_io_timing)
-		INSTR_TIME_SET_CURRENT(io_start);
+		INSTR_TIME_SET_CURRENT_FAST(io_start);
 
 	/*
-	 * bufToWrite is either the shared buffer or a copy, as appropriate.
+	 * bufsToWrite[] hold either the shared buffers or copies, as appropriate.
+	 * Write each stretch of buffers we started I/O on with one call.
 	 */
-	smgrwrite(reln,
-			  buf->tag.forkNum,
-			  buf->tag.blockNum,
-			  bufToWrite,
-			  false);
+	i = 0;
+	while (i < nbufs)
+	{
+		int			nrun = 0;
+
+		if (!started[i])
+		{
+			i++;
+			continue;
+		}
+
+		while (i + nrun < nbufs && started[i + nrun])
+			nrun++;
+
+		if (nrun == 1)
+			smgrwrite(reln,
+					  bufs[i]->tag.forkNum,
+					  bufs[i]->tag.blockNum,
+					  bufsToWrite[i],
+					  false);
+		else
+			smgrwritev(reln,
+					   bufs[i]->tag.forkNum,
+					   bufs[i]->tag.blockNum,
+					   &bufsToWrite[i],
+					   nrun,
+					   false);
+
+		i += nrun;
+	}
 
 	if (track_io_timing)
 	{
-		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SET_CURRENT_FAST(io_time);
 		INSTR_TIME_SUBTRACT(io_time, io_start);
 		pgstat_count_buffer_write_time(INSTR_TIME_GET_MICROSEC(io_time));
 		INSTR_TIME_ADD(pgBufferUsage.blk_write_time, io_time);
+		pgstat_count_io_time(IOOBJECT_RELATION, io_context, IOOP_WRITE,
+							 io_time);
 	}
 
-	pgBufferUsage.shared_blks_written++;
+	pgBufferUsage.shared_blks_written += nstarted;
+	pgstat_count_io_op_n(IOOBJECT_RELATION, io_context, IOOP_WRITE, nstarted);
 
-	/*
-	 * Mark the buffer as clean (unless BM_JUST_DIRTIED has become set) and
-	 * end the io_in_progress state.
-	 */
-	TerminateBufferIO(buf, true, 0);
+	for (i = 0; i < nbufs; i++)
+	{
+		BufferDesc *buf = bufs[i];
 
-	TRACE_POSTGRESQL_BUFFER_FLUSH_DONE(buf->tag.forkNum,
-									   buf->tag.blockNum,
-									   reln->smgr_rnode.node.spcNode,
-									   reln->smgr_rnode.node.dbNode,
-									   reln->smgr_rnode.node.relNode);
+		if (!started[i])
+			continue;
+
+		/*
+		 * Mark the buffer as clean (unless BM_JUST_DIRTIED has become set)
+		 * and end the io_in_progress state.
+		 */
+		TerminateBufferIO(buf, true, 0);
+
+		TRACE_POSTGRESQL_BUFFER_FLUSH_DONE(buf->tag.forkNum,
+										   buf->tag.blockNum,
+										   reln->smgr_rnode.node.spcNode,
+										   reln->smgr_rnode.node.dbNode,
+										   reln->smgr_rnode.node.relNode);
+	}
 
 	/* Pop the error context stack */
 	error_context_stack = errcallback.previous;
@@ -2967,18 +3517,23 @@ BufferGetLSNAtomic(Buffer buffer)
  *		that no other process could be trying to load more pages of the
  *		relation into buffers.
  *
- *		XXX currently it sequentially searches the buffer pool, should be
- *		changed to more clever ways of searching.  However, this routine
- *		is used only in code paths that aren't very performance-critical,
- *		and we shouldn't slow down the hot paths to make it faster ...
+ *		If the exact size of every fork is known, which is currently the case
+ *		only in recovery, and there are few enough blocks to drop, we look up
+ *		each of them in the buffer mapping table.  Otherwise we sequentially
+ *		search the whole buffer pool.
  * --------------------------------------------------------------------
  */
 void
-DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber *forkNum,
+DropRelFileNodeBuffers(SMgrRelation smgr_reln, ForkNumber *forkNum,
 					   int nforks, BlockNumber *firstDelBlock)
 {
 	int			i;
 	int			j;
+	RelFileNodeBackend rnode;
+	BlockNumber nForkBlock[MAX_FORKNUM + 1];
+	uint64		nBlocksToInvalidate = 0;
+
+	rnode = smgr_reln->smgr_rnode;
 
 	/* If it's a local relation, it's localbuf.c's problem. */
 	if (RelFileNodeBackendIsTemp(rnode))
@@ -2992,6 +3547,57 @@ DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber *forkNum,
 		return;
 	}
 
+	/*
+	 * To remove all the pages of the specified relation forks from the buffer
+	 * pool, we need to scan the entire buffer pool but we can optimize it by
+	 * finding the buffers from BufMapping table provided we know the exact
+	 * size of each fork of the relation. The exact size is required to ensure
+	 * that we don't leave any buffer for the relation being dropped as
+	 * otherwise the background writer or checkpointer can lead to a PANIC
+	 * error while flushing buffers corresponding to files that don't exist.
+	 *
+	 * To know the exact size, we rely on the size cached for each fork by us
+	 * during recovery which limits the optimization to recovery and on
+	 * standbys but we can easily extend it once we have shared cache for
+	 * relation size.
+	 *
+	 * In recovery, we cache the value returned by the first lseek(SEEK_END)
+	 * and the future writes keeps the cached value up-to-date. See
+	 * smgrextend. It is possible that the value of the first lseek is smaller
+	 * than the actual number of existing blocks in the file due to buggy
+	 * Linux kernels that might not have accounted for the recent write. But
+	 * that should be fine because there must not be any buffers after that
+	 * file size.
+	 */
+	for (i = 0; i < nforks; i++)
+	{
+		/* Get the number of blocks for a relation's fork */
+		nForkBlock[i] = smgrnblocks_cached(smgr_reln, forkNum[i]);
+
+		if (nForkBlock[i] == InvalidBlockNumber)
+		{
+			nBlocksToInvalidate = InvalidBlockNumber;
+			break;
+		}
+
+		/* calculate the number of blocks to be invalidated */
+		if (nForkBlock[i] > firstDelBlock[i])
+			nBlocksToInvalidate += (nForkBlock[i] - firstDelBlock[i]);
+	}
+
+	/*
+	 * We apply the optimization iff the total number of blocks to invalidate
+	 * is below the BUF_DROP_FULL_SCAN_THRESHOLD.
+	 */
+	if (BlockNumberIsValid(nBlocksToInvalidate) &&
+		nBlocksToInvalidate < BUF_DROP_FULL_SCAN_THRESHOLD)
+	{
+		for (j = 0; j < nforks; j++)
+			FindAndDropRelFileNodeBuffers(rnode.node, forkNum[j],
+										  nForkBlock[j], firstDelBlock[j]);
+		return;
+	}
+
 	for (i = 0; i < NBuffers; i++)
 	{
 		BufferDesc *bufHdr = GetBufferDescriptor(i);
@@ -3043,28 +3649,33 @@ DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber *forkNum,
  * --------------------------------------------------------------------
  */
 void
-DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
+DropRelFileNodesAllBuffers(SMgrRelation *smgr_reln, int nnodes)
 {
-	int			i,
-				n = 0;
+	int			i;
+	int			j;
+	int			n = 0;
+	SMgrRelation *rels;
+	BlockNumber (*block)[MAX_FORKNUM + 1];
+	uint64		nBlocksToInvalidate = 0;
 	RelFileNode *nodes;
+	bool		cached = true;
 	bool		use_bsearch;
 
 	if (nnodes == 0)
 		return;
 
-	nodes = palloc(sizeof(RelFileNode) * nnodes);	/* non-local relations */
+	rels = palloc(sizeof(SMgrRelation) * nnodes);	/* non-local relations */
 
 	/* If it's a local relation, it's localbuf.c's problem. */
 	for (i = 0; i < nnodes; i++)
 	{
-		if (RelFileNodeBackendIsTemp(rnodes[i]))
+		if (RelFileNodeBackendIsTemp(smgr_reln[i]->smgr_rnode))
 		{
-			if (rnodes[i].backend == MyBackendId)
-				DropRelFileNodeAllLocalBuffers(rnodes[i].node);
+			if (smgr_reln[i]->smgr_rnode.backend == MyBackendId)
+				DropRelFileNodeAllLocalBuffers(smgr_reln[i]->smgr_rnode.node);
 		}
 		else
-			nodes[n++] = rnodes[i].node;
+			rels[n++] = smgr_reln[i];
 	}
 
 	/*
@@ -3073,10 +3684,72 @@ DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
 	 */
 	if (n == 0)
 	{
-		pfree(nodes);
+		pfree(rels);
+		return;
+	}
+
+	/*
+	 * This is used to remember the number of blocks for all the relations
+	 * forks.
+	 */
+	block = (BlockNumber (*)[MAX_FORKNUM + 1])
+		palloc(sizeof(BlockNumber) * n * (MAX_FORKNUM + 1));
+
+	/*
+	 * We can avoid scanning the entire buffer pool if we know the exact size
+	 * of each of the given relation forks. See DropRelFileNodeBuffers.
+	 */
+	for (i = 0; i < n && cached; i++)
+	{
+		for (j = 0; j <= MAX_FORKNUM; j++)
+		{
+			/* Get the number of blocks for a relation's fork. */
+			block[i][j] = smgrnblocks_cached(rels[i], j);
+
+			/* We need to only consider the relation forks that exists. */
+			if (block[i][j] == InvalidBlockNumber)
+			{
+				if (!smgrexists(rels[i], j))
+					continue;
+				cached = false;
+				break;
+			}
+
+			/* calculate the total number of blocks to be invalidated */
+			nBlocksToInvalidate += block[i][j];
+		}
+	}
+
+	/*
+	 * We apply the optimization iff the total number of blocks to invalidate
+	 * is below the BUF_DROP_FULL_SCAN_THRESHOLD.
+	 */
+	if (cached && nBlocksToInvalidate < BUF_DROP_FULL_SCAN_THRESHOLD)
+	{
+		for (i = 0; i < n; i++)
+		{
+			for (j = 0; j <= MAX_FORKNUM; j++)
+			{
+				/* ignore relation forks that doesn't exist */
+				if (!BlockNumberIsValid(block[i][j]))
+					continue;
+
+				/* drop all the buffers for a particular relation fork */
+				FindAndDropRelFileNodeBuffers(rels[i]->smgr_rnode.node,
+											  j, block[i][j], 0);
+			}
+		}
+
+		pfree(block);
+		pfree(rels);
 		return;
 	}
 
+	pfree(block);
+	nodes = palloc(sizeof(RelFileNode) * n);	/* non-local relations */
+	for (i = 0; i < n; i++)
+		nodes[i] = rels[i]->smgr_rnode.node;
+
 	/*
 	 * For low number of relations to drop just use a simple walk through, to
 	 * save the bsearch overhead. The threshold to use is rather a guess than
@@ -3132,6 +3805,69 @@ DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
 	}
 
 	pfree(nodes);
+	pfree(rels);
+}
+
+/* ---------------------------------------------------------------------
+ *		FindAndDropRelFileNodeBuffers
+ *
+ *		This function performs look up in BufMapping table and removes from the
+ *		buffer pool all the pages of the specified relation fork that has block
+ *		number >= firstDelBlock. (In particular, with firstDelBlock = 0, all
+ *		pages are removed.)
+ * --------------------------------------------------------------------
+ */
+static void
+FindAndDropRelFileNodeBuffers(RelFileNode rnode, ForkNumber forkNum,
+							  BlockNumber nForkBlock,
+							  BlockNumber firstDelBlock)
+{
+	BlockNumber curBlock;
+
+	for (curBlock = firstDelBlock; curBlock < nForkBlock; curBlock++)
+	{
+		uint32		bufHash;	/* hash value for tag */
+		BufferTag	bufTag;		/* identity of requested block */
+		LWLock	   *bufPartitionLock;	/* buffer partition lock for it */
+		int			buf_id;
+		BufferDesc *bufHdr;
+		uint32		buf_state;
+
+		/* create a tag so we can lookup the buffer */
+		INIT_BUFFERTAG(bufTag, rnode, forkNum, curBlock);
+
+		/* determine its hash code and partition lock ID */
+		bufHash = BufTableHashCode(&bufTag);
+		bufPartitionLock = BufMappingPartitionLock(bufHash);
+
+		/* Check that it is in the buffer pool. If not, do nothing. */
+		if (!BufTableTryLookup(&bufTag, bufHash, &buf_id))
+		{
+			LWLockAcquire(bufPartitionLock, LW_SHARED);
+			buf_id = BufTableLookup(&bufTag, bufHash);
+			LWLockRelease(bufPartitionLock);
+		}
+
+		if (buf_id < 0)
+			continue;
+
+		bufHdr = GetBufferDescriptor(buf_id);
+
+		/*
+		 * We need to lock the buffer header and recheck if the buffer is
+		 * still associated with the same block because the buffer could be
+		 * evicted by some other backend loading blocks for a different
+		 * relation after we release lock on the BufMapping table.
+		 */
+		buf_state = LockBufHdr(bufHdr);
+
+		if (RelFileNodeEquals(bufHdr->tag.rnode, rnode) &&
+			bufHdr->tag.forkNum == forkNum &&
+			bufHdr->tag.blockNum >= firstDelBlock)
+			InvalidateBuffer(bufHdr);	/* releases spinlock */
+		else
+			UnlockBufHdr(bufHdr, buf_state);
+	}
 }
 
 /* ---------------------------------------------------------------------
@@ -3288,6 +4024,8 @@ FlushRelationBuffers(Relation rel)
 						  bufHdr->tag.blockNum,
 						  localpage,
 						  false);
+				pgstat_count_io_op(IOOBJECT_TEMP_RELATION, IOCONTEXT_NORMAL,
+								   IOOP_WRITE);
 
 				buf_state &= ~(BM_DIRTY | BM_JUST_DIRTIED);
 				pg_atomic_unlocked_write_u32(&bufHdr->state, buf_state);
@@ -3324,7 +4062,7 @@ FlushRelationBuffers(Relation rel)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, rel->rd_smgr);
+			FlushBuffer(bufHdr, rel->rd_smgr, IOCONTEXT_NORMAL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3420,7 +4158,7 @@ FlushRelationsAllBuffers(SMgrRelation *smgrs, int nrels)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, srelent->srel);
+			FlushBuffer(bufHdr, srelent->srel, IOCONTEXT_NORMAL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3476,7 +4214,7 @@ FlushDatabaseBuffers(Oid dbid)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, NULL);
+			FlushBuffer(bufHdr, NULL, IOCONTEXT_NORMAL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3503,7 +4241,7 @@ FlushOneBuffer(Buffer buffer)
 
 	Assert(LWLockHeldByMe(BufferDescriptorGetContentLock(bufHdr)));
 
-	FlushBuffer(bufHdr, NULL);
+	FlushBuffer(bufHdr, NULL, IOCONTEXT_NORMAL);
 }
 
 /*
@@ -4084,7 +4822,8 @@ WaitIO(BufferDesc *buf)
 /*
  * StartBufferIO: begin I/O on this buffer
  *	(Assumptions)
- *	My process is executing no IO
+ *	My process is executing no IO, other than reads started by
+ *	ReadBufferRange() and possibly one write of a victim buffer
  *	The buffer is Pinned
  *
  * In some scenarios there are race conditions in which multiple backends
@@ -4104,7 +4843,7 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 {
 	uint32		buf_state;
 
-	Assert(!InProgressBuf);
+	Assert(NumInProgressBufs < MAX_IN_PROGRESS_BUFS);
 
 	for (;;)
 	{
@@ -4143,8 +4882,9 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 	buf_state |= BM_IO_IN_PROGRESS;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = buf;
-	IsForInput = forInput;
+	InProgressBufs[NumInProgressBufs] = buf;
+	InProgressIsForInput[NumInProgressBufs] = forInput;
+	NumInProgressBufs++;
 
 	return true;
 }
@@ -4170,8 +4910,14 @@ static void
 TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 {
 	uint32		buf_state;
+	int			i;
 
-	Assert(buf == InProgressBuf);
+	for (i = NumInProgressBufs - 1; i >= 0; i--)
+	{
+		if (InProgressBufs[i] == buf)
+			break;
+	}
+	Assert(i >= 0);
 
 	buf_state = LockBufHdr(buf);
 
@@ -4184,7 +4930,10 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 	buf_state |= set_flag_bits;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = NULL;
+	/* forget it, keeping the array dense */
+	NumInProgressBufs--;
+	InProgressBufs[i] = InProgressBufs[NumInProgressBufs];
+	InProgressIsForInput[i] = InProgressIsForInput[NumInProgressBufs];
 
 	LWLockRelease(BufferDescriptorGetIOLock(buf));
 }
@@ -4201,10 +4950,9 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 void
 AbortBufferIO(void)
 {
-	BufferDesc *buf = InProgressBuf;
-
-	if (buf)
+	while (NumInProgressBufs > 0)
 	{
+		BufferDesc *buf = InProgressBufs[NumInProgressBufs - 1];
 		uint32		buf_state;
 
 		/*
@@ -4217,7 +4965,7 @@ AbortBufferIO(void)
 
 		buf_state = LockBufHdr(buf);
 		Assert(buf_state & BM_IO_IN_PROGRESS);
-		if (IsForInput)
+		if (InProgressIsForInput[NumInProgressBufs - 1])
 		{
 			Assert(!(buf_state & BM_DIRTY));
 
@@ -22,22 +22,50 @@
 
 #define INT_ACCESS_ONCE(var)	((int)(*((volatile int *)&(var))))
 
+/* GUC variable */
+int			clock_sweep_partitions = 1;
 
 /*
- * The shared freelist control information.
+ * The buffer pool is divided into clock_sweep_partitions contiguous ranges,
+ * each with its own clock sweep hand, so that backends evicting buffers
+ * concurrently don't all hammer the same atomic counter.  Each backend starts
+ * sweeping in the partition selected by its pgprocno and only moves on to the
+ * others if every buffer in its own is pinned.
  */
 typedef struct
 {
-	/* Spinlock: protects the values below */
-	slock_t		buffer_strategy_lock;
+	/* Spinlock: protects completePasses */
+	slock_t		clock_sweep_lock;
 
 	/*
-	 * Clock sweep hand: index of next buffer to consider grabbing. Note that
-	 * this isn't a concrete buffer - we only ever increase the value. So, to
-	 * get an actual buffer, it needs to be used modulo NBuffers.
+	 * Clock sweep hand: index of next buffer of this partition to consider
+	 * grabbing, relative to firstBuffer. Note that this isn't a concrete
+	 * buffer - we only ever increase the value. So, to get an actual buffer,
+	 * it needs to be used modulo numBuffers.
 	 */
 	pg_atomic_uint32 nextVictimBuffer;
 
+	uint32		completePasses; /* Complete cycles of the clock sweep */
+
+	int			firstBuffer;	/* first buffer of the partition */
+	int			numBuffers;		/* number of buffers in the partition */
+} ClockSweepPartition;
+
+/* Give each partition its own cache line(s) */
+typedef union ClockSweepPartitionPadded
+{
+	ClockSweepPartition part;
+	char		pad[TYPEALIGN(PG_CACHE_LINE_SIZE, sizeof(ClockSweepPartition))];
+} ClockSweepPartitionPadded;
+
+/*
+ * The shared freelist control information.
+ */
+typedef struct
+{
+	/* Spinlock: protects the values below */
+	slock_t		buffer_strategy_lock;
+
 	int			firstFreeBuffer;	/* Head of list of unused buffers */
 	int			lastFreeBuffer; /* Tail of list of unused buffers */
 
@@ -50,7 +78,6 @@ typedef struct
 	 * Statistics.  These counters should be wide enough that they can't
 	 * overflow during a single bgwriter cycle.
 	 */
-	uint32		completePasses; /* Complete cycles of the clock sweep */
 	pg_atomic_uint32 numBufferAllocs;	/* Buffers allocated since last reset */
 
 	/*
@@ -58,6 +85,10 @@ typedef struct
 	 * StrategyNotifyBgWriter.
 	 */
 	int			bgwprocno;
+
+	/* Clock sweep partitions */
+	int			numPartitions;
+	ClockSweepPartitionPadded partitions[FLEXIBLE_ARRAY_MEMBER];
 } BufferStrategyControl;
 
 /* Pointers to shared state */
@@ -106,11 +137,11 @@ static void AddBufferToRing(BufferAccessStrategy strategy,
 /*
  * ClockSweepTick - Helper routine for StrategyGetBuffer()
  *
- * Move the clock hand one buffer ahead of its current position and return the
- * id of the buffer now under the hand.
+ * Move the clock hand of the given partition one buffer ahead of its current
+ * position and return the id of the buffer now under the hand.
  */
 static inline uint32
-ClockSweepTick(void)
+ClockSweepTick(ClockSweepPartition *part)
 {
 	uint32		victim;
 
@@ -120,14 +151,14 @@ ClockSweepTick(void)
 	 * apparent order.
 	 */
 	victim =
-		pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, 1);
+		pg_atomic_fetch_add_u32(&part->nextVictimBuffer, 1);
 
-	if (victim >= NBuffers)
+	if (victim >= part->numBuffers)
 	{
 		uint32		originalVictim = victim;
 
 		/* always wrap what we look up in BufferDescriptors */
-		victim = victim % NBuffers;
+		victim = victim % part->numBuffers;
 
 		/*
 		 * If we're the one that just caused a wraparound, force
@@ -153,19 +184,19 @@ ClockSweepTick(void)
 				 * could lead to an overflow of nextVictimBuffers, but that's
 				 * highly unlikely and wouldn't be particularly harmful.
 				 */
-				SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
+				SpinLockAcquire(&part->clock_sweep_lock);
 
-				wrapped = expected % NBuffers;
+				wrapped = expected % part->numBuffers;
 
-				success = pg_atomic_compare_exchange_u32(&StrategyControl->nextVictimBuffer,
+				success = pg_atomic_compare_exchange_u32(&part->nextVictimBuffer,
 														 &expected, wrapped);
 				if (success)
-					StrategyControl->completePasses++;
-				SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+					part->completePasses++;
+				SpinLockRelease(&part->clock_sweep_lock);
 			}
 		}
 	}
-	return victim;
+	return part->firstBuffer + victim;
 }
 
 /*
@@ -203,6 +234,9 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 	BufferDesc *buf;
 	int			bgwprocno;
 	int			trycounter;
+	int			partno;
+	ClockSweepPartition *part;
+	int			part_trycounter;
 	uint32		local_buf_state;	/* to avoid repeated (de-)referencing */
 
 	/*
@@ -312,11 +346,17 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 		}
 	}
 
-	/* Nothing on the freelist, so run the "clock sweep" algorithm */
+	/*
+	 * Nothing on the freelist, so run the "clock sweep" algorithm, starting
+	 * in this backend's own partition.
+	 */
+	partno = MyProc ? MyProc->pgprocno % StrategyControl->numPartitions : 0;
+	part = &StrategyControl->partitions[partno].part;
+	part_trycounter = part->numBuffers;
 	trycounter = NBuffers;
 	for (;;)
 	{
-		buf = GetBufferDescriptor(ClockSweepTick());
+		buf = GetBufferDescriptor(ClockSweepTick(part));
 
 		/*
 		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
@@ -331,6 +371,7 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 				local_buf_state -= BUF_USAGECOUNT_ONE;
 
 				trycounter = NBuffers;
+				part_trycounter = part->numBuffers;
 			}
 			else
 			{
@@ -353,6 +394,13 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 			UnlockBufHdr(buf, local_buf_state);
 			elog(ERROR, "no unpinned buffers available");
 		}
+		else if (--part_trycounter == 0)
+		{
+			/* Everything in this partition is pinned, try the next one */
+			partno = (partno + 1) % StrategyControl->numPartitions;
+			part = &StrategyControl->partitions[partno].part;
+			part_trycounter = part->numBuffers;
+		}
 		UnlockBufHdr(buf, local_buf_state);
 	}
 }
@@ -390,33 +438,45 @@ StrategyFreeBuffer(BufferDesc *buf)
  * the higher-order bits of nextVictimBuffer) and the count of recent buffer
  * allocs if non-NULL pointers are passed.  The alloc count is reset after
  * being read.
+ *
+ * With several clock sweep partitions there is no single hand position.  We
+ * then add up how far all the hands have moved and report that as if it were
+ * the progress of a single hand over the whole pool, which is what the
+ * bgwriter's estimates are based on.
  */
 int
 StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc)
 {
-	uint32		nextVictimBuffer;
+	uint64		total = 0;
 	int			result;
 
-	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
-	nextVictimBuffer = pg_atomic_read_u32(&StrategyControl->nextVictimBuffer);
-	result = nextVictimBuffer % NBuffers;
-
-	if (complete_passes)
+	for (int i = 0; i < StrategyControl->numPartitions; i++)
 	{
-		*complete_passes = StrategyControl->completePasses;
+		ClockSweepPartition *part = &StrategyControl->partitions[i].part;
+		uint32		nextVictimBuffer;
+		uint32		completePasses;
+
+		SpinLockAcquire(&part->clock_sweep_lock);
+		nextVictimBuffer = pg_atomic_read_u32(&part->nextVictimBuffer);
+		completePasses = part->completePasses;
+		SpinLockRelease(&part->clock_sweep_lock);
 
 		/*
-		 * Additionally add the number of wraparounds that happened before
+		 * nextVictimBuffer may include wraparounds that happened before
 		 * completePasses could be incremented. C.f. ClockSweepTick().
 		 */
-		*complete_passes += nextVictimBuffer / NBuffers;
+		total += (uint64) completePasses * part->numBuffers + nextVictimBuffer;
 	}
 
+	result = (int) (total % NBuffers);
+
+	if (complete_passes)
+		*complete_passes = (uint32) (total / NBuffers);
+
 	if (num_buf_alloc)
 	{
 		*num_buf_alloc = pg_atomic_exchange_u32(&StrategyControl->numBufferAllocs, 0);
 	}
-	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 	return result;
 }
 
@@ -442,6 +502,17 @@ StrategyNotifyBgWriter(int bgwprocno)
 }
 
 
+/*
+ * Size of BufferStrategyControl, including its clock sweep partitions.
+ */
+static Size
+StrategyControlSize(void)
+{
+	return add_size(offsetof(BufferStrategyControl, partitions),
+					mul_size(Min(clock_sweep_partitions, NBuffers),
+							 sizeof(ClockSweepPartitionPadded)));
+}
+
 /*
  * StrategyShmemSize
  *
@@ -459,7 +530,7 @@ StrategyShmemSize(void)
 	size = add_size(size, BufTableShmemSize(NBuffers + NUM_BUFFER_PARTITIONS));
 
 	/* size of the shared replacement strategy control block */
-	size = add_size(size, MAXALIGN(sizeof(BufferStrategyControl)));
+	size = add_size(size, MAXALIGN(StrategyControlSize()));
 
 	return size;
 }
@@ -493,7 +564,7 @@ StrategyInitialize(bool init)
 	 */
 	StrategyControl = (BufferStrategyControl *)
 		ShmemInitStruct("Buffer Strategy Status",
-						sizeof(BufferStrategyControl),
+						StrategyControlSize(),
 						&found);
 
 	if (!found)
@@ -512,11 +583,27 @@ StrategyInitialize(bool init)
 		StrategyControl->firstFreeBuffer = 0;
 		StrategyControl->lastFreeBuffer = NBuffers - 1;
 
-		/* Initialize the clock sweep pointer */
-		pg_atomic_init_u32(&StrategyControl->nextVictimBuffer, 0);
+		/*
+		 * Divide the buffers between the clock sweep partitions as evenly as
+		 * possible, and initialize their clock sweep pointers.
+		 */
+		StrategyControl->numPartitions = Min(clock_sweep_partitions, NBuffers);
+		for (int i = 0; i < StrategyControl->numPartitions; i++)
+		{
+			ClockSweepPartition *part = &StrategyControl->partitions[i].part;
+			int			first = (int) ((int64) NBuffers * i /
+									   StrategyControl->numPartitions);
+			int			next = (int) ((int64) NBuffers * (i + 1) /
+									  StrategyControl->numPartitions);
+
+			SpinLockInit(&part->clock_sweep_lock);
+			pg_atomic_init_u32(&part->nextVictimBuffer, 0);
+			part->completePasses = 0;
+			part->firstBuffer = first;
+			part->numBuffers = next - first;
+		}
 
 		/* Clear statistics */
-		StrategyControl->completePasses = 0;
 		pg_atomic_init_u32(&StrategyControl->numBufferAllocs, 0);
 
 		/* No pending notification */
@@ -601,6 +688,31 @@ FreeAccessStrategy(BufferAccessStrategy strategy)
 		pfree(strategy);
 }
 
+/*
+ * IOContextForStrategy -- the pg_stat_io context to charge I/O done on
+ *		behalf of the given strategy to
+ */
+IOContext
+IOContextForStrategy(BufferAccessStrategy strategy)
+{
+	if (strategy == NULL)
+		return IOCONTEXT_NORMAL;
+
+	switch (strategy->btype)
+	{
+		case BAS_NORMAL:
+			break;
+		case BAS_BULKREAD:
+			return IOCONTEXT_BULKREAD;
+		case BAS_BULKWRITE:
+			return IOCONTEXT_BULKWRITE;
+		case BAS_VACUUM:
+			return IOCONTEXT_VACUUM;
+	}
+
+	return IOCONTEXT_NORMAL;
+}
+
 /*
  * GetBufferFromRing -- returns a buffer from the ring, or NULL if the
  *		ring is empty.
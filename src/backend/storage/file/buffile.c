@@ -40,12 +40,22 @@
  * when the corresponding files need to be survived across the transaction and
  * need to be opened and closed multiple times.  Such files need to be created
  * as a member of a SharedFileSet.
+ *
+ * BufFiles made by BufFileCreateCompressTemp may compress each buffer as it
+ * is written out, according to temp_file_compression.  Every buffer is then
+ * stored as a BufFileChunkHeader followed by its (possibly compressed)
+ * contents, so offsets within the physical files no longer correspond to
+ * logical positions.  Such files must be written sequentially from the
+ * start, rewound with BufFileSeek(file, 0, 0, SEEK_SET), and then read
+ * sequentially; no other seeks are supported.  That is how hash join uses
+ * its batch files.
  *-------------------------------------------------------------------------
  */
 
 #include "postgres.h"
 
 #include "commands/tablespace.h"
+#include "common/pg_lzcompress.h"
 #include "executor/instrument.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -62,6 +72,24 @@
 #define MAX_PHYSICAL_FILESIZE	0x40000000
 #define BUFFILE_SEG_SIZE		(MAX_PHYSICAL_FILESIZE / BLCKSZ)
 
+/*
+ * Each buffer written to a compressed BufFile is preceded by this header.
+ * storedlen is less than rawlen if the data is compressed, and equal to it
+ * if compression didn't pay off and the data was stored as is.  Chunks never
+ * cross a segment file boundary.
+ */
+typedef struct BufFileChunkHeader
+{
+	int32		rawlen;			/* number of bytes of buffer data */
+	int32		storedlen;		/* number of bytes following the header */
+} BufFileChunkHeader;
+
+#define BUFFILE_CHUNK_MAX_SIZE \
+	(sizeof(BufFileChunkHeader) + PGLZ_MAX_OUTPUT(BLCKSZ))
+
+/* GUC variable */
+int			temp_file_compression = TEMP_FILE_COMPRESSION_OFF;
+
 /*
  * This data structure represents a buffered file that consists of one or
  * more physical files (each accessed through a virtual file descriptor
@@ -76,6 +104,7 @@ struct BufFile
 	bool		isInterXact;	/* keep open over transactions? */
 	bool		dirty;			/* does buffer need to be written? */
 	bool		readOnly;		/* has the file been set to read only? */
+	bool		compress;		/* compress buffers as they're written? */
 
 	SharedFileSet *fileset;		/* space for segment files if shared */
 	const char *name;			/* name of this BufFile if shared */
@@ -95,6 +124,15 @@ struct BufFile
 	off_t		curOffset;		/* offset part of current pos */
 	int			pos;			/* next read/write position in buffer */
 	int			nbytes;			/* total # of valid bytes in buffer */
+
+	/*
+	 * For compressed files, curOffset is the physical position of the chunk
+	 * the buffer was loaded from, chunkSize is that chunk's size on disk, and
+	 * cbuffer is workspace for compressing and decompressing chunks.
+	 */
+	int			chunkSize;
+	char	   *cbuffer;
+
 	PGAlignedBlock buffer;
 };
 
@@ -103,6 +141,8 @@ static BufFile *makeBufFile(File firstfile);
 static void extendBufFile(BufFile *file);
 static void BufFileLoadBuffer(BufFile *file);
 static void BufFileDumpBuffer(BufFile *file);
+static void BufFileLoadCompressedBuffer(BufFile *file);
+static void BufFileDumpCompressedBuffer(BufFile *file);
 static void BufFileFlush(BufFile *file);
 static File MakeNewSharedSegment(BufFile *file, int segment);
 
@@ -117,11 +157,14 @@ makeBufFileCommon(int nfiles)
 	file->numFiles = nfiles;
 	file->isInterXact = false;
 	file->dirty = false;
+	file->compress = false;
 	file->resowner = CurrentResourceOwner;
 	file->curFile = 0;
 	file->curOffset = 0L;
 	file->pos = 0;
 	file->nbytes = 0;
+	file->chunkSize = 0;
+	file->cbuffer = NULL;
 
 	return file;
 }
@@ -210,6 +253,27 @@ BufFileCreateTemp(bool interXact)
 	return file;
 }
 
+/*
+ * Create a BufFile for a new temporary file, like BufFileCreateTemp, whose
+ * contents are compressed if temp_file_compression says so.
+ *
+ * The caller must write the file sequentially, rewind it, and then read it
+ * sequentially; see the notes at the top of this file.
+ */
+BufFile *
+BufFileCreateCompressTemp(bool interXact)
+{
+	BufFile    *file = BufFileCreateTemp(interXact);
+
+	if (temp_file_compression != TEMP_FILE_COMPRESSION_OFF)
+	{
+		file->compress = true;
+		file->cbuffer = palloc(BUFFILE_CHUNK_MAX_SIZE);
+	}
+
+	return file;
+}
+
 /*
  * Build the name for a given segment of a given BufFile.
  */
@@ -403,6 +467,8 @@ BufFileClose(BufFile *file)
 		FileClose(file->files[i]);
 	/* release the buffer space */
 	pfree(file->files);
+	if (file->cbuffer)
+		pfree(file->cbuffer);
 	pfree(file);
 }
 
@@ -417,6 +483,14 @@ static void
 BufFileLoadBuffer(BufFile *file)
 {
 	File		thisfile;
+	instr_time	io_start,
+				io_time;
+
+	if (file->compress)
+	{
+		BufFileLoadCompressedBuffer(file);
+		return;
+	}
 
 	/*
 	 * Advance to next component file if necessary and possible.
@@ -432,6 +506,10 @@ BufFileLoadBuffer(BufFile *file)
 	 * Read whatever we can get, up to a full bufferload.
 	 */
 	thisfile = file->files[file->curFile];
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT_FAST(io_start);
+
 	file->nbytes = FileRead(thisfile,
 							file->buffer.data,
 							sizeof(file->buffer),
@@ -446,10 +524,21 @@ BufFileLoadBuffer(BufFile *file)
 						FilePathName(thisfile))));
 	}
 
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT_FAST(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_io_time(IOOBJECT_TEMP_FILE, IOCONTEXT_NORMAL, IOOP_READ,
+							 io_time);
+	}
+
 	/* we choose not to advance curOffset here */
 
 	if (file->nbytes > 0)
+	{
 		pgBufferUsage.temp_blks_read++;
+		pgstat_count_io_op(IOOBJECT_TEMP_FILE, IOCONTEXT_NORMAL, IOOP_READ);
+	}
 }
 
 /*
@@ -465,6 +554,14 @@ BufFileDumpBuffer(BufFile *file)
 	int			wpos = 0;
 	int			bytestowrite;
 	File		thisfile;
+	instr_time	io_start,
+				io_time;
+
+	if (file->compress)
+	{
+		BufFileDumpCompressedBuffer(file);
+		return;
+	}
 
 	/*
 	 * Unlike BufFileLoadBuffer, we must dump the whole buffer even if it
@@ -495,6 +592,10 @@ BufFileDumpBuffer(BufFile *file)
 			bytestowrite = (int) availbytes;
 
 		thisfile = file->files[file->curFile];
+
+		if (track_io_timing)
+			INSTR_TIME_SET_CURRENT_FAST(io_start);
+
 		bytestowrite = FileWrite(thisfile,
 								 file->buffer.data + wpos,
 								 bytestowrite,
@@ -505,10 +606,20 @@ BufFileDumpBuffer(BufFile *file)
 					(errcode_for_file_access(),
 					 errmsg("could not write to file \"%s\": %m",
 							FilePathName(thisfile))));
+
+		if (track_io_timing)
+		{
+			INSTR_TIME_SET_CURRENT_FAST(io_time);
+			INSTR_TIME_SUBTRACT(io_time, io_start);
+			pgstat_count_io_time(IOOBJECT_TEMP_FILE, IOCONTEXT_NORMAL,
+								 IOOP_WRITE, io_time);
+		}
+
 		file->curOffset += bytestowrite;
 		wpos += bytestowrite;
 
 		pgBufferUsage.temp_blks_written++;
+		pgstat_count_io_op(IOOBJECT_TEMP_FILE, IOCONTEXT_NORMAL, IOOP_WRITE);
 	}
 	file->dirty = false;
 
@@ -533,6 +644,164 @@ BufFileDumpBuffer(BufFile *file)
 	file->nbytes = 0;
 }
 
+/*
+ * BufFileLoadCompressedBuffer
+ *
+ * Load the chunk starting at curOffset into the buffer, decompressing it if
+ * necessary.  Same calling conventions as BufFileLoadBuffer; in addition,
+ * chunkSize is set to the size of the chunk on disk.
+ */
+static void
+BufFileLoadCompressedBuffer(BufFile *file)
+{
+	BufFileChunkHeader hdr;
+	File		thisfile;
+	char	   *dest;
+	int			nread;
+	instr_time	io_start,
+				io_time;
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT_FAST(io_start);
+
+	/*
+	 * Read the chunk header, advancing to the next component file if this
+	 * one has been read to the end.
+	 */
+	for (;;)
+	{
+		thisfile = file->files[file->curFile];
+		nread = FileRead(thisfile, (char *) &hdr, sizeof(hdr),
+						 file->curOffset, WAIT_EVENT_BUFFILE_READ);
+		if (nread < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m",
+							FilePathName(thisfile))));
+		if (nread > 0 || file->curFile + 1 >= file->numFiles)
+			break;
+		file->curFile++;
+		file->curOffset = 0L;
+	}
+
+	if (nread == 0)
+		return;					/* end of file */
+
+	if (nread != sizeof(hdr) ||
+		hdr.rawlen <= 0 || hdr.rawlen > BLCKSZ ||
+		hdr.storedlen <= 0 || hdr.storedlen > hdr.rawlen)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid compressed data in temporary file \"%s\"",
+						FilePathName(thisfile))));
+
+	/* Data that is stored as is can be read straight into the buffer */
+	dest = (hdr.storedlen < hdr.rawlen) ? file->cbuffer : file->buffer.data;
+
+	nread = FileRead(thisfile, dest, hdr.storedlen,
+					 file->curOffset + sizeof(hdr), WAIT_EVENT_BUFFILE_READ);
+	if (nread < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m",
+						FilePathName(thisfile))));
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT_FAST(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_io_time(IOOBJECT_TEMP_FILE, IOCONTEXT_NORMAL, IOOP_READ,
+							 io_time);
+	}
+
+	if (nread != hdr.storedlen ||
+		(hdr.storedlen < hdr.rawlen &&
+		 pglz_decompress(file->cbuffer, hdr.storedlen, file->buffer.data,
+						 hdr.rawlen, true) != hdr.rawlen))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid compressed data in temporary file \"%s\"",
+						FilePathName(thisfile))));
+
+	file->nbytes = hdr.rawlen;
+	file->chunkSize = sizeof(hdr) + hdr.storedlen;
+
+	pgBufferUsage.temp_blks_read++;
+	pgstat_count_io_op(IOOBJECT_TEMP_FILE, IOCONTEXT_NORMAL, IOOP_READ);
+}
+
+/*
+ * BufFileDumpCompressedBuffer
+ *
+ * Compress the buffer and write it out as a chunk at curOffset.  Same calling
+ * conventions as BufFileDumpBuffer, except that the buffer must have been
+ * filled sequentially, so that pos = nbytes.
+ */
+static void
+BufFileDumpCompressedBuffer(BufFile *file)
+{
+	BufFileChunkHeader hdr;
+	File		thisfile;
+	int32		complen;
+	int			chunksize;
+	instr_time	io_start,
+				io_time;
+
+	Assert(file->pos == file->nbytes);
+
+	complen = pglz_compress(file->buffer.data, file->nbytes,
+							file->cbuffer + sizeof(hdr),
+							PGLZ_strategy_default);
+	if (complen < 0)
+	{
+		/* Not compressible enough, store it as is */
+		memcpy(file->cbuffer + sizeof(hdr), file->buffer.data, file->nbytes);
+		complen = file->nbytes;
+	}
+	hdr.rawlen = file->nbytes;
+	hdr.storedlen = complen;
+	memcpy(file->cbuffer, &hdr, sizeof(hdr));
+	chunksize = sizeof(hdr) + complen;
+
+	/* Start a new component file if the chunk doesn't fit in this one */
+	if (file->curOffset + chunksize > MAX_PHYSICAL_FILESIZE)
+	{
+		while (file->curFile + 1 >= file->numFiles)
+			extendBufFile(file);
+		file->curFile++;
+		file->curOffset = 0L;
+	}
+
+	thisfile = file->files[file->curFile];
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT_FAST(io_start);
+
+	if (FileWrite(thisfile, file->cbuffer, chunksize, file->curOffset,
+				  WAIT_EVENT_BUFFILE_WRITE) != chunksize)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to file \"%s\": %m",
+						FilePathName(thisfile))));
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT_FAST(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_io_time(IOOBJECT_TEMP_FILE, IOCONTEXT_NORMAL, IOOP_WRITE,
+							 io_time);
+	}
+
+	file->curOffset += chunksize;
+
+	pgBufferUsage.temp_blks_written++;
+	pgstat_count_io_op(IOOBJECT_TEMP_FILE, IOCONTEXT_NORMAL, IOOP_WRITE);
+
+	file->dirty = false;
+	file->pos = 0;
+	file->nbytes = 0;
+}
+
 /*
  * BufFileRead
  *
@@ -552,7 +821,8 @@ BufFileRead(BufFile *file, void *ptr, size_t size)
 		if (file->pos >= file->nbytes)
 		{
 			/* Try to load more data into buffer. */
-			file->curOffset += file->pos;
+			file->curOffset += file->compress ? file->chunkSize : file->pos;
+			file->chunkSize = 0;
 			file->pos = 0;
 			file->nbytes = 0;
 			BufFileLoadBuffer(file);
@@ -589,6 +859,10 @@ BufFileWrite(BufFile *file, void *ptr, size_t size)
 
 	Assert(!file->readOnly);
 
+	/* Compressed chunks can't be overwritten in place */
+	if (file->compress && !file->dirty && file->nbytes > 0)
+		elog(ERROR, "cannot write to compressed temporary file after reading from it");
+
 	while (size > 0)
 	{
 		if (file->pos >= BLCKSZ)
@@ -652,6 +926,20 @@ BufFileSeek(BufFile *file, int fileno, off_t offset, int whence)
 	int			newFile;
 	off_t		newOffset;
 
+	/* Compressed files can only be rewound, see BufFileCreateCompressTemp */
+	if (file->compress)
+	{
+		if (whence != SEEK_SET || fileno != 0 || offset != 0)
+			elog(ERROR, "compressed temporary files can only be rewound");
+		BufFileFlush(file);
+		file->curFile = 0;
+		file->curOffset = 0L;
+		file->pos = 0;
+		file->nbytes = 0;
+		file->chunkSize = 0;
+		return 0;
+	}
+
 	switch (whence)
 	{
 		case SEEK_SET:
@@ -742,6 +1030,9 @@ BufFileSeek(BufFile *file, int fileno, off_t offset, int whence)
 void
 BufFileTell(BufFile *file, int *fileno, off_t *offset)
 {
+	if (file->compress)
+		elog(ERROR, "cannot determine position in compressed temporary file");
+
 	*fileno = file->curFile;
 	*offset = file->curOffset + file->pos;
 }
@@ -766,6 +1057,42 @@ BufFileSeekBlock(BufFile *file, long blknum)
 					   SEEK_SET);
 }
 
+/*
+ * BufFilePrefetchBlock --- initiate asynchronous read of a range of blocks
+ *
+ * This tells the kernel that nblocks BLCKSZ-sized blocks starting at the
+ * n'th block will be read soon, so that the reads can be started while the
+ * caller is busy with other things.  It's only a hint: blocks past the end
+ * of the file are ignored, and nothing happens for compressed files (whose
+ * blocks aren't at predictable offsets) or where prefetching isn't supported.
+ */
+void
+BufFilePrefetchBlock(BufFile *file, long blknum, long nblocks)
+{
+#ifdef USE_PREFETCH
+	if (file->compress)
+		return;
+
+	while (nblocks > 0)
+	{
+		int			fileno = (int) (blknum / BUFFILE_SEG_SIZE);
+		long		segblknum = blknum % BUFFILE_SEG_SIZE;
+		long		segnblocks = Min(nblocks, BUFFILE_SEG_SIZE - segblknum);
+
+		if (fileno >= file->numFiles)
+			break;
+
+		(void) FilePrefetch(file->files[fileno],
+							(off_t) segblknum * BLCKSZ,
+							(int) (segnblocks * BLCKSZ),
+							WAIT_EVENT_BUFFILE_READ);
+
+		blknum += segnblocks;
+		nblocks -= segnblocks;
+	}
+#endif
+}
+
 #ifdef NOT_USED
 /*
  * BufFileTellBlock --- block-oriented tell
@@ -84,6 +84,9 @@
 #ifdef HAVE_SYS_RESOURCE_H
 #include <sys/resource.h>		/* for getrlimit */
 #endif
+#ifdef USE_POSIX_AIO
+#include <aio.h>
+#endif
 
 #include "access/xact.h"
 #include "access/xlog.h"
@@ -92,10 +95,12 @@
 #include "common/file_utils.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/pg_iovec.h"
 #include "portability/mem.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "utils/guc.h"
+#include "utils/memutils.h"
 #include "utils/resowner_private.h"
 
 /* Define PG_FLUSH_DATA_WORKS if we have an implementation for pg_flush_data */
@@ -157,6 +162,20 @@ int			max_safe_fds = FD_MINFREE;	/* default if not changed */
 /* Whether it is safe to continue running after fsync() fails. */
 bool		data_sync_retry = false;
 
+/* How reads started with FileStartRead() are carried out. */
+int			io_method = IO_METHOD_SYNC;
+
+const struct config_enum_entry io_method_options[] = {
+	{"sync", IO_METHOD_SYNC, false},
+#ifdef USE_POSIX_AIO
+	{"posix_aio", IO_METHOD_POSIX_AIO, false},
+#endif
+	{NULL, 0, false}
+};
+
+/* Which kinds of files are opened with O_DIRECT; see io_direct. */
+int			io_direct_flags = 0;
+
 /* Debugging.... */
 
 #ifdef FDDEBUG
@@ -274,6 +293,38 @@ static Oid *tempTableSpaces = NULL;
 static int	numTempTableSpaces = -1;
 static int	nextTempTableSpace = 0;
 
+/*
+ * Reads started with FileStartRead() and not yet collected by FileWaitRead().
+ * A slot whose file is 0 is free.  With io_method = posix_aio the aiocb must
+ * stay at a fixed address while the read is in flight, so the array is
+ * allocated once and never moved.
+ *
+ * The read target buffer belongs to the caller, and may be freed during
+ * (sub)transaction abort, so reads are completed before their creating
+ * subtransaction goes away, just like allocatedDescs are closed.  They are
+ * also completed before the underlying kernel FD is closed, since the
+ * kernel may still be using it.
+ */
+typedef struct FileReadSlot
+{
+	File		file;			/* file being read, or 0 if slot is free */
+	char	   *buffer;
+	int			amount;
+	off_t		offset;
+	uint32		wait_event_info;
+	SubTransactionId create_subid;
+	bool		done;			/* result and saved_errno are valid */
+	int			result;
+	int			saved_errno;
+#ifdef USE_POSIX_AIO
+	bool		submitted;		/* cb has been passed to aio_read() */
+	struct aiocb cb;
+#endif
+} FileReadSlot;
+
+static FileReadSlot *fileReadSlots = NULL;
+static int	numFileReadsInFlight = 0;
+
 
 /*--------------------
  *
@@ -317,6 +368,10 @@ static File AllocateVfd(void);
 static void FreeVfd(File file);
 
 static int	FileAccess(File file);
+static void FileCompleteRead(FileReadSlot *slot);
+static void FileCompleteReadsOnFile(File file, bool closing);
+static void CleanupFileReads(bool isCommit, SubTransactionId mySubid,
+							 SubTransactionId parentSubid);
 static File OpenTemporaryFileInTablespace(Oid tblspcOid, bool rejectError);
 static bool reserveAllocatedDesc(void);
 static int	FreeDesc(AllocateDesc *desc);
@@ -1184,6 +1239,10 @@ LruDelete(File file)
 
 	vfdP = &VfdCache[file];
 
+	/* The kernel might still be reading into a buffer using this FD */
+	if (numFileReadsInFlight > 0)
+		FileCompleteReadsOnFile(file, false);
+
 	/*
 	 * Close the file.  We aren't expecting this to fail; if it does, better
 	 * to leak the FD than to mess up our internal state.
@@ -1861,6 +1920,9 @@ FileClose(File file)
 
 	vfdP = &VfdCache[file];
 
+	if (numFileReadsInFlight > 0)
+		FileCompleteReadsOnFile(file, true);
+
 	if (!FileIsNotOpen(file))
 	{
 		/* close the file */
@@ -1961,6 +2023,13 @@ FilePrefetch(File file, off_t offset, int amount, uint32 wait_event_info)
 			   file, VfdCache[file].fileName,
 			   (int64) offset, amount));
 
+	/*
+	 * With direct I/O the data would be read into the kernel's page cache
+	 * and then read again, bypassing it.
+	 */
+	if (VfdCache[file].fileFlags & PG_O_DIRECT)
+		return 0;
+
 	returnCode = FileAccess(file);
 	if (returnCode < 0)
 		return returnCode;
@@ -1991,6 +2060,10 @@ FileWriteback(File file, off_t offset, off_t nbytes, uint32 wait_event_info)
 	if (nbytes <= 0)
 		return;
 
+	/* direct I/O leaves no dirty data in the kernel's page cache */
+	if (VfdCache[file].fileFlags & PG_O_DIRECT)
+		return;
+
 	returnCode = FileAccess(file);
 	if (returnCode < 0)
 		return;
@@ -2056,6 +2129,288 @@ retry:
 	return returnCode;
 }
 
+/*
+ * FileReadV - read a range of a file into several buffers at once
+ *
+ * Like FileRead(), but scatters the data over the given iovecs, so that
+ * adjacent blocks destined for non-adjacent memory need only one system
+ * call.  A short read is possible and is not an error.
+ */
+int
+FileReadV(File file, const struct iovec *iov, int iovcnt, off_t offset,
+		  uint32 wait_event_info)
+{
+	int			returnCode;
+	Vfd		   *vfdP;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileReadV: %d (%s) " INT64_FORMAT " %d",
+			   file, VfdCache[file].fileName,
+			   (int64) offset,
+			   iovcnt));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	vfdP = &VfdCache[file];
+
+retry:
+	pgstat_report_wait_start(wait_event_info);
+	returnCode = pg_preadv(vfdP->fd, iov, iovcnt, offset);
+	pgstat_report_wait_end();
+
+	/* OK to retry if interrupted */
+	if (returnCode < 0 && errno == EINTR)
+		goto retry;
+
+	return returnCode;
+}
+
+/*
+ * FileStartRead - begin reading a range of a file into a buffer
+ *
+ * The buffer must stay valid, and the caller must not touch it, until the
+ * returned handle is passed to FileWaitRead(), which returns what FileRead()
+ * would have.  With io_method = sync we only advise the kernel that the range
+ * will be needed soon, and the actual read happens at wait time; with
+ * io_method = posix_aio the read is handed to aio_read() right away.
+ *
+ * At most MAX_FILE_READS_IN_FLIGHT reads may be in flight in a backend;
+ * callers are expected to check FileReadsInFlight() before starting more.
+ */
+FileIoHandle
+FileStartRead(File file, char *buffer, int amount, off_t offset,
+			  uint32 wait_event_info)
+{
+	FileReadSlot *slot = NULL;
+	int			returnCode;
+	int			i;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileStartRead: %d (%s) " INT64_FORMAT " %d %p",
+			   file, VfdCache[file].fileName,
+			   (int64) offset,
+			   amount, buffer));
+
+	if (fileReadSlots == NULL)
+		fileReadSlots = (FileReadSlot *)
+			MemoryContextAllocZero(TopMemoryContext,
+								   sizeof(FileReadSlot) * MAX_FILE_READS_IN_FLIGHT);
+
+	for (i = 0; i < MAX_FILE_READS_IN_FLIGHT; i++)
+	{
+		if (fileReadSlots[i].file == 0)
+		{
+			slot = &fileReadSlots[i];
+			break;
+		}
+	}
+	if (slot == NULL)
+		elog(ERROR, "exceeded MAX_FILE_READS_IN_FLIGHT (%d)",
+			 MAX_FILE_READS_IN_FLIGHT);
+
+	slot->file = file;
+	slot->buffer = buffer;
+	slot->amount = amount;
+	slot->offset = offset;
+	slot->wait_event_info = wait_event_info;
+	slot->create_subid = GetCurrentSubTransactionId();
+	slot->done = false;
+	slot->result = 0;
+	slot->saved_errno = 0;
+	numFileReadsInFlight++;
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+	{
+		/* report the failure when the caller waits */
+		slot->done = true;
+		slot->result = returnCode;
+		slot->saved_errno = errno;
+		return (FileIoHandle) i;
+	}
+
+#ifdef USE_POSIX_AIO
+	slot->submitted = false;
+	if (io_method == IO_METHOD_POSIX_AIO)
+	{
+		MemSet(&slot->cb, 0, sizeof(slot->cb));
+		slot->cb.aio_fildes = VfdCache[file].fd;
+		slot->cb.aio_offset = offset;
+		slot->cb.aio_buf = buffer;
+		slot->cb.aio_nbytes = amount;
+		slot->cb.aio_sigevent.sigev_notify = SIGEV_NONE;
+
+		/*
+		 * If the request can't be queued (typically EAGAIN), just fall back
+		 * to reading synchronously in FileWaitRead().
+		 */
+		if (aio_read(&slot->cb) == 0)
+		{
+			slot->submitted = true;
+			return (FileIoHandle) i;
+		}
+	}
+#endif
+
+	(void) FilePrefetch(file, offset, amount, wait_event_info);
+
+	return (FileIoHandle) i;
+}
+
+/*
+ * FileWaitRead - finish a read started with FileStartRead
+ *
+ * Returns the number of bytes read, or -1 with errno set, like FileRead().
+ * The handle is invalid afterwards.
+ */
+int
+FileWaitRead(FileIoHandle handle)
+{
+	FileReadSlot *slot;
+	int			result;
+	int			save_errno;
+
+	Assert(handle >= 0 && handle < MAX_FILE_READS_IN_FLIGHT);
+	slot = &fileReadSlots[handle];
+	Assert(slot->file != 0);
+
+	if (!slot->done)
+		FileCompleteRead(slot);
+
+	result = slot->result;
+	save_errno = slot->saved_errno;
+
+	slot->file = 0;
+	numFileReadsInFlight--;
+
+	errno = save_errno;
+	return result;
+}
+
+/*
+ * FileReadsInFlight - number of reads started but not yet waited for
+ */
+int
+FileReadsInFlight(void)
+{
+	return numFileReadsInFlight;
+}
+
+/*
+ * Perform, or wait for, the read described by a slot, and remember its
+ * outcome for FileWaitRead().
+ */
+static void
+FileCompleteRead(FileReadSlot *slot)
+{
+	Assert(!slot->done);
+
+#ifdef USE_POSIX_AIO
+	if (slot->submitted)
+	{
+		const struct aiocb *list[1];
+		int			err;
+
+		list[0] = &slot->cb;
+
+		pgstat_report_wait_start(slot->wait_event_info);
+		while ((err = aio_error(&slot->cb)) == EINPROGRESS)
+			(void) aio_suspend(list, 1, NULL);
+		pgstat_report_wait_end();
+
+		slot->result = aio_return(&slot->cb);
+		slot->saved_errno = err;
+		slot->submitted = false;
+		slot->done = true;
+		return;
+	}
+#endif
+
+	slot->result = FileRead(slot->file, slot->buffer, slot->amount,
+							slot->offset, slot->wait_event_info);
+	slot->saved_errno = errno;
+	slot->done = true;
+}
+
+/*
+ * Make sure the kernel is no longer using the FD of the given file for any
+ * in-flight read.  If the VFD itself is going away, reads that haven't been
+ * issued yet can never succeed, so fail them.
+ */
+static void
+FileCompleteReadsOnFile(File file, bool closing)
+{
+	int			i;
+
+	for (i = 0; i < MAX_FILE_READS_IN_FLIGHT; i++)
+	{
+		FileReadSlot *slot = &fileReadSlots[i];
+
+		if (slot->file != file || slot->done)
+			continue;
+#ifdef USE_POSIX_AIO
+		if (slot->submitted)
+		{
+			FileCompleteRead(slot);
+			continue;
+		}
+#endif
+		if (closing)
+		{
+			slot->done = true;
+			slot->result = -1;
+			slot->saved_errno = EBADF;
+		}
+	}
+}
+
+/*
+ * Finish and forget about reads at (sub)transaction end.  With an invalid
+ * mySubid, all reads are cleaned up.
+ */
+static void
+CleanupFileReads(bool isCommit, SubTransactionId mySubid,
+				 SubTransactionId parentSubid)
+{
+	int			i;
+
+	if (numFileReadsInFlight == 0)
+		return;
+
+	for (i = 0; i < MAX_FILE_READS_IN_FLIGHT; i++)
+	{
+		FileReadSlot *slot = &fileReadSlots[i];
+
+		if (slot->file == 0)
+			continue;
+		if (mySubid != InvalidSubTransactionId)
+		{
+			if (slot->create_subid != mySubid)
+				continue;
+			if (isCommit)
+			{
+				slot->create_subid = parentSubid;
+				continue;
+			}
+		}
+		else if (isCommit)
+			elog(WARNING, "asynchronous read of file \"%s\" was not waited for",
+				 VfdCache[slot->file].fileName);
+
+#ifdef USE_POSIX_AIO
+		/* the buffer may be about to go away, so wait for the kernel */
+		if (!slot->done && slot->submitted)
+			FileCompleteRead(slot);
+#endif
+		slot->file = 0;
+		numFileReadsInFlight--;
+	}
+}
+
 int
 FileWrite(File file, char *buffer, int amount, off_t offset,
 		  uint32 wait_event_info)
@@ -2154,6 +2509,134 @@ retry:
 	return returnCode;
 }
 
+/*
+ * FileWriteV - write several buffers to a contiguous range of a file
+ *
+ * Like FileWrite(), but gathers the data from the given iovecs, so that
+ * adjacent blocks held in non-adjacent memory need only one system call.
+ */
+int
+FileWriteV(File file, const struct iovec *iov, int iovcnt, off_t offset,
+		   uint32 wait_event_info)
+{
+	int			returnCode;
+	Vfd		   *vfdP;
+	off_t		amount = 0;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileWriteV: %d (%s) " INT64_FORMAT " %d",
+			   file, VfdCache[file].fileName,
+			   (int64) offset,
+			   iovcnt));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	vfdP = &VfdCache[file];
+
+	for (int i = 0; i < iovcnt; i++)
+		amount += iov[i].iov_len;
+
+	/* See comments in FileWrite() */
+	if (temp_file_limit >= 0 && (vfdP->fdstate & FD_TEMP_FILE_LIMIT))
+	{
+		off_t		past_write = offset + amount;
+
+		if (past_write > vfdP->fileSize)
+		{
+			uint64		newTotal = temporary_files_size;
+
+			newTotal += past_write - vfdP->fileSize;
+			if (newTotal > (uint64) temp_file_limit * (uint64) 1024)
+				ereport(ERROR,
+						(errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
+						 errmsg("temporary file size exceeds temp_file_limit (%dkB)",
+								temp_file_limit)));
+		}
+	}
+
+retry:
+	errno = 0;
+	pgstat_report_wait_start(wait_event_info);
+	returnCode = pg_pwritev(vfdP->fd, iov, iovcnt, offset);
+	pgstat_report_wait_end();
+
+	/* if write didn't set errno, assume problem is no disk space */
+	if (returnCode != amount && errno == 0)
+		errno = ENOSPC;
+
+	if (returnCode >= 0)
+	{
+		/*
+		 * Maintain fileSize and temporary_files_size if it's a temp file.
+		 */
+		if (vfdP->fdstate & FD_TEMP_FILE_LIMIT)
+		{
+			off_t		past_write = offset + returnCode;
+
+			if (past_write > vfdP->fileSize)
+			{
+				temporary_files_size += past_write - vfdP->fileSize;
+				vfdP->fileSize = past_write;
+			}
+		}
+	}
+	else if (errno == EINTR)
+	{
+		/* OK to retry if interrupted */
+		goto retry;
+	}
+
+	return returnCode;
+}
+
+/*
+ * FileFallocate - allocate disk space for a range of a file
+ *
+ * The range reads back as zeroes.  Returns 0 on success, or -1 with errno
+ * set on failure; errno is EOPNOTSUPP if the platform or file system doesn't
+ * support doing this without writing, in which case the caller should write
+ * out zeroes instead.
+ */
+int
+FileFallocate(File file, off_t offset, off_t amount, uint32 wait_event_info)
+{
+#ifdef HAVE_POSIX_FALLOCATE
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileFallocate: %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) amount));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+retry:
+	pgstat_report_wait_start(wait_event_info);
+	returnCode = posix_fallocate(VfdCache[file].fd, offset, amount);
+	pgstat_report_wait_end();
+
+	if (returnCode == 0)
+		return 0;
+	else if (returnCode == EINTR)
+		goto retry;
+
+	/* posix_fallocate() doesn't set errno, it returns the error code */
+	if (returnCode == EINVAL)
+		returnCode = EOPNOTSUPP;
+	errno = returnCode;
+	return -1;
+#else
+	errno = EOPNOTSUPP;
+	return -1;
+#endif
+}
+
 int
 FileSync(File file, uint32 wait_event_info)
 {
@@ -2904,6 +3387,8 @@ AtEOSubXact_Files(bool isCommit, SubTransactionId mySubid,
 {
 	Index		i;
 
+	CleanupFileReads(isCommit, mySubid, parentSubid);
+
 	for (i = 0; i < numAllocatedDescs; i++)
 	{
 		if (allocatedDescs[i].create_subid == mySubid)
@@ -2934,6 +3419,8 @@ AtEOSubXact_Files(bool isCommit, SubTransactionId mySubid,
 void
 AtEOXact_Files(bool isCommit)
 {
+	CleanupFileReads(isCommit, InvalidSubTransactionId,
+					 InvalidSubTransactionId);
 	CleanupTempFiles(isCommit, false);
 	tempTableSpaces = NULL;
 	numTempTableSpaces = -1;
@@ -2948,6 +3435,8 @@ AtEOXact_Files(bool isCommit)
 static void
 AtProcExit_Files(int code, Datum arg)
 {
+	CleanupFileReads(false, InvalidSubTransactionId,
+					 InvalidSubTransactionId);
 	CleanupTempFiles(false, true);
 }
 
@@ -23,12 +23,14 @@
 #include "access/syncscan.h"
 #include "access/twophase.h"
 #include "commands/async.h"
+#include "commands/sequence.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/waitsampler.h"
 #include "replication/logicallauncher.h"
 #include "replication/origin.h"
 #include "replication/slot.h"
@@ -44,7 +46,9 @@
 #include "storage/procarray.h"
 #include "storage/procsignal.h"
 #include "storage/sinvaladt.h"
+#include "storage/smgr.h"
 #include "storage/spin.h"
+#include "utils/sharedrelcache.h"
 #include "utils/snapmgr.h"
 
 /* GUCs */
@@ -133,8 +137,10 @@ CreateSharedMemoryAndSemaphores(void)
 		size = add_size(size, BackgroundWorkerShmemSize());
 		size = add_size(size, MultiXactShmemSize());
 		size = add_size(size, LWLockShmemSize());
+		size = add_size(size, LWLockUsageShmemSize());
 		size = add_size(size, ProcArrayShmemSize());
 		size = add_size(size, BackendStatusShmemSize());
+		size = add_size(size, PgStatShmemSize());
 		size = add_size(size, SInvalShmemSize());
 		size = add_size(size, PMSignalShmemSize());
 		size = add_size(size, ProcSignalShmemSize());
@@ -145,10 +151,14 @@ CreateSharedMemoryAndSemaphores(void)
 		size = add_size(size, WalSndShmemSize());
 		size = add_size(size, WalRcvShmemSize());
 		size = add_size(size, ApplyLauncherShmemSize());
+		size = add_size(size, WaitSamplerShmemSize());
 		size = add_size(size, SnapMgrShmemSize());
 		size = add_size(size, BTreeShmemSize());
 		size = add_size(size, SyncScanShmemSize());
 		size = add_size(size, AsyncShmemSize());
+		size = add_size(size, SequenceShmemSize());
+		size = add_size(size, SharedRelCacheShmemSize());
+		size = add_size(size, RelSizeCacheShmemSize());
 #ifdef EXEC_BACKEND
 		size = add_size(size, ShmemBackendArraySize());
 #endif
@@ -237,8 +247,10 @@ CreateSharedMemoryAndSemaphores(void)
 	 */
 	if (!IsUnderPostmaster)
 		InitProcGlobal();
+	LWLockUsageShmemInit();
 	CreateSharedProcArray();
 	CreateSharedBackendStatus();
+	PgStatShmemInit();
 	TwoPhaseShmemInit();
 	BackgroundWorkerShmemInit();
 
@@ -259,6 +271,7 @@ CreateSharedMemoryAndSemaphores(void)
 	WalSndShmemInit();
 	WalRcvShmemInit();
 	ApplyLauncherShmemInit();
+	WaitSamplerShmemInit();
 
 	/*
 	 * Set up other modules that need some shared memory space
@@ -267,6 +280,9 @@ CreateSharedMemoryAndSemaphores(void)
 	BTreeShmemInit();
 	SyncScanShmemInit();
 	AsyncShmemInit();
+	SequenceShmemInit();
+	SharedRelCacheShmemInit();
+	RelSizeCacheShmemInit();
 
 #ifdef EXEC_BACKEND
 
@@ -2028,3 +2028,12 @@ drainSelfPipe(void)
 	}
 }
 #endif							/* !WIN32 */
+
+/*
+ * Get the number of wait events registered in a given WaitEventSet.
+ */
+int
+GetNumRegisteredWaitEvents(WaitEventSet *set)
+{
+	return set->nevents;
+}
@@ -101,6 +101,35 @@ typedef struct ProcArrayStruct
 	int			pgprocnos[FLEXIBLE_ARRAY_MEMBER];
 } ProcArrayStruct;
 
+/*
+ * Shared cache of the XIDs in the most recently built snapshot of a backend
+ * that has no XID of its own.  Such snapshots only depend on the set of
+ * running XIDs, which doesn't change until xactCompletionCount does (see
+ * GetSnapshotDataReuse()), so until then every XID-less backend can copy
+ * them from here instead of scanning the whole proc array.  The cost of
+ * taking a snapshot then depends on the number of running transactions,
+ * rather than on the number of connections.
+ *
+ * On a hot standby no backend has an XID, so every snapshot can use the
+ * cache; the XIDs then come from KnownAssignedXids and are all stored in the
+ * subxip array, see GetSnapshotData().  takenDuringRecovery tells the two
+ * layouts apart.
+ *
+ * The contents are protected by changecount, which is odd while the cache is
+ * being written: readers retry rather than wait, see SnapshotCacheRead().
+ * The XID arrays follow the struct in shared memory.
+ */
+typedef struct SnapshotCacheStruct
+{
+	pg_atomic_uint32 changecount;
+	uint64		xactCompletionCount;	/* 0 if there's no cached snapshot */
+	bool		takenDuringRecovery;
+	TransactionId xmin;
+	uint32		xcnt;
+	int32		subxcnt;
+	bool		suboverflowed;
+} SnapshotCacheStruct;
+
 /*
  * State for the GlobalVisTest* family of functions. Those functions can
  * e.g. be used to decide if a deleted row can be removed without violating
@@ -251,6 +280,10 @@ static ProcArrayStruct *procArray;
 
 static PGPROC *allProcs;
 
+static SnapshotCacheStruct *snapshotCache;
+static TransactionId *snapshotCacheXip;
+static TransactionId *snapshotCacheSubxip;
+
 /*
  * Bookkeeping for tracking emulated transactions in recovery
  */
@@ -282,6 +315,21 @@ static GlobalVisState GlobalVisTempRels;
  */
 static TransactionId ComputeXidHorizonsResultLastXmin;
 
+/*
+ * Size of KnownAssignedXids and of running-xacts xid arrays; see
+ * ProcArrayShmemSize.
+ */
+#define TOTAL_MAX_CACHED_SUBXIDS \
+	((PGPROC_MAX_CACHED_SUBXIDS + 1) * PROCARRAY_MAXPROCS)
+
+/*
+ * Size of snapshot sub-XID arrays: enough for every backend's subxid cache,
+ * and for the whole of KnownAssignedXids during hot standby.
+ */
+#define TOTAL_MAX_SNAPSHOT_SUBXIDS \
+	((Max(max_cached_subxids, PGPROC_MAX_CACHED_SUBXIDS) + 1) * \
+	 PROCARRAY_MAXPROCS)
+
 #ifdef XIDCACHE_DEBUG
 
 /* counters for XidCache measurement */
@@ -340,6 +388,14 @@ static inline void ProcArrayEndTransactionInternal(PGPROC *proc, TransactionId l
 static void ProcArrayGroupClearXid(PGPROC *proc, TransactionId latestXid);
 static void MaintainLatestCompletedXid(TransactionId latestXid);
 static void MaintainLatestCompletedXidRecovery(TransactionId latestXid);
+static bool SnapshotCacheRead(Snapshot snapshot,
+							  uint64 xactCompletionCount,
+							  TransactionId *xmin, size_t *xcnt,
+							  int *subxcnt, bool *suboverflowed);
+static void SnapshotCacheWrite(Snapshot snapshot,
+							   uint64 xactCompletionCount,
+							   TransactionId xmin, size_t xcnt,
+							   int subxcnt, bool suboverflowed);
 
 static inline FullTransactionId FullXidRelativeTo(FullTransactionId rel,
 												  TransactionId xid);
@@ -366,14 +422,25 @@ ProcArrayShmemSize(void)
 	 * TransactionIdIsInProgress() and GetRunningTransactionData(). All of the
 	 * main structures created in those functions must be identically sized,
 	 * since we may at times copy the whole of the data structures around. We
-	 * refer to this size as TOTAL_MAX_CACHED_SUBXIDS.
+	 * refer to this size as TOTAL_MAX_CACHED_SUBXIDS.  It depends only on
+	 * PGPROC_MAX_CACHED_SUBXIDS, because that bounds what the primary reports
+	 * per transaction in WAL.
+	 *
+	 * Snapshot sub-XID arrays must also be able to hold every backend's
+	 * cache, which can be larger; see TOTAL_MAX_SNAPSHOT_SUBXIDS.
 	 *
 	 * Ideally we'd only create this structure if we were actually doing hot
 	 * standby in the current run, but we don't know that yet at the time
 	 * shared memory is being set up.
 	 */
-#define TOTAL_MAX_CACHED_SUBXIDS \
-	((PGPROC_MAX_CACHED_SUBXIDS + 1) * PROCARRAY_MAXPROCS)
+
+	/* The shared snapshot cache, with room for the largest snapshot */
+#define SNAPSHOT_CACHE_SIZE \
+	add_size(MAXALIGN(sizeof(SnapshotCacheStruct)), \
+			 mul_size(sizeof(TransactionId), \
+					  add_size(PROCARRAY_MAXPROCS, TOTAL_MAX_SNAPSHOT_SUBXIDS)))
+
+	size = add_size(size, SNAPSHOT_CACHE_SIZE);
 
 	if (EnableHotStandby)
 	{
@@ -423,6 +490,18 @@ CreateSharedProcArray(void)
 
 	allProcs = ProcGlobal->allProcs;
 
+	/* Create or attach to the shared snapshot cache */
+	snapshotCache = (SnapshotCacheStruct *)
+		ShmemInitStruct("Snapshot Cache", SNAPSHOT_CACHE_SIZE, &found);
+	if (!found)
+	{
+		pg_atomic_init_u32(&snapshotCache->changecount, 0);
+		snapshotCache->xactCompletionCount = 0;
+	}
+	snapshotCacheXip = (TransactionId *)
+		((char *) snapshotCache + MAXALIGN(sizeof(SnapshotCacheStruct)));
+	snapshotCacheSubxip = snapshotCacheXip + PROCARRAY_MAXPROCS;
+
 	/* Create or attach to the KnownAssignedXids arrays too, if needed */
 	if (EnableHotStandby)
 	{
@@ -1210,6 +1289,9 @@ ProcArrayApplyRecoveryInfo(RunningTransactions running)
 	 */
 	MaintainLatestCompletedXidRecovery(running->latestCompletedXid);
 
+	/* ... and invalidate any snapshot cached before we knew all this */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 
 	/* ShmemVariableCache->nextXid must be beyond any observed xid. */
@@ -1982,7 +2064,7 @@ GetMaxSnapshotXidCount(void)
 int
 GetMaxSnapshotSubxidCount(void)
 {
-	return TOTAL_MAX_CACHED_SUBXIDS;
+	return TOTAL_MAX_SNAPSHOT_SUBXIDS;
 }
 
 /*
@@ -2120,6 +2202,7 @@ GetSnapshotData(Snapshot snapshot)
 	int			mypgxactoff;
 	TransactionId myxid;
 	uint64		curXactCompletionCount;
+	bool		usecache;
 
 	TransactionId replication_slot_xmin = InvalidTransactionId;
 	TransactionId replication_slot_catalog_xmin = InvalidTransactionId;
@@ -2192,7 +2275,21 @@ GetSnapshotData(Snapshot snapshot)
 
 	snapshot->takenDuringRecovery = RecoveryInProgress();
 
-	if (!snapshot->takenDuringRecovery)
+	/*
+	 * If we have no XID of our own, the XIDs in our snapshot are the same as
+	 * in any other XID-less backend's snapshot built since the last
+	 * transaction completion, so try to get them from the shared cache.
+	 * That's always the case during recovery.
+	 */
+	usecache = !TransactionIdIsValid(myxid);
+
+	if (usecache &&
+		SnapshotCacheRead(snapshot, curXactCompletionCount,
+						  &xmin, &count, &subcount, &suboverflowed))
+	{
+		/* nothing more to do, the cache had the running XIDs */
+	}
+	else if (!snapshot->takenDuringRecovery)
 	{
 		size_t		numProcs = arrayP->numProcs;
 		TransactionId *xip = snapshot->xip;
@@ -2296,6 +2393,11 @@ GetSnapshotData(Snapshot snapshot)
 				}
 			}
 		}
+
+		/* Let other XID-less backends reuse what we found */
+		if (usecache)
+			SnapshotCacheWrite(snapshot, curXactCompletionCount,
+							   xmin, count, subcount, suboverflowed);
 	}
 	else
 	{
@@ -2333,6 +2435,19 @@ GetSnapshotData(Snapshot snapshot)
 
 		if (TransactionIdPrecedesOrEquals(xmin, procArray->lastOverflowedXid))
 			suboverflowed = true;
+
+		/*
+		 * Let the next standby snapshots reuse what we found.  Removing XIDs
+		 * from KnownAssignedXids always advances xactCompletionCount, and
+		 * XIDs added meanwhile follow latestObservedXid, so they're >= xmax.
+		 * A snapshot overflowed by a later XID assignment record would be no
+		 * different from the cached one, since the subxids it removed are
+		 * still in the cached array and must be treated as running either
+		 * way.
+		 */
+		if (usecache)
+			SnapshotCacheWrite(snapshot, curXactCompletionCount,
+							   xmin, count, subcount, suboverflowed);
 	}
 
 
@@ -2458,6 +2573,109 @@ GetSnapshotData(Snapshot snapshot)
 	return snapshot;
 }
 
+/*
+ * SnapshotCacheRead -- copy the running XIDs from the shared snapshot cache
+ *
+ * Returns false if the cache doesn't hold the XIDs as of the given
+ * xactCompletionCount, or if it is being written.  Caller must hold
+ * ProcArrayLock, which guarantees that xactCompletionCount doesn't change.
+ *
+ * We don't want readers to write to shared memory, since this is done by
+ * every backend that takes a snapshot.  So instead of taking a lock, we copy
+ * the data and check that changecount didn't change meanwhile, like
+ * pgstat_read_current_status() does.  The counts are range checked before
+ * being used, since we might read them while being written.
+ */
+static bool
+SnapshotCacheRead(Snapshot snapshot, uint64 xactCompletionCount,
+				  TransactionId *xmin, size_t *xcnt, int *subxcnt,
+				  bool *suboverflowed)
+{
+	uint32		before_changecount;
+	uint32		after_changecount;
+	uint32		cached_xcnt;
+	int32		cached_subxcnt;
+	bool		cached_suboverflowed;
+
+	Assert(LWLockHeldByMe(ProcArrayLock));
+
+	before_changecount = pg_atomic_read_u32(&snapshotCache->changecount);
+	pg_read_barrier();
+
+	if ((before_changecount & 1) != 0 ||
+		snapshotCache->xactCompletionCount != xactCompletionCount ||
+		snapshotCache->takenDuringRecovery != snapshot->takenDuringRecovery)
+		return false;
+
+	*xmin = snapshotCache->xmin;
+	cached_xcnt = snapshotCache->xcnt;
+	cached_subxcnt = snapshotCache->subxcnt;
+	cached_suboverflowed = snapshotCache->suboverflowed;
+	if (cached_xcnt > (uint32) GetMaxSnapshotXidCount() ||
+		cached_subxcnt < 0 ||
+		cached_subxcnt > GetMaxSnapshotSubxidCount())
+		return false;
+
+	memcpy(snapshot->xip, snapshotCacheXip,
+		   cached_xcnt * sizeof(TransactionId));
+	if (!cached_suboverflowed)
+		memcpy(snapshot->subxip, snapshotCacheSubxip,
+			   cached_subxcnt * sizeof(TransactionId));
+
+	pg_read_barrier();
+	after_changecount = pg_atomic_read_u32(&snapshotCache->changecount);
+	if (before_changecount != after_changecount)
+		return false;
+
+	*xcnt = cached_xcnt;
+	*subxcnt = cached_subxcnt;
+	*suboverflowed = cached_suboverflowed;
+
+	return true;
+}
+
+/*
+ * SnapshotCacheWrite -- store the running XIDs in the shared snapshot cache
+ *
+ * Caller must hold ProcArrayLock, and must have no XID of its own.  If
+ * another backend is writing the cache, we don't wait for it: it must be
+ * storing the same XIDs as we would.
+ */
+static void
+SnapshotCacheWrite(Snapshot snapshot, uint64 xactCompletionCount,
+				   TransactionId xmin, size_t xcnt, int subxcnt,
+				   bool suboverflowed)
+{
+	uint32		changecount;
+
+	Assert(LWLockHeldByMe(ProcArrayLock));
+	Assert(!TransactionIdIsValid(MyProc->xid));
+
+	changecount = pg_atomic_read_u32(&snapshotCache->changecount);
+	if ((changecount & 1) != 0 ||
+		snapshotCache->xactCompletionCount == xactCompletionCount)
+		return;
+
+	/* Mark the cache as being written; this is a full barrier */
+	if (!pg_atomic_compare_exchange_u32(&snapshotCache->changecount,
+										&changecount, changecount + 1))
+		return;
+
+	snapshotCache->xactCompletionCount = xactCompletionCount;
+	snapshotCache->takenDuringRecovery = snapshot->takenDuringRecovery;
+	snapshotCache->xmin = xmin;
+	snapshotCache->xcnt = xcnt;
+	snapshotCache->subxcnt = subxcnt;
+	snapshotCache->suboverflowed = suboverflowed;
+	memcpy(snapshotCacheXip, snapshot->xip, xcnt * sizeof(TransactionId));
+	if (!suboverflowed)
+		memcpy(snapshotCacheSubxip, snapshot->subxip,
+			   subxcnt * sizeof(TransactionId));
+
+	pg_write_barrier();
+	pg_atomic_write_u32(&snapshotCache->changecount, changecount + 2);
+}
+
 /*
  * ProcArrayInstallImportedXmin -- install imported xmin into MyProc->xmin
  *
@@ -2689,7 +2907,13 @@ GetRunningTransactionData(void)
 		if (TransactionIdPrecedes(xid, oldestRunningXid))
 			oldestRunningXid = xid;
 
-		if (ProcGlobal->subxidStates[index].overflowed)
+		/*
+		 * Standbys only have room for PGPROC_MAX_CACHED_SUBXIDS subxids per
+		 * transaction, so a larger cache is reported as overflowed, just as
+		 * XLOG_XACT_ASSIGNMENT records would have told the standby anyway.
+		 */
+		if (ProcGlobal->subxidStates[index].overflowed ||
+			ProcGlobal->subxidStates[index].count > PGPROC_MAX_CACHED_SUBXIDS)
 			suboverflowed = true;
 
 		/*
@@ -4357,6 +4581,14 @@ ExpireAllKnownAssignedTransactionIds(void)
 {
 	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
 	KnownAssignedXidsRemovePreceding(InvalidTransactionId);
+
+	/*
+	 * Any transactions that were in progress were effectively aborted, so
+	 * advance xactCompletionCount, as ExpireTreeKnownAssignedTransactionIds
+	 * does.
+	 */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -4369,6 +4601,10 @@ ExpireOldKnownAssignedTransactionIds(TransactionId xid)
 {
 	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
 	KnownAssignedXidsRemovePreceding(xid);
+
+	/* As above, the removed XIDs are no longer running */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -4414,8 +4650,11 @@ ExpireOldKnownAssignedTransactionIds(TransactionId xid)
  * force compression of unused entries rather than wrapping around, since
  * allowing wraparound would greatly complicate the search logic.  We maintain
  * an explicit tail pointer so that pruning of old XIDs can be done without
- * immediately moving the array contents.  In most cases only a small fraction
- * of the array contains valid entries at any instant.
+ * immediately moving the array contents.  Likewise, removing the newest XID
+ * pulls the head pointer back over any invalid entries, so that the range
+ * snapshots have to scan shrinks as transactions end, not only when the
+ * array is compressed.  In most cases only a small fraction of the array
+ * contains valid entries at any instant.
  *
  * Although only the startup process can ever change the KnownAssignedXids
  * data structure, we still need interlocking so that standby backends will
@@ -4710,6 +4949,22 @@ KnownAssignedXidsSearch(TransactionId xid, bool remove)
 		pArray->numKnownAssignedXids--;
 		Assert(pArray->numKnownAssignedXids >= 0);
 
+		/*
+		 * If we're removing the head element then retreat head pointer over
+		 * any invalid elements, so that snapshots don't have to skip them.
+		 * Short transactions often end before any later XID is added, so
+		 * this keeps the array compact without waiting for compression.
+		 * Only the startup process adds XIDs, and it's the one holding the
+		 * exclusive lock here, so nobody can be writing past head.
+		 */
+		if (result_index == head - 1 && result_index != tail)
+		{
+			head--;
+			while (head > tail && !KnownAssignedXidsValid[head - 1])
+				head--;
+			pArray->headKnownAssignedXids = head;
+		}
+
 		/*
 		 * If we're removing the tail element then advance tail pointer over
 		 * any invalid elements.  This will speed future searches.
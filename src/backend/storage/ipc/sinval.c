@@ -21,6 +21,7 @@
 #include "storage/proc.h"
 #include "storage/sinvaladt.h"
 #include "utils/inval.h"
+#include "utils/sharedrelcache.h"
 
 
 uint64		SharedInvalidMessageCounter;
@@ -44,10 +45,14 @@ volatile sig_atomic_t catchupInterruptPending = false;
 /*
  * SendSharedInvalidMessages
  *	Add shared-cache-invalidation message(s) to the global SI message queue.
+ *
+ * The shared relation cache has no queue position of its own, so the
+ * messages are applied to it right here, before anyone can read them.
  */
 void
 SendSharedInvalidMessages(const SharedInvalidationMessage *msgs, int n)
 {
+	SharedRelCacheProcessInvalidations(msgs, n);
 	SIInsertDataEntries(msgs, n);
 }
 
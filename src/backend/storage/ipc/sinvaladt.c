@@ -43,9 +43,10 @@
  * SICleanupQueue is called, and we try not to do that often.)
  *
  * In reality, the messages are stored in a circular buffer of MAXNUMMESSAGES
- * entries.  We translate MsgNum values into circular-buffer indexes by
- * computing MsgNum % MAXNUMMESSAGES (this should be fast as long as
- * MAXNUMMESSAGES is a constant and a power of 2).  As long as maxMsgNum
+ * entries, set by the shared_invalidation_queue_size parameter.  We translate
+ * MsgNum values into circular-buffer indexes by masking off the high bits of
+ * MsgNum, which works because MAXNUMMESSAGES is a power of 2.  As long as
+ * maxMsgNum
  * doesn't exceed minMsgNum by more than MAXNUMMESSAGES, we have enough space
  * in the buffer.  If the buffer does overflow, we recover by setting the
  * "reset" flag for each backend that has fallen too far behind.  A backend
@@ -69,12 +70,18 @@
  * of "stuck" backends, we won't need a lot of extra interrupts, since ones
  * that aren't stuck will propagate their interrupts to the next guy.
  *
+ * Most messages concern a single database, and backends connected to other
+ * databases ignore them on receipt.  So before deciding whom to reset or
+ * signal, SICleanupQueue advances lagging backends past any leading messages
+ * that are addressed only to other databases.  DDL in one database then does
+ * not push idle sessions of every other database towards a reset.
+ *
  * We would have problems if the MsgNum values overflow an integer, so
  * whenever minMsgNum exceeds MSGNUMWRAPAROUND, we subtract MSGNUMWRAPAROUND
  * from all the MsgNum variables simultaneously.  MSGNUMWRAPAROUND can be
  * large so that we don't need to do this often.  It must be a multiple of
  * MAXNUMMESSAGES so that the existing circular-buffer entries don't need
- * to be moved when we do it.
+ * to be moved when we do it; being a larger power of 2, it is.
  *
  * Access to the shared sinval array is protected by two locks, SInvalReadLock
  * and SInvalWriteLock.  Readers take SInvalReadLock in shared mode; this
@@ -107,10 +114,11 @@
  * Configurable parameters.
  *
  * MAXNUMMESSAGES: max number of shared-inval messages we can buffer.
- * Must be a power of 2 for speed.
+ * Must be a power of 2, which the GUC check hook enforces.
  *
  * MSGNUMWRAPAROUND: how often to reduce MsgNum variables to avoid overflow.
- * Must be a multiple of MAXNUMMESSAGES.  Should be large.
+ * Must be a multiple of MAXNUMMESSAGES.  Should be large, but leave room
+ * for maxMsgNum to exceed it by MAXNUMMESSAGES without overflowing.
  *
  * CLEANUP_MIN: the minimum number of messages that must be in the buffer
  * before we bother to call SICleanupQueue.
@@ -127,13 +135,19 @@
  * per iteration.
  */
 
-#define MAXNUMMESSAGES 4096
-#define MSGNUMWRAPAROUND (MAXNUMMESSAGES * 262144)
+#define MAXNUMMESSAGES shared_invalidation_queue_size
+#define MSGNUMWRAPAROUND (1 << 30)
 #define CLEANUP_MIN (MAXNUMMESSAGES / 2)
 #define CLEANUP_QUANTUM (MAXNUMMESSAGES / 16)
 #define SIG_THRESHOLD (MAXNUMMESSAGES / 2)
 #define WRITE_QUANTUM 64
 
+/* circular-buffer index of a message number */
+#define SIBufferIndex(msgnum)	((msgnum) & (MAXNUMMESSAGES - 1))
+
+/* GUC variable */
+int			shared_invalidation_queue_size = 4096;
+
 /* Per-backend state in shared invalidation structure */
 typedef struct ProcState
 {
@@ -178,9 +192,16 @@ typedef struct SISeg
 	slock_t		msgnumLock;		/* spinlock protecting maxMsgNum */
 
 	/*
-	 * Circular buffer holding shared-inval messages
+	 * Circular buffer holding shared-inval messages (has MAXNUMMESSAGES
+	 * entries, and is located after procState[])
+	 */
+	SharedInvalidationMessage *buffer;
+
+	/*
+	 * Scratch space for SISkipForeignMessages (has MAXNUMMESSAGES entries).
+	 * Only used while holding both locks exclusively.
 	 */
-	SharedInvalidationMessage buffer[MAXNUMMESSAGES];
+	int		   *runEnd;
 
 	/*
 	 * Per-backend invalidation state info (has MaxBackends entries).
@@ -194,6 +215,7 @@ static SISeg *shmInvalBuffer;	/* pointer to the shared inval buffer */
 static LocalTransactionId nextLocalTransactionId;
 
 static void CleanupInvalidationState(int status, Datum arg);
+static void SISkipForeignMessages(SISeg *segP, int upto);
 
 
 /*
@@ -206,6 +228,10 @@ SInvalShmemSize(void)
 
 	size = offsetof(SISeg, procState);
 	size = add_size(size, mul_size(sizeof(ProcState), MaxBackends));
+	size = MAXALIGN(size);
+	size = add_size(size, mul_size(sizeof(SharedInvalidationMessage),
+								   MAXNUMMESSAGES));
+	size = add_size(size, mul_size(sizeof(int), MAXNUMMESSAGES));
 
 	return size;
 }
@@ -219,6 +245,7 @@ CreateSharedInvalidationState(void)
 {
 	int			i;
 	bool		found;
+	char	   *ptr;
 
 	/* Allocate space in shared memory */
 	shmInvalBuffer = (SISeg *)
@@ -226,6 +253,14 @@ CreateSharedInvalidationState(void)
 	if (found)
 		return;
 
+	/* Carve the message buffer and scratch array out of the space */
+	ptr = (char *) shmInvalBuffer +
+		MAXALIGN(offsetof(SISeg, procState) +
+				 sizeof(ProcState) * MaxBackends);
+	shmInvalBuffer->buffer = (SharedInvalidationMessage *) ptr;
+	ptr += sizeof(SharedInvalidationMessage) * MAXNUMMESSAGES;
+	shmInvalBuffer->runEnd = (int *) ptr;
+
 	/* Clear message counters, save size of procState array, init spinlock */
 	shmInvalBuffer->minMsgNum = 0;
 	shmInvalBuffer->maxMsgNum = 0;
@@ -477,7 +512,7 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
 		max = segP->maxMsgNum;
 		while (nthistime-- > 0)
 		{
-			segP->buffer[max % MAXNUMMESSAGES] = *data++;
+			segP->buffer[SIBufferIndex(max)] = *data++;
 			max++;
 		}
 
@@ -600,7 +635,7 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
 	n = 0;
 	while (n < datasize && stateP->nextMsgNum < max)
 	{
-		data[n++] = segP->buffer[stateP->nextMsgNum % MAXNUMMESSAGES];
+		data[n++] = segP->buffer[SIBufferIndex(stateP->nextMsgNum)];
 		stateP->nextMsgNum++;
 	}
 
@@ -663,6 +698,9 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 	minsig = min - SIG_THRESHOLD;
 	lowbound = min - MAXNUMMESSAGES + minFree;
 
+	/* First let lagging backends skip messages they'd ignore anyway */
+	SISkipForeignMessages(segP, minsig);
+
 	for (i = 0; i < segP->lastBackend; i++)
 	{
 		ProcState  *stateP = &segP->procState[i];
@@ -748,6 +786,117 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 	}
 }
 
+/*
+ * SIMessageDatabase
+ *		Return the database a message is addressed to, or InvalidOid if every
+ *		backend must process it.
+ *
+ * This must agree with the filtering in LocalExecuteInvalidationMessage.
+ * Smgr messages are processed regardless of database, so they are never
+ * attributed to one.
+ */
+static inline Oid
+SIMessageDatabase(const SharedInvalidationMessage *msg)
+{
+	if (msg->id >= 0)
+		return msg->cc.dbId;
+
+	switch (msg->id)
+	{
+		case SHAREDINVALCATALOG_ID:
+			return msg->cat.dbId;
+		case SHAREDINVALRELCACHE_ID:
+			return msg->rc.dbId;
+		case SHAREDINVALRELMAP_ID:
+			return msg->rm.dbId;
+		case SHAREDINVALSNAPSHOT_ID:
+			return msg->sn.dbId;
+		default:
+			return InvalidOid;
+	}
+}
+
+/*
+ * SISkipForeignMessages
+ *		Advance backends whose nextMsgNum is below "upto" past any messages
+ *		at the head of their queue that only concern other databases.
+ *
+ * Caller must hold both SInvalWriteLock and SInvalReadLock exclusively.
+ *
+ * We first compute, for each message from the furthest-back candidate to
+ * maxMsgNum, where its run of messages for the same database ends; each
+ * backend can then skip a whole run at a time.
+ */
+static void
+SISkipForeignMessages(SISeg *segP, int upto)
+{
+	int			max = segP->maxMsgNum;
+	int			lowest = max;
+	int			m;
+	int			i;
+	Oid			prevdb = InvalidOid;
+
+	/* Find the furthest-back backend that could benefit */
+	for (i = 0; i < segP->lastBackend; i++)
+	{
+		ProcState  *stateP = &segP->procState[i];
+
+		if (stateP->procPid == 0 || stateP->resetState || stateP->sendOnly ||
+			!OidIsValid(stateP->proc->databaseId))
+			continue;
+		if (stateP->nextMsgNum < upto && stateP->nextMsgNum < lowest)
+			lowest = stateP->nextMsgNum;
+	}
+	if (lowest >= max)
+		return;
+
+	/* runEnd of message m is stored at SIBufferIndex(m) */
+	for (m = max - 1; m >= lowest; m--)
+	{
+		Oid			db = SIMessageDatabase(&segP->buffer[SIBufferIndex(m)]);
+
+		if (m + 1 < max && OidIsValid(db) && db == prevdb)
+			segP->runEnd[SIBufferIndex(m)] =
+				segP->runEnd[SIBufferIndex(m + 1)];
+		else
+			segP->runEnd[SIBufferIndex(m)] = m + 1;
+		prevdb = db;
+	}
+
+	for (i = 0; i < segP->lastBackend; i++)
+	{
+		ProcState  *stateP = &segP->procState[i];
+		Oid			mydb;
+		int			n;
+
+		if (stateP->procPid == 0 || stateP->resetState || stateP->sendOnly)
+			continue;
+		mydb = stateP->proc->databaseId;
+		n = stateP->nextMsgNum;
+		if (!OidIsValid(mydb) || n >= upto)
+			continue;
+
+		while (n < max)
+		{
+			Oid			db = SIMessageDatabase(&segP->buffer[SIBufferIndex(n)]);
+
+			if (!OidIsValid(db) || db == mydb)
+				break;
+			n = segP->runEnd[SIBufferIndex(n)];
+		}
+		stateP->nextMsgNum = n;
+
+		/*
+		 * If nothing is left for it, it needn't look at the queue again, and
+		 * must be eligible for a catchup signal should it fall behind later.
+		 */
+		if (n >= max)
+		{
+			stateP->hasMessages = false;
+			stateP->signaled = false;
+		}
+	}
+}
 
 /*
  * GetNextLocalTransactionId --- allocate a new LocalTransactionId
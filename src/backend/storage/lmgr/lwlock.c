@@ -79,14 +79,17 @@
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
+#include "portability/instr_time.h"
 #include "postmaster/postmaster.h"
 #include "replication/slot.h"
 #include "storage/ipc.h"
 #include "storage/predicate.h"
 #include "storage/proc.h"
 #include "storage/proclist.h"
+#include "storage/shmem.h"
 #include "storage/spin.h"
 #include "utils/memutils.h"
+#include "utils/timestamp.h"
 
 #ifdef LWLOCK_STATS
 #include "utils/hsearch.h"
@@ -177,7 +180,15 @@ static const char *const BuiltinTrancheNames[] = {
 	/* LWTRANCHE_PARALLEL_APPEND: */
 	"ParallelAppend",
 	/* LWTRANCHE_PER_XACT_PREDICATE_LIST: */
-	"PerXactPredicateList"
+	"PerXactPredicateList",
+	/* LWTRANCHE_SHARED_RELCACHE: */
+	"SharedRelCache",
+	/* LWTRANCHE_SHARED_RELCACHE_DSA: */
+	"SharedRelCacheDSA",
+	/* LWTRANCHE_PGSTATS_DSA: */
+	"PgStatsDSA",
+	/* LWTRANCHE_PGSTATS_HASH: */
+	"PgStatsHash"
 };
 
 StaticAssertDecl(lengthof(BuiltinTrancheNames) ==
@@ -240,6 +251,43 @@ NamedLWLockTranche *NamedLWLockTrancheArray = NULL;
 
 static bool lock_named_request_allowed = true;
 
+/*
+ * Cumulative per-tranche usage counters, shown in pg_stat_lwlock.  Unlike
+ * the LWLOCK_STATS debugging code below, these are always maintained, so
+ * they have to be cheap: every PGPROC owns a row of NUM_LWLOCK_USAGE_SLOTS
+ * counters that only the process using that PGPROC ever writes, so we can
+ * bump them with plain stores and without touching any shared cache line.
+ * Readers sum up all rows.  A row keeps its values when its PGPROC is
+ * recycled, so the sums only ever grow; a reset just records the current
+ * sums as the new baseline.
+ */
+typedef struct LWLockUsageCounters
+{
+	pg_atomic_uint64 acquisitions;
+	pg_atomic_uint64 contended;
+	pg_atomic_uint64 wait_time;
+} LWLockUsageCounters;
+
+typedef struct LWLockUsageShmemStruct
+{
+	slock_t		mutex;			/* protects the reset state below */
+	TimestampTz stat_reset_timestamp;
+	LWLockTrancheUsage baseline[NUM_LWLOCK_USAGE_SLOTS];
+
+	/* per-PGPROC rows of NUM_LWLOCK_USAGE_SLOTS counters */
+	LWLockUsageCounters counters[FLEXIBLE_ARRAY_MEMBER];
+} LWLockUsageShmemStruct;
+
+static LWLockUsageShmemStruct *LWLockUsage = NULL;
+
+/* This process's row of counters, or NULL if we don't have a PGPROC */
+static LWLockUsageCounters *MyLWLockUsage = NULL;
+
+#define LWLockUsageSlot(tranche) \
+	Min((tranche), LWTRANCHE_FIRST_USER_DEFINED)
+#define LWLockUsageRows() \
+	(MaxBackends + NUM_AUXILIARY_PROCS)
+
 static void InitializeLWLocks(void);
 static inline void LWLockReportWaitStart(LWLock *lock);
 static inline void LWLockReportWaitEnd(void);
@@ -581,11 +629,167 @@ InitializeLWLocks(void)
 void
 InitLWLockAccess(void)
 {
+	Assert(MyProc != NULL && MyProc->pgprocno < LWLockUsageRows());
+
+	MyLWLockUsage = &LWLockUsage->counters[MyProc->pgprocno *
+										   NUM_LWLOCK_USAGE_SLOTS];
+
 #ifdef LWLOCK_STATS
 	init_lwlock_stats();
 #endif
 }
 
+/*
+ * Compute shmem space needed for the per-tranche usage counters.
+ */
+Size
+LWLockUsageShmemSize(void)
+{
+	Size		size;
+
+	size = mul_size(mul_size(LWLockUsageRows(), NUM_LWLOCK_USAGE_SLOTS),
+					sizeof(LWLockUsageCounters));
+	size = add_size(size, offsetof(LWLockUsageShmemStruct, counters));
+
+	return size;
+}
+
+/*
+ * Allocate and initialize the per-tranche usage counters.
+ */
+void
+LWLockUsageShmemInit(void)
+{
+	bool		found;
+
+	LWLockUsage = (LWLockUsageShmemStruct *)
+		ShmemInitStruct("LWLock Usage", LWLockUsageShmemSize(), &found);
+
+	if (!found)
+	{
+		int			ncounters = LWLockUsageRows() * NUM_LWLOCK_USAGE_SLOTS;
+
+		SpinLockInit(&LWLockUsage->mutex);
+		LWLockUsage->stat_reset_timestamp = GetCurrentTimestamp();
+		memset(LWLockUsage->baseline, 0, sizeof(LWLockUsage->baseline));
+
+		for (int i = 0; i < ncounters; i++)
+		{
+			pg_atomic_init_u64(&LWLockUsage->counters[i].acquisitions, 0);
+			pg_atomic_init_u64(&LWLockUsage->counters[i].contended, 0);
+			pg_atomic_init_u64(&LWLockUsage->counters[i].wait_time, 0);
+		}
+	}
+}
+
+/*
+ * Add to one of our own usage counters.  Nobody else writes to our row, so
+ * there's no need for a (much more expensive) atomic read-modify-write.
+ */
+static inline void
+LWLockUsageAdd(pg_atomic_uint64 *counter, uint64 n)
+{
+	pg_atomic_write_u64(counter, pg_atomic_read_u64(counter) + n);
+}
+
+/*
+ * Account for an attempt to acquire "lock" in our usage counters.
+ * "wait_time" is the time we slept for the lock, in microseconds; it's only
+ * meaningful if "contended" is true.
+ */
+static inline void
+LWLockCountUsage(LWLock *lock, bool acquired, bool contended, uint64 wait_time)
+{
+	LWLockUsageCounters *counters;
+
+	/* Not counting anything before we have a PGPROC */
+	if (MyLWLockUsage == NULL)
+		return;
+
+	counters = &MyLWLockUsage[LWLockUsageSlot(lock->tranche)];
+	if (acquired)
+		LWLockUsageAdd(&counters->acquisitions, 1);
+	if (contended)
+	{
+		LWLockUsageAdd(&counters->contended, 1);
+		LWLockUsageAdd(&counters->wait_time, wait_time);
+	}
+}
+
+/*
+ * Sum up the counters of all processes, without the baseline.
+ */
+static void
+LWLockSumUsage(LWLockTrancheUsage *usage)
+{
+	memset(usage, 0, sizeof(LWLockTrancheUsage) * NUM_LWLOCK_USAGE_SLOTS);
+
+	for (int row = 0; row < LWLockUsageRows(); row++)
+	{
+		LWLockUsageCounters *counters;
+
+		counters = &LWLockUsage->counters[row * NUM_LWLOCK_USAGE_SLOTS];
+		for (int i = 0; i < NUM_LWLOCK_USAGE_SLOTS; i++)
+		{
+			usage[i].acquisitions += pg_atomic_read_u64(&counters[i].acquisitions);
+			usage[i].contended += pg_atomic_read_u64(&counters[i].contended);
+			usage[i].wait_time += pg_atomic_read_u64(&counters[i].wait_time);
+		}
+	}
+}
+
+/*
+ * LWLockGetUsage - report cumulative usage of all LWLock tranches
+ *
+ * "usage" must have room for NUM_LWLOCK_USAGE_SLOTS entries, indexed by
+ * tranche ID; the last entry covers all extension tranches.  Returns the time
+ * of the last reset.
+ *
+ * The counters of other processes are read without any interlock, so the
+ * result is not a consistent snapshot, but each counter is exact.
+ */
+TimestampTz
+LWLockGetUsage(LWLockTrancheUsage *usage)
+{
+	LWLockTrancheUsage baseline[NUM_LWLOCK_USAGE_SLOTS];
+	TimestampTz reset_time;
+
+	LWLockSumUsage(usage);
+
+	SpinLockAcquire(&LWLockUsage->mutex);
+	memcpy(baseline, LWLockUsage->baseline, sizeof(baseline));
+	reset_time = LWLockUsage->stat_reset_timestamp;
+	SpinLockRelease(&LWLockUsage->mutex);
+
+	for (int i = 0; i < NUM_LWLOCK_USAGE_SLOTS; i++)
+	{
+		/* guard against counters read before a concurrent reset */
+		usage[i].acquisitions -= Min(usage[i].acquisitions,
+									 baseline[i].acquisitions);
+		usage[i].contended -= Min(usage[i].contended, baseline[i].contended);
+		usage[i].wait_time -= Min(usage[i].wait_time, baseline[i].wait_time);
+	}
+
+	return reset_time;
+}
+
+/*
+ * LWLockResetUsage - reset the usage counters of all tranches to zero
+ */
+void
+LWLockResetUsage(void)
+{
+	LWLockTrancheUsage usage[NUM_LWLOCK_USAGE_SLOTS];
+	TimestampTz now = GetCurrentTimestamp();
+
+	LWLockSumUsage(usage);
+
+	SpinLockAcquire(&LWLockUsage->mutex);
+	memcpy(LWLockUsage->baseline, usage, sizeof(usage));
+	LWLockUsage->stat_reset_timestamp = now;
+	SpinLockRelease(&LWLockUsage->mutex);
+}
+
 /*
  * GetNamedLWLockTranche - returns the base address of LWLock from the
  *		specified tranche.
@@ -1209,6 +1413,7 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 	PGPROC	   *proc = MyProc;
 	bool		result = true;
 	int			extraWaits = 0;
+	uint64		wait_time = 0;
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
 
@@ -1264,6 +1469,8 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 	for (;;)
 	{
 		bool		mustwait;
+		instr_time	wait_start;
+		instr_time	wait_end;
 
 		/*
 		 * Try to grab the lock the first time, we're not in the waitqueue
@@ -1323,6 +1530,7 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 
 		LWLockReportWaitStart(lock);
 		TRACE_POSTGRESQL_LWLOCK_WAIT_START(T_NAME(lock), mode);
+		INSTR_TIME_SET_CURRENT(wait_start);
 
 		for (;;)
 		{
@@ -1332,6 +1540,10 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 			extraWaits++;
 		}
 
+		INSTR_TIME_SET_CURRENT(wait_end);
+		INSTR_TIME_SUBTRACT(wait_end, wait_start);
+		wait_time += INSTR_TIME_GET_MICROSEC(wait_end);
+
 		/* Retrying, allow LWLockRelease to release waiters again. */
 		pg_atomic_fetch_or_u32(&lock->state, LW_FLAG_RELEASE_OK);
 
@@ -1355,6 +1567,8 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 
 	TRACE_POSTGRESQL_LWLOCK_ACQUIRE(T_NAME(lock), mode);
 
+	LWLockCountUsage(lock, true, !result, wait_time);
+
 	/* Add lock to list of locks held by this backend */
 	held_lwlocks[num_held_lwlocks].lock = lock;
 	held_lwlocks[num_held_lwlocks++].mode = mode;
@@ -1408,6 +1622,8 @@ LWLockConditionalAcquire(LWLock *lock, LWLockMode mode)
 	}
 	else
 	{
+		LWLockCountUsage(lock, true, false, 0);
+
 		/* Add lock to list of locks held by this backend */
 		held_lwlocks[num_held_lwlocks].lock = lock;
 		held_lwlocks[num_held_lwlocks++].mode = mode;
@@ -1435,7 +1651,10 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 {
 	PGPROC	   *proc = MyProc;
 	bool		mustwait;
+	bool		waited = false;
 	int			extraWaits = 0;
+	instr_time	wait_start;
+	instr_time	wait_end;
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
 
@@ -1484,6 +1703,7 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 
 			LWLockReportWaitStart(lock);
 			TRACE_POSTGRESQL_LWLOCK_WAIT_START(T_NAME(lock), mode);
+			INSTR_TIME_SET_CURRENT(wait_start);
 
 			for (;;)
 			{
@@ -1493,6 +1713,10 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 				extraWaits++;
 			}
 
+			INSTR_TIME_SET_CURRENT(wait_end);
+			INSTR_TIME_SUBTRACT(wait_end, wait_start);
+			waited = true;
+
 #ifdef LOCK_DEBUG
 			{
 				/* not waiting anymore */
@@ -1526,6 +1750,9 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 	while (extraWaits-- > 0)
 		PGSemaphoreUnlock(proc->sem);
 
+	LWLockCountUsage(lock, !mustwait, waited,
+					 waited ? INSTR_TIME_GET_MICROSEC(wait_end) : 0);
+
 	if (mustwait)
 	{
 		/* Failed to get lock, so release interrupt holdoff */
@@ -425,6 +425,20 @@ static bool MyXactDidWrite = false;
  */
 static SERIALIZABLEXACT *SavedSerializableXact = InvalidSerializableXact;
 
+/*
+ * Small direct-mapped cache of xids for which CheckForSerializableConflictOut
+ * has nothing more to do in the current transaction: the xid isn't
+ * serializable, its writes were already in our snapshot, it is doomed, or a
+ * rw-conflict to it has already been recorded.  None of that can change
+ * before we finish, so repeated reads of tuples written by the same
+ * transaction don't need to take SerializableXactHashLock again.  Cleared in
+ * ReleasePredicateLocksLocal().
+ */
+#define CONFLICT_OUT_CACHE_SIZE		64
+static TransactionId ConflictOutCache[CONFLICT_OUT_CACHE_SIZE];
+
+#define ConflictOutCacheSlot(xid)	((xid) % CONFLICT_OUT_CACHE_SIZE)
+
 /* local functions */
 
 static SERIALIZABLEXACT *CreatePredXact(void);
@@ -438,7 +452,7 @@ static void SetPossibleUnsafeConflict(SERIALIZABLEXACT *roXact, SERIALIZABLEXACT
 static void ReleaseRWConflict(RWConflict conflict);
 static void FlagSxactUnsafe(SERIALIZABLEXACT *sxact);
 
-static bool SerialPagePrecedesLogically(int p, int q);
+static bool SerialPagePrecedesLogically(int64 p, int64 q);
 static void SerialInit(void);
 static void SerialAdd(TransactionId xid, SerCommitSeqNo minConflictCommitSeqNo);
 static SerCommitSeqNo SerialGetMinConflictCommitSeqNo(TransactionId xid);
@@ -788,7 +802,7 @@ FlagSxactUnsafe(SERIALIZABLEXACT *sxact)
  * Compares using wraparound logic, as is required by slru.c.
  */
 static bool
-SerialPagePrecedesLogically(int p, int q)
+SerialPagePrecedesLogically(int64 p, int64 q)
 {
 	int			diff;
 
@@ -820,7 +834,7 @@ SerialInit(void)
 	 */
 	SerialSlruCtl->PagePrecedes = SerialPagePrecedesLogically;
 	SimpleLruInit(SerialSlruCtl, "Serial",
-				  NUM_SERIAL_BUFFERS, 0, SerialSLRULock, "pg_serial",
+				  serializable_buffers, 0, SerialSLRULock, "pg_serial",
 				  LWTRANCHE_SERIAL_BUFFER, SYNC_HANDLER_NONE);
 
 	/*
@@ -1323,7 +1337,7 @@ PredicateLockShmemSize(void)
 
 	/* Shared memory structures for SLRU tracking of old committed xids. */
 	size = add_size(size, sizeof(SerialControlData));
-	size = add_size(size, SimpleLruShmemSize(NUM_SERIAL_BUFFERS, 0));
+	size = add_size(size, SimpleLruShmemSize(serializable_buffers, 0));
 
 	return size;
 }
@@ -3656,6 +3670,9 @@ ReleasePredicateLocksLocal(void)
 	MySerializableXact = InvalidSerializableXact;
 	MyXactDidWrite = false;
 
+	/* Forget the conflict-out decisions of this transaction */
+	memset(ConflictOutCache, 0, sizeof(ConflictOutCache));
+
 	/* Delete per-transaction lock table */
 	if (LocalPredicateLockHash != NULL)
 	{
@@ -3673,17 +3690,32 @@ ClearOldPredicateLocks(void)
 {
 	SERIALIZABLEXACT *finishedSxact;
 	PREDICATELOCK *predlock;
+	TransactionId globalXmin;
+	SerCommitSeqNo canPartialClearThrough;
 
 	/*
 	 * Loop through finished transactions. They are in commit order, so we can
 	 * stop as soon as we find one that's still interesting.
 	 */
 	LWLockAcquire(SerializableFinishedListLock, LW_EXCLUSIVE);
+
+	/*
+	 * Take a copy of the horizons once, rather than re-acquiring
+	 * SerializableXactHashLock for every entry we look at.  Both only ever
+	 * advance, so working with slightly stale values can only make us clear
+	 * less than we could.  Since we hold SerializableFinishedListLock, no
+	 * transaction can join the finished list while we're looking at it, so
+	 * every entry we see committed before we took the copy.
+	 */
+	LWLockAcquire(SerializableXactHashLock, LW_SHARED);
+	globalXmin = PredXact->SxactGlobalXmin;
+	canPartialClearThrough = PredXact->CanPartialClearThrough;
+	LWLockRelease(SerializableXactHashLock);
+
 	finishedSxact = (SERIALIZABLEXACT *)
 		SHMQueueNext(FinishedSerializableTransactions,
 					 FinishedSerializableTransactions,
 					 offsetof(SERIALIZABLEXACT, finishedLink));
-	LWLockAcquire(SerializableXactHashLock, LW_SHARED);
 	while (finishedSxact)
 	{
 		SERIALIZABLEXACT *nextSxact;
@@ -3692,29 +3724,25 @@ ClearOldPredicateLocks(void)
 			SHMQueueNext(FinishedSerializableTransactions,
 						 &(finishedSxact->finishedLink),
 						 offsetof(SERIALIZABLEXACT, finishedLink));
-		if (!TransactionIdIsValid(PredXact->SxactGlobalXmin)
+		if (!TransactionIdIsValid(globalXmin)
 			|| TransactionIdPrecedesOrEquals(finishedSxact->finishedBefore,
-											 PredXact->SxactGlobalXmin))
+											 globalXmin))
 		{
 			/*
 			 * This transaction committed before any in-progress transaction
 			 * took its snapshot. It's no longer interesting.
 			 */
-			LWLockRelease(SerializableXactHashLock);
 			SHMQueueDelete(&(finishedSxact->finishedLink));
 			ReleaseOneSerializableXact(finishedSxact, false, false);
-			LWLockAcquire(SerializableXactHashLock, LW_SHARED);
 		}
 		else if (finishedSxact->commitSeqNo > PredXact->HavePartialClearedThrough
-				 && finishedSxact->commitSeqNo <= PredXact->CanPartialClearThrough)
+				 && finishedSxact->commitSeqNo <= canPartialClearThrough)
 		{
 			/*
 			 * Any active transactions that took their snapshot before this
 			 * transaction committed are read-only, so we can clear part of
 			 * its state.
 			 */
-			LWLockRelease(SerializableXactHashLock);
-
 			if (SxactIsReadOnly(finishedSxact))
 			{
 				/* A read-only transaction can be removed entirely */
@@ -3732,7 +3760,6 @@ ClearOldPredicateLocks(void)
 			}
 
 			PredXact->HavePartialClearedThrough = finishedSxact->commitSeqNo;
-			LWLockAcquire(SerializableXactHashLock, LW_SHARED);
 		}
 		else
 		{
@@ -3741,7 +3768,6 @@ ClearOldPredicateLocks(void)
 		}
 		finishedSxact = nextSxact;
 	}
-	LWLockRelease(SerializableXactHashLock);
 
 	/*
 	 * Loop through predicate locks on dummy transaction for summarized data.
@@ -3754,24 +3780,20 @@ ClearOldPredicateLocks(void)
 	while (predlock)
 	{
 		PREDICATELOCK *nextpredlock;
-		bool		canDoPartialCleanup;
 
 		nextpredlock = (PREDICATELOCK *)
 			SHMQueueNext(&OldCommittedSxact->predicateLocks,
 						 &predlock->xactLink,
 						 offsetof(PREDICATELOCK, xactLink));
 
-		LWLockAcquire(SerializableXactHashLock, LW_SHARED);
 		Assert(predlock->commitSeqNo != 0);
 		Assert(predlock->commitSeqNo != InvalidSerCommitSeqNo);
-		canDoPartialCleanup = (predlock->commitSeqNo <= PredXact->CanPartialClearThrough);
-		LWLockRelease(SerializableXactHashLock);
 
 		/*
 		 * If this lock originally belonged to an old enough transaction, we
 		 * can release it.
 		 */
-		if (canDoPartialCleanup)
+		if (predlock->commitSeqNo <= canPartialClearThrough)
 		{
 			PREDICATELOCKTAG tag;
 			PREDICATELOCKTARGET *target;
@@ -4070,6 +4092,10 @@ CheckForSerializableConflictOut(Relation relation, TransactionId xid, Snapshot s
 	if (TransactionIdEquals(xid, GetTopTransactionIdIfAny()))
 		return;
 
+	/* Have we already dealt with this xid? */
+	if (TransactionIdEquals(ConflictOutCache[ConflictOutCacheSlot(xid)], xid))
+		return;
+
 	/*
 	 * Find sxact or summarized info for the top level xid.
 	 */
@@ -4108,6 +4134,11 @@ CheckForSerializableConflictOut(Relation relation, TransactionId xid, Snapshot s
 
 			MySerializableXact->flags |= SXACT_FLAG_SUMMARY_CONFLICT_OUT;
 		}
+		else
+		{
+			/* Not serializable; that won't change. */
+			ConflictOutCache[ConflictOutCacheSlot(xid)] = xid;
+		}
 
 		/* It's not serializable or otherwise not important. */
 		LWLockRelease(SerializableXactHashLock);
@@ -4118,6 +4149,7 @@ CheckForSerializableConflictOut(Relation relation, TransactionId xid, Snapshot s
 	if (sxact == MySerializableXact || SxactIsDoomed(sxact))
 	{
 		/* Can't conflict with ourself or a transaction that will roll back. */
+		ConflictOutCache[ConflictOutCacheSlot(xid)] = xid;
 		LWLockRelease(SerializableXactHashLock);
 		return;
 	}
@@ -4166,6 +4198,7 @@ CheckForSerializableConflictOut(Relation relation, TransactionId xid, Snapshot s
 	if (!XidIsConcurrent(xid))
 	{
 		/* This write was already in our snapshot; no conflict. */
+		ConflictOutCache[ConflictOutCacheSlot(xid)] = xid;
 		LWLockRelease(SerializableXactHashLock);
 		return;
 	}
@@ -4182,6 +4215,13 @@ CheckForSerializableConflictOut(Relation relation, TransactionId xid, Snapshot s
 	 * structure, ereport an error.
 	 */
 	FlagRWConflict(MySerializableXact, sxact);
+
+	/*
+	 * The conflict stays recorded until we finish, unless we're read-only,
+	 * in which case a committing writer may release it early.
+	 */
+	if (!SxactIsReadOnly(MySerializableXact))
+		ConflictOutCache[ConflictOutCacheSlot(xid)] = xid;
 	LWLockRelease(SerializableXactHashLock);
 }
 
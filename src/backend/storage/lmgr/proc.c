@@ -61,6 +61,7 @@ int			DeadlockTimeout = 1000;
 int			StatementTimeout = 0;
 int			LockTimeout = 0;
 int			IdleInTransactionSessionTimeout = 0;
+int			max_cached_subxids = 256;
 bool		log_lock_waits = false;
 
 /* Pointer to this process's PGPROC struct, if any */
@@ -92,6 +93,7 @@ static void RemoveProcFromArray(int code, Datum arg);
 static void ProcKill(int code, Datum arg);
 static void AuxiliaryProcKill(int code, Datum arg);
 static void CheckDeadLock(void);
+static Size FastPathLockShmemSize(void);
 
 
 /*
@@ -113,9 +115,31 @@ ProcGlobalShmemSize(void)
 	size = add_size(size, mul_size(TotalProcs, sizeof(*ProcGlobal->subxidStates)));
 	size = add_size(size, mul_size(TotalProcs, sizeof(*ProcGlobal->statusFlags)));
 
+	/* fast-path lock arrays, sized by InitializeFastPathLocks() */
+	size = add_size(size, mul_size(TotalProcs, FastPathLockShmemSize()));
+
+	/* subtransaction XID caches */
+	size = add_size(size, mul_size(TotalProcs,
+								   mul_size(max_cached_subxids,
+											sizeof(TransactionId))));
+
 	return size;
 }
 
+/*
+ * Report shared-memory space needed for one backend's fast-path lock arrays.
+ */
+static Size
+FastPathLockShmemSize(void)
+{
+	Assert(FastPathLockGroupsPerBackend > 0);
+
+	return add_size(MAXALIGN(mul_size(FastPathLockGroupsPerBackend,
+									  sizeof(uint64))),
+					MAXALIGN(mul_size(FastPathLockSlotsPerBackend(),
+									  sizeof(Oid))));
+}
+
 /*
  * Report number of semaphores needed by InitProcGlobal.
  */
@@ -161,6 +185,8 @@ InitProcGlobal(void)
 	int			i,
 				j;
 	bool		found;
+	char	   *fpPtr;
+	TransactionId *subxidPtr;
 	uint32		TotalProcs = MaxBackends + NUM_AUXILIARY_PROCS + max_prepared_xacts;
 
 	/* Create the ProcGlobal shared structure */
@@ -213,10 +239,32 @@ InitProcGlobal(void)
 	ProcGlobal->statusFlags = (uint8 *) ShmemAlloc(TotalProcs * sizeof(*ProcGlobal->statusFlags));
 	MemSet(ProcGlobal->statusFlags, 0, TotalProcs * sizeof(*ProcGlobal->statusFlags));
 
+	/*
+	 * Allocate the fast-path lock arrays for all PGPROCs in one chunk.  Their
+	 * size depends on max_locks_per_transaction, so they can't be embedded in
+	 * PGPROC itself.
+	 */
+	fpPtr = (char *) ShmemAlloc(TotalProcs * FastPathLockShmemSize());
+	MemSet(fpPtr, 0, TotalProcs * FastPathLockShmemSize());
+
+	/* Likewise for the subtransaction XID caches, sized by max_cached_subxids */
+	subxidPtr = (TransactionId *)
+		ShmemAlloc(TotalProcs * max_cached_subxids * sizeof(TransactionId));
+
 	for (i = 0; i < TotalProcs; i++)
 	{
 		/* Common initialization for all PGPROCs, regardless of type. */
 
+		/* Point the PGPROC at its fast-path lock arrays. */
+		procs[i].fpLockBits = (uint64 *) fpPtr;
+		fpPtr += MAXALIGN(FastPathLockGroupsPerBackend * sizeof(uint64));
+		procs[i].fpRelId = (Oid *) fpPtr;
+		fpPtr += MAXALIGN(FastPathLockSlotsPerBackend() * sizeof(Oid));
+
+		/* ... and at its subtransaction XID cache. */
+		procs[i].subxids.xids = subxidPtr;
+		subxidPtr += max_cached_subxids;
+
 		/*
 		 * Set up per-PGPROC semaphore, latch, and fpInfoLock.  Prepared xact
 		 * dummy PGPROCs don't need these though - they're never associated
@@ -612,6 +660,9 @@ InitAuxiliaryProcess(void)
 	 * Arrange to clean up at process exit.
 	 */
 	on_shmem_exit(AuxiliaryProcKill, Int32GetDatum(proctype));
+
+	/* Now that we have a PGPROC, initialize local state needed for LWLocks */
+	InitLWLockAccess();
 }
 
 /*
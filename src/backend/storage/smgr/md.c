@@ -31,6 +31,7 @@
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
+#include "port/pg_iovec.h"
 #include "postmaster/bgwriter.h"
 #include "storage/bufmgr.h"
 #include "storage/fd.h"
@@ -87,6 +88,18 @@ typedef struct _MdfdVec
 
 static MemoryContext MdCxt;		/* context for all MdfdVec objects */
 
+/*
+ * With direct I/O, the kernel transfers data straight between the file and
+ * the caller's buffer, which must therefore be aligned to PG_IO_ALIGN_SIZE.
+ * Shared and local buffers always are, but some callers read or write pages
+ * kept in palloc'd or stack memory.  Those are copied through this buffer,
+ * allocated on first use.
+ */
+static char *md_bounce_buffer = NULL;
+
+/* A block of zeroes for mdzeroextend(), also allocated on first use */
+static char *md_zero_block = NULL;
+
 
 /* Populate a file tag describing an md.c segment file. */
 #define INIT_MD_FILETAG(a,xx_rnode,xx_forknum,xx_segno) \
@@ -117,11 +130,18 @@ static MemoryContext MdCxt;		/* context for all MdfdVec objects */
  */
 #define EXTENSION_DONT_CHECK_SIZE	(1 << 4)
 
+/*
+ * mdzeroextend() only uses FileFallocate() for extensions of more than this
+ * many blocks, and writes out zeroes for smaller ones.
+ */
+#define MD_FALLOCATE_MIN_BLOCKS		8
+
 
 /* local routines */
 static void mdunlinkfork(RelFileNodeBackend rnode, ForkNumber forkNum,
 						 bool isRedo);
 static MdfdVec *mdopenfork(SMgrRelation reln, ForkNumber forknum, int behavior);
+static int	md_file_sync(File file, uint32 wait_event_info);
 static void register_dirty_segment(SMgrRelation reln, ForkNumber forknum,
 								   MdfdVec *seg);
 static void register_unlink_segment(RelFileNodeBackend rnode, ForkNumber forknum,
@@ -139,6 +159,23 @@ static MdfdVec *_mdfd_getseg(SMgrRelation reln, ForkNumber forkno,
 							 BlockNumber blkno, bool skipFsync, int behavior);
 static BlockNumber _mdnblocks(SMgrRelation reln, ForkNumber forknum,
 							  MdfdVec *seg);
+static void mdreadcomplete(SMgrRelation reln, ForkNumber forknum,
+						   BlockNumber blocknum, char *buffer, MdfdVec *v,
+						   int nbytes);
+static char *md_io_buffer(char *buffer);
+static char *md_zero_buffer(void);
+
+/* Flags for opening relation files */
+static inline int
+_mdfd_open_flags(void)
+{
+	int			flags = O_RDWR | PG_BINARY;
+
+	if (io_direct_flags & IO_DIRECT_DATA)
+		flags |= PG_O_DIRECT;
+
+	return flags;
+}
 
 
 /*
@@ -201,14 +238,14 @@ mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo)
 
 	path = relpath(reln->smgr_rnode, forkNum);
 
-	fd = PathNameOpenFile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY);
+	fd = PathNameOpenFile(path, _mdfd_open_flags() | O_CREAT | O_EXCL);
 
 	if (fd < 0)
 	{
 		int			save_errno = errno;
 
 		if (isRedo)
-			fd = PathNameOpenFile(path, O_RDWR | PG_BINARY);
+			fd = PathNameOpenFile(path, _mdfd_open_flags());
 		if (fd < 0)
 		{
 			/* be sure to report the error reported by create, not open */
@@ -417,6 +454,7 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	off_t		seekpos;
 	int			nbytes;
 	MdfdVec    *v;
+	char	   *iobuf;
 
 	/* This assert is too expensive to have on normally ... */
 #ifdef CHECK_WRITE_VS_EXTEND
@@ -441,7 +479,11 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
-	if ((nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_EXTEND)) != BLCKSZ)
+	iobuf = md_io_buffer(buffer);
+	if (iobuf != buffer)
+		memcpy(iobuf, buffer, BLCKSZ);
+
+	if ((nbytes = FileWrite(v->mdfd_vfd, iobuf, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_EXTEND)) != BLCKSZ)
 	{
 		if (nbytes < 0)
 			ereport(ERROR,
@@ -464,6 +506,125 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	Assert(_mdnblocks(reln, forknum, v) <= ((BlockNumber) RELSEG_SIZE));
 }
 
+/*
+ *	mdzeroextend() -- Add nblocks zeroed blocks to the specified relation.
+ *
+ *		Like mdextend(), but for a run of blocks that are to read back as
+ *		zeroes.  Except for small extensions, the space is allocated with
+ *		FileFallocate(), which avoids writing out the zeroes and leaves the
+ *		file system a chance to allocate the whole range contiguously.
+ *		Small or unsupported cases write out zeroes, as few system calls as
+ *		PG_IOV_MAX allows.  Each segment touched is registered for fsync
+ *		just once.
+ */
+void
+mdzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			 BlockNumber nblocks, bool skipFsync)
+{
+	/* This assert is too expensive to have on normally ... */
+#ifdef CHECK_WRITE_VS_EXTEND
+	Assert(blocknum >= mdnblocks(reln, forknum));
+#endif
+
+	/*
+	 * If a relation manages to grow to 2^32-1 blocks, refuse to extend it any
+	 * more --- we mustn't create a block whose number actually is
+	 * InvalidBlockNumber.  Note that this also guards against overflow in
+	 * blocknum + nblocks.
+	 */
+	if ((uint64) blocknum + nblocks >= (uint64) InvalidBlockNumber)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("cannot extend file \"%s\" beyond %u blocks",
+						relpath(reln->smgr_rnode, forknum),
+						InvalidBlockNumber)));
+
+	while (nblocks > 0)
+	{
+		off_t		seekpos;
+		MdfdVec    *v;
+		BlockNumber nblocks_this_segment;
+		int			ret;
+
+		v = _mdfd_getseg(reln, forknum, blocknum, skipFsync, EXTENSION_CREATE);
+
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		nblocks_this_segment =
+			Min(nblocks,
+				RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+
+		/*
+		 * Allocating space for just a few blocks isn't worth a separate
+		 * system call, and some file systems handle it badly, so only use
+		 * FileFallocate() for larger extensions.
+		 */
+		ret = -1;
+		errno = EOPNOTSUPP;
+		if (nblocks_this_segment > MD_FALLOCATE_MIN_BLOCKS)
+			ret = FileFallocate(v->mdfd_vfd, seekpos,
+								(off_t) BLCKSZ * nblocks_this_segment,
+								WAIT_EVENT_DATA_FILE_EXTEND);
+		if (ret != 0 && errno != EOPNOTSUPP)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not extend file \"%s\" with FileFallocate(): %m",
+							FilePathName(v->mdfd_vfd)),
+					 errhint("Check free disk space.")));
+
+		if (ret != 0)
+		{
+			BlockNumber done = 0;
+
+			while (done < nblocks_this_segment)
+			{
+				struct iovec iov[PG_IOV_MAX];
+				int			iovcnt;
+				int			nbytes;
+
+				iovcnt = Min(nblocks_this_segment - done, PG_IOV_MAX);
+				for (int i = 0; i < iovcnt; i++)
+				{
+					iov[i].iov_base = md_zero_buffer();
+					iov[i].iov_len = BLCKSZ;
+				}
+
+				nbytes = FileWriteV(v->mdfd_vfd, iov, iovcnt,
+									seekpos + (off_t) BLCKSZ * done,
+									WAIT_EVENT_DATA_FILE_EXTEND);
+				if (nbytes != iovcnt * BLCKSZ)
+				{
+					if (nbytes < 0)
+						ereport(ERROR,
+								(errcode_for_file_access(),
+								 errmsg("could not extend file \"%s\": %m",
+										FilePathName(v->mdfd_vfd)),
+								 errhint("Check free disk space.")));
+					/* short write: complain appropriately */
+					ereport(ERROR,
+							(errcode(ERRCODE_DISK_FULL),
+							 errmsg("could not extend file \"%s\": wrote only %d of %d bytes at block %u",
+									FilePathName(v->mdfd_vfd),
+									nbytes, iovcnt * BLCKSZ,
+									blocknum + done),
+							 errhint("Check free disk space.")));
+				}
+				done += iovcnt;
+			}
+		}
+
+		if (!skipFsync && !SmgrIsTemp(reln))
+			register_dirty_segment(reln, forknum, v);
+
+		Assert(_mdnblocks(reln, forknum, v) <= ((BlockNumber) RELSEG_SIZE));
+
+		nblocks -= nblocks_this_segment;
+		blocknum += nblocks_this_segment;
+	}
+}
+
 /*
  *	mdopenfork() -- Open one fork of the specified relation.
  *
@@ -487,7 +648,7 @@ mdopenfork(SMgrRelation reln, ForkNumber forknum, int behavior)
 
 	path = relpath(reln->smgr_rnode, forknum);
 
-	fd = PathNameOpenFile(path, O_RDWR | PG_BINARY);
+	fd = PathNameOpenFile(path, _mdfd_open_flags());
 
 	if (fd < 0)
 	{
@@ -635,6 +796,7 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	off_t		seekpos;
 	int			nbytes;
 	MdfdVec    *v;
+	char	   *iobuf;
 
 	TRACE_POSTGRESQL_SMGR_MD_READ_START(forknum, blocknum,
 										reln->smgr_rnode.node.spcNode,
@@ -649,8 +811,160 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
-	nbytes = FileRead(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_READ);
+	iobuf = md_io_buffer(buffer);
+
+	nbytes = FileRead(v->mdfd_vfd, iobuf, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_READ);
+
+	if (iobuf != buffer && nbytes > 0)
+		memcpy(buffer, iobuf, nbytes);
+
+	mdreadcomplete(reln, forknum, blocknum, buffer, v, nbytes);
+}
+
+/*
+ *	mdreadv() -- Read a run of consecutive blocks from a relation.
+ *
+ *		The blocks are read with as few system calls as the segment
+ *		boundaries and PG_IOV_MAX allow.  A short read is handled like in
+ *		mdread(), but only for the blocks that were actually missing.
+ */
+void
+mdreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		char **buffers, BlockNumber nblocks)
+{
+	/* Let mdread() deal with any buffers unsuitable for direct I/O */
+	if (io_direct_flags & IO_DIRECT_DATA)
+	{
+		for (int i = 0; i < nblocks; i++)
+		{
+			if (md_io_buffer(buffers[i]) != buffers[i])
+			{
+				for (i = 0; i < nblocks; i++)
+					mdread(reln, forknum, blocknum + i, buffers[i]);
+				return;
+			}
+		}
+	}
+
+	while (nblocks > 0)
+	{
+		struct iovec iov[PG_IOV_MAX];
+		int			iovcnt;
+		off_t		seekpos;
+		int			nbytes;
+		int			nread;
+		MdfdVec    *v;
+		BlockNumber nblocks_this_segment;
 
+		v = _mdfd_getseg(reln, forknum, blocknum, false,
+						 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		nblocks_this_segment =
+			Min(nblocks,
+				RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+		nblocks_this_segment = Min(nblocks_this_segment, PG_IOV_MAX);
+
+		for (iovcnt = 0; iovcnt < nblocks_this_segment; iovcnt++)
+		{
+			TRACE_POSTGRESQL_SMGR_MD_READ_START(forknum, blocknum + iovcnt,
+												reln->smgr_rnode.node.spcNode,
+												reln->smgr_rnode.node.dbNode,
+												reln->smgr_rnode.node.relNode,
+												reln->smgr_rnode.backend);
+			iov[iovcnt].iov_base = buffers[iovcnt];
+			iov[iovcnt].iov_len = BLCKSZ;
+		}
+
+		nbytes = FileReadV(v->mdfd_vfd, iov, iovcnt, seekpos,
+						   WAIT_EVENT_DATA_FILE_READ);
+
+		/*
+		 * Complete each block in turn, so that errors are reported exactly
+		 * as mdread() would have.
+		 */
+		for (nread = 0; nread < iovcnt; nread++)
+		{
+			int			nbytes_this_block;
+
+			if (nbytes < 0)
+				nbytes_this_block = nbytes;
+			else
+				nbytes_this_block =
+					Min(Max(nbytes - nread * BLCKSZ, 0), BLCKSZ);
+
+			mdreadcomplete(reln, forknum, blocknum + nread, buffers[nread],
+						   v, nbytes_this_block);
+		}
+
+		nblocks -= iovcnt;
+		blocknum += iovcnt;
+		buffers += iovcnt;
+	}
+}
+
+/*
+ *	mdstartread() -- Start reading the specified block from a relation.
+ *
+ *		The returned handle must be passed to mdwaitread(), along with the
+ *		same block and buffer, before the buffer contents can be used.
+ *		With direct I/O, the buffer must be aligned to PG_IO_ALIGN_SIZE.
+ */
+int
+mdstartread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			char *buffer)
+{
+	off_t		seekpos;
+	MdfdVec    *v;
+
+	TRACE_POSTGRESQL_SMGR_MD_READ_START(forknum, blocknum,
+										reln->smgr_rnode.node.spcNode,
+										reln->smgr_rnode.node.dbNode,
+										reln->smgr_rnode.node.relNode,
+										reln->smgr_rnode.backend);
+
+	v = _mdfd_getseg(reln, forknum, blocknum, false,
+					 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+	seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+	Assert(md_io_buffer(buffer) == buffer);
+
+	return FileStartRead(v->mdfd_vfd, buffer, BLCKSZ, seekpos,
+						 WAIT_EVENT_DATA_FILE_READ);
+}
+
+/*
+ *	mdwaitread() -- Finish a read started with mdstartread().
+ */
+void
+mdwaitread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		   char *buffer, int handle)
+{
+	int			nbytes;
+	MdfdVec    *v;
+
+	nbytes = FileWaitRead(handle);
+
+	/* the segment was opened by mdstartread(), so this is cheap */
+	v = _mdfd_getseg(reln, forknum, blocknum, false,
+					 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+	mdreadcomplete(reln, forknum, blocknum, buffer, v, nbytes);
+}
+
+/*
+ * mdreadcomplete() -- Check the outcome of reading one block.
+ */
+static void
+mdreadcomplete(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			   char *buffer, MdfdVec *v, int nbytes)
+{
 	TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
 									   reln->smgr_rnode.node.spcNode,
 									   reln->smgr_rnode.node.dbNode,
@@ -686,6 +1000,44 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	}
 }
 
+/*
+ * md_io_buffer() -- Return a buffer suitable for reading or writing a block.
+ *
+ *		That's the given buffer itself unless direct I/O is in use and it is
+ *		not suitably aligned, in which case the caller must copy the data
+ *		through the returned bounce buffer.
+ */
+static char *
+md_io_buffer(char *buffer)
+{
+	if ((io_direct_flags & IO_DIRECT_DATA) == 0 ||
+		buffer == (char *) TYPEALIGN(PG_IO_ALIGN_SIZE, buffer))
+		return buffer;
+
+	if (md_bounce_buffer == NULL)
+		md_bounce_buffer = (char *)
+			TYPEALIGN(PG_IO_ALIGN_SIZE,
+					  MemoryContextAlloc(TopMemoryContext,
+										 BLCKSZ + PG_IO_ALIGN_SIZE));
+
+	return md_bounce_buffer;
+}
+
+/*
+ * md_zero_buffer() -- Return a block of zeroes, suitable for direct I/O.
+ */
+static char *
+md_zero_buffer(void)
+{
+	if (md_zero_block == NULL)
+		md_zero_block = (char *)
+			TYPEALIGN(PG_IO_ALIGN_SIZE,
+					  MemoryContextAllocZero(TopMemoryContext,
+											 BLCKSZ + PG_IO_ALIGN_SIZE));
+
+	return md_zero_block;
+}
+
 /*
  *	mdwrite() -- Write the supplied block at the appropriate location.
  *
@@ -700,6 +1052,7 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	off_t		seekpos;
 	int			nbytes;
 	MdfdVec    *v;
+	char	   *iobuf;
 
 	/* This assert is too expensive to have on normally ... */
 #ifdef CHECK_WRITE_VS_EXTEND
@@ -719,7 +1072,11 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
-	nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_WRITE);
+	iobuf = md_io_buffer(buffer);
+	if (iobuf != buffer)
+		memcpy(iobuf, buffer, BLCKSZ);
+
+	nbytes = FileWrite(v->mdfd_vfd, iobuf, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_WRITE);
 
 	TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum,
 										reln->smgr_rnode.node.spcNode,
@@ -750,6 +1107,110 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		register_dirty_segment(reln, forknum, v);
 }
 
+/*
+ *	mdwritev() -- Write a run of consecutive blocks.
+ *
+ *		The blocks are written with as few system calls as the segment
+ *		boundaries and PG_IOV_MAX allow, and each segment touched is
+ *		registered for fsync just once.
+ */
+void
+mdwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		 char **buffers, BlockNumber nblocks, bool skipFsync)
+{
+	/* Let mdwrite() deal with any buffers unsuitable for direct I/O */
+	if (io_direct_flags & IO_DIRECT_DATA)
+	{
+		for (int i = 0; i < nblocks; i++)
+		{
+			if (md_io_buffer(buffers[i]) != buffers[i])
+			{
+				for (i = 0; i < nblocks; i++)
+					mdwrite(reln, forknum, blocknum + i, buffers[i],
+							skipFsync);
+				return;
+			}
+		}
+	}
+
+	while (nblocks > 0)
+	{
+		struct iovec iov[PG_IOV_MAX];
+		int			iovcnt;
+		off_t		seekpos;
+		int			nbytes;
+		MdfdVec    *v;
+		BlockNumber nblocks_this_segment;
+
+		/* This assert is too expensive to have on normally ... */
+#ifdef CHECK_WRITE_VS_EXTEND
+		Assert(blocknum + nblocks <= mdnblocks(reln, forknum));
+#endif
+
+		v = _mdfd_getseg(reln, forknum, blocknum, skipFsync,
+						 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		nblocks_this_segment =
+			Min(nblocks,
+				RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+		nblocks_this_segment = Min(nblocks_this_segment, PG_IOV_MAX);
+
+		for (iovcnt = 0; iovcnt < nblocks_this_segment; iovcnt++)
+		{
+			TRACE_POSTGRESQL_SMGR_MD_WRITE_START(forknum, blocknum + iovcnt,
+												 reln->smgr_rnode.node.spcNode,
+												 reln->smgr_rnode.node.dbNode,
+												 reln->smgr_rnode.node.relNode,
+												 reln->smgr_rnode.backend);
+			iov[iovcnt].iov_base = buffers[iovcnt];
+			iov[iovcnt].iov_len = BLCKSZ;
+		}
+
+		nbytes = FileWriteV(v->mdfd_vfd, iov, iovcnt, seekpos,
+							WAIT_EVENT_DATA_FILE_WRITE);
+
+		for (int i = 0; i < iovcnt; i++)
+			TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum + i,
+												reln->smgr_rnode.node.spcNode,
+												reln->smgr_rnode.node.dbNode,
+												reln->smgr_rnode.node.relNode,
+												reln->smgr_rnode.backend,
+												nbytes < 0 ? nbytes :
+												Min(Max(nbytes - i * BLCKSZ, 0),
+													BLCKSZ),
+												BLCKSZ);
+
+		if (nbytes != iovcnt * BLCKSZ)
+		{
+			if (nbytes < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not write blocks %u..%u in file \"%s\": %m",
+								blocknum, blocknum + iovcnt - 1,
+								FilePathName(v->mdfd_vfd))));
+			/* short write: complain appropriately */
+			ereport(ERROR,
+					(errcode(ERRCODE_DISK_FULL),
+					 errmsg("could not write blocks %u..%u in file \"%s\": wrote only %d of %d bytes",
+							blocknum, blocknum + iovcnt - 1,
+							FilePathName(v->mdfd_vfd),
+							nbytes, iovcnt * BLCKSZ),
+					 errhint("Check free disk space.")));
+		}
+
+		if (!skipFsync && !SmgrIsTemp(reln))
+			register_dirty_segment(reln, forknum, v);
+
+		nblocks -= iovcnt;
+		blocknum += iovcnt;
+		buffers += iovcnt;
+	}
+}
+
 /*
  *	mdnblocks() -- Get the number of blocks stored in a relation.
  *
@@ -944,7 +1405,7 @@ mdimmedsync(SMgrRelation reln, ForkNumber forknum)
 	{
 		MdfdVec    *v = &reln->md_seg_fds[forknum][segno - 1];
 
-		if (FileSync(v->mdfd_vfd, WAIT_EVENT_DATA_FILE_IMMEDIATE_SYNC) < 0)
+		if (md_file_sync(v->mdfd_vfd, WAIT_EVENT_DATA_FILE_IMMEDIATE_SYNC) < 0)
 			ereport(data_sync_elevel(ERROR),
 					(errcode_for_file_access(),
 					 errmsg("could not fsync file \"%s\": %m",
@@ -961,6 +1422,36 @@ mdimmedsync(SMgrRelation reln, ForkNumber forknum)
 	}
 }
 
+/*
+ * md_file_sync() -- FileSync() a relation segment, counting it in pg_stat_io
+ */
+static int
+md_file_sync(File file, uint32 wait_event_info)
+{
+	instr_time	io_start,
+				io_time;
+	int			result;
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT_FAST(io_start);
+
+	result = FileSync(file, wait_event_info);
+
+	if (result == 0)
+	{
+		if (track_io_timing)
+		{
+			INSTR_TIME_SET_CURRENT_FAST(io_time);
+			INSTR_TIME_SUBTRACT(io_time, io_start);
+			pgstat_count_io_time(IOOBJECT_RELATION, IOCONTEXT_NORMAL,
+								 IOOP_FSYNC, io_time);
+		}
+		pgstat_count_io_op(IOOBJECT_RELATION, IOCONTEXT_NORMAL, IOOP_FSYNC);
+	}
+
+	return result;
+}
+
 /*
  * register_dirty_segment() -- Mark a relation segment as needing fsync
  *
@@ -985,7 +1476,7 @@ register_dirty_segment(SMgrRelation reln, ForkNumber forknum, MdfdVec *seg)
 		ereport(DEBUG1,
 				(errmsg("could not forward fsync request because request queue is full")));
 
-		if (FileSync(seg->mdfd_vfd, WAIT_EVENT_DATA_FILE_SYNC) < 0)
+		if (md_file_sync(seg->mdfd_vfd, WAIT_EVENT_DATA_FILE_SYNC) < 0)
 			ereport(data_sync_elevel(ERROR),
 					(errcode_for_file_access(),
 					 errmsg("could not fsync file \"%s\": %m",
@@ -1149,7 +1640,7 @@ _mdfd_openseg(SMgrRelation reln, ForkNumber forknum, BlockNumber segno,
 	fullpath = _mdfd_segpath(reln, forknum, segno);
 
 	/* open the file */
-	fd = PathNameOpenFile(fullpath, O_RDWR | PG_BINARY | oflags);
+	fd = PathNameOpenFile(fullpath, _mdfd_open_flags() | oflags);
 
 	pfree(fullpath);
 
@@ -1360,7 +1851,7 @@ mdsyncfiletag(const FileTag *ftag, char *path)
 	}
 
 	/* Sync the file. */
-	result = FileSync(file, WAIT_EVENT_DATA_FILE_SYNC);
+	result = md_file_sync(file, WAIT_EVENT_DATA_FILE_SYNC);
 	save_errno = errno;
 
 	if (need_to_close)
@@ -18,11 +18,14 @@
 #include "postgres.h"
 
 #include "access/xlog.h"
+#include "common/hashfn.h"
 #include "lib/ilist.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
 #include "storage/md.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
 #include "utils/hsearch.h"
 #include "utils/inval.h"
 
@@ -50,12 +53,26 @@ typedef struct f_smgr
 								bool isRedo);
 	void		(*smgr_extend) (SMgrRelation reln, ForkNumber forknum,
 								BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_zeroextend) (SMgrRelation reln, ForkNumber forknum,
+									BlockNumber blocknum, BlockNumber nblocks,
+									bool skipFsync);
 	bool		(*smgr_prefetch) (SMgrRelation reln, ForkNumber forknum,
 								  BlockNumber blocknum);
 	void		(*smgr_read) (SMgrRelation reln, ForkNumber forknum,
 							  BlockNumber blocknum, char *buffer);
+	void		(*smgr_readv) (SMgrRelation reln, ForkNumber forknum,
+							   BlockNumber blocknum, char **buffers,
+							   BlockNumber nblocks);
+	int			(*smgr_startread) (SMgrRelation reln, ForkNumber forknum,
+								   BlockNumber blocknum, char *buffer);
+	void		(*smgr_waitread) (SMgrRelation reln, ForkNumber forknum,
+								  BlockNumber blocknum, char *buffer,
+								  int handle);
 	void		(*smgr_write) (SMgrRelation reln, ForkNumber forknum,
 							   BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_writev) (SMgrRelation reln, ForkNumber forknum,
+								BlockNumber blocknum, char **buffers,
+								BlockNumber nblocks, bool skipFsync);
 	void		(*smgr_writeback) (SMgrRelation reln, ForkNumber forknum,
 								   BlockNumber blocknum, BlockNumber nblocks);
 	BlockNumber (*smgr_nblocks) (SMgrRelation reln, ForkNumber forknum);
@@ -75,9 +92,14 @@ static const f_smgr smgrsw[] = {
 		.smgr_exists = mdexists,
 		.smgr_unlink = mdunlink,
 		.smgr_extend = mdextend,
+		.smgr_zeroextend = mdzeroextend,
 		.smgr_prefetch = mdprefetch,
 		.smgr_read = mdread,
+		.smgr_readv = mdreadv,
+		.smgr_startread = mdstartread,
+		.smgr_waitread = mdwaitread,
 		.smgr_write = mdwrite,
+		.smgr_writev = mdwritev,
 		.smgr_writeback = mdwriteback,
 		.smgr_nblocks = mdnblocks,
 		.smgr_truncate = mdtruncate,
@@ -95,8 +117,303 @@ static HTAB *SMgrRelationHash = NULL;
 
 static dlist_head unowned_relns;
 
+/*
+ * Shared relation size cache.
+ *
+ * Finding out the size of a relation fork takes an lseek(SEEK_END) call on
+ * each of its segment files, and the planner does that for every relation
+ * in every query it plans.  When shared_relation_size_cache is set, sizes of
+ * non-temporary relation forks are remembered in shared memory, so that
+ * smgrnblocks() can usually skip the system calls.
+ *
+ * The cache is set-associative: an entry can only live in the partition its
+ * relation hashes to, and each partition holds RELSIZE_CACHE_WAYS entries,
+ * replaced in clock order when the partition is full.  A spinlock protects
+ * each partition.
+ *
+ * Every change of a file's size goes through smgr.c, which keeps the cache
+ * up to date: smgrextend() and smgrzeroextend() raise the cached size, while
+ * smgrtruncate(), smgrcreate() and smgrdounlinkall() remove the entry, and
+ * DROP DATABASE and ALTER DATABASE SET TABLESPACE remove all entries of the
+ * database with RelSizeCacheDropDatabase().  A backend that doesn't find a
+ * size in the cache asks the kernel and then adds the result to the cache.
+ * Since the file could have changed size in between, each partition has a
+ * counter that is incremented by every size change, and the new entry is
+ * only added if the counter hasn't moved since the lookup.
+ */
+#define RELSIZE_CACHE_WAYS	16
+
+typedef struct RelSizeCacheEntry
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber nblocks;		/* InvalidBlockNumber if slot is unused */
+	bool		recently_used;	/* for clock replacement */
+} RelSizeCacheEntry;
+
+typedef struct RelSizeCachePartition
+{
+	slock_t		mutex;
+	uint32		changecount;	/* incremented by every size change */
+	int			clock_hand;		/* next replacement candidate */
+	RelSizeCacheEntry entries[RELSIZE_CACHE_WAYS];
+} RelSizeCachePartition;
+
+/* GUC variable */
+int			shared_relation_size_cache = 0;
+
+static RelSizeCachePartition *RelSizeCache = NULL;
+static int	RelSizeCacheNumPartitions = 0;
+
 /* local function prototypes */
 static void smgrshutdown(int code, Datum arg);
+static RelSizeCachePartition *RelSizeCacheGetPartition(RelFileNode rnode);
+static BlockNumber RelSizeCacheLookup(SMgrRelation reln, ForkNumber forknum,
+									  uint32 *changecount);
+static void RelSizeCacheInsert(SMgrRelation reln, ForkNumber forknum,
+							   BlockNumber nblocks, uint32 changecount);
+static void RelSizeCacheExtend(SMgrRelation reln, ForkNumber forknum,
+							   BlockNumber nblocks);
+static void RelSizeCacheForget(RelFileNodeBackend rnode, ForkNumber forknum);
+
+/* Is the shared size cache usable for this relation? */
+#define RelSizeCacheUsable(reln) \
+	(RelSizeCache != NULL && !RelFileNodeBackendIsTemp((reln)->smgr_rnode))
+
+
+/*
+ * RelSizeCacheShmemSize --- report amount of shared memory space needed
+ */
+Size
+RelSizeCacheShmemSize(void)
+{
+	int			npartitions;
+
+	if (shared_relation_size_cache <= 0)
+		return 0;
+
+	npartitions = (shared_relation_size_cache + RELSIZE_CACHE_WAYS - 1) /
+		RELSIZE_CACHE_WAYS;
+	return mul_size(npartitions, sizeof(RelSizeCachePartition));
+}
+
+/*
+ * RelSizeCacheShmemInit --- initialize the shared relation size cache
+ */
+void
+RelSizeCacheShmemInit(void)
+{
+	bool		found;
+
+	if (shared_relation_size_cache <= 0)
+		return;
+
+	RelSizeCacheNumPartitions =
+		(shared_relation_size_cache + RELSIZE_CACHE_WAYS - 1) /
+		RELSIZE_CACHE_WAYS;
+	RelSizeCache = (RelSizeCachePartition *)
+		ShmemInitStruct("Relation Size Cache", RelSizeCacheShmemSize(),
+						&found);
+
+	if (!found)
+	{
+		for (int i = 0; i < RelSizeCacheNumPartitions; i++)
+		{
+			RelSizeCachePartition *part = &RelSizeCache[i];
+
+			SpinLockInit(&part->mutex);
+			part->changecount = 0;
+			part->clock_hand = 0;
+			for (int j = 0; j < RELSIZE_CACHE_WAYS; j++)
+				part->entries[j].nblocks = InvalidBlockNumber;
+		}
+	}
+}
+
+static RelSizeCachePartition *
+RelSizeCacheGetPartition(RelFileNode rnode)
+{
+	uint32		hash;
+
+	hash = hash_bytes((const unsigned char *) &rnode, sizeof(RelFileNode));
+	return &RelSizeCache[hash % RelSizeCacheNumPartitions];
+}
+
+/*
+ * Look up the size of a relation fork in the shared cache.  If it's not
+ * there, returns InvalidBlockNumber and the partition's change counter,
+ * which the caller must pass to RelSizeCacheInsert().
+ */
+static BlockNumber
+RelSizeCacheLookup(SMgrRelation reln, ForkNumber forknum, uint32 *changecount)
+{
+	RelSizeCachePartition *part;
+	BlockNumber result = InvalidBlockNumber;
+
+	part = RelSizeCacheGetPartition(reln->smgr_rnode.node);
+	SpinLockAcquire(&part->mutex);
+	for (int i = 0; i < RELSIZE_CACHE_WAYS; i++)
+	{
+		RelSizeCacheEntry *entry = &part->entries[i];
+
+		if (entry->nblocks != InvalidBlockNumber &&
+			entry->forknum == forknum &&
+			RelFileNodeEquals(entry->rnode, reln->smgr_rnode.node))
+		{
+			entry->recently_used = true;
+			result = entry->nblocks;
+			break;
+		}
+	}
+	*changecount = part->changecount;
+	SpinLockRelease(&part->mutex);
+
+	return result;
+}
+
+/*
+ * Add a size that we got from the kernel to the shared cache, unless some
+ * size in the partition changed since RelSizeCacheLookup() returned
+ * 'changecount'.  If the partition is full, an entry that hasn't been used
+ * recently is replaced.
+ */
+static void
+RelSizeCacheInsert(SMgrRelation reln, ForkNumber forknum,
+				   BlockNumber nblocks, uint32 changecount)
+{
+	RelSizeCachePartition *part;
+	RelSizeCacheEntry *victim = NULL;
+
+	part = RelSizeCacheGetPartition(reln->smgr_rnode.node);
+	SpinLockAcquire(&part->mutex);
+	if (part->changecount != changecount)
+	{
+		SpinLockRelease(&part->mutex);
+		return;
+	}
+
+	for (int i = 0; i < RELSIZE_CACHE_WAYS; i++)
+	{
+		RelSizeCacheEntry *entry = &part->entries[i];
+
+		if (entry->nblocks == InvalidBlockNumber)
+		{
+			if (victim == NULL)
+				victim = entry;
+		}
+		else if (entry->forknum == forknum &&
+				 RelFileNodeEquals(entry->rnode, reln->smgr_rnode.node))
+		{
+			/* someone else beat us to it */
+			SpinLockRelease(&part->mutex);
+			return;
+		}
+	}
+
+	/* No free slot, so run the clock to find one not recently used */
+	while (victim == NULL)
+	{
+		RelSizeCacheEntry *entry = &part->entries[part->clock_hand];
+
+		part->clock_hand = (part->clock_hand + 1) % RELSIZE_CACHE_WAYS;
+		if (entry->recently_used)
+			entry->recently_used = false;
+		else
+			victim = entry;
+	}
+
+	victim->rnode = reln->smgr_rnode.node;
+	victim->forknum = forknum;
+	victim->nblocks = nblocks;
+	victim->recently_used = true;
+	SpinLockRelease(&part->mutex);
+}
+
+/*
+ * A relation fork has been extended to at least 'nblocks' blocks.
+ */
+static void
+RelSizeCacheExtend(SMgrRelation reln, ForkNumber forknum, BlockNumber nblocks)
+{
+	RelSizeCachePartition *part;
+
+	part = RelSizeCacheGetPartition(reln->smgr_rnode.node);
+	SpinLockAcquire(&part->mutex);
+	part->changecount++;
+	for (int i = 0; i < RELSIZE_CACHE_WAYS; i++)
+	{
+		RelSizeCacheEntry *entry = &part->entries[i];
+
+		if (entry->nblocks != InvalidBlockNumber &&
+			entry->forknum == forknum &&
+			RelFileNodeEquals(entry->rnode, reln->smgr_rnode.node))
+		{
+			/* concurrent extensions might report out of order */
+			if (entry->nblocks < nblocks)
+				entry->nblocks = nblocks;
+			break;
+		}
+	}
+	SpinLockRelease(&part->mutex);
+}
+
+/*
+ * Remove a relation fork, or all forks if forknum is InvalidForkNumber,
+ * from the shared cache.
+ */
+static void
+RelSizeCacheForget(RelFileNodeBackend rnode, ForkNumber forknum)
+{
+	RelSizeCachePartition *part;
+
+	if (RelSizeCache == NULL || RelFileNodeBackendIsTemp(rnode))
+		return;
+
+	part = RelSizeCacheGetPartition(rnode.node);
+	SpinLockAcquire(&part->mutex);
+	part->changecount++;
+	for (int i = 0; i < RELSIZE_CACHE_WAYS; i++)
+	{
+		RelSizeCacheEntry *entry = &part->entries[i];
+
+		if (entry->nblocks != InvalidBlockNumber &&
+			(forknum == InvalidForkNumber || entry->forknum == forknum) &&
+			RelFileNodeEquals(entry->rnode, rnode.node))
+			entry->nblocks = InvalidBlockNumber;
+	}
+	SpinLockRelease(&part->mutex);
+}
+
+/*
+ * RelSizeCacheDropDatabase --- forget the sizes of all relations in the
+ * given database
+ *
+ * This is needed when a database's files are removed or moved without going
+ * through smgr, so that the relfilenodes can't be mistaken for new ones later.
+ */
+void
+RelSizeCacheDropDatabase(Oid dbid)
+{
+	if (RelSizeCache == NULL)
+		return;
+
+	for (int i = 0; i < RelSizeCacheNumPartitions; i++)
+	{
+		RelSizeCachePartition *part = &RelSizeCache[i];
+
+		SpinLockAcquire(&part->mutex);
+		part->changecount++;
+		for (int j = 0; j < RELSIZE_CACHE_WAYS; j++)
+		{
+			RelSizeCacheEntry *entry = &part->entries[j];
+
+			if (entry->nblocks != InvalidBlockNumber &&
+				entry->rnode.dbNode == dbid)
+				entry->nblocks = InvalidBlockNumber;
+		}
+		SpinLockRelease(&part->mutex);
+	}
+}
 
 
 /*
@@ -334,6 +651,9 @@ void
 smgrcreate(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 {
 	smgrsw[reln->smgr_which].smgr_create(reln, forknum, isRedo);
+
+	/* a reused relfilenode mustn't inherit an old size */
+	RelSizeCacheForget(reln->smgr_rnode, forknum);
 }
 
 /*
@@ -412,7 +732,7 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 	 * Get rid of any remaining buffers for the relations.  bufmgr will just
 	 * drop them without bothering to write the contents.
 	 */
-	DropRelFileNodesAllBuffers(rnodes, nrels);
+	DropRelFileNodesAllBuffers(rels, nrels);
 
 	/*
 	 * It'd be nice to tell the stats collector to forget them immediately,
@@ -444,6 +764,8 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 
 		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
 			smgrsw[which].smgr_unlink(rnodes[i], forknum, isRedo);
+
+		RelSizeCacheForget(rnodes[i], InvalidForkNumber);
 	}
 
 	pfree(rnodes);
@@ -475,6 +797,38 @@ smgrextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		reln->smgr_cached_nblocks[forknum] = blocknum + 1;
 	else
 		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+
+	if (RelSizeCacheUsable(reln))
+		RelSizeCacheExtend(reln, forknum, blocknum + 1);
+}
+
+/*
+ *	smgrzeroextend() -- Add nblocks zeroed blocks to a file.
+ *
+ *		Similar to smgrextend(), except the relation is extended by a run of
+ *		blocks that read back as all zeroes, without the caller having to
+ *		supply them.  This lets the storage manager allocate the space more
+ *		efficiently than one block at a time.
+ */
+void
+smgrzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			   BlockNumber nblocks, bool skipFsync)
+{
+	smgrsw[reln->smgr_which].smgr_zeroextend(reln, forknum, blocknum,
+											 nblocks, skipFsync);
+
+	/*
+	 * Normally we expect this to increase the fork size by nblocks, but if
+	 * the cached value isn't as expected, just invalidate it so the next call
+	 * asks the kernel.
+	 */
+	if (reln->smgr_cached_nblocks[forknum] == blocknum)
+		reln->smgr_cached_nblocks[forknum] = blocknum + nblocks;
+	else
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+
+	if (RelSizeCacheUsable(reln))
+		RelSizeCacheExtend(reln, forknum, blocknum + nblocks);
 }
 
 /*
@@ -505,6 +859,49 @@ smgrread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	smgrsw[reln->smgr_which].smgr_read(reln, forknum, blocknum, buffer);
 }
 
+/*
+ *	smgrreadv() -- read a run of consecutive blocks from a relation into
+ *				   the supplied buffers.
+ *
+ *		Like smgrread(), but lets the storage manager combine the reads into
+ *		fewer, larger I/O requests.
+ */
+void
+smgrreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		  char **buffers, BlockNumber nblocks)
+{
+	smgrsw[reln->smgr_which].smgr_readv(reln, forknum, blocknum, buffers,
+										nblocks);
+}
+
+/*
+ *	smgrstartread() -- begin reading a block into the supplied buffer.
+ *
+ *		The read may proceed asynchronously, depending on io_method.  The
+ *		caller must not look at the buffer, or let it go away, until it has
+ *		passed the returned handle to smgrwaitread() for the same block and
+ *		buffer.  Errors are reported by smgrwaitread().  A backend can have
+ *		at most MAX_FILE_READS_IN_FLIGHT reads outstanding.
+ */
+int
+smgrstartread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			  char *buffer)
+{
+	return smgrsw[reln->smgr_which].smgr_startread(reln, forknum, blocknum,
+												   buffer);
+}
+
+/*
+ *	smgrwaitread() -- finish a read started by smgrstartread().
+ */
+void
+smgrwaitread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			 char *buffer, int handle)
+{
+	smgrsw[reln->smgr_which].smgr_waitread(reln, forknum, blocknum, buffer,
+										   handle);
+}
+
 /*
  *	smgrwrite() -- Write the supplied buffer out.
  *
@@ -528,6 +925,20 @@ smgrwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 										buffer, skipFsync);
 }
 
+/*
+ *	smgrwritev() -- Write out a run of consecutive blocks.
+ *
+ *		Like calling smgrwrite() for each block in turn, but the blocks are
+ *		written with as few I/Os, and fsync requests, as possible.
+ */
+void
+smgrwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		   char **buffers, BlockNumber nblocks, bool skipFsync)
+{
+	smgrsw[reln->smgr_which].smgr_writev(reln, forknum, blocknum,
+										 buffers, nblocks, skipFsync);
+}
+
 
 /*
  *	smgrwriteback() -- Trigger kernel writeback for the supplied range of
@@ -549,7 +960,44 @@ BlockNumber
 smgrnblocks(SMgrRelation reln, ForkNumber forknum)
 {
 	BlockNumber result;
+	uint32		changecount = 0;
+
+	/* Check and return if we get the cached value for the number of blocks. */
+	result = smgrnblocks_cached(reln, forknum);
+	if (result != InvalidBlockNumber)
+		return result;
+
+	/* Try the shared cache next */
+	if (RelSizeCacheUsable(reln))
+	{
+		result = RelSizeCacheLookup(reln, forknum, &changecount);
+		if (result != InvalidBlockNumber)
+		{
+			reln->smgr_cached_nblocks[forknum] = result;
+			return result;
+		}
+	}
+
+	result = smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+
+	reln->smgr_cached_nblocks[forknum] = result;
+
+	if (RelSizeCacheUsable(reln))
+		RelSizeCacheInsert(reln, forknum, result, changecount);
+
+	return result;
+}
 
+/*
+ *	smgrnblocks_cached() -- Get the cached number of blocks in the supplied
+ *							relation.
+ *
+ * Returns an InvalidBlockNumber when not in recovery and when the relation
+ * fork size is not cached.
+ */
+BlockNumber
+smgrnblocks_cached(SMgrRelation reln, ForkNumber forknum)
+{
 	/*
 	 * For now, we only use cached values in recovery due to lack of a shared
 	 * invalidation mechanism for changes in file size.
@@ -557,11 +1005,7 @@ smgrnblocks(SMgrRelation reln, ForkNumber forknum)
 	if (InRecovery && reln->smgr_cached_nblocks[forknum] != InvalidBlockNumber)
 		return reln->smgr_cached_nblocks[forknum];
 
-	result = smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
-
-	reln->smgr_cached_nblocks[forknum] = result;
-
-	return result;
+	return InvalidBlockNumber;
 }
 
 /*
@@ -583,7 +1027,7 @@ smgrtruncate(SMgrRelation reln, ForkNumber *forknum, int nforks, BlockNumber *nb
 	 * Get rid of any buffers for the about-to-be-deleted blocks. bufmgr will
 	 * just drop them without bothering to write the contents.
 	 */
-	DropRelFileNodeBuffers(reln->smgr_rnode, forknum, nforks, nblocks);
+	DropRelFileNodeBuffers(reln, forknum, nforks, nblocks);
 
 	/*
 	 * Send a shared-inval message to force other backends to close any smgr
@@ -602,9 +1046,13 @@ smgrtruncate(SMgrRelation reln, ForkNumber *forknum, int nforks, BlockNumber *nb
 	{
 		/* Make the cached size is invalid if we encounter an error. */
 		reln->smgr_cached_nblocks[forknum[i]] = InvalidBlockNumber;
+		RelSizeCacheForget(reln->smgr_rnode, forknum[i]);
 
 		smgrsw[reln->smgr_which].smgr_truncate(reln, forknum[i], nblocks[i]);
 
+		/* Also stop backends that looked at the old size from caching it */
+		RelSizeCacheForget(reln->smgr_rnode, forknum[i]);
+
 		/*
 		 * We might as well update the local smgr_cached_nblocks values. The
 		 * smgr cache inval message that this function sent will cause other
@@ -0,0 +1,689 @@
+/*-------------------------------------------------------------------------
+ *
+ * autoprepare.c
+ *	  Automatic preparation of repeated simple-protocol queries
+ *
+ * Many clients send the same statement over and over through the simple
+ * query protocol, with only the literal values changing, so every execution
+ * pays for parse analysis and planning again.  When autoprepare_threshold is
+ * set, exec_simple_query() asks us first.  We replace the literals of the
+ * statement by parameter symbols and look the resulting text up in a
+ * per-backend cache.  Once a statement has been seen often enough, it is
+ * prepared as if by a Parse message, and from then on executed from its
+ * CachedPlanSource with the literals supplied as parameter values.  The
+ * plan cache takes care of invalidation and of choosing between custom and
+ * generic plans, exactly as for explicitly prepared statements.
+ *
+ * Only SELECT, INSERT, UPDATE and DELETE are considered.  Literals whose
+ * replacement would change the meaning of the statement are left alone:
+ * positional references in ORDER BY, GROUP BY and DISTINCT ON, type
+ * modifiers, and the "type 'string'" form of casts.  If the parameterized
+ * statement still can't be prepared, for instance because a parameter's
+ * type can't be determined, the statement is remembered as unsuitable and
+ * always executed the ordinary way.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/tcop/autoprepare.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/xact.h"
+#include "catalog/pg_type.h"
+#include "common/hashfn.h"
+#include "lib/ilist.h"
+#include "nodes/nodeFuncs.h"
+#include "parser/analyze.h"
+#include "parser/parser.h"
+#include "parser/scanner.h"
+#include "parser/gram.h"			/* must be after parser/scanner.h */
+#include "rewrite/rewriteHandler.h"
+#include "tcop/autoprepare.h"
+#include "tcop/utility.h"
+#include "utils/hsearch.h"
+#include "utils/int8.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+
+
+/* GUC parameters */
+int			autoprepare_threshold = 0;
+int			autoprepare_limit = 100;
+
+/* A literal found in the statement */
+typedef struct AutoPrepareLiteral
+{
+	A_Const    *con;			/* the literal's node */
+	int			location;		/* its offset in the statement text */
+	int			length;			/* its length, or -1 to leave it alone */
+} AutoPrepareLiteral;
+
+typedef struct AutoPrepareWalkerContext
+{
+	AutoPrepareLiteral *literals;
+	int			nliterals;
+	int			maxliterals;
+	bool		has_params;		/* statement already contains $n */
+} AutoPrepareWalkerContext;
+
+/*
+ * Cache entry.  The kinds string has one character per parameter, telling
+ * what type of literal it replaces, since 'x = 1' and 'x = ''1''' must not
+ * share a prepared statement.
+ */
+typedef struct AutoPrepareEntry
+{
+	uint64		hash;			/* hash key; must be first */
+	char	   *query;			/* parameterized statement text */
+	char	   *kinds;			/* literal kind of each parameter */
+	int64		calls;			/* times the statement was seen */
+	bool		failed;			/* statement can't be prepared */
+	CachedPlanSource *psrc;		/* prepared statement, or NULL */
+	FmgrInfo   *infuncs;		/* input functions of the parameter types */
+	Oid		   *typioparams;	/* and their type I/O parameters */
+	dlist_node	lru_node;		/* position in AutoPrepareLRU */
+} AutoPrepareEntry;
+
+/* Literal kinds */
+#define AUTOPREPARE_INT4		'i'
+#define AUTOPREPARE_INT8		'l'
+#define AUTOPREPARE_NUMERIC		'n'
+#define AUTOPREPARE_UNKNOWN		's'
+
+static HTAB *AutoPrepareHash = NULL;
+static dlist_head AutoPrepareLRU = DLIST_STATIC_INIT(AutoPrepareLRU);
+static MemoryContext AutoPrepareContext = NULL;
+
+static bool autoprepare_literal_walker(Node *node,
+									   AutoPrepareWalkerContext *context);
+static int	autoprepare_literal_cmp(const void *a, const void *b);
+static void autoprepare_literal_lengths(AutoPrepareLiteral *literals,
+										int nliterals, const char *query);
+static char autoprepare_literal_kind(A_Const *con);
+static CachedPlanSource *autoprepare_prepare(const char *query,
+											 const char *kinds);
+static CachedPlanSource *autoprepare_build(const char *query,
+										   const char *kinds);
+static void autoprepare_remove(AutoPrepareEntry *entry);
+
+
+/*
+ * AutoPrepareLookup
+ *		Find or make a prepared statement for a simple-protocol statement
+ *
+ * Returns the CachedPlanSource to execute the statement with, and sets
+ * *params to the parameter values taken from the statement's literals.
+ * Returns NULL if the statement is to be executed the ordinary way.
+ *
+ * The caller must be in a transaction, not in aborted state, and have an
+ * active snapshot if parse analysis needs one.
+ */
+CachedPlanSource *
+AutoPrepareLookup(RawStmt *parsetree, const char *query_string,
+				  ParamListInfo *params)
+{
+	Node	   *stmt = parsetree->stmt;
+	AutoPrepareWalkerContext context;
+	AutoPrepareEntry *entry;
+	A_Const   **values;
+	StringInfoData query;
+	char	   *text;
+	char	   *kinds;
+	int			textlen;
+	int			last;
+	int			nparams;
+	uint64		hash;
+	bool		found;
+	int			i;
+
+	*params = NULL;
+
+	if (autoprepare_threshold <= 0)
+		return NULL;
+
+	if (!IsA(stmt, SelectStmt) &&
+		!IsA(stmt, InsertStmt) &&
+		!IsA(stmt, UpdateStmt) &&
+		!IsA(stmt, DeleteStmt))
+		return NULL;
+
+	/* SELECT INTO is really a utility statement */
+	if (IsA(stmt, SelectStmt) && ((SelectStmt *) stmt)->intoClause != NULL)
+		return NULL;
+
+	/* Collect the literals */
+	context.nliterals = 0;
+	context.maxliterals = 16;
+	context.literals = (AutoPrepareLiteral *)
+		palloc(context.maxliterals * sizeof(AutoPrepareLiteral));
+	context.has_params = false;
+	(void) autoprepare_literal_walker(stmt, &context);
+	if (context.has_params)
+		return NULL;
+
+	/* Get this statement's part of the query string */
+	textlen = parsetree->stmt_len;
+	if (textlen == 0)
+		textlen = strlen(query_string + parsetree->stmt_location);
+	text = pnstrdup(query_string + parsetree->stmt_location, textlen);
+
+	for (i = 0; i < context.nliterals; i++)
+		context.literals[i].location -= parsetree->stmt_location;
+	if (context.nliterals > 1)
+		qsort(context.literals, context.nliterals,
+			  sizeof(AutoPrepareLiteral), autoprepare_literal_cmp);
+	autoprepare_literal_lengths(context.literals, context.nliterals, text);
+
+	/* Build the parameterized text */
+	initStringInfo(&query);
+	kinds = palloc(context.nliterals + 1);
+	values = palloc(context.nliterals * sizeof(A_Const *));
+	last = 0;
+	nparams = 0;
+	for (i = 0; i < context.nliterals; i++)
+	{
+		AutoPrepareLiteral *lit = &context.literals[i];
+
+		if (lit->length < 0 || lit->location < last ||
+			lit->location + lit->length > textlen)
+			continue;
+		appendBinaryStringInfo(&query, text + last, lit->location - last);
+		appendStringInfo(&query, "$%d", nparams + 1);
+		kinds[nparams] = autoprepare_literal_kind(lit->con);
+		values[nparams] = lit->con;
+		nparams++;
+		last = lit->location + lit->length;
+	}
+	appendBinaryStringInfo(&query, text + last, textlen - last);
+	kinds[nparams] = '\0';
+
+	hash = hash_combine64(hash_bytes_extended((const unsigned char *) query.data,
+											  query.len, 0),
+						  hash_bytes_extended((const unsigned char *) kinds,
+											  nparams, 0));
+
+	/* Set up the cache on first use */
+	if (AutoPrepareHash == NULL)
+	{
+		HASHCTL		ctl;
+
+		AutoPrepareContext = AllocSetContextCreate(CacheMemoryContext,
+												   "autoprepare",
+												   ALLOCSET_DEFAULT_SIZES);
+		ctl.keysize = sizeof(uint64);
+		ctl.entrysize = sizeof(AutoPrepareEntry);
+		ctl.hcxt = AutoPrepareContext;
+		AutoPrepareHash = hash_create("autoprepare", 256, &ctl,
+									  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	entry = (AutoPrepareEntry *) hash_search(AutoPrepareHash, &hash,
+											 HASH_FIND, NULL);
+
+	/* On a hash collision, the newcomer takes over */
+	if (entry != NULL &&
+		(strcmp(entry->query, query.data) != 0 ||
+		 strcmp(entry->kinds, kinds) != 0))
+	{
+		autoprepare_remove(entry);
+		entry = NULL;
+	}
+
+	if (entry == NULL)
+	{
+		while (hash_get_num_entries(AutoPrepareHash) >= autoprepare_limit &&
+			   !dlist_is_empty(&AutoPrepareLRU))
+			autoprepare_remove(dlist_tail_element(AutoPrepareEntry, lru_node,
+												  &AutoPrepareLRU));
+
+		entry = (AutoPrepareEntry *) hash_search(AutoPrepareHash, &hash,
+												 HASH_ENTER, &found);
+		Assert(!found);
+		entry->query = MemoryContextStrdup(AutoPrepareContext, query.data);
+		entry->kinds = MemoryContextStrdup(AutoPrepareContext, kinds);
+		entry->calls = 0;
+		entry->failed = false;
+		entry->psrc = NULL;
+		entry->infuncs = NULL;
+		entry->typioparams = NULL;
+		dlist_push_head(&AutoPrepareLRU, &entry->lru_node);
+	}
+	else
+		dlist_move_head(&AutoPrepareLRU, &entry->lru_node);
+
+	entry->calls++;
+	if (entry->failed)
+		return NULL;
+
+	/*
+	 * If the prepared statement has been invalidated, prepare it afresh
+	 * rather than letting the plan cache re-analyze it with the parameter
+	 * types it was given before: a string literal that became, say, an int4
+	 * parameter might not fit what the statement refers to now.
+	 */
+	if (entry->psrc != NULL && !entry->psrc->is_valid)
+	{
+		DropCachedPlan(entry->psrc);
+		entry->psrc = NULL;
+		pfree(entry->infuncs);
+		pfree(entry->typioparams);
+		entry->infuncs = NULL;
+		entry->typioparams = NULL;
+	}
+
+	if (entry->psrc == NULL)
+	{
+		CachedPlanSource *psrc;
+
+		if (entry->calls < autoprepare_threshold)
+			return NULL;
+
+		psrc = autoprepare_prepare(query.data, kinds);
+		if (psrc == NULL)
+		{
+			entry->failed = true;
+			return NULL;
+		}
+
+		SaveCachedPlan(psrc);
+		entry->psrc = psrc;
+		entry->infuncs = (FmgrInfo *)
+			MemoryContextAlloc(AutoPrepareContext,
+							   (nparams + 1) * sizeof(FmgrInfo));
+		entry->typioparams = (Oid *)
+			MemoryContextAlloc(AutoPrepareContext,
+							   (nparams + 1) * sizeof(Oid));
+		for (i = 0; i < nparams; i++)
+		{
+			Oid			typinput;
+
+			getTypeInputInfo(psrc->param_types[i], &typinput,
+							 &entry->typioparams[i]);
+			fmgr_info_cxt(typinput, &entry->infuncs[i], AutoPrepareContext);
+		}
+	}
+
+	/* Convert the literals to parameter values */
+	if (nparams > 0)
+	{
+		*params = makeParamList(nparams);
+		for (i = 0; i < nparams; i++)
+		{
+			ParamExternData *prm = &(*params)->params[i];
+			A_Const    *con = values[i];
+
+			if (IsA(&con->val, Integer))
+			{
+				Assert(entry->psrc->param_types[i] == INT4OID);
+				prm->value = Int32GetDatum(intVal(&con->val));
+			}
+			else
+				prm->value = InputFunctionCall(&entry->infuncs[i],
+											   strVal(&con->val),
+											   entry->typioparams[i],
+											   -1);
+			prm->isnull = false;
+			prm->pflags = PARAM_FLAG_CONST;
+			prm->ptype = entry->psrc->param_types[i];
+		}
+	}
+
+	return entry->psrc;
+}
+
+/*
+ * AutoPrepareReset
+ *		Forget all automatically prepared statements (for DISCARD ALL)
+ */
+void
+AutoPrepareReset(void)
+{
+	while (!dlist_is_empty(&AutoPrepareLRU))
+		autoprepare_remove(dlist_head_element(AutoPrepareEntry, lru_node,
+											  &AutoPrepareLRU));
+}
+
+/*
+ * Collect the literals that may be replaced by parameters.
+ */
+static bool
+autoprepare_literal_walker(Node *node, AutoPrepareWalkerContext *context)
+{
+	if (node == NULL)
+		return false;
+
+	switch (nodeTag(node))
+	{
+		case T_A_Const:
+			{
+				A_Const    *con = (A_Const *) node;
+
+				if (!IsA(&con->val, Integer) &&
+					!IsA(&con->val, Float) &&
+					!IsA(&con->val, String))
+					return false;
+				if (con->location < 0)
+					return false;
+
+				if (context->nliterals >= context->maxliterals)
+				{
+					context->maxliterals *= 2;
+					context->literals = (AutoPrepareLiteral *)
+						repalloc(context->literals,
+								 context->maxliterals * sizeof(AutoPrepareLiteral));
+				}
+				context->literals[context->nliterals].con = con;
+				context->literals[context->nliterals].location = con->location;
+				context->literals[context->nliterals].length = -1;
+				context->nliterals++;
+				return false;
+			}
+
+		case T_ParamRef:
+			context->has_params = true;
+			return true;
+
+		case T_TypeName:
+			/* type modifiers must stay constants */
+			return false;
+
+		case T_SortBy:
+			/* "ORDER BY 1" refers to an output column */
+			return false;
+
+		case T_TypeCast:
+			{
+				TypeCast   *tc = (TypeCast *) node;
+
+				/*
+				 * The grammar marks "type 'string'" casts, as well as TRUE and
+				 * FALSE, with an unknown location.  These only accept a
+				 * literal, and TRUE must not turn into an untyped parameter.
+				 */
+				if (tc->location < 0 && IsA(tc->arg, A_Const))
+					return false;
+				break;
+			}
+
+		case T_SelectStmt:
+			{
+				/*
+				 * Integer constants in GROUP BY and DISTINCT ON are output
+				 * column references too.  Walk a copy without them.
+				 */
+				SelectStmt	stmt = *(SelectStmt *) node;
+
+				stmt.groupClause = NIL;
+				stmt.distinctClause = NIL;
+				return raw_expression_tree_walker((Node *) &stmt,
+												  autoprepare_literal_walker,
+												  (void *) context);
+			}
+
+		default:
+			break;
+	}
+
+	return raw_expression_tree_walker(node, autoprepare_literal_walker,
+									  (void *) context);
+}
+
+static int
+autoprepare_literal_cmp(const void *a, const void *b)
+{
+	int			l1 = ((const AutoPrepareLiteral *) a)->location;
+	int			l2 = ((const AutoPrepareLiteral *) b)->location;
+
+	if (l1 < l2)
+		return -1;
+	else if (l1 > l2)
+		return +1;
+	else
+		return 0;
+}
+
+/*
+ * Find the length of each literal in the query text, which must be sorted by
+ * location.  As in pg_stat_statements, we rescan the text for this, relying
+ * on flex having placed a zero byte after the current token in scanbuf.
+ * Literals that aren't written as a numeric or string constant token, such
+ * as the field name of EXTRACT, keep length -1 and are not replaced.
+ */
+static void
+autoprepare_literal_lengths(AutoPrepareLiteral *literals, int nliterals,
+							const char *query)
+{
+	core_yyscan_t yyscanner;
+	core_yy_extra_type yyextra;
+	core_YYSTYPE yylval;
+	YYLTYPE		yylloc = -1;
+	int			tok = -1;
+	int			i;
+
+	if (nliterals == 0)
+		return;
+
+	yyscanner = scanner_init(query,
+							 &yyextra,
+							 &ScanKeywords,
+							 ScanKeywordTokens);
+
+	/* we don't want to re-emit any escape string warnings */
+	yyextra.escape_string_warning = false;
+
+	for (i = 0; i < nliterals; i++)
+	{
+		int			loc = literals[i].location;
+		bool		negative = false;
+
+		if (i > 0 && loc == literals[i - 1].location)
+			continue;			/* same node reached twice */
+
+		/* Lex tokens until we reach the literal */
+		while (yylloc < loc)
+		{
+			tok = core_yylex(&yylval, &yylloc, yyscanner);
+			if (tok == 0)
+				break;
+		}
+		if (tok == 0)
+			break;
+		if (yylloc != loc)
+			continue;			/* not at a token start */
+
+		/* A negative number's location is that of its minus sign */
+		if (tok == '-')
+		{
+			negative = true;
+			tok = core_yylex(&yylval, &yylloc, yyscanner);
+			if (tok == 0)
+				break;
+		}
+
+		if (tok == ICONST || tok == FCONST ||
+			(tok == SCONST && !negative))
+			literals[i].length = strlen(yyextra.scanbuf + loc);
+	}
+
+	scanner_finish(yyscanner);
+}
+
+/*
+ * Work out the kind of a literal, the same way make_const() picks its type.
+ */
+static char
+autoprepare_literal_kind(A_Const *con)
+{
+	int64		val64;
+
+	switch (nodeTag(&con->val))
+	{
+		case T_Integer:
+			return AUTOPREPARE_INT4;
+
+		case T_Float:
+			if (scanint8(strVal(&con->val), true, &val64))
+			{
+				if (val64 == (int64) (int32) val64)
+					return AUTOPREPARE_INT4;
+				return AUTOPREPARE_INT8;
+			}
+			return AUTOPREPARE_NUMERIC;
+
+		default:
+			return AUTOPREPARE_UNKNOWN;
+	}
+}
+
+/*
+ * Prepare the parameterized statement.  This happens in a subtransaction,
+ * so that a statement that can't be prepared is simply executed the
+ * ordinary way.  Returns NULL in that case.
+ */
+static CachedPlanSource *
+autoprepare_prepare(const char *query, const char *kinds)
+{
+	CachedPlanSource *psrc;
+	MemoryContext oldcontext = CurrentMemoryContext;
+	ResourceOwner oldowner = CurrentResourceOwner;
+
+	BeginInternalSubTransaction(NULL);
+	MemoryContextSwitchTo(oldcontext);
+
+	PG_TRY();
+	{
+		psrc = autoprepare_build(query, kinds);
+
+		ReleaseCurrentSubTransaction();
+		MemoryContextSwitchTo(oldcontext);
+		CurrentResourceOwner = oldowner;
+	}
+	PG_CATCH();
+	{
+		ErrorData  *edata;
+
+		MemoryContextSwitchTo(oldcontext);
+		edata = CopyErrorData();
+		FlushErrorState();
+
+		RollbackAndReleaseCurrentSubTransaction();
+		MemoryContextSwitchTo(oldcontext);
+		CurrentResourceOwner = oldowner;
+
+		/* A query cancel must not be swallowed */
+		if (edata->sqlerrcode == ERRCODE_QUERY_CANCELED)
+			ReThrowError(edata);
+
+		elog(DEBUG1, "could not prepare query automatically: %s",
+			 edata->message);
+		FreeErrorData(edata);
+		psrc = NULL;
+	}
+	PG_END_TRY();
+
+	return psrc;
+}
+
+/*
+ * Subroutine of autoprepare_prepare: do the work, much like
+ * exec_parse_message() does for a Parse message.
+ */
+static CachedPlanSource *
+autoprepare_build(const char *query, const char *kinds)
+{
+	List	   *parsetree_list;
+	RawStmt    *raw_parse_tree;
+	CachedPlanSource *psrc;
+	Query	   *querytree;
+	List	   *querytree_list;
+	Oid		   *paramTypes;
+	int			nparams = strlen(kinds);
+	int			numParams = nparams;
+	int			i;
+
+	parsetree_list = raw_parser(query);
+	if (list_length(parsetree_list) != 1)
+		elog(ERROR, "parameterized query is not a single statement");
+	raw_parse_tree = linitial_node(RawStmt, parsetree_list);
+
+	psrc = CreateCachedPlan(raw_parse_tree, query,
+							CreateCommandTag(raw_parse_tree->stmt));
+
+	paramTypes = (Oid *) palloc((nparams + 1) * sizeof(Oid));
+	for (i = 0; i < nparams; i++)
+	{
+		switch (kinds[i])
+		{
+			case AUTOPREPARE_INT4:
+				paramTypes[i] = INT4OID;
+				break;
+			case AUTOPREPARE_INT8:
+				paramTypes[i] = INT8OID;
+				break;
+			case AUTOPREPARE_NUMERIC:
+				paramTypes[i] = NUMERICOID;
+				break;
+			default:
+				paramTypes[i] = UNKNOWNOID;
+				break;
+		}
+	}
+
+	querytree = parse_analyze_varparams(raw_parse_tree, query,
+										&paramTypes, &numParams);
+
+	if (numParams != nparams)
+		elog(ERROR, "parameterized query has %d parameters, expected %d",
+			 numParams, nparams);
+	for (i = 0; i < numParams; i++)
+	{
+		Oid			ptype = paramTypes[i];
+
+		if (ptype == InvalidOid || ptype == UNKNOWNOID)
+			ereport(ERROR,
+					(errcode(ERRCODE_INDETERMINATE_DATATYPE),
+					 errmsg("could not determine data type of parameter $%d",
+							i + 1)));
+	}
+
+	if (querytree->commandType == CMD_UTILITY)
+		elog(ERROR, "parameterized query is a utility statement");
+
+	querytree_list = QueryRewrite(querytree);
+
+	CompleteCachedPlan(psrc,
+					   querytree_list,
+					   NULL,
+					   paramTypes,
+					   numParams,
+					   NULL,
+					   NULL,
+					   CURSOR_OPT_PARALLEL_OK,	/* allow parallel mode */
+					   true);	/* fixed result */
+
+	return psrc;
+}
+
+/*
+ * Remove an entry from the cache, dropping its prepared statement.
+ */
+static void
+autoprepare_remove(AutoPrepareEntry *entry)
+{
+	dlist_delete(&entry->lru_node);
+	if (entry->psrc)
+		DropCachedPlan(entry->psrc);
+	pfree(entry->query);
+	pfree(entry->kinds);
+	if (entry->infuncs)
+		pfree(entry->infuncs);
+	if (entry->typioparams)
+		pfree(entry->typioparams);
+	(void) hash_search(AutoPrepareHash, &entry->hash, HASH_REMOVE, NULL);
+}
@@ -39,6 +39,7 @@
 #include "executor/tstoreReceiver.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
+#include "postmaster/proxy.h"
 #include "utils/portal.h"
 
 
@@ -290,6 +291,9 @@ ReadyForQuery(CommandDest dest)
 			{
 				StringInfoData buf;
 
+				/* a connection proxy must know if it can't switch backends */
+				ProxyReportSessionState();
+
 				pq_beginmessage(&buf, 'Z');
 				pq_sendbyte(&buf, TransactionBlockStatusCode());
 				pq_endmessage(&buf);
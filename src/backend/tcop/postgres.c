@@ -42,6 +42,7 @@
 #include "catalog/pg_type.h"
 #include "commands/async.h"
 #include "commands/prepare.h"
+#include "executor/instrument.h"
 #include "executor/spi.h"
 #include "jit/jit.h"
 #include "libpq/libpq.h"
@@ -60,6 +61,7 @@
 #include "postmaster/autovacuum.h"
 #include "postmaster/interrupt.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
 #include "replication/logicallauncher.h"
 #include "replication/logicalworker.h"
 #include "replication/slot.h"
@@ -70,6 +72,7 @@
 #include "storage/proc.h"
 #include "storage/procsignal.h"
 #include "storage/sinval.h"
+#include "tcop/autoprepare.h"
 #include "tcop/fastpath.h"
 #include "tcop/pquery.h"
 #include "tcop/tcopprot.h"
@@ -189,6 +192,7 @@ static bool IsTransactionExitStmtList(List *pstmts);
 static bool IsTransactionStmtList(List *pstmts);
 static void drop_unnamed_stmt(void);
 static void log_disconnections(int code, Datum arg);
+static void ConfigureProtocolCompression(void);
 static void enable_statement_timeout(void);
 static void disable_statement_timeout(void);
 
@@ -427,6 +431,15 @@ SocketBackend(StringInfo inBuf)
 			ignore_till_sync = false;
 			break;
 
+		case 'A':				/* authenticate proxy client */
+			doing_extended_query_message = false;
+			/* only a connection proxy may send this */
+			if (!MyProcPort->proxied)
+				ereport(FATAL,
+						(errcode(ERRCODE_PROTOCOL_VIOLATION),
+						 errmsg("invalid frontend message type %d", qtype)));
+			break;
+
 		case 'B':				/* bind */
 		case 'C':				/* close */
 		case 'D':				/* describe */
@@ -1072,7 +1085,10 @@ exec_simple_query(const char *query_string)
 		MemoryContext per_parsetree_context = NULL;
 		List	   *querytree_list,
 				   *plantree_list;
-		Portal		portal;
+		CachedPlanSource *psrc = NULL;
+		CachedPlan *cplan = NULL;
+		ParamListInfo params = NULL;
+		Portal		portal = NULL;
 		DestReceiver *receiver;
 		int16		format;
 
@@ -1152,11 +1168,38 @@ exec_simple_query(const char *query_string)
 		else
 			oldcontext = MemoryContextSwitchTo(MessageContext);
 
-		querytree_list = pg_analyze_and_rewrite(parsetree, query_string,
-												NULL, 0, NULL);
+		/*
+		 * Use an automatically prepared statement if there is one, see
+		 * autoprepare.c.  As in exec_bind_message, nothing that could throw
+		 * an error may come between GetCachedPlan and PortalDefineQuery, so
+		 * create the portal first.
+		 */
+		if (autoprepare_threshold > 0)
+			psrc = AutoPrepareLookup(parsetree, query_string, &params);
+
+		if (psrc != NULL)
+		{
+			portal = CreatePortal("", true, true);
+			/* Don't display the portal in pg_cursors */
+			portal->visible = false;
+
+			cplan = GetCachedPlan(psrc, params, false, NULL);
+
+			PortalDefineQuery(portal,
+							  NULL,
+							  query_string,
+							  commandTag,
+							  cplan->stmt_list,
+							  cplan);
+		}
+		else
+		{
+			querytree_list = pg_analyze_and_rewrite(parsetree, query_string,
+													NULL, 0, NULL);
 
-		plantree_list = pg_plan_queries(querytree_list, query_string,
-										CURSOR_OPT_PARALLEL_OK, NULL);
+			plantree_list = pg_plan_queries(querytree_list, query_string,
+											CURSOR_OPT_PARALLEL_OK, NULL);
+		}
 
 		/*
 		 * Done with the snapshot used for parsing/planning.
@@ -1174,30 +1217,34 @@ exec_simple_query(const char *query_string)
 		/* If we got a cancel signal in analysis or planning, quit */
 		CHECK_FOR_INTERRUPTS();
 
-		/*
-		 * Create unnamed portal to run the query or queries in. If there
-		 * already is one, silently drop it.
-		 */
-		portal = CreatePortal("", true, true);
-		/* Don't display the portal in pg_cursors */
-		portal->visible = false;
+		if (portal == NULL)
+		{
+			/*
+			 * Create unnamed portal to run the query or queries in. If there
+			 * already is one, silently drop it.
+			 */
+			portal = CreatePortal("", true, true);
+			/* Don't display the portal in pg_cursors */
+			portal->visible = false;
 
-		/*
-		 * We don't have to copy anything into the portal, because everything
-		 * we are passing here is in MessageContext or the
-		 * per_parsetree_context, and so will outlive the portal anyway.
-		 */
-		PortalDefineQuery(portal,
-						  NULL,
-						  query_string,
-						  commandTag,
-						  plantree_list,
-						  NULL);
+			/*
+			 * We don't have to copy anything into the portal, because
+			 * everything we are passing here is in MessageContext or the
+			 * per_parsetree_context, and so will outlive the portal anyway.
+			 */
+			PortalDefineQuery(portal,
+							  NULL,
+							  query_string,
+							  commandTag,
+							  plantree_list,
+							  NULL);
+		}
 
 		/*
-		 * Start the portal.  No parameters here.
+		 * Start the portal.  There are parameters only if the literals of an
+		 * automatically prepared statement became ones.
 		 */
-		PortalStart(portal, NULL, 0, InvalidSnapshot);
+		PortalStart(portal, params, 0, InvalidSnapshot);
 
 		/*
 		 * Select the appropriate output format: text unless we are doing a
@@ -3212,6 +3259,9 @@ ProcessInterrupts(void)
 	if (ProcSignalBarrierPending)
 		ProcessProcSignalBarrier();
 
+	if (LogMemoryContextPending)
+		ProcessLogMemoryContextInterrupt();
+
 	if (ParallelMessagePending)
 		HandleParallelMessages();
 }
@@ -3897,6 +3947,10 @@ PostgresMain(int argc, char *argv[],
 
 		/* Initialize MaxBackends (if under postmaster, was done already) */
 		InitializeMaxBackends();
+		InitializeFastPathLocks();
+
+		/* Set up the timing clock (if under postmaster, was done already) */
+		InstrInitClockSource();
 	}
 
 	/* Early initialization */
@@ -3933,8 +3987,11 @@ PostgresMain(int argc, char *argv[],
 	 * *MyProcPort, because ConnCreate() allocated that space with malloc()
 	 * ... else we'd need to copy the Port data first.  Also, subsidiary data
 	 * such as the username isn't lost either; see ProcessStartupPacket().
+	 *
+	 * A backend serving a connection proxy keeps it, though, since it has to
+	 * reload pg_hba.conf to authenticate each client the proxy hands it.
 	 */
-	if (PostmasterContext)
+	if (PostmasterContext && !(MyProcPort && MyProcPort->proxied))
 	{
 		MemoryContextDelete(PostmasterContext);
 		PostmasterContext = NULL;
@@ -3948,6 +4005,11 @@ PostgresMain(int argc, char *argv[],
 	 */
 	BeginReportingGUCOptions();
 
+	/* Answer the client's request for protocol compression, if any */
+	if (whereToSendOutput == DestRemote &&
+		MyProcPort->compression_methods != NULL)
+		ConfigureProtocolCompression();
+
 	/*
 	 * Also set up handler to log session end; we have to wait till now to be
 	 * sure Log_disconnections has its final value.
@@ -4496,6 +4558,11 @@ PostgresMain(int argc, char *argv[],
 				send_ready_for_query = true;
 				break;
 
+			case 'A':			/* authenticate proxy client */
+				ProxyAuthenticateClient(&input_message);
+				send_ready_for_query = true;
+				break;
+
 				/*
 				 * 'X' means that the frontend is closing down the socket. EOF
 				 * means unexpected loss of frontend connection. Either way,
@@ -4743,6 +4810,31 @@ log_disconnections(int code, Datum arg)
 					port->remote_port[0] ? " port=" : "", port->remote_port)));
 }
 
+/*
+ * Reply to the _pq_.compression startup option with a ParameterStatus
+ * message naming the method we chose, or "off", and start compressing if
+ * there is one.  Messages after that one may be compressed, in either
+ * direction.
+ */
+static void
+ConfigureProtocolCompression(void)
+{
+	PqCompressionMethod method = PQ_COMPRESSION_NONE;
+	StringInfoData buf;
+
+	if (protocol_compression)
+		method = pq_compression_choose_method(MyProcPort->compression_methods);
+
+	pq_beginmessage(&buf, 'S');
+	pq_sendstring(&buf, PQ_COMPRESSION_OPTION);
+	pq_sendstring(&buf, method == PQ_COMPRESSION_NONE ? "off" :
+				  pq_compression_method_name(method));
+	pq_endmessage(&buf);
+
+	if (method != PQ_COMPRESSION_NONE)
+		pq_enable_compression(method);
+}
+
 /*
  * Start statement timeout timer, if enabled.
  *
@@ -14,11 +14,33 @@
 
 #include "catalog/pg_type.h"
 #include "common/int.h"
+#include "libpq/pqformat.h"
+#include "port/pg_bitutils.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/datum.h"
 #include "utils/lsyscache.h"
 #include "utils/typcache.h"
 
+/*
+ * SerialIOData
+ *		Used for caching element-type data in array_agg_serialize
+ */
+typedef struct SerialIOData
+{
+	FmgrInfo	typsend;
+} SerialIOData;
+
+/*
+ * DeserialIOData
+ *		Used for caching element-type data in array_agg_deserialize
+ */
+typedef struct DeserialIOData
+{
+	FmgrInfo	typreceive;
+	Oid			typioparam;
+} DeserialIOData;
+
 
 static Datum array_position_common(FunctionCallInfo fcinfo);
 
@@ -530,6 +552,258 @@ array_agg_finalfn(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(result);
 }
 
+/*
+ * array_agg_combine
+ *		Aggregate combine function for array_agg(anynonarray)
+ */
+Datum
+array_agg_combine(PG_FUNCTION_ARGS)
+{
+	ArrayBuildState *state1;
+	ArrayBuildState *state2;
+	MemoryContext agg_context;
+	MemoryContext old_context;
+	int			i;
+
+	if (!AggCheckCallContext(fcinfo, &agg_context))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state1 = PG_ARGISNULL(0) ? NULL : (ArrayBuildState *) PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (ArrayBuildState *) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+	{
+		/* state1 is already in the agg_context, if any */
+		if (state1 == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state1);
+	}
+
+	if (state1 == NULL)
+	{
+		/* Start with an empty state in the agg_context */
+		state1 = initArrayResultWithSize(state2->element_type, agg_context,
+										 false, state2->nelems);
+	}
+	else if (state1->alen < state1->nelems + state2->nelems)
+	{
+		old_context = MemoryContextSwitchTo(state1->mcontext);
+		state1->alen = pg_nextpower2_32(state1->nelems + state2->nelems);
+		state1->dvalues = (Datum *)
+			repalloc(state1->dvalues, state1->alen * sizeof(Datum));
+		state1->dnulls = (bool *)
+			repalloc(state1->dnulls, state1->alen * sizeof(bool));
+		MemoryContextSwitchTo(old_context);
+	}
+
+	Assert(state1->element_type == state2->element_type);
+
+	/* Copy state2's elements after state1's */
+	old_context = MemoryContextSwitchTo(state1->mcontext);
+	for (i = 0; i < state2->nelems; i++)
+	{
+		int			j = state1->nelems + i;
+
+		state1->dnulls[j] = state2->dnulls[i];
+		if (state2->dnulls[i])
+			state1->dvalues[j] = (Datum) 0;
+		else
+			state1->dvalues[j] = datumCopy(state2->dvalues[i],
+										   state1->typbyval,
+										   state1->typlen);
+	}
+	state1->nelems += state2->nelems;
+	MemoryContextSwitchTo(old_context);
+
+	PG_RETURN_POINTER(state1);
+}
+
+/*
+ * array_agg_serialize
+ *		Aggregate serialization function for array_agg(anynonarray)
+ *
+ * Elements of by-reference types are sent with the element type's send
+ * function, so the planner doesn't use this for types without one; see
+ * agg_args_support_sendreceive().
+ */
+Datum
+array_agg_serialize(PG_FUNCTION_ARGS)
+{
+	ArrayBuildState *state;
+	StringInfoData buf;
+	int			i;
+
+	/* cannot be called directly because of internal-type argument */
+	Assert(AggCheckCallContext(fcinfo, NULL));
+
+	state = (ArrayBuildState *) PG_GETARG_POINTER(0);
+
+	pq_begintypsend(&buf);
+
+	pq_sendint32(&buf, state->element_type);
+	pq_sendint32(&buf, state->nelems);
+	pq_sendbytes(&buf, (char *) state->dnulls, sizeof(bool) * state->nelems);
+
+	/*
+	 * By-value elements are sent as the Datums themselves, null or not;
+	 * by-reference elements with the send function, skipping nulls.
+	 */
+	if (state->typbyval)
+		pq_sendbytes(&buf, (char *) state->dvalues,
+					 sizeof(Datum) * state->nelems);
+	else
+	{
+		SerialIOData *iodata;
+
+		/* Avoid repeat catalog lookups for typsend function */
+		iodata = (SerialIOData *) fcinfo->flinfo->fn_extra;
+		if (iodata == NULL)
+		{
+			Oid			typsend;
+			bool		typisvarlena;
+
+			iodata = (SerialIOData *)
+				MemoryContextAlloc(fcinfo->flinfo->fn_mcxt,
+								   sizeof(SerialIOData));
+			getTypeBinaryOutputInfo(state->element_type, &typsend,
+									&typisvarlena);
+			fmgr_info_cxt(typsend, &iodata->typsend,
+						  fcinfo->flinfo->fn_mcxt);
+			fcinfo->flinfo->fn_extra = (void *) iodata;
+		}
+
+		for (i = 0; i < state->nelems; i++)
+		{
+			bytea	   *outputbytes;
+
+			if (state->dnulls[i])
+				continue;
+			outputbytes = SendFunctionCall(&iodata->typsend,
+										   state->dvalues[i]);
+			pq_sendint32(&buf, VARSIZE(outputbytes) - VARHDRSZ);
+			pq_sendbytes(&buf, VARDATA(outputbytes),
+						 VARSIZE(outputbytes) - VARHDRSZ);
+			pfree(outputbytes);
+		}
+	}
+
+	PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+/*
+ * array_agg_deserialize
+ *		Aggregate deserialization function for array_agg(anynonarray)
+ */
+Datum
+array_agg_deserialize(PG_FUNCTION_ARGS)
+{
+	bytea	   *sstate;
+	ArrayBuildState *result;
+	StringInfoData buf;
+	Oid			element_type;
+	int			nelems;
+	int			i;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	sstate = PG_GETARG_BYTEA_PP(0);
+
+	/*
+	 * Copy the bytea into a StringInfo so that we can "receive" it using the
+	 * standard recv-function infrastructure.
+	 */
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf,
+						   VARDATA_ANY(sstate), VARSIZE_ANY_EXHDR(sstate));
+
+	element_type = pq_getmsgint(&buf, 4);
+	nelems = pq_getmsgint(&buf, 4);
+	if (nelems < 0 || nelems > (buf.len - buf.cursor) / sizeof(bool))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				 errmsg("insufficient data left in message")));
+
+	result = initArrayResultWithSize(element_type, CurrentMemoryContext,
+									 false, nelems);
+	result->nelems = nelems;
+	memcpy(result->dnulls, pq_getmsgbytes(&buf, sizeof(bool) * nelems),
+		   sizeof(bool) * nelems);
+
+	/* see array_agg_serialize() */
+	if (result->typbyval)
+		memcpy(result->dvalues,
+			   pq_getmsgbytes(&buf, sizeof(Datum) * nelems),
+			   sizeof(Datum) * nelems);
+	else
+	{
+		DeserialIOData *iodata;
+
+		/* Avoid repeat catalog lookups for typreceive function */
+		iodata = (DeserialIOData *) fcinfo->flinfo->fn_extra;
+		if (iodata == NULL)
+		{
+			Oid			typreceive;
+
+			iodata = (DeserialIOData *)
+				MemoryContextAlloc(fcinfo->flinfo->fn_mcxt,
+								   sizeof(DeserialIOData));
+			getTypeBinaryInputInfo(element_type, &typreceive,
+								   &iodata->typioparam);
+			fmgr_info_cxt(typreceive, &iodata->typreceive,
+						  fcinfo->flinfo->fn_mcxt);
+			fcinfo->flinfo->fn_extra = (void *) iodata;
+		}
+
+		for (i = 0; i < nelems; i++)
+		{
+			int			itemlen;
+			StringInfoData elem_buf;
+			char		csave;
+
+			if (result->dnulls[i])
+			{
+				result->dvalues[i] = (Datum) 0;
+				continue;
+			}
+
+			itemlen = pq_getmsgint(&buf, 4);
+			if (itemlen < 0 || itemlen > (buf.len - buf.cursor))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+						 errmsg("insufficient data left in message")));
+
+			/*
+			 * Rather than copying data around, we just set up a phony
+			 * StringInfo pointing to the correct portion of the input buffer.
+			 * We assume we can scribble on the input buffer so as to maintain
+			 * the convention that StringInfos have a trailing null.
+			 */
+			elem_buf.data = &buf.data[buf.cursor];
+			elem_buf.maxlen = itemlen + 1;
+			elem_buf.len = itemlen;
+			elem_buf.cursor = 0;
+
+			buf.cursor += itemlen;
+
+			csave = buf.data[buf.cursor];
+			buf.data[buf.cursor] = '\0';
+
+			result->dvalues[i] = ReceiveFunctionCall(&iodata->typreceive,
+													 &elem_buf,
+													 iodata->typioparam,
+													 -1);
+
+			buf.data[buf.cursor] = csave;
+		}
+	}
+
+	pq_getmsgend(&buf);
+	pfree(buf.data);
+
+	PG_RETURN_POINTER(result);
+}
+
 /*
  * ARRAY_AGG(anyarray) aggregate function
  */
@@ -602,6 +876,219 @@ array_agg_array_finalfn(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(result);
 }
 
+/*
+ * array_agg_array_combine
+ *		Aggregate combine function for array_agg(anyarray)
+ */
+Datum
+array_agg_array_combine(PG_FUNCTION_ARGS)
+{
+	ArrayBuildStateArr *state1;
+	ArrayBuildStateArr *state2;
+	MemoryContext agg_context;
+	MemoryContext old_context;
+	int			i;
+
+	if (!AggCheckCallContext(fcinfo, &agg_context))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state1 = PG_ARGISNULL(0) ? NULL : (ArrayBuildStateArr *) PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (ArrayBuildStateArr *) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+	{
+		/* state1 is already in the agg_context, if any */
+		if (state1 == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state1);
+	}
+
+	if (state1 == NULL)
+	{
+		/* Start with an empty state in the agg_context, shaped as state2 */
+		state1 = initArrayResultArr(state2->array_type, state2->element_type,
+									agg_context, false);
+		state1->ndims = state2->ndims;
+		memcpy(state1->dims, state2->dims, sizeof(state2->dims));
+		state1->dims[0] = 0;
+		memcpy(state1->lbs, state2->lbs, sizeof(state2->lbs));
+	}
+	else
+	{
+		/*
+		 * The sub-arrays must all have the same dimensions.  Use the same
+		 * error as accumArrayResultArr().
+		 */
+		if (state1->ndims != state2->ndims)
+			ereport(ERROR,
+					(errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+					 errmsg("cannot accumulate arrays of different dimensionality")));
+		for (i = 1; i < state1->ndims; i++)
+		{
+			if (state1->dims[i] != state2->dims[i] ||
+				state1->lbs[i] != state2->lbs[i])
+				ereport(ERROR,
+						(errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+						 errmsg("cannot accumulate arrays of different dimensionality")));
+		}
+	}
+
+	Assert(state1->array_type == state2->array_type);
+
+	old_context = MemoryContextSwitchTo(state1->mcontext);
+
+	/* Append state2's data */
+	if (state1->nbytes + state2->nbytes > state1->abytes)
+	{
+		state1->abytes = pg_nextpower2_32(Max(1024,
+											  state1->nbytes + state2->nbytes));
+		if (state1->data)
+			state1->data = (char *) repalloc(state1->data, state1->abytes);
+		else
+			state1->data = (char *) palloc(state1->abytes);
+	}
+	memcpy(state1->data + state1->nbytes, state2->data, state2->nbytes);
+	state1->nbytes += state2->nbytes;
+
+	/* And its null bitmap, as in accumArrayResultArr() */
+	if (state1->nullbitmap || state2->nullbitmap)
+	{
+		int			newnitems = state1->nitems + state2->nitems;
+
+		if (state1->nullbitmap == NULL)
+		{
+			state1->aitems = pg_nextpower2_32(Max(256, newnitems + 1));
+			state1->nullbitmap = (bits8 *) palloc((state1->aitems + 7) / 8);
+			array_bitmap_copy(state1->nullbitmap, 0,
+							  NULL, 0,
+							  state1->nitems);
+		}
+		else if (newnitems > state1->aitems)
+		{
+			state1->aitems = pg_nextpower2_32(newnitems);
+			state1->nullbitmap = (bits8 *)
+				repalloc(state1->nullbitmap, (state1->aitems + 7) / 8);
+		}
+		array_bitmap_copy(state1->nullbitmap, state1->nitems,
+						  state2->nullbitmap, 0,
+						  state2->nitems);
+	}
+
+	state1->nitems += state2->nitems;
+	state1->dims[0] += state2->dims[0];
+
+	MemoryContextSwitchTo(old_context);
+
+	PG_RETURN_POINTER(state1);
+}
+
+/*
+ * array_agg_array_serialize
+ *		Aggregate serialization function for array_agg(anyarray)
+ *
+ * The accumulated data is in the array storage format already, so it's sent
+ * as-is.
+ */
+Datum
+array_agg_array_serialize(PG_FUNCTION_ARGS)
+{
+	ArrayBuildStateArr *state;
+	StringInfoData buf;
+	int			i;
+
+	/* cannot be called directly because of internal-type argument */
+	Assert(AggCheckCallContext(fcinfo, NULL));
+
+	state = (ArrayBuildStateArr *) PG_GETARG_POINTER(0);
+
+	pq_begintypsend(&buf);
+
+	pq_sendint32(&buf, state->array_type);
+	pq_sendint32(&buf, state->element_type);
+	pq_sendint32(&buf, state->ndims);
+	for (i = 0; i < state->ndims; i++)
+	{
+		pq_sendint32(&buf, state->dims[i]);
+		pq_sendint32(&buf, state->lbs[i]);
+	}
+	pq_sendint32(&buf, state->nitems);
+	pq_sendint32(&buf, state->nbytes);
+	pq_sendbytes(&buf, state->data, state->nbytes);
+	pq_sendbyte(&buf, state->nullbitmap != NULL);
+	if (state->nullbitmap)
+		pq_sendbytes(&buf, (char *) state->nullbitmap,
+					 (state->nitems + 7) / 8);
+
+	PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+/*
+ * array_agg_array_deserialize
+ *		Aggregate deserialization function for array_agg(anyarray)
+ */
+Datum
+array_agg_array_deserialize(PG_FUNCTION_ARGS)
+{
+	bytea	   *sstate;
+	ArrayBuildStateArr *result;
+	StringInfoData buf;
+	Oid			array_type;
+	Oid			element_type;
+	int			i;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	sstate = PG_GETARG_BYTEA_PP(0);
+
+	/* Read the bytea in place; we don't modify it */
+	buf.data = VARDATA_ANY(sstate);
+	buf.len = VARSIZE_ANY_EXHDR(sstate);
+	buf.maxlen = 0;
+	buf.cursor = 0;
+
+	array_type = pq_getmsgint(&buf, 4);
+	element_type = pq_getmsgint(&buf, 4);
+	result = initArrayResultArr(array_type, element_type,
+								CurrentMemoryContext, false);
+
+	result->ndims = pq_getmsgint(&buf, 4);
+	if (result->ndims < 2 || result->ndims > MAXDIM)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				 errmsg("invalid array_agg state")));
+	for (i = 0; i < result->ndims; i++)
+	{
+		result->dims[i] = pq_getmsgint(&buf, 4);
+		result->lbs[i] = pq_getmsgint(&buf, 4);
+	}
+	result->nitems = pq_getmsgint(&buf, 4);
+	result->nbytes = pq_getmsgint(&buf, 4);
+	if (result->nitems < 0 || result->nbytes < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				 errmsg("invalid array_agg state")));
+
+	result->abytes = Max(result->nbytes, 1);
+	result->data = (char *) palloc(result->abytes);
+	memcpy(result->data, pq_getmsgbytes(&buf, result->nbytes),
+		   result->nbytes);
+
+	if (pq_getmsgbyte(&buf))
+	{
+		int			nbitmapbytes = (result->nitems + 7) / 8;
+
+		result->aitems = nbitmapbytes * 8;
+		result->nullbitmap = (bits8 *) palloc(nbitmapbytes);
+		memcpy(result->nullbitmap, pq_getmsgbytes(&buf, nbitmapbytes),
+			   nbitmapbytes);
+	}
+
+	pq_getmsgend(&buf);
+
+	PG_RETURN_POINTER(result);
+}
+
 /*-----------------------------------------------------------------------------
  * array_position, array_position_start :
  *			return the offset of a value in an array.
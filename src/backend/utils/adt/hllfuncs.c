@@ -0,0 +1,295 @@
+/*-------------------------------------------------------------------------
+ *
+ * hllfuncs.c
+ *		Approximate distinct counting aggregates, based on HyperLogLog.
+ *
+ * approx_count_distinct(anyelement) estimates the number of distinct
+ * non-null input values, using a fixed amount of memory per group and no
+ * sorting.  The transition state is a HyperLogLog estimator fed with the
+ * input type's standard hash function, so the input type must be hashable.
+ *
+ * The estimator can also be returned as a "sketch" (a bytea), which can be
+ * stored and later merged with other sketches to estimate the number of
+ * distinct values in their union, as for rollup tables.  The same bytea
+ * representation is used to pass partial states between parallel workers.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/adt/hllfuncs.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "fmgr.h"
+#include "lib/hyperloglog.h"
+#include "libpq/pqformat.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/typcache.h"
+
+/*
+ * Register width used by the aggregates.  2^14 registers give a standard
+ * error of about 0.8%, in 16kB per group.
+ */
+#define APPROX_COUNT_DISTINCT_BWIDTH	14
+
+/*
+ * Make a new estimator in the aggregate's memory context.
+ */
+static hyperLogLogState *
+make_hll_state(MemoryContext aggcontext, uint8 bwidth)
+{
+	MemoryContext oldcontext;
+	hyperLogLogState *state;
+
+	oldcontext = MemoryContextSwitchTo(aggcontext);
+	state = (hyperLogLogState *) palloc(sizeof(hyperLogLogState));
+	initHyperLogLog(state, bwidth);
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
+/*
+ * Turn an estimator into a sketch: one byte of register width, followed
+ * by the registers.
+ */
+static bytea *
+hll_state_to_sketch(hyperLogLogState *state)
+{
+	StringInfoData buf;
+
+	pq_begintypsend(&buf);
+	pq_sendbyte(&buf, state->registerWidth);
+	pq_sendbytes(&buf, (char *) state->hashesArr, state->nRegisters);
+
+	return pq_endtypsend(&buf);
+}
+
+/*
+ * Merge a sketch into an estimator, creating the estimator if *state is
+ * NULL.
+ */
+static void
+hll_merge_sketch(hyperLogLogState **state, bytea *sketch,
+				 MemoryContext aggcontext)
+{
+	const uint8 *data = (const uint8 *) VARDATA_ANY(sketch);
+	Size		len = VARSIZE_ANY_EXHDR(sketch);
+	uint8		bwidth;
+	Size		i;
+
+	if (len < 1 || data[0] < 4 || data[0] > 16 ||
+		len != ((Size) 1 << data[0]) + 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				 errmsg("invalid approx_count_distinct sketch")));
+	bwidth = data[0];
+
+	if (*state == NULL)
+		*state = make_hll_state(aggcontext, bwidth);
+	else if ((*state)->registerWidth != bwidth)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("cannot merge approx_count_distinct sketches of different precision")));
+
+	for (i = 0; i < (*state)->nRegisters; i++)
+		(*state)->hashesArr[i] = Max((*state)->hashesArr[i], data[i + 1]);
+}
+
+/*
+ * Transition function for approx_count_distinct(anyelement) and
+ * approx_count_distinct_sketch(anyelement)
+ */
+Datum
+approx_count_distinct_transfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	hyperLogLogState *state;
+	FmgrInfo   *hash_proc;
+	uint32		hash;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state = PG_ARGISNULL(0) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(0);
+	if (state == NULL)
+		state = make_hll_state(aggcontext, APPROX_COUNT_DISTINCT_BWIDTH);
+
+	/* nulls are not counted */
+	if (PG_ARGISNULL(1))
+		PG_RETURN_POINTER(state);
+
+	/* Look up the input type's hash function, once per query */
+	hash_proc = (FmgrInfo *) fcinfo->flinfo->fn_extra;
+	if (hash_proc == NULL)
+	{
+		Oid			argtype = get_fn_expr_argtype(fcinfo->flinfo, 1);
+		TypeCacheEntry *typentry;
+
+		typentry = lookup_type_cache(argtype, TYPECACHE_HASH_PROC_FINFO);
+		if (!OidIsValid(typentry->hash_proc_finfo.fn_oid))
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_FUNCTION),
+					 errmsg("could not identify a hash function for type %s",
+							format_type_be(argtype))));
+		hash_proc = &typentry->hash_proc_finfo;
+		fcinfo->flinfo->fn_extra = hash_proc;
+	}
+
+	hash = DatumGetUInt32(FunctionCall1Coll(hash_proc,
+											PG_GET_COLLATION(),
+											PG_GETARG_DATUM(1)));
+	addHyperLogLog(state, hash);
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * Transition function for approx_count_distinct_merge(bytea)
+ */
+Datum
+approx_count_distinct_merge_transfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	hyperLogLogState *state;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state = PG_ARGISNULL(0) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+	/* null sketches are ignored */
+	if (!PG_ARGISNULL(1))
+		hll_merge_sketch(&state, PG_GETARG_BYTEA_PP(1), aggcontext);
+
+	if (state == NULL)
+		PG_RETURN_NULL();
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * Combine function for all the approx_count_distinct aggregates
+ */
+Datum
+approx_count_distinct_combine(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	hyperLogLogState *state1;
+	hyperLogLogState *state2;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state1 = PG_ARGISNULL(0) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+	{
+		if (state1 == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state1);
+	}
+
+	/* copy state2 into the aggregate context if we have nothing yet */
+	if (state1 == NULL)
+		state1 = make_hll_state(aggcontext, state2->registerWidth);
+
+	mergeHyperLogLog(state1, state2);
+
+	PG_RETURN_POINTER(state1);
+}
+
+/*
+ * Serialization function for all the approx_count_distinct aggregates
+ */
+Datum
+approx_count_distinct_serialize(PG_FUNCTION_ARGS)
+{
+	hyperLogLogState *state;
+
+	/* Ensure we disallow calling when not in aggregate context */
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state = (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+	PG_RETURN_BYTEA_P(hll_state_to_sketch(state));
+}
+
+/*
+ * Deserialization function for all the approx_count_distinct aggregates
+ */
+Datum
+approx_count_distinct_deserialize(PG_FUNCTION_ARGS)
+{
+	hyperLogLogState *state = NULL;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	hll_merge_sketch(&state, PG_GETARG_BYTEA_PP(0), CurrentMemoryContext);
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * Final function for approx_count_distinct(anyelement)
+ */
+Datum
+approx_count_distinct_finalfn(PG_FUNCTION_ARGS)
+{
+	hyperLogLogState *state;
+
+	/* cannot be called directly because of internal-type argument */
+	Assert(AggCheckCallContext(fcinfo, NULL));
+
+	/* like count(), return zero rather than null for no input rows */
+	if (PG_ARGISNULL(0))
+		PG_RETURN_INT64(0);
+
+	state = (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+	PG_RETURN_INT64((int64) rint(estimateHyperLogLog(state)));
+}
+
+/*
+ * Final function for approx_count_distinct_sketch(anyelement) and
+ * approx_count_distinct_merge(bytea)
+ */
+Datum
+approx_count_distinct_sketch_finalfn(PG_FUNCTION_ARGS)
+{
+	hyperLogLogState *state;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	/* return an empty sketch for no input, so that it can still be merged */
+	if (PG_ARGISNULL(0))
+		state = make_hll_state(CurrentMemoryContext,
+							   APPROX_COUNT_DISTINCT_BWIDTH);
+	else
+		state = (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+	PG_RETURN_BYTEA_P(hll_state_to_sketch(state));
+}
+
+/*
+ * approx_count_distinct_estimate(bytea)
+ *		Estimate the number of distinct values in a sketch.
+ */
+Datum
+approx_count_distinct_estimate(PG_FUNCTION_ARGS)
+{
+	hyperLogLogState *state = NULL;
+
+	hll_merge_sketch(&state, PG_GETARG_BYTEA_PP(0), CurrentMemoryContext);
+
+	PG_RETURN_INT64((int64) rint(estimateHyperLogLog(state)));
+}
@@ -13,6 +13,7 @@
  */
 #include "postgres.h"
 
+#include "access/detoast.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_type.h"
 #include "common/hashfn.h"
@@ -37,6 +38,13 @@
 #define JSONB_MAX_ELEMS (Min(MaxAllocSize / sizeof(JsonbValue), JB_CMASK))
 #define JSONB_MAX_PAIRS (Min(MaxAllocSize / sizeof(JsonbPair), JB_CMASK))
 
+/*
+ * Toasted jsonb datums at least this large (uncompressed) are detoasted
+ * piecemeal by getKeyJsonValueFromDatum().  Below this, the extra toast
+ * fetches would cost more than detoasting the whole datum at once.
+ */
+#define JSONB_SLICE_MIN_SIZE	(32 * 1024)
+
 static void fillJsonbValue(JsonbContainer *container, int index,
 						   char *base_addr, uint32 offset,
 						   JsonbValue *result);
@@ -53,6 +61,8 @@ static void appendToBuffer(StringInfo buffer, const char *data, int len);
 static void copyToBuffer(StringInfo buffer, int offset, const char *data, int len);
 static short padBufferToInt(StringInfo buffer);
 
+static int	findJsonbKeyIndex(JsonbContainer *container,
+							  const char *keyVal, int keyLen);
 static JsonbIterator *iteratorFromContainer(JsonbContainer *container, JsonbIterator *parent);
 static JsonbIterator *freeAndGetParent(JsonbIterator *it);
 static JsonbParseState *pushState(JsonbParseState **pstate);
@@ -390,6 +400,116 @@ findJsonbValueFromContainer(JsonbContainer *container, uint32 flags,
 JsonbValue *
 getKeyJsonValueFromContainer(JsonbContainer *container,
 							 const char *keyVal, int keyLen, JsonbValue *res)
+{
+	int			count = JsonContainerSize(container);
+	int			index;
+
+	Assert(JsonContainerIsObject(container));
+
+	index = findJsonbKeyIndex(container, keyVal, keyLen);
+	if (index < 0)
+		return NULL;
+
+	/* Found our key, return corresponding value */
+	index += count;
+
+	if (!res)
+		res = palloc(sizeof(JsonbValue));
+
+	fillJsonbValue(container, index, (char *) (container->children + count * 2),
+				   getJsonbOffset(container, index),
+				   res);
+
+	return res;
+}
+
+/*
+ * Find value by key in the root object of a jsonb datum, like
+ * getKeyJsonValueFromContainer() on the detoasted datum.
+ *
+ * An object stores its JEntries first, then all its keys, then all its
+ * values, so a key can be looked up, and its value fetched, from a prefix
+ * of the datum.  For large toasted datums we therefore only detoast as much
+ * of the datum as we need, with a detoast iterator.  The value returned may
+ * point into the iterator's buffer, so the iterator isn't released.
+ *
+ * Returns NULL if the root is not an object, or if the key isn't found.
+ */
+JsonbValue *
+getKeyJsonValueFromDatum(Datum jsonb, const char *keyVal, int keyLen,
+						 JsonbValue *res)
+{
+	struct varlena *attr = (struct varlena *) DatumGetPointer(jsonb);
+	Jsonb	   *jb;
+	DetoastIterator iter;
+	JsonbContainer *jc;
+	int32		avail;
+	uint32		count;
+	int32		hdrlen;
+	int			index;
+
+	if (!(VARATT_IS_EXTERNAL_ONDISK(attr) || VARATT_IS_COMPRESSED(attr)) ||
+		toast_raw_datum_size(jsonb) < VARHDRSZ + JSONB_SLICE_MIN_SIZE)
+	{
+		jb = DatumGetJsonbP(jsonb);
+		if (!JB_ROOT_IS_OBJECT(jb))
+			return NULL;
+		return getKeyJsonValueFromContainer(&jb->root, keyVal, keyLen, res);
+	}
+
+	iter = detoast_iterator_begin(attr);
+
+	/* Fetch the root container's header */
+	jc = (JsonbContainer *) detoast_iterator_fetch(iter, sizeof(uint32),
+												   &avail);
+	if (!JsonContainerIsObject(jc) || JsonContainerSize(jc) == 0)
+	{
+		detoast_iterator_end(iter);
+		return NULL;
+	}
+	count = JsonContainerSize(jc);
+	hdrlen = offsetof(JsonbContainer, children) + count * 2 * sizeof(JEntry);
+
+	/* Then its JEntries, to find where the keys end */
+	jc = (JsonbContainer *) detoast_iterator_fetch(iter, hdrlen, &avail);
+
+	/* Then the keys, to look up the one we want */
+	jc = (JsonbContainer *) detoast_iterator_fetch(iter,
+												   hdrlen + getJsonbOffset(jc, count),
+												   &avail);
+
+	index = findJsonbKeyIndex(jc, keyVal, keyLen);
+	if (index < 0)
+	{
+		detoast_iterator_end(iter);
+		return NULL;
+	}
+	index += count;
+
+	/* And finally everything up to the end of the value */
+	jc = (JsonbContainer *) detoast_iterator_fetch(iter,
+												   hdrlen +
+												   getJsonbOffset(jc, index) +
+												   getJsonbLength(jc, index),
+												   &avail);
+
+	if (!res)
+		res = palloc(sizeof(JsonbValue));
+
+	fillJsonbValue(jc, index, (char *) (jc->children + count * 2),
+				   getJsonbOffset(jc, index),
+				   res);
+
+	return res;
+}
+
+/*
+ * Binary search an object's keys for a key.  Returns the index of the key's
+ * JEntry, or -1 if not found.  Only the container's JEntries and keys are
+ * accessed, not its values.
+ */
+static int
+findJsonbKeyIndex(JsonbContainer *container, const char *keyVal, int keyLen)
 {
 	JEntry	   *children = container->children;
 	int			count = JsonContainerSize(container);
@@ -397,11 +517,9 @@ getKeyJsonValueFromContainer(JsonbContainer *container,
 	uint32		stopLow,
 				stopHigh;
 
-	Assert(JsonContainerIsObject(container));
-
-	/* Quick out without a palloc cycle if object is empty */
+	/* Quick out if object is empty */
 	if (count <= 0)
-		return NULL;
+		return -1;
 
 	/*
 	 * Binary search the container. Since we know this is an object, account
@@ -426,19 +544,7 @@ getKeyJsonValueFromContainer(JsonbContainer *container,
 											  keyVal, keyLen);
 
 		if (difference == 0)
-		{
-			/* Found our key, return corresponding value */
-			int			index = stopMiddle + count;
-
-			if (!res)
-				res = palloc(sizeof(JsonbValue));
-
-			fillJsonbValue(container, index, baseAddr,
-						   getJsonbOffset(container, index),
-						   res);
-
-			return res;
-		}
+			return stopMiddle;
 		else
 		{
 			if (difference < 0)
@@ -449,7 +555,7 @@ getKeyJsonValueFromContainer(JsonbContainer *container,
 	}
 
 	/* Not found */
-	return NULL;
+	return -1;
 }
 
 /*
@@ -19,6 +19,7 @@
 
 #include <ctype.h>
 
+#include "access/detoast.h"
 #include "catalog/pg_collation.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
@@ -46,6 +47,8 @@ static int	SB_IMatchText(const char *t, int tlen, const char *p, int plen,
 						  pg_locale_t locale, bool locale_is_c);
 
 static int	GenericMatchText(const char *s, int slen, const char *p, int plen, Oid collation);
+static int	GenericMatchToastedText(struct varlena *str, const char *p, int plen,
+									Oid collation);
 static int	Generic_Text_IC_like(text *str, text *pat, Oid collation);
 
 /*--------------------
@@ -146,9 +149,8 @@ SB_lower_char(unsigned char c, pg_locale_t locale, bool locale_is_c)
 
 #include "like_match.c"
 
-/* Generic for all cases not requiring inline case-folding */
-static inline int
-GenericMatchText(const char *s, int slen, const char *p, int plen, Oid collation)
+static inline void
+CheckLikeCollation(Oid collation)
 {
 	if (collation && !lc_ctype_is_c(collation) && collation != DEFAULT_COLLATION_OID)
 	{
@@ -159,6 +161,13 @@ GenericMatchText(const char *s, int slen, const char *p, int plen, Oid collation
 					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 					 errmsg("nondeterministic collations are not supported for LIKE")));
 	}
+}
+
+/* Generic for all cases not requiring inline case-folding */
+static inline int
+GenericMatchText(const char *s, int slen, const char *p, int plen, Oid collation)
+{
+	CheckLikeCollation(collation);
 
 	if (pg_database_encoding_max_length() == 1)
 		return SB_MatchText(s, slen, p, plen, 0, true);
@@ -168,6 +177,58 @@ GenericMatchText(const char *s, int slen, const char *p, int plen, Oid collation
 		return MB_MatchText(s, slen, p, plen, 0, true);
 }
 
+/*
+ * GenericMatchText() for a string that is still toasted.
+ *
+ * A pattern that starts with literal characters can only match a string
+ * that starts with the same bytes, and if the rest of the pattern is just
+ * "%", it matches every such string.  So look at a prefix of the string
+ * first, and detoast the rest only if the whole pattern needs matching.
+ * Only bytes below 0x80 can be wildcards or escapes, and those are never
+ * part of a multibyte character, so comparing bytes is safe.
+ */
+static int
+GenericMatchToastedText(struct varlena *str, const char *p, int plen,
+						Oid collation)
+{
+	DetoastIterator iter;
+	const char *s;
+	int32		slen;
+	int			prefixlen;
+	int			i;
+	int			result;
+
+	CheckLikeCollation(collation);
+
+	for (prefixlen = 0; prefixlen < plen; prefixlen++)
+	{
+		if (p[prefixlen] == '%' || p[prefixlen] == '_' || p[prefixlen] == '\\')
+			break;
+	}
+
+	iter = detoast_iterator_begin(str);
+	s = detoast_iterator_fetch(iter, prefixlen, &slen);
+
+	if (slen < prefixlen || memcmp(s, p, prefixlen) != 0)
+		result = LIKE_FALSE;
+	else
+	{
+		for (i = prefixlen; i < plen && p[i] == '%'; i++)
+			;
+		if (prefixlen < plen && i == plen)
+			result = LIKE_TRUE;
+		else
+		{
+			s = detoast_iterator_fetch(iter, PG_INT32_MAX, &slen);
+			result = GenericMatchText(s, slen, p, plen, collation);
+		}
+	}
+
+	detoast_iterator_end(iter);
+
+	return result;
+}
+
 static inline int
 Generic_Text_IC_like(text *str, text *pat, Oid collation)
 {
@@ -283,7 +344,8 @@ namenlike(PG_FUNCTION_ARGS)
 Datum
 textlike(PG_FUNCTION_ARGS)
 {
-	text	   *str = PG_GETARG_TEXT_PP(0);
+	struct varlena *rawstr = (struct varlena *) PG_GETARG_POINTER(0);
+	text	   *str;
 	text	   *pat = PG_GETARG_TEXT_PP(1);
 	bool		result;
 	char	   *s,
@@ -291,11 +353,21 @@ textlike(PG_FUNCTION_ARGS)
 	int			slen,
 				plen;
 
-	s = VARDATA_ANY(str);
-	slen = VARSIZE_ANY_EXHDR(str);
 	p = VARDATA_ANY(pat);
 	plen = VARSIZE_ANY_EXHDR(pat);
 
+	/* For a toasted string, a prefix may be enough */
+	if (VARATT_IS_EXTERNAL_ONDISK(rawstr) || VARATT_IS_COMPRESSED(rawstr))
+	{
+		result = (GenericMatchToastedText(rawstr, p, plen,
+										  PG_GET_COLLATION()) == LIKE_TRUE);
+		PG_RETURN_BOOL(result);
+	}
+
+	str = PG_GETARG_TEXT_PP(0);
+	s = VARDATA_ANY(str);
+	slen = VARSIZE_ANY_EXHDR(str);
+
 	result = (GenericMatchText(s, slen, p, plen, PG_GET_COLLATION()) == LIKE_TRUE);
 
 	PG_RETURN_BOOL(result);
@@ -304,7 +376,8 @@ textlike(PG_FUNCTION_ARGS)
 Datum
 textnlike(PG_FUNCTION_ARGS)
 {
-	text	   *str = PG_GETARG_TEXT_PP(0);
+	struct varlena *rawstr = (struct varlena *) PG_GETARG_POINTER(0);
+	text	   *str;
 	text	   *pat = PG_GETARG_TEXT_PP(1);
 	bool		result;
 	char	   *s,
@@ -312,11 +385,21 @@ textnlike(PG_FUNCTION_ARGS)
 	int			slen,
 				plen;
 
-	s = VARDATA_ANY(str);
-	slen = VARSIZE_ANY_EXHDR(str);
 	p = VARDATA_ANY(pat);
 	plen = VARSIZE_ANY_EXHDR(pat);
 
+	/* For a toasted string, a prefix may be enough */
+	if (VARATT_IS_EXTERNAL_ONDISK(rawstr) || VARATT_IS_COMPRESSED(rawstr))
+	{
+		result = (GenericMatchToastedText(rawstr, p, plen,
+										  PG_GET_COLLATION()) != LIKE_TRUE);
+		PG_RETURN_BOOL(result);
+	}
+
+	str = PG_GETARG_TEXT_PP(0);
+	s = VARDATA_ANY(str);
+	slen = VARSIZE_ANY_EXHDR(str);
+
 	result = (GenericMatchText(s, slen, p, plen, PG_GET_COLLATION()) != LIKE_TRUE);
 
 	PG_RETURN_BOOL(result);
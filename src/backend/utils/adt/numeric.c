@@ -311,6 +311,10 @@ typedef struct NumericVar
 	NumericDigit *digits;		/* base-NBASE digits */
 } NumericVar;
 
+/* Number of NBASE digits after the decimal point in a NumericVar */
+#define NUMERIC_VAR_FRAC_DIGITS(var) \
+	Max((var)->ndigits - (var)->weight - 1, 0)
+
 
 /* ----------
  * Data for generate_series
@@ -363,6 +367,14 @@ typedef struct
  * call to accum_sum_add() will enlarge the buffer, to make room for the
  * extra digit, and set the flag again.
  *
+ * Most sums are of values with few digits, so before touching the digit
+ * buffers we try to add each value to 'fastsum', a native integer holding
+ * the sum scaled by NBASE^fast_nscale.  Only values that are too wide for
+ * that, or that would overflow it, go into the digit buffers.  The digit
+ * sum and 'fastsum' are added together in accum_sum_final().  'fast_nscale'
+ * is chosen from the display scale of the first value added while 'fastsum'
+ * is zero, so for a column of a fixed scale all values normally qualify.
+ *
  * To initialize a new accumulator, simply reset all fields to zeros.
  *
  * The accumulator does not handle NaNs.
@@ -377,6 +389,12 @@ typedef struct NumericSumAccum
 	bool		have_carry_space;
 	int32	   *pos_digits;
 	int32	   *neg_digits;
+	int			fast_nscale;
+#ifdef HAVE_INT128
+	int128		fastsum;
+#else
+	int64		fastsum;
+#endif
 } NumericSumAccum;
 
 
@@ -525,6 +543,10 @@ static void apply_typmod_special(Numeric num, int32 typmod);
 static bool numericvar_to_int32(const NumericVar *var, int32 *result);
 static bool numericvar_to_int64(const NumericVar *var, int64 *result);
 static void int64_to_numericvar(int64 val, NumericVar *var);
+static bool numericvar_to_scaled_int64(const NumericVar *var, int nscale,
+									   int64 *result);
+static Numeric make_result_from_scaled_int64(int64 val, int nscale,
+											 int dscale, bool *have_error);
 static bool numericvar_to_uint64(const NumericVar *var, uint64 *result);
 #ifdef HAVE_INT128
 static bool numericvar_to_int128(const NumericVar *var, int128 *result);
@@ -596,10 +618,12 @@ static void compute_bucket(Numeric operand, Numeric bound1, Numeric bound2,
 						   NumericVar *result_var);
 
 static void accum_sum_add(NumericSumAccum *accum, const NumericVar *var1);
+static bool accum_sum_add_fast(NumericSumAccum *accum, const NumericVar *val);
 static void accum_sum_rescale(NumericSumAccum *accum, const NumericVar *val);
 static void accum_sum_carry(NumericSumAccum *accum);
 static void accum_sum_reset(NumericSumAccum *accum);
 static void accum_sum_final(NumericSumAccum *accum, NumericVar *result);
+static void accum_sum_final_fast(NumericSumAccum *accum, NumericVar *result);
 static void accum_sum_copy(NumericSumAccum *dst, NumericSumAccum *src);
 static void accum_sum_combine(NumericSumAccum *accum, NumericSumAccum *accum2);
 
@@ -2733,6 +2757,9 @@ numeric_add_opt_error(Numeric num1, Numeric num2, bool *have_error)
 	NumericVar	arg2;
 	NumericVar	result;
 	Numeric		res;
+	int			nscale;
+	int64		val1,
+				val2;
 
 	/*
 	 * Handle NaN and infinities
@@ -2763,11 +2790,22 @@ numeric_add_opt_error(Numeric num1, Numeric num2, bool *have_error)
 	}
 
 	/*
-	 * Unpack the values, let add_var() compute the result and return it.
+	 * Unpack the values.  If both fit in an int64 when scaled to the same
+	 * number of fractional digits, add them natively; otherwise let
+	 * add_var() compute the result.
 	 */
 	init_var_from_num(num1, &arg1);
 	init_var_from_num(num2, &arg2);
 
+	nscale = Max(NUMERIC_VAR_FRAC_DIGITS(&arg1),
+				 NUMERIC_VAR_FRAC_DIGITS(&arg2));
+	if (numericvar_to_scaled_int64(&arg1, nscale, &val1) &&
+		numericvar_to_scaled_int64(&arg2, nscale, &val2) &&
+		!pg_add_s64_overflow(val1, val2, &val1))
+		return make_result_from_scaled_int64(val1, nscale,
+											 Max(arg1.dscale, arg2.dscale),
+											 have_error);
+
 	init_var(&result);
 	add_var(&arg1, &arg2, &result);
 
@@ -2811,6 +2849,9 @@ numeric_sub_opt_error(Numeric num1, Numeric num2, bool *have_error)
 	NumericVar	arg2;
 	NumericVar	result;
 	Numeric		res;
+	int			nscale;
+	int64		val1,
+				val2;
 
 	/*
 	 * Handle NaN and infinities
@@ -2841,11 +2882,21 @@ numeric_sub_opt_error(Numeric num1, Numeric num2, bool *have_error)
 	}
 
 	/*
-	 * Unpack the values, let sub_var() compute the result and return it.
+	 * Unpack the values, and subtract them natively if possible, as in
+	 * numeric_add_opt_error().  Otherwise let sub_var() compute the result.
 	 */
 	init_var_from_num(num1, &arg1);
 	init_var_from_num(num2, &arg2);
 
+	nscale = Max(NUMERIC_VAR_FRAC_DIGITS(&arg1),
+				 NUMERIC_VAR_FRAC_DIGITS(&arg2));
+	if (numericvar_to_scaled_int64(&arg1, nscale, &val1) &&
+		numericvar_to_scaled_int64(&arg2, nscale, &val2) &&
+		!pg_sub_s64_overflow(val1, val2, &val1))
+		return make_result_from_scaled_int64(val1, nscale,
+											 Max(arg1.dscale, arg2.dscale),
+											 have_error);
+
 	init_var(&result);
 	sub_var(&arg1, &arg2, &result);
 
@@ -2889,6 +2940,10 @@ numeric_mul_opt_error(Numeric num1, Numeric num2, bool *have_error)
 	NumericVar	arg2;
 	NumericVar	result;
 	Numeric		res;
+	int			nscale1,
+				nscale2;
+	int64		val1,
+				val2;
 
 	/*
 	 * Handle NaN and infinities
@@ -2956,10 +3011,43 @@ numeric_mul_opt_error(Numeric num1, Numeric num2, bool *have_error)
 	 * case of numeric_mul(), which is invoked for the * operator on numerics,
 	 * we request exact representation for the product (rscale = sum(dscale of
 	 * arg1, dscale of arg2)).
+	 *
+	 * The exact product of two values that fit in an int64 as integers
+	 * scaled by their fractional digits is computed natively, if it doesn't
+	 * overflow.
 	 */
 	init_var_from_num(num1, &arg1);
 	init_var_from_num(num2, &arg2);
 
+	nscale1 = NUMERIC_VAR_FRAC_DIGITS(&arg1);
+	nscale2 = NUMERIC_VAR_FRAC_DIGITS(&arg2);
+	if (numericvar_to_scaled_int64(&arg1, nscale1, &val1) &&
+		numericvar_to_scaled_int64(&arg2, nscale2, &val2))
+	{
+#ifdef HAVE_INT128
+		int128		prod = (int128) val1 * (int128) val2;
+
+		if (prod >= PG_INT64_MIN && prod <= PG_INT64_MAX)
+			return make_result_from_scaled_int64((int64) prod,
+												 nscale1 + nscale2,
+												 arg1.dscale + arg2.dscale,
+												 have_error);
+
+		init_var(&result);
+		int128_to_numericvar(prod, &result);
+		result.weight -= nscale1 + nscale2;
+		result.dscale = arg1.dscale + arg2.dscale;
+		res = make_result_opt_error(&result, have_error);
+		free_var(&result);
+		return res;
+#else
+		if (!pg_mul_s64_overflow(val1, val2, &val1))
+			return make_result_from_scaled_int64(val1, nscale1 + nscale2,
+												 arg1.dscale + arg2.dscale,
+												 have_error);
+#endif
+	}
+
 	init_var(&result);
 	mul_var(&arg1, &arg2, &result, arg1.dscale + arg2.dscale);
 
@@ -7603,6 +7691,75 @@ int64_to_numericvar(int64 val, NumericVar *var)
 	var->weight = ndigits - 1;
 }
 
+/*
+ * Convert numeric to an int64 holding its value scaled by NBASE^nscale,
+ * that is, with nscale NBASE digits after the decimal point.
+ *
+ * Returns false (no error is raised) if the value has more than nscale
+ * fractional digits, or if the scaled value doesn't fit in an int64.
+ */
+static bool
+numericvar_to_scaled_int64(const NumericVar *var, int nscale, int64 *result)
+{
+	int			ndigits = var->weight + 1 + nscale;
+	int64		val;
+	int			i;
+
+	if (var->ndigits == 0)
+	{
+		*result = 0;
+		return true;
+	}
+
+	/* int64 can hold at most 19 decimal digits */
+	if (var->ndigits > ndigits || ndigits > 20 / DEC_DIGITS)
+		return false;
+
+	/* Construct the result, as a negative number like numericvar_to_int64 */
+	val = 0;
+	for (i = 0; i < ndigits; i++)
+	{
+		NumericDigit dig = (i < var->ndigits) ? var->digits[i] : 0;
+
+		if (unlikely(pg_mul_s64_overflow(val, NBASE, &val)) ||
+			unlikely(pg_sub_s64_overflow(val, dig, &val)))
+			return false;
+	}
+
+	if (var->sign == NUMERIC_POS)
+	{
+		if (unlikely(val == PG_INT64_MIN))
+			return false;
+		val = -val;
+	}
+	*result = val;
+
+	return true;
+}
+
+/*
+ * Make a Numeric from an int64 holding a value scaled by NBASE^nscale, with
+ * display scale dscale.
+ */
+static Numeric
+make_result_from_scaled_int64(int64 val, int nscale, int dscale,
+							  bool *have_error)
+{
+	NumericVar	var;
+	Numeric		res;
+
+	init_var(&var);
+	int64_to_numericvar(val, &var);
+	var.weight -= nscale;
+	var.dscale = dscale;
+
+	res = make_result_opt_error(&var, have_error);
+
+	free_var(&var);
+
+	return res;
+}
+
 /*
  * Convert numeric to uint64, rounding if needed.
  *
@@ -10839,6 +10996,7 @@ accum_sum_reset(NumericSumAccum *accum)
 	int			i;
 
 	accum->dscale = 0;
+	accum->fastsum = 0;
 	for (i = 0; i < accum->ndigits; i++)
 	{
 		accum->pos_digits[i] = 0;
@@ -10858,6 +11016,10 @@ accum_sum_add(NumericSumAccum *accum, const NumericVar *val)
 	int			val_ndigits;
 	NumericDigit *val_digits;
 
+	/* Use the native integer sum, if the value fits */
+	if (accum_sum_add_fast(accum, val))
+		return;
+
 	/*
 	 * If we have accumulated too many values since the last carry
 	 * propagation, do it now, to avoid overflowing.  (We could allow more
@@ -10894,6 +11056,37 @@ accum_sum_add(NumericSumAccum *accum, const NumericVar *val)
 	accum->num_uncarried++;
 }
 
+/*
+ * Try to add a new value to the accumulator's native integer sum.  Returns
+ * false if the value doesn't fit, or the sum would overflow; the caller
+ * must then add it to the digit buffers.
+ */
+static bool
+accum_sum_add_fast(NumericSumAccum *accum, const NumericVar *val)
+{
+	int64		ival;
+
+	/* While the sum is zero, we can choose its scale freely */
+	if (accum->fastsum == 0)
+		accum->fast_nscale = (val->dscale + DEC_DIGITS - 1) / DEC_DIGITS;
+
+	if (!numericvar_to_scaled_int64(val, accum->fast_nscale, &ival))
+		return false;
+
+#ifdef HAVE_INT128
+	/* no overflow check needed, as we add at most one int64 per row */
+	accum->fastsum += ival;
+#else
+	if (pg_add_s64_overflow(accum->fastsum, ival, &accum->fastsum))
+		return false;
+#endif
+
+	if (val->dscale > accum->dscale)
+		accum->dscale = val->dscale;
+
+	return true;
+}
+
 /*
  * Propagate carries.
  */
@@ -11069,6 +11262,7 @@ accum_sum_final(NumericSumAccum *accum, NumericVar *result)
 	if (accum->ndigits == 0)
 	{
 		set_var_from_var(&const_zero, result);
+		accum_sum_final_fast(accum, result);
 		return;
 	}
 
@@ -11100,6 +11294,37 @@ accum_sum_final(NumericSumAccum *accum, NumericVar *result)
 	/* And add them together */
 	add_var(&pos_var, &neg_var, result);
 
+	/* Add the native integer sum */
+	accum_sum_final_fast(accum, result);
+}
+
+/*
+ * Add the accumulator's native integer sum to the sum of its digit buffers,
+ * in 'result', and set the result's display scale.
+ */
+static void
+accum_sum_final_fast(NumericSumAccum *accum, NumericVar *result)
+{
+	if (accum->fastsum != 0)
+	{
+		NumericVar	fast_var;
+
+		init_var(&fast_var);
+#ifdef HAVE_INT128
+		int128_to_numericvar(accum->fastsum, &fast_var);
+#else
+		int64_to_numericvar(accum->fastsum, &fast_var);
+#endif
+		fast_var.weight -= accum->fast_nscale;
+		fast_var.dscale = accum->dscale;
+
+		add_var(result, &fast_var, result);
+
+		free_var(&fast_var);
+	}
+
+	result->dscale = accum->dscale;
+
 	/* Remove leading/trailing zeroes */
 	strip_var(result);
 }
@@ -11122,6 +11347,8 @@ accum_sum_copy(NumericSumAccum *dst, NumericSumAccum *src)
 	dst->ndigits = src->ndigits;
 	dst->weight = src->weight;
 	dst->dscale = src->dscale;
+	dst->fast_nscale = src->fast_nscale;
+	dst->fastsum = src->fastsum;
 }
 
 /*
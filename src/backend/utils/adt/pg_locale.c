@@ -143,6 +143,7 @@ static void icu_set_collation_attributes(UCollator *collator, const char *loc);
 
 static char *get_collation_actual_version(char collprovider,
 										  const char *collcollate);
+static const pg_ascii_weights *build_ascii_weights(pg_locale_t locale);
 
 /*
  * pg_perm_setlocale
@@ -1631,6 +1632,192 @@ pg_newlocale_from_collation(Oid collid)
 	return cache_entry->locale;
 }
 
+/*
+ * Get ASCII weights for a libc collation (0 for the database default), or
+ * NULL if it has none.
+ *
+ * strcoll() is many times slower than memcmp(), even on plain ASCII strings.
+ * But most locales order strings of ASCII letters and digits by a simple
+ * rule: first by the sequence of the characters' primary weights, which
+ * don't distinguish case, and then by the sequence of their tertiary
+ * weights, which do.  We derive such weights for a collation from its own
+ * strcoll(), and then check that comparing by them agrees with strcoll() on
+ * all strings of one or two letters and digits, and on a sample of longer
+ * ones.  If it doesn't, as for locales with contractions like Czech "ch",
+ * the collation gets no weights.  pg_ascii_weights_cmp() compares strings
+ * by the weights.
+ *
+ * Building the weights takes a while, so it's only done if "build" is true;
+ * otherwise we return NULL if they haven't been built yet.
+ */
+const pg_ascii_weights *
+pg_locale_ascii_weights(pg_locale_t locale, bool build)
+{
+	static bool default_ascii_weights_done = false;
+	static const pg_ascii_weights *default_ascii_weights = NULL;
+
+	if (locale == NULL)
+	{
+		if (!default_ascii_weights_done && build)
+		{
+			default_ascii_weights = build_ascii_weights(NULL);
+			default_ascii_weights_done = true;
+		}
+		return default_ascii_weights;
+	}
+
+	if (locale->provider != COLLPROVIDER_LIBC || !locale->deterministic)
+		return NULL;
+
+	if (!locale->ascii_weights_done && build)
+	{
+		locale->ascii_weights = build_ascii_weights(locale);
+		locale->ascii_weights_done = true;
+	}
+	return locale->ascii_weights;
+}
+
+/*
+ * strcoll() on behalf of build_ascii_weights()
+ */
+static int
+ascii_weights_strcoll(const char *arg1, const char *arg2, pg_locale_t locale)
+{
+#ifdef HAVE_LOCALE_T
+	if (locale)
+		return strcoll_l(arg1, arg2, locale->info.lt);
+#endif
+	return strcoll(arg1, arg2);
+}
+
+/*
+ * qsort_arg() comparator for build_ascii_weights(): strcoll(), with strcmp()
+ * as the tie-breaker
+ */
+static int
+ascii_weights_qsort_cmp(const void *a, const void *b, void *arg)
+{
+	int			result;
+
+	result = ascii_weights_strcoll((const char *) a, (const char *) b,
+								   (pg_locale_t) arg);
+	if (result == 0)
+		result = strcmp((const char *) a, (const char *) b);
+	return result;
+}
+
+/* number of random strings of three or four characters to check */
+#define ASCII_WEIGHTS_SAMPLE	2000
+
+/*
+ * Work horse of pg_locale_ascii_weights()
+ */
+static const pg_ascii_weights *
+build_ascii_weights(pg_locale_t locale)
+{
+	static const char covered[] =
+	"0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+	const int	ncovered = sizeof(covered) - 1;
+	char		chars[sizeof(covered) - 1][2];
+	char		(*strs)[5];
+	int			nstrs;
+	pg_ascii_weights weights;
+	pg_ascii_weights *result;
+	uint8		primary = 1;
+	uint8		tertiary = 1;
+	uint32		seed = 1;
+	int			i,
+				j;
+
+#ifdef WIN32
+	/* varstr_cmp() uses wcscoll() rather than strcoll() for UTF-8 */
+	if (GetDatabaseEncoding() == PG_UTF8)
+		return NULL;
+#endif
+
+	/*
+	 * Sort the characters.  Neighbors have the same primary weight if they
+	 * sort the other way around once we append the greatest character to
+	 * the lesser one and the least character to the greater one.  The
+	 * tertiary weights just follow the sort order.
+	 */
+	for (i = 0; i < ncovered; i++)
+	{
+		chars[i][0] = covered[i];
+		chars[i][1] = '\0';
+	}
+	qsort_arg(chars, ncovered, sizeof(chars[0]), ascii_weights_qsort_cmp,
+			  locale);
+
+	memset(&weights, 0, sizeof(weights));
+	for (i = 0; i < ncovered; i++)
+	{
+		if (i > 0)
+		{
+			char		a[3] = {chars[i - 1][0], chars[ncovered - 1][0], '\0'};
+			char		b[3] = {chars[i][0], chars[0][0], '\0'};
+
+			if (ascii_weights_strcoll(a, b, locale) < 0)
+				primary++;
+			if (ascii_weights_strcoll(chars[i - 1], chars[i], locale) != 0)
+				tertiary++;
+		}
+		weights.primary[(unsigned char) chars[i][0]] = primary;
+		weights.tertiary[(unsigned char) chars[i][0]] = tertiary;
+	}
+
+	/*
+	 * Sort all strings of one or two characters, and a sample of longer
+	 * ones, and check that the weights put each in order with the next.
+	 * That means they agree with strcoll() on all pairs of these strings.
+	 */
+	strs = palloc((ncovered + ncovered * ncovered + ASCII_WEIGHTS_SAMPLE) *
+				  sizeof(*strs));
+	nstrs = 0;
+	for (i = 0; i < ncovered; i++)
+	{
+		snprintf(strs[nstrs++], sizeof(*strs), "%c", covered[i]);
+		for (j = 0; j < ncovered; j++)
+			snprintf(strs[nstrs++], sizeof(*strs), "%c%c",
+					 covered[i], covered[j]);
+	}
+	for (i = 0; i < ASCII_WEIGHTS_SAMPLE; i++)
+	{
+		int			len = 3 + i % 2;
+
+		for (j = 0; j < len; j++)
+		{
+			/* a simple LCG is plenty random enough for this */
+			seed = seed * 1103515245 + 12345;
+			strs[nstrs][j] = covered[(seed >> 16) % ncovered];
+		}
+		strs[nstrs++][len] = '\0';
+	}
+	qsort_arg(strs, nstrs, sizeof(*strs), ascii_weights_qsort_cmp, locale);
+
+	for (i = 0; i + 1 < nstrs; i++)
+	{
+		int			cmp;
+
+		if (strcmp(strs[i], strs[i + 1]) == 0)
+			continue;
+		if (!pg_ascii_weights_cmp(&weights,
+								  strs[i], strlen(strs[i]),
+								  strs[i + 1], strlen(strs[i + 1]),
+								  &cmp) ||
+			cmp >= 0)
+		{
+			pfree(strs);
+			return NULL;
+		}
+	}
+	pfree(strs);
+
+	result = MemoryContextAlloc(TopMemoryContext, sizeof(pg_ascii_weights));
+	memcpy(result, &weights, sizeof(pg_ascii_weights));
+	return result;
+}
+
 /*
  * Get provider-specific collation version string for the given collation from
  * the operating system/library.
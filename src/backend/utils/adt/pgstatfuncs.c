@@ -16,6 +16,7 @@
 
 #include "access/htup_details.h"
 #include "access/xlog.h"
+#include "access/xlog_internal.h"
 #include "catalog/pg_authid.h"
 #include "catalog/pg_type.h"
 #include "common/ip.h"
@@ -1703,7 +1704,7 @@ pg_stat_get_buf_alloc(PG_FUNCTION_ARGS)
 Datum
 pg_stat_get_wal(PG_FUNCTION_ARGS)
 {
-#define PG_STAT_GET_WAL_COLS	5
+#define PG_STAT_GET_WAL_COLS	7
 	TupleDesc	tupdesc;
 	Datum		values[PG_STAT_GET_WAL_COLS];
 	bool		nulls[PG_STAT_GET_WAL_COLS];
@@ -1724,7 +1725,11 @@ pg_stat_get_wal(PG_FUNCTION_ARGS)
 					   NUMERICOID, -1, 0);
 	TupleDescInitEntry(tupdesc, (AttrNumber) 4, "wal_buffers_full",
 					   INT8OID, -1, 0);
-	TupleDescInitEntry(tupdesc, (AttrNumber) 5, "stats_reset",
+	TupleDescInitEntry(tupdesc, (AttrNumber) 5, "wal_flushes",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 6, "wal_flush_requests",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 7, "stats_reset",
 					   TIMESTAMPTZOID, -1, 0);
 
 	BlessTupleDesc(tupdesc);
@@ -1744,12 +1749,96 @@ pg_stat_get_wal(PG_FUNCTION_ARGS)
 									Int32GetDatum(-1));
 
 	values[3] = Int64GetDatum(wal_stats->wal_buffers_full);
-	values[4] = TimestampTzGetDatum(wal_stats->stat_reset_timestamp);
+	values[4] = Int64GetDatum(wal_stats->wal_flushes);
+	values[5] = Int64GetDatum(wal_stats->wal_flush_requests);
+	values[6] = TimestampTzGetDatum(wal_stats->stat_reset_timestamp);
 
 	/* Returns the record as Datum */
 	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
 }
 
+/*
+ * Returns statistics of WAL activity per resource manager and record type.
+ * Record types that haven't been seen since the last reset are left out.
+ */
+Datum
+pg_stat_get_wal_records(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_WAL_RECORDS_COLS	7
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	PgStat_WalStats *wal_stats;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Get statistics about WAL activity */
+	wal_stats = pgstat_fetch_stat_wal();
+
+	for (int rmid = 0; rmid <= RM_MAX_ID; rmid++)
+	{
+		const RmgrData *rmgr = &RmgrTable[rmid];
+
+		for (int type = 0; type < PGSTAT_WAL_RECORD_TYPES; type++)
+		{
+			PgStat_WalRecordCounters *counters = &wal_stats->records[rmid][type];
+			Datum		values[PG_STAT_GET_WAL_RECORDS_COLS];
+			bool		nulls[PG_STAT_GET_WAL_RECORDS_COLS];
+			const char *id;
+
+			if (counters->records == 0)
+				continue;
+
+			MemSet(values, 0, sizeof(values));
+			MemSet(nulls, 0, sizeof(nulls));
+
+			values[0] = CStringGetTextDatum(rmgr->rm_name);
+			id = rmgr->rm_identify((uint8) (type << 4));
+			if (id != NULL)
+				values[1] = CStringGetTextDatum(id);
+			else
+				values[1] = CStringGetTextDatum(psprintf("UNKNOWN (%x)",
+														 type << 4));
+			values[2] = Int64GetDatum(counters->records);
+			values[3] = Int64GetDatum(counters->fpi);
+			values[4] = Int64GetDatum(counters->bytes);
+			values[5] = Int64GetDatum(counters->fpi_bytes);
+			values[6] = TimestampTzGetDatum(wal_stats->stat_reset_timestamp);
+
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		}
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
 /*
  * Returns statistics of SLRU caches.
  */
@@ -1827,6 +1916,186 @@ pg_stat_get_slru(PG_FUNCTION_ARGS)
 	return (Datum) 0;
 }
 
+/*
+ * Returns cumulative usage statistics of LWLock tranches.
+ */
+Datum
+pg_stat_get_lwlock(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_LWLOCK_COLS	5
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	LWLockTrancheUsage usage[NUM_LWLOCK_USAGE_SLOTS];
+	TimestampTz reset_time;
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	reset_time = LWLockGetUsage(usage);
+
+	for (i = 0; i < NUM_LWLOCK_USAGE_SLOTS; i++)
+	{
+		/* for each row */
+		Datum		values[PG_STAT_GET_LWLOCK_COLS];
+		bool		nulls[PG_STAT_GET_LWLOCK_COLS];
+		const char *name;
+
+		/* all extension tranches are counted in the last slot */
+		if (i < LWTRANCHE_FIRST_USER_DEFINED)
+			name = GetLWLockIdentifier(PG_WAIT_LWLOCK, i);
+		else
+			name = "extension";
+
+		/* skip unused individual LWLock numbers */
+		if (name[0] == '<')
+			continue;
+
+		MemSet(values, 0, sizeof(values));
+		MemSet(nulls, 0, sizeof(nulls));
+
+		values[0] = CStringGetTextDatum(name);
+		values[1] = Int64GetDatum(usage[i].acquisitions);
+		values[2] = Int64GetDatum(usage[i].contended);
+		/* convert microseconds to milliseconds */
+		values[3] = Float8GetDatum(((double) usage[i].wait_time) / 1000.0);
+		values[4] = TimestampTzGetDatum(reset_time);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+static const char *const io_object_names[IOOBJECT_NUM_TYPES] = {
+	"relation",
+	"temp relation",
+	"temp file"
+};
+
+static const char *const io_context_names[IOCONTEXT_NUM_TYPES] = {
+	"normal",
+	"bulkread",
+	"bulkwrite",
+	"vacuum"
+};
+
+/*
+ * Returns cumulative I/O statistics, one row per backend type, I/O object
+ * and I/O context.
+ */
+Datum
+pg_stat_get_io(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_IO_COLS	12
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	PgStat_IOStats *stats;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/* request I/O stats from the stat collector */
+	stats = pgstat_fetch_stat_io();
+
+	for (int bktype = 0; bktype < BACKEND_NUM_TYPES; bktype++)
+	{
+		/* skip process types that never do relation or temp file I/O */
+		if (bktype == B_INVALID || bktype == B_ARCHIVER ||
+			bktype == B_STATS_COLLECTOR || bktype == B_LOGGER)
+			continue;
+
+		for (int obj = 0; obj < IOOBJECT_NUM_TYPES; obj++)
+		{
+			for (int ctx = 0; ctx < IOCONTEXT_NUM_TYPES; ctx++)
+			{
+				Datum		values[PG_STAT_GET_IO_COLS];
+				bool		nulls[PG_STAT_GET_IO_COLS];
+				PgStat_IOCounters *counters = &stats->stats[bktype][obj][ctx];
+				int			col;
+
+				/* temp objects are never accessed through a strategy */
+				if (obj != IOOBJECT_RELATION && ctx != IOCONTEXT_NORMAL)
+					continue;
+
+				MemSet(values, 0, sizeof(values));
+				MemSet(nulls, 0, sizeof(nulls));
+
+				values[0] = CStringGetTextDatum(GetBackendTypeDesc(bktype));
+				values[1] = CStringGetTextDatum(io_object_names[obj]);
+				values[2] = CStringGetTextDatum(io_context_names[ctx]);
+				col = 3;
+				for (int op = 0; op < IOOP_NUM_TYPES; op++)
+				{
+					values[col++] = Int64GetDatum(counters->counts[op]);
+					/* convert microseconds to milliseconds */
+					values[col++] =
+						Float8GetDatum(((double) counters->times[op]) / 1000.0);
+				}
+				values[col] = TimestampTzGetDatum(stats->stat_reset_timestamp);
+
+				tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+			}
+		}
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
 Datum
 pg_stat_get_xact_numscans(PG_FUNCTION_ARGS)
 {
@@ -30,7 +30,9 @@
 #include "postgres.h"
 
 #include "catalog/pg_type.h"
+#include "common/hashfn.h"
 #include "funcapi.h"
+#include "lib/ilist.h"
 #include "miscadmin.h"
 #include "regex/regex.h"
 #include "utils/array.h"
@@ -74,12 +76,12 @@ typedef struct regexp_matches_ctx
  * Over time, an item's average position corresponds to its frequency of use.
  *
  * When we first create an entry, it's inserted at the front of
- * the array, dropping the entry at the end of the array if necessary to
+ * the list, dropping the entry at the end of the list if necessary to
  * make room.  (This might seem to be weighting the new entry too heavily,
  * but if we insert new entries further back, we'll be unable to adjust to
- * a sudden shift in the query mix where we are presented with MAX_CACHED_RES
- * never-before-seen items used circularly.  We ought to be able to handle
- * that case, so we have to insert at the front.)
+ * a sudden shift in the query mix where we are presented with
+ * regex_cache_size never-before-seen items used circularly.  We ought to be
+ * able to handle that case, so we have to insert at the front.)
  *
  * Knuth mentions a variant strategy in which a used item is moved up just
  * one place in the list.  Although he says this uses fewer comparisons on
@@ -88,26 +90,34 @@ typedef struct regexp_matches_ctx
  * A reusable pattern that isn't used at least as often as non-reusable
  * patterns are seen will "fail to keep up" and will drop off the end of the
  * cache.  With move-to-front, a reusable pattern is guaranteed to stay in
- * the cache as long as it's used at least once in every MAX_CACHED_RES uses.
+ * the cache as long as it's used at least once in every regex_cache_size
+ * uses.
+ *
+ * The list is doubly linked, so that moving an entry to the front is cheap
+ * however large the cache is made, and each entry carries a hash of its
+ * pattern, flags and collation, so that the search rarely needs to compare
+ * patterns that don't match.
  */
 
-/* this is the maximum number of cached regular expressions */
-#ifndef MAX_CACHED_RES
-#define MAX_CACHED_RES	32
-#endif
+/* GUC parameter: the maximum number of cached regular expressions */
+int			regex_cache_size = 32;
 
 /* this structure describes one cached regular expression */
 typedef struct cached_re_str
 {
+	dlist_node	cre_node;		/* link in re_list */
+	uint32		cre_hash;		/* hash of pattern, flags and collation */
 	char	   *cre_pat;		/* original RE (not null terminated!) */
 	int			cre_pat_len;	/* length of original RE, in bytes */
 	int			cre_flags;		/* compile flags: extended,icase etc */
 	Oid			cre_collation;	/* collation to use */
+	char	   *cre_literal;	/* string every match must contain */
+	int			cre_literal_len;	/* its length in bytes, or 0 if none */
 	regex_t		cre_re;			/* the compiled regular expression */
 } cached_re_str;
 
 static int	num_res = 0;		/* # of cached re's */
-static cached_re_str re_array[MAX_CACHED_RES];	/* cached re's */
+static dlist_head re_list = DLIST_STATIC_INIT(re_list); /* cached re's */
 
 
 /* Local functions */
@@ -119,6 +129,14 @@ static regexp_matches_ctx *setup_regexp_matches(text *orig_str, text *pattern,
 												bool fetching_unmatched);
 static ArrayType *build_regexp_match_result(regexp_matches_ctx *matchctx);
 static Datum build_regexp_split_result(regexp_matches_ctx *splitctx);
+static cached_re_str *RE_compile_and_cache_entry(text *text_re, int cflags,
+												 Oid collation);
+static int	RE_required_literal(const char *pattern, int pattern_len,
+								int cflags, char *literal);
+static const char *RE_skip_bracket(const char *p, const char *end);
+static const char *RE_skip_group(const char *p, const char *end);
+static bool RE_contains_literal(cached_re_str *cre, const char *dat,
+								int dat_len);
 
 
 /*
@@ -135,39 +153,55 @@ static Datum build_regexp_split_result(regexp_matches_ctx *splitctx);
  */
 regex_t *
 RE_compile_and_cache(text *text_re, int cflags, Oid collation)
+{
+	return &RE_compile_and_cache_entry(text_re, cflags, collation)->cre_re;
+}
+
+/*
+ * RE_compile_and_cache_entry - guts of RE_compile_and_cache
+ *
+ * Returns the cache entry, which includes the RE's required literal.
+ */
+static cached_re_str *
+RE_compile_and_cache_entry(text *text_re, int cflags, Oid collation)
 {
 	int			text_re_len = VARSIZE_ANY_EXHDR(text_re);
 	char	   *text_re_val = VARDATA_ANY(text_re);
 	pg_wchar   *pattern;
 	int			pattern_len;
-	int			i;
+	uint32		hash;
+	dlist_iter	iter;
 	int			regcomp_result;
 	cached_re_str re_temp;
+	cached_re_str *re_new;
+	char	   *literal;
 	char		errMsg[100];
 
+	hash = hash_bytes((const unsigned char *) text_re_val, text_re_len);
+	hash = hash_combine(hash, (uint32) cflags);
+	hash = hash_combine(hash, (uint32) collation);
+
 	/*
 	 * Look for a match among previously compiled REs.  Since the data
 	 * structure is self-organizing with most-used entries at the front, our
 	 * search strategy can just be to scan from the front.
 	 */
-	for (i = 0; i < num_res; i++)
+	dlist_foreach(iter, &re_list)
 	{
-		if (re_array[i].cre_pat_len == text_re_len &&
-			re_array[i].cre_flags == cflags &&
-			re_array[i].cre_collation == collation &&
-			memcmp(re_array[i].cre_pat, text_re_val, text_re_len) == 0)
+		cached_re_str *cre = dlist_container(cached_re_str, cre_node, iter.cur);
+
+		if (cre->cre_hash == hash &&
+			cre->cre_pat_len == text_re_len &&
+			cre->cre_flags == cflags &&
+			cre->cre_collation == collation &&
+			memcmp(cre->cre_pat, text_re_val, text_re_len) == 0)
 		{
 			/*
 			 * Found a match; move it to front if not there already.
 			 */
-			if (i > 0)
-			{
-				re_temp = re_array[i];
-				memmove(&re_array[1], &re_array[0], i * sizeof(cached_re_str));
-				re_array[0] = re_temp;
-			}
+			dlist_move_head(&re_list, &cre->cre_node);
 
-			return &re_array[0].cre_re;
+			return cre;
 		}
 	}
 
@@ -208,44 +242,354 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 				 errmsg("invalid regular expression: %s", errMsg)));
 	}
 
+	/* Extract a string that every match must contain, if there is one */
+	literal = palloc(Max(text_re_len, 1));
+	re_temp.cre_literal_len = RE_required_literal(text_re_val, text_re_len,
+												  cflags, literal);
+
 	/*
-	 * We use malloc/free for the cre_pat field because the storage has to
-	 * persist across transactions, and because we want to get control back on
-	 * out-of-memory.  The Max() is because some malloc implementations return
-	 * NULL for malloc(0).
+	 * We use malloc/free for the cache entry and the cre_pat field because
+	 * the storage has to persist across transactions, and because we want to
+	 * get control back on out-of-memory.  The pattern and the required
+	 * literal share one allocation.  The Max() is because some malloc
+	 * implementations return NULL for malloc(0).
 	 */
-	re_temp.cre_pat = malloc(Max(text_re_len, 1));
-	if (re_temp.cre_pat == NULL)
+	re_new = malloc(sizeof(cached_re_str));
+	re_temp.cre_pat = malloc(Max(text_re_len + re_temp.cre_literal_len, 1));
+	if (re_new == NULL || re_temp.cre_pat == NULL)
 	{
 		pg_regfree(&re_temp.cre_re);
+		if (re_new)
+			free(re_new);
+		if (re_temp.cre_pat)
+			free(re_temp.cre_pat);
 		ereport(ERROR,
 				(errcode(ERRCODE_OUT_OF_MEMORY),
 				 errmsg("out of memory")));
 	}
 	memcpy(re_temp.cre_pat, text_re_val, text_re_len);
 	re_temp.cre_pat_len = text_re_len;
+	re_temp.cre_literal = re_temp.cre_pat + text_re_len;
+	memcpy(re_temp.cre_literal, literal, re_temp.cre_literal_len);
+	re_temp.cre_hash = hash;
 	re_temp.cre_flags = cflags;
 	re_temp.cre_collation = collation;
 
+	pfree(literal);
+
 	/*
-	 * Okay, we have a valid new item in re_temp; insert it into the storage
-	 * array.  Discard last entry if needed.
+	 * Okay, we have a valid new item in re_temp; insert it into the list.
+	 * Discard entries from the end if needed; there can be more than one to
+	 * discard if regex_cache_size was reduced.
 	 */
-	if (num_res >= MAX_CACHED_RES)
+	while (num_res >= regex_cache_size && num_res > 0)
 	{
-		--num_res;
-		Assert(num_res < MAX_CACHED_RES);
-		pg_regfree(&re_array[num_res].cre_re);
-		free(re_array[num_res].cre_pat);
+		cached_re_str *cre = dlist_container(cached_re_str, cre_node,
+											 dlist_tail_node(&re_list));
+
+		dlist_delete(&cre->cre_node);
+		pg_regfree(&cre->cre_re);
+		free(cre->cre_pat);
+		free(cre);
+		num_res--;
 	}
 
-	if (num_res > 0)
-		memmove(&re_array[1], &re_array[0], num_res * sizeof(cached_re_str));
-
-	re_array[0] = re_temp;
+	*re_new = re_temp;
+	dlist_push_head(&re_list, &re_new->cre_node);
 	num_res++;
 
-	return &re_array[0].cre_re;
+	return re_new;
+}
+
+/*
+ * RE_required_literal - find a string that every match of a RE must contain
+ *
+ * Returns the length of the string, which is stored into *literal (which
+ * must have room for pattern_len bytes), or 0 if we don't find one.  Before
+ * running the regex engine, we can cheaply rule out data that doesn't
+ * contain this string.
+ *
+ * This is a conservative scan of the pattern text, not an analysis of the
+ * compiled RE: it only handles AREs without case folding or expanded
+ * syntax, and only looks at the top level of the pattern, which must not
+ * contain alternatives.  Characters there that aren't followed by a
+ * quantifier must appear in any match, in order, so each run of them is a
+ * required string; we return the longest.  Anything we don't understand
+ * ends a run, or if it might make earlier characters optional, makes us give
+ * up.
+ */
+static int
+RE_required_literal(const char *pattern, int pattern_len, int cflags,
+					char *literal)
+{
+	const char *p = pattern;
+	const char *end = pattern + pattern_len;
+	char	   *run;
+	int			runlen = 0;
+	int			lastlen = 0;	/* length of the run's last character */
+	int			bestlen = 0;
+
+	if ((cflags & REG_ADVANCED) != REG_ADVANCED ||
+		(cflags & (REG_QUOTE | REG_ICASE | REG_EXPANDED)) != 0)
+		return 0;
+
+	/* Handle the ARE "director" prefixes */
+	if (pattern_len >= 4 && strncmp(p, "***", 3) == 0)
+	{
+		if (p[3] == '=')
+		{
+			/* the rest of the pattern is a literal string */
+			memcpy(literal, p + 4, pattern_len - 4);
+			return pattern_len - 4;
+		}
+		else if (p[3] != ':')
+			return 0;
+		p += 4;
+	}
+
+	/* Embedded options could change the meaning of anything that follows */
+	if (end - p >= 2 && p[0] == '(' && p[1] == '?')
+		return 0;
+
+	run = palloc(pattern_len);
+
+/* end the current run, remembering it if it's the longest so far */
+#define END_RUN() \
+	do { \
+		if (runlen > bestlen) \
+		{ \
+			memcpy(literal, run, runlen); \
+			bestlen = runlen; \
+		} \
+		runlen = 0; \
+		lastlen = 0; \
+	} while (0)
+
+	while (p < end)
+	{
+		switch (*p)
+		{
+			case '|':
+				/* with alternatives at top level, nothing is required */
+				pfree(run);
+				return 0;
+
+			case '*':
+			case '?':
+			case '{':
+				/* quantifier that may allow zero repetitions */
+				runlen -= lastlen;
+				END_RUN();
+				if (*p == '{')
+				{
+					/* skip the bound; don't try to handle anything else */
+					if (p + 1 < end && isdigit((unsigned char) p[1]))
+						p = memchr(p, '}', end - p);
+					else
+						p = NULL;
+					if (p == NULL)
+					{
+						pfree(run);
+						return 0;
+					}
+				}
+				p++;
+				break;
+
+			case '+':
+				/*
+				 * The last character is required, but may repeat, unless
+				 * another quantifier follows; to be safe, don't try to work
+				 * out what that combination means.
+				 */
+				if (p + 1 < end && strchr("*+?{", p[1]) != NULL)
+					runlen -= lastlen;
+				END_RUN();
+				p++;
+				break;
+
+			case '\\':
+				if (p + 1 >= end)
+				{
+					pfree(run);
+					return 0;
+				}
+				if (!isalnum((unsigned char) p[1]) && !IS_HIGHBIT_SET(p[1]))
+				{
+					/* an escaped ordinary character */
+					run[runlen++] = p[1];
+					lastlen = 1;
+				}
+				else if (strchr("dDsSwWmMyYAZ", p[1]) != NULL)
+				{
+					/* class-shorthand or constraint escape */
+					END_RUN();
+				}
+				else
+				{
+					/* other escapes may take arguments; don't try */
+					pfree(run);
+					return 0;
+				}
+				p += 2;
+				break;
+
+			case '[':
+				END_RUN();
+				p = RE_skip_bracket(p, end);
+				if (p == NULL)
+				{
+					pfree(run);
+					return 0;
+				}
+				break;
+
+			case '(':
+				END_RUN();
+				p = RE_skip_group(p, end);
+				if (p == NULL)
+				{
+					pfree(run);
+					return 0;
+				}
+				break;
+
+			case '.':
+			case '^':
+			case '$':
+			case ')':
+			case ']':
+			case '}':
+				END_RUN();
+				p++;
+				break;
+
+			default:
+				{
+					int			len = pg_mblen(p);
+
+					if (len > end - p)
+						len = end - p;
+					memcpy(run + runlen, p, len);
+					runlen += len;
+					lastlen = len;
+					p += len;
+				}
+				break;
+		}
+	}
+	END_RUN();
+
+#undef END_RUN
+
+	pfree(run);
+
+	return bestlen;
+}
+
+/*
+ * Skip over a bracket expression in an ARE.  p points at the opening '['.
+ * Returns a pointer just past the closing ']', or NULL if there is none.
+ */
+static const char *
+RE_skip_bracket(const char *p, const char *end)
+{
+	p++;
+	if (p < end && *p == '^')
+		p++;
+	if (p < end && *p == ']')
+		p++;
+	while (p < end && *p != ']')
+	{
+		if (*p == '[' && p + 1 < end &&
+			(p[1] == ':' || p[1] == '.' || p[1] == '='))
+		{
+			/* character class, collating element or equivalence class */
+			char		delim = p[1];
+
+			p += 2;
+			while (p + 1 < end && !(p[0] == delim && p[1] == ']'))
+				p++;
+			if (p + 1 >= end)
+				return NULL;
+			p += 2;
+		}
+		else if (*p == '\\')
+			p += 2;
+		else
+			p++;
+	}
+	if (p >= end)
+		return NULL;
+	return p + 1;
+}
+
+/*
+ * Skip over a parenthesized group in an ARE.  p points at the opening '('.
+ * Returns a pointer just past the matching ')', or NULL if there is none.
+ */
+static const char *
+RE_skip_group(const char *p, const char *end)
+{
+	int			depth = 0;
+
+	while (p < end)
+	{
+		switch (*p)
+		{
+			case '(':
+				depth++;
+				p++;
+				break;
+			case ')':
+				if (--depth == 0)
+					return p + 1;
+				p++;
+				break;
+			case '\\':
+				p += 2;
+				break;
+			case '[':
+				p = RE_skip_bracket(p, end);
+				if (p == NULL)
+					return NULL;
+				break;
+			default:
+				p++;
+				break;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * RE_contains_literal - can data that must be matched against a cached RE
+ * possibly match it?
+ *
+ * Returns false if the data doesn't contain the RE's required literal.
+ */
+static bool
+RE_contains_literal(cached_re_str *cre, const char *dat, int dat_len)
+{
+	const char *lit = cre->cre_literal;
+	int			lit_len = cre->cre_literal_len;
+	const char *p = dat;
+	const char *last = dat + dat_len - lit_len;
+
+	if (lit_len == 0)
+		return true;
+
+	/* look for the first byte with memchr(), then compare the rest */
+	while (p <= last)
+	{
+		p = memchr(p, lit[0], last - p + 1);
+		if (p == NULL)
+			return false;
+		if (memcmp(p + 1, lit + 1, lit_len - 1) == 0)
+			return true;
+		p++;
+	}
+	return false;
 }
 
 /*
@@ -344,12 +688,16 @@ RE_compile_and_execute(text *text_re, char *dat, int dat_len,
 					   int cflags, Oid collation,
 					   int nmatch, regmatch_t *pmatch)
 {
-	regex_t    *re;
+	cached_re_str *cre;
 
 	/* Compile RE */
-	re = RE_compile_and_cache(text_re, cflags, collation);
+	cre = RE_compile_and_cache_entry(text_re, cflags, collation);
+
+	/* Skip the regex engine if the data can't match */
+	if (!RE_contains_literal(cre, dat, dat_len))
+		return false;
 
-	return RE_execute(re, dat, dat_len, nmatch, pmatch);
+	return RE_execute(&cre->cre_re, dat, dat_len, nmatch, pmatch);
 }
 
 
@@ -41,6 +41,7 @@
 #include "parser/parse_relation.h"
 #include "storage/bufmgr.h"
 #include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
 #include "utils/fmgroids.h"
@@ -71,13 +72,14 @@
 /* these queries are executed against the PK (referenced) table: */
 #define RI_PLAN_CHECK_LOOKUPPK			1
 #define RI_PLAN_CHECK_LOOKUPPK_FROM_PK	2
-#define RI_PLAN_LAST_ON_PK				RI_PLAN_CHECK_LOOKUPPK_FROM_PK
+#define RI_PLAN_CHECK_LOOKUPPK_BATCH	3
+#define RI_PLAN_LAST_ON_PK				RI_PLAN_CHECK_LOOKUPPK_BATCH
 /* these queries are executed against the FK (referencing) table: */
-#define RI_PLAN_CASCADE_DEL_DODELETE	3
-#define RI_PLAN_CASCADE_UPD_DOUPDATE	4
-#define RI_PLAN_RESTRICT_CHECKREF		5
-#define RI_PLAN_SETNULL_DOUPDATE		6
-#define RI_PLAN_SETDEFAULT_DOUPDATE		7
+#define RI_PLAN_CASCADE_DEL_DODELETE	4
+#define RI_PLAN_CASCADE_UPD_DOUPDATE	5
+#define RI_PLAN_RESTRICT_CHECKREF		6
+#define RI_PLAN_SETNULL_DOUPDATE		7
+#define RI_PLAN_SETDEFAULT_DOUPDATE		8
 
 #define MAX_QUOTED_NAME_LEN  (NAMEDATALEN*2+3)
 #define MAX_QUOTED_REL_NAME_LEN  (MAX_QUOTED_NAME_LEN*2)
@@ -160,6 +162,38 @@ typedef struct RI_CompareHashEntry
 } RI_CompareHashEntry;
 
 
+/*
+ * RI_CheckBatch
+ *
+ * FK rows whose check against the PK table has been postponed, so that it
+ * can be done for many rows with a single query; see ri_QueueCheck().
+ * There is one of these for each constraint that has been checked in the
+ * current transaction.
+ */
+typedef struct RI_CheckBatch
+{
+	Oid			constraint_id;	/* OID of pg_constraint entry (hash key) */
+	bool		batchable;		/* can the key columns be batched? */
+	int			nkeys;			/* number of key columns */
+	Oid			elemtypes[RI_MAX_NUMKEYS];	/* base types of FK columns */
+	Oid			arraytypes[RI_MAX_NUMKEYS]; /* array types of those */
+	int16		typlens[RI_MAX_NUMKEYS];
+	bool		typbyvals[RI_MAX_NUMKEYS];
+	char		typaligns[RI_MAX_NUMKEYS];
+	int			nitems;			/* number of queued rows */
+	int			maxitems;		/* allocated length of arrays below */
+	Datum	   *values;			/* key values, nkeys per queued row */
+	ItemPointerData *tids;		/* TIDs of queued rows */
+	int		   *nestlevels;		/* subxact nest level each row was queued at */
+	MemoryContext valuecxt;		/* holds pass-by-reference key values */
+} RI_CheckBatch;
+
+
+/*
+ * GUC variable
+ */
+int			foreign_key_check_batch_size = 0;
+
 /*
  * Local data
  */
@@ -169,10 +203,21 @@ static HTAB *ri_compare_cache = NULL;
 static dlist_head ri_constraint_cache_valid_list;
 static int	ri_constraint_cache_valid_count = 0;
 
+/* batched checks, see ri_QueueCheck(); all of this is transaction-lifespan */
+static MemoryContext ri_batch_cxt = NULL;
+static HTAB *ri_batch_hash = NULL;
+static List *ri_batch_list = NIL;	/* batches, in order of creation */
+static int	ri_batch_pending = 0;	/* total queued rows */
+
 
 /*
  * Local function prototypes
  */
+static void ri_CheckFKeyRow(const RI_ConstraintInfo *riinfo, Relation fk_rel,
+							TupleTableSlot *newslot, bool allow_batch);
+static bool ri_QueueCheck(const RI_ConstraintInfo *riinfo, Relation fk_rel,
+						  TupleTableSlot *newslot);
+static void ri_FlushBatch(RI_CheckBatch *batch, int nestlevel);
 static bool ri_Check_Pk_Match(Relation pk_rel, Relation fk_rel,
 							  TupleTableSlot *oldslot,
 							  const RI_ConstraintInfo *riinfo);
@@ -232,11 +277,7 @@ static Datum
 RI_FKey_check(TriggerData *trigdata)
 {
 	const RI_ConstraintInfo *riinfo;
-	Relation	fk_rel;
-	Relation	pk_rel;
 	TupleTableSlot *newslot;
-	RI_QueryKey qkey;
-	SPIPlanPtr	qplan;
 
 	riinfo = ri_FetchConstraintInfo(trigdata->tg_trigger,
 									trigdata->tg_relation, false);
@@ -246,6 +287,26 @@ RI_FKey_check(TriggerData *trigdata)
 	else
 		newslot = trigdata->tg_trigslot;
 
+	ri_CheckFKeyRow(riinfo, trigdata->tg_relation, newslot, true);
+
+	return PointerGetDatum(NULL);
+}
+
+/*
+ * ri_CheckFKeyRow -
+ *
+ * Check that a row of the FK table has a matching row in the PK table.  If
+ * allow_batch is true, the check may instead be queued, to be done later
+ * together with those of other rows.
+ */
+static void
+ri_CheckFKeyRow(const RI_ConstraintInfo *riinfo, Relation fk_rel,
+				TupleTableSlot *newslot, bool allow_batch)
+{
+	Relation	pk_rel;
+	RI_QueryKey qkey;
+	SPIPlanPtr	qplan;
+
 	/*
 	 * We should not even consider checking the row if it is no longer valid,
 	 * since it was either deleted (so the deferred check should be skipped)
@@ -254,16 +315,15 @@ RI_FKey_check(TriggerData *trigdata)
 	 * and lock on the buffer to call HeapTupleSatisfiesVisibility.  Caller
 	 * should be holding pin, but not lock.
 	 */
-	if (!table_tuple_satisfies_snapshot(trigdata->tg_relation, newslot, SnapshotSelf))
-		return PointerGetDatum(NULL);
+	if (!table_tuple_satisfies_snapshot(fk_rel, newslot, SnapshotSelf))
+		return;
 
 	/*
-	 * Get the relation descriptors of the FK and PK tables.
+	 * Get the relation descriptor of the PK table.
 	 *
 	 * pk_rel is opened in RowShareLock mode since that's what our eventual
 	 * SELECT FOR KEY SHARE will get on it.
 	 */
-	fk_rel = trigdata->tg_relation;
 	pk_rel = table_open(riinfo->pk_relid, RowShareLock);
 
 	switch (ri_NullCheck(RelationGetDescr(fk_rel), newslot, riinfo, false))
@@ -275,7 +335,7 @@ RI_FKey_check(TriggerData *trigdata)
 			 * foreign key constraint.
 			 */
 			table_close(pk_rel, RowShareLock);
-			return PointerGetDatum(NULL);
+			return;
 
 		case RI_KEYS_SOME_NULL:
 
@@ -300,7 +360,7 @@ RI_FKey_check(TriggerData *trigdata)
 							 errtableconstraint(fk_rel,
 												NameStr(riinfo->conname))));
 					table_close(pk_rel, RowShareLock);
-					return PointerGetDatum(NULL);
+					return;
 
 				case FKCONSTR_MATCH_SIMPLE:
 
@@ -309,7 +369,7 @@ RI_FKey_check(TriggerData *trigdata)
 					 * the constraint.
 					 */
 					table_close(pk_rel, RowShareLock);
-					return PointerGetDatum(NULL);
+					return;
 
 #ifdef NOT_USED
 				case FKCONSTR_MATCH_PARTIAL:
@@ -333,6 +393,14 @@ RI_FKey_check(TriggerData *trigdata)
 			break;
 	}
 
+	/* Postpone the check, if we can do it together with other rows' */
+	if (allow_batch && foreign_key_check_batch_size > 0 &&
+		ri_QueueCheck(riinfo, fk_rel, newslot))
+	{
+		table_close(pk_rel, RowShareLock);
+		return;
+	}
+
 	if (SPI_connect() != SPI_OK_CONNECT)
 		elog(ERROR, "SPI_connect failed");
 
@@ -399,8 +467,434 @@ RI_FKey_check(TriggerData *trigdata)
 		elog(ERROR, "SPI_finish failed");
 
 	table_close(pk_rel, RowShareLock);
+}
 
-	return PointerGetDatum(NULL);
+/*
+ * ri_QueueCheck -
+ *
+ * Queue the check of an FK row, whose key columns are known to be all
+ * non-null, instead of doing it right away.  Returns false if the
+ * constraint's checks can't be batched.
+ *
+ * The queued rows of a constraint are checked by ri_FlushBatch(), with a
+ * single query that looks up the keys of all of them.  That happens when
+ * foreign_key_check_batch_size rows have been queued, and otherwise at the
+ * end of the current round of trigger firing; see RI_FlushPendingChecks().
+ */
+static bool
+ri_QueueCheck(const RI_ConstraintInfo *riinfo, Relation fk_rel,
+			  TupleTableSlot *newslot)
+{
+	RI_CheckBatch *batch;
+	MemoryContext oldcxt;
+	Datum	   *values;
+	bool		found;
+
+	if (ri_batch_hash == NULL)
+	{
+		HASHCTL		ctl;
+
+		ri_batch_cxt = AllocSetContextCreate(TopTransactionContext,
+											 "RI check batches",
+											 ALLOCSET_DEFAULT_SIZES);
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(Oid);
+		ctl.entrysize = sizeof(RI_CheckBatch);
+		ctl.hcxt = ri_batch_cxt;
+		ri_batch_hash = hash_create("RI check batches", 16, &ctl,
+									HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	batch = (RI_CheckBatch *) hash_search(ri_batch_hash,
+										  &riinfo->constraint_id,
+										  HASH_ENTER, &found);
+	if (!found)
+	{
+		batch->batchable = true;
+		batch->nkeys = riinfo->nkeys;
+		for (int i = 0; i < riinfo->nkeys; i++)
+		{
+			Oid			elemtype;
+
+			elemtype = getBaseType(RIAttType(fk_rel, riinfo->fk_attnums[i]));
+			batch->elemtypes[i] = elemtype;
+			batch->arraytypes[i] = get_array_type(elemtype);
+			if (!OidIsValid(batch->arraytypes[i]))
+				batch->batchable = false;
+			get_typlenbyvalalign(elemtype, &batch->typlens[i],
+								 &batch->typbyvals[i], &batch->typaligns[i]);
+		}
+		batch->nitems = 0;
+		batch->maxitems = 0;
+		batch->values = NULL;
+		batch->tids = NULL;
+		batch->nestlevels = NULL;
+		batch->valuecxt = AllocSetContextCreate(ri_batch_cxt,
+												"RI check batch values",
+												ALLOCSET_DEFAULT_SIZES);
+
+		oldcxt = MemoryContextSwitchTo(ri_batch_cxt);
+		ri_batch_list = lappend(ri_batch_list, batch);
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	if (!batch->batchable)
+		return false;
+
+	/* Make room for the row */
+	if (batch->nitems >= batch->maxitems)
+	{
+		int			newmax = Max(batch->maxitems * 2, 64);
+
+		oldcxt = MemoryContextSwitchTo(ri_batch_cxt);
+		if (batch->maxitems == 0)
+		{
+			batch->values = palloc(newmax * batch->nkeys * sizeof(Datum));
+			batch->tids = palloc(newmax * sizeof(ItemPointerData));
+			batch->nestlevels = palloc(newmax * sizeof(int));
+		}
+		else
+		{
+			batch->values = repalloc(batch->values,
+									 newmax * batch->nkeys * sizeof(Datum));
+			batch->tids = repalloc(batch->tids,
+								   newmax * sizeof(ItemPointerData));
+			batch->nestlevels = repalloc(batch->nestlevels,
+										 newmax * sizeof(int));
+		}
+		MemoryContextSwitchTo(oldcxt);
+		batch->maxitems = newmax;
+	}
+
+	/*
+	 * Remember the key and the TID of the row.  The TID lets us fetch the
+	 * row again, if we have to report a violation.
+	 */
+	values = batch->values + batch->nitems * batch->nkeys;
+	oldcxt = MemoryContextSwitchTo(batch->valuecxt);
+	for (int i = 0; i < batch->nkeys; i++)
+	{
+		bool		isnull;
+
+		values[i] = slot_getattr(newslot, riinfo->fk_attnums[i], &isnull);
+		Assert(!isnull);
+		values[i] = datumCopy(values[i], batch->typbyvals[i],
+							  batch->typlens[i]);
+	}
+	MemoryContextSwitchTo(oldcxt);
+	batch->tids[batch->nitems] = newslot->tts_tid;
+	batch->nestlevels[batch->nitems] = GetCurrentTransactionNestLevel();
+	batch->nitems++;
+	ri_batch_pending++;
+
+	if (batch->nitems >= foreign_key_check_batch_size)
+		ri_FlushBatch(batch, GetCurrentTransactionNestLevel());
+
+	return true;
+}
+
+/*
+ * ri_FlushBatch -
+ *
+ * Check the rows of a batch that were queued at transaction nest level
+ * nestlevel or deeper, and remove them from the batch.  Rows queued by
+ * outer transaction levels stay queued, so that the PK rows they reference
+ * don't end up locked by a subtransaction that may still be rolled back.
+ */
+static void
+ri_FlushBatch(RI_CheckBatch *batch, int nestlevel)
+{
+	const RI_ConstraintInfo *riinfo;
+	Relation	fk_rel;
+	Relation	pk_rel;
+	RI_QueryKey qkey;
+	SPIPlanPtr	qplan;
+	MemoryContext flushcxt;
+	MemoryContext oldcxt;
+	int		   *items;
+	ItemPointerData *tids;
+	bool	   *found;
+	int			nsel = 0;
+	int			nkept = 0;
+	Datum		vals[RI_MAX_NUMKEYS];
+	Oid			save_userid;
+	int			save_sec_context;
+	int			spi_result;
+	TupleTableSlot *slot = NULL;
+
+	flushcxt = AllocSetContextCreate(CurrentMemoryContext,
+									 "RI check batch flush",
+									 ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(flushcxt);
+
+	/* Pick out the rows to check */
+	items = (int *) palloc(batch->nitems * sizeof(int));
+	tids = (ItemPointerData *) palloc(batch->nitems * sizeof(ItemPointerData));
+	for (int i = 0; i < batch->nitems; i++)
+	{
+		if (batch->nestlevels[i] >= nestlevel)
+		{
+			items[nsel] = i;
+			tids[nsel] = batch->tids[i];
+			nsel++;
+		}
+	}
+	if (nsel == 0)
+	{
+		MemoryContextSwitchTo(oldcxt);
+		MemoryContextDelete(flushcxt);
+		return;
+	}
+	found = (bool *) palloc0(nsel * sizeof(bool));
+
+	/* Build an array of each key column's values */
+	for (int k = 0; k < batch->nkeys; k++)
+	{
+		Datum	   *elems = (Datum *) palloc(nsel * sizeof(Datum));
+
+		for (int j = 0; j < nsel; j++)
+			elems[j] = batch->values[items[j] * batch->nkeys + k];
+		vals[k] = PointerGetDatum(construct_array(elems, nsel,
+												  batch->elemtypes[k],
+												  batch->typlens[k],
+												  batch->typbyvals[k],
+												  batch->typaligns[k]));
+	}
+
+	/*
+	 * The FK table is still locked by the statement that queued the rows,
+	 * since that lock is held until end of transaction.
+	 */
+	riinfo = ri_LoadConstraintInfo(batch->constraint_id);
+	fk_rel = table_open(riinfo->fk_relid, NoLock);
+	pk_rel = table_open(riinfo->pk_relid, RowShareLock);
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+
+	/* Fetch or prepare a saved plan for the batched check */
+	ri_BuildQueryKey(&qkey, riinfo, RI_PLAN_CHECK_LOOKUPPK_BATCH);
+
+	if ((qplan = ri_FetchPreparedPlan(&qkey)) == NULL)
+	{
+		StringInfoData querybuf;
+		char		pkrelname[MAX_QUOTED_REL_NAME_LEN];
+		char		attname[MAX_QUOTED_NAME_LEN];
+		char		leftop[MAX_QUOTED_NAME_LEN + 2];
+		char		rightop[16];
+		const char *querysep;
+		const char *pk_only;
+
+		/* ----------
+		 * The query string built is
+		 *	SELECT k.ord FROM unnest($1 [, ...]) WITH ORDINALITY
+		 *		   k(k1 [, ...], ord), [ONLY] <pktable> x
+		 *		   WHERE x.pkatt1 = k.k1 [AND ...] FOR KEY SHARE OF x
+		 * The type id's for the $ parameters are the array types of the
+		 * (base types of the) corresponding FK attributes.  The query
+		 * returns the array positions of the keys that were found.
+		 * ----------
+		 */
+		initStringInfo(&querybuf);
+		pk_only = pk_rel->rd_rel->relkind == RELKIND_PARTITIONED_TABLE ?
+			"" : "ONLY ";
+		quoteRelationName(pkrelname, pk_rel);
+		appendStringInfoString(&querybuf, "SELECT k.ord FROM unnest(");
+		for (int i = 0; i < riinfo->nkeys; i++)
+			appendStringInfo(&querybuf, "%s$%d", i > 0 ? ", " : "", i + 1);
+		appendStringInfoString(&querybuf, ") WITH ORDINALITY k(");
+		for (int i = 0; i < riinfo->nkeys; i++)
+			appendStringInfo(&querybuf, "k%d, ", i + 1);
+		appendStringInfo(&querybuf, "ord), %s%s x", pk_only, pkrelname);
+		querysep = "WHERE";
+		for (int i = 0; i < riinfo->nkeys; i++)
+		{
+			Oid			pk_type = RIAttType(pk_rel, riinfo->pk_attnums[i]);
+
+			quoteOneName(attname,
+						 RIAttName(pk_rel, riinfo->pk_attnums[i]));
+			sprintf(leftop, "x.%s", attname);
+			sprintf(rightop, "k.k%d", i + 1);
+			ri_GenerateQual(&querybuf, querysep,
+							leftop, pk_type,
+							riinfo->pf_eq_oprs[i],
+							rightop, batch->elemtypes[i]);
+			querysep = "AND";
+		}
+		appendStringInfoString(&querybuf, " FOR KEY SHARE OF x");
+
+		/* Prepare and save the plan */
+		qplan = ri_PlanCheck(querybuf.data, riinfo->nkeys, batch->arraytypes,
+							 &qkey, fk_rel, pk_rel);
+	}
+
+	/* Look up the keys, as the PK table's owner; see ri_PerformCheck() */
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(RelationGetForm(pk_rel)->relowner,
+						   save_sec_context | SECURITY_LOCAL_USERID_CHANGE |
+						   SECURITY_NOFORCE_RLS);
+
+	spi_result = SPI_execute_snapshot(qplan, vals, NULL,
+									  InvalidSnapshot, InvalidSnapshot,
+									  false, false, 0);
+
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+
+	if (spi_result < 0)
+		elog(ERROR, "SPI_execute_snapshot returned %s", SPI_result_code_string(spi_result));
+
+	if (spi_result != SPI_OK_SELECT)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("referential integrity query on \"%s\" from constraint \"%s\" on \"%s\" gave unexpected result",
+						RelationGetRelationName(pk_rel),
+						NameStr(riinfo->conname),
+						RelationGetRelationName(fk_rel)),
+				 errhint("This is most likely due to a rule having rewritten the query.")));
+
+	for (uint64 r = 0; r < SPI_processed; r++)
+	{
+		bool		isnull;
+		int64		ord;
+
+		ord = DatumGetInt64(SPI_getbinval(SPI_tuptable->vals[r],
+										  SPI_tuptable->tupdesc, 1, &isnull));
+		Assert(!isnull && ord >= 1 && ord <= nsel);
+		found[ord - 1] = true;
+	}
+
+	if (SPI_finish() != SPI_OK_FINISH)
+		elog(ERROR, "SPI_finish failed");
+
+	/* Remove the checked rows from the batch */
+	for (int i = 0; i < batch->nitems; i++)
+	{
+		if (batch->nestlevels[i] >= nestlevel)
+			continue;
+		if (nkept != i)
+		{
+			memcpy(batch->values + nkept * batch->nkeys,
+				   batch->values + i * batch->nkeys,
+				   batch->nkeys * sizeof(Datum));
+			batch->tids[nkept] = batch->tids[i];
+			batch->nestlevels[nkept] = batch->nestlevels[i];
+		}
+		nkept++;
+	}
+	ri_batch_pending -= batch->nitems - nkept;
+	batch->nitems = nkept;
+	if (nkept == 0)
+		MemoryContextReset(batch->valuecxt);
+
+	/*
+	 * Check the rows whose key wasn't found once more, individually, to
+	 * report the violation.  By now the row may have been deleted or
+	 * updated, in which case ri_CheckFKeyRow() skips it.
+	 */
+	for (int j = 0; j < nsel; j++)
+	{
+		if (found[j])
+			continue;
+		if (slot == NULL)
+			slot = table_slot_create(fk_rel, NULL);
+		if (!table_tuple_fetch_row_version(fk_rel, &tids[j], SnapshotAny,
+										   slot))
+			continue;
+		ri_CheckFKeyRow(riinfo, fk_rel, slot, false);
+	}
+	if (slot != NULL)
+		ExecDropSingleTupleTableSlot(slot);
+
+	table_close(pk_rel, RowShareLock);
+	table_close(fk_rel, NoLock);
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(flushcxt);
+}
+
+/*
+ * RI_FlushPendingChecks -
+ *
+ * Check the FK rows whose checks have been batched up by the current
+ * transaction level.  This is called at the end of each round of AFTER
+ * trigger firing, so violations are still reported by the statement (or
+ * commit, or SET CONSTRAINTS) that fired the triggers.
+ */
+void
+RI_FlushPendingChecks(void)
+{
+	int			nestlevel;
+	ListCell   *lc;
+
+	if (ri_batch_pending == 0)
+		return;
+
+	nestlevel = GetCurrentTransactionNestLevel();
+	foreach(lc, ri_batch_list)
+	{
+		RI_CheckBatch *batch = (RI_CheckBatch *) lfirst(lc);
+
+		if (batch->nitems > 0)
+			ri_FlushBatch(batch, nestlevel);
+	}
+}
+
+/*
+ * RI_EndSubXactPendingChecks -
+ *
+ * At subtransaction end, hand rows the subtransaction queued over to its
+ * parent, or forget them if it aborted.
+ */
+void
+RI_EndSubXactPendingChecks(bool isCommit)
+{
+	int			my_level = GetCurrentTransactionNestLevel();
+	ListCell   *lc;
+
+	if (ri_batch_pending == 0)
+		return;
+
+	foreach(lc, ri_batch_list)
+	{
+		RI_CheckBatch *batch = (RI_CheckBatch *) lfirst(lc);
+		int			nkept = 0;
+
+		for (int i = 0; i < batch->nitems; i++)
+		{
+			if (batch->nestlevels[i] >= my_level)
+			{
+				if (!isCommit)
+					continue;
+				batch->nestlevels[i] = my_level - 1;
+			}
+			if (nkept != i)
+			{
+				memcpy(batch->values + nkept * batch->nkeys,
+					   batch->values + i * batch->nkeys,
+					   batch->nkeys * sizeof(Datum));
+				batch->tids[nkept] = batch->tids[i];
+				batch->nestlevels[nkept] = batch->nestlevels[i];
+			}
+			nkept++;
+		}
+		ri_batch_pending -= batch->nitems - nkept;
+		batch->nitems = nkept;
+	}
+}
+
+/*
+ * RI_EndXactPendingChecks -
+ *
+ * At transaction end, forget all batches.  Their memory goes away with
+ * TopTransactionContext.
+ */
+void
+RI_EndXactPendingChecks(void)
+{
+	ri_batch_cxt = NULL;
+	ri_batch_hash = NULL;
+	ri_batch_list = NIL;
+	ri_batch_pending = 0;
 }
 
 
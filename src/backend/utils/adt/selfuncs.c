@@ -6256,8 +6256,45 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	bool		found_saop;
 	bool		found_is_null_op;
 	double		num_sa_scans;
+	bool		skip_scan;
 	ListCell   *lc;
 
+	/*
+	 * If there are quals on the second index column but none on the first,
+	 * and no ScalarArrayOpExprs, nbtree performs a skip scan: a primitive
+	 * index scan for each distinct value of the first column, bounded by the
+	 * quals on the second column (see _bt_preprocess_skip_key).  Parallel
+	 * scans don't do that.
+	 */
+	skip_scan = false;
+	if (index->nkeycolumns > 1 && !path->path.parallel_aware &&
+		path->indexclauses != NIL &&
+		linitial_node(IndexClause, path->indexclauses)->indexcol == 1)
+	{
+		bool		found_bound = false;
+
+		skip_scan = true;
+		foreach(lc, path->indexclauses)
+		{
+			IndexClause *iclause = lfirst_node(IndexClause, lc);
+			ListCell   *lc2;
+
+			foreach(lc2, iclause->indexquals)
+			{
+				RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc2);
+
+				if (IsA(rinfo->clause, ScalarArrayOpExpr))
+					skip_scan = false;
+				else if (iclause->indexcol == 1 &&
+						 !(IsA(rinfo->clause, NullTest) &&
+						   ((NullTest *) rinfo->clause)->nulltesttype == IS_NOT_NULL))
+					found_bound = true;
+			}
+		}
+		if (!found_bound)
+			skip_scan = false;
+	}
+
 	/*
 	 * For a btree scan, only leading '=' quals plus inequality quals for the
 	 * immediately next attribute contribute to index selectivity (these are
@@ -6274,9 +6311,13 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * If there's a ScalarArrayOpExpr in the quals, we'll actually perform N
 	 * index scans not one, but the ScalarArrayOpExpr's operator can be
 	 * considered to act the same as it normally does.
+	 *
+	 * Similarly, in a skip scan each primitive scan treats the first column
+	 * as if it had an '=' qual, so the boundary quals start with the second
+	 * column, and they determine the total number of tuples visited.
 	 */
 	indexBoundQuals = NIL;
-	indexcol = 0;
+	indexcol = skip_scan ? 1 : 0;
 	eqQualHere = false;
 	found_saop = false;
 	found_is_null_op = false;
@@ -6365,6 +6406,7 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * NullTest invalidates that theory, even though it sets eqQualHere.
 	 */
 	if (index->unique &&
+		!skip_scan &&
 		indexcol == index->nkeycolumns - 1 &&
 		eqQualHere &&
 		!found_saop &&
@@ -6534,6 +6576,40 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 		}
 	}
 
+	/*
+	 * A skip scan descends the tree twice for each distinct value of the
+	 * first column: once to find the value and once to position the
+	 * primitive scan for it.  Charge for those descents the same way as for
+	 * the initial one, and assume each primitive scan reads at least one
+	 * leaf page of its own.
+	 */
+	if (skip_scan)
+	{
+		double		ndistinct;
+		bool		isdefault;
+		double		extraPages;
+
+		vardata.rel = index->rel;
+		ndistinct = get_variable_numdistinct(&vardata, &isdefault);
+
+		descentCost = (index->tree_height + 1) * 50.0 * cpu_operator_cost;
+		if (index->tuples > 1)
+			descentCost += ceil(log(index->tuples) / log(2.0)) * cpu_operator_cost;
+		costs.indexTotalCost += (2.0 * ndistinct - 1.0) * descentCost;
+
+		extraPages = Min(ndistinct, index->pages) - costs.numIndexPages;
+		if (extraPages > 0)
+		{
+			double		spc_random_page_cost;
+
+			get_tablespace_page_costs(index->reltablespace,
+									  &spc_random_page_cost,
+									  NULL);
+			costs.indexTotalCost += extraPages * spc_random_page_cost;
+			costs.numIndexPages += extraPages;
+		}
+	}
+
 	ReleaseVariableStats(vardata);
 
 	*indexStartupCost = costs.indexStartupCost;
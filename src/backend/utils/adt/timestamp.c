@@ -2154,6 +2154,7 @@ timestamp_cmp(PG_FUNCTION_ARGS)
 }
 
 /* note: this is used for timestamptz also */
+#if SIZEOF_DATUM < 8
 static int
 timestamp_fastcmp(Datum x, Datum y, SortSupport ssup)
 {
@@ -2162,13 +2163,19 @@ timestamp_fastcmp(Datum x, Datum y, SortSupport ssup)
 
 	return timestamp_cmp_internal(a, b);
 }
+#endif
 
 Datum
 timestamp_sortsupport(PG_FUNCTION_ARGS)
 {
 	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
 
+#if SIZEOF_DATUM >= 8
+	/* timestamps are int64s, so use the generic comparator */
+	ssup->comparator = ssup_datum_signed_cmp;
+#else
 	ssup->comparator = timestamp_fastcmp;
+#endif
 	PG_RETURN_VOID();
 }
 
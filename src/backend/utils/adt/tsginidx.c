@@ -14,6 +14,7 @@
 #include "postgres.h"
 
 #include "access/gin.h"
+#include "access/reloptions.h"
 #include "access/stratnum.h"
 #include "miscadmin.h"
 #include "tsearch/ts_type.h"
@@ -21,6 +22,39 @@
 #include "utils/builtins.h"
 
 
+/* tsvector_ops opclass options */
+typedef struct
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	bool		phrase;			/* index pairs of adjacent lexemes? */
+} GinTsVectorOptions;
+
+#define GET_PHRASE()	(PG_HAS_OPCLASS_OPTIONS() ? \
+						 ((GinTsVectorOptions *) PG_GET_OPCLASS_OPTIONS())->phrase : \
+						 false)
+
+/*
+ * With the "phrase" option, every pair of lexemes that occur at adjacent
+ * positions in a tsvector is indexed as an additional key, made of a zero
+ * byte, the first lexeme, another zero byte and the second lexeme.  Lexemes
+ * never contain zero bytes, so pair keys can't be confused with lexemes, and
+ * they sort before all of them, out of the way of prefix searches.
+ *
+ * An "a <-> b" phrase query then matches exactly the rows having the pair key
+ * for a and b, without looking at the positions in the heap tuple.  Pairs
+ * whose key would be longer than PHRASE_PAIR_MAXLEN are not indexed, and
+ * queries on them are rechecked as before.
+ */
+#define PHRASE_PAIR_MAXLEN	512
+
+/* a lexeme occurrence, for finding adjacent lexemes */
+typedef struct
+{
+	uint16		pos;			/* position, without the weight */
+	int			lexeme;			/* index of lexeme in the tsvector */
+} LexemePos;
+
+
 Datum
 gin_cmp_tslexeme(PG_FUNCTION_ARGS)
 {
@@ -61,6 +95,128 @@ gin_cmp_prefix(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(cmp);
 }
 
+/*
+ * Make the key for a pair of adjacent lexemes.
+ */
+static text *
+make_phrase_pair_key(const char *a, int alen, const char *b, int blen)
+{
+	int			len = alen + blen + 2;
+	text	   *txt = (text *) palloc(VARHDRSZ + len);
+	char	   *ptr = VARDATA(txt);
+
+	SET_VARSIZE(txt, VARHDRSZ + len);
+	*ptr++ = '\0';
+	memcpy(ptr, a, alen);
+	ptr += alen;
+	*ptr++ = '\0';
+	memcpy(ptr, b, blen);
+
+	return txt;
+}
+
+static int
+cmp_lexeme_pos(const void *a, const void *b)
+{
+	const LexemePos *pa = (const LexemePos *) a;
+	const LexemePos *pb = (const LexemePos *) b;
+
+	if (pa->pos != pb->pos)
+		return (pa->pos < pb->pos) ? -1 : 1;
+	if (pa->lexeme != pb->lexeme)
+		return (pa->lexeme < pb->lexeme) ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Append the keys for all pairs of adjacent lexemes in the tsvector to the
+ * entries array, which has room for *nentries entries.  Duplicate keys are
+ * left for GIN to remove.
+ */
+static Datum *
+add_phrase_pair_entries(TSVector vector, Datum *entries, int32 *nentries)
+{
+	WordEntry  *we = ARRPTR(vector);
+	LexemePos  *lp;
+	int			npos = 0;
+	int			maxentries = *nentries;
+	int			i,
+				j,
+				k;
+
+	for (i = 0; i < vector->size; i++)
+		npos += POSDATALEN(vector, &we[i]);
+	if (npos < 2)
+		return entries;
+
+	/* collect all lexeme occurrences, in order of position */
+	lp = (LexemePos *) palloc(sizeof(LexemePos) * npos);
+	npos = 0;
+	for (i = 0; i < vector->size; i++)
+	{
+		WordEntryPos *pos;
+
+		if (!we[i].haspos)
+			continue;
+		pos = POSDATAPTR(vector, &we[i]);
+		for (k = 0; k < POSDATALEN(vector, &we[i]); k++)
+		{
+			lp[npos].pos = WEP_GETPOS(pos[k]);
+			lp[npos].lexeme = i;
+			npos++;
+		}
+	}
+	qsort(lp, npos, sizeof(LexemePos), cmp_lexeme_pos);
+
+	/*
+	 * Pair each lexeme with every lexeme at the next position.  Usually
+	 * there's just one lexeme at each position, but dictionaries can emit
+	 * several.
+	 */
+	for (i = 0; i < npos; i = j)
+	{
+		int			next_end;
+		int			a,
+					b;
+
+		for (j = i + 1; j < npos && lp[j].pos == lp[i].pos; j++)
+			;
+		if (j >= npos || lp[j].pos != lp[i].pos + 1)
+			continue;
+		for (next_end = j + 1;
+			 next_end < npos && lp[next_end].pos == lp[j].pos;
+			 next_end++)
+			;
+
+		for (a = i; a < j; a++)
+		{
+			WordEntry  *wa = &we[lp[a].lexeme];
+
+			for (b = j; b < next_end; b++)
+			{
+				WordEntry  *wb = &we[lp[b].lexeme];
+
+				if (wa->len + wb->len + 2 > PHRASE_PAIR_MAXLEN)
+					continue;
+
+				if (*nentries >= maxentries)
+				{
+					maxentries *= 2;
+					entries = (Datum *) repalloc(entries,
+												 sizeof(Datum) * maxentries);
+				}
+				entries[(*nentries)++] = PointerGetDatum(
+					make_phrase_pair_key(STRPTR(vector) + wa->pos, wa->len,
+										 STRPTR(vector) + wb->pos, wb->len));
+			}
+		}
+	}
+
+	pfree(lp);
+
+	return entries;
+}
+
 Datum
 gin_extract_tsvector(PG_FUNCTION_ARGS)
 {
@@ -85,12 +241,66 @@ gin_extract_tsvector(PG_FUNCTION_ARGS)
 
 			we++;
 		}
+
+		if (GET_PHRASE())
+			entries = add_phrase_pair_entries(vector, entries, nentries);
 	}
 
 	PG_FREE_IF_COPY(vector, 0);
 	PG_RETURN_POINTER(entries);
 }
 
+/*
+ * Find the operand that every phrase match of the given subquery starts with
+ * (first = true) or ends with (first = false), if that is always the same
+ * plain lexeme.  Operands restricted by weight or prefix can't be paired.
+ */
+static QueryOperand *
+phrase_edge_operand(QueryItem *item, bool first)
+{
+	for (;;)
+	{
+		if (item->type == QI_VAL)
+		{
+			QueryOperand *val = &item->qoperand;
+
+			if (val->weight != 0 || val->prefix)
+				return NULL;
+			return val;
+		}
+		if (item->qoperator.oper != OP_PHRASE)
+			return NULL;
+		item = first ? item + item->qoperator.left : item + 1;
+	}
+}
+
+/*
+ * If the phrase operator at query item i requires a pair of adjacent lexemes
+ * that would be indexed, return its key, else NULL.
+ */
+static text *
+phrase_pair_key(TSQuery query, int i)
+{
+	QueryItem  *item = GETQUERY(query);
+	QueryOperand *left;
+	QueryOperand *right;
+
+	if (item[i].type != QI_OPR || item[i].qoperator.oper != OP_PHRASE ||
+		item[i].qoperator.distance != 1)
+		return NULL;
+
+	left = phrase_edge_operand(&item[i + item[i].qoperator.left], false);
+	right = phrase_edge_operand(&item[i + 1], true);
+	if (left == NULL || right == NULL ||
+		left->length + right->length + 2 > PHRASE_PAIR_MAXLEN)
+		return NULL;
+
+	return make_phrase_pair_key(GETOPERAND(query) + left->distance,
+								left->length,
+								GETOPERAND(query) + right->distance,
+								right->length);
+}
+
 Datum
 gin_extract_tsquery(PG_FUNCTION_ARGS)
 {
@@ -110,6 +320,7 @@ gin_extract_tsquery(PG_FUNCTION_ARGS)
 	if (query->size > 0)
 	{
 		QueryItem  *item = GETQUERY(query);
+		bool		phrase = GET_PHRASE();
 		int32		i,
 					j;
 		bool	   *partialmatch;
@@ -125,14 +336,15 @@ gin_extract_tsquery(PG_FUNCTION_ARGS)
 		else
 			*searchMode = GIN_SEARCH_MODE_ALL;
 
-		/* count number of VAL items */
+		/* count number of VAL items, and phrase pairs if indexed */
 		j = 0;
 		for (i = 0; i < query->size; i++)
 		{
 			if (item[i].type == QI_VAL)
 				j++;
+			else if (phrase && item[i].qoperator.oper == OP_PHRASE)
+				j++;
 		}
-		*nentries = j;
 
 		entries = (Datum *) palloc(sizeof(Datum) * j);
 		partialmatch = *ptr_partialmatch = (bool *) palloc(sizeof(bool) * j);
@@ -140,29 +352,40 @@ gin_extract_tsquery(PG_FUNCTION_ARGS)
 		/*
 		 * Make map to convert item's number to corresponding operand's (the
 		 * same, entry's) number. Entry's number is used in check array in
-		 * consistent method. We use the same map for each entry.
+		 * consistent method. We use the same map for each entry.  Phrase
+		 * operators are mapped to the entry for their pair key, other
+		 * operators to -1.
 		 */
 		*extra_data = (Pointer *) palloc(sizeof(Pointer) * j);
-		map_item_operand = (int *) palloc0(sizeof(int) * query->size);
+		map_item_operand = (int *) palloc(sizeof(int) * query->size);
 
-		/* Now rescan the VAL items and fill in the arrays */
+		/* Now rescan the items and fill in the arrays */
 		j = 0;
 		for (i = 0; i < query->size; i++)
 		{
+			text	   *txt;
+
+			map_item_operand[i] = -1;
+
 			if (item[i].type == QI_VAL)
 			{
 				QueryOperand *val = &item[i].qoperand;
-				text	   *txt;
 
 				txt = cstring_to_text_with_len(GETOPERAND(query) + val->distance,
 											   val->length);
-				entries[j] = PointerGetDatum(txt);
 				partialmatch[j] = val->prefix;
-				(*extra_data)[j] = (Pointer) map_item_operand;
-				map_item_operand[i] = j;
-				j++;
 			}
+			else if (phrase && (txt = phrase_pair_key(query, i)) != NULL)
+				partialmatch[j] = false;
+			else
+				continue;
+
+			entries[j] = PointerGetDatum(txt);
+			(*extra_data)[j] = (Pointer) map_item_operand;
+			map_item_operand[i] = j;
+			j++;
 		}
+		*nentries = j;
 	}
 
 	PG_FREE_IF_COPY(query, 0);
@@ -175,7 +398,6 @@ typedef struct
 	QueryItem  *first_item;
 	GinTernaryValue *check;
 	int		   *map_item_operand;
-	bool	   *need_recheck;
 } GinChkVal;
 
 /*
@@ -186,25 +408,22 @@ checkcondition_gin(void *checkval, QueryOperand *val, ExecPhraseData *data)
 {
 	GinChkVal  *gcv = (GinChkVal *) checkval;
 	int			j;
-
-	/*
-	 * if any val requiring a weight is used or caller needs position
-	 * information then set recheck flag
-	 */
-	if (val->weight != 0 || data != NULL)
-		*(gcv->need_recheck) = true;
+	GinTernaryValue result;
 
 	/* convert item's number to corresponding entry's (operand's) number */
 	j = gcv->map_item_operand[((QueryItem *) val) - gcv->first_item];
 
+	/* determine presence of current entry in indexed value */
+	result = gcv->check[j];
+
 	/*
-	 * return presence of current entry in indexed value; but TRUE becomes
-	 * MAYBE in the presence of a query requiring recheck
+	 * If any val requiring a weight is used or caller needs position
+	 * information then we must recheck, so replace TRUE with MAYBE.
 	 */
-	if (gcv->check[j] == GIN_TRUE)
+	if (result == GIN_TRUE)
 	{
 		if (val->weight != 0 || data != NULL)
-			return TS_MAYBE;
+			result = GIN_MAYBE;
 	}
 
 	/*
@@ -212,7 +431,107 @@ checkcondition_gin(void *checkval, QueryOperand *val, ExecPhraseData *data)
 	 * assignments.  We could use a switch statement to map the values if that
 	 * ever stops being true, but it seems unlikely to happen.
 	 */
-	return (TSTernaryValue) gcv->check[j];
+	return (TSTernaryValue) result;
+}
+
+/*
+ * Check the phrase pair keys required by a phrase operator and by the phrase
+ * operators nested directly below it, for a match that the lexeme entries
+ * alone leave uncertain.  A missing pair rules out the match.  A present pair
+ * proves it, if the operator is just a phrase of two plain lexemes.
+ */
+static TSTernaryValue
+checkcondition_gin_phrase(GinChkVal *gcv, QueryItem *curitem)
+{
+	TSTernaryValue result = TS_MAYBE;
+	int			j;
+
+	/* since this function recurses, it could be driven to stack overflow */
+	check_stack_depth();
+
+	if (curitem->type != QI_OPR || curitem->qoperator.oper != OP_PHRASE)
+		return TS_MAYBE;
+
+	j = gcv->map_item_operand[curitem - gcv->first_item];
+	if (j >= 0)
+	{
+		if (gcv->check[j] == GIN_FALSE)
+			return TS_NO;
+		if (gcv->check[j] == GIN_TRUE &&
+			curitem[curitem->qoperator.left].type == QI_VAL &&
+			curitem[1].type == QI_VAL)
+			result = TS_YES;
+	}
+
+	if (checkcondition_gin_phrase(gcv, curitem + curitem->qoperator.left) == TS_NO ||
+		checkcondition_gin_phrase(gcv, curitem + 1) == TS_NO)
+		return TS_NO;
+
+	return result;
+}
+
+/*
+ * Evaluate a tsquery against GIN index data.  This is TS_execute_ternary,
+ * except that uncertain phrase matches are narrowed down using the phrase
+ * pair keys, if the index has them.
+ */
+static TSTernaryValue
+gin_tsquery_execute(GinChkVal *gcv, QueryItem *curitem)
+{
+	TSTernaryValue lmatch;
+	TSTernaryValue rmatch;
+
+	/* since this function recurses, it could be driven to stack overflow */
+	check_stack_depth();
+
+	if (curitem->type == QI_VAL)
+		return checkcondition_gin(gcv, (QueryOperand *) curitem, NULL);
+
+	switch (curitem->qoperator.oper)
+	{
+		case OP_NOT:
+			switch (gin_tsquery_execute(gcv, curitem + 1))
+			{
+				case TS_NO:
+					return TS_YES;
+				case TS_YES:
+					return TS_NO;
+				case TS_MAYBE:
+					return TS_MAYBE;
+			}
+			break;
+
+		case OP_AND:
+			lmatch = gin_tsquery_execute(gcv, curitem + curitem->qoperator.left);
+			if (lmatch == TS_NO)
+				return TS_NO;
+			rmatch = gin_tsquery_execute(gcv, curitem + 1);
+			if (rmatch == TS_NO)
+				return TS_NO;
+			return (lmatch == TS_YES && rmatch == TS_YES) ? TS_YES : TS_MAYBE;
+
+		case OP_OR:
+			lmatch = gin_tsquery_execute(gcv, curitem + curitem->qoperator.left);
+			if (lmatch == TS_YES)
+				return TS_YES;
+			rmatch = gin_tsquery_execute(gcv, curitem + 1);
+			if (rmatch == TS_YES)
+				return TS_YES;
+			return (lmatch == TS_NO && rmatch == TS_NO) ? TS_NO : TS_MAYBE;
+
+		case OP_PHRASE:
+			lmatch = TS_execute_ternary(curitem, gcv, TS_EXEC_PHRASE_NO_POS,
+										checkcondition_gin);
+			if (lmatch != TS_MAYBE)
+				return lmatch;
+			return checkcondition_gin_phrase(gcv, curitem);
+
+		default:
+			elog(ERROR, "unrecognized operator: %d", curitem->qoperator.oper);
+	}
+
+	/* not reachable, but keep compiler quiet */
+	return TS_NO;
 }
 
 Datum
@@ -237,19 +556,27 @@ gin_tsquery_consistent(PG_FUNCTION_ARGS)
 
 		/*
 		 * check-parameter array has one entry for each value (operand) in the
-		 * query.
+		 * query, plus one for each indexed phrase pair.
 		 */
 		gcv.first_item = GETQUERY(query);
 		StaticAssertStmt(sizeof(GinTernaryValue) == sizeof(bool),
 						 "sizes of GinTernaryValue and bool are not equal");
 		gcv.check = (GinTernaryValue *) check;
 		gcv.map_item_operand = (int *) (extra_data[0]);
-		gcv.need_recheck = recheck;
 
-		res = TS_execute(GETQUERY(query),
-						 &gcv,
-						 TS_EXEC_PHRASE_NO_POS,
-						 checkcondition_gin);
+		switch (gin_tsquery_execute(&gcv, GETQUERY(query)))
+		{
+			case TS_NO:
+				res = false;
+				break;
+			case TS_YES:
+				res = true;
+				break;
+			case TS_MAYBE:
+				res = true;
+				*recheck = true;
+				break;
+		}
 	}
 
 	PG_RETURN_BOOL(res);
@@ -266,10 +593,6 @@ gin_tsquery_triconsistent(PG_FUNCTION_ARGS)
 	/* int32	nkeys = PG_GETARG_INT32(3); */
 	Pointer    *extra_data = (Pointer *) PG_GETARG_POINTER(4);
 	GinTernaryValue res = GIN_FALSE;
-	bool		recheck;
-
-	/* Initially assume query doesn't require recheck */
-	recheck = false;
 
 	if (query->size > 0)
 	{
@@ -277,23 +600,35 @@ gin_tsquery_triconsistent(PG_FUNCTION_ARGS)
 
 		/*
 		 * check-parameter array has one entry for each value (operand) in the
-		 * query.
+		 * query, plus one for each indexed phrase pair.
 		 */
 		gcv.first_item = GETQUERY(query);
 		gcv.check = check;
 		gcv.map_item_operand = (int *) (extra_data[0]);
-		gcv.need_recheck = &recheck;
 
-		if (TS_execute(GETQUERY(query),
-					   &gcv,
-					   TS_EXEC_PHRASE_NO_POS,
-					   checkcondition_gin))
-			res = recheck ? GIN_MAYBE : GIN_TRUE;
+		res = (GinTernaryValue) gin_tsquery_execute(&gcv, GETQUERY(query));
 	}
 
 	PG_RETURN_GIN_TERNARY_VALUE(res);
 }
 
+/*
+ * Opclass options for tsvector_ops
+ */
+Datum
+gin_tsvector_options(PG_FUNCTION_ARGS)
+{
+	local_relopts *relopts = (local_relopts *) PG_GETARG_POINTER(0);
+
+	init_local_reloptions(relopts, sizeof(GinTsVectorOptions));
+	add_local_bool_reloption(relopts, "phrase",
+							 "index pairs of adjacent lexemes for phrase search",
+							 false,
+							 offsetof(GinTsVectorOptions, phrase));
+
+	PG_RETURN_VOID();
+}
+
 /*
  * Formerly, gin_extract_tsvector had only two arguments.  Now it has three,
  * but we still need a pg_proc entry with two args to support reloading
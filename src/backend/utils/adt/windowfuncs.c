@@ -13,6 +13,7 @@
  */
 #include "postgres.h"
 
+#include "nodes/supportnodes.h"
 #include "utils/builtins.h"
 #include "windowapi.h"
 
@@ -74,6 +75,28 @@ rank_up(WindowObject winobj)
 }
 
 
+/*
+ * window_ranking_support
+ * planner support function for row_number, rank, dense_rank, percent_rank,
+ * cume_dist and ntile.  The frame clause doesn't affect any of these, and
+ * their results never decrease within a partition.
+ */
+Datum
+window_ranking_support(PG_FUNCTION_ARGS)
+{
+	Node	   *rawreq = (Node *) PG_GETARG_POINTER(0);
+
+	if (IsA(rawreq, SupportRequestWFuncMonotonic))
+	{
+		SupportRequestWFuncMonotonic *req = (SupportRequestWFuncMonotonic *) rawreq;
+
+		req->monotonic = MONOTONICFUNC_INCREASING;
+		PG_RETURN_POINTER(req);
+	}
+
+	PG_RETURN_POINTER(NULL);
+}
+
 /*
  * row_number
  * just increment up from 1 until current partition finishes.
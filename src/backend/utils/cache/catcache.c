@@ -63,6 +63,9 @@
 /* Cache management header --- pointer is NULL until created */
 static CatCacheHeader *CacheHdr = NULL;
 
+/* GUC parameter: limit on catcache tuple memory in kB, or -1 for none */
+int			catalog_cache_memory_limit = -1;
+
 static inline HeapTuple SearchCatCacheInternal(CatCache *cache,
 											   int nkeys,
 											   Datum v1, Datum v2,
@@ -88,6 +91,7 @@ static void CatCachePrintStats(int code, Datum arg);
 #endif
 static void CatCacheRemoveCTup(CatCache *cache, CatCTup *ct);
 static void CatCacheRemoveCList(CatCache *cache, CatCList *cl);
+static void CatCacheEnforceMemoryLimit(void);
 static void CatalogCacheInitializeCache(CatCache *cache);
 static CatCTup *CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 										Datum *arguments,
@@ -471,8 +475,10 @@ CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 		return;					/* nothing left to do */
 	}
 
-	/* delink from linked list */
+	/* delink from linked lists */
 	dlist_delete(&ct->cache_elem);
+	dlist_delete(&ct->lru_elem);
+	CacheHdr->ch_memory -= GetMemoryChunkSpace(ct);
 
 	/*
 	 * Free keys when we're dealing with a negative entry, normal entries just
@@ -530,6 +536,74 @@ CatCacheRemoveCList(CatCache *cache, CatCList *cl)
 }
 
 
+/*
+ *	CatCacheEnforceMemoryLimit
+ *
+ * Evict least recently used entries until the tuples in all caches fit in
+ * catalog_cache_memory_limit.  Only entries that nobody holds a reference
+ * to, directly or through a CatCList, can go; evicting one is no different
+ * from what a cache invalidation would do to it.
+ *
+ * Callers must make sure that any entry they are about to hand out is
+ * already pinned.
+ */
+static void
+CatCacheEnforceMemoryLimit(void)
+{
+	Size		limit;
+	int			nskipped = 0;
+
+	if (catalog_cache_memory_limit < 0)
+		return;
+
+	limit = (Size) catalog_cache_memory_limit * 1024;
+
+	/*
+	 * Referenced entries are moved to the tail, as they are evidently in
+	 * use; once we've skipped over every entry there is nothing left to do.
+	 */
+	while (CacheHdr->ch_memory > limit && nskipped < CacheHdr->ch_ntup)
+	{
+		CatCTup    *ct = dlist_head_element(CatCTup, lru_elem,
+											&CacheHdr->ch_lru);
+
+		if (ct->refcount > 0 ||
+			(ct->c_list != NULL && ct->c_list->refcount > 0))
+		{
+			dlist_move_tail(&CacheHdr->ch_lru, &ct->lru_elem);
+			nskipped++;
+			continue;
+		}
+
+		/* this also removes the entry's CatCList, if any */
+		CatCacheRemoveCTup(ct->my_cache, ct);
+		CacheHdr->ch_evictions++;
+	}
+}
+
+/*
+ *	CatalogCacheGetStats
+ *
+ * Report the size of the catalog caches and how well they are working.
+ */
+void
+CatalogCacheGetStats(int64 *ntup, int64 *memory, uint64 *hits,
+					 uint64 *misses, uint64 *evictions)
+{
+	if (CacheHdr == NULL)
+	{
+		*ntup = *memory = 0;
+		*hits = *misses = *evictions = 0;
+		return;
+	}
+
+	*ntup = CacheHdr->ch_ntup;
+	*memory = CacheHdr->ch_memory;
+	*hits = CacheHdr->ch_hits;
+	*misses = CacheHdr->ch_misses;
+	*evictions = CacheHdr->ch_evictions;
+}
+
 /*
  *	CatCacheInvalidate
  *
@@ -802,6 +876,11 @@ InitCatCache(int id,
 		CacheHdr = (CatCacheHeader *) palloc(sizeof(CatCacheHeader));
 		slist_init(&CacheHdr->ch_caches);
 		CacheHdr->ch_ntup = 0;
+		dlist_init(&CacheHdr->ch_lru);
+		CacheHdr->ch_memory = 0;
+		CacheHdr->ch_hits = 0;
+		CacheHdr->ch_misses = 0;
+		CacheHdr->ch_evictions = 0;
 #ifdef CATCACHE_STATS
 		/* set up to dump stats at backend exit */
 		on_proc_exit(CatCachePrintStats, 0);
@@ -1264,6 +1343,11 @@ SearchCatCacheInternal(CatCache *cache,
 		 */
 		dlist_move_head(bucket, &ct->cache_elem);
 
+		/* Likewise, if we may have to evict entries, note it's been used */
+		if (catalog_cache_memory_limit >= 0)
+			dlist_move_tail(&CacheHdr->ch_lru, &ct->lru_elem);
+		CacheHdr->ch_hits++;
+
 		/*
 		 * If it's a positive entry, bump its refcount and return it. If it's
 		 * negative, we can report failure to the caller.
@@ -1339,6 +1423,8 @@ SearchCatCacheMiss(CatCache *cache,
 	cur_skey[2].sk_argument = v3;
 	cur_skey[3].sk_argument = v4;
 
+	CacheHdr->ch_misses++;
+
 	/*
 	 * Tuple was not found in cache, so we have to try to retrieve it directly
 	 * from the relation.  If found, we will add it to the cache; if not
@@ -1410,6 +1496,8 @@ SearchCatCacheMiss(CatCache *cache,
 		 * refcount zero.
 		 */
 
+		CatCacheEnforceMemoryLimit();
+
 		return NULL;
 	}
 
@@ -1422,6 +1510,9 @@ SearchCatCacheMiss(CatCache *cache,
 	cache->cc_newloads++;
 #endif
 
+	/* The new entry is pinned, so it can't be evicted here */
+	CatCacheEnforceMemoryLimit();
+
 	return &ct->tuple;
 }
 
@@ -1582,6 +1673,18 @@ SearchCatCacheList(CatCache *cache,
 		 */
 		dlist_move_head(&cache->cc_lists, &cl->cache_elem);
 
+		/*
+		 * Members can only be evicted together with their list, so keep them
+		 * from aging out while the list is in use.
+		 */
+		if (catalog_cache_memory_limit >= 0)
+		{
+			for (i = 0; i < cl->n_members; i++)
+				dlist_move_tail(&CacheHdr->ch_lru,
+								&cl->members[i]->lru_elem);
+		}
+		CacheHdr->ch_hits++;
+
 		/* Bump the list's refcount and return it */
 		ResourceOwnerEnlargeCatCacheListRefs(CurrentResourceOwner);
 		cl->refcount++;
@@ -1609,6 +1712,8 @@ SearchCatCacheList(CatCache *cache,
 	 */
 	ResourceOwnerEnlargeCatCacheListRefs(CurrentResourceOwner);
 
+	CacheHdr->ch_misses++;
+
 	ctlist = NIL;
 
 	PG_TRY();
@@ -1678,6 +1783,9 @@ SearchCatCacheList(CatCache *cache,
 				break;			/* A-OK */
 			}
 
+			if (found && catalog_cache_memory_limit >= 0)
+				dlist_move_tail(&CacheHdr->ch_lru, &ct->lru_elem);
+
 			if (!found)
 			{
 				/* We didn't find a usable entry, so make a new one */
@@ -1770,6 +1878,9 @@ SearchCatCacheList(CatCache *cache,
 	CACHE_elog(DEBUG2, "SearchCatCacheList(%s): made list of %d members",
 			   cache->cc_relname, nmembers);
 
+	/* The new list is pinned, so its members can't be evicted here */
+	CatCacheEnforceMemoryLimit();
+
 	return cl;
 }
 
@@ -1890,9 +2001,11 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
 	ct->hash_value = hashValue;
 
 	dlist_push_head(&cache->cc_bucket[hashIndex], &ct->cache_elem);
+	dlist_push_tail(&CacheHdr->ch_lru, &ct->lru_elem);
 
 	cache->cc_ntup++;
 	CacheHdr->ch_ntup++;
+	CacheHdr->ch_memory += GetMemoryChunkSpace(ct);
 
 	/*
 	 * If the hash table has become too full, enlarge the buckets array. Quite
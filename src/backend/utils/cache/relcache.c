@@ -42,6 +42,7 @@
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
+#include "catalog/globaltemp.h"
 #include "catalog/index.h"
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
@@ -85,6 +86,7 @@
 #include "utils/memutils.h"
 #include "utils/relmapper.h"
 #include "utils/resowner_private.h"
+#include "utils/sharedrelcache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -122,14 +124,27 @@ static const FormData_pg_attribute Desc_pg_subscription[Natts_pg_subscription] =
  *
  *		We used to index the cache by both name and OID, but now there
  *		is only an index by OID.
+ *
+ *		The entries are also kept in a list in least-recently-used order,
+ *		so that we can trim the cache down to max_relation_cache_entries.
  */
 typedef struct relidcacheent
 {
 	Oid			reloid;
 	Relation	reldesc;
+	dlist_node	lru_node;		/* list member of RelationLRUList */
 } RelIdCacheEnt;
 
 static HTAB *RelationIdCache;
+static dlist_head RelationLRUList = DLIST_STATIC_INIT(RelationLRUList);
+
+/* GUC parameter: max # of relcache entries kept past xact end, or -1 */
+int			max_relation_cache_entries = -1;
+
+/* Counters reported by RelationCacheGetStats */
+static uint64 relcache_hits = 0;
+static uint64 relcache_misses = 0;
+static uint64 relcache_evictions = 0;
 
 /*
  * This flag is false until we have prepared the critical relcache entries
@@ -198,6 +213,7 @@ do { \
 		Relation _old_rel = hentry->reldesc; \
 		Assert(replace_allowed); \
 		hentry->reldesc = (RELATION); \
+		dlist_move_tail(&RelationLRUList, &hentry->lru_node); \
 		if (RelationHasReferenceCountZero(_old_rel)) \
 			RelationDestroyRelation(_old_rel, false); \
 		else if (!IsBootstrapProcessingMode()) \
@@ -205,7 +221,10 @@ do { \
 				 RelationGetRelationName(_old_rel)); \
 	} \
 	else \
+	{ \
 		hentry->reldesc = (RELATION); \
+		dlist_push_tail(&RelationLRUList, &hentry->lru_node); \
+	} \
 } while(0)
 
 #define RelationIdCacheLookup(ID, RELATION) \
@@ -229,6 +248,8 @@ do { \
 	if (hentry == NULL) \
 		elog(WARNING, "failed to delete relcache entry for OID %u", \
 			 (RELATION)->rd_id); \
+	else \
+		dlist_delete(&hentry->lru_node); \
 } while(0)
 
 
@@ -264,6 +285,7 @@ static void RememberToFreeTupleDescAtEOX(TupleDesc td);
 static void AssertPendingSyncConsistency(Relation relation);
 #endif
 static void AtEOXact_cleanup(Relation relation, bool isCommit);
+static void RelationCacheTrim(void);
 static void AtEOSubXact_cleanup(Relation relation, bool isCommit,
 								SubTransactionId mySubid, SubTransactionId parentSubid);
 static bool load_relcache_init_file(bool shared);
@@ -276,7 +298,7 @@ static void formrdesc(const char *relationName, Oid relationReltype,
 static HeapTuple ScanPgRelation(Oid targetRelId, bool indexOK, bool force_non_historic);
 static Relation AllocateRelationDesc(Form_pg_class relp);
 static void RelationParseRelOptions(Relation relation, HeapTuple tuple);
-static void RelationBuildTupleDesc(Relation relation);
+static void RelationBuildTupleDesc(Relation relation, uint64 shared_token);
 static Relation RelationBuildDesc(Oid targetRelId, bool insertIt);
 static void RelationInitPhysicalAddr(Relation relation);
 static void load_critical_index(Oid indexoid, Oid heapoid);
@@ -493,19 +515,20 @@ RelationParseRelOptions(Relation relation, HeapTuple tuple)
  *
  *		Form the relation's tuple descriptor from information in
  *		the pg_attribute, pg_attrdef & pg_constraint system catalogs.
+ *
+ *		shared_token is the result of SharedRelCacheBeginBuild; if it is
+ *		nonzero, the attributes may be taken from or published to the shared
+ *		relation cache.
  */
 static void
-RelationBuildTupleDesc(Relation relation)
+RelationBuildTupleDesc(Relation relation, uint64 shared_token)
 {
-	HeapTuple	pg_attribute_tuple;
-	Relation	pg_attribute_desc;
-	SysScanDesc pg_attribute_scan;
-	ScanKeyData skey[2];
-	int			need;
 	TupleConstr *constr;
 	AttrDefault *attrdef = NULL;
 	AttrMissing *attrmiss = NULL;
 	int			ndef = 0;
+	bool		use_shared;
+	int			i;
 
 	/* fill rd_att's type ID fields (compare heap.c's AddNewRelationTuple) */
 	relation->rd_att->tdtypeid =
@@ -517,55 +540,151 @@ RelationBuildTupleDesc(Relation relation)
 	constr->has_not_null = false;
 	constr->has_generated_stored = false;
 
-	/*
-	 * Form a scan key that selects only user attributes (attnum > 0).
-	 * (Eliminating system attribute rows at the index level is lots faster
-	 * than fetching them.)
-	 */
-	ScanKeyInit(&skey[0],
-				Anum_pg_attribute_attrelid,
-				BTEqualStrategyNumber, F_OIDEQ,
-				ObjectIdGetDatum(RelationGetRelid(relation)));
-	ScanKeyInit(&skey[1],
-				Anum_pg_attribute_attnum,
-				BTGreaterStrategyNumber, F_INT2GT,
-				Int16GetDatum(0));
+	use_shared = shared_token != 0 &&
+		!relation->rd_rel->relisshared &&
+		relation->rd_rel->relpersistence != RELPERSISTENCE_TEMP;
 
 	/*
-	 * Open pg_attribute and begin a scan.  Force heap scan if we haven't yet
-	 * built the critical relcache entries (this includes initdb and startup
-	 * without a pg_internal.init file).
+	 * If another backend has published this relation's attributes in the
+	 * shared relation cache, just copy them from there.
 	 */
-	pg_attribute_desc = table_open(AttributeRelationId, AccessShareLock);
-	pg_attribute_scan = systable_beginscan(pg_attribute_desc,
-										   AttributeRelidNumIndexId,
-										   criticalRelcachesBuilt,
-										   NULL,
-										   2, skey);
+	if (!use_shared ||
+		!SharedRelCacheLookup(RelationGetRelid(relation), relation->rd_att))
+	{
+		HeapTuple	pg_attribute_tuple;
+		Relation	pg_attribute_desc;
+		SysScanDesc pg_attribute_scan;
+		ScanKeyData skey[2];
+		int			need;
 
-	/*
-	 * add attribute data to relation->rd_att
-	 */
-	need = RelationGetNumberOfAttributes(relation);
+		/*
+		 * Form a scan key that selects only user attributes (attnum > 0).
+		 * (Eliminating system attribute rows at the index level is lots
+		 * faster than fetching them.)
+		 */
+		ScanKeyInit(&skey[0],
+					Anum_pg_attribute_attrelid,
+					BTEqualStrategyNumber, F_OIDEQ,
+					ObjectIdGetDatum(RelationGetRelid(relation)));
+		ScanKeyInit(&skey[1],
+					Anum_pg_attribute_attnum,
+					BTGreaterStrategyNumber, F_INT2GT,
+					Int16GetDatum(0));
 
-	while (HeapTupleIsValid(pg_attribute_tuple = systable_getnext(pg_attribute_scan)))
-	{
-		Form_pg_attribute attp;
-		int			attnum;
+		/*
+		 * Open pg_attribute and begin a scan.  Force heap scan if we haven't
+		 * yet built the critical relcache entries (this includes initdb and
+		 * startup without a pg_internal.init file).
+		 */
+		pg_attribute_desc = table_open(AttributeRelationId, AccessShareLock);
+		pg_attribute_scan = systable_beginscan(pg_attribute_desc,
+											   AttributeRelidNumIndexId,
+											   criticalRelcachesBuilt,
+											   NULL,
+											   2, skey);
+
+		/*
+		 * add attribute data to relation->rd_att
+		 */
+		need = RelationGetNumberOfAttributes(relation);
 
-		attp = (Form_pg_attribute) GETSTRUCT(pg_attribute_tuple);
+		while (HeapTupleIsValid(pg_attribute_tuple = systable_getnext(pg_attribute_scan)))
+		{
+			Form_pg_attribute attp;
+			int			attnum;
 
-		attnum = attp->attnum;
-		if (attnum <= 0 || attnum > RelationGetNumberOfAttributes(relation))
-			elog(ERROR, "invalid attribute number %d for %s",
-				 attp->attnum, RelationGetRelationName(relation));
+			attp = (Form_pg_attribute) GETSTRUCT(pg_attribute_tuple);
 
+			attnum = attp->attnum;
+			if (attnum <= 0 || attnum > RelationGetNumberOfAttributes(relation))
+				elog(ERROR, "invalid attribute number %d for %s",
+					 attp->attnum, RelationGetRelationName(relation));
 
-		memcpy(TupleDescAttr(relation->rd_att, attnum - 1),
-			   attp,
-			   ATTRIBUTE_FIXED_PART_SIZE);
 
-		/* Update constraint/default info */
+			memcpy(TupleDescAttr(relation->rd_att, attnum - 1),
+				   attp,
+				   ATTRIBUTE_FIXED_PART_SIZE);
+
+			/* Fill in the column's missing value, if it has one */
+			if (attp->atthasmissing)
+			{
+				Datum		missingval;
+				bool		missingNull;
+
+				/* Do we have a missing value? */
+				missingval = heap_getattr(pg_attribute_tuple,
+										  Anum_pg_attribute_attmissingval,
+										  pg_attribute_desc->rd_att,
+										  &missingNull);
+				if (!missingNull)
+				{
+					/* Yes, fetch from the array */
+					MemoryContext oldcxt;
+					bool		is_null;
+					int			one = 1;
+					Datum		missval;
+
+					if (attrmiss == NULL)
+						attrmiss = (AttrMissing *)
+							MemoryContextAllocZero(CacheMemoryContext,
+												   relation->rd_rel->relnatts *
+												   sizeof(AttrMissing));
+
+					missval = array_get_element(missingval,
+												1,
+												&one,
+												-1,
+												attp->attlen,
+												attp->attbyval,
+												attp->attalign,
+												&is_null);
+					Assert(!is_null);
+					if (attp->attbyval)
+					{
+						/* for copy by val just copy the datum direct */
+						attrmiss[attnum - 1].am_value = missval;
+					}
+					else
+					{
+						/* otherwise copy in the correct context */
+						oldcxt = MemoryContextSwitchTo(CacheMemoryContext);
+						attrmiss[attnum - 1].am_value = datumCopy(missval,
+																  attp->attbyval,
+																  attp->attlen);
+						MemoryContextSwitchTo(oldcxt);
+					}
+					attrmiss[attnum - 1].am_present = true;
+				}
+			}
+			need--;
+			if (need == 0)
+				break;
+		}
+
+		/*
+		 * end the scan and close the attribute relation
+		 */
+		systable_endscan(pg_attribute_scan);
+		table_close(pg_attribute_desc, AccessShareLock);
+
+		if (need != 0)
+			elog(ERROR, "catalog is missing %d attribute(s) for relid %u",
+				 need, RelationGetRelid(relation));
+
+		/*
+		 * Publish the result for other backends, unless some column has a
+		 * missing value, which the shared cache has no room for.
+		 */
+		if (use_shared && attrmiss == NULL)
+			SharedRelCacheStore(RelationGetRelid(relation), shared_token,
+								relation->rd_att);
+	}
+
+	/* Update constraint/default info */
+	for (i = 0; i < RelationGetNumberOfAttributes(relation); i++)
+	{
+		Form_pg_attribute attp = TupleDescAttr(relation->rd_att, i);
+
 		if (attp->attnotnull)
 			constr->has_not_null = true;
 		if (attp->attgenerated == ATTRIBUTE_GENERATED_STORED)
@@ -579,90 +698,21 @@ RelationBuildTupleDesc(Relation relation)
 					MemoryContextAllocZero(CacheMemoryContext,
 										   RelationGetNumberOfAttributes(relation) *
 										   sizeof(AttrDefault));
-			attrdef[ndef].adnum = attnum;
+			attrdef[ndef].adnum = attp->attnum;
 			attrdef[ndef].adbin = NULL;
 
 			ndef++;
 		}
-
-		/* Likewise for a missing value */
-		if (attp->atthasmissing)
-		{
-			Datum		missingval;
-			bool		missingNull;
-
-			/* Do we have a missing value? */
-			missingval = heap_getattr(pg_attribute_tuple,
-									  Anum_pg_attribute_attmissingval,
-									  pg_attribute_desc->rd_att,
-									  &missingNull);
-			if (!missingNull)
-			{
-				/* Yes, fetch from the array */
-				MemoryContext oldcxt;
-				bool		is_null;
-				int			one = 1;
-				Datum		missval;
-
-				if (attrmiss == NULL)
-					attrmiss = (AttrMissing *)
-						MemoryContextAllocZero(CacheMemoryContext,
-											   relation->rd_rel->relnatts *
-											   sizeof(AttrMissing));
-
-				missval = array_get_element(missingval,
-											1,
-											&one,
-											-1,
-											attp->attlen,
-											attp->attbyval,
-											attp->attalign,
-											&is_null);
-				Assert(!is_null);
-				if (attp->attbyval)
-				{
-					/* for copy by val just copy the datum direct */
-					attrmiss[attnum - 1].am_value = missval;
-				}
-				else
-				{
-					/* otherwise copy in the correct context */
-					oldcxt = MemoryContextSwitchTo(CacheMemoryContext);
-					attrmiss[attnum - 1].am_value = datumCopy(missval,
-															  attp->attbyval,
-															  attp->attlen);
-					MemoryContextSwitchTo(oldcxt);
-				}
-				attrmiss[attnum - 1].am_present = true;
-			}
-		}
-		need--;
-		if (need == 0)
-			break;
 	}
 
-	/*
-	 * end the scan and close the attribute relation
-	 */
-	systable_endscan(pg_attribute_scan);
-	table_close(pg_attribute_desc, AccessShareLock);
-
-	if (need != 0)
-		elog(ERROR, "catalog is missing %d attribute(s) for relid %u",
-			 need, RelationGetRelid(relation));
-
 	/*
 	 * The attcacheoff values we read from pg_attribute should all be -1
 	 * ("unknown").  Verify this if assert checking is on.  They will be
 	 * computed when and if needed during tuple access.
 	 */
 #ifdef USE_ASSERT_CHECKING
-	{
-		int			i;
-
-		for (i = 0; i < RelationGetNumberOfAttributes(relation); i++)
-			Assert(TupleDescAttr(relation->rd_att, i)->attcacheoff == -1);
-	}
+	for (i = 0; i < RelationGetNumberOfAttributes(relation); i++)
+		Assert(TupleDescAttr(relation->rd_att, i)->attcacheoff == -1);
 #endif
 
 	/*
@@ -1032,6 +1082,7 @@ RelationBuildDesc(Oid targetRelId, bool insertIt)
 	Oid			relid;
 	HeapTuple	pg_class_tuple;
 	Form_pg_class relp;
+	uint64		shared_token;
 
 	/*
 	 * This function and its subroutines can allocate a good deal of transient
@@ -1055,6 +1106,13 @@ RelationBuildDesc(Oid targetRelId, bool insertIt)
 	oldcxt = MemoryContextSwitchTo(tmpcxt);
 #endif
 
+	/*
+	 * Register with the shared relation cache before reading any catalogs,
+	 * so that an invalidation arriving while we work keeps us from
+	 * publishing stale data there.
+	 */
+	shared_token = SharedRelCacheBeginBuild(targetRelId);
+
 	/*
 	 * find the tuple in pg_class corresponding to the given relation id
 	 */
@@ -1135,6 +1193,11 @@ RelationBuildDesc(Oid targetRelId, bool insertIt)
 				relation->rd_islocaltemp = false;
 			}
 			break;
+		case RELPERSISTENCE_GLOBAL_TEMP:
+			/* every session accesses its own copy, see globaltemp.c */
+			relation->rd_backend = BackendIdForTempRelations();
+			relation->rd_islocaltemp = true;
+			break;
 		default:
 			elog(ERROR, "invalid relpersistence: %c",
 				 relation->rd_rel->relpersistence);
@@ -1144,7 +1207,7 @@ RelationBuildDesc(Oid targetRelId, bool insertIt)
 	/*
 	 * initialize the tuple descriptor (relation->rd_att).
 	 */
-	RelationBuildTupleDesc(relation);
+	RelationBuildTupleDesc(relation, shared_token);
 
 	/*
 	 * Fetch rules and triggers that affect this relation
@@ -2004,6 +2067,7 @@ formrdesc(const char *relationName, Oid relationReltype,
 Relation
 RelationIdGetRelation(Oid relationId)
 {
+	RelIdCacheEnt *hentry;
 	Relation	rd;
 
 	/* Make sure we're in an xact, even if this ends up being a cache hit */
@@ -2012,10 +2076,17 @@ RelationIdGetRelation(Oid relationId)
 	/*
 	 * first try to find reldesc in the cache
 	 */
-	RelationIdCacheLookup(relationId, rd);
+	hentry = (RelIdCacheEnt *) hash_search(RelationIdCache,
+										   (void *) &relationId,
+										   HASH_FIND, NULL);
+	rd = hentry ? hentry->reldesc : NULL;
 
 	if (RelationIsValid(rd))
 	{
+		relcache_hits++;
+		if (max_relation_cache_entries >= 0)
+			dlist_move_tail(&RelationLRUList, &hentry->lru_node);
+
 		/* return NULL for dropped relations */
 		if (rd->rd_droppedSubid != InvalidSubTransactionId)
 		{
@@ -2055,6 +2126,7 @@ RelationIdGetRelation(Oid relationId)
 	 * no reldesc in the cache, so have RelationBuildDesc() build one and add
 	 * it.
 	 */
+	relcache_misses++;
 	rd = RelationBuildDesc(relationId, true);
 	if (RelationIsValid(rd))
 		RelationIncrementReferenceCount(rd);
@@ -2384,6 +2456,8 @@ RelationDestroyRelation(Relation relation, bool remember_tupdesc)
 	bms_free(relation->rd_keyattr);
 	bms_free(relation->rd_pkattr);
 	bms_free(relation->rd_idattr);
+	bms_free(relation->rd_hotblockingattr);
+	bms_free(relation->rd_summarizedattr);
 	if (relation->rd_pubactions)
 		pfree(relation->rd_pubactions);
 	if (relation->rd_options)
@@ -3119,6 +3193,66 @@ AtEOXact_RelationCache(bool isCommit)
 	eoxact_list_overflowed = false;
 	NextEOXactTupleDescNum = 0;
 	EOXactTupleDescArrayLen = 0;
+
+	RelationCacheTrim();
+}
+
+/*
+ * RelationCacheTrim
+ *
+ *	Evict least recently used relcache entries until there are no more than
+ *	max_relation_cache_entries left.
+ *
+ * This is done at main-transaction end, when almost all entries are
+ * unreferenced and nothing can be iterating over the cache.  Nailed
+ * entries, and any that are still referenced or still carry
+ * transaction-local state, are kept; evicting the others is no different
+ * from what a relcache invalidation would do to them.
+ */
+static void
+RelationCacheTrim(void)
+{
+	long		nskipped = 0;
+
+	if (max_relation_cache_entries < 0)
+		return;
+
+	while (hash_get_num_entries(RelationIdCache) > max_relation_cache_entries &&
+		   nskipped < hash_get_num_entries(RelationIdCache))
+	{
+		RelIdCacheEnt *hentry = dlist_head_element(RelIdCacheEnt, lru_node,
+												   &RelationLRUList);
+		Relation	relation = hentry->reldesc;
+
+		if (!RelationHasReferenceCountZero(relation) ||
+			relation->rd_isnailed ||
+			relation->rd_createSubid != InvalidSubTransactionId ||
+			relation->rd_firstRelfilenodeSubid != InvalidSubTransactionId ||
+			relation->rd_droppedSubid != InvalidSubTransactionId)
+		{
+			dlist_move_tail(&RelationLRUList, &hentry->lru_node);
+			nskipped++;
+			continue;
+		}
+
+		RelationClearRelation(relation, false);
+		relcache_evictions++;
+	}
+}
+
+/*
+ * RelationCacheGetStats
+ *
+ *	Report the size of the relation cache and how well it is working.
+ */
+void
+RelationCacheGetStats(int64 *nrels, uint64 *hits, uint64 *misses,
+					  uint64 *evictions)
+{
+	*nrels = RelationIdCache ? hash_get_num_entries(RelationIdCache) : 0;
+	*hits = relcache_hits;
+	*misses = relcache_misses;
+	*evictions = relcache_evictions;
 }
 
 /*
@@ -3481,6 +3615,10 @@ RelationBuildLocalRelation(const char *relname,
 			rel->rd_backend = BackendIdForTempRelations();
 			rel->rd_islocaltemp = true;
 			break;
+		case RELPERSISTENCE_GLOBAL_TEMP:
+			rel->rd_backend = BackendIdForTempRelations();
+			rel->rd_islocaltemp = true;
+			break;
 		default:
 			elog(ERROR, "invalid relpersistence: %c", relpersistence);
 			break;
@@ -3582,6 +3720,10 @@ RelationBuildLocalRelation(const char *relname,
  * remainder of the current transaction.  This limits the usefulness to cases
  * such as TRUNCATE or rebuilding an index from scratch.
  *
+ * A global temporary relation's relfilenode is shared by all sessions, so
+ * for one of those we just replace the current session's storage instead,
+ * which can't be rolled back.
+ *
  * Caller must already hold exclusive lock on the relation.
  */
 void
@@ -3595,6 +3737,13 @@ RelationSetNewRelfilenode(Relation relation, char persistence)
 	TransactionId freezeXid = InvalidTransactionId;
 	RelFileNode newrnode;
 
+	if (RelationIsGlobalTemp(relation))
+	{
+		Assert(persistence == RELPERSISTENCE_GLOBAL_TEMP);
+		GlobalTempRelationResetStorage(relation);
+		return;
+	}
+
 	/* Allocate a new relfilenode */
 	newrelfilenode = GetNewRelFileNode(relation->rd_rel->reltablespace, NULL,
 									   persistence);
@@ -4945,6 +5094,8 @@ Bitmapset *
 RelationGetIndexAttrBitmap(Relation relation, IndexAttrBitmapKind attrKind)
 {
 	Bitmapset  *indexattrs;		/* indexed columns */
+	Bitmapset  *hotblockingattrs;	/* columns with HOT blocking indexes */
+	Bitmapset  *summarizedattrs;	/* columns with summarizing indexes */
 	Bitmapset  *uindexattrs;	/* columns in unique indexes */
 	Bitmapset  *pkindexattrs;	/* columns in the primary index */
 	Bitmapset  *idindexattrs;	/* columns in the replica identity */
@@ -4962,6 +5113,10 @@ RelationGetIndexAttrBitmap(Relation relation, IndexAttrBitmapKind attrKind)
 		{
 			case INDEX_ATTR_BITMAP_ALL:
 				return bms_copy(relation->rd_indexattr);
+			case INDEX_ATTR_BITMAP_HOT_BLOCKING:
+				return bms_copy(relation->rd_hotblockingattr);
+			case INDEX_ATTR_BITMAP_SUMMARIZED:
+				return bms_copy(relation->rd_summarizedattr);
 			case INDEX_ATTR_BITMAP_KEY:
 				return bms_copy(relation->rd_keyattr);
 			case INDEX_ATTR_BITMAP_PRIMARY_KEY:
@@ -5008,6 +5163,8 @@ restart:
 	 * won't be returned at all by RelationGetIndexList.
 	 */
 	indexattrs = NULL;
+	hotblockingattrs = NULL;
+	summarizedattrs = NULL;
 	uindexattrs = NULL;
 	pkindexattrs = NULL;
 	idindexattrs = NULL;
@@ -5023,6 +5180,7 @@ restart:
 		bool		isKey;		/* candidate key */
 		bool		isPK;		/* primary key */
 		bool		isIDKey;	/* replica identity index */
+		Bitmapset **attrs;
 
 		indexDesc = index_open(indexOid, AccessShareLock);
 
@@ -5060,6 +5218,15 @@ restart:
 		/* Is this index the configured (or default) replica identity? */
 		isIDKey = (indexOid == relreplindex);
 
+		/*
+		 * Changes to the columns of summarizing indexes don't prevent HOT
+		 * updates, so collect those separately.
+		 */
+		if (indexDesc->rd_indam->amsummarizing)
+			attrs = &summarizedattrs;
+		else
+			attrs = &hotblockingattrs;
+
 		/* Collect simple attribute references */
 		for (i = 0; i < indexDesc->rd_index->indnatts; i++)
 		{
@@ -5077,6 +5244,8 @@ restart:
 			{
 				indexattrs = bms_add_member(indexattrs,
 											attrnum - FirstLowInvalidHeapAttributeNumber);
+				*attrs = bms_add_member(*attrs,
+										attrnum - FirstLowInvalidHeapAttributeNumber);
 
 				if (isKey && i < indexDesc->rd_index->indnkeyatts)
 					uindexattrs = bms_add_member(uindexattrs,
@@ -5094,9 +5263,14 @@ restart:
 
 		/* Collect all attributes used in expressions, too */
 		pull_varattnos(indexExpressions, 1, &indexattrs);
+		pull_varattnos(indexExpressions, 1, attrs);
 
-		/* Collect all attributes in the index predicate, too */
+		/*
+		 * Collect all attributes in the index predicate, too.  Changes to
+		 * these always block HOT, even for summarizing indexes.
+		 */
 		pull_varattnos(indexPredicate, 1, &indexattrs);
+		pull_varattnos(indexPredicate, 1, &hotblockingattrs);
 
 		index_close(indexDesc, AccessShareLock);
 	}
@@ -5124,6 +5298,8 @@ restart:
 		bms_free(uindexattrs);
 		bms_free(pkindexattrs);
 		bms_free(idindexattrs);
+		bms_free(hotblockingattrs);
+		bms_free(summarizedattrs);
 		bms_free(indexattrs);
 
 		goto restart;
@@ -5138,6 +5314,10 @@ restart:
 	relation->rd_pkattr = NULL;
 	bms_free(relation->rd_idattr);
 	relation->rd_idattr = NULL;
+	bms_free(relation->rd_hotblockingattr);
+	relation->rd_hotblockingattr = NULL;
+	bms_free(relation->rd_summarizedattr);
+	relation->rd_summarizedattr = NULL;
 
 	/*
 	 * Now save copies of the bitmaps in the relcache entry.  We intentionally
@@ -5150,6 +5330,8 @@ restart:
 	relation->rd_keyattr = bms_copy(uindexattrs);
 	relation->rd_pkattr = bms_copy(pkindexattrs);
 	relation->rd_idattr = bms_copy(idindexattrs);
+	relation->rd_hotblockingattr = bms_copy(hotblockingattrs);
+	relation->rd_summarizedattr = bms_copy(summarizedattrs);
 	relation->rd_indexattr = bms_copy(indexattrs);
 	MemoryContextSwitchTo(oldcxt);
 
@@ -5158,6 +5340,10 @@ restart:
 	{
 		case INDEX_ATTR_BITMAP_ALL:
 			return indexattrs;
+		case INDEX_ATTR_BITMAP_HOT_BLOCKING:
+			return hotblockingattrs;
+		case INDEX_ATTR_BITMAP_SUMMARIZED:
+			return summarizedattrs;
 		case INDEX_ATTR_BITMAP_KEY:
 			return uindexattrs;
 		case INDEX_ATTR_BITMAP_PRIMARY_KEY:
@@ -5933,6 +6119,8 @@ load_relcache_init_file(bool shared)
 		rel->rd_keyattr = NULL;
 		rel->rd_pkattr = NULL;
 		rel->rd_idattr = NULL;
+		rel->rd_hotblockingattr = NULL;
+		rel->rd_summarizedattr = NULL;
 		rel->rd_pubactions = NULL;
 		rel->rd_statvalid = false;
 		rel->rd_version_checked = false;
@@ -0,0 +1,512 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedrelcache.c
+ *	  Shared-memory cache of relation tuple descriptors.
+ *
+ * Every backend builds its own relcache entries, and for a table with many
+ * columns the most expensive part of that is reading one pg_attribute row
+ * per column.  When shared_relation_cache_size is set, the fixed-size part
+ * of those rows is kept in a DSA area carved out of the main shared memory
+ * segment, keyed by (database, relation), so that other backends can copy
+ * the attribute array instead of scanning pg_attribute again.
+ *
+ * Correctness rests on the following protocol.  Before a backend starts
+ * reading the catalogs for a relation it calls SharedRelCacheBeginBuild(),
+ * which finds or creates the relation's entry and returns the entry's
+ * version, a value taken from a global counter when the entry was created.
+ * The backend then takes a fresh catalog snapshot and reads pg_attribute.
+ * Afterwards SharedRelCacheStore() publishes the result, but only if the
+ * entry still exists with the same version and is still empty.
+ *
+ * Committed catalog changes are applied by SharedRelCacheProcessInvalidations,
+ * which is called for every batch of messages added to the sinval queue; it
+ * simply removes the affected entries.  Since the invalidations of a commit
+ * are sent after the commit became visible, any builder that began before the
+ * removal will find its entry gone (or replaced by one with a newer version)
+ * and won't publish data read with an older snapshot, while any builder that
+ * began after it will see the change in its catalog snapshot.  As with the
+ * backend-local relcache, readers are protected from concurrent DDL by the
+ * relation lock they hold while opening the relation.
+ *
+ * Only relations whose catalog state is stable from everyone's point of view
+ * are cached: we skip bootstrap/initdb processing, logical decoding, shared
+ * and temporary relations, and transactions that have assigned an XID (and
+ * so might have uncommitted catalog changes of their own).  Relations with
+ * attmissingval entries are not published either, since the missing values
+ * are variable-length and are read from the pg_attribute tuples.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedrelcache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/transam.h"
+#include "access/xact.h"
+#include "catalog/pg_attribute.h"
+#include "miscadmin.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/dsa.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/relcache.h"
+#include "utils/sharedrelcache.h"
+#include "utils/snapmgr.h"
+
+
+/* GUC parameter */
+int			shared_relation_cache_size = 0;
+
+/*
+ * Number of entries evicted at once when the hash table or the DSA area
+ * runs out of space.
+ */
+#define SHARED_RELCACHE_EVICT_BATCH		16
+
+typedef struct SharedRelCacheKey
+{
+	Oid			dbid;
+	Oid			relid;
+} SharedRelCacheKey;
+
+typedef struct SharedRelCacheEntry
+{
+	SharedRelCacheKey key;		/* hash key --- must be first */
+	uint64		version;		/* assigned when the entry was created */
+	int			natts;			/* number of attributes in attrs */
+	dsa_pointer attrs;			/* array of fixed-size pg_attribute parts, or
+								 * InvalidDsaPointer if not yet filled in */
+} SharedRelCacheEntry;
+
+typedef struct SharedRelCacheControl
+{
+	LWLock		lock;			/* protects the hash table and next_version */
+	uint64		next_version;
+	Size		area_size;		/* size of the DSA area that follows */
+} SharedRelCacheControl;
+
+#define SharedRelCacheAreaPlace(ctl) \
+	((char *) (ctl) + MAXALIGN(sizeof(SharedRelCacheControl)))
+
+static SharedRelCacheControl *SharedRelCache = NULL;
+static HTAB *SharedRelCacheHash = NULL;
+
+/* This backend's attachment to the DSA area, made on first use */
+static dsa_area *SharedRelCacheArea = NULL;
+
+static int	SharedRelCacheNumEntries(void);
+static Size SharedRelCacheAreaSize(void);
+static bool SharedRelCacheUsable(Oid relid);
+static void SharedRelCacheAttach(void);
+static void SharedRelCacheRemoveEntry(SharedRelCacheEntry *entry);
+static void SharedRelCacheEvict(const SharedRelCacheKey *keep);
+
+
+/*
+ * We allow one hash entry for each 4kB of cache, which is generous for
+ * tables with many columns and leaves room for the empty entries created by
+ * SharedRelCacheBeginBuild for relations that end up not being cached.
+ */
+static int
+SharedRelCacheNumEntries(void)
+{
+	return Max(shared_relation_cache_size / 4, 128);
+}
+
+static Size
+SharedRelCacheAreaSize(void)
+{
+	return Max(mul_size((Size) shared_relation_cache_size, 1024),
+			   dsa_minimum_size());
+}
+
+/*
+ * SharedRelCacheShmemSize --- report amount of shared memory space needed
+ */
+Size
+SharedRelCacheShmemSize(void)
+{
+	Size		size;
+
+	if (shared_relation_cache_size <= 0)
+		return 0;
+
+	size = MAXALIGN(sizeof(SharedRelCacheControl));
+	size = add_size(size, SharedRelCacheAreaSize());
+	size = add_size(size, hash_estimate_size(SharedRelCacheNumEntries(),
+											 sizeof(SharedRelCacheEntry)));
+	return size;
+}
+
+/*
+ * SharedRelCacheShmemInit --- initialize this module's shared memory
+ */
+void
+SharedRelCacheShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+	int			nentries;
+
+	if (shared_relation_cache_size <= 0)
+		return;
+
+	SharedRelCache = (SharedRelCacheControl *)
+		ShmemInitStruct("Shared Relation Cache",
+						MAXALIGN(sizeof(SharedRelCacheControl)) +
+						SharedRelCacheAreaSize(),
+						&found);
+
+	if (!found)
+	{
+		dsa_area   *area;
+
+		LWLockInitialize(&SharedRelCache->lock, LWTRANCHE_SHARED_RELCACHE);
+		SharedRelCache->next_version = 0;
+		SharedRelCache->area_size = SharedRelCacheAreaSize();
+
+		/*
+		 * Create the area in place, and forbid it from growing into DSM
+		 * segments: all of its memory lives in the main segment, so it
+		 * survives for as long as the server does and needs no handle.  The
+		 * creator's reference is never released, which keeps the area alive
+		 * as backends come and go.
+		 */
+		area = dsa_create_in_place(SharedRelCacheAreaPlace(SharedRelCache),
+								   SharedRelCache->area_size,
+								   LWTRANCHE_SHARED_RELCACHE_DSA, NULL);
+		dsa_set_size_limit(area, SharedRelCache->area_size);
+		dsa_detach(area);
+	}
+
+	nentries = SharedRelCacheNumEntries();
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(SharedRelCacheKey);
+	info.entrysize = sizeof(SharedRelCacheEntry);
+	SharedRelCacheHash = ShmemInitHash("Shared Relation Cache hash",
+									   nentries, nentries,
+									   &info,
+									   HASH_ELEM | HASH_BLOBS | HASH_FIXED_SIZE);
+}
+
+/*
+ * Attach to the DSA area, if this backend hasn't already.
+ */
+static void
+SharedRelCacheAttach(void)
+{
+	MemoryContext oldcxt;
+	void	   *place;
+
+	if (SharedRelCacheArea != NULL)
+		return;
+
+	place = SharedRelCacheAreaPlace(SharedRelCache);
+	oldcxt = MemoryContextSwitchTo(TopMemoryContext);
+	SharedRelCacheArea = dsa_attach_in_place(place, NULL);
+	MemoryContextSwitchTo(oldcxt);
+	on_shmem_exit(dsa_on_shmem_exit_release_in_place, PointerGetDatum(place));
+}
+
+/*
+ * Can the shared cache be used for this relation right now?
+ */
+static bool
+SharedRelCacheUsable(Oid relid)
+{
+	if (SharedRelCache == NULL)
+		return false;
+	if (relid < FirstNormalObjectId || !OidIsValid(MyDatabaseId))
+		return false;
+	if (!IsNormalProcessingMode() || !criticalRelcachesBuilt)
+		return false;
+	if (HistoricSnapshotActive())
+		return false;
+	if (TransactionIdIsValid(GetTopTransactionIdIfAny()))
+		return false;
+	return true;
+}
+
+/*
+ * Remove an entry, freeing its attribute array.  Caller must hold the lock
+ * exclusively.
+ */
+static void
+SharedRelCacheRemoveEntry(SharedRelCacheEntry *entry)
+{
+	if (DsaPointerIsValid(entry->attrs))
+		dsa_free(SharedRelCacheArea, entry->attrs);
+	if (hash_search(SharedRelCacheHash, &entry->key,
+					HASH_REMOVE, NULL) == NULL)
+		elog(ERROR, "shared relation cache hash table corrupted");
+}
+
+/*
+ * Make room by removing a batch of entries other than 'keep'.  There is no
+ * attempt at LRU ordering: entries are cheap to rebuild, and this only
+ * happens when the cache is too small for the working set anyway.  Caller
+ * must hold the lock exclusively.
+ */
+static void
+SharedRelCacheEvict(const SharedRelCacheKey *keep)
+{
+	HASH_SEQ_STATUS status;
+	SharedRelCacheEntry *entry;
+	int			nevicted = 0;
+
+	hash_seq_init(&status, SharedRelCacheHash);
+	while ((entry = (SharedRelCacheEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (keep != NULL &&
+			entry->key.dbid == keep->dbid && entry->key.relid == keep->relid)
+			continue;
+		SharedRelCacheRemoveEntry(entry);
+		if (++nevicted >= SHARED_RELCACHE_EVICT_BATCH)
+		{
+			hash_seq_term(&status);
+			break;
+		}
+	}
+}
+
+/*
+ * SharedRelCacheBeginBuild
+ *		Register the start of a relcache build for relid.
+ *
+ * Returns a token to be passed to SharedRelCacheStore, or 0 if the shared
+ * cache can't be used for this build.  The catalog snapshot is invalidated,
+ * so that the catalog reads making up the build see every change whose
+ * invalidations were processed before the token was handed out.
+ */
+uint64
+SharedRelCacheBeginBuild(Oid relid)
+{
+	SharedRelCacheKey key;
+	SharedRelCacheEntry *entry;
+	bool		found;
+	uint64		token;
+
+	if (!SharedRelCacheUsable(relid))
+		return 0;
+
+	SharedRelCacheAttach();
+
+	key.dbid = MyDatabaseId;
+	key.relid = relid;
+
+	LWLockAcquire(&SharedRelCache->lock, LW_EXCLUSIVE);
+	entry = (SharedRelCacheEntry *)
+		hash_search(SharedRelCacheHash, &key, HASH_ENTER_NULL, &found);
+	if (entry == NULL)
+	{
+		SharedRelCacheEvict(NULL);
+		entry = (SharedRelCacheEntry *)
+			hash_search(SharedRelCacheHash, &key, HASH_ENTER_NULL, &found);
+	}
+	if (entry == NULL)
+		token = 0;
+	else
+	{
+		if (!found)
+		{
+			entry->version = ++SharedRelCache->next_version;
+			entry->natts = 0;
+			entry->attrs = InvalidDsaPointer;
+		}
+		token = entry->version;
+	}
+	LWLockRelease(&SharedRelCache->lock);
+
+	if (token != 0)
+		InvalidateCatalogSnapshot();
+
+	return token;
+}
+
+/*
+ * SharedRelCacheLookup
+ *		Fill in the attributes of tupdesc from the shared cache.
+ *
+ * Returns true on success.  tupdesc->natts must already be set from the
+ * relation's pg_class entry; a cached array of a different length is not
+ * used.
+ */
+bool
+SharedRelCacheLookup(Oid relid, TupleDesc tupdesc)
+{
+	SharedRelCacheKey key;
+	SharedRelCacheEntry *entry;
+	bool		result = false;
+
+	if (!SharedRelCacheUsable(relid) || tupdesc->natts <= 0)
+		return false;
+
+	SharedRelCacheAttach();
+
+	key.dbid = MyDatabaseId;
+	key.relid = relid;
+
+	LWLockAcquire(&SharedRelCache->lock, LW_SHARED);
+	entry = (SharedRelCacheEntry *)
+		hash_search(SharedRelCacheHash, &key, HASH_FIND, NULL);
+	if (entry != NULL && DsaPointerIsValid(entry->attrs) &&
+		entry->natts == tupdesc->natts)
+	{
+		char	   *src = dsa_get_address(SharedRelCacheArea, entry->attrs);
+		int			i;
+
+		for (i = 0; i < tupdesc->natts; i++)
+			memcpy(TupleDescAttr(tupdesc, i),
+				   src + i * ATTRIBUTE_FIXED_PART_SIZE,
+				   ATTRIBUTE_FIXED_PART_SIZE);
+		result = true;
+	}
+	LWLockRelease(&SharedRelCache->lock);
+
+	return result;
+}
+
+/*
+ * SharedRelCacheStore
+ *		Publish the attributes of tupdesc, built under the given token.
+ *
+ * Nothing happens if the entry has been invalidated since the token was
+ * handed out, or if someone else filled it in already.  Running out of
+ * shared memory is not an error; the entry just stays empty.
+ */
+void
+SharedRelCacheStore(Oid relid, uint64 token, TupleDesc tupdesc)
+{
+	SharedRelCacheKey key;
+	SharedRelCacheEntry *entry;
+	dsa_pointer dp;
+	char	   *dst;
+	int			i;
+
+	if (token == 0 || !SharedRelCacheUsable(relid) || tupdesc->natts <= 0)
+		return;
+
+	SharedRelCacheAttach();
+
+	key.dbid = MyDatabaseId;
+	key.relid = relid;
+
+	LWLockAcquire(&SharedRelCache->lock, LW_EXCLUSIVE);
+	entry = (SharedRelCacheEntry *)
+		hash_search(SharedRelCacheHash, &key, HASH_FIND, NULL);
+	if (entry == NULL || entry->version != token ||
+		DsaPointerIsValid(entry->attrs))
+	{
+		LWLockRelease(&SharedRelCache->lock);
+		return;
+	}
+
+	dp = dsa_allocate_extended(SharedRelCacheArea,
+							   (Size) tupdesc->natts * ATTRIBUTE_FIXED_PART_SIZE,
+							   DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(dp))
+	{
+		SharedRelCacheEvict(&key);
+		dp = dsa_allocate_extended(SharedRelCacheArea,
+								   (Size) tupdesc->natts * ATTRIBUTE_FIXED_PART_SIZE,
+								   DSA_ALLOC_NO_OOM);
+	}
+	if (DsaPointerIsValid(dp))
+	{
+		dst = dsa_get_address(SharedRelCacheArea, dp);
+		for (i = 0; i < tupdesc->natts; i++)
+			memcpy(dst + i * ATTRIBUTE_FIXED_PART_SIZE,
+				   TupleDescAttr(tupdesc, i),
+				   ATTRIBUTE_FIXED_PART_SIZE);
+		entry->natts = tupdesc->natts;
+		entry->attrs = dp;
+	}
+	LWLockRelease(&SharedRelCache->lock);
+}
+
+/*
+ * SharedRelCacheProcessInvalidations
+ *		Remove the entries affected by a batch of sinval messages.
+ *
+ * This is called for every batch added to the sinval queue, whether from
+ * transaction commit, COMMIT PREPARED or WAL replay.  A relcache message
+ * removes the relation's entry (or the whole database's, for a relcache
+ * reset); a catalog message for pg_attribute, sent by VACUUM FULL or CLUSTER
+ * of that catalog, removes the whole database's entries.  Other message
+ * types don't concern us.
+ */
+void
+SharedRelCacheProcessInvalidations(const SharedInvalidationMessage *msgs, int n)
+{
+	bool		locked = false;
+	int			i;
+
+	if (SharedRelCache == NULL)
+		return;
+
+	for (i = 0; i < n; i++)
+	{
+		const SharedInvalidationMessage *msg = &msgs[i];
+		Oid			dbid;
+		Oid			relid;
+
+		if (msg->id == SHAREDINVALRELCACHE_ID)
+		{
+			dbid = msg->rc.dbId;
+			relid = msg->rc.relId;
+		}
+		else if (msg->id == SHAREDINVALCATALOG_ID &&
+				 msg->cat.catId == AttributeRelationId)
+		{
+			dbid = msg->cat.dbId;
+			relid = InvalidOid;
+		}
+		else
+			continue;
+
+		/* shared relations are never cached */
+		if (!OidIsValid(dbid))
+			continue;
+
+		if (!locked)
+		{
+			SharedRelCacheAttach();
+			LWLockAcquire(&SharedRelCache->lock, LW_EXCLUSIVE);
+			locked = true;
+		}
+
+		if (OidIsValid(relid))
+		{
+			SharedRelCacheKey key;
+			SharedRelCacheEntry *entry;
+
+			key.dbid = dbid;
+			key.relid = relid;
+			entry = (SharedRelCacheEntry *)
+				hash_search(SharedRelCacheHash, &key, HASH_FIND, NULL);
+			if (entry != NULL)
+				SharedRelCacheRemoveEntry(entry);
+		}
+		else
+		{
+			HASH_SEQ_STATUS status;
+			SharedRelCacheEntry *entry;
+
+			hash_seq_init(&status, SharedRelCacheHash);
+			while ((entry = (SharedRelCacheEntry *) hash_seq_search(&status)) != NULL)
+			{
+				if (entry->key.dbid == dbid)
+					SharedRelCacheRemoveEntry(entry);
+			}
+		}
+	}
+
+	if (locked)
+		LWLockRelease(&SharedRelCache->lock);
+}
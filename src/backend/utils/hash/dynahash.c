@@ -22,6 +22,14 @@
  * lookup key's hash value as a partition number --- this will work because
  * of the way calc_bucket() maps hash values to bucket numbers.
  *
+ * A partitioned table can also be searched without any lock at all using
+ * hash_search_optimistic(), if the caller has some other way to find out
+ * whether the partition was modified while the search ran, typically a
+ * per-partition change counter that writers advance before and after each
+ * modification.  This works because no memory is ever released from a
+ * shared table, so following a stale pointer at worst leads into some other
+ * chain or into the freelist, never out of the table.
+ *
  * For hash tables in shared memory, the memory allocator function should
  * match malloc's semantics of returning NULL on failure.  For hash tables
  * in local memory, we typically use palloc() which will throw error on
@@ -253,6 +261,11 @@ struct HTAB
  */
 #define MOD(x,y)			   ((x) & ((y)-1))
 
+/*
+ * Maximum number of entries hash_search_optimistic visits before it gives up
+ */
+#define HASH_OPTIMISTIC_MAX_CHAIN 64
+
 #ifdef HASH_STATISTICS
 static long hash_accesses,
 			hash_collisions,
@@ -1104,6 +1117,63 @@ hash_search_with_hash_value(HTAB *hashp,
 	return NULL;				/* keep compiler quiet */
 }
 
+/*
+ * hash_search_optimistic -- look up key in a partitioned table without a lock
+ *
+ * This is like hash_search_with_hash_value with HASH_FIND, except that the
+ * caller need not hold the lock on the key's partition.  Entries may be
+ * added or removed concurrently, so the result can be wrong: the caller
+ * must check afterwards that the partition wasn't modified since before
+ * the call (see comments at the top of the file), and must not trust the
+ * result, nor the contents of a returned entry, otherwise.
+ *
+ * A chain being modified under us could seem to contain a cycle.  To make
+ * sure we return, we give up after HASH_OPTIMISTIC_MAX_CHAIN entries, which
+ * is far more than any chain in a reasonably sized table should hold; if so,
+ * *complete is set to false, and the caller has to search again while
+ * holding the lock.  Otherwise *complete is set to true.
+ */
+void *
+hash_search_optimistic(HTAB *hashp,
+					   const void *keyPtr,
+					   uint32 hashvalue,
+					   bool *complete)
+{
+	HASHHDR    *hctl = hashp->hctl;
+	uint32		bucket;
+	HASHSEGMENT segp;
+	HASHBUCKET	currBucket;
+	HashCompareFunc match = hashp->match;
+	Size		keysize = hashp->keysize;
+	int			nvisited = 0;
+
+	/* the bucket layout of a partitioned table never changes */
+	Assert(IS_PARTITIONED(hctl));
+
+	bucket = calc_bucket(hctl, hashvalue);
+	segp = hashp->dir[bucket >> hashp->sshift];
+	currBucket = segp[MOD(bucket, hashp->ssize)];
+
+	*complete = true;
+
+	while (currBucket != NULL)
+	{
+		if (currBucket->hashvalue == hashvalue &&
+			match(ELEMENTKEY(currBucket), keyPtr, keysize) == 0)
+			return (void *) ELEMENTKEY(currBucket);
+
+		if (++nvisited >= HASH_OPTIMISTIC_MAX_CHAIN)
+		{
+			*complete = false;
+			return NULL;
+		}
+
+		currBucket = currBucket->link;
+	}
+
+	return NULL;
+}
+
 /*
  * hash_update_hash_key -- change the hash key of an existing table entry
  *
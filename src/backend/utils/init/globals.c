@@ -33,6 +33,7 @@ volatile sig_atomic_t ProcDiePending = false;
 volatile sig_atomic_t ClientConnectionLost = false;
 volatile sig_atomic_t IdleInTransactionSessionTimeoutPending = false;
 volatile sig_atomic_t ProcSignalBarrierPending = false;
+volatile sig_atomic_t LogMemoryContextPending = false;
 volatile uint32 InterruptHoldoffCount = 0;
 volatile uint32 QueryCancelHoldoffCount = 0;
 volatile uint32 CritSectionCount = 0;
@@ -135,6 +136,15 @@ int			max_worker_processes = 8;
 int			max_parallel_workers = 8;
 int			MaxBackends = 0;
 
+/* GUC parameters for the sizes of the SLRU buffer pools, in pages */
+int			transaction_buffers = 0;	/* 0 means auto-size */
+int			subtransaction_buffers = 0; /* 0 means auto-size */
+int			commit_timestamp_buffers = 0;	/* 0 means auto-size */
+int			multixact_offset_buffers = 16;
+int			multixact_member_buffers = 32;
+int			notify_buffers = 16;
+int			serializable_buffers = 32;
+
 int			VacuumCostPageHit = 1;	/* GUC parameters for vacuum */
 int			VacuumCostPageMiss = 10;
 int			VacuumCostPageDirty = 20;
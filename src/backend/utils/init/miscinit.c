@@ -275,6 +275,9 @@ GetBackendTypeDesc(BackendType backendType)
 		case B_LOGGER:
 			backendDesc = "logger";
 			break;
+		case B_CONNECTION_PROXY:
+			backendDesc = "connection proxy";
+			break;
 	}
 
 	return backendDesc;
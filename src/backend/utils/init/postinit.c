@@ -236,7 +236,10 @@ PerformAuthentication(Port *port)
 	 * Now perform authentication exchange.
 	 */
 	set_ps_display("authentication");
-	ClientAuthentication(port); /* might not return, if failure */
+	if (port->proxied)
+		ClientAuthenticationBypass(port);
+	else
+		ClientAuthentication(port); /* might not return, if failure */
 
 	/*
 	 * Done with authentication.  Disable the timeout, and log if needed.
@@ -513,6 +516,39 @@ InitializeMaxBackends(void)
 		elog(ERROR, "too many backends configured");
 }
 
+/*
+ * Initialize the number of fast-path lock groups per backend.
+ *
+ * This must happen after max_locks_per_transaction is final (i.e. after
+ * loading shared_preload_libraries) and before sizing shared memory.  We
+ * size the fast-path arrays so that a backend can hold about
+ * max_locks_per_transaction relation locks without falling back to the
+ * main lock table, rounded up to a power of two number of groups and
+ * clamped to [1, FP_LOCK_GROUPS_PER_BACKEND_MAX].
+ *
+ * Like MaxBackends, in an EXEC_BACKEND environment the value is passed down
+ * from postmaster to subprocesses via BackendParameters.
+ */
+void
+InitializeFastPathLocks(void)
+{
+	Assert(FastPathLockGroupsPerBackend == 0);
+
+	/* we need at least one group */
+	FastPathLockGroupsPerBackend = 1;
+
+	while (FastPathLockGroupsPerBackend < FP_LOCK_GROUPS_PER_BACKEND_MAX)
+	{
+		/* stop once we exceed max_locks_per_xact */
+		if (FastPathLockSlotsPerBackend() >= max_locks_per_xact)
+			break;
+
+		FastPathLockGroupsPerBackend *= 2;
+	}
+
+	Assert(FastPathLockGroupsPerBackend <= FP_LOCK_GROUPS_PER_BACKEND_MAX);
+}
+
 /*
  * Early initialization of a backend (either standalone or under postmaster).
  * This happens even before InitPostgres.
@@ -31,22 +31,29 @@
 
 #include "access/commit_ts.h"
 #include "access/gin.h"
+#include "access/nbtree.h"
 #include "access/rmgr.h"
+#include "access/slru.h"
 #include "access/tableam.h"
+#include "access/toast_compression.h"
 #include "access/transam.h"
 #include "access/twophase.h"
 #include "access/xact.h"
 #include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_authid.h"
 #include "catalog/storage.h"
 #include "commands/async.h"
 #include "commands/prepare.h"
+#include "commands/sequence.h"
 #include "commands/trigger.h"
 #include "commands/user.h"
 #include "commands/vacuum.h"
 #include "commands/variable.h"
 #include "common/string.h"
+#include "executor/instrument.h"
+#include "executor/nodeHashjoin.h"
 #include "funcapi.h"
 #include "jit/jit.h"
 #include "libpq/auth.h"
@@ -66,9 +73,13 @@
 #include "postmaster/autovacuum.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
+#include "postmaster/pgarch.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
 #include "postmaster/syslogger.h"
+#include "postmaster/waitsampler.h"
 #include "postmaster/walwriter.h"
+#include "regex/regex.h"
 #include "replication/logicallauncher.h"
 #include "replication/reorderbuffer.h"
 #include "replication/slot.h"
@@ -76,18 +87,23 @@
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
 #include "storage/bufmgr.h"
+#include "storage/buffile.h"
 #include "storage/dsm_impl.h"
 #include "storage/fd.h"
 #include "storage/large_object.h"
 #include "storage/pg_shmem.h"
 #include "storage/predicate.h"
+#include "storage/sinvaladt.h"
 #include "storage/proc.h"
+#include "storage/smgr.h"
 #include "storage/standby.h"
+#include "tcop/autoprepare.h"
 #include "tcop/tcopprot.h"
 #include "tsearch/ts_cache.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/bytea.h"
+#include "utils/catcache.h"
 #include "utils/float.h"
 #include "utils/guc_tables.h"
 #include "utils/memutils.h"
@@ -96,7 +112,9 @@
 #include "utils/plancache.h"
 #include "utils/portal.h"
 #include "utils/ps_status.h"
+#include "utils/relcache.h"
 #include "utils/rls.h"
+#include "utils/sharedrelcache.h"
 #include "utils/snapmgr.h"
 #include "utils/tzparser.h"
 #include "utils/varlena.h"
@@ -162,6 +180,8 @@ static bool call_enum_check_hook(struct config_enum *conf, int *newval,
 
 static bool check_log_destination(char **newval, void **extra, GucSource source);
 static void assign_log_destination(const char *newval, void *extra);
+static bool check_io_direct(char **newval, void **extra, GucSource source);
+static void assign_io_direct(const char *newval, void *extra);
 
 static bool check_wal_consistency_checking(char **newval, void **extra,
 										   GucSource source);
@@ -177,6 +197,14 @@ static void assign_syslog_facility(int newval, void *extra);
 static void assign_syslog_ident(const char *newval, void *extra);
 static void assign_session_replication_role(int newval, void *extra);
 static bool check_temp_buffers(int *newval, void **extra, GucSource source);
+static bool check_transaction_buffers(int *newval, void **extra, GucSource source);
+static bool check_subtransaction_buffers(int *newval, void **extra, GucSource source);
+static bool check_commit_ts_buffers(int *newval, void **extra, GucSource source);
+static bool check_multixact_offset_buffers(int *newval, void **extra, GucSource source);
+static bool check_multixact_member_buffers(int *newval, void **extra, GucSource source);
+static bool check_notify_buffers(int *newval, void **extra, GucSource source);
+static bool check_serial_buffers(int *newval, void **extra, GucSource source);
+static bool check_shared_invalidation_queue_size(int *newval, void **extra, GucSource source);
 static bool check_bonjour(bool *newval, void **extra, GucSource source);
 static bool check_ssl(bool *newval, void **extra, GucSource source);
 static bool check_stage_log_stats(bool *newval, void **extra, GucSource source);
@@ -200,7 +228,9 @@ static bool check_autovacuum_max_workers(int *newval, void **extra, GucSource so
 static bool check_max_wal_senders(int *newval, void **extra, GucSource source);
 static bool check_autovacuum_work_mem(int *newval, void **extra, GucSource source);
 static bool check_effective_io_concurrency(int *newval, void **extra, GucSource source);
+static bool check_prefork_backends(int *newval, void **extra, GucSource source);
 static bool check_maintenance_io_concurrency(int *newval, void **extra, GucSource source);
+static bool check_max_recovery_prefetch_distance(int *newval, void **extra, GucSource source);
 static bool check_huge_page_size(int *newval, void **extra, GucSource source);
 static void assign_pgstat_temp_directory(const char *newval, void *extra);
 static bool check_application_name(char **newval, void **extra, GucSource source);
@@ -430,6 +460,65 @@ static const struct config_enum_entry synchronous_commit_options[] = {
 	{NULL, 0, false}
 };
 
+/*
+ * Although only "on", "off", and the algorithm names are documented, we
+ * accept all the likely variants of "on" and "off".  "on" means pglz.
+ */
+static const struct config_enum_entry default_toast_compression_options[] = {
+	{"pglz", TOAST_PGLZ_COMPRESSION, false},
+#ifdef USE_LZ4
+	{"lz4", TOAST_LZ4_COMPRESSION, false},
+#endif
+#ifdef USE_ZSTD
+	{"zstd", TOAST_ZSTD_COMPRESSION, false},
+#endif
+	{NULL, 0, false}
+};
+
+static const struct config_enum_entry wal_compression_options[] = {
+	{"pglz", WAL_COMPRESSION_PGLZ, false},
+#ifdef USE_LZ4
+	{"lz4", WAL_COMPRESSION_LZ4, false},
+#endif
+#ifdef USE_ZSTD
+	{"zstd", WAL_COMPRESSION_ZSTD, false},
+#endif
+	{"on", WAL_COMPRESSION_PGLZ, false},
+	{"off", WAL_COMPRESSION_NONE, false},
+	{"true", WAL_COMPRESSION_PGLZ, true},
+	{"false", WAL_COMPRESSION_NONE, true},
+	{"yes", WAL_COMPRESSION_PGLZ, true},
+	{"no", WAL_COMPRESSION_NONE, true},
+	{"1", WAL_COMPRESSION_PGLZ, true},
+	{"0", WAL_COMPRESSION_NONE, true},
+	{NULL, 0, false}
+};
+
+static const struct config_enum_entry temp_file_compression_options[] = {
+	{"off", TEMP_FILE_COMPRESSION_OFF, false},
+	{"pglz", TEMP_FILE_COMPRESSION_PGLZ, false},
+	{NULL, 0, false}
+};
+
+static const struct config_enum_entry logical_decoding_spill_compression_options[] = {
+	{"off", LOGICAL_DECODING_SPILL_COMPRESSION_OFF, false},
+	{"pglz", LOGICAL_DECODING_SPILL_COMPRESSION_PGLZ, false},
+	{NULL, 0, false}
+};
+
+static const struct config_enum_entry shared_memory_numa_options[] = {
+	{"off", SHMEM_NUMA_OFF, false},
+	{"interleave", SHMEM_NUMA_INTERLEAVE, false},
+	{NULL, 0, false}
+};
+
+static const struct config_enum_entry timing_clock_source_options[] = {
+	{"auto", TIMING_CLOCK_SOURCE_AUTO, false},
+	{"system", TIMING_CLOCK_SOURCE_SYSTEM, false},
+	{"cycle_counter", TIMING_CLOCK_SOURCE_CYCLE_COUNTER, false},
+	{NULL, 0, false}
+};
+
 /*
  * Although only "on", "off", "try" are documented, we accept all the likely
  * variants of "on" and "off".
@@ -506,6 +595,7 @@ extern const struct config_enum_entry archive_mode_options[];
 extern const struct config_enum_entry recovery_target_action_options[];
 extern const struct config_enum_entry sync_method_options[];
 extern const struct config_enum_entry dynamic_shared_memory_options[];
+extern const struct config_enum_entry io_method_options[];
 
 /*
  * GUC option variables that are exported from this module
@@ -581,6 +671,8 @@ int			ssl_renegotiation_limit;
  */
 int			huge_pages;
 int			huge_page_size;
+int			shared_memory_numa;
+int			shared_memory_huge_page_size;
 
 /*
  * These variables are all dummies that don't do anything, except in some
@@ -615,6 +707,7 @@ static char *recovery_target_string;
 static char *recovery_target_xid_string;
 static char *recovery_target_name_string;
 static char *recovery_target_lsn_string;
+static char *io_direct_string;
 
 
 /* should be static, but commands/variable.c needs to get at this */
@@ -705,6 +798,8 @@ const char *const config_group_names[] =
 	gettext_noop("Write-Ahead Log / Checkpoints"),
 	/* WAL_ARCHIVING */
 	gettext_noop("Write-Ahead Log / Archiving"),
+	/* WAL_RECOVERY */
+	gettext_noop("Write-Ahead Log / Recovery"),
 	/* WAL_ARCHIVE_RECOVERY */
 	gettext_noop("Write-Ahead Log / Archive Recovery"),
 	/* WAL_RECOVERY_TARGET */
@@ -1016,6 +1111,16 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_resultcache", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of result caching."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_resultcache,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_nestloop", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of nested-loop join plans."),
@@ -1046,6 +1151,16 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_hashjoin_bloom_filter", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the use of Bloom filters to discard outer rows in hash joins."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_hashjoin_bloom_filter,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_gathermerge", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of gather merge plans."),
@@ -1076,6 +1191,16 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_partitionwise_window", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables partitionwise parallel evaluation of window functions."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_partitionwise_window,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_parallel_append", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of parallel append plans."),
@@ -1096,6 +1221,16 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_parallel_sort", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel sort plans."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_parallel_sort,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_partition_pruning", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables plan-time and run-time partition pruning."),
@@ -1108,6 +1243,16 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_async_append", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of async append plans."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_async_append,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"geqo", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("Enables genetic query optimization."),
@@ -1175,6 +1320,15 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"protocol_compression", PGC_SIGHUP, CONN_AUTH_SETTINGS,
+			gettext_noop("Allows clients to request compression of the protocol stream."),
+			NULL
+		},
+		&protocol_compression,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"fsync", PGC_SIGHUP, WAL_SETTINGS,
 			gettext_noop("Forces synchronization of updates to disk."),
@@ -1259,16 +1413,6 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
-	{
-		{"wal_compression", PGC_SUSET, WAL_SETTINGS,
-			gettext_noop("Compresses full-page writes written in WAL file."),
-			NULL
-		},
-		&wal_compression,
-		false,
-		NULL, NULL, NULL
-	},
-
 	{
 		{"wal_init_zero", PGC_SUSET, WAL_SETTINGS,
 			gettext_noop("Writes zeroes to new WAL files before first use."),
@@ -1652,6 +1796,15 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"vacuum_eager_freeze", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Freezes pages that VACUUM finds all-visible when that is cheap or likely to pay off."),
+			NULL
+		},
+		&vacuum_eager_freeze,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"check_function_bodies", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Check function bodies during CREATE FUNCTION."),
@@ -1940,6 +2093,17 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"btree_heap_prefetch", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Prefetches heap blocks in plain B-tree index scans."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&btree_heap_prefetch,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"jit", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("Allow JIT compilation."),
@@ -2102,6 +2266,28 @@ static struct config_int ConfigureNamesInt[] =
 		8, 1, INT_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"autoprepare_threshold", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the number of executions after which a simple-protocol "
+						 "query is prepared automatically."),
+			gettext_noop("Literals in the query are replaced by parameters, so that "
+						 "executions with different literals share the prepared "
+						 "statement. Zero disables automatic preparation.")
+		},
+		&autoprepare_threshold,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+	{
+		{"autoprepare_limit", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the maximum number of queries remembered for automatic "
+						 "preparation."),
+			NULL
+		},
+		&autoprepare_limit,
+		100, 1, INT_MAX,
+		NULL, NULL, NULL
+	},
 	{
 		{"geqo_threshold", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("Sets the threshold of FROM items beyond which GEQO is used."),
@@ -2231,6 +2417,16 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"prefork_backends", PGC_SIGHUP, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the number of server processes to start ahead of incoming connections."),
+			NULL
+		},
+		&PreforkBackends,
+		0, 0, MAX_BACKENDS,
+		check_prefork_backends, NULL, NULL
+	},
+
 	{
 		{"min_dynamic_shared_memory", PGC_POSTMASTER, RESOURCES_MEM,
 			gettext_noop("Amount of dynamic shared memory reserved at startup."),
@@ -2242,6 +2438,27 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"shared_relation_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the amount of shared memory used to share relation descriptors between sessions."),
+			gettext_noop("0 disables the shared relation cache."),
+			GUC_UNIT_KB
+		},
+		&shared_relation_cache_size,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_relation_size_cache", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of relation sizes cached in shared memory."),
+			gettext_noop("0 disables the shared relation size cache.")
+		},
+		&shared_relation_size_cache,
+		0, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+
 	/*
 	 * We sometimes multiply the number of shared buffers by two without
 	 * checking for overflow, so we mustn't allow more than INT_MAX / 2.
@@ -2257,6 +2474,16 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"clock_sweep_partitions", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of partitions of the buffer replacement clock sweep."),
+			NULL
+		},
+		&clock_sweep_partitions,
+		1, 1, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"temp_buffers", PGC_USERSET, RESOURCES_MEM,
 			gettext_noop("Sets the maximum number of temporary buffers used by each session."),
@@ -2268,6 +2495,103 @@ static struct config_int ConfigureNamesInt[] =
 		check_temp_buffers, NULL, NULL
 	},
 
+	{
+		{"regex_cache_size", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum number of compiled regular expressions cached by each session."),
+			NULL
+		},
+		&regex_cache_size,
+		32, 1, 100000,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"transaction_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the transaction status cache."),
+			gettext_noop("0 means use a fraction of \"shared_buffers\"."),
+			GUC_UNIT_BLOCKS
+		},
+		&transaction_buffers,
+		0, 0, SLRU_MAX_ALLOWED_BUFFERS,
+		check_transaction_buffers, NULL, NULL
+	},
+
+	{
+		{"subtransaction_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the subtransaction cache."),
+			gettext_noop("0 means use a fraction of \"shared_buffers\"."),
+			GUC_UNIT_BLOCKS
+		},
+		&subtransaction_buffers,
+		0, 0, SLRU_MAX_ALLOWED_BUFFERS,
+		check_subtransaction_buffers, NULL, NULL
+	},
+
+	{
+		{"commit_timestamp_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the commit timestamp cache."),
+			gettext_noop("0 means use a fraction of \"shared_buffers\"."),
+			GUC_UNIT_BLOCKS
+		},
+		&commit_timestamp_buffers,
+		0, 0, SLRU_MAX_ALLOWED_BUFFERS,
+		check_commit_ts_buffers, NULL, NULL
+	},
+
+	{
+		{"multixact_offset_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the MultiXact offset cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&multixact_offset_buffers,
+		16, 16, SLRU_MAX_ALLOWED_BUFFERS,
+		check_multixact_offset_buffers, NULL, NULL
+	},
+
+	{
+		{"multixact_member_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the MultiXact member cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&multixact_member_buffers,
+		32, 16, SLRU_MAX_ALLOWED_BUFFERS,
+		check_multixact_member_buffers, NULL, NULL
+	},
+
+	{
+		{"notify_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the LISTEN/NOTIFY message cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&notify_buffers,
+		16, 16, SLRU_MAX_ALLOWED_BUFFERS,
+		check_notify_buffers, NULL, NULL
+	},
+
+	{
+		{"serializable_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the size of the dedicated buffer pool used for the serializable transaction cache."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&serializable_buffers,
+		32, 16, SLRU_MAX_ALLOWED_BUFFERS,
+		check_serial_buffers, NULL, NULL
+	},
+
+	{
+		{"shared_invalidation_queue_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of cache invalidation messages that can be queued in shared memory."),
+			gettext_noop("Sessions that fall further behind than this must rebuild their caches.")
+		},
+		&shared_invalidation_queue_size,
+		4096, 4096, 1024 * 1024,
+		check_shared_invalidation_queue_size, NULL, NULL
+	},
+
 	{
 		{"port", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
 			gettext_noop("Sets the TCP port the server listens on."),
@@ -2278,6 +2602,36 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"connection_proxies", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the number of connection proxy processes."),
+			gettext_noop("Zero disables connection pooling.")
+		},
+		&ConnectionProxies,
+		0, 0, MAX_CONNECTION_PROXIES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"proxy_port", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the TCP port the connection proxies listen on."),
+			NULL
+		},
+		&ProxyPortNumber,
+		6543, 1, 65535,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"session_pool_size", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the maximum number of backends each connection proxy keeps for a database and user."),
+			NULL
+		},
+		&SessionPoolSize,
+		10, 1, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"unix_socket_permissions", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
 			gettext_noop("Sets the access permissions of the Unix-domain socket."),
@@ -2335,6 +2689,19 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"query_work_mem", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory to be used for the workspaces of a whole query."),
+			gettext_noop("The planner divides this amount among the sort and "
+						 "hash operations of each plan, lowering their "
+						 "work_mem as needed. -1 disables the limit."),
+			GUC_UNIT_KB | GUC_EXPLAIN
+		},
+		&query_work_mem,
+		-1, -1, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"maintenance_work_mem", PGC_USERSET, RESOURCES_MEM,
 			gettext_noop("Sets the maximum memory to be used for maintenance operations."),
@@ -2358,6 +2725,41 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"after_trigger_queue_mem", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory to be used for queued AFTER trigger events."),
+			gettext_noop("Events beyond this are written to temporary files. "
+						 "-1 disables the limit."),
+			GUC_UNIT_KB
+		},
+		&after_trigger_queue_mem,
+		-1, -1, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"catalog_cache_memory_limit", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory to be used for catalog cache entries."),
+			gettext_noop("Least recently used entries that are not in use are "
+						 "evicted to stay below this limit. -1 disables the limit."),
+			GUC_UNIT_KB
+		},
+		&catalog_cache_memory_limit,
+		-1, -1, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"max_relation_cache_entries", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum number of relation cache entries kept after a transaction."),
+			gettext_noop("Least recently used entries are evicted at transaction "
+						 "end to stay below this limit. -1 disables the limit.")
+		},
+		&max_relation_cache_entries,
+		-1, -1, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	/*
 	 * We use the hopefully-safely-small value of 100kB as the compiled-in
 	 * default for max_stack_depth.  InitializeGUCOptions will increase it if
@@ -2579,6 +2981,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"max_cached_subxids", PGC_POSTMASTER, LOCK_MANAGEMENT,
+			gettext_noop("Sets the number of subtransaction XIDs each backend can advertise in shared memory."),
+			gettext_noop("Once a transaction has more subtransactions with XIDs than this, "
+						 "all snapshots must consult pg_subtrans to check visibility.")
+		},
+		&max_cached_subxids,
+		256, PGPROC_MAX_CACHED_SUBXIDS, PGPROC_MAX_CACHED_SUBXIDS_LIMIT,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"max_pred_locks_per_transaction", PGC_POSTMASTER, LOCK_MANAGEMENT,
 			gettext_noop("Sets the maximum number of predicate locks per transaction."),
@@ -2718,6 +3131,16 @@ static struct config_int ConfigureNamesInt[] =
 		check_wal_buffers, NULL, NULL
 	},
 
+	{
+		{"wal_insert_locks", PGC_POSTMASTER, WAL_SETTINGS,
+			gettext_noop("Sets the number of locks used for concurrent WAL insertion."),
+			NULL
+		},
+		&NumXLogInsertLocks,
+		8, 1, MAX_XLOGINSERT_LOCKS,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_writer_delay", PGC_SIGHUP, WAL_SETTINGS,
 			gettext_noop("Time between WAL flushes performed in the WAL writer."),
@@ -2740,6 +3163,16 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"wal_prealloc_segments", PGC_SIGHUP, WAL_SETTINGS,
+			gettext_noop("Sets the number of future WAL files the WAL writer keeps ready."),
+			NULL
+		},
+		&wal_prealloc_segments,
+		0, 0, 1024,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_skip_threshold", PGC_USERSET, WAL_SETTINGS,
 			gettext_noop("Size of new file to fsync instead of writing WAL."),
@@ -2800,11 +3233,11 @@ static struct config_int ConfigureNamesInt[] =
 		{"commit_delay", PGC_SUSET, WAL_SETTINGS,
 			gettext_noop("Sets the delay in microseconds between transaction commit and "
 						 "flushing WAL to disk."),
-			NULL
+			gettext_noop("-1 chooses the delay automatically.")
 			/* we have no microseconds designation, so can't supply units here */
 		},
 		&CommitDelay,
-		0, 0, 100000,
+		0, -1, 100000,
 		NULL, NULL, NULL
 	},
 
@@ -2912,6 +3345,18 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"bgwriter_lru_min_clean", PGC_SIGHUP, RESOURCES_BGWRITER,
+			gettext_noop("Background writer minimum number of clean buffers to keep ahead of buffer allocation."),
+			gettext_noop("Also allows exceeding bgwriter_lru_maxpages during bursts of buffer allocations. "
+						 "0 disables."),
+			GUC_UNIT_BLOCKS
+		},
+		&bgwriter_lru_min_clean,
+		0, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"bgwriter_flush_after", PGC_SIGHUP, RESOURCES_BGWRITER,
 			gettext_noop("Number of pages after which previously performed writes are flushed to disk."),
@@ -2959,6 +3404,36 @@ static struct config_int ConfigureNamesInt[] =
 		check_maintenance_io_concurrency, NULL, NULL
 	},
 
+	{
+		{"max_recovery_prefetch_distance", PGC_SIGHUP, WAL_RECOVERY,
+			gettext_noop("Maximum distance to read ahead in the WAL to prefetch referenced blocks."),
+			gettext_noop("Set to -1 to disable prefetching during recovery."),
+			GUC_UNIT_BYTE
+		},
+		&max_recovery_prefetch_distance,
+#ifdef USE_PREFETCH
+		256 * 1024,
+#else
+		-1,
+#endif
+		-1, INT_MAX,
+		check_max_recovery_prefetch_distance, NULL, NULL
+	},
+
+	{
+		{"io_combine_limit",
+			PGC_USERSET,
+			RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Limit on the size of data reads and writes."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&io_combine_limit,
+		DEFAULT_IO_COMBINE_LIMIT,
+		1, MAX_IO_COMBINE_LIMIT,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"backend_flush_after", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
 			gettext_noop("Number of pages after which previously performed writes are flushed to disk."),
@@ -3188,6 +3663,16 @@ static struct config_int ConfigureNamesInt[] =
 		check_autovacuum_max_workers, NULL, NULL
 	},
 
+	{
+		{"autovacuum_parallel_workers", PGC_SIGHUP, AUTOVACUUM,
+			gettext_noop("Sets the maximum number of parallel processes an autovacuum worker can use to vacuum a table at risk of wraparound."),
+			NULL
+		},
+		&autovacuum_parallel_workers,
+		0, 0, 1024,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"max_parallel_maintenance_workers", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
 			gettext_noop("Sets the maximum number of parallel processes per maintenance operation."),
@@ -3310,6 +3795,18 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"jit_defer_evaluations", PGC_USERSET, QUERY_TUNING_COST,
+			gettext_noop("Sets the number of evaluations of an expression after which it is JIT compiled."),
+			gettext_noop("Until then the expression is interpreted. "
+						 "0 compiles expressions before query execution starts."),
+			GUC_EXPLAIN
+		},
+		&jit_defer_evaluations,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"min_parallel_table_scan_size", PGC_USERSET, QUERY_TUNING_COST,
 			gettext_noop("Sets the minimum amount of table data for a parallel scan."),
@@ -3366,6 +3863,27 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"wait_sampling_history_size", PGC_POSTMASTER, STATS_COLLECTOR,
+			gettext_noop("Sets the number of wait event samples kept in shared memory."),
+			gettext_noop("Zero disables the wait event sampler.")
+		},
+		&wait_sampling_history_size,
+		0, 0, 10000000,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"wait_sampling_interval", PGC_SIGHUP, STATS_COLLECTOR,
+			gettext_noop("Sets the time between wait event samples."),
+			gettext_noop("Zero pauses sampling."),
+			GUC_UNIT_MS
+		},
+		&wait_sampling_interval,
+		10, 0, 60000,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gin_pending_list_limit", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Sets the maximum size of the pending list for GIN index."),
@@ -3377,6 +3895,26 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"shared_sequence_cache", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Sets the number of sequence values reserved at a time for the shared sequence cache."),
+			gettext_noop("Values of 0 or 1 disable the shared sequence cache.")
+		},
+		&shared_sequence_cache,
+		0, 0, 1000000,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"foreign_key_check_batch_size", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Sets the number of rows whose foreign key checks are done together."),
+			gettext_noop("Zero checks each row separately.")
+		},
+		&foreign_key_check_batch_size,
+		0, 0, 1000000,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"tcp_user_timeout", PGC_USERSET, CLIENT_CONN_OTHER,
 			gettext_noop("TCP user timeout."),
@@ -3399,6 +3937,17 @@ static struct config_int ConfigureNamesInt[] =
 		check_huge_page_size, NULL, NULL
 	},
 
+	{
+		{"shared_memory_huge_page_size", PGC_INTERNAL, PRESET_OPTIONS,
+			gettext_noop("Shows the size of the huge pages used for the main shared memory region."),
+			gettext_noop("Zero if huge pages are not in use."),
+			GUC_UNIT_KB | GUC_NOT_IN_SAMPLE | GUC_DISALLOW_IN_FILE
+		},
+		&shared_memory_huge_page_size,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	/* End-of-list marker */
 	{
 		{NULL, 0, 0, NULL, NULL}, NULL, 0, 0, 0, NULL, NULL, NULL
@@ -3698,6 +4247,16 @@ static struct config_string ConfigureNamesString[] =
 		NULL, NULL, show_archive_command
 	},
 
+	{
+		{"archive_library", PGC_SIGHUP, WAL_ARCHIVING,
+			gettext_noop("Sets the library that will be called to archive a WAL file."),
+			gettext_noop("An empty string indicates that \"archive_command\" should be used.")
+		},
+		&XLogArchiveLibrary,
+		"",
+		NULL, NULL, NULL
+	},
+
 	{
 		{"restore_command", PGC_SIGHUP, WAL_ARCHIVE_RECOVERY,
 			gettext_noop("Sets the shell command that will be called to retrieve an archived WAL file."),
@@ -4448,6 +5007,17 @@ static struct config_string ConfigureNamesString[] =
 		check_backtrace_functions, assign_backtrace_functions, NULL
 	},
 
+	{
+		{"io_direct", PGC_POSTMASTER, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Use direct I/O for file access."),
+			gettext_noop("Valid values are combinations of \"data\" and \"wal\"."),
+			GUC_LIST_INPUT
+		},
+		&io_direct_string,
+		"",
+		check_io_direct, assign_io_direct, NULL
+	},
+
 	/* End-of-list marker */
 	{
 		{NULL, 0, 0, NULL, NULL}, NULL, NULL, NULL, NULL, NULL
@@ -4500,6 +5070,17 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"default_toast_compression", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Sets the default compression method for compressible values."),
+			NULL
+		},
+		&default_toast_compression,
+		TOAST_PGLZ_COMPRESSION,
+		default_toast_compression_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"default_transaction_isolation", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Sets the transaction isolation level of each new transaction."),
@@ -4675,6 +5256,16 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"io_method", PGC_SIGHUP, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Selects the method used for asynchronous reads."),
+			NULL
+		},
+		&io_method,
+		IO_METHOD_SYNC, io_method_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"shared_memory_type", PGC_POSTMASTER, RESOURCES_MEM,
 			gettext_noop("Selects the shared memory implementation used for the main shared memory region."),
@@ -4685,6 +5276,16 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"wal_compression", PGC_SUSET, WAL_SETTINGS,
+			gettext_noop("Compresses full-page writes written in WAL file with specified method."),
+			NULL
+		},
+		&wal_compression,
+		WAL_COMPRESSION_NONE, wal_compression_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_sync_method", PGC_SIGHUP, WAL_SETTINGS,
 			gettext_noop("Selects the method used for forcing WAL updates to disk."),
@@ -4716,6 +5317,18 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"timing_clock_source", PGC_POSTMASTER, STATS_COLLECTOR,
+			gettext_noop("Selects the clock used for EXPLAIN ANALYZE and I/O timing."),
+			gettext_noop("\"auto\" uses the CPU's cycle counter if the operating "
+						 "system considers it reliable, \"cycle_counter\" uses it "
+						 "whenever the CPU reports it as invariant.")
+		},
+		&timing_clock_source,
+		TIMING_CLOCK_SOURCE_AUTO, timing_clock_source_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"huge_pages", PGC_POSTMASTER, RESOURCES_MEM,
 			gettext_noop("Use of huge pages on Linux or Windows."),
@@ -4726,6 +5339,36 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"shared_memory_numa", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the NUMA memory policy of the main shared memory region."),
+			NULL
+		},
+		&shared_memory_numa,
+		SHMEM_NUMA_OFF, shared_memory_numa_options,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"temp_file_compression", PGC_USERSET, RESOURCES_DISK,
+			gettext_noop("Sets the method used to compress temporary files."),
+			gettext_noop("Only hash join batch files are compressed.")
+		},
+		&temp_file_compression,
+		TEMP_FILE_COMPRESSION_OFF, temp_file_compression_options,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"logical_decoding_spill_compression", PGC_USERSET, RESOURCES_DISK,
+			gettext_noop("Sets the method used to compress changes that logical decoding spills to disk."),
+			NULL
+		},
+		&logical_decoding_spill_compression,
+		LOGICAL_DECODING_SPILL_COMPRESSION_OFF, logical_decoding_spill_compression_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"force_parallel_mode", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("Forces use of parallel query facilities."),
@@ -6306,6 +6949,35 @@ ReportChangedGUCOptions(void)
 	report_needed = false;
 }
 
+/*
+ * ResendGUCOptions: transmit the current values of all GUC_REPORT variables,
+ * whether or not they were reported before
+ *
+ * A backend serving a connection proxy uses this when a new client is
+ * handed to it, since that client hasn't seen any of the earlier reports.
+ */
+void
+ResendGUCOptions(void)
+{
+	if (!reporting_enabled)
+		return;
+
+	for (int i = 0; i < num_guc_variables; i++)
+	{
+		struct config_generic *conf = guc_variables[i];
+
+		if (conf->flags & GUC_REPORT)
+		{
+			if (conf->last_reported)
+				free(conf->last_reported);
+			conf->last_reported = NULL;
+			ReportGUCOption(conf);
+		}
+	}
+
+	report_needed = false;
+}
+
 /*
  * ReportGUCOption: if appropriate, transmit option value to frontend
  *
@@ -7763,6 +8435,13 @@ set_config_option(const char *name, const char *value,
 		report_needed = true;
 	}
 
+	/*
+	 * A session-level SET outlives the transaction, so a session served
+	 * through a connection proxy must keep its backend from now on.
+	 */
+	if (changeVal && source == PGC_S_SESSION && action == GUC_ACTION_SET)
+		ProxyPinSession();
+
 	return changeVal ? 1 : -1;
 }
 
@@ -11350,6 +12029,69 @@ assign_log_destination(const char *newval, void *extra)
 	Log_destination = *((int *) extra);
 }
 
+static bool
+check_io_direct(char **newval, void **extra, GucSource source)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *l;
+	int			flags = 0;
+	int		   *myextra;
+
+	/* Need a modifiable copy of string */
+	rawstring = pstrdup(*newval);
+
+	/* Parse string into list of identifiers */
+	if (!SplitIdentifierString(rawstring, ',', &elemlist))
+	{
+		/* syntax error in list */
+		GUC_check_errdetail("List syntax is invalid.");
+		pfree(rawstring);
+		list_free(elemlist);
+		return false;
+	}
+
+	foreach(l, elemlist)
+	{
+		char	   *tok = (char *) lfirst(l);
+
+		if (pg_strcasecmp(tok, "data") == 0)
+			flags |= IO_DIRECT_DATA;
+		else if (pg_strcasecmp(tok, "wal") == 0)
+			flags |= IO_DIRECT_WAL;
+		else
+		{
+			GUC_check_errdetail("Unrecognized key word: \"%s\".", tok);
+			pfree(rawstring);
+			list_free(elemlist);
+			return false;
+		}
+	}
+
+	pfree(rawstring);
+	list_free(elemlist);
+
+#if PG_O_DIRECT == 0
+	if (flags != 0)
+	{
+		GUC_check_errdetail("io_direct is not supported on this platform.");
+		return false;
+	}
+#endif
+
+	myextra = (int *) guc_malloc(ERROR, sizeof(int));
+	*myextra = flags;
+	*extra = (void *) myextra;
+
+	return true;
+}
+
+static void
+assign_io_direct(const char *newval, void *extra)
+{
+	io_direct_flags = *((int *) extra);
+}
+
 static void
 assign_syslog_facility(int newval, void *extra)
 {
@@ -11395,6 +12137,60 @@ check_temp_buffers(int *newval, void **extra, GucSource source)
 	return true;
 }
 
+static bool
+check_transaction_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("transaction_buffers", newval);
+}
+
+static bool
+check_subtransaction_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("subtransaction_buffers", newval);
+}
+
+static bool
+check_commit_ts_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("commit_timestamp_buffers", newval);
+}
+
+static bool
+check_multixact_offset_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("multixact_offset_buffers", newval);
+}
+
+static bool
+check_multixact_member_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("multixact_member_buffers", newval);
+}
+
+static bool
+check_notify_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("notify_buffers", newval);
+}
+
+static bool
+check_serial_buffers(int *newval, void **extra, GucSource source)
+{
+	return check_slru_buffers("serializable_buffers", newval);
+}
+
+static bool
+check_shared_invalidation_queue_size(int *newval, void **extra, GucSource source)
+{
+	/* sinvaladt.c maps message numbers to buffer slots by masking */
+	if ((*newval & (*newval - 1)) != 0)
+	{
+		GUC_check_errdetail("\"shared_invalidation_queue_size\" must be a power of 2.");
+		return false;
+	}
+	return true;
+}
+
 static bool
 check_bonjour(bool *newval, void **extra, GucSource source)
 {
@@ -11675,6 +12471,19 @@ check_effective_io_concurrency(int *newval, void **extra, GucSource source)
 	return true;
 }
 
+static bool
+check_prefork_backends(int *newval, void **extra, GucSource source)
+{
+#ifdef EXEC_BACKEND
+	if (*newval != 0)
+	{
+		GUC_check_errdetail("prefork_backends must be set to 0 on this platform.");
+		return false;
+	}
+#endif
+	return true;
+}
+
 static bool
 check_maintenance_io_concurrency(int *newval, void **extra, GucSource source)
 {
@@ -11688,6 +12497,19 @@ check_maintenance_io_concurrency(int *newval, void **extra, GucSource source)
 	return true;
 }
 
+static bool
+check_max_recovery_prefetch_distance(int *newval, void **extra, GucSource source)
+{
+#ifndef USE_PREFETCH
+	if (*newval > 0)
+	{
+		GUC_check_errdetail("max_recovery_prefetch_distance must be set to -1 on platforms that lack posix_fadvise().");
+		return false;
+	}
+#endif							/* USE_PREFETCH */
+	return true;
+}
+
 static bool
 check_huge_page_size(int *newval, void **extra, GucSource source)
 {
@@ -0,0 +1,716 @@
+/*-------------------------------------------------------------------------
+ *
+ * bump.c
+ *	  Bump allocator definitions.
+ *
+ * Bump is a custom MemoryContext implementation designed for cases where
+ * chunks are only ever allocated, and are all released together when the
+ * context is reset or deleted.
+ *
+ * Portions Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/mmgr/bump.c
+ *
+ *
+ *	This memory context carves chunks out of its current block by simply
+ *	advancing a pointer.  Chunk sizes are only rounded up to MAXALIGN, not
+ *	to a power of 2 as in aset.c, and the chunk header holds nothing but
+ *	the chunk size and the owning context (the minimum the memory context
+ *	APIs allow), so nearly all of each block is usable for caller data.
+ *	This makes it a good fit for things like sort tuples, which are loaded
+ *	in bulk and then thrown away all at once.
+ *
+ *	pfree() is accepted, so that code which frees temporary allocations
+ *	made in the current memory context keeps working, but it does not make
+ *	the space available for reuse; that only happens when the context is
+ *	reset.  Users that free many chunks individually, or expect repalloc()
+ *	to be cheap, should use one of the other implementations.
+ *
+ *	Blocks start at initBlockSize and double in size up to maxBlockSize,
+ *	like aset.c.  Oversized chunks get a dedicated block.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "lib/ilist.h"
+#include "utils/memdebug.h"
+#include "utils/memutils.h"
+
+
+#define Bump_BLOCKHDRSZ	MAXALIGN(sizeof(BumpBlock))
+#define Bump_CHUNKHDRSZ	sizeof(BumpChunk)
+
+typedef struct BumpBlock BumpBlock; /* forward reference */
+typedef struct BumpChunk BumpChunk;
+
+typedef void *BumpPointer;
+
+/*
+ * BumpContext is a simple memory context that never reuses space, and frees
+ * all of its blocks at once on reset.
+ */
+typedef struct BumpContext
+{
+	MemoryContextData header;	/* Standard memory-context fields */
+
+	/* Bump context parameters */
+	Size		initBlockSize;	/* initial block size */
+	Size		maxBlockSize;	/* maximum block size */
+	Size		nextBlockSize;	/* next block size to allocate */
+	Size		allocChunkLimit;	/* effective chunk size limit */
+
+	dlist_head	blocks;			/* list of blocks, current block first */
+} BumpContext;
+
+/*
+ * BumpBlock
+ *		BumpBlock is the unit of memory that is obtained by bump.c from
+ *		malloc().  It contains one or more BumpChunks, which are the units
+ *		requested by palloc().  Blocks are only returned to malloc() when the
+ *		context is reset or deleted.
+ *
+ *		BumpBlock is the header data for a block --- the usable space within
+ *		the block begins at the next alignment boundary.
+ */
+struct BumpBlock
+{
+	dlist_node	node;			/* doubly-linked list of blocks */
+	Size		blksize;		/* allocated size of this block */
+	char	   *freeptr;		/* start of free space in this block */
+	char	   *endptr;			/* end of space in this block */
+};
+
+/*
+ * BumpChunk
+ *		The prefix of each piece of memory in a BumpBlock
+ *
+ * Note: to meet the memory context APIs, the payload area of the chunk must
+ * be maxaligned, and the "context" link must be immediately adjacent to the
+ * payload area (cf. GetMemoryChunkContext).  As in generation.c, we add any
+ * required alignment padding before the pointer field.
+ */
+struct BumpChunk
+{
+	/* size is always the size of the usable space in the chunk */
+	Size		size;
+#ifdef MEMORY_CONTEXT_CHECKING
+	/* when debugging memory usage, also store actual requested size */
+	/* this is zero in a freed chunk */
+	Size		requested_size;
+
+#define BUMPCHUNK_RAWSIZE  (SIZEOF_SIZE_T * 2 + SIZEOF_VOID_P)
+#else
+#define BUMPCHUNK_RAWSIZE  (SIZEOF_SIZE_T + SIZEOF_VOID_P)
+#endif							/* MEMORY_CONTEXT_CHECKING */
+
+	/* ensure proper alignment by adding padding if needed */
+#if (BUMPCHUNK_RAWSIZE % MAXIMUM_ALIGNOF) != 0
+	char		padding[MAXIMUM_ALIGNOF - BUMPCHUNK_RAWSIZE % MAXIMUM_ALIGNOF];
+#endif
+
+	BumpContext *context;		/* owning context, or NULL if freed chunk */
+	/* there must not be any padding to reach a MAXALIGN boundary here! */
+};
+
+/*
+ * Only the "context" field should be accessed outside this module.
+ * We keep the rest of an allocated chunk's header marked NOACCESS when using
+ * valgrind.
+ */
+#define BUMPCHUNK_PRIVATE_LEN	offsetof(BumpChunk, context)
+
+/*
+ * BumpIsValid
+ *		True iff set is valid bump context.
+ */
+#define BumpIsValid(set) PointerIsValid(set)
+
+#define BumpPointerGetChunk(ptr) \
+	((BumpChunk *)(((char *)(ptr)) - Bump_CHUNKHDRSZ))
+#define BumpChunkGetPointer(chk) \
+	((BumpPointer *)(((char *)(chk)) + Bump_CHUNKHDRSZ))
+
+/*
+ * These functions implement the MemoryContext API for Bump contexts.
+ */
+static void *BumpAlloc(MemoryContext context, Size size);
+static void BumpFree(MemoryContext context, void *pointer);
+static void *BumpRealloc(MemoryContext context, void *pointer, Size size);
+static void BumpReset(MemoryContext context);
+static void BumpDelete(MemoryContext context);
+static Size BumpGetChunkSpace(MemoryContext context, void *pointer);
+static bool BumpIsEmpty(MemoryContext context);
+static void BumpStats(MemoryContext context,
+					  MemoryStatsPrintFunc printfunc, void *passthru,
+					  MemoryContextCounters *totals,
+					  bool print_to_stderr);
+
+#ifdef MEMORY_CONTEXT_CHECKING
+static void BumpCheck(MemoryContext context);
+#endif
+
+/*
+ * This is the virtual function table for Bump contexts.
+ */
+static const MemoryContextMethods BumpMethods = {
+	BumpAlloc,
+	BumpFree,
+	BumpRealloc,
+	BumpReset,
+	BumpDelete,
+	BumpGetChunkSpace,
+	BumpIsEmpty,
+	BumpStats
+#ifdef MEMORY_CONTEXT_CHECKING
+	,BumpCheck
+#endif
+};
+
+
+/*
+ * Public routines
+ */
+
+
+/*
+ * BumpContextCreate
+ *		Create a new Bump context.
+ *
+ * parent: parent context, or NULL if top-level context
+ * name: name of context (must be statically allocated)
+ * initBlockSize: initial allocation block size
+ * maxBlockSize: maximum allocation block size
+ */
+MemoryContext
+BumpContextCreate(MemoryContext parent,
+				  const char *name,
+				  Size initBlockSize,
+				  Size maxBlockSize)
+{
+	BumpContext *set;
+
+	/* Assert we padded BumpChunk properly */
+	StaticAssertStmt(Bump_CHUNKHDRSZ == MAXALIGN(Bump_CHUNKHDRSZ),
+					 "sizeof(BumpChunk) is not maxaligned");
+	StaticAssertStmt(offsetof(BumpChunk, context) + sizeof(MemoryContext) ==
+					 Bump_CHUNKHDRSZ,
+					 "padding calculation in BumpChunk is wrong");
+
+	/*
+	 * First, validate allocation parameters.  We use the same rules as
+	 * aset.c.
+	 */
+	if (initBlockSize != MAXALIGN(initBlockSize) ||
+		initBlockSize < 1024)
+		elog(ERROR, "invalid initBlockSize for memory context: %zu",
+			 initBlockSize);
+	if (maxBlockSize != MAXALIGN(maxBlockSize) ||
+		maxBlockSize < initBlockSize ||
+		!AllocHugeSizeIsValid(maxBlockSize))
+		elog(ERROR, "invalid maxBlockSize for memory context: %zu",
+			 maxBlockSize);
+
+	set = (BumpContext *) malloc(MAXALIGN(sizeof(BumpContext)));
+	if (set == NULL)
+	{
+		MemoryContextStats(TopMemoryContext);
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while creating memory context \"%s\".",
+						   name)));
+	}
+
+	/*
+	 * Avoid writing code that can fail between here and MemoryContextCreate;
+	 * we'd leak the header if we ereport in this stretch.
+	 */
+
+	/* Fill in BumpContext-specific header fields */
+	set->initBlockSize = initBlockSize;
+	set->maxBlockSize = maxBlockSize;
+	set->nextBlockSize = initBlockSize;
+	dlist_init(&set->blocks);
+
+	/*
+	 * Chunks larger than this get a dedicated block, so that a few large
+	 * requests don't waste the tail end of a regular block.
+	 */
+	set->allocChunkLimit = maxBlockSize / 8;
+
+	/* Finally, do the type-independent part of context creation */
+	MemoryContextCreate((MemoryContext) set,
+						T_BumpContext,
+						&BumpMethods,
+						parent,
+						name);
+
+	return (MemoryContext) set;
+}
+
+/*
+ * BumpReset
+ *		Frees all memory which is allocated in the given set.
+ */
+static void
+BumpReset(MemoryContext context)
+{
+	BumpContext *set = (BumpContext *) context;
+	dlist_mutable_iter miter;
+
+	AssertArg(BumpIsValid(set));
+
+#ifdef MEMORY_CONTEXT_CHECKING
+	/* Check for corruption and leaks before freeing */
+	BumpCheck(context);
+#endif
+
+	dlist_foreach_modify(miter, &set->blocks)
+	{
+		BumpBlock  *block = dlist_container(BumpBlock, node, miter.cur);
+
+		dlist_delete(miter.cur);
+
+		context->mem_allocated -= block->blksize;
+
+#ifdef CLOBBER_FREED_MEMORY
+		wipe_mem(block, block->blksize);
+#endif
+
+		free(block);
+	}
+
+	/* Reset block size allocation sequence, too */
+	set->nextBlockSize = set->initBlockSize;
+
+	Assert(dlist_is_empty(&set->blocks));
+}
+
+/*
+ * BumpDelete
+ *		Free all memory which is allocated in the given context.
+ */
+static void
+BumpDelete(MemoryContext context)
+{
+	/* Reset to release all the BumpBlocks */
+	BumpReset(context);
+	/* And free the context header */
+	free(context);
+}
+
+/*
+ * BumpAlloc
+ *		Returns pointer to allocated memory of given size or NULL if
+ *		request could not be completed; memory is added to the set.
+ *
+ * Note: when using valgrind, it doesn't matter how the returned allocation
+ * is marked, as mcxt.c will set it to UNDEFINED.
+ */
+static void *
+BumpAlloc(MemoryContext context, Size size)
+{
+	BumpContext *set = (BumpContext *) context;
+	BumpBlock  *block;
+	BumpChunk  *chunk;
+	Size		chunk_size = MAXALIGN(size);
+	Size		required_size = chunk_size + Bump_CHUNKHDRSZ;
+
+	/* is it an over-sized chunk? if yes, allocate special block */
+	if (chunk_size > set->allocChunkLimit)
+	{
+		Size		blksize = required_size + Bump_BLOCKHDRSZ;
+
+		block = (BumpBlock *) malloc(blksize);
+		if (block == NULL)
+			return NULL;
+
+		context->mem_allocated += blksize;
+
+		/* the block is completely full */
+		block->blksize = blksize;
+		block->freeptr = block->endptr = ((char *) block) + blksize;
+
+		chunk = (BumpChunk *) (((char *) block) + Bump_BLOCKHDRSZ);
+
+		/*
+		 * Add the block behind the current one, so that we keep allocating
+		 * from the current block.
+		 */
+		if (dlist_is_empty(&set->blocks))
+			dlist_push_head(&set->blocks, &block->node);
+		else
+			dlist_insert_after(dlist_head_node(&set->blocks), &block->node);
+	}
+	else
+	{
+		/*
+		 * Is there enough space in the current block?  If not, allocate a
+		 * new one.  Whatever is left over in the old block is wasted.
+		 */
+		block = dlist_is_empty(&set->blocks) ? NULL :
+			dlist_head_element(BumpBlock, node, &set->blocks);
+
+		if (block == NULL ||
+			(Size) (block->endptr - block->freeptr) < required_size)
+		{
+			Size		blksize = set->nextBlockSize;
+
+			/*
+			 * The first such block has size initBlockSize, and we double the
+			 * space in each succeeding block, but not more than maxBlockSize.
+			 */
+			set->nextBlockSize <<= 1;
+			if (set->nextBlockSize > set->maxBlockSize)
+				set->nextBlockSize = set->maxBlockSize;
+
+			/* If initBlockSize is small, it might not be enough */
+			while (blksize < required_size + Bump_BLOCKHDRSZ)
+				blksize <<= 1;
+
+			block = (BumpBlock *) malloc(blksize);
+			if (block == NULL)
+				return NULL;
+
+			context->mem_allocated += blksize;
+
+			block->blksize = blksize;
+			block->freeptr = ((char *) block) + Bump_BLOCKHDRSZ;
+			block->endptr = ((char *) block) + blksize;
+
+			/* Mark unallocated space NOACCESS. */
+			VALGRIND_MAKE_MEM_NOACCESS(block->freeptr,
+									   blksize - Bump_BLOCKHDRSZ);
+
+			/* make it the current allocation block */
+			dlist_push_head(&set->blocks, &block->node);
+		}
+
+		chunk = (BumpChunk *) block->freeptr;
+
+		/* Prepare to initialize the chunk header. */
+		VALGRIND_MAKE_MEM_UNDEFINED(chunk, Bump_CHUNKHDRSZ);
+
+		block->freeptr += required_size;
+		Assert(block->freeptr <= block->endptr);
+	}
+
+	chunk->context = set;
+	chunk->size = chunk_size;
+
+#ifdef MEMORY_CONTEXT_CHECKING
+	chunk->requested_size = size;
+	/* set mark to catch clobber of "unused" space */
+	if (size < chunk_size)
+		set_sentinel(BumpChunkGetPointer(chunk), size);
+#endif
+#ifdef RANDOMIZE_ALLOCATED_MEMORY
+	/* fill the allocated space with junk */
+	randomize_mem((char *) BumpChunkGetPointer(chunk), size);
+#endif
+
+	/* Ensure any padding bytes are marked NOACCESS. */
+	VALGRIND_MAKE_MEM_NOACCESS((char *) BumpChunkGetPointer(chunk) + size,
+							   chunk_size - size);
+
+	/* Disallow external access to private part of chunk header. */
+	VALGRIND_MAKE_MEM_NOACCESS(chunk, BUMPCHUNK_PRIVATE_LEN);
+
+	return BumpChunkGetPointer(chunk);
+}
+
+/*
+ * BumpFree
+ *		Mark a chunk as freed.  Its space is not reused until the context
+ *		is reset.
+ */
+static void
+BumpFree(MemoryContext context, void *pointer)
+{
+	BumpChunk  *chunk = BumpPointerGetChunk(pointer);
+
+	/* Allow access to private part of chunk header. */
+	VALGRIND_MAKE_MEM_DEFINED(chunk, BUMPCHUNK_PRIVATE_LEN);
+
+#ifdef MEMORY_CONTEXT_CHECKING
+	/* Test for someone scribbling on unused space in chunk */
+	if (chunk->requested_size < chunk->size)
+		if (!sentinel_ok(pointer, chunk->requested_size))
+			elog(WARNING, "detected write past chunk end in %s %p",
+				 context->name, chunk);
+#endif
+
+#ifdef CLOBBER_FREED_MEMORY
+	wipe_mem(pointer, chunk->size);
+#endif
+
+	/* Reset context to NULL in freed chunks */
+	chunk->context = NULL;
+
+#ifdef MEMORY_CONTEXT_CHECKING
+	/* Reset requested_size to 0 in freed chunks */
+	chunk->requested_size = 0;
+#endif
+}
+
+/*
+ * BumpRealloc
+ *		If the new size fits into the old chunk, just update the chunk
+ *		header.  Otherwise allocate a new chunk and copy the data; the old
+ *		chunk's space is not reused until the context is reset.
+ */
+static void *
+BumpRealloc(MemoryContext context, void *pointer, Size size)
+{
+	BumpChunk  *chunk = BumpPointerGetChunk(pointer);
+	BumpPointer newPointer;
+	Size		oldsize;
+
+	/* Allow access to private part of chunk header. */
+	VALGRIND_MAKE_MEM_DEFINED(chunk, BUMPCHUNK_PRIVATE_LEN);
+
+	oldsize = chunk->size;
+
+#ifdef MEMORY_CONTEXT_CHECKING
+	/* Test for someone scribbling on unused space in chunk */
+	if (chunk->requested_size < oldsize)
+		if (!sentinel_ok(pointer, chunk->requested_size))
+			elog(WARNING, "detected write past chunk end in %s %p",
+				 context->name, chunk);
+#endif
+
+	if (oldsize >= size)
+	{
+#ifdef MEMORY_CONTEXT_CHECKING
+		Size		oldrequest = chunk->requested_size;
+
+#ifdef RANDOMIZE_ALLOCATED_MEMORY
+		/* We can only fill the extra space if we know the prior request */
+		if (size > oldrequest)
+			randomize_mem((char *) pointer + oldrequest,
+						  size - oldrequest);
+#endif
+
+		chunk->requested_size = size;
+
+		/*
+		 * If this is an increase, mark any newly-available part UNDEFINED.
+		 * Otherwise, mark the obsolete part NOACCESS.
+		 */
+		if (size > oldrequest)
+			VALGRIND_MAKE_MEM_UNDEFINED((char *) pointer + oldrequest,
+										size - oldrequest);
+		else
+			VALGRIND_MAKE_MEM_NOACCESS((char *) pointer + size,
+									   oldsize - size);
+
+		/* set mark to catch clobber of "unused" space */
+		if (size < oldsize)
+			set_sentinel(pointer, size);
+#else							/* !MEMORY_CONTEXT_CHECKING */
+
+		/*
+		 * We don't have the information to determine whether we're growing
+		 * the old request or shrinking it, so we conservatively mark the
+		 * entire new allocation DEFINED.
+		 */
+		VALGRIND_MAKE_MEM_NOACCESS(pointer, oldsize);
+		VALGRIND_MAKE_MEM_DEFINED(pointer, size);
+#endif
+
+		/* Disallow external access to private part of chunk header. */
+		VALGRIND_MAKE_MEM_NOACCESS(chunk, BUMPCHUNK_PRIVATE_LEN);
+
+		return pointer;
+	}
+
+	/* allocate new chunk */
+	newPointer = BumpAlloc(context, size);
+
+	/* leave immediately if request was not completed */
+	if (newPointer == NULL)
+	{
+		/* Disallow external access to private part of chunk header. */
+		VALGRIND_MAKE_MEM_NOACCESS(chunk, BUMPCHUNK_PRIVATE_LEN);
+		return NULL;
+	}
+
+	/*
+	 * BumpAlloc() may have returned a region that is still NOACCESS.  Change
+	 * it to UNDEFINED for the moment; memcpy() will then transfer
+	 * definedness from the old allocation to the new.
+	 */
+	VALGRIND_MAKE_MEM_UNDEFINED(newPointer, size);
+#ifdef MEMORY_CONTEXT_CHECKING
+	oldsize = chunk->requested_size;
+#else
+	VALGRIND_MAKE_MEM_DEFINED(pointer, oldsize);
+#endif
+
+	/* transfer existing data (certain to fit) */
+	memcpy(newPointer, pointer, oldsize);
+
+	/* "free" old chunk */
+	BumpFree(context, pointer);
+
+	return newPointer;
+}
+
+/*
+ * BumpGetChunkSpace
+ *		Given a currently-allocated chunk, determine the total space
+ *		it occupies (including all memory-allocation overhead).
+ */
+static Size
+BumpGetChunkSpace(MemoryContext context, void *pointer)
+{
+	BumpChunk  *chunk = BumpPointerGetChunk(pointer);
+	Size		result;
+
+	VALGRIND_MAKE_MEM_DEFINED(chunk, BUMPCHUNK_PRIVATE_LEN);
+	result = chunk->size + Bump_CHUNKHDRSZ;
+	VALGRIND_MAKE_MEM_NOACCESS(chunk, BUMPCHUNK_PRIVATE_LEN);
+	return result;
+}
+
+/*
+ * BumpIsEmpty
+ *		Is a BumpContext empty of any allocated space?
+ */
+static bool
+BumpIsEmpty(MemoryContext context)
+{
+	BumpContext *set = (BumpContext *) context;
+
+	return dlist_is_empty(&set->blocks);
+}
+
+/*
+ * BumpStats
+ *		Compute stats about memory consumption of a Bump context.
+ *
+ * printfunc: if not NULL, pass a human-readable stats string to this.
+ * passthru: pass this pointer through to printfunc.
+ * totals: if not NULL, add stats about this context into *totals.
+ * print_to_stderr: print stats to stderr if true, elog otherwise.
+ *
+ * freespace only accounts for empty space at the end of each block, not
+ * space of freed chunks, which we don't track.
+ */
+static void
+BumpStats(MemoryContext context,
+		  MemoryStatsPrintFunc printfunc, void *passthru,
+		  MemoryContextCounters *totals,
+		  bool print_to_stderr)
+{
+	BumpContext *set = (BumpContext *) context;
+	Size		nblocks = 0;
+	Size		totalspace;
+	Size		freespace = 0;
+	dlist_iter	iter;
+
+	/* Include context header in totalspace */
+	totalspace = MAXALIGN(sizeof(BumpContext));
+
+	dlist_foreach(iter, &set->blocks)
+	{
+		BumpBlock  *block = dlist_container(BumpBlock, node, iter.cur);
+
+		nblocks++;
+		totalspace += block->blksize;
+		freespace += (block->endptr - block->freeptr);
+	}
+
+	if (printfunc)
+	{
+		char		stats_string[200];
+
+		snprintf(stats_string, sizeof(stats_string),
+				 "%zu total in %zd blocks; %zu free; %zu used",
+				 totalspace, nblocks, freespace, totalspace - freespace);
+		printfunc(context, passthru, stats_string, print_to_stderr);
+	}
+
+	if (totals)
+	{
+		totals->nblocks += nblocks;
+		totals->totalspace += totalspace;
+		totals->freespace += freespace;
+	}
+}
+
+
+#ifdef MEMORY_CONTEXT_CHECKING
+
+/*
+ * BumpCheck
+ *		Walk through chunks and check consistency of memory.
+ *
+ * NOTE: report errors as WARNING, *not* ERROR or FATAL.  Otherwise you'll
+ * find yourself in an infinite loop when trouble occurs, because this
+ * routine will be entered again when elog cleanup tries to release memory!
+ */
+static void
+BumpCheck(MemoryContext context)
+{
+	BumpContext *bump = (BumpContext *) context;
+	const char *name = context->name;
+	dlist_iter	iter;
+	Size		total_allocated = 0;
+
+	/* walk all blocks in this context */
+	dlist_foreach(iter, &bump->blocks)
+	{
+		BumpBlock  *block = dlist_container(BumpBlock, node, iter.cur);
+		char	   *ptr;
+
+		total_allocated += block->blksize;
+
+		ptr = ((char *) block) + Bump_BLOCKHDRSZ;
+
+		while (ptr < block->freeptr)
+		{
+			BumpChunk  *chunk = (BumpChunk *) ptr;
+
+			/* Allow access to private part of chunk header. */
+			VALGRIND_MAKE_MEM_DEFINED(chunk, BUMPCHUNK_PRIVATE_LEN);
+
+			/* move to the next chunk */
+			ptr += (chunk->size + Bump_CHUNKHDRSZ);
+
+			/* check for valid context pointer (NULL means freed) */
+			if (chunk->context != bump && chunk->context != NULL)
+				elog(WARNING, "problem in Bump %s: bogus context link in block %p, chunk %p",
+					 name, block, chunk);
+
+			/* now make sure the chunk size is correct */
+			if (chunk->size < chunk->requested_size ||
+				chunk->size != MAXALIGN(chunk->size))
+				elog(WARNING, "problem in Bump %s: bogus chunk size in block %p, chunk %p",
+					 name, block, chunk);
+
+			/* check sentinel, but only in allocated chunks */
+			if (chunk->context != NULL)
+			{
+				if (chunk->requested_size < chunk->size &&
+					!sentinel_ok(chunk, Bump_CHUNKHDRSZ + chunk->requested_size))
+					elog(WARNING, "problem in Bump %s: detected write past chunk end in block %p, chunk %p",
+						 name, block, chunk);
+
+				/* Disallow external access to private part of chunk header. */
+				VALGRIND_MAKE_MEM_NOACCESS(chunk, BUMPCHUNK_PRIVATE_LEN);
+			}
+		}
+
+		if (ptr != block->freeptr)
+			elog(WARNING, "problem in Bump %s: chunks overrun free pointer in block %p",
+				 name, block);
+	}
+
+	Assert(total_allocated == context->mem_allocated);
+}
+
+#endif							/* MEMORY_CONTEXT_CHECKING */
@@ -22,6 +22,7 @@
 #include "catalog/pg_type.h"
 #include "commands/portalcmds.h"
 #include "miscadmin.h"
+#include "postmaster/proxy.h"
 #include "storage/ipc.h"
 #include "utils/builtins.h"
 #include "utils/memutils.h"
@@ -631,6 +632,9 @@ PortalHashTableDeleteAll(void)
 static void
 HoldPortal(Portal portal)
 {
+	/* The held cursor stays with this backend */
+	ProxyPinSession();
+
 	/*
 	 * Note that PersistHoldablePortal() must release all resources used by
 	 * the portal that are local to the creating transaction.
@@ -54,6 +54,57 @@ print <<'EOM';
 EOM
 emit_qsort_implementation();
 
+# Variants that inline the comparison of leading keys using one of the
+# generic integer comparators.  The _ssup ones are for single-key sorts; the
+# _tuple ones call comparetup only when the leading keys are equal.
+emit_int_key_variants('unsigned', 'Unsigned');
+print "\n#if SIZEOF_DATUM >= 8\n";
+emit_int_key_variants('signed', 'Signed');
+print "#endif\n";
+emit_int_key_variants('int32', 'Int32');
+
+sub emit_int_key_variants
+{
+	my ($kind, $applyname) = @_;
+
+	$SUFFIX      = "ssup_$kind";
+	$EXTRAARGS   = ', SortSupport ssup';
+	$EXTRAPARAMS = ', ssup';
+	$CMPPARAMS   = ', ssup';
+	print <<EOM;
+
+#define cmp_ssup_$kind(a, b, ssup) \\
+	Apply${applyname}SortComparator((a)->datum1, (a)->isnull1, \\
+						(b)->datum1, (b)->isnull1, ssup)
+
+EOM
+	emit_qsort_implementation();
+
+	$SUFFIX      = "tuple_$kind";
+	$EXTRAARGS   = ', Tuplesortstate *state';
+	$EXTRAPARAMS = ', state';
+	$CMPPARAMS   = ', state';
+	print <<EOM;
+
+static inline int
+cmp_tuple_$kind(SortTuple *a, SortTuple *b, Tuplesortstate *state)
+{
+	int			compare;
+
+	compare = Apply${applyname}SortComparator(a->datum1, a->isnull1,
+							b->datum1, b->isnull1,
+							state->sortKeys);
+	if (compare != 0)
+		return compare;
+	return state->comparetup(a, b, state);
+}
+
+EOM
+	emit_qsort_implementation();
+
+	return;
+}
+
 sub emit_qsort_boilerplate
 {
 	print <<'EOM';
@@ -47,7 +47,9 @@
  *
  * To further make the I/Os more sequential, we can use a larger buffer
  * when reading, and read multiple blocks from the same tape in one go,
- * whenever the buffer becomes empty.
+ * whenever the buffer becomes empty.  Each time the buffer is filled, we
+ * also ask the kernel to prefetch the blocks for the next fill, so that
+ * they're usually in the page cache by the time the tape needs them.
  *
  * To support the above policy of writing to the lowest free block, the
  * freelist is a min heap.
@@ -225,6 +227,7 @@ static long ltsGetBlock(LogicalTapeSet *lts, LogicalTape *lt);
 static long ltsGetFreeBlock(LogicalTapeSet *lts);
 static long ltsGetPreallocBlock(LogicalTapeSet *lts, LogicalTape *lt);
 static void ltsReleaseBlock(LogicalTapeSet *lts, long blocknum);
+static void ltsPrefetchBuffer(LogicalTapeSet *lts, LogicalTape *lt);
 static void ltsConcatWorkerTapes(LogicalTapeSet *lts, TapeShare *shared,
 								 SharedFileSet *fileset);
 static void ltsInitTape(LogicalTape *lt);
@@ -339,9 +342,37 @@ ltsReadFillBuffer(LogicalTapeSet *lts, LogicalTape *lt)
 		/* Advance to next block, if we have buffer space left */
 	} while (lt->buffer_size - lt->nbytes > BLCKSZ);
 
+	ltsPrefetchBuffer(lts, lt);
+
 	return (lt->nbytes > 0);
 }
 
+/*
+ * Start reading the blocks that the next ltsReadFillBuffer() call on the
+ * tape will want, while the caller consumes the current buffer contents.
+ *
+ * When many tapes are read in turn, as in the merge phase of an external
+ * sort, each refill would otherwise wait for its own reads, which on
+ * rotating disks means a seek per buffer load.  We only know the number of
+ * the tape's next block, but blocks are handed out in ascending order, so
+ * the ones after it very often follow it directly in the file.  If they
+ * don't, the prefetch was wasted, but harmless.
+ */
+static void
+ltsPrefetchBuffer(LogicalTapeSet *lts, LogicalTape *lt)
+{
+	long		blocknum;
+	long		nblocks;
+
+	if (lt->nextBlockNumber == -1L)
+		return;
+
+	blocknum = lt->nextBlockNumber + lt->offsetBlockNumber;
+	nblocks = Min(lt->buffer_size / BLCKSZ, lts->nBlocksWritten - blocknum);
+	if (nblocks > 0)
+		BufFilePrefetchBlock(lts->pfile, blocknum, nblocks);
+}
+
 static inline void
 swap_nodes(long *heap, unsigned long a, unsigned long b)
 {
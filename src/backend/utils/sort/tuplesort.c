@@ -105,6 +105,7 @@
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
+#include "port/pg_bitutils.h"
 #include "utils/datum.h"
 #include "utils/logtape.h"
 #include "utils/lsyscache.h"
@@ -182,6 +183,18 @@ typedef struct
 	int			srctape;		/* source tape number */
 } SortTuple;
 
+/*
+ * BRIN tuples don't carry their own length, so the BRIN variant keeps each
+ * one in a wrapper that records it.
+ */
+typedef struct BrinSortTuple
+{
+	Size		tuplen;
+	BrinTuple	tuple;
+} BrinSortTuple;
+
+#define BRINSORTTUPLE_SIZE(len)		(offsetof(BrinSortTuple, tuple) + (len))
+
 /*
  * During merge, we use a pre-allocated set of fixed-size slots to hold
  * tuples.  To avoid palloc/pfree overhead.
@@ -231,6 +244,21 @@ typedef enum
 #define TAPE_BUFFER_OVERHEAD		BLCKSZ
 #define MERGE_BUFFER_SIZE			(BLCKSZ * 32)
 
+/*
+ * Leading keys compared with one of the generic integer comparators of
+ * sortsupport.h can be sorted with specialized routines; see int_key_kind().
+ * Such sorts use a radix sort, except that partitions smaller than
+ * RADIX_SORT_MIN_TUPLES are sorted with quicksort instead.
+ */
+typedef enum
+{
+	INT_KEY_UNSIGNED,			/* ssup_datum_unsigned_cmp */
+	INT_KEY_SIGNED,				/* ssup_datum_signed_cmp */
+	INT_KEY_INT32				/* ssup_datum_int32_cmp */
+} IntKeyKind;
+
+#define RADIX_SORT_MIN_TUPLES		64
+
 typedef int (*SortTupleComparator) (const SortTuple *a, const SortTuple *b,
 									Tuplesortstate *state);
 
@@ -624,6 +652,10 @@ static void dumptuples(Tuplesortstate *state, bool alltuples);
 static void make_bounded_heap(Tuplesortstate *state);
 static void sort_bounded_heap(Tuplesortstate *state);
 static void tuplesort_sort_memtuples(Tuplesortstate *state);
+static bool int_key_kind(Tuplesortstate *state, IntKeyKind *kind);
+static void qsort_int_key(SortTuple *data, size_t n, IntKeyKind kind,
+						  Tuplesortstate *state);
+static void radix_sort_memtuples(Tuplesortstate *state, IntKeyKind kind);
 static void tuplesort_heap_insert(Tuplesortstate *state, SortTuple *tuple);
 static void tuplesort_heap_replace_top(Tuplesortstate *state, SortTuple *tuple);
 static void tuplesort_heap_delete_top(Tuplesortstate *state);
@@ -654,6 +686,14 @@ static void writetup_index(Tuplesortstate *state, int tapenum,
 						   SortTuple *stup);
 static void readtup_index(Tuplesortstate *state, SortTuple *stup,
 						  int tapenum, unsigned int len);
+static int	comparetup_index_brin(const SortTuple *a, const SortTuple *b,
+								  Tuplesortstate *state);
+static void copytup_index_brin(Tuplesortstate *state, SortTuple *stup,
+							   void *tup);
+static void writetup_index_brin(Tuplesortstate *state, int tapenum,
+								SortTuple *stup);
+static void readtup_index_brin(Tuplesortstate *state, SortTuple *stup,
+							   int tapenum, unsigned int len);
 static int	comparetup_datum(const SortTuple *a, const SortTuple *b,
 							 Tuplesortstate *state);
 static void copytup_datum(Tuplesortstate *state, SortTuple *stup, void *tup);
@@ -674,7 +714,9 @@ static void tuplesort_updatemax(Tuplesortstate *state);
  * any variant of SortTuples, using the appropriate comparetup function.
  * qsort_ssup() is specialized for the case where the comparetup function
  * reduces to ApplySortComparator(), that is single-key MinimalTuple sorts
- * and Datum sorts.
+ * and Datum sorts.  The _unsigned, _signed and _int32 variants of both
+ * inline the comparison of leading keys that use the corresponding generic
+ * comparator of sortsupport.h; see qsort_int_key().
  */
 #include "qsort_tuple.c"
 
@@ -825,10 +867,17 @@ tuplesort_begin_batch(Tuplesortstate *state)
 	 * fragmentation. Note that the memtuples array of SortTuples is allocated
 	 * in the parent context, not this context, because there is no need to
 	 * free memtuples early.
+	 *
+	 * Tuples are only ever released together, by resetting this context
+	 * after a run has been dumped (the pfree()s in the writetup routines are
+	 * just for tidiness), so we use a bump context, which packs tuples much
+	 * more densely than aset.c.  Bounded sorts do free tuples individually;
+	 * tuplesort_set_bound() switches to an aset.c context for them.
 	 */
-	state->tuplecontext = AllocSetContextCreate(state->sortcontext,
-												"Caller tuples",
-												ALLOCSET_DEFAULT_SIZES);
+	state->tuplecontext = BumpContextCreate(state->sortcontext,
+											"Caller tuples",
+											ALLOCSET_DEFAULT_INITSIZE,
+											ALLOCSET_DEFAULT_MAXSIZE);
 
 	state->status = TSS_INITIAL;
 	state->bounded = false;
@@ -1224,6 +1273,41 @@ tuplesort_begin_index_gist(Relation heapRel,
 	return state;
 }
 
+Tuplesortstate *
+tuplesort_begin_index_brin(Relation heapRel,
+						   Relation indexRel,
+						   int workMem,
+						   SortCoordinate coordinate,
+						   bool randomAccess)
+{
+	Tuplesortstate *state = tuplesort_begin_common(workMem, coordinate,
+												   randomAccess);
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(state->maincontext);
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG,
+			 "begin index sort: workMem = %d, randomAccess = %c",
+			 workMem, randomAccess ? 't' : 'f');
+#endif
+
+	state->nKeys = 1;			/* Only one sort column, the block number */
+
+	state->comparetup = comparetup_index_brin;
+	state->copytup = copytup_index_brin;
+	state->writetup = writetup_index_brin;
+	state->readtup = readtup_index_brin;
+
+	state->heapRel = heapRel;
+	state->indexRel = indexRel;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
 Tuplesortstate *
 tuplesort_begin_datum(Oid datumType, Oid sortOperator, Oid sortCollation,
 					  bool nullsFirstFlag, int workMem,
@@ -1338,6 +1422,16 @@ tuplesort_set_bound(Tuplesortstate *state, int64 bound)
 	state->bounded = true;
 	state->bound = (int) bound;
 
+	/*
+	 * A bounded sort discards tuples as it goes, and a bump context would
+	 * never reuse their space, so switch the (still empty) tuple context to
+	 * one that does.
+	 */
+	MemoryContextDelete(state->tuplecontext);
+	state->tuplecontext = AllocSetContextCreate(state->sortcontext,
+												"Caller tuples",
+												ALLOCSET_DEFAULT_SIZES);
+
 	/*
 	 * Bounded sorts are not an effective target for abbreviated key
 	 * optimization.  Disable by setting state to be consistent with no
@@ -1709,12 +1803,18 @@ tuplesort_putindextuplevalues(Tuplesortstate *state, Relation rel,
 							  ItemPointer self, Datum *values,
 							  bool *isnull)
 {
-	MemoryContext oldcontext = MemoryContextSwitchTo(state->tuplecontext);
+	MemoryContext oldcontext;
 	SortTuple	stup;
 	Datum		original;
 	IndexTuple	tuple;
 
-	stup.tuple = index_form_tuple(RelationGetDescr(rel), values, isnull);
+	/*
+	 * Only the finished tuple goes into tuplecontext; any detoasted or
+	 * compressed temporaries are made (and freed) in the caller's context,
+	 * since tuplecontext would not reclaim them.
+	 */
+	stup.tuple = index_form_tuple_context(RelationGetDescr(rel), values,
+										  isnull, state->tuplecontext);
 	tuple = ((IndexTuple) stup.tuple);
 	tuple->t_tid = *self;
 	USEMEM(state, GetMemoryChunkSpace(stup.tuple));
@@ -1724,7 +1824,7 @@ tuplesort_putindextuplevalues(Tuplesortstate *state, Relation rel,
 							 RelationGetDescr(state->indexRel),
 							 &stup.isnull1);
 
-	MemoryContextSwitchTo(state->sortcontext);
+	oldcontext = MemoryContextSwitchTo(state->sortcontext);
 
 	if (!state->sortKeys || !state->sortKeys->abbrev_converter || stup.isnull1)
 	{
@@ -1777,6 +1877,33 @@ tuplesort_putindextuplevalues(Tuplesortstate *state, Relation rel,
 	MemoryContextSwitchTo(oldcontext);
 }
 
+/*
+ * Collect one BRIN tuple while collecting input data for sort.
+ */
+void
+tuplesort_putbrintuple(Tuplesortstate *state, BrinTuple *tuple, Size size)
+{
+	MemoryContext oldcontext = MemoryContextSwitchTo(state->tuplecontext);
+	SortTuple	stup;
+	BrinSortTuple *bstup;
+
+	/* Copy the tuple into memory we control, and decrease availMem */
+	bstup = (BrinSortTuple *) palloc(BRINSORTTUPLE_SIZE(size));
+	bstup->tuplen = size;
+	memcpy(&bstup->tuple, tuple, size);
+
+	stup.tuple = bstup;
+	stup.datum1 = UInt32GetDatum(tuple->bt_blkno);
+	stup.isnull1 = false;
+	USEMEM(state, GetMemoryChunkSpace(bstup));
+
+	MemoryContextSwitchTo(state->sortcontext);
+
+	puttuple_common(state, &stup);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
 /*
  * Accept one Datum while collecting input data for sort.
  *
@@ -2456,6 +2583,33 @@ tuplesort_getindextuple(Tuplesortstate *state, bool forward)
 	return (IndexTuple) stup.tuple;
 }
 
+/*
+ * Fetch the next BRIN tuple in either forward or back direction, storing its
+ * length in *len.  Returns NULL if no more tuples.  Returned tuple belongs to
+ * tuplesort memory context, and must not be freed by caller.  Caller may not
+ * rely on tuple remaining valid after any further manipulation of tuplesort.
+ */
+BrinTuple *
+tuplesort_getbrintuple(Tuplesortstate *state, Size *len, bool forward)
+{
+	MemoryContext oldcontext = MemoryContextSwitchTo(state->sortcontext);
+	SortTuple	stup;
+	BrinSortTuple *bstup;
+
+	if (!tuplesort_gettuple_common(state, forward, &stup))
+		stup.tuple = NULL;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (stup.tuple == NULL)
+		return NULL;
+
+	bstup = (BrinSortTuple *) stup.tuple;
+	*len = bstup->tuplen;
+
+	return &bstup->tuple;
+}
+
 /*
  * Fetch the next Datum in either forward or back direction.
  * Returns false if no more datums.
@@ -3528,19 +3682,32 @@ sort_bounded_heap(Tuplesortstate *state)
 }
 
 /*
- * Sort all memtuples using specialized qsort() routines.
+ * Sort all memtuples using specialized qsort() routines, or a radix sort.
  *
  * Quicksort is used for small in-memory sorts, and external sort runs.
+ * When the leading key is compared with one of the generic integer
+ * comparators, larger sorts use radix_sort_memtuples() instead, and smaller
+ * ones a quicksort with that comparison inlined.
  */
 static void
 tuplesort_sort_memtuples(Tuplesortstate *state)
 {
+	IntKeyKind kind;
+
 	Assert(!LEADER(state));
 
 	if (state->memtupcount > 1)
 	{
+		if (int_key_kind(state, &kind))
+		{
+			if (state->memtupcount >= RADIX_SORT_MIN_TUPLES)
+				radix_sort_memtuples(state, kind);
+			else
+				qsort_int_key(state->memtuples, state->memtupcount, kind,
+							  state);
+		}
 		/* Can we use the single-key sort function? */
-		if (state->onlyKey != NULL)
+		else if (state->onlyKey != NULL)
 			qsort_ssup(state->memtuples, state->memtupcount,
 					   state->onlyKey);
 		else
@@ -3551,6 +3718,249 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 	}
 }
 
+/*
+ * Quicksort with the leading key's comparison inlined.
+ *
+ * The _tuple variants fall back to comparetup only when the leading keys are
+ * equal, so they suit any sort whose leading key qualifies.
+ */
+static void
+qsort_int_key(SortTuple *data, size_t n, IntKeyKind kind,
+			  Tuplesortstate *state)
+{
+	if (state->onlyKey != NULL)
+	{
+		if (kind == INT_KEY_UNSIGNED)
+			qsort_ssup_unsigned(data, n, state->onlyKey);
+#if SIZEOF_DATUM >= 8
+		else if (kind == INT_KEY_SIGNED)
+			qsort_ssup_signed(data, n, state->onlyKey);
+#endif
+		else
+			qsort_ssup_int32(data, n, state->onlyKey);
+	}
+	else
+	{
+		if (kind == INT_KEY_UNSIGNED)
+			qsort_tuple_unsigned(data, n, state);
+#if SIZEOF_DATUM >= 8
+		else if (kind == INT_KEY_SIGNED)
+			qsort_tuple_signed(data, n, state);
+#endif
+		else
+			qsort_tuple_int32(data, n, state);
+	}
+}
+
+/*
+ * Radix sort of memtuples on the leading key.
+ *
+ * ssup_datum_unsigned_cmp() and friends order Datums the way integers are
+ * ordered, so when the leading key uses one of them, datum1 can be turned
+ * into an unsigned 64-bit key whose byte-wise order is the sort order, and
+ * memtuples sorted on that key without calling any comparator.  We use an
+ * in-place most-significant-digit radix sort ("American flag sort"), so no
+ * memory beyond memtuples itself is needed.  Each pass distributes one byte
+ * of the key, starting with the most significant byte that isn't the same
+ * for all tuples in the partition; small partitions are handed to
+ * quicksort.
+ *
+ * Tuples with equal keys are sorted with comparetup, which takes care of
+ * later sort keys, tie-breaks on the authoritative value when datum1 is an
+ * abbreviated key, and the uniqueness checks of B-Tree index builds.  Only
+ * when onlyKey is set is the leading key the whole sort order, and equal
+ * keys need no further work.
+ */
+static bool
+int_key_kind(Tuplesortstate *state, IntKeyKind *kind)
+{
+	SortSupport sortKey = state->sortKeys;
+
+	if (sortKey == NULL)
+		return false;
+
+	/* CLUSTER doesn't set up datum1 when the leading key is an expression */
+	if (state->comparetup == comparetup_cluster &&
+		state->indexInfo->ii_IndexAttrNumbers[0] == 0)
+		return false;
+
+	if (sortKey->comparator == ssup_datum_unsigned_cmp)
+		*kind = INT_KEY_UNSIGNED;
+#if SIZEOF_DATUM >= 8
+	else if (sortKey->comparator == ssup_datum_signed_cmp)
+		*kind = INT_KEY_SIGNED;
+#endif
+	else if (sortKey->comparator == ssup_datum_int32_cmp)
+		*kind = INT_KEY_INT32;
+	else
+		return false;
+
+	return true;
+}
+
+/*
+ * Map datum1 to an unsigned key that sorts in the requested order.
+ */
+static inline uint64
+radix_sort_key(Datum datum, IntKeyKind kind, bool reverse)
+{
+	uint64		key;
+
+	if (kind == INT_KEY_UNSIGNED)
+		key = (uint64) datum;
+#if SIZEOF_DATUM >= 8
+	else if (kind == INT_KEY_SIGNED)
+		key = (uint64) DatumGetInt64(datum) ^ (UINT64CONST(1) << 63);
+#endif
+	else
+		key = (uint64) (int64) DatumGetInt32(datum) ^ (UINT64CONST(1) << 63);
+
+	return reverse ? ~key : key;
+}
+
+/*
+ * Sort tuples whose leading keys are all equal (or all NULL).
+ */
+static void
+radix_sort_ties(SortTuple *data, size_t n, Tuplesortstate *state)
+{
+	if (n > 1 && state->onlyKey == NULL)
+		qsort_tuple(data, n, state->comparetup, state);
+}
+
+static void
+radix_sort_tuple(SortTuple *data, size_t n, IntKeyKind kind,
+				 Tuplesortstate *state)
+{
+	bool		reverse = state->sortKeys->ssup_reverse;
+	size_t		counts[256];
+	size_t		offsets[256];
+	size_t		start;
+	uint64		first;
+	uint64		diff = 0;
+	int			shift;
+	int			b;
+	size_t		i;
+
+	CHECK_FOR_INTERRUPTS();
+
+	if (n < RADIX_SORT_MIN_TUPLES)
+	{
+		qsort_int_key(data, n, kind, state);
+		return;
+	}
+
+	/* Find the most significant byte that differs between any two keys */
+	first = radix_sort_key(data[0].datum1, kind, reverse);
+	for (i = 1; i < n; i++)
+		diff |= radix_sort_key(data[i].datum1, kind, reverse) ^ first;
+
+	if (diff == 0)
+	{
+		radix_sort_ties(data, n, state);
+		return;
+	}
+	shift = (pg_leftmost_one_pos64(diff) / 8) * 8;
+
+	/* Count the tuples going to each bucket, and find where buckets start */
+	memset(counts, 0, sizeof(counts));
+	for (i = 0; i < n; i++)
+	{
+		uint64		key = radix_sort_key(data[i].datum1, kind, reverse);
+
+		counts[(key >> shift) & 0xFF]++;
+	}
+
+	start = 0;
+	for (b = 0; b < 256; b++)
+	{
+		offsets[b] = start;
+		start += counts[b];
+	}
+
+	/*
+	 * Permute in place: swap each misplaced tuple into the next free slot of
+	 * its own bucket until the slot at hand holds a tuple that belongs there.
+	 */
+	start = 0;
+	for (b = 0; b < 256; b++)
+	{
+		size_t		end = start + counts[b];
+
+		while (offsets[b] < end)
+		{
+			SortTuple  *cur = &data[offsets[b]];
+			int			dest;
+
+			dest = (radix_sort_key(cur->datum1, kind, reverse) >> shift) & 0xFF;
+			if (dest == b)
+				offsets[b]++;
+			else
+			{
+				SortTuple	tmp = *cur;
+
+				*cur = data[offsets[dest]];
+				data[offsets[dest]++] = tmp;
+			}
+		}
+		start = end;
+	}
+
+	/* Sort each bucket on the remaining bytes */
+	start = 0;
+	for (b = 0; b < 256; b++)
+	{
+		if (counts[b] > 1)
+		{
+			if (shift == 0)
+				radix_sort_ties(data + start, counts[b], state);
+			else
+				radix_sort_tuple(data + start, counts[b], kind, state);
+		}
+		start += counts[b];
+	}
+}
+
+static void
+radix_sort_memtuples(Tuplesortstate *state, IntKeyKind kind)
+{
+	SortTuple  *memtuples = state->memtuples;
+	bool		nulls_first = state->sortKeys->ssup_nulls_first;
+	size_t		n = state->memtupcount;
+	size_t		nfront = 0;
+	size_t		i;
+
+	/*
+	 * NULLs sort before or after all non-NULL values, regardless of sort
+	 * direction.  Move whichever group comes first to the front.
+	 */
+	for (i = 0; i < n; i++)
+	{
+		if (memtuples[i].isnull1 == nulls_first)
+		{
+			if (i != nfront)
+			{
+				SortTuple	tmp = memtuples[i];
+
+				memtuples[i] = memtuples[nfront];
+				memtuples[nfront] = tmp;
+			}
+			nfront++;
+		}
+	}
+
+	if (nulls_first)
+	{
+		radix_sort_ties(memtuples, nfront, state);
+		radix_sort_tuple(memtuples + nfront, n - nfront, kind, state);
+	}
+	else
+	{
+		radix_sort_tuple(memtuples, nfront, kind, state);
+		radix_sort_ties(memtuples + nfront, n - nfront, state);
+	}
+}
+
 /*
  * Insert a new tuple into an empty or existing heap, maintaining the
  * heap invariant.  Caller is responsible for ensuring there's room.
@@ -4414,6 +4824,76 @@ readtup_index(Tuplesortstate *state, SortTuple *stup,
 								 &stup->isnull1);
 }
 
+/*
+ * Routines specialized for BRIN case
+ */
+
+static int
+comparetup_index_brin(const SortTuple *a, const SortTuple *b,
+					  Tuplesortstate *state)
+{
+	BlockNumber blk1 = DatumGetUInt32(a->datum1);
+	BlockNumber blk2 = DatumGetUInt32(b->datum1);
+
+	/*
+	 * Several tuples may share a block number, when more than one participant
+	 * saw part of the same range; the caller merges those, in any order.
+	 */
+	if (blk1 != blk2)
+		return (blk1 < blk2) ? -1 : 1;
+
+	return 0;
+}
+
+static void
+copytup_index_brin(Tuplesortstate *state, SortTuple *stup, void *tup)
+{
+	/* Not currently needed */
+	elog(ERROR, "copytup_index_brin() should not be called");
+}
+
+static void
+writetup_index_brin(Tuplesortstate *state, int tapenum, SortTuple *stup)
+{
+	BrinSortTuple *bstup = (BrinSortTuple *) stup->tuple;
+	unsigned int tuplen;
+
+	tuplen = bstup->tuplen + sizeof(tuplen);
+	LogicalTapeWrite(state->tapeset, tapenum,
+					 (void *) &tuplen, sizeof(tuplen));
+	LogicalTapeWrite(state->tapeset, tapenum,
+					 (void *) &bstup->tuple, bstup->tuplen);
+	if (state->randomAccess)	/* need trailing length word? */
+		LogicalTapeWrite(state->tapeset, tapenum,
+						 (void *) &tuplen, sizeof(tuplen));
+
+	if (!state->slabAllocatorUsed)
+	{
+		FREEMEM(state, GetMemoryChunkSpace(bstup));
+		pfree(bstup);
+	}
+}
+
+static void
+readtup_index_brin(Tuplesortstate *state, SortTuple *stup,
+				   int tapenum, unsigned int len)
+{
+	unsigned int tuplen = len - sizeof(unsigned int);
+	BrinSortTuple *bstup;
+
+	bstup = (BrinSortTuple *) readtup_alloc(state, BRINSORTTUPLE_SIZE(tuplen));
+	bstup->tuplen = tuplen;
+
+	LogicalTapeReadExact(state->tapeset, tapenum,
+						 &bstup->tuple, tuplen);
+	if (state->randomAccess)	/* need trailing length word? */
+		LogicalTapeReadExact(state->tapeset, tapenum,
+							 &tuplen, sizeof(tuplen));
+	stup->tuple = (void *) bstup;
+	stup->datum1 = UInt32GetDatum(bstup->tuple.bt_blkno);
+	stup->isnull1 = false;
+}
+
 /*
  * Routines specialized for DatumTuple case
  */
@@ -4573,6 +5053,27 @@ tuplesort_initialize_shared(Sharedsort *shared, int nWorkers, dsm_segment *seg)
 	}
 }
 
+/*
+ * tuplesort_reinitialize_shared - reset shared tuplesort state for reuse
+ *
+ * Must be called from leader process while no worker tuplesortstates exist,
+ * so that the same shared state can be used for another parallel sort.  Any
+ * files left behind by the previous sort are deleted.
+ */
+void
+tuplesort_reinitialize_shared(Sharedsort *shared)
+{
+	int			i;
+
+	SharedFileSetDeleteAll(&shared->fileset);
+	shared->currentWorker = 0;
+	shared->workersFinished = 0;
+	for (i = 0; i < shared->nTapes; i++)
+	{
+		shared->tapes[i].firstblocknumber = 0L;
+	}
+}
+
 /*
  * tuplesort_attach_shared - attach to shared tuplesort state
  *
@@ -4757,3 +5258,47 @@ free_sort_tuple(Tuplesortstate *state, SortTuple *stup)
 	FREEMEM(state, GetMemoryChunkSpace(stup->tuple));
 	pfree(stup->tuple);
 }
+
+/*
+ * Generic comparators for Datums that sort like integers; see sortsupport.h.
+ */
+int
+ssup_datum_unsigned_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	if (x < y)
+		return -1;
+	else if (x > y)
+		return 1;
+	else
+		return 0;
+}
+
+#if SIZEOF_DATUM >= 8
+int
+ssup_datum_signed_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int64		xx = DatumGetInt64(x);
+	int64		yy = DatumGetInt64(y);
+
+	if (xx < yy)
+		return -1;
+	else if (xx > yy)
+		return 1;
+	else
+		return 0;
+}
+#endif
+
+int
+ssup_datum_int32_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int32		xx = DatumGetInt32(x);
+	int32		yy = DatumGetInt32(y);
+
+	if (xx < yy)
+		return -1;
+	else if (xx > yy)
+		return 1;
+	else
+		return 0;
+}
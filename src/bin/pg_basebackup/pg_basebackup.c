@@ -135,6 +135,8 @@ static bool showprogress = false;
 static bool estimatesize = true;
 static int	verbose = 0;
 static int	compresslevel = 0;
+static char *server_compression = NULL; /* gzip, lz4 or zstd */
+static int	server_compresslevel = 0;
 static IncludeWal includewal = STREAM_WAL;
 static bool fastcheckpoint = false;
 static bool writerecoveryconf = false;
@@ -394,6 +396,8 @@ usage(void)
 			 "                         include required WAL files with specified method\n"));
 	printf(_("  -z, --gzip             compress tar output\n"));
 	printf(_("  -Z, --compress=0-9     compress tar output with given compression level\n"));
+	printf(_("      --server-compress=gzip|lz4|zstd[:LEVEL]\n"
+			 "                         compress tar output on the server\n"));
 	printf(_("\nGeneral options:\n"));
 	printf(_("  -c, --checkpoint=fast|spread\n"
 			 "                         set fast or spread checkpointing\n"));
@@ -1031,7 +1035,9 @@ writeTarData(WriteTarState *state, char *buf, int r)
  * enabled, the data will be compressed while written to the file.
  *
  * The file will be named base.tar[.gz] if it's for the main data directory
- * or <tablespaceoid>.tar[.gz] if it's for another tablespace.
+ * or <tablespaceoid>.tar[.gz] if it's for another tablespace.  If the server
+ * compresses the data, the file suffix is that of the compression method,
+ * and the data is written as it is.
  *
  * No attempt to inspect or validate the contents of the file is done.
  */
@@ -1040,6 +1046,17 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 {
 	char		zerobuf[TAR_BLOCK_SIZE * 2];
 	WriteTarState state;
+	const char *suffix = "";
+
+	if (server_compression != NULL)
+	{
+		if (strcmp(server_compression, "gzip") == 0)
+			suffix = ".gz";
+		else if (strcmp(server_compression, "lz4") == 0)
+			suffix = ".lz4";
+		else
+			suffix = ".zst";
+	}
 
 	memset(&state, 0, sizeof(state));
 	state.tablespacenum = rownum;
@@ -1112,7 +1129,7 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 #endif
 			{
 				snprintf(state.filename, sizeof(state.filename),
-						 "%s/base.tar", basedir);
+						 "%s/base.tar%s", basedir, suffix);
 				state.tarfile = fopen(state.filename, "wb");
 			}
 		}
@@ -1140,8 +1157,8 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 		else
 #endif
 		{
-			snprintf(state.filename, sizeof(state.filename), "%s/%s.tar",
-					 basedir, PQgetvalue(res, rownum, 0));
+			snprintf(state.filename, sizeof(state.filename), "%s/%s.tar%s",
+					 basedir, PQgetvalue(res, rownum, 0), suffix);
 			state.tarfile = fopen(state.filename, "wb");
 		}
 	}
@@ -1256,8 +1273,12 @@ ReceiveTarFile(PGconn *conn, PGresult *res, int rownum)
 		termPQExpBuffer(&buf);
 	}
 
-	/* 2 * TAR_BLOCK_SIZE bytes empty data at end of file */
-	writeTarData(&state, zerobuf, sizeof(zerobuf));
+	/*
+	 * 2 * TAR_BLOCK_SIZE bytes empty data at end of file.  A server that
+	 * compresses the data has added them already.
+	 */
+	if (server_compression == NULL)
+		writeTarData(&state, zerobuf, sizeof(zerobuf));
 
 #ifdef HAVE_LIBZ
 	if (state.ztarfile != NULL)
@@ -1805,6 +1826,7 @@ BaseBackup(void)
 	char	   *maxrate_clause = NULL;
 	char	   *manifest_clause = NULL;
 	char	   *manifest_checksums_clause = "";
+	char	   *compression_clause = "";
 	int			i;
 	char		xlogstart[64];
 	char		xlogend[64];
@@ -1878,6 +1900,23 @@ BaseBackup(void)
 												 manifest_checksums);
 	}
 
+	if (server_compression != NULL)
+	{
+		if (serverMajor < 1400)
+		{
+			pg_log_error("server-side compression is not supported by server version %s",
+						 PQparameterStatus(conn, "server_version"));
+			exit(1);
+		}
+		if (server_compresslevel > 0)
+			compression_clause = psprintf("COMPRESSION '%s' COMPRESSION_LEVEL %d",
+										  server_compression,
+										  server_compresslevel);
+		else
+			compression_clause = psprintf("COMPRESSION '%s'",
+										  server_compression);
+	}
+
 	if (verbose)
 		pg_log_info("initiating base backup, waiting for checkpoint to complete");
 
@@ -1891,7 +1930,7 @@ BaseBackup(void)
 	}
 
 	basebkp =
-		psprintf("BASE_BACKUP LABEL '%s' %s %s %s %s %s %s %s %s %s",
+		psprintf("BASE_BACKUP LABEL '%s' %s %s %s %s %s %s %s %s %s %s",
 				 escaped_label,
 				 estimatesize ? "PROGRESS" : "",
 				 includewal == FETCH_WAL ? "WAL" : "",
@@ -1901,7 +1940,8 @@ BaseBackup(void)
 				 format == 't' ? "TABLESPACE_MAP" : "",
 				 verify_checksums ? "" : "NOVERIFY_CHECKSUMS",
 				 manifest_clause ? manifest_clause : "",
-				 manifest_checksums_clause);
+				 manifest_checksums_clause,
+				 compression_clause);
 
 	if (PQsendQuery(conn, basebkp) == 0)
 	{
@@ -2257,6 +2297,7 @@ main(int argc, char **argv)
 		{"no-manifest", no_argument, NULL, 5},
 		{"manifest-force-encode", no_argument, NULL, 6},
 		{"manifest-checksums", required_argument, NULL, 7},
+		{"server-compress", required_argument, NULL, 8},
 		{NULL, 0, NULL, 0}
 	};
 	int			c;
@@ -2437,6 +2478,35 @@ main(int argc, char **argv)
 			case 7:
 				manifest_checksums = pg_strdup(optarg);
 				break;
+			case 8:
+				{
+					char	   *sep;
+
+					server_compression = pg_strdup(optarg);
+					sep = strchr(server_compression, ':');
+					if (sep != NULL)
+					{
+						char	   *endptr;
+
+						*sep = '\0';
+						server_compresslevel = strtol(sep + 1, &endptr, 10);
+						if (*endptr != '\0' || server_compresslevel <= 0)
+						{
+							pg_log_error("invalid compression level \"%s\"",
+										 sep + 1);
+							exit(1);
+						}
+					}
+					if (strcmp(server_compression, "gzip") != 0 &&
+						strcmp(server_compression, "lz4") != 0 &&
+						strcmp(server_compression, "zstd") != 0)
+					{
+						pg_log_error("invalid compression method \"%s\"",
+									 server_compression);
+						exit(1);
+					}
+				}
+				break;
 			default:
 
 				/*
@@ -2482,6 +2552,44 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (server_compression != NULL)
+	{
+		if (format != 't')
+		{
+			pg_log_error("only tar mode backups can be compressed");
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+		if (compresslevel != 0)
+		{
+			pg_log_error("%s and %s are incompatible options",
+						 "--server-compress", "--compress");
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+
+		/*
+		 * We write what the server sends as it is, so we can't add anything
+		 * to the archives.
+		 */
+		if (writerecoveryconf)
+		{
+			pg_log_error("%s and %s are incompatible options",
+						 "--server-compress", "--write-recovery-conf");
+			fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+					progname);
+			exit(1);
+		}
+		if (strcmp(basedir, "-") == 0 && manifest)
+		{
+			pg_log_error("cannot include the backup manifest in a tar archive compressed on the server");
+			pg_log_info("HINT: use --no-manifest to suppress the backup manifest");
+			exit(1);
+		}
+	}
+
 	if (format == 't' && includewal == STREAM_WAL && strcmp(basedir, "-") == 0)
 	{
 		pg_log_error("cannot stream write-ahead logs in tar mode to stdout");
@@ -6,7 +6,7 @@ use File::Basename qw(basename dirname);
 use File::Path qw(rmtree);
 use PostgresNode;
 use TestLib;
-use Test::More tests => 109;
+use Test::More tests => 113;
 
 program_help_ok('pg_basebackup');
 program_version_ok('pg_basebackup');
@@ -177,6 +177,34 @@ $node->command_ok([ 'pg_basebackup', '-D', "$tempdir/tarbackup", '-Ft' ],
 ok(-f "$tempdir/tarbackup/base.tar", 'backup tar was created');
 rmtree("$tempdir/tarbackup");
 
+SKIP:
+{
+	skip "postgres was not built with zlib support", 2
+	  if (!check_pg_config("#define HAVE_LIBZ 1"));
+
+	$node->command_ok(
+		[
+			'pg_basebackup', '-D', "$tempdir/tarbackup_gz", '-Ft',
+			'--server-compress=gzip:1'
+		],
+		'tar format with server-side compression');
+	ok(-f "$tempdir/tarbackup_gz/base.tar.gz",
+		'server-compressed backup tar was created');
+	rmtree("$tempdir/tarbackup_gz");
+}
+$node->command_fails(
+	[
+		'pg_basebackup', '-D', "$tempdir/backup_foo", '-Fp',
+		'--server-compress=gzip'
+	],
+	'server-side compression requires tar format');
+$node->command_fails(
+	[
+		'pg_basebackup', '-D', "$tempdir/backup_foo", '-Ft',
+		'--server-compress=rar'
+	],
+	'unknown server-side compression method fails');
+
 $node->command_fails(
 	[ 'pg_basebackup', '-D', "$tempdir/backup_foo", '-Fp', "-T=/foo" ],
 	'-T with empty old directory fails');
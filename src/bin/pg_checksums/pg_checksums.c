@@ -19,6 +19,11 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#if defined(ENABLE_THREAD_SAFETY) && !defined(WIN32)
+#include <pthread.h>
+#define USE_CHECKSUM_THREADS
+#endif
+
 #include "access/xlog_internal.h"
 #include "common/controldata_utils.h"
 #include "common/file_perm.h"
@@ -40,6 +45,7 @@ static char *only_filenode = NULL;
 static bool do_sync = true;
 static bool verbose = false;
 static bool showprogress = false;
+static int	num_jobs = 1;
 
 typedef enum
 {
@@ -62,6 +68,44 @@ static PgChecksumMode mode = PG_MODE_CHECK;
 
 static const char *progname;
 
+/*
+ * A relation segment file to operate on, collected by scan_directory().
+ */
+typedef struct ChecksumFile
+{
+	char	   *path;
+	BlockNumber segmentno;
+	int64		size;
+} ChecksumFile;
+
+static ChecksumFile *filelist = NULL;
+static int	nfiles = 0;
+static int	maxfiles = 0;
+
+/*
+ * State of one worker.  With --jobs, every worker runs in its own thread
+ * and gets a fixed share of the files; the counters are only written by
+ * the worker itself, and read without locking by the main thread for
+ * progress reports.
+ */
+typedef struct ChecksumWorker
+{
+#ifdef USE_CHECKSUM_THREADS
+	pthread_t	thread;
+#endif
+	ChecksumFile **assigned;	/* files assigned to this worker */
+	int			nassigned;
+	int64		assigned_size;	/* total size of assigned files */
+
+	int64		files;			/* counters, as in the globals above */
+	int64		blocks;
+	int64		badblocks;
+	int64		current_size;	/* bytes processed so far */
+	volatile bool done;
+} ChecksumWorker;
+
+static ChecksumWorker *workers = NULL;
+
 /*
  * Progress status information.
  */
@@ -81,6 +125,7 @@ usage(void)
 	printf(_("  -d, --disable            disable data checksums\n"));
 	printf(_("  -e, --enable             enable data checksums\n"));
 	printf(_("  -f, --filenode=FILENODE  check only relation with specified filenode\n"));
+	printf(_("  -j, --jobs=NUM           use this many parallel jobs to process files\n"));
 	printf(_("  -N, --no-sync            do not wait for changes to be written safely to disk\n"));
 	printf(_("  -P, --progress           show progress information\n"));
 	printf(_("  -v, --verbose            output verbose messages\n"));
@@ -141,6 +186,11 @@ progress_report(bool finished)
 	/* Save current time */
 	last_progress_report = now;
 
+	/* Sum up what the workers have done so far */
+	current_size = 0;
+	for (int i = 0; i < num_jobs; i++)
+		current_size += workers[i].current_size;
+
 	/* Adjust total size if current_size is larger */
 	if (current_size > total_size)
 		total_size = current_size;
@@ -188,7 +238,7 @@ skipfile(const char *fn)
 }
 
 static void
-scan_file(const char *fn, BlockNumber segmentno)
+scan_file(ChecksumWorker *worker, const char *fn, BlockNumber segmentno)
 {
 	PGAlignedBlock buf;
 	PageHeader	header = (PageHeader) buf.data;
@@ -208,7 +258,7 @@ scan_file(const char *fn, BlockNumber segmentno)
 		exit(1);
 	}
 
-	files++;
+	worker->files++;
 
 	for (blockno = 0;; blockno++)
 	{
@@ -227,14 +277,14 @@ scan_file(const char *fn, BlockNumber segmentno)
 							 blockno, fn, r, BLCKSZ);
 			exit(1);
 		}
-		blocks++;
+		worker->blocks++;
 
 		/* New pages have no checksum yet */
 		if (PageIsNew(header))
 			continue;
 
 		csum = pg_checksum_page(buf.data, blockno + segmentno * RELSEG_SIZE);
-		current_size += r;
+		worker->current_size += r;
 		if (mode == PG_MODE_CHECK)
 		{
 			if (csum != header->pd_checksum)
@@ -242,7 +292,7 @@ scan_file(const char *fn, BlockNumber segmentno)
 				if (ControlFile->data_checksum_version == PG_DATA_CHECKSUM_VERSION)
 					pg_log_error("checksum verification failed in file \"%s\", block %u: calculated checksum %X but block contains %X",
 								 fn, blockno, csum, header->pd_checksum);
-				badblocks++;
+				worker->badblocks++;
 			}
 		}
 		else if (mode == PG_MODE_ENABLE)
@@ -273,7 +323,8 @@ scan_file(const char *fn, BlockNumber segmentno)
 			}
 		}
 
-		if (showprogress)
+		/* With several jobs, the main thread reports progress */
+		if (showprogress && num_jobs == 1)
 			progress_report(false);
 	}
 
@@ -289,14 +340,12 @@ scan_file(const char *fn, BlockNumber segmentno)
 }
 
 /*
- * Scan the given directory for items which can be checksummed and
- * operate on each one of them.  If "sizeonly" is true, the size of
- * all the items which have checksums is computed and returned back
- * to the caller without operating on the files.  This is used to compile
- * the total size of the data directory for progress reports.
+ * Scan the given directory for items which can be checksummed and add
+ * each one of them to the list of files to process.  The total size of
+ * the items added is returned, for progress reports.
  */
 static int64
-scan_directory(const char *basedir, const char *subdir, bool sizeonly)
+scan_directory(const char *basedir, const char *subdir)
 {
 	int64		dirsize = 0;
 	char		path[MAXPGPATH];
@@ -377,12 +426,16 @@ scan_directory(const char *basedir, const char *subdir, bool sizeonly)
 
 			dirsize += st.st_size;
 
-			/*
-			 * No need to work on the file when calculating only the size of
-			 * the items in the data folder.
-			 */
-			if (!sizeonly)
-				scan_file(fn, segmentno);
+			if (nfiles >= maxfiles)
+			{
+				maxfiles = Max(maxfiles * 2, 1024);
+				filelist = pg_realloc(filelist,
+									  maxfiles * sizeof(ChecksumFile));
+			}
+			filelist[nfiles].path = pg_strdup(fn);
+			filelist[nfiles].segmentno = segmentno;
+			filelist[nfiles].size = st.st_size;
+			nfiles++;
 		}
 #ifndef WIN32
 		else if (S_ISDIR(st.st_mode) || S_ISLNK(st.st_mode))
@@ -427,12 +480,11 @@ scan_directory(const char *basedir, const char *subdir, bool sizeonly)
 
 				/* Looks like a valid tablespace location */
 				dirsize += scan_directory(tblspc_path,
-										  TABLESPACE_VERSION_DIRECTORY,
-										  sizeonly);
+										  TABLESPACE_VERSION_DIRECTORY);
 			}
 			else
 			{
-				dirsize += scan_directory(path, de->d_name, sizeonly);
+				dirsize += scan_directory(path, de->d_name);
 			}
 		}
 	}
@@ -440,6 +492,116 @@ scan_directory(const char *basedir, const char *subdir, bool sizeonly)
 	return dirsize;
 }
 
+/*
+ * Work through the files assigned to one worker.
+ */
+static void *
+checksum_worker(void *arg)
+{
+	ChecksumWorker *worker = (ChecksumWorker *) arg;
+
+	for (int i = 0; i < worker->nassigned; i++)
+		scan_file(worker, worker->assigned[i]->path,
+				  worker->assigned[i]->segmentno);
+
+	worker->done = true;
+	return NULL;
+}
+
+/* qsort comparator for sorting ChecksumFiles by decreasing size */
+static int
+file_size_cmp(const void *a, const void *b)
+{
+	const ChecksumFile *fa = (const ChecksumFile *) a;
+	const ChecksumFile *fb = (const ChecksumFile *) b;
+
+	if (fa->size > fb->size)
+		return -1;
+	if (fa->size < fb->size)
+		return 1;
+	return 0;
+}
+
+/*
+ * Operate on all the files collected by scan_directory().
+ *
+ * With a single job the files are processed in directory order by the main
+ * thread.  Otherwise, the files are dealt out largest first, each to the
+ * worker with the least work assigned so far, so that the workers finish
+ * at about the same time; relation files are split into 1GB segments, so
+ * large relations are spread over several workers.
+ */
+static void
+process_files(void)
+{
+	workers = pg_malloc0(num_jobs * sizeof(ChecksumWorker));
+	for (int i = 0; i < num_jobs; i++)
+		workers[i].assigned = pg_malloc(nfiles * sizeof(ChecksumFile *));
+
+	if (num_jobs > 1)
+		qsort(filelist, nfiles, sizeof(ChecksumFile), file_size_cmp);
+
+	for (int i = 0; i < nfiles; i++)
+	{
+		ChecksumWorker *target = &workers[0];
+
+		for (int j = 1; j < num_jobs; j++)
+		{
+			if (workers[j].assigned_size < target->assigned_size)
+				target = &workers[j];
+		}
+		target->assigned[target->nassigned++] = &filelist[i];
+		target->assigned_size += filelist[i].size;
+	}
+
+	if (num_jobs == 1)
+		(void) checksum_worker(&workers[0]);
+#ifdef USE_CHECKSUM_THREADS
+	else
+	{
+		for (int i = 0; i < num_jobs; i++)
+		{
+			errno = pthread_create(&workers[i].thread, NULL, checksum_worker,
+								   &workers[i]);
+			if (errno != 0)
+			{
+				pg_log_error("could not create thread: %m");
+				exit(1);
+			}
+		}
+
+		if (showprogress)
+		{
+			for (;;)
+			{
+				bool		alldone = true;
+
+				for (int i = 0; i < num_jobs; i++)
+				{
+					if (!workers[i].done)
+						alldone = false;
+				}
+				if (alldone)
+					break;
+
+				progress_report(false);
+				pg_usleep(100000L);
+			}
+		}
+
+		for (int i = 0; i < num_jobs; i++)
+			pthread_join(workers[i].thread, NULL);
+	}
+#endif
+
+	for (int i = 0; i < num_jobs; i++)
+	{
+		files += workers[i].files;
+		blocks += workers[i].blocks;
+		badblocks += workers[i].badblocks;
+	}
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -449,6 +611,7 @@ main(int argc, char *argv[])
 		{"disable", no_argument, NULL, 'd'},
 		{"enable", no_argument, NULL, 'e'},
 		{"filenode", required_argument, NULL, 'f'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"no-sync", no_argument, NULL, 'N'},
 		{"progress", no_argument, NULL, 'P'},
 		{"verbose", no_argument, NULL, 'v'},
@@ -478,7 +641,7 @@ main(int argc, char *argv[])
 		}
 	}
 
-	while ((c = getopt_long(argc, argv, "cD:deNPf:v", long_options, &option_index)) != -1)
+	while ((c = getopt_long(argc, argv, "cD:deNPf:j:v", long_options, &option_index)) != -1)
 	{
 		switch (c)
 		{
@@ -499,6 +662,21 @@ main(int argc, char *argv[])
 				}
 				only_filenode = pstrdup(optarg);
 				break;
+			case 'j':
+				num_jobs = atoi(optarg);
+				if (num_jobs <= 0)
+				{
+					pg_log_error("invalid number of parallel jobs");
+					exit(1);
+				}
+#ifndef USE_CHECKSUM_THREADS
+				if (num_jobs != 1)
+				{
+					pg_log_error("parallel jobs are not supported on this platform");
+					exit(1);
+				}
+#endif
+				break;
 			case 'N':
 				do_sync = false;
 				break;
@@ -611,20 +789,15 @@ main(int argc, char *argv[])
 	if (mode == PG_MODE_CHECK || mode == PG_MODE_ENABLE)
 	{
 		/*
-		 * If progress status information is requested, we need to scan the
-		 * directory tree twice: once to know how much total data needs to be
-		 * processed and once to do the real work.
+		 * Collect the list of files first, which also tells how much total
+		 * data needs to be processed for progress reports, then do the real
+		 * work.
 		 */
-		if (showprogress)
-		{
-			total_size = scan_directory(DataDir, "global", true);
-			total_size += scan_directory(DataDir, "base", true);
-			total_size += scan_directory(DataDir, "pg_tblspc", true);
-		}
+		total_size = scan_directory(DataDir, "global");
+		total_size += scan_directory(DataDir, "base");
+		total_size += scan_directory(DataDir, "pg_tblspc");
 
-		(void) scan_directory(DataDir, "global", false);
-		(void) scan_directory(DataDir, "base", false);
-		(void) scan_directory(DataDir, "pg_tblspc", false);
+		process_files();
 
 		if (showprogress)
 			progress_report(true);
@@ -5,7 +5,7 @@ use strict;
 use warnings;
 use PostgresNode;
 use TestLib;
-use Test::More tests => 63;
+use Test::More tests => 64;
 
 
 # Utility routine to create and check a table with corrupted checksums
@@ -164,6 +164,11 @@ command_ok(
 	[ 'pg_checksums', '-D', $pgdata ],
 	"verifies checksums as default action");
 
+# Checksums can be verified with several jobs
+command_ok(
+	[ 'pg_checksums', '--check', '--jobs', '4', '-D', $pgdata ],
+	"verifies checksums with parallel jobs");
+
 # Specific relation files cannot be requested when action is --disable
 # or --enable.
 command_fails(
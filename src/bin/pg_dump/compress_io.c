@@ -11,9 +11,10 @@
  * provides more flexibility, using callbacks to read/write data from the
  * underlying stream. The second API is a wrapper around fopen/gzopen and
  * friends, providing an interface similar to those, but abstracts away
- * the possible compression. Both APIs use libz for the compression, but
- * the second API uses gzip headers, so the resulting files can be easily
- * manipulated with the gzip utility.
+ * the possible compression. Both APIs can use libz, LZ4 or zstd for the
+ * compression.  The second API writes gzip headers or LZ4 and zstd frames,
+ * so the resulting files can be easily manipulated with the gzip, lz4 and
+ * zstd utilities.
  *
  * Compressor API
  * --------------
@@ -41,10 +42,12 @@
  *	libz's gzopen() APIs. It allows you to use the same functions for
  *	compressed and uncompressed streams. cfopen_read() first tries to open
  *	the file with given name, and if it fails, it tries to open the same
- *	file with the .gz suffix. cfopen_write() opens a file for writing, an
- *	extra argument specifies if the file should be compressed, and adds the
- *	.gz suffix to the filename if so. This allows you to easily handle both
- *	compressed and uncompressed files.
+ *	file with the .gz, .lz4 or .zst suffix. cfopen_write() opens a file for
+ *	writing, an extra argument specifies if and how the file should be
+ *	compressed, and adds the matching suffix to the filename if so. This
+ *	allows you to easily handle both compressed and uncompressed files.
+ *	There is no gzopen() equivalent for LZ4 and zstd, so for those the
+ *	stream is (de)compressed here, on top of a plain stdio file.
  *
  * IDENTIFICATION
  *	   src/bin/pg_dump/compress_io.c
@@ -53,9 +56,70 @@
  */
 #include "postgres_fe.h"
 
+#include <limits.h>
+
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "compress_io.h"
 #include "pg_backup_utils.h"
 
+/* Highest levels accepted for LZ4 and zstd */
+#define LZ4_MAX_LEVEL	12
+#define ZSTD_MAX_LEVEL	22
+
+/* Number of zstd worker threads to use for compression (0 = none) */
+static int	compression_workers = 0;
+
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+/*
+ * LZ4 and zstd compression state, shared by both APIs.  Output is passed to
+ * a StreamWriteFunc as it becomes available.
+ */
+typedef void (*StreamWriteFunc) (void *arg, const char *buf, size_t len);
+
+typedef struct StreamCompressor
+{
+	CompressionAlgorithm alg;
+	char	   *outbuf;
+	size_t		outbufsize;
+	size_t		outlen;			/* bytes in outbuf not yet written */
+#ifdef USE_LZ4
+	LZ4F_cctx  *lz4;
+#endif
+#ifdef USE_ZSTD
+	ZSTD_CCtx  *zstd;
+#endif
+} StreamCompressor;
+
+typedef struct StreamDecompressor
+{
+	CompressionAlgorithm alg;
+#ifdef USE_LZ4
+	LZ4F_dctx  *lz4;
+#endif
+#ifdef USE_ZSTD
+	ZSTD_DCtx  *zstd;
+#endif
+} StreamDecompressor;
+
+static StreamCompressor *CreateStreamCompressor(CompressionAlgorithm alg,
+												int level);
+static void StreamCompress(StreamCompressor *sc, const char *data, size_t len,
+						   StreamWriteFunc writeF, void *arg);
+static void EndStreamCompressor(StreamCompressor *sc,
+								StreamWriteFunc writeF, void *arg);
+static StreamDecompressor *CreateStreamDecompressor(CompressionAlgorithm alg);
+static size_t StreamDecompress(StreamDecompressor *sd,
+							   const char *in, size_t inlen, size_t *inpos,
+							   char *out, size_t outsize, bool *done);
+static void EndStreamDecompressor(StreamDecompressor *sd);
+#endif
+
 /*----------------------
  * Compressor API
  *----------------------
@@ -72,11 +136,12 @@ struct CompressorState
 	char	   *zlibOut;
 	size_t		zlibOutSize;
 #endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	StreamCompressor *sc;
+	ArchiveHandle *AH;			/* for WriteStreamCompressor */
+#endif
 };
 
-static void ParseCompressionOption(int compression, CompressionAlgorithm *alg,
-								   int *level);
-
 /* Routines that support zlib compressed data I/O */
 #ifdef HAVE_LIBZ
 static void InitCompressorZlib(CompressorState *cs, int level);
@@ -88,33 +153,271 @@ static void WriteDataToArchiveZlib(ArchiveHandle *AH, CompressorState *cs,
 static void EndCompressorZlib(ArchiveHandle *AH, CompressorState *cs);
 #endif
 
+/* Routines that support LZ4 and zstd compressed data I/O */
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+static void WriteStreamCompressor(void *arg, const char *buf, size_t len);
+static void ReadDataFromArchiveStream(ArchiveHandle *AH,
+									  CompressionAlgorithm alg,
+									  ReadFunc readF);
+#endif
+
 /* Routines that support uncompressed data I/O */
 static void ReadDataFromArchiveNone(ArchiveHandle *AH, ReadFunc readF);
 static void WriteDataToArchiveNone(ArchiveHandle *AH, CompressorState *cs,
 								   const char *data, size_t dLen);
 
+static bool ParseCompressionInt(const char *str, int *result);
+
 /*
  * Interprets a numeric 'compression' value. The algorithm implied by the
- * value (zlib or none at the moment), is returned in *alg, and the
- * zlib compression level in *level.
+ * value is returned in *alg, and the compression level in *level.
  */
-static void
+void
 ParseCompressionOption(int compression, CompressionAlgorithm *alg, int *level)
 {
+	int			lev = compression;
+
 	if (compression == Z_DEFAULT_COMPRESSION ||
 		(compression > 0 && compression <= 9))
 		*alg = COMPR_ALG_LIBZ;
 	else if (compression == 0)
 		*alg = COMPR_ALG_NONE;
+	else if (compression >= COMPRESSION_LZ4 &&
+			 compression <= COMPRESSION_LZ4 + LZ4_MAX_LEVEL)
+	{
+		*alg = COMPR_ALG_LZ4;
+		lev = compression - COMPRESSION_LZ4;
+	}
+	else if (compression >= COMPRESSION_ZSTD &&
+			 compression <= COMPRESSION_ZSTD + ZSTD_MAX_LEVEL)
+	{
+		*alg = COMPR_ALG_ZSTD;
+		lev = compression - COMPRESSION_ZSTD;
+	}
 	else
 	{
 		fatal("invalid compression code: %d", compression);
 		*alg = COMPR_ALG_NONE;	/* keep compiler quiet */
 	}
 
-	/* The level is just the passed-in value. */
 	if (level)
-		*level = compression;
+		*level = lev;
+}
+
+/*
+ * Parse the argument of pg_dump's -Z/--compress option, and return the
+ * corresponding compression setting.
+ *
+ * For backwards compatibility, a plain number is a zlib level, 0 meaning no
+ * compression.  Otherwise the argument is METHOD[:DETAIL], where METHOD is
+ * one of none, gzip, lz4 and zstd, and DETAIL is a compression level or a
+ * comma-separated list of level=N and, for zstd only, workers=N items.  The
+ * number of zstd worker threads is returned in *workers.
+ */
+int
+ParseCompressionSpec(const char *spec, int *workers)
+{
+	const char *detail = strchr(spec, ':');
+	char	   *method;
+	CompressionAlgorithm alg;
+	int			maxlevel;
+	int			level;
+	int			compression;
+
+	*workers = 0;
+
+	if (ParseCompressionInt(spec, &level))
+	{
+		if (level < 0 || level > 9)
+			fatal("compression level must be in range 0..9");
+		return level;
+	}
+
+	method = detail ? pnstrdup(spec, detail - spec) : pg_strdup(spec);
+	if (strcmp(method, "none") == 0)
+	{
+		alg = COMPR_ALG_NONE;
+		maxlevel = 0;
+		level = 0;
+	}
+	else if (strcmp(method, "gzip") == 0)
+	{
+		alg = COMPR_ALG_LIBZ;
+		maxlevel = 9;
+		level = Z_DEFAULT_COMPRESSION;
+	}
+	else if (strcmp(method, "lz4") == 0)
+	{
+		alg = COMPR_ALG_LZ4;
+		maxlevel = LZ4_MAX_LEVEL;
+		level = 0;
+	}
+	else if (strcmp(method, "zstd") == 0)
+	{
+		alg = COMPR_ALG_ZSTD;
+		maxlevel = ZSTD_MAX_LEVEL;
+		level = 0;
+	}
+	else
+	{
+		fatal("unrecognized compression method \"%s\"", method);
+		alg = COMPR_ALG_NONE;	/* keep compiler quiet */
+		maxlevel = 0;
+		level = 0;
+	}
+
+	if (detail)
+	{
+		char	   *options = pg_strdup(detail + 1);
+		char	   *item;
+
+		for (item = strtok(options, ","); item; item = strtok(NULL, ","))
+		{
+			int			value;
+
+			if (ParseCompressionInt(item, &value) ||
+				(strncmp(item, "level=", 6) == 0 &&
+				 ParseCompressionInt(item + 6, &value)))
+			{
+				if (value < 0 || value > maxlevel)
+					fatal("compression level for method \"%s\" must be in range 0..%d",
+						  method, maxlevel);
+				level = value;
+			}
+			else if (strncmp(item, "workers=", 8) == 0 &&
+					 ParseCompressionInt(item + 8, &value))
+			{
+				if (alg != COMPR_ALG_ZSTD)
+					fatal("compression method \"%s\" does not support workers",
+						  method);
+				if (value < 0)
+					fatal("number of compression workers must be at least 0");
+				*workers = value;
+			}
+			else
+				fatal("unrecognized compression option \"%s\"", item);
+		}
+		free(options);
+	}
+
+	if (alg == COMPR_ALG_LZ4)
+		compression = COMPRESSION_LZ4 + level;
+	else if (alg == COMPR_ALG_ZSTD)
+		compression = COMPRESSION_ZSTD + level;
+	else
+		compression = level;
+
+	/*
+	 * A missing zlib only draws a warning from pg_dump, as it always has, but
+	 * there is no reason to be so lenient about the newer methods.
+	 */
+	if (!CompressionSupported(compression) && alg != COMPR_ALG_LIBZ)
+		fatal("compression method \"%s\" is not supported by this build",
+			  method);
+	free(method);
+
+	return compression;
+}
+
+/*
+ * Parse a decimal integer, requiring the whole string to be consumed.
+ */
+static bool
+ParseCompressionInt(const char *str, int *result)
+{
+	char	   *endptr;
+	long		val;
+
+	errno = 0;
+	val = strtol(str, &endptr, 10);
+	if (endptr == str || *endptr != '\0' || errno == ERANGE ||
+		val < INT_MIN || val > INT_MAX)
+		return false;
+	*result = (int) val;
+	return true;
+}
+
+/*
+ * Can this installation read and write data with the given compression
+ * setting?
+ */
+bool
+CompressionSupported(int compression)
+{
+	CompressionAlgorithm alg;
+
+	ParseCompressionOption(compression, &alg, NULL);
+	switch (alg)
+	{
+		case COMPR_ALG_NONE:
+			return true;
+		case COMPR_ALG_LIBZ:
+#ifdef HAVE_LIBZ
+			return true;
+#else
+			return false;
+#endif
+		case COMPR_ALG_LZ4:
+#ifdef USE_LZ4
+			return true;
+#else
+			return false;
+#endif
+		case COMPR_ALG_ZSTD:
+#ifdef USE_ZSTD
+			return true;
+#else
+			return false;
+#endif
+	}
+	return false;				/* keep compiler quiet */
+}
+
+const char *
+CompressionAlgorithmName(CompressionAlgorithm alg)
+{
+	switch (alg)
+	{
+		case COMPR_ALG_NONE:
+			return "none";
+		case COMPR_ALG_LIBZ:
+			return "gzip";
+		case COMPR_ALG_LZ4:
+			return "lz4";
+		case COMPR_ALG_ZSTD:
+			return "zstd";
+	}
+	return "???";				/* keep compiler quiet */
+}
+
+/*
+ * File name suffix used for files compressed with the given algorithm.
+ */
+const char *
+CompressionSuffix(CompressionAlgorithm alg)
+{
+	switch (alg)
+	{
+		case COMPR_ALG_NONE:
+			return "";
+		case COMPR_ALG_LIBZ:
+			return ".gz";
+		case COMPR_ALG_LZ4:
+			return ".lz4";
+		case COMPR_ALG_ZSTD:
+			return ".zst";
+	}
+	return "";					/* keep compiler quiet */
+}
+
+/*
+ * Set the number of worker threads zstd should use for compression.  This
+ * only affects how fast the output is produced, not the output itself.
+ */
+void
+SetCompressionWorkers(int workers)
+{
+	compression_workers = workers;
 }
 
 /* Public interface routines */
@@ -129,10 +432,8 @@ AllocateCompressor(int compression, WriteFunc writeF)
 
 	ParseCompressionOption(compression, &alg, &level);
 
-#ifndef HAVE_LIBZ
-	if (alg == COMPR_ALG_LIBZ)
-		fatal("not built with zlib support");
-#endif
+	if (!CompressionSupported(compression))
+		fatal("not built with %s support", CompressionAlgorithmName(alg));
 
 	cs = (CompressorState *) pg_malloc0(sizeof(CompressorState));
 	cs->writeF = writeF;
@@ -145,6 +446,10 @@ AllocateCompressor(int compression, WriteFunc writeF)
 	if (alg == COMPR_ALG_LIBZ)
 		InitCompressorZlib(cs, level);
 #endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	if (alg == COMPR_ALG_LZ4 || alg == COMPR_ALG_ZSTD)
+		cs->sc = CreateStreamCompressor(alg, level);
+#endif
 
 	return cs;
 }
@@ -168,6 +473,14 @@ ReadDataFromArchive(ArchiveHandle *AH, int compression, ReadFunc readF)
 		ReadDataFromArchiveZlib(AH, readF);
 #else
 		fatal("not built with zlib support");
+#endif
+	}
+	if (alg == COMPR_ALG_LZ4 || alg == COMPR_ALG_ZSTD)
+	{
+		if (!CompressionSupported(compression))
+			fatal("not built with %s support", CompressionAlgorithmName(alg));
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+		ReadDataFromArchiveStream(AH, alg, readF);
 #endif
 	}
 }
@@ -186,6 +499,13 @@ WriteDataToArchive(ArchiveHandle *AH, CompressorState *cs,
 			WriteDataToArchiveZlib(AH, cs, data, dLen);
 #else
 			fatal("not built with zlib support");
+#endif
+			break;
+		case COMPR_ALG_LZ4:
+		case COMPR_ALG_ZSTD:
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+			cs->AH = AH;
+			StreamCompress(cs->sc, data, dLen, WriteStreamCompressor, cs);
 #endif
 			break;
 		case COMPR_ALG_NONE:
@@ -203,6 +523,13 @@ EndCompressor(ArchiveHandle *AH, CompressorState *cs)
 #ifdef HAVE_LIBZ
 	if (cs->comprAlg == COMPR_ALG_LIBZ)
 		EndCompressorZlib(AH, cs);
+#endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	if (cs->comprAlg == COMPR_ALG_LZ4 || cs->comprAlg == COMPR_ALG_ZSTD)
+	{
+		cs->AH = AH;
+		EndStreamCompressor(cs->sc, WriteStreamCompressor, cs);
+	}
 #endif
 	free(cs);
 }
@@ -376,6 +703,353 @@ ReadDataFromArchiveZlib(ArchiveHandle *AH, ReadFunc readF)
 }
 #endif							/* HAVE_LIBZ */
 
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+/*
+ * Functions for LZ4 and zstd compressed output.
+ */
+
+/* StreamWriteFunc passing compressed data on to a CompressorState's writeF */
+static void
+WriteStreamCompressor(void *arg, const char *buf, size_t len)
+{
+	CompressorState *cs = (CompressorState *) arg;
+
+	cs->writeF(cs->AH, buf, len);
+}
+
+static void
+ReadDataFromArchiveStream(ArchiveHandle *AH, CompressionAlgorithm alg,
+						  ReadFunc readF)
+{
+	StreamDecompressor *sd;
+	char	   *out;
+	size_t		cnt;
+	char	   *buf;
+	size_t		buflen;
+	bool		done = false;
+
+	sd = CreateStreamDecompressor(alg);
+
+	buf = pg_malloc(LZ4_IN_SIZE);
+	buflen = LZ4_IN_SIZE;
+
+	out = pg_malloc(LZ4_OUT_SIZE + 1);
+
+	while ((cnt = readF(AH, &buf, &buflen)))
+	{
+		size_t		pos = 0;
+		size_t		outlen;
+
+		/* keep going while there is input, or output might be pending */
+		do
+		{
+			outlen = StreamDecompress(sd, buf, cnt, &pos, out, LZ4_OUT_SIZE,
+									  &done);
+			if (outlen > 0)
+			{
+				out[outlen] = '\0';
+				ahwrite(out, 1, outlen, AH);
+			}
+		} while (pos < cnt || outlen == LZ4_OUT_SIZE);
+	}
+
+	if (!done)
+		fatal("could not uncompress data: compressed data is truncated");
+
+	EndStreamDecompressor(sd);
+
+	free(buf);
+	free(out);
+}
+
+/*
+ * Set up LZ4 or zstd compression at the given level.
+ */
+static StreamCompressor *
+CreateStreamCompressor(CompressionAlgorithm alg, int level)
+{
+	StreamCompressor *sc;
+
+	sc = (StreamCompressor *) pg_malloc0(sizeof(StreamCompressor));
+	sc->alg = alg;
+
+#ifdef USE_LZ4
+	if (alg == COMPR_ALG_LZ4)
+	{
+		LZ4F_preferences_t prefs;
+		size_t		status;
+
+		memset(&prefs, 0, sizeof(prefs));
+		prefs.compressionLevel = level;
+
+		status = LZ4F_createCompressionContext(&sc->lz4, LZ4F_VERSION);
+		if (LZ4F_isError(status))
+			fatal("could not initialize compression library: %s",
+				  LZ4F_getErrorName(status));
+
+		/*
+		 * We feed at most LZ4_IN_SIZE bytes at a time, so this is enough for
+		 * any single call, including the frame header and trailer.
+		 */
+		sc->outbufsize = LZ4F_compressBound(LZ4_IN_SIZE, &prefs);
+		sc->outbuf = pg_malloc(sc->outbufsize);
+
+		/* The frame header is written along with the first data */
+		status = LZ4F_compressBegin(sc->lz4, sc->outbuf, sc->outbufsize,
+									&prefs);
+		if (LZ4F_isError(status))
+			fatal("could not compress data: %s", LZ4F_getErrorName(status));
+		sc->outlen = status;
+	}
+#endif
+#ifdef USE_ZSTD
+	if (alg == COMPR_ALG_ZSTD)
+	{
+		size_t		status;
+
+		sc->zstd = ZSTD_createCCtx();
+		if (sc->zstd == NULL)
+			fatal("could not initialize compression library");
+
+		status = ZSTD_CCtx_setParameter(sc->zstd, ZSTD_c_compressionLevel,
+										level);
+		if (ZSTD_isError(status))
+			fatal("could not set compression level %d: %s",
+				  level, ZSTD_getErrorName(status));
+
+		if (compression_workers > 0)
+		{
+			status = ZSTD_CCtx_setParameter(sc->zstd, ZSTD_c_nbWorkers,
+											compression_workers);
+			if (ZSTD_isError(status))
+				fatal("could not set number of compression workers to %d: %s",
+					  compression_workers, ZSTD_getErrorName(status));
+		}
+
+		sc->outbufsize = ZSTD_CStreamOutSize();
+		sc->outbuf = pg_malloc(sc->outbufsize);
+	}
+#endif
+
+	return sc;
+}
+
+/*
+ * Compress some data, passing any output produced to writeF.
+ */
+static void
+StreamCompress(StreamCompressor *sc, const char *data, size_t len,
+			   StreamWriteFunc writeF, void *arg)
+{
+#ifdef USE_LZ4
+	if (sc->alg == COMPR_ALG_LZ4)
+	{
+		while (len > 0)
+		{
+			size_t		chunk = Min(len, LZ4_IN_SIZE);
+			size_t		status;
+
+			/* Write out the frame header, if still pending */
+			if (sc->outlen > 0)
+			{
+				writeF(arg, sc->outbuf, sc->outlen);
+				sc->outlen = 0;
+			}
+
+			status = LZ4F_compressUpdate(sc->lz4, sc->outbuf, sc->outbufsize,
+										 data, chunk, NULL);
+			if (LZ4F_isError(status))
+				fatal("could not compress data: %s",
+					  LZ4F_getErrorName(status));
+
+			/* LZ4 buffers input until it has a whole block */
+			if (status > 0)
+				writeF(arg, sc->outbuf, status);
+
+			data += chunk;
+			len -= chunk;
+		}
+	}
+#endif
+#ifdef USE_ZSTD
+	if (sc->alg == COMPR_ALG_ZSTD)
+	{
+		ZSTD_inBuffer input = {data, len, 0};
+
+		while (input.pos < input.size)
+		{
+			ZSTD_outBuffer output = {sc->outbuf, sc->outbufsize, 0};
+			size_t		status;
+
+			status = ZSTD_compressStream2(sc->zstd, &output, &input,
+										  ZSTD_e_continue);
+			if (ZSTD_isError(status))
+				fatal("could not compress data: %s",
+					  ZSTD_getErrorName(status));
+
+			if (output.pos > 0)
+				writeF(arg, sc->outbuf, output.pos);
+		}
+	}
+#endif
+}
+
+/*
+ * Finish the compressed stream, writing out everything still buffered, and
+ * free the compressor.
+ */
+static void
+EndStreamCompressor(StreamCompressor *sc, StreamWriteFunc writeF, void *arg)
+{
+#ifdef USE_LZ4
+	if (sc->alg == COMPR_ALG_LZ4)
+	{
+		size_t		status;
+
+		if (sc->outlen > 0)
+			writeF(arg, sc->outbuf, sc->outlen);
+
+		status = LZ4F_compressEnd(sc->lz4, sc->outbuf, sc->outbufsize, NULL);
+		if (LZ4F_isError(status))
+			fatal("could not compress data: %s", LZ4F_getErrorName(status));
+		if (status > 0)
+			writeF(arg, sc->outbuf, status);
+
+		status = LZ4F_freeCompressionContext(sc->lz4);
+		if (LZ4F_isError(status))
+			fatal("could not close compression stream: %s",
+				  LZ4F_getErrorName(status));
+	}
+#endif
+#ifdef USE_ZSTD
+	if (sc->alg == COMPR_ALG_ZSTD)
+	{
+		size_t		status;
+
+		do
+		{
+			ZSTD_inBuffer input = {NULL, 0, 0};
+			ZSTD_outBuffer output = {sc->outbuf, sc->outbufsize, 0};
+
+			status = ZSTD_compressStream2(sc->zstd, &output, &input,
+										  ZSTD_e_end);
+			if (ZSTD_isError(status))
+				fatal("could not compress data: %s",
+					  ZSTD_getErrorName(status));
+
+			if (output.pos > 0)
+				writeF(arg, sc->outbuf, output.pos);
+		} while (status != 0);
+
+		ZSTD_freeCCtx(sc->zstd);
+	}
+#endif
+
+	free(sc->outbuf);
+	free(sc);
+}
+
+static StreamDecompressor *
+CreateStreamDecompressor(CompressionAlgorithm alg)
+{
+	StreamDecompressor *sd;
+
+	sd = (StreamDecompressor *) pg_malloc0(sizeof(StreamDecompressor));
+	sd->alg = alg;
+
+#ifdef USE_LZ4
+	if (alg == COMPR_ALG_LZ4)
+	{
+		size_t		status;
+
+		status = LZ4F_createDecompressionContext(&sd->lz4, LZ4F_VERSION);
+		if (LZ4F_isError(status))
+			fatal("could not initialize compression library: %s",
+				  LZ4F_getErrorName(status));
+	}
+#endif
+#ifdef USE_ZSTD
+	if (alg == COMPR_ALG_ZSTD)
+	{
+		sd->zstd = ZSTD_createDCtx();
+		if (sd->zstd == NULL)
+			fatal("could not initialize compression library");
+	}
+#endif
+
+	return sd;
+}
+
+/*
+ * Decompress from in[*inpos .. inlen) into out, which has room for outsize
+ * bytes.  *inpos is advanced past the input consumed, and the number of
+ * bytes produced is returned.  *done is set to true once the end of the
+ * compressed stream has been reached.
+ *
+ * Output can remain buffered inside the decompressor even after all input
+ * has been consumed, so callers must call again while the output buffer
+ * comes back full.
+ */
+static size_t
+StreamDecompress(StreamDecompressor *sd,
+				 const char *in, size_t inlen, size_t *inpos,
+				 char *out, size_t outsize, bool *done)
+{
+#ifdef USE_LZ4
+	if (sd->alg == COMPR_ALG_LZ4)
+	{
+		size_t		srcsize = inlen - *inpos;
+		size_t		dstsize = outsize;
+		size_t		status;
+
+		status = LZ4F_decompress(sd->lz4, out, &dstsize,
+								 in + *inpos, &srcsize, NULL);
+		if (LZ4F_isError(status))
+			fatal("could not uncompress data: %s",
+				  LZ4F_getErrorName(status));
+
+		*inpos += srcsize;
+		if (status == 0)
+			*done = true;
+		return dstsize;
+	}
+#endif
+#ifdef USE_ZSTD
+	if (sd->alg == COMPR_ALG_ZSTD)
+	{
+		ZSTD_inBuffer input = {in, inlen, *inpos};
+		ZSTD_outBuffer output = {out, outsize, 0};
+		size_t		status;
+
+		status = ZSTD_decompressStream(sd->zstd, &output, &input);
+		if (ZSTD_isError(status))
+			fatal("could not uncompress data: %s",
+				  ZSTD_getErrorName(status));
+
+		*inpos = input.pos;
+		if (status == 0)
+			*done = true;
+		return output.pos;
+	}
+#endif
+	return 0;
+}
+
+static void
+EndStreamDecompressor(StreamDecompressor *sd)
+{
+#ifdef USE_LZ4
+	if (sd->alg == COMPR_ALG_LZ4)
+		LZ4F_freeDecompressionContext(sd->lz4);
+#endif
+#ifdef USE_ZSTD
+	if (sd->alg == COMPR_ALG_ZSTD)
+		ZSTD_freeDCtx(sd->zstd);
+#endif
+	free(sd);
+}
+#endif							/* USE_LZ4 || USE_ZSTD */
+
 
 /*
  * Functions for uncompressed output.
@@ -414,7 +1088,8 @@ WriteDataToArchiveNone(ArchiveHandle *AH, CompressorState *cs,
 
 /*
  * cfp represents an open stream, wrapping the underlying FILE or gzFile
- * pointer. This is opaque to the callers.
+ * pointer, or the FILE pointer and (de)compressor for LZ4 and zstd. This is
+ * opaque to the callers.
  */
 struct cfp
 {
@@ -422,10 +1097,31 @@ struct cfp
 #ifdef HAVE_LIBZ
 	gzFile		compressedfp;
 #endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	FILE	   *rawfp;			/* the compressed file */
+	StreamCompressor *compressor;	/* set if writing */
+	StreamDecompressor *decompressor;	/* set if reading */
+	char	   *inbuf;			/* compressed data read from rawfp */
+	size_t		inpos;
+	size_t		inlen;
+	char	   *outbuf;			/* decompressed data not yet returned */
+	size_t		outpos;
+	size_t		outlen;
+	bool		eof;			/* end of compressed stream reached? */
+	bool		write_failed;	/* error writing to rawfp? */
+#endif
 };
 
-#ifdef HAVE_LIBZ
+/*
+ * Compressed file types cfopen_read() recognizes by their suffix, with a
+ * compression setting for each that is good enough for reading.
+ */
+static const int read_compressions[] = {1, COMPRESSION_LZ4, COMPRESSION_ZSTD};
+
 static int	hasSuffix(const char *filename, const char *suffix);
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+static bool cfp_fill(cfp *fp);
+static void cfp_write_raw(void *arg, const char *buf, size_t len);
 #endif
 
 /* free() without changing errno; useful in several places below */
@@ -442,34 +1138,41 @@ free_keep_errno(void *p)
  * Open a file for reading. 'path' is the file to open, and 'mode' should
  * be either "r" or "rb".
  *
- * If the file at 'path' does not exist, we append the ".gz" suffix (if 'path'
- * doesn't already have it) and try again. So if you pass "foo" as 'path',
- * this will open either "foo" or "foo.gz".
+ * If the file at 'path' does not exist, we append the ".gz", ".lz4" or ".zst"
+ * suffix (if 'path' doesn't already have one of them) and try again. So if
+ * you pass "foo" as 'path', this will open either "foo" or "foo.gz", or
+ * one of the others if supported.
  *
  * On failure, return NULL with an error code in errno.
  */
 cfp *
 cfopen_read(const char *path, const char *mode)
 {
-	cfp		   *fp;
+	cfp		   *fp = NULL;
+	int			i;
 
-#ifdef HAVE_LIBZ
-	if (hasSuffix(path, ".gz"))
-		fp = cfopen(path, mode, 1);
-	else
-#endif
+	for (i = 0; i < lengthof(read_compressions); i++)
 	{
-		fp = cfopen(path, mode, 0);
-#ifdef HAVE_LIBZ
-		if (fp == NULL)
-		{
-			char	   *fname;
+		CompressionAlgorithm alg;
 
-			fname = psprintf("%s.gz", path);
-			fp = cfopen(fname, mode, 1);
-			free_keep_errno(fname);
-		}
-#endif
+		ParseCompressionOption(read_compressions[i], &alg, NULL);
+		if (hasSuffix(path, CompressionSuffix(alg)))
+			return cfopen(path, mode, read_compressions[i]);
+	}
+
+	fp = cfopen(path, mode, 0);
+	for (i = 0; fp == NULL && i < lengthof(read_compressions); i++)
+	{
+		CompressionAlgorithm alg;
+		char	   *fname;
+
+		if (!CompressionSupported(read_compressions[i]))
+			continue;
+
+		ParseCompressionOption(read_compressions[i], &alg, NULL);
+		fname = psprintf("%s%s", path, CompressionSuffix(alg));
+		fp = cfopen(fname, mode, read_compressions[i]);
+		free_keep_errno(fname);
 	}
 	return fp;
 }
@@ -479,9 +1182,10 @@ cfopen_read(const char *path, const char *mode)
  * be a filemode as accepted by fopen() and gzopen() that indicates writing
  * ("w", "wb", "a", or "ab").
  *
- * If 'compression' is non-zero, a gzip compressed stream is opened, and
- * 'compression' indicates the compression level used. The ".gz" suffix
- * is automatically added to 'path' in that case.
+ * If 'compression' is non-zero, a compressed stream is opened, and
+ * 'compression' indicates the method and level used. The suffix for the
+ * method (".gz", ".lz4" or ".zst") is automatically added to 'path' in that
+ * case.
  *
  * On failure, return NULL with an error code in errno.
  */
@@ -494,32 +1198,37 @@ cfopen_write(const char *path, const char *mode, int compression)
 		fp = cfopen(path, mode, 0);
 	else
 	{
-#ifdef HAVE_LIBZ
+		CompressionAlgorithm alg;
 		char	   *fname;
 
-		fname = psprintf("%s.gz", path);
+		ParseCompressionOption(compression, &alg, NULL);
+		if (!CompressionSupported(compression))
+			fatal("not built with %s support", CompressionAlgorithmName(alg));
+
+		fname = psprintf("%s%s", path, CompressionSuffix(alg));
 		fp = cfopen(fname, mode, compression);
 		free_keep_errno(fname);
-#else
-		fatal("not built with zlib support");
-		fp = NULL;				/* keep compiler quiet */
-#endif
 	}
 	return fp;
 }
 
 /*
- * Opens file 'path' in 'mode'. If 'compression' is non-zero, the file
- * is opened with libz gzopen(), otherwise with plain fopen().
+ * Opens file 'path' in 'mode'. If 'compression' is non-zero, the file is
+ * opened with libz gzopen(), or set up for LZ4 or zstd (de)compression,
+ * otherwise it is opened with plain fopen().
  *
  * On failure, return NULL with an error code in errno.
  */
 cfp *
 cfopen(const char *path, const char *mode, int compression)
 {
-	cfp		   *fp = pg_malloc(sizeof(cfp));
+	cfp		   *fp = pg_malloc0(sizeof(cfp));
+	CompressionAlgorithm alg;
+	int			level;
+
+	ParseCompressionOption(compression, &alg, &level);
 
-	if (compression != 0)
+	if (alg == COMPR_ALG_LIBZ)
 	{
 #ifdef HAVE_LIBZ
 		if (compression != Z_DEFAULT_COMPRESSION)
@@ -547,11 +1256,30 @@ cfopen(const char *path, const char *mode, int compression)
 		fatal("not built with zlib support");
 #endif
 	}
-	else
+	else if (alg == COMPR_ALG_LZ4 || alg == COMPR_ALG_ZSTD)
 	{
-#ifdef HAVE_LIBZ
-		fp->compressedfp = NULL;
+		if (!CompressionSupported(compression))
+			fatal("not built with %s support", CompressionAlgorithmName(alg));
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+		fp->rawfp = fopen(path, mode);
+		if (fp->rawfp == NULL)
+		{
+			free_keep_errno(fp);
+			return NULL;
+		}
+
+		if (mode[0] == 'r')
+		{
+			fp->decompressor = CreateStreamDecompressor(alg);
+			fp->inbuf = pg_malloc(LZ4_IN_SIZE);
+			fp->outbuf = pg_malloc(LZ4_OUT_SIZE);
+		}
+		else
+			fp->compressor = CreateStreamCompressor(alg, level);
 #endif
+	}
+	else
+	{
 		fp->uncompressedfp = fopen(path, mode);
 		if (fp->uncompressedfp == NULL)
 		{
@@ -586,6 +1314,21 @@ cfread(void *ptr, int size, cfp *fp)
 		}
 	}
 	else
+#endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	if (fp->decompressor)
+	{
+		ret = 0;
+		while (ret < size && cfp_fill(fp))
+		{
+			size_t		n = Min(size - ret, fp->outlen - fp->outpos);
+
+			memcpy((char *) ptr + ret, fp->outbuf + fp->outpos, n);
+			fp->outpos += n;
+			ret += n;
+		}
+	}
+	else
 #endif
 	{
 		ret = fread(ptr, 1, size, fp->uncompressedfp);
@@ -602,6 +1345,14 @@ cfwrite(const void *ptr, int size, cfp *fp)
 	if (fp->compressedfp)
 		return gzwrite(fp->compressedfp, ptr, size);
 	else
+#endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	if (fp->compressor)
+	{
+		StreamCompress(fp->compressor, ptr, size, cfp_write_raw, fp);
+		return fp->write_failed ? 0 : size;
+	}
+	else
 #endif
 		return fwrite(ptr, 1, size, fp->uncompressedfp);
 }
@@ -624,6 +1375,15 @@ cfgetc(cfp *fp)
 		}
 	}
 	else
+#endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	if (fp->decompressor)
+	{
+		if (!cfp_fill(fp))
+			fatal("could not read from input file: end of file");
+		ret = (unsigned char) fp->outbuf[fp->outpos++];
+	}
+	else
 #endif
 	{
 		ret = fgetc(fp->uncompressedfp);
@@ -641,6 +1401,25 @@ cfgets(cfp *fp, char *buf, int len)
 	if (fp->compressedfp)
 		return gzgets(fp->compressedfp, buf, len);
 	else
+#endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	if (fp->decompressor)
+	{
+		int			i = 0;
+
+		/* same as fgets(): stop after a newline, or when buf is full */
+		while (i < len - 1 && cfp_fill(fp))
+		{
+			buf[i] = fp->outbuf[fp->outpos++];
+			if (buf[i++] == '\n')
+				break;
+		}
+		if (i == 0)
+			return NULL;
+		buf[i] = '\0';
+		return buf;
+	}
+	else
 #endif
 		return fgets(buf, len, fp->uncompressedfp);
 }
@@ -662,6 +1441,22 @@ cfclose(cfp *fp)
 		fp->compressedfp = NULL;
 	}
 	else
+#endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	if (fp->rawfp)
+	{
+		if (fp->compressor)
+			EndStreamCompressor(fp->compressor, cfp_write_raw, fp);
+		if (fp->decompressor)
+			EndStreamDecompressor(fp->decompressor);
+		result = fclose(fp->rawfp);
+		if (fp->write_failed)
+			result = EOF;
+		fp->rawfp = NULL;
+		free(fp->inbuf);
+		free(fp->outbuf);
+	}
+	else
 #endif
 	{
 		result = fclose(fp->uncompressedfp);
@@ -679,6 +1474,11 @@ cfeof(cfp *fp)
 	if (fp->compressedfp)
 		return gzeof(fp->compressedfp);
 	else
+#endif
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+	if (fp->decompressor)
+		return fp->eof && fp->outpos == fp->outlen;
+	else
 #endif
 		return feof(fp->uncompressedfp);
 }
@@ -699,7 +1499,51 @@ get_cfp_error(cfp *fp)
 	return strerror(errno);
 }
 
-#ifdef HAVE_LIBZ
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+/*
+ * Make sure there is decompressed data in fp->outbuf, reading and
+ * decompressing more of the file if needed.  Returns false at the end of
+ * the compressed stream.
+ */
+static bool
+cfp_fill(cfp *fp)
+{
+	while (fp->outpos == fp->outlen)
+	{
+		/* a full buffer means the decompressor may have more output */
+		bool		more_output = (fp->outlen == LZ4_OUT_SIZE);
+
+		if (fp->eof)
+			return false;
+
+		if (fp->inpos == fp->inlen && !more_output)
+		{
+			fp->inlen = fread(fp->inbuf, 1, LZ4_IN_SIZE, fp->rawfp);
+			fp->inpos = 0;
+			/* the stream isn't finished yet, so this is premature EOF */
+			if (fp->inlen == 0)
+				READ_ERROR_EXIT(fp->rawfp);
+		}
+
+		fp->outlen = StreamDecompress(fp->decompressor,
+									  fp->inbuf, fp->inlen, &fp->inpos,
+									  fp->outbuf, LZ4_OUT_SIZE, &fp->eof);
+		fp->outpos = 0;
+	}
+	return true;
+}
+
+/* StreamWriteFunc writing compressed data to a cfp's file */
+static void
+cfp_write_raw(void *arg, const char *buf, size_t len)
+{
+	cfp		   *fp = (cfp *) arg;
+
+	if (!fp->write_failed && fwrite(buf, 1, len, fp->rawfp) != len)
+		fp->write_failed = true;
+}
+#endif
+
 static int
 hasSuffix(const char *filename, const char *suffix)
 {
@@ -713,5 +1557,3 @@ hasSuffix(const char *filename, const char *suffix)
 				  suffix,
 				  suffixlen) == 0;
 }
-
-#endif
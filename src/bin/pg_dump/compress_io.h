@@ -21,12 +21,28 @@
 #define ZLIB_OUT_SIZE	4096
 #define ZLIB_IN_SIZE	4096
 
+/* Buffer sizes used in LZ4 and zstd compression. */
+#define LZ4_IN_SIZE		16384
+#define LZ4_OUT_SIZE	16384
+
 typedef enum
 {
 	COMPR_ALG_NONE,
-	COMPR_ALG_LIBZ
+	COMPR_ALG_LIBZ,
+	COMPR_ALG_LZ4,
+	COMPR_ALG_ZSTD
 } CompressionAlgorithm;
 
+/*
+ * Compression settings are passed around, and stored in the archive header,
+ * as a single int.  -1 is zlib's default level, 0 means no compression, and
+ * 1-9 are zlib levels; archive versions before 1.15 use only those.  LZ4
+ * and zstd are represented as COMPRESSION_LZ4 or COMPRESSION_ZSTD plus the
+ * level, where level 0 selects the library's default.
+ */
+#define COMPRESSION_LZ4		1000
+#define COMPRESSION_ZSTD	2000
+
 /* Prototype for callback function to WriteDataToArchive() */
 typedef void (*WriteFunc) (ArchiveHandle *AH, const char *buf, size_t len);
 
@@ -46,6 +62,14 @@ typedef size_t (*ReadFunc) (ArchiveHandle *AH, char **buf, size_t *buflen);
 /* struct definition appears in compress_io.c */
 typedef struct CompressorState CompressorState;
 
+extern int	ParseCompressionSpec(const char *spec, int *workers);
+extern void ParseCompressionOption(int compression, CompressionAlgorithm *alg,
+								   int *level);
+extern bool CompressionSupported(int compression);
+extern const char *CompressionAlgorithmName(CompressionAlgorithm alg);
+extern const char *CompressionSuffix(CompressionAlgorithm alg);
+extern void SetCompressionWorkers(int workers);
+
 extern CompressorState *AllocateCompressor(int compression, WriteFunc writeF);
 extern void ReadDataFromArchive(ArchiveHandle *AH, int compression,
 								ReadFunc readF);
@@ -129,6 +129,8 @@ typedef struct _restoreOptions
 	int			suppressDumpWarnings;	/* Suppress output of WARNING entries
 										 * to stderr */
 	bool		single_txn;
+	int			maintenance_workers;	/* max_parallel_maintenance_workers
+										 * to use, or -1 for server default */
 
 	bool	   *idWanted;		/* array showing which dump IDs to emit */
 	int			enable_row_security;
@@ -149,6 +151,8 @@ typedef struct _dumpOptions
 	bool		aclsSkip;
 	const char *lockWaitTimeout;
 	int			dump_inserts;	/* 0 = COPY, otherwise rows per INSERT */
+	int			table_chunk_pages;	/* 0 = one TABLE DATA item per table,
+									 * otherwise pages per item */
 
 	/* flags for various command-line long options */
 	int			disable_dollar_quoting;
@@ -31,6 +31,7 @@
 #endif
 
 #include "common/string.h"
+#include "compress_io.h"
 #include "dumputils.h"
 #include "fe_utils/string_utils.h"
 #include "lib/stringinfo.h"
@@ -89,6 +90,7 @@ static void processSearchPathEntry(ArchiveHandle *AH, TocEntry *te);
 static teReqs _tocEntryRequired(TocEntry *te, teSection curSection, ArchiveHandle *AH);
 static RestorePass _tocEntryRestorePass(TocEntry *te);
 static bool _tocEntryIsACL(TocEntry *te);
+static bool copy_can_freeze(ArchiveHandle *AH, TocEntry *te);
 static void _disableTriggersIfNecessary(ArchiveHandle *AH, TocEntry *te);
 static void _enableTriggersIfNecessary(ArchiveHandle *AH, TocEntry *te);
 static void buildTocEntryArrays(ArchiveHandle *AH);
@@ -381,8 +383,7 @@ RestoreArchive(Archive *AHX)
 	/*
 	 * Make sure we won't need (de)compression we haven't got
 	 */
-#ifndef HAVE_LIBZ
-	if (AH->compression != 0 && AH->PrintTocDataPtr != NULL)
+	if (!CompressionSupported(AH->compression) && AH->PrintTocDataPtr != NULL)
 	{
 		for (te = AH->toc->next; te != AH->toc; te = te->next)
 		{
@@ -390,7 +391,6 @@ RestoreArchive(Archive *AHX)
 				fatal("cannot restore from compressed archive (compression not supported in this installation)");
 		}
 	}
-#endif
 
 	/*
 	 * Prepare index arrays, so we can assume we have them throughout restore.
@@ -892,9 +892,12 @@ restore_toc_entry(ArchiveHandle *AH, TocEntry *te, bool is_parallel)
 					 * precede it with a TRUNCATE.  If archiving is not on
 					 * this prevents WAL-logging the COPY.  This obtains a
 					 * speedup similar to that from using single_txn mode in
-					 * non-parallel restores.
+					 * non-parallel restores.  We can't do that if the table's
+					 * data was split into several items, since those would
+					 * truncate each other's rows; only the first item is
+					 * ever marked created, so check it has no successors.
 					 */
-					if (is_parallel && te->created)
+					if (is_parallel && te->created && te->nextDataChunk == NULL)
 					{
 						/*
 						 * Parallel restore is always talking directly to a
@@ -914,11 +917,21 @@ restore_toc_entry(ArchiveHandle *AH, TocEntry *te, bool is_parallel)
 					}
 
 					/*
-					 * If we have a copy statement, use it.
+					 * If we have a copy statement, use it.  When the table
+					 * was created or truncated in the current transaction,
+					 * load it with FREEZE so that the rows don't need to be
+					 * hinted and frozen again by the first vacuum.
 					 */
 					if (te->copyStmt && strlen(te->copyStmt) > 0)
 					{
-						ahprintf(AH, "%s", te->copyStmt);
+						if (((is_parallel && te->nextDataChunk == NULL) ||
+							 ropt->single_txn) &&
+							te->created && copy_can_freeze(AH, te))
+							ahprintf(AH, "%.*s WITH (FREEZE);\n",
+									 (int) (strlen(te->copyStmt) - 2),
+									 te->copyStmt);
+						else
+							ahprintf(AH, "%s", te->copyStmt);
 						AH->outputKind = OUTPUT_COPYDATA;
 					}
 					else
@@ -935,7 +948,7 @@ restore_toc_entry(ArchiveHandle *AH, TocEntry *te, bool is_parallel)
 					AH->outputKind = OUTPUT_SQLCMDS;
 
 					/* close out the transaction started above */
-					if (is_parallel && te->created)
+					if (is_parallel && te->created && te->nextDataChunk == NULL)
 						CommitTransaction(&AH->public);
 
 					_enableTriggersIfNecessary(AH, te);
@@ -971,10 +984,36 @@ NewRestoreOptions(void)
 	opts->format = archUnknown;
 	opts->cparams.promptPassword = TRI_DEFAULT;
 	opts->dumpSections = DUMP_UNSECTIONED;
+	opts->maintenance_workers = -1;
 
 	return opts;
 }
 
+/*
+ * Check whether the COPY statement of a TABLE DATA item may have FREEZE
+ * added to it.  The caller must already know that the table was created or
+ * truncated in the current transaction; we check that the server supports
+ * COPY FREEZE and that the statement loads into the table itself and not,
+ * as with --load-via-partition-root, into some other table.
+ */
+static bool
+copy_can_freeze(ArchiveHandle *AH, TocEntry *te)
+{
+	const char *prefix;
+	size_t		len;
+
+	if (!RestoringToDB(AH) || PQserverVersion(AH->connection) < 90300)
+		return false;
+
+	prefix = fmtQualifiedId(te->namespace, te->tag);
+	len = strlen(te->copyStmt);
+	return (strncmp(te->copyStmt, "COPY ", 5) == 0 &&
+			strncmp(te->copyStmt + 5, prefix, strlen(prefix)) == 0 &&
+			te->copyStmt[5 + strlen(prefix)] == ' ' &&
+			len > 12 &&
+			strcmp(te->copyStmt + len - 12, "FROM stdin;\n") == 0);
+}
+
 static void
 _disableTriggersIfNecessary(ArchiveHandle *AH, TocEntry *te)
 {
@@ -1121,6 +1160,8 @@ PrintTOCSummary(Archive *AHX)
 	OutputContext sav;
 	const char *fmtName;
 	char		stamp_str[64];
+	CompressionAlgorithm alg;
+	int			level;
 
 	sav = SaveOutput(AH);
 	if (ropt->filename)
@@ -1130,10 +1171,17 @@ PrintTOCSummary(Archive *AHX)
 				 localtime(&AH->createDate)) == 0)
 		strcpy(stamp_str, "[unknown]");
 
+	ParseCompressionOption(AH->compression, &alg, &level);
+
 	ahprintf(AH, ";\n; Archive created at %s\n", stamp_str);
-	ahprintf(AH, ";     dbname: %s\n;     TOC Entries: %d\n;     Compression: %d\n",
+	ahprintf(AH, ";     dbname: %s\n;     TOC Entries: %d\n",
 			 sanitize_line(AH->archdbname, false),
-			 AH->tocCount, AH->compression);
+			 AH->tocCount);
+	if (alg == COMPR_ALG_LZ4 || alg == COMPR_ALG_ZSTD)
+		ahprintf(AH, ";     Compression: %s:%d\n",
+				 CompressionAlgorithmName(alg), level);
+	else
+		ahprintf(AH, ";     Compression: %d\n", AH->compression);
 
 	switch (AH->format)
 	{
@@ -1850,7 +1898,20 @@ buildTocEntryArrays(ArchiveHandle *AH)
 			if (tableId <= 0 || tableId > maxDumpId)
 				fatal("bad table dumpId for TABLE DATA item");
 
-			AH->tableDataId[tableId] = te->dumpId;
+			/*
+			 * pg_dump's --table-chunk-pages can split a table's data into
+			 * several TABLE DATA items.  tableDataId then shows the first one
+			 * seen, and the others are chained to it through nextDataChunk.
+			 */
+			if (AH->tableDataId[tableId] != 0)
+			{
+				TocEntry   *first = AH->tocsByDumpId[AH->tableDataId[tableId]];
+
+				te->nextDataChunk = first->nextDataChunk;
+				first->nextDataChunk = te;
+			}
+			else
+				AH->tableDataId[tableId] = te->dumpId;
 		}
 	}
 }
@@ -3146,6 +3207,11 @@ _doSetFixedOutputState(ArchiveHandle *AH)
 	if (!AH->public.std_strings)
 		ahprintf(AH, "SET escape_string_warning = off;\n");
 
+	/* Let large index builds use parallel workers, if requested */
+	if (ropt && ropt->maintenance_workers >= 0)
+		ahprintf(AH, "SET max_parallel_maintenance_workers = %d;\n",
+				 ropt->maintenance_workers);
+
 	/* Adjust row-security state */
 	if (ropt && ropt->enable_row_security)
 		ahprintf(AH, "SET row_security = on;\n");
@@ -3823,10 +3889,8 @@ ReadHead(ArchiveHandle *AH)
 	else
 		AH->compression = Z_DEFAULT_COMPRESSION;
 
-#ifndef HAVE_LIBZ
-	if (AH->compression != 0)
+	if (!CompressionSupported(AH->compression))
 		pg_log_warning("archive is compressed, but this installation does not support compression -- no data will be available");
-#endif
 
 	if (AH->version >= K_VERS_1_4)
 	{
@@ -4601,7 +4665,8 @@ fix_dependencies(ArchiveHandle *AH)
 
 /*
  * Change dependencies on table items to depend on table data items instead,
- * but only in POST_DATA items.
+ * but only in POST_DATA items.  If the table's data is split into several
+ * items, the dependency is replaced by dependencies on all of them.
  *
  * Also, for any item having such dependency(s), set its dataLength to the
  * largest dataLength of the table data items it depends on.  This ensures
@@ -4628,11 +4693,26 @@ repoint_table_dependencies(ArchiveHandle *AH)
 			{
 				DumpId		tabledataid = AH->tableDataId[olddep];
 				TocEntry   *tabledatate = AH->tocsByDumpId[tabledataid];
+				pgoff_t		tablelength = tabledatate->dataLength;
+				TocEntry   *chunkte;
 
 				te->dependencies[i] = tabledataid;
-				te->dataLength = Max(te->dataLength, tabledatate->dataLength);
 				pg_log_debug("transferring dependency %d -> %d to %d",
 							 te->dumpId, olddep, tabledataid);
+
+				for (chunkte = tabledatate->nextDataChunk; chunkte != NULL;
+					 chunkte = chunkte->nextDataChunk)
+				{
+					te->dependencies = (DumpId *)
+						pg_realloc(te->dependencies,
+								   (te->nDeps + 1) * sizeof(DumpId));
+					te->dependencies[te->nDeps++] = chunkte->dumpId;
+					tablelength += chunkte->dataLength;
+					pg_log_debug("adding dependency %d -> %d",
+								 te->dumpId, chunkte->dumpId);
+				}
+
+				te->dataLength = Max(te->dataLength, tablelength);
 			}
 		}
 	}
@@ -4759,7 +4839,7 @@ mark_create_done(ArchiveHandle *AH, TocEntry *te)
 }
 
 /*
- * Mark the DATA member corresponding to the given TABLE member
+ * Mark the DATA member(s) corresponding to the given TABLE member
  * as not wanted
  */
 static void
@@ -4770,9 +4850,11 @@ inhibit_data_for_failed_table(ArchiveHandle *AH, TocEntry *te)
 
 	if (AH->tableDataId[te->dumpId] != 0)
 	{
-		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
+		TocEntry   *ted;
 
-		ted->reqs = 0;
+		for (ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
+			 ted != NULL; ted = ted->nextDataChunk)
+			ted->reqs = 0;
 	}
 }
 
@@ -93,10 +93,12 @@ typedef z_stream *z_streamp;
 #define K_VERS_1_13 MAKE_ARCHIVE_VERSION(1, 13, 0)	/* change search_path
 													 * behavior */
 #define K_VERS_1_14 MAKE_ARCHIVE_VERSION(1, 14, 0)	/* add tableam */
+#define K_VERS_1_15 MAKE_ARCHIVE_VERSION(1, 15, 0)	/* add LZ4 and zstd
+													 * compression */
 
 /* Current archive version number (the format we can output) */
 #define K_VERS_MAJOR 1
-#define K_VERS_MINOR 14
+#define K_VERS_MINOR 15
 #define K_VERS_REV 0
 #define K_VERS_SELF MAKE_ARCHIVE_VERSION(K_VERS_MAJOR, K_VERS_MINOR, K_VERS_REV)
 
@@ -335,7 +337,8 @@ struct _archiveHandle
 	int			compression;	/* Compression requested on open Possible
 								 * values for compression: -1
 								 * Z_DEFAULT_COMPRESSION 0	COMPRESSION_NONE
-								 * 1-9 levels for gzip compression */
+								 * 1-9 levels for gzip compression, or an
+								 * LZ4 or zstd setting (see compress_io.h) */
 	bool		dosync;			/* data requested to be synced on sight */
 	ArchiveMode mode;			/* File mode - r or w */
 	void	   *formatData;		/* Header data specific to file format */
@@ -388,6 +391,7 @@ struct _tocEntry
 	pgoff_t		dataLength;		/* item's data size; 0 if none or unknown */
 	teReqs		reqs;			/* do we need schema and/or data of object */
 	bool		created;		/* set for DATA member if TABLE was created */
+	struct _tocEntry *nextDataChunk;	/* next DATA member of same TABLE */
 
 	/* working state (needed only for parallel restore) */
 	struct _tocEntry *pending_prev; /* list links for pending-items list; */
@@ -7,9 +7,10 @@
  *	Large objects (BLOBs) are stored in separate files named "blob_<uid>.dat",
  *	and there's a plain-text TOC file for them called "blobs.toc". If
  *	compression is used, each data file is individually compressed and the
- *	".gz" suffix is added to the filenames. The TOC files are never
- *	compressed by pg_dump, however they are accepted with the .gz suffix too,
- *	in case the user has manually compressed them with 'gzip'.
+ *	".gz", ".lz4" or ".zst" suffix is added to the filenames. The TOC files
+ *	are never compressed by pg_dump, however they are accepted with those
+ *	suffixes too, in case the user has manually compressed them with 'gzip',
+ *	'lz4' or 'zstd'.
  *
  *	NOTE: This format is identical to the files written in the tar file in
  *	the 'tar' format, except that we don't write the restore.sql file (TODO),
@@ -770,8 +771,13 @@ _PrepParallelRestore(ArchiveHandle *AH)
 		else
 		{
 			/* It might be compressed */
-			strlcat(fname, ".gz", sizeof(fname));
-			if (stat(fname, &st) == 0)
+			CompressionAlgorithm alg;
+			char		cfname[MAXPGPATH];
+
+			ParseCompressionOption(AH->compression, &alg, NULL);
+			snprintf(cfname, sizeof(cfname), "%s%s",
+					 fname, CompressionSuffix(alg));
+			if (stat(cfname, &st) == 0)
 				te->dataLength = st.st_size;
 		}
 
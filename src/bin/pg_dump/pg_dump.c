@@ -54,6 +54,7 @@
 #include "catalog/pg_trigger_d.h"
 #include "catalog/pg_type_d.h"
 #include "common/connect.h"
+#include "compress_io.h"
 #include "dumputils.h"
 #include "fe_utils/string_utils.h"
 #include "getopt_long.h"
@@ -160,6 +161,9 @@ static void expand_table_name_patterns(Archive *fout,
 									   bool strict_names);
 static NamespaceInfo *findNamespace(Oid nsoid);
 static void dumpTableData(Archive *fout, TableDataInfo *tdinfo);
+static void makeTableDataEntry(Archive *fout, TableDataInfo *tdinfo,
+							   DumpId dumpId, const char *copyStmt,
+							   DataDumperPtr dumpFn, BlockNumber dataLength);
 static void refreshMatViewData(Archive *fout, TableDataInfo *tdinfo);
 static void guessConstraintInheritance(TableInfo *tblinfo, int numTables);
 static void dumpComment(Archive *fout, const char *type, const char *name,
@@ -317,8 +321,10 @@ main(int argc, char **argv)
 	const char *dumpsnapshot = NULL;
 	char	   *use_role = NULL;
 	long		rowsPerInsert;
+	long		tableChunkPages;
 	int			numWorkers = 1;
 	int			compressLevel = -1;
+	int			compressWorkers = 0;
 	int			plainText = 0;
 	ArchiveFormat archiveFormat = archUnknown;
 	ArchiveMode archiveMode;
@@ -389,6 +395,7 @@ main(int argc, char **argv)
 		{"on-conflict-do-nothing", no_argument, &dopt.do_nothing, 1},
 		{"rows-per-insert", required_argument, NULL, 10},
 		{"include-foreign-data", required_argument, NULL, 11},
+		{"table-chunk-pages", required_argument, NULL, 12},
 		{"index-collation-versions-unknown", no_argument, &dopt.coll_unknown, 1},
 
 		{NULL, 0, NULL, 0}
@@ -530,13 +537,15 @@ main(int argc, char **argv)
 				dopt.aclsSkip = true;
 				break;
 
-			case 'Z':			/* Compression Level */
-				compressLevel = atoi(optarg);
-				if (compressLevel < 0 || compressLevel > 9)
-				{
-					pg_log_error("compression level must be in range 0..9");
-					exit_nicely(1);
-				}
+			case 'Z':			/* Compression */
+				compressLevel = ParseCompressionSpec(optarg, &compressWorkers);
+
+				/*
+				 * -1 means "not specified" below, so spell out zlib's
+				 * default level if "gzip" was given without one.
+				 */
+				if (compressLevel == Z_DEFAULT_COMPRESSION)
+					compressLevel = 6;
 				break;
 
 			case 0:
@@ -607,6 +616,21 @@ main(int argc, char **argv)
 										  optarg);
 				break;
 
+			case 12:			/* pages per table data chunk */
+				errno = 0;
+				tableChunkPages = strtol(optarg, &endptr, 10);
+
+				if (endptr == optarg || *endptr != '\0' ||
+					tableChunkPages <= 0 || tableChunkPages > INT_MAX ||
+					errno == ERANGE)
+				{
+					pg_log_error("table-chunk-pages must be in range %d..%d",
+								 1, INT_MAX);
+					exit_nicely(1);
+				}
+				dopt.table_chunk_pages = (int) tableChunkPages;
+				break;
+
 			default:
 				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
 				exit_nicely(1);
@@ -670,6 +694,14 @@ main(int argc, char **argv)
 	if (dopt.do_nothing && dopt.dump_inserts == 0)
 		fatal("option --on-conflict-do-nothing requires option --inserts, --rows-per-insert, or --column-inserts");
 
+	/*
+	 * Chunks of one table must all be read with the same snapshot, else a row
+	 * updated in between could be dumped twice or not at all.
+	 */
+	if (dopt.table_chunk_pages > 0 && numWorkers > 1 &&
+		dopt.no_synchronized_snapshots)
+		fatal("option --table-chunk-pages cannot be used with --no-synchronized-snapshots");
+
 	/* Identify archive format to emit */
 	archiveFormat = parseArchiveFormat(format, &archiveMode);
 
@@ -688,11 +720,28 @@ main(int argc, char **argv)
 			compressLevel = 0;
 	}
 
-#ifndef HAVE_LIBZ
-	if (compressLevel != 0)
+	/*
+	 * LZ4 and zstd were already checked by ParseCompressionSpec, so this can
+	 * only be a zlib level in an installation without zlib.
+	 */
+	if (!CompressionSupported(compressLevel))
+	{
 		pg_log_warning("requested compression not available in this installation -- archive will be uncompressed");
-	compressLevel = 0;
-#endif
+		compressLevel = 0;
+	}
+
+	/* Plain-text output is compressed with gzopen(), so only gzip works */
+	if (plainText && compressLevel != 0)
+	{
+		CompressionAlgorithm alg;
+
+		ParseCompressionOption(compressLevel, &alg, NULL);
+		if (alg != COMPR_ALG_LIBZ)
+			fatal("compression method \"%s\" is not supported for plain-text output",
+				  CompressionAlgorithmName(alg));
+	}
+
+	SetCompressionWorkers(compressWorkers);
 
 	/*
 	 * If emitting an archive format, we always want to emit a DATABASE item,
@@ -782,6 +831,16 @@ main(int argc, char **argv)
 	if (dumpsnapshot && fout->remoteVersion < 90200)
 		fatal("Exported snapshots are not supported by this server version.");
 
+	/*
+	 * Older servers can't scan a ctid range without reading the whole table,
+	 * so splitting tables into chunks would only multiply the work.
+	 */
+	if (dopt.table_chunk_pages > 0 && fout->remoteVersion < 140000)
+	{
+		pg_log_warning("option --table-chunk-pages is ignored for server versions before 14");
+		dopt.table_chunk_pages = 0;
+	}
+
 	/*
 	 * Find the last built-in OID, if needed (prior to 8.1)
 	 *
@@ -1006,7 +1065,8 @@ help(const char *progname)
 	printf(_("  -j, --jobs=NUM               use this many parallel jobs to dump\n"));
 	printf(_("  -v, --verbose                verbose mode\n"));
 	printf(_("  -V, --version                output version information, then exit\n"));
-	printf(_("  -Z, --compress=0-9           compression level for compressed formats\n"));
+	printf(_("  -Z, --compress=METHOD[:DETAIL]\n"
+			 "                               compress as specified, or 0-9 for gzip level\n"));
 	printf(_("  --lock-wait-timeout=TIMEOUT  fail after waiting TIMEOUT for a table lock\n"));
 	printf(_("  --no-sync                    do not wait for changes to be written safely to disk\n"));
 	printf(_("  -?, --help                   show this help, then exit\n"));
@@ -1056,6 +1116,8 @@ help(const char *progname)
 	printf(_("  --snapshot=SNAPSHOT          use given snapshot for the dump\n"));
 	printf(_("  --strict-names               require table and/or schema include patterns to\n"
 			 "                               match at least one entity each\n"));
+	printf(_("  --table-chunk-pages=NPAGES   dump data of larger tables in chunks of NPAGES\n"
+			 "                               pages each\n"));
 	printf(_("  --use-set-session-authorization\n"
 			 "                               use SET SESSION AUTHORIZATION commands instead of\n"
 			 "                               ALTER OWNER commands to set ownership\n"));
@@ -2304,43 +2366,106 @@ dumpTableData(Archive *fout, TableDataInfo *tdinfo)
 		copyStmt = NULL;
 	}
 
-	/*
-	 * Note: although the TableDataInfo is a full DumpableObject, we treat its
-	 * dependency on its table as "special" and pass it to ArchiveEntry now.
-	 * See comments for BuildArchiveDependencies.
-	 */
 	if (tdinfo->dobj.dump & DUMP_COMPONENT_DATA)
 	{
-		TocEntry   *te;
-
-		te = ArchiveEntry(fout, tdinfo->dobj.catId, tdinfo->dobj.dumpId,
-						  ARCHIVE_OPTS(.tag = tbinfo->dobj.name,
-									   .namespace = tbinfo->dobj.namespace->dobj.name,
-									   .owner = tbinfo->rolname,
-									   .description = "TABLE DATA",
-									   .section = SECTION_DATA,
-									   .copyStmt = copyStmt,
-									   .deps = &(tbinfo->dobj.dumpId),
-									   .nDeps = 1,
-									   .dumpFn = dumpFn,
-									   .dumpArg = tdinfo));
+		/*
+		 * relpages is declared as "integer" in pg_class, and hence also in
+		 * TableInfo, but it's really BlockNumber a/k/a unsigned int.  Cast so
+		 * that we get the right interpretation of table sizes exceeding
+		 * INT_MAX pages.
+		 */
+		BlockNumber relpages = (BlockNumber) tbinfo->relpages;
+		BlockNumber chunkpages = (BlockNumber) dopt->table_chunk_pages;
 
 		/*
-		 * Set the TocEntry's dataLength in case we are doing a parallel dump
-		 * and want to order dump jobs by table size.  We choose to measure
-		 * dataLength in table pages during dump, so no scaling is needed.
-		 * However, relpages is declared as "integer" in pg_class, and hence
-		 * also in TableInfo, but it's really BlockNumber a/k/a unsigned int.
-		 * Cast so that we get the right interpretation of table sizes
-		 * exceeding INT_MAX pages.
+		 * If requested, split the data of a large plain table into several
+		 * TABLE DATA items, each covering a range of ctids, so that parallel
+		 * dump and restore can work on them at the same time.  The last chunk
+		 * has no upper bound, so that pages added since relpages was last
+		 * updated are still dumped.  The first chunk keeps the dump ID of the
+		 * TableDataInfo; the others don't participate in sorting and just get
+		 * fresh IDs.
 		 */
-		te->dataLength = (BlockNumber) tbinfo->relpages;
+		if (chunkpages > 0 && relpages > chunkpages &&
+			tbinfo->relkind == RELKIND_RELATION &&
+			tdinfo->filtercond == NULL)
+		{
+			BlockNumber startblk = 0;
+
+			for (;;)
+			{
+				TableDataInfo *chunk;
+				bool		last = (relpages - startblk <= chunkpages);
+
+				chunk = (TableDataInfo *) pg_malloc(sizeof(TableDataInfo));
+				memcpy(chunk, tdinfo, sizeof(TableDataInfo));
+				if (last)
+					chunk->filtercond = psprintf("WHERE ctid >= '(%u,0)'",
+												 startblk);
+				else
+					chunk->filtercond = psprintf("WHERE ctid >= '(%u,0)' AND ctid < '(%u,0)'",
+												 startblk,
+												 startblk + chunkpages);
+
+				makeTableDataEntry(fout, chunk,
+								   startblk == 0 ?
+								   tdinfo->dobj.dumpId : createDumpId(),
+								   copyStmt, dumpFn,
+								   last ? relpages - startblk : chunkpages);
+
+				if (last)
+					break;
+				startblk += chunkpages;
+			}
+		}
+		else
+			makeTableDataEntry(fout, tdinfo, tdinfo->dobj.dumpId,
+							   copyStmt, dumpFn, relpages);
 	}
 
 	destroyPQExpBuffer(copyBuf);
 	destroyPQExpBuffer(clistBuf);
 }
 
+/*
+ * makeTableDataEntry -
+ *	  make the ArchiveEntry for (a chunk of) a table's contents
+ *
+ * dataLength is the number of table pages covered by the entry.
+ */
+static void
+makeTableDataEntry(Archive *fout, TableDataInfo *tdinfo, DumpId dumpId,
+				   const char *copyStmt, DataDumperPtr dumpFn,
+				   BlockNumber dataLength)
+{
+	TableInfo  *tbinfo = tdinfo->tdtable;
+	TocEntry   *te;
+
+	/*
+	 * Note: although the TableDataInfo is a full DumpableObject, we treat its
+	 * dependency on its table as "special" and pass it to ArchiveEntry now.
+	 * See comments for BuildArchiveDependencies.
+	 */
+	te = ArchiveEntry(fout, tdinfo->dobj.catId, dumpId,
+					  ARCHIVE_OPTS(.tag = tbinfo->dobj.name,
+								   .namespace = tbinfo->dobj.namespace->dobj.name,
+								   .owner = tbinfo->rolname,
+								   .description = "TABLE DATA",
+								   .section = SECTION_DATA,
+								   .copyStmt = copyStmt,
+								   .deps = &(tbinfo->dobj.dumpId),
+								   .nDeps = 1,
+								   .dumpFn = dumpFn,
+								   .dumpArg = tdinfo));
+
+	/*
+	 * Set the TocEntry's dataLength in case we are doing a parallel dump and
+	 * want to order dump jobs by table size.  We choose to measure dataLength
+	 * in table pages during dump, so no scaling is needed.
+	 */
+	te->dataLength = dataLength;
+}
+
 /*
  * refreshMatViewData -
  *	  load or refresh the contents of a single materialized view
@@ -2427,6 +2552,10 @@ makeTableDataInfo(DumpOptions *dopt, TableInfo *tbinfo)
 	if (tbinfo->relkind == RELKIND_PARTITIONED_TABLE)
 		return;
 
+	/* Skip global temporary tables (data is private to each session) */
+	if (tbinfo->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+		return;
+
 	/* Don't dump data in unlogged tables, if so requested */
 	if (tbinfo->relpersistence == RELPERSISTENCE_UNLOGGED &&
 		dopt->no_unlogged_table_data)
@@ -4071,6 +4200,7 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 	int			i_tableoid;
 	int			i_oid;
 	int			i_pubname;
+	int			i_prrelqual;
 	int			i,
 				j,
 				ntups;
@@ -4105,8 +4235,15 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 		resetPQExpBuffer(query);
 
 		/* Get the publication membership for the table. */
+		appendPQExpBufferStr(query,
+							 "SELECT pr.tableoid, pr.oid, p.pubname, ");
+		if (fout->remoteVersion >= 140000)
+			appendPQExpBufferStr(query,
+								 "pg_catalog.pg_get_expr(pr.prqual, pr.prrelid) AS prrelqual ");
+		else
+			appendPQExpBufferStr(query,
+								 "NULL AS prrelqual ");
 		appendPQExpBuffer(query,
-						  "SELECT pr.tableoid, pr.oid, p.pubname "
 						  "FROM pg_publication_rel pr, pg_publication p "
 						  "WHERE pr.prrelid = '%u'"
 						  "  AND p.oid = pr.prpubid",
@@ -4127,6 +4264,7 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 		i_tableoid = PQfnumber(res, "tableoid");
 		i_oid = PQfnumber(res, "oid");
 		i_pubname = PQfnumber(res, "pubname");
+		i_prrelqual = PQfnumber(res, "prrelqual");
 
 		pubrinfo = pg_malloc(ntups * sizeof(PublicationRelInfo));
 
@@ -4141,6 +4279,10 @@ getPublicationTables(Archive *fout, TableInfo tblinfo[], int numTables)
 			pubrinfo[j].dobj.name = tbinfo->dobj.name;
 			pubrinfo[j].pubname = pg_strdup(PQgetvalue(res, j, i_pubname));
 			pubrinfo[j].pubtable = tbinfo;
+			if (PQgetisnull(res, j, i_prrelqual))
+				pubrinfo[j].pubrelqual = NULL;
+			else
+				pubrinfo[j].pubrelqual = pg_strdup(PQgetvalue(res, j, i_prrelqual));
 
 			/* Decide whether we want to dump it */
 			selectDumpablePublicationTable(&(pubrinfo[j].dobj), fout);
@@ -4170,8 +4312,11 @@ dumpPublicationTable(Archive *fout, PublicationRelInfo *pubrinfo)
 
 	appendPQExpBuffer(query, "ALTER PUBLICATION %s ADD TABLE ONLY",
 					  fmtId(pubrinfo->pubname));
-	appendPQExpBuffer(query, " %s;\n",
+	appendPQExpBuffer(query, " %s",
 					  fmtQualifiedDumpable(tbinfo));
+	if (pubrinfo->pubrelqual)
+		appendPQExpBuffer(query, " WHERE (%s)", pubrinfo->pubrelqual);
+	appendPQExpBufferStr(query, ";\n");
 
 	/*
 	 * There is no point in creating drop query as the drop is done by table
@@ -8638,6 +8783,13 @@ getTableAttrs(Archive *fout, TableInfo *tblinfo, int numTables)
 			appendPQExpBufferStr(q,
 								 "NULL AS attmissingval,\n");
 
+		if (fout->remoteVersion >= 140000)
+			appendPQExpBufferStr(q,
+								 "a.attcompression AS attcompression,\n");
+		else
+			appendPQExpBufferStr(q,
+								 "'' AS attcompression,\n");
+
 		if (fout->remoteVersion >= 120000)
 			appendPQExpBufferStr(q,
 								 "a.attgenerated\n");
@@ -8665,6 +8817,7 @@ getTableAttrs(Archive *fout, TableInfo *tblinfo, int numTables)
 		tbinfo->attstattarget = (int *) pg_malloc(ntups * sizeof(int));
 		tbinfo->attstorage = (char *) pg_malloc(ntups * sizeof(char));
 		tbinfo->typstorage = (char *) pg_malloc(ntups * sizeof(char));
+		tbinfo->attcompression = (char *) pg_malloc(ntups * sizeof(char));
 		tbinfo->attidentity = (char *) pg_malloc(ntups * sizeof(char));
 		tbinfo->attgenerated = (char *) pg_malloc(ntups * sizeof(char));
 		tbinfo->attisdropped = (bool *) pg_malloc(ntups * sizeof(bool));
@@ -8691,6 +8844,7 @@ getTableAttrs(Archive *fout, TableInfo *tblinfo, int numTables)
 			tbinfo->attstattarget[j] = atoi(PQgetvalue(res, j, PQfnumber(res, "attstattarget")));
 			tbinfo->attstorage[j] = *(PQgetvalue(res, j, PQfnumber(res, "attstorage")));
 			tbinfo->typstorage[j] = *(PQgetvalue(res, j, PQfnumber(res, "typstorage")));
+			tbinfo->attcompression[j] = *(PQgetvalue(res, j, PQfnumber(res, "attcompression")));
 			tbinfo->attidentity[j] = *(PQgetvalue(res, j, PQfnumber(res, "attidentity")));
 			tbinfo->attgenerated[j] = *(PQgetvalue(res, j, PQfnumber(res, "attgenerated")));
 			tbinfo->needs_override = tbinfo->needs_override || (tbinfo->attidentity[j] == ATTRIBUTE_IDENTITY_ALWAYS);
@@ -15673,7 +15827,9 @@ dumpTableSchema(Archive *fout, TableInfo *tbinfo)
 
 		appendPQExpBuffer(q, "CREATE %s%s %s",
 						  tbinfo->relpersistence == RELPERSISTENCE_UNLOGGED ?
-						  "UNLOGGED " : "",
+						  "UNLOGGED " :
+						  tbinfo->relpersistence == RELPERSISTENCE_GLOBAL_TEMP ?
+						  "GLOBAL TEMPORARY " : "",
 						  reltypename,
 						  qualrelname);
 
@@ -16177,6 +16333,36 @@ dumpTableSchema(Archive *fout, TableInfo *tbinfo)
 									  storage);
 			}
 
+			/*
+			 * Dump per-column compression, if it's been set.
+			 */
+			if (tbinfo->relkind != RELKIND_FOREIGN_TABLE)
+			{
+				const char *cmname;
+
+				switch (tbinfo->attcompression[j])
+				{
+					case 'p':
+						cmname = "pglz";
+						break;
+					case 'l':
+						cmname = "lz4";
+						break;
+					case 'z':
+						cmname = "zstd";
+						break;
+					default:
+						cmname = NULL;
+						break;
+				}
+
+				if (cmname != NULL)
+					appendPQExpBuffer(q, "ALTER %sTABLE ONLY %s ALTER COLUMN %s SET COMPRESSION %s;\n",
+									  foreign, qualrelname,
+									  fmtId(tbinfo->attnames[j]),
+									  cmname);
+			}
+
 			/*
 			 * Dump per-column attributes.
 			 */
@@ -306,6 +306,7 @@ typedef struct _tableInfo
 	int		   *attstattarget;	/* attribute statistics targets */
 	char	   *attstorage;		/* attribute storage scheme */
 	char	   *typstorage;		/* type storage scheme */
+	char	   *attcompression; /* per-attribute compression method */
 	bool	   *attisdropped;	/* true if attr is dropped; don't dump it */
 	char	   *attidentity;
 	char	   *attgenerated;
@@ -616,6 +617,7 @@ typedef struct _PublicationRelInfo
 	DumpableObject dobj;
 	TableInfo  *pubtable;
 	char	   *pubname;
+	char	   *pubrelqual;		/* row filter, or NULL */
 } PublicationRelInfo;
 
 /*
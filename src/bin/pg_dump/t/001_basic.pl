@@ -4,7 +4,7 @@ use warnings;
 use Config;
 use PostgresNode;
 use TestLib;
-use Test::More tests => 82;
+use Test::More tests => 93;
 
 my $tempdir       = TestLib::tempdir;
 my $tempdir_short = TestLib::tempdir_short;
@@ -118,11 +118,31 @@ command_fails_like(
 	qr/\Qpg_restore: error: cannot specify both --single-transaction and multiple jobs\E/,
 	'pg_restore: cannot specify both --single-transaction and multiple jobs');
 
+command_fails_like(
+	[ 'pg_restore', '--maintenance-workers', '-1', '-f -' ],
+	qr/\Qpg_restore: error: maintenance-workers must be in range 0..1024\E/,
+	'pg_restore: maintenance-workers must be in range 0..1024');
+
 command_fails_like(
 	[ 'pg_dump', '-Z', '-1' ],
 	qr/\Qpg_dump: error: compression level must be in range 0..9\E/,
 	'pg_dump: compression level must be in range 0..9');
 
+command_fails_like(
+	[ 'pg_dump', '-Z', 'bzip2' ],
+	qr/\Qpg_dump: error: unrecognized compression method "bzip2"\E/,
+	'pg_dump: unrecognized compression method');
+
+command_fails_like(
+	[ 'pg_dump', '-Z', 'gzip:10' ],
+	qr/\Qpg_dump: error: compression level for method "gzip" must be in range 0..9\E/,
+	'pg_dump: compression level for gzip must be in range 0..9');
+
+command_fails_like(
+	[ 'pg_dump', '-Z', 'gzip:workers=2' ],
+	qr/\Qpg_dump: error: compression method "gzip" does not support workers\E/,
+	'pg_dump: only zstd supports compression workers');
+
 command_fails_like(
 	[ 'pg_dump', '--extra-float-digits', '-16' ],
 	qr/\Qpg_dump: error: extra_float_digits must be in range -15..3\E/,
@@ -133,6 +153,20 @@ command_fails_like(
 	qr/\Qpg_dump: error: rows-per-insert must be in range 1..2147483647\E/,
 	'pg_dump: rows-per-insert must be in range 1..2147483647');
 
+command_fails_like(
+	[ 'pg_dump', '--table-chunk-pages', '0' ],
+	qr/\Qpg_dump: error: table-chunk-pages must be in range 1..2147483647\E/,
+	'pg_dump: table-chunk-pages must be in range 1..2147483647');
+
+command_fails_like(
+	[
+		'pg_dump', '-j2', '-Fd', '-f', 'dump',
+		'--no-synchronized-snapshots', '--table-chunk-pages', '10'
+	],
+	qr/\Qpg_dump: error: option --table-chunk-pages cannot be used with --no-synchronized-snapshots\E/,
+	'pg_dump: --table-chunk-pages cannot be used with --no-synchronized-snapshots'
+);
+
 command_fails_like(
 	[ 'pg_restore', '--if-exists', '-f -' ],
 	qr/\Qpg_restore: error: option --if-exists requires option -c\/--clean\E/,
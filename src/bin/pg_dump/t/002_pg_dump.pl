@@ -31,6 +31,13 @@ my $tempdir_short = TestLib::tempdir_short;
 # generate a text file to run through the tests from the
 # non-text file generated by pg_dump.
 #
+# compile_option indicates if the run depends on a compression
+# method ('lz4' or 'zstd') that the build may not support; such
+# runs are skipped if it isn't available.
+#
+# glob_pattern is a pattern that must match at least one file
+# written by the run, to check that its output was compressed.
+#
 # TODO: Have pg_restore actually restore to an independent
 # database and then pg_dump *that* database (or something along
 # those lines) to validate that part of the process.
@@ -80,6 +87,78 @@ my %pgdump_runs = (
 			'--column-inserts',                   'postgres',
 		],
 	},
+	compression_lz4_custom => {
+		test_key       => 'defaults',
+		compile_option => 'lz4',
+		dump_cmd       => [
+			'pg_dump',
+			'--no-sync',
+			'--format=custom',
+			'--compress=lz4',
+			"--file=$tempdir/compression_lz4_custom.dump",
+			'postgres',
+		],
+		restore_cmd => [
+			'pg_restore',
+			"--file=$tempdir/compression_lz4_custom.sql",
+			"$tempdir/compression_lz4_custom.dump",
+		],
+	},
+	compression_lz4_dir => {
+		test_key       => 'defaults',
+		compile_option => 'lz4',
+		glob_pattern   => "$tempdir/compression_lz4_dir/*.dat.lz4",
+		dump_cmd       => [
+			'pg_dump',
+			'--no-sync',
+			'--format=directory',
+			'--compress=lz4:level=1',
+			'--jobs=2',
+			"--file=$tempdir/compression_lz4_dir",
+			'postgres',
+		],
+		restore_cmd => [
+			'pg_restore',
+			"--file=$tempdir/compression_lz4_dir.sql",
+			"$tempdir/compression_lz4_dir",
+		],
+	},
+	compression_zstd_custom => {
+		test_key       => 'defaults',
+		compile_option => 'zstd',
+		dump_cmd       => [
+			'pg_dump',
+			'--no-sync',
+			'--format=custom',
+			'--compress=zstd',
+			"--file=$tempdir/compression_zstd_custom.dump",
+			'postgres',
+		],
+		restore_cmd => [
+			'pg_restore',
+			"--file=$tempdir/compression_zstd_custom.sql",
+			"$tempdir/compression_zstd_custom.dump",
+		],
+	},
+	compression_zstd_dir => {
+		test_key       => 'defaults',
+		compile_option => 'zstd',
+		glob_pattern   => "$tempdir/compression_zstd_dir/*.dat.zst",
+		dump_cmd       => [
+			'pg_dump',
+			'--no-sync',
+			'--format=directory',
+			'--compress=zstd:level=5',
+			'--jobs=2',
+			"--file=$tempdir/compression_zstd_dir",
+			'postgres',
+		],
+		restore_cmd => [
+			'pg_restore',
+			"--file=$tempdir/compression_zstd_dir.sql",
+			"$tempdir/compression_zstd_dir",
+		],
+	},
 	createdb => {
 		dump_cmd => [
 			'pg_dump',
@@ -3328,6 +3407,12 @@ if ($collation_check_stderr !~ /ERROR: /)
 	$collation_support = 1;
 }
 
+# Find out which of the optional compression methods the build supports.
+# Runs that need one that isn't available are skipped.
+my %supports = (
+	lz4  => check_pg_config("#define USE_LZ4 1"),
+	zstd => check_pg_config("#define USE_ZSTD 1"));
+
 # Create a second database for certain tests to work against
 $node->psql('postgres', 'create database regress_pg_dump_test;');
 
@@ -3335,11 +3420,21 @@ $node->psql('postgres', 'create database regress_pg_dump_test;');
 # command_fails_like is actually 2 tests)
 my $num_tests = 12;
 
+# The tar format is checked to reject each supported compression method
+$num_tests += 2 * grep { $supports{$_} } keys %supports;
+
 foreach my $run (sort keys %pgdump_runs)
 {
 	my $test_key = $run;
 	my $run_db   = 'postgres';
 
+	# Skip runs that need a compression method the build lacks
+	if (defined($pgdump_runs{$run}->{compile_option})
+		&& !$supports{ $pgdump_runs{$run}->{compile_option} })
+	{
+		next;
+	}
+
 	if (defined($pgdump_runs{$run}->{database}))
 	{
 		$run_db = $pgdump_runs{$run}->{database};
@@ -3354,6 +3449,12 @@ foreach my $run (sort keys %pgdump_runs)
 		$num_tests++;
 	}
 
+	# Checking for compressed output is one more
+	if ($pgdump_runs{$run}->{glob_pattern})
+	{
+		$num_tests++;
+	}
+
 	if ($pgdump_runs{$run}->{test_key})
 	{
 		$test_key = $pgdump_runs{$run}->{test_key};
@@ -3492,6 +3593,22 @@ command_fails_like(
 	qr/\Qpg_dump: error: no matching tables were found for pattern\E/,
 	'no matching tables');
 
+#########################################
+# Test that the tar format rejects compression
+
+foreach my $method (sort keys %supports)
+{
+	next if !$supports{$method};
+
+	command_fails_like(
+		[
+			'pg_dump', '-p', "$port", '--format=tar', "--compress=$method",
+			"--file=$tempdir/compression_${method}_tar.tar", 'postgres'
+		],
+		qr/\Qpg_dump: error: compression is not supported by tar archive format\E/,
+		"tar format rejects $method compression");
+}
+
 #########################################
 # Run all runs
 
@@ -3500,9 +3617,22 @@ foreach my $run (sort keys %pgdump_runs)
 	my $test_key = $run;
 	my $run_db   = 'postgres';
 
+	if (defined($pgdump_runs{$run}->{compile_option})
+		&& !$supports{ $pgdump_runs{$run}->{compile_option} })
+	{
+		note "$run: skipped due to no $pgdump_runs{$run}->{compile_option} support";
+		next;
+	}
+
 	$node->command_ok(\@{ $pgdump_runs{$run}->{dump_cmd} },
 		"$run: pg_dump runs");
 
+	if ($pgdump_runs{$run}->{glob_pattern})
+	{
+		my @files = glob($pgdump_runs{$run}->{glob_pattern});
+		ok(@files > 0, "$run: pg_dump writes compressed files");
+	}
+
 	if ($pgdump_runs{$run}->{restore_cmd})
 	{
 		$node->command_ok(\@{ $pgdump_runs{$run}->{restore_cmd} },
@@ -0,0 +1,93 @@
+use strict;
+use warnings;
+
+use PostgresNode;
+use TestLib;
+use Test::More tests => 8;
+
+my $tempdir = TestLib::tempdir;
+
+my $node = get_new_node('main');
+my $port = $node->port;
+
+$node->init;
+# keep relpages as set by the VACUUM below
+$node->append_conf('postgresql.conf', 'autovacuum = off');
+$node->start;
+
+#########################################
+# Dump a table in ctid-range chunks with parallel pg_dump, restore it with
+# parallel pg_restore, and check that nothing was lost on the way.
+
+$node->safe_psql(
+	'postgres', q{
+	CREATE TABLE big (id int PRIMARY KEY, payload text);
+	INSERT INTO big SELECT i, md5(i::text) FROM generate_series(1, 10000) i;
+	CREATE INDEX big_payload_idx ON big (payload);
+	CREATE TABLE ref (big_id int REFERENCES big);
+	INSERT INTO ref SELECT i FROM generate_series(1, 10000, 7) i;
+	VACUUM big;
+	-- rows beyond relpages must be picked up by the last chunk
+	INSERT INTO big SELECT i, md5(i::text) FROM generate_series(10001, 12000) i;
+});
+
+my $chunks = $node->safe_psql('postgres',
+	"SELECT ceil(relpages / 10.0) FROM pg_class WHERE relname = 'big'");
+cmp_ok($chunks, '>', 1, 'table is larger than one chunk');
+
+command_ok(
+	[
+		'pg_dump', '-p', $port, '-Fd', '-j2', '--table-chunk-pages=10',
+		'-f', "$tempdir/chunked", 'postgres'
+	],
+	'parallel dump with --table-chunk-pages');
+
+my ($stdout, $stderr) =
+  run_command([ 'pg_restore', '-l', "$tempdir/chunked" ]);
+my $ndata = () = $stdout =~ /TABLE DATA public big /g;
+is($ndata, $chunks, 'table data is split into chunks');
+
+$node->safe_psql('postgres', 'CREATE DATABASE restored');
+
+# Keep the verbose output to look at the order in which the items ran
+my $result = IPC::Run::run(
+	[
+		'pg_restore', '-p', $port, '-j2', '-v', '-d', 'restored',
+		"$tempdir/chunked"
+	],
+	'>', \$stdout, '2>', \$stderr);
+ok($result, 'parallel restore of chunked dump');
+
+my @lines = split /\n/, $stderr;
+my ($last_chunk, $first_dependent, $nfinished);
+for my $i (0 .. $#lines)
+{
+	if ($lines[$i] =~ /finished item \d+ TABLE DATA big$/)
+	{
+		$last_chunk = $i;
+		$nfinished++;
+	}
+	if (!defined $first_dependent
+		&& $lines[$i] =~
+		/launching item \d+ (INDEX big_payload_idx|CONSTRAINT big big_pkey|FK CONSTRAINT ref ref_big_id_fkey)$/
+	  )
+	{
+		$first_dependent = $i;
+	}
+}
+is($nfinished, $chunks, 'all chunks were restored');
+ok( defined $last_chunk
+	  && defined $first_dependent
+	  && $last_chunk < $first_dependent,
+	'indexes and constraints on the table wait for all of its chunks');
+
+my $query =
+  "SELECT count(*), md5(string_agg(id || ':' || payload, ',' ORDER BY id)) FROM big";
+my $expected = $node->safe_psql('postgres', $query);
+is($node->safe_psql('restored', $query),
+	$expected, 'restored table has the same contents');
+is( $node->safe_psql(
+		'restored',
+		"SELECT count(*) FROM ref JOIN big ON big.id = ref.big_id"),
+	'1429',
+	'foreign key table is restored');
@@ -12,10 +12,14 @@
 #include <time.h>
 #include <unistd.h>
 #include <signal.h>
+#ifndef WIN32
+#include <sys/wait.h>
+#endif
 
 #include "access/xlogdefs.h"
 #include "common/logging.h"
 #include "getopt_long.h"
+#include "port/pg_iovec.h"
 
 /*
  * put the temp files in the local directory
@@ -81,6 +85,11 @@ static void test_sync(int writes_per_op);
 static void test_open_syncs(void);
 static void test_open_sync(const char *msg, int writes_size);
 static void test_file_descriptor_sync(void);
+static void test_write_sizes(void);
+static void test_direct_io(void);
+static void test_vectored_writes(void);
+static void test_concurrent_writers(void);
+static int	sync_data(int fd);
 
 #ifndef WIN32
 static void process_alarm(int sig);
@@ -129,6 +138,14 @@ main(int argc, char *argv[])
 
 	test_open_syncs();
 
+	test_write_sizes();
+
+	test_direct_io();
+
+	test_vectored_writes();
+
+	test_concurrent_writers();
+
 	test_file_descriptor_sync();
 
 	test_non_sync();
@@ -471,6 +488,281 @@ test_open_sync(const char *msg, int writes_size)
 #endif
 }
 
+/*
+ * Flush a file's data with the best method available, like the default
+ * wal_sync_method does on most platforms.
+ */
+static int
+sync_data(int fd)
+{
+#ifdef HAVE_FDATASYNC
+	return fdatasync(fd);
+#else
+	return fsync(fd);
+#endif
+}
+
+/*
+ * Test the cost of flushing different amounts of data at once.  This is what
+ * happens when a commit has to write out all WAL inserted since the last
+ * flush; how much that is depends on commit concurrency and wal_buffers.
+ */
+static void
+test_write_sizes(void)
+{
+	static const int sizes[] = {8, 32, 128, 512, 2048};
+
+	printf(_("\nCompare data sync of different write sizes:\n"));
+	printf(_("(This is designed to compare the cost of flushing different amounts of WAL\n"
+			 "at once, as after commits of different sizes or concurrency.)\n"));
+
+	for (int i = 0; i < lengthof(sizes); i++)
+	{
+		char		label[64];
+		int			tmpfile,
+					ops;
+
+		snprintf(label, sizeof(label), _("%4dkB write + data sync"), sizes[i]);
+		printf(LABEL_FORMAT, label);
+		fflush(stdout);
+
+		if ((tmpfile = open(filename, O_RDWR | PG_BINARY, 0)) == -1)
+			die("could not open output file");
+		START_TIMER;
+		for (ops = 0; alarm_triggered == false; ops++)
+		{
+			if (write(tmpfile, buf, sizes[i] * 1024) != sizes[i] * 1024)
+				die("write failed");
+			if (sync_data(tmpfile) != 0)
+				die("fsync failed");
+			if (lseek(tmpfile, 0, SEEK_SET) == -1)
+				die("seek failed");
+		}
+		STOP_TIMER;
+		close(tmpfile);
+	}
+}
+
+/*
+ * Compare buffered and direct writes, each followed by a data sync, as used
+ * for WAL without and with io_direct.
+ */
+static void
+test_direct_io(void)
+{
+	int			tmpfile,
+				ops;
+
+	printf(_("\nCompare buffered and direct I/O, %dkB write + data sync:\n"),
+		   XLOG_BLCKSZ_K);
+	printf(_("(This is designed to compare WAL writes with io_direct off and on.)\n"));
+
+	printf(LABEL_FORMAT, _("buffered"));
+	fflush(stdout);
+
+	if ((tmpfile = open(filename, O_RDWR | PG_BINARY, 0)) == -1)
+		die("could not open output file");
+	START_TIMER;
+	for (ops = 0; alarm_triggered == false; ops++)
+	{
+		if (write(tmpfile, buf, XLOG_BLCKSZ) != XLOG_BLCKSZ)
+			die("write failed");
+		if (sync_data(tmpfile) != 0)
+			die("fsync failed");
+		if (lseek(tmpfile, 0, SEEK_SET) == -1)
+			die("seek failed");
+	}
+	STOP_TIMER;
+	close(tmpfile);
+
+	printf(LABEL_FORMAT, _("direct"));
+	fflush(stdout);
+
+#if PG_O_DIRECT != 0
+	if ((tmpfile = open(filename, O_RDWR | PG_O_DIRECT | PG_BINARY, 0)) == -1)
+		printf(NA_FORMAT, _("n/a*"));
+	else
+	{
+		START_TIMER;
+		for (ops = 0; alarm_triggered == false; ops++)
+		{
+			if (write(tmpfile, buf, XLOG_BLCKSZ) != XLOG_BLCKSZ)
+				die("write failed");
+			if (sync_data(tmpfile) != 0)
+				die("fsync failed");
+			if (lseek(tmpfile, 0, SEEK_SET) == -1)
+				die("seek failed");
+		}
+		STOP_TIMER;
+		close(tmpfile);
+	}
+#else
+	printf(NA_FORMAT, _("n/a"));
+#endif
+}
+
+/*
+ * Compare writing 8 blocks with one write, with 8 writes and with one
+ * vectored write.  WAL is written from wal_buffers, where consecutive pages
+ * need not be contiguous in memory, so the last two are what the server does.
+ */
+static void
+test_vectored_writes(void)
+{
+	struct iovec iov[8];
+	int			tmpfile,
+				ops;
+
+	printf(_("\nCompare single, separate and vectored writes of 8 * %dkB + data sync:\n"),
+		   XLOG_BLCKSZ_K);
+
+	for (int i = 0; i < lengthof(iov); i++)
+	{
+		iov[i].iov_base = buf + i * XLOG_BLCKSZ;
+		iov[i].iov_len = XLOG_BLCKSZ;
+	}
+
+	if ((tmpfile = open(filename, O_RDWR | PG_BINARY, 0)) == -1)
+		die("could not open output file");
+
+	printf(LABEL_FORMAT, _("1 write"));
+	fflush(stdout);
+	START_TIMER;
+	for (ops = 0; alarm_triggered == false; ops++)
+	{
+		if (pg_pwrite(tmpfile, buf, 8 * XLOG_BLCKSZ, 0) != 8 * XLOG_BLCKSZ)
+			die("write failed");
+		if (sync_data(tmpfile) != 0)
+			die("fsync failed");
+	}
+	STOP_TIMER;
+
+	printf(LABEL_FORMAT, _("8 writes"));
+	fflush(stdout);
+	START_TIMER;
+	for (ops = 0; alarm_triggered == false; ops++)
+	{
+		for (int i = 0; i < lengthof(iov); i++)
+			if (pg_pwrite(tmpfile, iov[i].iov_base, XLOG_BLCKSZ,
+						  i * XLOG_BLCKSZ) != XLOG_BLCKSZ)
+				die("write failed");
+		if (sync_data(tmpfile) != 0)
+			die("fsync failed");
+	}
+	STOP_TIMER;
+
+	printf(LABEL_FORMAT, _("1 vectored write"));
+	fflush(stdout);
+	START_TIMER;
+	for (ops = 0; alarm_triggered == false; ops++)
+	{
+		if (pg_pwritev(tmpfile, iov, lengthof(iov), 0) != 8 * XLOG_BLCKSZ)
+			die("write failed");
+		if (sync_data(tmpfile) != 0)
+			die("fsync failed");
+	}
+	STOP_TIMER;
+
+	close(tmpfile);
+}
+
+/*
+ * Test several processes each writing and syncing their own file at the same
+ * time, as backends flushing data files or several WAL writers on the same
+ * device would.  The results show the total throughput of all processes,
+ * which tells whether the storage benefits from I/O concurrency.
+ */
+static void
+test_concurrent_writers(void)
+{
+	static const int nwriters[] = {1, 2, 4, 8};
+
+	printf(_("\nCompare concurrent writers, each %dkB write + data sync to its own file:\n"),
+		   XLOG_BLCKSZ_K);
+	printf(_("(Total for all writers.  Higher throughput with more writers means the\n"
+			 "storage can serve concurrent I/O.)\n"));
+
+	for (int i = 0; i < lengthof(nwriters); i++)
+	{
+		char		label[64];
+
+		snprintf(label, sizeof(label),
+				 ngettext("%d writer", "%d writers", nwriters[i]), nwriters[i]);
+		printf(LABEL_FORMAT, label);
+		fflush(stdout);
+
+#ifndef WIN32
+		{
+			int			pipefd[2];
+			int			ops = 0;
+
+			if (pipe(pipefd) != 0)
+				die("could not create pipe");
+
+			gettimeofday(&start_t, NULL);
+			for (int w = 0; w < nwriters[i]; w++)
+			{
+				pid_t		pid = fork();
+
+				if (pid < 0)
+					die("could not fork");
+				if (pid == 0)
+				{
+					char		wfilename[MAXPGPATH];
+					int			tmpfile;
+					int			wops;
+
+					/* child: don't remove the main test file on signals */
+					needs_unlink = 0;
+					close(pipefd[0]);
+
+					snprintf(wfilename, sizeof(wfilename), "%s.%d", filename, w);
+					if ((tmpfile = open(wfilename, O_RDWR | O_CREAT | PG_BINARY,
+										S_IRUSR | S_IWUSR)) == -1)
+						die("could not open output file");
+
+					alarm_triggered = false;
+					alarm(secs_per_test);
+					for (wops = 0; alarm_triggered == false; wops++)
+					{
+						if (pg_pwrite(tmpfile, buf, XLOG_BLCKSZ, 0) != XLOG_BLCKSZ)
+							die("write failed");
+						if (sync_data(tmpfile) != 0)
+							die("fsync failed");
+					}
+					close(tmpfile);
+					unlink(wfilename);
+
+					if (write(pipefd[1], &wops, sizeof(wops)) != sizeof(wops))
+						die("could not write to pipe");
+					exit(0);
+				}
+			}
+			close(pipefd[1]);
+
+			for (int w = 0; w < nwriters[i]; w++)
+			{
+				int			wops;
+
+				if (read(pipefd[0], &wops, sizeof(wops)) != sizeof(wops))
+				{
+					pg_log_error("writer process failed");
+					exit(1);
+				}
+				ops += wops;
+			}
+			close(pipefd[0]);
+			while (wait(NULL) > 0)
+				;
+
+			STOP_TIMER;
+		}
+#else
+		printf(NA_FORMAT, _("n/a"));
+#endif
+	}
+}
+
 static void
 test_file_descriptor_sync(void)
 {
@@ -14,8 +14,10 @@
 static const char *progname;
 
 static unsigned int test_duration = 3;
+static bool use_cycle_counter = false;
 
 static void handle_args(int argc, char *argv[]);
+static void init_cycle_counter(void);
 static uint64 test_timing(unsigned int duration);
 static void output(uint64 loop_count);
 
@@ -32,6 +34,9 @@ main(int argc, char *argv[])
 
 	handle_args(argc, argv);
 
+	if (use_cycle_counter)
+		init_cycle_counter();
+
 	loop_count = test_timing(test_duration);
 
 	output(loop_count);
@@ -43,6 +48,7 @@ static void
 handle_args(int argc, char *argv[])
 {
 	static struct option long_options[] = {
+		{"cycle-counter", no_argument, NULL, 'c'},
 		{"duration", required_argument, NULL, 'd'},
 		{NULL, 0, NULL, 0}
 	};
@@ -56,7 +62,7 @@ handle_args(int argc, char *argv[])
 	{
 		if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-?") == 0)
 		{
-			printf(_("Usage: %s [-d DURATION]\n"), progname);
+			printf(_("Usage: %s [-c] [-d DURATION]\n"), progname);
 			exit(0);
 		}
 		if (strcmp(argv[1], "--version") == 0 || strcmp(argv[1], "-V") == 0)
@@ -66,11 +72,15 @@ handle_args(int argc, char *argv[])
 		}
 	}
 
-	while ((option = getopt_long(argc, argv, "d:",
+	while ((option = getopt_long(argc, argv, "cd:",
 								 long_options, &optindex)) != -1)
 	{
 		switch (option)
 		{
+			case 'c':
+				use_cycle_counter = true;
+				break;
+
 			case 'd':
 				errno = 0;
 				optval = strtoul(optarg, &endptr, 10);
@@ -118,6 +128,27 @@ handle_args(int argc, char *argv[])
 		   test_duration);
 }
 
+/*
+ * Set up the CPU cycle counter the way the server does with
+ * timing_clock_source = auto, or failing that, = cycle_counter.
+ */
+static void
+init_cycle_counter(void)
+{
+	if (pg_cycle_counter_initialize(false))
+		printf(_("Using CPU cycle counter.\n"));
+	else if (pg_cycle_counter_initialize(true))
+		printf(_("Using CPU cycle counter, although the operating system does not use it as clock source.\n"));
+	else
+	{
+		fprintf(stderr, _("%s: no usable CPU cycle counter\n"), progname);
+		exit(1);
+	}
+
+	printf(_("Cycle counter frequency: %0.3f MHz\n"),
+		   1000.0 / pg_cycle_counter_ns_per_cycle);
+}
+
 static uint64
 test_timing(unsigned int duration)
 {
@@ -128,11 +159,18 @@ test_timing(unsigned int duration)
 				cur;
 	instr_time	start_time,
 				end_time,
+				system_start_time,
+				system_end_time,
 				temp;
 
 	total_time = duration > 0 ? duration * INT64CONST(1000000) : 0;
 
-	INSTR_TIME_SET_CURRENT(start_time);
+	/*
+	 * We time with INSTR_TIME_SET_CURRENT_FAST(), which is the same as
+	 * INSTR_TIME_SET_CURRENT() unless the cycle counter has been set up.
+	 */
+	INSTR_TIME_SET_CURRENT(system_start_time);
+	INSTR_TIME_SET_CURRENT_FAST(start_time);
 	cur = INSTR_TIME_GET_MICROSEC(start_time);
 
 	while (time_elapsed < total_time)
@@ -141,7 +179,7 @@ test_timing(unsigned int duration)
 					bits = 0;
 
 		prev = cur;
-		INSTR_TIME_SET_CURRENT(temp);
+		INSTR_TIME_SET_CURRENT_FAST(temp);
 		cur = INSTR_TIME_GET_MICROSEC(temp);
 		diff = cur - prev;
 
@@ -168,13 +206,21 @@ test_timing(unsigned int duration)
 		time_elapsed = INSTR_TIME_GET_MICROSEC(temp);
 	}
 
-	INSTR_TIME_SET_CURRENT(end_time);
+	INSTR_TIME_SET_CURRENT_FAST(end_time);
+	INSTR_TIME_SET_CURRENT(system_end_time);
 
 	INSTR_TIME_SUBTRACT(end_time, start_time);
+	INSTR_TIME_SUBTRACT(system_end_time, system_start_time);
 
 	printf(_("Per loop time including overhead: %0.2f ns\n"),
 		   INSTR_TIME_GET_DOUBLE(end_time) * 1e9 / loop_count);
 
+	/* Check the cycle counter's calibration against the system clock */
+	if (use_cycle_counter)
+		printf(_("Cycle counter deviation from system clock: %0.4f%%\n"),
+			   (INSTR_TIME_GET_DOUBLE(end_time) /
+				INSTR_TIME_GET_DOUBLE(system_end_time) - 1.0) * 100.0);
+
 	return loop_count;
 }
 
@@ -17,6 +17,11 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 
+#if defined(ENABLE_THREAD_SAFETY) && !defined(WIN32)
+#include <pthread.h>
+#define USE_VERIFY_THREADS
+#endif
+
 #include "common/hashfn.h"
 #include "common/logging.h"
 #include "fe_utils/simple_list.h"
@@ -108,8 +113,24 @@ typedef struct verifier_context
 	SimpleStringList ignore_list;
 	bool		exit_on_error;
 	bool		saw_any_error;
+	int			num_jobs;
 } verifier_context;
 
+/*
+ * With --jobs, checksum verification is divided among several workers, each
+ * running in its own thread and checking a fixed set of files.
+ */
+typedef struct checksum_worker
+{
+#ifdef USE_VERIFY_THREADS
+	pthread_t	thread;
+#endif
+	verifier_context *context;
+	manifest_file **files;
+	int			nfiles;
+	uint64		total_size;		/* sum of sizes of assigned files */
+} checksum_worker;
+
 static void parse_manifest_file(char *manifest_path,
 								manifest_files_hash **ht_p,
 								manifest_wal_range **first_wal_range_p);
@@ -133,6 +154,8 @@ static void verify_backup_file(verifier_context *context,
 							   char *relpath, char *fullpath);
 static void report_extra_backup_files(verifier_context *context);
 static void verify_backup_checksums(verifier_context *context);
+static void *verify_checksums_worker(void *arg);
+static int	manifest_file_size_cmp(const void *a, const void *b);
 static void verify_file_checksum(verifier_context *context,
 								 manifest_file *m, char *pathname);
 static void parse_required_wal(verifier_context *context,
@@ -160,6 +183,7 @@ main(int argc, char **argv)
 	static struct option long_options[] = {
 		{"exit-on-error", no_argument, NULL, 'e'},
 		{"ignore", required_argument, NULL, 'i'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"manifest-path", required_argument, NULL, 'm'},
 		{"no-parse-wal", no_argument, NULL, 'n'},
 		{"quiet", no_argument, NULL, 'q'},
@@ -183,6 +207,7 @@ main(int argc, char **argv)
 	progname = get_progname(argv[0]);
 
 	memset(&context, 0, sizeof(context));
+	context.num_jobs = 1;
 
 	if (argc > 1)
 	{
@@ -219,7 +244,7 @@ main(int argc, char **argv)
 	simple_string_list_append(&context.ignore_list, "recovery.signal");
 	simple_string_list_append(&context.ignore_list, "standby.signal");
 
-	while ((c = getopt_long(argc, argv, "ei:m:nqsw:", long_options, NULL)) != -1)
+	while ((c = getopt_long(argc, argv, "ei:j:m:nqsw:", long_options, NULL)) != -1)
 	{
 		switch (c)
 		{
@@ -234,6 +259,21 @@ main(int argc, char **argv)
 					simple_string_list_append(&context.ignore_list, arg);
 					break;
 				}
+			case 'j':
+				context.num_jobs = atoi(optarg);
+				if (context.num_jobs <= 0)
+				{
+					pg_log_fatal("invalid number of parallel jobs");
+					exit(1);
+				}
+#ifndef USE_VERIFY_THREADS
+				if (context.num_jobs != 1)
+				{
+					pg_log_fatal("parallel jobs are not supported on this platform");
+					exit(1);
+				}
+#endif
+				break;
 			case 'm':
 				manifest_path = pstrdup(optarg);
 				canonicalize_path(manifest_path);
@@ -673,32 +713,119 @@ report_extra_backup_files(verifier_context *context)
  * Verify checksums for hash table entries that are otherwise unproblematic.
  * If we've already reported some problem related to a hash table entry, or
  * if it has no checksum, just skip it.
+ *
+ * With more than one job, the files are handed out largest first, each to
+ * the worker with the least data assigned so far, so that the workers finish
+ * at about the same time.  A file can't be split between workers, since its
+ * checksum has to be computed over the whole file in order; but relation
+ * files in a backup are at most one segment (normally 1GB) long anyway.
  */
 static void
 verify_backup_checksums(verifier_context *context)
 {
 	manifest_files_iterator it;
 	manifest_file *m;
+	manifest_file **files;
+	int			nfiles = 0;
+	checksum_worker *workers;
+	int			num_jobs = context->num_jobs;
 
+	files = pg_malloc(context->ht->members * sizeof(manifest_file *));
 	manifest_files_start_iterate(context->ht, &it);
 	while ((m = manifest_files_iterate(context->ht, &it)) != NULL)
 	{
 		if (m->matched && !m->bad && m->checksum_type != CHECKSUM_TYPE_NONE &&
 			!should_ignore_relpath(context, m->pathname))
-		{
-			char	   *fullpath;
+			files[nfiles++] = m;
+	}
 
-			/* Compute the full pathname to the target file. */
-			fullpath = psprintf("%s/%s", context->backup_directory,
-								m->pathname);
+	if (num_jobs > 1)
+		qsort(files, nfiles, sizeof(manifest_file *), manifest_file_size_cmp);
 
-			/* Do the actual checksum verification. */
-			verify_file_checksum(context, m, fullpath);
+	workers = pg_malloc0(num_jobs * sizeof(checksum_worker));
+	for (int i = 0; i < num_jobs; i++)
+	{
+		workers[i].context = context;
+		workers[i].files = pg_malloc(nfiles * sizeof(manifest_file *));
+	}
 
-			/* Avoid leaking memory. */
-			pfree(fullpath);
+	for (int i = 0; i < nfiles; i++)
+	{
+		checksum_worker *target = &workers[0];
+
+		for (int j = 1; j < num_jobs; j++)
+		{
+			if (workers[j].total_size < target->total_size)
+				target = &workers[j];
 		}
+		target->files[target->nfiles++] = files[i];
+		target->total_size += files[i]->size;
 	}
+
+	if (num_jobs == 1)
+		(void) verify_checksums_worker(&workers[0]);
+#ifdef USE_VERIFY_THREADS
+	else
+	{
+		for (int i = 0; i < num_jobs; i++)
+		{
+			errno = pthread_create(&workers[i].thread, NULL,
+								   verify_checksums_worker, &workers[i]);
+			if (errno != 0)
+				report_fatal_error("could not create thread: %m");
+		}
+		for (int i = 0; i < num_jobs; i++)
+			pthread_join(workers[i].thread, NULL);
+	}
+#endif
+
+	for (int i = 0; i < num_jobs; i++)
+		pfree(workers[i].files);
+	pfree(workers);
+	pfree(files);
+}
+
+/*
+ * Verify the checksums of the files assigned to one worker.
+ */
+static void *
+verify_checksums_worker(void *arg)
+{
+	checksum_worker *worker = (checksum_worker *) arg;
+
+	for (int i = 0; i < worker->nfiles; i++)
+	{
+		manifest_file *m = worker->files[i];
+		char	   *fullpath;
+
+		/* Compute the full pathname to the target file. */
+		fullpath = psprintf("%s/%s", worker->context->backup_directory,
+							m->pathname);
+
+		/* Do the actual checksum verification. */
+		verify_file_checksum(worker->context, m, fullpath);
+
+		/* Avoid leaking memory. */
+		pfree(fullpath);
+	}
+
+	return NULL;
+}
+
+/*
+ * qsort comparator for sorting manifest files by decreasing size.
+ */
+static int
+manifest_file_size_cmp(const void *a, const void *b)
+{
+	manifest_file *ma = *(manifest_file *const *) a;
+	manifest_file *mb = *(manifest_file *const *) b;
+
+	if (ma->size > mb->size)
+		return -1;
+	if (ma->size < mb->size)
+		return 1;
+	return 0;
 }
 
 /*
@@ -913,6 +1040,7 @@ usage(void)
 	printf(_("Options:\n"));
 	printf(_("  -e, --exit-on-error         exit immediately on error\n"));
 	printf(_("  -i, --ignore=RELATIVE_PATH  ignore indicated path\n"));
+	printf(_("  -j, --jobs=NUM              use this many parallel jobs to verify checksums\n"));
 	printf(_("  -m, --manifest-path=PATH    use specified path for manifest\n"));
 	printf(_("  -n, --no-parse-wal          do not try to parse WAL files\n"));
 	printf(_("  -q, --quiet                 do not print any output, except for errors\n"));
@@ -65,6 +65,7 @@
 #include "getopt_long.h"
 #include "libpq-fe.h"
 #include "pgbench.h"
+#include "port/pg_bitutils.h"
 #include "portability/instr_time.h"
 
 #ifndef M_PI
@@ -232,6 +233,7 @@ bool		use_quiet;			/* quiet logging onto stderr */
 int			agg_interval;		/* log aggregates instead of individual
 								 * transactions */
 bool		per_script_stats = false;	/* whether to collect stats per script */
+bool		latency_percentiles = false;	/* report latency percentiles */
 int			progress = 0;		/* thread progress report every this seconds */
 bool		progress_timestamp = false; /* progress report with Unix time */
 int			nclients = 1;		/* number of clients */
@@ -286,6 +288,22 @@ typedef struct SimpleStats
 	double		sum2;			/* sum of squared values */
 } SimpleStats;
 
+/*
+ * Latency histogram buckets, used for --latency-percentiles.
+ *
+ * Latencies are counted in microseconds, in log-linear buckets as in HDR
+ * histograms: values below LATENCY_HIST_SUB_BUCKETS get a bucket each, and
+ * every further power-of-2 range is split into LATENCY_HIST_SUB_BUCKETS
+ * equal-sized buckets, so the relative error stays below about 3% over the
+ * whole range.  Latencies above 2^LATENCY_HIST_MAX_BITS microseconds (about
+ * 19 hours) are counted in the last bucket.
+ */
+#define LATENCY_HIST_SUB_BITS		5
+#define LATENCY_HIST_SUB_BUCKETS	(1 << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_MAX_BITS		36
+#define LATENCY_HIST_BUCKETS \
+	((LATENCY_HIST_MAX_BITS - LATENCY_HIST_SUB_BITS + 1) * LATENCY_HIST_SUB_BUCKETS)
+
 /*
  * Data structure to hold various statistics: per-thread and per-script stats
  * are maintained and merged together.
@@ -298,6 +316,8 @@ typedef struct StatsData
 								 * and --latency-limit */
 	SimpleStats latency;
 	SimpleStats lag;
+	int64		latency_hist[LATENCY_HIST_BUCKETS]; /* only with
+													 * --latency-percentiles */
 } StatsData;
 
 /*
@@ -485,7 +505,9 @@ typedef enum MetaCommand
 	META_IF,					/* \if */
 	META_ELIF,					/* \elif */
 	META_ELSE,					/* \else */
-	META_ENDIF					/* \endif */
+	META_ENDIF,					/* \endif */
+	META_STARTPIPELINE,			/* \startpipeline */
+	META_ENDPIPELINE			/* \endpipeline */
 } MetaCommand;
 
 typedef enum QueryMode
@@ -670,6 +692,7 @@ usage(void)
 		   "  -T, --time=NUM           duration of benchmark test in seconds\n"
 		   "  -v, --vacuum-all         vacuum all four standard tables before tests\n"
 		   "  --aggregate-interval=NUM aggregate data over NUM seconds\n"
+		   "  --latency-percentiles    report latency percentiles, also in progress reports\n"
 		   "  --log-prefix=PREFIX      prefix for transaction time log file\n"
 		   "                           (default: \"pgbench_log\")\n"
 		   "  --progress-timestamp     use Unix epoch timestamps for progress\n"
@@ -1112,6 +1135,78 @@ initStats(StatsData *sd, time_t start_time)
 	sd->skipped = 0;
 	initSimpleStats(&sd->latency);
 	initSimpleStats(&sd->lag);
+	memset(sd->latency_hist, 0, sizeof(sd->latency_hist));
+}
+
+/*
+ * Return the histogram bucket for a latency, in microseconds.
+ */
+static int
+latencyHistBucket(double latency)
+{
+	uint64		val;
+	int			shift;
+
+	if (latency < LATENCY_HIST_SUB_BUCKETS)
+		return latency > 0 ? (int) latency : 0;
+	if (latency >= (double) ((uint64) 1 << LATENCY_HIST_MAX_BITS))
+		return LATENCY_HIST_BUCKETS - 1;
+
+	val = (uint64) latency;
+	shift = pg_leftmost_one_pos64(val) - LATENCY_HIST_SUB_BITS;
+	return (shift + 1) * LATENCY_HIST_SUB_BUCKETS +
+		(int) (val >> shift) - LATENCY_HIST_SUB_BUCKETS;
+}
+
+/*
+ * Return the latency, in microseconds, in the middle of a histogram bucket.
+ */
+static double
+latencyHistValue(int bucket)
+{
+	int			shift;
+	int			sub;
+
+	if (bucket < LATENCY_HIST_SUB_BUCKETS)
+		return bucket + 0.5;
+
+	shift = bucket / LATENCY_HIST_SUB_BUCKETS - 1;
+	sub = bucket % LATENCY_HIST_SUB_BUCKETS;
+	return ((double) ((uint64) (LATENCY_HIST_SUB_BUCKETS + sub) << shift)) +
+		((double) ((uint64) 1 << shift)) / 2;
+}
+
+/*
+ * Compute the given percentile of the latencies counted in "hist" but not in
+ * "base" (which can be NULL), which should total "count" values.
+ */
+static double
+latencyPercentile(const int64 *hist, const int64 *base, int64 count,
+				  double percentile)
+{
+	int64		target = (int64) ceil(count * percentile / 100.0);
+	int64		seen = 0;
+
+	if (target < 1)
+		target = 1;
+
+	for (int i = 0; i < LATENCY_HIST_BUCKETS; i++)
+	{
+		seen += hist[i] - (base ? base[i] : 0);
+		if (seen >= target)
+			return latencyHistValue(i);
+	}
+	return 0.0;
+}
+
+/*
+ * Merge the latency histogram of one StatsData into another.
+ */
+static void
+mergeLatencyHist(StatsData *acc, StatsData *sd)
+{
+	for (int i = 0; i < LATENCY_HIST_BUCKETS; i++)
+		acc->latency_hist[i] += sd->latency_hist[i];
 }
 
 /*
@@ -1130,6 +1225,8 @@ accumStats(StatsData *stats, bool skipped, double lat, double lag)
 	else
 	{
 		addToSimpleStats(&stats->latency, lat);
+		if (latency_percentiles)
+			stats->latency_hist[latencyHistBucket(lat)]++;
 
 		/* and possibly the same for schedule lag */
 		if (throttle_delay)
@@ -1234,6 +1331,118 @@ doConnect(void)
 	return conn;
 }
 
+/*
+ * Execute the given statements, running up to nthreads of them concurrently
+ * on separate connections.  "con" is used as one of the connections; the
+ * others are opened here and closed again when all statements are done.
+ * Statements are started in the given order, but may complete in any order.
+ * Any failure is fatal, as in executeStatement().
+ */
+static void
+executeStatementsConcurrently(PGconn *con, char **sqls, int nsqls)
+{
+	int			nconns = Min(nthreads, nsqls);
+	PGconn	  **conns;
+	char	  **running;
+	int			nrunning = 0;
+	int			next = 0;
+	socket_set *sockets;
+
+	if (nconns <= 1)
+	{
+		for (int i = 0; i < nsqls; i++)
+			executeStatement(con, sqls[i]);
+		return;
+	}
+
+	conns = (PGconn **) pg_malloc(sizeof(PGconn *) * nconns);
+	running = (char **) pg_malloc0(sizeof(char *) * nconns);
+	conns[0] = con;
+	for (int i = 1; i < nconns; i++)
+	{
+		if ((conns[i] = doConnect()) == NULL)
+			exit(1);
+	}
+	sockets = alloc_socket_set(nconns);
+
+	for (;;)
+	{
+		int			nsocks = 0;
+
+		/* start the next statements on idle connections */
+		for (int i = 0; i < nconns && next < nsqls; i++)
+		{
+			if (running[i] != NULL)
+				continue;
+			if (!PQsendQuery(conns[i], sqls[next]))
+			{
+				pg_log_fatal("query failed: %s", PQerrorMessage(conns[i]));
+				pg_log_info("query was: %s", sqls[next]);
+				exit(1);
+			}
+			running[i] = sqls[next++];
+			nrunning++;
+		}
+
+		if (nrunning == 0)
+			break;
+
+		/* wait for some of them to make progress */
+		clear_socket_set(sockets);
+		for (int i = 0; i < nconns; i++)
+		{
+			if (running[i] != NULL)
+				add_socket_to_set(sockets, PQsocket(conns[i]), nsocks++);
+		}
+		if (wait_on_socket_set(sockets, 0) < 0 && errno != EINTR)
+		{
+			pg_log_fatal("%s() failed: %m", SOCKET_WAIT_METHOD);
+			exit(1);
+		}
+
+		/* and collect the results of those that are done */
+		nsocks = 0;
+		for (int i = 0; i < nconns; i++)
+		{
+			if (running[i] == NULL)
+				continue;
+			if (!socket_has_input(sockets, PQsocket(conns[i]), nsocks++))
+				continue;
+
+			if (!PQconsumeInput(conns[i]))
+			{
+				pg_log_fatal("query failed: %s", PQerrorMessage(conns[i]));
+				pg_log_info("query was: %s", running[i]);
+				exit(1);
+			}
+			while (!PQisBusy(conns[i]))
+			{
+				PGresult   *res = PQgetResult(conns[i]);
+
+				if (res == NULL)
+				{
+					running[i] = NULL;
+					nrunning--;
+					break;
+				}
+				if (PQresultStatus(res) != PGRES_COMMAND_OK)
+				{
+					pg_log_fatal("query failed: %s", PQerrorMessage(conns[i]));
+					pg_log_info("query was: %s", running[i]);
+					exit(1);
+				}
+				PQclear(res);
+			}
+		}
+	}
+
+	free_socket_set(sockets);
+	for (int i = 1; i < nconns; i++)
+		PQfinish(conns[i]);
+	pg_free(conns);
+	pg_free(running);
+}
+
 /* qsort comparator for Variable array */
 static int
 compareVariableNames(const void *v1, const void *v2)
@@ -2492,6 +2701,10 @@ getMetaCommand(const char *cmd)
 		mc = META_GSET;
 	else if (pg_strcasecmp(cmd, "aset") == 0)
 		mc = META_ASET;
+	else if (pg_strcasecmp(cmd, "startpipeline") == 0)
+		mc = META_STARTPIPELINE;
+	else if (pg_strcasecmp(cmd, "endpipeline") == 0)
+		mc = META_ENDPIPELINE;
 	else
 		mc = META_NONE;
 	return mc;
@@ -2635,6 +2848,38 @@ chooseScript(TState *thread)
 	return i - 1;
 }
 
+/*
+ * Prepare the SQL commands in the chosen script, if not done yet.
+ *
+ * This is done synchronously, so it must happen before entering pipeline
+ * mode; \startpipeline takes care of that.
+ */
+static void
+prepareCommands(CState *st)
+{
+	int			j;
+	Command   **commands = sql_script[st->use_file].commands;
+
+	if (st->prepared[st->use_file])
+		return;
+
+	for (j = 0; commands[j] != NULL; j++)
+	{
+		PGresult   *res;
+		char		name[MAX_PREPARE_NAME];
+
+		if (commands[j]->type != SQL_COMMAND)
+			continue;
+		preparedStatementName(name, st->use_file, j);
+		res = PQprepare(st->con, name,
+						commands[j]->argv[0], commands[j]->argc - 1, NULL);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			pg_log_error("%s", PQerrorMessage(st->con));
+		PQclear(res);
+	}
+	st->prepared[st->use_file] = true;
+}
+
 /* Send a SQL command, using the chosen querymode */
 static bool
 sendCommand(CState *st, Command *command)
@@ -2668,27 +2913,7 @@ sendCommand(CState *st, Command *command)
 		char		name[MAX_PREPARE_NAME];
 		const char *params[MAX_ARGS];
 
-		if (!st->prepared[st->use_file])
-		{
-			int			j;
-			Command   **commands = sql_script[st->use_file].commands;
-
-			for (j = 0; commands[j] != NULL; j++)
-			{
-				PGresult   *res;
-				char		name[MAX_PREPARE_NAME];
-
-				if (commands[j]->type != SQL_COMMAND)
-					continue;
-				preparedStatementName(name, st->use_file, j);
-				res = PQprepare(st->con, name,
-								commands[j]->argv[0], commands[j]->argc - 1, NULL);
-				if (PQresultStatus(res) != PGRES_COMMAND_OK)
-					pg_log_error("%s", PQerrorMessage(st->con));
-				PQclear(res);
-			}
-			st->prepared[st->use_file] = true;
-		}
+		prepareCommands(st);
 
 		getQueryParams(st, command, params);
 		preparedStatementName(name, st->use_file, st->command);
@@ -2717,6 +2942,10 @@ sendCommand(CState *st, Command *command)
  * the results of the *last* command (META_GSET) or *all* commands
  * (META_ASET).
  *
+ * In pipeline mode (meta is META_ENDPIPELINE), this reads the results of a
+ * single queued command, or the pipeline's sync point, in which case it
+ * also leaves pipeline mode.
+ *
  * Returns true if everything is A-OK, false if any error occurs.
  */
 static bool
@@ -2730,7 +2959,8 @@ readCommandResponse(CState *st, MetaCommand meta, char *varprefix)
 	 * varprefix should be set only with \gset or \aset, and SQL commands do
 	 * not need it.
 	 */
-	Assert((meta == META_NONE && varprefix == NULL) ||
+	Assert(((meta == META_NONE || meta == META_ENDPIPELINE) &&
+			varprefix == NULL) ||
 		   ((meta == META_GSET || meta == META_ASET) && varprefix != NULL));
 
 	res = PQgetResult(st->con);
@@ -2799,6 +3029,16 @@ readCommandResponse(CState *st, MetaCommand meta, char *varprefix)
 				/* otherwise the result is simply thrown away by PQclear below */
 				break;
 
+			case PGRES_PIPELINE_SYNC:
+				pg_log_debug("client %d pipeline ending", st->id);
+				if (PQexitPipelineMode(st->con) != 1)
+				{
+					pg_log_error("client %d failed to exit pipeline mode: %s",
+								 st->id, PQerrorMessage(st->con));
+					goto error;
+				}
+				break;
+
 			default:
 				/* anything else is unexpected */
 				pg_log_error("client %d script %d aborted in command %d query %d: %s",
@@ -3057,11 +3297,25 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 				/* Execute the command */
 				if (command->type == SQL_COMMAND)
 				{
-					if (!sendCommand(st, command))
+					bool		pipelined;
+
+					/*
+					 * In pipeline mode, results are only read at
+					 * \endpipeline, so they can't be stored into variables.
+					 */
+					pipelined = PQpipelineStatus(st->con) != PQ_PIPELINE_OFF;
+					if (pipelined && command->meta != META_NONE)
+					{
+						commandFailed(st, "SQL", "\\gset and \\aset are not allowed in pipeline mode");
+						st->state = CSTATE_ABORTED;
+					}
+					else if (!sendCommand(st, command))
 					{
 						commandFailed(st, "SQL", "SQL command send failed");
 						st->state = CSTATE_ABORTED;
 					}
+					else if (pipelined)
+						st->state = CSTATE_END_COMMAND;
 					else
 						st->state = CSTATE_WAIT_RESULT;
 				}
@@ -3189,7 +3443,13 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 				 */
 			case CSTATE_WAIT_RESULT:
 				pg_log_debug("client %d receiving", st->id);
-				if (!PQconsumeInput(st->con))
+
+				/*
+				 * Only read from the socket once the data already received
+				 * has been used up; in pipeline mode we come here for each
+				 * queued command, and a syscall for each would be costly.
+				 */
+				if (PQisBusy(st->con) && !PQconsumeInput(st->con))
 				{
 					/* there's something wrong */
 					commandFailed(st, "SQL", "perhaps the backend died while processing");
@@ -3203,7 +3463,14 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 				if (readCommandResponse(st,
 										sql_script[st->use_file].commands[st->command]->meta,
 										sql_script[st->use_file].commands[st->command]->varprefix))
-					st->state = CSTATE_END_COMMAND;
+				{
+					/*
+					 * In pipeline mode, keep reading results until the sync
+					 * point takes us out of it.
+					 */
+					if (PQpipelineStatus(st->con) == PQ_PIPELINE_OFF)
+						st->state = CSTATE_END_COMMAND;
+				}
 				else
 					st->state = CSTATE_ABORTED;
 				break;
@@ -3265,6 +3532,14 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 				 */
 				Assert(conditional_stack_empty(st->cstack));
 
+				/* the results of a pipeline must be read at \endpipeline */
+				if (PQpipelineStatus(st->con) != PQ_PIPELINE_OFF)
+				{
+					commandFailed(st, "endpipeline", "end of script reached with pipeline open");
+					st->state = CSTATE_ABORTED;
+					break;
+				}
+
 				if (is_connect)
 				{
 					finishCon(st);
@@ -3447,6 +3722,46 @@ executeMetaCommand(CState *st, instr_time *now)
 			return CSTATE_ABORTED;
 		}
 	}
+	else if (command->meta == META_STARTPIPELINE)
+	{
+		/* the simple Query message can't take part in a pipeline */
+		if (querymode == QUERY_SIMPLE)
+		{
+			commandFailed(st, "startpipeline", "cannot use pipeline mode with the simple query protocol");
+			return CSTATE_ABORTED;
+		}
+		if (PQpipelineStatus(st->con) != PQ_PIPELINE_OFF)
+		{
+			commandFailed(st, "startpipeline", "already in pipeline mode");
+			return CSTATE_ABORTED;
+		}
+
+		/* statements can't be prepared synchronously once in the pipeline */
+		if (querymode == QUERY_PREPARED)
+			prepareCommands(st);
+
+		if (PQenterPipelineMode(st->con) == 0)
+		{
+			commandFailed(st, "startpipeline", "failed to enter pipeline mode");
+			return CSTATE_ABORTED;
+		}
+	}
+	else if (command->meta == META_ENDPIPELINE)
+	{
+		if (PQpipelineStatus(st->con) != PQ_PIPELINE_ON)
+		{
+			commandFailed(st, "endpipeline", "not in pipeline mode");
+			return CSTATE_ABORTED;
+		}
+		if (!PQpipelineSync(st->con))
+		{
+			commandFailed(st, "endpipeline", "failed to send a pipeline sync");
+			return CSTATE_ABORTED;
+		}
+
+		/* collect the results of the pipeline, up to its sync point */
+		return CSTATE_WAIT_RESULT;
+	}
 
 	/*
 	 * executing the expression or shell command might have taken a
@@ -3552,7 +3867,8 @@ processXactStats(TState *thread, CState *st, instr_time *now,
 {
 	double		latency = 0.0,
 				lag = 0.0;
-	bool		thread_details = progress || throttle_delay || latency_limit,
+	bool		thread_details = progress || throttle_delay || latency_limit ||
+	latency_percentiles,
 				detailed = thread_details || use_log || per_script_stats;
 
 	if (detailed && !skipped)
@@ -3944,6 +4260,87 @@ initGenerateDataClientSide(PGconn *con)
 	executeStatement(con, "commit");
 }
 
+/*
+ * Parallel version of initGenerateDataServerSide, for -j greater than 1.
+ *
+ * The small tables are filled first, then pgbench_accounts is loaded by up to
+ * nthreads concurrent connections.  With range partitioning, each partition
+ * is truncated and loaded in a transaction of its own, which keeps the
+ * data-loading optimizations of the serial version.  Otherwise, the aid range
+ * is split into one chunk per connection.
+ */
+static void
+initGenerateDataServerSideParallel(PGconn *con)
+{
+	PQExpBufferData sql;
+	int64		total = (int64) naccounts * scale;
+	char	  **sqls;
+	int			nsqls;
+
+	executeStatement(con, "begin");
+	initTruncateTables(con);
+
+	initPQExpBuffer(&sql);
+
+	printfPQExpBuffer(&sql,
+					  "insert into pgbench_branches(bid,bbalance) "
+					  "select bid, 0 "
+					  "from generate_series(1, %d) as bid", nbranches * scale);
+	executeStatement(con, sql.data);
+
+	printfPQExpBuffer(&sql,
+					  "insert into pgbench_tellers(tid,bid,tbalance) "
+					  "select tid, (tid - 1) / %d + 1, 0 "
+					  "from generate_series(1, %d) as tid", ntellers, ntellers * scale);
+	executeStatement(con, sql.data);
+
+	executeStatement(con, "commit");
+
+	if (partition_method == PART_RANGE)
+	{
+		/* same bounds as in createPartitions() */
+		int64		part_size = (total + partitions - 1) / partitions;
+
+		nsqls = partitions;
+		sqls = (char **) pg_malloc(sizeof(char *) * nsqls);
+		for (int p = 1; p <= partitions; p++)
+			sqls[p - 1] =
+				psprintf("begin;"
+						 "truncate table pgbench_accounts_%d;"
+						 "insert into pgbench_accounts_%d(aid,bid,abalance,filler) "
+						 "select aid, (aid - 1) / %d + 1, 0, '' "
+						 "from generate_series(" INT64_FORMAT ", " INT64_FORMAT ") as aid;"
+						 "commit",
+						 p, p, naccounts,
+						 Min((p - 1) * part_size + 1, total + 1),
+						 p < partitions ? Min(p * part_size, total) : total);
+	}
+	else
+	{
+		int64		chunk = (total + nthreads - 1) / nthreads;
+
+		nsqls = nthreads;
+		sqls = (char **) pg_malloc(sizeof(char *) * nsqls);
+		for (int i = 0; i < nthreads; i++)
+			sqls[i] =
+				psprintf("insert into pgbench_accounts(aid,bid,abalance,filler) "
+						 "select aid, (aid - 1) / %d + 1, 0, '' "
+						 "from generate_series(" INT64_FORMAT ", " INT64_FORMAT ") as aid",
+						 naccounts,
+						 Min(i * chunk + 1, total + 1),
+						 Min((i + 1) * chunk, total));
+	}
+
+	fprintf(stderr, "loading pgbench_accounts using %d connections...\n",
+			Min(nthreads, nsqls));
+	executeStatementsConcurrently(con, sqls, nsqls);
+
+	for (int i = 0; i < nsqls; i++)
+		pg_free(sqls[i]);
+	pg_free(sqls);
+	termPQExpBuffer(&sql);
+}
+
 /*
  * Fill the standard tables with some data generated on the server
  *
@@ -3958,6 +4355,12 @@ initGenerateDataServerSide(PGconn *con)
 
 	fprintf(stderr, "generating data (server-side)...\n");
 
+	if (nthreads > 1)
+	{
+		initGenerateDataServerSideParallel(con);
+		return;
+	}
+
 	/*
 	 * we do all of this in one transaction to enable the backend's
 	 * data-loading optimizations
@@ -4019,28 +4422,67 @@ initCreatePKeys(PGconn *con)
 	};
 	int			i;
 	PQExpBufferData query;
+	char	   *tablespace_clause = NULL;
+	char	   *sqls[lengthof(DDLINDEXes)];
 
 	fprintf(stderr, "creating primary keys...\n");
 	initPQExpBuffer(&query);
 
-	for (i = 0; i < lengthof(DDLINDEXes); i++)
+	if (index_tablespace != NULL)
 	{
-		resetPQExpBuffer(&query);
-		appendPQExpBufferStr(&query, DDLINDEXes[i]);
+		char	   *escape_tablespace;
 
-		if (index_tablespace != NULL)
-		{
-			char	   *escape_tablespace;
+		escape_tablespace = PQescapeIdentifier(con, index_tablespace,
+											   strlen(index_tablespace));
+		tablespace_clause = psprintf(" using index tablespace %s",
+									 escape_tablespace);
+		PQfreemem(escape_tablespace);
+	}
 
-			escape_tablespace = PQescapeIdentifier(con, index_tablespace,
-												   strlen(index_tablespace));
-			appendPQExpBuffer(&query, " using index tablespace %s", escape_tablespace);
-			PQfreemem(escape_tablespace);
-		}
+	/*
+	 * With -j, build the primary keys of the partitions of pgbench_accounts
+	 * concurrently with each other and with the other tables' keys.  Adding
+	 * the primary key to the partitioned table afterwards then just attaches
+	 * the partitions' indexes.
+	 */
+	if (nthreads > 1 && partitions > 0)
+	{
+		char	  **partsqls;
+		int			nsqls = 0;
 
+		partsqls = (char **) pg_malloc(sizeof(char *) * (partitions + 2));
+		for (i = 0; i < 2; i++)
+			partsqls[nsqls++] = psprintf("%s%s", DDLINDEXes[i],
+										 tablespace_clause ? tablespace_clause : "");
+		for (int p = 1; p <= partitions; p++)
+			partsqls[nsqls++] = psprintf("alter table pgbench_accounts_%d add primary key (aid)%s",
+										 p, tablespace_clause ? tablespace_clause : "");
+
+		executeStatementsConcurrently(con, partsqls, nsqls);
+
+		for (i = 0; i < nsqls; i++)
+			pg_free(partsqls[i]);
+		pg_free(partsqls);
+
+		appendPQExpBufferStr(&query, DDLINDEXes[2]);
+		if (tablespace_clause)
+			appendPQExpBufferStr(&query, tablespace_clause);
 		executeStatement(con, query.data);
 	}
+	else
+	{
+		for (i = 0; i < lengthof(DDLINDEXes); i++)
+			sqls[i] = psprintf("%s%s", DDLINDEXes[i],
+							   tablespace_clause ? tablespace_clause : "");
+
+		executeStatementsConcurrently(con, sqls, lengthof(DDLINDEXes));
 
+		for (i = 0; i < lengthof(DDLINDEXes); i++)
+			pg_free(sqls[i]);
+	}
+
+	if (tablespace_clause)
+		pg_free(tablespace_clause);
 	termPQExpBuffer(&query);
 }
 
@@ -4674,7 +5116,9 @@ process_backslash_command(PsqlScanState sstate, const char *source)
 			syntax_error(source, lineno, my_command->first_line, my_command->argv[0],
 						 "missing command", NULL, -1);
 	}
-	else if (my_command->meta == META_ELSE || my_command->meta == META_ENDIF)
+	else if (my_command->meta == META_ELSE || my_command->meta == META_ENDIF ||
+			 my_command->meta == META_STARTPIPELINE ||
+			 my_command->meta == META_ENDPIPELINE)
 	{
 		if (my_command->argc != 1)
 			syntax_error(source, lineno, my_command->first_line, my_command->argv[0],
@@ -5117,6 +5561,8 @@ printProgressReport(TState *threads, int64 test_start, int64 now,
 	{
 		mergeSimpleStats(&cur.latency, &threads[i].stats.latency);
 		mergeSimpleStats(&cur.lag, &threads[i].stats.lag);
+		if (latency_percentiles)
+			mergeLatencyHist(&cur, &threads[i].stats);
 		cur.cnt += threads[i].stats.cnt;
 		cur.skipped += threads[i].stats.skipped;
 	}
@@ -5160,6 +5606,17 @@ printProgressReport(TState *threads, int64 test_start, int64 now,
 			"progress: %s, %.1f tps, lat %.3f ms stddev %.3f",
 			tbuf, tps, latency, stdev);
 
+	if (latency_percentiles && ntx > 0)
+		fprintf(stderr, ", p50 %.3f p90 %.3f p99 %.3f p99.9 %.3f ms",
+				0.001 * latencyPercentile(cur.latency_hist,
+										  last->latency_hist, ntx, 50.0),
+				0.001 * latencyPercentile(cur.latency_hist,
+										  last->latency_hist, ntx, 90.0),
+				0.001 * latencyPercentile(cur.latency_hist,
+										  last->latency_hist, ntx, 99.0),
+				0.001 * latencyPercentile(cur.latency_hist,
+										  last->latency_hist, ntx, 99.9));
+
 	if (throttle_delay)
 	{
 		fprintf(stderr, ", lag %.3f ms", lag);
@@ -5186,6 +5643,20 @@ printSimpleStats(const char *prefix, SimpleStats *ss)
 	}
 }
 
+static void
+printLatencyPercentiles(const char *prefix, StatsData *sd)
+{
+	static const double percentiles[] = {50.0, 90.0, 99.0, 99.9};
+
+	if (!latency_percentiles || sd->latency.count == 0)
+		return;
+
+	for (int i = 0; i < lengthof(percentiles); i++)
+		printf("%s %gth percentile = %.3f ms\n", prefix, percentiles[i],
+			   0.001 * latencyPercentile(sd->latency_hist, NULL,
+										 sd->latency.count, percentiles[i]));
+}
+
 /* print out results */
 static void
 printResults(StatsData *total, instr_time total_time,
@@ -5241,8 +5712,11 @@ printResults(StatsData *total, instr_time total_time,
 			   latency_limit / 1000.0, latency_late, ntx,
 			   (ntx > 0) ? 100.0 * latency_late / ntx : 0.0);
 
-	if (throttle_delay || progress || latency_limit)
+	if (throttle_delay || progress || latency_limit || latency_percentiles)
+	{
 		printSimpleStats("latency", &total->latency);
+		printLatencyPercentiles("latency", total);
+	}
 	else
 	{
 		/* no measurement, show average latency computed from run time */
@@ -5292,6 +5766,7 @@ printResults(StatsData *total, instr_time total_time,
 						   100.0 * sstats->skipped / sstats->cnt);
 
 				printSimpleStats(" - latency", &sstats->latency);
+				printLatencyPercentiles(" - latency", sstats);
 			}
 
 			/* Report per-command latencies */
@@ -5419,6 +5894,7 @@ main(int argc, char **argv)
 		{"show-script", required_argument, NULL, 10},
 		{"partitions", required_argument, NULL, 11},
 		{"partition-method", required_argument, NULL, 12},
+		{"latency-percentiles", no_argument, NULL, 13},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -5550,7 +6026,6 @@ main(int argc, char **argv)
 #endif							/* HAVE_GETRLIMIT */
 				break;
 			case 'j':			/* jobs */
-				benchmarking_option_set = true;
 				nthreads = atoi(optarg);
 				if (nthreads <= 0)
 				{
@@ -5792,6 +6267,10 @@ main(int argc, char **argv)
 					exit(1);
 				}
 				break;
+			case 13:			/* latency-percentiles */
+				benchmarking_option_set = true;
+				latency_percentiles = true;
+				break;
 			default:
 				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
 				exit(1);
@@ -5833,9 +6312,11 @@ main(int argc, char **argv)
 	/*
 	 * Don't need more threads than there are clients.  (This is not merely an
 	 * optimization; throttle_delay is calculated incorrectly below if some
-	 * threads have no clients assigned to them.)
+	 * threads have no clients assigned to them.)  In initialization mode,
+	 * -j is the number of connections used to load data and build indexes,
+	 * and has nothing to do with clients.
 	 */
-	if (nthreads > nclients)
+	if (nthreads > nclients && !is_init_mode)
 		nthreads = nclients;
 
 	/*
@@ -6193,6 +6674,8 @@ main(int argc, char **argv)
 		/* aggregate thread level stats */
 		mergeSimpleStats(&stats.latency, &thread->stats.latency);
 		mergeSimpleStats(&stats.lag, &thread->stats.lag);
+		if (latency_percentiles)
+			mergeLatencyHist(&stats, &thread->stats);
 		stats.cnt += thread->stats.cnt;
 		stats.skipped += thread->stats.skipped;
 		latency_late += thread->latency_late;
@@ -146,6 +146,42 @@ pgbench(
 	],
 	'pgbench --init-steps');
 
+# Parallel server-side data generation and primary key creation
+pgbench(
+	'--initialize --init-steps=dtGp --jobs=2 --partitions=3',
+	0,
+	[qr{^$}],
+	[
+		qr{dropping old tables},
+		qr{creating tables},
+		qr{creating 3 partitions},
+		qr{generating data \(server-side\)},
+		qr{loading pgbench_accounts using 2 connections},
+		qr{creating primary keys},
+		qr{done in \d+\.\d\d s }
+	],
+	'pgbench parallel initialization');
+
+pgbench(
+	'--initialize --init-steps=dtGp --jobs=3',
+	0,
+	[qr{^$}],
+	[
+		qr{generating data \(server-side\)},
+		qr{loading pgbench_accounts using 3 connections},
+		qr{creating primary keys},
+		qr{done in \d+\.\d\d s }
+	],
+	'pgbench parallel initialization without partitions');
+
+# The chunks loaded by each connection must cover every account exactly once
+is( $node->safe_psql(
+		'postgres',
+		'SELECT count(*), count(DISTINCT aid), min(aid), max(aid) FROM pgbench_accounts'
+	),
+	'100000|100000|1|100000',
+	'pgbench parallel initialization loads all accounts');
+
 # Run all builtin scripts, for a few transactions each
 pgbench(
 	'--transactions=5 -Dfoo=bla --client=2 --protocol=simple --builtin=t'
@@ -189,6 +225,18 @@ pgbench(
 	],
 	'pgbench select only');
 
+pgbench(
+	'-t 100 -c 2 -b se --no-vacuum --latency-percentiles',
+	0,
+	[
+		qr{processed: 200/200},
+		qr{latency average = \d+\.\d+ ms},
+		qr{latency 50th percentile = \d+\.\d+ ms},
+		qr{latency 99\.9th percentile = \d+\.\d+ ms}
+	],
+	[qr{^$}],
+	'pgbench latency percentiles');
+
 # check if threads are supported
 my $nthreads = 2;
 
@@ -755,6 +803,85 @@ pgbench(
 }
 	});
 
+# Working \startpipeline
+pgbench(
+	'-t 10 -n -M extended',
+	0,
+	[ qr{type: .*/001_pgbench_pipeline}, qr{actually processed: 10/10} ],
+	[],
+	'working \startpipeline',
+	{
+		'001_pgbench_pipeline' => q{
+-- test startpipeline
+\startpipeline
+} . "select 1;\n" x 10 . q{
+\endpipeline
+}
+	});
+
+# Working \startpipeline in prepared query mode
+pgbench(
+	'-t 10 -n -M prepared',
+	0,
+	[ qr{type: .*/001_pgbench_pipeline_prep}, qr{actually processed: 10/10} ],
+	[],
+	'working \startpipeline with prepared statements',
+	{
+		'001_pgbench_pipeline_prep' => q{
+-- test startpipeline
+\startpipeline
+\set x 1
+select :x;
+\set y 2
+select :y;
+\endpipeline
+}
+	});
+
+# Try \startpipeline twice
+pgbench(
+	'-t 1 -n -M extended',
+	2,
+	[],
+	[qr{already in pipeline mode}],
+	'error: call \startpipeline twice',
+	{
+		'001_pgbench_pipeline_2' => q{
+-- startpipeline twice
+\startpipeline
+\startpipeline
+}
+	});
+
+# Try to end a pipeline that hasn't started
+pgbench(
+	'-t 1 -n -M extended',
+	2,
+	[],
+	[qr{not in pipeline mode}],
+	'error: \endpipeline with no start',
+	{
+		'001_pgbench_pipeline_3' => q{
+-- pipeline not started
+\endpipeline
+}
+	});
+
+# Try \gset in pipeline mode
+pgbench(
+	'-t 1 -n -M extended',
+	2,
+	[],
+	[qr{gset and \\aset are not allowed in pipeline mode}],
+	'error: \gset not allowed in pipeline mode',
+	{
+		'001_pgbench_pipeline_4' => q{
+\startpipeline
+select 1 \gset f
+\endpipeline
+}
+	});
+
 # trigger many expression errors
 my @errors = (
 
@@ -1936,6 +1936,9 @@ describeOneTableDetails(const char *schemaname,
 			if (tableinfo.relpersistence == 'u')
 				printfPQExpBuffer(&title, _("Unlogged table \"%s.%s\""),
 								  schemaname, relationname);
+			else if (tableinfo.relpersistence == 'g')
+				printfPQExpBuffer(&title, _("Global temporary table \"%s.%s\""),
+								  schemaname, relationname);
 			else
 				printfPQExpBuffer(&title, _("Table \"%s.%s\""),
 								  schemaname, relationname);
@@ -1956,6 +1959,9 @@ describeOneTableDetails(const char *schemaname,
 			if (tableinfo.relpersistence == 'u')
 				printfPQExpBuffer(&title, _("Unlogged index \"%s.%s\""),
 								  schemaname, relationname);
+			else if (tableinfo.relpersistence == 'g')
+				printfPQExpBuffer(&title, _("Global temporary index \"%s.%s\""),
+								  schemaname, relationname);
 			else
 				printfPQExpBuffer(&title, _("Index \"%s.%s\""),
 								  schemaname, relationname);
@@ -5937,8 +5943,15 @@ describePublications(const char *pattern)
 		if (!puballtables)
 		{
 			printfPQExpBuffer(&buf,
-							  "SELECT n.nspname, c.relname\n"
-							  "FROM pg_catalog.pg_class c,\n"
+							  "SELECT n.nspname, c.relname");
+			if (pset.sversion >= 140000)
+				appendPQExpBufferStr(&buf,
+									 ", pg_catalog.pg_get_expr(pr.prqual, c.oid)");
+			else
+				appendPQExpBufferStr(&buf,
+									 ", NULL");
+			appendPQExpBuffer(&buf,
+							  "\nFROM pg_catalog.pg_class c,\n"
 							  "     pg_catalog.pg_namespace n,\n"
 							  "     pg_catalog.pg_publication_rel pr\n"
 							  "WHERE c.relnamespace = n.oid\n"
@@ -5966,6 +5979,9 @@ describePublications(const char *pattern)
 				printfPQExpBuffer(&buf, "    \"%s.%s\"",
 								  PQgetvalue(tabres, j, 0),
 								  PQgetvalue(tabres, j, 1));
+				if (!PQgetisnull(tabres, j, 2))
+					appendPQExpBuffer(&buf, " WHERE %s",
+									  PQgetvalue(tabres, j, 2));
 
 				printTableAddFooter(&cont, buf.data);
 			}
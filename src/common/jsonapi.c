@@ -19,6 +19,8 @@
 
 #include "common/jsonapi.h"
 #include "mb/pg_wchar.h"
+#include "port/pg_bitutils.h"
+#include "port/pg_simd.h"
 
 #ifdef FRONTEND
 #include "common/logging.h"
@@ -53,6 +55,7 @@ typedef enum					/* contexts of JSON parser */
 } JsonParseContext;
 
 static inline JsonParseErrorType json_lex_string(JsonLexContext *lex);
+static inline int json_count_plain_chars(const char *s, const char *end);
 static inline JsonParseErrorType json_lex_number(JsonLexContext *lex, char *s,
 												 bool *num_err, int *total_len);
 static inline JsonParseErrorType parse_scalar(JsonLexContext *lex, JsonSemAction *sem);
@@ -863,12 +866,28 @@ json_lex_string(JsonLexContext *lex)
 			}
 
 		}
-		else if (lex->strval != NULL)
+		else
 		{
-			if (hi_surrogate != -1)
-				return JSON_UNICODE_LOW_SURROGATE;
+			/*
+			 * An ordinary character.  Deal with the whole run of ordinary
+			 * characters starting here at once.
+			 */
+			int			nplain;
+
+			nplain = 1 + json_count_plain_chars(s + 1,
+												lex->input + lex->input_length);
 
-			appendStringInfoChar(lex->strval, *s);
+			if (lex->strval != NULL)
+			{
+				if (hi_surrogate != -1)
+					return JSON_UNICODE_LOW_SURROGATE;
+
+				appendBinaryStringInfo(lex->strval, s, nplain);
+			}
+
+			/* leave s pointing to the last character of the run */
+			s += nplain - 1;
+			len += nplain - 1;
 		}
 
 	}
@@ -882,6 +901,49 @@ json_lex_string(JsonLexContext *lex)
 	return JSON_SUCCESS;
 }
 
+/*
+ * Return the number of characters at the start of s, which ends just before
+ * end, that need no special handling within a string: anything but a quote,
+ * a backslash or a control character.  Strings are mostly made of these, so
+ * where we can we check a vector's worth of characters at a time.
+ */
+static inline int
+json_count_plain_chars(const char *s, const char *end)
+{
+	const char *p = s;
+
+#ifndef USE_NO_SIMD
+	{
+		const Vector8 quote_vec = vector8_broadcast('"');
+		const Vector8 bs_vec = vector8_broadcast('\\');
+		const Vector8 ctrl_vec = vector8_broadcast(31);
+
+		while (end - p >= (int) sizeof(Vector8))
+		{
+			Vector8		chunk;
+			Vector8		special;
+			uint32		mask;
+
+			vector8_load(&chunk, (const uint8 *) p);
+			special = vector8_or(vector8_eq(chunk, quote_vec),
+								 vector8_eq(chunk, bs_vec));
+			special = vector8_or(special, vector8_le(chunk, ctrl_vec));
+
+			mask = vector8_highbit_mask(special);
+			if (mask != 0)
+				return (p - s) + pg_rightmost_one_pos32(mask);
+
+			p += sizeof(Vector8);
+		}
+	}
+#endif
+
+	while (p < end && *p != '"' && *p != '\\' && (unsigned char) *p >= 32)
+		p++;
+
+	return p - s;
+}
+
 /*
  * The next token in the input stream is known to be a number; lex it.
  *
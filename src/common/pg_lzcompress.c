@@ -824,6 +824,103 @@ pglz_decompress(const char *source, int32 slen, char *dest,
 }
 
 
+/* ----------
+ * pglz_decompress_resume -
+ *
+ *		Like pglz_decompress(), but stops as soon as at least stopsize
+ *		bytes have been produced, so that the caller can look at a prefix
+ *		of the data before deciding whether it needs more.  The next call
+ *		continues where the previous one stopped, so source and dest must
+ *		be the same buffers each time, except that source may have grown.
+ *
+ *		source holds the first slen bytes of the compressed data, and
+ *		source_complete says whether that is all of it.  If it is not,
+ *		decompression also stops before an item that might extend past
+ *		the end of source; the caller must then supply more input.
+ *
+ *		Returns the total number of bytes decompressed into dest so far,
+ *		or -1 if the compressed data is corrupted.
+ * ----------
+ */
+int32
+pglz_decompress_resume(const char *source, int32 slen, bool source_complete,
+					   char *dest, int32 rawsize, int32 stopsize,
+					   PGLZ_DecompressState *state)
+{
+	const unsigned char *sp;
+	const unsigned char *srcend;
+	unsigned char *dp;
+	unsigned char *destend;
+	unsigned char *deststop;
+	int32		ctrl = state->ctrl;
+	int32		ctrlc = state->ctrlc;
+
+	sp = (const unsigned char *) source + state->srcpos;
+	srcend = ((const unsigned char *) source) + slen;
+	dp = (unsigned char *) dest + state->destpos;
+	destend = (unsigned char *) dest + rawsize;
+	deststop = (unsigned char *) dest + Min(stopsize, rawsize);
+
+	while (dp < deststop)
+	{
+		/*
+		 * An item is a literal byte or a match tag of up to 3 bytes, and a
+		 * control byte precedes each group of 8.  Unless we have the whole
+		 * input, don't start on anything that might not be there yet.
+		 */
+		if (ctrlc == 0)
+		{
+			if (sp >= srcend || (!source_complete && srcend - sp < 4))
+				break;
+			ctrl = *sp++;
+			ctrlc = 8;
+		}
+		if (sp >= srcend || (!source_complete && srcend - sp < 3))
+			break;
+
+		if (ctrl & 1)
+		{
+			/* A match tag; see pglz_decompress() */
+			int32		len;
+			int32		off;
+
+			len = (sp[0] & 0x0f) + 3;
+			off = ((sp[0] & 0xf0) << 4) | sp[1];
+			sp += 2;
+			if (len == 18)
+				len += *sp++;
+
+			if (unlikely(sp > srcend || off == 0 ||
+						 off > dp - (unsigned char *) dest))
+				return -1;
+
+			len = Min(len, destend - dp);
+			while (off < len)
+			{
+				memcpy(dp, dp - off, off);
+				len -= off;
+				dp += off;
+				off += off;
+			}
+			memcpy(dp, dp - off, len);
+			dp += len;
+		}
+		else
+			*dp++ = *sp++;
+
+		ctrl >>= 1;
+		ctrlc--;
+	}
+
+	state->srcpos = (const char *) sp - source;
+	state->destpos = (char *) dp - dest;
+	state->ctrl = ctrl;
+	state->ctrlc = ctrlc;
+
+	return state->destpos;
+}
+
+
 /* ----------
  * pglz_max_compressed_size -
  *
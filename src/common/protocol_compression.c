@@ -0,0 +1,565 @@
+/*-------------------------------------------------------------------------
+ *
+ * protocol_compression.c
+ *	  Streaming compression of frontend/backend protocol messages
+ *
+ * When the client asks for it in its startup packet, and the server agrees,
+ * DataRow and CopyData messages are sent compressed.  The sender feeds a run
+ * of such messages, complete with their type bytes and length words, into a
+ * compression stream, and sends the output in a CompressedData message once
+ * it reaches a message that is not compressible, needs to flush its output,
+ * or has compressed PQ_COMPRESSION_BLOCK_SIZE bytes.  The compression
+ * stream is flushed at the end of each CompressedData message, so that the
+ * receiver can decompress it into complete messages right away, but it is
+ * not reset, so later messages still benefit from the history.
+ *
+ * This code is used by both the backend and libpq, so it reports errors by
+ * returning an (untranslated) message, and uses malloc for memory.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/common/protocol_compression.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef FRONTEND
+#include "postgres.h"
+#else
+#include "postgres_fe.h"
+#endif
+
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "common/protocol_compression.h"
+
+struct PqCompressor
+{
+	PqCompressionMethod method;
+#ifdef USE_LZ4
+	LZ4F_cctx  *lz4;
+	bool		lz4_started;	/* frame header written yet? */
+#endif
+#ifdef USE_ZSTD
+	ZSTD_CCtx  *zstd;
+#endif
+};
+
+struct PqDecompressor
+{
+	PqCompressionMethod method;
+#ifdef USE_LZ4
+	LZ4F_dctx  *lz4;
+#endif
+#ifdef USE_ZSTD
+	ZSTD_DCtx  *zstd;
+#endif
+};
+
+/*
+ * zstd level 1 compresses about as fast as LZ4 while still shrinking
+ * typical result sets considerably; higher levels cost far more CPU than
+ * they save in bandwidth.
+ */
+#define PQ_ZSTD_LEVEL	1
+
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+static bool buffer_reserve(PqCompressionBuffer *buf, size_t needed);
+#endif
+
+
+/*
+ * Look up a compression method by name.  Returns false if the name is not
+ * recognized; the method may still not be supported by this build.
+ */
+bool
+pq_compression_parse_method(const char *name, PqCompressionMethod *method)
+{
+	if (pg_strcasecmp(name, "lz4") == 0)
+		*method = PQ_COMPRESSION_LZ4;
+	else if (pg_strcasecmp(name, "zstd") == 0)
+		*method = PQ_COMPRESSION_ZSTD;
+	else
+		return false;
+	return true;
+}
+
+const char *
+pq_compression_method_name(PqCompressionMethod method)
+{
+	switch (method)
+	{
+		case PQ_COMPRESSION_NONE:
+			return "none";
+		case PQ_COMPRESSION_LZ4:
+			return "lz4";
+		case PQ_COMPRESSION_ZSTD:
+			return "zstd";
+	}
+	return "???";
+}
+
+/*
+ * Was this build configured with the library for the given method?
+ */
+bool
+pq_compression_method_supported(PqCompressionMethod method)
+{
+	switch (method)
+	{
+		case PQ_COMPRESSION_NONE:
+			return true;
+		case PQ_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			return true;
+#else
+			return false;
+#endif
+		case PQ_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			return true;
+#else
+			return false;
+#endif
+	}
+	return false;
+}
+
+/*
+ * Pick the first method in a comma-separated list, in order of preference,
+ * that this build supports.  Unknown names are skipped, so that the peer
+ * can list methods we have never heard of.  Returns PQ_COMPRESSION_NONE if
+ * there is no usable method.
+ */
+PqCompressionMethod
+pq_compression_choose_method(const char *list)
+{
+	const char *p = list;
+
+	while (*p)
+	{
+		char		name[32];
+		size_t		len = 0;
+		PqCompressionMethod method;
+
+		while (*p == ' ' || *p == ',')
+			p++;
+		while (*p && *p != ',' && *p != ' ')
+		{
+			if (len < sizeof(name) - 1)
+				name[len++] = *p;
+			p++;
+		}
+		name[len] = '\0';
+
+		if (len > 0 &&
+			pq_compression_parse_method(name, &method) &&
+			pq_compression_method_supported(method))
+			return method;
+	}
+
+	return PQ_COMPRESSION_NONE;
+}
+
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+/*
+ * Make sure there's room for at least 'needed' more bytes in buf.
+ */
+static bool
+buffer_reserve(PqCompressionBuffer *buf, size_t needed)
+{
+	size_t		newlen;
+	char	   *newdata;
+
+	if (buf->maxlen - buf->len >= needed)
+		return true;
+
+	newlen = Max(buf->maxlen, 8192);
+	while (newlen - buf->len < needed)
+		newlen *= 2;
+
+	newdata = realloc(buf->data, newlen);
+	if (newdata == NULL)
+		return false;
+	buf->data = newdata;
+	buf->maxlen = newlen;
+	return true;
+}
+#endif							/* USE_LZ4 || USE_ZSTD */
+
+void
+pq_compression_buffer_free(PqCompressionBuffer *buf)
+{
+	if (buf->data)
+		free(buf->data);
+	buf->data = NULL;
+	buf->len = buf->maxlen = 0;
+}
+
+/*
+ * Create a compression stream.  Returns NULL on out-of-memory, or if the
+ * method is not supported by this build.
+ */
+PqCompressor *
+pq_compressor_create(PqCompressionMethod method)
+{
+	PqCompressor *cs;
+
+	cs = calloc(1, sizeof(PqCompressor));
+	if (cs == NULL)
+		return NULL;
+	cs->method = method;
+
+	switch (method)
+	{
+#ifdef USE_LZ4
+		case PQ_COMPRESSION_LZ4:
+			if (LZ4F_isError(LZ4F_createCompressionContext(&cs->lz4,
+														   LZ4F_VERSION)))
+				break;
+			return cs;
+#endif
+#ifdef USE_ZSTD
+		case PQ_COMPRESSION_ZSTD:
+			cs->zstd = ZSTD_createCCtx();
+			if (cs->zstd == NULL)
+				break;
+			if (ZSTD_isError(ZSTD_CCtx_setParameter(cs->zstd,
+													ZSTD_c_compressionLevel,
+													PQ_ZSTD_LEVEL)))
+				break;
+			return cs;
+#endif
+		default:
+			break;
+	}
+
+	pq_compressor_free(cs);
+	return NULL;
+}
+
+/*
+ * Feed data into the compression stream, appending any output to *out.
+ *
+ * Part of the data may stay buffered in the stream until the next
+ * pq_compress_flush.  Returns false on failure, setting *errmsg.
+ */
+bool
+pq_compress(PqCompressor *cs, const char *data, size_t len,
+			PqCompressionBuffer *out, const char **errmsg)
+{
+	switch (cs->method)
+	{
+#ifdef USE_LZ4
+		case PQ_COMPRESSION_LZ4:
+			{
+				size_t		ret;
+
+				if (!cs->lz4_started)
+				{
+					if (!buffer_reserve(out, LZ4F_HEADER_SIZE_MAX))
+						goto oom;
+					ret = LZ4F_compressBegin(cs->lz4, out->data + out->len,
+											 out->maxlen - out->len, NULL);
+					if (LZ4F_isError(ret))
+					{
+						*errmsg = LZ4F_getErrorName(ret);
+						return false;
+					}
+					out->len += ret;
+					cs->lz4_started = true;
+				}
+
+				while (len > 0)
+				{
+					size_t		chunk = Min(len, PQ_COMPRESSION_BLOCK_SIZE);
+
+					/* the bound covers data left buffered by earlier calls */
+					if (!buffer_reserve(out, LZ4F_compressBound(chunk, NULL)))
+						goto oom;
+					ret = LZ4F_compressUpdate(cs->lz4, out->data + out->len,
+											  out->maxlen - out->len,
+											  data, chunk, NULL);
+					if (LZ4F_isError(ret))
+					{
+						*errmsg = LZ4F_getErrorName(ret);
+						return false;
+					}
+					out->len += ret;
+					data += chunk;
+					len -= chunk;
+				}
+				return true;
+			}
+#endif
+#ifdef USE_ZSTD
+		case PQ_COMPRESSION_ZSTD:
+			{
+				ZSTD_inBuffer in = {data, len, 0};
+
+				while (in.pos < in.size)
+				{
+					ZSTD_outBuffer zout;
+					size_t		ret;
+
+					if (!buffer_reserve(out, ZSTD_CStreamOutSize()))
+						goto oom;
+					zout.dst = out->data + out->len;
+					zout.size = out->maxlen - out->len;
+					zout.pos = 0;
+					ret = ZSTD_compressStream2(cs->zstd, &zout, &in,
+											   ZSTD_e_continue);
+					if (ZSTD_isError(ret))
+					{
+						*errmsg = ZSTD_getErrorName(ret);
+						return false;
+					}
+					out->len += zout.pos;
+				}
+				return true;
+			}
+#endif
+		default:
+			break;
+	}
+
+	*errmsg = "unsupported compression method";
+	return false;
+
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+oom:
+	*errmsg = "out of memory";
+	return false;
+#endif
+}
+
+/*
+ * Flush all data buffered in the compression stream to *out, so that the
+ * receiver can decompress everything compressed so far.
+ */
+bool
+pq_compress_flush(PqCompressor *cs, PqCompressionBuffer *out,
+				  const char **errmsg)
+{
+	switch (cs->method)
+	{
+#ifdef USE_LZ4
+		case PQ_COMPRESSION_LZ4:
+			{
+				size_t		ret;
+
+				if (!cs->lz4_started)
+					return true;	/* nothing compressed yet */
+				if (!buffer_reserve(out, LZ4F_compressBound(0, NULL)))
+					goto oom;
+				ret = LZ4F_flush(cs->lz4, out->data + out->len,
+								 out->maxlen - out->len, NULL);
+				if (LZ4F_isError(ret))
+				{
+					*errmsg = LZ4F_getErrorName(ret);
+					return false;
+				}
+				out->len += ret;
+				return true;
+			}
+#endif
+#ifdef USE_ZSTD
+		case PQ_COMPRESSION_ZSTD:
+			{
+				ZSTD_inBuffer in = {NULL, 0, 0};
+				size_t		ret;
+
+				do
+				{
+					ZSTD_outBuffer zout;
+
+					if (!buffer_reserve(out, ZSTD_CStreamOutSize()))
+						goto oom;
+					zout.dst = out->data + out->len;
+					zout.size = out->maxlen - out->len;
+					zout.pos = 0;
+					ret = ZSTD_compressStream2(cs->zstd, &zout, &in,
+											   ZSTD_e_flush);
+					if (ZSTD_isError(ret))
+					{
+						*errmsg = ZSTD_getErrorName(ret);
+						return false;
+					}
+					out->len += zout.pos;
+				} while (ret != 0);
+				return true;
+			}
+#endif
+		default:
+			break;
+	}
+
+	*errmsg = "unsupported compression method";
+	return false;
+
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+oom:
+	*errmsg = "out of memory";
+	return false;
+#endif
+}
+
+void
+pq_compressor_free(PqCompressor *cs)
+{
+	if (cs == NULL)
+		return;
+#ifdef USE_LZ4
+	if (cs->lz4)
+		LZ4F_freeCompressionContext(cs->lz4);
+#endif
+#ifdef USE_ZSTD
+	if (cs->zstd)
+		ZSTD_freeCCtx(cs->zstd);
+#endif
+	free(cs);
+}
+
+/*
+ * Create a decompression stream.  Returns NULL on out-of-memory, or if the
+ * method is not supported by this build.
+ */
+PqDecompressor *
+pq_decompressor_create(PqCompressionMethod method)
+{
+	PqDecompressor *ds;
+
+	ds = calloc(1, sizeof(PqDecompressor));
+	if (ds == NULL)
+		return NULL;
+	ds->method = method;
+
+	switch (method)
+	{
+#ifdef USE_LZ4
+		case PQ_COMPRESSION_LZ4:
+			if (LZ4F_isError(LZ4F_createDecompressionContext(&ds->lz4,
+															 LZ4F_VERSION)))
+				break;
+			return ds;
+#endif
+#ifdef USE_ZSTD
+		case PQ_COMPRESSION_ZSTD:
+			ds->zstd = ZSTD_createDCtx();
+			if (ds->zstd == NULL)
+				break;
+			return ds;
+#endif
+		default:
+			break;
+	}
+
+	pq_decompressor_free(ds);
+	return NULL;
+}
+
+/*
+ * Decompress the contents of one CompressedData message, appending the
+ * output to *out.  Since the sender flushes its stream at the end of each
+ * message, all of the output is available once the input is consumed.
+ */
+bool
+pq_decompress(PqDecompressor *ds, const char *data, size_t len,
+			  PqCompressionBuffer *out, const char **errmsg)
+{
+	switch (ds->method)
+	{
+#ifdef USE_LZ4
+		case PQ_COMPRESSION_LZ4:
+			for (;;)
+			{
+				size_t		avail;
+				size_t		dstsize;
+				size_t		srcsize = len;
+				size_t		ret;
+
+				if (!buffer_reserve(out, PQ_COMPRESSION_BLOCK_SIZE))
+					goto oom;
+				avail = dstsize = out->maxlen - out->len;
+				ret = LZ4F_decompress(ds->lz4, out->data + out->len, &dstsize,
+									  data, &srcsize, NULL);
+				if (LZ4F_isError(ret))
+				{
+					*errmsg = LZ4F_getErrorName(ret);
+					return false;
+				}
+				out->len += dstsize;
+				data += srcsize;
+				len -= srcsize;
+
+				/* done once the input is used up and the output didn't fill */
+				if (len == 0 && dstsize < avail)
+					return true;
+			}
+#endif
+#ifdef USE_ZSTD
+		case PQ_COMPRESSION_ZSTD:
+			{
+				ZSTD_inBuffer in = {data, len, 0};
+
+				for (;;)
+				{
+					ZSTD_outBuffer zout;
+					size_t		ret;
+
+					if (!buffer_reserve(out, ZSTD_DStreamOutSize()))
+						goto oom;
+					zout.dst = out->data + out->len;
+					zout.size = out->maxlen - out->len;
+					zout.pos = 0;
+					ret = ZSTD_decompressStream(ds->zstd, &zout, &in);
+					if (ZSTD_isError(ret))
+					{
+						*errmsg = ZSTD_getErrorName(ret);
+						return false;
+					}
+					out->len += zout.pos;
+
+					/* done once the input is used up and the output didn't fill */
+					if (in.pos == in.size && zout.pos < zout.size)
+						return true;
+				}
+			}
+#endif
+		default:
+			break;
+	}
+
+	*errmsg = "unsupported compression method";
+	return false;
+
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+oom:
+	*errmsg = "out of memory";
+	return false;
+#endif
+}
+
+void
+pq_decompressor_free(PqDecompressor *ds)
+{
+	if (ds == NULL)
+		return;
+#ifdef USE_LZ4
+	if (ds->lz4)
+		LZ4F_freeDecompressionContext(ds->lz4);
+#endif
+#ifdef USE_ZSTD
+	if (ds->zstd)
+		ZSTD_freeDCtx(ds->zstd);
+#endif
+	free(ds);
+}
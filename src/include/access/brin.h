@@ -10,7 +10,9 @@
 #ifndef BRIN_H
 #define BRIN_H
 
+#include "catalog/pg_am_d.h"
 #include "nodes/execnodes.h"
+#include "storage/shm_toc.h"
 #include "utils/relcache.h"
 
 
@@ -51,5 +53,6 @@ typedef struct BrinStatsData
 
 
 extern void brinGetStats(Relation index, BrinStatsData *stats);
+extern void _brin_parallel_build_main(dsm_segment *seg, shm_toc *toc);
 
 #endif							/* BRIN_H */
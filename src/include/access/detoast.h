@@ -12,6 +12,25 @@
 #ifndef DETOAST_H
 #define DETOAST_H
 
+/*
+ * Access the fields packed into va_extinfo of a TOAST pointer: the actual
+ * length of the external data, and the ID of the method it was compressed
+ * with (meaningful only if it is compressed).
+ */
+#define VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer) \
+	((toast_pointer).va_extinfo & VARLENA_EXTSIZE_MASK)
+#define VARATT_EXTERNAL_GET_COMPRESS_METHOD(toast_pointer) \
+	((toast_pointer).va_extinfo >> VARLENA_EXTSIZE_BITS)
+
+#define VARATT_EXTERNAL_SET_SIZE_AND_COMPRESS_METHOD(toast_pointer, len, cm) \
+	do { \
+		Assert((cm) == TOAST_PGLZ_COMPRESSION_ID || \
+			   (cm) == TOAST_LZ4_COMPRESSION_ID || \
+			   (cm) == TOAST_ZSTD_COMPRESSION_ID); \
+		((toast_pointer).va_extinfo = \
+			(len) | ((uint32) (cm) << VARLENA_EXTSIZE_BITS)); \
+	} while (0)
+
 /*
  * Testing whether an externally-stored value is compressed now requires
  * comparing extsize (the actual length of the external data) to rawsize
@@ -20,7 +39,8 @@
  * saves space, so we expect either equality or less-than.
  */
 #define VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer) \
-	((toast_pointer).va_extsize < (toast_pointer).va_rawsize - VARHDRSZ)
+	(VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer) < \
+	 (toast_pointer).va_rawsize - VARHDRSZ)
 
 /*
  * Macro to fetch the possibly-unaligned contents of an EXTERNAL datum
@@ -73,6 +93,23 @@ extern struct varlena *detoast_attr_slice(struct varlena *attr,
 										  int32 sliceoffset,
 										  int32 slicelength);
 
+/* ----------
+ * detoast_iterator_begin() -
+ * detoast_iterator_fetch() -
+ * detoast_iterator_end() -
+ *
+ *		Detoast an attribute incrementally from the front, for callers
+ *		that may be able to decide what they want from a prefix of it
+ *		but don't know in advance how long a prefix.
+ * ----------
+ */
+typedef struct DetoastIteratorData *DetoastIterator;
+
+extern DetoastIterator detoast_iterator_begin(struct varlena *attr);
+extern char *detoast_iterator_fetch(DetoastIterator iter, int32 length,
+									int32 *avail);
+extern void detoast_iterator_end(DetoastIterator iter);
+
 /* ----------
  * toast_raw_datum_size -
  *
@@ -18,6 +18,7 @@
 #include "fmgr.h"
 #include "lib/rbtree.h"
 #include "storage/bufmgr.h"
+#include "storage/shm_toc.h"
 
 /*
  * Storage type for GIN's reloptions
@@ -121,6 +122,7 @@ extern void ginEntryInsert(GinState *ginstate,
 						   OffsetNumber attnum, Datum key, GinNullCategory category,
 						   ItemPointerData *items, uint32 nitem,
 						   GinStatsData *buildStats);
+extern void _gin_parallel_build_main(dsm_segment *seg, shm_toc *toc);
 
 /* ginbtree.c */
 
@@ -18,8 +18,10 @@
 #include "access/gist.h"
 #include "access/itup.h"
 #include "lib/pairingheap.h"
+#include "port/atomics.h"
 #include "storage/bufmgr.h"
 #include "storage/buffile.h"
+#include "storage/shm_toc.h"
 #include "utils/hsearch.h"
 #include "access/genam.h"
 
@@ -95,6 +97,12 @@ typedef struct GISTSTATE
 
 	/* Collations to pass to the support functions */
 	Oid			supportCollation[INDEX_MAX_KEYS];
+
+	/*
+	 * In a parallel index build, the participants' shared counter that hands
+	 * out build-time LSNs; NULL otherwise.
+	 */
+	pg_atomic_uint64 *buildLSN;
 } GISTSTATE;
 
 
@@ -549,6 +557,7 @@ extern void gistSplitByKey(Relation r, Page page, IndexTuple *itup,
 extern IndexBuildResult *gistbuild(Relation heap, Relation index,
 								   struct IndexInfo *indexInfo);
 extern void gistValidateBufferingOption(const char *value);
+extern void _gist_parallel_build_main(dsm_segment *seg, shm_toc *toc);
 
 /* gistbuildbuffers.c */
 extern GISTBuildBuffers *gistInitBuildBuffers(int pagesPerBuffer, int levelStep,
@@ -25,6 +25,7 @@
 #include "lib/stringinfo.h"
 #include "storage/bufmgr.h"
 #include "storage/lockdefs.h"
+#include "storage/shm_toc.h"
 #include "utils/hsearch.h"
 #include "utils/relcache.h"
 
@@ -443,11 +444,16 @@ extern bool _hash_first(IndexScanDesc scan, ScanDirection dir);
 /* hashsort.c */
 typedef struct HSpool HSpool;	/* opaque struct in hashsort.c */
 
-extern HSpool *_h_spoolinit(Relation heap, Relation index, uint32 num_buckets);
+extern HSpool *_h_spoolinit(Relation heap, Relation index, uint32 num_buckets,
+							struct IndexInfo *indexInfo);
 extern void _h_spooldestroy(HSpool *hspool);
+extern bool _h_spool_is_parallel(HSpool *hspool);
 extern void _h_spool(HSpool *hspool, ItemPointer self,
 					 Datum *values, bool *isnull);
+extern double _h_parallel_heapscan(HSpool *hspool, double *indtuples,
+								   bool *brokenhotchain);
 extern void _h_indexbuild(HSpool *hspool, Relation heapRel);
+extern void _h_parallel_build_main(dsm_segment *seg, shm_toc *toc);
 
 /* hashutil.c */
 extern bool _hash_checkqual(IndexScanDesc scan, IndexTuple itup);
@@ -16,6 +16,7 @@
 
 #include "access/htup.h"
 #include "storage/buf.h"
+#include "storage/bufpage.h"
 #include "utils/relcache.h"
 
 /*
@@ -24,12 +25,22 @@
  * If current_buf isn't InvalidBuffer, then we are holding an extra pin
  * on that buffer.
  *
+ * The load_* fields are used by heap_multi_insert() with HEAP_INSERT_BULK_LOAD,
+ * which fills load_page in private memory and writes it directly to storage
+ * as block load_blkno once it's full.  load_rel is NULL until then.
+ *
  * "typedef struct BulkInsertStateData *BulkInsertState" is in heapam.h
  */
 typedef struct BulkInsertStateData
 {
 	BufferAccessStrategy strategy;	/* our BULKWRITE strategy object */
 	Buffer		current_buf;	/* current insertion target page */
+
+	Relation	load_rel;		/* relation being bulk loaded, or NULL */
+	Page		load_page;		/* page being filled */
+	bool		load_page_valid;	/* load_page holds any tuples? */
+	BlockNumber load_first_blkno;	/* first block we wrote */
+	BlockNumber load_blkno;		/* block number of load_page */
 } BulkInsertStateData;
 
 
@@ -854,6 +854,12 @@ typedef struct BTScanPosData
 	int			lastItem;		/* last valid index in items[] */
 	int			itemIndex;		/* current index in items[] */
 
+	/*
+	 * nextPrefetch is the next entry in items[] whose heap block might need
+	 * to be prefetched, in the direction of the scan; see _bt_prefetch_heap.
+	 */
+	int			nextPrefetch;
+
 	BTScanPosItem items[MaxTIDsPerBTreePage];	/* MUST BE LAST */
 } BTScanPosData;
 
@@ -917,6 +923,15 @@ typedef struct BTScanOpaqueData
 	BTArrayKeyInfo *arrayKeys;	/* info about each equality-type array key */
 	MemoryContext arrayContext; /* scan-lifespan context for array data */
 
+	/*
+	 * workspace for skip scans; the skip key itself is arrayKeyData[0] (see
+	 * _bt_preprocess_skip_key)
+	 */
+	bool		skipScan;		/* stepping through leading column values? */
+	FmgrInfo	skipEqFunc;		/* "=" operator proc for leading column */
+	Datum		skipMarkValue;	/* skip key value saved by btmarkpos */
+	bool		skipMarkIsNull; /* is skipMarkValue NULL? */
+
 	/* info about killed items if any (killedItems is NULL if never used) */
 	int		   *killedItems;	/* currPos.items indexes of killed items */
 	int			numKilled;		/* number of currently stored items */
@@ -938,6 +953,14 @@ typedef struct BTScanOpaqueData
 	 */
 	int			markItemIndex;	/* itemIndex, or -1 if not valid */
 
+	/*
+	 * Heap prefetching for plain index scans: how many items ahead of the
+	 * current one to prefetch (-1 until the first btgettuple call, 0 if
+	 * disabled), and the last heap block prefetched.
+	 */
+	int			prefetchMaximum;
+	BlockNumber lastPrefetchBlock;
+
 	/* keep these last in struct for efficiency */
 	BTScanPosData currPos;		/* current position data */
 	BTScanPosData markPos;		/* marked position, if any */
@@ -989,6 +1012,9 @@ typedef struct BTOptions
 #define PROGRESS_BTREE_PHASE_PERFORMSORT_2				4
 #define PROGRESS_BTREE_PHASE_LEAF_LOAD					5
 
+/* GUC parameter, in nbtree.c */
+extern PGDLLIMPORT bool btree_heap_prefetch;
+
 /*
  * external entry points for btree, in nbtree.c
  */
@@ -1099,6 +1125,7 @@ extern OffsetNumber _bt_binsrch_insert(Relation rel, BTInsertState insertstate);
 extern int32 _bt_compare(Relation rel, BTScanInsert key, Page page, OffsetNumber offnum);
 extern bool _bt_first(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_next(IndexScanDesc scan, ScanDirection dir);
+extern bool _bt_skip_probe(IndexScanDesc scan, ScanDirection dir, bool first);
 extern Buffer _bt_get_endpoint(Relation rel, uint32 level, bool rightmost,
 							   Snapshot snapshot);
 
@@ -1112,6 +1139,10 @@ extern void _bt_start_array_keys(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_advance_array_keys(IndexScanDesc scan, ScanDirection dir);
 extern void _bt_mark_array_keys(IndexScanDesc scan);
 extern void _bt_restore_array_keys(IndexScanDesc scan);
+extern void _bt_preprocess_skip_key(IndexScanDesc scan);
+extern void _bt_set_skip_key(IndexScanDesc scan, Datum value, bool isnull);
+extern void _bt_mark_skip_key(IndexScanDesc scan);
+extern void _bt_restore_skip_key(IndexScanDesc scan);
 extern void _bt_preprocess_keys(IndexScanDesc scan);
 extern bool _bt_checkkeys(IndexScanDesc scan, IndexTuple tuple,
 						  int tupnatts, ScanDirection dir, bool *continuescan);
@@ -36,6 +36,10 @@ typedef struct TableScanDescData
 	int			rs_nkeys;		/* number of scan keys */
 	struct ScanKeyData *rs_key; /* array of scan key descriptors */
 
+	/* Range of ItemPointers for table_scan_getnextslot_tidrange() to scan. */
+	ItemPointerData rs_mintid;
+	ItemPointerData rs_maxtid;
+
 	/*
 	 * Information about type and behaviour of the scan, a bitmask of members
 	 * of the ScanOptions enum (see tableam.h).
@@ -148,6 +152,15 @@ typedef struct IndexScanDescData
 
 	bool		xs_recheck;		/* T means scan keys must be rechecked */
 
+	/*
+	 * An index AM that loads all the matching TIDs of an index page at once,
+	 * while holding the page's buffer lock, can advance xs_batchno each time
+	 * it does so, starting from 1.  Zero means that the AM makes no such
+	 * promise.  Index-only scans use this to decide how long a visibility
+	 * map lookup stays valid; see IndexOnlyNext.
+	 */
+	uint64		xs_batchno;
+
 	/*
 	 * When fetching with an ordering operator, the values of the ORDER BY
 	 * expressions of the last returned tuple, according to the index.  If
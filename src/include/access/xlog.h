@@ -110,15 +110,17 @@ extern int	max_wal_size_mb;
 extern int	wal_keep_size_mb;
 extern int	max_slot_wal_keep_size_mb;
 extern int	XLOGbuffers;
+extern int	NumXLogInsertLocks;
 extern int	XLogArchiveTimeout;
 extern int	wal_retrieve_retry_interval;
 extern char *XLogArchiveCommand;
 extern bool EnableHotStandby;
 extern bool fullPageWrites;
 extern bool wal_log_hints;
-extern bool wal_compression;
+extern int	wal_compression;
 extern bool wal_init_zero;
 extern bool wal_recycle;
+extern int	wal_prealloc_segments;
 extern bool *wal_consistency_checking;
 extern char *wal_consistency_checking_string;
 extern bool log_checkpoints;
@@ -158,6 +160,15 @@ typedef enum ArchiveMode
 } ArchiveMode;
 extern int	XLogArchiveMode;
 
+/* Compression algorithms for WAL full-page images */
+typedef enum WalCompression
+{
+	WAL_COMPRESSION_NONE = 0,
+	WAL_COMPRESSION_PGLZ,
+	WAL_COMPRESSION_LZ4,
+	WAL_COMPRESSION_ZSTD
+} WalCompression;
+
 /* WAL levels */
 typedef enum WalLevel
 {
@@ -211,6 +222,12 @@ extern PGDLLIMPORT int wal_level;
 extern bool XLOG_DEBUG;
 #endif
 
+/*
+ * Upper limit for wal_insert_locks.  WALInsertLockAcquireExclusive() holds
+ * all of the locks at once, which must stay well below MAX_SIMUL_LWLOCKS.
+ */
+#define MAX_XLOGINSERT_LOCKS	128
+
 /*
  * OR-able request flag bits for checkpoints.  The "cause" bits are used only
  * for logging purposes.  Note: the flags must be defined so that it's
@@ -283,9 +300,11 @@ struct XLogRecData;
 extern XLogRecPtr XLogInsertRecord(struct XLogRecData *rdata,
 								   XLogRecPtr fpw_lsn,
 								   uint8 flags,
-								   int num_fpi);
+								   int num_fpi,
+								   uint32 fpi_bytes);
 extern void XLogFlush(XLogRecPtr RecPtr);
 extern bool XLogBackgroundFlush(void);
+extern bool XLogPreallocFutureSegments(void);
 extern bool XLogNeedsFlush(XLogRecPtr RecPtr);
 extern int	XLogFileInit(XLogSegNo segno, bool *use_existent, bool use_lock);
 extern int	XLogFileOpen(XLogSegNo segno);
@@ -310,6 +329,8 @@ extern void GetXLogReceiptTime(TimestampTz *rtime, bool *fromStream);
 extern XLogRecPtr GetXLogReplayRecPtr(TimeLineID *replayTLI);
 extern XLogRecPtr GetXLogInsertRecPtr(void);
 extern XLogRecPtr GetXLogWriteRecPtr(void);
+extern Size XLogReadFromBuffers(char *dstbuf, XLogRecPtr startptr, Size count,
+								TimeLineID tli);
 extern bool RecoveryIsPaused(void);
 extern void SetRecoveryPause(bool recoveryPause);
 extern TimestampTz GetLatestXTime(void);
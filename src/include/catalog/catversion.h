@@ -53,6 +53,6 @@
  */
 
 /*							yyyymmddN */
-#define CATALOG_VERSION_NO	202011251
+#define CATALOG_VERSION_NO	202011267
 
 #endif
@@ -0,0 +1,25 @@
+/*-------------------------------------------------------------------------
+ *
+ * globaltemp.h
+ *	  prototypes for functions in backend/catalog/globaltemp.c
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/catalog/globaltemp.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef GLOBALTEMP_H
+#define GLOBALTEMP_H
+
+#include "utils/relcache.h"
+
+extern void GlobalTempStorageRemember(Relation rel);
+extern bool GlobalTempRelationHasStorage(Oid relid);
+extern void GlobalTempRelationInitStorage(Relation rel);
+extern void GlobalTempRelationResetStorage(Relation rel);
+extern void GlobalTempStorageDiscardAll(void);
+
+#endif							/* GLOBALTEMP_H */
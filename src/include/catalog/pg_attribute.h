@@ -121,6 +121,13 @@ CATALOG(pg_attribute,1249,AttributeRelationId) BKI_BOOTSTRAP BKI_ROWTYPE_OID(75,
 	 */
 	char		attalign;
 
+	/*
+	 * Compression method for compressing values of this attribute inline,
+	 * one of the TOAST_*_COMPRESSION constants in access/toast_compression.h.
+	 * '\0' means that default_toast_compression is used.
+	 */
+	char		attcompression BKI_DEFAULT('\0');
+
 	/* This flag represents the "NOT NULL" constraint */
 	bool		attnotnull;
 
@@ -85,9 +85,20 @@ typedef struct Publication
 	PublicationActions pubactions;
 } Publication;
 
+/*
+ * A relation being added to a publication, with its row filter, which must
+ * already have gone through parse analysis.
+ */
+typedef struct PublicationRelInfo
+{
+	Relation	relation;
+	Node	   *whereClause;	/* qualifications, or NULL */
+} PublicationRelInfo;
+
 extern Publication *GetPublication(Oid pubid);
 extern Publication *GetPublicationByName(const char *pubname, bool missing_ok);
 extern List *GetRelationPublications(Oid relid);
+extern bool PublicationRelHasRowFilter(Oid pubid, Oid relid);
 
 /*---------
  * Expected values for pub_partopt parameter of GetRelationPublications(),
@@ -110,7 +121,8 @@ extern List *GetAllTablesPublications(void);
 extern List *GetAllTablesPublicationRelations(bool pubviaroot);
 
 extern bool is_publishable_relation(Relation rel);
-extern ObjectAddress publication_add_relation(Oid pubid, Relation targetrel,
+extern ObjectAddress publication_add_relation(Oid pubid,
+											  PublicationRelInfo *targetrel,
 											  bool if_not_exists);
 
 extern Oid	get_publication_oid(const char *pubname, bool missing_ok);
@@ -17,6 +17,8 @@
 #include "nodes/execnodes.h"
 #include "nodes/parsenodes.h"
 #include "parser/parse_node.h"
+#include "storage/dsm.h"
+#include "storage/shm_toc.h"
 #include "tcop/dest.h"
 
 /*
@@ -31,6 +33,8 @@ typedef struct CopyFormatOptions
 								 * -1 if not specified */
 	bool		binary;			/* binary format? */
 	bool		freeze;			/* freeze rows on loading? */
+	int			nworkers;		/* number of parallel workers requested for
+								 * COPY FROM, 0 for a serial copy */
 	bool		csv_mode;		/* Comma Separated Value format? */
 	bool		header_line;	/* CSV header line? */
 	char	   *null_print;		/* NULL marker string (server encoding!) */
@@ -73,6 +77,9 @@ extern void CopyFromErrorCallback(void *arg);
 
 extern uint64 CopyFrom(CopyFromState cstate);
 
+extern void ParallelCopyMain(dsm_segment *seg, shm_toc *toc);
+extern void ParallelCopyToMain(dsm_segment *seg, shm_toc *toc);
+
 extern DestReceiver *CreateCopyDestReceiver(void);
 
 /*
@@ -85,6 +85,7 @@ typedef struct CopyFromStateData
 	char	   *filename;		/* filename, or NULL for STDIN */
 	bool		is_program;		/* is 'filename' a program to popen? */
 	copy_data_source_cb data_source_cb; /* function for reading data */
+	List	   *options;		/* raw COPY options, for parallel workers */
 
 	CopyFormatOptions opts;
 	bool	   *convert_select_flags;	/* per-column CSV/TEXT CS flags */
@@ -160,5 +161,10 @@ typedef struct CopyFromStateData
 
 extern void ReceiveCopyBegin(CopyFromState cstate);
 extern void ReceiveCopyBinaryHeader(CopyFromState cstate);
+extern bool CopyReadRawLine(CopyFromState cstate);
+
+/* in copyparallel.c */
+extern bool IsParallelCopyAllowed(CopyFromState cstate);
+extern bool ParallelCopyFrom(CopyFromState cstate, uint64 *processed);
 
 #endif							/* COPYFROM_INTERNAL_H */
@@ -140,6 +140,7 @@ typedef struct TransitionCaptureState
 #define SESSION_REPLICATION_ROLE_REPLICA	1
 #define SESSION_REPLICATION_ROLE_LOCAL		2
 extern PGDLLIMPORT int SessionReplicationRole;
+extern PGDLLIMPORT int after_trigger_queue_mem;
 
 /*
  * States at which a trigger can be fired. These are the
@@ -258,6 +259,11 @@ extern bool RI_Initial_Check(Trigger *trigger,
 							 Relation fk_rel, Relation pk_rel);
 extern void RI_PartitionRemove_Check(Trigger *trigger, Relation fk_rel,
 									 Relation pk_rel);
+extern void RI_FlushPendingChecks(void);
+extern void RI_EndSubXactPendingChecks(bool isCommit);
+extern void RI_EndXactPendingChecks(void);
+
+extern PGDLLIMPORT int foreign_key_check_batch_size;
 
 /* result values for RI_FKey_trigger_type: */
 #define RI_TRIGGER_PK	1		/* is a trigger on the PK relation */
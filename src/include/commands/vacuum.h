@@ -222,6 +222,8 @@ typedef struct VacuumParams
 										 * default value depends on reloptions */
 	VacOptTernaryValue truncate;	/* Truncate empty pages at the end,
 									 * default value depends on reloptions */
+	bool		insert_mostly;	/* table is mostly inserted into, so freeze
+								 * all-visible pages eagerly */
 
 	/*
 	 * The number of parallel vacuum workers.  0 by default which means choose
@@ -237,6 +239,7 @@ extern int	vacuum_freeze_min_age;
 extern int	vacuum_freeze_table_age;
 extern int	vacuum_multixact_freeze_min_age;
 extern int	vacuum_multixact_freeze_table_age;
+extern bool vacuum_eager_freeze;
 
 /* Variables for cost-based parallel vacuum */
 extern pg_atomic_uint32 *VacuumSharedCostBalance;
@@ -79,6 +79,22 @@ extern const PGLZ_Strategy *const PGLZ_strategy_default;
 extern const PGLZ_Strategy *const PGLZ_strategy_always;
 
 
+/* ----------
+ * PGLZ_DecompressState -
+ *
+ *		Progress of a decompression done in steps by
+ *		pglz_decompress_resume().  Must be zeroed before the first step.
+ * ----------
+ */
+typedef struct PGLZ_DecompressState
+{
+	int32		srcpos;			/* compressed bytes consumed so far */
+	int32		destpos;		/* bytes decompressed so far */
+	int32		ctrl;			/* unused bits of the current control byte */
+	int32		ctrlc;			/* number of items still under it */
+} PGLZ_DecompressState;
+
+
 /* ----------
  * Global function declarations
  * ----------
@@ -87,6 +103,10 @@ extern int32 pglz_compress(const char *source, int32 slen, char *dest,
 						   const PGLZ_Strategy *strategy);
 extern int32 pglz_decompress(const char *source, int32 slen, char *dest,
 							 int32 rawsize, bool check_complete);
+extern int32 pglz_decompress_resume(const char *source, int32 slen,
+									bool source_complete, char *dest,
+									int32 rawsize, int32 stopsize,
+									PGLZ_DecompressState *state);
 extern int32 pglz_maximum_compressed_size(int32 rawsize,
 										  int32 total_compressed_size);
 
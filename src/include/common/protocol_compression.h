@@ -0,0 +1,76 @@
+/*-------------------------------------------------------------------------
+ *
+ * protocol_compression.h
+ *	  Streaming compression of frontend/backend protocol messages
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/common/protocol_compression.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PROTOCOL_COMPRESSION_H
+#define PROTOCOL_COMPRESSION_H
+
+/*
+ * Name of the startup packet option in which the client lists the methods
+ * it accepts, and of the ParameterStatus message in which the server
+ * reports the one it chose.
+ */
+#define PQ_COMPRESSION_OPTION	"_pq_.compression"
+
+/* Message type of a CompressedData message */
+#define PQ_MSG_COMPRESSED_DATA	'z'
+
+/*
+ * Message types whose messages are compressed: DataRow and CopyData.  (The
+ * backend only ever compresses both, the frontend only sends CopyData.)
+ */
+#define PQ_MSG_IS_COMPRESSIBLE(type)	((type) == 'D' || (type) == 'd')
+
+/*
+ * A CompressedData message is closed off once this much uncompressed data
+ * has gone into it, so that the receiver can start on it.
+ */
+#define PQ_COMPRESSION_BLOCK_SIZE	(64 * 1024)
+
+typedef enum PqCompressionMethod
+{
+	PQ_COMPRESSION_NONE,
+	PQ_COMPRESSION_LZ4,
+	PQ_COMPRESSION_ZSTD
+} PqCompressionMethod;
+
+/* Output buffer, malloc'd and enlarged as needed */
+typedef struct PqCompressionBuffer
+{
+	char	   *data;
+	size_t		len;
+	size_t		maxlen;
+} PqCompressionBuffer;
+
+typedef struct PqCompressor PqCompressor;
+typedef struct PqDecompressor PqDecompressor;
+
+extern bool pq_compression_parse_method(const char *name,
+										PqCompressionMethod *method);
+extern const char *pq_compression_method_name(PqCompressionMethod method);
+extern bool pq_compression_method_supported(PqCompressionMethod method);
+extern PqCompressionMethod pq_compression_choose_method(const char *list);
+
+extern PqCompressor *pq_compressor_create(PqCompressionMethod method);
+extern bool pq_compress(PqCompressor *cs, const char *data, size_t len,
+						PqCompressionBuffer *out, const char **errmsg);
+extern bool pq_compress_flush(PqCompressor *cs, PqCompressionBuffer *out,
+							  const char **errmsg);
+extern void pq_compressor_free(PqCompressor *cs);
+
+extern PqDecompressor *pq_decompressor_create(PqCompressionMethod method);
+extern bool pq_decompress(PqDecompressor *ds, const char *data, size_t len,
+						  PqCompressionBuffer *out, const char **errmsg);
+extern void pq_decompressor_free(PqDecompressor *ds);
+
+extern void pq_compression_buffer_free(PqCompressionBuffer *buf);
+
+#endif							/* PROTOCOL_COMPRESSION_H */
@@ -18,6 +18,8 @@
 #include "nodes/execnodes.h"
 #include "storage/buffile.h"
 
+extern PGDLLIMPORT bool enable_hashjoin_bloom_filter;
+
 extern HashJoinState *ExecInitHashJoin(HashJoin *node, EState *estate, int eflags);
 extern void ExecEndHashJoin(HashJoinState *node);
 extern void ExecReScanHashJoin(HashJoinState *node);
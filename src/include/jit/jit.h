@@ -89,6 +89,7 @@ extern bool jit_tuple_deforming;
 extern double jit_above_cost;
 extern double jit_inline_above_cost;
 extern double jit_optimize_above_cost;
+extern int	jit_defer_evaluations;
 
 
 extern void jit_reset_after_error(void);
@@ -98,6 +99,7 @@ extern void jit_release_context(JitContext *context);
  * Functions for attempting to JIT code. Callers must accept that these might
  * not be able to perform JIT (i.e. return false).
  */
+extern bool jit_expr_wanted(struct ExprState *state);
 extern bool jit_compile_expr(struct ExprState *state);
 extern void InstrJitAgg(JitInstrumentation *dst, JitInstrumentation *add);
 
@@ -53,6 +53,9 @@ typedef struct LLVMJitContext
 
 	/* list of handles for code emitted via Orc */
 	List	   *handles;
+
+	/* deform functions in the current module, to be added to the cache */
+	List	   *deform_pending;
 } LLVMJitContext;
 
 /* llvm module containing information about types */
@@ -108,6 +111,8 @@ extern void llvm_inline(LLVMModuleRef mod);
  */
 extern bool llvm_compile_expr(struct ExprState *state);
 struct TupleTableSlotOps;
+extern void llvm_deform_cache_publish(struct LLVMJitContext *context);
+extern void llvm_deform_cache_discard(struct LLVMJitContext *context);
 extern LLVMValueRef slot_compile_deform(struct LLVMJitContext *context, TupleDesc desc,
 										const struct TupleTableSlotOps *ops, int natts);
 
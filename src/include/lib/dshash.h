@@ -59,6 +59,21 @@ typedef struct dshash_parameters
 struct dshash_table_item;
 typedef struct dshash_table_item dshash_table_item;
 
+/*
+ * Sequential scan state.  The details are private to dshash.c, but the
+ * struct is exposed so callers can allocate it on the stack.
+ */
+typedef struct dshash_seq_status
+{
+	dshash_table *hash_table;	/* table being scanned */
+	int			curbucket;		/* current bucket number */
+	int			nbuckets;		/* total number of buckets */
+	dshash_table_item *curitem; /* item most recently returned */
+	dsa_pointer pnextitem;		/* next item in the current bucket */
+	int			curpartition;	/* partition currently locked, or -1 */
+	bool		exclusive;		/* lock partitions exclusively? */
+} dshash_seq_status;
+
 /* Creating, sharing and destroying from hash tables. */
 extern dshash_table *dshash_create(dsa_area *area,
 								   const dshash_parameters *params,
@@ -80,6 +95,13 @@ extern bool dshash_delete_key(dshash_table *hash_table, const void *key);
 extern void dshash_delete_entry(dshash_table *hash_table, void *entry);
 extern void dshash_release_lock(dshash_table *hash_table, void *entry);
 
+/* Sequential scans over all entries. */
+extern void dshash_seq_init(dshash_seq_status *status, dshash_table *hash_table,
+							bool exclusive);
+extern void *dshash_seq_next(dshash_seq_status *status);
+extern void dshash_seq_term(dshash_seq_status *status);
+extern void dshash_delete_current(dshash_seq_status *status);
+
 /* Convenience hash and compare functions wrapping memcmp and tag_hash. */
 extern int	dshash_memcmp(const void *a, const void *b, size_t size, void *arg);
 extern dshash_hash dshash_memhash(const void *v, size_t size, void *arg);
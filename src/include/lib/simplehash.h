@@ -44,6 +44,9 @@
  *	    use this to allocate bytes
  *	  - SH_USE_NONDEFAULT_ALLOCATOR - if defined no element allocator functions
  *		are defined, so you can supply your own
+ *	  - SH_GROUP_PROBING - if defined, use group probing instead of robin hood
+ *		hashing, see below.  As this changes the hash table type, it has to be
+ *		defined for SH_DECLARE as well as for SH_DEFINE
  *	  The following parameters are only relevant when SH_DEFINE is defined:
  *	  - SH_KEY - name of the element in SH_ELEMENT_TYPE containing the hash key
  *	  - SH_EQUAL(table, a, b) - compare two table keys
@@ -86,9 +89,28 @@
  *	  presence is relevant to determine whether a lookup needs to continue
  *	  looking or is done - buckets following a deleted element are shifted
  *	  backwards, unless they're empty or already at their optimal position.
+ *
+ *	  With SH_GROUP_PROBING, a different design is used, modeled on "Swiss
+ *	  tables".  Next to the bucket array there is an array of one-byte control
+ *	  words, one per bucket, that say whether the bucket is empty, in use, or
+ *	  a tombstone left behind by a deletion.  For buckets in use, the control
+ *	  word also holds 7 bits of the element's hash.  The buckets are divided
+ *	  into groups of SH_GROUP_WIDTH, whose control words are checked all at
+ *	  once with vector instructions: a lookup loads a group's control words,
+ *	  compares the elements whose hash bits match, and stops at the first
+ *	  group that has an empty bucket.  Groups are probed in triangular order
+ *	  (the next group is 1, 2, 3, ... groups after the previous one), so
+ *	  clusters of full groups don't grow as they would with linear probing.
+ *	  Since most non-matching elements are rejected by their hash bits, the
+ *	  bucket array is usually touched only for the element looked for, which
+ *	  makes the table cheaper for large tables of wide elements, or when
+ *	  SH_EQUAL is expensive.  Elements never move once inserted, but deleted
+ *	  elements may leave tombstones behind; they count towards the fillfactor
+ *	  and are cleaned out when the table is resized.
  */
 
 #include "port/pg_bitutils.h"
+#include "port/pg_simd.h"
 
 /* helpers */
 #define SH_MAKE_PREFIX(a) CppConcat(a,_)
@@ -128,6 +150,10 @@
 #define SH_DISTANCE_FROM_OPTIMAL SH_MAKE_NAME(distance)
 #define SH_INITIAL_BUCKET SH_MAKE_NAME(initial_bucket)
 #define SH_ENTRY_HASH SH_MAKE_NAME(entry_hash)
+#define SH_ARRAY_SIZE SH_MAKE_NAME(array_size)
+#define SH_INITIAL_GROUP SH_MAKE_NAME(initial_group)
+#define SH_NEXT_GROUP SH_MAKE_NAME(next_group)
+#define SH_FIND_FREE SH_MAKE_NAME(find_free)
 #define SH_INSERT_HASH_INTERNAL SH_MAKE_NAME(insert_hash_internal)
 #define SH_LOOKUP_HASH_INTERNAL SH_MAKE_NAME(lookup_hash_internal)
 
@@ -156,6 +182,17 @@ typedef struct SH_TYPE
 	/* hash buckets */
 	SH_ELEMENT_TYPE *data;
 
+#ifdef SH_GROUP_PROBING
+	/* control words, stored in the same allocation after the buckets */
+	uint8	   *ctrl;
+
+	/* mask for group calculations, based on size */
+	uint32		groupmask;
+
+	/* how many buckets hold tombstones */
+	uint32		deleted;
+#endif
+
 #ifndef SH_RAW_ALLOCATOR
 	/* memory context to use for allocations */
 	MemoryContext ctx;
@@ -250,8 +287,12 @@ SH_SCOPE void SH_STAT(SH_TYPE * tb);
 
 /* normal fillfactor, unless already close to maximum */
 #ifndef SH_FILLFACTOR
+#ifdef SH_GROUP_PROBING
+#define SH_FILLFACTOR (0.875)
+#else
 #define SH_FILLFACTOR (0.9)
 #endif
+#endif
 /* increase fillfactor if we otherwise would error out */
 #define SH_MAX_FILLFACTOR (0.98)
 /* grow if actual and optimal location bigger than */
@@ -291,6 +332,67 @@ SH_SCOPE void SH_STAT(SH_TYPE * tb);
 #define sh_log(...) elog(LOG, __VA_ARGS__)
 #endif
 
+/*
+ * Group probing: number of buckets in a group, and the control word values.
+ * Tombstones and empty buckets have the high bit clear, buckets in use have
+ * it set, and the remaining 7 bits taken from the top of the hash value.
+ * Empty buckets are zero so that zeroed memory is an empty table.
+ */
+#define SH_GROUP_WIDTH 16
+#define SH_CTRL_EMPTY 0x00
+#define SH_CTRL_DELETED 0x01
+#define SH_CTRL_TAG(hash) ((uint8) (0x80 | ((hash) >> 25)))
+
+/*
+ * Return a bitmask of the buckets in the group starting at ctrl whose
+ * control word is c.
+ */
+static inline uint32
+sh_group_match(const uint8 *ctrl, uint8 c)
+{
+#ifndef USE_NO_SIMD
+	Vector8		group;
+
+	vector8_load(&group, ctrl);
+	return vector8_highbit_mask(vector8_eq(group, vector8_broadcast(c)));
+#else
+	uint32		result = 0;
+	int			i;
+
+	for (i = 0; i < SH_GROUP_WIDTH; i++)
+	{
+		if (ctrl[i] == c)
+			result |= (uint32) 1 << i;
+	}
+	return result;
+#endif
+}
+
+/*
+ * Return a bitmask of the buckets in the group starting at ctrl that are
+ * empty or hold a tombstone.
+ */
+static inline uint32
+sh_group_match_free(const uint8 *ctrl)
+{
+#ifndef USE_NO_SIMD
+	Vector8		group;
+
+	vector8_load(&group, ctrl);
+	return ~vector8_highbit_mask(group) & ((1 << SH_GROUP_WIDTH) - 1);
+#else
+	uint32		result = 0;
+	int			i;
+
+	for (i = 0; i < SH_GROUP_WIDTH; i++)
+	{
+		if ((ctrl[i] & 0x80) == 0)
+			result |= (uint32) 1 << i;
+	}
+	return result;
+#endif
+}
+
 #endif
 
 /*
@@ -302,8 +404,13 @@ SH_COMPUTE_PARAMETERS(SH_TYPE * tb, uint32 newsize)
 {
 	uint64		size;
 
+#ifdef SH_GROUP_PROBING
+	/* the table has to consist of whole groups */
+	size = Max(newsize, SH_GROUP_WIDTH);
+#else
 	/* supporting zero sized hashes would complicate matters */
 	size = Max(newsize, 2);
+#endif
 
 	/* round up size to the next power of 2, that's how bucketing works */
 	size = pg_nextpower2_64(size);
@@ -324,6 +431,10 @@ SH_COMPUTE_PARAMETERS(SH_TYPE * tb, uint32 newsize)
 	else
 		tb->sizemask = tb->size - 1;
 
+#ifdef SH_GROUP_PROBING
+	tb->groupmask = (tb->size / SH_GROUP_WIDTH) - 1;
+#endif
+
 	/*
 	 * Compute the next threshold at which we need to grow the hash table
 	 * again.
@@ -383,6 +494,57 @@ SH_ENTRY_HASH(SH_TYPE * tb, SH_ELEMENT_TYPE * entry)
 #endif
 }
 
+/* return the size of the allocation holding the buckets */
+static inline Size
+SH_ARRAY_SIZE(SH_TYPE * tb)
+{
+#ifdef SH_GROUP_PROBING
+	return (sizeof(SH_ELEMENT_TYPE) + sizeof(uint8)) * tb->size;
+#else
+	return sizeof(SH_ELEMENT_TYPE) * tb->size;
+#endif
+}
+
+#ifdef SH_GROUP_PROBING
+
+/* return the first group to probe for the hash */
+static inline uint32
+SH_INITIAL_GROUP(SH_TYPE * tb, uint32 hash)
+{
+	return hash & tb->groupmask;
+}
+
+/*
+ * Return the group to probe after the current one.  'step' is 1 for the
+ * second group probed, 2 for the third, and so on; with a power-of-2 number
+ * of groups, the resulting triangular sequence visits every group once.
+ */
+static inline uint32
+SH_NEXT_GROUP(SH_TYPE * tb, uint32 curgroup, uint32 step)
+{
+	return (curgroup + step) & tb->groupmask;
+}
+
+/* return the first bucket that is not in use in the hash's probe sequence */
+static inline uint32
+SH_FIND_FREE(SH_TYPE * tb, uint32 hash)
+{
+	uint32		curgroup = SH_INITIAL_GROUP(tb, hash);
+	uint32		step = 0;
+
+	while (true)
+	{
+		uint32		free = sh_group_match_free(&tb->ctrl[curgroup * SH_GROUP_WIDTH]);
+
+		if (free != 0)
+			return curgroup * SH_GROUP_WIDTH + pg_rightmost_one_pos32(free);
+
+		curgroup = SH_NEXT_GROUP(tb, curgroup, ++step);
+	}
+}
+
+#endif							/* SH_GROUP_PROBING */
+
 /* default memory allocator function */
 static inline void *SH_ALLOCATE(SH_TYPE * type, Size size);
 static inline void SH_FREE(SH_TYPE * type, void *pointer);
@@ -443,7 +605,11 @@ SH_CREATE(MemoryContext ctx, uint32 nelements, void *private_data)
 
 	SH_COMPUTE_PARAMETERS(tb, size);
 
-	tb->data = SH_ALLOCATE(tb, sizeof(SH_ELEMENT_TYPE) * tb->size);
+	tb->data = SH_ALLOCATE(tb, SH_ARRAY_SIZE(tb));
+#ifdef SH_GROUP_PROBING
+	tb->ctrl = (uint8 *) (tb->data + tb->size);
+	tb->deleted = 0;
+#endif
 
 	return tb;
 }
@@ -460,8 +626,11 @@ SH_DESTROY(SH_TYPE * tb)
 SH_SCOPE void
 SH_RESET(SH_TYPE * tb)
 {
-	memset(tb->data, 0, sizeof(SH_ELEMENT_TYPE) * tb->size);
+	memset(tb->data, 0, SH_ARRAY_SIZE(tb));
 	tb->members = 0;
+#ifdef SH_GROUP_PROBING
+	tb->deleted = 0;
+#endif
 }
 
 /*
@@ -471,6 +640,51 @@ SH_RESET(SH_TYPE * tb)
  * necessary. But resizing to the exact input size can be advantageous
  * performance-wise, when known at some point.
  */
+#ifdef SH_GROUP_PROBING
+SH_SCOPE void
+SH_GROW(SH_TYPE * tb, uint32 newsize)
+{
+	uint64		oldsize = tb->size;
+	SH_ELEMENT_TYPE *olddata = tb->data;
+	uint64		i;
+
+	Assert(oldsize == pg_nextpower2_64(oldsize));
+	Assert(oldsize <= newsize);
+
+	/*
+	 * compute parameters for new table; newsize may be the current size, if
+	 * we're only getting rid of tombstones
+	 */
+	SH_COMPUTE_PARAMETERS(tb, newsize);
+
+	tb->data = SH_ALLOCATE(tb, SH_ARRAY_SIZE(tb));
+	tb->ctrl = (uint8 *) (tb->data + tb->size);
+	tb->deleted = 0;
+
+	/*
+	 * Copy entries from the old data to the new.  As the keys are known to be
+	 * distinct, and there are no tombstones in the new table, each entry just
+	 * goes into the first free bucket of its probe sequence.
+	 */
+	for (i = 0; i < oldsize; i++)
+	{
+		SH_ELEMENT_TYPE *oldentry = &olddata[i];
+		uint32		hash;
+		uint32		newelem;
+
+		if (oldentry->status != SH_STATUS_IN_USE)
+			continue;
+
+		hash = SH_ENTRY_HASH(tb, oldentry);
+		newelem = SH_FIND_FREE(tb, hash);
+
+		tb->ctrl[newelem] = SH_CTRL_TAG(hash);
+		memcpy(&tb->data[newelem], oldentry, sizeof(SH_ELEMENT_TYPE));
+	}
+
+	SH_FREE(tb, olddata);
+}
+#else
 SH_SCOPE void
 SH_GROW(SH_TYPE * tb, uint32 newsize)
 {
@@ -576,6 +790,103 @@ SH_GROW(SH_TYPE * tb, uint32 newsize)
 
 	SH_FREE(tb, olddata);
 }
+#endif							/* SH_GROUP_PROBING */
+
+#ifdef SH_GROUP_PROBING
+
+/*
+ * This is a separate static inline function, so it can be reliably be inlined
+ * into its wrapper functions even if SH_SCOPE is extern.
+ */
+static inline SH_ELEMENT_TYPE *
+SH_INSERT_HASH_INTERNAL(SH_TYPE * tb, SH_KEY_TYPE key, uint32 hash, bool *found)
+{
+	uint8		tag;
+	uint32		curgroup;
+	uint32		step = 0;
+	uint32		insertelem = 0;
+	bool		have_insertelem = false;
+	SH_ELEMENT_TYPE *entry;
+
+	/*
+	 * We do the grow check even if the key is actually present, to avoid
+	 * doing the check inside the loop.  Tombstones take up buckets just like
+	 * elements do, but if they are most of what fills the table, getting rid
+	 * of them is enough and we don't need to grow.
+	 */
+	if (unlikely(tb->members + tb->deleted >= tb->grow_threshold))
+	{
+		if (tb->members < tb->grow_threshold / 2)
+			SH_GROW(tb, tb->size);
+		else if (tb->size == SH_MAX_SIZE)
+			sh_error("hash table size exceeded");
+		else
+			SH_GROW(tb, tb->size * 2);
+	}
+
+	/*
+	 * Search for the key, remembering the first free bucket we pass in case
+	 * it isn't there.
+	 */
+	tag = SH_CTRL_TAG(hash);
+	curgroup = SH_INITIAL_GROUP(tb, hash);
+	while (true)
+	{
+		const uint8 *ctrl = &tb->ctrl[curgroup * SH_GROUP_WIDTH];
+		uint32		match = sh_group_match(ctrl, tag);
+
+		while (match != 0)
+		{
+			entry = &tb->data[curgroup * SH_GROUP_WIDTH +
+							  pg_rightmost_one_pos32(match)];
+
+			if (SH_COMPARE_KEYS(tb, hash, key, entry))
+			{
+				Assert(entry->status == SH_STATUS_IN_USE);
+				*found = true;
+				return entry;
+			}
+
+			match &= match - 1;
+		}
+
+		if (!have_insertelem)
+		{
+			uint32		free = sh_group_match_free(ctrl);
+
+			if (free != 0)
+			{
+				insertelem = curgroup * SH_GROUP_WIDTH +
+					pg_rightmost_one_pos32(free);
+				have_insertelem = true;
+			}
+		}
+
+		/* the key can't be beyond a group with an empty bucket */
+		if (sh_group_match(ctrl, SH_CTRL_EMPTY) != 0)
+			break;
+
+		curgroup = SH_NEXT_GROUP(tb, curgroup, ++step);
+	}
+
+	Assert(have_insertelem);
+
+	if (tb->ctrl[insertelem] == SH_CTRL_DELETED)
+		tb->deleted--;
+	tb->ctrl[insertelem] = tag;
+	tb->members++;
+
+	entry = &tb->data[insertelem];
+	entry->SH_KEY = key;
+#ifdef SH_STORE_HASH
+	SH_GET_HASH(tb, entry) = hash;
+#endif
+	entry->status = SH_STATUS_IN_USE;
+	*found = false;
+	return entry;
+}
+
+#else
 
 /*
  * This is a separate static inline function, so it can be reliably be inlined
@@ -746,6 +1057,7 @@ restart:
 		}
 	}
 }
+#endif							/* SH_GROUP_PROBING */
 
 /*
  * Insert the key key into the hash-table, set *found to true if the key
@@ -771,6 +1083,49 @@ SH_INSERT_HASH(SH_TYPE * tb, SH_KEY_TYPE key, uint32 hash, bool *found)
 	return SH_INSERT_HASH_INTERNAL(tb, key, hash, found);
 }
 
+#ifdef SH_GROUP_PROBING
+
+/*
+ * This is a separate static inline function, so it can be reliably be inlined
+ * into its wrapper functions even if SH_SCOPE is extern.
+ */
+static inline SH_ELEMENT_TYPE *
+SH_LOOKUP_HASH_INTERNAL(SH_TYPE * tb, SH_KEY_TYPE key, uint32 hash)
+{
+	const uint8 tag = SH_CTRL_TAG(hash);
+	uint32		curgroup = SH_INITIAL_GROUP(tb, hash);
+	uint32		step = 0;
+
+	while (true)
+	{
+		const uint8 *ctrl = &tb->ctrl[curgroup * SH_GROUP_WIDTH];
+		uint32		match = sh_group_match(ctrl, tag);
+
+		while (match != 0)
+		{
+			SH_ELEMENT_TYPE *entry;
+
+			entry = &tb->data[curgroup * SH_GROUP_WIDTH +
+							  pg_rightmost_one_pos32(match)];
+
+			Assert(entry->status == SH_STATUS_IN_USE);
+
+			if (SH_COMPARE_KEYS(tb, hash, key, entry))
+				return entry;
+
+			match &= match - 1;
+		}
+
+		/* the key can't be beyond a group with an empty bucket */
+		if (sh_group_match(ctrl, SH_CTRL_EMPTY) != 0)
+			return NULL;
+
+		curgroup = SH_NEXT_GROUP(tb, curgroup, ++step);
+	}
+}
+
+#else
+
 /*
  * This is a separate static inline function, so it can be reliably be inlined
  * into its wrapper functions even if SH_SCOPE is extern.
@@ -805,6 +1160,7 @@ SH_LOOKUP_HASH_INTERNAL(SH_TYPE * tb, SH_KEY_TYPE key, uint32 hash)
 		curelem = SH_NEXT(tb, curelem, startelem);
 	}
 }
+#endif							/* SH_GROUP_PROBING */
 
 /*
  * Lookup up entry in hash table.  Returns NULL if key not present.
@@ -828,6 +1184,49 @@ SH_LOOKUP_HASH(SH_TYPE * tb, SH_KEY_TYPE key, uint32 hash)
 	return SH_LOOKUP_HASH_INTERNAL(tb, key, hash);
 }
 
+#ifdef SH_GROUP_PROBING
+
+/*
+ * Delete entry from hash table.  Returns whether to-be-deleted key was
+ * present.
+ */
+SH_SCOPE bool
+SH_DELETE(SH_TYPE * tb, SH_KEY_TYPE key)
+{
+	uint32		hash = SH_HASH_KEY(tb, key);
+	SH_ELEMENT_TYPE *entry;
+	uint32		curelem;
+
+	entry = SH_LOOKUP_HASH_INTERNAL(tb, key, hash);
+	if (entry == NULL)
+		return false;
+
+	curelem = entry - tb->data;
+
+	/*
+	 * Probing only continues past groups without empty buckets, and an
+	 * element is only placed beyond a group if that group is full.  So if the
+	 * element's group still has an empty bucket, no other element can have
+	 * been placed past it, and the bucket can be marked empty too.  Otherwise
+	 * we have to leave a tombstone.
+	 */
+	if (sh_group_match(&tb->ctrl[curelem & ~(SH_GROUP_WIDTH - 1)],
+					   SH_CTRL_EMPTY) != 0)
+		tb->ctrl[curelem] = SH_CTRL_EMPTY;
+	else
+	{
+		tb->ctrl[curelem] = SH_CTRL_DELETED;
+		tb->deleted++;
+	}
+
+	entry->status = SH_STATUS_EMPTY;
+	tb->members--;
+
+	return true;
+}
+
+#else
+
 /*
  * Delete entry from hash table.  Returns whether to-be-deleted key was
  * present.
@@ -899,6 +1298,7 @@ SH_DELETE(SH_TYPE * tb, SH_KEY_TYPE key)
 		curelem = SH_NEXT(tb, curelem, startelem);
 	}
 }
+#endif							/* SH_GROUP_PROBING */
 
 /*
  * Initialize iterator.
@@ -988,6 +1388,60 @@ SH_ITERATE(SH_TYPE * tb, SH_ITERATOR * iter)
 	return NULL;
 }
 
+#ifdef SH_GROUP_PROBING
+
+/*
+ * Report some statistics about the state of the hashtable. For
+ * debugging/profiling purposes only.
+ */
+SH_SCOPE void
+SH_STAT(SH_TYPE * tb)
+{
+	uint32		max_probe_length = 0;
+	uint64		total_probe_length = 0;
+	double		avg_probe_length;
+	double		fillfactor;
+	uint64		i;
+
+	for (i = 0; i < tb->size; i++)
+	{
+		uint32		curgroup;
+		uint32		step = 0;
+		SH_ELEMENT_TYPE *elem;
+
+		elem = &tb->data[i];
+
+		if (elem->status != SH_STATUS_IN_USE)
+			continue;
+
+		/* count the groups probed before the element's */
+		curgroup = SH_INITIAL_GROUP(tb, SH_ENTRY_HASH(tb, elem));
+		while (curgroup != i / SH_GROUP_WIDTH)
+			curgroup = SH_NEXT_GROUP(tb, curgroup, ++step);
+
+		if (step > max_probe_length)
+			max_probe_length = step;
+		total_probe_length += step;
+	}
+
+	if (tb->members > 0)
+	{
+		fillfactor = tb->members / ((double) tb->size);
+		avg_probe_length = ((double) total_probe_length) / tb->members;
+	}
+	else
+	{
+		fillfactor = 0;
+		avg_probe_length = 0;
+	}
+
+	sh_log("size: " UINT64_FORMAT ", members: %u, deleted: %u, filled: %f, total probe: " UINT64_FORMAT ", max probe: %u, avg probe: %f",
+		   tb->size, tb->members, tb->deleted, fillfactor, total_probe_length,
+		   max_probe_length, avg_probe_length);
+}
+
+#else
+
 /*
  * Report some statistics about the state of the hashtable. For
  * debugging/profiling purposes only.
@@ -1060,6 +1514,7 @@ SH_STAT(SH_TYPE * tb)
 		   tb->size, tb->members, fillfactor, total_chain_length, max_chain_length, avg_chain_length,
 		   total_collisions, max_collisions, avg_collisions);
 }
+#endif							/* SH_GROUP_PROBING */
 
 #endif							/* SH_DEFINE */
 
@@ -1076,6 +1531,7 @@ SH_STAT(SH_TYPE * tb)
 #undef SH_GET_HASH
 #undef SH_STORE_HASH
 #undef SH_USE_NONDEFAULT_ALLOCATOR
+#undef SH_GROUP_PROBING
 #undef SH_EQUAL
 
 /* undefine locally declared macros */
@@ -1121,5 +1577,9 @@ SH_STAT(SH_TYPE * tb)
 #undef SH_PREV
 #undef SH_DISTANCE_FROM_OPTIMAL
 #undef SH_ENTRY_HASH
+#undef SH_ARRAY_SIZE
+#undef SH_INITIAL_GROUP
+#undef SH_NEXT_GROUP
+#undef SH_FIND_FREE
 #undef SH_INSERT_HASH_INTERNAL
 #undef SH_LOOKUP_HASH_INTERNAL
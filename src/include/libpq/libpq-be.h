@@ -131,6 +131,7 @@ typedef struct Port
 	int			remote_hostname_errcode;	/* see above */
 	char	   *remote_port;	/* text rep of remote port */
 	CAC_state	canAcceptConnections;	/* postmaster connection status */
+	bool		proxied;		/* connection comes from a connection proxy */
 
 	/*
 	 * Information that needs to be saved from the startup packet and passed
@@ -142,6 +143,12 @@ typedef struct Port
 	char	   *cmdline_options;
 	List	   *guc_options;
 
+	/*
+	 * Compression methods the client accepts for the protocol stream, in
+	 * order of preference, from the _pq_.compression startup option.
+	 */
+	char	   *compression_methods;
+
 	/*
 	 * The startup packet application name, only used here for the "connection
 	 * authorized" log message. We shouldn't use this post-startup, instead
@@ -16,6 +16,7 @@
 
 #include <netinet/in.h>
 
+#include "common/protocol_compression.h"
 #include "lib/stringinfo.h"
 #include "libpq/libpq-be.h"
 #include "storage/latch.h"
@@ -29,6 +30,7 @@ typedef struct
 	bool		(*is_send_pending) (void);
 	int			(*putmessage) (char msgtype, const char *s, size_t len);
 	void		(*putmessage_noblock) (char msgtype, const char *s, size_t len);
+	int			(*putmessages) (const char *s, size_t len);
 	void		(*startcopyout) (void);
 	void		(*endcopyout) (bool errorAbort);
 } PQcommMethods;
@@ -43,6 +45,7 @@ extern const PGDLLIMPORT PQcommMethods *PqCommMethods;
 	(PqCommMethods->putmessage(msgtype, s, len))
 #define pq_putmessage_noblock(msgtype, s, len) \
 	(PqCommMethods->putmessage_noblock(msgtype, s, len))
+#define pq_putmessages(s, len) (PqCommMethods->putmessages(s, len))
 #define pq_startcopyout() (PqCommMethods->startcopyout())
 #define pq_endcopyout(errorAbort) (PqCommMethods->endcopyout(errorAbort))
 
@@ -60,9 +63,13 @@ extern int	StreamServerPort(int family, const char *hostName,
 							 pgsocket ListenSocket[], int MaxListen);
 extern int	StreamConnection(pgsocket server_fd, Port *port);
 extern void StreamClose(pgsocket sock);
+extern bool StreamSendSocket(pgsocket channel, pgsocket sock,
+							 const void *data, size_t len);
+extern pgsocket StreamReceiveSocket(pgsocket channel, void *data, size_t len);
 extern void TouchSocketFiles(void);
 extern void RemoveSocketFiles(void);
 extern void pq_init(void);
+extern void pq_enable_compression(PqCompressionMethod method);
 extern int	pq_getbytes(char *s, size_t len);
 extern int	pq_getstring(StringInfo s);
 extern void pq_startmsgread(void);
@@ -74,6 +81,8 @@ extern int	pq_peekbyte(void);
 extern int	pq_getbyte_if_available(unsigned char *c);
 extern int	pq_putbytes(const char *s, size_t len);
 
+extern bool protocol_compression;
+
 /*
  * prototypes for functions in be-secure.c
  */
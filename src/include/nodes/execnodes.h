@@ -17,6 +17,7 @@
 #include "access/tupconvert.h"
 #include "executor/instrument.h"
 #include "fmgr.h"
+#include "lib/ilist.h"
 #include "lib/pairingheap.h"
 #include "nodes/params.h"
 #include "nodes/plannodes.h"
@@ -112,6 +113,9 @@ typedef struct ExprState
 
 	Datum	   *innermost_domainval;
 	bool	   *innermost_domainnull;
+
+	/* evaluations so far, while JIT compilation is deferred */
+	int			jit_deferred_evals;
 } ExprState;
 
 
@@ -446,6 +450,13 @@ typedef struct ResultRelInfo
 	/* true when modifying foreign table directly */
 	bool		ri_usesFdwDirectModify;
 
+	/* batch insert stuff */
+	int			ri_NumSlots;	/* number of slots in the array */
+	int			ri_NumSlotsInitialized; /* number of initialized slots */
+	int			ri_BatchSize;	/* max slots inserted in a single batch */
+	TupleTableSlot **ri_Slots;	/* input tuples for batch insert */
+	TupleTableSlot **ri_PlanSlots;
+
 	/* list of WithCheckOption's to be checked */
 	List	   *ri_WithCheckOptions;
 
@@ -914,6 +925,23 @@ typedef struct DomainConstraintState
  */
 typedef TupleTableSlot *(*ExecProcNodeMtd) (struct PlanState *pstate);
 
+/* ----------------
+ *	 AsyncRequest
+ *
+ * State for an asynchronous tuple request.
+ * ----------------
+ */
+typedef struct AsyncRequest
+{
+	struct PlanState *requestor;	/* Node that wants a tuple */
+	struct PlanState *requestee;	/* Node from which a tuple is wanted */
+	int			request_index;	/* Scratch space for requestor */
+	bool		callback_pending;	/* Callback is needed */
+	bool		request_complete;	/* Request complete, result valid */
+	TupleTableSlot *result;		/* Result (NULL or an empty slot if no more
+								 * tuples) */
+} AsyncRequest;
+
 /* ----------------
  *		PlanState node
  *
@@ -1009,6 +1037,8 @@ typedef struct PlanState
 	bool		outeropsset;
 	bool		inneropsset;
 	bool		resultopsset;
+
+	bool		async_capable;	/* true if node is async-capable */
 } PlanState;
 
 /* ----------------
@@ -1037,6 +1067,11 @@ typedef struct PlanState
 		if (((PlanState *)(node))->instrument) \
 			((PlanState *)(node))->instrument->nfiltered2 += (delta); \
 	} while(0)
+#define InstrCountFiltered3(node, delta) \
+	do { \
+		if (((PlanState *)(node))->instrument) \
+			((PlanState *)(node))->instrument->nfiltered3 += (delta); \
+	} while(0)
 
 /*
  * EPQState is state for executing an EvalPlanQual recheck on a candidate
@@ -1207,12 +1242,25 @@ struct AppendState
 	PlanState **appendplans;	/* array of PlanStates for my inputs */
 	int			as_nplans;
 	int			as_whichplan;
+	bool		as_begun;		/* false means need to initialize */
+	Bitmapset  *as_asyncplans;	/* asynchronous plans indexes */
+	int			as_nasyncplans; /* # of asynchronous plans */
+	AsyncRequest **as_asyncrequests;	/* array of AsyncRequests */
+	TupleTableSlot **as_asyncresults;	/* unreturned results of async plans */
+	int			as_nasyncresults;	/* # of valid entries in as_asyncresults */
+	bool		as_syncdone;	/* true if all synchronous plans done in
+								 * asynchronous mode, else false */
+	int			as_nasyncremain;	/* # of remaining asynchronous plans */
+	Bitmapset  *as_needrequest; /* asynchronous plans needing a new request */
+	struct WaitEventSet *as_eventset;	/* WaitEventSet used to configure file
+										 * descriptor wait events */
 	int			as_first_partial_plan;	/* Index of 'appendplans' containing
 										 * the first partial plan */
 	ParallelAppendState *as_pstate; /* parallel coordination info */
 	Size		pstate_len;		/* size of parallel coordination info */
 	struct PartitionPruneState *as_prune_state;
 	Bitmapset  *as_valid_subplans;
+	Bitmapset  *as_valid_asyncplans;	/* valid asynchronous plans indexes */
 	bool		(*choose_next_subplan) (AppendState *);
 };
 
@@ -1328,6 +1376,8 @@ typedef struct SeqScanState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 	Size		pscan_len;		/* size of parallel heap scan descriptor */
+	Bitmapset  *projected_attrs;	/* columns needed, see table AM's
+									 * scan_set_projection */
 } SeqScanState;
 
 /* ----------------
@@ -1442,6 +1492,9 @@ typedef struct IndexScanState
  *		ScanDesc		   index scan descriptor
  *		TableSlot		   slot for holding tuples fetched from the table
  *		VMBuffer		   buffer in use for visibility map testing, if any
+ *		VMCacheBlock	   heap block whose all-visible status is cached
+ *		VMCacheBatch	   ScanDesc->xs_batchno when the status was cached
+ *		VMCacheAllVisible  cached all-visible status of VMCacheBlock
  *		PscanLen		   size of parallel index-only scan descriptor
  * ----------------
  */
@@ -1461,6 +1514,9 @@ typedef struct IndexOnlyScanState
 	struct IndexScanDescData *ioss_ScanDesc;
 	TupleTableSlot *ioss_TableSlot;
 	Buffer		ioss_VMBuffer;
+	BlockNumber ioss_VMCacheBlock;
+	uint64		ioss_VMCacheBatch;
+	bool		ioss_VMCacheAllVisible;
 	Size		ioss_PscanLen;
 } IndexOnlyScanState;
 
@@ -1611,6 +1667,24 @@ typedef struct TidScanState
 	HeapTupleData tss_htup;
 } TidScanState;
 
+/* ----------------
+ *	 TidRangeScanState information
+ *
+ *		trss_tidexprs		list of TidOpExpr structs (see nodeTidrangescan.c)
+ *		trss_mintid			the lowest TID in the scan range
+ *		trss_maxtid			the highest TID in the scan range
+ *		trss_inScan			is a scan currently in progress?
+ * ----------------
+ */
+typedef struct TidRangeScanState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	List	   *trss_tidexprs;
+	ItemPointerData trss_mintid;
+	ItemPointerData trss_maxtid;
+	bool		trss_inScan;
+} TidRangeScanState;
+
 /* ----------------
  *	 SubqueryScanState information
  *
@@ -1721,8 +1795,14 @@ typedef struct TableFuncScanState
  * Multiple CteScan nodes can read out from the same CTE query.  We use
  * a tuplestore to hold rows that have been read from the CTE query but
  * not yet consumed by all readers.
+ *
+ * A parallel-aware CteScan instead reads the CTE's rows from a shared
+ * tuplestore, which the leader fills when the parallel query starts.  In
+ * parallel workers, only the fields of the parallel scan are used.
  * ----------------
  */
+typedef struct ParallelCteScanState ParallelCteScanState;
+
 typedef struct CteScanState
 {
 	ScanState	ss;				/* its first field is NodeTag */
@@ -1734,6 +1814,10 @@ typedef struct CteScanState
 	/* The remaining fields are only valid in the "leader" CteScanState */
 	Tuplestorestate *cte_table; /* rows already read from the CTE query */
 	bool		eof_cte;		/* reached end of CTE query? */
+	/* Parallel scan state, if any */
+	ParallelCteScanState *pstate;	/* shared state in the DSM segment */
+	SharedTuplestoreAccessor *sts_accessor; /* access to the shared rows */
+	bool		sts_scanning;	/* have we begun the parallel scan? */
 } CteScanState;
 
 /* ----------------
@@ -1943,6 +2027,10 @@ typedef struct HashJoinState
 	int			hj_JoinState;
 	bool		hj_MatchedOuter;
 	bool		hj_OuterNotEmpty;
+	bool		hj_UseBloom;	/* build a Bloom filter of inner tuples? */
+	bool		hj_BloomActive; /* check outer tuples against it? */
+	uint64		hj_BloomProbes; /* # outer tuples checked */
+	uint64		hj_BloomRejects;	/* # outer tuples rejected */
 } HashJoinState;
 
 
@@ -1968,6 +2056,56 @@ typedef struct MaterialState
 	Tuplestorestate *tuplestorestate;
 } MaterialState;
 
+struct ResultCacheEntry;
+struct ResultCacheTuple;
+
+/* ----------------
+ *	 ResultCacheInstrumentation information
+ *
+ *		counters kept by a ResultCache node for EXPLAIN ANALYZE
+ * ----------------
+ */
+typedef struct ResultCacheInstrumentation
+{
+	uint64		cache_hits;		/* rescans answered from the cache */
+	uint64		cache_misses;	/* rescans that ran the subplan */
+	uint64		cache_evictions;	/* entries removed to free memory */
+	uint64		cache_overflows;	/* rescans whose rows didn't fit */
+	uint64		mem_peak;		/* peak memory used by the cache, in bytes */
+} ResultCacheInstrumentation;
+
+/* ----------------
+ *	 ResultCacheState information
+ *
+ *		result cache nodes remember the rows returned by their subplan for
+ *		each set of parameter values, and evict the least recently used
+ *		entries once the cache reaches hash_mem.
+ * ----------------
+ */
+typedef struct ResultCacheState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	int			rc_status;		/* state of the ExecResultCache machine */
+	int			nkeys;			/* number of cache keys */
+	struct resultcache_hash *hashtable; /* hash table of cache entries */
+	TupleTableSlot *tableslot;	/* slot for keys stored in the cache */
+	TupleTableSlot *probeslot;	/* slot for the current parameter values */
+	ExprState **param_exprs;	/* exprs computing the cache keys */
+	FmgrInfo   *hashfunctions;	/* hash function per key */
+	FmgrInfo   *eqfunctions;	/* equality function per key */
+	Oid		   *collations;		/* collation per key */
+	uint64		mem_used;		/* bytes of memory used by the cache */
+	uint64		mem_limit;		/* memory limit in bytes */
+	MemoryContext tableContext; /* memory context holding the cache */
+	dlist_head	lru_list;		/* entries, least recently used first */
+	struct ResultCacheTuple *last_tuple;	/* last row returned from, or
+											 * added to, the entry */
+	struct ResultCacheEntry *entry; /* entry being read or filled, if any */
+	bool		singlerow;		/* entry is complete after its first row */
+	Bitmapset  *keyparamids;	/* paramids the cache keys depend on */
+	ResultCacheInstrumentation stats;	/* execution statistics */
+} ResultCacheState;
+
 
 /* ----------------
  *	 When performing sorting by multiple keys, it's possible that the input
@@ -1995,8 +2133,14 @@ typedef struct SharedSortInfo
 
 /* ----------------
  *	 SortState information
+ *
+ *	 parallel_state is the shared coordination state of a Parallel Sort, or
+ *	 NULL if the sort is not parallel-aware or isn't run in parallel.
  * ----------------
  */
+struct ParallelSortState;
+typedef struct ParallelSortState ParallelSortState;
+
 typedef struct SortState
 {
 	ScanState	ss;				/* its first field is NodeTag */
@@ -2009,6 +2153,7 @@ typedef struct SortState
 	void	   *tuplesortstate; /* private state of tuplesort.c */
 	bool		am_worker;		/* are we a worker? */
 	SharedSortInfo *shared_info;	/* one entry per worker */
+	ParallelSortState *parallel_state;	/* parallel coordination info */
 } SortState;
 
 /* ----------------
@@ -2181,6 +2326,11 @@ typedef struct AggState
 	bool		hash_ever_spilled;	/* ever spilled during this execution? */
 	bool		hash_spill_mode;	/* we hit a limit during the current batch
 									 * and we must not create new groups */
+	bool		hash_emit_early;	/* emit groups instead of spilling? */
+	bool		hash_emit_pending;	/* we hit a limit while reading the outer
+									 * plan; emit groups, then read on */
+	Size		hash_emit_base_mem; /* hash_metacxt memory kept from earlier
+									 * fills, not counted against the limit */
 	Size		hash_mem_limit; /* limit before spilling hash table */
 	uint64		hash_ngroups_limit; /* limit before spilling hash table */
 	int			hash_planned_partitions;	/* number of partitions planned
@@ -2212,6 +2362,18 @@ typedef struct AggState
 typedef struct WindowStatePerFuncData *WindowStatePerFunc;
 typedef struct WindowStatePerAggData *WindowStatePerAgg;
 
+/*
+ * WindowAggStatus -- Used to track the status of WindowAggState
+ */
+typedef enum WindowAggStatus
+{
+	WINDOWAGG_DONE,				/* No more processing to do */
+	WINDOWAGG_RUN,				/* Normal processing of window funcs */
+	WINDOWAGG_PASSTHROUGH,		/* Don't eval window funcs */
+	WINDOWAGG_PASSTHROUGH_STRICT	/* Pass-through plus don't store new
+									 * tuples during spool */
+} WindowAggStatus;
+
 typedef struct WindowAggState
 {
 	ScanState	ss;				/* its first field is NodeTag */
@@ -2245,6 +2407,16 @@ typedef struct WindowAggState
 	Datum		startOffsetValue;	/* result of startOffset evaluation */
 	Datum		endOffsetValue; /* result of endOffset evaluation */
 
+	ExprState  *runcondition;	/* Condition which must remain true otherwise
+								 * execution of the WindowAgg will finish or
+								 * go into pass-through mode.  NULL when there
+								 * is no such condition. */
+	bool		use_pass_through;	/* When false, stop execution when
+									 * runcondition is no longer true.  Else
+									 * just stop evaluating window funcs. */
+	bool		top_window;		/* true if this is the top-most WindowAgg or
+								 * the only WindowAgg in this query level */
+
 	/* these fields are used with RANGE offset PRECEDING/FOLLOWING: */
 	FmgrInfo	startInRangeFunc;	/* in_range function for startOffset */
 	FmgrInfo	endInRangeFunc; /* in_range function for endOffset */
@@ -2264,8 +2436,8 @@ typedef struct WindowAggState
 	MemoryContext curaggcontext;	/* current aggregate's working data */
 	ExprContext *tmpcontext;	/* short-term evaluation context */
 
+	WindowAggStatus status;		/* run status of WindowAggState */
 	bool		all_first;		/* true if the scan is starting */
-	bool		all_done;		/* true if the scan is finished */
 	bool		partition_spooled;	/* true if all tuples in current partition
 									 * have been spooled into tuplestore */
 	bool		more_partitions;	/* true if there's more partitions after
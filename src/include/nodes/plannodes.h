@@ -61,6 +61,9 @@ typedef struct PlannedStmt
 
 	int			jitFlags;		/* which forms of JIT should be performed */
 
+	int			workMem;		/* per-node work_mem limit in KB derived from
+								 * query_work_mem, or 0 if none */
+
 	struct Plan *planTree;		/* tree of Plan nodes */
 
 	List	   *rtable;			/* list of RangeTblEntry nodes */
@@ -129,6 +132,11 @@ typedef struct Plan
 	bool		parallel_aware; /* engage parallel-aware logic? */
 	bool		parallel_safe;	/* OK to use as part of parallel plan? */
 
+	/*
+	 * information needed for asynchronous execution
+	 */
+	bool		async_capable;	/* engage asynchronous-capable logic? */
+
 	/*
 	 * Common structural data for all Plan types.
 	 */
@@ -245,6 +253,7 @@ typedef struct Append
 	Plan		plan;
 	Bitmapset  *apprelids;		/* RTIs of appendrel(s) formed by this node */
 	List	   *appendplans;
+	int			nasyncplans;	/* # of asynchronous plans */
 
 	/*
 	 * All 'appendplans' preceding this index are non-partial plans. All
@@ -485,6 +494,19 @@ typedef struct TidScan
 	List	   *tidquals;		/* qual(s) involving CTID = something */
 } TidScan;
 
+/* ----------------
+ *		tid range scan node
+ *
+ * tidrangequals is an implicitly AND'ed list of qual expressions of the form
+ * "CTID relop pseudoconstant", where relop is one of >,>=,<,<=.
+ * ----------------
+ */
+typedef struct TidRangeScan
+{
+	Scan		scan;
+	List	   *tidrangequals;	/* qual(s) involving CTID op something */
+} TidRangeScan;
+
 /* ----------------
  *		subquery scan node
  *
@@ -760,6 +782,27 @@ typedef struct Material
 	Plan		plan;
 } Material;
 
+/* ----------------
+ *		result cache node
+ *
+ * Remembers the rows its subplan returned for each set of values of
+ * param_exprs, so that a rescan with values seen before can return them
+ * without running the subplan again.
+ * ----------------
+ */
+typedef struct ResultCache
+{
+	Plan		plan;
+	int			numKeys;		/* size of the two arrays below */
+	Oid		   *hashOperators;	/* hashable equality operators for keys */
+	Oid		   *collations;		/* collations for keys */
+	List	   *param_exprs;	/* cache keys, evaluated from the params */
+	bool		singlerow;		/* entry is complete after its first row */
+	uint32		est_entries;	/* planner's estimate of how many entries
+								 * fit in the cache, or 0 if unknown */
+	Bitmapset  *keyparamids;	/* paramids referenced by param_exprs */
+} ResultCache;
+
 /* ----------------
  *		sort node
  * ----------------
@@ -849,12 +892,23 @@ typedef struct WindowAgg
 	int			frameOptions;	/* frame_clause options, see WindowDef */
 	Node	   *startOffset;	/* expression for starting bound, if any */
 	Node	   *endOffset;		/* expression for ending bound, if any */
+
+	/*
+	 * Once runCondition fails for a row, it cannot pass again for any later
+	 * row of the same partition, so the rest of the partition need not be
+	 * computed.  Its WindowFuncs are replaced by Vars referencing this node's
+	 * output; runConditionOrig is the original form, kept for EXPLAIN.
+	 */
+	List	   *runCondition;
+	List	   *runConditionOrig;
 	/* these fields are used with RANGE offset PRECEDING/FOLLOWING: */
 	Oid			startInRangeFunc;	/* in_range function for startOffset */
 	Oid			endInRangeFunc; /* in_range function for endOffset */
 	Oid			inRangeColl;	/* collation for in_range tests */
 	bool		inRangeAsc;		/* use ASC sort order for in_range tests? */
 	bool		inRangeNullsFirst;	/* nulls sort first for in_range tests? */
+	bool		topWindow;		/* false for all apart from the WindowAgg
+								 * that's closest to the root of the plan */
 } WindowAgg;
 
 /* ----------------
@@ -38,6 +38,7 @@
 struct PlannerInfo;				/* avoid including pathnodes.h here */
 struct IndexOptInfo;
 struct SpecialJoinInfo;
+struct WindowClause;
 
 
 /*
@@ -239,4 +240,43 @@ typedef struct SupportRequestIndexCondition
 								 * equivalent of the function call */
 } SupportRequestIndexCondition;
 
+/*
+ * The WFuncMonotonic request allows the support function to say whether the
+ * result of a window function can only increase, or only decrease, as the
+ * rows of a window partition are processed in order.  The planner uses this
+ * to turn an outer-query qual such as "rn <= 10" on the function's result
+ * into a "run condition" for the WindowAgg node, which can then stop
+ * processing the partition as soon as the qual fails, since it cannot pass
+ * again for any later row of that partition.
+ *
+ * "window_func" is the WindowFunc being inquired about and "window_clause"
+ * is the WindowClause it belongs to, which the support function may need to
+ * look at, for instance to check the frame options.
+ *
+ * The support function should set "monotonic" to MONOTONICFUNC_INCREASING
+ * if the function's result never decreases from one row to the next,
+ * MONOTONICFUNC_DECREASING if it never increases, or MONOTONICFUNC_BOTH if it
+ * stays the same for all rows of the partition, and return the request node.
+ * The core code initializes "monotonic" to MONOTONICFUNC_NONE.
+ */
+typedef enum MonotonicFunction
+{
+	MONOTONICFUNC_NONE = 0,
+	MONOTONICFUNC_INCREASING = (1 << 0),
+	MONOTONICFUNC_DECREASING = (1 << 1),
+	MONOTONICFUNC_BOTH = MONOTONICFUNC_INCREASING | MONOTONICFUNC_DECREASING
+} MonotonicFunction;
+
+typedef struct SupportRequestWFuncMonotonic
+{
+	NodeTag		type;
+
+	/* Input fields: */
+	WindowFunc *window_func;	/* window function we are inquiring about */
+	struct WindowClause *window_clause; /* window clause it belongs to */
+
+	/* Output fields: */
+	MonotonicFunction monotonic;
+} SupportRequestWFuncMonotonic;
+
 #endif							/* SUPPORTNODES_H */
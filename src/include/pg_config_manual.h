@@ -122,6 +122,15 @@
  */
 #define ALIGNOF_BUFFER	32
 
+/*
+ * Alignment of buffers used for direct I/O (see io_direct).  Most systems
+ * require buffers, file offsets and transfer sizes to be multiples of the
+ * logical block size of the underlying device, which is at most 4kB on
+ * common hardware.  So buffers that may be the source or target of a direct
+ * I/O are aligned to this boundary.
+ */
+#define PG_IO_ALIGN_SIZE	4096
+
 /*
  * If EXEC_BACKEND is defined, the postmaster uses an alternative method for
  * starting subprocesses: Instead of simply using fork(), as is standard on
@@ -156,6 +165,16 @@
 #define USE_PREFETCH
 #endif
 
+/*
+ * USE_POSIX_AIO controls whether io_method = posix_aio is available, that
+ * is, whether fd.c may hand reads to the kernel or C library with
+ * aio_read() and collect them later.  Where <aio.h> is missing, reads
+ * started with FileStartRead() are performed synchronously when waited for.
+ */
+#ifdef HAVE_AIO_H
+#define USE_POSIX_AIO
+#endif
+
 /*
  * Default and maximum values for backend_flush_after, bgwriter_flush_after
  * and checkpoint_flush_after; measured in blocks.  Currently, these are
@@ -11,6 +11,7 @@
 #ifndef PGSTAT_H
 #define PGSTAT_H
 
+#include "access/rmgr.h"
 #include "datatype/timestamp.h"
 #include "libpq/pqcomm.h"
 #include "miscadmin.h"
@@ -30,6 +31,10 @@
 #define PGSTAT_STAT_PERMANENT_FILENAME		"pg_stat/global.stat"
 #define PGSTAT_STAT_PERMANENT_TMPFILE		"pg_stat/global.tmp"
 
+/* Where the shared-memory statistics are saved across a clean shutdown */
+#define PGSTAT_SHARED_STATS_FILENAME		"pg_stat/objects.stat"
+#define PGSTAT_SHARED_STATS_TMPFILE			"pg_stat/objects.tmp"
+
 /* Default directory to store temporary statistics data in */
 #define PG_STAT_TMP_DIR		"pg_stat_tmp"
 
@@ -49,28 +54,16 @@ typedef enum StatMsgType
 {
 	PGSTAT_MTYPE_DUMMY,
 	PGSTAT_MTYPE_INQUIRY,
-	PGSTAT_MTYPE_TABSTAT,
-	PGSTAT_MTYPE_TABPURGE,
-	PGSTAT_MTYPE_DROPDB,
-	PGSTAT_MTYPE_RESETCOUNTER,
 	PGSTAT_MTYPE_RESETSHAREDCOUNTER,
-	PGSTAT_MTYPE_RESETSINGLECOUNTER,
 	PGSTAT_MTYPE_RESETSLRUCOUNTER,
 	PGSTAT_MTYPE_RESETREPLSLOTCOUNTER,
-	PGSTAT_MTYPE_AUTOVAC_START,
-	PGSTAT_MTYPE_VACUUM,
-	PGSTAT_MTYPE_ANALYZE,
 	PGSTAT_MTYPE_ARCHIVER,
 	PGSTAT_MTYPE_BGWRITER,
 	PGSTAT_MTYPE_WAL,
+	PGSTAT_MTYPE_WAL_RECORDS,
 	PGSTAT_MTYPE_SLRU,
-	PGSTAT_MTYPE_FUNCSTAT,
-	PGSTAT_MTYPE_FUNCPURGE,
-	PGSTAT_MTYPE_RECOVERYCONFLICT,
-	PGSTAT_MTYPE_TEMPFILE,
-	PGSTAT_MTYPE_DEADLOCK,
-	PGSTAT_MTYPE_CHECKSUMFAILURE,
 	PGSTAT_MTYPE_REPLSLOT,
+	PGSTAT_MTYPE_IO,
 } StatMsgType;
 
 /* ----------
@@ -84,8 +77,9 @@ typedef int64 PgStat_Counter;
  *
  * This struct should contain only actual event counters, because we memcmp
  * it against zeroes to detect whether there are any counts to transmit.
- * It is a component of PgStat_TableStatus (within-backend state) and
- * PgStat_TableEntry (the transmitted message format).
+ * It is a component of PgStat_TableStatus (within-backend state), and is
+ * added into the shared-memory PgStat_StatTabEntry when the backend flushes
+ * its pending counts.
  *
  * Note: for a table, tuples_returned is the number of tuples successfully
  * fetched by heap_getnext, while tuples_fetched is the number of tuples
@@ -126,9 +120,65 @@ typedef enum PgStat_Shared_Reset_Target
 {
 	RESET_ARCHIVER,
 	RESET_BGWRITER,
-	RESET_WAL
+	RESET_WAL,
+	RESET_IO
 } PgStat_Shared_Reset_Target;
 
+/*
+ * Dimensions of the I/O statistics.  IOObject says what kind of storage the
+ * I/O was performed on, IOContext says which buffer access strategy (if any)
+ * was in use, and IOOp says what was done.
+ */
+typedef enum IOObject
+{
+	IOOBJECT_RELATION,
+	IOOBJECT_TEMP_RELATION,
+	IOOBJECT_TEMP_FILE
+} IOObject;
+
+#define IOOBJECT_NUM_TYPES (IOOBJECT_TEMP_FILE + 1)
+
+typedef enum IOContext
+{
+	IOCONTEXT_NORMAL,
+	IOCONTEXT_BULKREAD,
+	IOCONTEXT_BULKWRITE,
+	IOCONTEXT_VACUUM
+} IOContext;
+
+#define IOCONTEXT_NUM_TYPES (IOCONTEXT_VACUUM + 1)
+
+typedef enum IOOp
+{
+	IOOP_READ,
+	IOOP_WRITE,
+	IOOP_EXTEND,
+	IOOP_FSYNC
+} IOOp;
+
+#define IOOP_NUM_TYPES (IOOP_FSYNC + 1)
+
+typedef struct PgStat_IOCounters
+{
+	PgStat_Counter counts[IOOP_NUM_TYPES];
+	PgStat_Counter times[IOOP_NUM_TYPES];	/* in microseconds */
+} PgStat_IOCounters;
+
+/*
+ * WAL records are counted per resource manager and record type.  The record
+ * type is the high 4 bits of xl_info, the low ones being reserved for
+ * XLogInsert's flags (XLR_INFO_MASK).
+ */
+#define PGSTAT_WAL_RECORD_TYPES 16
+
+typedef struct PgStat_WalRecordCounters
+{
+	PgStat_Counter records;		/* # of records */
+	PgStat_Counter fpi;			/* # of full page images in them */
+	PgStat_Counter bytes;		/* total size, including FPIs */
+	PgStat_Counter fpi_bytes;	/* size of the FPIs */
+} PgStat_WalRecordCounters;
+
 /* Possible object types for resetting single counters */
 typedef enum PgStat_Single_Reset_Type
 {
@@ -228,11 +278,11 @@ typedef struct PgStat_MsgDummy
  * PgStat_MsgInquiry			Sent by a backend to ask the collector
  *								to write the stats file(s).
  *
- * Ordinarily, an inquiry message prompts writing of the global stats file,
- * the stats file for shared catalogs, and the stats file for the specified
- * database.  If databaseid is InvalidOid, only the first two are written.
+ * Per-database, per-table and per-function statistics are kept in shared
+ * memory rather than in the collector, so an inquiry only prompts writing
+ * of the file holding the cluster-wide statistics.
  *
- * New file(s) will be written only if the existing file has a timestamp
+ * A new file will be written only if the existing file has a timestamp
  * older than the specified cutoff_time; this prevents duplicated effort
  * when multiple requests arrive at nearly the same time, assuming that
  * backends send requests with cutoff_times a little bit in the past.
@@ -248,83 +298,9 @@ typedef struct PgStat_MsgInquiry
 	PgStat_MsgHdr m_hdr;
 	TimestampTz clock_time;		/* observed local clock time */
 	TimestampTz cutoff_time;	/* minimum acceptable file timestamp */
-	Oid			databaseid;		/* requested DB (InvalidOid => shared only) */
 } PgStat_MsgInquiry;
 
 
-/* ----------
- * PgStat_TableEntry			Per-table info in a MsgTabstat
- * ----------
- */
-typedef struct PgStat_TableEntry
-{
-	Oid			t_id;
-	PgStat_TableCounts t_counts;
-} PgStat_TableEntry;
-
-/* ----------
- * PgStat_MsgTabstat			Sent by the backend to report table
- *								and buffer access statistics.
- * ----------
- */
-#define PGSTAT_NUM_TABENTRIES  \
-	((PGSTAT_MSG_PAYLOAD - sizeof(Oid) - 3 * sizeof(int) - 2 * sizeof(PgStat_Counter))	\
-	 / sizeof(PgStat_TableEntry))
-
-typedef struct PgStat_MsgTabstat
-{
-	PgStat_MsgHdr m_hdr;
-	Oid			m_databaseid;
-	int			m_nentries;
-	int			m_xact_commit;
-	int			m_xact_rollback;
-	PgStat_Counter m_block_read_time;	/* times in microseconds */
-	PgStat_Counter m_block_write_time;
-	PgStat_TableEntry m_entry[PGSTAT_NUM_TABENTRIES];
-} PgStat_MsgTabstat;
-
-
-/* ----------
- * PgStat_MsgTabpurge			Sent by the backend to tell the collector
- *								about dead tables.
- * ----------
- */
-#define PGSTAT_NUM_TABPURGE  \
-	((PGSTAT_MSG_PAYLOAD - sizeof(Oid) - sizeof(int))  \
-	 / sizeof(Oid))
-
-typedef struct PgStat_MsgTabpurge
-{
-	PgStat_MsgHdr m_hdr;
-	Oid			m_databaseid;
-	int			m_nentries;
-	Oid			m_tableid[PGSTAT_NUM_TABPURGE];
-} PgStat_MsgTabpurge;
-
-
-/* ----------
- * PgStat_MsgDropdb				Sent by the backend to tell the collector
- *								about a dropped database
- * ----------
- */
-typedef struct PgStat_MsgDropdb
-{
-	PgStat_MsgHdr m_hdr;
-	Oid			m_databaseid;
-} PgStat_MsgDropdb;
-
-
-/* ----------
- * PgStat_MsgResetcounter		Sent by the backend to tell the collector
- *								to reset counters
- * ----------
- */
-typedef struct PgStat_MsgResetcounter
-{
-	PgStat_MsgHdr m_hdr;
-	Oid			m_databaseid;
-} PgStat_MsgResetcounter;
-
 /* ----------
  * PgStat_MsgResetsharedcounter Sent by the backend to tell the collector
  *								to reset a shared counter
@@ -336,19 +312,6 @@ typedef struct PgStat_MsgResetsharedcounter
 	PgStat_Shared_Reset_Target m_resettarget;
 } PgStat_MsgResetsharedcounter;
 
-/* ----------
- * PgStat_MsgResetsinglecounter Sent by the backend to tell the collector
- *								to reset a single counter
- * ----------
- */
-typedef struct PgStat_MsgResetsinglecounter
-{
-	PgStat_MsgHdr m_hdr;
-	Oid			m_databaseid;
-	PgStat_Single_Reset_Type m_resettype;
-	Oid			m_objectid;
-} PgStat_MsgResetsinglecounter;
-
 /* ----------
  * PgStat_MsgResetslrucounter Sent by the backend to tell the collector
  *								to reset a SLRU counter
@@ -372,54 +335,6 @@ typedef struct PgStat_MsgResetreplslotcounter
 	bool		clearall;
 } PgStat_MsgResetreplslotcounter;
 
-/* ----------
- * PgStat_MsgAutovacStart		Sent by the autovacuum daemon to signal
- *								that a database is going to be processed
- * ----------
- */
-typedef struct PgStat_MsgAutovacStart
-{
-	PgStat_MsgHdr m_hdr;
-	Oid			m_databaseid;
-	TimestampTz m_start_time;
-} PgStat_MsgAutovacStart;
-
-
-/* ----------
- * PgStat_MsgVacuum				Sent by the backend or autovacuum daemon
- *								after VACUUM
- * ----------
- */
-typedef struct PgStat_MsgVacuum
-{
-	PgStat_MsgHdr m_hdr;
-	Oid			m_databaseid;
-	Oid			m_tableoid;
-	bool		m_autovacuum;
-	TimestampTz m_vacuumtime;
-	PgStat_Counter m_live_tuples;
-	PgStat_Counter m_dead_tuples;
-} PgStat_MsgVacuum;
-
-
-/* ----------
- * PgStat_MsgAnalyze			Sent by the backend or autovacuum daemon
- *								after ANALYZE
- * ----------
- */
-typedef struct PgStat_MsgAnalyze
-{
-	PgStat_MsgHdr m_hdr;
-	Oid			m_databaseid;
-	Oid			m_tableoid;
-	bool		m_autovacuum;
-	bool		m_resetcounter;
-	TimestampTz m_analyzetime;
-	PgStat_Counter m_live_tuples;
-	PgStat_Counter m_dead_tuples;
-} PgStat_MsgAnalyze;
-
-
 /* ----------
  * PgStat_MsgArchiver			Sent by the archiver to update statistics.
  * ----------
@@ -463,8 +378,32 @@ typedef struct PgStat_MsgWal
 	PgStat_Counter m_wal_fpi;
 	uint64		m_wal_bytes;
 	PgStat_Counter m_wal_buffers_full;
+	PgStat_Counter m_wal_flushes;
+	PgStat_Counter m_wal_flush_requests;
 } PgStat_MsgWal;
 
+/* ----------
+ * PgStat_MsgWalRecords		Sent by backends and background processes to
+ *							update per-record-type WAL statistics.
+ * ----------
+ */
+typedef struct PgStat_WalRecordEntry
+{
+	RmgrId		rmid;
+	uint8		type;			/* xl_info >> 4 */
+	PgStat_WalRecordCounters counters;
+} PgStat_WalRecordEntry;
+
+#define PGSTAT_NUM_WALRECORDENTRIES \
+	((PGSTAT_MSG_PAYLOAD - sizeof(int)) / sizeof(PgStat_WalRecordEntry))
+
+typedef struct PgStat_MsgWalRecords
+{
+	PgStat_MsgHdr m_hdr;
+	int			m_nentries;
+	PgStat_WalRecordEntry m_entry[PGSTAT_NUM_WALRECORDENTRIES];
+} PgStat_MsgWalRecords;
+
 /* ----------
  * PgStat_MsgSLRU			Sent by a backend to update SLRU statistics.
  * ----------
@@ -500,30 +439,18 @@ typedef struct PgStat_MsgReplSlot
 	PgStat_Counter m_stream_bytes;
 } PgStat_MsgReplSlot;
 
-
 /* ----------
- * PgStat_MsgRecoveryConflict	Sent by the backend upon recovery conflict
+ * PgStat_MsgIO				Sent by backends and background processes to
+ *							update I/O statistics.
  * ----------
  */
-typedef struct PgStat_MsgRecoveryConflict
+typedef struct PgStat_MsgIO
 {
 	PgStat_MsgHdr m_hdr;
+	BackendType m_backend_type;
+	PgStat_IOCounters m_counters[IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES];
+} PgStat_MsgIO;
 
-	Oid			m_databaseid;
-	int			m_reason;
-} PgStat_MsgRecoveryConflict;
-
-/* ----------
- * PgStat_MsgTempFile	Sent by the backend upon creating a temp file
- * ----------
- */
-typedef struct PgStat_MsgTempFile
-{
-	PgStat_MsgHdr m_hdr;
-
-	Oid			m_databaseid;
-	size_t		m_filesize;
-} PgStat_MsgTempFile;
 
 /* ----------
  * PgStat_FunctionCounts	The actual per-function counts kept by a backend
@@ -532,7 +459,7 @@ typedef struct PgStat_MsgTempFile
  * it against zeroes to detect whether there are any counts to transmit.
  *
  * Note that the time counters are in instr_time format here.  We convert to
- * microseconds in PgStat_Counter format when transmitting to the collector.
+ * microseconds in PgStat_Counter format when flushing to shared memory.
  * ----------
  */
 typedef struct PgStat_FunctionCounts
@@ -552,77 +479,6 @@ typedef struct PgStat_BackendFunctionEntry
 	PgStat_FunctionCounts f_counts;
 } PgStat_BackendFunctionEntry;
 
-/* ----------
- * PgStat_FunctionEntry			Per-function info in a MsgFuncstat
- * ----------
- */
-typedef struct PgStat_FunctionEntry
-{
-	Oid			f_id;
-	PgStat_Counter f_numcalls;
-	PgStat_Counter f_total_time;	/* times in microseconds */
-	PgStat_Counter f_self_time;
-} PgStat_FunctionEntry;
-
-/* ----------
- * PgStat_MsgFuncstat			Sent by the backend to report function
- *								usage statistics.
- * ----------
- */
-#define PGSTAT_NUM_FUNCENTRIES	\
-	((PGSTAT_MSG_PAYLOAD - sizeof(Oid) - sizeof(int))  \
-	 / sizeof(PgStat_FunctionEntry))
-
-typedef struct PgStat_MsgFuncstat
-{
-	PgStat_MsgHdr m_hdr;
-	Oid			m_databaseid;
-	int			m_nentries;
-	PgStat_FunctionEntry m_entry[PGSTAT_NUM_FUNCENTRIES];
-} PgStat_MsgFuncstat;
-
-/* ----------
- * PgStat_MsgFuncpurge			Sent by the backend to tell the collector
- *								about dead functions.
- * ----------
- */
-#define PGSTAT_NUM_FUNCPURGE  \
-	((PGSTAT_MSG_PAYLOAD - sizeof(Oid) - sizeof(int))  \
-	 / sizeof(Oid))
-
-typedef struct PgStat_MsgFuncpurge
-{
-	PgStat_MsgHdr m_hdr;
-	Oid			m_databaseid;
-	int			m_nentries;
-	Oid			m_functionid[PGSTAT_NUM_FUNCPURGE];
-} PgStat_MsgFuncpurge;
-
-/* ----------
- * PgStat_MsgDeadlock			Sent by the backend to tell the collector
- *								about a deadlock that occurred.
- * ----------
- */
-typedef struct PgStat_MsgDeadlock
-{
-	PgStat_MsgHdr m_hdr;
-	Oid			m_databaseid;
-} PgStat_MsgDeadlock;
-
-/* ----------
- * PgStat_MsgChecksumFailure	Sent by the backend to tell the collector
- *								about checksum failures noticed.
- * ----------
- */
-typedef struct PgStat_MsgChecksumFailure
-{
-	PgStat_MsgHdr m_hdr;
-	Oid			m_databaseid;
-	int			m_failurecount;
-	TimestampTz m_failure_time;
-} PgStat_MsgChecksumFailure;
-
-
 /* ----------
  * PgStat_Msg					Union over all possible messages.
  * ----------
@@ -632,28 +488,16 @@ typedef union PgStat_Msg
 	PgStat_MsgHdr msg_hdr;
 	PgStat_MsgDummy msg_dummy;
 	PgStat_MsgInquiry msg_inquiry;
-	PgStat_MsgTabstat msg_tabstat;
-	PgStat_MsgTabpurge msg_tabpurge;
-	PgStat_MsgDropdb msg_dropdb;
-	PgStat_MsgResetcounter msg_resetcounter;
 	PgStat_MsgResetsharedcounter msg_resetsharedcounter;
-	PgStat_MsgResetsinglecounter msg_resetsinglecounter;
 	PgStat_MsgResetslrucounter msg_resetslrucounter;
 	PgStat_MsgResetreplslotcounter msg_resetreplslotcounter;
-	PgStat_MsgAutovacStart msg_autovacuum_start;
-	PgStat_MsgVacuum msg_vacuum;
-	PgStat_MsgAnalyze msg_analyze;
 	PgStat_MsgArchiver msg_archiver;
 	PgStat_MsgBgWriter msg_bgwriter;
 	PgStat_MsgWal msg_wal;
+	PgStat_MsgWalRecords msg_walrecords;
 	PgStat_MsgSLRU msg_slru;
-	PgStat_MsgFuncstat msg_funcstat;
-	PgStat_MsgFuncpurge msg_funcpurge;
-	PgStat_MsgRecoveryConflict msg_recoveryconflict;
-	PgStat_MsgDeadlock msg_deadlock;
-	PgStat_MsgTempFile msg_tempfile;
-	PgStat_MsgChecksumFailure msg_checksumfailure;
 	PgStat_MsgReplSlot msg_replslot;
+	PgStat_MsgIO msg_io;
 } PgStat_Msg;
 
 
@@ -665,10 +509,10 @@ typedef union PgStat_Msg
  * ------------------------------------------------------------
  */
 
-#define PGSTAT_FILE_FORMAT_ID	0x01A5BC9F
+#define PGSTAT_FILE_FORMAT_ID	0x01A5BCA3
 
 /* ----------
- * PgStat_StatDBEntry			The collector's data per database
+ * PgStat_StatDBEntry			Shared-memory statistics per database
  * ----------
  */
 typedef struct PgStat_StatDBEntry
@@ -698,19 +542,11 @@ typedef struct PgStat_StatDBEntry
 	PgStat_Counter n_block_write_time;
 
 	TimestampTz stat_reset_timestamp;
-	TimestampTz stats_timestamp;	/* time of db stats file update */
-
-	/*
-	 * tables and functions must be last in the struct, because we don't write
-	 * the pointers out to the stats file.
-	 */
-	HTAB	   *tables;
-	HTAB	   *functions;
 } PgStat_StatDBEntry;
 
 
 /* ----------
- * PgStat_StatTabEntry			The collector's data per table (or index)
+ * PgStat_StatTabEntry			Shared-memory statistics per table (or index)
  * ----------
  */
 typedef struct PgStat_StatTabEntry
@@ -747,7 +583,7 @@ typedef struct PgStat_StatTabEntry
 
 
 /* ----------
- * PgStat_StatFuncEntry			The collector's data per function
+ * PgStat_StatFuncEntry			Shared-memory statistics per function
  * ----------
  */
 typedef struct PgStat_StatFuncEntry
@@ -805,6 +641,9 @@ typedef struct PgStat_WalStats
 	PgStat_Counter wal_fpi;
 	uint64		wal_bytes;
 	PgStat_Counter wal_buffers_full;
+	PgStat_Counter wal_flushes;
+	PgStat_Counter wal_flush_requests;
+	PgStat_WalRecordCounters records[RM_MAX_ID + 1][PGSTAT_WAL_RECORD_TYPES];
 	TimestampTz stat_reset_timestamp;
 } PgStat_WalStats;
 
@@ -823,6 +662,15 @@ typedef struct PgStat_SLRUStats
 	TimestampTz stat_reset_timestamp;
 } PgStat_SLRUStats;
 
+/*
+ * I/O statistics kept in the stats collector, per backend type
+ */
+typedef struct PgStat_IOStats
+{
+	PgStat_IOCounters stats[BACKEND_NUM_TYPES][IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES];
+	TimestampTz stat_reset_timestamp;
+} PgStat_IOStats;
+
 /*
  * Replication slot statistics kept in the stats collector
  */
@@ -886,8 +734,10 @@ typedef enum
 	WAIT_EVENT_LOGICAL_APPLY_MAIN,
 	WAIT_EVENT_LOGICAL_LAUNCHER_MAIN,
 	WAIT_EVENT_PGSTAT_MAIN,
+	WAIT_EVENT_PREFORKED_BACKEND_IDLE,
 	WAIT_EVENT_RECOVERY_WAL_STREAM,
 	WAIT_EVENT_SYSLOGGER_MAIN,
+	WAIT_EVENT_WAIT_SAMPLER_MAIN,
 	WAIT_EVENT_WAL_RECEIVER_MAIN,
 	WAIT_EVENT_WAL_SENDER_MAIN,
 	WAIT_EVENT_WAL_WRITER_MAIN
@@ -923,7 +773,8 @@ typedef enum
  */
 typedef enum
 {
-	WAIT_EVENT_BACKUP_WAIT_WAL_ARCHIVE = PG_WAIT_IPC,
+	WAIT_EVENT_APPEND_READY = PG_WAIT_IPC,
+	WAIT_EVENT_BACKUP_WAIT_WAL_ARCHIVE,
 	WAIT_EVENT_BGWORKER_SHUTDOWN,
 	WAIT_EVENT_BGWORKER_STARTUP,
 	WAIT_EVENT_BTREE_PAGE,
@@ -1170,6 +1021,9 @@ typedef struct PgBackendStatus
 	/* Type of backends */
 	BackendType st_backendType;
 
+	/* Index of the backend's PGPROC in ProcGlobal->allProcs, or -1 */
+	int			st_procno;
+
 	/* Times when current backend, transaction, and activity started */
 	TimestampTz st_proc_start_timestamp;
 	TimestampTz st_xact_start_timestamp;
@@ -1193,6 +1047,9 @@ typedef struct PgBackendStatus
 	/* current state */
 	BackendState st_state;
 
+	/* query identifier of the top-level statement being run, or 0 */
+	uint64		st_query_id;
+
 	/* application name; MUST be null-terminated */
 	char	   *st_appname;
 
@@ -1359,10 +1216,14 @@ extern PgStat_Counter pgStatBlockWriteTime;
  */
 extern Size BackendStatusShmemSize(void);
 extern void CreateSharedBackendStatus(void);
+extern Size PgStatShmemSize(void);
+extern void PgStatShmemInit(void);
 
 extern void pgstat_init(void);
 extern int	pgstat_start(void);
 extern void pgstat_reset_all(void);
+extern void pgstat_restore_shared_stats(void);
+extern void pgstat_save_shared_stats(void);
 extern void allow_immediate_pgstat_restart(void);
 
 #ifdef EXEC_BACKEND
@@ -1406,6 +1267,10 @@ extern void pgstat_initialize(void);
 extern void pgstat_bestart(void);
 
 extern void pgstat_report_activity(BackendState state, const char *cmd_str);
+extern void pgstat_report_query_id(uint64 query_id);
+struct WaitSample;
+extern int	pgstat_sample_wait_events(struct WaitSample *samples,
+									  TimestampTz now);
 extern void pgstat_report_tempfile(size_t filesize);
 extern void pgstat_report_appname(const char *appname);
 extern void pgstat_report_xact_timestamp(TimestampTz tstamp);
@@ -1524,6 +1389,8 @@ pgstat_report_wait_end(void)
 	(pgStatBlockReadTime += (n))
 #define pgstat_count_buffer_write_time(n)							\
 	(pgStatBlockWriteTime += (n))
+#define pgstat_count_io_op(obj, ctx, op)							\
+	pgstat_count_io_op_n(obj, ctx, op, 1)
 
 extern void pgstat_count_heap_insert(Relation rel, PgStat_Counter n);
 extern void pgstat_count_heap_update(Relation rel, bool hot);
@@ -1551,6 +1418,14 @@ extern void pgstat_twophase_postabort(TransactionId xid, uint16 info,
 extern void pgstat_send_archiver(const char *xlog, bool failed);
 extern void pgstat_send_bgwriter(void);
 extern void pgstat_send_wal(void);
+extern void pgstat_count_wal_record(RmgrId rmid, uint8 info, uint32 len,
+									int num_fpi, uint32 fpi_bytes);
+
+extern void pgstat_count_io_op_n(IOObject io_object, IOContext io_context,
+								 IOOp io_op, uint32 cnt);
+extern void pgstat_count_io_time(IOObject io_object, IOContext io_context,
+								 IOOp io_op, instr_time io_time);
+extern void pgstat_send_io(void);
 
 /* ----------
  * Support functions for the SQL-callable functions to
@@ -1559,6 +1434,8 @@ extern void pgstat_send_wal(void);
  */
 extern PgStat_StatDBEntry *pgstat_fetch_stat_dbentry(Oid dbid);
 extern PgStat_StatTabEntry *pgstat_fetch_stat_tabentry(Oid relid);
+extern PgStat_StatTabEntry *pgstat_fetch_stat_tabentry_ext(bool shared,
+														   Oid relid);
 extern PgBackendStatus *pgstat_fetch_stat_beentry(int beid);
 extern LocalPgBackendStatus *pgstat_fetch_stat_local_beentry(int beid);
 extern PgStat_StatFuncEntry *pgstat_fetch_stat_funcentry(Oid funcid);
@@ -1567,6 +1444,7 @@ extern PgStat_ArchiverStats *pgstat_fetch_stat_archiver(void);
 extern PgStat_GlobalStats *pgstat_fetch_global(void);
 extern PgStat_WalStats *pgstat_fetch_stat_wal(void);
 extern PgStat_SLRUStats *pgstat_fetch_slru(void);
+extern PgStat_IOStats *pgstat_fetch_stat_io(void);
 extern PgStat_ReplSlotStats *pgstat_fetch_replslot(int *nslots_p);
 
 extern void pgstat_count_slru_page_zeroed(int slru_idx);
@@ -0,0 +1,192 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_simd.h
+ *	  Support for platform-specific vector operations.
+ *
+ * These are thin wrappers around the 128-bit vector instructions that every
+ * CPU of a given architecture is guaranteed to have, so no runtime check is
+ * needed: SSE2 on x86-64 and Advanced SIMD (NEON) on 64-bit ARM.  On other
+ * platforms USE_NO_SIMD is defined, and callers must provide a scalar
+ * fallback.
+ *
+ * Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * src/include/port/pg_simd.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PG_SIMD_H
+#define PG_SIMD_H
+
+#if (defined(__x86_64__) || defined(_M_AMD64))
+/*
+ * SSE2 instructions are part of the spec for the 64-bit x86 ISA, so we can
+ * assume them without checking.
+ */
+#include <emmintrin.h>
+#define USE_SSE2
+typedef __m128i Vector8;
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+/*
+ * Advanced SIMD is mandatory on AArch64, so we can likewise assume it.
+ */
+#include <arm_neon.h>
+#define USE_NEON
+typedef uint8x16_t Vector8;
+
+#else
+/*
+ * No vector support; callers fall back to processing one byte at a time.
+ */
+#define USE_NO_SIMD
+#endif
+
+#ifndef USE_NO_SIMD
+
+/*
+ * Load a chunk of memory into the given vector.  No alignment is required.
+ */
+static inline void
+vector8_load(Vector8 *v, const uint8 *s)
+{
+#if defined(USE_SSE2)
+	*v = _mm_loadu_si128((const __m128i *) s);
+#elif defined(USE_NEON)
+	*v = vld1q_u8(s);
+#endif
+}
+
+/*
+ * Create a vector with all elements set to the same value.
+ */
+static inline Vector8
+vector8_broadcast(const uint8 c)
+{
+#if defined(USE_SSE2)
+	return _mm_set1_epi8((char) c);
+#elif defined(USE_NEON)
+	return vdupq_n_u8(c);
+#endif
+}
+
+/*
+ * Return a vector with each element set to all ones where the corresponding
+ * elements of the inputs are equal, and to zero elsewhere.
+ */
+static inline Vector8
+vector8_eq(const Vector8 v1, const Vector8 v2)
+{
+#if defined(USE_SSE2)
+	return _mm_cmpeq_epi8(v1, v2);
+#elif defined(USE_NEON)
+	return vceqq_u8(v1, v2);
+#endif
+}
+
+/*
+ * Return a vector with each element set to all ones where the element of v1
+ * is less than or equal to the corresponding element of v2, comparing as
+ * unsigned values, and to zero elsewhere.
+ */
+static inline Vector8
+vector8_le(const Vector8 v1, const Vector8 v2)
+{
+#if defined(USE_SSE2)
+	return _mm_cmpeq_epi8(_mm_min_epu8(v1, v2), v1);
+#elif defined(USE_NEON)
+	return vcleq_u8(v1, v2);
+#endif
+}
+
+/*
+ * Return the bitwise OR of the inputs.
+ */
+static inline Vector8
+vector8_or(const Vector8 v1, const Vector8 v2)
+{
+#if defined(USE_SSE2)
+	return _mm_or_si128(v1, v2);
+#elif defined(USE_NEON)
+	return vorrq_u8(v1, v2);
+#endif
+}
+
+/*
+ * Return the bitwise AND of v1 and the complement of v2.
+ */
+static inline Vector8
+vector8_andnot(const Vector8 v1, const Vector8 v2)
+{
+#if defined(USE_SSE2)
+	return _mm_andnot_si128(v2, v1);
+#elif defined(USE_NEON)
+	return vbicq_u8(v1, v2);
+#endif
+}
+
+/*
+ * Return true if all bits of the vector are zero.
+ */
+static inline bool
+vector8_is_zero(const Vector8 v)
+{
+#if defined(USE_SSE2)
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xFFFF;
+#elif defined(USE_NEON)
+	return vmaxvq_u8(v) == 0;
+#endif
+}
+
+/*
+ * Return true if the high bit of any element is set.
+ */
+static inline bool
+vector8_is_highbit_set(const Vector8 v)
+{
+#if defined(USE_SSE2)
+	return _mm_movemask_epi8(v) != 0;
+#elif defined(USE_NEON)
+	return vmaxvq_u8(v) > 0x7F;
+#endif
+}
+
+/*
+ * Return a bitmask with bit i set if the high bit of element i is set.
+ */
+static inline uint32
+vector8_highbit_mask(const Vector8 v)
+{
+#if defined(USE_SSE2)
+	return (uint32) _mm_movemask_epi8(v);
+#elif defined(USE_NEON)
+	/*
+	 * There's no direct equivalent of movemask on NEON.  Turn each element
+	 * into all ones or all zeros according to its high bit, keep a different
+	 * bit of each half's elements, and add up the halves horizontally.
+	 */
+	static const uint8 mask[16] = {
+		1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6, 1 << 7,
+		1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6, 1 << 7,
+	};
+	uint8x16_t	bits;
+
+	bits = vandq_u8(vreinterpretq_u8_s8(vshrq_n_s8(vreinterpretq_s8_u8(v), 7)),
+					vld1q_u8(mask));
+	return (uint32) vaddv_u8(vget_low_u8(bits)) |
+		((uint32) vaddv_u8(vget_high_u8(bits)) << 8);
+#endif
+}
+
+/*
+ * Return true if any element of the vector is equal to c.
+ */
+static inline bool
+vector8_has(const Vector8 v, const uint8 c)
+{
+	return vector8_is_highbit_set(vector8_eq(v, vector8_broadcast(c)));
+}
+
+#endif							/* ! USE_NO_SIMD */
+
+#endif							/* PG_SIMD_H */
@@ -39,6 +39,7 @@ extern int	autovacuum_anl_thresh;
 extern double autovacuum_anl_scale;
 extern int	autovacuum_freeze_max_age;
 extern int	autovacuum_multixact_freeze_max_age;
+extern int	autovacuum_parallel_workers;
 extern double autovacuum_vac_cost_delay;
 extern int	autovacuum_vac_cost_limit;
 
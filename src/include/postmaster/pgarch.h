@@ -36,4 +36,52 @@ extern int	pgarch_start(void);
 extern void PgArchiverMain(int argc, char *argv[]) pg_attribute_noreturn();
 #endif
 
+/* GUC parameter */
+extern char *XLogArchiveLibrary;
+
+/*
+ * Callbacks for archive modules
+ *
+ * An archive module is a shared library loaded into the archiver process,
+ * that archives WAL files itself instead of the archiver running
+ * archive_command for each of them.  It must define _PG_archive_module_init,
+ * which fills in the callbacks below.  archive_file_cb is required, the
+ * other callbacks are optional.
+ *
+ * check_configured_cb returns false if the module is not set up to archive
+ * anything yet, in which case the archiver waits and checks again later.
+ *
+ * archive_file_cb archives the WAL file "file", which can be read at "path",
+ * a path relative to the data directory, and returns true if that
+ * succeeded.  It's called in a short-lived memory context, which is reset
+ * after each file.  An ERROR makes the archiver exit, after which the
+ * postmaster starts a new one.
+ *
+ * shutdown_cb is called when the archiver exits, including when it exits
+ * because archive_library was changed.
+ */
+typedef bool (*ArchiveCheckConfiguredCB) (void);
+typedef bool (*ArchiveFileCB) (const char *file, const char *path);
+typedef void (*ArchiveShutdownCB) (void);
+
+typedef struct ArchiveModuleCallbacks
+{
+	ArchiveCheckConfiguredCB check_configured_cb;
+	ArchiveFileCB archive_file_cb;
+	ArchiveShutdownCB shutdown_cb;
+} ArchiveModuleCallbacks;
+
+/*
+ * Type of the shared library symbol _PG_archive_module_init that is looked
+ * up when loading an archive library.
+ */
+typedef void (*ArchiveModuleInit) (ArchiveModuleCallbacks *cb);
+
+extern PGDLLEXPORT void _PG_archive_module_init(ArchiveModuleCallbacks *cb);
+
+/*
+ * Archiving with archive_command, used when archive_library is not set
+ */
+extern void shell_archive_init(ArchiveModuleCallbacks *cb);
+
 #endif							/* _PGARCH_H */
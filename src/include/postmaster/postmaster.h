@@ -16,6 +16,7 @@
 /* GUC options */
 extern bool EnableSSL;
 extern int	ReservedBackends;
+extern int	PreforkBackends;
 extern PGDLLIMPORT int PostPortNumber;
 extern int	Unix_socket_permissions;
 extern char *Unix_socket_group;
@@ -74,4 +75,7 @@ extern void ShmemBackendArrayAllocation(void);
  */
 #define MAX_BACKENDS	0x3FFFF
 
+/* Maximum number of sockets the postmaster listens on, per port */
+#define MAXLISTEN	64
+
 #endif							/* _POSTMASTER_H */
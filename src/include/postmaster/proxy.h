@@ -0,0 +1,35 @@
+/*-------------------------------------------------------------------------
+ *
+ * proxy.h
+ *	  Exports from postmaster/proxy.c.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/postmaster/proxy.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _PROXY_H
+#define _PROXY_H
+
+#include "lib/stringinfo.h"
+
+/* upper limit for connection_proxies */
+#define MAX_CONNECTION_PROXIES	64
+
+/* GUC parameters */
+extern PGDLLIMPORT int ConnectionProxies;
+extern PGDLLIMPORT int ProxyPortNumber;
+extern PGDLLIMPORT int SessionPoolSize;
+
+/* Functions called from postmaster */
+extern void ConnectionProxyMain(int proxyIndex, pgsocket *listenSockets,
+								pgsocket pmChannel) pg_attribute_noreturn();
+
+/* Functions called from backends serving a proxy */
+extern void ProxyAuthenticateClient(StringInfo msg);
+extern void ProxyPinSession(void);
+extern void ProxyReportSessionState(void);
+
+#endif							/* _PROXY_H */
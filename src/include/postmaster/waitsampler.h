@@ -0,0 +1,40 @@
+/*-------------------------------------------------------------------------
+ *
+ * waitsampler.h
+ *	  Exports from postmaster/waitsampler.c.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ *
+ * src/include/postmaster/waitsampler.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef WAITSAMPLER_H
+#define WAITSAMPLER_H
+
+#include "datatype/timestamp.h"
+#include "miscadmin.h"
+
+/*
+ * One observation of one process, as stored in the sample history.
+ * wait_event_info is zero if the process was running rather than waiting.
+ */
+typedef struct WaitSample
+{
+	TimestampTz sample_time;
+	int			pid;
+	BackendType backend_type;
+	uint32		wait_event_info;
+	uint64		query_id;
+} WaitSample;
+
+/* GUC options */
+extern int	wait_sampling_interval;
+extern int	wait_sampling_history_size;
+
+extern Size WaitSamplerShmemSize(void);
+extern void WaitSamplerShmemInit(void);
+extern void WaitSamplerRegister(void);
+extern void WaitSamplerMain(Datum main_arg) pg_attribute_noreturn();
+
+#endif							/* WAITSAMPLER_H */
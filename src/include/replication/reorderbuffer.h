@@ -18,6 +18,14 @@
 #include "utils/timestamp.h"
 
 extern PGDLLIMPORT int logical_decoding_work_mem;
+extern PGDLLIMPORT int logical_decoding_spill_compression;
+
+/* Possible values for logical_decoding_spill_compression */
+typedef enum LogicalDecodingSpillCompression
+{
+	LOGICAL_DECODING_SPILL_COMPRESSION_OFF,
+	LOGICAL_DECODING_SPILL_COMPRESSION_PGLZ
+} LogicalDecodingSpillCompression;
 
 /* an individual tuple, stored in one chunk of memory */
 typedef struct ReorderBufferTupleBuf
@@ -14,6 +14,7 @@
 
 #include "access/xlog.h"
 #include "nodes/nodes.h"
+#include "port/atomics.h"
 #include "replication/syncrep.h"
 #include "storage/latch.h"
 #include "storage/shmem.h"
@@ -104,6 +105,14 @@ typedef struct
 	 */
 	bool		sync_standbys_defined;
 
+	/*
+	 * Number of waits for each synchronous replication level, and the total
+	 * time spent in them in microseconds.  Updated by the waiting backends
+	 * themselves, without any lock.
+	 */
+	pg_atomic_uint64 sync_rep_waits[NUM_SYNC_REP_WAIT_MODE];
+	pg_atomic_uint64 sync_rep_wait_time[NUM_SYNC_REP_WAIT_MODE];
+
 	WalSnd		walsnds[FLEXIBLE_ARRAY_MEMBER];
 } WalSndCtlData;
 
@@ -32,17 +32,29 @@
 
 typedef struct BufFile BufFile;
 
+/* Possible values for temp_file_compression */
+typedef enum TempFileCompression
+{
+	TEMP_FILE_COMPRESSION_OFF,
+	TEMP_FILE_COMPRESSION_PGLZ
+} TempFileCompression;
+
+/* GUC variable */
+extern int	temp_file_compression;
+
 /*
  * prototypes for functions in buffile.c
  */
 
 extern BufFile *BufFileCreateTemp(bool interXact);
+extern BufFile *BufFileCreateCompressTemp(bool interXact);
 extern void BufFileClose(BufFile *file);
 extern size_t BufFileRead(BufFile *file, void *ptr, size_t size);
 extern void BufFileWrite(BufFile *file, void *ptr, size_t size);
 extern int	BufFileSeek(BufFile *file, int fileno, off_t offset, int whence);
 extern void BufFileTell(BufFile *file, int *fileno, off_t *offset);
 extern int	BufFileSeekBlock(BufFile *file, long blknum);
+extern void BufFilePrefetchBlock(BufFile *file, long blknum, long nblocks);
 extern int64 BufFileSize(BufFile *file);
 extern long BufFileAppend(BufFile *target, BufFile *source);
 
@@ -46,12 +46,38 @@
 #include <dirent.h>
 
 
+struct iovec;
+
 typedef int File;
 
+/*
+ * FileStartRead() returns a handle identifying the read, to be passed to
+ * FileWaitRead() once the caller needs the data.
+ */
+typedef int FileIoHandle;
+
+/* Possible values for io_method */
+typedef enum IoMethod
+{
+	IO_METHOD_SYNC,				/* read at wait time, after posix_fadvise() */
+	IO_METHOD_POSIX_AIO			/* aio_read() at start, aio_suspend() at wait */
+} IoMethod;
+
+/*
+ * Maximum number of reads a backend can have started with FileStartRead()
+ * but not yet waited for.
+ */
+#define MAX_FILE_READS_IN_FLIGHT	128
+
+/* Flags in io_direct_flags, set from the io_direct GUC */
+#define IO_DIRECT_DATA				0x01
+#define IO_DIRECT_WAL				0x02
 
 /* GUC parameter */
 extern PGDLLIMPORT int max_files_per_process;
 extern PGDLLIMPORT bool data_sync_retry;
+extern int	io_method;
+extern int	io_direct_flags;
 
 /*
  * This is private to fd.c, but exported for save/restore_backend_variables()
@@ -82,7 +108,13 @@ extern File OpenTemporaryFile(bool interXact);
 extern void FileClose(File file);
 extern int	FilePrefetch(File file, off_t offset, int amount, uint32 wait_event_info);
 extern int	FileRead(File file, char *buffer, int amount, off_t offset, uint32 wait_event_info);
+extern int	FileReadV(File file, const struct iovec *iov, int iovcnt, off_t offset, uint32 wait_event_info);
+extern FileIoHandle FileStartRead(File file, char *buffer, int amount, off_t offset, uint32 wait_event_info);
+extern int	FileWaitRead(FileIoHandle handle);
+extern int	FileReadsInFlight(void);
 extern int	FileWrite(File file, char *buffer, int amount, off_t offset, uint32 wait_event_info);
+extern int	FileWriteV(File file, const struct iovec *iov, int iovcnt, off_t offset, uint32 wait_event_info);
+extern int	FileFallocate(File file, off_t offset, off_t amount, uint32 wait_event_info);
 extern int	FileSync(File file, uint32 wait_event_info);
 extern off_t FileSize(File file);
 extern int	FileTruncate(File file, off_t offset, uint32 wait_event_info);
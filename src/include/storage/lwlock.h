@@ -18,6 +18,7 @@
 #error "lwlock.h may not be included from frontend code"
 #endif
 
+#include "datatype/timestamp.h"
 #include "port/atomics.h"
 #include "storage/proclist_types.h"
 
@@ -218,9 +219,32 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_SHARED_TIDBITMAP,
 	LWTRANCHE_PARALLEL_APPEND,
 	LWTRANCHE_PER_XACT_PREDICATE_LIST,
+	LWTRANCHE_SHARED_RELCACHE,
+	LWTRANCHE_SHARED_RELCACHE_DSA,
+	LWTRANCHE_PGSTATS_DSA,
+	LWTRANCHE_PGSTATS_HASH,
 	LWTRANCHE_FIRST_USER_DEFINED
 }			BuiltinTrancheIds;
 
+/*
+ * Cumulative usage of an LWLock tranche, as shown in pg_stat_lwlock.  Every
+ * builtin tranche has its own entry; all extension tranches share the last
+ * one.
+ */
+typedef struct LWLockTrancheUsage
+{
+	uint64		acquisitions;	/* number of times the lock was acquired */
+	uint64		contended;		/* number of times we had to sleep for it */
+	uint64		wait_time;		/* time spent sleeping, in microseconds */
+} LWLockTrancheUsage;
+
+#define NUM_LWLOCK_USAGE_SLOTS	(LWTRANCHE_FIRST_USER_DEFINED + 1)
+
+extern Size LWLockUsageShmemSize(void);
+extern void LWLockUsageShmemInit(void);
+extern TimestampTz LWLockGetUsage(LWLockTrancheUsage *usage);
+extern void LWLockResetUsage(void);
+
 /*
  * Prior to PostgreSQL 9.4, we used an enum type called LWLockId to refer
  * to LWLocks.  New code should instead use LWLock *.  However, for the
@@ -45,6 +45,8 @@ typedef struct PGShmemHeader	/* standard header for all Postgres shmem */
 extern int	shared_memory_type;
 extern int	huge_pages;
 extern int	huge_page_size;
+extern int	shared_memory_numa;
+extern int	shared_memory_huge_page_size;
 
 /* Possible values for huge_pages */
 typedef enum
@@ -62,6 +64,13 @@ typedef enum
 	SHMEM_TYPE_MMAP
 }			PGShmemType;
 
+/* Possible values for shared_memory_numa */
+typedef enum
+{
+	SHMEM_NUMA_OFF,
+	SHMEM_NUMA_INTERLEAVE
+}			SharedMemoryNumaType;
+
 #ifndef WIN32
 extern unsigned long UsedShmemSegID;
 #else
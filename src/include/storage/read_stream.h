@@ -0,0 +1,50 @@
+/*-------------------------------------------------------------------------
+ *
+ * read_stream.h
+ *	  Mechanism for reading a sequence of blocks of a relation ahead of use.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/read_stream.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef READ_STREAM_H
+#define READ_STREAM_H
+
+#include "storage/bufmgr.h"
+
+/* Flags controlling read streams */
+
+/* Default behavior */
+#define READ_STREAM_DEFAULT			0x00
+
+/*
+ * The stream is for maintenance work done on behalf of many sessions, such
+ * as VACUUM, so use maintenance_io_concurrency instead of
+ * effective_io_concurrency.
+ */
+#define READ_STREAM_MAINTENANCE		0x01
+
+typedef struct ReadStream ReadStream;
+
+/*
+ * Callback that returns the next block number to read, or InvalidBlockNumber
+ * when there are no more.
+ */
+typedef BlockNumber (*ReadStreamBlockNumberCB) (ReadStream *stream,
+												void *callback_private_data);
+
+extern ReadStream *read_stream_begin_relation(int flags,
+											  Relation rel,
+											  ForkNumber forknum,
+											  BufferAccessStrategy strategy,
+											  ReadStreamBlockNumberCB callback,
+											  void *callback_private_data);
+extern Buffer read_stream_next_buffer(ReadStream *stream);
+extern void read_stream_reset(ReadStream *stream);
+extern void read_stream_end(ReadStream *stream);
+
+#endif							/* READ_STREAM_H */
@@ -0,0 +1,30 @@
+/*-------------------------------------------------------------------------
+ *
+ * autoprepare.h
+ *	  Automatic preparation of repeated simple-protocol queries
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/tcop/autoprepare.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef AUTOPREPARE_H
+#define AUTOPREPARE_H
+
+#include "nodes/params.h"
+#include "nodes/parsenodes.h"
+#include "utils/plancache.h"
+
+/* GUC parameters */
+extern int	autoprepare_threshold;
+extern int	autoprepare_limit;
+
+extern CachedPlanSource *AutoPrepareLookup(RawStmt *parsetree,
+										   const char *query_string,
+										   ParamListInfo *params);
+extern void AutoPrepareReset(void);
+
+#endif							/* AUTOPREPARE_H */
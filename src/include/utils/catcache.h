@@ -103,6 +103,12 @@ typedef struct catctup
 	 */
 	dlist_node	cache_elem;		/* list member of per-bucket list */
 
+	/*
+	 * Each tuple is also a member of CacheHdr->ch_lru, which is kept in
+	 * least-recently-used order while catalog_cache_memory_limit is enabled.
+	 */
+	dlist_node	lru_elem;		/* list member of global LRU list */
+
 	/*
 	 * A tuple marked "dead" must not be returned by subsequent searches.
 	 * However, it won't be physically deleted from the cache until its
@@ -183,8 +189,16 @@ typedef struct catcacheheader
 {
 	slist_head	ch_caches;		/* head of list of CatCache structs */
 	int			ch_ntup;		/* # of tuples in all caches */
+	dlist_head	ch_lru;			/* all tuples, least recently used first */
+	Size		ch_memory;		/* space used by tuples in all caches */
+	uint64		ch_hits;		/* # of searches satisfied by the cache */
+	uint64		ch_misses;		/* # of searches that read the catalogs */
+	uint64		ch_evictions;	/* # of tuples evicted to stay under limit */
 } CatCacheHeader;
 
+/* GUC parameter */
+extern int	catalog_cache_memory_limit;
+
 
 /* this extern duplicates utils/memutils.h... */
 extern PGDLLIMPORT MemoryContext CacheMemoryContext;
@@ -225,6 +239,9 @@ extern void PrepareToInvalidateCacheTuple(Relation relation,
 										  HeapTuple newtuple,
 										  void (*function) (int, uint32, Oid));
 
+extern void CatalogCacheGetStats(int64 *ntup, int64 *memory, uint64 *hits,
+								 uint64 *misses, uint64 *evictions);
+
 extern void PrintCatCacheLeakWarning(HeapTuple tuple);
 extern void PrintCatCacheListLeakWarning(CatCList *list);
 
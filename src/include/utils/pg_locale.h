@@ -73,6 +73,17 @@ extern struct lconv *PGLC_localeconv(void);
 extern void cache_locale_time(void);
 
 
+/*
+ * Weights that order strings of ASCII letters and digits the same way as a
+ * libc collation, see pg_locale_ascii_weights().  primary[] is zero for
+ * characters that aren't covered.
+ */
+typedef struct pg_ascii_weights
+{
+	uint8		primary[256];
+	uint8		tertiary[256];
+} pg_ascii_weights;
+
 /*
  * We define our own wrapper around locale_t so we can keep the same
  * function signatures for all builds, while not having to create a
@@ -83,6 +94,8 @@ struct pg_locale_struct
 {
 	char		provider;
 	bool		deterministic;
+	bool		ascii_weights_done; /* have we tried to set ascii_weights? */
+	const pg_ascii_weights *ascii_weights;	/* NULL if not usable */
 	union
 	{
 #ifdef HAVE_LOCALE_T
@@ -105,6 +118,65 @@ extern pg_locale_t pg_newlocale_from_collation(Oid collid);
 
 extern char *get_collation_version_for_oid(Oid collid);
 
+extern const pg_ascii_weights *pg_locale_ascii_weights(pg_locale_t locale,
+													   bool build);
+
+/*
+ * Compare two strings by ASCII weights, like strcoll() followed by the
+ * memcmp() tie-breaker for deterministic collations.  Returns false if
+ * either string contains a character that the weights don't cover; the
+ * caller must then compare them the slow way.
+ */
+static inline bool
+pg_ascii_weights_cmp(const pg_ascii_weights *weights,
+					 const char *arg1, int len1,
+					 const char *arg2, int len2,
+					 int *result)
+{
+	const unsigned char *s1 = (const unsigned char *) arg1;
+	const unsigned char *s2 = (const unsigned char *) arg2;
+	int			len = Min(len1, len2);
+	int			i;
+
+	for (i = 0; i < len1; i++)
+	{
+		if (weights->primary[s1[i]] == 0)
+			return false;
+	}
+	for (i = 0; i < len2; i++)
+	{
+		if (weights->primary[s2[i]] == 0)
+			return false;
+	}
+
+	/* First the primary weights, then the length, then tertiary weights */
+	for (i = 0; i < len; i++)
+	{
+		if (weights->primary[s1[i]] != weights->primary[s2[i]])
+		{
+			*result = weights->primary[s1[i]] < weights->primary[s2[i]] ? -1 : 1;
+			return true;
+		}
+	}
+	if (len1 != len2)
+	{
+		*result = len1 < len2 ? -1 : 1;
+		return true;
+	}
+	for (i = 0; i < len; i++)
+	{
+		if (weights->tertiary[s1[i]] != weights->tertiary[s2[i]])
+		{
+			*result = weights->tertiary[s1[i]] < weights->tertiary[s2[i]] ? -1 : 1;
+			return true;
+		}
+	}
+
+	/* Break tie */
+	*result = memcmp(arg1, arg2, len);
+	return true;
+}
+
 #ifdef USE_ICU
 extern int32_t icu_to_uchar(UChar **buff_uchar, const char *buff, size_t nbytes);
 extern int32_t icu_from_uchar(char **result, const UChar *buff_uchar, int32_t len_uchar);
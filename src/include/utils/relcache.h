@@ -57,6 +57,8 @@ extern bytea **RelationGetIndexAttOptions(Relation relation, bool copy);
 typedef enum IndexAttrBitmapKind
 {
 	INDEX_ATTR_BITMAP_ALL,
+	INDEX_ATTR_BITMAP_HOT_BLOCKING,
+	INDEX_ATTR_BITMAP_SUMMARIZED,
 	INDEX_ATTR_BITMAP_KEY,
 	INDEX_ATTR_BITMAP_PRIMARY_KEY,
 	INDEX_ATTR_BITMAP_IDENTITY_KEY
@@ -134,6 +136,9 @@ extern void AtEOXact_RelationCache(bool isCommit);
 extern void AtEOSubXact_RelationCache(bool isCommit, SubTransactionId mySubid,
 									  SubTransactionId parentSubid);
 
+extern void RelationCacheGetStats(int64 *nrels, uint64 *hits, uint64 *misses,
+								  uint64 *evictions);
+
 /*
  * Routines to help manage rebuilding of relcache init files
  */
@@ -148,4 +153,7 @@ extern bool criticalRelcachesBuilt;
 /* should be used only by relcache.c and postinit.c */
 extern bool criticalSharedRelcachesBuilt;
 
+/* GUC parameter */
+extern int	max_relation_cache_entries;
+
 #endif							/* RELCACHE_H */
@@ -0,0 +1,32 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedrelcache.h
+ *	  Shared-memory cache of relation tuple descriptors.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedrelcache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDRELCACHE_H
+#define SHAREDRELCACHE_H
+
+#include "access/tupdesc.h"
+#include "storage/sinval.h"
+
+/* GUC parameter, in kB; 0 disables the cache */
+extern PGDLLIMPORT int shared_relation_cache_size;
+
+extern Size SharedRelCacheShmemSize(void);
+extern void SharedRelCacheShmemInit(void);
+
+extern uint64 SharedRelCacheBeginBuild(Oid relid);
+extern bool SharedRelCacheLookup(Oid relid, TupleDesc tupdesc);
+extern void SharedRelCacheStore(Oid relid, uint64 token, TupleDesc tupdesc);
+extern void SharedRelCacheProcessInvalidations(const SharedInvalidationMessage *msgs,
+											   int n);
+
+#endif							/* SHAREDRELCACHE_H */
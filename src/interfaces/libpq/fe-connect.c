@@ -129,6 +129,7 @@ static int	ldapServiceLookup(const char *purl, PQconninfoOption *options,
 #define DefaultChannelBinding	"disable"
 #endif
 #define DefaultTargetSessionAttrs	"any"
+#define DefaultCompression	"off"
 #ifdef USE_SSL
 #define DefaultSSLMode "prefer"
 #else
@@ -355,6 +356,10 @@ static const internalPQconninfoOption PQconninfoOptions[] = {
 		"Target-Session-Attrs", "", 11, /* sizeof("read-write") = 11 */
 	offsetof(struct pg_conn, target_session_attrs)},
 
+	{"compression", "PGCOMPRESSION", DefaultCompression, NULL,
+		"Compression", "", 10,	/* sizeof("zstd,lz4") = 9 */
+	offsetof(struct pg_conn, compression)},
+
 	/* Terminating entry --- MUST BE LAST */
 	{NULL, NULL, NULL, NULL,
 	NULL, NULL, 0}
@@ -468,7 +473,7 @@ pqDropConnection(PGconn *conn, bool flushInput)
 
 	/* Optionally discard any unread data */
 	if (flushInput)
-		conn->inStart = conn->inCursor = conn->inEnd = 0;
+		conn->inStart = conn->inCursor = conn->inEnd = conn->inScanned = 0;
 
 	/* Always discard any unsent data */
 	conn->outCount = 0;
@@ -578,6 +583,13 @@ pqDropServerData(PGconn *conn)
 	}
 	conn->pstatus = NULL;
 	conn->client_encoding = PG_SQL_ASCII;
+
+	/* Forget commands whose results will never arrive */
+	while (conn->cmd_queue_head != NULL)
+		pqCommandQueueAdvance(conn);
+
+	/* Compression is negotiated anew with each server */
+	pqFreeCompression(conn);
 	conn->std_strings = false;
 	conn->sversion = 0;
 
@@ -1409,6 +1421,62 @@ connectOptions2(PGconn *conn)
 		}
 	}
 
+	/*
+	 * Validate the compression option, and work out the list of methods to
+	 * request: "on" means all that this build supports, best first.
+	 */
+	if (conn->compression && strcmp(conn->compression, "off") != 0)
+	{
+		PQExpBufferData methods;
+		const char *p = conn->compression;
+
+		if (strcmp(p, "on") == 0)
+			p = "zstd,lz4";
+
+		initPQExpBuffer(&methods);
+		while (*p)
+		{
+			size_t		len = strcspn(p, ",");
+			char		name[32];
+			PqCompressionMethod method;
+
+			strlcpy(name, p, Min(len + 1, sizeof(name)));
+			if (!pq_compression_parse_method(name, &method))
+			{
+				conn->status = CONNECTION_BAD;
+				printfPQExpBuffer(&conn->errorMessage,
+								  libpq_gettext("invalid %s value: \"%s\"\n"),
+								  "compression",
+								  conn->compression);
+				termPQExpBuffer(&methods);
+				return false;
+			}
+			if (pq_compression_method_supported(method))
+			{
+				if (methods.len > 0)
+					appendPQExpBufferChar(&methods, ',');
+				appendPQExpBufferStr(&methods,
+									 pq_compression_method_name(method));
+			}
+			p += len;
+			if (*p == ',')
+				p++;
+		}
+
+		if (PQExpBufferDataBroken(methods))
+			goto oom_error;
+		if (methods.len == 0)
+		{
+			conn->status = CONNECTION_BAD;
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("compression value \"%s\" invalid when no requested method is compiled in\n"),
+							  conn->compression);
+			termPQExpBuffer(&methods);
+			return false;
+		}
+		conn->compression_methods = methods.data;
+	}
+
 	/*
 	 * Only if we get this far is it appropriate to try to connect. (We need a
 	 * state flag, rather than just the boolean result of this function, in
@@ -2023,7 +2091,7 @@ connectDBStart(PGconn *conn)
 	}
 
 	/* Ensure our buffers are empty */
-	conn->inStart = conn->inCursor = conn->inEnd = 0;
+	conn->inStart = conn->inCursor = conn->inEnd = conn->inScanned = 0;
 	conn->outCount = 0;
 
 	/*
@@ -3225,10 +3293,11 @@ keep_going:						/* We will come back to here until there is
 
 				/*
 				 * Validate message type: we expect only an authentication
-				 * request or an error here.  Anything else probably means
-				 * it's not Postgres on the other end at all.
+				 * request, a protocol negotiation or an error here.  Anything
+				 * else probably means it's not Postgres on the other end at
+				 * all.
 				 */
-				if (!(beresp == 'R' || beresp == 'E'))
+				if (!(beresp == 'R' || beresp == 'v' || beresp == 'E'))
 				{
 					appendPQExpBuffer(&conn->errorMessage,
 									  libpq_gettext("expected authentication request from server, but received %c\n"),
@@ -3259,7 +3328,8 @@ keep_going:						/* We will come back to here until there is
 				 * length in an error, it means we're really talking to a
 				 * pre-3.0-protocol server; cope.
 				 */
-				if (beresp == 'R' && (msgLength < 8 || msgLength > 2000))
+				if ((beresp == 'R' || beresp == 'v') &&
+					(msgLength < 8 || msgLength > 2000))
 				{
 					appendPQExpBuffer(&conn->errorMessage,
 									  libpq_gettext("expected authentication request from server, but received %c\n"),
@@ -3321,6 +3391,18 @@ keep_going:						/* We will come back to here until there is
 					return PGRES_POLLING_READING;
 				}
 
+				/*
+				 * NegotiateProtocolVersion means the server didn't recognize
+				 * some protocol options we sent, as an older server won't
+				 * recognize _pq_.compression.  Those are all optional, so
+				 * carry on without them; no ParameterStatus will enable them.
+				 */
+				if (beresp == 'v')
+				{
+					conn->inStart = conn->inCursor + msgLength;
+					goto keep_going;
+				}
+
 				/* Handle errors. */
 				if (beresp == 'E')
 				{
@@ -4071,8 +4153,9 @@ freePGconn(PGconn *conn)
 	if (conn->connip)
 		free(conn->connip);
 	/* Note that conn->Pfdebug is not ours to close or free */
-	if (conn->last_query)
-		free(conn->last_query);
+	pqFreeCommandQueue(conn->cmd_queue_head);
+	pqFreeCommandQueue(conn->cmd_queue_recycle);
+	pqFreeCompression(conn);
 	if (conn->write_err_msg)
 		free(conn->write_err_msg);
 	if (conn->inBuffer)
@@ -4083,6 +4166,10 @@ freePGconn(PGconn *conn)
 		free(conn->rowBuf);
 	if (conn->target_session_attrs)
 		free(conn->target_session_attrs);
+	if (conn->compression)
+		free(conn->compression);
+	if (conn->compression_methods)
+		free(conn->compression_methods);
 	termPQExpBuffer(&conn->errorMessage);
 	termPQExpBuffer(&conn->workBuffer);
 
@@ -4158,6 +4245,7 @@ closePGconn(PGconn *conn)
 	conn->status = CONNECTION_BAD;	/* Well, not really _bad_ - just absent */
 	conn->asyncStatus = PGASYNC_IDLE;
 	conn->xactStatus = PQTRANS_IDLE;
+	conn->pipelineStatus = PQ_PIPELINE_OFF;
 	pqClearAsyncResult(conn);	/* deallocate result */
 	resetPQExpBuffer(&conn->errorMessage);
 	release_conn_addrinfo(conn);
@@ -6625,11 +6713,19 @@ PQtransactionStatus(const PGconn *conn)
 {
 	if (!conn || conn->status != CONNECTION_OK)
 		return PQTRANS_UNKNOWN;
-	if (conn->asyncStatus != PGASYNC_IDLE)
+	if (conn->asyncStatus != PGASYNC_IDLE || conn->cmd_queue_head != NULL)
 		return PQTRANS_ACTIVE;
 	return conn->xactStatus;
 }
 
+PGpipelineStatus
+PQpipelineStatus(const PGconn *conn)
+{
+	if (!conn)
+		return PQ_PIPELINE_OFF;
+	return conn->pipelineStatus;
+}
+
 const char *
 PQparameterStatus(const PGconn *conn, const char *paramName)
 {
@@ -39,7 +39,9 @@ char	   *const pgresStatus[] = {
 	"PGRES_NONFATAL_ERROR",
 	"PGRES_FATAL_ERROR",
 	"PGRES_COPY_BOTH",
-	"PGRES_SINGLE_TUPLE"
+	"PGRES_SINGLE_TUPLE",
+	"PGRES_PIPELINE_SYNC",
+	"PGRES_PIPELINE_ABORTED"
 };
 
 /*
@@ -53,6 +55,9 @@ static bool static_std_strings = false;
 static PGEvent *dupEvents(PGEvent *events, int count, size_t *memSize);
 static bool pqAddTuple(PGresult *res, PGresAttValue *tup,
 					   const char **errmsgp);
+static PGcmdQueueEntry *pqAllocCmdQueueEntry(PGconn *conn);
+static void pqAppendCmdQueueEntry(PGconn *conn, PGcmdQueueEntry *entry);
+static void pqRecycleCmdQueueEntry(PGconn *conn, PGcmdQueueEntry *entry);
 static bool PQsendQueryStart(PGconn *conn);
 static int	PQsendQueryGuts(PGconn *conn,
 							const char *command,
@@ -63,6 +68,8 @@ static int	PQsendQueryGuts(PGconn *conn,
 							const int *paramLengths,
 							const int *paramFormats,
 							int resultFormat);
+static int	pqPipelineFlush(PGconn *conn);
+static void pqPipelineProcessQueue(PGconn *conn);
 static void parseInput(PGconn *conn);
 static PGresult *getCopyResult(PGconn *conn, ExecStatusType copytype);
 static bool PQexecStart(PGconn *conn);
@@ -1210,7 +1217,7 @@ pqRowProcessor(PGconn *conn, const char **errmsgp)
 		conn->next_result = conn->result;
 		conn->result = res;
 		/* And mark the result ready to return */
-		conn->asyncStatus = PGASYNC_READY;
+		conn->asyncStatus = PGASYNC_READY_MORE;
 	}
 
 	return 1;
@@ -1233,6 +1240,8 @@ fail:
 int
 PQsendQuery(PGconn *conn, const char *query)
 {
+	PGcmdQueueEntry *entry;
+
 	if (!PQsendQueryStart(conn))
 		return 0;
 
@@ -1244,37 +1253,50 @@ PQsendQuery(PGconn *conn, const char *query)
 		return 0;
 	}
 
+	/*
+	 * The simple Query message implies a Sync, and may contain several
+	 * commands, so it can't take part in a pipeline.
+	 */
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("%s not allowed in pipeline mode\n"),
+						  "PQsendQuery");
+		return 0;
+	}
+
+	entry = pqAllocCmdQueueEntry(conn);
+	if (entry == NULL)
+		return 0;				/* error message already set */
+
 	/* construct the outgoing Query message */
 	if (pqPutMsgStart('Q', false, conn) < 0 ||
 		pqPuts(query, conn) < 0 ||
 		pqPutMsgEnd(conn) < 0)
-	{
-		/* error message should be set up already */
-		return 0;
-	}
+		goto sendFailed;
 
 	/* remember we are using simple query protocol */
-	conn->queryclass = PGQUERY_SIMPLE;
+	entry->queryclass = PGQUERY_SIMPLE;
 
 	/* and remember the query text too, if possible */
-	/* if insufficient memory, last_query just winds up NULL */
-	if (conn->last_query)
-		free(conn->last_query);
-	conn->last_query = strdup(query);
+	/* if insufficient memory, query just winds up NULL */
+	entry->query = strdup(query);
 
 	/*
 	 * Give the data a push.  In nonblock mode, don't complain if we're unable
 	 * to send it all; PQgetResult() will do any additional flushing needed.
 	 */
 	if (pqFlush(conn) < 0)
-	{
-		/* error message should be set up already */
-		return 0;
-	}
+		goto sendFailed;
 
 	/* OK, it's launched! */
-	conn->asyncStatus = PGASYNC_BUSY;
+	pqAppendCmdQueueEntry(conn, entry);
 	return 1;
+
+sendFailed:
+	pqRecycleCmdQueueEntry(conn, entry);
+	/* error message should be set up already */
+	return 0;
 }
 
 /*
@@ -1301,10 +1323,11 @@ PQsendQueryParams(PGconn *conn,
 						  libpq_gettext("command string is a null pointer\n"));
 		return 0;
 	}
-	if (nParams < 0 || nParams > 65535)
+	if (nParams < 0 || nParams > PQ_QUERY_PARAM_MAX_LIMIT)
 	{
 		printfPQExpBuffer(&conn->errorMessage,
-						  libpq_gettext("number of parameters must be between 0 and 65535\n"));
+						  libpq_gettext("number of parameters must be between 0 and %d\n"),
+						  PQ_QUERY_PARAM_MAX_LIMIT);
 		return 0;
 	}
 
@@ -1331,6 +1354,8 @@ PQsendPrepare(PGconn *conn,
 			  const char *stmtName, const char *query,
 			  int nParams, const Oid *paramTypes)
 {
+	PGcmdQueueEntry *entry = NULL;
+
 	if (!PQsendQueryStart(conn))
 		return 0;
 
@@ -1347,10 +1372,11 @@ PQsendPrepare(PGconn *conn,
 						  libpq_gettext("command string is a null pointer\n"));
 		return 0;
 	}
-	if (nParams < 0 || nParams > 65535)
+	if (nParams < 0 || nParams > PQ_QUERY_PARAM_MAX_LIMIT)
 	{
 		printfPQExpBuffer(&conn->errorMessage,
-						  libpq_gettext("number of parameters must be between 0 and 65535\n"));
+						  libpq_gettext("number of parameters must be between 0 and %d\n"),
+						  PQ_QUERY_PARAM_MAX_LIMIT);
 		return 0;
 	}
 
@@ -1362,6 +1388,10 @@ PQsendPrepare(PGconn *conn,
 		return 0;
 	}
 
+	entry = pqAllocCmdQueueEntry(conn);
+	if (entry == NULL)
+		return 0;				/* error message already set */
+
 	/* construct the Parse message */
 	if (pqPutMsgStart('P', false, conn) < 0 ||
 		pqPuts(stmtName, conn) < 0 ||
@@ -1388,32 +1418,34 @@ PQsendPrepare(PGconn *conn,
 	if (pqPutMsgEnd(conn) < 0)
 		goto sendFailed;
 
-	/* construct the Sync message */
-	if (pqPutMsgStart('S', false, conn) < 0 ||
-		pqPutMsgEnd(conn) < 0)
-		goto sendFailed;
+	/* construct the Sync message, unless the application does that */
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
+	{
+		if (pqPutMsgStart('S', false, conn) < 0 ||
+			pqPutMsgEnd(conn) < 0)
+			goto sendFailed;
+	}
 
 	/* remember we are doing just a Parse */
-	conn->queryclass = PGQUERY_PREPARE;
+	entry->queryclass = PGQUERY_PREPARE;
 
 	/* and remember the query text too, if possible */
-	/* if insufficient memory, last_query just winds up NULL */
-	if (conn->last_query)
-		free(conn->last_query);
-	conn->last_query = strdup(query);
+	/* if insufficient memory, query just winds up NULL */
+	entry->query = strdup(query);
 
 	/*
 	 * Give the data a push.  In nonblock mode, don't complain if we're unable
 	 * to send it all; PQgetResult() will do any additional flushing needed.
 	 */
-	if (pqFlush(conn) < 0)
+	if (pqPipelineFlush(conn) < 0)
 		goto sendFailed;
 
 	/* OK, it's launched! */
-	conn->asyncStatus = PGASYNC_BUSY;
+	pqAppendCmdQueueEntry(conn, entry);
 	return 1;
 
 sendFailed:
+	pqRecycleCmdQueueEntry(conn, entry);
 	/* error message should be set up already */
 	return 0;
 }
@@ -1442,10 +1474,11 @@ PQsendQueryPrepared(PGconn *conn,
 						  libpq_gettext("statement name is a null pointer\n"));
 		return 0;
 	}
-	if (nParams < 0 || nParams > 65535)
+	if (nParams < 0 || nParams > PQ_QUERY_PARAM_MAX_LIMIT)
 	{
 		printfPQExpBuffer(&conn->errorMessage,
-						  libpq_gettext("number of parameters must be between 0 and 65535\n"));
+						  libpq_gettext("number of parameters must be between 0 and %d\n"),
+						  PQ_QUERY_PARAM_MAX_LIMIT);
 		return 0;
 	}
 
@@ -1479,19 +1512,44 @@ PQsendQueryStart(PGconn *conn)
 						  libpq_gettext("no connection to the server\n"));
 		return false;
 	}
-	/* Can't send while already busy, either. */
-	if (conn->asyncStatus != PGASYNC_IDLE)
+
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
 	{
-		printfPQExpBuffer(&conn->errorMessage,
-						  libpq_gettext("another command is already in progress\n"));
-		return false;
-	}
+		/* Can't send while already busy, either. */
+		if (conn->asyncStatus != PGASYNC_IDLE)
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("another command is already in progress\n"));
+			return false;
+		}
 
-	/* initialize async result-accumulation state */
-	pqClearAsyncResult(conn);
+		/* Outside pipeline mode, nothing can be pending once we're idle */
+		while (conn->cmd_queue_head != NULL)
+			pqCommandQueueAdvance(conn);
 
-	/* reset single-row processing mode */
-	conn->singleRowMode = false;
+		/* initialize async result-accumulation state */
+		pqClearAsyncResult(conn);
+
+		/* reset single-row processing mode */
+		conn->singleRowMode = false;
+	}
+	else
+	{
+		/*
+		 * In pipeline mode the command is just queued behind the earlier
+		 * ones, and result-accumulation state is set up when its results
+		 * are due (see pqPipelineProcessQueue).  But the server won't read
+		 * anything but COPY data during COPY.
+		 */
+		if (conn->asyncStatus == PGASYNC_COPY_IN ||
+			conn->asyncStatus == PGASYNC_COPY_OUT ||
+			conn->asyncStatus == PGASYNC_COPY_BOTH)
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("cannot queue commands during COPY\n"));
+			return false;
+		}
+	}
 
 	/* ready to send command message */
 	return true;
@@ -1516,6 +1574,7 @@ PQsendQueryGuts(PGconn *conn,
 				int resultFormat)
 {
 	int			i;
+	PGcmdQueueEntry *entry;
 
 	/* This isn't gonna work on a 2.0 server */
 	if (PG_PROTOCOL_MAJOR(conn->pversion) < 3)
@@ -1525,9 +1584,14 @@ PQsendQueryGuts(PGconn *conn,
 		return 0;
 	}
 
+	entry = pqAllocCmdQueueEntry(conn);
+	if (entry == NULL)
+		return 0;				/* error message already set */
+
 	/*
-	 * We will send Parse (if needed), Bind, Describe Portal, Execute, Sync,
-	 * using specified statement name and the unnamed portal.
+	 * We will send Parse (if needed), Bind, Describe Portal, Execute, Sync
+	 * (unless in pipeline mode), using specified statement name and the
+	 * unnamed portal.
 	 */
 
 	if (command)
@@ -1637,39 +1701,167 @@ PQsendQueryGuts(PGconn *conn,
 		pqPutMsgEnd(conn) < 0)
 		goto sendFailed;
 
-	/* construct the Sync message */
-	if (pqPutMsgStart('S', false, conn) < 0 ||
-		pqPutMsgEnd(conn) < 0)
-		goto sendFailed;
+	/* construct the Sync message, unless the application does that */
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
+	{
+		if (pqPutMsgStart('S', false, conn) < 0 ||
+			pqPutMsgEnd(conn) < 0)
+			goto sendFailed;
+	}
 
 	/* remember we are using extended query protocol */
-	conn->queryclass = PGQUERY_EXTENDED;
+	entry->queryclass = PGQUERY_EXTENDED;
 
 	/* and remember the query text too, if possible */
-	/* if insufficient memory, last_query just winds up NULL */
-	if (conn->last_query)
-		free(conn->last_query);
+	/* if insufficient memory, query just winds up NULL */
 	if (command)
-		conn->last_query = strdup(command);
-	else
-		conn->last_query = NULL;
+		entry->query = strdup(command);
 
 	/*
 	 * Give the data a push.  In nonblock mode, don't complain if we're unable
 	 * to send it all; PQgetResult() will do any additional flushing needed.
 	 */
-	if (pqFlush(conn) < 0)
+	if (pqPipelineFlush(conn) < 0)
 		goto sendFailed;
 
 	/* OK, it's launched! */
-	conn->asyncStatus = PGASYNC_BUSY;
+	pqAppendCmdQueueEntry(conn, entry);
 	return 1;
 
 sendFailed:
+	pqRecycleCmdQueueEntry(conn, entry);
 	/* error message should be set up already */
 	return 0;
 }
 
+/*
+ * pqAllocCmdQueueEntry
+ *		Get a command queue entry for a command about to be sent
+ *
+ * The entry is not linked into the queue until the command has been sent
+ * successfully, see pqAppendCmdQueueEntry.  Returns NULL on out of memory,
+ * with conn->errorMessage set.
+ */
+static PGcmdQueueEntry *
+pqAllocCmdQueueEntry(PGconn *conn)
+{
+	PGcmdQueueEntry *entry;
+
+	if (conn->cmd_queue_recycle == NULL)
+	{
+		entry = (PGcmdQueueEntry *) malloc(sizeof(PGcmdQueueEntry));
+		if (entry == NULL)
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("out of memory\n"));
+			return NULL;
+		}
+	}
+	else
+	{
+		entry = conn->cmd_queue_recycle;
+		conn->cmd_queue_recycle = entry->next;
+	}
+	entry->next = NULL;
+	entry->query = NULL;
+
+	return entry;
+}
+
+/*
+ * pqAppendCmdQueueEntry
+ *		Add a command that has just been sent to the end of the queue
+ */
+static void
+pqAppendCmdQueueEntry(PGconn *conn, PGcmdQueueEntry *entry)
+{
+	Assert(entry->next == NULL);
+
+	if (conn->cmd_queue_head == NULL)
+		conn->cmd_queue_head = entry;
+	else
+		conn->cmd_queue_tail->next = entry;
+	conn->cmd_queue_tail = entry;
+
+	/*
+	 * If nothing else is pending, start collecting this command's results.
+	 * Otherwise PQgetResult will get to it once it has returned the results
+	 * of the commands ahead of it.
+	 */
+	if (conn->asyncStatus == PGASYNC_IDLE && conn->cmd_queue_head == entry)
+	{
+		if (conn->pipelineStatus == PQ_PIPELINE_OFF)
+			conn->asyncStatus = PGASYNC_BUSY;
+		else
+			pqPipelineProcessQueue(conn);
+	}
+}
+
+/*
+ * pqRecycleCmdQueueEntry
+ *		Put an unlinked command queue entry on the recycle list
+ */
+static void
+pqRecycleCmdQueueEntry(PGconn *conn, PGcmdQueueEntry *entry)
+{
+	if (entry == NULL)
+		return;
+
+	/* recyclable entries should not have a follow-on command */
+	Assert(entry->next == NULL);
+
+	if (entry->query)
+	{
+		free(entry->query);
+		entry->query = NULL;
+	}
+
+	entry->next = conn->cmd_queue_recycle;
+	conn->cmd_queue_recycle = entry;
+}
+
+/*
+ * pqCommandQueueAdvance
+ *		Remove the command at the head of the queue, whose results have all
+ *		been received
+ */
+void
+pqCommandQueueAdvance(PGconn *conn)
+{
+	PGcmdQueueEntry *prevquery;
+
+	if (conn->cmd_queue_head == NULL)
+		return;
+
+	/* delink from queue */
+	prevquery = conn->cmd_queue_head;
+	conn->cmd_queue_head = prevquery->next;
+	if (conn->cmd_queue_head == NULL)
+		conn->cmd_queue_tail = NULL;
+
+	/* and make it recyclable */
+	prevquery->next = NULL;
+	pqRecycleCmdQueueEntry(conn, prevquery);
+}
+
+/*
+ * pqFreeCommandQueue
+ *		Free a list of command queue entries
+ */
+void
+pqFreeCommandQueue(PGcmdQueueEntry *queue)
+{
+	while (queue != NULL)
+	{
+		PGcmdQueueEntry *cur = queue;
+
+		queue = cur->next;
+		if (cur->query)
+			free(cur->query);
+		free(cur);
+	}
+}
+
 /*
  * Select row-by-row processing mode
  */
@@ -1684,8 +1876,9 @@ PQsetSingleRowMode(PGconn *conn)
 		return 0;
 	if (conn->asyncStatus != PGASYNC_BUSY)
 		return 0;
-	if (conn->queryclass != PGQUERY_SIMPLE &&
-		conn->queryclass != PGQUERY_EXTENDED)
+	if (conn->cmd_queue_head == NULL ||
+		(conn->cmd_queue_head->queryclass != PGQUERY_SIMPLE &&
+		 conn->cmd_queue_head->queryclass != PGQUERY_EXTENDED))
 		return 0;
 	if (conn->result)
 		return 0;
@@ -1766,6 +1959,65 @@ PQisBusy(PGconn *conn)
 	return conn->asyncStatus == PGASYNC_BUSY || conn->write_failed;
 }
 
+/*
+ * pqPipelineProcessQueue
+ *	 In pipeline mode, once all results of one command have been returned,
+ *	 get ready to return those of the next command in the queue.
+ */
+static void
+pqPipelineProcessQueue(PGconn *conn)
+{
+	Assert(conn->pipelineStatus != PQ_PIPELINE_OFF);
+
+	/* Nothing to do unless idle with more commands queued */
+	if (conn->asyncStatus != PGASYNC_IDLE || conn->cmd_queue_head == NULL)
+		return;
+
+	/* initialize async result-accumulation state */
+	pqClearAsyncResult(conn);
+
+	/* single-row mode has to be requested for each command */
+	conn->singleRowMode = false;
+
+	if (conn->pipelineStatus == PQ_PIPELINE_ABORTED &&
+		conn->cmd_queue_head->queryclass != PGQUERY_SYNC)
+	{
+		/*
+		 * After an error the server skips everything up to the next Sync, so
+		 * there's nothing to wait for.  Just tell the application that the
+		 * command was not executed.
+		 */
+		conn->result = PQmakeEmptyPGresult(conn, PGRES_PIPELINE_ABORTED);
+		if (!conn->result)
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("out of memory\n"));
+			pqSaveErrorResult(conn);
+		}
+		conn->asyncStatus = PGASYNC_READY;
+	}
+	else
+	{
+		/* allow parsing to proceed */
+		conn->asyncStatus = PGASYNC_BUSY;
+	}
+}
+
+/*
+ * pqPipelineFlush
+ *	 Push out a newly sent command, except in pipeline mode, where we let
+ *	 commands accumulate in the output buffer until the application sends a
+ *	 sync point or calls PQflush.  (pqPutMsgEnd sends out full blocks
+ *	 regardless.)
+ */
+static int
+pqPipelineFlush(PGconn *conn)
+{
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
+		return pqFlush(conn);
+	return 0;
+}
+
 
 /*
  * PQgetResult
@@ -1843,9 +2095,49 @@ PQgetResult(PGconn *conn)
 	{
 		case PGASYNC_IDLE:
 			res = NULL;			/* query is complete */
+
+			/*
+			 * In pipeline mode, that was the end of one command's results;
+			 * next time, start returning those of the next command.
+			 */
+			if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+				pqPipelineProcessQueue(conn);
 			break;
 		case PGASYNC_READY:
 			res = pqPrepareAsyncResult(conn);
+
+			/*
+			 * This is the last result of an extended-protocol command, so
+			 * it's done.  A simple Query may produce more results, so it's
+			 * removed from the queue at ReadyForQuery instead.  A Sync is
+			 * done only when the server has responded to it; an error raised
+			 * while processing it (say, at commit) comes first.
+			 */
+			if (conn->cmd_queue_head &&
+				conn->cmd_queue_head->queryclass != PGQUERY_SIMPLE &&
+				(conn->cmd_queue_head->queryclass != PGQUERY_SYNC ||
+				 (res && res->resultStatus == PGRES_PIPELINE_SYNC)))
+				pqCommandQueueAdvance(conn);
+
+			if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+			{
+				/*
+				 * Return NULL next time to mark the end of this command's
+				 * results; but a sync point is not followed by NULL, so go
+				 * straight on to the next command after one.
+				 */
+				conn->asyncStatus = PGASYNC_IDLE;
+				if (res && res->resultStatus == PGRES_PIPELINE_SYNC)
+					pqPipelineProcessQueue(conn);
+			}
+			else
+			{
+				/* Set the state back to BUSY, allowing parsing to proceed. */
+				conn->asyncStatus = PGASYNC_BUSY;
+			}
+			break;
+		case PGASYNC_READY_MORE:
+			res = pqPrepareAsyncResult(conn);
 			/* Set the state back to BUSY, allowing parsing to proceed. */
 			conn->asyncStatus = PGASYNC_BUSY;
 			break;
@@ -2025,6 +2317,14 @@ PQexecStart(PGconn *conn)
 	if (!conn)
 		return false;
 
+	/* PQgetResult can't be used to skip over results in a pipeline */
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("synchronous command execution functions are not allowed in pipeline mode\n"));
+		return false;
+	}
+
 	/*
 	 * Silently discard any prior query result that application didn't eat.
 	 * This is probably poor design, but it's here for backward compatibility.
@@ -2219,6 +2519,8 @@ PQsendDescribePortal(PGconn *conn, const char *portal)
 static int
 PQsendDescribe(PGconn *conn, char desc_type, const char *desc_target)
 {
+	PGcmdQueueEntry *entry = NULL;
+
 	/* Treat null desc_target as empty string */
 	if (!desc_target)
 		desc_target = "";
@@ -2234,6 +2536,10 @@ PQsendDescribe(PGconn *conn, char desc_type, const char *desc_target)
 		return 0;
 	}
 
+	entry = pqAllocCmdQueueEntry(conn);
+	if (entry == NULL)
+		return 0;				/* error message already set */
+
 	/* construct the Describe message */
 	if (pqPutMsgStart('D', false, conn) < 0 ||
 		pqPutc(desc_type, conn) < 0 ||
@@ -2241,21 +2547,163 @@ PQsendDescribe(PGconn *conn, char desc_type, const char *desc_target)
 		pqPutMsgEnd(conn) < 0)
 		goto sendFailed;
 
-	/* construct the Sync message */
-	if (pqPutMsgStart('S', false, conn) < 0 ||
-		pqPutMsgEnd(conn) < 0)
+	/* construct the Sync message, unless the application does that */
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
+	{
+		if (pqPutMsgStart('S', false, conn) < 0 ||
+			pqPutMsgEnd(conn) < 0)
+			goto sendFailed;
+	}
+
+	/* remember we are doing a Describe (there's no query text) */
+	entry->queryclass = PGQUERY_DESCRIBE;
+
+	/*
+	 * Give the data a push.  In nonblock mode, don't complain if we're unable
+	 * to send it all; PQgetResult() will do any additional flushing needed.
+	 */
+	if (pqPipelineFlush(conn) < 0)
 		goto sendFailed;
 
-	/* remember we are doing a Describe */
-	conn->queryclass = PGQUERY_DESCRIBE;
+	/* OK, it's launched! */
+	pqAppendCmdQueueEntry(conn, entry);
+	return 1;
+
+sendFailed:
+	pqRecycleCmdQueueEntry(conn, entry);
+	/* error message should be set up already */
+	return 0;
+}
+
+/*
+ * PQenterPipelineMode
+ *	 Put the connection in pipeline mode.
+ *
+ * In pipeline mode, commands sent with the PQsendQueryParams family are
+ * not followed by a Sync, and may be sent without waiting for the results
+ * of earlier ones.  The application marks sync points with PQpipelineSync,
+ * and collects results with PQgetResult in the order the commands were sent:
+ * each command's results are followed by a NULL, and each sync point yields
+ * a PGRES_PIPELINE_SYNC result.  After an error, the server skips the rest
+ * of the commands up to the next sync point, and each of them yields a
+ * PGRES_PIPELINE_ABORTED result.
+ *
+ * Returns 1 on success (including if already in pipeline mode), 0 if the
+ * connection is busy or can't use pipelining.
+ */
+int
+PQenterPipelineMode(PGconn *conn)
+{
+	if (!conn)
+		return 0;
+
+	/* succeed with no action if already in pipeline mode */
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+		return 1;
 
-	/* reset last_query string (not relevant now) */
-	if (conn->last_query)
+	if (conn->asyncStatus != PGASYNC_IDLE)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("cannot enter pipeline mode, connection not idle\n"));
+		return 0;
+	}
+
+	/* The Sync message doesn't exist in protocol 2.0 */
+	if (PG_PROTOCOL_MAJOR(conn->pversion) < 3)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("function requires at least protocol version 3.0\n"));
+		return 0;
+	}
+
+	conn->pipelineStatus = PQ_PIPELINE_ON;
+
+	return 1;
+}
+
+/*
+ * PQexitPipelineMode
+ *	 End pipeline mode and return to normal command mode.
+ *
+ * Returns 1 on success (including if not in pipeline mode), 0 if there are
+ * commands whose results have not been collected yet.
+ */
+int
+PQexitPipelineMode(PGconn *conn)
+{
+	if (!conn)
+		return 0;
+
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
+		return 1;
+
+	if (conn->asyncStatus == PGASYNC_BUSY)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("cannot exit pipeline mode while busy\n"));
+		return 0;
+	}
+	if (conn->asyncStatus != PGASYNC_IDLE || conn->cmd_queue_head != NULL)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("cannot exit pipeline mode with uncollected results\n"));
+		return 0;
+	}
+
+	conn->pipelineStatus = PQ_PIPELINE_OFF;
+
+	/* Flush any pending data in out buffer */
+	if (pqFlush(conn) < 0)
+		return 0;				/* error message is setup already */
+
+	return 1;
+}
+
+/*
+ * PQpipelineSync
+ *	 Send a Sync message, marking the end of a group of commands in pipeline
+ *	 mode, and flush the output buffer.
+ *
+ * The server commits the implicit transaction, if any, at the sync point,
+ * and resumes processing commands there after an error.
+ *
+ * Returns 1 on success, 0 on failure.
+ */
+int
+PQpipelineSync(PGconn *conn)
+{
+	PGcmdQueueEntry *entry;
+
+	if (!conn)
+		return 0;
+
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("cannot send pipeline when not in pipeline mode\n"));
+		return 0;
+	}
+
+	if (conn->asyncStatus == PGASYNC_COPY_IN ||
+		conn->asyncStatus == PGASYNC_COPY_OUT ||
+		conn->asyncStatus == PGASYNC_COPY_BOTH)
 	{
-		free(conn->last_query);
-		conn->last_query = NULL;
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("cannot queue commands during COPY\n"));
+		return 0;
 	}
 
+	entry = pqAllocCmdQueueEntry(conn);
+	if (entry == NULL)
+		return 0;				/* error message already set */
+
+	entry->queryclass = PGQUERY_SYNC;
+
+	/* construct the Sync message */
+	if (pqPutMsgStart('S', false, conn) < 0 ||
+		pqPutMsgEnd(conn) < 0)
+		goto sendFailed;
+
 	/*
 	 * Give the data a push.  In nonblock mode, don't complain if we're unable
 	 * to send it all; PQgetResult() will do any additional flushing needed.
@@ -2264,10 +2712,12 @@ PQsendDescribe(PGconn *conn, char desc_type, const char *desc_target)
 		goto sendFailed;
 
 	/* OK, it's launched! */
-	conn->asyncStatus = PGASYNC_BUSY;
+	pqAppendCmdQueueEntry(conn, entry);
+
 	return 1;
 
 sendFailed:
+	pqRecycleCmdQueueEntry(conn, entry);
 	/* error message should be set up already */
 	return 0;
 }
@@ -2419,7 +2869,8 @@ PQputCopyEnd(PGconn *conn, const char *errormsg)
 		 * If we sent the COPY command in extended-query mode, we must issue a
 		 * Sync as well.
 		 */
-		if (conn->queryclass != PGQUERY_SIMPLE)
+		if (conn->cmd_queue_head &&
+			conn->cmd_queue_head->queryclass != PGQUERY_SIMPLE)
 		{
 			if (pqPutMsgStart('S', false, conn) < 0 ||
 				pqPutMsgEnd(conn) < 0)
@@ -2665,6 +3116,14 @@ PQfn(PGconn *conn,
 	/* clear the error string */
 	resetPQExpBuffer(&conn->errorMessage);
 
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("%s not allowed in pipeline mode\n"),
+						  "PQfn");
+		return NULL;
+	}
+
 	if (conn->sock == PGINVALID_SOCKET || conn->asyncStatus != PGASYNC_IDLE ||
 		conn->result != NULL)
 	{
@@ -55,6 +55,8 @@
 
 static int	pqPutMsgBytes(const void *buf, size_t len, PGconn *conn);
 static int	pqSendSome(PGconn *conn, int len);
+static int	pqEndCompressedBlock(PGconn *conn);
+static int	pqDecompressInput(PGconn *conn);
 static int	pqSocketCheck(PGconn *conn, int forRead, int forWrite,
 						  time_t end_time);
 static int	pqSocketPoll(int sock, int forRead, int forWrite, time_t end_time);
@@ -417,13 +419,14 @@ pqCheckInBufferSpace(size_t bytes_needed, PGconn *conn)
 					conn->inEnd - conn->inStart);
 			conn->inEnd -= conn->inStart;
 			conn->inCursor -= conn->inStart;
+			conn->inScanned -= conn->inStart;
 			conn->inStart = 0;
 		}
 	}
 	else
 	{
 		/* buffer is logically empty, reset it */
-		conn->inStart = conn->inCursor = conn->inEnd = 0;
+		conn->inStart = conn->inCursor = conn->inEnd = conn->inScanned = 0;
 	}
 
 	/* Recheck whether we have enough space */
@@ -507,6 +510,11 @@ pqPutMsgStart(char msg_type, bool force_len, PGconn *conn)
 	int			lenPos;
 	int			endPos;
 
+	/* compressed messages must go out before anything that isn't */
+	if (conn->compressor && !PQ_MSG_IS_COMPRESSIBLE(msg_type) &&
+		pqEndCompressedBlock(conn))
+		return EOF;
+
 	/* allow room for message type byte */
 	if (msg_type)
 		endPos = conn->outCount + 1;
@@ -585,6 +593,31 @@ pqPutMsgEnd(PGconn *conn)
 		memcpy(conn->outBuffer + conn->outMsgStart, &msgLen, 4);
 	}
 
+	/*
+	 * With compression, a CopyData message goes into the compressor instead,
+	 * to come out in a CompressedData message when the block is ended.
+	 */
+	if (conn->compressor && conn->outMsgStart == conn->outCount + 1 &&
+		PQ_MSG_IS_COMPRESSIBLE(conn->outBuffer[conn->outCount]))
+	{
+		size_t		len = conn->outMsgEnd - conn->outCount;
+		const char *errmsg;
+
+		if (!pq_compress(conn->compressor, conn->outBuffer + conn->outCount,
+						 len, &conn->compressBuffer, &errmsg))
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("could not compress data: %s\n"),
+							  errmsg);
+			return EOF;
+		}
+		conn->outMsgEnd = conn->outCount;
+		conn->compressPending += len;
+		if (conn->compressPending >= PQ_COMPRESSION_BLOCK_SIZE &&
+			pqEndCompressedBlock(conn))
+			return EOF;
+	}
+
 	/* Make message eligible to send */
 	conn->outCount = conn->outMsgEnd;
 
@@ -600,6 +633,166 @@ pqPutMsgEnd(PGconn *conn)
 	return 0;
 }
 
+/*
+ * pqEndCompressedBlock: move compressed messages to the output buffer
+ *
+ * Flushes the compression stream and appends its output to outBuffer as a
+ * CompressedData message.  Must not be called while a message is being
+ * constructed.
+ *
+ * Returns 0 on success, EOF on error
+ */
+static int
+pqEndCompressedBlock(PGconn *conn)
+{
+	PqCompressionBuffer *buf = &conn->compressBuffer;
+	const char *errmsg;
+	uint32		msgLen;
+
+	if (conn->compressPending == 0)
+		return 0;
+	conn->compressPending = 0;
+
+	if (!pq_compress_flush(conn->compressor, buf, &errmsg))
+	{
+		buf->len = 0;
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("could not compress data: %s\n"),
+						  errmsg);
+		return EOF;
+	}
+
+	if (pqCheckOutBufferSpace(conn->outCount + 1 + 4 + buf->len, conn))
+	{
+		buf->len = 0;
+		return EOF;
+	}
+	conn->outBuffer[conn->outCount] = PQ_MSG_COMPRESSED_DATA;
+	msgLen = pg_hton32((uint32) (buf->len + 4));
+	memcpy(conn->outBuffer + conn->outCount + 1, &msgLen, 4);
+	memcpy(conn->outBuffer + conn->outCount + 5, buf->data, buf->len);
+	conn->outCount += 1 + 4 + buf->len;
+
+	if (conn->Pfdebug)
+		fprintf(conn->Pfdebug, "To backend> Msg %c, length %u\n",
+				PQ_MSG_COMPRESSED_DATA, (unsigned int) (buf->len + 4));
+
+	buf->len = 0;
+	return 0;
+}
+
+/*
+ * pqDecompressInput: replace CompressedData messages in the input buffer
+ * by the messages they contain
+ *
+ * Checks the complete messages received since the last call, starting at
+ * inScanned.  The message parsers therefore never see a CompressedData
+ * message, except possibly an incomplete one at the end of the buffer, and
+ * they wait for the rest of that like for any other message.
+ *
+ * Returns 0 on success, EOF on error
+ */
+static int
+pqDecompressInput(PGconn *conn)
+{
+	while (conn->inEnd - conn->inScanned >= 5)
+	{
+		PqCompressionBuffer *buf = &conn->decompressBuffer;
+		int			msgLength;
+		int			msgEnd;
+		int			delta;
+		const char *errmsg;
+
+		memcpy(&msgLength, conn->inBuffer + conn->inScanned + 1, 4);
+		msgLength = pg_ntoh32(msgLength);
+		if (msgLength < 4)
+			break;				/* the parser will report loss of sync */
+		if (conn->inEnd - conn->inScanned - 1 < msgLength)
+			break;				/* incomplete */
+		msgEnd = conn->inScanned + 1 + msgLength;
+
+		if (conn->inBuffer[conn->inScanned] != PQ_MSG_COMPRESSED_DATA)
+		{
+			conn->inScanned = msgEnd;
+			continue;
+		}
+
+		buf->len = 0;
+		if (!pq_decompress(conn->decompressor,
+						   conn->inBuffer + conn->inScanned + 5,
+						   msgLength - 4, buf, &errmsg))
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("could not decompress data from server: %s\n"),
+							  errmsg);
+			return EOF;
+		}
+
+		/*
+		 * Replace the CompressedData message by its contents.  Making room
+		 * may left-justify the buffer, so recompute the message end after.
+		 */
+		delta = (int) buf->len - (1 + msgLength);
+		if (delta > 0 &&
+			pqCheckInBufferSpace(conn->inEnd + (size_t) delta, conn))
+			return EOF;
+		msgEnd = conn->inScanned + 1 + msgLength;
+		memmove(conn->inBuffer + conn->inScanned + buf->len,
+				conn->inBuffer + msgEnd, conn->inEnd - msgEnd);
+		memcpy(conn->inBuffer + conn->inScanned, buf->data, buf->len);
+		conn->inEnd += delta;
+		conn->inScanned += buf->len;
+	}
+
+	return 0;
+}
+
+/*
+ * pqEnableCompression: start using the compression method the server chose
+ *
+ * Called on receipt of the server's ParameterStatus message for
+ * _pq_.compression, with conn->inCursor just past it.  If we can't set up
+ * decompression, which can only be for lack of memory, the connection will
+ * fail with a loss of sync on the first CompressedData message.
+ */
+void
+pqEnableCompression(PGconn *conn, const char *method_name)
+{
+	PqCompressionMethod method;
+
+	if (conn->compressor != NULL ||
+		!pq_compression_parse_method(method_name, &method) ||
+		!pq_compression_method_supported(method))
+		return;
+
+	conn->compressor = pq_compressor_create(method);
+	conn->decompressor = pq_decompressor_create(method);
+	if (conn->compressor == NULL || conn->decompressor == NULL)
+	{
+		pqFreeCompression(conn);
+		return;
+	}
+
+	/* Whatever follows the ParameterStatus message may be compressed */
+	conn->inScanned = conn->inCursor;
+	(void) pqDecompressInput(conn);
+}
+
+/*
+ * pqFreeCompression: release protocol compression state
+ */
+void
+pqFreeCompression(PGconn *conn)
+{
+	pq_compressor_free(conn->compressor);
+	conn->compressor = NULL;
+	pq_decompressor_free(conn->decompressor);
+	conn->decompressor = NULL;
+	pq_compression_buffer_free(&conn->compressBuffer);
+	pq_compression_buffer_free(&conn->decompressBuffer);
+	conn->compressPending = 0;
+}
+
 /* ----------
  * pqReadData: read more data, if any is available
  * Possible return values:
@@ -633,13 +826,14 @@ pqReadData(PGconn *conn)
 					conn->inEnd - conn->inStart);
 			conn->inEnd -= conn->inStart;
 			conn->inCursor -= conn->inStart;
+			conn->inScanned -= conn->inStart;
 			conn->inStart = 0;
 		}
 	}
 	else
 	{
 		/* buffer is logically empty, reset it */
-		conn->inStart = conn->inCursor = conn->inEnd = 0;
+		conn->inStart = conn->inCursor = conn->inEnd = conn->inScanned = 0;
 	}
 
 	/*
@@ -695,6 +889,8 @@ retry3:
 	if (nread > 0)
 	{
 		conn->inEnd += nread;
+		if (conn->decompressor && pqDecompressInput(conn))
+			goto definitelyFailed;
 
 		/*
 		 * Hack to deal with the fact that some kernels will only give us back
@@ -790,6 +986,8 @@ retry4:
 	if (nread > 0)
 	{
 		conn->inEnd += nread;
+		if (conn->decompressor && pqDecompressInput(conn))
+			goto definitelyFailed;
 		return 1;
 	}
 
@@ -1014,6 +1212,9 @@ pqFlush(PGconn *conn)
 	if (conn->Pfdebug)
 		fflush(conn->Pfdebug);
 
+	if (conn->compressor && pqEndCompressedBlock(conn))
+		return -1;
+
 	if (conn->outCount > 0)
 		return pqSendSome(conn, conn->outCount);
 
@@ -37,10 +37,12 @@
  */
 #define VALID_LONG_MESSAGE_TYPE(id) \
 	((id) == 'T' || (id) == 'D' || (id) == 'd' || (id) == 'V' || \
-	 (id) == 'E' || (id) == 'N' || (id) == 'A')
+	 (id) == 'E' || (id) == 'N' || (id) == 'A' || \
+	 (id) == PQ_MSG_COMPRESSED_DATA)
 
 
 static void handleSyncLoss(PGconn *conn, char id, int msgLength);
+static bool pqQueryClassIs(PGconn *conn, PGQueryClass queryclass);
 static int	getRowDescriptions(PGconn *conn, int msgLength);
 static int	getParamDescriptions(PGconn *conn, int msgLength);
 static int	getAnotherTuple(PGconn *conn, int msgLength);
@@ -158,6 +160,15 @@ pqParseInput3(PGconn *conn)
 			if (conn->asyncStatus != PGASYNC_IDLE)
 				return;
 
+			/*
+			 * ... and likewise in pipeline mode if there are more commands
+			 * queued: we're only idle until PQgetResult moves on to the next
+			 * one.
+			 */
+			if (conn->pipelineStatus != PQ_PIPELINE_OFF &&
+				conn->cmd_queue_head != NULL)
+				return;
+
 			/*
 			 * Unexpected message in IDLE state; need to recover somehow.
 			 * ERROR messages are handled using the notice processor;
@@ -215,12 +226,39 @@ pqParseInput3(PGconn *conn)
 				case 'E':		/* error return */
 					if (pqGetErrorNotice3(conn, true))
 						return;
+					/* the server skips the rest of the pipeline */
+					if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+						conn->pipelineStatus = PQ_PIPELINE_ABORTED;
 					conn->asyncStatus = PGASYNC_READY;
 					break;
 				case 'Z':		/* backend is ready for new query */
 					if (getReadyForQuery(conn))
 						return;
-					conn->asyncStatus = PGASYNC_IDLE;
+					if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+					{
+						/* report the sync point to the application */
+						conn->result = PQmakeEmptyPGresult(conn,
+														   PGRES_PIPELINE_SYNC);
+						if (!conn->result)
+						{
+							printfPQExpBuffer(&conn->errorMessage,
+											  libpq_gettext("out of memory"));
+							pqSaveErrorResult(conn);
+						}
+						conn->pipelineStatus = PQ_PIPELINE_ON;
+						conn->asyncStatus = PGASYNC_READY;
+					}
+					else
+					{
+						/*
+						 * A simple Query is complete only now (see
+						 * PQgetResult).
+						 */
+						if (conn->cmd_queue_head &&
+							conn->cmd_queue_head->queryclass == PGQUERY_SIMPLE)
+							pqCommandQueueAdvance(conn);
+						conn->asyncStatus = PGASYNC_IDLE;
+					}
 					break;
 				case 'I':		/* empty query */
 					if (conn->result == NULL)
@@ -238,7 +276,7 @@ pqParseInput3(PGconn *conn)
 					break;
 				case '1':		/* Parse Complete */
 					/* If we're doing PQprepare, we're done; else ignore */
-					if (conn->queryclass == PGQUERY_PREPARE)
+					if (pqQueryClassIs(conn, PGQUERY_PREPARE))
 					{
 						if (conn->result == NULL)
 						{
@@ -285,7 +323,7 @@ pqParseInput3(PGconn *conn)
 						conn->inCursor += msgLength;
 					}
 					else if (conn->result == NULL ||
-							 conn->queryclass == PGQUERY_DESCRIBE)
+							 pqQueryClassIs(conn, PGQUERY_DESCRIBE))
 					{
 						/* First 'T' in a query sequence */
 						if (getRowDescriptions(conn, msgLength))
@@ -318,7 +356,7 @@ pqParseInput3(PGconn *conn)
 					 * instead of PGRES_TUPLES_OK.  Otherwise we can just
 					 * ignore this message.
 					 */
-					if (conn->queryclass == PGQUERY_DESCRIBE)
+					if (pqQueryClassIs(conn, PGQUERY_DESCRIBE))
 					{
 						if (conn->result == NULL)
 						{
@@ -437,6 +475,16 @@ pqParseInput3(PGconn *conn)
 	}
 }
 
+/*
+ * pqQueryClassIs: is the command whose results we're receiving of this type?
+ */
+static bool
+pqQueryClassIs(PGconn *conn, PGQueryClass queryclass)
+{
+	return conn->cmd_queue_head != NULL &&
+		conn->cmd_queue_head->queryclass == queryclass;
+}
+
 /*
  * handleSyncLoss: clean up after loss of message-boundary sync
  *
@@ -477,7 +525,7 @@ getRowDescriptions(PGconn *conn, int msgLength)
 	 * PGresult created by getParamDescriptions, and we should fill data into
 	 * that.  Otherwise, create a new, empty PGresult.
 	 */
-	if (conn->queryclass == PGQUERY_DESCRIBE)
+	if (pqQueryClassIs(conn, PGQUERY_DESCRIBE))
 	{
 		if (conn->result)
 			result = conn->result;
@@ -584,7 +632,7 @@ getRowDescriptions(PGconn *conn, int msgLength)
 	 * If we're doing a Describe, we're done, and ready to pass the result
 	 * back to the client.
 	 */
-	if (conn->queryclass == PGQUERY_DESCRIBE)
+	if (pqQueryClassIs(conn, PGQUERY_DESCRIBE))
 	{
 		conn->asyncStatus = PGASYNC_READY;
 		return 0;
@@ -931,8 +979,9 @@ pqGetErrorNotice3(PGconn *conn, bool isError)
 	 * might need it for an error cursor display, which is only true if there
 	 * is a PG_DIAG_STATEMENT_POSITION field.
 	 */
-	if (have_position && conn->last_query && res)
-		res->errQuery = pqResultStrdup(res, conn->last_query);
+	if (have_position && res &&
+		conn->cmd_queue_head && conn->cmd_queue_head->query)
+		res->errQuery = pqResultStrdup(res, conn->cmd_queue_head->query);
 
 	/*
 	 * Now build the "overall" error message for PQresultErrorMessage.
@@ -1397,6 +1446,15 @@ getParameterStatus(PGconn *conn)
 	}
 	/* And save it */
 	pqSaveParameterStatus(conn, conn->workBuffer.data, valueBuf.data);
+
+	/*
+	 * If it's the server's answer to our request for protocol compression,
+	 * messages following this one may be compressed.
+	 */
+	if (strcmp(conn->workBuffer.data, PQ_COMPRESSION_OPTION) == 0 &&
+		conn->compression_methods != NULL)
+		pqEnableCompression(conn, valueBuf.data);
+
 	termPQExpBuffer(&valueBuf);
 	return 0;
 }
@@ -1851,7 +1909,8 @@ pqEndcopy3(PGconn *conn)
 		 * If we sent the COPY command in extended-query mode, we must issue a
 		 * Sync as well.
 		 */
-		if (conn->queryclass != PGQUERY_SIMPLE)
+		if (conn->cmd_queue_head &&
+			conn->cmd_queue_head->queryclass != PGQUERY_SIMPLE)
 		{
 			if (pqPutMsgStart('S', false, conn) < 0 ||
 				pqPutMsgEnd(conn) < 0)
@@ -2191,6 +2250,9 @@ build_startup_packet(const PGconn *conn, char *packet,
 	if (conn->client_encoding_initial && conn->client_encoding_initial[0])
 		ADD_STARTUP_OPTION("client_encoding", conn->client_encoding_initial);
 
+	if (conn->compression_methods)
+		ADD_STARTUP_OPTION(PQ_COMPRESSION_OPTION, conn->compression_methods);
+
 	/* Add any environment-driven GUC settings needed */
 	for (next_eo = options; next_eo->envName; next_eo++)
 	{
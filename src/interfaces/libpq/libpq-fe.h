@@ -36,6 +36,9 @@ extern "C"
 #define PG_COPYRES_EVENTS		  0x04
 #define PG_COPYRES_NOTICEHOOKS	  0x08
 
+/* Maximum number of parameters for a query (limited by the wire protocol) */
+#define PQ_QUERY_PARAM_MAX_LIMIT 65535
+
 /* Application-visible enum types */
 
 /*
@@ -97,7 +100,10 @@ typedef enum
 	PGRES_NONFATAL_ERROR,		/* notice or warning message */
 	PGRES_FATAL_ERROR,			/* query failed */
 	PGRES_COPY_BOTH,			/* Copy In/Out data transfer in progress */
-	PGRES_SINGLE_TUPLE			/* single tuple from larger resultset */
+	PGRES_SINGLE_TUPLE,			/* single tuple from larger resultset */
+	PGRES_PIPELINE_SYNC,		/* pipeline synchronization point */
+	PGRES_PIPELINE_ABORTED		/* Command didn't run because of an abort
+								 * earlier in a pipeline */
 } ExecStatusType;
 
 typedef enum
@@ -124,6 +130,17 @@ typedef enum
 	PQSHOW_CONTEXT_ALWAYS		/* always show CONTEXT field */
 } PGContextVisibility;
 
+/*
+ * PGpipelineStatus - Current status of pipeline mode
+ */
+typedef enum
+{
+	PQ_PIPELINE_OFF,			/* not in pipeline mode */
+	PQ_PIPELINE_ON,				/* in pipeline mode */
+	PQ_PIPELINE_ABORTED			/* in pipeline mode, waiting for the sync
+								 * point after an error */
+} PGpipelineStatus;
+
 /*
  * PGPing - The ordering of this enum should not be altered because the
  * values are exposed externally via pg_isready.
@@ -435,6 +452,12 @@ extern PGresult *PQgetResult(PGconn *conn);
 extern int	PQisBusy(PGconn *conn);
 extern int	PQconsumeInput(PGconn *conn);
 
+/* Routines for pipeline mode management */
+extern PGpipelineStatus PQpipelineStatus(const PGconn *conn);
+extern int	PQenterPipelineMode(PGconn *conn);
+extern int	PQexitPipelineMode(PGconn *conn);
+extern int	PQpipelineSync(PGconn *conn);
+
 /* LISTEN/NOTIFY support */
 extern PGnotify *PQnotifies(PGconn *conn);
 
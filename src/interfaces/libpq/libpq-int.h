@@ -39,6 +39,7 @@
 
 /* include stuff common to fe and be */
 #include "getaddrinfo.h"
+#include "common/protocol_compression.h"
 #include "libpq/pqcomm.h"
 /* include stuff found in fe only */
 #include "pqexpbuffer.h"
@@ -218,6 +219,7 @@ typedef enum
 	PGASYNC_IDLE,				/* nothing's happening, dude */
 	PGASYNC_BUSY,				/* query in progress */
 	PGASYNC_READY,				/* result ready for PQgetResult */
+	PGASYNC_READY_MORE,			/* single-row result ready, more to come */
 	PGASYNC_COPY_IN,			/* Copy In data transfer in progress */
 	PGASYNC_COPY_OUT,			/* Copy Out data transfer in progress */
 	PGASYNC_COPY_BOTH			/* Copy In/Out data transfer in progress */
@@ -229,7 +231,8 @@ typedef enum
 	PGQUERY_SIMPLE,				/* simple Query protocol (PQexec) */
 	PGQUERY_EXTENDED,			/* full Extended protocol (PQexecParams) */
 	PGQUERY_PREPARE,			/* Parse only (PQprepare) */
-	PGQUERY_DESCRIBE			/* Describe Statement or Portal */
+	PGQUERY_DESCRIBE,			/* Describe Statement or Portal */
+	PGQUERY_SYNC				/* Sync (at end of a pipeline) */
 } PGQueryClass;
 
 /* PGSetenvStatusType defines the state of the pqSetenv state machine */
@@ -264,6 +267,17 @@ typedef struct pgParameterStatus
 	/* Note: name and value are stored in same malloc block as struct is */
 } pgParameterStatus;
 
+/*
+ * An entry in the queue of commands sent to the server whose results have
+ * not been fully received yet.  Outside pipeline mode there's at most one.
+ */
+typedef struct PGcmdQueueEntry
+{
+	PGQueryClass queryclass;	/* query type */
+	char	   *query;			/* SQL command, or NULL if none/unknown/OOM */
+	struct PGcmdQueueEntry *next;	/* list link */
+} PGcmdQueueEntry;
+
 /* large-object-access data ... allocated only if large-object code is used. */
 typedef struct pgLobjfuncs
 {
@@ -373,6 +387,8 @@ struct pg_conn
 	/* Type of connection to make.  Possible values: any, read-write. */
 	char	   *target_session_attrs;
 
+	char	   *compression;	/* protocol compression (off, on, or methods) */
+
 	/* Optional file to write trace info to */
 	FILE	   *Pfdebug;
 
@@ -388,8 +404,7 @@ struct pg_conn
 	ConnStatusType status;
 	PGAsyncStatusType asyncStatus;
 	PGTransactionStatusType xactStatus; /* never changes to ACTIVE */
-	PGQueryClass queryclass;
-	char	   *last_query;		/* last SQL command, or NULL if unknown */
+	PGpipelineStatus pipelineStatus;	/* status of pipeline mode */
 	char		last_sqlstate[6];	/* last reported SQLSTATE */
 	bool		options_valid;	/* true if OK to attempt connection */
 	bool		nonblocking;	/* whether this connection is using nonblock
@@ -400,6 +415,15 @@ struct pg_conn
 	PGnotify   *notifyHead;		/* oldest unreported Notify msg */
 	PGnotify   *notifyTail;		/* newest unreported Notify msg */
 
+	/*
+	 * Queue of commands sent to the server, oldest first.  The head is the
+	 * command whose results are currently being received.  Entries are
+	 * recycled through cmd_queue_recycle to avoid malloc traffic.
+	 */
+	PGcmdQueueEntry *cmd_queue_head;
+	PGcmdQueueEntry *cmd_queue_tail;
+	PGcmdQueueEntry *cmd_queue_recycle;
+
 	/* Support for multiple hosts in connection string */
 	int			nconnhost;		/* # of hosts named in conn string */
 	int			whichhost;		/* host we're currently trying/connected to */
@@ -446,6 +470,8 @@ struct pg_conn
 	int			inStart;		/* offset to first unconsumed data in buffer */
 	int			inCursor;		/* next byte to tentatively consume */
 	int			inEnd;			/* offset to first position after avail data */
+	int			inScanned;		/* offset past data checked for compressed
+								 * messages; see pqDecompressInput */
 
 	/* Buffer for data not yet sent to backend */
 	char	   *outBuffer;		/* currently allocated buffer */
@@ -457,6 +483,19 @@ struct pg_conn
 								 * msg has no length word */
 	int			outMsgEnd;		/* offset to msg end (so far) */
 
+	/*
+	 * Protocol compression, once the server has agreed to it.  CopyData
+	 * messages go through the compressor into compressBuffer, and are moved
+	 * to outBuffer as a CompressedData message when the block is ended; see
+	 * fe-misc.c.
+	 */
+	char	   *compression_methods;	/* methods to request, or NULL */
+	PqCompressor *compressor;
+	PqDecompressor *decompressor;
+	PqCompressionBuffer compressBuffer;
+	size_t		compressPending;	/* uncompressed bytes in current block */
+	PqCompressionBuffer decompressBuffer;
+
 	/* Row processor interface workspace */
 	PGdataValue *rowBuf;		/* array for passing values to rowProcessor */
 	int			rowBufLen;		/* number of entries allocated in rowBuf */
@@ -612,6 +651,8 @@ extern void pqSaveMessageField(PGresult *res, char code,
 extern void pqSaveParameterStatus(PGconn *conn, const char *name,
 								  const char *value);
 extern int	pqRowProcessor(PGconn *conn, const char **errmsgp);
+extern void pqCommandQueueAdvance(PGconn *conn);
+extern void pqFreeCommandQueue(PGcmdQueueEntry *queue);
 
 /* === in fe-protocol2.c === */
 
@@ -669,6 +710,8 @@ extern int	pqPutMsgStart(char msg_type, bool force_len, PGconn *conn);
 extern int	pqPutMsgEnd(PGconn *conn);
 extern int	pqReadData(PGconn *conn);
 extern int	pqFlush(PGconn *conn);
+extern void pqEnableCompression(PGconn *conn, const char *method_name);
+extern void pqFreeCompression(PGconn *conn);
 extern int	pqWait(int forRead, int forWrite, PGconn *conn);
 extern int	pqWaitTimed(int forRead, int forWrite, PGconn *conn,
 						time_t finish_time);
@@ -6217,6 +6217,29 @@ exec_eval_simple_expr(PLpgSQL_execstate *estate,
 	if (expr->expr_simple_expr == NULL)
 		return false;
 
+	/*
+	 * If the expression just fetches a variable, we can return the value
+	 * directly.  There is no need to revalidate the plan in that case: the
+	 * variable's type is fixed for the life of the compiled function, so any
+	 * replan would produce the very same Param.  Like
+	 * plpgsql_param_eval_var_ro, we must pass back only a read-only pointer
+	 * to an expanded object.
+	 */
+	if (expr->expr_simple_vardno >= 0)
+	{
+		PLpgSQL_var *var;
+
+		var = (PLpgSQL_var *) estate->datums[expr->expr_simple_vardno];
+		Assert(var->dtype == PLPGSQL_DTYPE_VAR);
+		*result = MakeExpandedObjectReadOnly(var->value,
+											 var->isnull,
+											 var->datatype->typlen);
+		*isNull = var->isnull;
+		*rettype = expr->expr_simple_type;
+		*rettypmod = expr->expr_simple_typmod;
+		return true;
+	}
+
 	/*
 	 * If expression is in use in current xact, don't touch it.
 	 */
@@ -8298,6 +8321,23 @@ exec_save_simple_expr(PLpgSQL_expr *expr, CachedPlan *cplan)
 	expr->expr_simple_typmod = exprTypmod((Node *) tle_expr);
 	/* We also want to remember if it is immutable or not */
 	expr->expr_simple_mutable = contain_mutable_functions((Node *) tle_expr);
+
+	/*
+	 * Check whether the expression is nothing but a reference to a plain
+	 * variable, as in "RETURN x" or "IF found THEN".  Those are common enough
+	 * to deserve a shortcut in exec_eval_simple_expr.  Promises are excluded
+	 * since they must be fulfilled by plpgsql_param_eval_generic.
+	 */
+	expr->expr_simple_vardno = -1;
+	if (IsA(tle_expr, Param) &&
+		((Param *) tle_expr)->paramkind == PARAM_EXTERN)
+	{
+		int			dno = ((Param *) tle_expr)->paramid - 1;
+
+		Assert(dno >= 0 && dno < expr->func->ndatums);
+		if (expr->func->datums[dno]->dtype == PLPGSQL_DTYPE_VAR)
+			expr->expr_simple_vardno = dno;
+	}
 }
 
 /*
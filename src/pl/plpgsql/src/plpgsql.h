@@ -234,6 +234,8 @@ typedef struct PLpgSQL_expr
 	Oid			expr_simple_type;	/* result type Oid, if simple */
 	int32		expr_simple_typmod; /* result typmod, if simple */
 	bool		expr_simple_mutable;	/* true if simple expr is mutable */
+	int			expr_simple_vardno; /* dno of VAR if simple expr is just a
+									 * reference to it, else -1 */
 
 	/*
 	 * If the expression was ever determined to be simple, we remember its
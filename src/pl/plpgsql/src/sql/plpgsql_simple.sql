@@ -59,3 +59,19 @@ select simplecaller();
 \c -
 
 select simplecaller();
+
+-- Check that simple expressions that just reference a variable don't
+-- hand out a read/write pointer to an expanded array
+create function simplearraycopy() returns int[] language plpgsql
+as $$
+declare
+  a int[] := array[1, 2, 3];
+  b int[];
+begin
+  b := a;
+  b[1] := 99;
+  a[2] := 42;
+  return a || b;
+end$$;
+
+select simplearraycopy();
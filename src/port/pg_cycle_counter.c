@@ -0,0 +1,192 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_cycle_counter.c
+ *	  Set up the CPU cycle counter for INSTR_TIME_SET_CURRENT_FAST().
+ *
+ * The cycle counter is only used if it ticks at a constant rate regardless
+ * of CPU frequency changes and sleep states, and is synchronized across
+ * CPUs.  ARM64's CNTVCT_EL0 is architecturally guaranteed to be.  On
+ * x86-64, CPUs advertise an "invariant TSC" with a CPUID flag; but since
+ * virtual machines don't always keep the TSCs of different virtual CPUs in
+ * sync, we additionally require that the kernel trusts the TSC enough to
+ * use it as clock source, unless the caller forces its use.
+ *
+ * The counter's frequency is read from CNTFRQ_EL0 on ARM64.  On x86-64, it
+ * is measured against clock_gettime() over a short interval.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ *
+ * src/port/pg_cycle_counter.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "c.h"
+
+#ifdef HAVE__GET_CPUID
+#include <cpuid.h>
+#endif
+
+#include "portability/instr_time.h"
+
+/* time to spend measuring the TSC frequency, in microseconds */
+#define CYCLE_COUNTER_CALIBRATION_USEC	10000
+
+bool		pg_cycle_counter_in_use = false;
+int64		pg_cycle_counter_base = 0;
+double		pg_cycle_counter_ns_per_cycle = 0;
+
+#ifdef HAVE_PG_CYCLE_COUNTER
+
+#if defined(__x86_64__)
+
+/*
+ * Does the CPU have an invariant TSC, and does the OS trust it?
+ */
+static bool
+cycle_counter_is_reliable(bool force)
+{
+#ifdef HAVE__GET_CPUID
+	unsigned int exx[4] = {0, 0, 0, 0};
+
+	/* invariant TSC is bit 8 of EDX of extended leaf 0x80000007 */
+	if (!__get_cpuid(0x80000007, &exx[0], &exx[1], &exx[2], &exx[3]) ||
+		(exx[3] & (1 << 8)) == 0)
+		return false;
+#else
+	return false;
+#endif
+
+#ifdef __linux__
+	if (!force)
+	{
+		FILE	   *file;
+		char		clocksource[64];
+		bool		result = false;
+
+		file = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+		if (file == NULL)
+			return false;
+		if (fgets(clocksource, sizeof(clocksource), file) != NULL)
+			result = strcmp(clocksource, "tsc\n") == 0;
+		fclose(file);
+		return result;
+	}
+#endif
+
+	return true;
+}
+
+/*
+ * Read the system clock and the TSC at (nearly) the same time.  We take a
+ * few readings and keep the one where the two system clock readings around
+ * the TSC reading are closest, to lessen the effect of being interrupted.
+ */
+static void
+read_both_clocks(instr_time *clock, int64 *cycles)
+{
+	int64		best_gap = PG_INT64_MAX;
+	int			i;
+
+	for (i = 0; i < 5; i++)
+	{
+		instr_time	before,
+					after;
+		int64		c;
+		int64		gap;
+
+		INSTR_TIME_SET_CURRENT(before);
+		c = pg_read_cycle_counter();
+		INSTR_TIME_SET_CURRENT(after);
+
+		gap = (int64) (after.tv_sec - before.tv_sec) * 1000000000 +
+			(after.tv_nsec - before.tv_nsec);
+		if (gap < best_gap)
+		{
+			best_gap = gap;
+			*clock = before;
+			*cycles = c;
+		}
+	}
+}
+
+static double
+cycle_counter_ns_per_cycle(void)
+{
+	instr_time	start_time,
+				end_time;
+	int64		start_cycles,
+				end_cycles;
+	double		elapsed_ns;
+
+	read_both_clocks(&start_time, &start_cycles);
+	pg_usleep(CYCLE_COUNTER_CALIBRATION_USEC);
+	read_both_clocks(&end_time, &end_cycles);
+
+	INSTR_TIME_SUBTRACT(end_time, start_time);
+	elapsed_ns = INSTR_TIME_GET_DOUBLE(end_time) * 1e9;
+
+	if (end_cycles <= start_cycles || elapsed_ns <= 0)
+		return 0;
+
+	return elapsed_ns / (double) (end_cycles - start_cycles);
+}
+
+#else							/* __aarch64__ */
+
+static bool
+cycle_counter_is_reliable(bool force)
+{
+	return true;
+}
+
+static double
+cycle_counter_ns_per_cycle(void)
+{
+	int64		frequency;
+
+	__asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(frequency));
+
+	if (frequency <= 0)
+		return 0;
+
+	return 1e9 / (double) frequency;
+}
+
+#endif							/* __x86_64__ */
+
+#endif							/* HAVE_PG_CYCLE_COUNTER */
+
+/*
+ * pg_cycle_counter_initialize --- start using the cycle counter for
+ *		INSTR_TIME_SET_CURRENT_FAST(), if it is usable
+ *
+ * If "force" is true, the OS's opinion on whether the counter is reliable
+ * is ignored; the CPU still has to report it to be invariant.  Returns
+ * true if the cycle counter is now in use.
+ *
+ * This is meant to be called once at program start; in the backend, the
+ * postmaster calls it and its children inherit the result.  The counter's
+ * frequency is available as 1000 / pg_cycle_counter_ns_per_cycle MHz.
+ */
+bool
+pg_cycle_counter_initialize(bool force)
+{
+#ifdef HAVE_PG_CYCLE_COUNTER
+	double		ns_per_cycle;
+
+	if (!cycle_counter_is_reliable(force))
+		return false;
+
+	/* reject frequencies outside 1 MHz .. 100 GHz as measurement errors */
+	ns_per_cycle = cycle_counter_ns_per_cycle();
+	if (ns_per_cycle < 0.01 || ns_per_cycle > 1000)
+		return false;
+
+	pg_cycle_counter_ns_per_cycle = ns_per_cycle;
+	pg_cycle_counter_base = pg_read_cycle_counter();
+	pg_cycle_counter_in_use = true;
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,28 @@
+# Tests that NOTIFY only wakes up listeners on the notified channels
+#
+# trace_notify makes a listener report each time it is woken up to read the
+# notification queue.  The listeners stay in a transaction block while the
+# notification is sent, so that they only process the wakeup, if there was
+# one, when they commit.
+
+session "notifier"
+step "notify_a"	{ NOTIFY chan_a, 'to a'; }
+step "notify_ab"	{ NOTIFY chan_a, 'to a'; NOTIFY chan_b, 'to b'; }
+
+session "listener_a"
+setup			{ LISTEN chan_a; }
+step "a_begin"	{ BEGIN; SET trace_notify = on; SET client_min_messages = debug1; }
+step "a_commit"	{ COMMIT; }
+teardown		{ RESET ALL; UNLISTEN *; }
+
+session "listener_b"
+setup			{ LISTEN chan_b; }
+step "b_begin"	{ BEGIN; SET trace_notify = on; SET client_min_messages = debug1; }
+step "b_commit"	{ COMMIT; }
+teardown		{ RESET ALL; UNLISTEN *; }
+
+# listener_b is not woken up for a channel it isn't listening on
+permutation "a_begin" "b_begin" "notify_a" "a_commit" "b_commit"
+
+# but it is for its own channel
+permutation "a_begin" "b_begin" "notify_ab" "a_commit" "b_commit"
@@ -0,0 +1,15 @@
+CREATE EXTENSION test_microbench;
+
+--
+-- The timings vary from run to run, so only check that every benchmark
+-- runs and reports a sane result.
+--
+SELECT benchmark, ops, ns_per_op >= min_ns_per_op AS ok
+FROM test_microbench(loops => 1000, repeats => 3);
+
+SELECT benchmark, ops FROM test_microbench('tuplesort_int4', 10, 1);
+
+-- error cases
+SELECT * FROM test_microbench('no_such_benchmark');
+SELECT * FROM test_microbench(loops => 0);
+SELECT * FROM test_microbench(repeats => 0);
@@ -0,0 +1,15 @@
+/* src/test/modules/test_microbench/test_microbench--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_microbench" to load this file. \quit
+
+CREATE FUNCTION test_microbench(name text DEFAULT NULL,
+    loops bigint DEFAULT 100000,
+    repeats integer DEFAULT 5,
+    OUT benchmark text,
+    OUT ops bigint,
+    OUT ns_per_op float8,
+    OUT min_ns_per_op float8,
+    OUT cycles_per_op float8)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME' LANGUAGE C;
@@ -0,0 +1,571 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_microbench.c
+ *		Micro-benchmarks for frequently used backend internals.
+ *
+ * Each benchmark consists of a setup function, which builds whatever the
+ * measured operation needs and is not timed, and a run function, which
+ * performs the operation a given number of times.  Every benchmark is run
+ * once untimed to warm up caches and memory contexts, and then 'repeats'
+ * times with timing.  We report the median and the minimum time per
+ * operation over the timed runs; the median is the number to compare, the
+ * minimum shows how much noise there was.  On platforms with a cycle
+ * counter, the median number of cycles per operation is reported too.
+ *
+ * Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_microbench/test_microbench.c
+ *
+ * -------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/table.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_operator_d.h"
+#include "catalog/pg_type_d.h"
+#include "common/hashfn.h"
+#include "executor/executor.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "portability/instr_time.h"
+#include "storage/bufmgr.h"
+#include "storage/bufpage.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/tuplesort.h"
+#include "utils/tuplestore.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(test_microbench);
+
+/* number of keys in the hash tables used by the lookup benchmarks */
+#define BENCH_HASH_KEYS		65536
+
+/*
+ * Results are added to this, so that the compiler can't optimize away the
+ * operations being measured.
+ */
+static volatile uint64 bench_sink;
+
+typedef struct bench_spec
+{
+	const char *name;			/* name of the benchmark, for humans */
+	void	   *(*setup) (int64 loops);
+	void		(*run) (void *arg, int64 loops);
+} bench_spec;
+
+/* simplehash table for the simplehash benchmark */
+typedef struct bench_sh_entry
+{
+	uint32		key;
+	char		status;
+} bench_sh_entry;
+
+#define SH_PREFIX bench_sh
+#define SH_ELEMENT_TYPE bench_sh_entry
+#define SH_KEY_TYPE uint32
+#define SH_KEY key
+#define SH_HASH_KEY(tb, key) murmurhash32(key)
+#define SH_EQUAL(tb, a, b) ((a) == (b))
+#define SH_SCOPE static inline
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
+/*
+ * Simple deterministic pseudo-random number generator, so that every run
+ * of a benchmark works on the same input.
+ */
+static inline uint32
+bench_random(uint64 *state)
+{
+	uint64		x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	*state = x;
+	return (uint32) (x >> 32);
+}
+
+/* keys for the hash table benchmarks, in random order */
+static uint32 *
+make_hash_keys(void)
+{
+	uint32	   *keys = palloc(BENCH_HASH_KEYS * sizeof(uint32));
+	uint64		seed = UINT64CONST(0x5DEECE66D);
+
+	for (int i = 0; i < BENCH_HASH_KEYS; i++)
+		keys[i] = bench_random(&seed);
+	return keys;
+}
+
+/*
+ * Memory allocators: allocate and free 64-byte chunks, keeping a window of
+ * 256 chunks allocated at a time.
+ */
+static void
+run_alloc_free(MemoryContext cxt, int64 loops)
+{
+	void	   *chunks[256] = {0};
+
+	for (int64 i = 0; i < loops; i++)
+	{
+		int			slot = i % lengthof(chunks);
+
+		if (chunks[slot])
+			pfree(chunks[slot]);
+		chunks[slot] = MemoryContextAlloc(cxt, 64);
+	}
+	for (int i = 0; i < lengthof(chunks); i++)
+		if (chunks[i])
+			pfree(chunks[i]);
+}
+
+static void *
+setup_aset(int64 loops)
+{
+	return AllocSetContextCreate(CurrentMemoryContext, "aset benchmark",
+								 ALLOCSET_DEFAULT_SIZES);
+}
+
+static void *
+setup_generation(int64 loops)
+{
+	return GenerationContextCreate(CurrentMemoryContext,
+								   "generation benchmark",
+								   SLAB_DEFAULT_BLOCK_SIZE);
+}
+
+static void *
+setup_slab(int64 loops)
+{
+	return SlabContextCreate(CurrentMemoryContext, "slab benchmark",
+							 SLAB_DEFAULT_BLOCK_SIZE, 64);
+}
+
+static void
+run_context_alloc_free(void *arg, int64 loops)
+{
+	run_alloc_free((MemoryContext) arg, loops);
+}
+
+/* The bump allocator can't free chunks, so reset it every 256 chunks. */
+static void *
+setup_bump(int64 loops)
+{
+	return BumpContextCreate(CurrentMemoryContext, "bump benchmark",
+							 ALLOCSET_DEFAULT_INITSIZE,
+							 ALLOCSET_DEFAULT_MAXSIZE);
+}
+
+static void
+run_bump_alloc(void *arg, int64 loops)
+{
+	MemoryContext cxt = (MemoryContext) arg;
+
+	for (int64 i = 0; i < loops; i++)
+	{
+		if (i % 256 == 0)
+			MemoryContextReset(cxt);
+		bench_sink += (uintptr_t) MemoryContextAlloc(cxt, 64);
+	}
+}
+
+/* dynahash: look up existing uint32 keys */
+typedef struct dynahash_bench
+{
+	HTAB	   *htab;
+	uint32	   *keys;
+} dynahash_bench;
+
+static void *
+setup_dynahash(int64 loops)
+{
+	dynahash_bench *b = palloc(sizeof(dynahash_bench));
+	HASHCTL		ctl;
+
+	ctl.keysize = sizeof(uint32);
+	ctl.entrysize = sizeof(uint32);
+	ctl.hcxt = CurrentMemoryContext;
+	b->htab = hash_create("dynahash benchmark", BENCH_HASH_KEYS, &ctl,
+						  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	b->keys = make_hash_keys();
+	for (int i = 0; i < BENCH_HASH_KEYS; i++)
+		(void) hash_search(b->htab, &b->keys[i], HASH_ENTER, NULL);
+
+	return b;
+}
+
+static void
+run_dynahash_lookup(void *arg, int64 loops)
+{
+	dynahash_bench *b = (dynahash_bench *) arg;
+	uint64		found = 0;
+
+	for (int64 i = 0; i < loops; i++)
+	{
+		if (hash_search(b->htab, &b->keys[i % BENCH_HASH_KEYS],
+						HASH_FIND, NULL) != NULL)
+			found++;
+	}
+	bench_sink += found;
+}
+
+/* simplehash: look up existing uint32 keys */
+typedef struct simplehash_bench
+{
+	bench_sh_hash *htab;
+	uint32	   *keys;
+} simplehash_bench;
+
+static void *
+setup_simplehash(int64 loops)
+{
+	simplehash_bench *b = palloc(sizeof(simplehash_bench));
+	bool		found;
+
+	b->htab = bench_sh_create(CurrentMemoryContext, BENCH_HASH_KEYS, NULL);
+	b->keys = make_hash_keys();
+	for (int i = 0; i < BENCH_HASH_KEYS; i++)
+		(void) bench_sh_insert(b->htab, b->keys[i], &found);
+
+	return b;
+}
+
+static void
+run_simplehash_lookup(void *arg, int64 loops)
+{
+	simplehash_bench *b = (simplehash_bench *) arg;
+	uint64		found = 0;
+
+	for (int64 i = 0; i < loops; i++)
+	{
+		if (bench_sh_lookup(b->htab, b->keys[i % BENCH_HASH_KEYS]) != NULL)
+			found++;
+	}
+	bench_sink += found;
+}
+
+/* tuplesort: sort 'loops' random int4 datums in memory */
+typedef struct tuplesort_bench
+{
+	int32	   *values;
+	int			workMem;
+} tuplesort_bench;
+
+static void *
+setup_tuplesort(int64 loops)
+{
+	tuplesort_bench *b = palloc(sizeof(tuplesort_bench));
+	uint64		seed = UINT64CONST(0x2545F4914F6CDD1D);
+
+	b->values = MemoryContextAllocHuge(CurrentMemoryContext,
+									   loops * sizeof(int32));
+	for (int64 i = 0; i < loops; i++)
+		b->values[i] = (int32) bench_random(&seed);
+
+	/* make sure the sort never spills to disk */
+	b->workMem = Min(Max((int64) work_mem, loops * 64 / 1024 + 1024),
+					 MAX_KILOBYTES);
+
+	return b;
+}
+
+static void
+run_tuplesort_int4(void *arg, int64 loops)
+{
+	tuplesort_bench *b = (tuplesort_bench *) arg;
+	Tuplesortstate *sortstate;
+	Datum		val;
+	bool		isnull;
+
+	sortstate = tuplesort_begin_datum(INT4OID, Int4LessOperator, InvalidOid,
+									  false, b->workMem, NULL, false);
+	for (int64 i = 0; i < loops; i++)
+		tuplesort_putdatum(sortstate, Int32GetDatum(b->values[i]), false);
+	tuplesort_performsort(sortstate);
+	while (tuplesort_getdatum(sortstate, true, &val, &isnull, NULL))
+		bench_sink += DatumGetInt32(val);
+	tuplesort_end(sortstate);
+}
+
+/* expression evaluation: int4lt(int4pl($1, $2), $3) with constant inputs */
+typedef struct expr_bench
+{
+	ExprState  *state;
+	ExprContext *econtext;
+} expr_bench;
+
+static void *
+setup_expr(int64 loops)
+{
+	expr_bench *b = palloc(sizeof(expr_bench));
+	Expr	   *pl;
+	Expr	   *lt;
+
+	pl = (Expr *) makeFuncExpr(F_INT4PL, INT4OID,
+							   list_make2(makeConst(INT4OID, -1, InvalidOid,
+													sizeof(int32),
+													Int32GetDatum(1),
+													false, true),
+										  makeConst(INT4OID, -1, InvalidOid,
+													sizeof(int32),
+													Int32GetDatum(2),
+													false, true)),
+							   InvalidOid, InvalidOid,
+							   COERCE_EXPLICIT_CALL);
+	lt = (Expr *) makeFuncExpr(F_INT4LT, BOOLOID,
+							   list_make2(pl,
+										  makeConst(INT4OID, -1, InvalidOid,
+													sizeof(int32),
+													Int32GetDatum(4),
+													false, true)),
+							   InvalidOid, InvalidOid,
+							   COERCE_EXPLICIT_CALL);
+
+	b->state = ExecInitExpr(lt, NULL);
+	b->econtext = CreateStandaloneExprContext();
+
+	return b;
+}
+
+static void
+run_expr_eval(void *arg, int64 loops)
+{
+	expr_bench *b = (expr_bench *) arg;
+	uint64		ntrue = 0;
+	bool		isnull;
+
+	for (int64 i = 0; i < loops; i++)
+	{
+		if (DatumGetBool(ExecEvalExprSwitchContext(b->state, b->econtext,
+												   &isnull)))
+			ntrue++;
+	}
+	bench_sink += ntrue;
+}
+
+/* page routines: add 32-byte items to a heap page, reinitializing when full */
+static void *
+setup_page(int64 loops)
+{
+	return palloc0(BLCKSZ);
+}
+
+static void
+run_page_add_item(void *arg, int64 loops)
+{
+	Page		page = (Page) arg;
+	char		item[MAXALIGN(32)] = {0};
+
+	PageInit(page, BLCKSZ, 0);
+	for (int64 i = 0; i < loops; i++)
+	{
+		if (PageAddItem(page, (Item) item, sizeof(item), InvalidOffsetNumber,
+						false, true) == InvalidOffsetNumber)
+		{
+			PageInit(page, BLCKSZ, 0);
+			(void) PageAddItem(page, (Item) item, sizeof(item),
+							   InvalidOffsetNumber, false, true);
+		}
+	}
+}
+
+/*
+ * Buffer prefetching: PrefetchBuffer() on blocks that are already in shared
+ * buffers.  This is the overhead btree_heap_prefetch adds per heap block to
+ * index scans over a cached heap, where prefetching can't gain anything.
+ * pg_class serves as the relation; setup reads all its blocks in.
+ */
+static void *
+setup_prefetch(int64 loops)
+{
+	Relation	rel = table_open(RelationRelationId, AccessShareLock);
+	BlockNumber nblocks = RelationGetNumberOfBlocks(rel);
+
+	for (BlockNumber blkno = 0; blkno < nblocks; blkno++)
+		ReleaseBuffer(ReadBuffer(rel, blkno));
+	table_close(rel, AccessShareLock);
+
+	return NULL;
+}
+
+static void
+run_prefetch_buffer_hit(void *arg, int64 loops)
+{
+	Relation	rel = table_open(RelationRelationId, AccessShareLock);
+	BlockNumber nblocks = RelationGetNumberOfBlocks(rel);
+
+	for (int64 i = 0; i < loops; i++)
+	{
+		PrefetchBufferResult result;
+
+		result = PrefetchBuffer(rel, MAIN_FORKNUM, (BlockNumber) (i % nblocks));
+		bench_sink += BufferIsValid(result.recent_buffer);
+	}
+	table_close(rel, AccessShareLock);
+}
+
+static const bench_spec bench_specs[] = {
+	{"aset_alloc_free", setup_aset, run_context_alloc_free},
+	{"generation_alloc_free", setup_generation, run_context_alloc_free},
+	{"slab_alloc_free", setup_slab, run_context_alloc_free},
+	{"bump_alloc", setup_bump, run_bump_alloc},
+	{"dynahash_lookup", setup_dynahash, run_dynahash_lookup},
+	{"simplehash_lookup", setup_simplehash, run_simplehash_lookup},
+	{"tuplesort_int4", setup_tuplesort, run_tuplesort_int4},
+	{"expr_eval_int4", setup_expr, run_expr_eval},
+	{"page_add_item", setup_page, run_page_add_item},
+	{"prefetch_buffer_hit", setup_prefetch, run_prefetch_buffer_hit},
+};
+
+static int
+double_cmp(const void *a, const void *b)
+{
+	double		da = *(const double *) a;
+	double		db = *(const double *) b;
+
+	if (da < db)
+		return -1;
+	if (da > db)
+		return 1;
+	return 0;
+}
+
+/*
+ * Run one benchmark and add a row with its results to 'tupstore'.
+ */
+static void
+run_benchmark(const bench_spec *spec, int64 loops, int repeats,
+			  Tuplestorestate *tupstore, TupleDesc tupdesc)
+{
+	MemoryContext bench_cxt;
+	MemoryContext oldcxt;
+	void	   *arg;
+	double	   *ns = palloc(repeats * sizeof(double));
+	double	   *cycles = palloc(repeats * sizeof(double));
+	Datum		values[5];
+	bool		nulls[5] = {0};
+
+	bench_cxt = AllocSetContextCreate(CurrentMemoryContext,
+									  "microbenchmark",
+									  ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(bench_cxt);
+
+	arg = spec->setup(loops);
+
+	/* warm-up run */
+	spec->run(arg, loops);
+
+	for (int r = 0; r < repeats; r++)
+	{
+		instr_time	start;
+		instr_time	duration;
+#ifdef HAVE_PG_CYCLE_COUNTER
+		int64		start_cycles;
+#endif
+
+		CHECK_FOR_INTERRUPTS();
+
+		INSTR_TIME_SET_CURRENT(start);
+#ifdef HAVE_PG_CYCLE_COUNTER
+		start_cycles = pg_read_cycle_counter();
+#endif
+		spec->run(arg, loops);
+#ifdef HAVE_PG_CYCLE_COUNTER
+		cycles[r] = (double) (pg_read_cycle_counter() - start_cycles) / loops;
+#endif
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+
+		ns[r] = INSTR_TIME_GET_DOUBLE(duration) * 1e9 / loops;
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(bench_cxt);
+
+	qsort(ns, repeats, sizeof(double), double_cmp);
+	qsort(cycles, repeats, sizeof(double), double_cmp);
+
+	values[0] = CStringGetTextDatum(spec->name);
+	values[1] = Int64GetDatum(loops);
+	values[2] = Float8GetDatum(ns[repeats / 2]);
+	values[3] = Float8GetDatum(ns[0]);
+#ifdef HAVE_PG_CYCLE_COUNTER
+	values[4] = Float8GetDatum(cycles[repeats / 2]);
+#else
+	nulls[4] = true;
+#endif
+	tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+
+	pfree(ns);
+	pfree(cycles);
+}
+
+/*
+ * SQL-callable entry point.  Runs the named benchmark, or all of them if
+ * the name is NULL.
+ */
+Datum
+test_microbench(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	char	   *name = PG_ARGISNULL(0) ? NULL : text_to_cstring(PG_GETARG_TEXT_PP(0));
+	int64		loops = PG_ARGISNULL(1) ? 100000 : PG_GETARG_INT64(1);
+	int			repeats = PG_ARGISNULL(2) ? 5 : PG_GETARG_INT32(2);
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext oldcontext;
+	bool		found = false;
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	if (loops < 1 || loops > PG_INT32_MAX)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("loops must be between 1 and %d", PG_INT32_MAX)));
+	if (repeats < 1 || repeats > 1000)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("repeats must be between 1 and %d", 1000)));
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+	MemoryContextSwitchTo(oldcontext);
+
+	for (int i = 0; i < lengthof(bench_specs); i++)
+	{
+		if (name != NULL && strcmp(name, bench_specs[i].name) != 0)
+			continue;
+		run_benchmark(&bench_specs[i], loops, repeats, tupstore, tupdesc);
+		found = true;
+	}
+
+	if (!found)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("unrecognized benchmark \"%s\"", name)));
+
+	return (Datum) 0;
+}
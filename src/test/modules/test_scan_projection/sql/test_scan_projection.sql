@@ -0,0 +1,24 @@
+CREATE EXTENSION test_scan_projection;
+
+CREATE TABLE proj_tbl (a int, b int, c text) USING test_scan_projection;
+INSERT INTO proj_tbl SELECT i, i * 10, 'row ' || i FROM generate_series(1, 5) i;
+
+-- columns in the target list and in the qual
+SELECT a FROM proj_tbl WHERE b > 20 ORDER BY a;
+SELECT * FROM proj_tbl WHERE a = 1;
+
+-- no column at all
+SELECT count(*) FROM proj_tbl;
+
+-- columns used only inside an aggregate
+SELECT max(c) FROM proj_tbl WHERE a < 3;
+
+-- a whole-row reference needs every column
+SELECT t FROM proj_tbl t WHERE a = 5;
+
+-- system columns
+SELECT ctid, a FROM proj_tbl WHERE a = 1;
+DELETE FROM proj_tbl WHERE a = 2;
+
+DROP TABLE proj_tbl;
+DROP EXTENSION test_scan_projection;
@@ -0,0 +1,11 @@
+/* src/test/modules/test_scan_projection/test_scan_projection--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_scan_projection" to load this file. \quit
+
+CREATE FUNCTION test_scan_projection_handler(internal)
+RETURNS table_am_handler
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE ACCESS METHOD test_scan_projection TYPE TABLE
+HANDLER test_scan_projection_handler;
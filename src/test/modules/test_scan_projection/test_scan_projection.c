@@ -0,0 +1,84 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_scan_projection.c
+ *		Table access method for testing scan_set_projection.
+ *
+ * The access method is heap, except that it provides a scan_set_projection
+ * callback, which reports the columns the executor said it needs as a
+ * NOTICE.  The scan itself still returns whole rows.
+ *
+ * Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_scan_projection/test_scan_projection.c
+ *
+ * -------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/sysattr.h"
+#include "access/tableam.h"
+#include "fmgr.h"
+#include "lib/stringinfo.h"
+#include "nodes/bitmapset.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(test_scan_projection_handler);
+
+static TableAmRoutine projection_methods;
+static bool projection_methods_initialized = false;
+
+static void
+projection_scan_set_projection(TableScanDesc scan, Bitmapset *attrs)
+{
+	Relation	rel = scan->rs_rd;
+	StringInfoData buf;
+	int			x;
+
+	if (attrs == NULL)
+	{
+		elog(NOTICE, "scan of \"%s\" needs no columns",
+			 RelationGetRelationName(rel));
+		return;
+	}
+
+	if (bms_is_member(0 - FirstLowInvalidHeapAttributeNumber, attrs))
+	{
+		elog(NOTICE, "scan of \"%s\" needs all columns",
+			 RelationGetRelationName(rel));
+		return;
+	}
+
+	initStringInfo(&buf);
+	x = -1;
+	while ((x = bms_next_member(attrs, x)) >= 0)
+	{
+		AttrNumber	attnum = x + FirstLowInvalidHeapAttributeNumber;
+
+		if (buf.len > 0)
+			appendStringInfoString(&buf, ", ");
+		appendStringInfoString(&buf,
+							   get_attname(RelationGetRelid(rel), attnum,
+										   false));
+	}
+
+	elog(NOTICE, "scan of \"%s\" needs columns: %s",
+		 RelationGetRelationName(rel), buf.data);
+	pfree(buf.data);
+}
+
+Datum
+test_scan_projection_handler(PG_FUNCTION_ARGS)
+{
+	if (!projection_methods_initialized)
+	{
+		projection_methods = *GetHeapamTableAmRoutine();
+		projection_methods.scan_set_projection = projection_scan_set_projection;
+		projection_methods_initialized = true;
+	}
+
+	PG_RETURN_POINTER(&projection_methods);
+}
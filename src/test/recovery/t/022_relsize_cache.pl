@@ -0,0 +1,108 @@
+# Check that the shared relation size cache stays correct when relations
+# are truncated and extended, on a primary and on a standby replaying the
+# same changes.  Every query runs in a new backend, so it gets relation
+# sizes from the shared cache, not from a size its own SMgrRelation kept.
+# A size that is too large makes sequential scans fail to read blocks past
+# the end of the file, and one that is too small makes them miss rows.
+use strict;
+use warnings;
+
+use PostgresNode;
+use TestLib;
+use Test::More tests => 16;
+
+my $node_primary = get_new_node('primary');
+$node_primary->init(allows_streaming => 1);
+$node_primary->append_conf(
+	'postgresql.conf', qq{
+shared_relation_size_cache = 1024
+autovacuum = off
+});
+$node_primary->start;
+$node_primary->backup('my_backup');
+
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_primary, 'my_backup',
+	has_streaming => 1);
+$node_standby->start;
+
+my $count_query = 'SELECT count(*), sum(id) FROM relsize_tbl';
+my $pages_query =
+  "SELECT pg_relation_size('relsize_tbl') / current_setting('block_size')::int";
+
+# Check the contents of relsize_tbl on both nodes.
+sub check_table
+{
+	my ($expected, $test_name) = @_;
+
+	$node_primary->wait_for_catchup($node_standby, 'replay',
+		$node_primary->lsn('insert'));
+	is($node_primary->safe_psql('postgres', $count_query),
+		$expected, "$test_name on primary");
+	is($node_standby->safe_psql('postgres', $count_query),
+		$expected, "$test_name on standby");
+	return;
+}
+
+$node_primary->safe_psql(
+	'postgres', q{
+	CREATE TABLE relsize_tbl (id int, filler text);
+	INSERT INTO relsize_tbl
+		SELECT i, repeat('x', 100) FROM generate_series(1, 10000) i;
+});
+check_table('10000|50005000', 'initial contents');
+
+# Remove the rows at the end, and let VACUUM truncate the table
+my $pages_before = $node_primary->safe_psql('postgres', $pages_query);
+$node_primary->safe_psql(
+	'postgres', q{
+	DELETE FROM relsize_tbl WHERE id > 2000;
+	VACUUM relsize_tbl;
+});
+my $pages_after = $node_primary->safe_psql('postgres', $pages_query);
+cmp_ok($pages_after, '<', $pages_before, 'VACUUM truncated the table');
+check_table('2000|2001000', 'after truncation by VACUUM');
+
+# Extend it again, past its original size
+$node_primary->safe_psql(
+	'postgres', q{
+	INSERT INTO relsize_tbl
+		SELECT i, repeat('x', 100) FROM generate_series(2001, 15000) i;
+});
+cmp_ok($node_primary->safe_psql('postgres', $pages_query),
+	'>', $pages_before, 'table extended past its original size');
+check_table('15000|112507500', 'after extension');
+
+# The first TRUNCATE assigns a new relfilenode.  The second one, in the same
+# transaction, truncates that file in place.
+$node_primary->safe_psql(
+	'postgres', q{
+	BEGIN;
+	TRUNCATE relsize_tbl;
+	INSERT INTO relsize_tbl
+		SELECT i, repeat('x', 100) FROM generate_series(1, 5000) i;
+	TRUNCATE relsize_tbl;
+	INSERT INTO relsize_tbl
+		SELECT i, repeat('x', 100) FROM generate_series(1, 100) i;
+	COMMIT;
+});
+check_table('100|5050', 'after TRUNCATE in the same transaction');
+
+# Sizes must also be right after the cache was emptied by a restart
+$node_primary->restart;
+$node_standby->restart;
+check_table('100|5050', 'after restart');
+
+# Extend and truncate again, starting with an empty cache
+$node_primary->safe_psql(
+	'postgres', q{
+	INSERT INTO relsize_tbl
+		SELECT i, repeat('x', 100) FROM generate_series(101, 8000) i;
+});
+check_table('8000|32004000', 'after extension following restart');
+$node_primary->safe_psql(
+	'postgres', q{
+	DELETE FROM relsize_tbl WHERE id > 10;
+	VACUUM relsize_tbl;
+});
+check_table('10|55', 'after truncation following restart');
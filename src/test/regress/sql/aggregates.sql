@@ -605,6 +605,24 @@ select aggfns(distinct a,b,c order by a,b,i,c)
 select aggfns(distinct a,a,c order by a,b)
   from (values (1,1,'foo')) v(a,b,c), generate_series(1,2) i;
 
+-- approx_count_distinct tests
+select approx_count_distinct(four) as four, approx_count_distinct(ten) as ten,
+  approx_count_distinct(null::int) as nulls from onek;
+select approx_count_distinct(x) from (values (1), (1), (null), (2)) v(x);
+select approx_count_distinct(x) from (values (1)) v(x) where false;
+select approx_count_distinct(g) between 9500 and 10500 as ok
+  from generate_series(1, 10000) g;
+select approx_count_distinct(point(1,1));  -- not hashable
+-- sketches can be stored and merged later
+select length(approx_count_distinct_sketch(1));
+select approx_count_distinct_estimate(approx_count_distinct_sketch(x))
+  from (values ('a'), ('b'), ('a')) v(x);
+select approx_count_distinct_estimate(approx_count_distinct_merge(s))
+  between 1900 and 2100 as ok
+  from (select approx_count_distinct_sketch(g % 2000) as s
+        from generate_series(1, 4000) g group by g % 2) ss;
+select approx_count_distinct_estimate('\x0102'::bytea);
+
 -- string_agg tests
 select string_agg(a,',') from (values('aaaa'),('bbbb'),('cccc')) g(a);
 select string_agg(a,',') from (values('aaaa'),(null),('bbbb'),('cccc')) g(a);
@@ -1067,6 +1085,31 @@ FROM (SELECT * FROM tenk1
       UNION ALL SELECT * FROM tenk1
       UNION ALL SELECT * FROM tenk1) u;
 
+-- string_agg(text) and string_agg(bytea) cover string_agg_combine
+-- array_agg(anynonarray) covers array_agg_combine, with by-value and
+-- by-reference elements, and array_agg(anyarray) array_agg_array_combine
+EXPLAIN (COSTS OFF)
+SELECT string_agg(unique1::text, ','), string_agg(unique1::text::bytea, ','),
+       array_agg(unique1), array_agg(unique1::text), array_agg(ARRAY[unique1])
+FROM tenk1;
+
+SELECT (SELECT sum(v::int) FROM unnest(string_to_array(t, ',')) v) AS tsum,
+       (SELECT count(*) FROM unnest(string_to_array(t, ',')) v) AS tcount,
+       (SELECT sum(v::int)
+          FROM unnest(string_to_array(encode(b, 'escape'), ',')) v) AS bsum,
+       cardinality(a) AS acard,
+       cardinality(array_remove(a, NULL)) AS anotnull,
+       (SELECT sum(v) FROM unnest(a) v) AS asum,
+       (SELECT sum(v::int) FROM unnest(at) v) AS atsum,
+       array_dims(aa) AS aadims,
+       (SELECT sum(v) FROM unnest(aa) v) AS aasum
+FROM (SELECT string_agg(unique1::text, ',') AS t,
+             string_agg(unique1::text::bytea, ',') AS b,
+             array_agg(CASE WHEN unique1 % 4 = 1 THEN NULL ELSE unique1 END) AS a,
+             array_agg(CASE WHEN unique1 % 4 = 1 THEN NULL ELSE unique1 END::text) AS at,
+             array_agg(ARRAY[unique1, CASE WHEN unique1 % 4 = 1 THEN NULL ELSE unique1 END]) AS aa
+      FROM tenk1) s;
+
 ROLLBACK;
 
 -- test coverage for dense_rank
@@ -1216,6 +1259,57 @@ set work_mem to default;
   union all
 (select * from agg_group_4 except select * from agg_hash_4);
 
+-- A partial hash aggregate, like the one in each parallel worker, emits the
+-- groups it has when it runs out of memory instead of spilling them to disk.
+-- Check that it did so, without emitting after every group, and that the
+-- results are still right.
+create function partial_hashagg_batches(query text,
+  out emitted_early bool, out few_batches bool, out spilled bool)
+language plpgsql as
+$$
+declare
+    plan jsonb;
+    agg jsonb;
+begin
+    execute 'explain (analyze, costs off, summary off, timing off, format json) '
+        || query into plan;
+    agg := jsonb_path_query_first(plan,
+        '$.** ? (@."Partial Mode" == "Partial")');
+    emitted_early := jsonb_path_exists(agg,
+        '$.**."HashAgg Batches" ? (@ > 1)');
+    few_batches := not jsonb_path_exists(agg,
+        '$.**."HashAgg Batches" ? (@ >= 1000)');
+    spilled := jsonb_path_exists(agg, '$.**."Disk Usage" ? (@ > 0)');
+end;
+$$;
+
+set work_mem='64kB';
+set enable_sort = false;
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set min_parallel_table_scan_size = 0;
+set max_parallel_workers_per_gather = 2;
+
+select * from partial_hashagg_batches('
+select g%10000 as c1, sum(g::numeric) as c2, count(*) as c3
+  from agg_data_20k group by g%10000');
+
+(select g%10000 as c1, sum(g::numeric) as c2, count(*) as c3
+   from agg_data_20k group by g%10000
+ except select * from agg_group_1)
+  union all
+(select * from agg_group_1
+ except select g%10000 as c1, sum(g::numeric) as c2, count(*) as c3
+   from agg_data_20k group by g%10000);
+
+reset max_parallel_workers_per_gather;
+reset min_parallel_table_scan_size;
+reset parallel_tuple_cost;
+reset parallel_setup_cost;
+reset enable_sort;
+reset work_mem;
+drop function partial_hashagg_batches(text);
+
 drop table agg_group_1;
 drop table agg_group_2;
 drop table agg_group_3;
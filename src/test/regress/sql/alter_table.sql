@@ -2162,6 +2162,22 @@ ALTER TABLE unlogged1 SET LOGGED; -- silently do nothing
 DROP TABLE unlogged3;
 DROP TABLE unlogged2;
 DROP TABLE unlogged1;
+-- set logged copies the table's blocks, so tuples keep their ctids
+CREATE UNLOGGED TABLE unlogged4(f1 int PRIMARY KEY, f2 text);
+INSERT INTO unlogged4
+  SELECT g, (SELECT string_agg(md5(g::text || i::text), '')
+             FROM generate_series(1, 100) i)
+  FROM generate_series(1, 100) g;
+DELETE FROM unlogged4 WHERE f1 <= 10;
+SELECT ctid AS unlogged4_ctid FROM unlogged4 WHERE f1 = 50 \gset
+ALTER TABLE unlogged4 SET LOGGED;
+SELECT relpersistence FROM pg_class WHERE relname = 'unlogged4';
+SELECT ctid = :'unlogged4_ctid' AS same_ctid FROM unlogged4 WHERE f1 = 50;
+SELECT count(*), sum(length(f2)) FROM unlogged4;
+SET enable_seqscan = off;
+SELECT length(f2) FROM unlogged4 WHERE f1 = 50;
+RESET enable_seqscan;
+DROP TABLE unlogged4;
 -- set unlogged
 CREATE TABLE logged1(f1 SERIAL PRIMARY KEY, f2 TEXT);
 -- check relpersistence of a permanent table
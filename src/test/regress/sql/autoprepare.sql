@@ -0,0 +1,64 @@
+--
+-- Tests for automatic preparation of simple-protocol statements
+--
+
+-- prepare every statement the first time it is seen
+SET autoprepare_threshold = 1;
+
+CREATE TABLE autoprep_tbl (a int, b text);
+INSERT INTO autoprep_tbl VALUES (1, 'one');
+INSERT INTO autoprep_tbl VALUES (2, 'two');
+INSERT INTO autoprep_tbl VALUES (3, 'three');
+
+-- statements that differ only in their literals
+SELECT a, b FROM autoprep_tbl WHERE a = 1;
+SELECT a, b FROM autoprep_tbl WHERE a = 2;
+SELECT a, b FROM autoprep_tbl WHERE b = 'three';
+SELECT a, b FROM autoprep_tbl WHERE b = 'one';
+SELECT a, b FROM autoprep_tbl ORDER BY a LIMIT 1;
+SELECT a, b FROM autoprep_tbl ORDER BY a LIMIT 2;
+
+-- int4, int8 and numeric literals must not share a prepared statement
+SELECT 1 + 1;
+SELECT 2147483647 + 1;
+SELECT 2147483648 + 1;
+SELECT 1.5 + 1;
+SELECT -5 + 1;
+SELECT a, b FROM autoprep_tbl WHERE a = 3000000000;
+SELECT a, b FROM autoprep_tbl WHERE a = 2.0;
+SELECT a, b FROM autoprep_tbl WHERE a = 2.5;
+
+-- errors raised while executing a prepared statement
+SELECT 1 / 0;
+SELECT 4 / 2;
+
+UPDATE autoprep_tbl SET b = 'deux' WHERE a = 2;
+UPDATE autoprep_tbl SET b = 'trois' WHERE a = 3;
+DELETE FROM autoprep_tbl WHERE a = 4;
+SELECT a, b FROM autoprep_tbl ORDER BY 1;
+
+-- literals that can't be replaced by a parameter, or statements whose
+-- parameterized form can't be prepared, must still work
+SELECT a, count(*) FROM autoprep_tbl GROUP BY 1 ORDER BY 1;
+SELECT 'abcd'::varchar(2);
+SELECT 'abc';
+SELECT 'def';
+
+-- schema changes invalidate the prepared statements
+SELECT * FROM autoprep_tbl WHERE b = 'one';
+ALTER TABLE autoprep_tbl ADD COLUMN c int DEFAULT 0;
+SELECT * FROM autoprep_tbl WHERE b = 'one';
+-- a string literal's parameter type follows the column's new type
+SELECT a, b FROM autoprep_tbl WHERE b = 'deux';
+ALTER TABLE autoprep_tbl ALTER COLUMN b TYPE int USING a * 10;
+SELECT a, b FROM autoprep_tbl WHERE b = '20';
+
+-- DISCARD ALL forgets the prepared statements (and resets the setting)
+DISCARD ALL;
+SHOW autoprepare_threshold;
+SET autoprepare_threshold = 1;
+SELECT a, b FROM autoprep_tbl WHERE a = 1;
+SELECT 1 + 1;
+
+RESET autoprepare_threshold;
+DROP TABLE autoprep_tbl;
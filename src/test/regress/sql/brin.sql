@@ -509,3 +509,92 @@ SELECT * FROM brintest_3 WHERE b < '0';
 
 DROP TABLE brintest_3;
 RESET enable_seqscan;
+
+-- bloom and multi-minmax opclasses
+CREATE TABLE brintest_bloom_multi (a int4, b text, c int8, d timestamp)
+  WITH (fillfactor = 10);
+INSERT INTO brintest_bloom_multi
+SELECT (i * 7919) % 1000, md5((i % 500)::text),
+       CASE WHEN i % 100 = 0 THEN i * 1000 ELSE i END,
+       '2020-01-01'::timestamp + i * interval '1 minute'
+  FROM generate_series(1, 2000) s(i);
+CREATE INDEX brin_bloom_idx ON brintest_bloom_multi
+  USING brin (a int4_bloom_ops, b text_bloom_ops) WITH (pages_per_range = 2);
+CREATE INDEX brin_multi_idx ON brintest_bloom_multi
+  USING brin (c int8_minmax_multi_ops, d timestamp_minmax_multi_ops)
+  WITH (pages_per_range = 2);
+
+SET enable_seqscan = off;
+
+EXPLAIN (COSTS OFF)
+SELECT count(*) FROM brintest_bloom_multi WHERE a = 17;
+
+SELECT count(*) FROM brintest_bloom_multi WHERE a = 17;
+SELECT count(*) FROM brintest_bloom_multi WHERE b = md5('42');
+SELECT count(*) FROM brintest_bloom_multi WHERE c < 50;
+SELECT count(*) FROM brintest_bloom_multi WHERE c = 100000;
+SELECT count(*) FROM brintest_bloom_multi WHERE c > 1500000;
+SELECT count(*) FROM brintest_bloom_multi
+  WHERE d BETWEEN '2020-01-01 10:00' AND '2020-01-01 11:00';
+
+-- insert into an already-summarized range, and resummarize
+INSERT INTO brintest_bloom_multi VALUES (17, md5('42'), -5, '2019-12-31');
+SELECT brin_summarize_new_values('brin_bloom_idx') >= 0 AS ok;
+SELECT count(*) FROM brintest_bloom_multi WHERE a = 17;
+SELECT count(*) FROM brintest_bloom_multi WHERE c < 50;
+SELECT count(*) FROM brintest_bloom_multi WHERE d < '2020-01-01';
+
+DROP TABLE brintest_bloom_multi;
+RESET enable_seqscan;
+
+-- test parallel index build and summarization
+CREATE TABLE brin_parallel_test (a int, b text)
+  WITH (parallel_workers = 2, fillfactor = 10);
+INSERT INTO brin_parallel_test
+SELECT i, md5(i::text) FROM generate_series(1, 5000) s(i);
+SET max_parallel_maintenance_workers = 2;
+CREATE INDEX brin_parallel_idx ON brin_parallel_test
+  USING brin (a, b) WITH (pages_per_range = 2);
+-- every range must have been summarized by the build
+SELECT brin_summarize_new_values('brin_parallel_idx');
+SET enable_seqscan = off;
+SELECT count(*) FROM brin_parallel_test WHERE a BETWEEN 100 AND 200;
+SELECT count(*) FROM brin_parallel_test WHERE b = md5('4242');
+RESET enable_seqscan;
+
+TRUNCATE brin_parallel_test;
+INSERT INTO brin_parallel_test
+SELECT i, md5(i::text) FROM generate_series(1, 5000) s(i);
+SET min_parallel_table_scan_size = 0;
+SELECT brin_summarize_new_values('brin_parallel_idx') > 0 AS summarized;
+SELECT brin_summarize_new_values('brin_parallel_idx');
+SET enable_seqscan = off;
+SELECT count(*) FROM brin_parallel_test WHERE a BETWEEN 100 AND 200;
+SELECT count(*) FROM brin_parallel_test WHERE b = md5('4242');
+RESET enable_seqscan;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_maintenance_workers;
+
+DROP TABLE brin_parallel_test;
+
+-- Updates that only change columns of BRIN indexes can be HOT
+CREATE TABLE brin_hot (id int PRIMARY KEY, val int NOT NULL)
+  WITH (autovacuum_enabled = off, fillfactor = 70);
+INSERT INTO brin_hot SELECT i, 0 FROM generate_series(1, 100) i;
+CREATE INDEX brin_hot_val ON brin_hot USING brin (val);
+BEGIN;
+UPDATE brin_hot SET val = -3 WHERE id = 42;
+SELECT pg_stat_get_xact_tuples_updated('brin_hot'::regclass) AS updated,
+       pg_stat_get_xact_tuples_hot_updated('brin_hot'::regclass) AS hot_updated;
+COMMIT;
+-- the BRIN summary must still cover the new value
+SET enable_seqscan = off;
+SELECT id FROM brin_hot WHERE val = -3;
+RESET enable_seqscan;
+-- changing a column of the btree index still prevents HOT
+BEGIN;
+UPDATE brin_hot SET id = 1000, val = -4 WHERE id = 43;
+SELECT pg_stat_get_xact_tuples_updated('brin_hot'::regclass) AS updated,
+       pg_stat_get_xact_tuples_hot_updated('brin_hot'::regclass) AS hot_updated;
+COMMIT;
+DROP TABLE brin_hot;
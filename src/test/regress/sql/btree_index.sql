@@ -191,3 +191,67 @@ INSERT INTO delete_test_table SELECT i, 1, 2, 3 FROM generate_series(1,1000) i;
 
 -- Test unsupported btree opclass parameters
 create index on btree_tall_tbl (id int4_ops(foo=1));
+
+--
+-- Test skip scans, which are used when there are quals on the second index
+-- column but not the first
+--
+CREATE TABLE btree_skip_tbl (a int, b int);
+INSERT INTO btree_skip_tbl SELECT i % 5, i FROM generate_series(1, 1000) i;
+INSERT INTO btree_skip_tbl VALUES (NULL, 10), (NULL, 2000);
+CREATE INDEX btree_skip_idx ON btree_skip_tbl (a, b);
+VACUUM ANALYZE btree_skip_tbl;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT a, b FROM btree_skip_tbl WHERE b < 12 ORDER BY a, b;
+SELECT count(*) FROM btree_skip_tbl WHERE b = 10;
+-- backward scans
+SELECT a, b FROM btree_skip_tbl WHERE b BETWEEN 500 AND 502 ORDER BY a DESC, b DESC;
+SELECT a, b FROM btree_skip_tbl WHERE b > 999 ORDER BY a DESC, b DESC;
+-- bitmap scan
+SET enable_indexscan = off;
+SET enable_indexonlyscan = off;
+SET enable_bitmapscan = on;
+SELECT count(*) FROM btree_skip_tbl WHERE b <= 100;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+RESET enable_indexscan;
+RESET enable_indexonlyscan;
+DROP TABLE btree_skip_tbl;
+
+--
+-- Test pivot tuples truncated within a text attribute, for keys sharing
+-- long prefixes
+--
+CREATE TABLE btree_prefix_tbl (t text COLLATE "C");
+INSERT INTO btree_prefix_tbl
+  SELECT 'https://www.example.com/some/long/path/' || i
+  FROM generate_series(1, 10000) i;
+CREATE INDEX btree_prefix_idx ON btree_prefix_tbl (t);
+INSERT INTO btree_prefix_tbl
+  SELECT 'https://www.example.com/some/long/path/' || i
+  FROM generate_series(10001, 20000) i;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*) FROM btree_prefix_tbl
+  WHERE t >= 'https://www.example.com/some/long/path/5'
+    AND t < 'https://www.example.com/some/long/path/6';
+SELECT count(*) FROM btree_prefix_tbl
+  WHERE t = 'https://www.example.com/some/long/path/12345';
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE btree_prefix_tbl;
+
+--
+-- Test heap prefetching in plain index scans
+--
+SET btree_heap_prefetch = on;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+EXPLAIN (COSTS OFF)
+SELECT count(*), sum(ten) FROM tenk1 WHERE unique1 < 1000;
+SELECT count(*), sum(ten) FROM tenk1 WHERE unique1 < 1000;
+SELECT unique1, ten FROM tenk1 WHERE unique1 < 1000 ORDER BY unique1 DESC LIMIT 3;
+RESET btree_heap_prefetch;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
@@ -444,6 +444,39 @@ drop type textrange_en_us;
 CREATE COLLATION ctest_det (locale = 'en_US.utf8', deterministic = true);
 CREATE COLLATION ctest_nondet (locale = 'en_US.utf8', deterministic = false);
 
+-- comparisons of ASCII letters and digits by derived weights (see
+-- pg_locale_ascii_weights()), checked against strcoll()
+
+CREATE TABLE collate_weights_test (x text COLLATE "en_US");
+INSERT INTO collate_weights_test
+  SELECT DISTINCT s FROM (
+    SELECT a || b FROM unnest('{a,A,b,B,1,-}'::text[]) a,
+                       unnest('{a,A,b,B,1,-}'::text[]) b
+    UNION ALL
+    SELECT unnest('{abc,abC,aBc,Abc,ABC,abcd,abcD,abce,abd,ab1,ab2,ab10,a1b,1ab,10,9,09,a9,a10,z,Z,zz,Zz,zZ,a-b,a_b,a.b,"a b",ab-,-ab,ab!,a-B,A-b,abé,abe,abf,abÉ,aBé,é,e,E,ae,æ,ab€,Übel,uber,Uber,über,abcé,abcè,Abcé}'::text[])
+  ) ss(s);
+SELECT count(*) FROM collate_weights_test;
+
+-- In a new session, the first comparisons made by the < operator use
+-- strcoll(), so record their results before anything builds the weights.
+\c -
+SET search_path = collate_tests;
+CREATE TEMP TABLE collate_weights_pairs AS
+  SELECT a.x AS x1, b.x AS x2, a.x < b.x AS lt
+  FROM collate_weights_test a, collate_weights_test b;
+
+-- Sorts use the weights whenever both strings are covered by them.
+SELECT count(*) AS mismatches
+FROM collate_weights_pairs p,
+     (SELECT x, row_number() OVER (ORDER BY x) AS r FROM collate_weights_test) r1,
+     (SELECT x, row_number() OVER (ORDER BY x) AS r FROM collate_weights_test) r2
+WHERE r1.x = p.x1 AND r2.x = p.x2 AND p.lt <> (r1.r < r2.r);
+
+-- Now that the sort has built them, the < operator uses them too.
+SELECT count(*) AS mismatches FROM collate_weights_pairs WHERE lt <> (x1 < x2);
+
+DROP TABLE collate_weights_test;
+
 
 -- cleanup
 SET client_min_messages TO warning;
@@ -0,0 +1,56 @@
+--
+-- Per-column TOAST compression methods
+--
+-- Only pglz is available in every build, so lz4 and zstd are not
+-- exercised here.
+--
+SET default_toast_compression = 'pglz';
+
+CREATE TABLE cmdata(f1 text COMPRESSION pglz);
+INSERT INTO cmdata VALUES(repeat('1234567890', 1000));
+INSERT INTO cmdata VALUES('short');
+SELECT attcompression FROM pg_attribute
+  WHERE attrelid = 'cmdata'::regclass AND attname = 'f1';
+SELECT length(f1), pg_column_compression(f1) IS NULL AS uncompressed
+  FROM cmdata ORDER BY 1;
+SELECT pg_column_compression(f1) FROM cmdata WHERE length(f1) > 5;
+
+-- revert to the default method
+ALTER TABLE cmdata ALTER COLUMN f1 SET COMPRESSION default;
+SELECT attcompression = '' AS is_default FROM pg_attribute
+  WHERE attrelid = 'cmdata'::regclass AND attname = 'f1';
+ALTER TABLE cmdata ALTER COLUMN f1 SET COMPRESSION pglz;
+
+-- errors
+CREATE TABLE cmbad(f1 text COMPRESSION I_do_not_exist);
+ALTER TABLE cmdata ALTER COLUMN f1 SET COMPRESSION I_do_not_exist;
+CREATE TABLE cmbad(f1 int COMPRESSION pglz);
+
+-- copied by LIKE only when asked for
+CREATE TABLE cmlike1 (LIKE cmdata);
+CREATE TABLE cmlike2 (LIKE cmdata INCLUDING COMPRESSION);
+SELECT attrelid::regclass, attcompression = '' AS is_default
+  FROM pg_attribute
+  WHERE attrelid IN ('cmlike1'::regclass, 'cmlike2'::regclass)
+    AND attname = 'f1'
+  ORDER BY 1;
+
+-- inherited from the parent, and from partitioned tables
+CREATE TABLE cminh () INHERITS (cmdata);
+CREATE TABLE cmpart(f1 text COMPRESSION pglz) PARTITION BY HASH(f1);
+CREATE TABLE cmpart1 PARTITION OF cmpart FOR VALUES WITH (MODULUS 1, REMAINDER 0);
+SELECT attrelid::regclass, attcompression FROM pg_attribute
+  WHERE attrelid IN ('cminh'::regclass, 'cmpart1'::regclass)
+    AND attname = 'f1'
+  ORDER BY 1;
+INSERT INTO cmpart VALUES(repeat('1234567890', 1000));
+SELECT pg_column_compression(f1) FROM cmpart1;
+
+-- compressed values survive a copy into a table with the default method
+CREATE TABLE cmdata2(f1 text);
+INSERT INTO cmdata2 SELECT f1 FROM cmdata;
+SELECT length(f1) FROM cmdata2 ORDER BY 1;
+SELECT f1 = repeat('1234567890', 1000) AS ok FROM cmdata2 WHERE length(f1) > 5;
+
+DROP TABLE cmdata, cminh, cmdata2, cmlike1, cmlike2, cmpart;
+RESET default_toast_compression;
@@ -66,6 +66,8 @@ COPY x from stdin (force_not_null (a), force_not_null (b));
 COPY x from stdin (force_null (a), force_null (b));
 COPY x from stdin (convert_selectively (a), convert_selectively (b));
 COPY x from stdin (encoding 'sql_ascii', encoding 'sql_ascii');
+COPY x from stdin (parallel 2, parallel 2);
+
 
 -- too many columns in column list: should fail
 COPY x (a, b, c, d, e, d, c) from stdin;
@@ -454,6 +456,28 @@ test1
 SELECT * FROM instead_of_insert_tbl;
 COMMIT;
 
+-- parallel COPY FROM
+CREATE TABLE parallel_copy_tbl (a int, b text);
+COPY parallel_copy_tbl FROM stdin (parallel 2);
+1	one
+2	two
+3	three
+\.
+COPY parallel_copy_tbl FROM stdin (format csv, header, parallel 2);
+a,b
+4,"four
+and more"
+5,five
+\.
+SELECT * FROM parallel_copy_tbl ORDER BY a;
+
+-- parallel COPY TO; a single-page table comes out in a predictable order
+CREATE TABLE parallel_copy_to_tbl (a int, b text);
+INSERT INTO parallel_copy_to_tbl VALUES (1, 'one'), (2, NULL), (3, 'three, "quoted"');
+COPY parallel_copy_to_tbl TO stdout (parallel 2);
+COPY parallel_copy_to_tbl (b, a) TO stdout (format csv, header, parallel 2);
+COPY (SELECT a FROM parallel_copy_to_tbl WHERE a = 1) TO stdout (parallel 2);
+
 -- clean up
 DROP TABLE forcetest;
 DROP TABLE vistest;
@@ -468,3 +492,5 @@ DROP TABLE instead_of_insert_tbl;
 DROP VIEW instead_of_insert_tbl_view;
 DROP VIEW instead_of_insert_tbl_view_2;
 DROP FUNCTION fun_instead_of_insert_tbl();
+DROP TABLE parallel_copy_tbl;
+DROP TABLE parallel_copy_to_tbl;
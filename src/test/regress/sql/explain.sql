@@ -105,3 +105,33 @@ select jsonb_pretty(
 );
 
 rollback;
+
+--
+-- Test division of query_work_mem among the plan nodes
+--
+set work_mem = '4MB';
+set query_work_mem = '1MB';
+set enable_mergejoin = off;
+set enable_nestloop = off;
+
+-- a Sort and a Hash share the budget
+explain (costs off)
+select a.ten, b.ten from tenk1 a join onek b on a.unique1 = b.unique1
+order by a.ten, b.ten;
+
+-- below a Gather, each participant gets its own share
+begin isolation level repeatable read;
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set min_parallel_table_scan_size = 0;
+set max_parallel_workers_per_gather = 2;
+
+explain (costs off)
+select sum(a.ten + b.ten) from tenk1 a join onek b on a.unique1 = b.unique1;
+
+rollback;
+
+reset work_mem;
+reset query_work_mem;
+reset enable_mergejoin;
+reset enable_nestloop;
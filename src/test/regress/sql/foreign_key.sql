@@ -1738,3 +1738,45 @@ DELETE FROM fkpart9.pk WHERE a=35;
 SELECT * FROM fkpart9.pk;
 SELECT * FROM fkpart9.fk;
 DROP SCHEMA fkpart9 CASCADE;
+
+-- batched foreign key checks
+CREATE TABLE fkb_pk (a int PRIMARY KEY, b text UNIQUE);
+CREATE TABLE fkb_fk (x int REFERENCES fkb_pk, y text REFERENCES fkb_pk (b));
+INSERT INTO fkb_pk SELECT i, i::text FROM generate_series(1, 100) i;
+SET foreign_key_check_batch_size = 10;
+INSERT INTO fkb_fk SELECT i % 100 + 1, (i % 50 + 1)::text
+  FROM generate_series(1, 1000) i;
+SELECT count(*) FROM fkb_fk;
+INSERT INTO fkb_fk SELECT i, i::text FROM generate_series(95, 105) i;
+UPDATE fkb_fk SET y = '1000' WHERE x = 1;
+UPDATE fkb_fk SET y = '99' WHERE x = 1;
+SELECT count(*) FROM fkb_fk WHERE y = '99';
+-- checks on the referenced side are unaffected
+DELETE FROM fkb_pk WHERE a = 1;
+-- deferred constraints are checked at commit
+ALTER TABLE fkb_fk ALTER CONSTRAINT fkb_fk_x_fkey DEFERRABLE INITIALLY DEFERRED;
+BEGIN;
+INSERT INTO fkb_fk VALUES (200, '1');
+INSERT INTO fkb_pk VALUES (200, '200');
+COMMIT;
+BEGIN;
+INSERT INTO fkb_fk VALUES (300, '1');
+COMMIT;
+RESET foreign_key_check_batch_size;
+DROP TABLE fkb_fk, fkb_pk;
+
+-- Deferred checks still work when the trigger event queue is spilled to disk
+CREATE TABLE fkspill_pk (a int PRIMARY KEY);
+CREATE TABLE fkspill_fk (a int REFERENCES fkspill_pk DEFERRABLE INITIALLY DEFERRED);
+INSERT INTO fkspill_pk SELECT generate_series(1, 5000);
+SET after_trigger_queue_mem = 0;
+BEGIN;
+INSERT INTO fkspill_fk SELECT generate_series(1, 5000);
+UPDATE fkspill_fk SET a = a + 1 WHERE a % 1000 = 1;
+COMMIT;
+SELECT count(*), sum(a) FROM fkspill_fk;
+BEGIN;
+INSERT INTO fkspill_fk SELECT generate_series(1, 5001);
+COMMIT;
+RESET after_trigger_queue_mem;
+DROP TABLE fkspill_fk, fkspill_pk;
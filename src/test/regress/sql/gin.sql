@@ -171,3 +171,25 @@ reset enable_seqscan;
 reset enable_bitmapscan;
 
 drop table t_gin_test_tbl;
+
+-- test parallel index build
+create table t_gin_parallel_tbl(i int4, j int4[]) with (parallel_workers = 2);
+insert into t_gin_parallel_tbl
+  select g, array[g % 100, 1000 + g % 7] from generate_series(1, 20000) g;
+set max_parallel_maintenance_workers = 2;
+set maintenance_work_mem = '1MB';
+create index t_gin_parallel_tbl_j_idx on t_gin_parallel_tbl using gin(j);
+reset maintenance_work_mem;
+reset max_parallel_maintenance_workers;
+
+set enable_seqscan = off;
+set enable_bitmapscan = on;
+
+select count(*) from t_gin_parallel_tbl where j @> array[50];
+select count(*) from t_gin_parallel_tbl where j @> array[50, 1003];
+select count(*) from t_gin_parallel_tbl where j @> array[1000];
+
+reset enable_seqscan;
+reset enable_bitmapscan;
+
+drop table t_gin_parallel_tbl;
@@ -148,3 +148,21 @@ reset enable_bitmapscan;
 reset enable_indexonlyscan;
 
 drop table gist_tbl;
+
+-- Test parallel build, using an opclass without sortsupport
+create table gist_parallel_tbl (b box) with (parallel_workers = 2);
+insert into gist_parallel_tbl
+  select box(point(i % 100, i / 100), point(i % 100 + 0.5, i / 100 + 0.5))
+  from generate_series(0, 19999) as i;
+set max_parallel_maintenance_workers = 2;
+create index gist_parallel_tbl_idx on gist_parallel_tbl using gist (b);
+reset max_parallel_maintenance_workers;
+
+set enable_seqscan = off;
+select count(*) from gist_parallel_tbl
+where b <@ box(point(10, 10), point(20, 20));
+select count(*) from gist_parallel_tbl
+where b && box(point(0, 150), point(99.5, 199.5));
+reset enable_seqscan;
+
+drop table gist_parallel_tbl;
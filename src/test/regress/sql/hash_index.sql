@@ -197,6 +197,21 @@ INSERT INTO hash_heap_float4 VALUES (1.1,1);
 CREATE INDEX hash_idx ON hash_heap_float4 USING hash (x);
 DROP TABLE hash_heap_float4 CASCADE;
 
+-- Parallel build; the leader merges the workers' sorted runs.
+CREATE TABLE hash_parallel_heap (keycol int) WITH (parallel_workers = 2);
+INSERT INTO hash_parallel_heap SELECT a % 1000 FROM generate_series(1, 20000) a;
+SET max_parallel_maintenance_workers = 2;
+CREATE INDEX hash_parallel_index ON hash_parallel_heap USING hash (keycol);
+RESET max_parallel_maintenance_workers;
+
+SET enable_seqscan = OFF;
+SET enable_bitmapscan = OFF;
+SELECT count(*) FROM hash_parallel_heap WHERE keycol = 42;
+SELECT count(*) FROM hash_parallel_heap WHERE keycol = 1000;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE hash_parallel_heap;
+
 -- Test out-of-range fillfactor values
 CREATE INDEX hash_f8_index2 ON hash_f8_heap USING hash (random float8_ops)
 	WITH (fillfactor=9);
@@ -202,6 +202,25 @@ $$
 $$);
 rollback to settings;
 
+-- non-parallel, with compressed batch files
+savepoint settings;
+set local max_parallel_workers_per_gather = 0;
+set local work_mem = '128kB';
+set local temp_file_compression = pglz;
+select count(*), sum(r.id + s.id) from simple r join simple s using (id);
+select original > 1 as initially_multibatch, final > original as increased_batches
+  from hash_join_batches(
+$$
+  select count(*), sum(r.id + s.id) from simple r join simple s using (id);
+$$);
+select count(*), sum(r.id + s.id) FROM simple r JOIN bigger_than_it_looks s USING (id);
+select original > 1 as initially_multibatch, final > original as increased_batches
+  from hash_join_batches(
+$$
+  select count(*), sum(r.id + s.id) FROM simple r JOIN bigger_than_it_looks s USING (id);
+$$);
+rollback to settings;
+
 -- parallel with parallel-oblivious hash join
 savepoint settings;
 set local max_parallel_workers_per_gather = 2;
@@ -418,7 +437,16 @@ explain (costs off)
 select  count(*) from simple r full outer join simple s using (id);
 rollback to settings;
 
--- parallelism not possible with parallel-oblivious outer hash join
+-- parallelism not possible with parallel-oblivious full hash join
+savepoint settings;
+set enable_parallel_hash = off;
+set local max_parallel_workers_per_gather = 2;
+explain (costs off)
+     select  count(*) from simple r full outer join simple s using (id);
+select  count(*) from simple r full outer join simple s using (id);
+rollback to settings;
+
+-- parallelism is possible with parallel-aware full hash join
 savepoint settings;
 set local max_parallel_workers_per_gather = 2;
 explain (costs off)
@@ -436,7 +464,16 @@ explain (costs off)
 select  count(*) from simple r full outer join simple s on (r.id = 0 - s.id);
 rollback to settings;
 
--- parallelism not possible with parallel-oblivious outer hash join
+-- parallelism not possible with parallel-oblivious full hash join
+savepoint settings;
+set enable_parallel_hash = off;
+set local max_parallel_workers_per_gather = 2;
+explain (costs off)
+     select  count(*) from simple r full outer join simple s on (r.id = 0 - s.id);
+select  count(*) from simple r full outer join simple s on (r.id = 0 - s.id);
+rollback to settings;
+
+-- parallelism is possible with parallel-aware full hash join
 savepoint settings;
 set local max_parallel_workers_per_gather = 2;
 explain (costs off)
@@ -538,3 +575,30 @@ WHERE
     AND hjtest_1.a <> hjtest_2.b;
 
 ROLLBACK;
+
+-- Hash joins with a selective inner side discard outer rows that can't
+-- match using a Bloom filter of the inner hash values
+BEGIN;
+SET LOCAL enable_nestloop = off;
+SET LOCAL enable_mergejoin = off;
+SET LOCAL max_parallel_workers_per_gather = 0;
+-- the hash table's memory usage varies between platforms, so hide it
+CREATE FUNCTION explain_bloom(query text) RETURNS SETOF text
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    ln text;
+BEGIN
+    FOR ln IN
+        EXECUTE 'EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF) ' || query
+    LOOP
+        CONTINUE WHEN ln ~ 'Memory Usage';
+        RETURN NEXT ln;
+    END LOOP;
+END;
+$$;
+SELECT explain_bloom('SELECT * FROM tenk1 a JOIN onek b ON a.unique1 = b.unique1 WHERE b.unique1 < 10');
+SELECT count(*) FROM tenk1 a JOIN onek b ON a.unique1 = b.unique1 WHERE b.unique1 < 10;
+SET LOCAL enable_hashjoin_bloom_filter = off;
+SELECT explain_bloom('SELECT * FROM tenk1 a JOIN onek b ON a.unique1 = b.unique1 WHERE b.unique1 < 10');
+ROLLBACK;
@@ -1280,3 +1280,18 @@ select '12345.0000000000000000000000000000000000000000000005'::jsonb::float8;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int2;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int4;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int8;
+
+-- field extraction from large toasted objects, which detoasts them piecemeal
+create temp table test_jsonb_large (j jsonb);
+alter table test_jsonb_large alter column j set storage external;
+insert into test_jsonb_large
+  select jsonb_object_agg('k' || i, jsonb_build_object('n', i))
+  from generate_series(1, 5000) i;
+insert into test_jsonb_large values ('[1, 2, 3]');
+select j -> 'k1', j ->> 'k2500', j -> 'k5000' -> 'n', j -> 'k5001', j ->> 'n'
+  from test_jsonb_large order by jsonb_typeof(j);
+alter table test_jsonb_large alter column j set storage extended;
+update test_jsonb_large set j = j || '{}' where jsonb_typeof(j) = 'object';
+select j -> 'k1', j ->> 'k2500', j -> 'k5000' -> 'n', j -> 'k5001', j ->> 'n'
+  from test_jsonb_large order by jsonb_typeof(j);
+drop table test_jsonb_large;
@@ -331,3 +331,22 @@ RESET parallel_setup_cost;
 EXPLAIN (COSTS OFF)
 SELECT x, sum(y), avg(y), count(*) FROM pagg_tab_para GROUP BY x HAVING avg(y) < 7 ORDER BY 1, 2, 3;
 SELECT x, sum(y), avg(y), count(*) FROM pagg_tab_para GROUP BY x HAVING avg(y) < 7 ORDER BY 1, 2, 3;
+
+-- Test partitionwise parallel window functions: each worker gets whole
+-- partitions, so the windows can be computed below the Gather Merge.
+SET enable_partitionwise_window TO true;
+SET parallel_setup_cost TO 0;
+SET parallel_tuple_cost TO 0;
+
+EXPLAIN (COSTS OFF)
+SELECT x, y, row_number() OVER (PARTITION BY x ORDER BY y) FROM pagg_tab_para;
+SELECT count(*), sum(rn), count(*) FILTER (WHERE rn = 1) FROM
+  (SELECT row_number() OVER (PARTITION BY x ORDER BY y) rn FROM pagg_tab_para) s;
+
+-- Not possible when a window doesn't partition by the partition key
+EXPLAIN (COSTS OFF)
+SELECT x, y, row_number() OVER (PARTITION BY y ORDER BY x) FROM pagg_tab_para;
+
+RESET enable_partitionwise_window;
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
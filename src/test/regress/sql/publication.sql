@@ -93,6 +93,53 @@ ALTER PUBLICATION testpub_forparted SET (publish_via_partition_root = true);
 DROP TABLE testpub_parted1;
 DROP PUBLICATION testpub_forparted, testpub_forparted1;
 
+-- Tests for row filters
+CREATE TABLE testpub_rf_tbl1 (a integer, b text);
+CREATE TABLE testpub_rf_tbl2 (c text, d integer);
+ALTER TABLE testpub_rf_tbl1 REPLICA IDENTITY FULL;
+ALTER TABLE testpub_rf_tbl2 REPLICA IDENTITY FULL;
+CREATE FUNCTION testpub_rf_func(integer) RETURNS integer AS $$ SELECT $1 $$ LANGUAGE sql IMMUTABLE;
+SET client_min_messages = 'ERROR';
+CREATE PUBLICATION testpub_rf FOR TABLE testpub_rf_tbl1 WHERE (a > 1 AND b <> 'x'), testpub_rf_tbl2;
+RESET client_min_messages;
+\dRp+ testpub_rf
+ALTER PUBLICATION testpub_rf SET TABLE testpub_rf_tbl1, testpub_rf_tbl2 WHERE (d % 2 = 0);
+\dRp+ testpub_rf
+ALTER PUBLICATION testpub_rf DROP TABLE testpub_rf_tbl2;
+ALTER PUBLICATION testpub_rf ADD TABLE testpub_rf_tbl2 WHERE (c LIKE 'abc%');
+\dRp+ testpub_rf
+-- fail - WHERE clause must be boolean
+ALTER PUBLICATION testpub_rf SET TABLE testpub_rf_tbl1 WHERE (a + 1);
+-- fail - no aggregates, subqueries, system columns, mutable or user-defined functions
+ALTER PUBLICATION testpub_rf SET TABLE testpub_rf_tbl1 WHERE (sum(a) > 1);
+ALTER PUBLICATION testpub_rf SET TABLE testpub_rf_tbl1 WHERE (a IN (SELECT 1));
+ALTER PUBLICATION testpub_rf SET TABLE testpub_rf_tbl1 WHERE (ctid IS NOT NULL);
+ALTER PUBLICATION testpub_rf SET TABLE testpub_rf_tbl1 WHERE (a < random());
+ALTER PUBLICATION testpub_rf SET TABLE testpub_rf_tbl1 WHERE (testpub_rf_func(a) > 1);
+-- fail - conflicting WHERE clauses
+ALTER PUBLICATION testpub_rf SET TABLE testpub_rf_tbl1, testpub_rf_tbl1 WHERE (a > 2);
+-- fail - the WHERE clause depends on the columns
+ALTER TABLE testpub_rf_tbl2 DROP COLUMN c;
+ALTER TABLE testpub_rf_tbl2 ALTER COLUMN c TYPE varchar;
+DROP TABLE testpub_rf_tbl1, testpub_rf_tbl2;
+DROP FUNCTION testpub_rf_func(integer);
+DROP PUBLICATION testpub_rf;
+-- publications of updates or deletes can only filter on replica identity
+CREATE TABLE testpub_rf_tbl3 (a integer PRIMARY KEY, b integer);
+SET client_min_messages = 'ERROR';
+-- fail - b is not part of the replica identity
+CREATE PUBLICATION testpub_rf_ri FOR TABLE testpub_rf_tbl3 WHERE (b > 1);
+CREATE PUBLICATION testpub_rf_ri FOR TABLE testpub_rf_tbl3 WHERE (b > 1) WITH (publish = 'insert');
+RESET client_min_messages;
+-- fail - the existing filter uses b
+ALTER PUBLICATION testpub_rf_ri SET (publish = 'insert, delete');
+ALTER PUBLICATION testpub_rf_ri SET TABLE testpub_rf_tbl3 WHERE (a > 1);
+ALTER PUBLICATION testpub_rf_ri SET (publish = 'insert, update, delete');
+-- fail - b is not part of the replica identity
+ALTER PUBLICATION testpub_rf_ri SET TABLE testpub_rf_tbl3 WHERE (a > 1 AND b > 1);
+DROP PUBLICATION testpub_rf_ri;
+DROP TABLE testpub_rf_tbl3;
+
 -- fail - view
 CREATE PUBLICATION testpub_fortbl FOR TABLE testpub_view;
 SET client_min_messages = 'ERROR';
@@ -135,6 +135,13 @@ select 'a' ~ '.. ()|\1';
 select 'a' ~ '()*\1';
 select 'a' ~ '()+\1';
 
+-- Test required-literal prefiltering, with a small cache
+set regex_cache_size = 2;
+select x, x ~ 'ab+c\.d' as m1, x ~ 'a(x|y)*bc' as m2, x ~ 'bc?d' as m3,
+       x ~ 'bc|zz' as m4, x ~ '***=c.d' as m5
+  from (values ('abbc.d'), ('abcd'), ('zz'), ('axybc')) v(x);
+reset regex_cache_size;
+
 -- Error conditions
 select 'xyz' ~ 'x(\w)(?=\1)';  -- no backrefs in LACONs
 select 'xyz' ~ 'x(\w)(?=(\1))';
@@ -0,0 +1,104 @@
+-- Perform tests on the Result Cache node.
+
+-- Memory usage, heap fetches and loop counts can vary between machines, and
+-- so can the hit and miss counts once entries get evicted.  Replace them by
+-- 'N', except that no evictions are shown as 'Zero', so that we can tell
+-- whether there were any.
+create function explain_resultcache(query text, hide_hitmiss bool) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, summary off, timing off) %s',
+            query)
+    loop
+        if hide_hitmiss = true then
+                ln := regexp_replace(ln, 'Hits: \d+', 'Hits: N');
+                ln := regexp_replace(ln, 'Misses: \d+', 'Misses: N');
+        end if;
+        ln := regexp_replace(ln, 'Evictions: 0', 'Evictions: Zero');
+        ln := regexp_replace(ln, 'Evictions: \d+', 'Evictions: N');
+        ln := regexp_replace(ln, 'Memory Usage: \d+', 'Memory Usage: N');
+        ln := regexp_replace(ln, 'Heap Fetches: \d+', 'Heap Fetches: N');
+        ln := regexp_replace(ln, 'loops=\d+', 'loops=N');
+        return next ln;
+    end loop;
+end;
+$$;
+
+-- Result Cache is off by default
+SET enable_resultcache TO on;
+SET enable_hashjoin TO off;
+SET enable_mergejoin TO off;
+SET enable_bitmapscan TO off;
+
+-- Test Result Cache with a unique inner side, which is marked complete after
+-- its first row.
+SELECT explain_resultcache('
+SELECT COUNT(*), SUM(t1.unique1) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.unique1 = t2.twenty
+WHERE t2.unique1 < 1000;', false);
+
+-- And check we get the expected results.
+SELECT COUNT(*), SUM(t1.unique1) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.unique1 = t2.twenty
+WHERE t2.unique1 < 1000;
+
+-- Semi and anti joins only read the first matching row too.
+SELECT explain_resultcache('
+SELECT COUNT(*) FROM tenk1 t2
+WHERE t2.unique1 < 1000 AND
+  EXISTS (SELECT 1 FROM tenk1 t1 WHERE t1.hundred = t2.twenty);', false);
+
+SELECT COUNT(*) FROM tenk1 t2
+WHERE t2.unique1 < 1000 AND
+  EXISTS (SELECT 1 FROM tenk1 t1 WHERE t1.hundred = t2.twenty);
+
+SELECT explain_resultcache('
+SELECT COUNT(*) FROM tenk1 t2
+WHERE t2.unique1 < 1000 AND
+  NOT EXISTS (SELECT 1 FROM tenk1 t1 WHERE t1.hundred = t2.twenty * 6);', false);
+
+SELECT COUNT(*) FROM tenk1 t2
+WHERE t2.unique1 < 1000 AND
+  NOT EXISTS (SELECT 1 FROM tenk1 t1 WHERE t1.hundred = t2.twenty * 6);
+
+-- Reduce work_mem so that we see some cache evictions
+SET work_mem TO '64kB';
+SELECT explain_resultcache('
+SELECT COUNT(*), SUM(t1.hundred) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.hundred = t2.twenty
+WHERE t2.unique1 < 1000;', true);
+
+SELECT COUNT(*), SUM(t1.hundred) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.hundred = t2.twenty
+WHERE t2.unique1 < 1000;
+RESET work_mem;
+
+-- The same queries give the same results without the cache
+SET enable_resultcache TO off;
+
+SELECT COUNT(*), SUM(t1.unique1) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.unique1 = t2.twenty
+WHERE t2.unique1 < 1000;
+
+SELECT COUNT(*) FROM tenk1 t2
+WHERE t2.unique1 < 1000 AND
+  EXISTS (SELECT 1 FROM tenk1 t1 WHERE t1.hundred = t2.twenty);
+
+SELECT COUNT(*) FROM tenk1 t2
+WHERE t2.unique1 < 1000 AND
+  NOT EXISTS (SELECT 1 FROM tenk1 t1 WHERE t1.hundred = t2.twenty * 6);
+
+SELECT COUNT(*), SUM(t1.hundred) FROM tenk1 t1
+INNER JOIN tenk1 t2 ON t1.hundred = t2.twenty
+WHERE t2.unique1 < 1000;
+
+RESET enable_resultcache;
+RESET enable_hashjoin;
+RESET enable_mergejoin;
+RESET enable_bitmapscan;
+
+DROP FUNCTION explain_resultcache(text, bool);
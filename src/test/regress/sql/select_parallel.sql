@@ -136,6 +136,15 @@ reset enable_indexonlyscan;
 reset enable_bitmapscan;
 alter table tenk2 reset (parallel_workers);
 
+-- test parallel scan of a materialized CTE
+alter table tenk2 set (parallel_workers = 0);
+explain (costs off)
+	with t2 as materialized (select * from tenk2)
+	select count(*) from t2 where t2.unique1 > 100;
+with t2 as materialized (select * from tenk2)
+	select count(*) from t2 where t2.unique1 > 100;
+alter table tenk2 reset (parallel_workers);
+
 -- test parallel index scans.
 set enable_seqscan to off;
 set enable_bitmapscan to off;
@@ -345,6 +354,19 @@ select string4 from tenk1 order by string4 limit 5;
 reset parallel_leader_participation;
 reset max_parallel_workers;
 
+-- parallel sort, whose output is gathered in order without merging
+set enable_parallel_sort = on;
+set enable_gathermerge = off;
+explain (costs off)
+   select string4, ten from tenk1 order by string4, ten;
+select count(*) from
+  (select string4, ten,
+          lag(string4) over () as prev4, lag(ten) over () as prevten
+   from (select string4, ten from tenk1 order by string4, ten) ss) s
+  where (prev4, prevten) > (string4, ten);
+reset enable_gathermerge;
+reset enable_parallel_sort;
+
 SAVEPOINT settings;
 SET LOCAL force_parallel_mode = 1;
 explain (costs off)
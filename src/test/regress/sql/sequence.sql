@@ -406,3 +406,21 @@ SELECT nextval('test_seq1');
 SELECT nextval('test_seq1');
 
 DROP SEQUENCE test_seq1;
+
+-- shared cache tests
+CREATE SEQUENCE test_seq2 INCREMENT BY 2 MAXVALUE 30;
+SET shared_sequence_cache = 5;
+SELECT nextval('test_seq2') FROM generate_series(1, 12);
+SELECT last_value, is_called FROM test_seq2;
+-- setval must discard the rest of the shared range
+SELECT setval('test_seq2', 10);
+SELECT nextval('test_seq2');
+SELECT nextval('test_seq2');
+SELECT currval('test_seq2');
+-- and so must ALTER SEQUENCE
+ALTER SEQUENCE test_seq2 RESTART;
+SELECT nextval('test_seq2');
+RESET shared_sequence_cache;
+SELECT nextval('test_seq2');
+
+DROP SEQUENCE test_seq2;
@@ -434,6 +434,12 @@ SELECT substr(f1, 99995) from toasttest;
 -- string length
 SELECT substr(f1, 99995, 10) from toasttest;
 
+-- LIKE looks at a prefix of a toasted string before detoasting all of it
+SELECT f1 LIKE '12345%' AS prefix, f1 LIKE '1234567890%90' AS prefix_suffix,
+       f1 LIKE '12346%' AS mismatch, f1 NOT LIKE '123%' AS not_prefix,
+       f1 LIKE '%890' AS suffix, f1 LIKE '1_3%890' AS wildcard
+  FROM toasttest;
+
 TRUNCATE TABLE toasttest;
 INSERT INTO toasttest values (repeat('1234567890',300));
 INSERT INTO toasttest values (repeat('1234567890',300));
@@ -17,6 +17,10 @@ select count(*) >= 0 as ok from pg_available_extensions;
 select name, ident, parent, level, total_bytes >= free_bytes
   from pg_backend_memory_contexts where level = 0;
 
+-- Likewise, only the shape of pg_backend_cache_stats is stable.
+select cache, entries > 0 as has_entries, total_bytes is not null as has_bytes
+  from pg_backend_cache_stats order by cache;
+
 -- At introduction, pg_config had 23 entries; it may grow
 select count(*) > 20 as ok from pg_config;
 
@@ -40,6 +44,27 @@ select count(*) >= 0 as ok from pg_prepared_xacts;
 -- There must be only one record
 select count(*) = 1 as ok from pg_stat_wal;
 
+-- Full page images are part of the records they're counted in
+select count(*) filter (where fpi_bytes > bytes or records = 0) = 0 as ok
+  from pg_stat_wal_records;
+
+-- LWLock usage is tracked for every builtin tranche, plus one extension row
+select count(*) > 1 as ok, sum(acquisitions) > 0 as ok2,
+       count(*) filter (where tranche = 'extension') = 1 as ok3
+  from pg_stat_lwlock;
+
+-- I/O on temp objects is only ever reported in the normal context
+select count(*) = 6 as ok,
+       count(*) filter (where object <> 'relation') = 2 as ok2
+  from pg_stat_io where backend_type = 'client backend';
+
+-- The wait event sampler is off by default, but the views must work anyway
+select count(*) >= 0 as ok from pg_stat_wait_samples;
+select count(*) >= 0 as ok from pg_stat_wait_profile;
+
+-- There is one row per synchronous replication level.
+select count(*) = 3 as ok from pg_stat_sync_replication;
+
 -- This is to record the prevailing planner enable_foo settings during
 -- a regression test run.
 select name, setting from pg_settings where name like 'enable%';
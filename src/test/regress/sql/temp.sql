@@ -295,3 +295,28 @@ SET search_path TO 'pg_temp';
 BEGIN;
 SELECT current_schema() ~ 'pg_temp' AS is_temp_schema;
 PREPARE TRANSACTION 'twophase_search';
+
+-- Global temporary tables: the definition is shared, the contents are not
+RESET search_path;
+create global temp table gtt (a int primary key, b text);
+select relname, relpersistence from pg_class
+  where relname in ('gtt', 'gtt_pkey') order by relname;
+insert into gtt values (1, 'one'), (2, 'two');
+select * from gtt order by a;
+insert into gtt values (1, 'dup');
+truncate gtt;
+select count(*) from gtt;
+insert into gtt values (3, 'three');
+-- a new session starts out with the table empty
+\c -
+select * from gtt;
+insert into gtt values (1, 'again');
+select * from gtt where a = 1;
+discard temp;
+select count(*) from gtt;
+-- unsupported operations
+create global temp table gtt_bad (a int) on commit delete rows;
+create global temp table gtt_bad () inherits (gtt);
+alter table gtt alter column a type bigint;
+vacuum full gtt;
+drop table gtt;
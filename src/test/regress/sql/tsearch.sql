@@ -249,6 +249,54 @@ EXPLAIN (COSTS OFF)
 SELECT count(*) FROM test_tsvector WHERE a @@ 'wr' AND a @@ '!qh';
 SELECT count(*) FROM test_tsvector WHERE a @@ 'wr' AND a @@ '!qh';
 
+-- Test phrase parameter of GIN tsvector_ops
+DROP INDEX wowidx;
+CREATE INDEX wowidx ON test_tsvector USING gin (a tsvector_ops(phrase=true));
+
+SELECT count(*) FROM test_tsvector WHERE a @@ 'pl <-> yh';
+SELECT count(*) FROM test_tsvector WHERE a @@ 'yh <-> pl';
+SELECT count(*) FROM test_tsvector WHERE a @@ 'qe <2> qt';
+SELECT count(*) FROM test_tsvector WHERE a @@ '!pl <-> yh';
+SELECT count(*) FROM test_tsvector WHERE a @@ '!pl <-> !yh';
+SELECT count(*) FROM test_tsvector WHERE a @@ '!yh <-> pl';
+SELECT count(*) FROM test_tsvector WHERE a @@ '!qe <2> qt';
+SELECT count(*) FROM test_tsvector WHERE a @@ '!(pl <-> yh)';
+SELECT count(*) FROM test_tsvector WHERE a @@ '!(yh <-> pl)';
+SELECT count(*) FROM test_tsvector WHERE a @@ '!(qe <2> qt)';
+
+CREATE TABLE test_tsvector_phrase (id int, a tsvector);
+INSERT INTO test_tsvector_phrase VALUES
+  (1, 'a:1 b:2 c:3'),
+  (2, 'a:1 c:2 b:3'),
+  (3, 'a:1,5 b:3,6 c:7'),
+  (4, 'a b c'),
+  (5, 'a:1 x:1 b:2 c:3'),
+  (6, 'b:1 a:2'),
+  (7, 'a:1A b:2 c:3');
+CREATE INDEX ON test_tsvector_phrase USING gin (a tsvector_ops(phrase=true));
+
+EXPLAIN (COSTS OFF)
+SELECT id FROM test_tsvector_phrase WHERE a @@ 'a <-> b';
+SELECT q, array(SELECT id FROM test_tsvector_phrase
+                WHERE a @@ q::tsquery ORDER BY id) AS ids
+FROM (VALUES
+  ('a <-> b'),
+  ('b <-> a'),
+  ('b <-> c'),
+  ('c <-> b'),
+  ('a <-> c'),
+  ('x <-> b'),
+  ('a <-> a'),
+  ('a <-> b <-> c'),
+  ('a <2> b'),
+  ('a:A <-> b'),
+  ('a:* <-> b'),
+  ('!(a <-> b)'),
+  ('(a <-> b) & c'),
+  ('a <-> b | b <-> a')) v(q);
+
+DROP TABLE test_tsvector_phrase;
+
 RESET enable_seqscan;
 
 INSERT INTO test_tsvector VALUES ('???', 'DFG:1A,2B,6C,10 FGH');
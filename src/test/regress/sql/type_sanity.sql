@@ -366,7 +366,7 @@ ORDER BY 1;
 SELECT p1.oid, p1.relname
 FROM pg_class as p1
 WHERE relkind NOT IN ('r', 'i', 'S', 't', 'v', 'm', 'c', 'f', 'p') OR
-    relpersistence NOT IN ('p', 'u', 't') OR
+    relpersistence NOT IN ('p', 'u', 't', 'g') OR
     relreplident NOT IN ('d', 'n', 'f', 'i');
 
 -- All tables and indexes should have an access method.
@@ -93,6 +93,13 @@ VACUUM (PARALLEL 2) pvactst;
 UPDATE pvactst SET i = i WHERE i < 1000;
 VACUUM (PARALLEL 2) pvactst;
 
+-- VACUUM scans and vacuums the heap in parallel
+SET min_parallel_table_scan_size to 0;
+UPDATE pvactst SET i = i WHERE i < 1000;
+VACUUM (PARALLEL 2) pvactst;
+VACUUM (PARALLEL 2, DISABLE_PAGE_SKIPPING) pvactst;
+RESET min_parallel_table_scan_size;
+
 UPDATE pvactst SET i = i WHERE i < 1000;
 VACUUM (PARALLEL 0) pvactst; -- disable parallel vacuum
 
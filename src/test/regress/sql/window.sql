@@ -960,6 +960,54 @@ SELECT * FROM
    FROM empsalary) emp
 WHERE first_emp = 1 OR last_emp = 1;
 
+-- Test that quals on monotonic window functions become run conditions
+EXPLAIN (COSTS OFF)
+SELECT * FROM
+  (SELECT empno,
+          row_number() OVER (ORDER BY empno) rn
+   FROM empsalary) emp
+WHERE rn < 3;
+
+SELECT * FROM
+  (SELECT empno,
+          row_number() OVER (ORDER BY empno) rn
+   FROM empsalary) emp
+WHERE rn < 3;
+
+-- an equality qual can't be used directly, but implies one that can
+EXPLAIN (COSTS OFF)
+SELECT * FROM
+  (SELECT depname,
+          empno,
+          rank() OVER (PARTITION BY depname ORDER BY salary DESC) r
+   FROM empsalary) emp
+WHERE r = 1;
+
+SELECT * FROM
+  (SELECT depname,
+          empno,
+          salary,
+          rank() OVER (PARTITION BY depname ORDER BY salary DESC) r
+   FROM empsalary) emp
+WHERE r <= 2
+ORDER BY depname, r, empno;
+
+-- other window aggregates must still see every row
+SELECT * FROM
+  (SELECT empno,
+          row_number() OVER (ORDER BY empno) rn,
+          count(*) OVER () c
+   FROM empsalary) emp
+WHERE rn <= 3;
+
+-- no run condition for a function that isn't monotonic
+EXPLAIN (COSTS OFF)
+SELECT * FROM
+  (SELECT empno,
+          lag(empno) OVER (ORDER BY empno) prev
+   FROM empsalary) emp
+WHERE prev < 3;
+
 -- cleanup
 DROP TABLE empsalary;
 
@@ -4,7 +4,7 @@ use strict;
 use warnings;
 use PostgresNode;
 use TestLib;
-use Test::More tests => 5;
+use Test::More tests => 6;
 
 # Create and initialize a publisher node
 my $node_publisher = get_new_node('publisher');
@@ -28,11 +28,22 @@ my $ddl = qq(
 		a INTEGER[] PRIMARY KEY,
 		b NUMERIC[],
 		c TEXT[]
+		);
+	CREATE TABLE public.test_initial (
+		a INTEGER PRIMARY KEY,
+		b NUMERIC[],
+		c TEXT
 		););
 
 $node_publisher->safe_psql('postgres', $ddl);
 $node_subscriber->safe_psql('postgres', $ddl);
 
+# Data that exists before the subscription is created goes through the
+# initial table synchronization, which uses binary COPY
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO public.test_initial VALUES (1, '{1.1, 1.2}', 'one'), (2, NULL, NULL)"
+);
+
 # Configure logical replication
 $node_publisher->safe_psql('postgres',
 	"CREATE PUBLICATION tpub FOR ALL TABLES");
@@ -48,6 +59,12 @@ $node_subscriber->poll_query_until('postgres',
 	"SELECT count(1) = 0 FROM pg_subscription_rel WHERE srsubstate NOT IN ('s', 'r');"
 ) or die "Timed out while waiting for subscriber to synchronize data";
 
+my $result = $node_subscriber->safe_psql('postgres',
+	"SELECT a, b, c FROM test_initial ORDER BY a");
+
+is( $result, '1|{1.1,1.2}|one
+2||', 'check initial data was copied in binary format');
+
 # Insert some content and make sure it's replicated across
 $node_publisher->safe_psql(
 	'postgres', qq(
@@ -63,7 +80,7 @@ $node_publisher->safe_psql(
 
 $node_publisher->wait_for_catchup('tsub');
 
-my $result = $node_subscriber->safe_psql('postgres',
+$result = $node_subscriber->safe_psql('postgres',
 	"SELECT a, b, c, d FROM test_numerical ORDER BY a");
 
 is( $result, '1|1.2|1.3|10
@@ -0,0 +1,110 @@
+# Test publication row filters
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 6;
+
+# Create and initialize a publisher node
+my $node_publisher = get_new_node('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->start;
+
+# Create and initialize subscriber node
+my $node_subscriber = get_new_node('subscriber');
+$node_subscriber->init(allows_streaming => 'logical');
+$node_subscriber->start;
+
+my $ddl = qq(
+	CREATE TABLE tab_rf (a int PRIMARY KEY, b text);
+	ALTER TABLE tab_rf REPLICA IDENTITY FULL;
+	CREATE TABLE tab_rf_key (a int PRIMARY KEY, b text);
+	CREATE TABLE tab_rf_parted (a int PRIMARY KEY, b text) PARTITION BY RANGE (a);
+	CREATE TABLE tab_rf_part1 PARTITION OF tab_rf_parted FOR VALUES FROM (0) TO (100);
+	CREATE TABLE tab_rf_part2 PARTITION OF tab_rf_parted FOR VALUES FROM (100) TO (200););
+
+$node_publisher->safe_psql('postgres', $ddl);
+$node_subscriber->safe_psql('postgres', $ddl);
+
+# Rows that exist before the subscription go through the initial copy
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO tab_rf VALUES (1, 'one'), (20, 'twenty'), (30, 'skip')");
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO tab_rf_parted VALUES (1, 'one'), (150, 'one hundred fifty')");
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO tab_rf_key VALUES (5, 'five'), (25, 'twenty-five'), (30, 'thirty'), (40, 'forty')"
+);
+
+# tab_rf has a replica identity of FULL, so its filter can use any column;
+# the filters of the other tables can only use their primary keys.
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE tab_rf WHERE (a > 10 AND b <> 'skip'), tab_rf_parted WHERE (a >= 100), tab_rf_key WHERE (a > 10)"
+);
+
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+$node_subscriber->safe_psql('postgres',
+	"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr' PUBLICATION tap_pub"
+);
+
+$node_publisher->wait_for_catchup('tap_sub');
+$node_subscriber->poll_query_until('postgres',
+	"SELECT count(1) = 0 FROM pg_subscription_rel WHERE srsubstate NOT IN ('s', 'r');"
+) or die "Timed out while waiting for subscriber to synchronize data";
+
+my $result = $node_subscriber->safe_psql('postgres',
+	"SELECT a, b FROM tab_rf ORDER BY a");
+is($result, '20|twenty', 'initial copy applies the row filter');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT a, b FROM tab_rf_parted ORDER BY a");
+is($result, '150|one hundred fifty',
+	'initial copy applies the row filter of the partitioned table');
+
+# Changes are filtered by the publisher
+$node_publisher->safe_psql(
+	'postgres', qq(
+	INSERT INTO tab_rf VALUES (2, 'two'), (40, 'forty'), (50, 'skip');
+	UPDATE tab_rf SET b = 'TWENTY' WHERE a = 20;
+	INSERT INTO tab_rf_parted VALUES (2, 'two'), (160, 'one hundred sixty');
+	DELETE FROM tab_rf_parted WHERE a = 150;
+	));
+
+$node_publisher->wait_for_catchup('tap_sub');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT a, b FROM tab_rf ORDER BY a");
+is( $result, '20|TWENTY
+40|forty', 'changes are filtered');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT a, b FROM tab_rf_parted ORDER BY a");
+is($result, '160|one hundred sixty', 'changes to partitions are filtered');
+
+# Updates that move a row into the filter are sent as inserts, and those
+# that move it out as deletes.  Deletes are filtered on the old row.
+$node_publisher->safe_psql(
+	'postgres', qq(
+	UPDATE tab_rf SET b = 'skip' WHERE a = 40;
+	UPDATE tab_rf SET b = 'thirty' WHERE a = 30;
+	DELETE FROM tab_rf WHERE a = 20;
+	UPDATE tab_rf_key SET a = 15 WHERE a = 5;
+	UPDATE tab_rf_key SET a = 3 WHERE a = 25;
+	UPDATE tab_rf_key SET b = 'THIRTY' WHERE a = 30;
+	DELETE FROM tab_rf_key WHERE a = 40;
+	DELETE FROM tab_rf_key WHERE a = 3;
+	));
+
+$node_publisher->wait_for_catchup('tap_sub');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT a, b FROM tab_rf ORDER BY a");
+is($result, '30|thirty',
+	'updates crossing a filter on a non-key column and deletes are filtered');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT a, b FROM tab_rf_key ORDER BY a");
+is( $result, '15|five
+30|THIRTY', 'updates crossing a filter on the key and deletes are filtered');
+
+$node_subscriber->stop('fast');
+$node_publisher->stop('fast');